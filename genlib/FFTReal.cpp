@@ -9,6 +9,8 @@
 *       Portable ISO C++                                                     *
 *                                                                            *
 * Tab = 3                                                                    *
+*                                                                            *
+*       Modified for RTcmix: shared look-up tables (see FFTReal.h).          *
 *****************************************************************************/
 
 
@@ -19,6 +21,7 @@
 
 #include	<cassert>
 #include	<cmath>
+#include	<pthread.h>
 
 
 
@@ -43,8 +46,8 @@
 FFTReal::FFTReal (const long length)
 :	_length (length)
 ,	_nbr_bits (int (floor (log (length) / log (2) + 0.5)))
-,	_bit_rev_lut (int (floor (log (length) / log (2) + 0.5)))
-,	_trigo_lut (int (floor (log (length) / log (2) + 0.5)))
+,	_bit_rev_lut (shared_bit_rev_lut (int (floor (log (length) / log (2) + 0.5))))
+,	_trigo_lut (shared_trigo_lut (int (floor (log (length) / log (2) + 0.5))))
 ,	_sqrt2_2 (flt_t (sqrt (2) * 0.5))
 {
 	assert ((1L << _nbr_bits) == length);
@@ -583,6 +586,62 @@ FFTReal::TrigoLUT::~TrigoLUT (void)
 
 
 
+/*\\\ SHARED LOOK-UP TABLES \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
+
+
+
+enum {	MAX_NBR_BITS = 31	};
+
+static pthread_mutex_t	lut_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*==========================================================================*/
+/*      Name: shared_bit_rev_lut, shared_trigo_lut                          */
+/*      Description: Return the table for FFTs of 2^nbr_bits points,        */
+/*                   building it the first time it is asked for.            */
+/*      Input parameters:                                                   */
+/*        - nbr_bits: number of bits of the array on which we want to do a  */
+/*                    FFT. Range: > 0                                       */
+/*      Throws: std::bad_alloc                                              */
+/*==========================================================================*/
+
+const FFTReal::BitReversedLUT &	FFTReal::shared_bit_rev_lut (const int nbr_bits)
+{
+	static BitReversedLUT *	lut_arr [MAX_NBR_BITS + 1];
+
+	assert (nbr_bits >= 0 && nbr_bits <= MAX_NBR_BITS);
+	pthread_mutex_lock (&lut_lock);
+	if (lut_arr [nbr_bits] == 0)
+	{
+		lut_arr [nbr_bits] = new BitReversedLUT (nbr_bits);
+	}
+	const BitReversedLUT &	lut = *lut_arr [nbr_bits];
+	pthread_mutex_unlock (&lut_lock);
+
+	return (lut);
+}
+
+
+
+const FFTReal::TrigoLUT &	FFTReal::shared_trigo_lut (const int nbr_bits)
+{
+	static TrigoLUT *	lut_arr [MAX_NBR_BITS + 1];
+
+	assert (nbr_bits >= 0 && nbr_bits <= MAX_NBR_BITS);
+	pthread_mutex_lock (&lut_lock);
+	if (lut_arr [nbr_bits] == 0)
+	{
+		lut_arr [nbr_bits] = new TrigoLUT (nbr_bits);
+	}
+	const TrigoLUT &	lut = *lut_arr [nbr_bits];
+	pthread_mutex_unlock (&lut_lock);
+
+	return (lut);
+}
+
+
+
 #if defined (_MSC_VER)
 #pragma pack (pop)
 #endif	// _MSC_VER
@@ -9,6 +9,10 @@
 *       Portable ISO C++                                                     *
 *                                                                            *
 * Tab = 3                                                                    *
+*                                                                            *
+*       Modified for RTcmix: the look-up tables are built once per size and  *
+*       shared by all FFTReal objects of that size, rather than built by     *
+*       every object.                                                        *
 *****************************************************************************/
 
 
@@ -80,10 +84,14 @@ private:
 		flt_t	*			_ptr;
 	};
 
+	/* Process-wide tables, one of each per size, never freed */
+	static const BitReversedLUT &	shared_bit_rev_lut (const int nbr_bits);
+	static const TrigoLUT &	shared_trigo_lut (const int nbr_bits);
+
 	const long		_length;
 	const int		_nbr_bits;
-	const BitReversedLUT	_bit_rev_lut;
-	const TrigoLUT	_trigo_lut;
+	const BitReversedLUT &	_bit_rev_lut;
+	const TrigoLUT &	_trigo_lut;
 	const flt_t		_sqrt2_2;
 	flt_t *			_buffer_ptr;
 
@@ -72,6 +72,46 @@ float Ocomb::next(float input, float delaySamps)
 	return _lastout;
 }
 
+#define COMB_CHUNK 256
+
+void Ocomb::next(const float input[], float output[], int frames)
+{
+	float loop[COMB_CHUNK];
+	int done = 0;
+	while (done < frames) {
+		long count = _delay->blockLimit();
+		if (count > frames - done)
+			count = frames - done;
+		if (count > COMB_CHUNK)
+			count = COMB_CHUNK;
+		if (count < 1) {	// delay too short to read ahead
+			output[done] = next(input[done]);
+			++done;
+			continue;
+		}
+		const float *in = &input[done];
+		float *out = &output[done];
+		const float gain = _gain;
+		loop[0] = in[0] + (gain * _delay->last());
+		_delay->readBlock(out, count);
+		for (long n = 1; n < count; ++n)
+			loop[n] = in[n] + (gain * out[n - 1]);
+		_delay->writeBlock(loop, count);
+		done += count;
+	}
+	if (frames > 0)
+		_lastout = output[frames - 1];
+}
+
+void Ocomb::next(const float input[], float output[], int frames, float delaySamps)
+{
+	if (delaySamps != _delsamps) {
+		_delsamps = delaySamps;
+		_delay->setdelay(_delsamps);
+	}
+	next(input, output, frames);
+}
+
 float Ocomb::frequency() const
 {
 	float delay = _delay->delay();
@@ -51,6 +51,15 @@ public:
 
 	float next(float input, float delaySamps);
 
+	// Block versions of the two next() methods: filter <frames> of <input>
+	// into <output>, with the one delay for the whole block.  These read and
+	// write the delay line a run at a time (see Odelay::readBlock), which
+	// the compiler can vectorize, wherever the delay is at least as long
+	// as the run.
+
+	void next(const float input[], float output[], int frames);
+	void next(const float input[], float output[], int frames, float delaySamps);
+
 	// Current frequency of comb
 	
 	float frequency() const;
@@ -0,0 +1,167 @@
+// RTcmix - Copyright (C) 2005  The RTcmix Development Team
+// See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+// the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+
+#include <Oconvolve.h>
+#include <Offt.h>
+#include <string.h>
+//#define NDEBUG
+#include <assert.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE__)
+#define OCONVOLVE_SIMD 1
+#include <xmmintrin.h>
+#endif
+
+Oconvolve::Impulse::Impulse(const float impulse[], int implen, int blocklen)
+	: _blocklen(blocklen), _refcount(0)
+{
+	assert(blocklen > 0 && (blocklen & (blocklen - 1)) == 0);
+	_numparts = (implen + blocklen - 1) / blocklen;
+	if (_numparts < 1)
+		_numparts = 1;
+
+	const int fftlen = blocklen * 2;
+	_spectra = new float [_numparts * fftlen];
+	Offt fft(fftlen, Offt::kRealToComplex);
+	float *fftbuf = fft.getbuf();
+
+	// Offt scales its forward transform by 1 / fftlen, and so both spectra
+	// multiplied in process(); make up for one of them here.
+	const float scale = (float) fftlen;
+	for (int part = 0; part < _numparts; part++) {
+		const int start = part * blocklen;
+		int len = implen - start;
+		if (len > blocklen)
+			len = blocklen;
+		for (int i = 0; i < len; i++)
+			fftbuf[i] = impulse[start + i];
+		for (int i = len; i < fftlen; i++)
+			fftbuf[i] = 0.0f;
+		fft.r2c();
+		float *spectrum = &_spectra[part * fftlen];
+		for (int i = 0; i < fftlen; i++)
+			spectrum[i] = fftbuf[i] * scale;
+	}
+}
+
+Oconvolve::Impulse::~Impulse()
+{
+	delete [] _spectra;
+}
+
+void Oconvolve::Impulse::ref()
+{
+	__sync_add_and_fetch(&_refcount, 1);
+}
+
+void Oconvolve::Impulse::unref()
+{
+	if (__sync_sub_and_fetch(&_refcount, 1) == 0)
+		delete this;
+}
+
+
+Oconvolve::Oconvolve(const float impulse[], int implen, int blocklen)
+{
+	init(new Impulse(impulse, implen, blocklen));
+}
+
+Oconvolve::Oconvolve(Impulse *impulse)
+{
+	init(impulse);
+}
+
+void Oconvolve::init(Impulse *impulse)
+{
+	_impulse = impulse;
+	_impulse->ref();
+	_blocklen = impulse->getblocklen();
+	_fftlen = _blocklen * 2;
+	_numparts = impulse->getpartitions();
+
+	_history = new float [_numparts * _fftlen];
+	_accum = new float [_fftlen];
+	_lastin = new float [_blocklen];
+	_fft = new Offt(_fftlen);
+	_fftbuf = _fft->getbuf();
+	clear();
+}
+
+Oconvolve::~Oconvolve()
+{
+	_impulse->unref();
+	delete [] _history;
+	delete [] _accum;
+	delete [] _lastin;
+	delete _fft;
+}
+
+void Oconvolve::clear()
+{
+	memset(_history, 0, sizeof(float) * _numparts * _fftlen);
+	memset(_lastin, 0, sizeof(float) * _blocklen);
+	_current = 0;
+}
+
+// Add the product of spectra <x> and <h>, in Offt format, to <acc>.  With a
+// long impulse response this is nearly all of the work, so with SSE it does
+// two bins at a time; the sums are the same as those of the plain loop.
+
+static inline void multiplyAdd(float *acc, const float *x, const float *h,
+	int len)
+{
+	acc[0] += x[0] * h[0];		// DC
+	acc[1] += x[1] * h[1];		// Nyquist
+	int i = 2;
+#ifdef OCONVOLVE_SIMD
+	const __m128 negate = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+	for ( ; i + 4 <= len; i += 4) {
+		const __m128 xv = _mm_loadu_ps(&x[i]);
+		const __m128 hv = _mm_loadu_ps(&h[i]);
+		const __m128 xr = _mm_shuffle_ps(xv, xv, _MM_SHUFFLE(2, 2, 0, 0));
+		const __m128 xi = _mm_shuffle_ps(xv, xv, _MM_SHUFFLE(3, 3, 1, 1));
+		const __m128 hswap = _mm_shuffle_ps(hv, hv, _MM_SHUFFLE(2, 3, 0, 1));
+		// (xr * hr - xi * hi, xr * hi + xi * hr) for each bin
+		const __m128 prod = _mm_add_ps(_mm_mul_ps(xr, hv),
+							_mm_xor_ps(_mm_mul_ps(xi, hswap), negate));
+		_mm_storeu_ps(&acc[i], _mm_add_ps(_mm_loadu_ps(&acc[i]), prod));
+	}
+#endif
+	for ( ; i < len; i += 2) {
+		const float xr = x[i], xi = x[i + 1];
+		const float hr = h[i], hi = h[i + 1];
+		acc[i] += (xr * hr) - (xi * hi);
+		acc[i + 1] += (xr * hi) + (xi * hr);
+	}
+}
+
+// Overlap-save: transform the previous block followed by this one, and keep
+// only the second half of the inverse transform, where the circular
+// convolution equals the linear one.
+
+void Oconvolve::process(const float in[], float out[])
+{
+	memcpy(_fftbuf, _lastin, sizeof(float) * _blocklen);
+	memcpy(_fftbuf + _blocklen, in, sizeof(float) * _blocklen);
+	memcpy(_lastin, in, sizeof(float) * _blocklen);
+	_fft->r2c();
+	memcpy(&_history[_current * _fftlen], _fftbuf, sizeof(float) * _fftlen);
+
+	memset(_accum, 0, sizeof(float) * _fftlen);
+	int slot = _current;
+	for (int part = 0; part < _numparts; part++) {
+		multiplyAdd(_accum, &_history[slot * _fftlen], _impulse->spectrum(part),
+																			_fftlen);
+		if (--slot < 0)
+			slot = _numparts - 1;
+	}
+
+	memcpy(_fftbuf, _accum, sizeof(float) * _fftlen);
+	_fft->c2r();
+	memcpy(out, _fftbuf + _blocklen, sizeof(float) * _blocklen);
+
+	if (++_current == _numparts)
+		_current = 0;
+}
+
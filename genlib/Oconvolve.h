@@ -0,0 +1,67 @@
+// RTcmix - Copyright (C) 2005  The RTcmix Development Team
+// See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+// the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+
+// Oconvolve convolves a signal with an impulse response of any length, a
+// block at a time, using uniformly partitioned frequency-domain convolution.
+// The impulse response is cut into partitions of <blocklen> frames, and their
+// spectra are computed once, when the object is made.  Each call to process()
+// takes one block of input, adds the product of its spectrum and those of
+// earlier blocks with the partition spectra, and returns one block of output.
+// The output has no delay relative to the input beyond the block itself, and
+// the cost of a block is two FFTs of 2 * <blocklen> points plus one complex
+// multiply-add per bin per partition, however long the impulse response.
+//
+// <blocklen> must be a power of 2.  Use with Obucket to feed it from an
+// instrument whose run() buffer size differs.
+
+class Offt;
+
+class Oconvolve {
+public:
+	// The partition spectra of an impulse response.  These never change once
+	// made, so any number of Oconvolve objects, on any threads, can share
+	// them.  Call ref() for each holder, and unref() when it is done.
+	class Impulse {
+	public:
+		Impulse(const float impulse[], int implen, int blocklen);
+		void ref();
+		void unref();
+		int getblocklen() const { return _blocklen; }
+		int getpartitions() const { return _numparts; }
+		const float *spectrum(int part) const { return &_spectra[part * 2 * _blocklen]; }
+	private:
+		~Impulse();
+		int _blocklen;
+		int _numparts;
+		float *_spectra;
+		volatile int _refcount;
+	};
+
+	Oconvolve(const float impulse[], int implen, int blocklen);
+	Oconvolve(Impulse *impulse);		// shares <impulse>
+	~Oconvolve();
+
+	// Convolve the next <blocklen> samples of <in>, writing as many to <out>,
+	// which may be the same array.
+	void process(const float in[], float out[]);
+	void clear();
+
+	int getblocklen() const { return _blocklen; }
+	int getpartitions() const { return _numparts; }
+
+private:
+	void init(Impulse *impulse);
+
+	Impulse *_impulse;
+	int _blocklen;
+	int _fftlen;
+	int _numparts;
+	int _current;		// partition of _history holding the newest input
+	float *_history;	// spectra of the last _numparts input blocks
+	float *_accum;
+	float *_lastin;		// previous block of input
+	float *_fftbuf;
+	Offt *_fft;
+};
+
@@ -79,6 +79,39 @@ float Odelay::next(float input)
 	return _lastout;
 }
 
+void Odelay::readBlock(float output[], int frames)
+{
+	assert(frames <= blockLimit());
+	int done = 0;
+	while (done < frames) {
+		long run = _len - _outpoint;
+		if (run > frames - done)
+			run = frames - done;
+		memcpy(&output[done], &_dline[_outpoint], run * sizeof(float));
+		_outpoint += run;
+		if (_outpoint == _len)
+			_outpoint = 0;
+		done += run;
+	}
+	if (frames > 0)
+		_lastout = output[frames - 1];
+}
+
+void Odelay::writeBlock(const float input[], int frames)
+{
+	int done = 0;
+	while (done < frames) {
+		long run = _len - _inpoint;
+		if (run > frames - done)
+			run = frames - done;
+		memcpy(&_dline[_inpoint], &input[done], run * sizeof(float));
+		_inpoint += run;
+		if (_inpoint == _len)
+			_inpoint = 0;
+		done += run;
+	}
+}
+
 static float *newFloats(float *oldptr, long oldlen, long *newlen)
 {
 	float *ptr = NULL;
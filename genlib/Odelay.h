@@ -64,6 +64,21 @@ public:
 	virtual void setdelay(double lagsamps);
 	virtual float next(float input);
 
+	// --------------------------------------------------------------------------
+	// API 3: blocks for API 2
+	//
+	// readBlock() returns the next <frames> values that calls to next() would
+	// return, and writeBlock() then stores the <frames> inputs those calls
+	// would have stored.  This lets a caller whose input depends on earlier
+	// output, such as a comb filter, work a block at a time, with each loop a
+	// straight run through the delay line.  It only works for blocks whose
+	// reads do not depend on their own writes: <frames> may be no more than
+	// blockLimit(), which is 0 when the delay is too short for any.
+
+	virtual void readBlock(float output[], int frames);
+	void writeBlock(const float input[], int frames);
+	virtual long blockLimit() const { return lag(); }
+
 	float last() const { return _lastout; }
 
 	long  length() const { return _len; }
@@ -73,6 +88,9 @@ public:
 	
 protected:
 	long	resize(long newLen);
+	// Whole samples from the output pointer to the input pointer
+	long	lag() const { return (_inpoint >= _outpoint) ? _inpoint - _outpoint
+	                                                     : _inpoint - _outpoint + _len; }
 
 protected:
 	float *_dline;
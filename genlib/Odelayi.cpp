@@ -4,6 +4,7 @@
 */
 
 #include <Odelayi.h>
+#include <assert.h>
 
 Odelayi::Odelayi(long defaultLen) : Odelay(defaultLen), _frac(0.0)
 {
@@ -42,6 +43,37 @@ float Odelayi::next(float input)
 	return _lastout = next - _frac * (next - out);
 }
 
+// Works in runs that stop one short of the end of the line, so that both
+// samples of each interpolation are in the run, and does the sample that
+// straddles the end by itself.
+
+void Odelayi::readBlock(float output[], int frames)
+{
+	assert(frames <= blockLimit());
+	const float frac = _frac;
+	int done = 0;
+	while (done < frames) {
+		long run = _len - 1 - _outpoint;
+		if (run <= 0) {
+			const float out = _dline[_outpoint];
+			const float next = _dline[0];
+			_outpoint = 0;
+			output[done++] = next - frac * (next - out);
+			continue;
+		}
+		if (run > frames - done)
+			run = frames - done;
+		const float *line = &_dline[_outpoint];
+		float *op = &output[done];
+		for (long n = 0; n < run; ++n)
+			op[n] = line[n + 1] - frac * (line[n + 1] - line[n]);
+		_outpoint += run;
+		done += run;
+	}
+	if (frames > 0)
+		_lastout = output[frames - 1];
+}
+
 float Odelayi::delay() const
 {
 	return Odelay::delay() + _frac;
@@ -20,6 +20,9 @@ public:
 	virtual float getsamp(double lagsamps);
 	virtual void setdelay(double lagsamps);
 	virtual float next(float input);
+	virtual void readBlock(float output[], int frames);
+	// Each output also reads the sample after, so one fewer.
+	virtual long blockLimit() const { return lag() - 1; }
 	virtual float delay() const;
 
 private:
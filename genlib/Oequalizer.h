@@ -41,6 +41,26 @@ public:
 	inline float next(float input);
 	float last() const { return _y1; }
 
+	// The coefficients next() uses: c[0] * input + c[1] * x1 + c[2] * x2
+	// - c[3] * y1 - c[4] * y2.
+	inline void getcoeffs(float c[5]) const
+	{
+		c[0] = _c0;
+		c[1] = _c1;
+		c[2] = _c2;
+		c[3] = _c3;
+		c[4] = _c4;
+	}
+	// Set them as getcoeffs() gives them, e.g. from another Oequalizer.
+	inline void setcoeffs(const float c[5])
+	{
+		_c0 = c[0];
+		_c1 = c[1];
+		_c2 = c[2];
+		_c3 = c[3];
+		_c4 = c[4];
+	}
+
 private:
 	float _sr;
 	OeqType _type;
@@ -0,0 +1,216 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include "Ofdn.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE__)
+#define OFDN_SIMD 1
+#include <xmmintrin.h>
+#endif
+
+Ofdn::Ofdn(int lines, int maxDelay)
+	: _lines(lines), _write(0)
+{
+	assert(lines == 4 || lines == 8 || lines == 16);
+	assert(maxDelay > 0);
+	_size = 1;
+	while (_size <= maxDelay)
+		_size <<= 1;
+	_mask = _size - 1;
+	_buf = new float [_lines * _size];
+	_lineout = new float [kMaxLines * kBlock];
+	_rows = new float [kMaxLines * kBlock];
+	for (int i = 0; i < _lines; i++) {
+		_delay[i] = maxDelay;
+		_gain[i] = 1.0f;
+		_damping[i] = 0.0f;
+		_c0[i] = 1.0f;
+		_c1[i] = 0.0f;
+		setFeedback(i, i, 1.0f);
+	}
+	clear();
+}
+
+Ofdn::~Ofdn()
+{
+	delete [] _buf;
+	delete [] _lineout;
+	delete [] _rows;
+}
+
+void Ofdn::clear()
+{
+	memset(_buf, 0, sizeof(float) * _lines * _size);
+	for (int i = 0; i < _lines; i++)
+		_z[i] = 0.0f;
+}
+
+void Ofdn::setDelay(int line, int frames)
+{
+	if (frames < 1)
+		frames = 1;
+	else if (frames > _mask)
+		frames = _mask;
+	_delay[line] = frames;
+}
+
+void Ofdn::setGain(int line, float gain)
+{
+	_gain[line] = gain;
+	_c0[line] = gain * (1.0f - _damping[line]);
+}
+
+void Ofdn::setDamping(int line, float damping)
+{
+	_damping[line] = damping;
+	_c0[line] = _gain[line] * (1.0f - damping);
+	_c1[line] = damping;
+}
+
+void Ofdn::setFeedback(int line, int row, float sign)
+{
+	_row[line] = row;
+	_mult[line] = sign / sqrtf((float) _lines);
+}
+
+void Ofdn::readLine(int line, float *dest, int len) const
+{
+	const float *buf = &_buf[line * _size];
+	const int start = (_write - _delay[line]) & _mask;
+	const int first = (start + len <= _size) ? len : _size - start;
+	memcpy(dest, &buf[start], first * sizeof(float));
+	memcpy(&dest[first], buf, (len - first) * sizeof(float));
+}
+
+void Ofdn::writeLine(int line, const float *src, int len)
+{
+	float *buf = &_buf[line * _size];
+	const int first = (_write + len <= _size) ? len : _size - _write;
+	memcpy(&buf[_write], src, first * sizeof(float));
+	memcpy(buf, &src[first], (len - first) * sizeof(float));
+}
+
+// y = x * gain * (1 - damping) + y' * damping, for each line.  This is the
+// only recursive part, so it goes across the lines: four lines' frames are
+// transposed so that each vector holds one frame of the four, and back.
+
+void Ofdn::damp(int len)
+{
+	for (int group = 0; group < _lines; group += 4) {
+		int k = 0;
+#ifdef OFDN_SIMD
+		float *x0 = &_lineout[group * kBlock];
+		float *x1 = x0 + kBlock, *x2 = x1 + kBlock, *x3 = x2 + kBlock;
+		const __m128 c0 = _mm_loadu_ps(&_c0[group]);
+		const __m128 c1 = _mm_loadu_ps(&_c1[group]);
+		__m128 z = _mm_loadu_ps(&_z[group]);
+		for ( ; k + 4 <= len; k += 4) {
+			__m128 f0 = _mm_loadu_ps(&x0[k]), f1 = _mm_loadu_ps(&x1[k]);
+			__m128 f2 = _mm_loadu_ps(&x2[k]), f3 = _mm_loadu_ps(&x3[k]);
+			_MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+			f0 = z = _mm_add_ps(_mm_mul_ps(f0, c0), _mm_mul_ps(z, c1));
+			f1 = z = _mm_add_ps(_mm_mul_ps(f1, c0), _mm_mul_ps(z, c1));
+			f2 = z = _mm_add_ps(_mm_mul_ps(f2, c0), _mm_mul_ps(z, c1));
+			f3 = z = _mm_add_ps(_mm_mul_ps(f3, c0), _mm_mul_ps(z, c1));
+			_MM_TRANSPOSE4_PS(f0, f1, f2, f3);
+			_mm_storeu_ps(&x0[k], f0);
+			_mm_storeu_ps(&x1[k], f1);
+			_mm_storeu_ps(&x2[k], f2);
+			_mm_storeu_ps(&x3[k], f3);
+		}
+		_mm_storeu_ps(&_z[group], z);
+#endif
+		for (int i = group; i < group + 4; i++) {
+			float *x = &_lineout[i * kBlock];
+			float y = _z[i];
+			for (int j = k; j < len; j++)
+				x[j] = y = x[j] * _c0[i] + y * _c1[i];
+			_z[i] = y;
+		}
+	}
+}
+
+// Butterflies over whole blocks, then each line's row back in, with its
+// input.  Denormals, infinities and NaNs are written as zero.
+
+void Ofdn::feedback(const float * const in[], int offset, int len)
+{
+	memcpy(_rows, _lineout, _lines * kBlock * sizeof(float));
+	for (int span = 1; span < _lines; span <<= 1) {
+		for (int i = 0; i < _lines; i += span * 2) {
+			for (int j = i; j < i + span; j++) {
+				float *a = &_rows[j * kBlock];
+				float *b = &_rows[(j + span) * kBlock];
+				int k = 0;
+#ifdef OFDN_SIMD
+				for ( ; k + 4 <= len; k += 4) {
+					const __m128 va = _mm_loadu_ps(&a[k]);
+					const __m128 vb = _mm_loadu_ps(&b[k]);
+					_mm_storeu_ps(&a[k], _mm_add_ps(va, vb));
+					_mm_storeu_ps(&b[k], _mm_sub_ps(va, vb));
+				}
+#endif
+				for ( ; k < len; k++) {
+					const float va = a[k], vb = b[k];
+					a[k] = va + vb;
+					b[k] = va - vb;
+				}
+			}
+		}
+	}
+
+	float line[kBlock];
+	for (int i = 0; i < _lines; i++) {
+		const float *src = in[i] + offset;
+		const float *row = &_rows[_row[i] * kBlock];
+		const float mult = _mult[i];
+		int k = 0;
+#ifdef OFDN_SIMD
+		const __m128 vmult = _mm_set1_ps(mult);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 lo = _mm_set1_ps(FLT_MIN), hi = _mm_set1_ps(FLT_MAX);
+		for ( ; k + 4 <= len; k += 4) {
+			const __m128 v = _mm_add_ps(_mm_loadu_ps(&src[k]),
+										_mm_mul_ps(_mm_loadu_ps(&row[k]), vmult));
+			const __m128 a = _mm_max_ps(v, _mm_sub_ps(zero, v));
+			const __m128 ok = _mm_and_ps(_mm_cmpge_ps(a, lo), _mm_cmple_ps(a, hi));
+			_mm_storeu_ps(&line[k], _mm_and_ps(v, ok));
+		}
+#endif
+		for ( ; k < len; k++) {
+			const float v = src[k] + row[k] * mult;
+			const float a = fabsf(v);
+			line[k] = (a >= FLT_MIN && a <= FLT_MAX) ? v : 0.0f;
+		}
+		writeLine(i, line, len);
+	}
+}
+
+void Ofdn::process(const float * const in[], float * const out[], int frames)
+{
+	int shortest = _delay[0];
+	for (int i = 1; i < _lines; i++)
+		if (_delay[i] < shortest)
+			shortest = _delay[i];
+
+	for (int done = 0; done < frames; ) {
+		int len = frames - done;
+		if (len > kBlock)
+			len = kBlock;
+		if (len > shortest)
+			len = shortest;
+		for (int i = 0; i < _lines; i++)
+			readLine(i, &_lineout[i * kBlock], len);
+		damp(len);
+		for (int i = 0; i < _lines; i++)
+			memcpy(out[i] + done, &_lineout[i * kBlock], len * sizeof(float));
+		feedback(in, done, len);
+		_write = (_write + len) & _mask;
+		done += len;
+	}
+}
@@ -0,0 +1,68 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OFDN_H_
+#define _OFDN_H_ 1
+
+// Feedback delay network: 4, 8 or 16 delay lines, each with a gain and a
+// one-pole damping filter on its output, fed back through a Hadamard
+// matrix (scaled to lose no energy) along with each line's own input.
+// It runs a block at a time.  No line reads what the same block writes as
+// long as the block is no longer than the shortest delay, so each block
+// is read from all the lines at once; the damping filters run with the
+// lines as SIMD lanes, four at a time, and the Hadamard transform and the
+// writes run four frames at a time.  This is the core of a reverb, cheap
+// enough to run one per group of sources.
+//
+//    Ofdn fdn(4, maxDelay);
+//    fdn.setDelay(0, 1931); ...
+//    fdn.process(in, out, frames);	// in[line][frame], out[line][frame]
+
+class Ofdn
+{
+public:
+	Ofdn(int lines, int maxDelay);
+	~Ofdn();
+
+	void clear();
+	int lines() const { return _lines; }
+
+	// Delay of <line>, from 1 to maxDelay frames.
+	void setDelay(int line, int frames);
+	void setGain(int line, float gain);
+	// 0 for none, up to 1
+	void setDamping(int line, float damping);
+	// Feed row <row> of the Hadamard matrix, times <sign>, back into <line>,
+	// rather than row <line>.  The rows are in natural (Sylvester) order:
+	// row r, column c is -1 if r & c has an odd number of bits set.
+	void setFeedback(int line, int row, float sign);
+
+	// For each of <frames> frames, write the damped output of each line to
+	// <out>[line], and write its input from <in>[line] plus the feedback
+	// into the line.
+	void process(const float * const in[], float * const out[], int frames);
+
+private:
+	enum { kMaxLines = 16, kBlock = 64 };
+
+	void readLine(int line, float *dest, int len) const;
+	void writeLine(int line, const float *src, int len);
+	void damp(int len);
+	void feedback(const float * const in[], int offset, int len);
+
+	int _lines;
+	int _size, _mask;		// length of each line's buffer, a power of 2
+	int _write;				// where every line writes next
+	float *_buf;			// the lines, one after another
+	int _delay[kMaxLines];
+	float _gain[kMaxLines], _damping[kMaxLines];
+	float _c0[kMaxLines], _c1[kMaxLines];	// damping filter coefficients
+	float _z[kMaxLines];					// and state
+	int _row[kMaxLines];
+	float _mult[kMaxLines];		// sign and scaling of _row
+	float *_lineout;		// [kMaxLines][kBlock], read and then damped
+	float *_rows;			// [kMaxLines][kBlock], transformed
+};
+
+#endif // _OFDN_H_
@@ -4,11 +4,53 @@
 */
 
 #include <Offt.h>
-#ifndef FFTW
+#ifdef FFTW
+#include <pthread.h>
+#else
 #include <FFTReal.h>
 #endif
 
 
+#ifdef FFTW
+
+// Plans are made once per FFT size and direction, and shared by every
+// Offt, which runs them on its own buffers.  (Making a plan is slow, and
+// the FFTW planner must not be entered by two threads at once.)  Offt
+// buffers all come from fftwf_malloc, so they have the alignment the plans
+// were made for.
+
+#define kMaxPlanBits 31
+
+static fftwf_plan _r2c_plans[kMaxPlanBits + 1];
+static fftwf_plan _c2r_plans[kMaxPlanBits + 1];
+static pthread_mutex_t _planLock = PTHREAD_MUTEX_INITIALIZER;
+
+static fftwf_plan sharedPlan(int len, bool forward)
+{
+	int bits = 0;
+	while ((1 << bits) < len)
+		bits++;
+	fftwf_plan *plans = forward ? _r2c_plans : _c2r_plans;
+	pthread_mutex_lock(&_planLock);
+	if (plans[bits] == NULL) {
+		float *buf = (float *) fftwf_malloc(sizeof(float) * len);
+		fftwf_complex *cbuf = (fftwf_complex *)
+						fftwf_malloc(sizeof(fftwf_complex) * ((len / 2) + 1));
+		if (forward)
+			plans[bits] = fftwf_plan_dft_r2c_1d(len, buf, cbuf, FFTW_ESTIMATE);
+		else
+			plans[bits] = fftwf_plan_dft_c2r_1d(len, cbuf, buf, FFTW_ESTIMATE);
+		fftwf_free(buf);
+		fftwf_free(cbuf);
+	}
+	fftwf_plan plan = plans[bits];
+	pthread_mutex_unlock(&_planLock);
+	return plan;
+}
+
+#endif // FFTW
+
+
 Offt::Offt(int fftsize, unsigned int flags)
 	: _len(fftsize)
 {
@@ -18,9 +60,9 @@ Offt::Offt(int fftsize, unsigned int flags)
 	int csize = sizeof(fftwf_complex) * ((_len / 2) + 1);
 	_cbuf = (fftwf_complex *) fftwf_malloc(csize);
 	if (flags & kRealToComplex)
-		_plan_r2c = fftwf_plan_dft_r2c_1d(_len, _buf, _cbuf, FFTW_ESTIMATE);
+		_plan_r2c = sharedPlan(_len, true);
 	if (flags & kComplexToReal)
-		_plan_c2r = fftwf_plan_dft_c2r_1d(_len, _cbuf, _buf, FFTW_ESTIMATE);
+		_plan_c2r = sharedPlan(_len, false);
 #else // !FFTW
 	_buf = new float [_len];
 	_tmp = new float [_len];
@@ -31,10 +73,6 @@ Offt::Offt(int fftsize, unsigned int flags)
 Offt::~Offt()
 {
 #ifdef FFTW
-	if (_plan_r2c)
-		fftwf_destroy_plan(_plan_r2c);
-	if (_plan_c2r)
-		fftwf_destroy_plan(_plan_c2r);
 	fftwf_free(_buf);
 	fftwf_free(_cbuf);
 #else // !FFTW
@@ -49,7 +87,7 @@ Offt::~Offt()
 
 void Offt::r2c()
 {
-	fftwf_execute(_plan_r2c);
+	fftwf_execute_dft_r2c(_plan_r2c, _buf, _cbuf);
 
 	// _cbuf has complex result in real,imaginary pairs from DC to Nyquist;
 	// copy into _buf while reordering to...
@@ -78,7 +116,7 @@ void Offt::c2r()
 		_cbuf[i][1] = _buf[i + i + 1];
 	}
 
-	fftwf_execute(_plan_c2r);
+	fftwf_execute_dft_c2r(_plan_c2r, _cbuf, _buf);
 }
 
 #else // !FFTW
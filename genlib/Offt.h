@@ -17,6 +17,10 @@
 // Muck around with the FFT complex data, then call c2r() to turn it back into
 // real-valued samples.
 //
+// The tables or plans for each FFT size are made the first time an Offt of
+// that size is, and kept for the rest of the process, so that later notes
+// using the same size start without building them.
+//
 // Check out Obucket also.  This class makes it fairly easy to decouple the
 // FFT length from your instrument's buffer size and to have a fixed latency,
 // regardless of note start time.  See insts/jg/SPECTACLE2_BASE.cpp for an
@@ -0,0 +1,389 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Ofilterbank.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+// The band groups run as four-lane SSE vectors where we have them.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE__)
+#define FILTERBANK_SSE 1
+#define FILTERBANK_SIMD 1
+#include <xmmintrin.h>
+
+namespace {
+
+typedef __m128 vec4;
+
+inline vec4 vload(const float *p) { return _mm_loadu_ps(p); }
+inline void vstore(float *p, vec4 v) { _mm_storeu_ps(p, v); }
+inline vec4 vsplat(float x) { return _mm_set1_ps(x); }
+inline vec4 vadd(vec4 a, vec4 b) { return _mm_add_ps(a, b); }
+inline vec4 vsub(vec4 a, vec4 b) { return _mm_sub_ps(a, b); }
+inline vec4 vmul(vec4 a, vec4 b) { return _mm_mul_ps(a, b); }
+
+inline float horizontalSum(vec4 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+// Flush denormals to zero while a group runs: a decaying narrow band
+// otherwise spends most of its ring-down in them, at many times the cost.
+class FlushDenormals {
+public:
+	FlushDenormals() : _csr(_mm_getcsr()) { _mm_setcsr(_csr | 0x8040); }
+	~FlushDenormals() { _mm_setcsr(_csr); }
+private:
+	const unsigned int _csr;
+};
+
+}
+
+#endif
+
+static float *newLanes(int groups)
+{
+	const int n = groups * Ofilterbank::kGroup;
+	float *array = new float [n];
+	memset(array, 0, n * sizeof(float));
+	return array;
+}
+
+Ofilterbank::Ofilterbank(int numbands)
+	: _numbands(numbands), _numgroups((numbands + kGroup - 1) / kGroup)
+{
+	_b0 = newLanes(_numgroups);
+	_b1 = newLanes(_numgroups);
+	_b2 = newLanes(_numgroups);
+	_a1 = newLanes(_numgroups);
+	_a2 = newLanes(_numgroups);
+	_x1 = newLanes(_numgroups);
+	_x2 = newLanes(_numgroups);
+	_y1 = newLanes(_numgroups);
+	_y2 = newLanes(_numgroups);
+}
+
+Ofilterbank::~Ofilterbank()
+{
+	delete [] _b0;
+	delete [] _b1;
+	delete [] _b2;
+	delete [] _a1;
+	delete [] _a2;
+	delete [] _x1;
+	delete [] _x2;
+	delete [] _y1;
+	delete [] _y2;
+}
+
+void Ofilterbank::setcoeffs(int band, float b0, float b1, float b2, float a1,
+	float a2)
+{
+	assert(band >= 0 && band < _numbands);
+	_b0[band] = b0;
+	_b1[band] = b1;
+	_b2[band] = b2;
+	_a1[band] = a1;
+	_a2[band] = a2;
+}
+
+void Ofilterbank::clear()
+{
+	const size_t bytes = _numgroups * kGroup * sizeof(float);
+	memset(_x1, 0, bytes);
+	memset(_x2, 0, bytes);
+	memset(_y1, 0, bytes);
+	memset(_y2, 0, bytes);
+}
+
+#ifdef FILTERBANK_SIMD
+
+// One band group is two vectors, <lo> and <hi>.
+
+#define LOAD_GROUP(name, array) \
+	vec4 name##lo = vload(&(array)[first]); \
+	vec4 name##hi = vload(&(array)[first + 4])
+#define STORE_GROUP(array, name) \
+	vstore(&(array)[first], name##lo); \
+	vstore(&(array)[first + 4], name##hi)
+#define BIQUAD(y, x, half) \
+	vec4 y = vsub(vsub(vadd(vadd( \
+					vmul(b0##half, x), vmul(b1##half, x1##half)), \
+					vmul(b2##half, x2##half)), \
+					vmul(a1##half, y1##half)), vmul(a2##half, y2##half)); \
+	x2##half = x1##half; \
+	x1##half = x; \
+	y2##half = y1##half; \
+	y1##half = y
+
+#define RUN_GROUP(PER_FRAME) \
+	const int first = group * kGroup; \
+	FlushDenormals flush; \
+	LOAD_GROUP(b0, _b0); LOAD_GROUP(b1, _b1); LOAD_GROUP(b2, _b2); \
+	LOAD_GROUP(a1, _a1); LOAD_GROUP(a2, _a2); \
+	LOAD_GROUP(x1, _x1); LOAD_GROUP(x2, _x2); \
+	LOAD_GROUP(y1, _y1); LOAD_GROUP(y2, _y2); \
+	for (int i = 0; i < nframes; i++) { \
+		const vec4 x = vsplat(in[i]); \
+		BIQUAD(ylo, x, lo); \
+		BIQUAD(yhi, x, hi); \
+		PER_FRAME; \
+	} \
+	STORE_GROUP(_x1, x1); STORE_GROUP(_x2, x2); \
+	STORE_GROUP(_y1, y1); STORE_GROUP(_y2, y2)
+
+void Ofilterbank::rungroup(int group, const float *in, float *out, int nframes)
+{
+	RUN_GROUP(
+		vstore(&out[i * kGroup], ylo);
+		vstore(&out[i * kGroup + 4], yhi));
+}
+
+void Ofilterbank::addgroup(int group, const float *in, const float *gains,
+	float *sum, int nframes)
+{
+	const vec4 glo = vload(&gains[group * kGroup]);
+	const vec4 ghi = vload(&gains[group * kGroup + 4]);
+	RUN_GROUP(
+		sum[i] += horizontalSum(vadd(vmul(ylo, glo), vmul(yhi, ghi))));
+}
+
+#else	// !FILTERBANK_SIMD
+
+#define RUN_GROUP(PER_FRAME) \
+	const int first = group * kGroup; \
+	float b0[kGroup], b1[kGroup], b2[kGroup], a1[kGroup], a2[kGroup]; \
+	float x1[kGroup], x2[kGroup], y1[kGroup], y2[kGroup], y[kGroup]; \
+	for (int k = 0; k < kGroup; k++) { \
+		b0[k] = _b0[first + k]; b1[k] = _b1[first + k]; \
+		b2[k] = _b2[first + k]; a1[k] = _a1[first + k]; \
+		a2[k] = _a2[first + k]; x1[k] = _x1[first + k]; \
+		x2[k] = _x2[first + k]; y1[k] = _y1[first + k]; \
+		y2[k] = _y2[first + k]; \
+	} \
+	for (int i = 0; i < nframes; i++) { \
+		const float x = in[i]; \
+		for (int k = 0; k < kGroup; k++) { \
+			y[k] = (b0[k] * x) + (b1[k] * x1[k]) + (b2[k] * x2[k]) \
+									- (a1[k] * y1[k]) - (a2[k] * y2[k]); \
+			x2[k] = x1[k]; \
+			x1[k] = x; \
+			y2[k] = y1[k]; \
+			y1[k] = y[k]; \
+		} \
+		PER_FRAME; \
+	} \
+	for (int k = 0; k < kGroup; k++) { \
+		_x1[first + k] = x1[k]; _x2[first + k] = x2[k]; \
+		_y1[first + k] = y1[k]; _y2[first + k] = y2[k]; \
+	}
+
+void Ofilterbank::rungroup(int group, const float *in, float *out, int nframes)
+{
+	RUN_GROUP(
+		for (int k = 0; k < kGroup; k++)
+			out[i * kGroup + k] = y[k]);
+}
+
+void Ofilterbank::addgroup(int group, const float *in, const float *gains,
+	float *sum, int nframes)
+{
+	const float *g = &gains[group * kGroup];
+	RUN_GROUP(
+		float s = 0.0f;
+		for (int k = 0; k < kGroup; k++)
+			s += y[k] * g[k];
+		sum[i] += s);
+}
+
+#endif	// !FILTERBANK_SIMD
+
+
+// Obalancebank
+
+static int *newCounters(int groups, int value)
+{
+	int *array = new int [groups];
+	for (int g = 0; g < groups; g++)
+		array[g] = value;
+	return array;
+}
+
+Obalancebank::Obalancebank(float srate, int numbands, int windowlen)
+	: _numbands(numbands),
+	  _numgroups((numbands + Ofilterbank::kGroup - 1) / Ofilterbank::kGroup),
+	  _windowlen(windowlen)
+{
+	// The coefficients of Orms's Oonepole(srate, 10.0f), worked the same way.
+	const float freq = 10.0f;
+	double c = 2.0 - cos(freq * (M_PI * 2.0) / srate);
+	_b = -(sqrt(c * c - 1.0) - c);
+	_a = (_b > 0.0) ? 1.0 - _b : 1.0 + _b;
+
+	_rmscounter = newCounters(_numgroups, 0);
+	_balcounter = newCounters(_numgroups, _windowlen + 1);	// as in Obalance
+	_inhist = newLanes(_numgroups);
+	_cmphist = newLanes(_numgroups);
+	_inrms = newLanes(_numgroups);
+	_cmprms = newLanes(_numgroups);
+	_gain = newLanes(_numgroups);
+	_increment = newLanes(_numgroups);
+}
+
+Obalancebank::~Obalancebank()
+{
+	delete [] _rmscounter;
+	delete [] _balcounter;
+	delete [] _inhist;
+	delete [] _cmphist;
+	delete [] _inrms;
+	delete [] _cmprms;
+	delete [] _gain;
+	delete [] _increment;
+}
+
+void Obalancebank::setwindow(const int nframes)
+{
+	_windowlen = (nframes > 0) ? nframes : 1;
+	for (int g = 0; g < _numgroups; g++) {
+		_rmscounter[g] = 0;
+		_balcounter[g] = _windowlen + 1;
+	}
+}
+
+void Obalancebank::clear()
+{
+	const size_t bytes = _numgroups * Ofilterbank::kGroup * sizeof(float);
+	memset(_inhist, 0, bytes);
+	memset(_cmphist, 0, bytes);
+	memset(_inrms, 0, bytes);
+	memset(_cmprms, 0, bytes);
+	memset(_gain, 0, bytes);
+	memset(_increment, 0, bytes);
+	for (int g = 0; g < _numgroups; g++)
+		_rmscounter[g] = _balcounter[g] = 0;
+}
+
+#ifdef FILTERBANK_SSE
+
+void Obalancebank::rungroup(int group, const float *input,
+	const float *comparator, const float *scale, float *sum, int nframes)
+{
+	const int G = Ofilterbank::kGroup;
+	const int first = group * G;
+	FlushDenormals flush;
+	const __m128 a = _mm_set1_ps(_a), b = _mm_set1_ps(_b);
+	const __m128 window = _mm_set1_ps((float) _windowlen);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 slo = _mm_set1_ps(1.0f), shi = slo;
+	if (scale) {
+		slo = _mm_loadu_ps(&scale[first]);
+		shi = _mm_loadu_ps(&scale[first + 4]);
+	}
+	LOAD_GROUP(ih, _inhist);
+	LOAD_GROUP(ch, _cmphist);
+	LOAD_GROUP(ir, _inrms);
+	LOAD_GROUP(cr, _cmprms);
+	LOAD_GROUP(gain, _gain);
+	LOAD_GROUP(inc, _increment);
+	int rmscounter = _rmscounter[group];
+	int balcounter = _balcounter[group];
+
+	for (int i = 0; i < nframes; i++) {
+		const __m128 inlo = _mm_loadu_ps(&input[i * G]);
+		const __m128 inhi = _mm_loadu_ps(&input[i * G + 4]);
+		const __m128 cmplo = _mm_loadu_ps(&comparator[i * G]);
+		const __m128 cmphi = _mm_loadu_ps(&comparator[i * G + 4]);
+		ihlo = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(inlo, inlo)), _mm_mul_ps(b, ihlo));
+		ihhi = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(inhi, inhi)), _mm_mul_ps(b, ihhi));
+		chlo = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(cmplo, cmplo)), _mm_mul_ps(b, chlo));
+		chhi = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(cmphi, cmphi)), _mm_mul_ps(b, chhi));
+		if (--rmscounter < 0) {
+			irlo = _mm_sqrt_ps(ihlo);
+			irhi = _mm_sqrt_ps(ihhi);
+			crlo = _mm_sqrt_ps(chlo);
+			crhi = _mm_sqrt_ps(chhi);
+			rmscounter = _windowlen;
+		}
+		if (--balcounter < 0) {
+			// a = in ? cmp / in : cmp
+			const __m128 nzlo = _mm_cmpneq_ps(irlo, zero);
+			const __m128 nzhi = _mm_cmpneq_ps(irhi, zero);
+			const __m128 rlo = _mm_or_ps(_mm_and_ps(nzlo, _mm_div_ps(crlo, irlo)),
+										 _mm_andnot_ps(nzlo, crlo));
+			const __m128 rhi = _mm_or_ps(_mm_and_ps(nzhi, _mm_div_ps(crhi, irhi)),
+										 _mm_andnot_ps(nzhi, crhi));
+			inclo = _mm_div_ps(_mm_sub_ps(rlo, gainlo), window);
+			inchi = _mm_div_ps(_mm_sub_ps(rhi, gainhi), window);
+			balcounter = _windowlen;
+		}
+		const __m128 outlo = _mm_mul_ps(inlo, gainlo);
+		const __m128 outhi = _mm_mul_ps(inhi, gainhi);
+		gainlo = _mm_add_ps(gainlo, inclo);
+		gainhi = _mm_add_ps(gainhi, inchi);
+		sum[i] += horizontalSum(_mm_add_ps(_mm_mul_ps(outlo, slo),
+										   _mm_mul_ps(outhi, shi)));
+	}
+
+	STORE_GROUP(_inhist, ih);
+	STORE_GROUP(_cmphist, ch);
+	STORE_GROUP(_inrms, ir);
+	STORE_GROUP(_cmprms, cr);
+	STORE_GROUP(_gain, gain);
+	STORE_GROUP(_increment, inc);
+	_rmscounter[group] = rmscounter;
+	_balcounter[group] = balcounter;
+}
+
+#else	// !FILTERBANK_SSE
+
+void Obalancebank::rungroup(int group, const float *input,
+	const float *comparator, const float *scale, float *sum, int nframes)
+{
+	const int G = Ofilterbank::kGroup;
+	const int first = group * G;
+	float *ih = &_inhist[first], *ch = &_cmphist[first];
+	float *ir = &_inrms[first], *cr = &_cmprms[first];
+	float *gain = &_gain[first], *inc = &_increment[first];
+	int rmscounter = _rmscounter[group];
+	int balcounter = _balcounter[group];
+
+	for (int i = 0; i < nframes; i++) {
+		const float *in = &input[i * G], *cmp = &comparator[i * G];
+		for (int k = 0; k < G; k++) {
+			ih[k] = (_a * (in[k] * in[k])) + (_b * ih[k]);
+			ch[k] = (_a * (cmp[k] * cmp[k])) + (_b * ch[k]);
+		}
+		if (--rmscounter < 0) {
+			for (int k = 0; k < G; k++) {
+				ir[k] = sqrtf(ih[k]);
+				cr[k] = sqrtf(ch[k]);
+			}
+			rmscounter = _windowlen;
+		}
+		if (--balcounter < 0) {
+			for (int k = 0; k < G; k++) {
+				const float a = ir[k] ? cr[k] / ir[k] : cr[k];
+				inc[k] = (a - gain[k]) / _windowlen;
+			}
+			balcounter = _windowlen;
+		}
+		float s = 0.0f;
+		for (int k = 0; k < G; k++) {
+			const float out = in[k] * gain[k];
+			gain[k] += inc[k];
+			s += scale ? out * scale[first + k] : out;
+		}
+		sum[i] += s;
+	}
+
+	_rmscounter[group] = rmscounter;
+	_balcounter[group] = balcounter;
+}
+
+#endif	// !FILTERBANK_SIMD
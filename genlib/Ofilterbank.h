@@ -0,0 +1,87 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OFILTERBANK_H_
+#define _OFILTERBANK_H_ 1
+
+#include "Orms.h"
+
+// A bank of biquad filters that all filter the same input, as in vocoders
+// and resonator banks.  The bands are computed kGroup at a time, their
+// coefficients and histories kept in parallel arrays so that the members
+// of a group fill the lanes of SIMD registers.  A group is run over many
+// frames at once, and groups are independent of one another, so an
+// instrument can give different groups to different threads.
+//
+// Each band computes
+//
+//    y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+//
+// in floats, in that order, so that a band set from an Oequalizer or
+// Oreson gives exactly what that object's next() would.  While a group
+// runs on SSE hardware, denormals are flushed to zero.
+
+class Ofilterbank
+{
+public:
+	enum { kGroup = 8 };		// bands computed together
+
+	Ofilterbank(int numbands);
+	~Ofilterbank();
+
+	int numbands() const { return _numbands; }
+	int numgroups() const { return _numgroups; }
+
+	void setcoeffs(int band, float b0, float b1, float b2, float a1, float a2);
+	void clear();
+	float last(int band) const { return _y1[band]; }
+
+	// Filter <nframes> samples of <in> through the bands of <group>, writing
+	// the output of band (group * kGroup + k) for frame i to
+	// out[i * kGroup + k].
+	void rungroup(int group, const float *in, float *out, int nframes);
+
+	// The same, but add the bands' outputs, each times its entry in
+	// <gains> (indexed by band), to sum[i] instead.
+	void addgroup(int group, const float *in, const float *gains, float *sum,
+				  int nframes);
+
+private:
+	int _numbands, _numgroups;
+	float *_b0, *_b1, *_b2, *_a1, *_a2;
+	float *_x1, *_x2, *_y1, *_y2;
+};
+
+// Balance followers for a bank of bands, each scaling one band's signal so
+// that its RMS power follows that of a comparator band.  Per band, this is
+// exactly Obalance (and its Orms gauges), grouped like Ofilterbank.  All
+// bands share one window length.
+
+class Obalancebank
+{
+public:
+	Obalancebank(float srate, int numbands,
+						int windowlen = kDefaultRMSWindowLength);
+	~Obalancebank();
+
+	void setwindow(const int nframes);
+	void clear();
+
+	// Balance each band of <group> in <input> against the same band in
+	// <comparator>, both laid out as Ofilterbank::rungroup writes them, and
+	// add the results to sum[i], each times its entry in <scale> (indexed
+	// by band) if <scale> is not NULL.
+	void rungroup(int group, const float *input, const float *comparator,
+				  const float *scale, float *sum, int nframes);
+
+private:
+	int _numbands, _numgroups;
+	int _windowlen;
+	float _a, _b;				// Orms's 10 Hz lowpass
+	int *_rmscounter, *_balcounter;		// per group
+	float *_inhist, *_cmphist, *_inrms, *_cmprms;
+	float *_gain, *_increment;
+};
+
+#endif // _OFILTERBANK_H_
@@ -0,0 +1,123 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Ofir.h>
+#include <Oconvolve.h>
+#include <string.h>
+#include <assert.h>
+
+// The dot product runs as four-lane SSE vectors where we have them.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE__)
+#define OFIR_SIMD 1
+#include <xmmintrin.h>
+
+namespace {
+
+typedef __m128 vec4;
+
+inline vec4 vload(const float *p) { return _mm_loadu_ps(p); }
+inline vec4 vzero() { return _mm_setzero_ps(); }
+inline vec4 vadd(vec4 a, vec4 b) { return _mm_add_ps(a, b); }
+inline vec4 vmul(vec4 a, vec4 b) { return _mm_mul_ps(a, b); }
+
+inline float horizontalSum(vec4 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+}
+#endif
+
+Ofir::Ofir(const double coefs[], int ncoefs)
+	: _ncoefs(ncoefs), _tail(NULL), _block(NULL), _tailout(NULL)
+{
+	assert(ncoefs > 0);
+	int direct = ncoefs;
+	if (ncoefs > kMaxDirect) {
+		direct = kHeadLength;
+		float *tail = new float [ncoefs - direct];
+		for (int i = direct; i < ncoefs; i++)
+			tail[i - direct] = coefs[i];
+		_tail = new Oconvolve(tail, ncoefs - direct, kHeadLength);
+		delete [] tail;
+		_block = new float [kHeadLength];
+		_tailout = new float [kHeadLength];
+	}
+
+	// Reversed, so that they line up with the history, and padded with
+	// zeros at the oldest end.
+	_headlen = (direct + 3) & ~3;
+	_head = new float [_headlen];
+	for (int i = 0; i < _headlen; i++) {
+		const int coef = _headlen - 1 - i;
+		_head[i] = (coef < direct) ? coefs[coef] : 0.0f;
+	}
+	_hist = new float [_headlen * 2];
+	clear();
+}
+
+Ofir::~Ofir()
+{
+	delete _tail;
+	delete [] _block;
+	delete [] _tailout;
+	delete [] _head;
+	delete [] _hist;
+}
+
+void Ofir::clear()
+{
+	memset(_hist, 0, sizeof(float) * _headlen * 2);
+	_histpos = 0;
+	if (_tail) {
+		_tail->clear();
+		memset(_tailout, 0, sizeof(float) * kHeadLength);
+	}
+	_blockpos = 0;
+}
+
+float Ofir::dotProduct(const float x[], const float h[], int len)
+{
+#ifdef OFIR_SIMD
+	vec4 sum0 = vzero(), sum1 = vzero();
+	int i = 0;
+	for ( ; i + 8 <= len; i += 8) {
+		sum0 = vadd(sum0, vmul(vload(&x[i]), vload(&h[i])));
+		sum1 = vadd(sum1, vmul(vload(&x[i + 4]), vload(&h[i + 4])));
+	}
+	if (i < len)
+		sum0 = vadd(sum0, vmul(vload(&x[i]), vload(&h[i])));
+	return horizontalSum(vadd(sum0, sum1));
+#else
+	float sum = 0.0f;
+	for (int i = 0; i < len; i++)
+		sum += x[i] * h[i];
+	return sum;
+#endif
+}
+
+// Each input is written at _histpos and _histpos + _headlen, so the last
+// _headlen of them are always in order, oldest first, at _histpos + 1.
+
+float Ofir::next(float input)
+{
+	_hist[_histpos] = _hist[_histpos + _headlen] = input;
+	float out = dotProduct(&_hist[_histpos + 1], _head, _headlen);
+	if (++_histpos == _headlen)
+		_histpos = 0;
+
+	if (_tail) {
+		// The rest of the filter, applied to the last block of input
+		out += _tailout[_blockpos];
+		_block[_blockpos] = input;
+		if (++_blockpos == kHeadLength) {
+			_tail->process(_block, _tailout);
+			_blockpos = 0;
+		}
+	}
+	return out;
+}
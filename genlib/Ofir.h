@@ -0,0 +1,50 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OFIR_H_
+#define _OFIR_H_ 1
+
+// FIR filter with any number of coefficients, a sample at a time, with no
+// delay beyond that of the filter itself.  Short filters are a dot product
+// of the coefficients with a circular buffer of recent input, four lanes at
+// a time where there is SIMD.  Above kMaxDirect coefficients, only the
+// first kHeadLength are done that way; the rest, which only need input from
+// at least kHeadLength frames ago, are convolved a block of kHeadLength
+// frames at a time by Oconvolve.  So the cost per sample grows with the log
+// of the filter length rather than the length, and a filter of thousands of
+// coefficients costs little more than one of a few hundred.
+
+class Oconvolve;
+
+class Ofir
+{
+public:
+	Ofir(const double coefs[], int ncoefs);
+	~Ofir();
+
+	void clear();
+	float next(float input);
+	int length() const { return _ncoefs; }
+
+	enum { kMaxDirect = 256, kHeadLength = 128 };
+
+	// The sum of <x>[i] * <h>[i] for i from 0 to <len> - 1, where <len> is a
+	// multiple of 4, using SIMD where there is some.
+	static float dotProduct(const float x[], const float h[], int len);
+
+private:
+
+	int _ncoefs;
+	int _headlen;		// coefficients in the dot product, a multiple of 4
+	float *_head;		// those coefficients, oldest input's first
+	float *_hist;		// last _headlen inputs, stored twice over
+	int _histpos;
+
+	Oconvolve *_tail;	// NULL if the dot product covers all coefficients
+	float *_block;		// input for _tail
+	float *_tailout;	// output of _tail, for the block now being collected
+	int _blockpos;
+};
+
+#endif // _OFIR_H_
@@ -0,0 +1,142 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Ogainmatrix.h>
+#include <string.h>
+#include <assert.h>
+
+// Four frames at a time where we have SSE vectors.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE__)
+#define GAINMATRIX_SIMD 1
+#include <xmmintrin.h>
+
+namespace {
+
+typedef __m128 vec4;
+
+inline vec4 vload(const float *p) { return _mm_loadu_ps(p); }
+inline void vstore(float *p, vec4 v) { _mm_storeu_ps(p, v); }
+inline vec4 vsplat(float x) { return _mm_set1_ps(x); }
+inline vec4 vset(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+inline vec4 vadd(vec4 a, vec4 b) { return _mm_add_ps(a, b); }
+inline vec4 vmul(vec4 a, vec4 b) { return _mm_mul_ps(a, b); }
+
+}
+#endif
+
+#define CHUNK  256
+
+// acc[n] += x[n] * (gain + n * incr), for n from 0 to frames - 1.
+
+static void mixRamp(const float *x, float *acc, int frames, float gain,
+	float incr)
+{
+	int n = 0;
+#ifdef GAINMATRIX_SIMD
+	if (incr == 0.0f) {
+		const vec4 g = vsplat(gain);
+		for ( ; n + 4 <= frames; n += 4)
+			vstore(&acc[n], vadd(vload(&acc[n]), vmul(vload(&x[n]), g)));
+	}
+	else {
+		vec4 g = vset(gain, gain + incr, gain + 2.0f * incr, gain + 3.0f * incr);
+		const vec4 step = vsplat(4.0f * incr);
+		for ( ; n + 4 <= frames; n += 4) {
+			vstore(&acc[n], vadd(vload(&acc[n]), vmul(vload(&x[n]), g)));
+			g = vadd(g, step);
+		}
+	}
+#endif
+	for ( ; n < frames; n++)
+		acc[n] += x[n] * (gain + n * incr);
+}
+
+Ogainmatrix::Ogainmatrix(int ninputs, int noutputs)
+	: _nin(ninputs), _nout(noutputs)
+{
+	assert(ninputs > 0 && noutputs > 0);
+	_gains = new float [ninputs * noutputs];
+	_targets = new float [ninputs * noutputs];
+	_acc = new float [CHUNK];
+	clear();
+}
+
+Ogainmatrix::~Ogainmatrix()
+{
+	delete [] _gains;
+	delete [] _targets;
+	delete [] _acc;
+}
+
+void Ogainmatrix::clear()
+{
+	for (int i = 0; i < _nin * _nout; i++)
+		_gains[i] = _targets[i] = 0.0f;
+}
+
+void Ogainmatrix::setgain(int input, int output, float gain)
+{
+	assert(input >= 0 && input < _nin && output >= 0 && output < _nout);
+	_targets[output * _nin + input] = gain;
+}
+
+void Ogainmatrix::setgains(int input, const float gains[])
+{
+	assert(input >= 0 && input < _nin);
+	for (int out = 0; out < _nout; out++)
+		_targets[out * _nin + input] = gains[out];
+}
+
+void Ogainmatrix::jump()
+{
+	memcpy(_gains, _targets, sizeof(float) * _nin * _nout);
+}
+
+void Ogainmatrix::process(const float *inputs[], float *outputs[], int stride,
+	int frames)
+{
+	for (int offset = 0; offset < frames; offset += CHUNK) {
+		const int n = (frames - offset < CHUNK) ? frames - offset : CHUNK;
+		processChunk(inputs, outputs, stride, offset, n, offset, frames);
+	}
+}
+
+// Mix frames [offset, offset + frames) of this process() call, which is
+// <rampframes> long and has already done <ramp> of them.
+
+void Ogainmatrix::processChunk(const float *inputs[], float *outputs[],
+	int stride, int offset, int frames, int ramp, int rampframes)
+{
+	const int left = rampframes - ramp;		// frames to go, this one included
+	for (int out = 0; out < _nout; out++) {
+		float *gains = &_gains[out * _nin];
+		const float *targets = &_targets[out * _nin];
+		float *dest = &outputs[out][offset * stride];
+		bool sounding = false;
+		for (int in = 0; in < _nin; in++) {
+			const float gain = gains[in], target = targets[in];
+			if (gain == 0.0f && target == 0.0f)
+				continue;
+			if (!sounding) {
+				memset(_acc, 0, sizeof(float) * frames);
+				sounding = true;
+			}
+			// Step so as to land on the target with the last frame.
+			const float incr = (target - gain) / left;
+			mixRamp(&inputs[in][offset], _acc, frames, gain + incr, incr);
+			gains[in] = (frames == left) ? target : gain + incr * frames;
+		}
+		if (!sounding) {
+			for (int n = 0; n < frames; n++)
+				dest[n * stride] = 0.0f;
+		}
+		else if (stride == 1)
+			memcpy(dest, _acc, sizeof(float) * frames);
+		else {
+			for (int n = 0; n < frames; n++)
+				dest[n * stride] = _acc[n];
+		}
+	}
+}
@@ -0,0 +1,52 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OGAINMATRIX_H_
+#define _OGAINMATRIX_H_ 1
+
+// Mixes <ninputs> signals into <noutputs> channels, each input reaching each
+// output through its own gain: the inner loop of a panner.  Gains set
+// between calls to process() are not jumped to, but ramped to over the
+// frames of the next call, so that a panner updating them once per control
+// period glides from one position to the next without zipper noise.
+// Outputs that get nothing from any input, as most speakers in a large
+// array do from one panned source, are only zeroed.
+//
+//    matrix.setgains(0, speakerGains);
+//    matrix.process(inputs, outputs, stride, frames);
+
+class Ogainmatrix
+{
+public:
+	Ogainmatrix(int ninputs, int noutputs);
+	~Ogainmatrix();
+
+	// Zero all gains at once.
+	void clear();
+
+	void setgain(int input, int output, float gain);
+	// Set the gain from <input> into each of the outputs.
+	void setgains(int input, const float gains[]);
+	// Make the gains set since the last process() take hold at once.
+	void jump();
+
+	// Write <frames> mixed from each of <inputs> (contiguous) to each of
+	// <outputs>, whose samples are <stride> apart.
+	void process(const float *inputs[], float *outputs[], int stride,
+	             int frames);
+
+	int inputs() const { return _nin; }
+	int outputs() const { return _nout; }
+
+private:
+	void processChunk(const float *inputs[], float *outputs[], int stride,
+	                  int offset, int frames, int ramp, int rampframes);
+
+	int _nin, _nout;
+	float *_gains;		// [output * _nin + input], as of the last frame done
+	float *_targets;	// where the ramps are headed
+	float *_acc;		// one output's chunk
+};
+
+#endif // _OGAINMATRIX_H_
@@ -0,0 +1,252 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Olimiter.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#define CHUNK              256		// frames per pass through the stages
+#define DEFAULT_WINDOW     128
+#define DEFAULT_RELEASE    0.1f
+
+Olimiter::Olimiter(float srate, int nchans, float lookahead, float maxattack)
+	: _srate(srate), _nchans(nchans), _detector(kPeak),
+	  _window(DEFAULT_WINDOW), _threshold(32768.0f), _slope(-1.0f),
+	  _bypass(false)
+{
+	assert(nchans > 0);
+	_delay = (lookahead > 0.0f) ? (int) (lookahead * srate + 0.5f) : 0;
+	_capacity = _delay + 1;
+	const int attack = (maxattack > 0.0f) ? (int) (maxattack * srate + 0.5f) : 0;
+	if (attack > _capacity)
+		_capacity = attack;
+	_attack = (_delay > 0) ? _delay : 1;
+
+	_delayline = new float [_delay * nchans + 1];
+	_levelhist = new float [kMaxWindow];
+	_minvals = new float [_capacity + 1];
+	_minframes = new long long [_capacity + 1];
+	_attackhist = new float [_capacity];
+	_level = new float [CHUNK];
+	_target = new float [CHUNK];
+	setrelease(DEFAULT_RELEASE);
+	clear();
+}
+
+Olimiter::~Olimiter()
+{
+	delete [] _delayline;
+	delete [] _levelhist;
+	delete [] _minvals;
+	delete [] _minframes;
+	delete [] _attackhist;
+	delete [] _level;
+	delete [] _target;
+}
+
+void Olimiter::clear()
+{
+	memset(_delayline, 0, sizeof(float) * (_delay * _nchans + 1));
+	_delaypos = 0;
+	memset(_levelhist, 0, sizeof(float) * kMaxWindow);
+	_levelpos = 0;
+	_levelsum = 0.0;
+	_minhead = _mincount = 0;
+	_frame = 0;
+	for (int i = 0; i < _capacity; i++)
+		_attackhist[i] = 1.0f;
+	_attackpos = 0;
+	_attacksum = _attack;
+	_gain = 1.0f;
+}
+
+void Olimiter::setratio(float ratio)
+{
+	if (ratio < 1.0f)
+		ratio = 1.0f;
+	_slope = (ratio >= 100.0f) ? -1.0f : 1.0f / ratio - 1.0f;
+}
+
+void Olimiter::setattack(float seconds)
+{
+	int attack = (int) (seconds * _srate + 0.5f);
+	if (attack < 1)
+		attack = 1;
+	else if (attack > _capacity)
+		attack = _capacity;
+	if (attack == _attack)
+		return;
+	_attack = attack;
+	_attacksum = 0.0;
+	for (int i = 1; i <= attack; i++)
+		_attacksum += _attackhist[(_attackpos - i + _capacity) % _capacity];
+}
+
+void Olimiter::setrelease(float seconds)
+{
+	const float frames = seconds * _srate;
+	_relcoef = (frames > 1.0f) ? 1.0f - expf(-1.0f / frames) : 1.0f;
+}
+
+void Olimiter::setdetector(Detector type, int windowframes)
+{
+	if (windowframes <= 0)
+		windowframes = _window;
+	else if (windowframes > kMaxWindow)
+		windowframes = kMaxWindow;
+	if (type == _detector && windowframes == _window)
+		return;
+	if (type != _detector) {
+		// The history holds peaks for one, and their squares for the other.
+		memset(_levelhist, 0, sizeof(float) * kMaxWindow);
+	}
+	_detector = type;
+	_window = windowframes;
+	_levelsum = 0.0;
+	for (int i = 1; i <= _window; i++)
+		_levelsum += _levelhist[(_levelpos - i + kMaxWindow) % kMaxWindow];
+}
+
+void Olimiter::process(float *bufs[], int frames)
+{
+	for (int offset = 0; offset < frames; offset += CHUNK) {
+		const int n = (frames - offset < CHUNK) ? frames - offset : CHUNK;
+		processChunk(bufs, offset, n);
+	}
+}
+
+// Leave in _level the level of each frame.
+
+void Olimiter::detect(float *bufs[], int offset, int frames)
+{
+	float *level = _level;
+	const float *x = &bufs[0][offset];
+	for (int i = 0; i < frames; i++)
+		level[i] = fabsf(x[i]);
+	for (int ch = 1; ch < _nchans; ch++) {
+		x = &bufs[ch][offset];
+		for (int i = 0; i < frames; i++) {
+			const float a = fabsf(x[i]);
+			level[i] = (a > level[i]) ? a : level[i];
+		}
+	}
+	if (_detector == kPeak)
+		return;
+
+	if (_detector == kRMS) {
+		for (int i = 0; i < frames; i++)
+			level[i] *= level[i];
+	}
+	const int window = _window;
+	const double scale = 1.0 / window;
+	int pos = _levelpos;
+	double sum = _levelsum;
+	for (int i = 0; i < frames; i++) {
+		const int old = (pos - window + kMaxWindow) & (kMaxWindow - 1);
+		sum += level[i] - _levelhist[old];
+		_levelhist[pos] = level[i];
+		pos = (pos + 1) & (kMaxWindow - 1);
+		level[i] = (sum > 0.0) ? float(sum * scale) : 0.0f;
+	}
+	_levelpos = pos;
+	_levelsum = sum;
+	if (_detector == kRMS) {
+		for (int i = 0; i < frames; i++)
+			level[i] = sqrtf(level[i]);
+	}
+}
+
+// Turn the gains in _target, which each frame needs as it comes in, into the
+// gains to apply to the frames coming out of the delay line.
+
+void Olimiter::lookahead(int frames)
+{
+	const int window = (_attack > _delay + 1) ? _attack : _delay + 1;
+	const int span = _capacity + 1;
+	const double scale = 1.0 / _attack;
+	float gain = _gain;
+
+	for (int i = 0; i < frames; i++, _frame++) {
+		// The least gain wanted in the window: a queue of the gains that
+		// could yet be the least, oldest first, each smaller than the last.
+		const float want = _target[i];
+		while (_mincount > 0
+		       && _minvals[(_minhead + _mincount - 1) % span] >= want)
+			_mincount--;
+		const int tail = (_minhead + _mincount) % span;
+		_minvals[tail] = want;
+		_minframes[tail] = _frame;
+		_mincount++;
+		if (_minframes[_minhead] <= _frame - window) {
+			_minhead = (_minhead + 1) % span;
+			_mincount--;
+		}
+		const float least = _minvals[_minhead];
+
+		// Average it over the attack.
+		const int old = (_attackpos - _attack + _capacity) % _capacity;
+		_attacksum += least - _attackhist[old];
+		_attackhist[_attackpos] = least;
+		if (++_attackpos == _capacity)
+			_attackpos = 0;
+		const float smooth = float(_attacksum * scale);
+
+		// Follow it down at once, since it's already gradual, and up slowly.
+		if (smooth < gain)
+			gain = smooth;
+		else
+			gain += (smooth - gain) * _relcoef;
+		_target[i] = gain;
+	}
+	_gain = gain;
+}
+
+void Olimiter::processChunk(float *bufs[], int offset, int frames)
+{
+	detect(bufs, offset, frames);
+
+	const float *level = _level;
+	float *target = _target;
+	const float threshold = _threshold;
+	if (_slope == -1.0f) {
+		for (int i = 0; i < frames; i++)
+			target[i] = (level[i] > threshold) ? threshold / level[i] : 1.0f;
+	}
+	else {
+		const float slope = _slope, scale = 1.0f / threshold;
+		for (int i = 0; i < frames; i++)
+			target[i] = (level[i] > threshold)
+			            ? powf(level[i] * scale, slope) : 1.0f;
+	}
+
+	lookahead(frames);
+	if (_bypass) {
+		for (int i = 0; i < frames; i++)
+			target[i] = 1.0f;
+	}
+
+	if (_delay == 0) {
+		for (int ch = 0; ch < _nchans; ch++) {
+			float *x = &bufs[ch][offset];
+			for (int i = 0; i < frames; i++)
+				x[i] *= target[i];
+		}
+		return;
+	}
+	int pos = _delaypos;
+	for (int ch = 0; ch < _nchans; ch++) {
+		float *x = &bufs[ch][offset];
+		float *line = &_delayline[ch * _delay];
+		pos = _delaypos;
+		for (int i = 0; i < frames; i++) {
+			const float out = line[pos];
+			line[pos] = x[i];
+			x[i] = out * target[i];
+			if (++pos == _delay)
+				pos = 0;
+		}
+	}
+	_delaypos = pos;
+}
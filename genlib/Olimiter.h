@@ -0,0 +1,97 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OLIMITER_H_
+#define _OLIMITER_H_ 1
+
+// A look-ahead compressor-limiter for one or more channels, which share one
+// gain so that the stereo image holds still.  process() takes a block of
+// each channel and works in stages, each a loop over the block:
+//
+//    detect      the level of each frame: its peak over all channels, or
+//                the average or RMS of that over a window of frames
+//    compute     the gain that brings that level down to the threshold,
+//                less ratio - 1 parts in ratio above it
+//    look ahead  the least of those gains that any frame from now to
+//                <lookahead> ahead will need...
+//    attack      ...averaged over the attack time, which makes the gain
+//                ramp down smoothly in time for each frame that needs it
+//    release     back up toward unity, with a one-pole lag
+//
+// and then the signal, delayed by latency() frames, is multiplied by the
+// gain.  When the attack is no longer than the lookahead, no frame comes
+// out above the threshold.  Levels are absolute, so the threshold is in
+// whatever units the samples are (e.g. 32768 for full scale in RTcmix).
+
+class Olimiter
+{
+public:
+	enum Detector { kPeak = 0, kAverage = 1, kRMS = 2 };
+	enum { kMaxWindow = 8192 };	// frames averaged by kAverage and kRMS
+
+	// <lookahead> and <maxattack> are in seconds.  The attack can be set
+	// as long as the longer of the two.
+	Olimiter(float srate, int nchans, float lookahead, float maxattack = 0.0f);
+	~Olimiter();
+
+	void clear();
+
+	void setthreshold(float amp) { _threshold = (amp > 0.0f) ? amp : 1e-9f; }
+	// A ratio of 1 leaves the signal alone, and one of 100 or more limits.
+	void setratio(float ratio);
+	// The attack defaults to the lookahead, and the release to 0.1 seconds.
+	void setattack(float seconds);
+	void setrelease(float seconds);
+	void setdetector(Detector type, int windowframes = 0);
+	// Keep tracking the level, but pass the delayed signal with unity gain.
+	void setbypass(bool bypass) { _bypass = bypass; }
+
+	// Limit <frames> of each of the nchans arrays in <bufs>, in place.
+	void process(float *bufs[], int frames);
+
+	int latency() const { return _delay; }
+	// The gain applied to the last frame processed.
+	float gain() const { return _gain; }
+
+private:
+	void processChunk(float *bufs[], int offset, int frames);
+	void detect(float *bufs[], int offset, int frames);
+	void lookahead(int frames);
+
+	float _srate;
+	int _nchans;
+
+	int _delay;				// lookahead, in frames
+	float *_delayline;		// _delay frames per channel
+	int _delaypos;
+
+	Detector _detector;
+	int _window;
+	float *_levelhist;		// kMaxWindow frames of peak or squared peak
+	int _levelpos;
+	double _levelsum;
+
+	float _threshold;
+	float _slope;			// 1 / ratio - 1
+
+	int _capacity;			// longest look-ahead window and attack
+	float *_minvals;		// the gains in view, each less than the ones after
+	long long *_minframes;	// and when each is needed
+	int _minhead, _mincount;
+	long long _frame;
+
+	int _attack;			// frames, no more than _capacity
+	float *_attackhist;		// _capacity frames of look-ahead gain
+	int _attackpos;
+	double _attacksum;
+
+	float _relcoef;
+	float _gain;
+	bool _bypass;
+
+	float *_level;			// for one chunk
+	float *_target;
+};
+
+#endif // _OLIMITER_H_
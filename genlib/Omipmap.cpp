@@ -0,0 +1,143 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Omipmap.h>
+#include <Offt.h>
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+	#define M_PI	3.14159265358979323846264338327950288
+#endif
+
+// For a table length with no FFT, a DFT of the harmonics we keep.  Every
+// angle is a whole number of table points, so the sines and cosines are
+// looked up, not computed.
+
+namespace {
+
+struct Sines {
+	Sines(int len) : cosines(new double [len]), sines(new double [len]) {
+		for (int i = 0; i < len; i++) {
+			cosines[i] = cos(2.0 * M_PI * i / len);
+			sines[i] = sin(2.0 * M_PI * i / len);
+		}
+	}
+	~Sines() { delete [] cosines; delete [] sines; }
+	double *cosines, *sines;
+};
+
+}
+
+static void
+spectrum(const double *table, int len, const Sines &tab, int harmonics,
+	double *re, double *im)
+{
+	for (int h = 0; h <= harmonics; h++) {
+		double sumre = 0.0, sumim = 0.0;
+		int idx = 0;
+		for (int i = 0; i < len; i++) {
+			sumre += table[i] * tab.cosines[idx];
+			sumim += table[i] * tab.sines[idx];
+			idx += h;
+			if (idx >= len)
+				idx -= len;
+		}
+		re[h] = sumre / len;
+		im[h] = sumim / len;
+	}
+}
+
+static void
+synthesize(const double *re, const double *im, int harmonics, int len,
+	const Sines &tab, double *sum, float *out)
+{
+	for (int i = 0; i < len; i++)
+		sum[i] = re[0];
+	for (int h = 1; h <= harmonics; h++) {
+		const double a = 2.0 * re[h], b = 2.0 * im[h];
+		int idx = 0;
+		for (int i = 0; i < len; i++) {
+			sum[i] += a * tab.cosines[idx] + b * tab.sines[idx];
+			idx += h;
+			if (idx >= len)
+				idx -= len;
+		}
+	}
+	for (int i = 0; i < len; i++)
+		out[i] = sum[i];
+}
+
+Omipmap::Omipmap(const double *table, int len) : _len(len)
+{
+	// The table's own Nyquist harmonic, if it has one, is left out.
+	const int top = (len - 1) / 2;
+	_levels = 1;
+	while ((top >> _levels) > 0)
+		_levels++;
+	_level = new float * [_levels];
+	_harmonics = new int [_levels];
+
+	_level[0] = new float [len];
+	for (int i = 0; i < len; i++)
+		_level[0][i] = table[i];
+	_harmonics[0] = top;
+	for (int n = 1; n < _levels; n++) {
+		_level[n] = new float [len];
+		_harmonics[n] = top >> n;
+	}
+	if (_levels == 1)
+		return;
+
+	if ((len & (len - 1)) == 0) {
+		// Filter in the frequency domain, one inverse FFT per level.
+		Offt fft(len);
+		float *buf = fft.getbuf();
+		for (int i = 0; i < len; i++)
+			buf[i] = table[i];
+		fft.r2c();
+		float *spec = new float [len];
+		memcpy(spec, buf, len * sizeof(float));
+		for (int n = 1; n < _levels; n++) {
+			const int keep = 2 * (_harmonics[n] + 1);	// DC, then pairs
+			memcpy(buf, spec, keep * sizeof(float));
+			buf[1] = 0.0f;								// Nyquist
+			memset(buf + keep, 0, (len - keep) * sizeof(float));
+			fft.c2r();
+			memcpy(_level[n], buf, len * sizeof(float));
+		}
+		delete [] spec;
+	}
+	else {
+		const Sines tab(len);
+		double *re = new double [top + 1];
+		double *im = new double [top + 1];
+		double *sum = new double [len];
+		spectrum(table, len, tab, top, re, im);
+		for (int n = 1; n < _levels; n++)
+			synthesize(re, im, _harmonics[n], len, tab, sum, _level[n]);
+		delete [] re;
+		delete [] im;
+		delete [] sum;
+	}
+}
+
+Omipmap::~Omipmap()
+{
+	for (int n = 0; n < _levels; n++)
+		delete [] _level[n];
+	delete [] _level;
+	delete [] _harmonics;
+}
+
+int Omipmap::levelFor(double incr) const
+{
+	const double nyquist = 0.5 * _len;
+	incr = fabs(incr);
+	for (int n = 0; n < _levels; n++) {
+		if (_harmonics[n] * incr < nyquist)
+			return n;
+	}
+	return _levels - 1;
+}
@@ -0,0 +1,42 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OMIPMAP_H_
+#define _OMIPMAP_H_ 1
+
+// Band-limited copies of one cycle of a waveform, an octave apart, for an
+// oscillator to read instead of the waveform itself, so that it does not
+// alias at high pitches.  Level 0 is the waveform as given.  Each level
+// after it keeps the DC and the harmonics up to half the highest of the level
+// before, down to a sine at the last level.  All have the same length, so
+// an oscillator can change levels without changing its phase.
+//
+// Made once by maketable(..., "bandlimit", ...) and shared by every note
+// reading that table (see TablePField::mipmap()).
+//
+//    Ooscili osc(SR, freq, mipmap);		// picks the level for freq
+
+class Omipmap
+{
+public:
+	Omipmap(const double *table, int len);
+	~Omipmap();
+
+	int length() const { return _len; }
+	int levels() const { return _levels; }
+	const float *level(int n) const { return _level[n]; }
+
+	// The fullest level with no harmonic at or above the Nyquist frequency,
+	// when reading <incr> table points per sample.  If even a sine would
+	// alias, the last level.
+	int levelFor(double incr) const;
+
+private:
+	int _len;
+	int _levels;
+	float **_level;
+	int *_harmonics;		// the highest in each level
+};
+
+#endif // _OMIPMAP_H_
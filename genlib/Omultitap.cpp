@@ -0,0 +1,167 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Omultitap.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#define CHUNK  256		// frames written to the line before the taps read
+
+Omultitap::Omultitap(long maxDelay, int ntaps, int noutputs)
+	: _ntaps(ntaps), _nouts(noutputs)
+{
+	assert(maxDelay >= 0 && ntaps > 0);
+	assert(noutputs > 0 && noutputs <= kMaxOutputs);
+	_taps = new Tap [ntaps];
+	for (int i = 0; i < ntaps; i++) {
+		Tap &tap = _taps[i];
+		tap.delay = tap.olddelay = 0;
+		tap.frac = tap.oldfrac = 0.0f;
+		for (int n = 0; n < kMaxOutputs; n++)
+			tap.gains[n] = tap.oldgains[n] = 0.0f;
+		tap.fade = kFadeFrames;
+		tap.set = false;
+	}
+	// Room for the longest interpolated delay behind a whole chunk
+	_len = maxDelay + 2 + CHUNK;
+	_line = new float [_len + 1];
+	_sig = new float [CHUNK];
+	_oldsig = new float [CHUNK];
+	clear();
+}
+
+Omultitap::~Omultitap()
+{
+	delete [] _taps;
+	delete [] _line;
+	delete [] _sig;
+	delete [] _oldsig;
+}
+
+void Omultitap::clear()
+{
+	memset(_line, 0, sizeof(float) * (_len + 1));
+	_inpoint = 0;
+}
+
+void Omultitap::setTap(int tapnum, double delay, const float gains[])
+{
+	assert(tapnum >= 0 && tapnum < _ntaps);
+	Tap &tap = _taps[tapnum];
+	if (delay < 0.0)
+		delay = 0.0;
+	else if (delay > _len - 2 - CHUNK)
+		delay = _len - 2 - CHUNK;
+	const long whole = (long) delay;
+	const float frac = (float) (delay - whole);
+
+	if (tap.set) {
+		bool same = (whole == tap.delay && frac == tap.frac);
+		for (int n = 0; n < _nouts; n++)
+			same = same && (gains[n] == tap.gains[n]);
+		if (same)
+			return;
+		// Fade from wherever a fade under way has got to.  Taking the
+		// setting it was leaving would jump back; taking the one it was
+		// going to is close enough, as the fades are short.
+		tap.olddelay = tap.delay;
+		tap.oldfrac = tap.frac;
+		for (int n = 0; n < _nouts; n++)
+			tap.oldgains[n] = tap.gains[n];
+		tap.fade = 0;
+	}
+	tap.delay = whole;
+	tap.frac = frac;
+	for (int n = 0; n < _nouts; n++)
+		tap.gains[n] = gains[n];
+	tap.set = true;
+}
+
+void Omultitap::process(const float input[], float *outputs[], int frames)
+{
+	for (int offset = 0; offset < frames; offset += CHUNK) {
+		const int n = (frames - offset < CHUNK) ? frames - offset : CHUNK;
+		processChunk(&input[offset], outputs, offset, n);
+	}
+}
+
+// Sample i of the line is at _line[i + 1], and _line[0] is a copy of the
+// last, so that the sample before any read position is always the one just
+// below it in memory.
+
+void Omultitap::read(long delay, float frac, float out[], int frames) const
+{
+	// The chunk just written starts at _inpoint - frames.
+	long pos = _inpoint - frames - delay;
+	while (pos < 0)
+		pos += _len;
+	int done = 0;
+	while (done < frames) {
+		int n = frames - done;
+		if (pos + n > _len)
+			n = _len - pos;
+		const float *x = &_line[pos + 1];
+		if (frac == 0.0f) {
+			memcpy(&out[done], x, sizeof(float) * n);
+		}
+		else {
+			for (int i = 0; i < n; i++)
+				out[done + i] = x[i] + frac * (x[i - 1] - x[i]);
+		}
+		done += n;
+		pos += n;
+		if (pos == _len)
+			pos = 0;
+	}
+}
+
+void Omultitap::processChunk(const float input[], float *outputs[],
+	int offset, int frames)
+{
+	for (int i = 0; i < frames; i++) {
+		_line[_inpoint + 1] = input[i];
+		if (++_inpoint == _len) {
+			_inpoint = 0;
+			_line[0] = _line[_len];
+		}
+	}
+
+	for (int n = 0; n < _nouts; n++)
+		memset(&outputs[n][offset], 0, sizeof(float) * frames);
+
+	for (int t = 0; t < _ntaps; t++) {
+		Tap &tap = _taps[t];
+		if (!tap.set)
+			continue;
+		read(tap.delay, tap.frac, _sig, frames);
+
+		int start = 0;
+		if (tap.fade < kFadeFrames) {
+			// Fade from the old setting to the new one.
+			start = kFadeFrames - tap.fade;
+			if (start > frames)
+				start = frames;
+			read(tap.olddelay, tap.oldfrac, _oldsig, start);
+			const float step = 1.0f / kFadeFrames;
+			for (int n = 0; n < _nouts; n++) {
+				float *out = &outputs[n][offset];
+				const float gain = tap.gains[n], oldgain = tap.oldgains[n];
+				float w = (tap.fade + 1) * step;
+				for (int i = 0; i < start; i++, w += step)
+					out[i] += (_sig[i] * gain - _oldsig[i] * oldgain) * w
+					          + _oldsig[i] * oldgain;
+			}
+			tap.fade += start;
+		}
+		for (int n = 0; n < _nouts; n++) {
+			const float gain = tap.gains[n];
+			if (gain == 0.0f)
+				continue;
+			float *out = &outputs[n][offset];
+			for (int i = start; i < frames; i++)
+				out[i] += _sig[i] * gain;
+		}
+	}
+}
@@ -0,0 +1,68 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OMULTITAP_H_
+#define _OMULTITAP_H_ 1
+
+// A delay line read by many taps at once, such as the early reflections of
+// a room, a block at a time.  Each tap has its own delay, which may be
+// fractional (read with linear interpolation), and its own gain into each
+// of up to kMaxOutputs outputs.  process() writes a block of input into
+// the line, then takes each tap in turn, reading its stretch of the line
+// from one end to the other and adding it into the outputs, so the inner
+// loops are straight runs through memory that the compiler can vectorize,
+// rather than a scattered read per tap per sample.
+//
+// Changing a tap's delay or gains cross-fades from the old setting to the
+// new one over kFadeFrames, so a moving source does not click.
+
+class Omultitap
+{
+public:
+	// <maxDelay> is the longest delay, in samples, that any tap will have.
+	Omultitap(long maxDelay, int ntaps, int noutputs);
+	~Omultitap();
+
+	void clear();
+
+	// Give <tap> a delay of <delay> samples and the gains in <gains>, one
+	// per output.  The first call for a tap takes effect at once; later ones
+	// fade in.  A delay of 0 passes the input sample straight through.
+	void setTap(int tap, double delay, const float gains[]);
+
+	// Take <frames> of <input>, and write the sum of the taps to each of
+	// <outputs>[0] to <outputs>[noutputs - 1].
+	void process(const float input[], float *outputs[], int frames);
+
+	int taps() const { return _ntaps; }
+
+	enum { kMaxOutputs = 4, kFadeFrames = 64 };
+
+private:
+	struct Tap {
+		long	delay;		// whole samples
+		float	frac;		// and the fraction of the next one
+		float	gains[kMaxOutputs];
+		long	olddelay;	// setting being faded out
+		float	oldfrac;
+		float	oldgains[kMaxOutputs];
+		int		fade;		// frames of fade done, or kFadeFrames if none
+		bool	set;
+	};
+
+	void processChunk(const float input[], float *outputs[], int offset,
+	                  int frames);
+	void read(long delay, float frac, float out[], int frames) const;
+
+	int _ntaps;
+	int _nouts;
+	Tap *_taps;
+	float *_line;		// _len samples, after one copy of the last
+	long _len;
+	long _inpoint;		// where the next input goes
+	float *_sig;		// one tap's samples for a chunk
+	float *_oldsig;
+};
+
+#endif // _OMULTITAP_H_
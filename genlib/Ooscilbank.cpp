@@ -0,0 +1,153 @@
+/* RTcmix - Copyright (C) 2004  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Ooscilbank.h>
+//#define NDEBUG
+#include <assert.h>
+
+#define kFracBits 16
+#define kFracShift 65536
+#define kFracMask (kFracShift - 1)
+
+// Oscillators are run over at most this many samples at a time.
+#define kBankChunk 256
+
+Ooscilbank::Ooscilbank(float SR, int numoscs, double table[], int len)
+	: _sr(SR), _numoscs(numoscs)
+{
+	_phase = new fixed_t [numoscs];
+	_si = new fixed_t [numoscs];
+	_table = new double * [numoscs];
+	_length = new int [numoscs];
+	_lendivSR = new double [numoscs];
+	_amp = new double [numoscs];
+	_pan = new double [numoscs];
+	_wave = new float [kBankChunk];
+	for (int i = 0; i < numoscs; i++) {
+		settable(i, table, len);
+		_si[i] = 0;
+		_phase[i] = 0;
+		_amp[i] = 0.0;
+		_pan[i] = 0.0;
+	}
+}
+
+Ooscilbank::~Ooscilbank()
+{
+	delete [] _phase;
+	delete [] _si;
+	delete [] _table;
+	delete [] _length;
+	delete [] _lendivSR;
+	delete [] _amp;
+	delete [] _pan;
+	delete [] _wave;
+}
+
+void Ooscilbank::settable(int osc, double table[], int len)
+{
+	assert(len < kFracShift / 2);
+	_table[osc] = table;
+	_length[osc] = len;
+	_lendivSR[osc] = (double) len / _sr;
+}
+
+// Fill <wave> with the next <n> samples of oscillator <osc>, as Ooscili's
+// nextBlock() does: a loop free of wraparound tests between the points
+// where the phase wraps, and single steps near them.
+
+void Ooscilbank::render(int osc, float *wave, int n)
+{
+	const double *tab = _table[osc];
+	const int length = _length[osc];
+	const fixed_t fplen = length << kFracBits;
+	const fixed_t lastseg = (length - 1) << kFracBits;
+	const fixed_t incr = _si[osc];
+	const bool segments = (incr > 0 && incr < fplen);
+	fixed_t phase = _phase[osc];
+	if ((length & (length - 1)) == 0) {
+		// With a power-of-two table, the wrap is a mask of each sample's
+		// phase, which unsigned arithmetic computes modulo 2^32.
+		const uint32_t mask = (uint32_t) fplen - 1;
+		const uint32_t start = (uint32_t) phase;
+		const int lenmask = length - 1;
+		for (int m = 0; m < n; m++) {
+			const uint32_t phs = (start + m * (uint32_t) incr) & mask;
+			const int i = phs >> kFracBits;
+			const int k = (i + 1) & lenmask;
+			const int frac = phs & kFracMask;
+			wave[m] = tab[i] + (((tab[k] - tab[i]) * frac) / kFracShift);
+		}
+		_phase[osc] = (fixed_t) ((start + n * (uint32_t) incr) & mask);
+		return;
+	}
+	int j = 0;
+	while (j < n) {
+		if (segments && phase < lastseg) {
+			int count = (lastseg - 1 - phase) / incr + 1;
+			if (count > n - j)
+				count = n - j;
+			const fixed_t start = phase;
+			float *dest = wave + j;
+			for (int m = 0; m < count; m++) {
+				const fixed_t phs = start + m * incr;
+				const int i = phs >> kFracBits;
+				const int frac = phs & kFracMask;
+				dest[m] = tab[i] + (((tab[i + 1] - tab[i]) * frac) / kFracShift);
+			}
+			phase = start + count * incr;
+			j += count;
+		}
+		else {
+			const int i = phase >> kFracBits;
+			const int k = (i + 1 < length) ? i + 1 : 0;
+			const int frac = phase & kFracMask;
+			wave[j++] = tab[i] + (((tab[k] - tab[i]) * frac) / kFracShift);
+			phase += incr;
+		}
+		while (phase >= fplen)
+			phase -= fplen;
+		while (phase < 0)		// handle negative freqs
+			phase += fplen;
+	}
+	_phase[osc] = phase;
+}
+
+void Ooscilbank::nextBlock(float *out, int n)
+{
+	for (int done = 0; done < n; done += kBankChunk) {
+		const int count = (n - done < kBankChunk) ? n - done : kBankChunk;
+		float *dest = out + done;
+		for (int m = 0; m < count; m++)
+			dest[m] = 0.0f;
+		for (int osc = 0; osc < _numoscs; osc++) {
+			render(osc, _wave, count);
+			const double amp = _amp[osc];
+			for (int m = 0; m < count; m++)
+				dest[m] += (float) (_wave[m] * amp);
+		}
+	}
+}
+
+void Ooscilbank::nextBlock(float *left, float *right, int n)
+{
+	for (int done = 0; done < n; done += kBankChunk) {
+		const int count = (n - done < kBankChunk) ? n - done : kBankChunk;
+		float *ldest = left + done;
+		float *rdest = right + done;
+		for (int m = 0; m < count; m++)
+			ldest[m] = rdest[m] = 0.0f;
+		for (int osc = 0; osc < _numoscs; osc++) {
+			render(osc, _wave, count);
+			const double amp = _amp[osc];
+			const double lpan = _pan[osc];
+			const double rpan = 1.0 - lpan;
+			for (int m = 0; m < count; m++) {
+				const float sig = _wave[m] * amp;
+				ldest[m] += sig * lpan;
+				rdest[m] += sig * rpan;
+			}
+		}
+	}
+}
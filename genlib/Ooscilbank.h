@@ -0,0 +1,47 @@
+/* RTcmix - Copyright (C) 2004  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OOSCILBANK_H_
+#define _OOSCILBANK_H_ 1
+
+#include "Ooscili.h"
+
+// A bank of interpolating oscillators, each with its own table, frequency,
+// amplitude and pan, mixed together a block at a time.  Each oscillator
+// sounds exactly like an Ooscili, but the state of all of them is kept in
+// parallel arrays and each is run over a block of samples at once, rather
+// than every oscillator being stepped in turn for every sample.  This is
+// for additive instruments with tens or hundreds of partials.
+
+class Ooscilbank
+{
+	float _sr;
+	int _numoscs;
+	fixed_t *_phase, *_si;
+	double **_table;
+	int *_length;
+	double *_lendivSR;
+	double *_amp, *_pan;
+	float *_wave;		// scratch block for one oscillator
+
+	void render(int osc, float *wave, int n);
+public:
+	Ooscilbank(float SR, int numoscs, double table[], int len);
+	~Ooscilbank();
+
+	void settable(int osc, double table[], int len);
+	inline void setfreq(int osc, float freq) { _si[osc] = fp(freq * _lendivSR[osc]); }
+	inline void setphase(int osc, double phs) { _phase[osc] = fp(phs); }	// wavetable index
+	inline void setamp(int osc, double amp) { _amp[osc] = amp; }
+	inline void setpan(int osc, double pctleft) { _pan[osc] = pctleft; }
+	inline int getnumoscs() const { return _numoscs; }
+
+	// Write to <out> the sum of the next <n> samples of every oscillator,
+	// each times its amplitude.  The second form also pans each oscillator
+	// between <left> and <right>.
+	void nextBlock(float *out, int n);
+	void nextBlock(float *left, float *right, int n);
+};
+
+#endif // _OOSCILBANK_H_
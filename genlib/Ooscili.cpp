@@ -3,7 +3,9 @@
    the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
 */
 #include <Ooscili.h>
+#include <Omipmap.h>
 #include <ugens.h>
+#include <stddef.h>
 //#define NDEBUG
 #include <assert.h>
 
@@ -11,20 +13,44 @@
 #define kFracShift 65536
 #define kFracMask (kFracShift - 1)
 
-Ooscili::Ooscili(float SR, float freq, int arr) : _sr(SR)
+Ooscili::Ooscili(float SR, float freq, int arr)
+	: farray(NULL), _sr(SR), mipmap(NULL)
 {
 	array = floc(arr);
 	length = fsize(arr);
 	init(freq);
 }
 
-Ooscili::Ooscili(float SR, float freq, double arr[], int len) : _sr(SR)
+Ooscili::Ooscili(float SR, float freq, double arr[], int len)
+	: farray(NULL), _sr(SR), mipmap(NULL)
 {
 	array = arr;
 	length = len;
 	init(freq);
 }
 
+Ooscili::Ooscili(float SR, float freq, const float arr[], int len)
+	: array(NULL), farray(arr), _sr(SR), mipmap(NULL)
+{
+	length = len;
+	init(freq);
+}
+
+Ooscili::Ooscili(float SR, float freq, const Omipmap *mip)
+	: array(NULL), _sr(SR), mipmap(mip)
+{
+	length = mip->length();
+	init(freq);
+	selectLevel(freq);
+}
+
+// The levels all have the same length, so the phase carries over.
+
+void Ooscili::selectLevel(double freq)
+{
+	farray = mipmap->level(mipmap->levelFor(freq * lendivSR));
+}
+
 void Ooscili::init(float freq)
 {
 	assert(length < kFracShift / 2);
@@ -64,14 +90,25 @@ void Ooscili::setPhaseRadians(double phs)
 	phase = fp(normphase);
 }
 
+// Each table read is done by a template for the table's element type.
+// Values are converted to double before any arithmetic, so a float table
+// gives the same result as a double table holding the same values.
+
 float Ooscili::next()
+{
+	return farray ? nextFrom(farray) : nextFrom(array);
+}
+
+template <typename T>
+float Ooscili::nextFrom(const T *tab)
 {
 	int i = phase >> kFracBits;
 	int k = i + 1;
 	if (k >= length)
 		k = 0;
 	const int frac = phase & kFracMask;
-	float output = array[i] + (((array[k] - array[i]) * frac) / kFracShift);
+	const double yi = tab[i], yk = tab[k];
+	float output = yi + (((yk - yi) * frac) / kFracShift);
 
 	// prepare for next call
 	phase += si;
@@ -85,13 +122,130 @@ float Ooscili::next()
 }
 
 float Ooscili::next(int nsample)
+{
+	return farray ? nextFrom(farray, nsample) : nextFrom(array, nsample);
+}
+
+template <typename T>
+float Ooscili::nextFrom(const T *tab, int nsample)
 {
 	assert(nsample >= 0);
 	double frac = nsample * tabscale;
 	int i = (int) frac;
 	if (i >= length - 1)			// NB: we read array[i + 1]
-		return array[length - 1];
+		return tab[length - 1];
 	frac = frac - (double) i;
-	return array[i] + (frac * (array[i + 1] - array[i]));
+	const double y0 = tab[i], y1 = tab[i + 1];
+	return y0 + (frac * (y1 - y0));
 }
 
+
+// Between wraps of the phase, the phase of each sample is a multiple of <si>
+// from the first, so the table reads do not depend on one another and the
+// loop can be unrolled or vectorized.  For a power-of-two table, the wrap
+// is just a mask.  Otherwise we run that loop up to the last sample that
+// does not read the final table point (whose neighbor is the first point),
+// and let next() handle the samples near the wrap.
+
+void Ooscili::nextBlock(float *out, int n)
+{
+	if (farray)
+		nextBlockFrom(farray, out, n);
+	else
+		nextBlockFrom(array, out, n);
+}
+
+template <typename T>
+void Ooscili::nextBlockFrom(const T *tab, float *out, int n)
+{
+	const fixed_t fplen = length << kFracBits;
+	if (si <= 0 || si >= fplen) {		// unusual; wrap each sample
+		for (int j = 0; j < n; j++)
+			out[j] = nextFrom(tab);
+		return;
+	}
+	if ((length & (length - 1)) == 0) {
+		// With a power-of-two table, the wrap is a mask of each sample's
+		// phase, which unsigned arithmetic computes modulo 2^32.
+		const uint32_t mask = (uint32_t) fplen - 1;
+		const uint32_t start = (uint32_t) phase;
+		const int lenmask = length - 1;
+		for (int m = 0; m < n; m++) {
+			const uint32_t phs = (start + m * (uint32_t) si) & mask;
+			const int i = phs >> kFracBits;
+			const int k = (i + 1) & lenmask;
+			const int frac = phs & kFracMask;
+			const double yi = tab[i], yk = tab[k];
+			out[m] = yi + (((yk - yi) * frac) / kFracShift);
+		}
+		phase = (fixed_t) ((start + n * (uint32_t) si) & mask);
+		return;
+	}
+	const fixed_t lastseg = (length - 1) << kFracBits;
+	int j = 0;
+	while (j < n) {
+		if (phase < lastseg) {
+			int count = (lastseg - 1 - phase) / si + 1;
+			if (count > n - j)
+				count = n - j;
+			const fixed_t start = phase;
+			const fixed_t incr = si;
+			float *dest = out + j;
+			for (int m = 0; m < count; m++) {
+				const fixed_t phs = start + m * incr;
+				const int i = phs >> kFracBits;
+				const int frac = phs & kFracMask;
+				const double yi = tab[i], yk = tab[i + 1];
+				dest[m] = yi + (((yk - yi) * frac) / kFracShift);
+			}
+			phase = start + count * incr;
+			while (phase >= fplen)
+				phase -= fplen;
+			j += count;
+		}
+		else
+			out[j++] = nextFrom(tab);
+	}
+}
+
+// With a band-limited table, the level is chosen for the highest frequency
+// in the block.
+
+void Ooscili::nextBlock(float *out, const float *freqs, int n)
+{
+	if (mipmap && n > 0) {
+		float top = 0.0f;
+		for (int j = 0; j < n; j++) {
+			const float f = fabsf(freqs[j]);
+			if (f > top)
+				top = f;
+		}
+		selectLevel(top);
+	}
+	if (farray)
+		nextBlockFrom(farray, out, freqs, n);
+	else
+		nextBlockFrom(array, out, freqs, n);
+}
+
+template <typename T>
+void Ooscili::nextBlockFrom(const T *tab, float *out, const float *freqs, int n)
+{
+	const fixed_t fplen = length << kFracBits;
+	fixed_t phs = phase, incr = si;
+	for (int j = 0; j < n; j++) {
+		incr = fp(freqs[j] * lendivSR);
+		const int i = phs >> kFracBits;
+		const int k = (i + 1 < length) ? i + 1 : 0;
+		const int frac = phs & kFracMask;
+		const double yi = tab[i], yk = tab[k];
+		out[j] = yi + (((yk - yi) * frac) / kFracShift);
+		phs += incr;
+		while (phs >= fplen)
+			phs -= fplen;
+		while (phs < 0)
+			phs += fplen;
+	}
+	phase = phs;
+	si = incr;
+}
@@ -15,6 +15,8 @@
 
 typedef int32_t fixed_t;	// 16.16 fixed point
 
+class Omipmap;
+
 inline fixed_t fp(double val) { return (fixed_t) (val * 65536); }
 
 class Ooscili
@@ -23,16 +25,40 @@ class Ooscili
 	double tabscale;
 	fixed_t si, phase;
 	double *array;
+	const float *farray;	// used in place of <array> if not NULL
 	float _sr;
 	int length;
+	const Omipmap *mipmap;	// if not NULL, <farray> is one of its levels
 
 	void init(float);
+	void selectLevel(double freq);
+	template <typename T> float nextFrom(const T *tab);
+	template <typename T> float nextFrom(const T *tab, int nsample);
+	template <typename T> void nextBlockFrom(const T *tab, float *out, int n);
+	template <typename T> void nextBlockFrom(const T *tab, float *out,
+											 const float *freqs, int n);
 public:
 	Ooscili(float SR, float freq, int arr);
 	Ooscili(float SR, float freq, double arr[], int len);
+	// Read a table of floats, such as a TablePField's floatArray().
+	Ooscili(float SR, float freq, const float arr[], int len);
+	// Read whichever level of a band-limited table (see Omipmap.h) has
+	// all its harmonics below the Nyquist frequency, changing levels as the
+	// frequency changes.
+	Ooscili(float SR, float freq, const Omipmap *mip);
 	float next();
 	float next(int nsample);
-	inline void setfreq(float freq) { si = fp(freq * lendivSR); }
+
+	// Fill <out> with the next <n> samples, as calling next() <n> times
+	// would.  The second form changes frequency each sample, as calling
+	// setfreq(freqs[i]) before each next() would.
+	void nextBlock(float *out, int n);
+	void nextBlock(float *out, const float *freqs, int n);
+	inline void setfreq(float freq) {
+		si = fp(freq * lendivSR);
+		if (mipmap)
+			selectLevel(freq);
+	}
 	inline void setphase(double phs) { phase = fp(phs); }	// wavetable index
 	void setPhaseRadians(double phs);
 	inline double getphase() const { return double(phase) / 65536; }
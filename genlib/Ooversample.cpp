@@ -0,0 +1,139 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Ooversample.h>
+#include <Ofir.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+#define CUTOFF       0.45	// of the original sampling rate
+#define KAISER_BETA  8.0	// about 80 dB down in the stopband
+
+// Modified Bessel function of the first kind, order 0
+
+static double bessel0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	const double halfx = x * 0.5;
+	for (int k = 1; k < 50; k++) {
+		term *= halfx / k;
+		const double t2 = term * term;
+		sum += t2;
+		if (t2 < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+// The low-pass filter both passes use: (kTaps - 1) * factor + 1
+// coefficients, centered on the middle one, with unity gain at DC.  That
+// length makes the total delay (kTaps - 1) original samples exactly.
+
+static double *designFilter(int factor, int len)
+{
+	double *h = new double [len];
+	const double fc = CUTOFF / factor;
+	const double middle = (len - 1) * 0.5;
+	const double norm = bessel0(KAISER_BETA);
+	double sum = 0.0;
+	for (int k = 0; k < len; k++) {
+		const double t = k - middle;
+		const double sinc = (t == 0.0) ? 1.0 : sin(2.0 * M_PI * fc * t) / (2.0 * M_PI * fc * t);
+		const double r = t / middle;
+		const double window = bessel0(KAISER_BETA * sqrt(1.0 - r * r)) / norm;
+		h[k] = sinc * window;
+		sum += h[k];
+	}
+	for (int k = 0; k < len; k++)
+		h[k] /= sum;
+	return h;
+}
+
+Ooversample::Ooversample(int factor)
+	: _factor(factor), _upcoefs(NULL), _uphist(NULL), _downcoefs(NULL),
+	  _downhist(NULL)
+{
+	assert(factor == 1 || factor == 2 || factor == 4 || factor == 8);
+	if (factor == 1)
+		return;
+
+	const int len = (kTaps - 1) * factor + 1;
+	double *h = designFilter(factor, len);
+
+	// Phase p of the interpolator makes output p of each group from
+	// coefficients p, p + factor, p + 2 * factor, ... times factor, to make
+	// up for the zeros that would otherwise be stuffed between inputs.
+	_upcoefs = new float [kTaps * factor];
+	for (int p = 0; p < factor; p++) {
+		float *coefs = &_upcoefs[p * kTaps];
+		for (int i = 0; i < kTaps; i++) {
+			const int k = p + i * factor;
+			coefs[kTaps - 1 - i] = (k < len) ? h[k] * factor : 0.0f;
+		}
+	}
+
+	// The decimator's output lines up with the first of the samples given
+	// to down(), not the last, so its coefficients start factor - 1 later.
+	const int downlen = kTaps * factor;
+	_downcoefs = new float [downlen];
+	for (int i = 0; i < downlen; i++) {
+		const int k = i - (factor - 1);
+		_downcoefs[downlen - 1 - i] = (k >= 0) ? h[k] : 0.0f;
+	}
+	delete [] h;
+
+	_uphist = new float [kTaps * 2];
+	_downhist = new float [downlen * 2];
+	clear();
+}
+
+Ooversample::~Ooversample()
+{
+	delete [] _upcoefs;
+	delete [] _uphist;
+	delete [] _downcoefs;
+	delete [] _downhist;
+}
+
+void Ooversample::clear()
+{
+	if (_factor == 1)
+		return;
+	memset(_uphist, 0, sizeof(float) * kTaps * 2);
+	memset(_downhist, 0, sizeof(float) * kTaps * _factor * 2);
+	_uppos = 0;
+	_downpos = 0;
+}
+
+// As in Ofir, each history holds every input twice, so that the most
+// recent ones are always in order, oldest first, ending just before the
+// next place to write.
+
+void Ooversample::up(float input, float output[])
+{
+	if (_factor == 1) {
+		output[0] = input;
+		return;
+	}
+	_uphist[_uppos] = _uphist[_uppos + kTaps] = input;
+	if (++_uppos == kTaps)
+		_uppos = 0;
+	const float *x = &_uphist[_uppos];
+	for (int p = 0; p < _factor; p++)
+		output[p] = Ofir::dotProduct(x, &_upcoefs[p * kTaps], kTaps);
+}
+
+float Ooversample::down(const float input[])
+{
+	if (_factor == 1)
+		return input[0];
+	const int len = kTaps * _factor;
+	for (int p = 0; p < _factor; p++) {
+		_downhist[_downpos] = _downhist[_downpos + len] = input[p];
+		if (++_downpos == len)
+			_downpos = 0;
+	}
+	return Ofir::dotProduct(&_downhist[_downpos], _downcoefs, len);
+}
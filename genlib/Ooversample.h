@@ -0,0 +1,55 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OOVERSAMPLE_H_
+#define _OOVERSAMPLE_H_ 1
+
+// Runs part of an instrument at <factor> times the sampling rate, so that a
+// nonlinearity there (clipping, waveshaping, a bit crusher) makes less
+// aliasing.  up() turns each input sample into <factor> samples, band-
+// limited to the original Nyquist frequency; process those, then give them
+// to down(), which filters out what is above that Nyquist frequency again
+// and returns one sample.
+//
+//    float buf[Ooversample::kMaxFactor];
+//    oversamp.up(input, buf);
+//    for (int j = 0; j < oversamp.factor(); j++)
+//       buf[j] = distort(buf[j]);
+//    output = oversamp.down(buf);
+//
+// Both filters are polyphase Kaiser-windowed sincs, of kTaps coefficients
+// per phase, and between them they delay the signal by latency() samples
+// at the original rate.  A factor of 1 just passes samples through.
+// Instruments that mix the result with their unprocessed input should
+// delay that input by as much.
+
+class Ooversample
+{
+public:
+	// <factor> must be 1, 2, 4 or 8.
+	Ooversample(int factor);
+	~Ooversample();
+
+	void clear();
+	// Write factor() samples to <output>.
+	void up(float input, float output[]);
+	// Take factor() samples from <input>.
+	float down(const float input[]);
+
+	int factor() const { return _factor; }
+	int latency() const { return (_factor > 1) ? kTaps - 1 : 0; }
+
+	enum { kMaxFactor = 8, kTaps = 32 };
+
+private:
+	int _factor;
+	float *_upcoefs;	// kTaps for each phase, oldest input's first
+	float *_uphist;		// last kTaps inputs, stored twice over
+	int _uppos;
+	float *_downcoefs;	// kTaps * _factor, oldest input's first
+	float *_downhist;	// last kTaps * _factor inputs, twice over
+	int _downpos;
+};
+
+#endif // _OOVERSAMPLE_H_
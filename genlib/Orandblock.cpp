@@ -0,0 +1,147 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Orandblock.h>
+#include <ugens.h>
+#include <sys/time.h>
+
+// All four lanes in one step where we have SSE2 vectors.
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define RANDBLOCK_SIMD 1
+#include <emmintrin.h>
+
+namespace {
+
+typedef __m128i uvec4;
+
+inline uvec4 vload(const unsigned *p) { return _mm_loadu_si128((const __m128i *) p); }
+inline void vstore(unsigned *p, uvec4 v) { _mm_storeu_si128((__m128i *) p, v); }
+inline uvec4 vadd(uvec4 a, uvec4 b) { return _mm_add_epi32(a, b); }
+inline uvec4 vxor(uvec4 a, uvec4 b) { return _mm_xor_si128(a, b); }
+inline uvec4 vshl(uvec4 a, int n) { return _mm_slli_epi32(a, n); }
+inline uvec4 vrotl(uvec4 a, int n) { return _mm_or_si128(_mm_slli_epi32(a, n), _mm_srli_epi32(a, 32 - n)); }
+// The top 24 bits, as a float from 0 to 1
+inline void vunit(float *p, uvec4 a) {
+	_mm_storeu_ps(p, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(a, 8)),
+	                            _mm_set1_ps(1.0f / 16777216.0f)));
+}
+
+}
+#endif
+
+// splitmix32, to spread one seed over all of the state
+
+static unsigned splitmix(unsigned *x)
+{
+	unsigned z = (*x += 0x9e3779b9u);
+	z = (z ^ (z >> 16)) * 0x85ebca6bu;
+	z = (z ^ (z >> 13)) * 0xc2b2ae35u;
+	return z ^ (z >> 16);
+}
+
+Orandblock::Orandblock(unsigned seed)
+{
+	this->seed(seed);
+}
+
+void Orandblock::seed(unsigned seed)
+{
+	unsigned x = seed;
+	for (int lane = 0; lane < kLanes; lane++) {
+		for (int word = 0; word < 4; word++)
+			_state[word][lane] = splitmix(&x);
+		// xoshiro only gets stuck on all zeros
+		if ((_state[0][lane] | _state[1][lane] | _state[2][lane]
+		     | _state[3][lane]) == 0)
+			_state[0][lane] = 1;
+	}
+	_bufpos = kBufferSize;
+}
+
+void Orandblock::timeseed()
+{
+	struct timeval tv;
+	struct timezone tz;
+
+	gettimeofday(&tv,&tz);
+	seed(tv.tv_usec);
+}
+
+void Orandblock::scoreseed()
+{
+	// rrand() has 15 bits to give each time.
+	const unsigned hi = (unsigned) ((rrand() + 1.0f) * 16384.0f);
+	const unsigned lo = (unsigned) ((rrand() + 1.0f) * 16384.0f);
+	seed((hi << 15) | lo);
+}
+
+// Write <steps> * kLanes numbers from 0 to 1 to <out>.
+
+void Orandblock::generate(float *out, int steps)
+{
+#ifdef RANDBLOCK_SIMD
+	uvec4 s0 = vload(_state[0]), s1 = vload(_state[1]);
+	uvec4 s2 = vload(_state[2]), s3 = vload(_state[3]);
+	for (int i = 0; i < steps; i++, out += kLanes) {
+		vunit(out, vadd(s0, s3));
+		const uvec4 t = vshl(s1, 9);
+		s2 = vxor(s2, s0);
+		s3 = vxor(s3, s1);
+		s1 = vxor(s1, s2);
+		s0 = vxor(s0, s3);
+		s2 = vxor(s2, t);
+		s3 = vrotl(s3, 11);
+	}
+	vstore(_state[0], s0);
+	vstore(_state[1], s1);
+	vstore(_state[2], s2);
+	vstore(_state[3], s3);
+#else
+	for (int i = 0; i < steps; i++, out += kLanes) {
+		for (int lane = 0; lane < kLanes; lane++) {
+			unsigned &s0 = _state[0][lane], &s1 = _state[1][lane];
+			unsigned &s2 = _state[2][lane], &s3 = _state[3][lane];
+			out[lane] = (float) ((s0 + s3) >> 8) * (1.0f / 16777216.0f);
+			const unsigned t = s1 << 9;
+			s2 ^= s0;
+			s3 ^= s1;
+			s1 ^= s2;
+			s0 ^= s3;
+			s2 ^= t;
+			s3 = (s3 << 11) | (s3 >> 21);
+		}
+	}
+#endif
+}
+
+void Orandblock::fillBlock(float *out, int frames, float min, float max)
+{
+	int n = 0;
+	while (n < frames && _bufpos < kBufferSize)
+		out[n++] = _buffer[_bufpos++];
+	const int steps = (frames - n) / kLanes;
+	generate(&out[n], steps);
+	n += steps * kLanes;
+	if (n < frames) {
+		generate(_buffer, kBufferSize / kLanes);
+		_bufpos = 0;
+		while (n < frames)
+			out[n++] = _buffer[_bufpos++];
+	}
+	if (min != 0.0f || max != 1.0f) {
+		const float scale = max - min;
+		for (n = 0; n < frames; n++)
+			out[n] = min + out[n] * scale;
+	}
+}
+
+float Orandblock::random()
+{
+	if (_bufpos == kBufferSize) {
+		generate(_buffer, kBufferSize / kLanes);
+		_bufpos = 0;
+	}
+	return _buffer[_bufpos++];
+}
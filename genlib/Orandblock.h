@@ -0,0 +1,54 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _ORANDBLOCK_H_
+#define _ORANDBLOCK_H_ 1
+
+// White noise a block at a time, for instruments that want a random number
+// for every frame.  Four xoshiro128+ generators run side by side, four
+// numbers per step, which vectors do in one go; their numbers are taken in
+// turn, as one stream.  The stream depends only on the seed, not on how it
+// is read, so a note mixing fillBlock() and next() gets the same numbers
+// for the same seed every time it is rendered.
+//
+//    Orandblock noise(seed);
+//    noise.fillBlock(buf, frames);		// -1 to +1
+
+class Orandblock
+{
+public:
+	Orandblock(unsigned seed = 1);
+
+	void seed(unsigned seed);
+
+	// seed with the time of day
+	void timeseed();
+
+	// Seed from the rrand() stream, which srand() in a score seeds, so that
+	// successive notes differ but the score still sounds the same each time.
+	void scoreseed();
+
+	// Write <frames> numbers between <min> and <max> to <out>.
+	void fillBlock(float *out, int frames, float min = -1.0f, float max = 1.0f);
+
+	// returns between 0.0 and 1.0, from the same stream
+	float random();
+
+	// returns between -1 and +1
+	float rand() { return random() * 2.0f - 1.0f; }
+
+	// returns between min and max
+	float range(float min, float max) { return min + random() * (max - min); }
+
+private:
+	enum { kLanes = 4, kBufferSize = 64 };
+
+	void generate(float *out, int steps);
+
+	unsigned _state[4][kLanes];		// [word][lane]
+	float _buffer[kBufferSize];		// the rest of the last generate()
+	int _bufpos;
+};
+
+#endif // _ORANDBLOCK_H_
@@ -0,0 +1,63 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Oreblock.h>
+#include <string.h>
+
+Oreblock::Oreblock(int hop, int inchans, int outchans,
+		ProcessFunction callback, void *context, int window)
+	: _hop(hop), _window(window < hop ? hop : window),
+	  _inchans(inchans), _outchans(outchans), _fill(0),
+	  _callback(callback), _context(context)
+{
+	_inbuf = new float [_window * _inchans];
+	_outbuf = new float [_hop * _outchans];
+	clear();
+}
+
+Oreblock::~Oreblock()
+{
+	delete [] _inbuf;
+	delete [] _outbuf;
+}
+
+void Oreblock::clear()
+{
+	memset(_inbuf, 0, _window * _inchans * sizeof(float));
+	memset(_outbuf, 0, _hop * _outchans * sizeof(float));
+	_fill = 0;
+}
+
+// Runs of frames up to the end of the current hop are copied in and out
+// whole, so the cost per frame does not depend on how the hop and the
+// buffer size line up.
+
+void Oreblock::run(const float *in, float *out, int nframes)
+{
+	while (nframes > 0) {
+		int n = _hop - _fill;
+		if (n > nframes)
+			n = nframes;
+		float *dest = &_inbuf[(_window - _hop + _fill) * _inchans];
+		if (in) {
+			memcpy(dest, in, n * _inchans * sizeof(float));
+			in += n * _inchans;
+		}
+		else
+			memset(dest, 0, n * _inchans * sizeof(float));
+		if (out) {
+			memcpy(out, &_outbuf[_fill * _outchans], n * _outchans * sizeof(float));
+			out += n * _outchans;
+		}
+		_fill += n;
+		nframes -= n;
+		if (_fill == _hop) {
+			(*_callback)(_inbuf, _outbuf, _hop, _context);
+			if (_window > _hop)
+				memmove(_inbuf, &_inbuf[_hop * _inchans],
+				                 (_window - _hop) * _inchans * sizeof(float));
+			_fill = 0;
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/* RTcmix - Copyright (C) 2005  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _OREBLOCK_H_
+#define _OREBLOCK_H_ 1
+
+// Lets an instrument process in blocks of its own size (an FFT hop, say)
+// whatever the run() buffer size.  Like Obucket, it collects input and
+// calls back when it has a block, but it also keeps the output of each call
+// and hands it back a buffer at a time, so run() just does
+//
+//    reblock->run(in, out, framesToRun());
+//
+// and mixes or writes <out>.  Input and output are interleaved, with any
+// number of channels each.  Each call to the process function is given
+// <window> frames of input -- the newest <hop> of them, and before them
+// the input of earlier calls (zeros at first) -- and fills <hop> frames of
+// output, which come out of run() latency() frames (one hop) after the
+// input that ended the window went in.  Add latency() and whatever delay
+// the process function makes to the note's duration, and delay any dry
+// signal by the same, as CONVOLVE1 does.
+
+class Oreblock {
+public:
+	typedef void (*ProcessFunction)(const float *in, float *out, int hop,
+	                                                           void *context);
+	// <window> must be at least <hop>; 0 means the same as <hop>.
+	Oreblock(int hop, int inchans, int outchans, ProcessFunction callback,
+	                                        void *context, int window = 0);
+	~Oreblock();
+
+	// Pass <nframes> frames of <in> through, writing as many to <out>.  A
+	// NULL <in> is taken as silence, and a NULL <out> throws output away.
+	void run(const float *in, float *out, int nframes);
+	void clear();
+
+	int hop() const { return _hop; }
+	int window() const { return _window; }
+	int latency() const { return _hop; }
+
+private:
+	int _hop;
+	int _window;
+	int _inchans;
+	int _outchans;
+	int _fill;				// frames of the current hop taken so far
+	ProcessFunction _callback;
+	void *_context;
+	float *_inbuf;			// <_window> frames, the current hop at the end
+	float *_outbuf;			// <_hop> frames from the last call
+};
+
+#endif // _OREBLOCK_H_
@@ -0,0 +1,124 @@
+/* RTcmix - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include <Oresample.h>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+typedef short HWORD;
+#include "../utils/resample/smallfilter.h"
+
+#define NPC            256      // filter table entries per input frame
+#define NWING          SMALL_FILTER_NWING
+#define WING_CROSSINGS ((SMALL_FILTER_NMULT - 1) / 2)
+#define INPUT_BLOCK    512      // room for input beyond the filter's reach
+
+// The filter tables, scaled once to floats with unity gain at DC.
+
+static float sImp[NWING];
+static float sImpD[NWING];
+static bool sTablesMade = false;
+
+static void makeTables()
+{
+	if (sTablesMade)
+		return;
+	double gain = SMALL_FILTER_IMP[0];
+	for (int n = NPC; n < NWING; n += NPC)
+		gain += 2.0 * SMALL_FILTER_IMP[n];
+	for (int n = 0; n < NWING; n++) {
+		sImp[n] = SMALL_FILTER_IMP[n] / gain;
+		sImpD[n] = SMALL_FILTER_IMPD[n] / gain;
+	}
+	sTablesMade = true;
+}
+
+Oresample::Oresample(double maxIncrement)
+	: _maxIncrement(maxIncrement > 1.0 ? maxIncrement : 1.0)
+{
+	makeTables();
+	_maxWing = (int) ceil(WING_CROSSINGS * _maxIncrement) + 1;
+	_len = 2 * _maxWing + INPUT_BLOCK;
+	_buf = new float [_len];
+	clear();
+}
+
+Oresample::~Oresample()
+{
+	delete [] _buf;
+}
+
+void Oresample::clear()
+{
+	// Silence before the first input frame
+	for (int n = 0; n < _maxWing; n++)
+		_buf[n] = 0.0;
+	_end = _maxWing;
+	_time = _maxWing;
+}
+
+int Oresample::space()
+{
+	// Drop the frames that the filter can no longer reach.
+	const int drop = (int) _time - _maxWing;
+	if (drop > 0) {
+		memmove(_buf, _buf + drop, (_end - drop) * sizeof(float));
+		_end -= drop;
+		_time -= drop;
+	}
+	return _len - _end;
+}
+
+int Oresample::write(const float *input, int stride, int frames)
+{
+	const int room = space();
+	if (frames > room)
+		frames = room;
+	float *buf = &_buf[_end];
+	for (int n = 0; n < frames; n++, input += stride)
+		buf[n] = *input;
+	_end += frames;
+	return frames;
+}
+
+// Sum the wings of the filter on each side of the output point, which is
+// <frac> past <frame>.  <phaseIncr> is how far into the filter table each
+// input frame is, which is less than NPC when widening it to downsample.
+
+inline float Oresample::filter(int frame, double frac, double phaseIncr) const
+{
+	double sum = 0.0;
+	double phase = frac * phaseIncr;
+	for (const float *x = &_buf[frame]; phase < NWING; x--, phase += phaseIncr) {
+		const int i = (int) phase;
+		sum += *x * (sImp[i] + sImpD[i] * (phase - i));
+	}
+	phase = (1.0 - frac) * phaseIncr;
+	for (const float *x = &_buf[frame + 1]; phase < NWING; x++, phase += phaseIncr) {
+		const int i = (int) phase;
+		sum += *x * (sImp[i] + sImpD[i] * (phase - i));
+	}
+	return sum * (phaseIncr / NPC);
+}
+
+int Oresample::read(float *output, int stride, int frames, double increment)
+{
+	assert(increment >= 0.0);
+	double factor = (increment > 1.0) ? increment : 1.0;
+	if (factor > _maxIncrement)
+		factor = _maxIncrement;
+	const double phaseIncr = NPC / factor;
+	const int wing = (int) ceil(WING_CROSSINGS * factor) + 1;
+
+	int made = 0;
+	for ( ; made < frames; made++, output += stride) {
+		const int frame = (int) _time;
+		if (frame + wing >= _end)
+			break;
+		*output = filter(frame, _time - frame, phaseIncr);
+		_time += increment;
+	}
+	return made;
+}
@@ -0,0 +1,56 @@
+/* RTcmix - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _ORESAMPLE_H_
+#define _ORESAMPLE_H_ 1
+
+// Band-limited resampling of one channel, by the windowed-sinc method of
+// Julius Smith's resample (see utils/resample), using the same 13-tap
+// filter.  The caller writes input frames as there is room for them and
+// reads output, advancing <increment> input frames per output frame: an
+// increment of 2 transposes up an octave, 0.5 down an octave.  It may
+// change from one read() to the next, but must not be negative.  For
+// increments above 1 the filter is widened to keep out aliasing, up to the
+// <maxIncrement> given to the constructor; past that, the increment is
+// still honored, but aliasing comes back.
+//
+//    while (made < frames) {
+//       made += resamp.read(&out[made], 1, frames - made, increment);
+//       if (made < frames)
+//          input += resamp.write(input, 1, inputLeft);
+//    }
+//
+// The output starts at input frame 0, and read() makes nothing until the
+// few input frames past the point it has reached are written.
+
+class Oresample {
+
+public:
+	Oresample(double maxIncrement = 4.0);
+	~Oresample();
+
+	// Frames write() can take now.
+	int space();
+	// Add up to <frames> input frames, every <stride> samples in <input>.
+	// Returns how many were taken, which is no more than space().
+	int write(const float *input, int stride, int frames);
+	// Write up to <frames> output frames, every <stride> samples in
+	// <output>, stopping early if more input is needed.  Returns how many
+	// were written.
+	int read(float *output, int stride, int frames, double increment);
+	// Forget all input, and start again at input frame 0.
+	void clear();
+
+private:
+	float filter(int frame, double frac, double phaseIncr) const;
+
+	float *_buf;
+	int _len;
+	int _end;			// input frames in _buf
+	double _time;		// position of the next output frame in _buf
+	int _maxWing;
+	double _maxIncrement;
+};
+
+#endif // _ORESAMPLE_H_
@@ -20,6 +20,14 @@ public:
 	inline float next(float sig);
 	float last() { return _last; }
 
+	// The coefficients next() uses: a0 * sig + a1 * y1 - a2 * y2.
+	inline void getcoeffs(float *a0, float *a1, float *a2) const
+	{
+		*a0 = _a0;
+		*a1 = _a1;
+		*a2 = _a2;
+	}
+
 private:
 	float _srate;
 	Scale _scale;
@@ -4,7 +4,9 @@
 */
 
 #include "Ostrum.h"
+#include "Orandblock.h"
 #include <math.h>
+#include <string.h>
 
 const float Ostrum::kMinFreq = 20.0f;
 
@@ -12,29 +14,53 @@ const float Ostrum::kMinFreq = 20.0f;
 // to make comparisons between that code and this object easier.  -JGG
 
 Ostrum::Ostrum(float srate, float freq, int squish, float fundDecayTime,
-	float nyquistDecayTime)
+	float nyquistDecayTime, bool blockNoise)
 	: _srate(srate), _funddcy(fundDecayTime), _nyqdcy(nyquistDecayTime),
-	  _dcz1(0.0f)
+	  _ownsDelay(true), _dcz1(0.0f)
 {
-	// Size strum array so that it will work with freqs as low as kMinFreq. -JGG
-	_dlen = int((1.0 / kMinFreq * _srate) + 0.5);
+	_dlen = delayLength(_srate);
 	_d = new float [_dlen];
+	init(freq, squish, blockNoise);
+}
+
+
+Ostrum::Ostrum(float srate, float freq, int squish, float fundDecayTime,
+	float nyquistDecayTime, float *delayLine, bool blockNoise)
+	: _srate(srate), _funddcy(fundDecayTime), _nyqdcy(nyquistDecayTime),
+	  _ownsDelay(false), _dcz1(0.0f)
+{
+	_dlen = delayLength(_srate);
+	_d = delayLine;
+	init(freq, squish, blockNoise);
+}
 
+
+// Size strum array so that it will work with freqs as low as kMinFreq. -JGG
+
+int Ostrum::delayLength(float srate)
+{
+	return int((1.0 / kMinFreq * srate) + 0.5);
+}
+
+
+void Ostrum::init(float freq, int squish, bool blockNoise)
+{
 	_maxfreq = _srate * 0.333333f;	// Prevent _d underflow.  -JGG
 
-	sset(freq, fundDecayTime, nyquistDecayTime);
+	sset(freq, _funddcy, _nyqdcy);
 
 	// Init this outside of sset, which may be called to change freq.  -JGG
 	_p = _n;
 
-	randfill();
+	randfill(blockNoise);
 	squisher(squish);
 }
 
 
 Ostrum::~Ostrum()
 {
-	delete [] _d;
+	if (_ownsDelay)
+		delete [] _d;
 }
 
 
@@ -131,23 +157,30 @@ void Ostrum::sset(float freq, float fundDecayTime, float nyquistDecayTime)
 }
 
 
-// Fill plucked string array <_d> with white noise.
+// Fill plucked string array <_d> with white noise.  Every string gets the
+// same noise, from a fixed seed.  With <blockNoise>, Orandblock makes it four
+// numbers at a time, but the numbers are not the ones Orand gives.
 
 #include "Orand.h"
 
-void Ostrum::randfill()
+void Ostrum::randfill(bool blockNoise)
 {
-	// Set values of array to zero.
-	for (int i = 0; i < _dlen; i++)
-		_d[i] = 0.0f;
+	// Set values of array past the noise to zero.
+	memset(&_d[_n], 0, (_dlen - _n) * sizeof(float));
 
 	// Fill with white noise.
-	Orand randgen;
+	if (blockNoise) {
+		Orandblock randgen;
+		randgen.fillBlock(_d, _n);
+	}
+	else {
+		Orand randgen;
+		for (int i = 0; i < _n; i++)
+			_d[i] = randgen.rand();
+	}
 	float total = 0.0f;
-	for (int i = 0; i < _n; i++) {
-		_d[i] = randgen.rand();
+	for (int i = 0; i < _n; i++)
 		total += _d[i];
-	}
 
 	// Subtract any DC component.
 	float average = total / float(_n);
@@ -214,3 +247,60 @@ float Ostrum::next(float input)
 	return _d[_p];
 }
 
+
+
+void Ostrum::nextBlock(float *out, int n)
+{
+	float x[kChunk];
+	int done = 0;
+	while (done < n) {
+		// The first sample of the chunk is written at <start>, and its
+		// filter reads from <r> (p4) on.  The filter reads samples written
+		// _n to _n + 3 samples ago -- fewer, for a string nearly as long as
+		// the array, whose taps wrap past the write position -- so for that
+		// many samples it does not depend on this chunk.  The chunk also
+		// stops where either the writes or the reads would wrap around.
+		int start = _p + 1;
+		if (start >= _dlen)
+			start = 0;
+		int r = (start - _n - 3) % _dlen;
+		if (r < 0)
+			r += _dlen;
+		int len = n - done;
+		for (int tap = 0; tap < 4; tap++) {
+			const int age = (_n + tap) % _dlen;
+			if (age > 0 && len > age)
+				len = age;
+		}
+		if (len > kChunk)
+			len = kChunk;
+		if (len > _dlen - start)
+			len = _dlen - start;
+		if (len > _dlen - 3 - r)
+			len = _dlen - 3 - r;
+		if (len < 1) {
+			out[done++] = next();
+			continue;
+		}
+
+		// four-point averaging filter
+		const float *src = &_d[r];
+		for (int i = 0; i < len; i++)
+			x[i] = _a3 * src[i] + _a2 * src[i + 1] + _a1 * src[i + 2]
+					+ _a0 * src[i + 3];
+
+		// DC-blocking filter
+		float *dst = &_d[start];
+		float z = _dcz1;
+		for (int i = 0; i < len; i++) {
+			float y = _dca1 * z;
+			z = (_dcb1 * z) + x[i];
+			y += _dca0 * z;
+			dst[i] = y;
+			out[done + i] = y;
+		}
+		_dcz1 = z;
+		_p = start + len - 1;
+		done += len;
+	}
+}
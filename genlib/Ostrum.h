@@ -11,10 +11,20 @@
 class Ostrum {
 
 public:
+	// If <blockNoise>, the initial noise burst comes from Orandblock, which
+	// is faster to make but sounds different from the usual Orand burst.
 	Ostrum(float srate, float freq, int squish, float fundDecayTime = 1.0f,
-					float nyquistDecayTime = 0.1f);
+					float nyquistDecayTime = 0.1f, bool blockNoise = false);
+	// Use <delayLine>, which must hold delayLength(srate) floats, instead of
+	// allocating one.  The caller owns it.
+	Ostrum(float srate, float freq, int squish, float fundDecayTime,
+					float nyquistDecayTime, float *delayLine,
+					bool blockNoise = false);
 	~Ostrum();
 
+	// The length of the delay line for sampling rate <srate>.
+	static int delayLength(float srate);
+
 	// Change frequency while note is playing.
 	inline void setfreq(float freq);
 
@@ -26,17 +36,25 @@ public:
 	// mixed in with the plucked string signal and added into the delay line.
 	float next(float input = 0.0f);
 
+	// Write the next <n> samples to <out>, with no input.  Same as calling
+	// next() <n> times, but the four-point filter runs over as many samples
+	// at once as the string is long, which the compiler can vectorize.
+	void nextBlock(float *out, int n);
+
 private:
 	static const float kMinFreq;
+	enum { kChunk = 256 };
 
+	void init(float freq, int squish, bool blockNoise);
 	void sset(float freq, float fundDecayTime, float nyquistDecayTime);
-	void randfill();
+	void randfill(bool blockNoise);
 	void squisher(int squish);
 
 	float _srate;
 	float _maxfreq;
 	float _funddcy, _nyqdcy;
 	int _dlen;
+	bool _ownsDelay;
 
 	int _n, _p;
 	float *_d;
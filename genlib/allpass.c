@@ -11,3 +11,31 @@ float allpass(float samp,float *a)
 	*aptr = *aptr * a[1] + samp;
 	return(temp - a[1] * *aptr);
 }
+
+/* Block version of allpass: <x> may be the same array as <out>.  See bcomb.
+*/
+void ballpass(float *x, float *a, float *out, int nvals)
+{
+	int i, n, run, end;
+	float temp, gain, *line;
+
+	gain = a[1];
+	end = (int) a[0];
+	i = (int) a[STARTM1];
+	while (nvals > 0) {
+		if (i >= end) i = START;
+		run = end - i;
+		if (run > nvals) run = nvals;
+		line = a + i;
+		for (n = 0; n < run; n++) {
+			temp = line[n];
+			line[n] = temp * gain + x[n];
+			out[n] = temp - gain * line[n];
+		}
+		i += run;
+		x += run;
+		out += run;
+		nvals -= run;
+	}
+	a[STARTM1] = i;
+}
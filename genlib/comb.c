@@ -10,3 +10,33 @@ float comb(float samp, float *a)
 	*aptr = *aptr * a[1] + samp;
 	return(temp);
 }
+
+/* Block version of comb: <x> may be the same array as <out>.  Each sample
+   of the loop is read and rewritten once per trip around it, so a run up
+   to the end of the loop has no dependence from one sample to the next.
+*/
+void bcomb(float *x, float *a, float *out, int nvals)
+{
+	int i, n, run, end;
+	float temp, gain, *line;
+
+	gain = a[1];
+	end = (int) a[0];
+	i = (int) a[STARTM1];
+	while (nvals > 0) {
+		if (i >= end) i = START;
+		run = end - i;
+		if (run > nvals) run = nvals;
+		line = a + i;
+		for (n = 0; n < run; n++) {
+			temp = line[n];
+			line[n] = temp * gain + x[n];
+			out[n] = temp;
+		}
+		i += run;
+		x += run;
+		out += run;
+		nvals -= run;
+	}
+	a[STARTM1] = i;
+}
@@ -10,3 +10,39 @@ float delget(float *a, float wait, int *l)
 		}
 	return a[i];
 }
+
+/* After bdelput of <nvals> values, get the <nvals> values that delget would
+   have returned after each of them, wait seconds old.  The delay must be at
+   least one sample, and the line (see delset) at least <nvals> samples
+   longer than it, or the block will have overwritten some of them.
+*/
+void bdelget(float *a, float wait, int *l, float *out, int nvals)
+{
+	int n, run, len = l[2];
+	int lag = (int)(wait * l[1] + .5);
+	/* where the first of the block would have been read */
+	register int i = l[0] - nvals + 1 - lag;
+
+	if (lag > len) {
+		/* delget finds nothing this old for some of them */
+		for (n = 0; n < nvals; n++) {
+			int now = (l[0] - nvals + 1 + n) % len;
+			if (now < 0) now += len;
+			i = now - lag;
+			if (i < 0) i += len;
+			out[n] = (i < 0) ? 0 : a[i];
+		}
+		return;
+	}
+	i %= len;
+	if (i < 0) i += len;
+	while (nvals > 0) {
+		run = len - i;
+		if (run > nvals) run = nvals;
+		for (n = 0; n < run; n++)
+			out[n] = a[i + n];
+		out += run;
+		nvals -= run;
+		i = 0;
+	}
+}
@@ -8,3 +8,22 @@ delput(float x, float *a, int *l)
 	if (l[0] >= l[2])
 		l[0] -= l[2];
 }
+
+/* put <nvals> values in delay line, as that many calls to delput would. */
+void
+bdelput(float *x, float *a, int *l, int nvals)
+{
+	int n, run;
+	while (nvals > 0) {
+		run = l[2] - l[0];
+		if (run > nvals)
+			run = nvals;
+		for (n = 0; n < run; n++)
+			a[l[0] + n] = x[n];
+		x += run;
+		nvals -= run;
+		l[0] += run;
+		if (l[0] >= l[2])
+			l[0] -= l[2];
+	}
+}
@@ -15,3 +15,53 @@ float dliget(float *a, float wait, int *l)
 		}
 	return a[i] + frac * (a[im1] - a[i]);
 }
+
+/* After bdelput of <nvals> values, get the <nvals> interpolated values that
+   dliget would have returned after each of them, wait seconds old.  The
+   delay must be at least one sample, and the line (see delset) at least
+   <nvals> + 1 samples longer than it.
+*/
+void bdliget(float *a, float wait, int *l, float *out, int nvals)
+{
+	register int i, n, run, len = l[2];
+	float x = wait * l[1];
+	int lag = (int) x;
+	float frac = x - lag;
+
+	if (lag > len) {
+		/* dliget finds nothing this old for some of them */
+		for (n = 0; n < nvals; n++) {
+			int now = (l[0] - nvals + 1 + n) % len;
+			if (now < 0) now += len;
+			i = now - lag;
+			if (i < 0) i += len;
+			if (i < 0) { out[n] = 0; continue; }
+			out[n] = a[i] + frac * (a[(i == 0) ? len - 1 : i - 1] - a[i]);
+		}
+		return;
+	}
+	/* where the first of the block would have been read */
+	i = (l[0] - nvals + 1 - lag) % len;
+	if (i < 0) i += len;
+	n = 0;
+	while (n < nvals) {
+		if (i == 0) {
+			/* the sample before is at the other end */
+			out[n] = a[0] + frac * (a[len - 1] - a[0]);
+			n++;
+			i = 1;
+			continue;
+		}
+		run = len - i;
+		if (run > nvals - n) run = nvals - n;
+		{
+			float *ap = a + i, *op = out + n;
+			int k;
+			for (k = 0; k < run; k++)
+				op[k] = ap[k] + frac * (ap[k - 1] - ap[k]);
+		}
+		n += run;
+		i += run;
+		if (i >= len) i = 0;
+	}
+}
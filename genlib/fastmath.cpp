@@ -0,0 +1,142 @@
+/* RTcmix - Copyright (C) 2004  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// Tables and block forms for fastmath.h.
+#include <fastmath.h>
+#include <math.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define FASTMATH_SIMD 1
+#include <emmintrin.h>
+#endif
+
+#ifndef M_LN2
+#define M_LN2	0.69314718055994529
+#endif
+
+// midC freq is 440.0 * pow(2.0, -9.0 / 12.0) = 261.625..., as in pitchconv.c
+#define MIDC_OFFSET (261.62556530059868 / 256.0)
+
+// 2^f and log2(1 + f) for f from 0 to 1, read with linear interpolation.
+#define TABLE_BITS	12
+#define TABLE_SIZE	(1 << TABLE_BITS)
+
+static double sExp2Table[TABLE_SIZE + 1];
+static double sLog2Table[TABLE_SIZE + 1];
+
+static struct FastMathTables {
+	FastMathTables() {
+		for (int i = 0; i <= TABLE_SIZE; ++i) {
+			const double f = (double) i / TABLE_SIZE;
+			sExp2Table[i] = pow(2.0, f);
+			sLog2Table[i] = log(1.0 + f) / M_LN2;
+		}
+	}
+} sTables;
+
+static inline double lookup(const double *table, double f)
+{
+	const double pos = f * TABLE_SIZE;
+	int i = (int) pos;
+	if (i >= TABLE_SIZE)
+		i = TABLE_SIZE - 1;
+	const double frac = pos - i;
+	return table[i] + frac * (table[i + 1] - table[i]);
+}
+
+double fastcpsoct(double oct)
+{
+	const double whole = floor(oct);
+	return ldexp(lookup(sExp2Table, oct - whole), (int) whole) * MIDC_OFFSET;
+}
+
+double fastoctcps(double cps)
+{
+	int e;
+	const double m = frexp(cps / MIDC_OFFSET, &e);	// 0.5 to 1
+	return lookup(sLog2Table, m * 2.0 - 1.0) + (e - 1);
+}
+
+// As octpch() and cpsoct() in pitchconv.c.
+double fastcpspch(double pch)
+{
+	const int octave = (int) pch;
+	return fastcpsoct(octave + (100.0 / 12.0) * (pch - octave));
+}
+
+#ifdef FASTMATH_SIMD
+
+// fastexp2f(), four at a time.
+static inline __m128 exp2x4(__m128 x)
+{
+	x = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(127.49f)), _mm_set1_ps(-126.0f));
+	const __m128 half = _mm_or_ps(_mm_and_ps(x, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f));
+	const __m128i n = _mm_cvttps_epi32(_mm_add_ps(x, half));
+	const __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+	__m128 p = _mm_set1_ps(1.535336188319500e-4f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.339887440266574e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.618437357674640e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.550332471162809e-2f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.402264791363012e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.931472028550421e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+	const __m128i bits = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(bits));
+}
+
+#endif	// FASTMATH_SIMD
+
+void fastexpf_block(const float *in, float *out, int len)
+{
+	int n = 0;
+#ifdef FASTMATH_SIMD
+	const __m128 log2e = _mm_set1_ps(1.44269504089f);
+	for ( ; n + 4 <= len; n += 4)
+		_mm_storeu_ps(&out[n], exp2x4(_mm_mul_ps(_mm_loadu_ps(&in[n]), log2e)));
+#endif
+	for ( ; n < len; ++n)
+		out[n] = fastexpf(in[n]);
+}
+
+void fastampdb_block(const float *in, float *out, int len)
+{
+	int n = 0;
+#ifdef FASTMATH_SIMD
+	const __m128 scale = _mm_set1_ps(0.166096404744f);
+	for ( ; n + 4 <= len; n += 4)
+		_mm_storeu_ps(&out[n], exp2x4(_mm_mul_ps(_mm_loadu_ps(&in[n]), scale)));
+#endif
+	for ( ; n < len; ++n)
+		out[n] = fastampdb(in[n]);
+}
+
+// Both branches of fasttanhf() for all four, and the one each needs kept.
+
+void fasttanhf_block(const float *in, float *out, int len)
+{
+	int n = 0;
+#ifdef FASTMATH_SIMD
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	for ( ; n + 4 <= len; n += 4) {
+		const __m128 x = _mm_loadu_ps(&in[n]);
+		const __m128 a = _mm_andnot_ps(sign, x);
+		const __m128 z = _mm_mul_ps(x, x);
+		__m128 series = _mm_add_ps(_mm_set1_ps(-0.333333333f),
+								   _mm_mul_ps(z, _mm_set1_ps(0.133333333f)));
+		series = _mm_mul_ps(x, _mm_add_ps(one, _mm_mul_ps(z, series)));
+		const __m128 e = exp2x4(_mm_mul_ps(_mm_min_ps(a, _mm_set1_ps(9.0f)),
+										   _mm_set1_ps(2.88539008178f)));
+		__m128 t = _mm_sub_ps(one, _mm_div_ps(_mm_set1_ps(2.0f), _mm_add_ps(e, one)));
+		t = _mm_or_ps(_mm_andnot_ps(_mm_cmpgt_ps(a, _mm_set1_ps(9.0f)), t),
+					  _mm_and_ps(_mm_cmpgt_ps(a, _mm_set1_ps(9.0f)), one));
+		t = _mm_or_ps(t, _mm_and_ps(x, sign));
+		const __m128 small = _mm_cmplt_ps(a, _mm_set1_ps(0.0625f));
+		_mm_storeu_ps(&out[n], _mm_or_ps(_mm_and_ps(small, series),
+										 _mm_andnot_ps(small, t)));
+	}
+#endif
+	for ( ; n < len; ++n)
+		out[n] = fasttanhf(in[n]);
+}
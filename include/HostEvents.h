@@ -0,0 +1 @@
+../src/rtcmix/HostEvents.h
\ No newline at end of file
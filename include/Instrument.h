@@ -0,0 +1 @@
+../src/rtcmix/Instrument.h
\ No newline at end of file
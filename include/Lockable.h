@@ -0,0 +1 @@
+../src/rtcmix/Lockable.h
\ No newline at end of file
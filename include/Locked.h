@@ -0,0 +1 @@
+../src/rtcmix/Locked.h
\ No newline at end of file
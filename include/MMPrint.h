@@ -0,0 +1 @@
+../src/rtcmix/MMPrint.h
\ No newline at end of file
@@ -11,16 +11,29 @@
 #include "../genlib/Obucket.h"
 #include "../genlib/Ocomb.h"
 #include "../genlib/Ocombi.h"
+#include "../genlib/Oconvolve.h"
 #include "../genlib/Odcblock.h"
 #include "../genlib/Odelay.h"
 #include "../genlib/Odelayi.h"
 #include "../genlib/Odistort.h"
+#include "../genlib/Ofdn.h"
 #include "../genlib/Oequalizer.h"
 #include "../genlib/Offt.h"
+#include "../genlib/Ofilterbank.h"
+#include "../genlib/Ofir.h"
+#include "../genlib/Ogainmatrix.h"
+#include "../genlib/Olimiter.h"
+#include "../genlib/Omipmap.h"
+#include "../genlib/Omultitap.h"
 #include "../genlib/Oonepole.h"
 #include "../genlib/Ooscil.h"
+#include "../genlib/Ooscilbank.h"
 #include "../genlib/Ooscili.h"
+#include "../genlib/Ooversample.h"
 #include "../genlib/Orand.h"
+#include "../genlib/Orandblock.h"
+#include "../genlib/Oreblock.h"
+#include "../genlib/Oresample.h"
 #include "../genlib/Oreson.h"
 #include "../genlib/Orms.h"
 #include "../genlib/Ortgetin.h"
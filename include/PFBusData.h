@@ -0,0 +1 @@
+../src/rtcmix/PFBusData.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/PField.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/PFieldSet.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/RTOption.h
\ No newline at end of file
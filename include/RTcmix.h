@@ -0,0 +1 @@
+../src/rtcmix/RTcmix.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/RTsockfuncs.h
\ No newline at end of file
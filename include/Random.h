@@ -0,0 +1 @@
+../src/rtcmix/Random.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/RawDataFile.h
\ No newline at end of file
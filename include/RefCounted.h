@@ -0,0 +1 @@
+../src/rtcmix/RefCounted.h
\ No newline at end of file
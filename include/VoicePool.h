@@ -0,0 +1 @@
+../src/rtcmix/VoicePool.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/WorkerPool.h
\ No newline at end of file
@@ -1,9 +1,14 @@
 #ifndef _BUS_H_ 
 #define _BUS_H_ 1
 
-/* MAXBUS is the maximum number of buses you can ever request dynamically. Some arrays are still statically set using this */
+/* The bus count is set by rtsetparams, from MINBUS to MAXBUSCOUNT, and
+   everything indexed by bus number is sized to it then.  MAXBUS is the
+   most buses of each direction one instrument can name in its bus_config,
+   since instruments size their per-channel arrays by it.
+*/
 #define MINBUS 8
 #define MAXBUS 129
+#define MAXBUSCOUNT 4096
 
 #ifndef DEFAULT_MAXBUS
 #if defined(EMBEDDED)
@@ -45,7 +50,7 @@ struct CheckNode;
 struct BusConfig
 {
 	BusConfig() : In_Config(0), HasChild(false), HasParent(false), AuxInUse(false), AuxOutInUse(false),
-				  OutInUse(false), RevPlay(0) {}
+				  OutInUse(false), RevPlay(0), PlayLevel(0) {}
 	/* Bus graph, parsed by check_bus_inst_config */
 	/* Allows loop checking ... and buffer playback order? */
 	CheckNode *	In_Config;
@@ -56,6 +61,8 @@ struct BusConfig
 	bool		AuxOutInUse;
 	bool		OutInUse;
 	short		RevPlay;
+	/* Depth of this aux bus in the bus graph: 1 + deepest aux bus feeding it */
+	short		PlayLevel;
 };
 
 class BusSlot;
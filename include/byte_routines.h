@@ -0,0 +1 @@
+../src/rtcmix/byte_routines.h
\ No newline at end of file
@@ -0,0 +1,119 @@
+/* RTcmix - Copyright (C) 2004  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _FASTMATH_H_
+#define _FASTMATH_H_ 1
+
+// Quicker stand-ins for the libm calls instruments make at control rate or
+// for every sample: ampdb and the pitch converters in ugens.h, and exp and
+// tanh in nonlinear filters and shapers.  Nothing calls these for you; use
+// them where the error below is small enough not to matter.
+//
+//    fastexp2f               relative error under 1e-7, down to 2^-125
+//    fastexpf                relative error under 6e-7 for -10 to 10,
+//                            growing with |x| as x * log2(e) is rounded
+//    fastlog2f               relative error under 1e-7; the argument
+//                            must be positive and finite
+//    fasttanhf               absolute error under 2e-7
+//    fastampdb               relative error under 1e-6 for -120 to 40 dB
+//    fastdbamp               relative error under 3e-7; 0 gives -759 dB
+//    fastcpsoct, fastcpspch  relative error under 1e-8, from a table
+//    fastoctcps              absolute error under 2e-8 (octaves), ditto
+//
+// The _block forms do <len> values at once, four at a time with SSE2, and
+// may work in place.  Their results are the same as the scalar ones.
+
+#include <string.h>
+
+// 2^x, for x from -126 to 127.49.
+inline float fastexp2f(float x)
+{
+	if (x < -126.0f)
+		x = -126.0f;
+	else if (x > 127.49f)
+		x = 127.49f;
+	const int n = (int) (x + (x >= 0.0f ? 0.5f : -0.5f));
+	const float f = x - n;					// -0.5 to 0.5
+	const float p = ((((( 1.535336188319500e-4f * f
+						+ 1.339887440266574e-3f) * f
+						+ 9.618437357674640e-3f) * f
+						+ 5.550332471162809e-2f) * f
+						+ 2.402264791363012e-1f) * f
+						+ 6.931472028550421e-1f) * f + 1.0f;
+	const int bits = (n + 127) << 23;
+	float scale;
+	memcpy(&scale, &bits, sizeof(scale));
+	return p * scale;
+}
+
+inline float fastlog2f(float x)
+{
+	int bits;
+	memcpy(&bits, &x, sizeof(bits));
+	int e = ((bits >> 23) & 0xff) - 127;
+	bits = (bits & 0x7fffff) | 0x3f800000;
+	float m;
+	memcpy(&m, &bits, sizeof(m));			// 1 to 2
+	if (m > 1.41421356f) {
+		m *= 0.5f;
+		++e;
+	}
+	const float t = m - 1.0f;				// -0.29 to 0.41
+	const float z = t * t;
+	float y = (((((((( 7.0376836292e-2f * t
+					- 1.1514610310e-1f) * t
+					+ 1.1676998740e-1f) * t
+					- 1.2420140846e-1f) * t
+					+ 1.4249322787e-1f) * t
+					- 1.6668057665e-1f) * t
+					+ 2.0000714765e-1f) * t
+					- 2.4999993993e-1f) * t
+					+ 3.3333331174e-1f) * t * z;
+	y += t - 0.5f * z;						// log(m)
+	return y * 1.44269504089f + e;
+}
+
+inline float fastexpf(float x)
+{
+	return fastexp2f(x * 1.44269504089f);
+}
+
+inline float fasttanhf(float x)
+{
+	const float a = x < 0.0f ? -x : x;
+	float t;
+	if (a < 0.0625f) {
+		const float z = x * x;
+		return x * (1.0f + z * (-0.333333333f + z * 0.133333333f));
+	}
+	if (a > 9.0f)
+		t = 1.0f;
+	else
+		t = 1.0f - 2.0f / (fastexp2f(a * 2.88539008178f) + 1.0f);
+	return x < 0.0f ? -t : t;
+}
+
+inline float fastampdb(float db)
+{
+	return fastexp2f(db * 0.166096404744f);		// log2(10) / 20
+}
+
+inline float fastdbamp(float amp)
+{
+	if (amp < 0.0f)
+		amp = -amp;
+	if (amp < 1.17549435e-38f)					// FLT_MIN
+		amp = 1.17549435e-38f;
+	return fastlog2f(amp) * 6.02059991328f;		// 20 * log10(2)
+}
+
+double fastcpsoct(double oct);
+double fastoctcps(double cps);
+double fastcpspch(double pch);
+
+void fastexpf_block(const float *in, float *out, int len);
+void fasttanhf_block(const float *in, float *out, int len);
+void fastampdb_block(const float *in, float *out, int len);
+
+#endif	// _FASTMATH_H_
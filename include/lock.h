@@ -0,0 +1 @@
+../src/rtcmix/lock.h
\ No newline at end of file
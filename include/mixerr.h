@@ -0,0 +1 @@
+../src/rtcmix/mixerr.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/rt.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/rtcmix_types.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/rtdefs.h
\ No newline at end of file
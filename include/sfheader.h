@@ -0,0 +1 @@
+../src/rtcmix/sfheader.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/sockdefs.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/spray.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/rtcmix/ug_intro.h
\ No newline at end of file
@@ -68,6 +68,7 @@ extern int (*getsample)(double, float *, int);
 #define GETSAMPLE (*getsample)
 
 float allpass(float, float *);
+void ballpass(float*, float*, float*, int);
 float allpole(float, int*, int, float*, float*);
 double ampdb(float);
 double dbamp(float);
@@ -81,14 +82,18 @@ void sbrrand(unsigned int);
 void brrand(float, float*, int);
 float buzz(float, float, float, double*, float*);
 float comb(float, float*);
+void bcomb(float*, float*, float*, int);
 void combset(float, float, float,int, float*);
 double cpsmidi(double);
 double cpsoct(double);
 double cpspch(double);
 float delget(float*, float, int*);
+void bdelget(float*, float, int*, float*, int);
 void delput(float, float*, int*);
+void bdelput(float*, float*, int*, int);
 void delset(float, float*, int*, float);
 float dliget(float*, float, int*);
+void bdliget(float*, float, int*, float*, int);
 float evp(long, double*, double*, float*);
 void evset(float, float, float, float, int, float*);
 float hcomb(float,float,float*);
@@ -161,6 +166,9 @@ off_t outrepos(int samps, int fno);
 /* fnscl.c */
 void fnscl(struct gen *gen);
 
+/* addsine.c */
+void addsine(double array[], int len, double incr, double phase, double amp);
+
 /* system error status values.  These are returned up through to the parser */
 
 typedef enum {
@@ -209,10 +217,13 @@ typedef enum {
 #define RTPrintfCat(format, ...) set_mm_print_ptr(snprintf(get_mm_print_ptr(), get_mm_print_space(), format, ## __VA_ARGS__))
 #define RTFPrintfCat(FILE, format, ...) set_mm_print_ptr(snprintf(get_mm_print_ptr(), get_mm_print_space(), format, ## __VA_ARGS__))
 #else
-#define RTPrintf(format, ...) printf(format, ## __VA_ARGS__)
-#define RTFPrintf(FILE, format, ...) fprintf(FILE, format, ## __VA_ARGS__)
-#define RTPrintfCat(format, ...) printf(format, ## __VA_ARGS__)
-#define RTFPrintfCat(FILE, format, ...) fprintf(FILE, format, ## __VA_ARGS__)
+#include <stdio.h>
+/* like fprintf, but deferred on real-time threads (see message.cpp) */
+int rtcmix_fprintf(FILE *stream, const char *format, ...);
+#define RTPrintf(format, ...) rtcmix_fprintf(stdout, format, ## __VA_ARGS__)
+#define RTFPrintf(FILE, format, ...) rtcmix_fprintf(FILE, format, ## __VA_ARGS__)
+#define RTPrintfCat(format, ...) rtcmix_fprintf(stdout, format, ## __VA_ARGS__)
+#define RTFPrintfCat(FILE, format, ...) rtcmix_fprintf(FILE, format, ## __VA_ARGS__)
 #endif
 
 #define RTExit(status) throw(status)
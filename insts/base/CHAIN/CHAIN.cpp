@@ -58,6 +58,9 @@ void unrefInstrument(Instrument *i)
 
 CHAIN::~CHAIN()
 {
+	// Our outbuf belongs to the last instrument in the chain (see configure()).
+	if (!mInstVector.empty() && outbuf == mInstVector.back()->outbuf)
+		outbuf = NULL;
     std::for_each(mInstVector.begin(), mInstVector.end(), unrefInstrument);
 }
 
@@ -66,7 +69,7 @@ int  CHAIN::setup(PFieldSet *inPFields)
 	// Copy first 3 numeric args to new PFieldSet
 	PFieldSet *newSet = new PFieldSet(3);
 	for (int p = 0; p < 3; ++p)
-		newSet->load(new ConstPField((*inPFields)[p].doubleValue(0.0)), p);
+		newSet->loadConstant((*inPFields)[p].doubleValue(0.0), p);
 	// The remaining args are InstPFields
 	int numChainedInstruments = (int)(*inPFields)[2].intValue(0.0);
 	if (numChainedInstruments <= 0) {
@@ -112,21 +115,32 @@ int CHAIN::configure()
 	Instrument *previous = NULL;
 	for (std::vector<Instrument *>::iterator it = mInstVector.begin(); it != mInstVector.end(); ++it) {
 		Instrument *inst = *it;
-		status = inst->configure(RTBUFSAMPS);
-		if (status != 0)
-			return status;
+		// Whatever reads our members' output wants it interleaved.
+		inst->_planarOutput = false;
+		// Connect the input first, so that configure() can tell it is chained.
 		if (previous != NULL) {
 			status = inst->setChainedInputBuffer(previous->outbuf, previous->outputChannels());
 			if (status != 0)
 				return status;
 		}
+		status = inst->configure(RTBUFSAMPS);
+		if (status != 0)
+			return status;
 		previous = inst;
 	}
     assert(previous != NULL);   // should not be possible for this to fire
+	if (previous->outputChannels() != outputChannels()) {
+		return die("CHAIN", "Last chained inst output (%d) != CHAIN output chans (%d)",
+				   previous->outputChannels(), outputChannels());
+	}
 	// For CHAIN itself, we override our (what should be zero) input channel count here.  This allows setChainedInputBuffer() to succeed
 	// even though the counts don't seem to match.
 	_input.inputchans = previous->outputChannels();
 	status = setChainedInputBuffer(previous->outbuf, previous->outputChannels());
+	// The last instrument writes straight into what we mix to the buses, so
+	// we give back the buffer Instrument::configure(int) made for us.
+	freeBuffer(outbuf);
+	outbuf = previous->outbuf;
 	return status;
 }
 
@@ -152,9 +166,7 @@ int CHAIN::run()
 //    if (!anInstRan) {
 //        printf("CHAIN::run(%p) - no internal instruments ran!\n", this);
 //    }
-	// Copy from inputChainedBuf, which points to the outbuf of the last instrument in the chain.
-	unsigned copySize = framesToRun() * outputChannels() * sizeof(BUFTYPE);
-	memcpy(outbuf, inputChainBuf, copySize);
+	// Our outbuf is the outbuf of the last instrument in the chain, so there is nothing to copy.
 	return framesToRun();
 }
 
@@ -32,7 +32,7 @@ MIX::MIX() : Instrument(), in(NULL)
 
 MIX::~MIX()
 {
-	delete [] in;
+	freeBuffer(in);
 }
 
 // In fastUpdate mode, we skip doupdate() entirely, instead updating only amp,
@@ -101,19 +101,31 @@ int MIX::init(double p[], int n_args)
 
 int MIX::configure()
 {
-	in = new float [RTBUFSAMPS * inputChannels()];
+	if (hasChainedInput())
+		return 0;		// we read the previous instrument's output in place
+	in = allocBuffer(RTBUFSAMPS * inputChannels());
 	return in ? 0 : -1;
 }
 
 
-int MIX::run()
+// Called through runForChannels, so that the channel counts are constants
+// in the usual cases.
+
+template <int IN, int OUT>
+int MIX::runChannels()
 {
-	const int inchans = inputChannels();
-	const int samps = framesToRun() * inchans;
+	const int inchans = IN ? IN : inputChannels();
+	const int ochans = OUT ? OUT : outputChannels();
+	const int frames = framesToRun();
+
+	const float *inbuf = rtgetinbuf(in, frames * inchans);
 
-	rtgetin(in, this, samps);
+	int stride = 1;
+	BUFTYPE *outs[MAXBUS];
+	for (int j = 0; j < ochans; j++)
+		outs[j] = outputChannel(j, &stride);
 
-	for (int i = 0; i < samps; i += inchans)  {
+	for (int i = 0; i < frames; i++, inbuf += inchans)  {
 		if (--branch <= 0) {
 			if (fastUpdate) {
 				if (amptable)
@@ -129,20 +141,26 @@ int MIX::run()
 			branch = getSkip();
 		}
 
-		float out[MAXBUS];
-		const int ochans = outputChannels();
-		for (int j = 0; j < ochans; j++) {
+		float out[OUT ? OUT : MAXBUS];
+		for (int j = 0; j < ochans; j++)
 			out[j] = 0.0;
-			for (int k = 0; k < inchans; k++) {
-				if (outchan[k] == j)
-					out[j] += in[i+k] * amp;
-			}
+		for (int k = 0; k < inchans; k++) {
+			if (outchan[k] >= 0)
+				out[outchan[k]] += inbuf[k] * amp;
 		}
+		for (int j = 0; j < ochans; j++)
+			outs[j][i * stride] = out[j];
 
-		rtaddout(out);
 		increment();
 	}
-	return framesToRun();
+	advanceOutput(frames);
+	return frames;
+}
+
+
+int MIX::run()
+{
+	return runForChannels(this);
 }
 
 
@@ -13,5 +13,6 @@ public:
 	virtual int init(double *, int);
 	virtual int configure();
 	virtual int run();
+	template <int IN, int OUT> int runChannels();
 };
 
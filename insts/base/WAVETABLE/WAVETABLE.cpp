@@ -18,7 +18,14 @@
 
    *** If p5 is missing, you can use an old-style gen table 2 for the
    oscillator waveform.  If there is no p5 and no gen table 2, then a
-   a built-in sine table will be used.
+   a built-in sine table will be used.  A p5 table made with maketable's
+   "bandlimit" option is read at each pitch without aliasing, e.g.
+
+      wave = maketable("wave", "bandlimit", 2048, "saw")
+
+   With set_option("voice_pool = true"), notes that use neither gen table
+   are played as voices of one long-lived WAVETABLE, which saves the cost of
+   making an instrument for each.  A pooled note returns no handle.
 
                                                 rev for v4, JGG, 7/12/04
 */
@@ -27,7 +34,9 @@
 #include <stdlib.h>
 #include <ugens.h>
 #include <math.h>
+#include <new>
 #include <Instrument.h>
+#include <VoicePool.h>
 #include <PField.h>
 #include <RTOption.h>	// fastUpdate
 #include "WAVETABLE.h"
@@ -36,6 +45,7 @@
 
 #define AMP_GEN_SLOT     1
 #define WAVET_GEN_SLOT   2
+#define SINE_LEN         1024
 
 
 WAVETABLE::WAVETABLE() : branch(0), fastUpdate(false), ownWavetable(false), wavetable(NULL), amptable(NULL), osc(NULL)
@@ -109,15 +119,23 @@ int WAVETABLE::init(double p[], int n_args)
 
 	wavetable = NULL;
 	int tablelen = 0;
-	if (n_args > 5)		// handle table coming in as optional p5 TablePField
-		wavetable = (double *) getPFieldTable(5, &tablelen);
-	if (wavetable == NULL) {
+	const float *floattable = NULL;
+	const Omipmap *mipmap = NULL;
+	if (n_args > 5) {	// handle table coming in as optional p5 TablePField
+		mipmap = getPFieldMipmap(5);
+		if (mipmap != NULL)
+			tablelen = mipmap->length();
+		// Read a float table as it is, rather than having a copy made.
+		else if ((floattable = getPFieldFloatTable(5, &tablelen)) == NULL)
+			wavetable = (double *) getPFieldTable(5, &tablelen);
+	}
+	if (wavetable == NULL && floattable == NULL && mipmap == NULL) {
 		wavetable = floc(WAVET_GEN_SLOT);
 		if (wavetable)
 			tablelen = fsize(WAVET_GEN_SLOT);
 		else {
 			rtcmix_advise("WAVETABLE", "No wavetable specified, so using sine wave.");
-			tablelen = 1024;
+			tablelen = SINE_LEN;
 			wavetable = new double [tablelen];
 			ownWavetable = true;
 			const double twopi = M_PI * 2.0;
@@ -128,7 +146,17 @@ int WAVETABLE::init(double p[], int n_args)
 	if (tablelen > 32767)
 		return die("WAVETABLE", "wavetable must have fewer than 32768 samples.");
 
-	osc = new Ooscili(SR, freq, wavetable, tablelen);
+	if (mipmap != NULL)
+		osc = new Ooscili(SR, freq, mipmap);
+	else if (floattable != NULL)
+		osc = new Ooscili(SR, freq, floattable, tablelen);
+	else
+		osc = new Ooscili(SR, freq, wavetable, tablelen);
+
+	// Notes can be replayed from the note cache, unless they use makegens,
+	// which can change between notes.
+	if (floc(AMP_GEN_SLOT) == NULL && (n_args > 5 || floc(WAVET_GEN_SLOT) == NULL))
+		allowNoteCache();
 
 	return nSamps();
 }
@@ -151,35 +179,145 @@ void WAVETABLE::doupdate()
 	spread = p[4];
 }
 
+// The oscillator fills a block of samples at a time, up to the next control
+// update (<branch> counts the frames until then).
+
+#define WAVE_CHUNK 256
+
 int WAVETABLE::run()
 {
 	const int nframes = framesToRun();
-	for (int i = 0; i < nframes; i++) {
-		if (--branch <= 0) {
+	float wave[WAVE_CHUNK];
+	int i = 0;
+	while (i < nframes) {
+		if (branch <= 0) {
 			if (fastUpdate) {
 				if (amptable)
 					amp = ampmult * tablei(currentFrame(), amptable, amptabs);
 			}
 			else
 				doupdate();
+			ampRamp.set(amp, getSkip());
 			branch = getSkip();
 		}
+		int count = nframes - i;
+		if (count > branch)
+			count = branch;
+		if (count > WAVE_CHUNK)
+			count = WAVE_CHUNK;
+		osc->nextBlock(wave, count);
 
-		float out[2];
-		out[0] = osc->next() * amp;
+		for (int j = 0; j < count; j++) {
+			float out[2];
+			out[0] = wave[j] * (float) ampRamp.next();
 
-		if (outputChannels() == 2) {
-			out[1] = (1.0 - spread) * out[0];
-			out[0] *= spread;
-		}
+			if (outputChannels() == 2) {
+				out[1] = (1.0 - spread) * out[0];
+				out[0] *= spread;
+			}
 
-		rtaddout(out);
-		increment();
+			rtaddout(out);
+			increment();
+		}
+		branch -= count;
+		i += count;
 	}
 	return framesToRun();
 }
 
 
+WAVETABLEPool::WAVETABLEPool()
+{
+	voices = new Voice [kMaxNotes];
+	oscs = (Ooscili *) ::operator new(sizeof(Ooscili) * kMaxNotes);
+	sinetable = new double [SINE_LEN];
+	const double twopi = M_PI * 2.0;
+	for (int i = 0; i < SINE_LEN; i++)
+		sinetable[i] = sin(twopi * ((double) i / SINE_LEN));
+}
+
+WAVETABLEPool::~WAVETABLEPool()
+{
+	delete [] voices;
+	::operator delete(oscs);
+	delete [] sinetable;
+}
+
+bool WAVETABLEPool::acceptNote(int voice, const double p[],
+	PField * const fields[], int nargs)
+{
+	if (outputChannels() > 2 || floc(AMP_GEN_SLOT) != NULL)
+		return false;
+
+	double *wavetable = NULL;
+	const float *floattable = NULL;
+	const Omipmap *mipmap = NULL;
+	int tablelen = 0;
+	if (nargs > 5 && fields[5] != NULL) {
+		mipmap = fields[5]->mipmap();
+		if (mipmap == NULL && (floattable = fields[5]->floatArray()) == NULL)
+			wavetable = (double *) *fields[5];
+		tablelen = fields[5]->values();
+	}
+	if (wavetable == NULL && floattable == NULL && mipmap == NULL) {
+		if (floc(WAVET_GEN_SLOT) != NULL)
+			return false;
+		wavetable = sinetable;
+		tablelen = SINE_LEN;
+	}
+	if (tablelen > 32767)
+		return false;
+
+	Voice &v = voices[voice];
+	v.freqraw = p[3];
+	const float freq = (v.freqraw < 15.0) ? cpspch(v.freqraw) : v.freqraw;
+	if (mipmap != NULL)
+		new (&oscs[voice]) Ooscili(SR, freq, mipmap);
+	else if (floattable != NULL)
+		new (&oscs[voice]) Ooscili(SR, freq, floattable, tablelen);
+	else
+		new (&oscs[voice]) Ooscili(SR, freq, wavetable, tablelen);
+	v.ampRamp = ControlRamp();
+	return true;
+}
+
+// As WAVETABLE::doupdate()
+
+void WAVETABLEPool::updateVoice(int voice, const double p[], int nargs)
+{
+	Voice &v = voices[voice];
+	v.amp = p[2];
+	if (p[3] != v.freqraw) {
+		v.freqraw = p[3];
+		float freq = (v.freqraw < 15.0) ? cpspch(v.freqraw) : v.freqraw;
+		oscs[voice].setfreq(freq);
+	}
+	v.spread = p[4];
+	v.ampRamp.set(v.amp, getSkip());
+}
+
+void WAVETABLEPool::renderVoice(int voice, float *outs[], int frames)
+{
+	Voice &v = voices[voice];
+	float wave[kBlockFrames];
+	oscs[voice].nextBlock(wave, frames);
+
+	if (outputChannels() == 2) {
+		float *left = outs[0], *right = outs[1];
+		for (int j = 0; j < frames; j++) {
+			const float out = wave[j] * (float) v.ampRamp.next();
+			left[j] += out * v.spread;
+			right[j] += (1.0 - v.spread) * out;
+		}
+	}
+	else {
+		float *mono = outs[0];
+		for (int j = 0; j < frames; j++)
+			mono[j] += wave[j] * (float) v.ampRamp.next();
+	}
+}
+
+
 Instrument *makeWAVETABLE()
 {
 	WAVETABLE *inst;
@@ -188,9 +326,16 @@ Instrument *makeWAVETABLE()
 	return inst;
 }
 
+VoicePool *makeWAVETABLEPool()
+{
+	WAVETABLEPool *pool = new WAVETABLEPool();
+	pool->set_bus_config("WAVETABLE");
+	return pool;
+}
+
 #ifndef EMBEDDED
 void rtprofile()
 {
-	RT_INTRO("WAVETABLE", makeWAVETABLE);
+	RT_INTRO_POOL("WAVETABLE", makeWAVETABLE, makeWAVETABLEPool);
 }
 #endif
@@ -5,6 +5,7 @@ class WAVETABLE : public Instrument {
 	bool fastUpdate, ownWavetable;
 	float amp, ampmult, freqraw, spread, amptabs[2];
 	double *wavetable, *amptable;
+	ControlRamp ampRamp;
 	Ooscili *osc;
 
 	void initamp(float dur, double p[], int ampindex, int ampgenslot);
@@ -15,3 +16,25 @@ public:
 	virtual int init(double p[], int n_args);
 	virtual int run();
 };
+
+// WAVETABLE notes played as the voices of one instrument, for the voice_pool
+// option (see VoicePool.h).  Notes that use makegen tables are left to
+// WAVETABLE itself.
+
+class WAVETABLEPool : public VoicePool {
+	struct Voice {
+		float amp, freqraw, spread;
+		ControlRamp ampRamp;
+	};
+	Voice *voices;
+	Ooscili *oscs;		// one per voice, made in place
+	double *sinetable;
+protected:
+	virtual bool acceptNote(int voice, const double p[], PField * const fields[],
+	                        int nargs);
+	virtual void updateVoice(int voice, const double p[], int nargs);
+	virtual void renderVoice(int voice, float *outs[], int frames);
+public:
+	WAVETABLEPool();
+	virtual ~WAVETABLEPool();
+};
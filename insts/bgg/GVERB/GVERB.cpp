@@ -37,12 +37,14 @@
 #include <rtdefs.h>
 
 
-GVERB::GVERB() : Instrument()
+GVERB::GVERB() : Instrument(), p(NULL)
 {
 }
 
 GVERB::~GVERB()
 {
+	if (p)
+		delete p->fdn;
 }
 
 int GVERB::init(double pfs[], int n_args)
@@ -102,31 +104,13 @@ int GVERB::init(double pfs[], int n_args)
 
 	/* FDN section */
 
-	p->fdndels = (ty_fixeddelay **)malloc(FDNORDER*sizeof(ty_fixeddelay *));
-	if(!p->fdndels)
-		return die("GVERB", "out of memory for fixeddelay ptrs");
-	for(i = 0; i < FDNORDER; i++)
-	{
-		p->fdndels[i] = fixeddelay_make((int)p->maxdelay+1000);
-		if(!p->fdndels[i])
-			return die("GVERB", "out of memory for fixeddelays");
-	}
+	p->fdn = new Ofdn(FDNORDER, (int)p->maxdelay+1000);
+	gverb_fdnmatrix(p->fdn);
 	p->fdngains = (float *)malloc(FDNORDER*sizeof(float));
 	p->fdnlens = (int *)malloc(FDNORDER*sizeof(int));
 	if(!p->fdngains || !p->fdnlens)
 		return die("GVERB", "out of memory for delay gains and lengths");
 
-	p->fdndamps = (ty_damper **)malloc(FDNORDER*sizeof(ty_damper *));
-	if(!p->fdndamps)
-		return die("GVERB", "out of memory for delay amps");
-
-	for(i = 0; i < FDNORDER; i++)
-	{
-		p->fdndamps[i] = damper_make(p->fdndamping);
-		if(!p->fdndamps[i])
-			return die("GVERB", "out of memory for delay amps 2");
-	}
-
 	ga = 60.0;
 	gt = p->revtime;
 	ga = pow(10.0,-ga/20.0);
@@ -150,12 +134,6 @@ int GVERB::init(double pfs[], int n_args)
 		p->fdngains[i] = -powf((float)p->alpha,p->fdnlens[i]);
 	}
 
-	p->d = (float *)malloc(FDNORDER*sizeof(float));
-	p->u = (float *)malloc(FDNORDER*sizeof(float));
-	p->f = (float *)malloc(FDNORDER*sizeof(float));
-	if(!p->d || !p->u || !p->f)
-		return die("GVERB", "out of memory for other delay stuff");
-
 
 	/* Diffuser section */
 
@@ -257,6 +235,8 @@ int GVERB::init(double pfs[], int n_args)
 
 	branch = 0;
 
+	sleepWhenSilent(inputframes, (int) (SR * maxroomsize * 0.00294f));
+
 	return nSamps();
 }
 
@@ -320,29 +300,42 @@ void GVERB::doupdate()
 
 int GVERB::run()
 {
-	const int samps = framesToRun() * inputChannels();
-	int i;
+	const int frames = framesToRun();
+	const int inchans = inputChannels();
+	float x[GVERB_CHUNK], yl[GVERB_CHUNK], yr[GVERB_CHUNK];
 	float out[2];
 
-	rtgetin(in, this, samps);
-	
-	for (i = 0; i < samps; i += inputChannels()) {
-		if (--branch <= 0) {
+	rtgetin(in, this, frames * inchans);
+
+	int i = 0;
+	while (i < frames) {
+		if (branch <= 0) {
 			doupdate();
 			branch = getSkip();
 		}
+		int count = frames - i;
+		if (count > branch)
+			count = branch;
+		if (count > GVERB_CHUNK)
+			count = GVERB_CHUNK;
 
-		if (currentFrame() > inputframes) in[i+inputchan] = 0.0;
-		gverb_do(p, in[i+inputchan], out, out+1);
+		const int frame = currentFrame();
+		for (int k = 0; k < count; k++)
+			x[k] = (frame + k > inputframes) ? 0.0f : in[(i + k) * inchans + inputchan];
+		gverb_do(p, x, yl, yr, count);
 
-		out[0] = (out[0] * amp) + (in[i+inputchan] * p->drylevel);
-		out[1] = (out[1] * amp) + (in[i+inputchan] * p->drylevel);
+		for (int k = 0; k < count; k++) {
+			out[0] = (yl[k] * amp) + (x[k] * p->drylevel);
+			out[1] = (yr[k] * amp) + (x[k] * p->drylevel);
 
-		rtaddout(out);
+			rtaddout(out);
 
-		increment();
+			increment();
+		}
+		branch -= count;
+		i += count;
 	}
-	return i;
+	return framesToRun();
 }
 
 Instrument*
@@ -31,6 +31,7 @@
 #include <stdio.h>
 
 #define FDNORDER 4
+#define GVERB_CHUNK 256		// most frames given to gverb_do at once
 
 typedef struct
 {
@@ -46,24 +47,23 @@ typedef struct
 	float revtime;
 	float maxdelay;
 	float largestdelay;
-	ty_fixeddelay **fdndels;
+	Ofdn *fdn;
 	float *fdngains;
 	int *fdnlens;
-	ty_damper **fdndamps; 
 	float fdndamping;
 	ty_diffuser **ldifs;
 	ty_diffuser **rdifs;
 	ty_fixeddelay *tapdelay;
 	int *taps;
 	float *tapgains;
-	float *d;
-	float *u;
-	float *f;
+	float x[GVERB_CHUNK];			// input, cleaned up
+	float u[FDNORDER][GVERB_CHUNK];	// taps, and FDN input
+	float d[FDNORDER][GVERB_CHUNK];	// FDN output
 	double alpha;
 } ty_gverb;
 
 
-static void gverb_do(ty_gverb *, float, float *, float *);
+static void gverb_do(ty_gverb *, const float *, float *, float *, int);
 static void gverb_set_roomsize(ty_gverb *, double);
 static void gverb_set_revtime(ty_gverb *, double);
 static void gverb_set_damping(ty_gverb *, double);
@@ -95,71 +95,89 @@ static void gverb_set_taillevel(ty_gverb *, double);
  * be 0.5, say.
  */
 
-static inline void gverb_fdnmatrix(float *a, float *b)
-{
-  const float dl0 = a[0], dl1 = a[1], dl2 = a[2], dl3 = a[3];
+/*
+ * The lines, their damping and the matrix are an Ofdn.  The matrix was
+ *
+ *   b[0] = 0.5f*(+dl0 + dl1 - dl2 - dl3);
+ *   b[1] = 0.5f*(+dl0 - dl1 - dl2 + dl3);
+ *   b[2] = 0.5f*(-dl0 + dl1 - dl2 + dl3);
+ *   b[3] = 0.5f*(+dl0 + dl1 + dl2 + dl3);
+ *
+ * which is rows 2, 3, 1 (negated) and 0 of the Hadamard matrix.
+ */
 
-  b[0] = 0.5f*(+dl0 + dl1 - dl2 - dl3);
-  b[1] = 0.5f*(+dl0 - dl1 - dl2 + dl3);
-  b[2] = 0.5f*(-dl0 + dl1 - dl2 + dl3);
-  b[3] = 0.5f*(+dl0 + dl1 + dl2 + dl3);
+static inline void gverb_fdnmatrix(Ofdn *fdn)
+{
+	fdn->setFeedback(0, 2, 1.0f);
+	fdn->setFeedback(1, 3, 1.0f);
+	fdn->setFeedback(2, 1, -1.0f);
+	fdn->setFeedback(3, 0, 1.0f);
 }
 
-static inline void gverb_do(ty_gverb *p, float x, float *yl, float *yr)
+// Run <n> frames, up to GVERB_CHUNK, of input <x>.  The input damper, the
+// diffusers and the tapped delay run a frame at a time, and the FDN between
+// them a block at a time.
+
+static inline void gverb_do(ty_gverb *p, const float *x, float *yl, float *yr,
+	int n)
 {
 	float z;
 	unsigned int i;
+	int k;
 	float lsum,rsum,sum,sign;
 
-	if(IS_NAN_FLOAT(x) || IS_DENORM_FLOAT(x) || fabsf(x) > 100000.0f)
+	for(k = 0; k < n; k++)
 	{
-		x = 0.0f;
+		float xk = x[k];
+		if(IS_NAN_FLOAT(xk) || IS_DENORM_FLOAT(xk) || fabsf(xk) > 100000.0f)
+		{
+			xk = 0.0f;
+		}
+		p->x[k] = xk;
+
+		z = damper_do(p->inputdamper, xk);
+
+		z = diffuser_do(p->ldifs[0],z);
+
+		for(i = 0; i < FDNORDER; i++)
+		{
+			p->u[i][k] = p->tapgains[i]*fixeddelay_read(p->tapdelay,p->taps[i]);
+		}
+		fixeddelay_write(p->tapdelay,z);
 	}
 
-	z = damper_do(p->inputdamper, x);
-
-	z = diffuser_do(p->ldifs[0],z);
-
+	const float *u[FDNORDER];
+	float *d[FDNORDER];
 	for(i = 0; i < FDNORDER; i++)
 	{
-		p->u[i] = p->tapgains[i]*fixeddelay_read(p->tapdelay,p->taps[i]);
+		u[i] = p->u[i];
+		d[i] = p->d[i];
 	}
-	fixeddelay_write(p->tapdelay,z);
+	p->fdn->process(u, d, n);
 
-	for(i = 0; i < FDNORDER; i++)
+	for(k = 0; k < n; k++)
 	{
-		p->d[i] = damper_do(p->fdndamps[i],
-							p->fdngains[i]*fixeddelay_read(p->fdndels[i],
-							p->fdnlens[i]));
+		sum = 0.0f;
+		sign = 1.0f;
+		for(i = 0; i < FDNORDER; i++)
+		{
+			sum += sign*(p->taillevel*p->d[i][k] + p->earlylevel*p->u[i][k]);
+			sign = -sign;
+		}
+		sum += p->x[k]*p->earlylevel;
+		lsum = sum;
+		rsum = sum;
+
+		lsum = diffuser_do(p->ldifs[1],lsum);
+		lsum = diffuser_do(p->ldifs[2],lsum);
+		lsum = diffuser_do(p->ldifs[3],lsum);
+		rsum = diffuser_do(p->rdifs[1],rsum);
+		rsum = diffuser_do(p->rdifs[2],rsum);
+		rsum = diffuser_do(p->rdifs[3],rsum);
+
+		yl[k] = lsum;
+		yr[k] = rsum;
 	}
-
-	sum = 0.0f;
-	sign = 1.0f;
-	for(i = 0; i < FDNORDER; i++)
-	{
-		sum += sign*(p->taillevel*p->d[i] + p->earlylevel*p->u[i]);
-		sign = -sign;
-	}
-	sum += x*p->earlylevel;
-	lsum = sum;
-	rsum = sum;
-
-	gverb_fdnmatrix(p->d,p->f);
-
-	for(i = 0; i < FDNORDER; i++)
-	{
-		fixeddelay_write(p->fdndels[i],p->u[i]+p->f[i]);
-	}
-
-	lsum = diffuser_do(p->ldifs[1],lsum);
-	lsum = diffuser_do(p->ldifs[2],lsum);
-	lsum = diffuser_do(p->ldifs[3],lsum);
-	rsum = diffuser_do(p->rdifs[1],rsum);
-	rsum = diffuser_do(p->rdifs[2],rsum);
-	rsum = diffuser_do(p->rdifs[3],rsum);
-
-	*yl = lsum;
-	*yr = rsum;
 }
 
 static inline void gverb_set_roomsize(ty_gverb *p, double a)
@@ -183,6 +201,8 @@ static inline void gverb_set_roomsize(ty_gverb *p, double a)
 	for(i = 0; i < FDNORDER; i++)
 	{
 		p->fdngains[i] = -powf((float)p->alpha, p->fdnlens[i]);
+		p->fdn->setDelay(i, p->fdnlens[i]);
+		p->fdn->setGain(i, p->fdngains[i]);
 	}
 
 	p->taps[0] = 5+ff_round(0.410f*p->largestdelay);
@@ -213,6 +233,7 @@ static inline void gverb_set_revtime(ty_gverb *p, double a)
 	for(i = 0; i < FDNORDER; i++)
 	{
 		p->fdngains[i] = -powf((float)p->alpha, p->fdnlens[i]);
+		p->fdn->setGain(i, p->fdngains[i]);
 	}
 }
 
@@ -223,7 +244,7 @@ static inline void gverb_set_damping(ty_gverb *p, double a)
 	p->fdndamping = CLIP(a, 0.0f, 1.0f);
 	for(i = 0; i < FDNORDER; i++)
 	{
-		damper_set(p->fdndamps[i],p->fdndamping);
+		p->fdn->setDamping(i,p->fdndamping);
 	}
 }
 
@@ -11,10 +11,16 @@
 	p5 = second half wavetable
 	*p6 = wavetable mid-crossover point [0-1]
 	*p7 = pan [optional; default is 0]
+	p8 = oversampling factor (1, 2, 4 or 8) [optional; default is 1]
 
 	* p-fields marked with an asterisk can receive dynamic updates
 	from a table or real-time control source
 
+	Switching from one half-wave to the other makes a corner in the
+	waveform, which aliases at high pitches.  Oversampling makes the
+	waveform at 2, 4 or 8 times the sampling rate and filters it back
+	down, leaving much less of that.
+
 	BGG, 7/2007
 */
 
@@ -28,12 +34,14 @@
 
 HALFWAVE::HALFWAVE() : Instrument()
 {
+	oversamp = NULL;
 }
 
 HALFWAVE::~HALFWAVE()
 {
 	delete theOscils[0];
 	delete theOscils[1];
+	delete oversamp;
 }
 
 int HALFWAVE::init(double p[], int n_args)
@@ -51,13 +59,19 @@ int HALFWAVE::init(double p[], int n_args)
 	else
 		freq = p[2];
 
+	int factor = n_args > 8 ? (int) p[8] : 1;
+	if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+		return die("HALFWAVE", "Oversampling factor must be 1, 2, 4 or 8.");
+	oversamp = new Ooversample(factor);
+	oversr = SR * factor;		// the waveform is made at this rate
+
 	oscwave = (double *) getPFieldTable(4, wavelens);
-	theOscils[0] = new Ooscili(SR, freq*2.0, oscwave, wavelens[0]);
+	theOscils[0] = new Ooscili(oversr, freq*2.0, oscwave, wavelens[0]);
 
 	oscwave = (double *) getPFieldTable(5, wavelens+1);
-	theOscils[1] = new Ooscili(SR, freq*2.0, oscwave, wavelens[1]);
+	theOscils[1] = new Ooscili(oversr, freq*2.0, oscwave, wavelens[1]);
 
-	endpoint = (1.0/freq) * SR;	// number of samps (fractional) in 1 cycle
+	endpoint = (1.0/freq) * oversr;	// number of samps (fractional) in 1 cycle
 	divpoint = endpoint * p[6];
 
 	amp = p[3];
@@ -80,7 +94,7 @@ void HALFWAVE::doupdate()
 		freq = cpspch(p[2]);
 	else
 		freq = p[2];
-	endpoint = (1.0/freq) * SR;	// number of samps (fractional) in 1 cycle
+	endpoint = (1.0/freq) * oversr;	// number of samps (fractional) in 1 cycle
 
 	divpoint = endpoint * p[6];
 	if (divpoint == 0.0) divpoint = 0.0001; // just in case...
@@ -92,11 +106,32 @@ void HALFWAVE::doupdate()
 	spread = p[7];
 }
 
+// One sample of the waveform, at the oversampled rate
+
+inline float HALFWAVE::nextsamp()
+{
+	double pval;
+	float sig = theOscils[oscnum]->next();
+
+	sample_count += 1.0;
+	if (sample_count > endpoint) {
+		oscnum = 0;
+		pval = (sample_count - endpoint)/(double)wavelens[1] * (double)wavelens[0];
+		theOscils[oscnum]->setphase(pval);
+		sample_count = sample_count - endpoint;
+	} else if ( (sample_count > divpoint) && (oscnum == 0) ) {
+		oscnum = 1;
+		pval = (sample_count - divpoint)/(double)wavelens[0] * (double)wavelens[1];
+		theOscils[oscnum]->setphase(pval);
+	}
+	return sig;
+}
+
 int HALFWAVE::run()
 {
 	int i;
 	float out[2];
-	double pval;
+	float buf[Ooversample::kMaxFactor];
 	
 	for (i = 0; i < framesToRun(); i++) {
 		if (--branch <= 0) {
@@ -104,7 +139,9 @@ int HALFWAVE::run()
 			branch = getSkip();
 		}
 
-		out[0] = theOscils[oscnum]->next() * amp;
+		for (int j = 0; j < oversamp->factor(); j++)
+			buf[j] = nextsamp();
+		out[0] = oversamp->down(buf) * amp;
 
 		if (outputChannels() > 1) {
 			out[1] = out[0] * (1.0 - spread);
@@ -113,18 +150,6 @@ int HALFWAVE::run()
 
 		rtaddout(out);
 
-		sample_count += 1.0;
-		if (sample_count > endpoint) {
-			oscnum = 0;
-			pval = (sample_count - endpoint)/(double)wavelens[1] * (double)wavelens[0];
-			theOscils[oscnum]->setphase(pval);
-			sample_count = sample_count - endpoint;
-		} else if ( (sample_count > divpoint) && (oscnum == 0) ) {
-			oscnum = 1;
-			pval = (sample_count - divpoint)/(double)wavelens[0] * (double)wavelens[1];
-			theOscils[oscnum]->setphase(pval);
-		}
-
 		increment();
 	}
 	return i;
@@ -1,12 +1,15 @@
 class HALFWAVE : public Instrument {
 	float amp, spread;
 	Ooscili *theOscils[2];
+	Ooversample *oversamp;
+	float oversr;
 	double divpoint, endpoint, sample_count;
 	int wavelens[2];
 	int oscnum;
 	int branch;
 
 	void doupdate();
+	float nextsamp();
 
 public:
 	HALFWAVE();
@@ -16,6 +16,10 @@
 
 	BGG, 11/2009
 	BGG, 12/2012 -- fixed de-queuing problem, changed to PFBusdata approach
+
+	The draw is stamped with the output frames it covers, so instruments
+	reading the bus (and those de-queued by it) change on the exact frame,
+	not at their next control update.
 */
 
 
@@ -97,7 +101,7 @@ int PFSCHED::init(double p[], int n_args)
 
 	pfbus = p[2];
 
-	if (PFBusData::pfbus_is_connected[pfbus] != 1) {
+	if (!PFBusData::isConnected(pfbus)) {
 		rterror("PFSCHED", "pfbus %d not connected", pfbus);
 		return DONT_SCHEDULE;
 	}
@@ -105,30 +109,25 @@ int PFSCHED::init(double p[], int n_args)
 	if (rtsetoutput(p[0], p[1], this) == -1)
 		return DONT_SCHEDULE;
 
-	PFBusData::dq_now[pfbus] = 0;
-	PFBusData::drawflag[pfbus]  = 0; // prevent reading from the bus for now
 	// NOTE: Casting away const here -- PFields were not intended to be shared.  DAS
-	PFBusData::thepfield[pfbus] = (PField *) &(getPField(3)); // the PField to read
-	if (makedyntable() == DONT_SCHEDULE) {
-		PFBusData::thepfield[pfbus] = NULL;		// D.S. Make sure this is not kept around.
+	PField *pfield = (PField *) &(getPField(3)); // the PField to read
+	if (makedyntable(&pfield) == DONT_SCHEDULE)
 		return DONT_SCHEDULE;
-	}
-	PFBusData::thepfield[pfbus]->ref();
-	PFBusData::dqflag[pfbus]  = p[4];
-	PFBusData::theincr[pfbus] = (SR/(float)resetval)/(double)(nSamps());
-	PFBusData::percent[pfbus] = 0.0;
-	PFBusData::drawflag[pfbus] = 1; // signal to start reading from the pfield
+	// The bus keeps the PField, as readers may still be reading it when
+	// the next PFSCHED on the bus replaces it.
+	pfield->ref();
+	FRAMETYPE startFrame;
+	configureEndSamp(&startFrame);
+	PFBusData::startDraw(pfbus, pfield, startFrame, nSamps(),
+			(SR/(float)resetval)/(double)(nSamps()), (int) p[4] == 1);
 
 	return nSamps();
 }
 
-int PFSCHED::makedyntable()
+int PFSCHED::makedyntable(PField **pfield)
 {
-	double tval = 0.0; // get rid of the compiler warning :-)
-
-	const PField *PF = PFBusData::thepfield[pfbus];
-	if (PF != NULL)
-		tval = PFBusData::val[pfbus];
+	const PField *PF = *pfield;
+	const double tval = PFBusData::value(pfbus);
 
 	// if DYNTABLETOKEN is the first value in the data, it means we need
 	// to construct a new table, based on the current pfield value
@@ -165,13 +164,8 @@ int PFSCHED::makedyntable()
 			return DONT_SCHEDULE;            // error message already given
 		}
 
-		TablePField *table;
-		table = new TablePField(data, len);
-
 		// replace the pfield with the newly-constructed table
-		RefCounted::unref(PFBusData::thepfield[pfbus]);
-		PFBusData::thepfield[pfbus] = table;
-		table->ref();
+		*pfield = new TablePField(data, len);
 	}
 
 	return(1);
@@ -1,7 +1,7 @@
 class PFSCHED : public Instrument {
 	int pfbus;
 
-	int makedyntable();
+	int makedyntable(PField **pfield);
 	void doupdate();
 
 public:
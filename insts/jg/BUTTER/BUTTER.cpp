@@ -203,6 +203,8 @@ int BUTTER :: init(double p[], int n_args)
 
    skip = (int) (SR / (float) resetval);
 
+   setPlanarOutput();      // we write a channel at a time
+
    return nSamps();
 }
 
@@ -263,19 +265,18 @@ void BUTTER :: doupdate()
       }
    }
 
+   // The stages are identical, so only the first works out its setting.
    if (setfilt) {
       if (type == LowPass)
-         for (int j = 0; j < nfilts; j++)
-            filt[j]->setLowPass(cf);
+         filt[0]->setLowPass(cf);
       else if (type == HighPass)
-         for (int j = 0; j < nfilts; j++)
-            filt[j]->setHighPass(cf);
+         filt[0]->setHighPass(cf);
       else if (type == BandPass)
-         for (int j = 0; j < nfilts; j++)
-            filt[j]->setBandPass(cf, bw);
+         filt[0]->setBandPass(cf, bw);
       else // type == BandReject
-         for (int j = 0; j < nfilts; j++)
-            filt[j]->setBandReject(cf, bw);
+         filt[0]->setBandReject(cf, bw);
+      for (int j = 1; j < nfilts; j++)
+         filt[j]->copyCoeffs(*filt[0]);
    }
 
    if (nargs > 13)
@@ -285,47 +286,79 @@ void BUTTER :: doupdate()
 
 int BUTTER :: configure()
 {
+   if (readsInputInPlace())
+      return 0;
    in = new float [RTBUFSAMPS * inputChannels()];
    return in ? 0 : -1;
 }
 
 
+// The filter cascade runs a block of samples at a time, up to the next
+// control update (<branch> counts the frames until then).
+
+#define BUTTER_CHUNK 256
+
 int BUTTER :: run()
 {
-   int samps = framesToRun() * inputChannels();
+   const int nframes = framesToRun();
+   const int inchans = inputChannels();
 
+   // Read our one input channel where it is, rather than having it copied.
+   InputChannel chans[MAXBUS];
    if (currentFrame() < insamps)
-      rtgetin(in, this, samps);
+      rtgetinchans(chans, in, nframes * inchans);
+   const InputChannel &inp = chans[inchan];
 
-   for (int i = 0; i < samps; i += inputChannels()) {
-      if (--branch <= 0) {
+   float insig[BUTTER_CHUNK], sig[BUTTER_CHUNK];
+   int i = 0;
+   while (i < nframes) {
+      if (branch <= 0) {
          doupdate();
          branch = skip;
       }
+      int count = nframes - i;
+      if (count > branch)
+         count = branch > 0 ? branch : 1;
+      if (count > BUTTER_CHUNK)
+         count = BUTTER_CHUNK;
+
+      for (int j = 0; j < count; j++) {
+         if (currentFrame() + j < insamps)
+            insig[j] = inp.samps[(i + j) * inp.stride] * inamp;
+         else
+            insig[j] = 0.0;
+      }
 
-      float insig;
-      if (currentFrame() < insamps)
-         insig = in[i + inchan] * inamp;
-      else
-         insig = 0.0;
-
-      float out[2];
-      out[0] = insig;
-      if (!bypass) {
-         for (int j = 0; j < nfilts; j++)
-            out[0] = filt[j]->tick(out[0]);
+      if (bypass) {
+         for (int j = 0; j < count; j++)
+            sig[j] = insig[j];
+      }
+      else {
+         Butter::tickCascade(filt, nfilts, insig, sig, count);
          if (do_balance)
-            out[0] = balancer->tick(out[0], insig);
+            for (int j = 0; j < count; j++)
+               sig[j] = balancer->tick(sig[j], insig[j]);
       }
-		out[0] *= outamp;
 
+      int stride;
+      BUFTYPE *left = outputChannel(0, &stride);
       if (outputChannels() == 2) {
-         out[1] = out[0] * (1.0 - pctleft);
-         out[0] *= pctleft;
+         BUFTYPE *right = outputChannel(1, &stride);
+         const float leftamp = outamp * pctleft;
+         const float rightamp = outamp * (1.0 - pctleft);
+         for (int j = 0; j < count; j++) {
+            left[j * stride] = sig[j] * leftamp;
+            right[j * stride] = sig[j] * rightamp;
+         }
       }
-
-      rtaddout(out);
-      increment();
+      else {
+         for (int j = 0; j < count; j++)
+            left[j * stride] = sig[j] * outamp;
+      }
+      advanceOutput(count);
+      increment(count);
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
@@ -13,7 +13,7 @@
     * p7  = threshold (in dBFS)
     * p8  = compression ratio - e.g. 20 means 20:1 (100 is infinity)
       p9  = look-ahead time (seconds)
-      p10 = peak detection window size (power of 2 <= RTCmix output buffer size)
+      p10 = detection window size, for types 1 and 2 (<= RTcmix buffer size)
     * p11 = detection type (0: peak, 1: average peak, 2: rms)
             [optional; default is 0)
     * p12 = bypass (1: bypass on, 0: bypass off) [optional; default is 0]
@@ -26,9 +26,10 @@
       scales the makeup gain (p4), after conversion from dB to linear amp.
       When bypass (p12) is on, there is no enveloping at all in this version.
 
-   2. BUG: Sometimes the compressor will stay in sustain for too long.  This
-      happens when the source sound has a long decaying envelope during which
-      some of the decay is above the threshold.
+   2. The output is delayed by the look-ahead time.  When the attack is no
+      longer than that, the limiter has always finished coming down by the
+      time a peak reaches the output, so nothing gets past the threshold.
+      Attacks are limited to one second.
 
 
    John Gibson <johgibso at indiana dot edu>, 4/21/00; rev. for v4, 6/18/05
@@ -39,52 +40,35 @@
 #include <float.h>       // DBL_MAX
 #include <ugens.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "COMPLIMIT.h"
 #include <rt.h>
 #include <rtdefs.h>
-#include <assert.h>
-
-//#define DEBUG
-//#define DEBUG2
-
-#ifdef DEBUG
-   #define DPRINT(msg)        printf((msg))
-   #define DPRINT1(msg, arg)  printf((msg), (arg))
-#else
-   #define DPRINT(msg)
-   #define DPRINT1(msg, arg)
-#endif
-
-// experiment to relieve symptom of bug described in comment above
-// (major problem for pnoEb2stop.tm2.aif)
-#define LONG_SUSTAIN_FIX
-#define MAX_WINS 5        // just a guess
 
 #define DEFAULT_WINDOW_SIZE   128
+#define MAX_ATTACK            1.0     // seconds
 
 
 COMPLIMIT::COMPLIMIT() : Instrument()
 {
    in = NULL;
-   first_time = true;
-   env_state = ENV_INACTIVE;
-   env_count = -1;
-   sus_count = 0;
-   gain = 0.0;
+   sig = NULL;
+   limiter = NULL;
    ingain = -DBL_MAX;
    outgain = -DBL_MAX;
    threshold_dbfs = -DBL_MAX;
    atk_time = -DBL_MAX;
    rel_time = -DBL_MAX;
-   target_peak = 0.0;
-   next_target_gain = 0.0;
-   wins_under_thresh = 0;
+   ratio = -DBL_MAX;
+   detect_type = -DBL_MAX;
    branch = 0;
 }
 
 COMPLIMIT::~COMPLIMIT()
 {
    delete [] in;
+   delete [] sig;
+   delete limiter;
 }
 
 int COMPLIMIT::usage()
@@ -96,26 +80,21 @@ int COMPLIMIT::usage()
 
 inline int min(int a, int b) { return (a < b) ? a : b; }
 
-DetectType COMPLIMIT::getDetectType(double pval)
+int COMPLIMIT::getDetectType(double pval)
 {
    int intval = int(pval);
-   DetectType type = PEAK_DETECTOR;
 
    switch (intval) {
       case 0:
-         type = PEAK_DETECTOR;
-         break;
+         return Olimiter::kPeak;
       case 1:
-         type = AVERAGE_DETECTOR;
-         break;
+         return Olimiter::kAverage;
       case 2:
-         type = RMS_DETECTOR;
-         break;
+         return Olimiter::kRMS;
       default:
-         die("COMPLIMIT", "Invalid detector type %d\n.", intval);
          break;
    }
-   return type;
+   return die("COMPLIMIT", "Invalid detector type %d\n.", intval);
 }
 
 int COMPLIMIT::init(double p[], int n_args)
@@ -141,7 +120,8 @@ int COMPLIMIT::init(double p[], int n_args)
       return die("COMPLIMIT", "Can't use more than 2 output channels.");
 
    const float lookahead_time = p[9];
-   lookahead_samps = int(lookahead_time * SR + 0.5);
+   if (lookahead_time < 0.0)
+      return die("COMPLIMIT", "Look-ahead time must be zero or greater.");
 
    dbref = dbamp(32768.0);
    // Verify initial value of threshold, in dbFS.
@@ -149,11 +129,8 @@ int COMPLIMIT::init(double p[], int n_args)
       return die("COMPLIMIT", "Threshold must be between %.2f and 0.", -dbref);
 
    // Verify initial value of ratio.
-   ratio = p[8];
-   if (ratio < 1.0)
+   if (p[8] < 1.0)
       return die("COMPLIMIT", "Compression ratio must be 1 or greater.");
-   if (ratio >= 100.0)
-      ratio = DBL_MAX;
 
    window_frames = int(p[10]);
    if (window_frames == 0) {
@@ -165,11 +142,13 @@ int COMPLIMIT::init(double p[], int n_args)
                         "(currently %d frames).  Correcting...", RTBUFSAMPS);
       window_frames = RTBUFSAMPS;
    }
-   else if (RTBUFSAMPS % window_frames)
-      return die("COMPLIMIT", "RTcmix buffer size must be a multiple of the "
-                              "COMPLIMIT window size.");
+   else if (window_frames < 0)
+      return die("COMPLIMIT", "Window size must be zero or greater.");
 
-   detector_type = getDetectType(p[11]);
+   if (getDetectType(p[11]) < 0)
+      return DONT_SCHEDULE;
+
+   limiter = new Olimiter(SR, 1, lookahead_time, MAX_ATTACK);
 
    // for backward compatibility with pre-v4 scores
    amptable = floc(1);
@@ -178,100 +157,15 @@ int COMPLIMIT::init(double p[], int n_args)
       tableset(SR, dur, amplen, amptabs);
    }
 
-#ifdef DEBUG
-   printf("lookahead_samps: %d, window_frames: %d\n",
-          lookahead_samps, window_frames);
-#endif
-
    return nSamps();
 }
 
 
-/* Return the peak of a segment of the input buffer. The segment starts at
-   <offset> samples (not frames) and contains <window_len> frames worth. The
-   peak detection method is either absolute peak, average peak or RMS.
-   If detecting absolute peak, pass back the *frame* offset of the first
-   sample that exceeds the threshold, relative to <offset>. Note that this
-   sample may not be the peak for the window. If detecting peak by either of
-   the two averaging methods, pass pack zero.
-*/
-inline float COMPLIMIT::get_peak(int offset, int *over_thresh_offset)
-{
-   float pk = 0.0;
-#ifdef DEBUG
-   float over = 0.0;
-#endif
-
-   const int inchans = inputChannels();
-   const int endsamp = offset + (window_len * inchans);
-
-   *over_thresh_offset = 0;
-
-   if (detector_type == PEAK_DETECTOR) {
-      int loc = -1;
-      for (int i = offset; i < endsamp; i += inchans) {
-         float samp = in[i + inchan];
-         if (samp < 0.0)
-            samp = -samp;
-         if (loc == -1 && samp > threshold_amp) {
-            loc = i - offset;
-#ifdef DEBUG
-            over = samp;
-#endif
-         }
-         if (samp > pk)
-            pk = samp;
-      }
-      *over_thresh_offset = loc / inchans;
-   }
-   else if (detector_type == AVERAGE_DETECTOR) {
-      double dpk = 0.0;
-      for (int i = offset; i < endsamp; i += inchans) {
-         double samp = in[i + inchan];
-         if (samp < 0.0)
-            samp = -samp;
-         dpk += samp;
-      }
-      pk = dpk / window_len;
-   }
-   else {  // detector_type == RMS_DETECTOR
-      double dpk = 0.0;
-      for (int i = offset; i < endsamp; i += inchans) {
-         double samp = in[i + inchan];
-         dpk += samp * samp;
-      }
-      pk = sqrt(dpk / window_len);
-   }
-
-#ifdef DEBUG2
-   printf("\npeak: %g, over: %g, over_thresh_offset: %d, firstsamp: %d, "
-          "window_len: %d, offset: %d\n", pk, over, *over_thresh_offset,
-                         currentFrame() + lookahead_samps, window_len, offset);
-#endif
-
-   return pk;
-}
-
-
-inline float COMPLIMIT::get_gain_reduction()
-{
-   const double peak_db = dbamp(target_peak);
-   const double diff = peak_db - threshold_db;
-   const double level_db = threshold_db + (diff / ratio);
-   const float gain_reduction = float(level_db - peak_db);
-
-#ifdef DEBUG
-   printf("get_gain_reduction(): target=%g, thresh=%g dB, level=%g dB, "
-         "reduction=%g\n", target_peak, threshold_db, level_db, gain_reduction);
-#endif
-
-   return gain_reduction;
-}
-
-
 int COMPLIMIT::configure()
 {
-   return 0;
+   in = new float [RTBUFSAMPS * inputChannels()];
+   sig = new float [RTBUFSAMPS];
+   return (in && sig) ? 0 : -1;
 }
 
 
@@ -294,11 +188,11 @@ void COMPLIMIT::doupdate()
 
    if (atk_time != p[5]) {
       atk_time = p[5];
-      atk_samps = (atk_time < 0.0) ? 0 : int(atk_time * SR + 0.5);
+      limiter->setattack((atk_time < 0.0) ? 0.0 : atk_time);
    }
    if (rel_time != p[6]) {
       rel_time = p[6];
-      rel_samps = (rel_time < 0.0) ? 0 : int(rel_time * SR + 0.5);
+      limiter->setrelease((rel_time < 0.0) ? 0.0 : rel_time);
    }
 
    if (threshold_dbfs != p[7]) {
@@ -307,28 +201,25 @@ void COMPLIMIT::doupdate()
          threshold_dbfs = -dbref;
       else if (threshold_dbfs > 0.0)
          threshold_dbfs = 0;
-      // pre-calculate for get_gain_reduction()...
-      threshold_db = threshold_dbfs + dbref;
-      threshold_amp = ampdb(threshold_db);
+      limiter->setthreshold(ampdb(threshold_dbfs + dbref));
    }
 
-   ratio = p[8];
-   if (ratio < 1.0)
-      ratio = 1.0;
-   else if (ratio >= 100.0)
-      ratio = DBL_MAX;
+   if (ratio != p[8]) {
+      ratio = p[8];
+      limiter->setratio(ratio);
+   }
 
-   detector_type = getDetectType(p[11]);
+   if (detect_type != p[11]) {
+      detect_type = p[11];
+      const int type = getDetectType(detect_type);
+      if (type >= 0)
+         limiter->setdetector(Olimiter::Detector(type), window_frames);
+   }
 
    bypass = bool(p[12]);
+   limiter->setbypass(bypass);
    inchan = int(p[13]);
    pan = (nargs > 14) ? p[14] : 0.5f;
-
-#ifdef DEBUG
-   printf("inamp: %g, outamp: %g, threshold: %g (amp), ratio: %g:1, "
-          "atk_samps: %d, rel_samps: %d\n",
-          inamp, outamp, threshold_amp, ratio, atk_samps, rel_samps);
-#endif
 }
 
 
@@ -336,251 +227,42 @@ int COMPLIMIT::run()
 {
    const int nframes = framesToRun();
    const int inchans = inputChannels();
-   const int samps = nframes * inchans;
-
-   if (first_time) {
-      int nbufs = (lookahead_samps / RTBUFSAMPS) + 2;
-      int extrasamps = RTBUFSAMPS - nframes;
-      if (extrasamps)
-         nbufs++;
-      buf_samps = nbufs * RTBUFSAMPS * inchans;
-      in = new float [buf_samps];
-      for (int i = 0; i < buf_samps; i++)
-         in[i] = 0.0;
-
-      // Note: input ptr chases read ptr by lookahead_samps
-      inptr = in + (buf_samps - (lookahead_samps * inchans));
-      bufstartptr = in + (extrasamps * inchans);
-      readptr = bufstartptr;
-
-      offset = extrasamps * inchans;
-      window_len = nframes % window_frames;
-      if (window_len == 0)
-         window_len = window_frames;
-   }
-
-   float *bufendptr = in + buf_samps;
-
-   int win_end_count = window_len - 1;
-   int win_count = 0;                  // trigger first look-ahead
 
-#ifdef DEBUG
-   printf("\nin=%p, inptr=%p, readptr=%p, bufstartptr=%p, bufendptr=%p\n",
-                                 in, inptr, readptr, bufstartptr, bufendptr);
-#endif
-   rtgetin(readptr, this, samps);
-
-   int over_thresh_offset = 0;
+   rtgetin(in, this, nframes * inchans);
 
-   for (int i = 0; i < nframes; i++) {
-      if (--branch <= 0) {
+   for (int i = 0; i < nframes; ) {
+      if (branch <= 0) {
          doupdate();
          branch = getSkip();
       }
-
-      if (win_count == 0) {
-         float peak = get_peak(offset, &over_thresh_offset);
-
-         if (peak > threshold_amp) {
-            DPRINT1("current increment: %f\n", gain_increment);
-            switch (env_state) {
-               case ENV_INACTIVE:
-                  target_peak = peak;
-                  target_gain = get_gain_reduction();
-                  gain_increment = target_gain / float(atk_samps);
-                  gain = 0.0;                   // in dB
-                  env_count = atk_samps;
-                  sus_count = window_len - (over_thresh_offset + 1);
-                  env_state = ENV_ATTACK_WAIT;
-                  break;
-               case ENV_ATTACK:
-                  if (peak > target_peak) {      // re-start attack
-                     target_peak = peak;
-                     float tmpgain = get_gain_reduction();
-                     float tmpincr = (tmpgain - gain)
-                                    / float(atk_samps + over_thresh_offset);
-                     if (next_target_gain) {    // new gain already pending
-                        next_target_gain = 0;   // override it
-                        DPRINT("W ATTACK: OVERRIDE PENDING GAIN...\n");
-                     }
-                     if (tmpincr < gain_increment) {   // NB: both negative
-                        target_gain = tmpgain;
-                        gain_increment = tmpincr;
-                        env_count = atk_samps + over_thresh_offset;
-                        sus_count = window_len - (over_thresh_offset + 1);
-                        DPRINT("W ATTACK: RESTART ATTACK\n");
-                     }
-                     else {
-                        // delay new ramp until current target_gain reached
-                        next_target_gain = tmpgain;
-                        next_env_count = (atk_samps + over_thresh_offset)
-                                                                   - env_count;
-                        DPRINT("W ATTACK: NEW GAIN PENDING...\n");
-                     }
-                  }
-                  else                          // stay in sustain for longer
-                     sus_count += window_len * (wins_under_thresh + 1);
-                  break;
-               case ENV_SUSTAIN:
-                  if (peak > target_peak) {     // re-start attack
-                     target_peak = peak;
-                     target_gain = get_gain_reduction();
-                     gain_increment = (target_gain - gain)
-                                    / float(atk_samps + over_thresh_offset);
-                     env_count = atk_samps + over_thresh_offset;
-                     sus_count = window_len - (over_thresh_offset + 1);
-                     env_state = ENV_ATTACK;
-                     DPRINT("W SUSTAIN -> RESTART ATTACK\n");
-                  }
-                  else {                        // stay in sustain for longer
-#ifdef LONG_SUSTAIN_FIX
-                     if (wins_under_thresh < MAX_WINS)
-                        sus_count += window_len * (wins_under_thresh + 1);
-#else
-                     sus_count += window_len * (wins_under_thresh + 1);
-#endif
-                  }
-                  break;
-               case ENV_RELEASE:
-                  target_peak = peak;
-                  target_gain = get_gain_reduction();
-                  gain_increment = (target_gain - gain)
-                                    / float(atk_samps + over_thresh_offset);
-                  env_count = atk_samps + over_thresh_offset;
-                  sus_count = window_len - (over_thresh_offset + 1);
-                  env_state = ENV_ATTACK;
-                  break;
-               case ENV_ATTACK_WAIT:            // should never get here
-                  assert(env_state != ENV_ATTACK_WAIT);
-                  break;
-            }
-            DPRINT1("new increment: %f\n", gain_increment);
-            wins_under_thresh = 0;
-         }  // if (peak > threshold_amp)
-         else
-            wins_under_thresh++;
-
-         offset += window_len * inchans;
-         if (offset >= buf_samps)
-            offset = 0;
-         if (window_len != window_frames) {     // after first window
-            window_len = window_frames;
-            win_count = win_end_count;
-            win_end_count = window_len - 1;
+      const int frames = min(branch, nframes - i);
+
+      // In bypass, the limiter only delays the input.
+      const float gain = bypass ? 1.0f : inamp;
+      const float *inp = &in[i * inchans + inchan];
+      for (int j = 0; j < frames; j++, inp += inchans)
+         sig[j] = *inp * gain;
+
+      float *bufs[1] = { sig };
+      limiter->process(bufs, frames);
+
+      const float amp = bypass ? 1.0f : outamp;
+      for (int j = 0; j < frames; j++) {
+         const float outsig = sig[j] * amp;
+         float out[2];
+         if (outputChannels() == 2) {
+            out[0] = outsig * pan;
+            out[1] = outsig * (1.0f - pan);
          }
          else
-            win_count = win_end_count;
-#ifdef DEBUG2
-         printf("sus_count=%d, wins_under_thresh=%d\n",
-                                                sus_count, wins_under_thresh);
-#endif
-      }
-      else
-         win_count--;
-
-      if (env_state == ENV_ATTACK_WAIT) {
-         if (over_thresh_offset == 0)
-            env_state = ENV_ATTACK;  // timer elapsed; start attack this samp
-         else
-            over_thresh_offset--;
-      }
+            out[0] = outsig;
 
-      float sig = inptr[inchan] * inamp;
-
-      if (env_state == ENV_ATTACK) {
-         const double scale = ampdb(gain);
-#ifdef DEBUG2
-         printf("attack:   cursamp=%d, envcount=%d, insig=% f, gain=%f, sc=%f",
-                                 currentFrame(), env_count, sig, gain, scale);
-#endif
-         sig *= scale;
-
-         if (env_count == 0) {
-            if (next_target_gain) {
-               gain = target_gain;
-               target_gain = next_target_gain;
-               next_target_gain = 0;
-               env_count = next_env_count - 1;
-               gain_increment = (target_gain - gain) / float(env_count);
-            }
-            else {
-               gain = target_gain;
-               env_state = ENV_SUSTAIN;
-            }
-         }
-         else {
-            gain += gain_increment;
-            env_count--;
-         }
-      }
-      else if (env_state == ENV_SUSTAIN) {
-         // not efficient to keep converting from the same gain, but...
-         double scale = ampdb(gain);
-#ifdef DEBUG2
-         printf("sustain:  cursamp=%d, envcount=%d, insig=% f, gain=%f, sc=%f",
-                                 currentFrame(), env_count, sig, gain, scale);
-#endif
-         sig *= scale;
-
-         if (sus_count == 0) {
-            gain_increment = gain / float(rel_samps);
-            env_count = rel_samps;
-            env_state = ENV_RELEASE;
-         }
-         else
-            sus_count--;
-      }
-      else if (env_state == ENV_RELEASE) {
-         double scale = ampdb(gain);
-#ifdef DEBUG2
-         printf("release:  cursamp=%d, envcount=%d, insig=% f, gain=%f, sc=%f",
-                                 currentFrame(), env_count, sig, gain, scale);
-#endif
-         sig *= scale;
-         gain -= gain_increment;
-
-         if (env_count == 0) {
-            env_count = -1;
-            env_state = ENV_INACTIVE;
-         }
-         else
-            env_count--;
-      }
-#ifdef DEBUG2
-      if (env_state != ENV_INACTIVE)
-         printf(", outsig=% f\n", sig);
-      if (fabs(sig) > threshold_amp)
-         printf("OUTPUT EXCEEDS THRESHOLD! (%f, %f)\n", sig, threshold_amp);
-#endif
-      sig *= outamp;
-
-      if (bypass)
-         sig = inptr[inchan];
-
-      float out[2];
-      if (outputChannels() == 2) {
-         out[0] = sig * pan;
-         out[1] = sig * (1.0f - pan);
-      }
-      else
-         out[0] = sig;
-
-      rtaddout(out);
-      increment();
-
-      inptr += inchans;
-      if (inptr >= bufendptr) {
-         inptr = bufstartptr;
-         bufstartptr = in;
-         DPRINT1("    resetting inptr=%p\n", inptr);
+         rtaddout(out);
+         increment();
       }
+      i += frames;
+      branch -= frames;
    }
-   readptr += samps;
-   if (readptr >= bufendptr)
-      readptr = in;
-
-   if (first_time)
-      first_time = false;
 
    return nframes;
 }
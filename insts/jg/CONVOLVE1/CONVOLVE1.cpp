@@ -17,30 +17,27 @@
    p3 (amplitude), p9 (wet percent) and p11 (pan) can receive dynamic updates
    from a table or real-time control source.
 
-   This instrument is designed for short impulse responses: a maximum of about
-   6 seconds at 44.1kHz sampling rate, though a few hundred milliseconds is more
-   typical.  The impulse response duration determines the FFT size: the longer
-   the response, the larger the FFT size, and therefore the more transient
-   smearing.  Only one FFT of the impulse response is taken.  The FFT size of
-   the input equals that of the impulse response, and there is a delay before
-   the start of sound approximately equal to the impulse response duration.
-   (Actually, the delay in frames is the smallest power of two that is greater
-   than the impulse response length.)
-
-   With this in mind, the best strategy for using the instrument is to loop with
-   very short notes, while creeping through both the input and the impulse
-   response.  See the example scores.
-
-   NOTE: This instrument can work with very small buffer sizes (e.g., 32), but
-   it probably will cause audio buffer underruns if the impulse response is
-   longer than about 20 milliseconds.
+   The impulse response can be up to about 6 seconds long at 44.1kHz sampling
+   rate.  It is cut into partitions the size of the audio buffer (rounded up
+   to a power of two), so the delay before the start of sound is one buffer,
+   however long the response.  The cost of each buffer grows with the number
+   of partitions, i.e., with the impulse response duration divided by the
+   buffer size.
+
+   The window function, if given, is applied to the impulse response, and to
+   the input in successive segments of the impulse response duration.  One
+   good strategy for using the instrument is to loop with very short notes,
+   while creeping through both the input and the impulse response.  See the
+   example scores.
 
    John Gibson, 5/31/05 (based on cmix convolve)
 */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
 #include <ugens.h>
 #include <Ougens.h>
 #include <PField.h>
@@ -62,6 +59,7 @@
 
 const int kMinFFTsize = 256;
 const int kMaxImpulseFrames = 262144;	// 2^18: about 6 seconds at 44100
+const int kMinBlockLen = 64;			// smallest convolution partition
 
 inline int imax(int x, int y) { return x > y ? x : y; }
 inline int imin(int x, int y) { return x < y ? x : y; }
@@ -78,12 +76,12 @@ inline float clamp(float low, float val, float high)
 
 CONVOLVE1::CONVOLVE1()
 	: _branch(0),
+	  _winframe(0),
 	  _inbuf(NULL),      // buffer to read (possibly multichannel) input
-	  _imp(NULL),        // buffer holding impulse response spectrum
-	  _ovadd(NULL),      // buffer for overlap-adding fft output
-	  _dry(NULL),        // dry signal for output
-	  _wet(NULL),        // wet signal for output
-	  _bucket(NULL),     // input bucket
+	  _block(NULL),      // windowed input block for the convolver
+	  _outbuf(NULL),     // wet and dry signals for output
+	  _reblock(NULL),    // input and output blocks for the convolver
+	  _convolver(NULL),  // partitioned convolution engine
 	  _winosc(NULL)      // window function table oscillator
 {
 }
@@ -91,13 +89,11 @@ CONVOLVE1::CONVOLVE1()
 CONVOLVE1::~CONVOLVE1()
 {
 	delete [] _inbuf;
-	delete [] _imp;
-	delete [] _ovadd;
-	delete [] _dry;
-	delete [] _wet;
+	delete [] _block;
+	delete [] _outbuf;
 	delete _winosc;
-	delete _bucket;
-	delete _fft;
+	delete _reblock;
+	delete _convolver;
 }
 
 int CONVOLVE1::init(double p[], int n_args)
@@ -126,15 +122,23 @@ int CONVOLVE1::init(double p[], int n_args)
 	// NOTE: <impend> may be past end of table; we handle that in prepareImpulse.
 	DPRINT2("impend=%d, _imptablen=%d\n", impend, _imptablen);
 	_impframes = impend - _impStartIndex;
+	if (_impframes > kMaxImpulseFrames)
+		return die("CONVOLVE1", "Impulse duration must be no more than %d frames.",
+										kMaxImpulseFrames);
 
 	_halfFFTlen = kMinFFTsize / 2;
-	for ( ; _halfFFTlen < kMaxImpulseFrames; _halfFFTlen *= 2)
-		if (_halfFFTlen >= _impframes)
-			break;
+	while (_halfFFTlen < _impframes)
+		_halfFFTlen *= 2;
 	_fftlen = 2 * _halfFFTlen;
 	DPRINT2("_impframes=%d, _halfFFTlen=%d\n", _impframes, _halfFFTlen);
-	rtcmix_advise("CONVOLVE1", "Using %d impulse response frames.  FFT length is %d.",
-				_impframes, _fftlen);
+
+	// Partition size: the buffer size, as a power of two, but no bigger than
+	// needed to hold the whole impulse response.
+	_blocklen = kMinBlockLen;
+	while (_blocklen < RTBUFSAMPS && _blocklen < _halfFFTlen)
+		_blocklen *= 2;
+	rtcmix_advise("CONVOLVE1", "Using %d impulse response frames in %d partitions of %d.",
+				_impframes, (_impframes + _blocklen - 1) / _blocklen, _blocklen);
 
 	if (rtsetinput(inskip, this) == -1)
 		return DONT_SCHEDULE;	// no input
@@ -142,11 +146,12 @@ int CONVOLVE1::init(double p[], int n_args)
 		return die("CONVOLVE1", "You asked for channel %d of a %d-channel input.",
 										_inchan, inputChannels());
 
-	// Latency is the delay before the FFT looks at actual input rather than
-	// zero-padding.  Need to let inst run long enough to compensate for this.
+	// Latency is the delay while the first block of input is collected.
+	// Need to let inst run long enough to compensate for this, and for the
+	// impulse response to ring out.
 
-	const float latency = float(_impframes) / SR;
-	const float ringdur = latency;
+	const float latency = float(_blocklen) / SR;
+	const float ringdur = float(_impframes) / SR;
 	if (rtsetoutput(outskip, latency + indur + ringdur, this) == -1)
 		return DONT_SCHEDULE;
 	if (outputChannels() > 2)
@@ -166,44 +171,150 @@ int CONVOLVE1::init(double p[], int n_args)
 }
 
 
+// Scores often play many notes with the same impulse response, so the
+// partition spectra made for one are kept for others.  An entry matches a
+// note whose windowed impulse response has the same samples, and whose gain
+// and partition size are the same.  Comparing the samples, rather than the
+// table and the arguments that select from it, means a freed table whose
+// memory is reused can never be mistaken for the one cached.  Notes hold
+// their own references, so replacing an entry does not affect them.
+
+#define IMPULSE_CACHE_SLOTS 8
+
+struct CachedImpulse {
+	unsigned long hash;
+	int frames, blocklen;
+	float gain;
+	float *samples;		// windowed, not yet normalized
+	Oconvolve::Impulse *impulse;
+};
+
+static CachedImpulse sImpulseCache[IMPULSE_CACHE_SLOTS];
+static int sNextImpulseSlot = 0;
+static pthread_mutex_t sImpulseCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned long hashSamples(const float *samples, int len)
+{
+	const unsigned char *bytes = (const unsigned char *) samples;
+	const int nbytes = len * sizeof(float);
+	unsigned long hash = 2166136261UL;
+	for (int i = 0; i < nbytes; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+// Return the cached spectra matching these, with a reference added for the
+// caller, or NULL.
+
+static Oconvolve::Impulse *findImpulse(unsigned long hash, const float *samples,
+									   int frames, int blocklen, float gain)
+{
+	Oconvolve::Impulse *impulse = NULL;
+	pthread_mutex_lock(&sImpulseCacheLock);
+	for (int slot = 0; slot < IMPULSE_CACHE_SLOTS; slot++) {
+		const CachedImpulse &cached = sImpulseCache[slot];
+		if (cached.impulse != NULL && cached.hash == hash
+				&& cached.frames == frames && cached.blocklen == blocklen
+				&& cached.gain == gain
+				&& memcmp(cached.samples, samples, frames * sizeof(float)) == 0) {
+			impulse = cached.impulse;
+			impulse->ref();
+			break;
+		}
+	}
+	pthread_mutex_unlock(&sImpulseCacheLock);
+	return impulse;
+}
+
+static void cacheImpulse(unsigned long hash, const float *samples, int frames,
+						 int blocklen, float gain, Oconvolve::Impulse *impulse)
+{
+	float *copy = new float [frames];
+	memcpy(copy, samples, frames * sizeof(float));
+	pthread_mutex_lock(&sImpulseCacheLock);
+	CachedImpulse &cached = sImpulseCache[sNextImpulseSlot];
+	if (cached.impulse != NULL) {
+		cached.impulse->unref();
+		delete [] cached.samples;
+	}
+	cached.hash = hash;
+	cached.frames = frames;
+	cached.blocklen = blocklen;
+	cached.gain = gain;
+	cached.samples = copy;
+	cached.impulse = impulse;
+	impulse->ref();
+	sNextImpulseSlot = (sNextImpulseSlot + 1) % IMPULSE_CACHE_SLOTS;
+	pthread_mutex_unlock(&sImpulseCacheLock);
+}
+
+
+// The spectrum of the whole impulse response is taken once, to normalize its
+// peak to <_impgain>, as it was when one FFT covered the whole response; the
+// convolution itself is done by partitions.  Neither is needed if an earlier
+// note made the same partitions.
+
 int CONVOLVE1::prepareImpulse()
 {
-	// copy and window impulse response; zero-pad to fft length
-	const int end = imin(_imptablen, _impframes);
+	// copy and window impulse response
+	const int end = imin(_imptablen - _impStartIndex, _impframes);
+	float *impulse = new float [end];
 	if (_winosc) {
 		for (int i = 0, j = _impStartIndex; i < end; i++, j++)
-			_fftbuf[i] = _imptab[j] * _winosc->next(i);
+			impulse[i] = _imptab[j] * _winosc->next(i);
 	}
 	else
 		for (int i = 0, j = _impStartIndex; i < end; i++, j++)
-			_fftbuf[i] = _imptab[j];
-	for (int i = end; i < _fftlen; i++)
-		_fftbuf[i] = 0.0f;
-
-	_fft->r2c();	// take FFT
-
-	// normalize spectrum
-	double max = 0.0;
-	for (int i = 0; i < _halfFFTlen; i++) {
-		int index = i << 1;
-		float a = _fftbuf[index];
-		float b = _fftbuf[index + 1];
-		double c2 = (a * a) + (b * b);
-		if (c2 > max)
-			max = c2;
-	}
-	if (max != 0.0)
-		max = _impgain / sqrt(max);
-	else
-		return die("CONVOLVE1", "Impulse response is all zeros.");
+			impulse[i] = _imptab[j];
+
+	const unsigned long hash = hashSamples(impulse, end);
+	Oconvolve::Impulse *spectra = findImpulse(hash, impulse, end, _blocklen,
+											  _impgain);
+	if (spectra == NULL) {
+		Offt fft(_fftlen, Offt::kRealToComplex);
+		float *fftbuf = fft.getbuf();
+
+		// zero-pad to fft length
+		for (int i = 0; i < end; i++)
+			fftbuf[i] = impulse[i];
+		for (int i = end; i < _fftlen; i++)
+			fftbuf[i] = 0.0f;
+
+		fft.r2c();	// take FFT
+
+		// normalize spectrum
+		double max = 0.0;
+		for (int i = 0; i < _halfFFTlen; i++) {
+			int index = i << 1;
+			float a = fftbuf[index];
+			float b = fftbuf[index + 1];
+			double c2 = (a * a) + (b * b);
+			if (c2 > max)
+				max = c2;
+		}
+		if (max != 0.0)
+			max = _impgain / sqrt(max);
+		else {
+			delete [] impulse;
+			return die("CONVOLVE1", "Impulse response is all zeros.");
+		}
 
-	_imp = new float [_fftlen];
-	if (_imp == NULL)
-		return -1;
-	for (int i = 0; i < _fftlen; i++)
-		_imp[i] = _fftbuf[i] * max;
+		// The single-FFT convolution came out scaled by 1 / _fftlen.
+		const float scale = max / _fftlen;
+		float *scaled = new float [end];
+		for (int i = 0; i < end; i++)
+			scaled[i] = impulse[i] * scale;
+		spectra = new Oconvolve::Impulse(scaled, end, _blocklen);
+		delete [] scaled;
+		spectra->ref();
+		cacheImpulse(hash, impulse, end, _blocklen, _impgain, spectra);
+	}
+	delete [] impulse;
 
-//	for (int i = 0; i < _fftlen; i++) printf("[%d] = %f\n", i, _imp[i]);
+	_convolver = new Oconvolve(spectra);
+	spectra->unref();		// _convolver has its own reference
 
 	return 0;
 }
@@ -212,33 +323,17 @@ int CONVOLVE1::prepareImpulse()
 int CONVOLVE1::configure()
 {
 	_inbuf = new float [RTBUFSAMPS * inputChannels()];
-	_ovadd = new float [_impframes];
-	if (_inbuf == NULL || _ovadd == NULL)
-		return -1;
-	for (int i = 0; i < _impframes; i++)
-		_ovadd[i] = 0.0f;
-
-	// read index chases write index by _impframes
-	_outframes = imax(_halfFFTlen, RTBUFSAMPS) * 2;
-	_outReadIndex = _outframes - _impframes;
-	_outWriteIndex = 0;
-	_dry = new float [_outframes];
-	_wet = new float [_outframes];
-	if (_dry == NULL || _wet == NULL)
+	_block = new float [_blocklen];
+	_outbuf = new float [RTBUFSAMPS * 2];
+	if (_inbuf == NULL || _block == NULL || _outbuf == NULL)
 		return -1;
-	for (int i = 0; i < _outframes; i++)
-		_dry[i] = _wet[i] = 0.0f;
-	DPRINT1("_outframes: %d\n", _outframes);
 
-	_bucket = new Obucket(_impframes, processWrapper, (void *) this);
-	if (_bucket == NULL)
+	// Output frames are wet and dry, so that both are delayed by the block.
+	_reblock = new Oreblock(_blocklen, inputChannels(), 2, processWrapper,
+	                                                          (void *) this);
+	if (_reblock == NULL)
 		return -1;
 
-	_fft = new Offt(_fftlen);
-	if (_fft == NULL)
-		return -1;
-	_fftbuf = _fft->getbuf();
-
 	if (prepareImpulse() != 0)
 		return -1;
 
@@ -246,63 +341,43 @@ int CONVOLVE1::configure()
 }
 
 
-void CONVOLVE1::convolve()
-{
-	_fft->r2c();
-
-	_fftbuf[0] = _fftbuf[0] * _imp[0];			// DC
-	_fftbuf[1] = _fftbuf[1] * _imp[1];			// Nyquist
-
-	int i = 2;
-	int j = 3;
-	for ( ; i < _fftlen; i += 2, j += 2) {
-		float a = (_fftbuf[i] * _imp[i]) - (_fftbuf[j] * _imp[j]);
-		float b = (_fftbuf[i] * _imp[j]) + (_fftbuf[j] * _imp[i]);
-		_fftbuf[i] = a;
-		_fftbuf[j] = b;
-	}
-
-	_fft->c2r();
-}
-
-
-// Called by Obucket whenever the bucket is full (i.e., has _halfFFTlen samps).
-// This static member wrapper function lets us call a non-static member
-// function, which we can't pass directly as a callback to Obucket.
+// Called by Oreblock whenever it has a block of input (i.e., _blocklen
+// frames).  This static member wrapper function lets us call a non-static
+// member function, which we can't pass directly as a callback to Oreblock.
 // See http://www.newty.de/fpt/callback.html for one explanation of this.
 
-void CONVOLVE1::processWrapper(const float buf[], const int len, void *obj)
+void CONVOLVE1::processWrapper(const float *in, float *out, int len, void *obj)
 {
 	CONVOLVE1 *myself = (CONVOLVE1 *) obj;
-	myself->process(buf, len);
+	myself->process(in, out, len);
 }
 
 
-void CONVOLVE1::process(const float *buf, const int len)
+void CONVOLVE1::process(const float *in, float *out, const int len)
 {
 	DPRINT1("CONVOLVE1::process (len=%d)\n", len);
 
-	// NOTE: <len> will always be equal to _impframes
-	if (_winosc)
-		for (int i = 0; i < len; i++)
-			_fftbuf[i] = buf[i] * _winosc->next(i);
+	// NOTE: <len> will always be equal to _blocklen.  The window spans
+	// _impframes of input, so it runs across blocks.
+	const int inchans = inputChannels();
+	const float *insig = &in[_inchan];
+	if (_winosc) {
+		for (int i = 0; i < len; i++) {
+			_block[i] = insig[i * inchans] * _winosc->next(_winframe);
+			if (++_winframe == _impframes)
+				_winframe = 0;
+		}
+	}
 	else
 		for (int i = 0; i < len; i++)
-			_fftbuf[i] = buf[i];
-	for (int i = len; i < _fftlen; i++)
-		_fftbuf[i] = 0.0f;
-
-	convolve();
-
-	for (int i = 0, j = len; i < len; i++, j++) {
-		_ovadd[i] += _fftbuf[i];
-		_wet[_outWriteIndex] = _ovadd[i];
-		_dry[_outWriteIndex] = buf[i];
-		incrementOutWriteIndex();
-		_ovadd[i] = _fftbuf[j];
-	}
+			_block[i] = insig[i * inchans];
+
+	_convolver->process(_block, _block);
 
-//	for (int i = 0; i < _fftlen; i++) printf("[%d] = %f\n", i, _fftbuf[i]);
+	for (int i = 0; i < len; i++) {
+		out[i * 2] = _block[i];
+		out[i * 2 + 1] = insig[i * inchans];
+	}
 }
 
 
@@ -324,18 +399,11 @@ int CONVOLVE1::run()
 	const int nframes = framesToRun();
 
 	if (currentFrame() < _inframes) {
-		const int insamps = nframes * inchans;
-		rtgetin(_inbuf, this, insamps);
-		for (int i = _inchan; i < insamps; i += inchans)
-			_bucket->drop(_inbuf[i]);
-	}
-	else {
-		for (int i = 0; i < nframes; i++)
-			_bucket->drop(0.0f);
+		rtgetin(_inbuf, this, nframes * inchans);
+		_reblock->run(_inbuf, _outbuf, nframes);
 	}
-	// If in last run invocation, make sure everything in bucket is processed.
-	if (currentFrame() + nframes >= nSamps())
-		_bucket->flush();
+	else
+		_reblock->run(NULL, _outbuf, nframes);
 
 	float drypct = 1.0 - _wetpct;
 
@@ -347,8 +415,7 @@ int CONVOLVE1::run()
 		}
 
 		float out[2];
-		out[0] = (_wet[_outReadIndex] * _wetpct) + (_dry[_outReadIndex] * drypct);
-		incrementOutReadIndex();
+		out[0] = (_outbuf[i * 2] * _wetpct) + (_outbuf[i * 2 + 1] * drypct);
 		out[0] *= _amp;
 
 		if (outchans == 2) {
@@ -1,7 +1,7 @@
 #include <Instrument.h>
 
-class Obucket;
-class Offt;
+class Oreblock;
+class Oconvolve;
 class Ooscili;
 
 class CONVOLVE1 : public Instrument {
@@ -14,38 +14,18 @@ public:
 
 private:
 	int prepareImpulse();
-	void convolve();
-	static void processWrapper(const float buf[], const int len, void *obj);
-	void process(const float *buf, const int len);
+	static void processWrapper(const float *in, float *out, int len, void *obj);
+	void process(const float *in, float *out, const int len);
 	void doupdate();
-	inline void incrementOutReadIndex();
-	inline void incrementOutWriteIndex();
 
-	int _branch, _inchan, _imptablen, _impframes, _inframes, _outframes;
-	int _impStartIndex, _halfFFTlen, _fftlen, _outReadIndex, _outWriteIndex;
+	int _branch, _inchan, _imptablen, _impframes, _inframes;
+	int _impStartIndex, _halfFFTlen, _fftlen, _blocklen, _winframe;
 	float _impgain, _amp, _wetpct, _pan;
-	float *_inbuf, *_fftbuf, *_imp, *_ovadd, *_dry, *_wet;
+	float *_inbuf, *_block, *_outbuf;
 	double *_imptab;
-	Obucket *_bucket;
-	Offt *_fft;
+	Oreblock *_reblock;
+	Oconvolve *_convolver;
 	Ooscili *_winosc;
 };
 
 
-#define NDEBUG
-#include <assert.h>
-
-inline void CONVOLVE1::incrementOutReadIndex()
-{
-	if (++_outReadIndex == _outframes)
-		_outReadIndex = 0;
-	assert(_outReadIndex != _outWriteIndex);
-}
-
-inline void CONVOLVE1::incrementOutWriteIndex()
-{
-	if (++_outWriteIndex == _outframes)
-		_outWriteIndex = 0;
-	assert(_outWriteIndex != _outReadIndex);
-}
-
@@ -12,6 +12,7 @@
          [optional, default is 0]
    p7 = input channel [optional, default is 0]
    p8 = percent of signal to left output channel [optional, default is .5]
+   p9 = oversampling factor (1, 2, 4 or 8) [optional, default is 1]
 
    p3 (pre-amp), p4 (post-amp), p5 (bits), p6 (cutoff) and p8 (pan) can
    receive dynamic updates from a table or real-time control source.
@@ -19,6 +20,10 @@
    If an old-style gen table 1 is present, its values will be multiplied
    by the p4 post-amp multiplier, even if the latter is dynamic.
 
+   Oversampling runs the decimation at 2, 4 or 8 times the sampling rate,
+   so that the harmonics it makes above the Nyquist frequency are filtered
+   out rather than folded back down.  It delays the output by 31 samples.
+
    JGG <johgibso at indiana dot edu>, 3 Jan 2002, rev for v4, 7/11/04
 */
 #include <stdio.h>
@@ -27,6 +32,7 @@
 #include <math.h>
 #include <ugens.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "DECIMATE.h"
 #include <rt.h>
 #include <rtdefs.h>
@@ -39,6 +45,7 @@ DECIMATE :: DECIMATE() : Instrument()
 {
    in = NULL;
    lpfilt = NULL;
+   oversamp = NULL;
    branch = 0;
    warn_bits = true;
    warn_cutoff = true;
@@ -49,6 +56,7 @@ DECIMATE :: ~DECIMATE()
 {
    delete [] in;
    delete lpfilt;
+   delete oversamp;
 }
 
 
@@ -116,6 +124,12 @@ int DECIMATE :: init(double p[], int n_args)
       tableset(SR, dur, len, amptabs);
    }
 
+   const int factor = n_args > 9 ? (int) p[9] : 1;
+   if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+      return die("DECIMATE", "Oversampling factor must be 1, 2, 4 or 8.");
+   if (factor > 1)
+      oversamp = new Ooversample(factor);
+
    nyquist = SR * 0.5;
    if (cutoff < 0.0 || cutoff > nyquist)
       return die("DECIMATE",
@@ -166,6 +180,17 @@ inline void DECIMATE :: changebits(int nbits)
 }
 
 
+inline float DECIMATE :: decimate(float sig)
+{
+   int32_t isig = (int32_t) sig;
+   float out = (float) ((isig & mask) + bias);
+#ifdef DEBUG2
+   printf("%f -> %d -> %f\n", sig, isig, out);
+#endif
+   return out;
+}
+
+
 int DECIMATE :: run()
 {
    int samps = framesToRun() * inputChannels();
@@ -202,11 +227,15 @@ int DECIMATE :: run()
 
       float out[2];
       float sig = in[i + inchan] * preamp;
-      int32_t isig = (int32_t) sig;
-      out[0] = (float) ((isig & mask) + bias);
-#ifdef DEBUG2
-      printf("%f -> %d -> %f\n", sig, isig, out[0]);
-#endif
+      if (oversamp) {
+         float buf[Ooversample::kMaxFactor];
+         oversamp->up(sig, buf);
+         for (int j = 0; j < oversamp->factor(); j++)
+            buf[j] = decimate(buf[j]);
+         out[0] = oversamp->down(buf);
+      }
+      else
+         out[0] = decimate(sig);
       if (usefilt)
          out[0] = lpfilt->tick(out[0]);
 
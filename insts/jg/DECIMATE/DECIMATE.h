@@ -1,5 +1,7 @@
 #include <objlib.h>
 
+class Ooversample;
+
 class DECIMATE : public Instrument {
    bool     warn_bits, warn_cutoff, usefilt;
    int32_t  mask;
@@ -8,8 +10,10 @@ class DECIMATE : public Instrument {
    float    *in, amptabs[2];
    double   *amparray;
    Butter   *lpfilt;
+   Ooversample *oversamp;
 
    void changebits(int bits);
+   float decimate(float sig);
 public:
    DECIMATE();
    virtual ~DECIMATE();
@@ -15,11 +15,16 @@
    p10 = distortion param (only for types 3 and 4 -- must be greater
          than zero, typically as high as 100) [optional, default is 1]
    p11 = wet/dry mix (0: dry, 1: wet) [optional, default is 1]
+   p12 = oversampling factor (1, 2, 4 or 8) [optional, default is 1]
 
    p3 (amplitude), p5 (gain), p6 (cutoff), p8 (pan), p9 (bypass), 
    p10 (distortion param), and p11 (wet/dry mix) can receive dynamic updates
    from a table or real-time control source.
 
+   Oversampling runs the distortion at 2, 4 or 8 times the sampling rate,
+   which cuts down the aliasing it makes, especially with hard clipping and
+   high gain.  It delays the output by 31 samples.
+
    If an old-style gen table 1 is present, its values will be multiplied
    by the p3 amplitude multiplier, even if the latter is dynamic.
 
@@ -44,7 +49,7 @@
 
 DISTORT::DISTORT()
    : usefilt(false), branch(0), param(1.0), wet(1.0), in(NULL), distort(NULL),
-     filt(NULL), amptable(NULL)
+     filt(NULL), amptable(NULL), oversamp(NULL), drydelay(NULL)
 {
 }
 
@@ -55,6 +60,8 @@ DISTORT::~DISTORT()
    delete distort;
    delete filt;
    delete amptable;
+   delete oversamp;
+   delete drydelay;
 }
 
 
@@ -88,6 +95,15 @@ int DISTORT::init(double p[], int n_args)
    else
       return die("DISTORT", "Distortion type must be 1-4.");
 
+   const int factor = n_args > 12 ? (int) p[12] : 1;
+   if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+      return die("DISTORT", "Oversampling factor must be 1, 2, 4 or 8.");
+   if (factor > 1) {
+      oversamp = new Ooversample(factor);
+      drydelay = new Odelay(oversamp->latency() + 1);
+      drydelay->setdelay(oversamp->latency());
+   }
+
    usefilt = (cutoff > 0.0);
    if (usefilt) {
       filt = new Butter(SR);
@@ -157,7 +173,16 @@ int DISTORT::run()
       if (!bypass) {
          float orig = sig;
          sig *= (gain / 32768.0f);  // apply gain, convert range
-         sig = distort->next(sig, param);
+         if (oversamp) {
+            float buf[Ooversample::kMaxFactor];
+            oversamp->up(sig, buf);
+            for (int j = 0; j < oversamp->factor(); j++)
+               buf[j] = distort->next(buf[j], param);
+            sig = oversamp->down(buf);
+            orig = drydelay->next(orig);     // keep dry in step with wet
+         }
+         else
+            sig = distort->next(sig, param);
          sig *= 32768.0f;
          if (usefilt)
             sig = filt->tick(sig);
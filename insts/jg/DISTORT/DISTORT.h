@@ -1,6 +1,8 @@
 class Odistort;
 class Butter;
 class TableL;
+class Ooversample;
+class Odelay;
 
 class DISTORT : public Instrument {
 
@@ -21,6 +23,8 @@ private:
 	Odistort	*distort;
    Butter   *filt;
    TableL   *amptable;
+   Ooversample *oversamp;
+   Odelay   *drydelay;
 };
 
 // update flags (shift amount is pfield number)
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include <ugens.h>
 #include "elldefs.h"
 #include "setell.h"
@@ -17,11 +18,30 @@ extern float SR(); // hack to access what was global
 static double coeffs[461];              /* array for coefficients */
 static int    nsections = 0;            /* number of sections */
 
+/* Designs made by earlier calls to ellset, newest replacing oldest, so that
+   a score calling ellset with the same specs before each of many notes
+   designs the filter once.
+*/
+#define MAX_DESIGNS  16
+#define DESIGN_LEN   (4 * MAX_SECTIONS + 1)    /* coefficients plus xnorm */
+
+typedef struct {
+   double srate, f1, f2, f3, ripple, atten;
+   int    nsections;
+   double coeffs[DESIGN_LEN];
+} EllDesign;
+
+static EllDesign designs[MAX_DESIGNS];
+static int       ndesigns = 0;
+static int       nextdesign = 0;
+
 
 double
 ellset(double p[], int n_args)
 {
-   double srate, f1, f2, f3, ripple, atten;
+   int       i;
+   double    srate, f1, f2, f3, ripple, atten;
+   EllDesign *d;
 
    f1 = (double)p[0];
    f2 = (double)p[1];
@@ -32,10 +52,35 @@ ellset(double p[], int n_args)
 
 // ***FIXME: do some input validation here
 
+   for (i = 0; i < ndesigns; i++) {
+      d = &designs[i];
+      if (d->srate == srate && d->f1 == f1 && d->f2 == f2 && d->f3 == f3
+                           && d->ripple == ripple && d->atten == atten) {
+         nsections = d->nsections;
+         memcpy(coeffs, d->coeffs, (4 * nsections + 1) * sizeof(double));
+         return 0.0;
+      }
+   }
+
    setell(srate, f1, f2, f3, ripple, atten, coeffs, &nsections, VERBOSE);
 
-   if (nsections < 1 || nsections > MAX_SECTIONS)
+   if (nsections < 1 || nsections > MAX_SECTIONS) {
       die("ELL", "Filter design failed! Try relaxing specs.");
+      return 0.0;
+   }
+
+   d = &designs[nextdesign];
+   d->srate = srate;
+   d->f1 = f1;
+   d->f2 = f2;
+   d->f3 = f3;
+   d->ripple = ripple;
+   d->atten = atten;
+   d->nsections = nsections;
+   memcpy(d->coeffs, coeffs, (4 * nsections + 1) * sizeof(double));
+   nextdesign = (nextdesign + 1) % MAX_DESIGNS;
+   if (ndesigns < MAX_DESIGNS)
+      ndesigns++;
 
    return 0.0;
 }
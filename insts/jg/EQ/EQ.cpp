@@ -242,7 +242,7 @@ void EQ :: doupdate()
       freq = newfreq;
       Q = newQ;
       gain = newgain;
-      eq->setCoeffs(freq, Q, gain);
+      eq->rampCoeffs(freq, Q, gain);
    }
 }
 
@@ -254,38 +254,53 @@ int EQ :: configure()
 }
 
 
+// The filter runs a block of samples at a time, up to the next control
+// update (<branch> counts the frames until then), and ramps over the block
+// to the coefficients that update sets.
+
+#define EQ_CHUNK 256
+
 int EQ :: run()
 {
-   const int samps = framesToRun() * inputChannels();
+   const int nframes = framesToRun();
+   const int inchans = inputChannels();
    if (currentFrame() < insamps)
-      rtgetin(in, this, samps);
+      rtgetin(in, this, nframes * inchans);
 
-   for (int i = 0; i < samps; i += inputChannels()) {
-      if (--branch <= 0) {
+   float sig[EQ_CHUNK];
+   int i = 0;
+   while (i < nframes) {
+      if (branch <= 0) {
          doupdate();
          branch = skip;
       }
-
-      float insig = 0.0;
-      if (currentFrame() < insamps)
-         insig = in[i + inchan];
-
-      float outsig;
-      if (bypass)
-         outsig = insig;
-      else
-         outsig = eq->tick(insig);
-
-      float out[2];
-      out[0] = outsig * amp;
-
-      if (outputChannels() == 2) {
-         out[1] = out[0] * (1.0 - pctleft);
-         out[0] *= pctleft;
+      int count = nframes - i;
+      if (count > branch)
+         count = branch > 0 ? branch : 1;
+      if (count > EQ_CHUNK)
+         count = EQ_CHUNK;
+
+      const float *insig = &in[i * inchans + inchan];
+      for (int j = 0; j < count; j++)
+         sig[j] = (currentFrame() + j < insamps) ? insig[j * inchans] : 0.0;
+
+      if (!bypass)
+         eq->tickBlock(sig, sig, count);
+
+      for (int j = 0; j < count; j++) {
+         float out[2];
+         out[0] = sig[j] * amp;
+
+         if (outputChannels() == 2) {
+            out[1] = out[0] * (1.0 - pctleft);
+            out[0] *= pctleft;
+         }
+
+         rtaddout(out);
+         increment();
       }
-
-      rtaddout(out);
-      increment();
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
@@ -47,11 +47,21 @@
 #define FIRST_BAND_ARG	7
 #define BAND_ARGS			3
 
-
-FilterBand::FilterBand(float srate, float cf, float bw, float amp)
-	: _cf(cf), _bw(bw), _amp(amp)
+// Bands are filtered a group at a time over a block of frames, up to the
+// next control update.  With many bands, the groups are split into jobs of
+// BANDS_PER_JOB bands, which run on helper threads if the frame_threads
+// option allows, each adding into its own partial sum.  The partial sums
+// are added in job order, so the output does not depend on the threads.
+#define FILTERBANK_CHUNK	256
+#define BANDS_PER_JOB		32
+
+
+FilterBand::FilterBand(float srate, Ofilterbank *bank, int band, float cf,
+	float bw)
+	: _bank(bank), _band(band), _cf(cf), _bw(bw)
 {
 	_filt = new Oreson(srate, cf, bw, Oreson::kRMSResponse);
+	setcoeffs();
 }
 
 
@@ -61,8 +71,17 @@ FilterBand::~FilterBand()
 }
 
 
+void FilterBand::setcoeffs()
+{
+	float a0, a1, a2;
+	_filt->getcoeffs(&a0, &a1, &a2);
+	_bank->setcoeffs(_band, a0, 0.0f, 0.0f, -a1, a2);
+}
+
+
 FILTERBANK::FILTERBANK()
-	: branch(0), numbands(0), in(NULL), filt(NULL)
+	: branch(0), numbands(0), in(NULL), sig(NULL), gains(NULL), partial(NULL),
+	  filt(NULL), bank(NULL)
 {
 }
 
@@ -70,9 +89,13 @@ FILTERBANK::FILTERBANK()
 FILTERBANK::~FILTERBANK()
 {
 	delete [] in;
+	delete [] sig;
+	delete [] partial;
 	for (int i = 0; i < numbands; i++)
 		delete filt[i];
 	delete [] filt;
+	delete [] gains;
+	delete bank;
 }
 
 
@@ -100,13 +123,21 @@ int FILTERBANK::init(double p[], int n_args)
 
 	numbands = (nargs - FIRST_BAND_ARG) / BAND_ARGS;
    filt = new FilterBand * [numbands];
+	bank = new Ofilterbank(numbands);
+	const int lanes = bank->numgroups() * Ofilterbank::kGroup;
+	gains = new float [lanes];
+	for (int i = 0; i < lanes; i++)
+		gains[i] = 0.0f;
+	numjobs = (numbands + BANDS_PER_JOB - 1) / BANDS_PER_JOB;
+	if (numjobs < 1)
+		numjobs = 1;
 
 	int band = 0;
 	for (int i = FIRST_BAND_ARG; i < nargs; i += BAND_ARGS) {
 		float cf = p[i] < 15.0 ? cpspch(p[i]) : p[i];
 		float bw = p[i + 1];
-		float amp = p[i + 2];
-		filt[band] = new FilterBand(SR, cf, bw, amp);
+		gains[band] = p[i + 2];
+		filt[band] = new FilterBand(SR, bank, band, cf, bw);
 		band++;
 	}
 
@@ -130,8 +161,8 @@ void FILTERBANK::doupdate()
 		float bw = p[i + 1] * cf;
 		if (bw <= 0.0)
 			bw = FLT_MIN;
-		float famp = p[i + 2];
-		filt[band]->setparams(cf, bw, famp);
+		filt[band]->setparams(cf, bw);
+		gains[band] = p[i + 2];
 		band++;
 	}
 }
@@ -140,44 +171,75 @@ void FILTERBANK::doupdate()
 int FILTERBANK::configure()
 {
 	in = new float [RTBUFSAMPS * inputChannels()];
+	sig = new float [FILTERBANK_CHUNK];
+	partial = new float [numjobs * FILTERBANK_CHUNK];
 	return in ? 0 : -1;
 }
 
 
+void FILTERBANK::runJob(void *context, int job)
+{
+	FILTERBANK *inst = (FILTERBANK *) context;
+	const int groupsPerJob = BANDS_PER_JOB / Ofilterbank::kGroup;
+	const int first = job * groupsPerJob;
+	int last = first + groupsPerJob;
+	if (last > inst->bank->numgroups())
+		last = inst->bank->numgroups();
+	float *sum = &inst->partial[job * FILTERBANK_CHUNK];
+	for (int i = 0; i < inst->spanframes; i++)
+		sum[i] = 0.0f;
+	for (int group = first; group < last; group++)
+		inst->bank->addgroup(group, inst->sig, inst->gains, sum,
+													inst->spanframes);
+}
+
+
 int FILTERBANK::run()
 {
 	const int inchans = inputChannels();
 	const int outchans = outputChannels();
-	const int samps = framesToRun() * inchans;
+	const int nframes = framesToRun();
 
 	if (currentFrame() < insamps)
-		rtgetin(in, this, samps);
+		rtgetin(in, this, nframes * inchans);
 
-	for (int i = 0; i < samps; i += inchans) {
-		if (--branch <= 0) {
+	int i = 0;
+	while (i < nframes) {
+		if (branch <= 0) {
 			doupdate();
 			branch = getSkip();
 		}
-
-		float insig;
-		if (currentFrame() < insamps)
-			insig = in[i + inchan];
-		else
-			insig = 0.0f;
-
-		float outsig = 0.0f;
-		for (int n = 0; n < numbands; n++)
-			outsig += filt[n]->next(insig);
-
-		float out[2];
-		out[0] = outsig * amp;
-		if (outchans == 2) {
-			out[1] = out[0] * (1.0 - pan);
-			out[0] *= pan;
+		int count = nframes - i;
+		if (count > branch)
+			count = branch > 0 ? branch : 1;
+		if (count > FILTERBANK_CHUNK)
+			count = FILTERBANK_CHUNK;
+
+		const float *insig = &in[i * inchans + inchan];
+		for (int j = 0; j < count; j++)
+			sig[j] = (currentFrame() + j < insamps) ? insig[j * inchans] : 0.0f;
+
+		spanframes = count;
+		runInParallel(runJob, this, numjobs);
+		for (int job = 1; job < numjobs; job++) {
+			const float *sum = &partial[job * FILTERBANK_CHUNK];
+			for (int j = 0; j < count; j++)
+				partial[j] += sum[j];
 		}
 
-		rtaddout(out);
-		increment();
+		for (int j = 0; j < count; j++) {
+			float out[2];
+			out[0] = partial[j] * amp;
+			if (outchans == 2) {
+				out[1] = out[0] * (1.0 - pan);
+				out[0] *= pan;
+			}
+
+			rtaddout(out);
+			increment();
+		}
+		branch -= count;
+		i += count;
 	}
 
 	return framesToRun();
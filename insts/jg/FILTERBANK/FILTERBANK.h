@@ -1,32 +1,40 @@
 class Oreson;
+class Ofilterbank;
+
+// One band's settings.  Its Oreson works out the coefficients, which run
+// in the shared Ofilterbank.
 
 class FilterBand {
-	Oreson	*_filt;
+	Oreson		*_filt;
+	Ofilterbank	*_bank;
+	int			_band;
 	float		_cf;
 	float		_bw;
-	float		_amp;
+
+	void setcoeffs();
 public:
-	FilterBand(float srate, float cf, float bw, float amp);
+	FilterBand(float srate, Ofilterbank *bank, int band, float cf, float bw);
 	~FilterBand();
-	inline void setparams(float cf, float bw, float amp) {
-		_amp = amp;
+	inline void setparams(float cf, float bw) {
 		if (cf != _cf || bw != _bw) {
 			_cf = cf;
 			_bw = bw;
 			_filt->setparams(_cf, _bw);
+			setcoeffs();
 		}
 	}
-	inline float next(float sig) { return _filt->next(sig) * _amp; }
 };
 
 
 class FILTERBANK : public Instrument {
-	int			nargs, branch, insamps, numbands, inchan;
+	int			nargs, branch, insamps, numbands, inchan, numjobs, spanframes;
 	float			amp, pan;
-	float			*in;
+	float			*in, *sig, *gains, *partial;
 	FilterBand	**filt;
+	Ofilterbank	*bank;
 
 	void doupdate();
+	static void runJob(void *context, int job);
 public:
 	FILTERBANK();
 	virtual ~FILTERBANK();
@@ -178,8 +178,9 @@ void FILTSWEEP :: doupdate()
    if (newcf != cf || newbw != bw) {
       cf = newcf;
       bw = newbw;
-      for (int j = 0; j < nfilts; j++)
-         filt[j]->setFreqBandwidthAndGain(cf, bw, scale);
+      filt[0]->setFreqBandwidthAndGain(cf, bw, scale);
+      for (int j = 1; j < nfilts; j++)
+         filt[j]->copyCoeffs(*filt[0]);
    }
 }
 
@@ -191,42 +192,65 @@ int FILTSWEEP :: configure()
 }
 
 
+// The filter cascade runs a block of samples at a time, up to the next
+// control update (<branch> counts the frames until then).
+
+#define FILTSWEEP_CHUNK 256
+
 int FILTSWEEP :: run()
 {
-   const int samps = framesToRun() * inputChannels();
+   const int nframes = framesToRun();
+   const int inchans = inputChannels();
 
    if (currentFrame() < insamps)
-      rtgetin(in, this, samps);
+      rtgetin(in, this, nframes * inchans);
 
-   for (int i = 0; i < samps; i += inputChannels()) {
-      if (--branch <= 0) {
+   float insig[FILTSWEEP_CHUNK], sig[FILTSWEEP_CHUNK];
+   int i = 0;
+   while (i < nframes) {
+      if (branch <= 0) {
          doupdate();
          branch = getSkip();
       }
+      int count = nframes - i;
+      if (count > branch)
+         count = branch > 0 ? branch : 1;
+      if (count > FILTSWEEP_CHUNK)
+         count = FILTSWEEP_CHUNK;
+
+      const float *inp = &in[i * inchans + inchan];
+      for (int j = 0; j < count; j++) {
+         if (currentFrame() + j < insamps)
+            insig[j] = inp[j * inchans];
+         else
+            insig[j] = 0.0;
+      }
 
-      float insig;
-      if (currentFrame() < insamps)
-         insig = in[i + inchan];
-      else
-         insig = 0.0;
-
-      float out[2];
-      out[0] = insig;
-      if (!bypass) {
-         for (int j = 0; j < nfilts; j++)
-            out[0] = filt[j]->tick(out[0]);
+      if (bypass) {
+         for (int j = 0; j < count; j++)
+            sig[j] = insig[j];
+      }
+      else {
+         JGBiQuad::tickCascade(filt, nfilts, insig, sig, count);
          if (do_balance)
-            out[0] = balancer->tick(out[0], insig);
+            for (int j = 0; j < count; j++)
+               sig[j] = balancer->tick(sig[j], insig[j]);
       }
 
-		out[0] *= amp;
-      if (outputChannels() == 2) {
-         out[1] = out[0] * (1.0 - pctleft);
-         out[0] *= pctleft;
-      }
+      for (int j = 0; j < count; j++) {
+         float out[2];
+         out[0] = sig[j] * amp;
+
+         if (outputChannels() == 2) {
+            out[1] = out[0] * (1.0 - pctleft);
+            out[0] *= pctleft;
+         }
 
-      rtaddout(out);
-      increment();
+         rtaddout(out);
+         increment();
+      }
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
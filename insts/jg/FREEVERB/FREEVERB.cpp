@@ -65,6 +65,16 @@ FREEVERB :: ~FREEVERB()
 }
 
 
+// Frames that input takes to reach the output: the predelay, the longest
+// comb and the allpasses in series.
+
+static int pathLength(int predelay_samps)
+{
+   return predelay_samps + combtuningR8 + allpasstuningR1 + allpasstuningR2
+                         + allpasstuningR3 + allpasstuningR4;
+}
+
+
 int FREEVERB :: init(double p[], int n_args)
 {
    float outskip = p[0];
@@ -127,6 +137,9 @@ int FREEVERB :: init(double p[], int n_args)
       tableset(SR, dur, lenamp, amptabs);
    }
 
+   path_samps = pathLength(predelay_samps);
+   sleepWhenSilent(insamps, path_samps);
+
    return nSamps();
 }
 
@@ -164,6 +177,12 @@ inline void FREEVERB :: updateRvb(double p[])
          predelay_samps = max_predelay_samps;
       }
       rvb->setpredelay(predelay_samps);
+      // Only ever lengthen the hold: signal already in a longer predelay
+      // still has to come out.
+      if (pathLength(predelay_samps) > path_samps) {
+         path_samps = pathLength(predelay_samps);
+         sleepWhenSilent(insamps, path_samps);
+      }
    }
    if (p[7] != damp) {
       damp = p[7];
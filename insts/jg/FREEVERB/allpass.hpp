@@ -7,7 +7,8 @@
 #ifndef _allpass_
 #define _allpass_
 
-#if defined(i386)
+// SSE is as slow with denormals as the x87 is.  -JGG
+#if defined(i386) || defined(__x86_64__)
  #define ANTI_DENORM
 #endif
 
@@ -17,6 +18,7 @@ public:
 					fv_allpass();
 			void	setbuffer(float *buf, int size);
 	inline  float	process(float inp);
+	inline  void	processblock(float *samps, int n);
 			void	mute();
 			void	setfeedback(float val);
 			float	getfeedback();
@@ -50,6 +52,45 @@ inline float fv_allpass::process(float input)
 	return output;
 }
 
+// Replace <n> samples in <samps> with their output, as process() would,
+// one run of samples between buffer wraps at a time.  The allpass is much
+// shorter than its buffer, so a run has no dependencies within it.  -JGG
+
+inline void fv_allpass::processblock(float *samps, int n)
+{
+#ifdef ANTI_DENORM
+	float ad = antidenorm;
+#endif
+	const float fb = feedback;
+
+	while (n > 0)
+	{
+		float *buf = buffer + bufidx;
+		int count = bufsize - bufidx;
+		if (count > n)
+			count = n;
+		for (int i = 0; i < count; i++)
+		{
+			float bufout = buf[i];
+#ifdef ANTI_DENORM
+			bufout += ad;
+			ad = -ad;
+#endif
+			const float input = samps[i];
+			samps[i] = -input + bufout;
+			buf[i] = input + (bufout*fb);
+		}
+		bufidx += count;
+		if (bufidx >= bufsize) bufidx = 0;
+		samps += count;
+		n -= count;
+	}
+
+#ifdef ANTI_DENORM
+	antidenorm = ad;
+#endif
+}
+
 #endif//_allpass
 
 //ends
@@ -7,7 +7,8 @@
 #ifndef _comb_
 #define _comb_
 
-#if defined(i386)
+// SSE is as slow with denormals as the x87 is.  -JGG
+#if defined(i386) || defined(__x86_64__)
  #define ANTI_DENORM
 #endif
 
@@ -17,6 +18,8 @@ public:
 					fv_comb();
 			void	setbuffer(float *buf, int size);
 	inline  float	process(float inp);
+	template <int N>
+	static inline void	processbank(fv_comb *combs, const float *inp, float *out, int n);
 			void	mute();
 			void	setdamp(float val);
 			float	getdamp();
@@ -60,6 +63,80 @@ inline float fv_comb::process(float input)
 	return output;
 }
 
+// Set <out> to the summed output of the <N> combs in <combs> for <n>
+// samples of <inp>.  The same as calling process() for each comb, sample
+// by sample, but with their state in registers, and with no test for the
+// end of a buffer except between runs of samples.  The combs' recursions
+// are independent, so the processor can overlap them.  -JGG
+
+template <int N>
+inline void fv_comb::processbank(fv_comb *combs, const float *inp, float *out, int n)
+{
+	float store[N], fb[N], d1[N], d2[N];
+#ifdef ANTI_DENORM
+	float ad[N];
+#endif
+	float *buf[N];
+	for (int c = 0; c < N; c++)
+	{
+		store[c] = combs[c].filterstore;
+		fb[c] = combs[c].feedback;
+		d1[c] = combs[c].damp1;
+		d2[c] = combs[c].damp2;
+#ifdef ANTI_DENORM
+		ad[c] = combs[c].antidenorm;
+#endif
+	}
+
+	while (n > 0)
+	{
+		int count = n;
+		for (int c = 0; c < N; c++)
+		{
+			const int left = combs[c].bufsize - combs[c].bufidx;
+			if (left < count)
+				count = left;
+			buf[c] = combs[c].buffer + combs[c].bufidx;
+		}
+		for (int i = 0; i < count; i++)
+		{
+			const float input = inp[i];
+			float sum = 0;
+			for (int c = 0; c < N; c++)
+			{
+				float output = buf[c][i];
+#ifdef ANTI_DENORM
+				output += ad[c];
+#endif
+				store[c] = (output*d2[c]) + (store[c]*d1[c]);
+#ifdef ANTI_DENORM
+				store[c] += ad[c];
+				ad[c] = -ad[c];
+#endif
+				buf[c][i] = input + (store[c]*fb[c]);
+				sum += output;
+			}
+			out[i] = sum;
+		}
+		for (int c = 0; c < N; c++)
+		{
+			combs[c].bufidx += count;
+			if (combs[c].bufidx >= combs[c].bufsize) combs[c].bufidx = 0;
+		}
+		inp += count;
+		out += count;
+		n -= count;
+	}
+
+	for (int c = 0; c < N; c++)
+	{
+		combs[c].filterstore = store[c];
+#ifdef ANTI_DENORM
+		combs[c].antidenorm = ad[c];
+#endif
+	}
+}
+
 #endif //_comb_
 
 //ends
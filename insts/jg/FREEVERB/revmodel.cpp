@@ -7,6 +7,10 @@
 
 #include "revmodel.hpp"
 
+// processreplace() works on this many frames at a time, running each comb
+// and allpass over all of them before going on to the next.  -JGG
+#define REVMODEL_CHUNK 256
+
 revmodel::revmodel()
 {
 	// Tie the components to their buffers
@@ -81,45 +85,52 @@ void revmodel::mute()
 
 void revmodel::processreplace(float *inputL, float *inputR, float *outputL, float *outputR, long numsamples, int input_skip, int output_skip)
 {
-	float outL,outR,input;
+	float input[REVMODEL_CHUNK];
+	float blockL[REVMODEL_CHUNK], blockR[REVMODEL_CHUNK];
 
-	while(numsamples-- > 0)
+	while(numsamples > 0)
 	{
-		outL = outR = 0;
-		input = (*inputL + *inputR) * gain;
+		const int n = numsamples < REVMODEL_CHUNK ? numsamples : REVMODEL_CHUNK;
+
+		for(int j=0; j<n; j++)
+			input[j] = (inputL[j*input_skip] + inputR[j*input_skip]) * gain;
 
 		// Accumulate comb filters in parallel
-		for(int i=0; i<numcombs; i++)
-		{
-			outL += combL[i].process(input);
-			outR += combR[i].process(input);
-		}
+		fv_comb::processbank<numcombs>(combL, input, blockL, n);
+		fv_comb::processbank<numcombs>(combR, input, blockR, n);
 
 		// Feed through allpasses in series
 		for(int i=0; i<numallpasses; i++)
 		{
-			outL = allpassL[i].process(outL);
-			outR = allpassR[i].process(outR);
+			allpassL[i].processblock(blockL, n);
+			allpassR[i].processblock(blockR, n);
 		}
 
-		// Calculate output REPLACING anything already there
-
-		// If we're using predelay, stuff reverb'd samp into delay line,
-		// and retrieve oldest samp.  -JGG
-		if (predelay_samps) {
-			*outputL = delayL.process(outL*wet1 + outR*wet2) + *inputL*dry;
-			*outputR = delayR.process(outR*wet1 + outL*wet2) + *inputR*dry;
-		}
-		else {
-			*outputL = outL*wet1 + outR*wet2 + *inputL*dry;
-			*outputR = outR*wet1 + outL*wet2 + *inputR*dry;
+		for(int j=0; j<n; j++)
+		{
+			const float outL = blockL[j];
+			const float outR = blockR[j];
+
+			// Calculate output REPLACING anything already there
+
+			// If we're using predelay, stuff reverb'd samp into delay line,
+			// and retrieve oldest samp.  -JGG
+			if (predelay_samps) {
+				*outputL = delayL.process(outL*wet1 + outR*wet2) + *inputL*dry;
+				*outputR = delayR.process(outR*wet1 + outL*wet2) + *inputR*dry;
+			}
+			else {
+				*outputL = outL*wet1 + outR*wet2 + *inputL*dry;
+				*outputR = outR*wet1 + outL*wet2 + *inputR*dry;
+			}
+
+			// Increment sample pointers, allowing for interleave (if any)
+			inputL += input_skip;
+			inputR += input_skip;
+			outputL += output_skip;
+			outputR += output_skip;
 		}
-
-		// Increment sample pointers, allowing for interleave (if any)
-		inputL += input_skip;
-		inputR += input_skip;
-		outputL += output_skip;
-		outputR += output_skip;
+		numsamples -= n;
 	}
 }
 
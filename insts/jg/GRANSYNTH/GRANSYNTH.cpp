@@ -123,6 +123,7 @@ int GRANSYNTH::init(double p[], int n_args)
       return die("GRANSYNTH", "You must create a table containing the grain "
                               "envelope.");
    _stream->setGrainEnvelopeTable(table, length);
+   _stream->setParallel(runInParallel);
 
    if (_nargs > 12) {
       table = (double *) getPFieldTable(12, &length);
@@ -5,16 +5,12 @@
 #include <math.h>
 #include <float.h>
 #include <ugens.h>   // for octpch and ampdb
-#include <Ougens.h>  // for Ooscil
 #include "synthgrainstream.h"
-#include "synthgrainvoice.h"
 //#define NDEBUG       // disable asserts
 #include <assert.h>
 
 #define DEBUG 0
 
-#define ALL_VOICES_IN_USE  -1
-
 #define COUNT_VOICES
 
 
@@ -26,33 +22,28 @@ SynthGrainStream::SynthGrainStream(const float srate, double *waveTable,
      _pitch(8.0), _maxpitchjitter(0.0), _transptab(NULL), _transplen(0),
      _outframecount(0), _nextoutstart(0), _lastL(0.0f), _lastR(0.0f)
 {
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      _voices[i] = new SynthGrainVoice(_srate, _wavetab, _wavetablen,
-									numOutChans);
+   _pool = new GrainPool(_srate, numOutChans);
+   _pool->setWaveTable(_wavetab, _wavetablen);
    _outrand = new LinearRandom(0.0, 1.0, seed * 2);
    _durrand = new LinearRandom(0.0, 1.0, seed * 3);
    _amprand = new LinearRandom(0.0, 1.0, seed * 4);
    _pitchrand = new LinearRandom(0.0, 1.0, seed * 5);
    _panrand = new LinearRandom(0.0, 1.0, seed * 6);
-#ifdef COUNT_VOICES
-   _maxvoice = -1;
-#endif
 }
 
 
 SynthGrainStream::~SynthGrainStream()
 {
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      delete _voices[i];
+#ifdef COUNT_VOICES
+   rtcmix_advise("GRANSYNTH", "Used %d voices", _pool->mostActive());
+#endif
+   delete _pool;
    delete [] _transptab;
    delete _outrand;
    delete _durrand;
    delete _amprand;
    delete _pitchrand;
    delete _panrand;
-#ifdef COUNT_VOICES
-   rtcmix_advise("GRANSYNTH", "Used %d voices", _maxvoice + 1);
-#endif
 }
 
 
@@ -61,8 +52,7 @@ SynthGrainStream::~SynthGrainStream()
 
 void SynthGrainStream::setGrainEnvelopeTable(double *table, int length)
 {
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      _voices[i]->setGrainEnvelopeTable(table, length);
+   _pool->setEnvelopeTable(table, length);
 }
 
 
@@ -124,17 +114,6 @@ const double SynthGrainStream::getPitch()
 }
 
 
-// Return index of first freq grain voice, or -1 if none are free.
-const int SynthGrainStream::firstFreeVoice()
-{
-   for (int i = 0; i < MAX_NUM_VOICES; i++) {
-      if (_voices[i]->inUse() == false)
-         return i;
-   }
-   return ALL_VOICES_IN_USE;
-}
-
-
 // Decide whether to (re)initialize a grain.
 // <bufoutstart> is the offset into the output buffer for the grain to start.
 // This is relevant only when using block I/O.
@@ -143,22 +122,15 @@ void SynthGrainStream::maybeStartGrain(const int bufoutstart)
 {
    if (_outframecount >= _nextoutstart) {    // time to start another grain
 
-      const int voice = firstFreeVoice();
-      if (voice != ALL_VOICES_IN_USE) {
-#ifdef COUNT_VOICES
-         if (voice > _maxvoice)
-            _maxvoice = voice;
-#endif
-         const double startphase = 0.0; // XXX pfield?
-         const double outdur = _durrand->value();
-         const double amp = _amprand->value();
-         const double pan = _outchans > 1 ? _panrand->value() : 1.0;
-         const double pitch = getPitch();
-
-         if (outdur >= 0.0)
-            _voices[voice]->startGrain(bufoutstart, startphase, outdur, amp,
-                                                                pitch, pan);
-      }
+      const double startphase = 0.0; // XXX pfield?
+      const double outdur = _durrand->value();
+      const double amp = _amprand->value();
+      const double pan = _outchans > 1 ? _panrand->value() : 1.0;
+      const double pitch = getPitch();
+
+      if (outdur >= 0.0)
+         _pool->startOscGrain(bufoutstart, int((outdur * _srate) + 0.5),
+                              cpsoct(pitch), startphase, amp, pan);
 
       const int outjitter = (_maxoutjitter == 0.0) ? 0
                                           : int(_outrand->value() * _srate);
@@ -171,45 +143,16 @@ void SynthGrainStream::maybeStartGrain(const int bufoutstart)
 }
 
 
-// Called for single-frame I/O.
-
-void SynthGrainStream::playGrains()
-{
-   _lastL = 0.0f;
-   _lastR = 0.0f;
-   for (int i = 0; i < MAX_NUM_VOICES; i++) {
-      if (_voices[i]->inUse()) {
-         float sigL, sigR;
-         _voices[i]->next(sigL, sigR);
-         _lastL += sigL;
-         _lastR += sigR;
-      }
-   }
-}
-
-
-// Called for block I/O.
-
-void SynthGrainStream::playGrains(float buffer[], const int numFrames,
-   const float amp)
-{
-   const int count = numFrames * _outchans;
-   for (int i = 0; i < count; i++)
-      buffer[i] = 0.0f;
-
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      if (_voices[i]->inUse())
-         _voices[i]->next(buffer, numFrames, amp);
-}
-
-
 // Compute one frame of samples across all active grains.  Activate a
 // new grain if it's time.
 
 void SynthGrainStream::prepare()
 {
    maybeStartGrain();
-   playGrains();
+   float frame[2] = { 0.0f, 0.0f };
+   _pool->render(frame, 1, 1.0f);
+   _lastL = frame[0];
+   _lastR = frame[1];      // zero if mono
    _outframecount++;
 }
 
@@ -220,11 +163,15 @@ void SynthGrainStream::prepare()
 void SynthGrainStream::processBlock(float *buffer, const int numFrames,
    const float amp)
 {
+   const int count = numFrames * _outchans;
+   for (int i = 0; i < count; i++)
+      buffer[i] = 0.0f;
+
    for (int i = 0; i < numFrames; i++) {
       maybeStartGrain(i);
       _outframecount++;
    }
-   playGrains(buffer, numFrames, amp);
+   _pool->render(buffer, numFrames, amp);
 }
 
 
@@ -2,11 +2,8 @@
 // software and for a DISCLAIMER OF ALL WARRANTIES.
 
 #include "../../../src/rtcmix/Random.h"
+#include <GrainPool.h>
 
-#define MAX_NUM_VOICES 50
-
-class Ooscil;
-class SynthGrainVoice;
 
 class SynthGrainStream {
 
@@ -22,6 +19,11 @@ public:
 
    void setGrainEnvelopeTable(double *table, int length);
 
+   // Let block I/O render grains on several threads at once.
+   inline void setParallel(GrainPool::ParallelFunction func) {
+      _pool->setParallel(func);
+   }
+
    // <hop> is the number of seconds to skip on the output before starting a
    // new grain.  We add jitter to this amount in maybeStartGrain().
    inline void setGrainHop(const double hop) {
@@ -77,10 +79,7 @@ public:
    void processBlock(float *buffer, const int numFrames, const float amp);
 
 private:
-   const int firstFreeVoice();
    const double getPitch();
-   void playGrains();
-   void playGrains(float buffer[], const int numFrames, const float amp);
    void maybeStartGrain(const int bufoutstart = 0);
 
    // set in response to user input
@@ -96,7 +95,7 @@ private:
    int _transplen;
 
    // set internally
-   SynthGrainVoice *_voices[MAX_NUM_VOICES];
+   GrainPool *_pool;
    Random *_outrand;
    Random *_durrand;
    Random *_amprand;
@@ -104,7 +103,6 @@ private:
    Random *_panrand;
    int _outframecount;
    int _nextoutstart;
-   int _maxvoice;
    float _lastL;
    float _lastR;
 };
@@ -175,6 +175,7 @@ int GRANULATE::init(double p[], int n_args)
       return die("GRANULATE", "You must create a table containing the grain "
                               "envelope.");
    _stream->setGrainEnvelopeTable(table, length);
+   _stream->setParallel(runInParallel);
 
    if (_nargs > 20) {
       table = (double *) getPFieldTable(20, &length);
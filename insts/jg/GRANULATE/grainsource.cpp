@@ -0,0 +1,94 @@
+// Copyright (C) 2005 John Gibson.  See ``LICENSE'' for the license to this
+// software and for a DISCLAIMER OF ALL WARRANTIES.
+
+#include <string.h>
+#include "grainsource.h"
+//#define NDEBUG     // disable asserts
+#include <assert.h>
+
+// Grow the resident region by at least this many frames at a time.
+#define MIN_GROWTH 8192
+
+
+// NOTE: We don't own the table memory.
+GrainSource::GrainSource(double *inputTable, int inputFrames, int numInChans)
+   : _inputtab(inputTable), _inputframes(inputFrames), _numinchans(numInChans)
+{
+   assert(_inputtab != NULL);
+   assert(_numinchans > 0);
+
+   _region = new Region[_numinchans];
+   for (int i = 0; i < _numinchans; i++) {
+      _region[i].data = NULL;
+      _region[i].first = 0;
+      _region[i].end = 0;
+   }
+}
+
+
+GrainSource::~GrainSource()
+{
+   for (int i = 0; i < _numinchans; i++)
+      delete [] _region[i].data;
+   delete [] _region;
+}
+
+
+void GrainSource::require(const int chan, int first, int last)
+{
+   assert(chan >= 0 && chan < _numinchans);
+
+   if (first > last) {
+      const int tmp = first;
+      first = last;
+      last = tmp;
+   }
+   if (first < 0)
+      first = 0;
+   if (last >= _inputframes)
+      last = _inputframes - 1;
+
+   Region &region = _region[chan];
+   if (region.data != NULL && first >= region.first && last < region.end)
+      return;
+
+   // Take in the old region as well, since grains may still be reading it,
+   // and leave room to grow in the direction we're growing.
+   int newfirst = first;
+   int newend = last + 1;
+   if (region.data != NULL) {
+      if (region.first < newfirst)
+         newfirst = region.first;
+      if (region.end > newend)
+         newend = region.end;
+   }
+   int growth = (newend - newfirst) / 2;
+   if (growth < MIN_GROWTH)
+      growth = MIN_GROWTH;
+   if (region.data == NULL || first < region.first)
+      newfirst -= growth;
+   if (region.data == NULL || last >= region.end)
+      newend += growth;
+   if (newfirst < 0)
+      newfirst = 0;
+   if (newend > _inputframes)
+      newend = _inputframes;
+
+   float *data = new float [newend - newfirst];
+   int copyfirst = newend, copyend = newend;    // no old region: convert all
+   if (region.data != NULL) {
+      copyfirst = region.first;
+      copyend = region.end;
+      memcpy(&data[copyfirst - newfirst], region.data,
+                                    (copyend - copyfirst) * sizeof(float));
+   }
+   for (int frame = newfirst; frame < copyfirst; frame++)
+      data[frame - newfirst] = (float) _inputtab[(frame * _numinchans) + chan];
+   for (int frame = copyend; frame < newend; frame++)
+      data[frame - newfirst] = (float) _inputtab[(frame * _numinchans) + chan];
+   delete [] region.data;
+   region.data = data;
+   region.first = newfirst;
+   region.end = newend;
+}
+
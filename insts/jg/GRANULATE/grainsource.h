@@ -0,0 +1,42 @@
+// Copyright (C) 2005 John Gibson.  See ``LICENSE'' for the license to this
+// software and for a DISCLAIMER OF ALL WARRANTIES.
+
+// The input that all the grain voices of a stream read from.  The input
+// table holds interleaved doubles for however many channels the sound file
+// had, so a voice reading one channel from it touches a whole frame of
+// doubles (and usually a new cache line) for every sample.  Instead, we keep
+// the part of the table that grains actually use -- the window, plus however
+// far grains run past it -- as contiguous floats for each channel read, and
+// share that among all the voices.  The resident region only grows, in large
+// steps, so it is converted from the table once per note, not once per grain.
+
+class GrainSource {
+
+public:
+   GrainSource(double *inputTable, int inputFrames, int numInChans);
+   ~GrainSource();
+
+   // Make frames <first> through <last> (in either order) of <chan> resident.
+   // Call this when starting a grain, not while grains are being played.
+   void require(const int chan, int first, int last);
+
+   // Samples of <chan>, starting with frame number <firstFrame>.  These
+   // pointers change when require() grows the region, so a voice should
+   // fetch them every time it starts computing.
+   inline const float *samples(const int chan) const { return _region[chan].data; }
+   inline int firstFrame(const int chan) const { return _region[chan].first; }
+   inline int endFrame(const int chan) const { return _region[chan].end; }
+
+private:
+   struct Region {
+      float *data;
+      int first;     // first resident frame
+      int end;       // one past the last resident frame
+   };
+
+   double *_inputtab;
+   int _inputframes;
+   int _numinchans;
+   Region *_region;     // one per input channel
+};
+
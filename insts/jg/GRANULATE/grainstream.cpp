@@ -5,16 +5,13 @@
 #include <math.h>
 #include <float.h>
 #include <ugens.h>   // for octpch and ampdb
-#include <Ougens.h>  // for Ooscil
 #include "grainstream.h"
-#include "grainvoice.h"
+#include "grainsource.h"
 //#define NDEBUG       // disable asserts
 #include <assert.h>
 
 #define DEBUG 0
 
-#define ALL_VOICES_IN_USE  -1
-
 #define COUNT_VOICES
 
 inline int _clamp(const int min, const int val, const int max)
@@ -32,31 +29,31 @@ GrainStream::GrainStream(const float srate, double *inputTable, int tableLen,
    const int numInChans, const int numOutChans, const bool preserveGrainDur,
    const int seed, const bool use3rdOrderInterp)
    : _srate(srate), _inputtab(inputTable), _inputframes(tableLen / numInChans),
-     _outchans(numOutChans), _inchan(0), _winstart(-1), _winend(_inputframes),
+     _inchans(numInChans), _outchans(numOutChans), _inchan(0), _winstart(-1), _winend(_inputframes),
      _wrap(true), _inhop(0), _outhop(0), _maxinjitter(0.0), _maxoutjitter(0.0),
      _transp(0.0), _maxtranspjitter(0.0), _transptab(NULL), _transplen(0),
-     _outframecount(0), _nextinstart(0), _nextoutstart(0), _travrate(1.0),
+     _preservedur(preserveGrainDur), _outframecount(0), _nextinstart(0), _nextoutstart(0), _travrate(1.0),
      _lasttravrate(1.0), _lastinskip(DBL_MAX), _lastL(0.0f), _lastR(0.0f)
 {
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      _voices[i] = new GrainVoice(_srate, _inputtab, _inputframes, numInChans,
-                            numOutChans, preserveGrainDur, use3rdOrderInterp);
+   _source = new GrainSource(_inputtab, _inputframes, numInChans);
+   _pool = new GrainPool(_srate, numOutChans, numInChans,
+               use3rdOrderInterp ? GrainPool::kCubic : GrainPool::kQuadratic);
    _inrand = new LinearRandom(0.0, 1.0, seed);
    _outrand = new LinearRandom(0.0, 1.0, seed * 2);
    _durrand = new LinearRandom(0.0, 1.0, seed * 3);
    _amprand = new LinearRandom(0.0, 1.0, seed * 4);
    _transprand = new LinearRandom(0.0, 1.0, seed * 5);
    _panrand = new LinearRandom(0.0, 1.0, seed * 6);
-#ifdef COUNT_VOICES
-   _maxvoice = -1;
-#endif
 }
 
 
 GrainStream::~GrainStream()
 {
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      delete _voices[i];
+#ifdef COUNT_VOICES
+   rtcmix_advise("GRANULATE", "Used %d voices", _pool->mostActive());
+#endif
+   delete _pool;
+   delete _source;
    delete [] _transptab;
    delete _inrand;
    delete _outrand;
@@ -64,9 +61,6 @@ GrainStream::~GrainStream()
    delete _amprand;
    delete _transprand;
    delete _panrand;
-#ifdef COUNT_VOICES
-   rtcmix_advise("GRANULATE", "Used %d voices", _maxvoice + 1);
-#endif
 }
 
 
@@ -75,8 +69,7 @@ GrainStream::~GrainStream()
 
 void GrainStream::setGrainEnvelopeTable(double *table, int length)
 {
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      _voices[i]->setGrainEnvelopeTable(table, length);
+   _pool->setEnvelopeTable(table, length);
 }
 
 
@@ -205,14 +198,54 @@ const double GrainStream::getTransposition()
 }
 
 
-// Return index of first freq grain voice, or -1 if none are free.
-const int GrainStream::firstFreeVoice()
+// <transp> is in linear octaves, relative to zero.
+
+void GrainStream::startGrain(const int bufoutstart, const int instartframe,
+   const double outdur, const double amp, const double transp,
+   const double pan, const bool forwards)
 {
-   for (int i = 0; i < MAX_NUM_VOICES; i++) {
-      if (_voices[i]->inUse() == false)
-         return i;
+   // Getting durations right is tricky when transposing, because our
+   // transposition method doesn't preserve duration.  For example, if we
+   // request 1 second and transpose down an octave, then the transposer will
+   // generate 2 seconds, while consuming 1 second of the source audio.  We
+   // let the caller decide whether to preserve <outdur> when transposing.
+   // If _preservedur is true, then we adjust the duration fed to the
+   // transposer so that the result will be <outdur>.  In the previous example,
+   // we would tell the transposer to consume only a half second of audio
+   // so that the result would last 1 second.  The grain envelope spans
+   // <outdur>, regardless of _preservedur state.
+   //
+   // There's another problem.  If a grain duration would cause us to read past
+   // the end of the input array, then we don't play the grain.
+
+   const double increment = (transp == 0.0) ? 1.0 : pow(2.0, transp);
+   const double inputdur = _preservedur ? outdur * increment : outdur;
+   const double outputdur = _preservedur ? outdur : outdur / increment;
+
+   const int inframes = int((inputdur * _srate) + 0.5);
+   const int inendframe = forwards ? instartframe + inframes
+                                   : instartframe - inframes;
+   if (inendframe >= _inputframes || inendframe < 0) {
+#if DEBUG > 0
+      printf("Suppressing grain that would run past input array end.\n");
+#endif
+      return;
    }
-   return ALL_VOICES_IN_USE;
+
+   // Including the frames on either side that interpolation reads
+   if (forwards)
+      _source->require(_inchan, instartframe - 2, inendframe + 2);
+   else
+      _source->require(_inchan, inendframe - 2, instartframe + 2);
+
+   _pool->startSampleGrain(bufoutstart, int((outputdur * _srate) + 0.5),
+      _inchan, instartframe, forwards ? increment : -increment, amp, pan);
+
+#if DEBUG > 0
+   printf("inputdur=%f, outputdur=%f, _inchan=%d, _inputframes=%d, "
+      "instartframe=%d, inendframe=%d, inframes=%d\n", inputdur, outputdur,
+      _inchan, _inputframes, instartframe, inendframe, inframes);
+#endif
 }
 
 
@@ -241,29 +274,22 @@ bool GrainStream::maybeStartGrain(const int bufoutstart)
          _lasttravrate = _travrate;
       }
 
-      const int voice = firstFreeVoice();
-      if (voice != ALL_VOICES_IN_USE) {
-#ifdef COUNT_VOICES
-         if (voice > _maxvoice)
-            _maxvoice = voice;
-#endif
-         const double outdur = _durrand->value();
+      const double outdur = _durrand->value();
 
-         // Try to prevent glitch when traversal rate crosses zero.
-         if (inoffset != 0) {
-            inoffset *= int((outdur * _srate) + 0.5);
-            _nextinstart += inoffset;
-            _nextinstart = _clamp(0, _nextinstart, _inputframes - 1);
-         }
+      // Try to prevent glitch when traversal rate crosses zero.
+      if (inoffset != 0) {
+         inoffset *= int((outdur * _srate) + 0.5);
+         _nextinstart += inoffset;
+         _nextinstart = _clamp(0, _nextinstart, _inputframes - 1);
+      }
 
-         const double amp = _amprand->value();
-         const double pan = _outchans > 1 ? _panrand->value() : 1.0;
-         const double transp = getTransposition();
+      const double amp = _amprand->value();
+      const double pan = _outchans > 1 ? _panrand->value() : 1.0;
+      const double transp = getTransposition();
 
-         if (outdur >= 0.0)
-            _voices[voice]->startGrain(bufoutstart, _nextinstart, outdur,
-                                       _inchan, amp, transp, pan, forwards);
-      }
+      if (outdur >= 0.0)
+         startGrain(bufoutstart, _nextinstart, outdur, amp, transp, pan,
+                                                                  forwards);
       const int injitter = (_maxinjitter == 0.0) ? 0
                                           : int(_inrand->value() * _srate);
       _nextinstart += _inhop + injitter;
@@ -321,38 +347,19 @@ bool GrainStream::maybeStartGrain(const int bufoutstart)
 }
 
 
-// Called for single-frame I/O.
+// The source may have moved its samples since grains were last played.
 
-void GrainStream::playGrains()
+void GrainStream::updateInput()
 {
-   _lastL = 0.0f;
-   _lastR = 0.0f;
-   for (int i = 0; i < MAX_NUM_VOICES; i++) {
-      if (_voices[i]->inUse()) {
-         float sigL, sigR;
-         _voices[i]->next(sigL, sigR);
-         _lastL += sigL;
-         _lastR += sigR;
-      }
+   for (int chan = 0; chan < _inchans; chan++) {
+      const float *samples = _source->samples(chan);
+      if (samples)
+         _pool->setInput(chan, samples, _source->firstFrame(chan),
+                                        _source->endFrame(chan));
    }
 }
 
 
-// Called for block I/O.
-
-void GrainStream::playGrains(float buffer[], const int numFrames,
-   const float amp)
-{
-   const int count = numFrames * _outchans;
-   for (int i = 0; i < count; i++)
-      buffer[i] = 0.0f;
-
-   for (int i = 0; i < MAX_NUM_VOICES; i++)
-      if (_voices[i]->inUse())
-         _voices[i]->next(buffer, numFrames, amp);
-}
-
-
 // Compute one frame of samples across all active grains.  Activate a
 // new grain if it's time.  Return false if caller should terminate
 // prematurely, due to running out of input when not using wraparound mode;
@@ -361,7 +368,11 @@ void GrainStream::playGrains(float buffer[], const int numFrames,
 bool GrainStream::prepare()
 {
    bool keepgoing = maybeStartGrain();
-   playGrains();
+   updateInput();
+   float frame[2] = { 0.0f, 0.0f };
+   _pool->render(frame, 1, 1.0f);
+   _lastL = frame[0];
+   _lastR = frame[1];      // zero if mono
    _outframecount++;
 
    return keepgoing;
@@ -374,6 +385,10 @@ bool GrainStream::prepare()
 bool GrainStream::processBlock(float *buffer, const int numFrames,
    const float amp)
 {
+   const int count = numFrames * _outchans;
+   for (int i = 0; i < count; i++)
+      buffer[i] = 0.0f;
+
    bool keepgoing = true;
    for (int i = 0; i < numFrames; i++) {
       keepgoing = maybeStartGrain(i);
@@ -381,7 +396,8 @@ bool GrainStream::processBlock(float *buffer, const int numFrames,
       if (!keepgoing)
          break;
    }
-   playGrains(buffer, numFrames, amp);
+   updateInput();
+   _pool->render(buffer, numFrames, amp);
    return keepgoing;
 }
 
@@ -2,11 +2,9 @@
 // software and for a DISCLAIMER OF ALL WARRANTIES.
 
 #include "../../../src/rtcmix/Random.h"
+#include <GrainPool.h>
 
-#define MAX_NUM_VOICES 50
-
-class Ooscil;
-class GrainVoice;
+class GrainSource;
 
 class GrainStream {
 
@@ -29,6 +27,11 @@ public:
 
    void setGrainEnvelopeTable(double *table, int length);
 
+   // Let block I/O render grains on several threads at once.
+   inline void setParallel(GrainPool::ParallelFunction func) {
+      _pool->setParallel(func);
+   }
+
    void setInskip(const double inskip);
    void setWindow(const double start, const double end);
 
@@ -89,16 +92,18 @@ public:
    bool processBlock(float *buffer, const int numFrames, const float amp);
 
 private:
-   const int firstFreeVoice();
    const double getTransposition();
-   void playGrains();
-   void playGrains(float buffer[], const int numFrames, const float amp);
+   void startGrain(const int bufoutstart, const int instartframe,
+      const double outdur, const double amp, const double transp,
+      const double pan, const bool forwards);
    bool maybeStartGrain(const int bufoutstart = 0);
+   void updateInput();
 
    // set in response to user input
    double _srate;
    double *_inputtab;
    int _inputframes;
+   int _inchans;
    int _outchans;
    int _inchan;
    int _inskip;
@@ -113,9 +118,11 @@ private:
    double _maxtranspjitter;
    double *_transptab;
    int _transplen;
+   bool _preservedur;
 
    // set internally
-   GrainVoice *_voices[MAX_NUM_VOICES];
+   GrainSource *_source;
+   GrainPool *_pool;
    Random *_inrand;
    Random *_outrand;
    Random *_durrand;
@@ -125,7 +132,6 @@ private:
    int _outframecount;
    int _nextinstart;
    int _nextoutstart;
-   int _maxvoice;
    double _travrate;
    double _lasttravrate;
    double _lastinskip;
@@ -133,6 +133,8 @@ int JDELAY::init(double p[], int n_args)
 
    prev_in = prev_out = 0.0;         // for DC-blocker
 
+   sleepWhenSilent(insamps, (int) delay->length());
+
    return nSamps();
 }
 
@@ -19,7 +19,8 @@
    amp is from 0 to 1.  Ideally, frequencies with amplitude of 1 are passed
    without attenuation; those with amplitude of 0 are attenuated totally.  But
    this behavior depends on the order of the filter. Try an order of 200, and
-   increase that as needed.
+   increase that as needed.  Orders in the thousands are fine: past a few
+   hundred, most of the filter runs as an FFT convolution.
 
    Example:
 
@@ -48,17 +49,59 @@
 #include <ugens.h>
 #include <Instrument.h>
 #include <PField.h>
+#include <Ougens.h>
 #include "JFIR.h"
 #include <rt.h>
 #include <rtdefs.h>
+#include <Lockable.h>
+#include <string.h>
+#include <vector>
 
 //#define DEBUG
 //#define PRINT_RESPONSE
 #define NCOLUMNS 160      // 1 data point per terminal column
 #define NROWS    60
+#define MAX_CACHED_DESIGNS 16
 
 
-JFIR :: JFIR() : in(NULL), filt(NULL)
+// Filters designed by earlier notes.  Design costs on the order of
+// <order> squared cosines, so a score of many short notes sharing one
+// response table and order designs it once, and the rest copy it.
+
+struct JFIRDesign {
+   double               srate;
+   std::vector<double>  response;
+   std::vector<double>  coeffs;     // [order]
+};
+
+static Lockable sDesignLock;
+static std::vector<JFIRDesign> sDesigns;
+
+static void design_filter(NZero *filt, double srate, double *table, int len)
+{
+   const int order = filt->getOrder();
+   AutoLock lock(sDesignLock);
+   for (size_t n = 0; n < sDesigns.size(); n++) {
+      JFIRDesign &design = sDesigns[n];
+      if (design.srate == srate && (int) design.coeffs.size() == order
+            && (int) design.response.size() == len
+            && memcmp(&design.response[0], table, len * sizeof(double)) == 0) {
+         filt->setZeroCoeffs(&design.coeffs[0]);
+         return;
+      }
+   }
+   filt->designFromFunctionTable(table, len, 0, 0);
+   if (sDesigns.size() >= MAX_CACHED_DESIGNS)
+      sDesigns.erase(sDesigns.begin());
+   JFIRDesign design;
+   design.srate = srate;
+   design.response.assign(table, table + len);
+   design.coeffs.assign(filt->getZeroCoeffs(), filt->getZeroCoeffs() + order);
+   sDesigns.push_back(design);
+}
+
+
+JFIR :: JFIR() : in(NULL), filt(NULL), fir(NULL)
 {
    branch = 0;
 }
@@ -68,6 +111,7 @@ JFIR :: ~JFIR()
 {
    delete [] in;
    delete filt;
+   delete fir;
 }
 
 
@@ -107,7 +151,9 @@ int JFIR :: init(double p[], int n_args)
       return die("JFIR", "Order must be greater than 0.");
 
    filt = new NZero(SR, order);
-   filt->designFromFunctionTable(response_table, tablelen, 0, 0);
+   design_filter(filt, SR, response_table, tablelen);
+   // NZero just designs it; Ofir runs it, by FFT at high orders.
+   fir = new Ofir(filt->getZeroCoeffs(), filt->getOrder());
 #ifdef PRINT_RESPONSE
    print_freq_response();
 #endif
@@ -169,7 +215,7 @@ int JFIR :: run()
       if (bypass)
          out[0] = insig;
       else
-         out[0] = filt->tick(insig);
+         out[0] = fir->next(insig);
 
       if (outputchans == 2) {
          out[1] = out[0] * (1.0 - pctleft);
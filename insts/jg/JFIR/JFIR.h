@@ -1,5 +1,7 @@
 #include <objlib.h>
 
+class Ofir;
+
 class JFIR : public Instrument {
    bool    bypass;
    int     nargs, inchan, insamps, branch;
@@ -7,6 +9,7 @@ class JFIR : public Instrument {
    float   *in, amptabs[2];
    double  *amparray;
    NZero   *filt;
+   Ofir    *fir;
 
    void doupdate();
 public:
@@ -106,10 +106,23 @@ int MOOGVCF :: init(double p[], int n_args)
 
    skip = (int) (SR / (float) resetval);
 
+   notifyAtNoiseFloor();
+
    return nSamps();
 }
 
 
+// Output has gone silent.  Unless the filter is only muted by amp, its state
+// is all that is left of the tail, decaying toward denormals, so clear it.
+void MOOGVCF :: noiseFloorReached()
+{
+   const float tiny = 1.0e-3;
+   if (fabs(b0) < tiny && fabs(b1) < tiny && fabs(b2) < tiny
+       && fabs(b3) < tiny && fabs(b4) < tiny)
+      b0 = b1 = b2 = b3 = b4 = 0.0;
+}
+
+
 void MOOGVCF :: doupdate()
 {
    double p[9];
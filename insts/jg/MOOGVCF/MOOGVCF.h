@@ -14,6 +14,8 @@ public:
    virtual int init(double p[], int n_args);
    virtual int configure();
    virtual int run();
+protected:
+   virtual void noiseFloorReached();
 };
 
 
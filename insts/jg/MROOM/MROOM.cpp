@@ -24,15 +24,13 @@
 #include <math.h>
 #include <ugens.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "MROOM.h"
 #include <rt.h>
 #include <rtdefs.h>
-#include <delmacros.h>
 
 //#define DEBUG
 
-#define INTERP_GET                    /* use interpolating delay line fetch */
-
 #define DEFAULT_QUANTIZATION  100
 #define MAX_DELAY             1.0     /* seconds */
 #define AVERAGE_CHANS         -1      /* average input chans flag value */
@@ -40,8 +38,10 @@
 
 MROOM::MROOM() : Instrument()
 {
-   in = NULL;
-   delayline = rvbarrayl = rvbarrayr = NULL;
+   in = tapin = rvbarrayl = rvbarrayr = NULL;
+   for (int n = 0; n < 4; n++)
+      tapout[n] = NULL;
+   taps = NULL;
    branch = quantbranch = 0;
 }
 
@@ -49,7 +49,10 @@ MROOM::MROOM() : Instrument()
 MROOM::~MROOM()
 {
    delete [] in;
-   delete [] delayline;
+   delete [] tapin;
+   for (int n = 0; n < 4; n++)
+      delete [] tapout[n];
+   delete taps;
    delete [] rvbarrayl;
    delete [] rvbarrayr;
 }
@@ -98,9 +101,7 @@ int MROOM::init(double p[], int n_args)
    tableset(SR, dur, POS_ARRAY_SIZE, xpostabs);
    tableset(SR, dur, POS_ARRAY_SIZE, ypostabs);
 
-   int delsamps = (int)(MAX_DELAY * SR + 0.5);
-   delayline = new float[delsamps];
-   delset(SR, delayline, deltabs, MAX_DELAY);
+   taps = new Omultitap((int)(MAX_DELAY * SR + 0.5) - 1, NTAPS, 4);
 
    /* Array dimensions taken from lib/rvbset.c (+ 2 extra for caution). */
    int rvbsamps = (int)((0.1583 * SR) + 18 + 2);
@@ -129,6 +130,9 @@ int MROOM::init(double p[], int n_args)
 int MROOM::configure()
 {
    in = new float [RTBUFSAMPS * inputChannels()];
+   tapin = new float [RTBUFSAMPS];
+   for (int n = 0; n < 4; n++)
+      tapout[n] = new float [RTBUFSAMPS];
    return in ? 0 : -1;
 }
 
@@ -136,31 +140,38 @@ int MROOM::configure()
 /* ------------------------------------------------------------------ run --- */
 int MROOM::run()
 {
-   const int samps = framesToRun() * inputChannels();
+   const int frames = framesToRun();
+   const int inchans = inputChannels();
 
-   rtgetin(in, this, samps);
+   rtgetin(in, this, frames * inchans);
 
-   for (int i = 0; i < samps; i += inputChannels()) {
-      float insig, delval = 0.0, rvbsig = 0.0;
+   int start = 0;          /* first frame not yet through the taps */
+   for (int n = 0, i = 0; n < frames; n++, i += inchans) {
+      const int frame = currentFrame() + n;
+      float insig;
 
-      if (currentFrame() < insamps) {        /* still taking input */
+      if (frame < insamps) {                 /* still taking input */
          if (--branch <= 0) {
             if (amparray)
-               aamp = tablei(currentFrame(), amparray, amptabs) * ovamp;
+               aamp = tablei(frame, amparray, amptabs) * ovamp;
             branch = skip;
          }
          if (--quantbranch <= 0) {
-            float xposit = tablei(currentFrame(), xpos, xpostabs);
-            float yposit = tablei(currentFrame(), ypos, ypostabs);
+            /* Frames before this one get the old geometry. */
+            runTaps(start, n);
+            start = n;
+            float xposit = tablei(frame, xpos, xpostabs);
+            float yposit = tablei(frame, ypos, ypostabs);
             distndelset(xposit, yposit, xdim, ydim, innerwidth, reflect);
+            setTaps();
             quantbranch = quantskip;
          }
 
          if (inchan == AVERAGE_CHANS) {
             insig = 0.0;
-            for (int n = 0; n < inputChannels(); n++)
-               insig += in[i + n];
-            insig /= (float)inputChannels();
+            for (int c = 0; c < inchans; c++)
+               insig += in[i + c];
+            insig /= (float)inchans;
          }
          else
             insig = in[i + inchan];
@@ -169,37 +180,14 @@ int MROOM::run()
       else                                   /* in ring-down phase */
          insig = 0.0;
 
-      DELPUT(insig, delayline, deltabs);
-
-      float rout = 0.0;
-      for (int m = 1; m < NTAPS; m += 2) {
-#ifdef INTERP_GET
-         DLIGET(delayline, del[m], deltabs, delval);
-#else
-         DELGET(delayline, del[m], deltabs, delval);
-#endif
-         rout += delval * amp[m];
-         if (m < 2)
-            rvbsig = -rout;
-      }
-      rvbsig += rout;
+      tapin[n] = insig;
+   }
+   runTaps(start, frames);
 
+   for (int n = 0; n < frames; n++) {
       float out[2];
-      out[0] = rout + reverb(rvbsig, rvbarrayr);
-
-      float lout = 0.0;
-      for (int m = 0; m < NTAPS; m += 2) {
-#ifdef INTERP_GET
-         DLIGET(delayline, del[m], deltabs, delval);
-#else
-         DELGET(delayline, del[m], deltabs, delval);
-#endif
-         lout += delval * amp[m];
-         if (m < 2)
-            rvbsig = -lout;
-      }
-      rvbsig += lout;
-      out[1] = lout + reverb(rvbsig, rvbarrayl);
+      out[0] = tapout[0][n] + reverb(tapout[2][n], rvbarrayr);
+      out[1] = tapout[1][n] + reverb(tapout[3][n], rvbarrayl);
 
       rtaddout(out);
       increment();
@@ -209,6 +197,40 @@ int MROOM::run()
 }
 
 
+/* -------------------------------------------------------------- setTaps --- */
+/* Odd taps go right, even taps left, and each side's reverb gets that
+   side's taps but the first (the direct sound).  The interpolating delay
+   fetch this replaces read one sample short of del[m].
+*/
+void MROOM::setTaps()
+{
+   const double maxdelay = (int)(MAX_DELAY * SR + 0.5) - 1;
+   for (int m = 0; m < NTAPS; m++) {
+      float gains[4] = { 0.0, 0.0, 0.0, 0.0 };
+      const int side = (m & 1) ? 0 : 1;
+      const double delay = del[m] * SR - 1.0;
+      if (delay <= maxdelay) {               /* else past end of line */
+         gains[side] = amp[m];
+         if (m >= 2)
+            gains[side + 2] = amp[m];
+      }
+      taps->setTap(m, delay, gains);
+   }
+}
+
+
+/* -------------------------------------------------------------- runTaps --- */
+void MROOM::runTaps(int start, int end)
+{
+   if (end > start) {
+      float *outs[4];
+      for (int n = 0; n < 4; n++)
+         outs[n] = &tapout[n][start];
+      taps->process(&tapin[start], outs, end - start);
+   }
+}
+
+
 /* -------------------------------------------------------------- traject --- */
 void MROOM::traject(int ntimes)
 {
@@ -4,16 +4,18 @@ extern "C" {
 
 #define NTAPS 10
 
+class Omultitap;
+
 class MROOM : public Instrument {
    int    inchan, insamps, skip, branch, quantbranch, quantskip;
-   int    deltabs[3];
    float  aamp, ovamp, xdim, ydim, reflect, innerwidth;
    float  del[NTAPS], amp[NTAPS];
    float  timepts[TIME_ARRAY_SIZE];
    float  xvals[TIME_ARRAY_SIZE], yvals[TIME_ARRAY_SIZE];
    double xpos[POS_ARRAY_SIZE], ypos[POS_ARRAY_SIZE];
    float  amptabs[2], xpostabs[2], ypostabs[2];
-   float  *in, *delayline, *rvbarrayl, *rvbarrayr;
+   float  *in, *tapin, *tapout[4], *rvbarrayl, *rvbarrayr;
+   Omultitap *taps;
    double *amparray;
 
 public:
@@ -24,6 +26,8 @@ public:
    virtual int run();
 private:
    void traject(int);
+   void setTaps();
+   void runTaps(int, int);
    float distndelset(float, float, float, float, float, float);
 };
 
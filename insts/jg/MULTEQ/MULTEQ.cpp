@@ -206,8 +206,10 @@ void MULTEQ :: doupdate()
       float gain = p[i + 3];
       bool bypass = (bool) p[i + 4];
 
-      for (int c = 0; c < inputChannels(); c++)
-         eq[band + c]->setparams(type, freq, Q, gain, bypass);
+      // Every channel's band has the same settings.
+      eq[band]->setparams(type, freq, Q, gain, bypass);
+      for (int c = 1; c < inputChannels(); c++)
+         eq[band + c]->copyparams(*eq[band], bypass);
    }
 }
 
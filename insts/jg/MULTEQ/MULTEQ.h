@@ -28,6 +28,22 @@ public:
       }
       _bypass = bypass;
    }
+   // Take the settings of <other>, copying its coefficients rather than
+   // working them out again.
+   inline void copyparams(const EQBand &other, bool bypass) {
+      if (other._type != _type || other._freq != _freq || other._Q != _Q
+                                                || other._gain != _gain) {
+         _type = other._type;
+         _freq = other._freq;
+         _Q = other._Q;
+         _gain = other._gain;
+         float c[5];
+         other._eq->getcoeffs(c);
+         _eq->settype(_type);
+         _eq->setcoeffs(c);
+      }
+      _bypass = bypass;
+   }
    inline float next(float sig) { return _bypass ? sig : _eq->next(sig); }
 };
 
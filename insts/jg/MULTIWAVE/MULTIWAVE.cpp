@@ -40,18 +40,15 @@ MULTIWAVE::MULTIWAVE() : Instrument()
    branch = 0;
    numpartials = 0;
    oscil = NULL;
-   amp = NULL;
-   pan = NULL;
+   outbuf[0] = outbuf[1] = NULL;
 }
 
 
 MULTIWAVE::~MULTIWAVE()
 {
-   for (int i = 0; i < numpartials; i++)
-      delete oscil[i];
-   delete [] oscil;
-   delete [] amp;
-   delete [] pan;
+   delete oscil;
+   delete [] outbuf[0];
+   delete [] outbuf[1];
 }
 
 
@@ -83,17 +80,14 @@ int MULTIWAVE::init(double p[], int n_args)
       return die("MULTIWAVE", "p3 must be wavetable (use maketable)");
 
    numpartials = (nargs - FIRST_FREQ_ARG) / 4;
-   oscil = new Ooscili * [numpartials];
-   amp = new double [numpartials];
-   pan = new double [numpartials];
-
+   oscil = new Ooscilbank(SR, numpartials, wavet, wavelen);
    for (int i = 0; i < numpartials; i++) {
-      oscil[i] = new Ooscili(SR, 440.0, wavet, wavelen);
       const int index = FIRST_FREQ_ARG + (4 * i);
-      oscil[i]->setphase(p[index + 2] / 360.0);
-      amp[i] = 0.0;
-      pan[i] = 0.0;
+      oscil->setfreq(i, 440.0);
+      oscil->setphase(i, p[index + 2] / 360.0);
    }
+   for (int j = 0; j < outputChannels(); j++)
+      outbuf[j] = new float [RTBUFSAMPS];
 
    return nSamps();
 }
@@ -108,43 +102,44 @@ void MULTIWAVE::doupdate()
 
    for (int i = 0; i < numpartials; i++) {
       const int index = FIRST_FREQ_ARG + (4 * i);
-      oscil[i]->setfreq(p[index]);
-      amp[i] = p[index + 1];
-      pan[i] = p[index + 3];
+      oscil->setfreq(i, p[index]);
+      oscil->setamp(i, p[index + 1]);
+      oscil->setpan(i, p[index + 3]);
    }
 }
 
 
+// The partials are rendered together a block at a time, up to the next
+// control update (<branch> counts the frames until then).
+
 int MULTIWAVE::run()
 {
    const int samps = framesToRun();
    const int chans = outputChannels();
    float out[chans];
 
-   for (int i = 0; i < samps; i++) {
-      if (--branch <= 0) {
+   int i = 0;
+   while (i < samps) {
+      if (branch <= 0) {
          doupdate();
          branch = getSkip();
       }
+      const int count = (samps - i < branch) ? samps - i : branch;
 
-      for (int j = 0; j < chans; j++)
-         out[j] = 0.0f;
-
-      for (int j = 0; j < numpartials; j++) {
-         float sig = oscil[j]->next() * amp[j];
-         if (chans == 1)
-            out[0] += sig;
-         else {
-            out[0] += sig * pan[j];
-            out[1] += sig * (1.0 - pan[j]);
-         }
-      }
-      float scale = (1.0 / float(numpartials)) * (overall_amp * chans);
-      for (int j = 0; j < chans; j++)
-         out[j] *= scale;
+      if (chans == 1)
+         oscil->nextBlock(outbuf[0], count);
+      else
+         oscil->nextBlock(outbuf[0], outbuf[1], count);
 
-      rtaddout(out);
-      increment();
+      float scale = (1.0 / float(numpartials)) * (overall_amp * chans);
+      for (int k = 0; k < count; k++) {
+         for (int j = 0; j < chans; j++)
+            out[j] = outbuf[j][k] * scale;
+         rtaddout(out);
+         increment();
+      }
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
@@ -1,10 +1,10 @@
-class Ooscili;
+class Ooscilbank;
 
 class MULTIWAVE : public Instrument {
    int     nargs, branch, numpartials;
    double  overall_amp;
-   double  *amp, *pan;
-   Ooscili **oscil;
+   float   *outbuf[2];
+   Ooscilbank *oscil;
 
    int usage();
    void doupdate();
@@ -73,6 +73,7 @@
 #include <ugens.h>
 #include <Instrument.h>
 #include <PField.h>
+#include <Ougens.h>
 #include "NPAN.h"
 #include <rt.h>
 #include <rtdefs.h>
@@ -81,11 +82,13 @@
 
 #define TWO_PI       (M_PI * 2.0)
 #define PI_OVER_2    (M_PI / 2.0)
+#define NPAN_CHUNK   256
 
 
 NPAN::NPAN() : Instrument()
 {
    in = NULL;
+   matrix = NULL;
    num_speakers = 0;
    prev_angle = -DBL_MAX;
    src_x = DBL_MAX;
@@ -97,6 +100,7 @@ NPAN::NPAN() : Instrument()
 NPAN::~NPAN()
 {
    delete [] in;
+   delete matrix;
    for (int i = 0; i < num_speakers; i++)
       delete speakers[i];
 }
@@ -168,6 +172,9 @@ int NPAN::init(double p[], int n_args)
 
    skip = (int) (SR / (float) resetval);
 
+   matrix = new Ogainmatrix(1, num_speakers);
+   setPlanarOutput();      // we write a channel at a time
+
    return nSamps();
 }
 
@@ -258,6 +265,14 @@ void NPAN::doupdate()
          setgains();
       }
    }
+
+   // The matrix glides to these over the next block, except at the start.
+   float gains[MAX_SPEAKERS];
+   for (int j = 0; j < num_speakers; j++)
+      gains[speakers[j]->channel()] = speakers[j]->gain() * amp;
+   matrix->setgains(0, gains);
+   if (currentFrame() == 0)
+      matrix->jump();
 }
 
 
@@ -270,24 +285,41 @@ int NPAN::configure()
 
 int NPAN::run()
 {
+   const int nframes = framesToRun();
    const int outchans = outputChannels();
-   float out[outchans];
-   const int samps = framesToRun() * inputChannels();
 
-   rtgetin(in, this, samps);
-
-   for (int i = 0; i < samps; i += inputChannels()) {
-      if (--branch <= 0) {
+   // Read our one input channel where it is, rather than having it copied.
+   InputChannel chans[MAXBUS];
+   rtgetinchans(chans, in, nframes * inputChannels());
+   const InputChannel &inp = chans[inchan];
+
+   float insig[NPAN_CHUNK];
+   const float *ins[1] = { insig };
+   BUFTYPE *outs[MAX_SPEAKERS];
+   int i = 0;
+   while (i < nframes) {
+      if (branch <= 0) {
          doupdate();
          branch = skip;
       }
-      float insig = in[i + inchan] * amp;
+      int count = nframes - i;
+      if (count > branch)
+         count = branch > 0 ? branch : 1;
+      if (count > NPAN_CHUNK)
+         count = NPAN_CHUNK;
+
+      for (int j = 0; j < count; j++)
+         insig[j] = inp.samps[(i + j) * inp.stride];
 
+      int stride = 1;
       for (int j = 0; j < outchans; j++)
-         out[speakers[j]->channel()] = insig * speakers[j]->gain();
+         outs[j] = outputChannel(j, &stride);
+      matrix->process(ins, outs, stride, count);
 
-      rtaddout(out);
-      increment();
+      advanceOutput(count);
+      increment(count);
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
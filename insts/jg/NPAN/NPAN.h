@@ -1,5 +1,7 @@
 #include "speakers.h"
 
+class Ogainmatrix;
+
 class NPAN : public Instrument {
    enum { PolarMode = 0, CartesianMode = 1 };
 
@@ -7,6 +9,7 @@ class NPAN : public Instrument {
    double  amp, prev_angle, src_angle, src_distance, min_distance, src_x, src_y;
    Speaker *speakers[MAX_SPEAKERS];
    float   *in;
+   Ogainmatrix *matrix;
 
    int usage();
    int getmode();
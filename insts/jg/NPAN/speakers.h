@@ -1,6 +1,6 @@
 #include <math.h>    // for M_PI
 
-#define MAX_SPEAKERS 16
+#define MAX_SPEAKERS 64
 
 class Speaker {
 public:
@@ -35,17 +35,21 @@
 #include <math.h>
 #include <ugens.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "PAN.h"
 #include <rt.h>
 #include <rtdefs.h>
 
 //#define DEBUG
 
+#define PAN_CHUNK    256
+
 
 PAN :: PAN() : Instrument()
 {
    in = NULL;
    panarray = NULL;
+   matrix = NULL;
    branch = 0;
    prevpan = -1.0;
 }
@@ -54,6 +58,7 @@ PAN :: PAN() : Instrument()
 PAN :: ~PAN()
 {
    delete [] in;
+   delete matrix;
 }
 
 
@@ -94,6 +99,9 @@ int PAN :: init(double p[], int n_args)
 
    skip = (int) (SR / (float) resetval);
 
+   matrix = new Ogainmatrix(1, 2);
+   setPlanarOutput();      // we write a channel at a time
+
    return nSamps();
 }
 
@@ -134,6 +142,12 @@ void PAN :: doupdate()
                            newpan, pan[0], pan[1], pan[0] + pan[1]);
 #endif
    }
+
+   // The matrix glides to these over the next block, except at the start.
+   matrix->setgain(0, 0, pan[0] * amp);
+   matrix->setgain(0, 1, pan[1] * amp);
+   if (currentFrame() == 0)
+      matrix->jump();
 }
 
 
@@ -146,23 +160,41 @@ int PAN :: configure()
 
 int PAN :: run()
 {
-   const int samps = framesToRun() * inputChannels();
-
-   rtgetin(in, this, samps);
-
-   for (int i = 0; i < samps; i += inputChannels()) {
-      if (--branch <= 0) {
+   const int nframes = framesToRun();
+   const int outchans = outputChannels();
+
+   // Read our one input channel where it is, rather than having it copied.
+   InputChannel chans[MAXBUS];
+   rtgetinchans(chans, in, nframes * inputChannels());
+   const InputChannel &inp = chans[inchan];
+
+   float insig[PAN_CHUNK];
+   const float *ins[1] = { insig };
+   BUFTYPE *outs[2];
+   int i = 0;
+   while (i < nframes) {
+      if (branch <= 0) {
          doupdate();
          branch = skip;
       }
-      float insig = in[i + inchan] * amp;
-
-      float out[2];
-      out[0] = insig * pan[0];
-      out[1] = insig * pan[1];
-
-      rtaddout(out);
-      increment();
+      int count = nframes - i;
+      if (count > branch)
+         count = branch > 0 ? branch : 1;
+      if (count > PAN_CHUNK)
+         count = PAN_CHUNK;
+
+      for (int j = 0; j < count; j++)
+         insig[j] = inp.samps[(i + j) * inp.stride];
+
+      int stride = 1;
+      for (int j = 0; j < outchans; j++)
+         outs[j] = outputChannel(j, &stride);
+      matrix->process(ins, outs, stride, count);
+
+      advanceOutput(count);
+      increment(count);
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
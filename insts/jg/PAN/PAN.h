@@ -1,8 +1,11 @@
+class Ogainmatrix;
+
 class PAN : public Instrument {
    int     nargs, inchan, skip, branch;
    float   amp, prevpan, pan[2];
    float   *in, amptabs[2], pantabs[2];
    double  *amparray, *panarray;
+   Ogainmatrix *matrix;
 
    void doupdate();
 public:
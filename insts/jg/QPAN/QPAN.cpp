@@ -23,6 +23,7 @@
 #include <float.h>   // for DBL_MAX
 #include <ugens.h>
 #include <PField.h>
+#include <Ougens.h>
 #include "QPAN.h"
 #include <rt.h>
 #include <rtdefs.h>
@@ -30,11 +31,13 @@
 //#define DEBUG
 
 #define PI_OVER_4    (M_PI / 4.0)
+#define QPAN_CHUNK   256
 
 
 QPAN::QPAN()
 {
    in = NULL;
+   matrix = NULL;
    branch = 0;
    src_x = DBL_MAX;
    src_y = DBL_MAX;
@@ -50,6 +53,7 @@ QPAN::QPAN()
 QPAN::~QPAN()
 {
    delete [] in;
+   delete matrix;
 }
 
 
@@ -81,6 +85,9 @@ int QPAN::init(double p[], int n_args)
       return die("QPAN", "You asked for channel %d of %d-channel input.",
                                                    inchan, inputChannels());
 
+   matrix = new Ogainmatrix(1, 4);
+   setPlanarOutput();      // we write a channel at a time
+
    return nSamps();
 }
 
@@ -129,6 +136,12 @@ void QPAN::doupdate()
              gains[0], gains[1], gains[2], gains[3]);
 #endif
    }
+
+   // The matrix glides to these over the next block, except at the start.
+   for (int j = 0; j < 4; j++)
+      matrix->setgain(0, j, gains[j] * amp);
+   if (currentFrame() == 0)
+      matrix->jump();
 }
 
 
@@ -141,25 +154,41 @@ int QPAN::configure()
 
 int QPAN::run()
 {
-   float out[outputChannels()];
-   const int inchans = inputChannels();
+   const int nframes = framesToRun();
    const int outchans = outputChannels();
-   const int samps = framesToRun() * inchans;
 
-   rtgetin(in, this, samps);
-
-   for (int i = 0; i < samps; i += inchans) {
-      if (--branch <= 0) {
+   // Read our one input channel where it is, rather than having it copied.
+   InputChannel chans[MAXBUS];
+   rtgetinchans(chans, in, nframes * inputChannels());
+   const InputChannel &inp = chans[inchan];
+
+   float insig[QPAN_CHUNK];
+   const float *ins[1] = { insig };
+   BUFTYPE *outs[4];
+   int i = 0;
+   while (i < nframes) {
+      if (branch <= 0) {
          doupdate();
          branch = getSkip();
       }
-      float insig = in[i + inchan] * amp;
+      int count = nframes - i;
+      if (count > branch)
+         count = branch > 0 ? branch : 1;
+      if (count > QPAN_CHUNK)
+         count = QPAN_CHUNK;
+
+      for (int j = 0; j < count; j++)
+         insig[j] = inp.samps[(i + j) * inp.stride];
 
+      int stride = 1;
       for (int j = 0; j < outchans; j++)
-         out[j] = insig * gains[j];
+         outs[j] = outputChannel(j, &stride);
+      matrix->process(ins, outs, stride, count);
 
-      rtaddout(out);
-      increment();
+      advanceOutput(count);
+      increment(count);
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
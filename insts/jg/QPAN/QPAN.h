@@ -1,10 +1,13 @@
 #include <Instrument.h>
 
+class Ogainmatrix;
+
 class QPAN : public Instrument {
    int     inchan, branch;
    double  amp, src_x, src_y, gains[4];
    double  speaker_angles[4];
    float   *in;
+   Ogainmatrix *matrix;
 
    int usage();
    void doupdate();
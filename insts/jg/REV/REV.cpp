@@ -96,12 +96,16 @@ int REV :: init(double p[], int n_args)
       tableset(SR, dur, lenamp, amptabs);
    }
 
+   sleepWhenSilent(insamps, (int) reverb->pathLength());
+
    return nSamps();
 }
 
 
 int REV :: configure()
 {
+   if (readsInputInPlace())
+      return 0;
    in = new float [RTBUFSAMPS * inputChannels()];
    return in ? 0 : -1;
 }
@@ -111,8 +115,15 @@ int REV :: run()
 {
    int samps = framesToRun() * inputChannels();
 
-   if (currentFrame() < insamps)
-      rtgetin(in, this, samps);
+   // Read our one input channel where it is, rather than having it copied.
+   const BUFTYPE *inp = NULL;
+   int stride = 0;
+   if (currentFrame() < insamps) {
+      InputChannel chans[MAXBUS];
+      rtgetinchans(chans, in, samps);
+      inp = chans[inchan].samps;
+      stride = chans[inchan].stride;
+   }
 
    for (int i = 0; i < samps; i += inputChannels()) {
       if (--branch <= 0) {
@@ -126,11 +137,12 @@ int REV :: run()
 
       float insig;
       if (cursamp < insamps)                 // still taking input from file
-         insig = in[i + inchan] * amp;
+         insig = *inp * amp;
       else                                   // in ring-down phase
          insig = 0.0;
 
       reverb->tick(insig);
+      inp += stride;
 
       float out[2];
       if (outputChannels() == 2) {
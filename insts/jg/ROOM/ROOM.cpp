@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <ugens.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "ROOM.h"
 #include <rt.h>
 #include <rtdefs.h>
@@ -12,8 +13,8 @@
 
 ROOM::ROOM() : Instrument()
 {
-   in = NULL;
-   echo = NULL;
+   in = tapin = tapout[0] = tapout[1] = NULL;
+   taps = NULL;
    branch = 0;
 }
 
@@ -21,7 +22,10 @@ ROOM::ROOM() : Instrument()
 ROOM::~ROOM()
 {
    delete [] in;
-   delete [] echo;
+   delete [] tapin;
+   delete [] tapout[0];
+   delete [] tapout[1];
+   delete taps;
 }
 
 
@@ -46,14 +50,20 @@ int ROOM::init(double p[], int n_args)
    if (inputChannels() == 1)
       inchan = 0;
 
-   nmax = get_room(ipoint, lamp, ramp, SR);
+   int ipoint[NTAPS];
+   float lamp[NTAPS], ramp[NTAPS];
+   int nmax = get_room(ipoint, lamp, ramp, SR);
    if (nmax == 0)
       return die("ROOM", "You need to call roomset before ROOM.");
 
-   echo = new float[nmax];
-   for (int i = 0; i < nmax; i++)
-      echo[i] = 0.0;
-   jpoint = 0;
+   /* get_room gives each tap as a read point trailing the write point, which
+      starts at 0, in a line of <nmax> samples.
+   */
+   taps = new Omultitap(nmax, NTAPS, 2);
+   for (int j = 0; j < NTAPS; j++) {
+      const float gains[2] = { lamp[j], ramp[j] };
+      taps->setTap(j, (nmax - ipoint[j]) % nmax, gains);
+   }
 
 #ifdef DEBUG
    printf("maximum delay = %d samples.\n", nmax);
@@ -81,52 +91,50 @@ int ROOM::init(double p[], int n_args)
 int ROOM::configure()
 {
    in = new float [RTBUFSAMPS * inputChannels()];
+   tapin = new float [RTBUFSAMPS];
+   tapout[0] = new float [RTBUFSAMPS];
+   tapout[1] = new float [RTBUFSAMPS];
    return in ? 0 : -1;
 }
 
 
 int ROOM::run()
 {
-   const int samps = framesToRun() * inputChannels();
-
-   rtgetin(in, this, samps);
+   const int frames = framesToRun();
+   const int inchans = inputChannels();
 
-   for (int i = 0; i < samps; i += inputChannels()) {
-      if (--branch <= 0) {
-         if (amparray)
-            aamp = tablei(currentFrame(), amparray, amptabs) * amp;
-         branch = skip;
-      }
+   rtgetin(in, this, frames * inchans);
 
+   for (int n = 0, i = 0; n < frames; n++, i += inchans) {
       float insig;
-      if (currentFrame() < insamps) {        /* still taking input */
+      if (currentFrame() + n < insamps) {    /* still taking input */
          if (inchan == AVERAGE_CHANS) {
             insig = 0.0;
-            for (int n = 0; n < inputChannels(); n++)
-               insig += in[i + n];
-            insig /= (float) inputChannels();
+            for (int c = 0; c < inchans; c++)
+               insig += in[i + c];
+            insig /= (float) inchans;
          }
          else
             insig = in[i + inchan];
       }
       else                                   /* in ring-down phase */
          insig = 0.0;
+      tapin[n] = insig;
+   }
 
-      echo[jpoint++] = insig;
-      if (jpoint >= nmax)
-         jpoint -= nmax;
+   taps->process(tapin, tapout, frames);
 
-      float out[2];
-      out[0] = out[1] = 0.0;
-      for (int j = 0; j < NTAPS; j++) {
-         float e = echo[ipoint[j]];
-         out[0] += e * lamp[j];
-         out[1] += e * ramp[j];
-         ipoint[j]++;
-         if (ipoint[j] >= nmax)
-            ipoint[j] -= nmax;
+   for (int n = 0; n < frames; n++) {
+      if (--branch <= 0) {
+         if (amparray)
+            aamp = tablei(currentFrame(), amparray, amptabs) * amp;
+         branch = skip;
       }
 
+      float out[2];
+      out[0] = tapout[0][n];
+      out[1] = tapout[1][n];
+
       if (aamp != 1.0) {
          out[0] *= aamp;
          out[1] *= aamp;
@@ -2,12 +2,13 @@ extern "C" {
    #include "roomset.h"          /* only for NTAPS */
 }
 
+class Omultitap;
+
 class ROOM : public Instrument {
    int    inchan, insamps, skip, branch;
-   int    nmax, jpoint, ipoint[NTAPS];
-   float  lamp[NTAPS], ramp[NTAPS];
    float  amp, aamp;
-   float  *in, *echo, amptabs[2];
+   float  *in, *tapin, *tapout[2], amptabs[2];
+   Omultitap *taps;
    double *amparray;
 
 public:
@@ -16,6 +16,7 @@
    p9 = reference to waveshaping transfer function table [optional; if missing,
         must use gen 2] ***
    p10 = index guide [optional; if missing, can use gen 3] ****
+   p11 = oversampling factor (1, 2, 4 or 8) [optional, default is 1]
 
    p3 (amplitude), p4 (min index), p5 (max index), p8 (pan) and p10 (index)
    can receive dynamic updates from a table or real-time control source.
@@ -30,6 +31,11 @@
    moves lower (see SHAPE2.sco) for the higher signal amplitudes.  This will
    keep the bright and dark timbres more equal in amplitude.
 
+   Oversampling runs the transfer function at 2, 4 or 8 times the sampling
+   rate, so that at high distortion indices the harmonics above the Nyquist
+   frequency are filtered out rather than folded back down.  It delays the
+   output by 31 samples.
+
    ----
 
    Notes about backward compatibility with pre-v4 scores:
@@ -55,6 +61,7 @@
 #include <math.h>
 #include <Instrument.h>
 #include <PField.h>
+#include <Ougens.h>
 #include "SHAPE.h"
 #include <rt.h>
 #include <rtdefs.h>
@@ -66,6 +73,7 @@ SHAPE :: SHAPE() : Instrument()
    amp_table = NULL;
    ampnorm = NULL;
    index_table = NULL;
+   oversamp = NULL;
    norm_index = 0.0;
    branch = 0;
 }
@@ -79,6 +87,7 @@ SHAPE :: ~SHAPE()
    delete shaper;
    delete ampnorm;
    delete dcblocker;
+   delete oversamp;
 }
 
 
@@ -167,6 +176,12 @@ int SHAPE :: init(double p[], int n_args)
 
    dcblocker = new DCBlock();
 
+   const int factor = n_args > 11 ? (int) p[11] : 1;
+   if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+      return die("SHAPE", "Oversampling factor must be 1, 2, 4 or 8.");
+   if (factor > 1)
+      oversamp = new Ooversample(factor);
+
    skip = (int) (SR / (float) resetval);
 
    return nSamps();
@@ -224,7 +239,16 @@ int SHAPE :: run()
 
       // NB: WavShape deals with samples in range [-1, 1].
       float insig = in[i + inchan] * (1.0 / 32768.0);
-      float outsig = shaper->tick(insig * index);
+      float outsig;
+      if (oversamp) {
+         float buf[Ooversample::kMaxFactor];
+         oversamp->up(insig * index, buf);
+         for (int j = 0; j < oversamp->factor(); j++)
+            buf[j] = shaper->tick(buf[j]);
+         outsig = oversamp->down(buf);
+      }
+      else
+         outsig = shaper->tick(insig * index);
       if (outsig) {
          if (ampnorm)
             outsig = dcblocker->tick(outsig) * ampnorm->tick(norm_index);
@@ -1,5 +1,7 @@
 #include <objlib.h>
 
+class Ooversample;
+
 class SHAPE : public Instrument {
    int      nargs, inchan, skip, branch;
    float    amp, index, min_index, max_index, norm_index, pctleft;
@@ -7,6 +9,7 @@ class SHAPE : public Instrument {
    TableL   *amp_table, *index_table;
    WavShape *shaper, *ampnorm;
    DCBlock  *dcblocker;
+   Ooversample *oversamp;
 
    void doupdate();
 public:
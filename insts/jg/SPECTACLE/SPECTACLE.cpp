@@ -60,6 +60,12 @@
 /* ------------------------------------------------------------- SPECTACLE -- */
 SPECTACLE :: SPECTACLE()
 {
+   eqtable = deltimetable = feedbacktable = NULL;
+   eqgain = NULL;
+   delsamps = NULL;
+   delayed_bands = NULL;
+   num_delayed_bands = 0;
+   phase_delay = mag_delay = NULL;
 }
 
 
@@ -69,12 +75,17 @@ SPECTACLE :: ~SPECTACLE()
    delete [] eqtable;
    delete [] deltimetable;
    delete [] feedbacktable;
-   for (int i = 0; i < half_fft_len; i++) {
-      if (mag_delay[i])
+   delete [] eqgain;
+   delete [] delsamps;
+   delete [] delayed_bands;
+   if (mag_delay) {
+      for (int i = 0; i < half_fft_len; i++) {
          delete mag_delay[i];
-      if (phase_delay[i])
          delete phase_delay[i];
+      }
    }
+   delete [] mag_delay;
+   delete [] phase_delay;
 }
 
 
@@ -96,6 +107,10 @@ int SPECTACLE :: pre_init(double p[], int n_args)
    else
       return die(instname(), "You haven't made the EQ function (table 3).");
 
+   eqgain = new double [half_fft_len];
+   for (int i = 0; i < half_fft_len; i++)
+      eqgain[i] = ampdb(eqtable[i]);
+
    deltimetable = floc(4);
    if (deltimetable) {
       int len = fsize(4);
@@ -108,10 +123,17 @@ int SPECTACLE :: pre_init(double p[], int n_args)
    /* Compute maximum delay lag and create delay lines for FFT magnitude
       and phase values.  Make ringdur at least as long as the longest
       delay time.  Remember that these delays function at the decimation
-      rate, not at audio rate.
+      rate, not at audio rate.  Only bands with a delay get delay lines;
+      modify_analysis just scales the others.
    */
    long maxdelsamps = (long) (MAXDELTIME * SR / decimation + 0.5);
    float maxtime = 0.0;
+   delsamps = new long [half_fft_len];
+   delayed_bands = new int [half_fft_len];
+   mag_delay = new DLineN * [half_fft_len];
+   phase_delay = new DLineN * [half_fft_len];
+   for (int i = 0; i < half_fft_len; i++)
+      mag_delay[i] = phase_delay[i] = NULL;
    for (int i = 0; i < half_fft_len; i++) {
       float deltime = deltimetable[i];
       if (deltime < 0.0 || deltime > MAXDELTIME)
@@ -119,6 +141,21 @@ int SPECTACLE :: pre_init(double p[], int n_args)
                                                                   MAXDELTIME);
       float samps = deltime * SR / (float) decimation;
       assert(samps <= maxdelsamps);
+      if (deltime == 0.0) {
+         delsamps[i] = -1;
+         continue;
+      }
+      delsamps[i] = (long)(deltime * SR + 0.5) / decimation;
+
+      /* Not sure why this is necessary, but without it, delayed copies
+         sound distorted.
+      */
+      if (int_overlap > 1) {
+         int remainder = delsamps[i] % int_overlap;
+         if (remainder)
+            delsamps[i] -= remainder;
+      }
+      delayed_bands[num_delayed_bands++] = i;
       mag_delay[i] = new DLineN(maxdelsamps);
       phase_delay[i] = new DLineN(maxdelsamps);
       if (deltime > maxtime)
@@ -177,48 +214,34 @@ void SPECTACLE :: modify_analysis()
    dump_anal_channels();
 #endif
 
-   for (int i = 0; i < half_fft_len; i++) {
-      float mag, phase;
-      int index = i * 2;
-
-      if (reading_input) {
-         mag = anal_chans[index];
-         phase = anal_chans[index + 1];
-         mag *= ampdb(eqtable[i]);
-      }
-      else {
-         mag = 0.0;
-         phase = anal_chans[index + 1];
-      }
+   /* EQ every band in one pass, then run the delayed bands through their
+      delay lines.
+   */
+   if (reading_input) {
+      for (int i = 0; i < half_fft_len; i++)
+         anal_chans[i * 2] *= eqgain[i];
+   }
+   else {
+      for (int i = 0; i < half_fft_len; i++)
+         anal_chans[i * 2] = 0.0;
+   }
 
-      float deltime = deltimetable[i];
-      if (deltime == 0.0) {
-         anal_chans[index] = mag;
-         anal_chans[index + 1] = phase;
-      }
-      else {
-         long delsamps = (long)(deltime * SR + 0.5) / decimation;
-
-         /* Not sure why this is necessary, but without it, delayed copies
-            sound distorted.
-         */
-         if (int_overlap > 1) {
-            int remainder = delsamps % int_overlap;
-            if (remainder)
-               delsamps -= remainder;
-         }
-
-         float newmag = mag_delay[i]->getSample(delsamps);
-         float newphase = phase_delay[i]->getSample(delsamps);
-         anal_chans[index] = newmag;
-         anal_chans[index + 1] = newphase;
-         mag_delay[i]->putSample(mag + (newmag * feedbacktable[i]));
-
-         if (reading_input)
-            phase_delay[i]->putSample(phase);
-         else
-            phase_delay[i]->putSample(newphase);
-      }
+   for (int j = 0; j < num_delayed_bands; j++) {
+      int i = delayed_bands[j];
+      int index = i * 2;
+      float mag = anal_chans[index];
+      float phase = anal_chans[index + 1];
+
+      float newmag = mag_delay[i]->getSample(delsamps[i]);
+      float newphase = phase_delay[i]->getSample(delsamps[i]);
+      anal_chans[index] = newmag;
+      anal_chans[index + 1] = newphase;
+      mag_delay[i]->putSample(mag + (newmag * feedbacktable[i]));
+
+      if (reading_input)
+         phase_delay[i]->putSample(phase);
+      else
+         phase_delay[i]->putSample(newphase);
    }
 }
 
@@ -3,7 +3,10 @@
 class SPECTACLE : public SPECTACLE_BASE {
 
    double   *eqtable, *deltimetable, *feedbacktable;
-   DLineN   *phase_delay[MAXFFTLEN / 2], *mag_delay[MAXFFTLEN / 2];
+   double   *eqgain;          /* linear gain of each band */
+   long     *delsamps;        /* delay of each band, in frames */
+   int      *delayed_bands, num_delayed_bands;
+   DLineN   **phase_delay, **mag_delay;
 
 public:
    SPECTACLE();
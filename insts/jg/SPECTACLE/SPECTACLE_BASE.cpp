@@ -11,6 +11,8 @@
 SPECTACLE_BASE :: SPECTACLE_BASE()
 {
    first_time = 1;
+   frames = NULL;
+   num_frames = 0;
    iamp_branch = 0;
    oamp_branch = 0;
 }
@@ -23,9 +25,12 @@ SPECTACLE_BASE :: ~SPECTACLE_BASE()
    delete [] output;
    delete [] anal_window;
    delete [] synth_window;
-   delete [] fft_buf;
-   delete [] anal_chans;
-   delete [] drybuf;
+   for (int i = 0; i < num_frames; i++) {
+      delete frames[i].fft;
+      delete [] frames[i].chans;
+      delete [] frames[i].drybuf;
+   }
+   delete [] frames;
    delete [] inbuf;
    delete [] outbuf;
    delete dry_delay;
@@ -187,7 +192,7 @@ int SPECTACLE_BASE :: init(double p[], int n_args)
    window_type = getWindowType(p[7]);
    float overlap = p[8];
 
-   /* Make sure FFT length is a power of 2 <= MAXFFTLEN and <= RTBUFSAMPS. */
+   /* Make sure FFT length is a power of 2 <= MAXFFTLEN. */
    bool valid = false;
    for (int x = 1; x <= MAXFFTLEN; x *= 2) {
       if (fft_len == x) {
@@ -199,16 +204,6 @@ int SPECTACLE_BASE :: init(double p[], int n_args)
       return die(instname(), "FFT length must be a power of two <= %d",
                                                                   MAXFFTLEN);
 
-// FIXME: now this isn't a problem; instead, decimation can't be larger
-// than RTBUFSAMPS.  But must couch errmsg in terms of overlap and fft length,
-// not decimation...
-#if 0
-   if (fft_len > RTBUFSAMPS)
-      return die(instname(),
-                 "FFT length must be a power of two less than or equal\n"
-                 "to the output buffer size set in rtsetparams (currently %d).",
-                 RTBUFSAMPS);
-#endif
    half_fft_len = fft_len / 2;
    fund_anal_freq = SR / (float) fft_len;
 
@@ -244,6 +239,15 @@ int SPECTACLE_BASE :: init(double p[], int n_args)
    /* derive decimation from overlap */
    decimation = (int) (fft_len / overlap);
 
+   /* run() takes at least one frame per buffer, so the hop between frames
+      can't be longer than the buffer size.
+   */
+   if (decimation > RTBUFSAMPS)
+      return die(instname(),
+                 "Overlap must be at least %g for an FFT length of %d, with\n"
+                 "the buffer size set in rtsetparams (currently %d).",
+                 (float) fft_len / RTBUFSAMPS, fft_len, RTBUFSAMPS);
+
    DPRINT2("fft_len=%d, decimation=%d\n", fft_len, decimation);
 
    if (pre_init(p, n_args) != 0)    /* can modify ringdur */
@@ -287,14 +291,26 @@ int SPECTACLE_BASE :: init(double p[], int n_args)
    output = new float [window_len];          /* output buffer */
    anal_window = new float [window_len];     /* analysis window */
    synth_window = new float [window_len];    /* synthesis window */
-   fft_buf = new float [fft_len];            /* FFT buffer */
-   anal_chans = new float [fft_len + 2];     /* analysis channels */
+
+   /* Buffers for as many frames as one run() can process. */
+   num_frames = (RTBUFSAMPS / decimation) + 1;
+   frames = new Frame [num_frames];
+   for (int i = 0; i < num_frames; i++) {
+      frames[i].fft = new Offt(fft_len);
+      frames[i].fft_buf = frames[i].fft->getbuf();
+      frames[i].chans = new float [fft_len + 2];
+      for (int j = 0; j < fft_len + 2; j++)
+         frames[i].chans[j] = 0.0;
+      frames[i].drybuf = new float [decimation];
+      frames[i].analyzed = 0;
+   }
+   anal_chans = frames[0].chans;
 
    if (make_windows() != 0)
       return DONT_SCHEDULE;
 
    /* Delay dry output by window_len - decimation to sync with wet sig. */
-   drybuf = new float [decimation];
+   drybuf = frames[0].drybuf;
    dry_delay = new DLineN(window_len);
    dry_delay->setDelay((float) window_len_minus_decimation);
 
@@ -355,7 +371,7 @@ void SPECTACLE_BASE :: shiftin()
    Using modulus arithmetic, fold and rotate windowed input into FFT buffer
    of length <fft_len>, according to current input time <n>.
 */
-void SPECTACLE_BASE :: fold(int n)
+void SPECTACLE_BASE :: fold(int n, float *fft_buf)
 {
    for (int i = 0; i < fft_len; i++)
       fft_buf[i] = 0.0;
@@ -371,13 +387,13 @@ void SPECTACLE_BASE :: fold(int n)
 
 
 /* ----------------------------------------------------------- leanconvert -- */
-/* <fft_buf> is a spectrum in JGrfft format, i.e. it contains <half_fft_len> * 2
+/* <fft_buf> is a spectrum in Offt format, i.e. it contains <half_fft_len> * 2
    real values, arranged in pairs of real and imaginary values, except for
    the first two values, which are the real parts of 0 and Nyquist frequencies.
    Converts these into <half_fft_len> + 1 pairs of magnitude and phase values,
-   and stores them into the output array <anal_chans>.
+   and stores them into the output array <chans>.
 */
-void SPECTACLE_BASE :: leanconvert()
+void SPECTACLE_BASE :: leanconvert(const float *fft_buf, float *chans)
 {
    int   real_index, imag_index, amp_index, phase_index;
    float a, b;
@@ -393,8 +409,8 @@ void SPECTACLE_BASE :: leanconvert()
          a = fft_buf[real_index];
          b = (i == 0) ? 0.0 : fft_buf[imag_index];
       }
-      anal_chans[amp_index] = hypot(a, b);
-      anal_chans[phase_index] = -atan2(b, a);
+      chans[amp_index] = hypot(a, b);
+      chans[phase_index] = -atan2(b, a);
    }
 }
 
@@ -411,11 +427,11 @@ void SPECTACLE_BASE :: flush_dry_delay()
 
 /* --------------------------------------------------------- leanunconvert -- */
 /* leanunconvert essentially undoes what leanconvert does, i.e., it turns
-   <half_fft_len> + 1 pairs of amplitude and phase values in <anal_chans>
-   into <half_fft_len> pairs of complex spectrum data (in JGrfft format) in
+   <half_fft_len> + 1 pairs of amplitude and phase values in <chans>
+   into <half_fft_len> pairs of complex spectrum data (in Offt format) in
    output array <fft_buf>.
 */
-void SPECTACLE_BASE :: leanunconvert()
+void SPECTACLE_BASE :: leanunconvert(const float *chans, float *fft_buf)
 {
    int   real_index, imag_index, amp_index, phase_index;
    float mag, phase;
@@ -425,8 +441,8 @@ void SPECTACLE_BASE :: leanunconvert()
       imag_index = phase_index = real_index + 1;
       if (i == half_fft_len)
          real_index = 1;
-      mag = anal_chans[amp_index];
-      phase = anal_chans[phase_index];
+      mag = chans[amp_index];
+      phase = chans[phase_index];
       fft_buf[real_index] = mag * cos(phase);
       if (i != half_fft_len)
          fft_buf[imag_index] = -mag * sin(phase);
@@ -439,7 +455,7 @@ void SPECTACLE_BASE :: leanunconvert()
    <synth_window> are of length <window_len>.  Overlap-add windowed,
    unrotated, unfolded <fft_buf> data into <output>.
 */
-void SPECTACLE_BASE :: overlapadd(int n)
+void SPECTACLE_BASE :: overlapadd(int n, const float *fft_buf)
 {
    n %= fft_len;
    for (int i = 0; i < window_len; i++) {
@@ -487,6 +503,28 @@ void SPECTACLE_BASE :: shiftout()
 }
 
 
+/* --------------------------------------------------------- analyze_frame -- */
+void SPECTACLE_BASE :: analyze_frame(void *context, int index)
+{
+   SPECTACLE_BASE *inst = (SPECTACLE_BASE *) context;
+   Frame *frame = &inst->frames[index];
+   if (frame->analyzed) {
+      frame->fft->r2c();
+      inst->leanconvert(frame->fft_buf, frame->chans);
+   }
+}
+
+
+/* ------------------------------------------------------ synthesize_frame -- */
+void SPECTACLE_BASE :: synthesize_frame(void *context, int index)
+{
+   SPECTACLE_BASE *inst = (SPECTACLE_BASE *) context;
+   Frame *frame = &inst->frames[index];
+   inst->leanunconvert(frame->chans, frame->fft_buf);
+   frame->fft->c2r();
+}
+
+
 /* ------------------------------------------------------------------- run -- */
 int SPECTACLE_BASE :: run()
 {
@@ -541,22 +579,47 @@ int SPECTACLE_BASE :: run()
 
    DPRINT1("iterations=%d\n", iterations);
 
+   /* The frames are processed in stages, so that the FFTs and the polar
+      conversions, which depend only on their own frame, can be shared with
+      helper threads (see the frame_threads option).  Taking input, the
+      subclass's modify_analysis and overlap-adding are done in frame order,
+      with the current frame set for each as usual.
+   */
+   const int start_frame = currentFrame();
+
    for (int i = 0; i < iterations; i++) {
-      if (currentFrame() < input_end_frame) {
+      Frame *frame = &frames[i];
+      drybuf = frame->drybuf;
+      frame->analyzed = (currentFrame() < input_end_frame);
+      if (frame->analyzed) {
          DPRINT1("taking input...cursamp=%d\n", currentFrame());
          shiftin();
-         fold(currentFrame());
-         JGrfft(fft_buf, half_fft_len, FORWARD);
-         leanconvert();
+         fold(currentFrame(), frame->fft_buf);
       }
       else
          flush_dry_delay();
+      increment(decimation);
+   }
+   runInParallel(analyze_frame, this, iterations);
+
+   cursamp = start_frame;
+   for (int i = 0; i < iterations; i++) {
+      Frame *frame = &frames[i];
+      /* A frame without input modifies what the last one left. */
+      if (!frame->analyzed && frame->chans != anal_chans)
+         memcpy(frame->chans, anal_chans, (fft_len + 2) * sizeof(float));
+      anal_chans = frame->chans;
       modify_analysis();
-      leanunconvert();
-      JGrfft(fft_buf, half_fft_len, INVERSE);
-      overlapadd(currentFrame());
-      shiftout();
+      increment(decimation);
+   }
+   runInParallel(synthesize_frame, this, iterations);
 
+   cursamp = start_frame;
+   for (int i = 0; i < iterations; i++) {
+      Frame *frame = &frames[i];
+      overlapadd(currentFrame(), frame->fft_buf);
+      drybuf = frame->drybuf;
+      shiftout();
       increment(decimation);
    }
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <ugens.h>
 #include <mixerr.h>
@@ -8,9 +9,19 @@
 #include <rtdefs.h>
 #include <assert.h>
 #include <objlib.h>
-#include "fft.h"
+#include <Ougens.h>
 
-#define MAXFFTLEN    4096
+#if (!defined(M_PI))
+  #define M_PI 3.14159265358979323846264338327
+#endif
+#if (!defined(PI))
+  #define PI M_PI
+#endif
+#if (!defined(TWO_PI))
+  #define TWO_PI (2.0 * M_PI)
+#endif
+
+#define MAXFFTLEN    65536
 #define MAXWINDOWLEN MAXFFTLEN * 8
 #define MINOVERLAP   0.25
 #define MAXOVERLAP   64.0
@@ -40,9 +51,22 @@ typedef enum {
 class SPECTACLE_BASE : public Instrument {
 
 private:
+   /* One analysis/synthesis frame of a run() call.  Each has its own
+      buffers, so that the FFTs of the frames can be done at the same time.
+   */
+   typedef struct {
+      Offt  *fft;
+      float *fft_buf;      /* fft->getbuf() */
+      float *chans;        /* analysis channels */
+      float *drybuf;
+      int   analyzed;      /* took input */
+   } Frame;
+
    int      iamp_branch, oamp_branch;
    float    amp, iamp, oamp;
-   float    *anal_window, *synth_window, *input, *output, *fft_buf, *drybuf;
+   float    *anal_window, *synth_window, *input, *output, *drybuf;
+   Frame    *frames;
+   int      num_frames;
    float    *inbuf, *inbuf_startptr, *inbuf_readptr, *inbuf_writeptr,
             *inbuf_endptr;
    float    *outbuf, *outbuf_startptr, *outbuf_readptr, *outbuf_writeptr,
@@ -67,11 +91,11 @@ protected:
    double *resample_functable(double *, int, int);
    int make_windows();
    void shiftin();
-   void fold(int);
-   void leanconvert();
+   void fold(int, float *);
+   void leanconvert(const float *, float *);
    void flush_dry_delay();
-   void leanunconvert();
-   void overlapadd(int);
+   void leanunconvert(const float *, float *);
+   void overlapadd(int, const float *);
    void shiftout();
    virtual int pre_init(double p[], int n_args) = 0;
    virtual int post_init(double p[], int n_args) = 0;
@@ -79,6 +103,8 @@ protected:
    virtual const char *instname() = 0;
 private:
    WindowType getWindowType(double pval);
+   static void analyze_frame(void *, int);
+   static void synthesize_frame(void *, int);
 };
 
 inline int odd(long x) { return (x & 0x00000001); }
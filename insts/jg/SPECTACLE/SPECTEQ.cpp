@@ -49,6 +49,8 @@
 /* --------------------------------------------------------------- SPECTEQ -- */
 SPECTEQ :: SPECTEQ()
 {
+   eqtable = NULL;
+   eqgain = NULL;
 }
 
 
@@ -56,6 +58,7 @@ SPECTEQ :: SPECTEQ()
 SPECTEQ :: ~SPECTEQ()
 {
    delete [] eqtable;
+   delete [] eqgain;
 }
 
 
@@ -75,6 +78,10 @@ int SPECTEQ :: pre_init(double p[], int n_args)
    else
       return die(instname(), "You haven't made the EQ function (table 3).");
 
+   eqgain = new double [half_fft_len];
+   for (int i = 0; i < half_fft_len; i++)
+      eqgain[i] = ampdb(eqtable[i]);
+
    return 0;
 }
 
@@ -112,18 +119,13 @@ void SPECTEQ :: modify_analysis()
    dump_anal_channels();
 #endif
 
-   for (int i = 0; i < half_fft_len; i++) {
-      float mag;
-      int index = i * 2;
-
-      if (reading_input) {
-         mag = anal_chans[index];
-         mag *= ampdb(eqtable[i]);
-      }
-      else
-         mag = 0.0;
-
-      anal_chans[index] = mag;
+   if (reading_input) {
+      for (int i = 0; i < half_fft_len; i++)
+         anal_chans[i * 2] *= eqgain[i];
+   }
+   else {
+      for (int i = 0; i < half_fft_len; i++)
+         anal_chans[i * 2] = 0.0;
    }
 }
 
@@ -3,6 +3,7 @@
 class SPECTEQ : public SPECTACLE_BASE {
 
    double   *eqtable;
+   double   *eqgain;          /* linear gain of each band */
 
 public:
    SPECTEQ();
@@ -74,6 +74,12 @@
 /* ----------------------------------------------------------- TVSPECTACLE -- */
 TVSPECTACLE :: TVSPECTACLE()
 {
+   eqtableA = deltimetableA = feedbacktableA = NULL;
+   eqtableB = deltimetableB = feedbacktableB = NULL;
+   phase_delay = mag_delay = NULL;
+   eqgain = NULL;
+   delsamps = NULL;
+   have_eqgain = have_delsamps = 0;
 }
 
 
@@ -86,12 +92,16 @@ TVSPECTACLE :: ~TVSPECTACLE()
    delete [] eqtableB;
    delete [] deltimetableB;
    delete [] feedbacktableB;
-   for (int i = 0; i < half_fft_len; i++) {
-      if (mag_delay[i])
+   if (mag_delay) {
+      for (int i = 0; i < half_fft_len; i++) {
          delete mag_delay[i];
-      if (phase_delay[i])
          delete phase_delay[i];
+      }
    }
+   delete [] mag_delay;
+   delete [] phase_delay;
+   delete [] eqgain;
+   delete [] delsamps;
 }
 
 
@@ -164,6 +174,10 @@ int TVSPECTACLE :: pre_init(double p[], int n_args)
    */
    maxdelsamps = (long) (MAXDELTIME * SR / decimation + 0.5);
    float maxtime = 0.0;
+   mag_delay = new DLineN * [half_fft_len];
+   phase_delay = new DLineN * [half_fft_len];
+   for (int i = 0; i < half_fft_len; i++)
+      mag_delay[i] = phase_delay[i] = NULL;
    for (int i = 0; i < half_fft_len; i++) {
 
       /* Check delay time table A. */
@@ -258,10 +272,54 @@ int TVSPECTACLE :: pre_init(double p[], int n_args)
    }
 
 //printf("deltimecurvetabs: %f, %f\n", deltimecurvetabs[0], deltimecurvetabs[1]);
+   eqgain = new double [half_fft_len];
+   delsamps = new long [half_fft_len];
+
    return 0;
 }
 
 
+/* ----------------------------------------------------------- make_eqgain -- */
+void TVSPECTACLE :: make_eqgain()
+{
+   for (int i = 0; i < half_fft_len; i++) {
+      float eq = ((1.0 - eq_curve_weight) * eqtableA[i])
+                                          + (eq_curve_weight * eqtableB[i]);
+      eqgain[i] = ampdb(eq);
+   }
+   eqgain_weight = eq_curve_weight;
+   have_eqgain = 1;
+}
+
+
+/* --------------------------------------------------------- make_delsamps -- */
+void TVSPECTACLE :: make_delsamps()
+{
+   for (int i = 0; i < half_fft_len; i++) {
+      float deltime = ((1.0 - deltime_curve_weight) * deltimetableA[i])
+                                 + (deltime_curve_weight * deltimetableB[i]);
+      if (deltime == 0.0) {
+         delsamps[i] = -1;
+         continue;
+      }
+      long samps = (long)(deltime * SR + 0.5) / decimation;
+
+      /* Not sure why this is necessary, but without it, delayed copies
+         sound distorted.
+      */
+      if (int_overlap > 1) {
+         int remainder = samps % int_overlap;
+         if (remainder)
+            samps -= remainder;
+      }
+      assert(samps >= 0 && samps <= maxdelsamps);
+      delsamps[i] = samps;
+   }
+   delsamps_weight = deltime_curve_weight;
+   have_delsamps = 1;
+}
+
+
 /* ------------------------------------------------------------- post_init -- */
 int TVSPECTACLE :: post_init(double p[], int n_args)
 {
@@ -312,6 +370,11 @@ void TVSPECTACLE :: modify_analysis()
             currentFrame(), latency);
 #endif
 
+   if (!have_eqgain || eq_curve_weight != eqgain_weight)
+      make_eqgain();
+   if (!have_delsamps || deltime_curve_weight != delsamps_weight)
+      make_delsamps();
+
    for (int i = 0; i < half_fft_len; i++) {
       float mag, phase;
       int index = i * 2;
@@ -325,31 +388,14 @@ void TVSPECTACLE :: modify_analysis()
          phase = anal_chans[index + 1];
       }
 
-      float eq = ((1.0 - eq_curve_weight) * eqtableA[i])
-                                          + (eq_curve_weight * eqtableB[i]);
-      float deltime = ((1.0 - deltime_curve_weight) * deltimetableA[i])
-                                 + (deltime_curve_weight * deltimetableB[i]);
-
-      if (deltime == 0.0) {
-         anal_chans[index] = mag * ampdb(eq);
+      if (delsamps[i] < 0) {
+         anal_chans[index] = mag * eqgain[i];
          anal_chans[index + 1] = phase;
       }
       else {
-         long delsamps = (long)(deltime * SR + 0.5) / decimation;
-
-         /* Not sure why this is necessary, but without it, delayed copies
-            sound distorted.
-         */
-         if (int_overlap > 1) {
-            int remainder = delsamps % int_overlap;
-            if (remainder)
-               delsamps -= remainder;
-         }
-         assert(delsamps >= 0 && delsamps <= maxdelsamps);
-
-         float newmag = mag_delay[i]->getSample(delsamps);
-         float newphase = phase_delay[i]->getSample(delsamps);
-         anal_chans[index] = newmag * ampdb(eq);
+         float newmag = mag_delay[i]->getSample(delsamps[i]);
+         float newphase = phase_delay[i]->getSample(delsamps[i]);
+         anal_chans[index] = newmag * eqgain[i];
          anal_chans[index + 1] = newphase;
 
          float feedback = ((1.0 - feedback_curve_weight) * feedbacktableA[i])
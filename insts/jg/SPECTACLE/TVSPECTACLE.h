@@ -9,7 +9,18 @@ private:
    double   *eqtableB, *deltimetableB, *feedbacktableB;
    double   *eqcurve, *deltimecurve, *feedbackcurve;
    float    eqcurvetabs[2], deltimecurvetabs[2], feedbackcurvetabs[2];
-   DLineN   *phase_delay[MAXFFTLEN / 2], *mag_delay[MAXFFTLEN / 2];
+   DLineN   **phase_delay, **mag_delay;
+
+   /* Per-band EQ gains and delays (-1 for none) for the curve weights
+      they were made for, remade only when those change.
+   */
+   double   *eqgain;
+   long     *delsamps;
+   float    eqgain_weight, delsamps_weight;
+   int      have_eqgain, have_delsamps;
+
+   void make_eqgain();
+   void make_delsamps();
 
 public:
    TVSPECTACLE();
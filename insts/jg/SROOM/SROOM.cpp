@@ -16,10 +16,10 @@
 #include <math.h>
 #include <ugens.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "SROOM.h"
 #include <rt.h>
 #include <rtdefs.h>
-#include <delmacros.h>
 
 //#define DEBUG
 #define AVERAGE_CHANS   -1           /* average input chans flag value */
@@ -27,8 +27,10 @@
 
 SROOM::SROOM() : Instrument()
 {
-   in = NULL;
-   delayline = rvbarrayl = rvbarrayr = NULL;
+   in = tapin = rvbarrayl = rvbarrayr = NULL;
+   for (int n = 0; n < 4; n++)
+      tapout[n] = NULL;
+   taps = NULL;
    branch = 0;
 }
 
@@ -36,7 +38,10 @@ SROOM::SROOM() : Instrument()
 SROOM::~SROOM()
 {
    delete [] in;
-   delete [] delayline;
+   delete [] tapin;
+   for (int n = 0; n < 4; n++)
+      delete [] tapout[n];
+   delete taps;
    delete [] rvbarrayl;
    delete [] rvbarrayr;
 }
@@ -100,30 +105,34 @@ int SROOM::init(double p[], int n_args)
 int SROOM::configure()
 {
    in = new float [RTBUFSAMPS * inputChannels()];
+   tapin = new float [RTBUFSAMPS];
+   for (int n = 0; n < 4; n++)
+      tapout[n] = new float [RTBUFSAMPS];
    return in ? 0 : -1;
 }
 
 
 int SROOM::run()
 {
-   const int samps = framesToRun() * inputChannels();
+   const int frames = framesToRun();
+   const int inchans = inputChannels();
 
-   rtgetin(in, this, samps);
+   rtgetin(in, this, frames * inchans);
 
-   for (int i = 0; i < samps; i += inputChannels()) {
-      float insig, delval = 0.0, rvbsig = 0.0;
+   for (int n = 0, i = 0; n < frames; n++, i += inchans) {
+      float insig;
 
-      if (currentFrame() < insamps) {        /* still taking input */
+      if (currentFrame() + n < insamps) {    /* still taking input */
          if (--branch <= 0) {
             if (amparray)
-               aamp = tablei(currentFrame(), amparray, amptabs) * ovamp;
+               aamp = tablei(currentFrame() + n, amparray, amptabs) * ovamp;
             branch = skip;
          }
          if (inchan == AVERAGE_CHANS) {
             insig = 0.0;
-            for (int n = 0; n < inputChannels(); n++)
-               insig += in[i + n];
-            insig /= (float) inputChannels();
+            for (int c = 0; c < inchans; c++)
+               insig += in[i + c];
+            insig /= (float) inchans;
          }
          else
             insig = in[i + inchan];
@@ -132,29 +141,15 @@ int SROOM::run()
       else                                   /* in ring-down phase */
          insig = 0.0;
 
-      DELPUT(insig, delayline, deltabs);
+      tapin[n] = insig;
+   }
 
-      float rout = 0.0;
-      for (int m = 1; m < NTAPS; m += 2) {
-         DELGET(delayline, del[m], deltabs, delval);
-         rout += delval * amp[m];
-         if (m < 2)
-            rvbsig = -rout;
-      }
-      rvbsig += rout;
+   taps->process(tapin, tapout, frames);
 
+   for (int n = 0; n < frames; n++) {
       float out[2];
-      out[0] = rout + reverb(rvbsig, rvbarrayr);
-
-      float lout = 0.0;
-      for (int m = 0; m < NTAPS; m += 2) {
-         DELGET(delayline, del[m], deltabs, delval);
-         lout += delval * amp[m];
-         if (m < 2)
-            rvbsig = -lout;
-      }
-      rvbsig += lout;
-      out[1] = lout + reverb(rvbsig, rvbarrayl);
+      out[0] = tapout[0][n] + reverb(tapout[2][n], rvbarrayr);
+      out[1] = tapout[1][n] + reverb(tapout[3][n], rvbarrayl);
 
       rtaddout(out);
       increment();
@@ -209,10 +204,6 @@ float SROOM::distndelset(float xsource,
          amp[m] = amp[m] * reflect / 100.0;
    }
 
-   delayline = new float[nmax];
-
-   delset(SR, delayline, deltabs, (float)nmax / SR);
-
    if (!ysource) {
       if (xsource < inner)
          (xsource < -inner) ? (amp[0] = 0.0) : (amp[0] = amp[1] = 0.0);
@@ -220,6 +211,20 @@ float SROOM::distndelset(float xsource,
          amp[1] = 0.0;
    }
 
+   /* Odd taps go right, even taps left, and each side's reverb gets that
+      side's taps but the first (the direct sound).  The delay fetch this
+      replaces read one sample short of del[m].
+   */
+   taps = new Omultitap(nmax, NTAPS, 4);
+   for (m = 0; m < NTAPS; m++) {
+      float gains[4] = { 0.0, 0.0, 0.0, 0.0 };
+      const int side = (m & 1) ? 0 : 1;
+      gains[side] = amp[m];
+      if (m >= 2)
+         gains[side + 2] = amp[m];
+      taps->setTap(m, (int)(del[m] * SR + 0.5) - 1, gains);
+   }
+
    return 0.0;
 }
 
@@ -1,11 +1,13 @@
 #define NTAPS 10
 
+class Omultitap;
+
 class SROOM : public Instrument {
    int    inchan, insamps, skip, branch;
-   int    deltabs[3];
    float  ovamp, aamp;
    float  del[NTAPS], amp[NTAPS];
-   float  *in, *delayline, *rvbarrayl, *rvbarrayr, amptabs[2];
+   float  *in, *tapin, *tapout[4], *rvbarrayl, *rvbarrayr, amptabs[2];
+   Omultitap *taps;
    double *amparray;
 
 public:
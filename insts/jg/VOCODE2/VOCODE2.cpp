@@ -90,27 +90,43 @@
 #include <ugens.h>
 #include <mixerr.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "VOCODE2.h"
 #include <rt.h>
 #include <rtdefs.h>
 
 
+// The filter banks and balancers run a group of bands at a time over a
+// block of frames, up to the next control update.  With many bands, the
+// groups are split into jobs of BANDS_PER_JOB bands, which run on helper
+// threads if the frame_threads option allows, each adding into its own
+// partial sum.  The partial sums are added in job order, so the output
+// does not depend on the threads.
+#define VOCODE_CHUNK    128
+#define BANDS_PER_JOB   32
+
+
 VOCODE2 :: VOCODE2() : Instrument()
 {
    branch = 0;
    in = NULL;
+   carsig = modsig = partial = NULL;
+   noise = NULL;
    hipassmod = NULL;
+   modulator_bank = carrier_bank = NULL;
+   balancer = NULL;
 }
 
 
 VOCODE2 :: ~VOCODE2()
 {
    delete [] in;
-   for (int i = 0; i < numfilts; i++) {
-      delete carrier_filt[i];
-      delete modulator_filt[i];
-      delete balancer[i];
-   }
+   delete [] carsig;
+   delete [] modsig;
+   delete [] partial;
+   delete modulator_bank;
+   delete carrier_bank;
+   delete balancer;
    delete noise;
    delete hipassmod;
 }
@@ -232,21 +248,29 @@ int VOCODE2 :: init(double p[], int n_args)
    if (carrier_transp)
       carrier_transp = octpch(carrier_transp);
 
+   // Butter works out the coefficients; the banks run them.
+   modulator_bank = new Ofilterbank(numfilts);
+   carrier_bank = new Ofilterbank(numfilts);
+   balancer = new Obalancebank(SR, numfilts, balance_window);
+   numjobs = (numfilts + BANDS_PER_JOB - 1) / BANDS_PER_JOB;
+   if (numjobs < 1)
+      numjobs = 1;
+
    for (int j = 0; j < numfilts; j++) {
       float thecf = cf[j];
+      Butter filt(SR);
+      double b[3], a[2];
 
-      modulator_filt[j] = new Butter(SR);
-      modulator_filt[j]->setBandPass(thecf, bwpct * thecf);
+      filt.setBandPass(thecf, bwpct * thecf);
+      filt.getCoeffs(b, a);
+      modulator_bank->setcoeffs(j, b[0], b[1], b[2], a[0], a[1]);
 
       if (carrier_transp)
          thecf = cpsoct(octcps(thecf) + carrier_transp);
 
-      carrier_filt[j] = new Butter(SR);
-      carrier_filt[j]->setBandPass(thecf, bwpct * thecf);
-
-      balancer[j] = new Balance(SR);
-      balancer[j]->setWindowSize(balance_window);
-      balancer[j]->setInitialGain(0.0);
+      filt.setBandPass(thecf, bwpct * thecf);
+      filt.getCoeffs(b, a);
+      carrier_bank->setcoeffs(j, b[0], b[1], b[2], a[0], a[1]);
    }
 
    amparray = floc(1);
@@ -264,6 +288,9 @@ int VOCODE2 :: init(double p[], int n_args)
 int VOCODE2 :: configure()
 {
    in = new float [RTBUFSAMPS * inputChannels()];
+   carsig = new float [VOCODE_CHUNK];
+   modsig = new float [VOCODE_CHUNK];
+   partial = new float [numjobs * VOCODE_CHUNK];
    return in ? 0 : -1;
 }
 
@@ -282,45 +309,84 @@ void VOCODE2 :: doupdate()
 }
 
 
+void VOCODE2 :: runJob(void *context, int job)
+{
+   VOCODE2 *inst = (VOCODE2 *) context;
+   const int nframes = inst->spanframes;
+   const int groupsPerJob = BANDS_PER_JOB / Ofilterbank::kGroup;
+   const int first = job * groupsPerJob;
+   int last = first + groupsPerJob;
+   if (last > inst->modulator_bank->numgroups())
+      last = inst->modulator_bank->numgroups();
+
+   float mod[VOCODE_CHUNK * Ofilterbank::kGroup];
+   float car[VOCODE_CHUNK * Ofilterbank::kGroup];
+   float *sum = &inst->partial[job * VOCODE_CHUNK];
+   for (int i = 0; i < nframes; i++)
+      sum[i] = 0.0;
+
+   for (int group = first; group < last; group++) {
+      inst->modulator_bank->rungroup(group, inst->modsig, mod, nframes);
+      inst->carrier_bank->rungroup(group, inst->carsig, car, nframes);
+      inst->balancer->rungroup(group, car, mod, NULL, sum, nframes);
+   }
+}
+
+
 int VOCODE2 :: run()
 {
-   const int samps = framesToRun() * inputChannels();
-   rtgetin(in, this, samps);
+   const int nframes = framesToRun();
+   rtgetin(in, this, nframes * inputChannels());
 
-   for (int i = 0; i < samps; i += inputChannels()) {
-      if (--branch <= 0) {
+   int i = 0;
+   while (i < nframes) {
+      if (branch <= 0) {
          doupdate();
          branch = skip;
       }
-      float carsig = in[i];
-      if (noise_amp > 0.0) {
-         float noisig = noise->tick() * 32767.0;
-         carsig += noisig * noise_amp;
-      }
-      float modsig = in[i + 1];
-
-      float out[2];
-      out[0] = 0.0;
-      for (int j = 0; j < numfilts; j++) {
-         float mod = modulator_filt[j]->tick(modsig);
-         float car = carrier_filt[j]->tick(carsig);
-         CLAMP_DENORMALS(mod);
-         CLAMP_DENORMALS(car);
-         out[0] += balancer[j]->tick(car, mod);
-      }
-      if (hipass_mod_amp > 0.0) {
-         float hpmodsig = hipassmod->tick(modsig);
-         out[0] += hpmodsig * hipass_mod_amp;
+      int count = nframes - i;
+      if (count > branch)
+         count = branch > 0 ? branch : 1;
+      if (count > VOCODE_CHUNK)
+         count = VOCODE_CHUNK;
+
+      for (int j = 0; j < count; j++) {
+         const float *frame = &in[(i + j) * inputChannels()];
+         carsig[j] = frame[0];
+         if (noise_amp > 0.0) {
+            float noisig = noise->tick() * 32767.0;
+            carsig[j] += noisig * noise_amp;
+         }
+         modsig[j] = frame[1];
       }
 
-      out[0] *= amp;
-      if (outputChannels() == 2) {
-         out[1] = out[0] * (1.0 - pctleft);
-         out[0] *= pctleft;
+      spanframes = count;
+      runInParallel(runJob, this, numjobs);
+      for (int job = 1; job < numjobs; job++) {
+         const float *sum = &partial[job * VOCODE_CHUNK];
+         for (int j = 0; j < count; j++)
+            partial[j] += sum[j];
       }
 
-      rtaddout(out);
-      increment();
+      for (int j = 0; j < count; j++) {
+         float out[2];
+         out[0] = partial[j];
+         if (hipass_mod_amp > 0.0) {
+            float hpmodsig = hipassmod->tick(modsig[j]);
+            out[0] += hpmodsig * hipass_mod_amp;
+         }
+
+         out[0] *= amp;
+         if (outputChannels() == 2) {
+            out[1] = out[0] * (1.0 - pctleft);
+            out[0] *= pctleft;
+         }
+
+         rtaddout(out);
+         increment();
+      }
+      branch -= count;
+      i += count;
    }
 
    return framesToRun();
@@ -2,16 +2,22 @@
 
 #define MAXFILTS 200
 
+class Ofilterbank;
+class Obalancebank;
+
 class VOCODE2 : public Instrument {
-   int       nargs, skip, numfilts, branch;
+   int       nargs, skip, numfilts, branch, numjobs, spanframes;
    float     amp, pctleft, noise_amp, hipass_mod_amp;
    float     *in, amptabs[2];
+   float     *carsig, *modsig, *partial;
    double    *amparray;
    SubNoiseL *noise;
-   Butter    *modulator_filt[MAXFILTS], *carrier_filt[MAXFILTS], *hipassmod;
-   Balance   *balancer[MAXFILTS];
+   Butter    *hipassmod;
+   Ofilterbank *modulator_bank, *carrier_bank;
+   Obalancebank *balancer;
 
    void doupdate();
+   static void runJob(void *context, int job);
 public:
    VOCODE2();
    virtual ~VOCODE2();
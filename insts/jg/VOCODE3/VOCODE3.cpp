@@ -85,12 +85,23 @@
 
 const OeqType kBandPassType = OeqBandPassCPG;  // constant 0 dB peak gain
 
+// The filter banks and balancers run a group of bands at a time over a
+// block of frames, up to the next control update: first every carrier
+// group, then each modulator group with the carrier bands mapped to it.
+// With many bands, the groups are split into jobs of kBandsPerJob bands,
+// which run on helper threads if the frame_threads option allows, each
+// adding into its own partial sum.  The partial sums are added in job
+// order, so the output does not depend on the threads.
+const int kChunk = 128;
+const int kBandsPerJob = 32;
+
 
 VOCODE3::VOCODE3()
 	: _branch(0), _numfilts(0), _hold(0), _maptable(NULL), _responsetime(-FLT_MAX), _nyquist(SR * 0.5f),
 	  _in(NULL), _lastmod(NULL), _modtable_src(NULL), _cartable_src(NULL), _modtable_prev(NULL), _cartable_prev(NULL),
+	  _carsig(NULL), _modsig(NULL), _carout(NULL), _partial(NULL), _scale(NULL),
       _maptable_src(NULL), _scaletable(NULL), _modulator_filt(NULL), _carrier_filt(NULL),
-	  _balancer(NULL)
+	  _modulator_bank(NULL), _carrier_bank(NULL), _balancer(NULL)
 {
 }
 
@@ -102,16 +113,32 @@ VOCODE3::~VOCODE3()
 	delete [] _maptable;
 	delete [] _in;
 	delete [] _lastmod;
+	delete [] _carsig;
+	delete [] _modsig;
+	delete [] _carout;
+	delete [] _partial;
+	delete [] _scale;
 
     // NOTE:  It is possible to leak some or all of these because _numfilts could still be set to 0
 	for (int i = 0; i < _numfilts; i++) {
 		delete _modulator_filt[i];
 		delete _carrier_filt[i];
-		delete _balancer[i];
 	}
 	delete [] _modulator_filt;
 	delete [] _carrier_filt;
-	delete [] _balancer;
+	delete _modulator_bank;
+	delete _carrier_bank;
+	delete _balancer;
+}
+
+
+void VOCODE3::setfilt(Oequalizer *filt, Ofilterbank *bank, int band,
+	float freq, float q)
+{
+	filt->setparams(freq, q);
+	float c[5];
+	filt->getcoeffs(c);
+	bank->setcoeffs(band, c[0], c[1], c[2], c[3], c[4]);
 }
 
 
@@ -186,7 +213,19 @@ int VOCODE3::init(double p[], int n_args)
 
 	_modulator_filt = new Oequalizer * [nFilters];
 	_carrier_filt = new Oequalizer * [nFilters];
-	_balancer = new Obalance * [nFilters];
+	_modulator_bank = new Ofilterbank(nFilters);
+	_carrier_bank = new Ofilterbank(nFilters);
+	_balancer = new Obalancebank(SR, nFilters);
+	_numjobs = (nFilters + kBandsPerJob - 1) / kBandsPerJob;
+	if (_numjobs < 1)
+		_numjobs = 1;
+
+	if (_scaletable) {
+		const int lanes = _modulator_bank->numgroups() * Ofilterbank::kGroup;
+		_scale = new float [lanes];
+		for (int i = 0; i < lanes; i++)
+			_scale[i] = (i < nFilters) ? _scaletable[i] : 0.0f;
+	}
 
 #ifdef NOTYET
 	const bool print_stats = Option::printStats();
@@ -205,14 +244,12 @@ int VOCODE3::init(double p[], int n_args)
 		_modulator_filt[i] = new Oequalizer(SR, kBandPassType);
 		_modtable_prev[i] = _modtable_src[i];
 		float mfreq = updateFreq(_modtable_src[i], _modtransp);
-		_modulator_filt[i]->setparams(mfreq, _modq);
+		setfilt(_modulator_filt[i], _modulator_bank, i, mfreq, _modq);
 
 		_carrier_filt[i] = new Oequalizer(SR, kBandPassType);
 		_cartable_prev[i] = _cartable_src[i];
 		float cfreq = updateFreq(_cartable_src[i], _cartransp);
-		_carrier_filt[i]->setparams(cfreq, _carq);
-
-		_balancer[i] = new Obalance(SR);
+		setfilt(_carrier_filt[i], _carrier_bank, i, cfreq, _carq);
 
 		_lastmod[i] = 0.0f;	// not necessary
 
@@ -226,6 +263,10 @@ int VOCODE3::init(double p[], int n_args)
 int VOCODE3::configure()
 {
 	_in = new float [RTBUFSAMPS * inputChannels()];
+	_carsig = new float [kChunk];
+	_modsig = new float [kChunk];
+	_carout = new float [_carrier_bank->numgroups() * kChunk * Ofilterbank::kGroup];
+	_partial = new float [_numjobs * kChunk];
 	return _in ? 0 : -1;
 }
 
@@ -262,7 +303,7 @@ void VOCODE3::doupdate()
 		for (int i = 0; i < _numfilts; i++) {
 			_modtable_prev[i] = _modtable_src[i];     // src freq may've changed
 			float freq = updateFreq(_modtable_src[i], _modtransp);
-			_modulator_filt[i]->setparams(freq, _modq);
+			setfilt(_modulator_filt[i], _modulator_bank, i, freq, _modq);
 		}
 	}
 	else if (p[4] != 0.0) {                // mod. cf table has changed
@@ -270,7 +311,7 @@ void VOCODE3::doupdate()
 			if (_modtable_prev[i] != _modtable_src[i]) {
 				_modtable_prev[i] = _modtable_src[i];
 				float freq = updateFreq(_modtable_src[i], _modtransp);
-				_modulator_filt[i]->setparams(freq, _modq);
+				setfilt(_modulator_filt[i], _modulator_bank, i, freq, _modq);
 			}
 		}
 	}
@@ -279,7 +320,7 @@ void VOCODE3::doupdate()
 		for (int i = 0; i < _numfilts; i++) {
 			_cartable_prev[i] = _cartable_src[i];
 			float freq = updateFreq(_cartable_src[i], _cartransp);
-			_carrier_filt[i]->setparams(freq, _carq);
+			setfilt(_carrier_filt[i], _carrier_bank, i, freq, _carq);
 		}
 	}
 	else if (p[5] != 0.0) {                // car. cf table has changed
@@ -287,7 +328,7 @@ void VOCODE3::doupdate()
 			if (_cartable_prev[i] != _cartable_src[i]) {
 				_cartable_prev[i] = _cartable_src[i];
 				float freq = updateFreq(_cartable_src[i], _cartransp);
-				_carrier_filt[i]->setparams(freq, _carq);
+				setfilt(_carrier_filt[i], _carrier_bank, i, freq, _carq);
 			}
 		}
 	}
@@ -303,8 +344,7 @@ void VOCODE3::doupdate()
 		int windowlen = int(_responsetime * SR + 0.5f);
 		if (windowlen < 2)   // otherwise, can get ear-splitting output
 			windowlen = 2;
-		for (int i = 0; i < _numfilts; i++)
-			_balancer[i]->setwindow(windowlen);
+		_balancer->setwindow(windowlen);
 	}
 
 	int newhold = int(p[13]);
@@ -312,53 +352,129 @@ void VOCODE3::doupdate()
 		_hold = newhold;
 		if (_hold) {
 			for (int i = 0; i < _numfilts; i++) {
-				_lastmod[i] = _modulator_filt[i]->last();
+				_lastmod[i] = _modulator_bank->last(i);
 				// _modulator_filt[i]->clear();	// doesn't seem necessary
 			}
 		}
 	}
 
 	_pan = (_nargs > 14) ? p[14] : 0.5f;
+
+	if (_scale) {                          // in case the table is redrawn
+		for (int i = 0; i < _numfilts; i++)
+			_scale[i] = _scaletable[i];
+	}
+}
+
+
+void VOCODE3::runCarrierJob(void *context, int job)
+{
+	VOCODE3 *inst = (VOCODE3 *) context;
+	const int nframes = inst->_spanframes;
+	const int groupsPerJob = kBandsPerJob / Ofilterbank::kGroup;
+	const int first = job * groupsPerJob;
+	int last = first + groupsPerJob;
+	if (last > inst->_carrier_bank->numgroups())
+		last = inst->_carrier_bank->numgroups();
+
+	for (int group = first; group < last; group++)
+		inst->_carrier_bank->rungroup(group, inst->_carsig,
+					&inst->_carout[group * kChunk * Ofilterbank::kGroup], nframes);
+}
+
+
+void VOCODE3::runModulatorJob(void *context, int job)
+{
+	VOCODE3 *inst = (VOCODE3 *) context;
+	const int G = Ofilterbank::kGroup;
+	const int nframes = inst->_spanframes;
+	const int groupsPerJob = kBandsPerJob / G;
+	const int first = job * groupsPerJob;
+	int last = first + groupsPerJob;
+	if (last > inst->_modulator_bank->numgroups())
+		last = inst->_modulator_bank->numgroups();
+
+	float mod[kChunk * G], car[kChunk * G];
+	float *sum = &inst->_partial[job * kChunk];
+	for (int i = 0; i < nframes; i++)
+		sum[i] = 0.0f;
+
+	for (int group = first; group < last; group++) {
+		// Gather the carrier band mapped to each of this group's bands.
+		for (int k = 0; k < G; k++) {
+			const int band = group * G + k;
+			if (band < inst->_numfilts) {
+				const int m = inst->_maptable[band];
+				const float *src = &inst->_carout[((m / G) * kChunk) * G + m % G];
+				for (int i = 0; i < nframes; i++)
+					car[i * G + k] = src[i * G];
+			}
+			else {
+				for (int i = 0; i < nframes; i++)
+					car[i * G + k] = 0.0f;
+			}
+		}
+		if (inst->_hold) {
+			for (int k = 0; k < G; k++) {
+				const int band = group * G + k;
+				const float last = (band < inst->_numfilts)
+											? inst->_lastmod[band] : 0.0f;
+				for (int i = 0; i < nframes; i++)
+					mod[i * G + k] = last;
+			}
+		}
+		else
+			inst->_modulator_bank->rungroup(group, inst->_modsig, mod, nframes);
+		inst->_balancer->rungroup(group, car, mod, inst->_scale, sum, nframes);
+	}
 }
 
 
 int VOCODE3::run()
 {
 	const int inchans = inputChannels();
-	const int samps = framesToRun() * inchans;
-	rtgetin(_in, this, samps);
+	const int nframes = framesToRun();
+	rtgetin(_in, this, nframes * inchans);
 
-	for (int i = 0; i < samps; i += inchans) {
-		if (--_branch <= 0) {
+	int i = 0;
+	while (i < nframes) {
+		if (_branch <= 0) {
 			doupdate();
 			_branch = getSkip();
 		}
-		const float carsig = _in[i];
-		const float modsig = _in[i + 1];
-
-		float out[2];
-		out[0] = 0.0f;
-		for (int j = 0; j < _numfilts; j++) {
-			float mod;
-			if (_hold)
-				mod = _lastmod[j];
-			else
-				mod = _modulator_filt[j]->next(modsig);
-			float car = _carrier_filt[_maptable[j]]->next(carsig);
-			float balsig = _balancer[j]->next(car, mod);
-			if (_scaletable != NULL)
-				balsig *= _scaletable[j];
-			out[0] += balsig;
+		int count = nframes - i;
+		if (count > _branch)
+			count = _branch > 0 ? _branch : 1;
+		if (count > kChunk)
+			count = kChunk;
+
+		for (int j = 0; j < count; j++) {
+			_carsig[j] = _in[(i + j) * inchans];
+			_modsig[j] = _in[(i + j) * inchans + 1];
 		}
 
-		out[0] *= _amp;
-		if (outputChannels() == 2) {
-			out[1] = out[0] * (1.0f - _pan);
-			out[0] *= _pan;
+		_spanframes = count;
+		runInParallel(runCarrierJob, this, _numjobs);
+		runInParallel(runModulatorJob, this, _numjobs);
+		for (int job = 1; job < _numjobs; job++) {
+			const float *sum = &_partial[job * kChunk];
+			for (int j = 0; j < count; j++)
+				_partial[j] += sum[j];
 		}
 
-		rtaddout(out);
-		increment();
+		for (int j = 0; j < count; j++) {
+			float out[2];
+			out[0] = _partial[j] * _amp;
+			if (outputChannels() == 2) {
+				out[1] = out[0] * (1.0f - _pan);
+				out[0] *= _pan;
+			}
+
+			rtaddout(out);
+			increment();
+		}
+		_branch -= count;
+		i += count;
 	}
 
 	return framesToRun();
@@ -2,23 +2,30 @@
 #include <math.h>
 
 class Oequalizer;
-class Obalance;
+class Ofilterbank;
+class Obalancebank;
 
 class VOCODE3 : public Instrument {
-	int _nargs, _branch, _numfilts, _hold;
+	int _nargs, _branch, _numfilts, _hold, _numjobs, _spanframes;
 	int *_maptable;
 	float _modtransp, _cartransp, _modq, _carq, _responsetime;
 	float _amp, _pan, _nyquist;
 	float *_in, *_lastmod;
 	double *_modtable_src, *_cartable_src, *_modtable_prev, *_cartable_prev;
+	float *_carsig, *_modsig, *_carout, *_partial, *_scale;
 	double *_maptable_src, *_scaletable;
-	Oequalizer **_modulator_filt, **_carrier_filt;
-	Obalance **_balancer;
+	Oequalizer **_modulator_filt, **_carrier_filt;	// work out coefficients
+	Ofilterbank *_modulator_bank, *_carrier_bank;
+	Obalancebank *_balancer;
 
 	int usage();
 	inline float convertSmooth(const float smooth);
 	inline float updateFreq(float freq, float transp);
+	void setfilt(Oequalizer *filt, Ofilterbank *bank, int band, float freq,
+																float q);
 	void doupdate();
+	static void runCarrierJob(void *context, int job);
+	static void runModulatorJob(void *context, int job);
 public:
 	VOCODE3();
 	virtual ~VOCODE3();
@@ -107,10 +107,19 @@
 #include <Ougens.h>
 #include <objlib.h>
 
+// The modulator is analyzed by an Ofilterbank a block of frames at a time,
+// up to the next control update.  The power followers and oscillators then
+// run through the block one band at a time.  With many bands, the bands are
+// split into jobs of BANDS_PER_JOB, which run on helper threads if the
+// frame_threads option allows, each adding into its own partial sum.
+#define VOCODESYNTH_CHUNK  128
+#define BANDS_PER_JOB      32
+
 /* ----------------------------------------------------------- VOCODESYNTH -- */
 VOCODESYNTH :: VOCODESYNTH()
-   : branch(0), inringdown(0), in(NULL), car_wavetable(NULL), scaletable(NULL),
-     hipassmod(NULL), amptable(NULL)
+   : numbands(0), branch(0), inringdown(0), numjobs(1), in(NULL),
+     modsig(NULL), modout(NULL), partial(NULL), car_wavetable(NULL),
+     scaletable(NULL), hipassmod(NULL), modulator_bank(NULL), amptable(NULL)
 {
 }
 
@@ -119,9 +128,12 @@ VOCODESYNTH :: VOCODESYNTH()
 VOCODESYNTH :: ~VOCODESYNTH()
 {
    delete [] in;
+   delete [] modsig;
+   delete [] modout;
+   delete [] partial;
+   delete modulator_bank;
    for (int i = 0; i < numbands; i++) {
       delete carrier_osc[i];
-      delete modulator_filt[i];
       delete gauge[i];
       delete smoother[i];
       delete envelope[i];
@@ -329,11 +341,19 @@ int VOCODESYNTH :: init(double p[], int n_args)
 
    // make filters, oscillators ---------------------------------------------
 
+   modulator_bank = new Ofilterbank(numbands);
+   numjobs = (numbands + BANDS_PER_JOB - 1) / BANDS_PER_JOB;
+   if (numjobs < 1)
+      numjobs = 1;
+
    for (int i = 0; i < numbands; i++) {
       float thecf = cf[i];
+      Butter filt(SR);
+      double b[3], a[2];
 
-      modulator_filt[i] = new Butter(SR);
-      modulator_filt[i]->setBandPass(thecf, bwpct * thecf);
+      filt.setBandPass(thecf, bwpct * thecf);
+      filt.getCoeffs(b, a);
+      modulator_bank->setcoeffs(i, b[0], b[1], b[2], a[0], a[1]);
 
       if (carrier_transp)
          thecf = cpsoct(octcps(thecf) + carrier_transp);
@@ -362,6 +382,10 @@ int VOCODESYNTH :: init(double p[], int n_args)
 int VOCODESYNTH :: configure()
 {
    in = new float [RTBUFSAMPS * inputChannels()];
+   modsig = new float [VOCODESYNTH_CHUNK];
+   modout = new float [modulator_bank->numgroups() * VOCODESYNTH_CHUNK
+                                                   * Ofilterbank::kGroup];
+   partial = new float [numjobs * VOCODESYNTH_CHUNK];
    return in ? 0 : -1;
 }
 
@@ -380,82 +404,139 @@ void VOCODESYNTH :: doupdate()
 }
 
 
-/* ------------------------------------------------------------------- run -- */
-int VOCODESYNTH :: run()
+/* ---------------------------------------------------------------- runJob -- */
+/* Analyze and resynthesize the bands of one job over <spanframes> frames,
+   adding the oscillators into the job's partial sum.
+*/
+void VOCODESYNTH :: runJob(void *context, int job)
 {
-   const int frames = framesToRun() * inputChannels();
-   rtgetin(in, this, frames);
+   VOCODESYNTH *inst = (VOCODESYNTH *) context;
+   const int kGroup = Ofilterbank::kGroup;
+   const int groupstride = VOCODESYNTH_CHUNK * kGroup;
+   const int frames = inst->spanframes;
+   const int ringdown = inst->inringdown;
+   const float threshold = inst->threshold;
+   const int first = job * BANDS_PER_JOB;
+   int last = first + BANDS_PER_JOB;
+   if (last > inst->numbands)
+      last = inst->numbands;
+
+   if (!ringdown) {
+      const int lastgroup = (last + kGroup - 1) / kGroup;
+      for (int group = first / kGroup; group < lastgroup; group++)
+         inst->modulator_bank->rungroup(group, inst->modsig,
+                                 &inst->modout[group * groupstride], frames);
+   }
 
-   for (int i = 0; i < frames; i += inputChannels()) {
-      float modsig;
-      if (currentFrame() < insamps) {
-         if (--branch <= 0) {
-            doupdate();
-            branch = getSkip();
-         }
-         modsig = in[i + inchan];
-      }
-      else {
-         inringdown = 1;
-         modsig = 0.0;
-      }
+   float *sum = &inst->partial[job * VOCODESYNTH_CHUNK];
+   for (int i = 0; i < frames; i++)
+      sum[i] = 0.0f;
 
-      float out[2];
-      out[0] = 0.0;
-      for (int j = 0; j < numbands; j++) {
+   for (int j = first; j < last; j++) {
+      const float *mod = &inst->modout[(j / kGroup) * groupstride
+                                                      + (j % kGroup)];
+      Envelope *envelope = inst->envelope[j];
+
+      for (int i = 0; i < frames; i++) {
          float power, car = 0.0;
 
-         if (inringdown) {
-            if (state[j] == aboveThreshold) {      // turn this band off
-               state[j] = belowThreshold;
-               envelope[j]->setRate(release_rate);
-               envelope[j]->keyOff();
+         if (ringdown) {
+            if (inst->state[j] == aboveThreshold) {   // turn this band off
+               inst->state[j] = belowThreshold;
+               envelope->setRate(inst->release_rate);
+               envelope->keyOff();
             }
-            power = lastpower[j];
+            power = inst->lastpower[j];
          }
          else {
-            float mod = modulator_filt[j]->tick(modsig);
-            power = gauge[j]->tick(mod);
-            if (smoothness > 0.0)
-               power = smoother[j]->tick(power);
-            lastpower[j] = power;                  // save for ringdown
+            power = inst->gauge[j]->tick(mod[i * kGroup]);
+            if (inst->smoothness > 0.0)
+               power = inst->smoother[j]->tick(power);
+            inst->lastpower[j] = power;               // save for ringdown
             if (power >= threshold) {
-               if (state[j] == belowThreshold) {
-                  state[j] = aboveThreshold;
-                  envelope[j]->setRate(attack_rate);
-                  envelope[j]->keyOn();
+               if (inst->state[j] == belowThreshold) {
+                  inst->state[j] = aboveThreshold;
+                  envelope->setRate(inst->attack_rate);
+                  envelope->keyOn();
                }
             }
             else {
-               if (state[j] == aboveThreshold) {
-                  state[j] = belowThreshold;
-                  envelope[j]->setRate(release_rate);
-                  envelope[j]->keyOff();
+               if (inst->state[j] == aboveThreshold) {
+                  inst->state[j] = belowThreshold;
+                  envelope->setRate(inst->release_rate);
+                  envelope->keyOff();
                }
             }
          }
-         float env = envelope[j]->tick();
+         float env = envelope->tick();
          if (env > 0.0) {
-            float gain = power * env * scaletable[j];
-            car = carrier_osc[j]->next() * gain;
+            float gain = power * env * inst->scaletable[j];
+            car = inst->carrier_osc[j]->next() * gain;
          }
-         out[0] += car;
-//printf("%d: power=%f, state=%d, env=%f\n", currentFrame(), power, state[j], env);
+         sum[i] += car;
       }
+   }
+}
 
-      if (hipass_mod_amp > 0.0) {
-         float hpmodsig = hipassmod->tick(modsig);
-         out[0] += hpmodsig * hipass_mod_amp;
-      }
 
-      out[0] *= amp;
-      if (outputChannels() == 2) {
-         out[1] = out[0] * (1.0 - pan);
-         out[0] *= pan;
+/* ------------------------------------------------------------------- run -- */
+int VOCODESYNTH :: run()
+{
+   const int inchans = inputChannels();
+   const int nframes = framesToRun();
+   rtgetin(in, this, nframes * inchans);
+
+   int i = 0;
+   while (i < nframes) {
+      int count = nframes - i;
+      if (currentFrame() < insamps) {
+         if (--branch <= 0) {
+            doupdate();
+            branch = getSkip();
+         }
+         // Stop the span at the next update and where the input ends.
+         if (count > branch)
+            count = branch;
+         if (count > insamps - currentFrame())
+            count = insamps - currentFrame();
+      }
+      else
+         inringdown = 1;
+      if (count > VOCODESYNTH_CHUNK)
+         count = VOCODESYNTH_CHUNK;
+
+      for (int j = 0; j < count; j++)
+         modsig[j] = inringdown ? 0.0 : in[(i + j) * inchans + inchan];
+
+      spanframes = count;
+      runInParallel(runJob, this, numjobs);
+      for (int job = 1; job < numjobs; job++) {
+         const float *sum = &partial[job * VOCODESYNTH_CHUNK];
+         for (int j = 0; j < count; j++)
+            partial[j] += sum[j];
       }
 
-      rtaddout(out);
-      increment();
+      for (int j = 0; j < count; j++) {
+         float out[2];
+         out[0] = partial[j];
+
+         if (hipass_mod_amp > 0.0) {
+            float hpmodsig = hipassmod->tick(modsig[j]);
+            out[0] += hpmodsig * hipass_mod_amp;
+         }
+
+         out[0] *= amp;
+         if (outputChannels() == 2) {
+            out[1] = out[0] * (1.0 - pan);
+            out[0] *= pan;
+         }
+
+         rtaddout(out);
+         increment();
+      }
+      if (!inringdown)
+         branch -= count - 1;
+      i += count;
    }
 
    return framesToRun();
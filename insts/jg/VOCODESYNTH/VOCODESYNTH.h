@@ -20,6 +20,7 @@
 #define MAXOSC 200
 
 class Butter;
+class Ofilterbank;
 class Envelope;
 class JGOnePole;
 class RMS;
@@ -33,12 +34,14 @@ typedef enum {
 
 class VOCODESYNTH : public Instrument {
    int         nargs, numbands, branch, inchan, insamps, inringdown;
+   int         numjobs, spanframes;
    float       amp, pan, hipass_mod_amp, smoothness;
    float       threshold, attack_rate, release_rate;
-   float       *in;
+   float       *in, *modsig, *modout, *partial;
    float       lastpower[MAXOSC];
    double      *car_wavetable, *scaletable;
-   Butter      *modulator_filt[MAXOSC], *hipassmod;
+   Butter      *hipassmod;
+   Ofilterbank *modulator_bank;
    Ooscili     *carrier_osc[MAXOSC];
    TableL      *amptable;
    RMS         *gauge[MAXOSC];
@@ -47,6 +50,7 @@ class VOCODESYNTH : public Instrument {
    PowerState  state[MAXOSC];
 
    void doupdate();
+   static void runJob(void *context, int job);
 public:
    VOCODESYNTH();
    virtual ~VOCODESYNTH();
@@ -365,14 +365,12 @@ void WIGGLE::doupdate()
             cf = 1.0f;
          if (cf > nyquist)
             cf = nyquist;
-         if (filter_type == LowPass) {
-            for (int i = 0; i < nfilts; i++)
-               filt[i]->setLowPass(cf);
-         }
-         else if (filter_type == HighPass) {
-            for (int i = 0; i < nfilts; i++)
-               filt[i]->setHighPass(cf);
-         }
+         if (filter_type == LowPass)
+            filt[0]->setLowPass(cf);
+         else if (filter_type == HighPass)
+            filt[0]->setHighPass(cf);
+         for (int i = 1; i < nfilts; i++)
+            filt[i]->copyCoeffs(*filt[0]);
          cf_raw = cf;
       }
    }
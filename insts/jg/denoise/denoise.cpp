@@ -1,10 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <ugens.h>
 #include <sfheader.h>
-#include "denoise.h"
+#include <WorkerPool.h>
+#include <Ougens.h>
 
 #define CMIX                    /* changes to original Carl src for cmix */
 
@@ -16,8 +18,35 @@ extern int headersize[NFILES];
 #define OUTPUT 1
 #define NOISE  2
 
+#define BATCH_FRAMES 32         /* FFT frames analyzed or synthesized at once */
+
+extern "C" {
+   double denoise(double p[], int n_args);
+   int profile();
+}
+
 static void hamming(float *, int, int);
-static void malerr(char *, int);
+static void malerr(const char *, int);
+
+/* One FFT frame of a batch.  Each has its own Offt, so that the frames of a
+   batch can be transformed on different threads; the times are those the
+   main loop had when it read the frame's input. */
+typedef struct {
+   Offt *fft;
+   long nI;                    /* input time of center of analysis window */
+   long nOd;                   /* delayed output time */
+   int Ii;                     /* number of outputs to shift out after it */
+   int clearFrom;              /* output index to zero from after that */
+} Frame;
+
+typedef struct {
+   Frame *frames;
+   float *input;
+   long ibuflen;
+   float *analWindow;
+   int analWinLen;
+   int N;
+} Batch;
 
 
 /*------------------------------------------------------------------------
@@ -84,12 +113,89 @@ static void malerr(char *, int);
 ------------------------------------------------------------------------*/
 
 
+/* analysis: The analysis computes the complex output at time n of
+   (N/2 + 1) of the FFT bins.  It operates on input samples
+   (n - analWinLen) thru (n + analWinLen) and expects to find these
+   in input[(n +- analWinLen) mod ibuflen].  It expects analWindow to
+   point to the center of a symmetric window of length (2 * analWinLen +1).
+   It is the responsibility of the main program to ensure that these
+   values are correct!  The results are returned in the frame's Offt
+   buffer, in its packed format. */
+
+/* Offt keeps the real value of the N/2 harmonic in buf[1].  The noise gate
+   wants all (N/2 + 1) bins as real and imaginary pairs, with the N/2
+   harmonic in anal[N], so these convert between the two. */
+
+static void
+unpack(const float *buf, float *anal, int N)
+{
+   anal[0] = buf[0];
+   anal[1] = 0.;
+   memcpy(anal + 2, buf + 2, (N - 2) * sizeof(float));
+   anal[N] = buf[1];
+   anal[N + 1] = 0.;
+}
+
+
+static void
+pack(const float *anal, float *buf, int N)
+{
+   buf[0] = anal[0];
+   buf[1] = anal[N];
+   memcpy(buf + 2, anal + 2, (N - 2) * sizeof(float));
+}
+
+
+static void
+analyzeFrame(void *context, int index)
+{
+   Batch *batch = (Batch *) context;
+   Frame *frame = &batch->frames[index];
+   float *anal = frame->fft->getbuf();
+   const float *input = batch->input;
+   const float *analWindow = batch->analWindow;
+   const long ibuflen = batch->ibuflen;
+   const int analWinLen = batch->analWinLen;
+   const int N = batch->N;
+   long i, j, k;
+
+   for (i = 0; i < N; i++)
+      anal[i] = 0.;           /*initialize */
+
+   j = (frame->nI - analWinLen - 1 + ibuflen) % ibuflen;  /*input pntr */
+
+   k = frame->nI - analWinLen - 1;  /*time shift */
+   while (k < 0)
+      k += N;
+   k = k % N;
+
+   for (i = -analWinLen; i <= analWinLen; i++) {
+      if (++j >= ibuflen)
+         j -= ibuflen;
+      if (++k >= N)
+         k -= N;
+      anal[k] += analWindow[i] * input[j];
+   }
+
+   frame->fft->r2c();
+}
+
+
+static void
+synthesizeFrame(void *context, int index)
+{
+   Batch *batch = (Batch *) context;
+   batch->frames[index].fft->c2r();
+}
+
+
 double
 denoise(double p[], int n_args)
 {
    float *input,               /* input buffer */
    *output,                    /* output buffer */
    *anal,                      /* analysis buffer */
+   *fftbuf,                    /* Offt buffer of current frame */
    *nextIn,                    /* pointer to next empty word in input */
    *nextOut,                   /* pointer to next empty word in output */
    *analWindowStart,           /* pointer to start of analysis window */
@@ -141,7 +247,7 @@ denoise(double p[], int n_args)
     Ninv,                      /* 1. / N */
     R = 0.;                    /* input sampling rate */
 
-   int i, j, k, n,             /* index variables */
+   int i, j, k, n, c,          /* index variables */
     i0, i1,                    /* indices for real and imaginary FFT values */
     Dd,                        /* number of new inputs to read (Dd <= D) */
     Ii,                        /* number of new outputs to write (Ii <= I) */
@@ -150,12 +256,16 @@ denoise(double p[], int n_args)
     Lf = 0,                    /* flag for even L */
     sh = 1,                    /* sharpness control for noise gate gain */
 //  v = 0,                     /* flag for verifying noise reference values */
-    flag;                      /* end-of-input flag */
+    flag,                      /* end-of-input flag */
+    nframes;                   /* number of frames in current batch */
+
+   Frame *frames;              /* frames of current batch */
+   Batch batch;                /* what analyzeFrame needs to know */
 
    float srate;                /* sample rate from header on input file */
    float inskip=0.0, indur=0.0;
    long nsampsIn, nsampsNoise, samps_read;
-   int inchan, outchan, nchans, noiseInChan, class, process_whole_file=0;
+   int inchan, outchan, nchans, noiseInChan, sclass, process_whole_file=0;
    float inputdur, noiseInskip, noiseInend, noiseDur;
    float noiseIn[SF_MAXCHAN], in[SF_MAXCHAN], out[SF_MAXCHAN];
 
@@ -207,10 +317,10 @@ denoise(double p[], int n_args)
    if (inchan >= nchans || inchan < 0)
       die("denoise", "You asked for channel %d of a %d-channel file.",
                                                               inchan, nchans);
-   class = sfclass(&sfdesc[INPUT]);
+   sclass = sfclass(&sfdesc[INPUT]);
    if (process_whole_file)
       inputdur = (float)(sfst[INPUT].st_size - headersize[INPUT])
-                                      / (float)class / (float)nchans / srate;
+                                      / (float)sclass / (float)nchans / srate;
    else
       inputdur = indur;
    nsampsIn = setnote(inskip, inputdur, INPUT);
@@ -283,13 +393,14 @@ denoise(double p[], int n_args)
    if ((L % 2) == 0)
       Lf = 1;
 
-   ibuflen = 4 * M;
-   obuflen = 4 * L;
-
    if (D == 0)
       D = ((float) M / 8.);
    I = D;
 
+   /* The input buffer holds the input of a whole batch of frames. */
+   ibuflen = 4 * M + BATCH_FRAMES * D;
+   obuflen = 4 * L;
+
    Pi = 4. * atan(1.);
    TwoPi = 2. * Pi;
 
@@ -389,6 +500,16 @@ denoise(double p[], int n_args)
          *(synWindow + i) *= sum;
    }
 
+/* Offt::r2c() scales by 1/N, and Offt::c2r() does not scale at all;
+   the reverse of the IEEE fast and fsst this was written for.  Fold
+   the difference into the windows, so that the spectrum compared with
+   the noise reference is the same as before. */
+
+   for (i = -analWinLen; i <= analWinLen; i++)
+      *(analWindow + i) *= N;
+   for (i = -synWinLen; i <= synWinLen; i++)
+      *(synWindow + i) *= Ninv;
+
 
 /* set up input buffer:  nextIn always points to the next empty
    word in the input buffer (i.e., the sample following
@@ -423,6 +544,22 @@ denoise(double p[], int n_args)
    if (anal == NULL)
       malerr("denoise: insufficient memory", 1);
 
+/* set up frames:  The analysis and synthesis FFTs of the frames in a
+   batch are independent of one another, so WorkerPool can give them
+   to other threads.  Only the noise gate, which averages over the
+   frames in mbuf, and the overlap-add must go frame by frame. */
+
+   frames = new Frame[BATCH_FRAMES];
+   for (i = 0; i < BATCH_FRAMES; i++)
+      frames[i].fft = new Offt(N);
+
+   batch.frames = frames;
+   batch.input = input;
+   batch.ibuflen = ibuflen;
+   batch.analWindow = analWindow;
+   batch.analWinLen = analWinLen;
+   batch.N = N;
+
 /* noise reduction: calculate noise reference by taking as many 
    consecutive FFT's as possible in noise soundfile, and
    averaging them all together.  Multiply by th*th to
@@ -441,6 +578,7 @@ denoise(double p[], int n_args)
       malerr("denoise: insufficient memory", 1);
 
 
+   fftbuf = frames[0].fft->getbuf();
    k = 0;
    j = beg;
    while (j < end) {
@@ -448,20 +586,20 @@ denoise(double p[], int n_args)
 #ifdef CMIX
          if (j < end) {
             GETIN(noiseIn, NOISE);
-            anal[i] = noiseIn[noiseInChan];
+            fftbuf[i] = noiseIn[noiseInChan];
          }
+         else
+            fftbuf[i] = 0.;
 #else
          if (j < end)
-            anal[i] = fsndi(sfd, j);
+            fftbuf[i] = fsndi(sfd, j);
          if (sferror)
             quit();
 #endif
       }
 
-      cfast(anal, N);
-
-      for (i = 0; i <= N + 1; i++)
-         anal[i] *= Ninv;
+      frames[0].fft->r2c();
+      unpack(fftbuf, anal, N);
 
       for (i = 0; i <= N2; i++) {
          fac = anal[2 * i] * anal[2 * i];
@@ -496,98 +634,116 @@ denoise(double p[], int n_args)
    mp = mi * Np2;
 
 /* main loop:  If nMax is not specified it is assumed to be very large
-   and then readjusted when getfloat detects the end of input. */
+   and then readjusted when getfloat detects the end of input.  Each
+   pass reads the input for a batch of up to BATCH_FRAMES frames,
+   noting the times for each, then analyzes, gates and synthesizes
+   the batch. */
 
    samps_read = 0;
    while (nId < (nMax + analWinLen)) {
 
-      for (i = 0; i < Dd; i++) {
+      for (nframes = 0; nframes < BATCH_FRAMES
+                        && nId < (nMax + analWinLen); nframes++) {
+         Frame *frame = &frames[nframes];
+
+         for (i = 0; i < Dd; i++) {
 #ifdef CMIX
-         if (!GETIN(in, INPUT))
-            Dd = i;             /* EOF ? */
-         if (++samps_read > nsampsIn)
-            Dd = i;
-         *nextIn++ = in[inchan];
+            if (!GETIN(in, INPUT))
+               Dd = i;             /* EOF ? */
+            if (++samps_read > nsampsIn)
+               Dd = i;
+            *nextIn++ = in[inchan];
 #else
-         if (getfloat(nextIn++) <= 0)
-            Dd = i;             /* EOF ? */
+            if (getfloat(nextIn++) <= 0)
+               Dd = i;             /* EOF ? */
 #endif
-         if (nextIn >= (input + ibuflen))
-            nextIn -= ibuflen;
-      }
-
-      if (nI > 0)
-         for (i = Dd; i < D; i++) {  /* zero fill at EOF */
-            *(nextIn++) = 0.;
             if (nextIn >= (input + ibuflen))
                nextIn -= ibuflen;
          }
 
-
-      /* analysis: The analysis subroutine computes the complex output at
-         time n of (N/2 + 1) of the FFT bins.  It operates on input
-         samples (n - analWinLen) thru (n + analWinLen) and expects
-         to find these in input[(n +- analWinLen) mod ibuflen].
-         It expects analWindow to point to the center of a
-         symmetric window of length (2 * analWinLen +1).  It is the
-         responsibility of the main program to ensure that these values
-         are correct!  The results are returned in anal as succesive
-         pairs of real and imaginary values for the lowest (N/2 + 1)
-         channels. */
-
-
-      for (i = 0; i < N + 2; i++)
-         *(anal + i) = 0.;      /*initialize */
-
-      j = (nI - analWinLen - 1 + ibuflen) % ibuflen;  /*input pntr */
-
-      k = nI - analWinLen - 1;  /*time shift */
-      while (k < 0)
-         k += N;
-      k = k % N;
-
-      for (i = -analWinLen; i <= analWinLen; i++) {
-         if (++j >= ibuflen)
-            j -= ibuflen;
-         if (++k >= N)
-            k -= N;
-         anal[k] += analWindow[i] * input[j];
+         if (nI > 0)
+            for (i = Dd; i < D; i++) {  /* zero fill at EOF */
+               *(nextIn++) = 0.;
+               if (nextIn >= (input + ibuflen))
+                  nextIn -= ibuflen;
+            }
+
+         frame->nI = nI;
+         frame->nOd = nOd;
+         frame->Ii = Ii;
+         frame->clearFrom = obuflen;
+
+         if (flag)
+            if ((nI > 0) && (Dd < D)) {  /* EOF detected */
+               flag = 0;
+               nMax = nI + analWinLen - (D - Dd);
+            }
+
+         nI += D;                  /* increment time */
+         nO += I;
+         nId += D;                 /* increment time */
+         nOd += I;
+
+         if ((nI + analWinLen) <= nMax)
+            Dd = D;
+         else if ((nI + analWinLen - D) <= nMax)
+            Dd = nMax - (nI + analWinLen - D);
+         else
+            Dd = 0;
+
+         if (nOd > (synWinLen + I))
+            Ii = I;
+         else if (nOd > synWinLen)
+            Ii = nOd - synWinLen;
+         else {
+            Ii = 0;
+            frame->clearFrom = nOd + synWinLen;
+         }
       }
 
-      cfast(anal, N);
+      WorkerPool::run(analyzeFrame, &batch, nframes);
 
       /* noise reduction: for each bin, calculate average magnitude-squared
          and calculate corresponding gain.  Apply this gain to delayed
          FFT values in mbuf[mj*Np2 + i?]. */
 
-      for (i = 0; i <= N2; i++) {
-         i0 = 2 * i;
-         i1 = i0 + 1;
-         rsum[i] -= mbuf[mp + i0] * mbuf[mp + i0];
-         rsum[i] -= mbuf[mp + i1] * mbuf[mp + i1];
-         rsum[i] += anal[i0] * anal[i0];
-         rsum[i] += anal[i1] * anal[i1];
-         avg = minv * rsum[i];
-         if (avg < 0.)
-            avg = 0.;
-         if (avg == 0.)
-            fac = 0.;
-         else
-            fac = avg / (avg + nref[i]);
-         for (j = 1; j < sh; j++)
-            fac *= fac;
-         gain = g0m * fac + g0;
-         mbuf[mp + i0] = anal[i0];
-         mbuf[mp + i1] = anal[i1];
-         anal[i0] = gain * mbuf[mj * Np2 + i0];
-         anal[i1] = gain * mbuf[mj * Np2 + i1];
+      for (n = 0; n < nframes; n++) {
+         fftbuf = frames[n].fft->getbuf();
+         unpack(fftbuf, anal, N);
+
+         for (i = 0; i <= N2; i++) {
+            i0 = 2 * i;
+            i1 = i0 + 1;
+            rsum[i] -= mbuf[mp + i0] * mbuf[mp + i0];
+            rsum[i] -= mbuf[mp + i1] * mbuf[mp + i1];
+            rsum[i] += anal[i0] * anal[i0];
+            rsum[i] += anal[i1] * anal[i1];
+            avg = minv * rsum[i];
+            if (avg < 0.)
+               avg = 0.;
+            if (avg == 0.)
+               fac = 0.;
+            else
+               fac = avg / (avg + nref[i]);
+            for (j = 1; j < sh; j++)
+               fac *= fac;
+            gain = g0m * fac + g0;
+            mbuf[mp + i0] = anal[i0];
+            mbuf[mp + i1] = anal[i1];
+            anal[i0] = gain * mbuf[mj * Np2 + i0];
+            anal[i1] = gain * mbuf[mj * Np2 + i1];
+         }
+
+         pack(anal, fftbuf, N);
+
+         if (++mi >= m)
+            mi = 0;
+         if (++mj >= m)
+            mj = 0;
+         mp = mi * Np2;
       }
 
-      if (++mi >= m)
-         mi = 0;
-      if (++mj >= m)
-         mj = 0;
-      mp = mi * Np2;
+      WorkerPool::run(synthesizeFrame, &batch, nframes);
 
       /* synthesis: The synthesis employs the Weighted Overlap-Add
          technique to reconstruct the time-domain signal.  The
@@ -598,67 +754,44 @@ denoise(double p[], int n_args)
          program must take care to zero each location which it "shifts"
          out (to standard output). */
 
-      cfsst(anal, N);
-
-      j = nOd - synWinLen - 1;
-      while (j < 0)
-         j += obuflen;
-      j = j % obuflen;
-
-      k = nOd - synWinLen - 1;
-      while (k < 0)
-         k += N;
-      k = k % N;
-
-      for (i = -synWinLen; i <= synWinLen; i++) {  /*overlap-add */
-         if (++j >= obuflen)
-            j -= obuflen;
-         if (++k >= N)
-            k -= N;
-         output[j] += anal[k] * synWindow[i];
-      }
-
+      for (n = 0; n < nframes; n++) {
+         Frame *frame = &frames[n];
+         fftbuf = frame->fft->getbuf();
+
+         j = frame->nOd - synWinLen - 1;
+         while (j < 0)
+            j += obuflen;
+         j = j % obuflen;
+
+         k = frame->nOd - synWinLen - 1;
+         while (k < 0)
+            k += N;
+         k = k % N;
+
+         for (i = -synWinLen; i <= synWinLen; i++) {  /*overlap-add */
+            if (++j >= obuflen)
+               j -= obuflen;
+            if (++k >= N)
+               k -= N;
+            output[j] += fftbuf[k] * synWindow[i];
+         }
 
-      for (i = 0; i < Ii; i++) {  /* shift out next Ii values */
+         for (i = 0; i < frame->Ii; i++) {  /* shift out next Ii values */
 #ifdef CMIX
-         for (n = 0; n < SF_MAXCHAN; n++)
-            out[n] = 0.0;
-         out[outchan] = *nextOut;
-         ADDOUT(out, OUTPUT);
+            for (c = 0; c < SF_MAXCHAN; c++)
+               out[c] = 0.0;
+            out[outchan] = *nextOut;
+            ADDOUT(out, OUTPUT);
 #else
-         putfloat(nextOut);
+            putfloat(nextOut);
 #endif
-         *(nextOut++) = 0.;
-         if (nextOut >= (output + obuflen))
-            nextOut -= obuflen;
-         outCount++;
-      }
-
-      if (flag)
-         if ((nI > 0) && (Dd < D)) {  /* EOF detected */
-            flag = 0;
-            nMax = nI + analWinLen - (D - Dd);
+            *(nextOut++) = 0.;
+            if (nextOut >= (output + obuflen))
+               nextOut -= obuflen;
+            outCount++;
          }
 
-      nI += D;                  /* increment time */
-      nO += I;
-      nId += D;                 /* increment time */
-      nOd += I;
-
-      if ((nI + analWinLen) <= nMax)
-         Dd = D;
-      else if ((nI + analWinLen - D) <= nMax)
-         Dd = nMax - (nI + analWinLen - D);
-      else
-         Dd = 0;
-
-      if (nOd > (synWinLen + I))
-         Ii = I;
-      else if (nOd > synWinLen)
-         Ii = nOd - synWinLen;
-      else {
-         Ii = 0;
-         for (i = nOd + synWinLen; i < obuflen; i++)
+         for (i = frame->clearFrom; i < obuflen; i++)
             if (i > 0)
                output[i] = 0.;
       }
@@ -689,6 +822,9 @@ denoise(double p[], int n_args)
    free(nref);
    free(mbuf);
    free(rsum);
+   for (i = 0; i < BATCH_FRAMES; i++)
+      delete frames[i].fft;
+   delete [] frames;
 #else
    flushfloat();
 #endif
@@ -749,7 +885,7 @@ hamming(float *win, int winLen, int even)
 
 
 static void
-malerr(char *str, int ex)
+malerr(const char *str, int ex)
 {
    fprintf(stderr, "%s\n", str);
    exit(ex);
@@ -22,6 +22,7 @@ Butter :: Butter(double srate) : JGFilter(srate)
    poleCoeffs[0] = 0.0;
    poleCoeffs[1] = 0.0;
    gain = 1.0;
+   rampValid = false;
    type = LOW_PASS;
    c = d = 0.0;
    this->clear();
@@ -148,6 +149,31 @@ void Butter :: setBandReject(double freq, double bandwidth)
 }
 
 
+void Butter :: copyCoeffs(const Butter &other)
+{
+   c = other.c;
+   d = other.d;
+   type = other.type;
+   gain = other.gain;
+   zeroCoeffs[0] = other.zeroCoeffs[0];
+   zeroCoeffs[1] = other.zeroCoeffs[1];
+   poleCoeffs[0] = other.poleCoeffs[0];
+   poleCoeffs[1] = other.poleCoeffs[1];
+}
+
+
+// tick() is the canonical form of these.
+
+void Butter :: getCoeffs(double b[3], double a[2]) const
+{
+   b[0] = gain;
+   b[1] = zeroCoeffs[0];
+   b[2] = zeroCoeffs[1];
+   a[0] = poleCoeffs[0];
+   a[1] = poleCoeffs[1];
+}
+
+
 #define DISABLE_CLAMP_DENORMALS  // disabled until sure it works with doubles
 #include "ClampDenormals.h"
 
@@ -167,3 +193,117 @@ double Butter :: tick(double sample)
    return lastOutput;
 }
 
+
+void Butter :: tickBlock(float *in, float *out, int n)
+{
+   const double g = gain, p0 = poleCoeffs[0], p1 = poleCoeffs[1];
+   const double z0 = zeroCoeffs[0], z1 = zeroCoeffs[1];
+   double s0 = inputs[0], s1 = inputs[1], y = lastOutput;
+
+   for (int i = 0; i < n; i++) {
+      double temp = in[i] - s0 * p0 - s1 * p1;
+      CLAMP_DENORMALS(temp);
+      y = temp * g + s0 * z0 + s1 * z1;
+      s1 = s0;
+      s0 = temp;
+      out[i] = y;
+   }
+
+   inputs[0] = s0;
+   inputs[1] = s1;
+   lastOutput = y;
+}
+
+
+// Filters past this many are run as a further cascade over the output.
+#define MAX_CASCADE 8
+
+void Butter :: tickCascade(Butter *filts[], int count, float *in, float *out,
+                                                                     int n)
+{
+   if (n <= 0)
+      return;
+   if (count <= 0) {
+      if (out != in)
+         for (int i = 0; i < n; i++)
+            out[i] = in[i];
+      return;
+   }
+
+   const int stages = count < MAX_CASCADE ? count : MAX_CASCADE;
+   double g[MAX_CASCADE], p0[MAX_CASCADE], p1[MAX_CASCADE];
+   double z0[MAX_CASCADE], z1[MAX_CASCADE], s0[MAX_CASCADE], s1[MAX_CASCADE];
+   double y[MAX_CASCADE];
+   double dg[MAX_CASCADE], dp0[MAX_CASCADE], dp1[MAX_CASCADE];
+   double dz0[MAX_CASCADE], dz1[MAX_CASCADE];
+   const double step = 1.0 / n;
+   bool ramp = false;
+
+   for (int j = 0; j < stages; j++) {
+      Butter *f = filts[j];
+      g[j] = f->gain;
+      p0[j] = f->poleCoeffs[0];
+      p1[j] = f->poleCoeffs[1];
+      z0[j] = f->zeroCoeffs[0];
+      z1[j] = f->zeroCoeffs[1];
+      s0[j] = f->inputs[0];
+      s1[j] = f->inputs[1];
+      y[j] = f->lastOutput;
+      dg[j] = dp0[j] = dp1[j] = dz0[j] = dz1[j] = 0.0;
+      const double *from = f->rampFrom;
+      if (f->rampValid && (from[0] != g[j] || from[1] != p0[j]
+                  || from[2] != p1[j] || from[3] != z0[j] || from[4] != z1[j])) {
+         // Start one step along, so that the last sample has the new setting.
+         dg[j] = (g[j] - from[0]) * step;
+         dp0[j] = (p0[j] - from[1]) * step;
+         dp1[j] = (p1[j] - from[2]) * step;
+         dz0[j] = (z0[j] - from[3]) * step;
+         dz1[j] = (z1[j] - from[4]) * step;
+         g[j] = from[0] + dg[j];
+         p0[j] = from[1] + dp0[j];
+         p1[j] = from[2] + dp1[j];
+         z0[j] = from[3] + dz0[j];
+         z1[j] = from[4] + dz1[j];
+         ramp = true;
+      }
+   }
+
+   for (int i = 0; i < n; i++) {
+      float sig = in[i];
+      for (int j = 0; j < stages; j++) {
+         double temp = sig - s0[j] * p0[j] - s1[j] * p1[j];
+         CLAMP_DENORMALS(temp);
+         y[j] = temp * g[j] + s0[j] * z0[j] + s1[j] * z1[j];
+         s1[j] = s0[j];
+         s0[j] = temp;
+         sig = y[j];
+      }
+      out[i] = sig;
+      if (ramp) {
+         for (int j = 0; j < stages; j++) {
+            g[j] += dg[j];
+            p0[j] += dp0[j];
+            p1[j] += dp1[j];
+            z0[j] += dz0[j];
+            z1[j] += dz1[j];
+         }
+      }
+   }
+
+   for (int j = 0; j < stages; j++) {
+      Butter *f = filts[j];
+      f->inputs[0] = s0[j];
+      f->inputs[1] = s1[j];
+      f->lastOutput = y[j];
+      f->rampFrom[0] = f->gain;
+      f->rampFrom[1] = f->poleCoeffs[0];
+      f->rampFrom[2] = f->poleCoeffs[1];
+      f->rampFrom[3] = f->zeroCoeffs[0];
+      f->rampFrom[4] = f->zeroCoeffs[1];
+      f->rampValid = true;
+   }
+
+   if (count > stages)
+      tickCascade(filts + stages, count - stages, out, out, n);
+}
+
@@ -11,6 +11,8 @@ class Butter : public JGFilter
   protected:
     double poleCoeffs[2];
     double zeroCoeffs[2];
+    double rampFrom[5];     // gain, poles, zeros as of the last tickCascade
+    bool rampValid;
   public:
     Butter(double srate);
     ~Butter();
@@ -24,6 +26,30 @@ class Butter : public JGFilter
     void setBandRejectBandwidth(double bandwidth);
     void setBandReject(double freq, double bandwidth);
     double tick(double sample);
+
+    // Take the setting of <other>, which is much cheaper than working it
+    // out again for each of a chain of identical filters.
+    void copyCoeffs(const Butter &other);
+
+    // The current setting as direct-form coefficients:
+    // y = b[0] x + b[1] x1 + b[2] x2 - a[0] y1 - a[1] y2
+    void getCoeffs(double b[3], double a[2]) const;
+
+    // Same as tick() for each of <n> samples.  <in> and <out> may be the
+    // same buffer.
+    void tickBlock(float *in, float *out, int n);
+
+    // Run <count> filters in series, <filts>[0] first, over <n> samples,
+    // with the same result as passing each sample through their tick()
+    // methods in turn and storing it as a float between them.  The chain's
+    // coefficients and history are held in local arrays for the block, so
+    // the filters work on consecutive samples at once instead of waiting on
+    // one another sample by sample.  When a filter's setting has changed
+    // since its last block, its coefficients move in a straight line from
+    // the old setting to the new over the block, ending on the new one, so
+    // a sweep updated once per block has no steps in it.
+    static void tickCascade(Butter *filts[], int count, float *in, float *out,
+                                                                     int n);
 };
 
 #endif
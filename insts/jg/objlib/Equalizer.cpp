@@ -14,6 +14,7 @@ Equalizer :: Equalizer(double srate, EQType eqType)
 {
    c0 = c1 = c2 = c3 = c4 = 0.0;
    x1 = x2 = y1 = y2 = 0.0;
+   haveCoeffs = ramping = false;
 }
 
 
@@ -157,5 +158,84 @@ void Equalizer :: setCoeffs(
    c2 = b2 / a0;
    c3 = a1 / a0;
    c4 = a2 / a0;
+
+   haveCoeffs = true;
+   ramping = false;
+}
+
+
+void Equalizer :: rampCoeffs(double freq, double Q, double gain)
+{
+   if (!haveCoeffs) {
+      setCoeffs(freq, Q, gain);
+      return;
+   }
+   const double old[5] = { c0, c1, c2, c3, c4 };
+   setCoeffs(freq, Q, gain);
+   target[0] = c0;
+   target[1] = c1;
+   target[2] = c2;
+   target[3] = c3;
+   target[4] = c4;
+   c0 = old[0];
+   c1 = old[1];
+   c2 = old[2];
+   c3 = old[3];
+   c4 = old[4];
+   ramping = true;
+}
+
+
+void Equalizer :: tickBlock(float *in, float *out, int n)
+{
+   double b0 = c0, b1 = c1, b2 = c2, a1 = c3, a2 = c4;
+   double sx1 = x1, sx2 = x2, sy1 = y1, sy2 = y2;
+
+   if (ramping && n > 0) {
+      const double step = 1.0 / n;
+      const double db0 = (target[0] - b0) * step;
+      const double db1 = (target[1] - b1) * step;
+      const double db2 = (target[2] - b2) * step;
+      const double da1 = (target[3] - a1) * step;
+      const double da2 = (target[4] - a2) * step;
+      for (int i = 0; i < n; i++) {
+         b0 += db0;
+         b1 += db1;
+         b2 += db2;
+         a1 += da1;
+         a2 += da2;
+         const double x0 = in[i];
+         const double y0 = (b0 * x0) + (b1 * sx1) + (b2 * sx2)
+                                     - (a1 * sy1) - (a2 * sy2);
+         sx2 = sx1;
+         sx1 = x0;
+         sy2 = sy1;
+         sy1 = y0;
+         out[i] = y0;
+      }
+      c0 = target[0];
+      c1 = target[1];
+      c2 = target[2];
+      c3 = target[3];
+      c4 = target[4];
+      ramping = false;
+   }
+   else {
+      for (int i = 0; i < n; i++) {
+         const double x0 = in[i];
+         const double y0 = (b0 * x0) + (b1 * sx1) + (b2 * sx2)
+                                     - (a1 * sy1) - (a2 * sy2);
+         sx2 = sx1;
+         sx1 = x0;
+         sy2 = sy1;
+         sy1 = y0;
+         out[i] = y0;
+      }
+   }
+
+   x1 = sx1;
+   x2 = sx2;
+   y1 = sy1;
+   y2 = sy2;
 }
 
@@ -35,6 +35,8 @@ protected:
    double   c0, c1, c2, c3, c4;
    double   x1, x2, y1, y2;
    EQType   type;
+   double   target[5];    // coefficients tickBlock is ramping toward
+   bool     haveCoeffs, ramping;
 public:
    Equalizer(double srate, EQType eqType);
    ~Equalizer();
@@ -43,6 +45,18 @@ public:
    void setEQType(EQType eqType) { type = eqType; }
    void setCoeffs(double freq, double Q, double gain);
 
+   // Like setCoeffs, but the next tickBlock call moves the coefficients
+   // from their current values to the new ones a step per sample, so that
+   // a change of setting between blocks doesn't click.  (Each coefficient
+   // set in between is a mix of two stable filters' sets, and so is itself
+   // stable.)  The first coefficients set take effect at once.  tick()
+   // does not ramp; it uses the current coefficients until a tickBlock.
+   void rampCoeffs(double freq, double Q, double gain);
+
+   // Same as tick() for each of <n> samples, other than any ramp.  <in>
+   // and <out> may be the same buffer.
+   void tickBlock(float *in, float *out, int n);
+
    double tick(double sample)
    {
       double y0 = (c0 * sample) + (c1 * x1) + (c2 * x2)
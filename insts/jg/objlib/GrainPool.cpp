@@ -0,0 +1,475 @@
+/* Granular voice pool, shared by GRANSYNTH and GRANULATE, by John Gibson
+*/
+
+#include "GrainPool.h"
+
+#define INITIAL_GRAINS  64
+
+// Rendering in parallel
+#define DEFAULT_GRAINS_PER_JOB   128
+#define MAX_JOBS                 16
+#define MIN_PARALLEL_FRAMES      32
+
+
+// Interpolators for sampled input.  The quadratic one passes through <y0>,
+// <y1> and <y2> at t = 0, 1 and 2; the cubic one through <ym2>, <ym1>,
+// <yp1> and <yp2> at t = -1, 0, 1 and 2.
+
+static inline float interp2ndOrder(float y0, float y1, float y2, float t)
+{
+   const float hy0 = y0 * 0.5f;
+   const float hy2 = y2 * 0.5f;
+   const float b = (-3.0f * hy0) + (2.0f * y1) - hy2;
+   const float c = hy0 - y1 + hy2;
+
+   return y0 + (b * t) + (c * t * t);
+}
+
+static inline float interp3rdOrder(float ym2, float ym1, float yp1, float yp2,
+   float t)
+{
+   const float a = t + 1.0f;
+   const float c = t - 1.0f;
+   const float d = t - 2.0f;
+
+   const float e = a * t;
+   const float f = c * d;
+
+   return 0.5f * (a * f * ym1 - e * d * yp1)
+            + 0.166666666667f * (e * c * yp2 - t * f * ym2);
+}
+
+template <typename T>
+static void resize(T *&array, int count, int capacity)
+{
+   T *newarray = new T [capacity];
+   for (int i = 0; i < count; i++)
+      newarray[i] = array[i];
+   delete [] array;
+   array = newarray;
+}
+
+
+GrainPool::GrainPool(double srate, int numOutChans, int numInChans,
+   Interp interp)
+   : _srate(srate), _outchans(numOutChans), _inchans(numInChans),
+     _interp(interp), _envtab(NULL), _envlen(0), _wavetab(NULL), _wavelen(0),
+     _pos(NULL), _incr(NULL), _envpos(NULL), _envincr(NULL), _gainL(NULL),
+     _gainR(NULL), _offset(NULL), _left(NULL), _chan(NULL), _count(0),
+     _capacity(0), _mostActive(0), _scratch(NULL), _scratchlen(0),
+     _partial(NULL), _partiallen(0), _parallel(NULL),
+     _grainsPerJob(DEFAULT_GRAINS_PER_JOB)
+{
+   assert(_srate > 0.0);
+   assert(_outchans == 1 || _outchans == 2);
+
+   _insamps = new const float * [_inchans + 1];
+   _infirst = new int [_inchans + 1];
+   _inend = new int [_inchans + 1];
+   for (int i = 0; i < _inchans; i++) {
+      _insamps[i] = NULL;
+      _infirst[i] = 0;
+      _inend[i] = 0;
+   }
+   grow(INITIAL_GRAINS);
+}
+
+
+GrainPool::~GrainPool()
+{
+   delete [] _insamps;
+   delete [] _infirst;
+   delete [] _inend;
+   delete [] _pos;
+   delete [] _incr;
+   delete [] _envpos;
+   delete [] _envincr;
+   delete [] _gainL;
+   delete [] _gainR;
+   delete [] _offset;
+   delete [] _left;
+   delete [] _chan;
+   delete [] _scratch;
+   delete [] _partial;
+}
+
+
+void GrainPool::setEnvelopeTable(double *table, int length)
+{
+   _envtab = table;
+   _envlen = length;
+}
+
+
+void GrainPool::setWaveTable(double *table, int length)
+{
+   _wavetab = table;
+   _wavelen = length;
+}
+
+
+void GrainPool::setInput(int chan, const float *samples, int firstFrame,
+   int endFrame)
+{
+   assert(chan >= 0 && chan < _inchans);
+   _insamps[chan] = samples;
+   _infirst[chan] = firstFrame;
+   _inend[chan] = endFrame;
+}
+
+
+void GrainPool::reserve(int count)
+{
+   if (count > _capacity)
+      grow(count);
+}
+
+
+void GrainPool::grow(int capacity)
+{
+   resize(_pos, _count, capacity);
+   resize(_incr, _count, capacity);
+   resize(_envpos, _count, capacity);
+   resize(_envincr, _count, capacity);
+   resize(_gainL, _count, capacity);
+   resize(_gainR, _count, capacity);
+   resize(_offset, _count, capacity);
+   resize(_left, _count, capacity);
+   resize(_chan, _count, capacity);
+   _capacity = capacity;
+}
+
+
+// Set up everything but the grain's source, and return its index.
+
+int GrainPool::newGrain(int offset, int frames, double amp, double pan)
+{
+   if (_count == _capacity)
+      grow(_capacity * 2);
+   const int grain = _count++;
+   if (_count > _mostActive)
+      _mostActive = _count;
+
+   _offset[grain] = offset;
+   _left[grain] = frames;
+
+   // The envelope runs through the table once, ending at its last point.
+   assert(_envtab != NULL);
+   _envpos[grain] = 0.0;
+   _envincr[grain] = (_envlen > 1) ? double(_envlen - 1) / double(frames) : 0.0;
+
+   if (_outchans > 1) {
+      const double panR = 1.0 - pan;
+      const double boost = 1.0 / sqrt((pan * pan) + (panR * panR));
+      _gainL[grain] = amp * pan * boost;
+      _gainR[grain] = amp * panR * boost;
+   }
+   else {
+      _gainL[grain] = amp;
+      _gainR[grain] = 0.0f;
+   }
+   return grain;
+}
+
+
+// Fill the hole with the last grain, so that [0, _count) stay in use.
+
+void GrainPool::removeGrain(int grain)
+{
+   const int last = --_count;
+   if (grain == last)
+      return;
+   _pos[grain] = _pos[last];
+   _incr[grain] = _incr[last];
+   _envpos[grain] = _envpos[last];
+   _envincr[grain] = _envincr[last];
+   _gainL[grain] = _gainL[last];
+   _gainR[grain] = _gainR[last];
+   _offset[grain] = _offset[last];
+   _left[grain] = _left[last];
+   _chan[grain] = _chan[last];
+}
+
+
+void GrainPool::startOscGrain(int offset, int frames, double freq,
+   double phase, double amp, double pan)
+{
+   if (frames < 1)
+      return;
+   assert(_wavetab != NULL);
+   const int grain = newGrain(offset, frames, amp, pan);
+   phase = fmod(phase, double(_wavelen));
+   _pos[grain] = (phase < 0.0) ? phase + _wavelen : phase;
+   _incr[grain] = fabs(freq) * _wavelen / _srate;
+   _chan[grain] = -1;
+}
+
+
+void GrainPool::startSampleGrain(int offset, int frames, int chan,
+   double startFrame, double increment, double amp, double pan)
+{
+   if (frames < 1)
+      return;
+   assert(chan >= 0 && chan < _inchans);
+   const int grain = newGrain(offset, frames, amp, pan);
+   _pos[grain] = startFrame;
+   _incr[grain] = increment;
+   _chan[grain] = chan;
+}
+
+
+// Looping through the wave table, with linear interpolation.
+
+void GrainPool::fillOsc(int grain, float *sig, int frames)
+{
+   const double *tab = _wavetab;
+   const int len = _wavelen;
+   const double incr = _incr[grain];
+   double phase = _pos[grain];
+   for (int i = 0; i < frames; i++) {
+      const int index = int(phase);
+      const int next = (index + 1 < len) ? index + 1 : 0;
+      const double frac = phase - index;
+      sig[i] = tab[index] + ((tab[next] - tab[index]) * frac);
+      phase += incr;
+      while (phase >= len)
+         phase -= len;
+   }
+   _pos[grain] = phase;
+}
+
+
+// Reading input whose frames, and their neighbors, are all resident.
+
+void GrainPool::fillSample(int grain, float *sig, int frames)
+{
+   const int chan = _chan[grain];
+   const double incr = _incr[grain];
+   double pos = _pos[grain];
+
+   const double lastpos = pos + (incr * (frames - 1));
+   const double lo = (incr < 0.0) ? lastpos : pos;
+   const double hi = (incr < 0.0) ? pos : lastpos;
+   if (lo < _infirst[chan] + 1 || int(hi) + 2 >= _inend[chan]) {
+      fillSampleEdge(grain, sig, frames);
+      return;
+   }
+   const float *in = _insamps[chan] - _infirst[chan];
+
+   if ((incr == 1.0 || incr == -1.0) && pos == floor(pos)) {
+      // Not transposed: a copy, forwards or backwards
+      const int start = int(pos);
+      if (incr > 0.0)
+         for (int i = 0; i < frames; i++)
+            sig[i] = in[start + i];
+      else
+         for (int i = 0; i < frames; i++)
+            sig[i] = in[start - i];
+   }
+   else if (_interp == kCubic) {
+      for (int i = 0; i < frames; i++) {
+         const int index = int(pos);
+         const float t = pos - index;
+         sig[i] = interp3rdOrder(in[index - 1], in[index], in[index + 1],
+                                 in[index + 2], t);
+         pos += incr;
+      }
+   }
+   else {
+      for (int i = 0; i < frames; i++) {
+         const int index = int(pos + 0.5);
+         const float t = (pos - index) + 1.0;
+         sig[i] = interp2ndOrder(in[index - 1], in[index], in[index + 1], t);
+         pos += incr;
+      }
+   }
+   _pos[grain] = lastpos + incr;
+}
+
+
+// The same, for a grain near either end of what is resident, where
+// neighboring frames that are missing repeat the nearest one there is.
+
+void GrainPool::fillSampleEdge(int grain, float *sig, int frames)
+{
+   const int chan = _chan[grain];
+   const float *in = _insamps[chan];
+   const int first = _infirst[chan];
+   const int last = _inend[chan] - 1;
+   const double incr = _incr[grain];
+   double pos = _pos[grain];
+   assert(in != NULL && last >= first);
+
+#define AT(frame) in[(((frame) < first) ? first \
+                                 : ((frame) > last) ? last : (frame)) - first]
+   for (int i = 0; i < frames; i++) {
+      if (_interp == kCubic) {
+         const int index = int(floor(pos));
+         const float t = pos - index;
+         sig[i] = interp3rdOrder(AT(index - 1), AT(index), AT(index + 1),
+                                 AT(index + 2), t);
+      }
+      else {
+         const int index = int(floor(pos + 0.5));
+         const float t = (pos - index) + 1.0;
+         sig[i] = interp2ndOrder(AT(index - 1), AT(index), AT(index + 1), t);
+      }
+      pos += incr;
+   }
+#undef AT
+   _pos[grain] = pos;
+}
+
+
+// The envelope, with linear interpolation.
+
+void GrainPool::applyEnvelope(int grain, float *sig, int frames)
+{
+   const double *tab = _envtab;
+   if (_envlen < 2) {
+      for (int i = 0; i < frames; i++)
+         sig[i] *= tab[0];
+      return;
+   }
+   const double incr = _envincr[grain];
+   double pos = _envpos[grain];
+   for (int i = 0; i < frames; i++) {
+      const int index = int(pos);
+      const double frac = pos - index;
+      sig[i] *= tab[index] + ((tab[index + 1] - tab[index]) * frac);
+      pos += incr;
+   }
+   _envpos[grain] = pos;
+}
+
+
+// Add grains [first, last) into <buffer>, using <sig> for one grain's
+// samples.  Grains that finish are left for compact(), so that groups of
+// grains can be rendered at the same time.
+
+void GrainPool::renderGrains(int first, int last, float *buffer, float *sig,
+   int numFrames, float amp)
+{
+   for (int grain = first; grain < last; grain++) {
+      const int start = _offset[grain];
+      if (start >= numFrames) {
+         _offset[grain] -= numFrames;
+         continue;
+      }
+      int frames = numFrames - start;
+      if (frames > _left[grain])
+         frames = _left[grain];
+
+      if (_chan[grain] < 0)
+         fillOsc(grain, sig, frames);
+      else
+         fillSample(grain, sig, frames);
+      applyEnvelope(grain, sig, frames);
+
+      const float gainL = _gainL[grain] * amp;
+      if (_outchans > 1) {
+         const float gainR = _gainR[grain] * amp;
+         float *out = &buffer[start * 2];
+         for (int i = 0; i < frames; i++) {
+            out[i * 2] += sig[i] * gainL;
+            out[(i * 2) + 1] += sig[i] * gainR;
+         }
+      }
+      else {
+         float *out = &buffer[start];
+         for (int i = 0; i < frames; i++)
+            out[i] += sig[i] * gainL;
+      }
+
+      _offset[grain] = 0;
+      _left[grain] -= frames;
+   }
+}
+
+
+void GrainPool::compact()
+{
+   for (int grain = 0; grain < _count; ) {
+      if (_left[grain] == 0)
+         removeGrain(grain);
+      else
+         grain++;
+   }
+}
+
+
+void GrainPool::setParallel(ParallelFunction func, int grainsPerJob)
+{
+   _parallel = func;
+   _grainsPerJob = (grainsPerJob > 0) ? grainsPerJob : DEFAULT_GRAINS_PER_JOB;
+}
+
+
+// Job 0 adds into the output itself, and each of the others into a partial
+// buffer of its own.
+
+void GrainPool::renderJob(void *context, int job)
+{
+   GrainPool *pool = (GrainPool *) context;
+   const int first = job * pool->_jobgrains;
+   int last = first + pool->_jobgrains;
+   if (last > pool->_count)
+      last = pool->_count;
+   const int numFrames = pool->_jobframes;
+   float *out = pool->_jobout;
+   if (job > 0) {
+      const int samps = numFrames * pool->_outchans;
+      out = &pool->_partial[(job - 1) * samps];
+      for (int i = 0; i < samps; i++)
+         out[i] = 0.0f;
+   }
+   pool->renderGrains(first, last, out, &pool->_scratch[job * numFrames],
+                      numFrames, pool->_jobamp);
+}
+
+
+void GrainPool::render(float *buffer, int numFrames, float amp)
+{
+   int jobs = 1;
+   if (_parallel && numFrames >= MIN_PARALLEL_FRAMES) {
+      jobs = (_count + _grainsPerJob - 1) / _grainsPerJob;
+      if (jobs > MAX_JOBS)
+         jobs = MAX_JOBS;
+   }
+   if (jobs < 2) {
+      if (numFrames > _scratchlen) {
+         delete [] _scratch;
+         _scratch = new float [numFrames];
+         _scratchlen = numFrames;
+      }
+      renderGrains(0, _count, buffer, _scratch, numFrames, amp);
+      compact();
+      return;
+   }
+
+   const int samps = numFrames * _outchans;
+   if (jobs * numFrames > _scratchlen) {
+      delete [] _scratch;
+      _scratchlen = MAX_JOBS * numFrames;
+      _scratch = new float [_scratchlen];
+   }
+   if ((jobs - 1) * samps > _partiallen) {
+      delete [] _partial;
+      _partiallen = (MAX_JOBS - 1) * samps;
+      _partial = new float [_partiallen];
+   }
+   _jobgrains = (_count + jobs - 1) / jobs;
+   _jobframes = numFrames;
+   _jobamp = amp;
+   _jobout = buffer;
+   (*_parallel)(renderJob, this, jobs);
+
+   // Add the partial sums in job order, so the output doesn't depend on
+   // which thread ran what.
+   for (int job = 1; job < jobs; job++) {
+      const float *sum = &_partial[(job - 1) * samps];
+      for (int i = 0; i < samps; i++)
+         buffer[i] += sum[i];
+   }
+   compact();
+}
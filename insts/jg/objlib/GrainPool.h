@@ -0,0 +1,123 @@
+/* Granular voice pool, shared by GRANSYNTH and GRANULATE, by John Gibson
+*/
+
+#if !defined(__GrainPool_h)
+#define __GrainPool_h
+
+#include "objdefs.h"
+
+// The grains sounding in one stream, kept as parallel arrays with one entry
+// per grain, rather than as an array of voice objects.  A block of output is
+// made grain by grain: each grain's samples for the block are computed in
+// one tight loop into a scratch buffer, then panned into the output in
+// another, so the work per sample is a few multiply-adds that the compiler
+// can vectorize.  A grain may begin at any frame of the block.  The arrays
+// grow as needed, so there is no limit on how many grains overlap.
+//
+// A grain reads either the wave table, looping at a given frequency
+// (GRANSYNTH), or one channel of sampled input, once through at a given
+// rate (GRANULATE).  Mono output gets the grain's amp; stereo output is
+// panned, with a boost to fill the hole in the middle.
+
+class GrainPool
+{
+  public:
+    // How to read sampled input between frames.
+    enum Interp { kQuadratic, kCubic };
+
+    GrainPool(double srate, int numOutChans, int numInChans = 0,
+              Interp interp = kCubic);
+    ~GrainPool();
+
+    // NOTE: We don't own the table memory.
+    void setEnvelopeTable(double *table, int length);
+    void setWaveTable(double *table, int length);
+
+    // Where the frames of input channel <chan> are, beginning with frame
+    // number <firstFrame> and ending before <endFrame>.  Call this before
+    // render() whenever they may have moved.
+    void setInput(int chan, const float *samples, int firstFrame, int endFrame);
+
+    // Make room for <count> grains, so that starting that many does not
+    // allocate.
+    void reserve(int count);
+
+    // Start a grain of <frames> output frames, <offset> frames into the next
+    // block rendered.  An oscillator grain starts at <phase> (a table index)
+    // in the wave table at <freq> Hz.  A sample grain starts at input frame
+    // <startFrame> of <chan>, moving <increment> frames (which may be
+    // negative) per output frame.
+    void startOscGrain(int offset, int frames, double freq, double phase,
+                       double amp, double pan);
+    void startSampleGrain(int offset, int frames, int chan, double startFrame,
+                          double increment, double amp, double pan);
+
+    // Add the next <numFrames> frames of every grain, times <amp>, into the
+    // interleaved <buffer>.
+    void render(float *buffer, int numFrames, float amp);
+
+    // Have render() split the grains into groups of about <grainsPerJob>
+    // and hand them to <func>, which makes each of the calls
+    // (*jobFunc)(context, n) for n from 0 to count - 1 and may make them
+    // on several threads at once -- such as Instrument::runInParallel.
+    typedef void (*JobFunction)(void *context, int job);
+    typedef void (*ParallelFunction)(JobFunction jobFunc, void *context,
+                                     int count);
+    void setParallel(ParallelFunction func, int grainsPerJob = 0);
+
+    int active() const { return _count; }
+    int mostActive() const { return _mostActive; }
+
+  private:
+    int  newGrain(int offset, int frames, double amp, double pan);
+    void removeGrain(int grain);
+    void compact();
+    void renderGrains(int first, int last, float *buffer, float *sig,
+                      int numFrames, float amp);
+    static void renderJob(void *context, int job);
+    void grow(int capacity);
+    void fillOsc(int grain, float *sig, int frames);
+    void fillSample(int grain, float *sig, int frames);
+    void fillSampleEdge(int grain, float *sig, int frames);
+    void applyEnvelope(int grain, float *sig, int frames);
+
+    double _srate;
+    int _outchans;
+    int _inchans;
+    Interp _interp;
+    double *_envtab;
+    int _envlen;
+    double *_wavetab;
+    int _wavelen;
+
+    const float **_insamps;    // per input channel, from setInput()
+    int *_infirst;
+    int *_inend;
+
+    // One entry per grain, [0, _count) sounding
+    double *_pos;        // table index or input frame
+    double *_incr;
+    double *_envpos;
+    double *_envincr;
+    float *_gainL;       // amp, pan and boost together
+    float *_gainR;
+    int *_offset;        // frames into the block before the grain starts
+    int *_left;          // frames left to play
+    int *_chan;          // -1 for an oscillator grain
+    int _count;
+    int _capacity;
+    int _mostActive;
+
+    float *_scratch;     // one grain's samples for the block, per job
+    int _scratchlen;
+    float *_partial;     // output of jobs after the first
+    int _partiallen;
+    ParallelFunction _parallel;
+    int _grainsPerJob;
+    int _jobgrains;      // for the jobs of the current render()
+    int _jobframes;
+    float _jobamp;
+    float *_jobout;
+};
+
+#endif
@@ -49,6 +49,12 @@ JCRev :: JCRev(double srate, double T60) : Reverb(srate)
       combCoeff[i] = pow(10, (-3 * lens[i] / (T60 * _sr)));
 //      printf("combCoeff[%d] = %f\n", i, combCoeff[i]);
    }
+   int longest = 0;
+   for (int i = 0; i < 4; i++)
+      if (lens[i] > longest)
+         longest = lens[i];
+   _pathLength = lens[4] + lens[5] + lens[6] + longest
+                 + (lens[7] > lens[8] ? lens[7] : lens[8]);
    outLdelayLine = new DLineN(lens[7] + 2);
    outLdelayLine->setDelay(lens[7]);
    outRdelayLine = new DLineN(lens[8] + 2);
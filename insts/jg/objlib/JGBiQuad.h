@@ -15,6 +15,8 @@ class JGBiQuad : public JGFilter
   protected:  
     double poleCoeffs[2];
     double zeroCoeffs[2];
+    double rampFrom[5];     // gain, poles, zeros as of the last tickCascade
+    bool rampValid;
   public:
     JGBiQuad(double srate);
     ~JGBiQuad();
@@ -26,6 +28,18 @@ class JGBiQuad : public JGFilter
     void setFreqAndReson(double freq, double reson);
     void setFreqBandwidthAndGain(double freq, double bw, double aGain);
     double tick(double sample);
+
+    // Take the setting of <other>, as Butter::copyCoeffs does.
+    void copyCoeffs(const JGBiQuad &other);
+
+    // Same as tick() for each of <n> samples.  <in> and <out> may be the
+    // same buffer.
+    void tickBlock(float *in, float *out, int n);
+
+    // Run <count> filters in series over <n> samples, ramping changed
+    // settings, as Butter::tickCascade does.
+    static void tickCascade(JGBiQuad *filts[], int count, float *in,
+                                                      float *out, int n);
 };
 
 #endif
@@ -35,6 +35,12 @@ NRev :: NRev(double srate, double T60) : Reverb(srate)
       CdelayLine[i]->setDelay((long)(lens[i]));
       combCoef[i] = pow(10, (-3 * lens[i] / (T60 * _sr)));
    }
+   int longest = 0;
+   for (int i = 0; i < 6; i++)
+      if (lens[i] > longest)
+         longest = lens[i];
+   _pathLength = longest + lens[6] + lens[7] + lens[8] + lens[9]
+                 + (lens[10] > lens[11] ? lens[10] : lens[11]);
    for (int i = 0; i < 6; i++) {
       APdelayLine[i] = new DLineN((long)(lens[i + 6]) + 2);
       APdelayLine[i]->setDelay((long)(lens[i + 6]));
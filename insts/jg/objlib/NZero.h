@@ -17,6 +17,8 @@ class NZero : public JGFilter
     void clear();
     void setZeroCoeffs(double *coeffs);
     void setGain(double aValue);
+    int getOrder() const { return order; }
+    const double *getZeroCoeffs() const { return zeroCoeffs; }
     float getFrequencyResponse(float freq);
     void designFromFunctionTable(double *table, int size, double low,
                                                                   double high);
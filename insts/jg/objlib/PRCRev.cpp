@@ -33,6 +33,7 @@ PRCRev :: PRCRev(double srate, double T60) : Reverb(srate)
       CdelayLine[i]->setDelay(lens[i+2]);
       combCoeff[i] = pow(10, (-3 * lens[i + 2] / (T60 * _sr)));
    }
+   _pathLength = lens[0] + lens[1] + (lens[2] > lens[3] ? lens[2] : lens[3]);
    allPassCoeff = 0.7;
    effectMix = 0.5;
    this->clear();
@@ -6,7 +6,7 @@
 #include "Reverb.h"
 
 
-Reverb :: Reverb(double srate) : _sr(srate)
+Reverb :: Reverb(double srate) : _sr(srate), _pathLength(0)
 {
 }
 
@@ -10,6 +10,7 @@ class Reverb
 {
   protected:
     double _sr;
+    long _pathLength;
   public:
     Reverb(double srate);
     virtual ~Reverb();
@@ -19,6 +20,9 @@ class Reverb
     virtual double lastOutputR();
     virtual double tick(double input);
     int isprime(int val);
+    // Frames a sound takes to get all the way through: the allpasses in
+    // series, plus the longest comb and output delay.
+    long pathLength() { return _pathLength; }
 };
 
 #endif // defined(__Reverb_h)
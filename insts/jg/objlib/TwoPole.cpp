@@ -91,3 +91,20 @@ double TwoPole :: tick(double sample)
 }
 
 
+void TwoPole :: tickBlock(float *in, float *out, int n)
+{
+   const double g = gain, p0 = poleCoeffs[0], p1 = poleCoeffs[1];
+   double y1 = outputs[0], y2 = outputs[1];
+
+   for (int i = 0; i < n; i++) {
+      const double temp = in[i] * g + p0 * y1 + p1 * y2;
+      y2 = y1;
+      y1 = temp;
+      out[i] = temp;
+   }
+
+   outputs[0] = y1;
+   outputs[1] = y2;
+   lastOutput = y1;
+}
+
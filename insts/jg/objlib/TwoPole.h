@@ -24,6 +24,10 @@ class TwoPole : public JGFilter
     void setFreqAndReson(double freq, double reson);
     void setFreqBandwidthAndScale(double freq, double bw, int scale);
     double tick(double sample);
+
+    // Same as tick() for each of <n> samples.  <in> and <out> may be the
+    // same buffer.
+    void tickBlock(float *in, float *out, int n);
 };
 
 #endif
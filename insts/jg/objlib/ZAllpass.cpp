@@ -63,3 +63,22 @@ double ZAllpass :: tick(double input, double delaySamps)
    return lastOutput;
 }
 
+
+void ZAllpass :: tickBlock(float *in, float *out, int n, double delaySamps)
+{
+   if (delaySamps != delsamps) {
+      delayLine->setDelay(delaySamps);
+      delsamps = delaySamps;
+   }
+
+   double y = lastOutput;
+   for (int i = 0; i < n; i++) {
+      double temp = delayLine->lastOut();
+      y = in[i] + (allPassCoeff * temp);
+      delayLine->tick(y);
+      y = temp - (allPassCoeff * y);
+      out[i] = y;
+   }
+   lastOutput = y;
+}
+
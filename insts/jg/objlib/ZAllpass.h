@@ -18,6 +18,10 @@ class ZAllpass : public JGFilter
     void clear();
     void setReverbTime(double reverbTime);
     double tick(double input, double delaySamps);
+
+    // Same as tick() for each of <n> samples, all with the same delay.
+    // <in> and <out> may be the same buffer.
+    void tickBlock(float *in, float *out, int n, double delaySamps);
 };
 
 #endif
@@ -63,3 +63,20 @@ double ZComb :: tick(double input, double delaySamps)
    return lastOutput;
 }
 
+
+void ZComb :: tickBlock(float *in, float *out, int n, double delaySamps)
+{
+   if (delaySamps != delsamps) {
+      delayLine->setDelay(delaySamps);
+      delsamps = delaySamps;
+   }
+
+   double y = lastOutput;
+   for (int i = 0; i < n; i++) {
+      double temp = in[i] + (combCoeff * delayLine->lastOut());
+      y = delayLine->tick(temp);
+      out[i] = y;
+   }
+   lastOutput = y;
+}
+
@@ -11,6 +11,7 @@
 #include "DLineN.h"
 #include "Envelope.h"
 #include "Equalizer.h"
+#include "GrainPool.h"
 #include "JGFilter.h"
 #include "JCRev.h"
 #include "KOscilN.h"
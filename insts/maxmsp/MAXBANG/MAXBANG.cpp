@@ -1,8 +1,8 @@
 /* MAXBANG -- set to work with max/msp check_bang().
 
-	all this does is set the extern "C" int 'bang_ready' to 1,
-	max/msp will check this and send out a bang (and reset it
-	to 0 in check_bang, at the end of Minc/main.C
+	all this does is post a bang with HostEvents::postBang();
+	checkForBang() takes it at the end of the buffer and has
+	max/msp send out a bang
 
 	p0 = time to generate the bang
 
@@ -16,6 +16,7 @@
 #include "MAXBANG.h"
 #include <rt.h>
 #include <rtdefs.h>
+#include <HostEvents.h>
 
 
 MAXBANG::MAXBANG() : Instrument()
@@ -35,11 +36,9 @@ int MAXBANG::init(double p[], int n_args)
 	return nSamps();
 }
 
-extern "C" int bang_ready;
-
 int MAXBANG::run()
 {
-	bang_ready = 1;
+	HostEvents::postBang(get_ichunkstart());
 	return(1);
 }
 
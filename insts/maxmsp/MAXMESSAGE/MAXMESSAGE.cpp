@@ -3,9 +3,8 @@
 	this one returns the number of RTcmix values to return
 	back to max/msp to be sent out as a float or as a list
 	of floats.  Values are set via the p-fields of this
-	instrument.  It then sets an extern "C" int 'vals_ready'
-	to the number of vals (0 means no vals pending) at the
-	for check_vals at the end of Minc/main.C
+	instrument.  It posts them with HostEvents::postValues(),
+	and checkForVals() takes them at the end of the buffer
 
 	p0 = time to send them vals
 	p1-n = the vals
@@ -21,6 +20,7 @@
 #include "MAXMESSAGE.h"
 #include <rt.h>
 #include <rtdefs.h>
+#include <HostEvents.h>
 
 
 MAXMESSAGE::MAXMESSAGE() : Instrument()
@@ -45,15 +45,9 @@ int MAXMESSAGE::init(double p[], int n_args)
 	return nSamps();
 }
 
-extern "C" int vals_ready;
-extern "C" float maxmsp_vals[];
-
 int MAXMESSAGE::run()
 {
-	int i;
-
-	for (i = 0; i < nvals; i++) maxmsp_vals[i] = thevals[i];
-	vals_ready = nvals;
+	HostEvents::postValues(get_ichunkstart(), thevals, nvals);
 
 	return(1);
 }
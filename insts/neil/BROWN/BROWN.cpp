@@ -10,6 +10,9 @@
    p2 (amp) and p3 (pan) can receive updates from a table or real-time
    control source.
 
+   With the block_noise option set, the random steps come from an Orandblock
+   seeded from the srand series, rather than from that series itself.
+
    Neil Thornock <neilthornock at gmail>, 11/12/16.
 
    Algorithm by Andrew Simper (vellocet.com/dsp/noise/VRand.html), who
@@ -20,17 +23,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ugens.h>
+#include <Ougens.h>
+#include <RTOption.h>	// blockNoise
 #include "BROWN.h"
 #include <rt.h>
 #include <rtdefs.h>
 
 BROWN::BROWN()
-	: _branch(0), _brown(0.0)
+	: _branch(0), _brown(0.0), _steps(NULL)
 {
 }
 
 BROWN::~BROWN()
 {
+	delete [] _steps;
 }
 
 int BROWN::init(double p[], int n_args)
@@ -43,11 +49,17 @@ int BROWN::init(double p[], int n_args)
 		return DONT_SCHEDULE;
 	if (outputChannels() > 2)
 		return die("BROWN", "Use mono or stereo output only.");
+
+	if (RTOption::blockNoise())
+		_noise.scoreseed();
+
 	return nSamps();
 }
 
 int BROWN::configure()
 {
+	if (RTOption::blockNoise())
+		_steps = new float [RTBUFSAMPS];
 	return 0;
 }
 
@@ -61,6 +73,9 @@ void BROWN::doupdate()
 
 int BROWN::run()
 {
+	if (_steps)
+		_noise.fillBlock(_steps, framesToRun());
+
 	for (int i = 0; i < framesToRun(); i++) {
 		if (--_branch <= 0) {
 			doupdate();
@@ -68,7 +83,14 @@ int BROWN::run()
 		}
 		float out[2];
 
-		while (true) {
+		// A step that would leave the range is drawn again.
+		if (_steps) {
+			float r = _steps[i];
+			while (_brown + r < -8.0 || _brown + r > 8.0)
+				r = _noise.rand();
+			_brown += r;
+		}
+		else while (true) {
 			float r = rrand();
 			_brown += r;
 			if (_brown <- 8.0 || _brown > 8.0)
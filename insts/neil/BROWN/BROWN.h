@@ -14,5 +14,7 @@ private:
 
 	int _nargs, _branch;
 	float _brown, _amp, _pan;
+	float *_steps;
+	Orandblock _noise;
 };
 
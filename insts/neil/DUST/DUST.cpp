@@ -20,16 +20,15 @@
 #include "DUST.h"
 #include <rt.h>
 #include <rtdefs.h>
-#include <random>
-#include <ctime>
 
 DUST::DUST()
-	: _branch(0)
+	: _branch(0), _throws(NULL)
 {
 }
 
 DUST::~DUST()
 {
+	delete [] _throws;
 }
 
 int DUST::init(double p[], int n_args)
@@ -38,8 +37,6 @@ int DUST::init(double p[], int n_args)
 
 	const float outskip = p[0];
 	const float dur = p[1];
-	_dice = new Orand();
-	_dice->timeseed();
 	_range = (_nargs > 4) ? p[4] : -1;
 	if (!((_range == 0) || (_range == -1)))
 		return die("DUST", "p[4] range minimum must be either -1 or 0.");
@@ -49,16 +46,19 @@ int DUST::init(double p[], int n_args)
 	if (outputChannels() > 2)
 		return die("DUST", "Use mono or stereo output only.");
 
-	float seed = (_nargs > 5) ? p[5] : std::time(0);
-
-	_randgen = std::mt19937(seed);
-	_dist = std::uniform_real_distribution<double>(0, SR);
+	// The seed sets when the impulses come; their heights always vary.
+	_dice.timeseed();
+	if (_nargs > 5)
+		_noise.seed((unsigned) p[5]);
+	else
+		_noise.timeseed();
 
 	return nSamps();
 }
 
 int DUST::configure()
 {
+	_throws = new float [RTBUFSAMPS];
 	return 0;
 }
 
@@ -74,6 +74,10 @@ void DUST::doupdate()
 
 int DUST::run()
 {
+	// A throw from 0 to SR for each frame: the chance of an impulse in a
+	// frame is _density / SR.
+	_noise.fillBlock(_throws, framesToRun(), 0.0f, SR);
+
 	for (int i = 0; i < framesToRun(); i++) {
 		if (--_branch <= 0) {
 			doupdate();
@@ -83,12 +87,11 @@ int DUST::run()
 		float out[2];
 
 		float outsamp = 0.0;
-		double thisr = _dist(_randgen);
-		if (thisr < _density) {
+		if (_throws[i] < _density) {
 			if (_range == -1)
-				outsamp = _dice->rand() * _amp;
+				outsamp = _dice.rand() * _amp;
 			else
-				outsamp = _dice->random() * _amp;
+				outsamp = _dice.random() * _amp;
 		}
 
 		out[0] = outsamp;
@@ -1,5 +1,4 @@
 #include <Instrument.h>
-#include <random>
 
 class DUST : public Instrument {
 
@@ -15,7 +14,7 @@ private:
 
 	int _nargs, _branch;
 	float _amp, _pan, _density, _range;
-	Orand *_dice;
-	std::mt19937 _randgen;
-	std::uniform_real_distribution<double> _dist;
+	float *_throws;
+	Orand _dice;
+	Orandblock _noise;
 };
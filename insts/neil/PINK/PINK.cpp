@@ -10,6 +10,9 @@
    p2 (amp) and p3 (pan) can receive updates from a table or real-time
    control source.
 
+   With the block_noise option set, the white noise comes from an Orandblock
+   seeded from the srand series, rather than from that series itself.
+
    Neil Thornock <neilthornock at gmail>, 11/12/16.
 
    Algorithm by Andrew Simper (vellocet.com/dsp/noise/VRand.html), who
@@ -20,17 +23,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ugens.h>
+#include <Ougens.h>
+#include <RTOption.h>	// blockNoise
 #include "PINK.h"
 #include <rt.h>
 #include <rtdefs.h>
 
 PINK::PINK()
-	: _branch(0), _b0(0.0), _b1(0.0), _b2(0.0), _b3(0.0), _b4(0.0), _b5(0.0), _b6(0.0)
+	: _branch(0), _b0(0.0), _b1(0.0), _b2(0.0), _b3(0.0), _b4(0.0), _b5(0.0), _b6(0.0),
+	  _white(NULL)
 {
 }
 
 PINK::~PINK()
 {
+	delete [] _white;
 }
 
 int PINK::init(double p[], int n_args)
@@ -44,11 +51,16 @@ int PINK::init(double p[], int n_args)
 	if (outputChannels() > 2)
 		return die("PINK", "Use mono or stereo output only.");
 
+	if (RTOption::blockNoise())
+		_noise.scoreseed();
+
 	return nSamps();
 }
 
 int PINK::configure()
 {
+	if (RTOption::blockNoise())
+		_white = new float [RTBUFSAMPS];
 	return 0;
 }
 
@@ -64,6 +76,9 @@ void PINK::doupdate()
 
 int PINK::run()
 {
+	if (_white)
+		_noise.fillBlock(_white, framesToRun());
+
 	for (int i = 0; i < framesToRun(); i++) {
 		if (--_branch <= 0) {
 			doupdate();
@@ -76,7 +91,7 @@ int PINK::run()
 			(44100Hz sampling rate). Unity gain is at Nyquist, but can be adjusted 
 			by scaling the numbers at the end of each line.  -Paul Kellet
 		*/
-		const double white = rrand() * _amp;
+		const double white = (_white ? _white[i] : rrand()) * _amp;
 		_b0 = _b0 * 0.99886 + white * 0.0555179;
 		_b1 = _b1 * 0.99332 + white * 0.0750759;
 		_b2 = _b2 * 0.96900 + white * 0.1538520;
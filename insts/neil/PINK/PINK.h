@@ -15,5 +15,7 @@ private:
 	int _nargs, _branch;
 	double _b0, _b1, _b2, _b3, _b4, _b5, _b6;
 	float _amp, _pan;
+	float *_white;
+	Orandblock _noise;
 };
 
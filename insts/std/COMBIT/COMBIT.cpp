@@ -69,6 +69,7 @@ int COMBIT::init(double p[], int n_args)
 	if (rtsetoutput(start, dur + ringdur, this) == -1)
 		return DONT_SCHEDULE;
 	insamps = (int) (dur * SR + 0.5);
+	setTailFrames(nSamps() - insamps);	// the ring-down
 
 	if (frequency <= 0.0)
 		return die("COMBIT", "Invalid frequency value!");
@@ -87,26 +88,36 @@ int COMBIT::init(double p[], int n_args)
 
 	skip = (int) (SR / (float) resetval);
 
+	setPlanarOutput();		// we write a channel at a time
+
 	return nSamps();
 }
 
 
 int COMBIT::configure()
 {
+	if (readsInputInPlace())
+		return 0;
 	in = new float [RTBUFSAMPS * inputChannels()];
 	return in ? 0 : -1;
 }
 
 
+#define COMBIT_CHUNK 256
+
 int COMBIT::run()
 {
-	int samps = framesToRun() * inputChannels();
+	const int nframes = framesToRun();
 
+	InputChannel chans[MAXBUS];
 	if (currentFrame() < insamps)
-		rtgetin(in, this, samps);
+		rtgetinchans(chans, in, nframes * inputChannels());
+	const InputChannel &inp = chans[inchan];
 
-	for (int i = 0; i < samps; i += inputChannels())  {
-		if (--branch <= 0) {
+	float insig[COMBIT_CHUNK], sig[COMBIT_CHUNK];
+	int i = 0;
+	while (i < nframes) {
+		if (branch <= 0) {
 			double p[8];
 			update(p, 8);
 			amp = p[3];
@@ -128,21 +139,40 @@ int COMBIT::run()
 			pctleft = p[7];
 			branch = skip;
 		}
+		int count = nframes - i;
+		if (count > branch)
+			count = branch > 0 ? branch : 1;
+		if (count > COMBIT_CHUNK)
+			count = COMBIT_CHUNK;
+
+		for (int k = 0; k < count; k++) {
+			if (currentFrame() + k < insamps)
+				insig[k] = inp.samps[(i + k) * inp.stride];
+			else
+				insig[k] = 0.0;
+		}
 
-		float insig, out[2];
+		comb->next(insig, sig, count, delsamps);
 
-		if (currentFrame() < insamps)
-			insig = in[i + inchan];
-		else
-			insig = 0.0;
-		out[0] = comb->next(insig, delsamps) * amp;
+		int stride;
+		BUFTYPE *left = outputChannel(0, &stride);
 		if (outputChannels() == 2) {
-			out[1] = out[0] * (1.0 - pctleft);
-			out[0] *= pctleft;
+			BUFTYPE *right = outputChannel(1, &stride);
+			const float leftamp = amp * pctleft;
+			const float rightamp = amp * (1.0 - pctleft);
+			for (int k = 0; k < count; k++) {
+				left[k * stride] = sig[k] * leftamp;
+				right[k * stride] = sig[k] * rightamp;
+			}
 		}
-
-		rtaddout(out);
-		increment();
+		else {
+			for (int k = 0; k < count; k++)
+				left[k * stride] = sig[k] * amp;
+		}
+		advanceOutput(count);
+		increment(count);
+		branch -= count;
+		i += count;
 	}
 
 	return framesToRun();
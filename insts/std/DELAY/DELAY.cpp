@@ -85,15 +85,19 @@ int DELAY::init(double p[], int n_args)
 
 int DELAY::configure()
 {
+	if (hasChainedInput())
+		return 0;		// we read the previous instrument's output in place
 	in = new float [RTBUFSAMPS * inputChannels()];
-	return in ? 0 : -1; }
+	return in ? 0 : -1;
+}
 
 int DELAY::run()
 {
 	int samps = framesToRun() * inputChannels();
 
+	const float *inbuf = NULL;
 	if (currentFrame() < insamps)
-		rtgetin(in, this, samps);
+		inbuf = rtgetinbuf(in, samps);
 
 	for (int i = 0; i < samps; i += inputChannels())  {
 		if (--branch <= 0) {
@@ -112,7 +116,7 @@ int DELAY::run()
 		float sig, out[2];
 
 		if (currentFrame() < insamps)
-			sig = in[i + inchan] * amp;
+			sig = inbuf[i + inchan] * amp;
 		else
 			sig = 0.0;
 
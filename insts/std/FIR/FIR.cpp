@@ -5,16 +5,22 @@
 *  p2 = dur
 *  p3 = amp
 *  p4 = total number of coefficients
-*  p5...  the coefficients (up to 99 fir coefficients)
+*  p5...  the coefficients, or a table holding them (e.g., from maketable
+*         "literal" or "datafile"), for filters too long to list here
 *
 *  p3 (amp) can receive updates.
 *  mono input / mono output only
+*
+*  There is no limit on the number of coefficients.  Past a few hundred,
+*  most of the filter is done by FFT convolution, so that linear-phase
+*  filters of thousands of coefficients are cheap to run (see Ofir.h).
 */
 #include <stdio.h>
 #include <stdlib.h>
 #include <ugens.h>
 #include <mixerr.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include "FIR.h"
 #include <rt.h>
 #include <rtdefs.h>
@@ -22,12 +28,14 @@
 FIR::FIR() : Instrument()
 {
 	in = NULL;
+	fir = NULL;
 	branch = 0;
 }
 
 FIR::~FIR()
 {
 	delete [] in;
+	delete fir;
 }
 
 int FIR::init(double p[], int n_args)
@@ -37,10 +45,22 @@ int FIR::init(double p[], int n_args)
 	if (rtsetoutput(p[0], p[2], this) == -1)
 		return DONT_SCHEDULE;
 
-	ncoefs = (int)p[4];
-	for (int i = 0; i < ncoefs; i++) {
-		coefs[i] = p[i+6]; 
-		pastsamps[i] = 0.0;
+	int ncoefs = (int)p[4];
+	if (ncoefs < 1)
+		return die("FIR", "Need at least one coefficient.");
+	int tablelen = 0;
+	const double *table = (n_args == 6) ? getPFieldTable(5, &tablelen) : NULL;
+	if (table) {
+		if (tablelen < ncoefs)
+			return die("FIR", "Asked for %d coefficients, but the table has "
+			           "only %d.", ncoefs, tablelen);
+		fir = new Ofir(table, ncoefs);
+	}
+	else {
+		if (n_args < ncoefs + 5)
+			return die("FIR", "Asked for %d coefficients, but only %d given.",
+			           ncoefs, n_args - 5);
+		fir = new Ofir(&p[5], ncoefs);
 	}
 
 	amp = p[3];
@@ -70,15 +90,7 @@ int FIR::run()
 			amp = p[3];
 			branch = skip;
 		}
-		out[0] = 0.0;
-		pastsamps[0] = in[i * inputChannels()];
-
-		for (int j = 0; j < ncoefs; j++) 
-			out[0] += (pastsamps[j] * coefs[j]);
-		for (int j = ncoefs-1; j >= 1; j--)
-			pastsamps[j] = pastsamps[j-1];
-
-		out[0] *= amp;
+		out[0] = fir->next(in[i * inputChannels()]) * amp;
 		rtaddout(out);
 		increment();
 	}
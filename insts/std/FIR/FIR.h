@@ -1,8 +1,9 @@
+class Ofir;
+
 class FIR : public Instrument {
-	int ncoefs, branch, skip;
-	float pastsamps[101];
-	float coefs[101];
+	int branch, skip;
 	float amp, *in;
+	Ofir *fir;
 
 public:
 	FIR();
@@ -27,12 +27,20 @@
    **** If p9 is missing, you must use an old-style gen table 3 for the
    index guide function.
 
+   With set_option("voice_pool = true"), notes that give both p8 and p9 and
+   have no gen table 1 are played as voices of one long-lived FMINST, which
+   saves the cost of making an instrument for each.  A pooled note returns
+   no handle.
+
                                                 rev for v4, JGG, 7/12/04
 */
 #include <stdlib.h>
 #include <stdio.h>
+#include <new>
 #include <ugens.h>
+#include <fastmath.h>
 #include <Instrument.h>
+#include <VoicePool.h>
 #include <PField.h>
 #include <RTOption.h>		// for fastUpdate
 #include "FMINST.h"
@@ -163,14 +171,14 @@ void FMINST::doupdate()
 	if (p[3] != carfreqraw) {
 		carfreqraw = p[3];
 		if (carfreqraw < 15.0)
-			carfreq = cpspch(carfreqraw);
+			carfreq = fastcpspch(carfreqraw);
 		else
 			carfreq = carfreqraw;
 	}
 	if (p[4] != modfreqraw) {
 		modfreqraw = p[4];
 		if (modfreqraw < 15.0)
-			modfreq = cpspch(modfreqraw);
+			modfreq = fastcpspch(modfreqraw);
 		else
 			modfreq = modfreqraw;
 		modosc->setfreq(modfreq);
@@ -227,6 +235,96 @@ int FMINST::run()
 	return framesToRun();
 }
 
+FMINSTPool::FMINSTPool()
+{
+	voices = new Voice [kMaxNotes];
+	carosc = (Ooscili *) ::operator new(sizeof(Ooscili) * kMaxNotes);
+	modosc = (Ooscili *) ::operator new(sizeof(Ooscili) * kMaxNotes);
+}
+
+FMINSTPool::~FMINSTPool()
+{
+	delete [] voices;
+	::operator delete(carosc);
+	::operator delete(modosc);
+}
+
+bool FMINSTPool::acceptNote(int voice, const double p[],
+	PField * const fields[], int nargs)
+{
+	if (outputChannels() > 2 || floc(AMP_GEN_SLOT) != NULL || nargs < 10
+			|| fields[8] == NULL)
+		return false;
+	double *wavetable = (double *) *fields[8];
+	if (wavetable == NULL)
+		return false;
+	const int tablelen = fields[8]->values();
+
+	Voice &v = voices[voice];
+	v.carfreqraw = p[3];
+	v.carfreq = (v.carfreqraw < 15.0) ? cpspch(v.carfreqraw) : v.carfreqraw;
+	v.modfreqraw = p[4];
+	v.modfreq = (v.modfreqraw < 15.0) ? cpspch(v.modfreqraw) : v.modfreqraw;
+	new (&carosc[voice]) Ooscili(SR, v.carfreq, wavetable, tablelen);
+	new (&modosc[voice]) Ooscili(SR, v.modfreq, wavetable, tablelen);
+	return true;
+}
+
+// As FMINST::doupdate(), with the guide pfield
+
+void FMINSTPool::updateVoice(int voice, const double p[], int nargs)
+{
+	Voice &v = voices[voice];
+	v.amp = p[2];
+
+	if (p[3] != v.carfreqraw) {
+		v.carfreqraw = p[3];
+		v.carfreq = (v.carfreqraw < 15.0) ? fastcpspch(v.carfreqraw) : v.carfreqraw;
+	}
+	if (p[4] != v.modfreqraw) {
+		v.modfreqraw = p[4];
+		v.modfreq = (v.modfreqraw < 15.0) ? fastcpspch(v.modfreqraw) : v.modfreqraw;
+		modosc[voice].setfreq(v.modfreq);
+	}
+
+	float minindex = p[5];
+	float maxindex = p[6];
+	if (minindex > maxindex) {		// swap if wrong order
+		float tmp = minindex;
+		minindex = maxindex;
+		maxindex = tmp;
+	}
+	float index = minindex + ((maxindex - minindex) * p[9]);
+	v.peakdev = index * v.modfreq;
+
+	v.pan = p[7];
+}
+
+void FMINSTPool::renderVoice(int voice, float *outs[], int frames)
+{
+	Voice &v = voices[voice];
+	float sig[kBlockFrames], freqs[kBlockFrames];
+
+	modosc[voice].nextBlock(sig, frames);
+	for (int j = 0; j < frames; j++)
+		freqs[j] = v.carfreq + sig[j] * v.peakdev;
+	carosc[voice].nextBlock(sig, freqs, frames);
+
+	if (outputChannels() == 2) {
+		float *left = outs[0], *right = outs[1];
+		for (int j = 0; j < frames; j++) {
+			const float out = sig[j] * v.amp;
+			left[j] += out * v.pan;
+			right[j] += (1.0 - v.pan) * out;
+		}
+	}
+	else {
+		float *mono = outs[0];
+		for (int j = 0; j < frames; j++)
+			mono[j] += sig[j] * v.amp;
+	}
+}
+
 Instrument *makeFMINST()
 {
 	FMINST *inst;
@@ -237,9 +335,16 @@ Instrument *makeFMINST()
 	return inst;
 }
 
+VoicePool *makeFMINSTPool()
+{
+	FMINSTPool *pool = new FMINSTPool();
+	pool->set_bus_config("FMINST");
+	return pool;
+}
+
 #ifndef EMBEDDED
 void rtprofile()
 {
-	RT_INTRO("FMINST",makeFMINST);
+	RT_INTRO_POOL("FMINST",makeFMINST,makeFMINSTPool);
 }
 #endif
@@ -17,3 +17,23 @@ public:
 	virtual int init(double *, int);
 	virtual int run();
 };
+
+// FMINST notes played as the voices of one instrument, for the voice_pool
+// option (see VoicePool.h).  Notes that use makegen tables are left to
+// FMINST itself.
+
+class FMINSTPool : public VoicePool {
+	struct Voice {
+		float amp, carfreq, carfreqraw, modfreq, modfreqraw, peakdev, pan;
+	};
+	Voice *voices;
+	Ooscili *carosc, *modosc;	// one per voice, made in place
+protected:
+	virtual bool acceptNote(int voice, const double p[], PField * const fields[],
+	                        int nargs);
+	virtual void updateVoice(int voice, const double p[], int nargs);
+	virtual void renderVoice(int voice, float *outs[], int frames);
+public:
+	FMINSTPool();
+	virtual ~FMINSTPool();
+};
@@ -0,0 +1,156 @@
+// LPCFrameCache.cpp -- see LPCFrameCache.h
+
+#include "LPCFrameCache.h"
+#include "LPCDataSet.h"
+#include "lp.h"
+#include <Lockable.h>
+#include <ugens.h>
+#include <string.h>
+#include <vector>
+
+#define FRAMES_PER_BLOCK	64		// frames stabilized by one parallel call
+#define MAX_DATASETS		4
+#define MAX_PITCH_TRACKS	32
+
+LPCStableFrames::LPCStableFrames(LPCDataSet *dataSet,
+								 LPCParallelRunner runInParallel)
+	: _frameCount((int) dataSet->getFrameCount()),
+	  _frameSize(dataSet->getNPoles() + 4)
+{
+	_frames = new float[_frameCount * _frameSize];
+	for (int frame = 0; frame < _frameCount; ++frame) {
+		if (dataSet->getFrame((double) frame, &_frames[frame * _frameSize]) < 0) {
+			_frameCount = frame;
+			break;
+		}
+	}
+	const int blocks = (_frameCount + FRAMES_PER_BLOCK - 1) / FRAMES_PER_BLOCK;
+	runInParallel(stabilizeFrames, this, blocks);
+}
+
+LPCStableFrames::~LPCStableFrames()
+{
+	delete [] _frames;
+}
+
+void LPCStableFrames::stabilizeFrames(void *context, int block)
+{
+	LPCStableFrames *self = (LPCStableFrames *) context;
+	const int first = block * FRAMES_PER_BLOCK;
+	int last = first + FRAMES_PER_BLOCK;
+	if (last > self->_frameCount)
+		last = self->_frameCount;
+	for (int frame = first; frame < last; ++frame)
+		stabilize(&self->_frames[frame * self->_frameSize], self->_frameSize - 4);
+}
+
+int LPCStableFrames::getFrame(double frameno, float *coeffs) const
+{
+	const int frame = (int) frameno;
+	const double fraction = frameno - (double) frame;
+	if (frame < 0 || frame >= _frameCount) {
+		rtcmix_warn("LPC", "reached eof on analysis file");
+		return -1;
+	}
+	const int next = (frame + 1 < _frameCount) ? frame + 1 : frame;
+	const float *a = &_frames[frame * _frameSize];
+	const float *b = &_frames[next * _frameSize];
+	for (int j = 0; j < _frameSize; ++j)
+		coeffs[j] = a[j] + fraction * (b[j] - a[j]);
+	return 0;
+}
+
+// The cache.  Both lists are short, and searched only by notes being set
+// up, so they are plain vectors under one lock, newest entries last.
+
+struct CachedTrack {
+	LPCDataSet			*dataSet;
+	LPCPitchSettings	settings;
+	std::vector<double>	pitches;
+	int					unvoicedCount;
+	int					initialUnvoicedCount;
+	float				weight;
+};
+
+struct CachedFrames {
+	LPCDataSet		*dataSet;
+	LPCStableFrames	*frames;
+};
+
+static Lockable sCacheLock;
+static std::vector<CachedTrack> sTracks;
+static std::vector<CachedFrames> sFrames;
+
+static bool sameSettings(const LPCPitchSettings &a, const LPCPitchSettings &b)
+{
+	return a.first == b.first && a.last == b.last
+		&& a.highthresh == b.highthresh && a.fixOctave == b.fixOctave
+		&& a.fixGaps == b.fixGaps && a.smoothing == b.smoothing;
+}
+
+bool LPCFrameCache::findPitchTrack(LPCDataSet *dataSet,
+								   const LPCPitchSettings &settings,
+								   LPCPitchTrack *track)
+{
+	AutoLock lock(sCacheLock);
+	for (size_t n = 0; n < sTracks.size(); ++n) {
+		const CachedTrack &cached = sTracks[n];
+		if (cached.dataSet == dataSet && sameSettings(cached.settings, settings)) {
+			track->frameCount = (int) cached.pitches.size();
+			memcpy(track->pitches, &cached.pitches[0],
+				   cached.pitches.size() * sizeof(double));
+			track->unvoicedCount = cached.unvoicedCount;
+			track->initialUnvoicedCount = cached.initialUnvoicedCount;
+			track->weight = cached.weight;
+			return true;
+		}
+	}
+	return false;
+}
+
+void LPCFrameCache::addPitchTrack(LPCDataSet *dataSet,
+								  const LPCPitchSettings &settings,
+								  const LPCPitchTrack &track)
+{
+	AutoLock lock(sCacheLock);
+	if (sTracks.size() >= MAX_PITCH_TRACKS) {
+		RefCounted::unref(sTracks.front().dataSet);
+		sTracks.erase(sTracks.begin());
+	}
+	CachedTrack cached;
+	cached.dataSet = dataSet;
+	cached.settings = settings;
+	cached.pitches.assign(track.pitches, track.pitches + track.frameCount);
+	cached.unvoicedCount = track.unvoicedCount;
+	cached.initialUnvoicedCount = track.initialUnvoicedCount;
+	cached.weight = track.weight;
+	// The reference keeps another data set from reusing this address.
+	dataSet->ref();
+	sTracks.push_back(cached);
+}
+
+LPCStableFrames *LPCFrameCache::stableFrames(LPCDataSet *dataSet,
+											  LPCParallelRunner runInParallel)
+{
+	AutoLock lock(sCacheLock);
+	for (size_t n = 0; n < sFrames.size(); ++n) {
+		if (sFrames[n].dataSet == dataSet) {
+			sFrames[n].frames->ref();
+			return sFrames[n].frames;
+		}
+	}
+	if (sFrames.size() >= MAX_DATASETS) {
+		RefCounted::unref(sFrames.front().frames);
+		RefCounted::unref(sFrames.front().dataSet);
+		sFrames.erase(sFrames.begin());
+	}
+	rtcmix_advise("LPCPLAY", "Stabilizing %d frames", (int) dataSet->getFrameCount());
+	CachedFrames cached;
+	cached.dataSet = dataSet;
+	cached.frames = new LPCStableFrames(dataSet, runInParallel);
+	dataSet->ref();
+	cached.frames->ref();		// the cache's
+	cached.frames->ref();		// the caller's
+	sFrames.push_back(cached);
+	return cached.frames;
+}
@@ -0,0 +1,73 @@
+// LPCFrameCache.h -- frame data worked out once per LPCDataSet, and shared
+// by every note that reads the same frames with the same settings.
+
+#ifndef _LPCFRAMECACHE_H_
+#define _LPCFRAMECACHE_H_
+
+#include <RefCounted.h>
+
+class LPCDataSet;
+
+// The pitch track LPCPLAY::localInit() makes for frames <first> to <last>:
+// each frame's pitch after the octave, gap and smoothing passes, how many
+// frames are unvoiced (at the start, and in all), and the weighted average
+// pitch.  A score playing 50 notes from one .lpc file makes it once.
+
+struct LPCPitchSettings {
+	int		first, last;
+	double	highthresh;
+	float	fixOctave;			// -1 for none
+	bool	fixGaps;
+	float	smoothing;			// 0 for none
+};
+
+struct LPCPitchTrack {
+	int		frameCount;
+	double	*pitches;			// [frameCount]
+	int		unvoicedCount;
+	int		initialUnvoicedCount;
+	float	weight;
+};
+
+// Every frame of a data set, stabilized once as use_autocorrect() asks,
+// the unstable ones factored in parallel.  getFrame() interpolates between
+// them as LPCDataSet::getFrame() does; the caller stabilizes the result,
+// which is nearly always stable already, so the costly factoring seldom
+// runs while notes play.
+
+// Instrument::runInParallel, passed in by the instrument, which may call it.
+typedef void (*LPCParallelRunner)(void (*func)(void *context, int index),
+								  void *context, int count);
+
+class LPCStableFrames : public RefCounted {
+public:
+	LPCStableFrames(LPCDataSet *dataSet, LPCParallelRunner runInParallel);
+	int		getFrame(double frameno, float *coeffs) const;
+protected:
+	virtual ~LPCStableFrames();
+private:
+	static void	stabilizeFrames(void *context, int block);
+	int			_frameCount;
+	int			_frameSize;		// floats per frame
+	float		*_frames;
+};
+
+class LPCFrameCache {
+public:
+	// Copy the cached track for <settings> from <dataSet> into <track>,
+	// whose pitches must have room for it, and return true; or return
+	// false if there is none.
+	static bool		findPitchTrack(LPCDataSet *dataSet,
+								   const LPCPitchSettings &settings,
+								   LPCPitchTrack *track);
+	static void		addPitchTrack(LPCDataSet *dataSet,
+								  const LPCPitchSettings &settings,
+								  const LPCPitchTrack &track);
+	// The stabilized frames of <dataSet>, made if need be, with a
+	// reference for the caller.  The cache keeps the last few data sets
+	// used, and holds a reference to each.
+	static LPCStableFrames *	stableFrames(LPCDataSet *dataSet,
+											 LPCParallelRunner runInParallel);
+};
+
+#endif	// _LPCFRAMECACHE_H_
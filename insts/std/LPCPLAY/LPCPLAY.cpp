@@ -24,6 +24,7 @@
 #include "LPCPLAY.h"
 #include "LPCDataSet.h"
 #include "setup.h"
+#include "LPCFrameCache.h"
 
 static const float kDefaultFrequency = 256.0;
 
@@ -182,7 +183,8 @@ extern int GetConfiguration(float *maxdev,
                             float *smoothingFactor);
 
 LPCINST::LPCINST(const char *name)
-	: _dataSet(NULL), _alpvals(NULL), _buzvals(NULL), _functionName(name)
+	: _dataSet(NULL), _stableFrames(NULL), _alpvals(NULL), _buzvals(NULL),
+	  _functionName(name)
 {
 	_autoCorrect = false;
 	_jcount = _counter = 0; 
@@ -192,6 +194,7 @@ LPCINST::LPCINST(const char *name)
 
 LPCINST::~LPCINST()
 {
+	RefCounted::unref(_stableFrames);
 	RefCounted::unref(_dataSet);
 	delete [] _alpvals;
 	delete [] _buzvals;
@@ -225,6 +228,11 @@ int LPCINST::init(double p[], int n_args)
 	if (rval == DONT_SCHEDULE)
 		return die(name(), "LocalInit failed.");
 
+	// Every note stabilizing the same frames, over and over as it plays, is
+	// slow enough to make buffers late; the cache does each frame once.
+	if (_autoCorrect)
+		_stableFrames = LPCFrameCache::stableFrames(_dataSet, runInParallel);
+
 	// Finish the initialization
 	
 	for (int i=0; i<_nPoles*2; i++) _past[i] = 0;
@@ -235,6 +243,19 @@ int LPCINST::init(double p[], int n_args)
 	return nSamps();
 }
 
+int
+LPCINST::readFrame(double frameno, float *coeffs)
+{
+	if (_stableFrames == NULL)
+		return _dataSet->getFrame(frameno, coeffs);
+	if (_stableFrames->getFrame(frameno, coeffs) == -1)
+		return -1;
+	// Between two stable frames is nearly always stable too, and then
+	// this only checks.
+	stabilize(coeffs, _nPoles);
+	return 0;
+}
+
 int
 LPCINST::configure()
 {
@@ -326,45 +347,26 @@ int LPCPLAY::localInit(double p[], int n_args)
 	// Pitch table
 	_pchvals = new double[lpcFrameCount];
 
-    // Read the pitch values out of data set into _pchvals array
 	_lpcFrames = lpcFrameCount;
 	_lpcFrame1 = startLPCFrame;
-    int unvoicedCount = 0, initialUnvoicedCount = 0;
-    bool firstVoicedFound = false;
-	for (i = startLPCFrame; i <= endLPCFrame; ++i) {
-		double dindex = i;
-		if (_dataSet->getFrame(dindex, _coeffs) < 0)
-			break;
-        /* This is just in case I am using datasets with no pitch value stored */
-		_pchvals[i - startLPCFrame] = (_coeffs[PITCH] != 0.0 ? _coeffs[PITCH] : kDefaultFrequency);
-        
-        if (_coeffs[THRESH] > _highthresh) {
-            ++unvoicedCount;
-            // Count initial set of unvoiced - preprocessors will skip these
-            if (!firstVoicedFound) {
-                ++initialUnvoicedCount;
-            }
-        }
-        else {
-            firstVoicedFound = true;
-        }
+
+	// Notes reading the same frames with the same settings share the pitch
+	// track the first of them made.
+	LPCPitchSettings settings;
+	settings.first = startLPCFrame;
+	settings.last = endLPCFrame;
+	settings.highthresh = _highthresh;
+	settings.fixOctave = pitchFixOctave;
+	settings.fixGaps = fixPitchGaps;
+	settings.smoothing = smoothingFactor;
+	LPCPitchTrack track;
+	track.pitches = _pchvals;
+	if (!LPCFrameCache::findPitchTrack(_dataSet, settings, &track)) {
+		makePitchTrack(settings, &track);
+		LPCFrameCache::addPitchTrack(_dataSet, settings, track);
 	}
-    // This pitch preprocessors operate on just the pitches in frames specified by LPCPLAY.
-    if (pitchFixOctave != -1.0) {
-        rtcmix_advise("LPCPLAY", "Fixing octaves");
-        ::fixOctaves(_pchvals, lpcFrameCount, initialUnvoicedCount, pitchFixOctave);
-    }
-    if (fixPitchGaps) {
-        rtcmix_advise("LPCPLAY", "Fixing pitch gaps");
-        ::fixGaps(_pchvals, lpcFrameCount, initialUnvoicedCount, pitchFixOctave);
-    }
-    if (smoothingFactor != 0.0) {
-        rtcmix_advise("LPCPLAY", "Smoothing pitch curve");
-       ::smooth(_pchvals, lpcFrameCount, initialUnvoicedCount, smoothingFactor);
-    }
-    _actualWeight = weight(startLPCFrame, endLPCFrame, (float)_highthresh);
-	if (_actualWeight == 0.0)
-        _actualWeight = kDefaultFrequency;
+	const int unvoicedCount = track.unvoicedCount;
+	_actualWeight = track.weight;
     
     const float defaultFrameRate = 220.5;   // DAS changed from 112, which was the original rate in cmix
     // User specified duration, so calculate LPC frame increments
@@ -541,18 +543,12 @@ int LPCPLAY::run()
             }
         }
         
-        // We lock the data set here only because we dont want reentrant calls from parallel LPCPLAY calls.
-        _dataSet->lock();
-        if (_dataSet->getFrame(_lpcFrameno,_coeffs) == -1) {
+        // Safe to call from parallel LPCPLAY notes: see LPCDataSet.h.
+        if (readFrame(_lpcFrameno,_coeffs) == -1) {
             _amp = 0.0;
-            _dataSet->unlock();
 			break;
         }
-        _dataSet->unlock();
 
-        // If requested, stabilize this frame before using
-		if (_autoCorrect)
-			stabilize(_coeffs, _nPoles);
         double voicedAmp = getVoicedAmp(_coeffs[THRESH]);
         _voiced = (voicedAmp > _highthresh);
 #ifdef debug
@@ -740,6 +736,57 @@ LPCPLAY::getVoicedAmp(float err)
 	return amp;
 }
 
+// The pitches of frames <settings.first> to <settings.last>, put through the
+// preprocessors set up by the score, into <track>.
+
+void
+LPCPLAY::makePitchTrack(const LPCPitchSettings &settings, LPCPitchTrack *track)
+{
+	const int startLPCFrame = settings.first;
+	const int endLPCFrame = settings.last;
+	const int lpcFrameCount = endLPCFrame - startLPCFrame + 1;
+	double *pchvals = track->pitches;
+    int unvoicedCount = 0, initialUnvoicedCount = 0;
+    bool firstVoicedFound = false;
+	for (int i = startLPCFrame; i <= endLPCFrame; ++i) {
+		double dindex = i;
+		if (_dataSet->getFrame(dindex, _coeffs) < 0)
+			break;
+        /* This is just in case I am using datasets with no pitch value stored */
+		pchvals[i - startLPCFrame] = (_coeffs[PITCH] != 0.0 ? _coeffs[PITCH] : kDefaultFrequency);
+        
+        if (_coeffs[THRESH] > settings.highthresh) {
+            ++unvoicedCount;
+            // Count initial set of unvoiced - preprocessors will skip these
+            if (!firstVoicedFound) {
+                ++initialUnvoicedCount;
+            }
+        }
+        else {
+            firstVoicedFound = true;
+        }
+	}
+    // This pitch preprocessors operate on just the pitches in frames specified by LPCPLAY.
+    if (settings.fixOctave != -1.0) {
+        rtcmix_advise("LPCPLAY", "Fixing octaves");
+        ::fixOctaves(pchvals, lpcFrameCount, initialUnvoicedCount, settings.fixOctave);
+    }
+    if (settings.fixGaps) {
+        rtcmix_advise("LPCPLAY", "Fixing pitch gaps");
+        ::fixGaps(pchvals, lpcFrameCount, initialUnvoicedCount, settings.fixOctave);
+    }
+    if (settings.smoothing != 0.0) {
+        rtcmix_advise("LPCPLAY", "Smoothing pitch curve");
+       ::smooth(pchvals, lpcFrameCount, initialUnvoicedCount, settings.smoothing);
+    }
+	track->frameCount = lpcFrameCount;
+	track->unvoicedCount = unvoicedCount;
+	track->initialUnvoicedCount = initialUnvoicedCount;
+    track->weight = weight(startLPCFrame, endLPCFrame, (float)settings.highthresh);
+	if (track->weight == 0.0)
+        track->weight = kDefaultFrequency;
+}
+
 float
 LPCPLAY::weight(float frame1, float frame2, float thresh)
 {
@@ -960,18 +1007,12 @@ int LPCIN::run()
         printf("\tthis=%p: getting frame %.1f of %d (%d out of %d signal samps)\n",
 			   this, _lpcFrameno, (int)_lpcFrames, currentFrame(), nSamps());
 #endif
-        // We lock the data set here only because we dont want reentrant calls from parallel LPCIN calls.
-        _dataSet->lock();
-        if (_dataSet->getFrame(_lpcFrameno,_coeffs) == -1) {
+        // Safe to call from parallel LPCIN notes: see LPCDataSet.h.
+        if (readFrame(_lpcFrameno,_coeffs) == -1) {
             _amp = 0.0;
-            _dataSet->unlock();
 			break;
         }
-        _dataSet->unlock();
 
-		// If requested, stabilize this frame before using
-		if (_autoCorrect)
-			stabilize(_coeffs, _nPoles);
 
 		_ampmlt = _amp * _coeffs[RESIDAMP] / 10000.0;	// XXX normalize this!
 		float newcps = (_coeffs[PITCH] > 0.0) ? _coeffs[PITCH] : 64.0;
@@ -4,6 +4,9 @@
 #define MAXVALS 2000
 
 class LPCDataSet;
+class LPCStableFrames;
+struct LPCPitchSettings;
+struct LPCPitchTrack;
 
 class LPCINST : public Instrument {
 public:
@@ -32,9 +35,12 @@ protected:
 protected:
 	virtual int 	localInit(double *, int) = 0;
 	virtual void	SetupArrays(int frameCount) = 0;
+	// Frame <frameno>, stabilized if use_autocorrect() asked for it.
+	int				readFrame(double frameno, float *coeffs);
 
 	// These are set via external routines and copied in during init.
 	LPCDataSet	*_dataSet;
+	LPCStableFrames	*_stableFrames;		// if _autoCorrect
 
 	// These are set and used within subclasses.
 	double	_amp;
@@ -72,6 +78,7 @@ protected:
 	virtual int 	localInit(double *, int);
 	virtual void	SetupArrays(int frameCount);
 	double	getVoicedAmp(float err);
+	void	makePitchTrack(const LPCPitchSettings &settings, LPCPitchTrack *track);
 	float	weight(float frame1, float frame2, float thresh);
 	float	deviation(float frame1, float frame2, float weight, float thresh);
 	void	adjust(float actdev, float desdev, float actweight, 
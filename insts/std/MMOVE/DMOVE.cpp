@@ -139,40 +139,8 @@ void DMOVE::get_tap(int currentSamp, int chan, int path, int len)
    double incr = 1.0 + delta / len;
 
    const int tap = currentSamp % m_tapsize;
-   register double outTap = (double) tap - outloc;
-   if (outTap < 0.0) outTap += m_tapsize;
-   double *tapdel = m_tapDelay;
-   double *Sig = vec->Sig;
-    int out = 0;
-    
-    int len1 = (m_tapsize - (outTap + 1.0)) / incr;     // boundary point before needing to wrap
-    int count = 0;
-    int sampsNeeded = len;
-    while (sampsNeeded > 0 && count++ < len1) {
-        const int iOuttap = (int) outTap;
-        const double frac = outTap - (double)iOuttap;
-        Sig[out++] = tapdel[iOuttap] + frac * (tapdel[iOuttap+1] - tapdel[iOuttap]);
-        outTap += incr;
-        --sampsNeeded;
-    }
-    while (sampsNeeded > 0 && outTap < (double) m_tapsize) {
-        const int iOuttap = (int) outTap;
-        const double frac = outTap - (double)iOuttap;
-        int outTapPlusOne = int(outTap + 1.0);
-        if (outTapPlusOne >= m_tapsize)
-            outTapPlusOne -= m_tapsize;
-        Sig[out++] = tapdel[iOuttap] + frac * (tapdel[outTapPlusOne] - tapdel[iOuttap]);
-        outTap += incr;
-        --sampsNeeded;
-    }
-    outTap -= m_tapsize;
-    while (sampsNeeded > 0) {
-        const int iOuttap = (int) outTap;
-        const double frac = outTap - (double)iOuttap;
-        Sig[out++] = tapdel[iOuttap] + frac * (tapdel[iOuttap+1] - tapdel[iOuttap]);
-        outTap += incr;
-        --sampsNeeded;
-    }
+   get_moving_tap(m_tapDelay, m_tapsize, (double) tap - outloc, incr,
+                  vec->Sig, len);
 }
 
 // This gets called every internal buffer's worth of samples.  The actual
@@ -318,29 +318,32 @@ int MBASE::run()
 				return -1;
 
 			DBG1(printf("  vector loop: bufsamps = %d\n", bufsamps));
-			for (int ch = 0; ch < 2; ch++) {
-				for (int path = 0; path < m_paths; path++) {
-					Vector *vec = &m_vectors[ch][path];
-					/* get delayed samps */
-					get_tap(thisFrame, ch, path, bufsamps);
-#if 0				
-                    DBG(printf("signal [%d][%d] before filters:\n", ch, path));
-					DBG(PrintSig(vec->Sig, bufsamps));
-#endif
-					/* air absorpt. filters */
-         			air(vec->Sig, bufsamps, vec->Airdata);			
-					/* wall absorpt. filters */
-					if (path > 0)	// no filtering of direct signal
-         				wall(vec->Sig, bufsamps, vec->Walldata);
-					/* do binaural angle filters if necessary*/
-					if (m_binaural)	{					
-						fir(vec->Sig, thisFrame, g_Nterms[path], 
-					    	vec->Fircoeffs, vec->Firtaps, bufsamps);
+			for (int path = 0; path < m_paths; path++) {
+				Vector *lvec = &m_vectors[0][path];
+				Vector *rvec = &m_vectors[1][path];
+				/* get delayed samps */
+				get_tap(thisFrame, 0, path, bufsamps);
+				get_tap(thisFrame, 1, path, bufsamps);
+				/* air and wall absorpt. filters, for both channels at once;
+				   no wall filtering of direct signal */
+				if (path > 0)
+					air_wall_pair(lvec->Sig, rvec->Sig, bufsamps,
+					              lvec->Airdata, rvec->Airdata,
+					              lvec->Walldata, rvec->Walldata);
+				else
+					air_wall_pair(lvec->Sig, rvec->Sig, bufsamps,
+					              lvec->Airdata, rvec->Airdata, NULL, NULL);
+				/* do binaural angle filters if necessary*/
+				if (m_binaural) {
+					for (int ch = 0; ch < 2; ch++) {
+						Vector *vec = &m_vectors[ch][path];
+						fir(vec->Sig, thisFrame, g_Nterms[path],
+						    vec->Fircoeffs, vec->Firtaps, bufsamps);
 					}
-                    DBG(printf("signal [%d][%d] before rvb:\n", ch, path));
-                    DBG(PrintSig(vec->Sig, bufsamps));
-//                    DBG(PrintSig(vec->Sig, bufsamps, SIG_THRESH));
-		 		}
+				}
+				DBG(printf("signal [%d] before rvb:\n", path));
+				DBG(PrintSig(lvec->Sig, bufsamps));
+				DBG(PrintSig(rvec->Sig, bufsamps));
 			}
 			DBG(printf("summing vectors\n"));
 			Vector *vec;
@@ -517,7 +520,6 @@ int MBASE::roomtrig(double A,                 /* 'rho' or 'x' */
                     int    cart)
 {
    register int i;
-   double x[13], y[13], r[13], t[13], d[4], Ra[2], Ta[2];
    double X, Y, R, T;
    const double z = 0.017453292;  /* Pi / 180 */
 
@@ -549,102 +551,16 @@ int MBASE::roomtrig(double A,                 /* 'rho' or 'x' */
       return (1);
    }
 
-   /* multiply global dimension array by 2 to save calc. time */
-
-   for (i = 0; i < 4; ++i)
-      d[i] = Dimensions[i] * 2.0;
-
-   /* image calculations */
-
-   /* source vector */
-   x[0] = X;
-   y[0] = Y;
-   t[0] = T;
-   r[0] = R;
-
-   /* front wall vector */
-   x[1] = X;
-   y[1] = d[0] - Y;
-   t[1] = atan(x[1] / y[1]);
-   r[1] = y[1] / cos(t[1]);
-
-   /* right wall vector */
-   x[2] = d[1] - X;
-   y[2] = Y;
-   t[2] = PI / 2.0 - atan(y[2] / x[2]);
-   r[2] = x[2] / sin(t[2]);
-
-   /* back wall vector */
-   x[3] = X;
-   y[3] = d[2] - Y;
-   t[3] = PI + atan(x[3] / y[3]);
-   r[3] = y[3] / cos(t[3]);
-
-   /* left wall vector */
-   x[4] = d[3] - X;
-   y[4] = Y;
-   t[4] = 3. * PI / 2. - atan(y[4] / x[4]);
-   r[4] = x[4] / sin(t[4]);
-
-   /* 2nd gen. images: 4 opposing wall, 4 adjacent wall reflections */
-
-   /* front wall vector */
-   x[5] = X;
-   y[5] = d[0] - d[2] + Y;
-   t[5] = atan(x[5] / y[5]);
-   r[5] = hypot(X, y[5]);
-
-   /* right wall vector */
-   x[6] = d[1] - d[3] + X;
-   y[6] = Y;
-   t[6] = PI / 2.0 - atan(y[6] / x[6]);
-   r[6] = hypot(x[6], Y);
-
-   /* back wall vector */
-   x[7] = X;
-   y[7] = d[2] - d[0] + Y;
-   t[7] = PI + atan(x[7] / y[7]);
-   r[7] = hypot(X, y[7]);
-
-   /* left wall vector */
-   x[8] = d[3] - d[1] + X;
-   y[8] = Y;
-   t[8] = 3.0 * PI / 2.0 - atan(y[8] / x[8]);
-   r[8] = hypot(x[8], Y);
-
-   /* fr. rt. vector - double image in rectangular room, as are next 3 */
-   x[9] = x[2];
-   y[9] = y[1];
-   t[9] = atan(x[9] / y[9]);
-   r[9] = hypot(x[9], y[9]);
-
-   /* back rt. vector */
-   x[10] = x[2];
-   y[10] = y[3];
-   t[10] = PI / 2.0 - atan(y[10] / x[10]);
-   r[10] = hypot(x[10], y[10]);
-
-   /* back lft. vector */
-   x[11] = x[4];
-   y[11] = y[3];
-   t[11] = PI + atan(x[11] / y[11]);
-   r[11] = hypot(x[11], y[11]);
-
-   /* front lft. vector */
-   x[12] = x[4];
-   y[12] = y[1];
-   t[12] = 3.0 * PI / 2.0 - atan(y[12] / x[12]);
-   r[12] = hypot(x[12], y[12]);
-
-   /* calculate stereo vector pairs for each of these */
+   /* image calculations, split into stereo pairs by binaural */
+
+   double rho[2][13], theta[2][13];
+   room_images(X, Y, R, T, H, Dimensions, rho, theta);
+
    for (i = 0; i < 13; ++i) {
-      binaural(r[i], t[i], x[i], y[i], H, Ra, Ta);
-	  register Vector *lvec = &m_vectors[0][i];
-	  register Vector *rvec = &m_vectors[1][i];
-      lvec->Rho = Ra[0];
-      rvec->Rho = Ra[1];
-      lvec->Theta = Ta[0];
-      rvec->Theta = Ta[1];
+      m_vectors[0][i].Rho = rho[0][i];
+      m_vectors[1][i].Rho = rho[1][i];
+      m_vectors[0][i].Theta = theta[0][i];
+      m_vectors[1][i].Theta = theta[1][i];
    }
 
    /* Check to see that source distance is not "zero" unless we have a min distance */
@@ -120,28 +120,7 @@ void rtprofile()
 void MPLACE::get_tap(int intap, int chan, int path, int len)
 {
 	Vector *vec = &m_vectors[chan][path];
-	register double *tapdel = m_tapDelay;
-	register double *Sig = vec->Sig;
-	register int tap = intap % m_tapsize;
-    int outtap = tap - (int) vec->outloc;
-    if (outtap < 0) outtap += m_tapsize;
-
-	int len1 = min(len, m_tapsize - outtap);
-	int i;
-
-    // run till the output tap wraps, or len reached
-
-	for (i = 0; i < len1; ++i) {
-    	Sig[i] = tapdel[outtap++];
-	}
-	
-	// wrap outtap and finish if necessary
-	
-	if (outtap >= m_tapsize)
-	    outtap -= m_tapsize;
-
-	for (; i < len; ++i) {
-    	Sig[i] = tapdel[outtap++];
-	}
+	const int tap = intap % m_tapsize;
+	get_fixed_tap(m_tapDelay, m_tapsize, tap - (int) vec->outloc, vec->Sig, len);
 }
 
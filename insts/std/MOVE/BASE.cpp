@@ -279,37 +279,45 @@ int BASE::run()
 
 			DBG1(printf("  inner loop: bufsamps = %d\n", bufsamps));
 		
-			for (int ch = 0; ch < 2; ch++) {
-				for (int path = 0; path < 13; path++) {
+			for (int path = 0; path < 13; path++) {
+				Vector *lvec = &m_vectors[0][path];
+				Vector *rvec = &m_vectors[1][path];
+				/* get delayed samps */
+				get_tap(cursamp, 0, path, bufsamps);
+				get_tap(cursamp, 1, path, bufsamps);
+				/* air and wall absorpt. filters, for both channels at once;
+				   no wall filtering of direct signal */
+				if (path > 0)
+					air_wall_pair(lvec->Sig, rvec->Sig, bufsamps,
+					              lvec->Airdata, rvec->Airdata,
+					              lvec->Walldata, rvec->Walldata);
+				else
+					air_wall_pair(lvec->Sig, rvec->Sig, bufsamps,
+					              lvec->Airdata, rvec->Airdata, NULL, NULL);
+				for (int ch = 0; ch < 2; ch++) {
 					Vector *vec = &m_vectors[ch][path];
 					DBG(printf("vector[%d][%d]:\n", ch, path));
-					/* get delayed samps */
-					get_tap(cursamp, ch, path, bufsamps);
-					DBG(PrintSig(vec->Sig, bufsamps));   
-					/* air absorpt. filters */
-		 				air(vec->Sig, bufsamps, vec->Airdata);			
-					/* wall absorpt. filters */
-					if (path > 0)	// no filtering of direct signal
-		 				wall(vec->Sig, bufsamps, vec->Walldata);
+					DBG(PrintSig(vec->Sig, bufsamps));
 					/* do binaural angle filters if necessary*/
-					if (m_binaural)						
-						fir(vec->Sig, cursamp, g_Nterms[path], 
+					if (m_binaural)
+						fir(vec->Sig, cursamp, g_Nterms[path],
 							vec->Fircoeffs, vec->Firtaps, bufsamps);
-		   				// sum unscaled reflected paths as input for RVB.
+					// sum unscaled reflected paths as input for RVB.
 					// first path is set; the rest are summed
 					if (path == 1)
-						copyBuf(&roomsig[ch][0], vec->Sig, bufsamps);			 
+						copyBuf(&roomsig[ch][0], vec->Sig, bufsamps);
 					else if (path > 1)
-						addBuf(&roomsig[ch][0], vec->Sig, bufsamps);			 
+						addBuf(&roomsig[ch][0], vec->Sig, bufsamps);
 					/* now do cardioid mike effect if not binaural mode */
 					if (!m_binaural)
 						scale(vec->Sig, bufsamps, vec->MikeAmp);
 					DBG(printf("after final scale before rvb:\n"));
 					DBG(PrintSig(vec->Sig, bufsamps, 0.1));
-		 		}
-				/* scale reverb input by amp factor */
-				scale(&roomsig[ch][0], bufsamps, m_rvbamp);
+				}
 			}
+			/* scale reverb input by amp factor */
+			for (int ch = 0; ch < 2; ch++)
+				scale(&roomsig[ch][0], bufsamps, m_rvbamp);
 			/* run 1st and 2nd generation paths through reverberator */
  			for (int n = 0; n < bufsamps; n++) {
 				if (m_rvbamp != 0.0) {
@@ -760,7 +768,6 @@ int BASE::roomtrig(double A,				 /* 'rho' or 'x' */
 					int	cart)
 {
    register int i;
-   double x[13], y[13], r[13], t[13], d[4], Ra[2], Ta[2];
    double X, Y, R, T;
    const double z = 0.017453292;  /* Pi / 180 */
 
@@ -789,102 +796,16 @@ int BASE::roomtrig(double A,				 /* 'rho' or 'x' */
 	  return (1);
    }
 
-   /* multiply global dimension array by 2 to save calc. time */
-
-   for (i = 0; i < 4; ++i)
-	  d[i] = Dimensions[i] * 2.0;
-
-   /* image calculations */
-
-   /* source vector */
-   x[0] = X;
-   y[0] = Y;
-   t[0] = T;
-   r[0] = R;
-
-   /* front wall vector */
-   x[1] = X;
-   y[1] = d[0] - Y;
-   t[1] = atan(x[1] / y[1]);
-   r[1] = y[1] / cos(t[1]);
-
-   /* right wall vector */
-   x[2] = d[1] - X;
-   y[2] = Y;
-   t[2] = PI / 2.0 - atan(y[2] / x[2]);
-   r[2] = x[2] / sin(t[2]);
-
-   /* back wall vector */
-   x[3] = X;
-   y[3] = d[2] - Y;
-   t[3] = PI + atan(x[3] / y[3]);
-   r[3] = y[3] / cos(t[3]);
-
-   /* left wall vector */
-   x[4] = d[3] - X;
-   y[4] = Y;
-   t[4] = 3. * PI / 2. - atan(y[4] / x[4]);
-   r[4] = x[4] / sin(t[4]);
-
-   /* 2nd gen. images: 4 opposing wall, 4 adjacent wall reflections */
-
-   /* front wall vector */
-   x[5] = X;
-   y[5] = d[0] - d[2] + Y;
-   t[5] = atan(x[5] / y[5]);
-   r[5] = hypot(X, y[5]);
-
-   /* right wall vector */
-   x[6] = d[1] - d[3] + X;
-   y[6] = Y;
-   t[6] = PI / 2.0 - atan(y[6] / x[6]);
-   r[6] = hypot(x[6], Y);
-
-   /* back wall vector */
-   x[7] = X;
-   y[7] = d[2] - d[0] + Y;
-   t[7] = PI + atan(x[7] / y[7]);
-   r[7] = hypot(X, y[7]);
-
-   /* left wall vector */
-   x[8] = d[3] - d[1] + X;
-   y[8] = Y;
-   t[8] = 3.0 * PI / 2.0 - atan(y[8] / x[8]);
-   r[8] = hypot(x[8], Y);
-
-   /* fr. rt. vector - double image in rectangular room, as are next 3 */
-   x[9] = x[2];
-   y[9] = y[1];
-   t[9] = atan(x[9] / y[9]);
-   r[9] = hypot(x[9], y[9]);
-
-   /* back rt. vector */
-   x[10] = x[2];
-   y[10] = y[3];
-   t[10] = PI / 2.0 - atan(y[10] / x[10]);
-   r[10] = hypot(x[10], y[10]);
-
-   /* back lft. vector */
-   x[11] = x[4];
-   y[11] = y[3];
-   t[11] = PI + atan(x[11] / y[11]);
-   r[11] = hypot(x[11], y[11]);
-
-   /* front lft. vector */
-   x[12] = x[4];
-   y[12] = y[1];
-   t[12] = 3.0 * PI / 2.0 - atan(y[12] / x[12]);
-   r[12] = hypot(x[12], y[12]);
-
-   /* calculate stereo vector pairs for each of these */
+   /* image calculations, split into stereo pairs by binaural */
+
+   double rho[2][13], theta[2][13];
+   room_images(X, Y, R, T, H, Dimensions, rho, theta);
+
    for (i = 0; i < 13; ++i) {
-	  binaural(r[i], t[i], x[i], y[i], H, Ra, Ta);
-	  register Vector *lvec = &m_vectors[0][i];
-	  register Vector *rvec = &m_vectors[1][i];
-	  lvec->Rho = Ra[0];
-	  rvec->Rho = Ra[1];
-	  lvec->Theta = Ta[0];
-	  rvec->Theta = Ta[1];
+	  m_vectors[0][i].Rho = rho[0][i];
+	  m_vectors[1][i].Rho = rho[1][i];
+	  m_vectors[0][i].Theta = theta[0][i];
+	  m_vectors[1][i].Theta = theta[1][i];
    }
 
    /* Check to see that source distance is not "zero" */
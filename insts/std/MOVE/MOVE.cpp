@@ -145,38 +145,8 @@ void MOVE::get_tap(int currentSamp, int chan, int path, int len)
    double incr = 1.0 + delta / len;
 
    const int tap = currentSamp % m_tapsize;
-   register double otap = (double) tap - outloc;
-   if (otap < 0.0) otap += m_tapsize;
-   double otapPlusOne = otap + 1.0;
-   if (otapPlusOne >= (double) m_tapsize) otapPlusOne -= m_tapsize;
-   
-   double closestToEnd = max(otap, otapPlusOne);
-
-   // run till one of output taps wrap, or len reached
-
-   int len1 = min(len, m_tapsize - (int) closestToEnd);
-
-   register double *tapdel = m_tapDelay;
-   register double *Sig = vec->Sig;
-   int out = 0;
-   
-   while (out < len)
-   {
-       const int clen = len1;
-       for (int i = 0; i < clen; ++i) {
-	   int outtap = (int) otap;
-	   double frac = otap - (double)outtap;
-	   Sig[out++] = tapdel[outtap] + frac * (tapdel[outtap + 1] - tapdel[outtap]);
-	   otap += incr;
-       }
-
-       if (otap >= (double) m_tapsize) otap -= m_tapsize;
-       otapPlusOne = otap + 1.0;
-       if (otapPlusOne >= (double) m_tapsize) otapPlusOne -= m_tapsize;
-       closestToEnd = max(otap, otapPlusOne);
-
-       len1 = min(len - out, m_tapsize - (int) closestToEnd);
-   }
+   get_moving_tap(m_tapDelay, m_tapsize, (double) tap - outloc, incr,
+                  vec->Sig, len);
 }
 
 // This gets called every internal buffer's worth of samples.  The actual
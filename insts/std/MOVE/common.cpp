@@ -3,6 +3,7 @@
 #include "common.h"
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 /* ----------------------------------------------------------------- wrap --- */
 /* Converts negative or large polar angles (in rads) into positive */
@@ -102,6 +103,138 @@ wall(double *Sig, int len, double Walldata[3])
 	}
 }
 
+/* -------------------------------------------------------- air_wall_pair --- */
+/* air_wall_pair runs the air and wall absorption filters of the left and
+   right vectors of one path over their signals together, giving the same
+   results as calling air and wall for each in turn.  The four recursions
+   are independent, so interleaving them keeps the FPU busy instead of
+   waiting on each filter's previous output.  <lwall> and <rwall> are NULL
+   for the direct signal, which has no wall filtering.
+*/
+void
+air_wall_pair(double *lsig, double *rsig, int len, double lair[3],
+              double rair[3], double lwall[3], double rwall[3])
+{
+#if defined(i386)
+	air(lsig, len, lair);
+	air(rsig, len, rair);
+	if (lwall) {
+		wall(lsig, len, lwall);
+		wall(rsig, len, rwall);
+	}
+#else
+	const double la0 = lair[0], la1 = lair[1];
+	const double ra0 = rair[0], ra1 = rair[1];
+	double lapast = lair[2], rapast = rair[2];
+	if (lwall) {
+		const double lw0 = lwall[0], lw1 = lwall[1];
+		const double rw0 = rwall[0], rw1 = rwall[1];
+		double lwpast = lwall[2], rwpast = rwall[2];
+		for (int i = 0; i < len; ++i) {
+			lapast = la0 * lsig[i] + la1 * lapast;
+			rapast = ra0 * rsig[i] + ra1 * rapast;
+			lwpast = lw0 * lapast + lw1 * lwpast;
+			rwpast = rw0 * rapast + rw1 * rwpast;
+			lsig[i] = lwpast;
+			rsig[i] = rwpast;
+		}
+		lwall[2] = lwpast;
+		rwall[2] = rwpast;
+	}
+	else {
+		for (int i = 0; i < len; ++i) {
+			lapast = la0 * lsig[i] + la1 * lapast;
+			rapast = ra0 * rsig[i] + ra1 * rapast;
+			lsig[i] = lapast;
+			rsig[i] = rapast;
+		}
+	}
+	lair[2] = lapast;
+	rair[2] = rapast;
+#endif
+}
+
+/* -------------------------------------------------------- get_fixed_tap --- */
+/* get_fixed_tap copies <len> samples from the tap delay <tapdel>, of
+   length <tapsize>, starting at <outtap>, into <sig>.
+*/
+void
+get_fixed_tap(const double *tapdel, int tapsize, int outtap, double *sig,
+              int len)
+{
+	while (outtap >= tapsize)
+		outtap -= tapsize;
+	while (outtap < 0)
+		outtap += tapsize;
+	const int len1 = (len < tapsize - outtap) ? len : tapsize - outtap;
+	memcpy(sig, &tapdel[outtap], len1 * sizeof(double));
+	if (len1 < len)
+		memcpy(&sig[len1], tapdel, (len - len1) * sizeof(double));
+}
+
+/* ------------------------------------------------------- get_moving_tap --- */
+/* get_moving_tap reads <len> interpolated samples from the tap delay
+   <tapdel>, of length <tapsize>, into <sig>, starting at <outtap> and
+   advancing by <incr> per sample, so that a tap whose delay changes
+   glides to its new length.  Between the points where the tap wraps, each
+   sample's position is figured from the start of the run, so the loop has
+   no wraparound tests or dependencies from one sample to the next.  When
+   the delay is not changing (<incr> 1.0), the interpolation fraction is
+   the same for every sample, and the run is a straight walk down the line.
+*/
+void
+get_moving_tap(const double *tapdel, int tapsize, double outtap, double incr,
+               double *sig, int len)
+{
+	while (outtap >= tapsize)
+		outtap -= tapsize;
+	while (outtap < 0.0)
+		outtap += tapsize;
+	int n = 0;
+	while (n < len) {
+		// number of samples for which both points of the interpolation
+		// lie below the end of the delay line
+		int count = 0;
+		if (incr > 0.0 && outtap < tapsize - 1)
+			count = (int) ((tapsize - 1 - outtap) / incr);
+		if (count > len - n)
+			count = len - n;
+		if (count > 0) {
+			double *out = &sig[n];
+			if (incr == 1.0) {
+				const int itap = (int) outtap;
+				const double frac = outtap - (double) itap;
+				const double *in = &tapdel[itap];
+				for (int i = 0; i < count; ++i)
+					out[i] = in[i] + frac * (in[i + 1] - in[i]);
+			}
+			else {
+				for (int i = 0; i < count; ++i) {
+					const double pos = outtap + i * incr;
+					const int itap = (int) pos;
+					const double frac = pos - (double) itap;
+					out[i] = tapdel[itap] + frac * (tapdel[itap + 1] - tapdel[itap]);
+				}
+			}
+			outtap += count * incr;
+			n += count;
+		}
+		else {
+			const int itap = (int) outtap;
+			const double frac = outtap - (double) itap;
+			int next = itap + 1;
+			if (next >= tapsize)
+				next -= tapsize;
+			sig[n++] = tapdel[itap] + frac * (tapdel[next] - tapdel[itap]);
+			outtap += incr;
+		}
+		while (outtap >= tapsize)
+			outtap -= tapsize;
+		while (outtap < 0.0)
+			outtap += tapsize;
+	}
+}
+
 // other buffer routines
 
 template <typename T>
@@ -355,6 +488,118 @@ binaural(double R,
 }
 
 
+/* ---------------------------------------------------------- room_images --- */
+/* room_images calculates the distance/angle vectors for a source at <X>, <Y>
+   (<R>, <T> in polar form) and its images up through the 2nd generation
+   reflections off the walls of the room <dim>.  13 vectors total:  1 source,
+   4 1st gen., 8 2nd gen.  These are split by binaural into stereo pairs for
+   an ear or mike spacing <H>, as rho[chan][path] and theta[chan][path].
+*/
+void
+room_images(double X, double Y, double R, double T, double H,
+            const double dim[4], double rho[2][13], double theta[2][13])
+{
+   double x[13], y[13], r[13], t[13], d[4], Ra[2], Ta[2];
+   int i;
+
+   /* multiply global dimension array by 2 to save calc. time */
+
+   for (i = 0; i < 4; ++i)
+      d[i] = dim[i] * 2.0;
+
+   /* image calculations */
+
+   /* source vector */
+   x[0] = X;
+   y[0] = Y;
+   t[0] = T;
+   r[0] = R;
+
+   /* front wall vector */
+   x[1] = X;
+   y[1] = d[0] - Y;
+   t[1] = atan(x[1] / y[1]);
+   r[1] = y[1] / cos(t[1]);
+
+   /* right wall vector */
+   x[2] = d[1] - X;
+   y[2] = Y;
+   t[2] = PI / 2.0 - atan(y[2] / x[2]);
+   r[2] = x[2] / sin(t[2]);
+
+   /* back wall vector */
+   x[3] = X;
+   y[3] = d[2] - Y;
+   t[3] = PI + atan(x[3] / y[3]);
+   r[3] = y[3] / cos(t[3]);
+
+   /* left wall vector */
+   x[4] = d[3] - X;
+   y[4] = Y;
+   t[4] = 3. * PI / 2. - atan(y[4] / x[4]);
+   r[4] = x[4] / sin(t[4]);
+
+   /* 2nd gen. images: 4 opposing wall, 4 adjacent wall reflections */
+
+   /* front wall vector */
+   x[5] = X;
+   y[5] = d[0] - d[2] + Y;
+   t[5] = atan(x[5] / y[5]);
+   r[5] = hypot(X, y[5]);
+
+   /* right wall vector */
+   x[6] = d[1] - d[3] + X;
+   y[6] = Y;
+   t[6] = PI / 2.0 - atan(y[6] / x[6]);
+   r[6] = hypot(x[6], Y);
+
+   /* back wall vector */
+   x[7] = X;
+   y[7] = d[2] - d[0] + Y;
+   t[7] = PI + atan(x[7] / y[7]);
+   r[7] = hypot(X, y[7]);
+
+   /* left wall vector */
+   x[8] = d[3] - d[1] + X;
+   y[8] = Y;
+   t[8] = 3.0 * PI / 2.0 - atan(y[8] / x[8]);
+   r[8] = hypot(x[8], Y);
+
+   /* fr. rt. vector - double image in rectangular room, as are next 3 */
+   x[9] = x[2];
+   y[9] = y[1];
+   t[9] = atan(x[9] / y[9]);
+   r[9] = hypot(x[9], y[9]);
+
+   /* back rt. vector */
+   x[10] = x[2];
+   y[10] = y[3];
+   t[10] = PI / 2.0 - atan(y[10] / x[10]);
+   r[10] = hypot(x[10], y[10]);
+
+   /* back lft. vector */
+   x[11] = x[4];
+   y[11] = y[3];
+   t[11] = PI + atan(x[11] / y[11]);
+   r[11] = hypot(x[11], y[11]);
+
+   /* front lft. vector */
+   x[12] = x[4];
+   y[12] = y[1];
+   t[12] = 3.0 * PI / 2.0 - atan(y[12] / x[12]);
+   r[12] = hypot(x[12], y[12]);
+
+   /* calculate stereo vector pairs for each of these */
+   for (i = 0; i < 13; ++i) {
+      binaural(r[i], t[i], x[i], y[i], H, Ra, Ta);
+      rho[0][i] = Ra[0];
+      rho[1][i] = Ra[1];
+      theta[0][i] = Ta[0];
+      theta[1][i] = Ta[1];
+   }
+}
+
+
 /* ------------------------------------------------------------------ fir --- */
 /* fir is a f.i.r. filter, set up by setfir, which filters each image
    sample pair to simulate binaural spectral cues according to angle
@@ -45,6 +45,12 @@ extern void btone(double *, int, double data[3]);
 extern void air(double *, int, double[3]);
 extern void wall(double *, int, double[3]);
 extern void check_denormals(double *, int);
+extern void air_wall_pair(double *, double *, int, double[3], double[3],
+                                                    double[3], double[3]);
+extern void room_images(double, double, double, double, double,
+                        const double[4], double[2][13], double[2][13]);
+extern void get_fixed_tap(const double *, int, int, double *, int);
+extern void get_moving_tap(const double *, int, double, double, double *, int);
 extern void copyBuf(double *to, double *from, int len);
 extern void addBuf(double *to, double *from, int len);
 extern void copyScaleBuf(double *to, double *from, int len, double gain);
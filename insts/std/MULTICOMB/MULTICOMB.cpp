@@ -71,6 +71,7 @@ int MULTICOMB::init(double p[], int n_args)
 	if (rtsetoutput(start, dur + ringdur, this) == -1)
 		return DONT_SCHEDULE;
 	insamps = (int) (dur * SR + 0.5);
+	setTailFrames(nSamps() - insamps);	// the ring-down
 
 	if (outputChannels() != 2)
 		return die("MULTICOMB", "Output must be stereo.");
@@ -92,24 +93,38 @@ int MULTICOMB::init(double p[], int n_args)
 		spread[j] = (float) j / (float) (NCOMBS - 1);
 	}
 
+	setPlanarOutput();		// we write a channel at a time
+
 	return nSamps();
 }
 
 int MULTICOMB::configure()
 {
+	if (readsInputInPlace())
+		return 0;
 	in = new float [RTBUFSAMPS * inputChannels()];
 	return in ? 0 : -1;
 }
 
+#define MULTICOMB_CHUNK 256
+
+// The combs run one after another over a block, each through a straight
+// run of its delay line.
+
 int MULTICOMB::run()
 {
-	int samps = framesToRun() * inputChannels();
+	const int nframes = framesToRun();
 
+	InputChannel chans[MAXBUS];
 	if (currentFrame() < insamps)
-		rtgetin(in, this, samps);
-
-	for (int i = 0; i < samps; i += inputChannels())  {
-		if (--branch <= 0) {
+		rtgetinchans(chans, in, nframes * inputChannels());
+	const InputChannel &inp = chans[inchan];
+
+	float insig[MULTICOMB_CHUNK], sig[MULTICOMB_CHUNK];
+	float outl[MULTICOMB_CHUNK], outr[MULTICOMB_CHUNK];
+	int i = 0;
+	while (i < nframes) {
+		if (branch <= 0) {
 			double p[7];
 			update(p, 7, kAmp | kRvbTime);
 			amp = p[3];
@@ -127,26 +142,41 @@ int MULTICOMB::run()
 			}
 			branch = getSkip();
 		}
+		int count = nframes - i;
+		if (count > branch)
+			count = branch > 0 ? branch : 1;
+		if (count > MULTICOMB_CHUNK)
+			count = MULTICOMB_CHUNK;
+
+		for (int k = 0; k < count; k++) {
+			if (currentFrame() + k < insamps)
+				insig[k] = inp.samps[(i + k) * inp.stride];
+			else
+				insig[k] = 0.0;
+			outl[k] = outr[k] = 0.0;
+		}
 
-		float insig, out[2];
-
-		if (currentFrame() < insamps)
-			insig = in[i + inchan];
-		else
-			insig = 0.0;
-
-		out[0] = out[1] = 0.0;
 		for (int j = 0; j < NCOMBS; j++) {
-			float sig = comb[j]->next(insig, delsamps[j]);
-			out[0] += sig * spread[j]; 
-			out[1] += sig * (1.0 - spread[j]);
+			comb[j]->next(insig, sig, count, delsamps[j]);
+			const float lamp = spread[j];
+			const float ramp = 1.0 - spread[j];
+			for (int k = 0; k < count; k++) {
+				outl[k] += sig[k] * lamp;
+				outr[k] += sig[k] * ramp;
+			}
 		}
 
-		out[0] *= amp;
-		out[1] *= amp;
-
-		rtaddout(out);
-		increment();
+		int stride;
+		BUFTYPE *left = outputChannel(0, &stride);
+		BUFTYPE *right = outputChannel(1, &stride);
+		for (int k = 0; k < count; k++) {
+			left[k * stride] = outl[k] * amp;
+			right[k * stride] = outr[k] * amp;
+		}
+		advanceOutput(count);
+		increment(count);
+		branch -= count;
+		i += count;
 	}
 
 	return framesToRun();
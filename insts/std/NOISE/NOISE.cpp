@@ -13,7 +13,8 @@
 
    The series of random numbers that makes the noise is affected by any
    calls to srand given in the script.  If there are no such calls, the
-   random seed is 1.
+   random seed is 1.  With the block_noise option set, the noise comes
+   from an Orandblock seeded from that series instead.
 
    JGG <johgibso at indiana dot edu>, 24 Dec 2002, rev. 7/9/04
 */
@@ -22,6 +23,8 @@
 #include <ugens.h>
 #include <math.h>
 #include <Instrument.h>
+#include <Ougens.h>
+#include <RTOption.h>	// blockNoise
 #include "NOISE.h"
 #include <rt.h>
 #include <rtdefs.h>
@@ -30,11 +33,13 @@
 NOISE :: NOISE() : Instrument()
 {
    branch = 0;
+   noisebuf = NULL;
 }
 
 
 NOISE :: ~NOISE()
 {
+   delete [] noisebuf;
 }
 
 
@@ -56,12 +61,26 @@ int NOISE :: init(double p[], int n_args)
 
    skip = (int) (SR / (float) resetval);
 
+   if (RTOption::blockNoise())
+      noise.scoreseed();
+
    return nSamps();
 }
 
 
+int NOISE :: configure()
+{
+   if (RTOption::blockNoise())
+      noisebuf = new float [RTBUFSAMPS];
+   return 0;
+}
+
+
 int NOISE :: run()
 {
+   if (noisebuf)
+      noise.fillBlock(noisebuf, framesToRun());
+
    for (int i = 0; i < framesToRun(); i++) {
       if (--branch <= 0) {
          double p[nargs];
@@ -74,7 +93,7 @@ int NOISE :: run()
       }
 
       float out[2];
-      out[0] = rrand() * amp;
+      out[0] = (noisebuf ? noisebuf[i] : rrand()) * amp;
 
       if (outputChannels() == 2) {
          out[1] = out[0] * (1.0 - pctleft);
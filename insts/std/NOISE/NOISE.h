@@ -2,11 +2,14 @@ class NOISE : public Instrument {
    int     inchan, skip, branch, nargs;
    float   amp, pctleft, amptabs[2];
    double  *amparray;
+   float   *noisebuf;
+   Orandblock noise;
 
 public:
    NOISE();
    virtual ~NOISE();
    virtual int init(double *, int);
+   virtual int configure();
    virtual int run();
 };
 
@@ -6,6 +6,7 @@
 #include <rtdefs.h>
 #include <string.h>
 #include <assert.h>
+#include <Ougens.h>
 
 #include "pv.h"
 #include "PVOC.h"
@@ -37,6 +38,12 @@ of D and I) <= 128.
 
 #undef debug
 
+// oscbank() runs four oscillators at once where we have SSE2.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define OSCBANK_SIMD 1
+#include <emmintrin.h>
+#endif
+
 #ifdef MACOSX
 	#define cosf(x) (float) cos((double)(x))
 	#define sinf(x) (float) sin((double)(x))
@@ -134,9 +141,8 @@ PVOC::PVOC() : _first(1), _valid(-1)
 	_pvInput= NULL;
 	Hwin= NULL;
 	winput= NULL;
-	lpcoef= NULL;
-	_fftBuf= NULL;
-	channel= NULL;
+	_frames = NULL;
+	_maxFrames = 0;
 	_pvOutput= NULL;
 	_convertPhase = NULL;
 	_unconvertPhase = NULL;
@@ -144,6 +150,9 @@ PVOC::PVOC() : _first(1), _valid(-1)
 	_lastFreq = NULL;
 	_index = NULL;
 	_table = NULL;
+	_bankChan = NULL;
+	_bankAmp = _bankAmpInc = _bankFreq = _bankFreqInc = _bankPhase = NULL;
+	_bankSums = NULL;
 }
 
 PVOC::~PVOC()
@@ -156,9 +165,12 @@ PVOC::~PVOC()
 	delete [] Hwin;
 	delete [] winput;
 	RefCounted::unref(_pvFilter);
-	delete [] lpcoef;
-	delete [] _fftBuf;
-	delete [] channel;
+	for (int n = 0; n < _maxFrames; ++n) {
+		delete _frames[n].fft;
+		delete [] _frames[n].channel;
+		delete [] _frames[n].lpcoef;
+	}
+	delete [] _frames;
 	delete [] _pvOutput;
 	delete [] _inbuf;
 	delete [] _outbuf;
@@ -166,6 +178,13 @@ PVOC::~PVOC()
 	delete [] _lastFreq;
 	delete [] _index;
 	delete [] _table;
+	delete [] _bankChan;
+	delete [] _bankAmp;
+	delete [] _bankAmpInc;
+	delete [] _bankFreq;
+	delete [] _bankFreqInc;
+	delete [] _bankPhase;
+	delete [] _bankSums;
 }
 
 inline float *
@@ -237,6 +256,10 @@ int PVOC::init(double *p, int n_args)
 	printf("Np = %d\n", Np );
 	printf("thresh = %g\n", _oscThreshold );
 #endif
+	if (_fftLen < 4 || (_fftLen & (_fftLen - 1)) != 0) {
+		die("PVOC", "FFT length must be a power of 2");
+		return(DONT_SCHEDULE);
+	}
 	if (_decimation <= 0) {
 		die("PVOC", "decimation must be >= 1");
 		return(DONT_SCHEDULE);
@@ -300,9 +323,18 @@ int PVOC::configure()
 	_pvInput = ::NewArray(_windowLen);	/* input buffer */
 	Hwin = ::NewArray(_windowLen);		/* plain Hamming window */
 	winput = ::NewArray(_windowLen);		/* windowed input buffer */
-	lpcoef = ::NewArray(Np+1);	/* lp coefficients */
-	_fftBuf = ::NewArray(_fftLen);		/* FFT buffer */
-	channel = ::NewArray(_fftLen+2);	/* analysis channels */
+	/*
+	 * buffers for as many frames as one run() usually needs
+	 */
+	_maxFrames = RTBUFSAMPS / _interpolation + 1;
+	_frames = new Frame[_maxFrames];
+	for (int n = 0; n < _maxFrames; ++n) {
+		_frames[n].fft = new Offt(_fftLen);
+		_frames[n].fftBuf = _frames[n].fft->getbuf();	/* FFT buffer */
+		_frames[n].channel = ::NewArray(_fftLen+2);	/* analysis channels */
+		_frames[n].lpcoef = ::NewArray(Np+1);	/* lp coefficients */
+		_frames[n].on = 0;
+	}
 	_pvOutput = ::NewArray(_windowLen);	/* output buffer */
 	/*
 	 * create windows
@@ -408,39 +440,53 @@ int PVOC::run()
 
 	while (outFramesNeeded > 0)
 	{
+		/*
+		 * Work on as many frames as it takes to make the output needed,
+		 * up to _maxFrames at a time.  Each stage below is done for all
+		 * of them before the next, so that the FFTs and the conversions
+		 * between complex and polar form, which depend only on their own
+		 * frame, can be shared with helper threads (see the frame_threads
+		 * option).
+		 */
+		int frames = 0;
+		for (int on = _on, produced = 0;
+			 produced < outFramesNeeded && frames < _maxFrames; ++frames) {
+			on += _interpolation;
+			if ((obank ? on + _windowLen - _interpolation : on) >= 0)
+				produced += _interpolation;
+		}
 #ifdef debug
-		printf("\ttop of loop: needed=%d _in=%d _on=%d _windowLen=%d\n",
-			   outFramesNeeded, _in, _on, _windowLen);
+		printf("\ttop of loop: needed=%d frames=%d _in=%d _on=%d _windowLen=%d\n",
+			   outFramesNeeded, frames, _in, _on, _windowLen);
 #endif	
 		/*
 		* analysis: input _decimation samples; window, fold and rotate input
 		* samples into FFT buffer; take FFT; and convert to
 		* amplitude-frequency (phase vocoder) form
 		*/
-		shiftin( _pvInput, _windowLen, _decimation);
-		/*
-		 * increment times
-		 */
-		_in += _decimation;
-		_on += _interpolation;
-
-		if ( Np ) {
-			::vvmult( winput, Hwin, _pvInput, _windowLen );
-			lpcoef[0] = ::lpa( winput, _windowLen, lpcoef, Np );
-		/*			printf("%.3g/", lpcoef[0] ); */
+		for (int n = 0; n < frames; ++n) {
+			Frame *frame = &_frames[n];
+			shiftin( _pvInput, _windowLen, _decimation);
+			/*
+			 * increment times
+			 */
+			_in += _decimation;
+			_on += _interpolation;
+			frame->on = _on;
+
+			if ( Np ) {
+				::vvmult( winput, Hwin, _pvInput, _windowLen );
+				frame->lpcoef[0] = ::lpa( winput, _windowLen, frame->lpcoef, Np );
+			/*			printf("%.3g/", frame->lpcoef[0] ); */
+			}
+			::fold( _pvInput, Wanal, _windowLen, frame->fftBuf, _fftLen, _in );
 		}
-		::fold( _pvInput, Wanal, _windowLen, _fftBuf, _fftLen, _in );
-		::rfft( _fftBuf, N2, FORWARD );
-		convert( _fftBuf, channel, N2, _decimation, R );
-
-	// 	if ( _interpolation == 0 ) {
-	// 		if ( Np )
-	// 			fwrite( lpcoef, sizeof(float), Np+1, stdout );
-	// 		fwrite( channel, sizeof(float), N+2, stdout );
-	// 		fflush( stdout );
-	// /*		printf("\n" );
-	// 		continue;
-	// 	}
+		runInParallel(analyzeFrame, this, frames);
+
+		for (int n = 0; n < frames; ++n) {
+			Frame *frame = &_frames[n];
+			convert( frame->channel, N2 );
+
 	/*
 	 * at this point channel[2*i] contains amplitude data and
 	 * channel[2*i+1] contains frequency data (in Hz) for phase
@@ -453,64 +499,95 @@ int PVOC::run()
 	 * efficiently) suited to overlap-add resynthesis
 	 */
 
-		if (_pvFilter) {
-			_pvFilter->run(channel, N2);
-		}
+			if (_pvFilter) {
+				_pvFilter->run(frame->channel, N2);
+			}
 
-		if ( obank ) {
-			/*
-			 * oscillator bank resynthesis
-			 */
-			oscbank( channel, N2, lpcoef, Np, R, _windowLen, _interpolation, P, _pvOutput );
+			if ( obank ) {
+				/*
+				 * oscillator bank resynthesis
+				 */
+				oscbank( frame->channel, N2, frame->lpcoef, Np, R, _windowLen, _interpolation, P, _pvOutput );
 #if defined(debug) && 0
-			printf("osc output (first 16):\n");
-			for (int x=0;x<16;++x) printf("%g ",_pvOutput[x]);
-			printf("\n");
+				printf("osc output (first 16):\n");
+				for (int x=0;x<16;++x) printf("%g ",_pvOutput[x]);
+				printf("\n");
 #endif
-			shiftout( _pvOutput, _windowLen, _interpolation, _on+_windowLen-_interpolation);
+				shiftout( _pvOutput, _windowLen, _interpolation, frame->on+_windowLen-_interpolation);
+				outFramesNeeded -= writeOutput(outFramesNeeded);
+			}
+			else
+				unconvert( frame->channel, N2 );
 		}
-		else {
+
+		if ( !obank ) {
 			/*
 			 * overlap-add resynthesis
 			 */
-			unconvert( channel, _fftBuf, N2, _interpolation, R );
-			::rfft( _fftBuf, N2, INVERSE );
-			::overlapadd( _fftBuf, _fftLen, Wsyn, _pvOutput, _windowLen, _on );
-			// _interpolation samples written into _outbuf
-			shiftout( _pvOutput, _windowLen, _interpolation, _on);
+			runInParallel(synthesizeFrame, this, frames);
+			for (int n = 0; n < frames; ++n) {
+				Frame *frame = &_frames[n];
+				::overlapadd( frame->fftBuf, _fftLen, Wsyn, _pvOutput, _windowLen, frame->on );
+				// _interpolation samples written into _outbuf
+				shiftout( _pvOutput, _windowLen, _interpolation, frame->on);
+				outFramesNeeded -= writeOutput(outFramesNeeded);
+			}
 		}
-	   // Handle case where last synthesized block extended beyond outFramesNeeded
+	}	/* while (outFramesNeeded > 0) */
+
+	return framesToRun();
+}
 
-		int framesToOutput = ::min(outFramesNeeded, _interpolation);
+// Write what shiftout() just put in _outbuf, up to <framesNeeded> frames,
+// keeping any left over for next time.  Returns the frames written.
+// This handles the case where the last synthesized block extended beyond
+// the output needed.
+
+int PVOC::writeOutput(int framesNeeded)
+{
+	int framesToOutput = ::min(framesNeeded, _interpolation);
 #ifdef debug
-		printf("\tbottom of loop. framesToOutput: %d\n", framesToOutput);
+	printf("\tbottom of loop. framesToOutput: %d\n", framesToOutput);
 #endif
-		int framesAvailable = _outWriteOffset - _outReadOffset;
-		framesToOutput = ::min(framesToOutput, framesAvailable);
-		if (framesToOutput > 0) {
+	int framesAvailable = _outWriteOffset - _outReadOffset;
+	framesToOutput = ::min(framesToOutput, framesAvailable);
+	if (framesToOutput > 0) {
 #ifdef debug
-			printf("\twriting %d frames from offset %d to rtbaddout\n", 
-				   framesToOutput, _outReadOffset);
+		printf("\twriting %d frames from offset %d to rtbaddout\n", 
+			   framesToOutput, _outReadOffset);
 #endif
-			rtbaddout(&_outbuf[_outReadOffset], framesToOutput);
-			increment(framesToOutput);
-			_outReadOffset += framesToOutput;
-			if (_outReadOffset == _outWriteOffset)
-				_outReadOffset = _outWriteOffset = 0;
-		}
+		rtbaddout(&_outbuf[_outReadOffset], framesToOutput);
+		increment(framesToOutput);
+		_outReadOffset += framesToOutput;
+		if (_outReadOffset == _outWriteOffset)
+			_outReadOffset = _outWriteOffset = 0;
+	}
 
-		_cachedOutFrames = _outWriteOffset - _outReadOffset;
+	_cachedOutFrames = _outWriteOffset - _outReadOffset;
 #ifdef debug
-		if (_cachedOutFrames > 0) {
-			printf("\tsaving %d samples left over\n", _cachedOutFrames);
-		}
-		printf("\toutbuf read offset %d, write offset %d\n\n",
-			   _outReadOffset, _outWriteOffset);
+	if (_cachedOutFrames > 0) {
+		printf("\tsaving %d samples left over\n", _cachedOutFrames);
+	}
+	printf("\toutbuf read offset %d, write offset %d\n\n",
+		   _outReadOffset, _outWriteOffset);
 #endif
-		outFramesNeeded -= framesToOutput;
-	}	/* while (outFramesNeeded > 0) */
+	return framesToOutput;
+}
 
-	return framesToRun();
+void PVOC::analyzeFrame(void *context, int n)
+{
+	PVOC *inst = (PVOC *) context;
+	Frame *frame = &inst->_frames[n];
+	frame->fft->r2c();
+	inst->polar( frame->fftBuf, frame->channel, inst->N2 );
+}
+
+void PVOC::synthesizeFrame(void *context, int n)
+{
+	PVOC *inst = (PVOC *) context;
+	Frame *frame = &inst->_frames[n];
+	inst->rectangular( frame->channel, frame->fftBuf, inst->N2 );
+	frame->fft->c2r();
 }
 
 /*
@@ -632,45 +709,67 @@ void PVOC::shiftout( float A[], int winLen, int I, int n)
 }
 
 /*
- * S is a spectrum in rfft format, i.e., it contains N real values
+ * S is a spectrum in Offt format, i.e., it contains N real values
  * arranged as real followed by imaginary values, except for first
  * two values, which are real parts of 0 and Nyquist frequencies;
- * convert first changes these into N/2+1 PAIRS of magnitude and
- * phase values to be stored in output array C; the phases are then
- * unwrapped and successive phase differences are used to compute
- * estimates of the instantaneous frequencies for each phase vocoder
- * analysis channel; decimation rate D and sampling rate R are used
- * to render these frequency values directly in Hz.
+ * polar changes these into N/2+1 PAIRS of magnitude and phase values
+ * to be stored in output array C.  It uses nothing but its arguments,
+ * so frames can be done on any thread.
  */
 void 
-PVOC::convert(float S[], float C[], int N2, int D, int R)
+PVOC::polar(const float S[], float C[], int N2)
 {
-	// Local copies
-	register float *lastphase = _convertPhase;
-	const float fundamental = _fundamental;
-	const float factor = _convertFactor;
-	
 	/*
-	 * unravel rfft-format spectrum: note that N2+1 pairs of
+	 * unravel Offt-format spectrum: note that N2+1 pairs of
 	 * values are produced
 	 */
 	for (int i = 0 ; i < N2 ; ++i ) {
-		int real, imag, amp, freq;
-		imag = freq = ( real = amp = i<<1 ) + 1;
+		int real, imag, amp, phase;
+		imag = phase = ( real = amp = i<<1 ) + 1;
 		float a = S[real];
 		float b = (i == 0) ? 0. : S[imag];
 		/*
-		 * compute magnitude value from real and imaginary parts
+		 * compute magnitude and phase values from real and imaginary parts
 		 */
 		C[amp] = hypotf( a, b );
+		C[phase] = ( C[amp] != 0. ) ? -atan2f( b, a ) : 0.0f;
+	}
+	// i == N2 case
+	{
+		int amp, phase;
+		phase = ( amp = N2<<1 ) + 1;
+		float a = S[1];
+		float b = 0.;
+		C[amp] = hypotf( a, b );
+		C[phase] = ( C[amp] != 0. ) ? -atan2f( b, a ) : 0.0f;
+	}
+}
+
+/*
+ * convert takes the phases that polar left in C, unwraps them, and uses
+ * successive phase differences to compute estimates of the instantaneous
+ * frequencies for each phase vocoder analysis channel; decimation rate D
+ * and sampling rate R (in _convertFactor) are used to render these
+ * frequency values directly in Hz.  Frames must be converted in order.
+ */
+void 
+PVOC::convert(float C[], int N2)
+{
+	// Local copies
+	register float *lastphase = _convertPhase;
+	const float fundamental = _fundamental;
+	const float factor = _convertFactor;
+
+	for (int i = 0 ; i <= N2 ; ++i ) {
+		int amp, freq;
+		freq = ( amp = i<<1 ) + 1;
 		/*
-		 * compute phase value from real and imaginary parts and take
-		 * difference between this and previous value for each channel
+		 * take difference between this and previous phase for each channel
 		 */
 		float phase, phasediff = 0.0f;
 
 		if ( C[amp] != 0. ) {
-			phasediff = ( phase = -atan2f( b, a ) ) - lastphase[i];
+			phasediff = ( phase = C[freq] ) - lastphase[i];
 			lastphase[i] = phase;
 			/*
 			 * unwrap phase differences
@@ -685,36 +784,17 @@ PVOC::convert(float S[], float C[], int N2, int D, int R)
 		 */
 		C[freq] = (phasediff * factor) + (i * fundamental);
 	}
-	// i == N2 case
-	{
-		int real, imag, amp, freq;
-		imag = freq = ( real = amp = N2<<1 ) + 1;
-		float a = S[1];
-		float b = 0.;
-		C[amp] = hypotf( a, b );
-		float phase, phasediff = 0.0f;
-
-		if ( C[amp] != 0. ) {
-			phasediff = ( phase = -atan2f( b, a ) ) - lastphase[N2];
-			lastphase[N2] = phase;
-			while ( phasediff > PI )
-				phasediff -= TWOPI;
-			while ( phasediff < -PI )
-				phasediff += TWOPI;
-		}
-		C[freq] = (phasediff * factor) + (N2 * fundamental);
-	}
 }
 
 /*
- * unconvert essentially undoes what convert does, i.e., it
- * turns N2+1 PAIRS of amplitude and frequency values in
- * C into N2 PAIR of complex spectrum data (in rfft format)
- * in output array S; sampling rate R and interpolation factor
- * I are used to recompute phase values from frequencies
+ * unconvert essentially undoes what convert does, i.e., it turns N2+1
+ * PAIRS of amplitude and frequency values in C back into amplitude and
+ * phase; sampling rate R and interpolation factor I (in _unconvertFactor)
+ * are used to recompute phase values from frequencies.  Frames must be
+ * unconverted in order.
  */
 void 
-PVOC::unconvert( float C[], float S[], int N2, int I, int R )
+PVOC::unconvert(float C[], int N2)
 {
 	// Local copies
 	register float *lastphase = _unconvertPhase;
@@ -722,27 +802,39 @@ PVOC::unconvert( float C[], float S[], int N2, int I, int R )
 	const float factor = _unconvertFactor;
 
 	/*
-	 * subtract out frequencies associated with each channel,
-	 * compute phases in terms of radians per I samples, and
-	 * convert to complex form
+	 * subtract out frequencies associated with each channel and
+	 * compute phases in terms of radians per I samples
 	 */
+	for (int i = 0 ; i <= N2 ; ++i) {
+		int amp, freq;
+		freq = ( amp = i<<1 ) + 1;
+		lastphase[i] += C[freq] - i*fundamental;
+		C[freq] = lastphase[i]*factor;
+	}
+}
+
+/*
+ * rectangular undoes what polar does, i.e., it turns N2+1 PAIRS of
+ * amplitude and phase values in C into N2 PAIR of complex spectrum data
+ * (in Offt format) in output array S.  Like polar, it can be done on
+ * any thread.
+ */
+void 
+PVOC::rectangular(const float C[], float S[], int N2)
+{
 	for (int i = 0 ; i < N2 ; ++i) {
-		int real, imag, amp, freq;
-		imag = freq = ( real = amp = i<<1 ) + 1;
+		int real, imag, amp, phase;
+		imag = phase = ( real = amp = i<<1 ) + 1;
 		float mag = C[amp];
-		lastphase[i] += C[freq] - i*fundamental;
-		float phase = lastphase[i]*factor;
-		S[real] = mag*cosf( phase );
-		S[imag] = -mag*sinf( phase );
+		S[real] = mag*cosf( C[phase] );
+		S[imag] = -mag*sinf( C[phase] );
 	}
 	// i == N2 case
 	{
-		int real = 1, imag, amp, freq;
-		imag = freq = ( amp = N2<<1 ) + 1;
+		int amp, phase;
+		phase = ( amp = N2<<1 ) + 1;
 		float mag = C[amp];
-		lastphase[N2] += C[freq] - N2 * fundamental;
-		float phase = lastphase[N2]*factor;
-		S[real] = mag * cosf( phase );
+		S[1] = mag * cosf( C[phase] );
 	}
 }
 
@@ -753,6 +845,14 @@ PVOC::initOscbank(int N, int npoles, int R, int Nw, int I, float P)
 	_lastFreq = ::NewArray(N+1);
 	_index = ::NewArray(N+1);
 	_table = ::NewArray(L);
+	// Room for every bin, plus silent ones to fill out the last group of 4
+	_bankChan = new int[N+4];
+	_bankAmp = ::NewArray(N+4);
+	_bankAmpInc = ::NewArray(N+4);
+	_bankFreq = ::NewArray(N+4);
+	_bankFreqInc = ::NewArray(N+4);
+	_bankPhase = ::NewArray(N+4);
+	_bankSums = ::NewArray(4*I);
 
 	const float tabscale = npoles ? 2./Nw : ( Nw >= N ? N : 8*N );
 	const float TWOPIoL = TWOPI/L;
@@ -773,6 +873,9 @@ PVOC::initOscbank(int N, int npoles, int R, int Nw, int I, float P)
  * compute I (interpolation factor) samples of output O
  * from N+1 amplitude and frequency value-pairs in C;
  * frequencies are scaled by P
+ *
+ * The bins above threshold (or fading out) are first packed into
+ * the _bank arrays, and only those are run, four at a time with SSE2.
  */
 void
 PVOC::oscbank(float C[], int N, float lpcoef[], int npoles,
@@ -785,16 +888,21 @@ PVOC::oscbank(float C[], int N, float lpcoef[], int npoles,
 	float *lastfreq = _lastFreq;
 	float *lastamp = _lastAmp;
 	float *index = _index;
-	float *table = _table;
+	const float *table = _table;
+	int *bankChan = _bankChan;
+	float *bankAmp = _bankAmp, *bankAmpInc = _bankAmpInc;
+	float *bankFreq = _bankFreq, *bankFreqInc = _bankFreqInc;
+	float *bankPhase = _bankPhase;
 	
 #ifdef debug
 	printf("\toscbank: N=%d Nw=%d I=%d P=%g\n", N, Nw, I, P);
 #endif
 	/*
-	 * for each channel, compute I samples using linear
-	 * interpolation on the amplitude and frequency
-	 * control values
+	 * for each channel, find the amplitude and frequency
+	 * at the start of the frame, and their increments for
+	 * linear interpolation across it
 	 */
+	int count = 0;
 	for (int chan = npoles ? (int)P : 0; chan < NP; ++chan) {
 		const int amp = ( chan << 1 );
 		const int freq = amp + 1;
@@ -811,8 +919,7 @@ PVOC::oscbank(float C[], int N, float lpcoef[], int npoles,
 		}
 		C[freq] *= Pinc;
 
-		register float a, f;
-		register const float finc = ( C[freq] - ( f = lastfreq[chan] ) ) * Iinv;
+		const float f = lastfreq[chan];
 	/*
 	 * if linear prediction specified, REPLACE phase vocoder amplitude
 	 * measurements with linear prediction estimates
@@ -823,31 +930,85 @@ PVOC::oscbank(float C[], int N, float lpcoef[], int npoles,
 			else
 				C[amp] = ::lpamp( chan*ffac, lpcoef[0], lpcoef, npoles );
 		}
-		register const float ainc = ( C[amp] - ( a = lastamp[chan] ) ) * Iinv;
-		register float address = index[chan];
+		const float a = lastamp[chan];
+		bankChan[count] = chan;
+		bankAmp[count] = a;
+		bankAmpInc[count] = ( C[amp] - a ) * Iinv;
+		bankFreq[count] = f;
+		bankFreqInc[count] = ( C[freq] - f ) * Iinv;
+		bankPhase[count] = index[chan];
+		++count;
+	/*
+	 * save current values for next iteration
+	 */
+		lastfreq[chan] = C[freq];
+		lastamp[chan] = C[amp];
+	}
+	const int active = (count + 3) & ~3;
+	for (int k = count; k < active; ++k) {
+		bankAmp[k] = bankAmpInc[k] = 0.0f;
+		bankFreq[k] = bankFreqInc[k] = 0.0f;
+		bankPhase[k] = 0.0f;
+	}
 	/*
 	 * accumulate the I samples from each oscillator into
 	 * output array O (initially assumed to be zero);
 	 * f is frequency in Hz scaled by oscillator increment
-	 * factor and pitch (Pinc); a is amplitude;
+	 * factor and pitch (Pinc); a is amplitude.  L is a power
+	 * of 2, so a table index is wrapped with a mask.
 	 */
+#ifdef OSCBANK_SIMD
+	float *sums = _bankSums;
+	memset(sums, 0, 4 * I * sizeof(float));
+	const __m128 length = _mm_set1_ps((float) L);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i mask = _mm_set1_epi32(L - 1);
+	for (int k = 0; k < active; k += 4) {
+		__m128 a = _mm_loadu_ps(&bankAmp[k]);
+		const __m128 ainc = _mm_loadu_ps(&bankAmpInc[k]);
+		__m128 f = _mm_loadu_ps(&bankFreq[k]);
+		const __m128 finc = _mm_loadu_ps(&bankFreqInc[k]);
+		__m128 address = _mm_loadu_ps(&bankPhase[k]);
+		for (int n = 0; n < I; ++n) {
+			int at[4];
+			_mm_storeu_si128((__m128i *) at,
+							 _mm_and_si128(_mm_cvttps_epi32(address), mask));
+			const __m128 wave = _mm_setr_ps(table[at[0]], table[at[1]],
+											table[at[2]], table[at[3]]);
+			float *sum = &sums[n << 2];
+			_mm_storeu_ps(sum, _mm_add_ps(_mm_loadu_ps(sum), _mm_mul_ps(a, wave)));
+			address = _mm_add_ps(address, f);
+			address = _mm_sub_ps(address, _mm_and_ps(_mm_cmpge_ps(address, length), length));
+			address = _mm_add_ps(address, _mm_and_ps(_mm_cmplt_ps(address, zero), length));
+			a = _mm_add_ps(a, ainc);
+			f = _mm_add_ps(f, finc);
+		}
+		_mm_storeu_ps(&bankPhase[k], address);
+	}
+	for (int n = 0; n < I; ++n) {
+		const float *sum = &sums[n << 2];
+		O[n] += (sum[0] + sum[1]) + (sum[2] + sum[3]);
+	}
+#else
+	for (int k = 0; k < count; ++k) {
+		register float a = bankAmp[k], f = bankFreq[k];
+		register const float ainc = bankAmpInc[k], finc = bankFreqInc[k];
+		register float address = bankPhase[k];
 		for (int n = 0 ; n < I ; ++n) {
-			O[n] += a*table[ (int) address ] ;  
+			O[n] += a*table[ (int) address & (L - 1) ];
 			address += f;
-			while ( address >= L )
+			if ( address >= L )
 				address -= L;
-			while ( address < 0 )
+			else if ( address < 0 )
 				address += L;
 			a += ainc;
 			f += finc;
 		} 
-	/*
-	 * save current values for next iteration
-	 */
-		lastfreq[chan] = C[freq];
-		lastamp[chan] = C[amp];
-		index[chan] = address;
+		bankPhase[k] = address;
 	}
+#endif
+	for (int k = 0; k < count; ++k)
+		index[bankChan[k]] = bankPhase[k];
 }
 
 Instrument *makePVOC()
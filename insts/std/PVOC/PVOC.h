@@ -1,6 +1,7 @@
 #include <Instrument.h>      /* the base class for this instrument */
 
 class PVFilter;
+class Offt;
 
 class PVOC : public Instrument {
 public:
@@ -23,7 +24,7 @@ protected:
 	int		R, _fftLen, N2, _windowLen, Nw2, _decimation, _interpolation, i, _in, _on, obank, Np;
 	float	_amp;
 	float	P, *Hwin, *Wanal, *Wsyn, *_pvInput, *winput;
-	float 	*lpcoef, *_fftBuf, *channel, *_pvOutput;
+	float 	*_pvOutput;
 	BUFTYPE	*_outbuf;         // private interleaved buffer
 	PVFilter *_pvFilter;
 	
@@ -36,6 +37,22 @@ protected:
 	float	_oscThreshold;
 	float	_Iinv, _Pinc, _ffac;
 	int		_NP;
+	// The bins sounding in the current frame, packed together by oscbank()
+	int		*_bankChan;
+	float	*_bankAmp, *_bankAmpInc, *_bankFreq, *_bankFreqInc, *_bankPhase;
+	float	*_bankSums;		// per-sample sums, one per SIMD lane
+
+	// One analysis/synthesis frame.  Each has its own buffers, so that the
+	// FFTs of the frames in one run() can be done at the same time.
+	struct Frame {
+		Offt	*fft;
+		float	*fftBuf;	// fft->getbuf()
+		float	*channel;	// analysis channels
+		float	*lpcoef;	// lp coefficients
+		int		on;			// output time of the frame
+	};
+	Frame	*_frames;
+	int		_maxFrames;		// frames per batch
 	
 private:
 	void	initOscbank(int N, int npoles, int R, int Nw, int I, float P);
@@ -43,7 +60,12 @@ private:
 					int R, int Nw, int I, float P, float O[]);
 	int		doUpdate();
 	int		shiftin(float A[], int N, int D);
-	void	convert(float S[], float C[], int N2, int D, int R);
-	void	unconvert(float C[], float S[], int N2, int I, int R);
+	void	polar(const float S[], float C[], int N2);
+	void	convert(float C[], int N2);
+	void	unconvert(float C[], int N2);
+	void	rectangular(const float C[], float S[], int N2);
 	void	shiftout(float A[], int N, int I, int n);
+	int		writeOutput(int framesNeeded);
+	static void	analyzeFrame(void *context, int frame);
+	static void	synthesizeFrame(void *context, int frame);
 };
@@ -20,8 +20,6 @@ extern float TWOPI;
 void findroots(complex a[], complex r[], int M);
 complex scmult(float s, complex x);
 void makewindows(float H[], float A[], float S[], int Nw, int N, int I, int osc);
-void rfft(float x[], int N, int forward);
-void cfft(float x[], int NC, int forward);
 void fold(float I[], float W[], int Nw, float O[], int N, int n);
 void overlapadd(float I[], int N, float W[], float O[], int Nw, int n);
 float lpa(float x[], int N, float b[], int M);
@@ -45,7 +45,7 @@ STEREO::STEREO() : Instrument()
 
 STEREO::~STEREO()
 {
-	delete [] in;
+	freeBuffer(in);
 }
 
 
@@ -114,13 +114,18 @@ int STEREO::init(double p[], int n_args)
 	if (fastUpdate)
 		updatePans(p);
 
+	// Notes can be replayed from the note cache, unless they use a makegen,
+	// which can change between notes.
+	if (floc(1) == NULL)
+		allowNoteCache();
+
 	return nSamps();
 }
 
 
 int STEREO::configure()
 {
-	in = new float [RTBUFSAMPS * inputChannels()];
+	in = allocBuffer(RTBUFSAMPS * inputChannels());
 	return in ? 0 : -1;
 }
 
@@ -160,13 +165,22 @@ void STEREO::doupdate()
 }
 
 
-int STEREO::run()
+// Called through runForInputChannels, so that the input channel count is a
+// constant in the usual cases.  Output is always stereo.
+
+template <int IN, int OUT>
+int STEREO::runChannels()
 {
-	const int inchans = inputChannels();
-	const int samps = framesToRun() * inchans;
+	const int inchans = IN ? IN : inputChannels();
+	const int frames = framesToRun();
+	const int samps = frames * inchans;
 
 	rtgetin(in, this, samps);
 
+	int lstride = 1, rstride = 1;
+	BUFTYPE *left = outputChannel(0, &lstride);
+	BUFTYPE *right = outputChannel(1, &rstride);
+
 	for (int i = 0; i < samps; i += inchans)  {
 		if (--branch <= 0) {
 			if (fastUpdate) {
@@ -175,22 +189,34 @@ int STEREO::run()
 			}
 			else
 				doupdate();
+			ampRamp.set(amp, getSkip());
 			branch = getSkip();
 		}
 
+		const float gain = ampRamp.next();
 		float out[2];
 		out[0] = out[1] = 0.0;
 		for (int j = 0; j < inchans; j++) {
 			if (outPan[j] >= 0.0) {
-				out[0] += in[i+j] * outPan[j] * amp;
-				out[1] += in[i+j] * (1.0 - outPan[j]) * amp;
+				out[0] += in[i+j] * outPan[j] * gain;
+				out[1] += in[i+j] * (1.0 - outPan[j]) * gain;
 			}
 		}
 
-		rtaddout(out);
+		*left = out[0];
+		*right = out[1];
+		left += lstride;
+		right += rstride;
 		increment();
 	}
-	return framesToRun();
+	advanceOutput(frames);
+	return frames;
+}
+
+
+int STEREO::run()
+{
+	return runForInputChannels(this);
 }
 
 
@@ -6,6 +6,7 @@ class STEREO : public Instrument {
 	float outPan[MAXBUS];
 	float amp, ampmult, *in, amptabs[2];
 	double *amptable;
+	ControlRamp ampRamp;
 
 	void initamp(float dur, double p[], int ampindex, int ampgenslot);
 	void updatePans(double p[]);
@@ -16,4 +17,5 @@ public:
 	virtual int init(double *, int);
 	virtual int configure();
 	virtual int run();
+	template <int IN, int OUT> int runChannels();
 };
@@ -11,6 +11,10 @@
    p2 (amp), p3 (freq) and p6 (pan) can receive updates from a table or
    real-time control source.
 
+   With the block_noise option set, each string is excited by a noise
+   burst from Orandblock, which is quicker to make than the usual one but
+   sounds slightly different.
+
    John Gibson <johgibso at indiana dot edu>, 7/10/05
 */
 #include <stdio.h>
@@ -20,8 +24,11 @@
 #include "STRUM2.h"
 #include <rt.h>
 #include <rtdefs.h>
+#include <RTOption.h>	// blockNoise
+#include <new>
 
 const float kMinDecay = 0.001f;	// prevent NaNs in Ostrum
+const int kStrumChunk = 256;
 
 STRUM2::STRUM2()
 	: _branch(0), _strum(NULL)
@@ -55,7 +62,8 @@ int STRUM2::init(double p[], int n_args)
 		fundDecayTime = kMinDecay;
 	float nyquistDecayTime = fundDecayTime * 0.1;
 
-	_strum = new Ostrum(SR, freq, squish, fundDecayTime, nyquistDecayTime);
+	_strum = new Ostrum(SR, freq, squish, fundDecayTime, nyquistDecayTime,
+														RTOption::blockNoise());
 
 	return nSamps();
 }
@@ -83,26 +91,112 @@ void STRUM2::doupdate()
 
 int STRUM2::run()
 {
-	for (int i = 0; i < framesToRun(); i++) {
-		if (--_branch <= 0) {
+	const int nframes = framesToRun();
+	float wave[kStrumChunk];
+	int i = 0;
+	while (i < nframes) {
+		if (_branch <= 0) {
 			doupdate();
 			_branch = getSkip();
 		}
+		int count = nframes - i;
+		if (count > _branch)
+			count = _branch;
+		if (count > kStrumChunk)
+			count = kStrumChunk;
+		_strum->nextBlock(wave, count);
+
+		for (int j = 0; j < count; j++) {
+			float out[2];
+			out[0] = wave[j] * _amp;
+
+			if (outputChannels() == 2) {
+				out[1] = out[0] * (1.0f - _pan);
+				out[0] *= _pan;
+			}
+
+			rtaddout(out);
+			increment();
+		}
+		_branch -= count;
+		i += count;
+	}
 
-		float out[2];
+	return framesToRun();
+}
 
-		out[0] = _strum->next() * _amp;
+STRUM2Pool::STRUM2Pool()
+{
+	_voices = new Voice [kMaxNotes];
+	_strums = (Ostrum *) ::operator new(sizeof(Ostrum) * kMaxNotes);
+	_delayLength = Ostrum::delayLength(SR);
+	_delays = new float [kMaxNotes * _delayLength];
+}
 
-		if (outputChannels() == 2) {
-			out[1] = out[0] * (1.0f - _pan);
-			out[0] *= _pan;
-		}
+STRUM2Pool::~STRUM2Pool()
+{
+	delete [] _voices;
+	::operator delete(_strums);
+	delete [] _delays;
+}
+
+// As STRUM2::init().  The delay lines belong to the pool, so a voice's
+// Ostrum needs no destructor call.
+
+bool STRUM2Pool::acceptNote(int voice, const double p[],
+	PField * const fields[], int nargs)
+{
+	if (outputChannels() > 2 || nargs < 6)
+		return false;
+
+	Voice &v = _voices[voice];
+	v.rawfreq = p[3];
+	const float freq = (v.rawfreq < 15.0) ? cpspch(v.rawfreq) : v.rawfreq;
+	const int squish = int(p[4]);
+	float fundDecayTime = p[5];
+	if (fundDecayTime < kMinDecay)
+		fundDecayTime = kMinDecay;
+	const float nyquistDecayTime = fundDecayTime * 0.1;
+
+	new (&_strums[voice]) Ostrum(SR, freq, squish, fundDecayTime,
+						nyquistDecayTime, &_delays[voice * _delayLength],
+						RTOption::blockNoise());
+	return true;
+}
 
-		rtaddout(out);
-		increment();
+// As STRUM2::doupdate()
+
+void STRUM2Pool::updateVoice(int voice, const double p[], int nargs)
+{
+	Voice &v = _voices[voice];
+	v.amp = p[2];
+	if (p[3] != v.rawfreq) {
+		v.rawfreq = p[3];
+		const float freq = (v.rawfreq < 15.0) ? cpspch(v.rawfreq) : v.rawfreq;
+		_strums[voice].setfreq(freq);
 	}
+	v.pan = (nargs > 6) ? p[6] : 0.5;
+}
 
-	return framesToRun();
+void STRUM2Pool::renderVoice(int voice, float *outs[], int frames)
+{
+	Voice &v = _voices[voice];
+	float wave[kBlockFrames];
+	_strums[voice].nextBlock(wave, frames);
+
+	if (outputChannels() == 2) {
+		float *left = outs[0], *right = outs[1];
+		for (int j = 0; j < frames; j++) {
+			const float out = wave[j] * v.amp;
+			left[j] += out * v.pan;
+			right[j] += out * (1.0f - v.pan);
+		}
+	}
+	else {
+		float *mono = outs[0];
+		for (int j = 0; j < frames; j++)
+			mono[j] += wave[j] * v.amp;
+	}
 }
 
 Instrument *makeSTRUM2()
@@ -113,10 +207,17 @@ Instrument *makeSTRUM2()
 	return inst;
 }
 
+VoicePool *makeSTRUM2Pool()
+{
+	STRUM2Pool *pool = new STRUM2Pool();
+	pool->set_bus_config("STRUM2");
+	return pool;
+}
+
 #ifndef EMBEDDED
 void rtprofile()
 {
-	RT_INTRO("STRUM2", makeSTRUM2);
+	RT_INTRO_POOL("STRUM2", makeSTRUM2, makeSTRUM2Pool);
 }
 #endif
 
@@ -1,4 +1,5 @@
 #include <Instrument.h>
+#include <VoicePool.h>
 
 class Ostrum;
 
@@ -19,3 +20,26 @@ private:
 	Ostrum *_strum;
 };
 
+
+// STRUM2 notes played as the voices of one instrument, for the voice_pool
+// option (see VoicePool.h).  The strings' delay lines are carved from one
+// array made with the pool, so a pluck allocates nothing, and each string
+// is run a block at a time.
+
+class STRUM2Pool : public VoicePool {
+	struct Voice {
+		float amp, rawfreq, pan;
+	};
+	Voice *_voices;
+	Ostrum *_strums;		// one per voice, made in place
+	float *_delays;			// one delay line per voice
+	int _delayLength;
+protected:
+	virtual bool acceptNote(int voice, const double p[], PField * const fields[],
+	                        int nargs);
+	virtual void updateVoice(int voice, const double p[], int nargs);
+	virtual void renderVoice(int voice, float *outs[], int frames);
+public:
+	STRUM2Pool();
+	virtual ~STRUM2Pool();
+};
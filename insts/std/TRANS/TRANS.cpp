@@ -7,6 +7,9 @@
    p4 = interval of transposition, in octave.pc
    p5 = input channel [optional, default is 0]
    p6 = pan (in percent-to-left form: 0-1) [optional, default is .5]
+   p7 = interpolation: 0 for the 3-point spline, 1 for band-limited (sinc)
+        resampling, which costs more but keeps transpositions up from
+        aliasing [optional, default is 0]
 
    p3 (amplitude), p4 (transposition) and p6 (pan) can receive dynamic updates
    from a table or real-time control source.
@@ -41,6 +44,7 @@
 #include <PField.h>
 #include <RTOption.h>     // for fastUpdate
 #include "TRANS.h"
+#include <Ougens.h>
 #include <rt.h>
 
 //#define DEBUG
@@ -70,6 +74,7 @@ TRANS::TRANS() : Instrument()
    _increment = 0.0;
    counter = 0.0;
    getframe = true;
+   resampler = NULL;
 
    // clear sample history
    oldersig = 0.0;
@@ -81,6 +86,7 @@ TRANS::TRANS() : Instrument()
 TRANS::~TRANS()
 {
    delete [] in;
+   delete resampler;
 }
 
 
@@ -127,7 +133,7 @@ int TRANS::init(double p[], int n_args)
    nargs = n_args;
    if (nargs < 5)
       return die("TRANS",
-                 "Usage: TRANS(start, inskip, dur, amp, trans[, inchan, pan])");
+                 "Usage: TRANS(start, inskip, dur, amp, trans[, inchan, pan, interp])");
 
    const float outskip = p[0];
    const float inskip = p[1];
@@ -150,6 +156,9 @@ int TRANS::init(double p[], int n_args)
    // to trigger first read in run()
    inframe = RTBUFSAMPS;
 
+   if (nargs > 7 && p[7] != 0.0)
+      resampler = new Oresample();
+
    initamp(dur, p, 3, 1);
 
    oneover_cpsoct10 = 1.0 / cpsoct(10.0);
@@ -185,8 +194,57 @@ void TRANS::doupdate()
    }
 }
 
+// Band-limited version of run(), taking output from <resampler> a control
+// period at a time and giving it input a buffer at a time.
+
+int TRANS::runResampled()
+{
+   const int outframes = framesToRun();
+   const int inchans = inputChannels();
+   float *outp = outbuf;
+
+   int i = 0;
+   while (i < outframes) {
+      if (branch <= 0) {
+         if (fastUpdate) {
+            if (amptable)
+               amp = ampmult * tablei(currentFrame(), amptable, amptabs);
+         }
+         else
+            doupdate();
+         branch = getSkip();
+      }
+      const int count = (outframes - i < branch) ? outframes - i : branch;
+      const int made = resampler->read(outp, outputchans, count, _increment);
+      if (made < count) {
+         if (inframe >= RTBUFSAMPS) {
+            rtgetin(in, this, RTBUFSAMPS * inchans);
+            inframe = 0;
+         }
+         inframe += resampler->write(&in[(inframe * inchans) + inchan], inchans,
+                                     RTBUFSAMPS - inframe);
+      }
+
+      for (int j = 0; j < made; j++, outp += outputchans) {
+         outp[0] *= amp;
+         if (outputchans == 2) {
+            outp[1] = outp[0] * (1.0 - pctleft);
+            outp[0] *= pctleft;
+         }
+      }
+      increment(made);
+      branch -= made;
+      i += made;
+   }
+
+   return framesToRun();
+}
+
 int TRANS::run()
 {
+   if (resampler)
+      return runResampled();
+
    const int outframes = framesToRun();
    const int inchans = inputChannels();
    float *outp = outbuf;               // point to inst private out buffer
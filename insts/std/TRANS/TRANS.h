@@ -1,6 +1,8 @@
 #include <Instrument.h>
 #include <rtdefs.h>
 
+class Oresample;
+
 class TRANS : public Instrument {
    int    incount, inframe, branch, inchan, nargs;
    bool   getframe, fastUpdate;
@@ -9,9 +11,11 @@ class TRANS : public Instrument {
    float  newsig, oldsig, oldersig;
    double *amptable;
    float  *in, amptabs[2];
+   Oresample *resampler;
 
    void initamp(float dur, double p[], int ampindex, int ampgenslot);
    void doupdate();
+   int runResampled();
 public:
    TRANS();
    virtual ~TRANS();
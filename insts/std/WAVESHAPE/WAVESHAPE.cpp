@@ -13,6 +13,7 @@
         must use gen 3] ***
    p9 = index guide [optional; if missing, must use gen 4] ****
    p10 = amp normalization [optional; default is on (1)]
+   p11 = oversampling factor (1, 2, 4 or 8) [optional; default is 1]
 
    p2 (freq), p3 (min index), p4 (max index), p5 (amp), p6 (pan) and
    p9 (index) can receive dynamic updates from a table or real-time
@@ -21,6 +22,10 @@
    NOTE: The amp normalization in this instrument can cause clicks at
    the beginning and ending of notes.  Passing zero for p10 turns it off.
 
+   Oversampling runs the transfer function at 2, 4 or 8 times the sampling
+   rate, so that harmonics above the Nyquist frequency are filtered out
+   rather than folded back down.  It delays the output by 31 samples.
+
    ----
 
    Notes about backward compatibility with pre-v4 scores:
@@ -58,12 +63,14 @@
 WAVESHAPE::WAVESHAPE() : Instrument()
 {
 	osc = NULL;
+	oversamp = NULL;
 	branch = 0;
 }
 
 WAVESHAPE::~WAVESHAPE()
 {
 	delete osc;
+	delete oversamp;
 }
 
 int WAVESHAPE::init(double p[], int n_args)
@@ -130,6 +137,12 @@ int WAVESHAPE::init(double p[], int n_args)
 
 	setDCBlocker(freq, true);		// initialize dc blocking filter
 
+	int factor = n_args > 11 ? (int) p[11] : 1;
+	if (factor != 1 && factor != 2 && factor != 4 && factor != 8)
+		return die("WAVESHAPE", "Oversampling factor must be 1, 2, 4 or 8.");
+	if (factor > 1)
+		oversamp = new Ooversample(factor);
+
 	skip = (int) (SR / (float) resetval);
 
 	return nSamps();
@@ -192,7 +205,23 @@ int WAVESHAPE::run()
 		}
 
 		float sig = osc->next();
-		float wsig = wshape(sig * index, xferfunc, lenxfer);
+		float wsig;
+		if (oversamp) {
+			float buf[Ooversample::kMaxFactor];
+			oversamp->up(sig * index, buf);
+			for (int j = 0; j < oversamp->factor(); j++) {
+				// The interpolation can overshoot the table range a little.
+				float x = buf[j];
+				if (x > 1.0f)
+					x = 1.0f;
+				else if (x < -1.0f)
+					x = -1.0f;
+				buf[j] = wshape(x, xferfunc, lenxfer);
+			}
+			wsig = oversamp->down(buf);
+		}
+		else
+			wsig = wshape(sig * index, xferfunc, lenxfer);
 
 		// dc blocking filter
 		float osig = a1 * z1;
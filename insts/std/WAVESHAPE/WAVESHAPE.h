@@ -9,6 +9,7 @@ class WAVESHAPE : public Instrument {
 	float a0, a1, b1, z1;
 	double *waveform, *ampenv, *xferfunc, *indenv;
 	Ooscili *osc;
+	Ooversample *oversamp;
 
 	void setDCBlocker(float freq, bool init);
 	void doupdate();
@@ -45,6 +45,9 @@
 #include <rt.h>
 #include <rtdefs.h>
 
+// max frames handed to the stk block tick at once
+#define BLOCKSIZE 256
+
 
 
 MBANDEDWG :: MBANDEDWG()
@@ -152,24 +155,38 @@ void MBANDEDWG :: doupdate()
 
 int MBANDEDWG :: run()
 {
-	int   i;
+	const int nframes = framesToRun();
+	MY_FLOAT sig[BLOCKSIZE];
 	float out[2];
 
-	for (i = 0; i < framesToRun(); i++) {
+	int i = 0;
+	while (i < nframes) {
 		if (--branch <= 0) {
 			doupdate();
 			branch = getSkip();
 		}
 
-		out[0] = theBar->tick(velocity) * amp;
+		// Tick the model in blocks that end at the next control update.
+		int count = nframes - i;
+		if (count > branch)
+			count = branch;
+		if (count > BLOCKSIZE)
+			count = BLOCKSIZE;
+		theBar->tick(velocity, sig, count);
 
-		if (outputChannels() == 2) {
-			out[1] = out[0] * (1.0 - pctleft);
-			out[0] *= pctleft;
-		}
+		for (int j = 0; j < count; j++) {
+			out[0] = sig[j] * amp;
 
-		rtaddout(out);
-		increment();
+			if (outputChannels() == 2) {
+				out[1] = out[0] * (1.0 - pctleft);
+				out[0] *= pctleft;
+			}
+
+			rtaddout(out);
+			increment();
+		}
+		branch -= count - 1;
+		i += count;
 	}
 
 	return framesToRun();
@@ -35,6 +35,9 @@
 #include <rt.h>
 #include <rtdefs.h>
 
+// max frames handed to the stk block tick at once
+#define BLOCKSIZE 256
+
 
 
 MBLOWBOTL :: MBLOWBOTL() : Instrument()
@@ -103,24 +106,38 @@ void MBLOWBOTL :: doupdate()
 
 int MBLOWBOTL :: run()
 {
-	int   i;
+	const int nframes = framesToRun();
+	MY_FLOAT sig[BLOCKSIZE];
 	float out[2];
 
-	for (i = 0; i < framesToRun(); i++) {
+	int i = 0;
+	while (i < nframes) {
 		if (--branch <= 0) {
 			doupdate();
 			branch = getSkip();
 		}
-		
-		out[0] = theBotl->tick(breathamp) * amp;
 
-		if (outputChannels() == 2) {
-			out[1] = out[0] * (1.0 - pctleft);
-			out[0] *= pctleft;
-		}
+		// Tick the model in blocks that end at the next control update.
+		int count = nframes - i;
+		if (count > branch)
+			count = branch;
+		if (count > BLOCKSIZE)
+			count = BLOCKSIZE;
+		theBotl->tick(breathamp, sig, count);
+
+		for (int j = 0; j < count; j++) {
+			out[0] = sig[j] * amp;
 
-		rtaddout(out);
-		increment();
+			if (outputChannels() == 2) {
+				out[1] = out[0] * (1.0 - pctleft);
+				out[0] *= pctleft;
+			}
+
+			rtaddout(out);
+			increment();
+		}
+		branch -= count - 1;
+		i += count;
 	}
 
 	return framesToRun();
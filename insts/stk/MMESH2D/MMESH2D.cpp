@@ -30,6 +30,9 @@
 #include <rt.h>
 #include <rtdefs.h>
 
+// max frames handed to the stk block tick at once
+#define BLOCKSIZE 256
+
 
 MMESH2D :: MMESH2D()
 	: branch(0), theMesh(NULL), dcblocker(NULL)
@@ -69,10 +72,12 @@ int MMESH2D :: init(double p[], int n_args)
 
 int MMESH2D :: run()
 {
-	int   i;
+	const int nframes = framesToRun();
+	MY_FLOAT sig[BLOCKSIZE];
 	float out[2];
 
-	for (i = 0; i < framesToRun(); i++) {
+	int i = 0;
+	while (i < nframes) {
 		if (--branch <= 0) {
 			double p[10];
 			update (p, 10, kAmp | kPan);
@@ -84,15 +89,27 @@ int MMESH2D :: run()
 			branch = getSkip();
 		}
 
-		out[0] = dcblocker->next(theMesh->tick()) * amp;
+		// Tick the mesh in blocks that end at the next control update.
+		int count = nframes - i;
+		if (count > branch)
+			count = branch;
+		if (count > BLOCKSIZE)
+			count = BLOCKSIZE;
+		theMesh->tick(sig, count);
 
-		if (outputChannels() == 2) {
-			out[1] = out[0] * (1.0 - pctleft);
-			out[0] *= pctleft;
-		}
+		for (int j = 0; j < count; j++) {
+			out[0] = dcblocker->next(sig[j]) * amp;
 
-		rtaddout(out);
-		increment();
+			if (outputChannels() == 2) {
+				out[1] = out[0] * (1.0 - pctleft);
+				out[0] *= pctleft;
+			}
+
+			rtaddout(out);
+			increment();
+		}
+		branch -= count - 1;
+		i += count;
 	}
 
 	return framesToRun();
@@ -44,6 +44,9 @@
 #include <rt.h>
 #include <rtdefs.h>
 
+// max frames handed to the stk block tick at once
+#define BLOCKSIZE 256
+
 
 
 MMODALBAR :: MMODALBAR() : Instrument()
@@ -126,27 +129,48 @@ void MMODALBAR :: doupdate()
 
 int MMODALBAR :: run()
 {
-	int   i;
+	const int nframes = framesToRun();
+	MY_FLOAT sig[BLOCKSIZE], ex[BLOCKSIZE];
 	float out[2];
 
-	for (i = 0; i < framesToRun(); i++) {
+	int i = 0;
+	while (i < nframes) {
 		if (--branch <=0) {
 			doupdate();
 			branch = getSkip();
 		}
 
-		if (currentFrame() < 256) // feed in excitation
-			out[0] = theBar->tick(exciteamp, excite[currentFrame()]) * amp;
-		else
-			out[0] = theBar->tick(exciteamp, 0.0) * amp;
-
-		if (outputChannels() == 2) {
-			out[1] = out[0] * (1.0 - pctleft);
-			out[0] *= pctleft;
+		// Tick the bar in blocks that end at the next control update, and
+		// at the end of the excitation.
+		int count = nframes - i;
+		if (count > branch)
+			count = branch;
+		if (count > BLOCKSIZE)
+			count = BLOCKSIZE;
+		const int frame = currentFrame();
+		const MY_FLOAT *exptr = NULL;
+		if (frame < 256) { // feed in excitation
+			if (count > 256 - frame)
+				count = 256 - frame;
+			for (int j = 0; j < count; j++)
+				ex[j] = excite[frame + j];
+			exptr = ex;
 		}
+		theBar->tick(exciteamp, exptr, sig, count);
+
+		for (int j = 0; j < count; j++) {
+			out[0] = sig[j] * amp;
 
-		rtaddout(out);
-		increment();
+			if (outputChannels() == 2) {
+				out[1] = out[0] * (1.0 - pctleft);
+				out[0] *= pctleft;
+			}
+
+			rtaddout(out);
+			increment();
+		}
+		branch -= count - 1;
+		i += count;
 	}
 
 	return framesToRun();
@@ -341,6 +341,14 @@ MY_FLOAT BandedWG :: tick()
 return 0.0;
 }
 
+MY_FLOAT *BandedWG :: tick(float velocityEnvelope, MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(velocityEnvelope);
+
+  return vector;
+}
+
 void BandedWG :: controlChange(int number, MY_FLOAT value)
 {
   MY_FLOAT norm = value * ONE_OVER_128;
@@ -84,6 +84,9 @@ class BandedWG : public Instrmnt
   //! Compute one output sample.
   MY_FLOAT tick(float velocityEnvelope);
 
+  //! Compute \e vectorSize output samples with the same \e velocityEnvelope and return them in \e vector.
+  MY_FLOAT *tick(float velocityEnvelope, MY_FLOAT *vector, unsigned int vectorSize);
+
   //! Compute one output sample. (dummy -- BGG)
   MY_FLOAT tick();
 
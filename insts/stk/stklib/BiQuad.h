@@ -101,4 +101,22 @@ public:
   MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
 };
 
+inline MY_FLOAT BiQuad :: lastOut(void) const
+{
+  return Filter::lastOut();
+}
+
+inline MY_FLOAT BiQuad :: tick(MY_FLOAT sample)
+{
+  inputs[0] = gain * sample;
+  outputs[0] = b[0] * inputs[0] + b[1] * inputs[1] + b[2] * inputs[2];
+  outputs[0] -= a[2] * outputs[2] + a[1] * outputs[1];
+  inputs[2] = inputs[1];
+  inputs[1] = inputs[0];
+  outputs[2] = outputs[1];
+  outputs[1] = outputs[0];
+
+  return outputs[0];
+}
+
 #endif
@@ -149,6 +149,14 @@ MY_FLOAT BlowBotl :: tick()
 return 0.0;
 }
 
+MY_FLOAT *BlowBotl :: tick(float ampPressure, MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(ampPressure);
+
+  return vector;
+}
+
 // BGG -- RTcmix doesn't use these...
 void BlowBotl :: controlChange(int number, MY_FLOAT value)
 {
@@ -157,6 +157,14 @@ MY_FLOAT Brass :: tick()
 return 0.0;
 }
 
+MY_FLOAT *Brass :: tick(float ampPressure, MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(ampPressure);
+
+  return vector;
+}
+
 
 // BGG -- RTcmix doesn't use these...
 void Brass :: controlChange(int number, MY_FLOAT value)
@@ -69,6 +69,9 @@ class Brass: public Instrmnt
   //! Compute one output sample.
   MY_FLOAT tick(float ampPressure);
 
+  //! Compute \e vectorSize output samples with the same \e ampPressure and return them in \e vector.
+  MY_FLOAT *tick(float ampPressure, MY_FLOAT *vector, unsigned int vectorSize);
+
   //! Compute one output sample (dummy -- BGG)
   MY_FLOAT tick();
 
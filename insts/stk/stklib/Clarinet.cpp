@@ -153,6 +153,14 @@ MY_FLOAT Clarinet :: tick()
 return 0.0;
 }
 
+MY_FLOAT *Clarinet :: tick(float ampPressure, MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(ampPressure);
+
+  return vector;
+}
+
 // BGG -- kind of dumb, but I don't use this in RTcmix...  use access
 // methods below
 void Clarinet :: controlChange(int number, MY_FLOAT value)
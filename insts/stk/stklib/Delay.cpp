@@ -133,37 +133,27 @@ MY_FLOAT Delay :: contentsAt(long tapDelay) const
   return inputs[tap];
 }
 
-MY_FLOAT Delay :: lastOut(void) const
-{
-  return Filter::lastOut();
-}
-
-MY_FLOAT Delay :: nextOut(void) const
-{
-  return inputs[outPoint];
-}
-
-MY_FLOAT Delay :: tick(MY_FLOAT sample)
-{
-  inputs[inPoint++] = sample;
-
-  // Check for end condition
-  if (inPoint == length)
-    inPoint -= length;
-
-  // Read out next value
-  outputs[0] = inputs[outPoint++];
-
-  if (outPoint>=length)
-    outPoint -= length;
-
-  return outputs[0];
-}
-
+// Same as tick() for each sample, with the read and write points held in
+// locals for the whole vector.
 MY_FLOAT *Delay :: tick(MY_FLOAT *vector, unsigned int vectorSize)
 {
-  for (unsigned int i=0; i<vectorSize; i++)
-    vector[i] = tick(vector[i]);
+  MY_FLOAT *line = inputs;
+  const long len = length;
+  long in = inPoint, out = outPoint;
+  MY_FLOAT output = outputs[0];
+
+  for (unsigned int i=0; i<vectorSize; i++) {
+    line[in++] = vector[i];
+    if (in == len)
+      in -= len;
+    output = line[out++];
+    if (out >= len)
+      out -= len;
+    vector[i] = output;
+  }
+  inPoint = in;
+  outPoint = out;
+  outputs[0] = output;
 
   return vector;
 }
@@ -74,7 +74,8 @@ public:
   MY_FLOAT nextOut(void) const;
 
   //! Input one sample to the delay-line and return one output.
-  virtual MY_FLOAT tick(MY_FLOAT sample);
+  // (not virtual, so that it can be inlined; see Filter.h)
+  MY_FLOAT tick(MY_FLOAT sample);
 
   //! Input \e vectorSize samples to the delay-line and return an equal number of outputs in \e vector.
   virtual MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
@@ -86,5 +87,32 @@ protected:
   MY_FLOAT delay;
 };
 
+inline MY_FLOAT Delay :: lastOut(void) const
+{
+  return Filter::lastOut();
+}
+
+inline MY_FLOAT Delay :: nextOut(void) const
+{
+  return inputs[outPoint];
+}
+
+inline MY_FLOAT Delay :: tick(MY_FLOAT sample)
+{
+  inputs[inPoint++] = sample;
+
+  // Check for end condition
+  if (inPoint == length)
+    inPoint -= length;
+
+  // Read out next value
+  outputs[0] = inputs[outPoint++];
+
+  if (outPoint>=length)
+    outPoint -= length;
+
+  return outputs[0];
+}
+
 #endif
 
@@ -102,33 +102,11 @@ void DelayA :: setDelay(MY_FLOAT theDelay)
     ((MY_FLOAT) 1.0 + alpha);         // coefficient for all pass
 }
 
-MY_FLOAT DelayA :: nextOut(void)
+// The per-sample tick() is inline, so this loop has no calls in it.
+MY_FLOAT *DelayA :: tick(MY_FLOAT *vector, unsigned int vectorSize)
 {
-  if ( doNextOut ) {
-    // Do allpass interpolation delay.
-    nextOutput = -coeff * outputs[0];
-    nextOutput += apInput + (coeff * inputs[outPoint]);
-    doNextOut = false;
-  }
-
-  return nextOutput;
-}
-
-MY_FLOAT DelayA :: tick(MY_FLOAT sample)
-{
-  inputs[inPoint++] = sample;
-
-  // Increment input pointer modulo length.
-  if (inPoint == length)
-    inPoint -= length;
-
-  outputs[0] = nextOut();
-  doNextOut = true;
-
-  // Save the allpass input and increment modulo length.
-  apInput = inputs[outPoint++];
-  if (outPoint == length)
-    outPoint -= length;
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(vector[i]);
 
-  return outputs[0];
+  return vector;
 }
@@ -66,6 +66,9 @@ public:
   //! Input one sample to the delay-line and return one output.
   MY_FLOAT tick(MY_FLOAT sample);
 
+  //! Input \e vectorSize samples to the delay-line and return an equal number of outputs in \e vector.
+  MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
+
 protected:  
   MY_FLOAT alpha;
   MY_FLOAT coeff;
@@ -74,4 +77,35 @@ protected:
   bool doNextOut;
 };
 
+inline MY_FLOAT DelayA :: nextOut(void)
+{
+  if ( doNextOut ) {
+    // Do allpass interpolation delay.
+    nextOutput = -coeff * outputs[0];
+    nextOutput += apInput + (coeff * inputs[outPoint]);
+    doNextOut = false;
+  }
+
+  return nextOutput;
+}
+
+inline MY_FLOAT DelayA :: tick(MY_FLOAT sample)
+{
+  inputs[inPoint++] = sample;
+
+  // Increment input pointer modulo length.
+  if (inPoint == length)
+    inPoint -= length;
+
+  outputs[0] = nextOut();
+  doNextOut = true;
+
+  // Save the allpass input and increment modulo length.
+  apInput = inputs[outPoint++];
+  if (outPoint == length)
+    outPoint -= length;
+
+  return outputs[0];
+}
+
 #endif
@@ -89,36 +89,11 @@ MY_FLOAT DelayL :: getDelay(void) const
   return delay;
 }
 
-MY_FLOAT DelayL :: nextOut(void)
+// The per-sample tick() is inline, so this loop has no calls in it.
+MY_FLOAT *DelayL :: tick(MY_FLOAT *vector, unsigned int vectorSize)
 {
-  if ( doNextOut ) {
-    // First 1/2 of interpolation
-    nextOutput = inputs[outPoint] * omAlpha;
-    // Second 1/2 of interpolation
-    if (outPoint+1 < length)
-      nextOutput += inputs[outPoint+1] * alpha;
-    else
-      nextOutput += inputs[0] * alpha;
-    doNextOut = false;
-  }
-
-  return nextOutput;
-}
-
-MY_FLOAT DelayL :: tick(MY_FLOAT sample)
-{
-  inputs[inPoint++] = sample;
-
-  // Increment input pointer modulo length.
-  if (inPoint == length)
-    inPoint -= length;
-
-  outputs[0] = nextOut();
-  doNextOut = true;
-
-  // Increment output pointer modulo length.
-  if (++outPoint >= length)
-    outPoint -= length;
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(vector[i]);
 
-  return outputs[0];
+  return vector;
 }
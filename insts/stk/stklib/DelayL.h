@@ -63,6 +63,9 @@ public:
   //! Input one sample to the delay-line and return one output.
   MY_FLOAT tick(MY_FLOAT sample);
 
+  //! Input \e vectorSize samples to the delay-line and return an equal number of outputs in \e vector.
+  MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
+
  protected:  
   MY_FLOAT alpha;
   MY_FLOAT omAlpha;
@@ -70,4 +73,38 @@ public:
   bool doNextOut;
 };
 
+inline MY_FLOAT DelayL :: nextOut(void)
+{
+  if ( doNextOut ) {
+    // First 1/2 of interpolation
+    nextOutput = inputs[outPoint] * omAlpha;
+    // Second 1/2 of interpolation
+    if (outPoint+1 < length)
+      nextOutput += inputs[outPoint+1] * alpha;
+    else
+      nextOutput += inputs[0] * alpha;
+    doNextOut = false;
+  }
+
+  return nextOutput;
+}
+
+inline MY_FLOAT DelayL :: tick(MY_FLOAT sample)
+{
+  inputs[inPoint++] = sample;
+
+  // Increment input pointer modulo length.
+  if (inPoint == length)
+    inPoint -= length;
+
+  outputs[0] = nextOut();
+  doNextOut = true;
+
+  // Increment output pointer modulo length.
+  if (++outPoint >= length)
+    outPoint -= length;
+
+  return outputs[0];
+}
+
 #endif
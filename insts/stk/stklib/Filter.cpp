@@ -214,11 +214,6 @@ MY_FLOAT Filter :: getGain(void) const
   return gain;
 }
 
-MY_FLOAT Filter :: lastOut(void) const
-{
-  return outputs[0];
-}
-
 MY_FLOAT Filter :: tick(MY_FLOAT sample)
 {
   int i;
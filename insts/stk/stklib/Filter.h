@@ -93,11 +93,15 @@ public:
   //! Return the current filter gain.
   virtual MY_FLOAT getGain(void) const;
 
+// lastOut() and tick(MY_FLOAT) are not virtual, so that the subclasses'
+// versions, defined inline in their headers, are inlined into the models
+// that call them through pointers to the concrete filters, instead of being
+// dispatched once per sample.  Nothing uses these classes polymorphically.
   //! Return the last computed output value.
-  virtual MY_FLOAT lastOut(void) const;
+  MY_FLOAT lastOut(void) const;
 
   //! Input one sample to the filter and return one output.
-  virtual MY_FLOAT tick(MY_FLOAT sample);
+  MY_FLOAT tick(MY_FLOAT sample);
 
   //! Input \e vectorSize samples to the filter and return an equal number of outputs in \e vector.
   virtual MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
@@ -113,4 +117,9 @@ protected:
 
 };
 
+inline MY_FLOAT Filter :: lastOut(void) const
+{
+  return outputs[0];
+}
+
 #endif
@@ -264,6 +264,15 @@ MY_FLOAT Mesh2D :: tick()
   return lastOutput;
 }
 
+// Unlike Instrmnt's version, this calls our tick() directly.
+MY_FLOAT *Mesh2D :: tick(MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = Mesh2D::tick();
+
+  return vector;
+}
+
 #define VSCALE ((MY_FLOAT) (0.5))
 
 MY_FLOAT Mesh2D :: tick0()
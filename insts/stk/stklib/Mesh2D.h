@@ -73,6 +73,9 @@ class Mesh2D : public Instrmnt
   //! Compute one output sample, without adding energy to the mesh.
   MY_FLOAT tick();
 
+  //! Compute \e vectorSize output samples and return them in \e vector.
+  MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
+
   //! Input a sample to the mesh and compute one output sample.
   MY_FLOAT tick(MY_FLOAT input);
 
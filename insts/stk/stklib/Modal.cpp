@@ -250,3 +250,18 @@ MY_FLOAT Modal :: tick()
 {
 return 0.0;
 }
+
+MY_FLOAT *Modal :: tick(MY_FLOAT amp, const MY_FLOAT *excite, MY_FLOAT *vector,
+                        unsigned int vectorSize)
+{
+  if (excite) {
+    for (unsigned int i=0; i<vectorSize; i++)
+      vector[i] = tick(amp, excite[i]);
+  }
+  else {
+    for (unsigned int i=0; i<vectorSize; i++)
+      vector[i] = tick(amp, 0.0);
+  }
+
+  return vector;
+}
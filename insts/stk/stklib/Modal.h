@@ -68,6 +68,10 @@ public:
   //! Compute one output sample.
   virtual MY_FLOAT tick(MY_FLOAT amp, MY_FLOAT excite);
 
+  //! Compute \e vectorSize output samples with the same \e amp, and \e excite samples from \e excite (or zeros, if it's NULL); return them in \e vector.
+  MY_FLOAT *tick(MY_FLOAT amp, const MY_FLOAT *excite, MY_FLOAT *vector,
+                 unsigned int vectorSize);
+
   //! Compute one output sample.
   virtual MY_FLOAT tick(); // dummy for RTcmix
 
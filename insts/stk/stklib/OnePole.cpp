@@ -86,30 +86,29 @@ MY_FLOAT OnePole :: getGain(void) const
   return Filter::getGain();
 }
 
-MY_FLOAT OnePole :: lastOut(void) const
-{
-  return Filter::lastOut();
-}
-
-MY_FLOAT OnePole :: tick(MY_FLOAT sample)
+// Same as tick() for each sample, with the coefficients and history held in
+// locals for the whole vector.
+MY_FLOAT *OnePole :: tick(MY_FLOAT *vector, unsigned int vectorSize)
 {
-  inputs[0] = gain * sample;
-  outputs[0] = b[0] * inputs[0] - a[1] * outputs[1];
-  outputs[1] = outputs[0];
+  const MY_FLOAT g = gain;
+  const MY_FLOAT b0 = b[0], a1 = a[1];
+  MY_FLOAT in0 = inputs[0];
+  MY_FLOAT out0 = outputs[0], out1 = outputs[1];
+
+  for (unsigned int i=0; i<vectorSize; i++) {
+    in0 = g * vector[i];
+    out0 = b0 * in0 - a1 * out1;
 #if defined(i386)
-  outputs[1] = outputs[0] + antidenorm;
-  antidenorm = -antidenorm;
+    out1 = out0 + antidenorm;
+    antidenorm = -antidenorm;
 #else
-  outputs[1] = outputs[0];
+    out1 = out0;
 #endif
-
-  return outputs[0];
-}
-
-MY_FLOAT *OnePole :: tick(MY_FLOAT *vector, unsigned int vectorSize)
-{
-  for (unsigned int i=0; i<vectorSize; i++)
-    vector[i] = tick(vector[i]);
+    vector[i] = out0;
+  }
+  inputs[0] = in0;
+  outputs[0] = out0;
+  outputs[1] = out1;
 
   return vector;
 }
@@ -78,4 +78,24 @@ private:
 #endif
 };
 
+inline MY_FLOAT OnePole :: lastOut(void) const
+{
+  return Filter::lastOut();
+}
+
+inline MY_FLOAT OnePole :: tick(MY_FLOAT sample)
+{
+  inputs[0] = gain * sample;
+  outputs[0] = b[0] * inputs[0] - a[1] * outputs[1];
+  outputs[1] = outputs[0];
+#if defined(i386)
+  outputs[1] = outputs[0] + antidenorm;
+  antidenorm = -antidenorm;
+#else
+  outputs[1] = outputs[0];
+#endif
+
+  return outputs[0];
+}
+
 #endif
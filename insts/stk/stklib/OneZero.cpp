@@ -80,24 +80,23 @@ MY_FLOAT OneZero :: getGain(void) const
   return Filter::getGain();
 }
 
-MY_FLOAT OneZero :: lastOut(void) const
-{
-  return Filter::lastOut();
-}
-
-MY_FLOAT OneZero :: tick(MY_FLOAT sample)
-{
-  inputs[0] = gain * sample;
-  outputs[0] = b[1] * inputs[1] + b[0] * inputs[0];
-  inputs[1] = inputs[0];
-
-  return outputs[0];
-}
-
+// Same as tick() for each sample, with the coefficients and history held in
+// locals for the whole vector.
 MY_FLOAT *OneZero :: tick(MY_FLOAT *vector, unsigned int vectorSize)
 {
-  for (unsigned int i=0; i<vectorSize; i++)
-    vector[i] = tick(vector[i]);
+  const MY_FLOAT g = gain;
+  const MY_FLOAT b0 = b[0], b1 = b[1];
+  MY_FLOAT in1 = inputs[1];
+  MY_FLOAT out0 = outputs[0];
+
+  for (unsigned int i=0; i<vectorSize; i++) {
+    const MY_FLOAT in0 = g * vector[i];
+    out0 = b1 * in1 + b0 * in0;
+    in1 = in0;
+    vector[i] = out0;
+  }
+  inputs[0] = inputs[1] = in1;
+  outputs[0] = out0;
 
   return vector;
 }
@@ -73,4 +73,18 @@ class OneZero : protected Filter
   MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
 };
 
+inline MY_FLOAT OneZero :: lastOut(void) const
+{
+  return Filter::lastOut();
+}
+
+inline MY_FLOAT OneZero :: tick(MY_FLOAT sample)
+{
+  inputs[0] = gain * sample;
+  outputs[0] = b[1] * inputs[1] + b[0] * inputs[0];
+  inputs[1] = inputs[0];
+
+  return outputs[0];
+}
+
 #endif
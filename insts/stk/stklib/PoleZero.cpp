@@ -76,25 +76,24 @@ MY_FLOAT PoleZero :: getGain(void) const
   return Filter::getGain();
 }
 
-MY_FLOAT PoleZero :: lastOut(void) const
-{
-  return Filter::lastOut();
-}
-
-MY_FLOAT PoleZero :: tick(MY_FLOAT sample)
-{
-  inputs[0] = gain * sample;
-  outputs[0] = b[0] * inputs[0] + b[1] * inputs[1] - a[1] * outputs[1];
-  inputs[1] = inputs[0];
-  outputs[1] = outputs[0];
-
-  return outputs[0];
-}
-
+// Same as tick() for each sample, with the coefficients and history held in
+// locals for the whole vector.
 MY_FLOAT *PoleZero :: tick(MY_FLOAT *vector, unsigned int vectorSize)
 {
-  for (unsigned int i=0; i<vectorSize; i++)
-    vector[i] = tick(vector[i]);
+  const MY_FLOAT g = gain;
+  const MY_FLOAT b0 = b[0], b1 = b[1], a1 = a[1];
+  MY_FLOAT in1 = inputs[1];
+  MY_FLOAT out1 = outputs[1];
+
+  for (unsigned int i=0; i<vectorSize; i++) {
+    const MY_FLOAT in0 = g * vector[i];
+    const MY_FLOAT out0 = b0 * in0 + b1 * in1 - a1 * out1;
+    in1 = in0;
+    out1 = out0;
+    vector[i] = out0;
+  }
+  inputs[0] = inputs[1] = in1;
+  outputs[0] = outputs[1] = out1;
 
   return vector;
 }
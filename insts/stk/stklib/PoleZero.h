@@ -80,4 +80,19 @@ class PoleZero : protected Filter
   MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
 };
 
+inline MY_FLOAT PoleZero :: lastOut(void) const
+{
+  return Filter::lastOut();
+}
+
+inline MY_FLOAT PoleZero :: tick(MY_FLOAT sample)
+{
+  inputs[0] = gain * sample;
+  outputs[0] = b[0] * inputs[0] + b[1] * inputs[1] - a[1] * outputs[1];
+  inputs[1] = inputs[0];
+  outputs[1] = outputs[0];
+
+  return outputs[0];
+}
+
 #endif
@@ -185,6 +185,14 @@ MY_FLOAT Saxofony :: tick()
 return(0.0);
 }
 
+MY_FLOAT *Saxofony :: tick(float ampPressure, MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(ampPressure);
+
+  return vector;
+}
+
 // BGG -- kind of dumb, but I don't use this in RTcmix...  use access
 // methods below
 void Saxofony :: controlChange(int number, MY_FLOAT value)
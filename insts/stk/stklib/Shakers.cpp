@@ -892,6 +892,15 @@ MY_FLOAT Shakers :: tick()
   return lastOutput;
 }
 
+// Unlike Instrmnt's version, this calls our tick() directly.
+MY_FLOAT *Shakers :: tick(MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = Shakers::tick();
+
+  return vector;
+}
+
 // BGG -- kind of dumb, but I don't use this in RTcmix...  use access
 // methods below (at end of this file)
 void Shakers :: controlChange(int number, MY_FLOAT value)
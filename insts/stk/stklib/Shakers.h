@@ -86,6 +86,9 @@ class Shakers : public Instrmnt
   //! Compute one output sample.
   MY_FLOAT tick();
 
+  //! Compute \e vectorSize output samples and return them in \e vector.
+  MY_FLOAT *tick(MY_FLOAT *vector, unsigned int vectorSize);
+
   //! Perform the control change specified by \e number and \e value (0.0 - 128.0).
   virtual void controlChange(int number, MY_FLOAT value);
 
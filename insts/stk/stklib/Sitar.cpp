@@ -129,3 +129,11 @@ MY_FLOAT Sitar :: tick()
 {
 return 0.0;
 }
+
+MY_FLOAT *Sitar :: tick(float amp, MY_FLOAT *vector, unsigned int vectorSize)
+{
+  for (unsigned int i=0; i<vectorSize; i++)
+    vector[i] = tick(amp);
+
+  return vector;
+}
@@ -58,6 +58,9 @@ class Sitar : public Instrmnt
   //! Compute one output sample.
   MY_FLOAT tick(float amp);
 
+  //! Compute \e vectorSize output samples with the same \e amp and return them in \e vector.
+  MY_FLOAT *tick(float amp, MY_FLOAT *vector, unsigned int vectorSize);
+
   //! Compute one output sample.
   MY_FLOAT tick(); // dummy for RTcmix
 
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <mixerr.h>
 #include <Instrument.h>
+#include <Ougens.h>
 #include <rt.h>
 #include <rtdefs.h>
 #include "MIXN.h"
@@ -10,6 +11,8 @@
 
 #include "funcs.h"
 
+#define MIXN_CHUNK 256
+
 extern int resetval;
 
 MIXN::MIXN() : Instrument()
@@ -28,11 +31,13 @@ MIXN::MIXN() : Instrument()
   my_use_path = use_path;
   my_use_rates = use_rates;
   my_cycle = cycle;
+  matrix = NULL;
 }
 
 MIXN::~MIXN()
 {
   delete [] in;
+  delete matrix;
 }
 
 int MIXN::init(double p[], int n_args)
@@ -89,6 +94,9 @@ int MIXN::init(double p[], int n_args)
 
   skip = (int)(SR/(float)resetval); // how often to update amp curve, default 200/sec.
 
+  matrix = new Ogainmatrix(1, outputchans);
+  setPlanarOutput();  // we write a channel at a time
+
   //  if (inchan >= inputChannels())
   //  warn("MIXN","You are requesting channel %2.f of a %d channel file.\n",inchan+1,inputChannels());
 
@@ -103,14 +111,14 @@ int MIXN::configure()
 
 int MIXN::run()
 {
-  int i,j,k,outframes;
+  int i,j,nframes,count;
   float aamp;
   int branch;
-  float *outp;
   float t_out_amp[8];  /* FIXME make this more flexible later */
-  float t_dur;
-  float sig;
-  int finalsamp;
+  float insig[MIXN_CHUNK], gains[MAXBUS];
+  const float *ins[1];
+  BUFTYPE *outs[MAXBUS];
+  int stride = 1;
 
   aamp = 0;
 
@@ -128,14 +136,13 @@ int MIXN::run()
   use_rates = my_use_rates;
   cycle = my_cycle;
 
-  outframes = framesToRun()*inputChannels();
+  nframes = framesToRun();
 
-  rtgetin(in, this, outframes);
-
-  outp = outbuf;  // Use private pointer to Inst::outbuf
+  rtgetin(in, this, nframes*inputChannels());
 
+  ins[0] = insig;
   branch = 0;
-  for (i = 0; i < outframes; i += inputChannels())  {
+  for (i = 0; i < nframes; i += count)  {
 	if (--branch < 0) {
 #ifdef RTUPDATE
 	  if (tags_on) {
@@ -154,20 +161,35 @@ int MIXN::run()
 	  if (use_path) {
 		update_amps(cursamp);
 	  }
+	  // The matrix glides to these over the next block, except at the start.
+	  for (j = 0; j < outputchans; j++)
+		gains[j] = out_chan_amp[j] * aamp;
+	  matrix->setgains(0, gains);
+	  if (cursamp == 0)
+		matrix->jump();
 	  branch = skip;
 	}
 
-	if (inchan < inputChannels())
-	  sig = in[i + (int)inchan] * aamp;
-	else
-	  sig = 0;
-
-
-	for (j = 0; j < outputchans; j++) {
-	  outp[j] = sig * out_chan_amp[j];
+	// One frame, then up to the next update
+	count = nframes - i;
+	if (count > branch + 1)
+	  count = branch + 1;
+	if (count > MIXN_CHUNK)
+	  count = MIXN_CHUNK;
+	branch -= count - 1;
+
+	for (j = 0; j < count; j++) {
+	  if (inchan < inputChannels())
+		insig[j] = in[(i + j) * inputChannels() + (int)inchan];
+	  else
+		insig[j] = 0;
 	}
-	outp += outputchans;
-	cursamp++;
+
+	for (j = 0; j < outputchans; j++)
+	  outs[j] = outputChannel(j, &stride);
+	matrix->process(ins, outs, stride, count);
+	advanceOutput(count);
+	cursamp += count;
   }
 
   my_cur_rate = cur_rate;
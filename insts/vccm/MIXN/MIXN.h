@@ -1,5 +1,7 @@
 #include "mixn_structs.h"
 
+class Ogainmatrix;
+
 class MIXN : public Instrument {
 	float amp, tabs[2],*in;
 	double *amptable;
@@ -20,6 +22,7 @@ class MIXN : public Instrument {
 	Bool my_use_path;
 	Bool my_use_rates;
 	double my_cycle;  /* Length of 1 iteration ... last path time */
+	Ogainmatrix *matrix;
 
 public:
 	MIXN();
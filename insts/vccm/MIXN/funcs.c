@@ -69,6 +69,11 @@ double speakerloc(double p[], int n_args) {
   i=j=0;
   n_spk=0;
 
+  if (n_args / 2 > MAXSPEAKS) {
+	fprintf(stderr,"WARNING:  set_spk_locs too many speaker locations\n");
+	fprintf(stderr,"%d attempted, %d allocated\n",n_args / 2, MAXSPEAKS);
+	exit(1);
+  }
   spk_locs = (pt *)malloc(MAXSPEAKS * sizeof(pt));
   
   while(j<n_args) {
@@ -81,11 +86,6 @@ double speakerloc(double p[], int n_args) {
      i++;
   }
   n_spk = i;
-  if (i > MAXBUS) {
-	fprintf(stderr,"WARNING:  set_spk_locs too many speaker locations\n");
-	fprintf(stderr,"%d attempted, %d allocated\n",i, MAXBUS);
-	exit(1);
-  }
   tot_dist = calc_tot_dist();
   return 0;
 }
@@ -99,6 +99,11 @@ double speakerloc_p(double p[], int n_args) {
   n_spk=0;
   i=j=0;
   
+  if (n_args / 2 > MAXSPEAKS) {
+	fprintf(stderr,"WARNING:  set_spk_locs too many speaker locations\n");
+	fprintf(stderr,"%d attempted, %d allocated\n",n_args / 2, MAXSPEAKS);
+	exit(1);
+  }
   spk_locs = (pt *)malloc(MAXSPEAKS * sizeof(pt));
 
   while(j<n_args) {
@@ -115,11 +120,6 @@ double speakerloc_p(double p[], int n_args) {
 	i++;
   }
   n_spk = i;
-  if (i > MAXBUS) {
-	fprintf(stderr,"WARNING:  set_spk_locs too many speaker locations\n");
-	fprintf(stderr,"%d attempted, %d allocated\n",i, MAXBUS);
-	exit(1);
-  }
   tot_dist = calc_tot_dist();
   return 0;
 }
@@ -1,6 +1,6 @@
 #define MAXRATES 32
 #define MAXLOCS 32
-#define MAXSPEAKS 16
+#define MAXSPEAKS 64
 
 typedef struct pt {
   double x;
@@ -5,8 +5,31 @@
 #include "ugens.h"
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 #include <assert.h>
 
+// Four-lane float vectors for limitChannel(), where SSE2 is available.
+
+#if defined(__SSE2__)
+#define LIMIT_SIMD 1
+#include <emmintrin.h>
+
+typedef __m128 vec4;
+
+static inline vec4 vload(const float *p) { return _mm_loadu_ps(p); }
+static inline void vstore(float *p, vec4 v) { _mm_storeu_ps(p, v); }
+static inline vec4 vsplat(float x) { return _mm_set1_ps(x); }
+static inline vec4 vabs(vec4 v) { return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+static inline vec4 vmin(vec4 a, vec4 b) { return _mm_min_ps(a, b); }
+static inline vec4 vmax(vec4 a, vec4 b) { return _mm_max_ps(a, b); }
+static inline vec4 vand(vec4 a, vec4 b) { return _mm_and_ps(a, b); }
+static inline vec4 vor(vec4 a, vec4 b) { return _mm_or_ps(a, b); }
+static inline vec4 vlt(vec4 a, vec4 b) { return _mm_cmplt_ps(a, b); }
+static inline vec4 vgt(vec4 a, vec4 b) { return _mm_cmpgt_ps(a, b); }
+static inline int vmask(vec4 v) { return _mm_movemask_ps(v); }	// a bit per lane
+
+#endif
+
 #define DEBUG 0
 
 #if DEBUG > 1
@@ -36,7 +59,8 @@ AudioDeviceImpl::AudioDeviceImpl()
 	  _frameChannels(0), _deviceChannels(0), _samplingRate(0.0), _maxFrames(0),
 	  _runCallback(NULL), _stopCallback(NULL),
 	  _convertBuffer(NULL), 
-	  _recConvertFunction(NULL), _playConvertFunction(NULL), _muteThreshold(0.0)
+	  _recConvertFunction(NULL), _playConvertFunction(NULL),
+	  _playLimitFunction(NULL), _muteThreshold(0.0)
 {
 	_lastErr[0] = '\0';
 	for (int n = 0; n < 32; ++n) {
@@ -179,6 +203,10 @@ int AudioDeviceImpl::getFrames(void *frameBuffer, int frameCount)
 			PRINT1("getFrames: skipping conversion after doGetFrames (formats identical)\n");
 			doGetFrames(frameBuffer, frameCount);
 		}
+		else if (void *deviceBuffer = doBeginGetFrames(frameCount)) {
+			PRINT1("getFrames: running conversion from device memory\n");
+			convertFrame(deviceBuffer, frameBuffer, frameCount, true);
+		}
 		else {
 			PRINT1("getFrames: running conversion after doGetFrames\n");
 			doGetFrames(_convertBuffer, frameCount);
@@ -196,13 +224,29 @@ int AudioDeviceImpl::sendFrames(void *frameBuffer, int frameCount)
 	if (isPlaying()) {
 		// Clip if converting from non-clipped to clipped.
 		bool doClipping = !isFrameFmtClipped() && isPlaybackDeviceFmtClipped();
-		limitFrame(frameBuffer, frameCount,
-				   doClipping, checkPeaks(), reportClipping());
-		void *sendBuffer = convertFrame(frameBuffer,
-										_convertBuffer, 
-										frameCount, 
-										false);
-		status = doSendFrames(sendBuffer, frameCount);
+		// If there is a conversion to do anyway, try to do it right into
+		// the device's memory.  Without one, doSendFrames() makes the only copy.
+		const bool converting = (_playLimitFunction != NULL || _playConvertFunction != NULL);
+		void *deviceBuffer = converting ? doBeginSendFrames(frameCount) : NULL;
+		void *convertBuffer = (deviceBuffer != NULL) ? deviceBuffer : _convertBuffer;
+		void *sendBuffer;
+		if (_playLimitFunction != NULL) {
+			limitFrame(frameBuffer, frameCount,
+					   doClipping, checkPeaks(), reportClipping(), convertBuffer);
+			sendBuffer = convertBuffer;
+		}
+		else {
+			limitFrame(frameBuffer, frameCount,
+					   doClipping, checkPeaks(), reportClipping());
+			sendBuffer = convertFrame(frameBuffer,
+									  convertBuffer, 
+									  frameCount, 
+									  false);
+		}
+		if (deviceBuffer != NULL)
+			status = doCommitSendFrames(frameCount);
+		else
+			status = doSendFrames(sendBuffer, frameCount);
 	}
 	else
 		status = error("Not in playback mode");
@@ -519,52 +563,223 @@ AudioDeviceImpl::convertFrame(void *inbuffer, void *outbuffer,
 	return outbuffer;
 }
 
-void
-AudioDeviceImpl::limitFrame(void *frameBuffer, int frames, bool doClip, bool checkPeaks, bool reportClipping)
+// Fused limiting and conversion for playback.  limitFrame() used to make one
+// pass over the frame buffer to clip and track peaks, and convertFrame() a
+// second one to convert it to the device format.  These kernels do all of
+// it in one sweep per channel, four samples at a time where SSE2 is available.
+// Results are identical to the scalar code:  clipping is to the 16-bit range,
+// a channel's peak location is the first frame with its largest magnitude, and
+// float-to-integer conversion truncates.
+
+struct LimitState {
+	bool	clip;
+	bool	checkPeaks;
+	long	startFrame;
+	float	*peaks;
+	long	*peakLocs;
+	int		clipped;
+	float	clipMax;
+};
+
+struct Int24 { unsigned char bytes[3]; };
+
+// Each Store writes one (already clipped) sample in a device format.
+
+struct StoreNothing {
+	typedef char SampleType;
+	static inline void store(SampleType *, float) {}
+};
+
+template <Endian theEndian>
+struct StoreShort {
+	typedef short SampleType;
+	static inline void store(SampleType *out, float samp) {
+		*out = ::swap(theEndian != kMachineEndian, (short) (int) samp);
+	}
+};
+
+template <Endian theEndian>
+struct StoreInt24 {
+	typedef Int24 SampleType;
+	static inline void store(SampleType *out, float samp) {
+		const int value = (int) (samp * (1 << 8));
+		const int hi = (theEndian == Big) ? 0 : 2;
+		out->bytes[hi] = (value >> 16);
+		out->bytes[1] = (value >> 8);
+		out->bytes[2 - hi] = (value & 0xFF);
+	}
+};
+
+template <Endian theEndian>
+struct StoreInt32 {
+	typedef int32_t SampleType;
+	static inline void store(SampleType *out, float samp) {
+		*out = ::swap(theEndian != kMachineEndian, int32_t(samp * 65536.0f));
+	}
+};
+
+template <Endian theEndian, bool isNormalized>
+struct StoreFloat {
+	typedef float SampleType;
+	static inline void store(SampleType *out, float samp) {
+		*out = ::swap(theEndian != kMachineEndian, ::normalize(isNormalized, samp));
+	}
+};
+
+static inline float limitSample(float *in, long frame, LimitState *state,
+								float &peak, long &peakLoc)
 {
-	const int chans = getFrameChannels();	// since frameBuffer is from user
-	const long bufStartSamp = getFrameCount();
-	int numclipped = 0;
-	float clipmax = 0.0f;
-	bool frameMuting = (_muteThreshold > 0.0);
-	
-	PRINT1("AudioDeviceImpl::limitFrame: clip = %d check = %d\n", doClip, checkPeaks);
-	for (int c = 0; c < chans; ++c) {
-		float *fp;
-		int incr;
-		if (isFrameInterleaved()) {
-			fp = &((float *) frameBuffer)[c];
-			incr = chans;
+	float samp = *in;
+	if (state->clip) {
+		if (samp < -32768.0f) {
+			if (-samp > state->clipMax)
+				state->clipMax = -samp;
+			*in = samp = -32768.0f;
+			++state->clipped;
 		}
-		else {
-			fp = ((float **) frameBuffer)[c];
-			incr = 1;
+		else if (samp > 32767.0f) {
+			if (samp > state->clipMax)
+				state->clipMax = samp;
+			*in = samp = 32767.0f;
+			++state->clipped;
 		}
-		for (int n = 0; n < frames; ++n, fp += incr) {
-			if (doClip || frameMuting) {
-				const float samp = *fp;
-				if (samp < -32768.0f) {
-					if (samp < -clipmax)
-						clipmax = -samp;
-					*fp = -32768.0f;
-					++numclipped;
-				}
-				else if (samp > 32767.0f) {
-					if (samp > clipmax)
-						clipmax = samp;
-					*fp = 32767.0f;
-					++numclipped;
+	}
+	if (state->checkPeaks) {
+		const float fabsamp = fabsf(samp);
+		if (fabsamp > peak) {
+			peak = fabsamp;
+			peakLoc = state->startFrame + frame;	// frame count
+		}
+	}
+	return samp;
+}
+
+// Clip one channel in place, track its peak, and store it via <Store>.
+
+template <class Store>
+static void limitChannel(int ch, float *in, int inIncr,
+						 typename Store::SampleType *out, int outIncr,
+						 int frames, LimitState *state)
+{
+	float peak = state->peaks[ch];
+	long peakLoc = state->peakLocs[ch];
+	int n = 0;
+#ifdef LIMIT_SIMD
+	if (inIncr == 1) {
+		const vec4 lo = vsplat(-32768.0f);
+		const vec4 hi = vsplat(32767.0f);
+		vec4 clipMax = vsplat(0.0f);
+		for (; n + 4 <= frames; n += 4, in += 4, out += 4 * outIncr) {
+			vec4 samps = vload(in);
+			if (state->clip) {
+				const vec4 over = vor(vlt(samps, lo), vgt(samps, hi));
+				const int overMask = vmask(over);
+				if (overMask != 0) {
+					state->clipped += __builtin_popcount(overMask);
+					clipMax = vmax(clipMax, vand(over, vabs(samps)));
+					samps = vmin(hi, vmax(lo, samps));
+					vstore(in, samps);
 				}
 			}
-			if (checkPeaks) {
-				const double fabsamp = fabs((double) *fp);
-				if (fabsamp > (double) _peaks[c]) {
-					_peaks[c] = (float) fabsamp;
-					_peakLocs[c] = bufStartSamp + n;	// frame count
+			float lanes[4];
+			vstore(lanes, samps);
+			if (state->checkPeaks) {
+				const vec4 mags = vabs(samps);
+				if (vmask(vgt(mags, vsplat(peak))) != 0) {
+					for (int k = 0; k < 4; ++k) {
+						const float fabsamp = fabsf(lanes[k]);
+						if (fabsamp > peak) {
+							peak = fabsamp;
+							peakLoc = state->startFrame + n + k;
+						}
+					}
 				}
 			}
+			Store::store(out, lanes[0]);
+			Store::store(out + outIncr, lanes[1]);
+			Store::store(out + outIncr * 2, lanes[2]);
+			Store::store(out + outIncr * 3, lanes[3]);
 		}
+		float maxes[4];
+		vstore(maxes, clipMax);
+		for (int k = 0; k < 4; ++k)
+			if (maxes[k] > state->clipMax)
+				state->clipMax = maxes[k];
 	}
+#endif
+	for (; n < frames; ++n, in += inIncr, out += outIncr)
+		Store::store(out, limitSample(in, n, state, peak, peakLoc));
+	state->peaks[ch] = peak;
+	state->peakLocs[ch] = peakLoc;
+}
+
+// Non-interleaved float frames to any <OutStream>.  Frame channels beyond
+// the device's are limited but not stored; device channels beyond the
+// frame's are zeroed.
+
+template <class Store, class OutStream>
+static void limitAndConvert(void *in, void *out, int inchans, int outchans,
+							int frames, LimitState *state)
+{
+	typedef typename OutStream::StreamType OutType;
+	typedef typename OutStream::ChannelType OutChanType;
+	float **fin = (float **) in;
+	OutType *tout = (OutType *) out;
+	const int outIncr = OutStream::channelIncrement(outchans);
+	int ch;
+	for (ch = 0; ch < inchans; ++ch) {
+		if (ch < outchans)
+			limitChannel<Store>(ch, fin[ch], 1,
+								OutStream::innerFromOuter(tout, ch), outIncr,
+								frames, state);
+		else {
+			char dummy;
+			limitChannel<StoreNothing>(ch, fin[ch], 1, &dummy, 0, frames, state);
+		}
+	}
+	for (; ch < outchans; ++ch) {
+		OutChanType *outbuffer = OutStream::innerFromOuter(tout, ch);
+		for (int fr = 0; fr < frames; ++fr, outbuffer += outIncr)
+			Store::store(outbuffer, 0.0f);
+	}
+}
+
+// Clip and peak-check the frame buffer in place.  If <convertedFrame> is
+// non-NULL, also convert it into that buffer with _playLimitFunction.
+
+void
+AudioDeviceImpl::limitFrame(void *frameBuffer, int frames, bool doClip, bool checkPeaks, bool reportClipping, void *convertedFrame)
+{
+	const int chans = getFrameChannels();	// since frameBuffer is from user
+	const long bufStartSamp = getFrameCount();
+	bool frameMuting = (_muteThreshold > 0.0);
+	
+	PRINT1("AudioDeviceImpl::limitFrame: clip = %d check = %d\n", doClip, checkPeaks);
+	LimitState state;
+	state.clip = doClip || frameMuting;
+	state.checkPeaks = checkPeaks;
+	state.startFrame = bufStartSamp;
+	state.peaks = _peaks;
+	state.peakLocs = _peakLocs;
+	state.clipped = 0;
+	state.clipMax = 0.0f;
+	if (convertedFrame != NULL) {
+		(*_playLimitFunction)(frameBuffer, convertedFrame,
+							  chans, getPlaybackDeviceChannels(), frames, &state);
+	}
+	else if (state.clip || state.checkPeaks) {
+		for (int c = 0; c < chans; ++c) {
+			char dummy;
+			if (isFrameInterleaved())
+				limitChannel<StoreNothing>(c, &((float *) frameBuffer)[c], chans,
+										   &dummy, 0, frames, &state);
+			else
+				limitChannel<StoreNothing>(c, ((float **) frameBuffer)[c], 1,
+										   &dummy, 0, frames, &state);
+		}
+	}
+	const int numclipped = state.clipped;
+	const float clipmax = state.clipMax;
 	if (frameMuting && clipmax >= _muteThreshold) {
 		if (reportClipping) {
 			float loc1 = bufStartSamp / getSamplingRate();
@@ -581,6 +796,9 @@ AudioDeviceImpl::limitFrame(void *frameBuffer, int frames, bool doClip, bool che
 				memset(fp, 0, frames * sizeof(float));
 			}
 		}
+		// Rare enough that we just convert the silence over again.
+		if (convertedFrame != NULL)
+			convertFrame(frameBuffer, convertedFrame, frames, false);
 	}
 	else if (numclipped && reportClipping) {
 		float loc1 = bufStartSamp / getSamplingRate();
@@ -720,6 +938,59 @@ static void convert(void *_in, void *_out, int inchans, int outchans, int frames
 	}
 }
 
+// Returns the fused playback kernel matching one of the conversions set up
+// below for non-interleaved float frames, or NULL.
+
+static LimitFunction limitFunctionFor(int rawDeviceFormat)
+{
+	const bool normalized = IS_NORMALIZED_FORMAT(rawDeviceFormat);
+	if (IS_INTERLEAVED_FORMAT(rawDeviceFormat)) {
+		switch (MUS_GET_FORMAT(rawDeviceFormat)) {
+		case MUS_LFLOAT:
+			return normalized
+				? ::limitAndConvert< StoreFloat<Little, true>, InterleavedStream<float, Little, true> >
+				: ::limitAndConvert< StoreFloat<Little, false>, InterleavedStream<float, Little> >;
+		case MUS_BFLOAT:
+			return normalized
+				? ::limitAndConvert< StoreFloat<Big, true>, InterleavedStream<float, Big, true> >
+				: ::limitAndConvert< StoreFloat<Big, false>, InterleavedStream<float, Big> >;
+		case MUS_B24INT:
+			return ::limitAndConvert< StoreInt24<Big>, InterleavedStream<Int24, Big> >;
+		case MUS_L24INT:
+			return ::limitAndConvert< StoreInt24<Little>, InterleavedStream<Int24, Little> >;
+		case MUS_LSHORT:
+			return ::limitAndConvert< StoreShort<Little>, InterleavedStream<short, Little> >;
+		case MUS_BSHORT:
+			return ::limitAndConvert< StoreShort<Big>, InterleavedStream<short, Big> >;
+		default:
+			break;
+		}
+	}
+	else {
+		switch (MUS_GET_FORMAT(rawDeviceFormat)) {
+		case MUS_LFLOAT:
+			return normalized
+				? ::limitAndConvert< StoreFloat<Little, true>, NonInterleavedStream<float, Little, true> >
+				: ::limitAndConvert< StoreFloat<Little, false>, NonInterleavedStream<float, Little> >;
+		case MUS_BFLOAT:
+			return normalized
+				? ::limitAndConvert< StoreFloat<Big, true>, NonInterleavedStream<float, Big, true> >
+				: ::limitAndConvert< StoreFloat<Big, false>, NonInterleavedStream<float, Big> >;
+		case MUS_LINT:
+			return ::limitAndConvert< StoreInt32<Little>, NonInterleavedStream<int32_t, Little, true> >;
+		case MUS_BINT:
+			return ::limitAndConvert< StoreInt32<Big>, NonInterleavedStream<int32_t, Big, true> >;
+		case MUS_LSHORT:
+			return ::limitAndConvert< StoreShort<Little>, NonInterleavedStream<short, Little> >;
+		case MUS_BSHORT:
+			return ::limitAndConvert< StoreShort<Big>, NonInterleavedStream<short, Big> >;
+		default:
+			break;
+		}
+	}
+	return NULL;
+}
+
 // Conversion functions are assigned in pairs, regardless of rec/pb state.
 
 int AudioDeviceImpl::setConvertFunctions(int rawFrameFormat,
@@ -969,6 +1240,12 @@ int AudioDeviceImpl::setConvertFunctions(int rawFrameFormat,
 		}	// !deviceInterleaved
 	}	// !frameInterleaved
 	
+	// The usual playback case -- full-range, non-interleaved float frames --
+	// gets a kernel which limits and converts in one pass.
+	_playLimitFunction = NULL;
+	if (_playConvertFunction != NULL && !frameInterleaved && !frameNormalized)
+		_playLimitFunction = limitFunctionFor(rawDeviceFormat);
+
 	if (isPlaying() && _playConvertFunction == NULL)
 		return error("This format conversion is currently not supported!");
 	if (isRecording() && _recConvertFunction == NULL)
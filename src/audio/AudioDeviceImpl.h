@@ -7,6 +7,8 @@
 #include "AudioDevice.h"
 
 typedef void (*ConversionFunction)(void *, void*, int, int, int);
+struct LimitState;
+typedef void (*LimitFunction)(void *, void*, int, int, int, LimitState *);
 
 class AudioDeviceImpl : public AudioDevice {
 public:
@@ -82,6 +84,18 @@ protected:
 	virtual	int		doGetFrames(void *frameBuffer, int frameCount) = 0;
 	// Returns number of frames written, or -1 for error.
 	virtual	int		doSendFrames(void *frameBuffer, int frameCount) = 0;
+	// Devices that can lend out their own buffer memory (an embedding host's output buffer, say)
+	// return room for <frameCount> frames in the device format here, and
+	// sendFrames() converts straight into it and then calls
+	// doCommitSendFrames() instead of doSendFrames().  Returning NULL means
+	// "use doSendFrames() this time".
+	virtual void *	doBeginSendFrames(int frameCount) { return NULL; }
+	// Returns number of frames written, or -1 for error.
+	virtual int		doCommitSendFrames(int frameCount) { return -1; }
+	// The same for recording: devices whose recorded frames are already in
+	// memory may return them here, in the device format, and getFrames()
+	// converts straight from them instead of calling doGetFrames().
+	virtual void *	doBeginGetFrames(int frameCount) { return NULL; }
 
 	// Local utilities for base classes to use.
 
@@ -98,7 +112,8 @@ protected:
 	inline int		getMode() const;
 	inline State	getState() const;
 	void			*convertFrame(void *inFrame, void *outFrame, int frames, bool rec);
-	void			limitFrame(void *frame, int frames, bool doClip, bool checkPeaks, bool reportClip);
+	void			limitFrame(void *frame, int frames, bool doClip, bool checkPeaks, bool reportClip,
+							   void *convertedFrame=NULL);
 	int				error(const char *msg, const char *msg2=0);
 
 private:
@@ -129,6 +144,7 @@ private:
 	void				*_convertBuffer;
 	ConversionFunction	_recConvertFunction;
 	ConversionFunction	_playConvertFunction;
+	LimitFunction		_playLimitFunction;		// fused limitFrame/convertFrame
 	double				_muteThreshold;
 	enum { ErrLength = 128 };
 	char				_lastErr[ErrLength];
@@ -7,10 +7,13 @@
 
 #include <math.h>       /* for fabs */
 #include "AudioFileDevice.h"
+#include "FlacEncoder.h"
+#include "sndlibsupport.h"
 #include <byte_routines.h>
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
 #if defined(LINUX) || defined(MACOSX)
 #include <unistd.h>
 #endif
@@ -28,9 +31,23 @@
 #define PRINT1 if (0) printf
 #endif
 
+#define WRITER_IDLE_USEC	1000
+
 struct AudioFileDevice::Impl {
 	char						*path;
 	int							fileType;		// wave, aiff, etc.
+	// Write-behind queue, a single-producer, single-consumer byte ring.
+	// The thread in sendFrames() advances tail; the writer advances head.
+	char						*ring;
+	long						ringBytes;
+	long						batchBytes;		// wait for this much to write
+	volatile long				head;
+	volatile long				tail;
+	volatile int				writeErrno;		// set by the writer on failure
+	volatile bool				draining;
+	pthread_t					writer;
+	bool						writerRunning;
+	FlacEncoder					*encoder;		// for RT_MUS_FLAC files
 };
 
 AudioFileDevice::AudioFileDevice(const char *path,
@@ -40,12 +57,22 @@ AudioFileDevice::AudioFileDevice(const char *path,
 	PRINT1("AudioFileDevice::AudioFileDevice\n");
 	_impl->path = (char *)path;
 	_impl->fileType = fileType;
+	_impl->ring = NULL;
+	_impl->ringBytes = 0;
+	_impl->batchBytes = 0;
+	_impl->head = _impl->tail = 0;
+	_impl->writeErrno = 0;
+	_impl->draining = false;
+	_impl->writerRunning = false;
+	_impl->encoder = NULL;
 }
 
 AudioFileDevice::~AudioFileDevice()
 {
 	PRINT1("AudioFileDevice::~AudioFileDevice\n");
 	close();
+	stopWriter();
+	delete _impl->encoder;
 	delete _impl;
 }
 
@@ -78,11 +105,118 @@ int AudioFileDevice::open(int mode, int fileSampFmt, int fileChans, double srate
 	return status;
 }
 
+int AudioFileDevice::setWriteBuffer(int frames, bool batch)
+{
+	if (!isOpen())
+		return error("File device must be open to set its write buffer");
+	if (frames <= 0 || _impl->writerRunning)
+		return 0;
+	_impl->ringBytes = (long) frames * getDeviceBytesPerFrame() + 1;	// one is never used
+	_impl->batchBytes = batch ? _impl->ringBytes / 2 : 1;
+	_impl->ring = new char[_impl->ringBytes];
+	_impl->head = _impl->tail = 0;
+	_impl->writeErrno = 0;
+	_impl->draining = false;
+	if (pthread_create(&_impl->writer, NULL, &AudioFileDevice::writerThread, this) != 0) {
+		delete [] _impl->ring;
+		_impl->ring = NULL;
+		return error("Failed to start file writer thread");
+	}
+	_impl->writerRunning = true;
+	return 0;
+}
+
+void *AudioFileDevice::writerThread(void *context)
+{
+	((AudioFileDevice *) context)->writeQueued();
+	return NULL;
+}
+
+// The writer thread's loop.  Exits once the queue is empty after
+// stopWriter() sets draining, or on a write error.
+
+void AudioFileDevice::writeQueued()
+{
+	Impl *impl = _impl;
+	const long size = impl->ringBytes;
+	for (;;) {
+		const long head = impl->head;
+		const long tail = impl->tail;
+		__sync_synchronize();		// read the data only after seeing the tail
+		const long used = (tail - head + size) % size;
+		if (used == 0 || (used < impl->batchBytes && !impl->draining)) {
+			if (used == 0 && impl->draining)
+				break;
+			::usleep(WRITER_IDLE_USEC);
+			continue;
+		}
+		const long bytes = (tail > head) ? tail - head : size - head;
+		long written;
+		if (impl->encoder != NULL)
+			written = (impl->encoder->encode(&impl->ring[head], bytes) == 0) ? bytes : -1;
+		else
+			written = ::write(device(), &impl->ring[head], bytes);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0) {
+			impl->writeErrno = (written < 0) ? errno : ENOSPC;
+			break;
+		}
+		__sync_synchronize();		// finish reading before freeing the space
+		impl->head = (head + written) % size;
+	}
+}
+
+// Copy <bytes> of converted audio into the queue, waiting for the writer to
+// make room if need be.
+
+int AudioFileDevice::queueFrames(void *frameBuffer, long bytes)
+{
+	Impl *impl = _impl;
+	const long size = impl->ringBytes;
+	const char *src = (const char *) frameBuffer;
+	while (bytes > 0) {
+		const long tail = impl->tail;
+		long space;
+		while ((space = size - 1 - (tail - impl->head + size) % size) == 0) {
+			if (impl->writeErrno != 0)
+				return -1;
+			::usleep(WRITER_IDLE_USEC);
+		}
+		__sync_synchronize();		// don't overwrite until the writer is done
+		if (impl->writeErrno != 0)
+			return -1;
+		long chunk = (bytes < space) ? bytes : space;
+		if (chunk > size - tail)
+			chunk = size - tail;
+		memcpy(&impl->ring[tail], src, chunk);
+		__sync_synchronize();		// publish the data before the new tail
+		impl->tail = (tail + chunk) % size;
+		src += chunk;
+		bytes -= chunk;
+	}
+	return 0;
+}
+
+void AudioFileDevice::stopWriter()
+{
+	if (!_impl->writerRunning)
+		return;
+	_impl->draining = true;
+	pthread_join(_impl->writer, NULL);
+	_impl->writerRunning = false;
+	delete [] _impl->ring;
+	_impl->ring = NULL;
+}
+
 int AudioFileDevice::doOpen(int mode)
 {
 	assert(!(mode & Record));
 	setMode(mode);
 	
+	if (_impl->fileType == RT_MUS_FLAC)
+		return openFlac();
+
 	int fd = sndlib_create((char *)_impl->path, _impl->fileType,
 						   getDeviceFormat(), (int) getSamplingRate(), 
 						   getDeviceChannels());
@@ -96,12 +230,57 @@ int AudioFileDevice::doOpen(int mode)
 	return (fd > 0) ? 0 : -1;
 }
 
+// FLAC files are written by our own encoder, which wants little-endian
+// 16- or 24-bit frames (rtoutput asks for those).
+
+int AudioFileDevice::openFlac()
+{
+	int bits;
+	switch (MUS_GET_FORMAT(getDeviceFormat())) {
+	case MUS_LSHORT:
+		bits = 16;
+		break;
+	case MUS_L24INT:
+		bits = 24;
+		break;
+	default:
+		return error("FLAC files must be 16- or 24-bit");
+	}
+	if (!FlacEncoder::supports(getDeviceChannels(), (int) getSamplingRate(), bits))
+		return error("FLAC files support 1 to 8 channels");
+	int fd = ::open(_impl->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return error(::strerror(errno));
+	_impl->encoder = new FlacEncoder(fd, getDeviceChannels(), (int) getSamplingRate(), bits);
+	if (_impl->encoder->start() != 0) {
+		error(::strerror(errno));
+		delete _impl->encoder;
+		_impl->encoder = NULL;
+		::close(fd);
+		return -1;
+	}
+	setDevice(fd);
+	closing(false);
+	resetFrameCount();
+	return 0;
+}
+
 int AudioFileDevice::doClose()
 {
 	PRINT1("AudioFileDevice::doClose\n");
 	int status = 0;
 	if (!closing()) {
 		closing(true);
+		stopWriter();		// everything queued is on disk after this
+		if (_impl->encoder != NULL) {
+			if (_impl->encoder->finish() != 0)
+				status = error("Error writing to file.");
+			delete _impl->encoder;
+			_impl->encoder = NULL;
+			::close(device());
+			setDevice(-1);
+			return status;
+		}
 		if (checkPeaks()) {
 			// Normalize peaks if file was normalized.
 			if (isDeviceFmtNormalized())
@@ -158,6 +337,21 @@ int AudioFileDevice::doGetFrames(void *frameBuffer, int frameCount)
 int	AudioFileDevice::doSendFrames(void *frameBuffer, int frames)
 {
 	long bytesToWrite = frames * getDeviceBytesPerFrame();
+	if (_impl->writerRunning) {
+		if (queueFrames(frameBuffer, bytesToWrite) != 0) {
+			return error(_impl->writeErrno == ENOSPC ? "Incomplete write to file (disk full?)"
+													 : "Error writing to file.");
+		}
+		incrementFrameCount(frames);
+		return frames;
+	}
+	if (_impl->encoder != NULL) {
+		if (_impl->encoder->encode(frameBuffer, bytesToWrite) != 0)
+			return error(errno == ENOSPC ? "Incomplete write to file (disk full?)"
+										 : "Error writing to file.");
+		incrementFrameCount(frames);
+		return frames;
+	}
 	long bytesWritten = ::write(device(), frameBuffer, bytesToWrite);
 	if (bytesWritten < 0) {
 		return error("Error writing to file.");
@@ -13,6 +13,15 @@ public:
 	// AudioDeviceImpl overrides.
 	virtual int open(int mode, int sampfmt, int chans, double srate);
 
+	// Hand writes off to a thread of our own, through a queue of <frames>
+	// frames of converted audio, so that the thread calling sendFrames()
+	// never waits on the disk unless the queue fills.  The thread writes
+	// out whatever is queued in as few calls as it can; with <batch>, it
+	// waits for half the queue before writing at all, for the largest
+	// possible sequential writes.  Call after open(); 0 frames (the
+	// default) writes on the calling thread.
+	int setWriteBuffer(int frames, bool batch);
+
 protected:
     // ThreadedAudioDevice redefine.
     virtual void run();
@@ -27,6 +36,11 @@ protected:
 	virtual int doGetFrames(void *frameBuffer, int frameCount);
 	virtual	int	doSendFrames(void *frameBuffer, int frameCount);
 private:
+	static void *writerThread(void *);
+	void	writeQueued();
+	int		queueFrames(void *frameBuffer, long bytes);
+	void	stopWriter();
+	int		openFlac();
 	struct Impl;
 	Impl	*_impl;
 };
@@ -1,14 +1,22 @@
 // AudioOutputGroupDevice.cpp
 
 #include "AudioOutputGroupDevice.h"
+#include "sndlibsupport.h"
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #ifndef NULL
 #define NULL 0
 #endif
 
+#define QUEUE_IDLE_USEC		1000
+#define DRIFT_GAIN			0.002	// ratio change per unit of fill error
+#define MAX_DRIFT			0.005	// never resample more than 0.5%
+#define FILL_SMOOTHING		0.01	// weight of each new fill measurement
+
 // This subclass is designed to allow up to three independent output AudioDevice
 // instances to function and be controlled as a single unit.  It allows for the creation 
 // of compound AudioDevices which play back to more than one HW device.
@@ -18,11 +26,181 @@
 // invokes the run() method).  The others must run in Passive mode, where they
 // waits for the application to call getFrames() or sendFrames().  The
 // first AudioDevice * argument to the constructor, below, is the master device.
+//
+// By default the other devices are written in turn from the master's thread,
+// so any of them that blocks holds up all of them, and since each HW device
+// has its own clock they slowly drift apart.  After setAsynchronous(), each
+// device after the master gets a Queue: sendFrames() only copies into it,
+// and a thread per device empties it at that device's pace.  The thread
+// resamples very slightly (linear interpolation, at most MAX_DRIFT) to keep
+// its queue half full, which absorbs the clock difference.
+
+struct AudioOutputGroupDevice::Queue {
+	AudioDevice		*device;
+	int				chans;
+	int				blockFrames;	// frames per write to the device
+	// Single-producer, single-consumer frame ring.  sendFrames() advances
+	// tail; the queue's thread advances head.
+	float			**ring;			// [chans][size]
+	long			size;			// one frame is never used
+	volatile long	head;
+	volatile long	tail;
+	volatile bool	quit;
+	volatile bool	failed;			// the device refused a write
+	volatile long	overruns;		// writes dropped because the queue was full
+	float			**block;		// resampled frames for the device
+	double			phase;			// fractional read position past head
+	double			ratio;			// input frames consumed per output frame
+	double			meanFill;
+	pthread_t		thread;
+	bool			running;
+
+	Queue(AudioDevice *dev, int chans, int blockFrames, int fifoBlocks);
+	~Queue();
+	long			used() const { return (tail - head + size) % size; }
+	void			push(float **frames, int frameCount);
+	int				start();
+	void			stop();
+	static void *	threadProcess(void *context);
+	void			run();
+};
+
+AudioOutputGroupDevice::Queue::Queue(AudioDevice *dev, int nchans, int frames, int fifoBlocks)
+	: device(dev), chans(nchans), blockFrames(frames),
+	  size((long) frames * fifoBlocks * 2 + 1), head(0), tail(0),
+	  quit(false), failed(false), overruns(0),
+	  phase(0.0), ratio(1.0), meanFill(0.0), running(false)
+{
+	ring = new float *[chans];
+	block = new float *[chans];
+	for (int ch = 0; ch < chans; ++ch) {
+		ring[ch] = new float[size];
+		block[ch] = new float[blockFrames];
+	}
+	meanFill = (size - 1) / 2;
+}
+
+AudioOutputGroupDevice::Queue::~Queue()
+{
+	stop();
+	for (int ch = 0; ch < chans; ++ch) {
+		delete [] ring[ch];
+		delete [] block[ch];
+	}
+	delete [] ring;
+	delete [] block;
+}
+
+// Called from the master's thread; never waits.  If the device has fallen
+// so far behind that the queue is full, the frames are dropped for it.  The
+// drops are only counted here; stop() reports them, off the audio thread.
+
+void AudioOutputGroupDevice::Queue::push(float **frames, int frameCount)
+{
+	const long t = tail;
+	const long space = size - 1 - (t - head + size) % size;
+	if (space < frameCount) {
+		++overruns;
+		return;
+	}
+	__sync_synchronize();		// don't overwrite until the reader is done
+	long first = frameCount;
+	if (first > size - t)
+		first = size - t;
+	for (int ch = 0; ch < chans; ++ch) {
+		memcpy(&ring[ch][t], frames[ch], first * sizeof(float));
+		if (first < frameCount)
+			memcpy(&ring[ch][0], frames[ch] + first, (frameCount - first) * sizeof(float));
+	}
+	__sync_synchronize();		// publish the frames before the new tail
+	tail = (t + frameCount) % size;
+}
+
+int AudioOutputGroupDevice::Queue::start()
+{
+	if (running)
+		return 0;
+	quit = false;
+	if (pthread_create(&thread, NULL, &Queue::threadProcess, this) != 0)
+		return -1;
+	running = true;
+	return 0;
+}
+
+void AudioOutputGroupDevice::Queue::stop()
+{
+	if (!running)
+		return;
+	quit = true;
+	pthread_join(thread, NULL);
+	running = false;
+	if (overruns > 0) {
+		fprintf(stderr, "Output device queue overrun: dropped %ld writes.\n",
+				(long) overruns);
+		overruns = 0;
+	}
+}
+
+void *AudioOutputGroupDevice::Queue::threadProcess(void *context)
+{
+	((Queue *) context)->run();
+	return NULL;
+}
+
+void AudioOutputGroupDevice::Queue::run()
+{
+	const double target = (size - 1) / 2;
+	// Let the queue fill to its working level before the first write.
+	while (!quit && used() < (long) target)
+		::usleep(QUEUE_IDLE_USEC);
+	while (!quit) {
+		const long avail = used();
+		const long needed = (long) (phase + (blockFrames - 1) * ratio) + 2;
+		if (avail < needed) {
+			::usleep(QUEUE_IDLE_USEC);
+			continue;
+		}
+		__sync_synchronize();		// read the frames only after seeing the tail
+		const long h = head;
+		for (int n = 0; n < blockFrames; ++n) {
+			const double pos = phase + n * ratio;
+			const long i = (long) pos;
+			const float frac = (float) (pos - i);
+			const long i0 = (h + i) % size;
+			const long i1 = (i0 + 1) % size;
+			for (int ch = 0; ch < chans; ++ch) {
+				const float a = ring[ch][i0];
+				block[ch][n] = a + frac * (ring[ch][i1] - a);
+			}
+		}
+		const double end = phase + blockFrames * ratio;
+		const long consumed = (long) end;
+		phase = end - consumed;
+		__sync_synchronize();		// finish reading before freeing the space
+		head = (h + consumed) % size;
+
+		// The fill level just before each write tells us whether this
+		// device's clock is slower (queue growing) or faster than the master's.
+		meanFill += FILL_SMOOTHING * (avail - meanFill);
+		double drift = DRIFT_GAIN * (meanFill - target) / target;
+		if (drift > MAX_DRIFT)
+			drift = MAX_DRIFT;
+		else if (drift < -MAX_DRIFT)
+			drift = -MAX_DRIFT;
+		ratio = 1.0 + drift;
+
+		if (device->sendFrames(block, blockFrames) != blockFrames) {
+			failed = true;
+			break;
+		}
+	}
+}
 
 AudioOutputGroupDevice::AudioOutputGroupDevice(AudioDevice *masterDevice,
 							 				   AudioDevice *outputDevice2,
 							 				   AudioDevice *outputDevice3)
-	: _count((outputDevice3 != NULL) ? 3 : 2), _devices(new AudioDevice *[_count])
+	: _count((outputDevice3 != NULL) ? 3 : 2), _devices(new AudioDevice *[_count]),
+	  _queues(NULL), _frameFormat(0), _frameChans(0)
 {
 	_devices[0] = masterDevice;
 	_devices[1] = outputDevice2;
@@ -32,6 +210,11 @@ AudioOutputGroupDevice::AudioOutputGroupDevice(AudioDevice *masterDevice,
 
 AudioOutputGroupDevice::~AudioOutputGroupDevice()
 {
+	if (_queues != NULL) {
+		for (int dev = 0; dev < _count; ++dev)
+			delete _queues[dev];
+		delete [] _queues;
+	}
 	for (int dev = 0; dev < _count; ++dev)
 		delete _devices[dev];
 	delete [] _devices;
@@ -39,6 +222,8 @@ AudioOutputGroupDevice::~AudioOutputGroupDevice()
 
 int AudioOutputGroupDevice::setFrameFormat(int sampfmt, int chans)
 {
+	_frameFormat = sampfmt;
+	_frameChans = chans;
 	int status = 0;
 	for (int dev = 0; dev < _count && status == 0; ++dev) {
 		status = _devices[dev]->setFrameFormat(sampfmt, chans);
@@ -60,6 +245,7 @@ int AudioOutputGroupDevice::open(int mode, int sampfmt, int chans, double sr)
 
 int AudioOutputGroupDevice::close()
 {
+	stopQueues();
 	int status = 0;
 	for (int dev = 0; dev < _count && status == 0; ++dev) {
 		status = _devices[dev]->close();
@@ -72,6 +258,10 @@ int AudioOutputGroupDevice::start(Callback *runCallback)
 	int status = 0;
 	for (int dev = _count - 1; dev > 0 && status == 0; --dev) {
 		status = _devices[dev]->start(NULL, NULL);
+		if (status == 0 && _queues != NULL && _queues[dev]->start() != 0) {
+			fprintf(stderr, "Failed to start output device queue thread.\n");
+			status = -1;
+		}
 	}
 	if (status == 0)
 		status = _devices[0]->start(runCallback);
@@ -102,6 +292,7 @@ int AudioOutputGroupDevice::pause(bool paused)
 
 int AudioOutputGroupDevice::stop()
 {
+	stopQueues();
 	int status = 0;
 	for (int dev = 0; dev < _count && status == 0; ++dev) {
 		status = _devices[dev]->stop();
@@ -165,6 +356,12 @@ int AudioOutputGroupDevice::sendFrames(void *frameBuffer, int frameCount)
 {
 	int frames = 0;
 	for (int dev = 0; dev < _count; ++dev) {
+		if (dev > 0 && _queues != NULL) {
+			if (_queues[dev]->failed)
+				return -1;
+			_queues[dev]->push((float **) frameBuffer, frameCount);
+			continue;
+		}
 		frames = _devices[dev]->sendFrames(frameBuffer, frameCount);
 		if (frames != frameCount)
 			break;	// Error
@@ -172,6 +369,30 @@ int AudioOutputGroupDevice::sendFrames(void *frameBuffer, int frameCount)
 	return frames;
 }
 
+int AudioOutputGroupDevice::setAsynchronous(int blockFrames, int fifoBlocks)
+{
+	if (_queues != NULL || fifoBlocks <= 0)
+		return 0;
+	if (MUS_GET_INTERLEAVE(_frameFormat) != MUS_NON_INTERLEAVED
+			|| !IS_FLOAT_FORMAT(_frameFormat)) {
+		fprintf(stderr, "Output device queues need non-interleaved float frames.\n");
+		return -1;
+	}
+	_queues = new Queue *[_count];
+	_queues[0] = NULL;
+	for (int dev = 1; dev < _count; ++dev)
+		_queues[dev] = new Queue(_devices[dev], _frameChans, blockFrames, fifoBlocks);
+	return 0;
+}
+
+void AudioOutputGroupDevice::stopQueues()
+{
+	if (_queues == NULL)
+		return;
+	for (int dev = 1; dev < _count; ++dev)
+		_queues[dev]->stop();
+}
+
 bool AudioOutputGroupDevice::isOpen() const
 {
 	bool open = true;
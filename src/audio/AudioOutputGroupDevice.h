@@ -29,15 +29,27 @@ public:
 	int			setMuteThreshold(double thresh);
 	const char *getLastError() const;
 
+	// Give each device after the first a queue of <fifoBlocks> writes of
+	// <blockFrames> frames and a thread of its own, so that it runs on its
+	// own clock rather than the first device's.  Must be called after
+	// setQueueSize().  Only float, non-interleaved frames are supported.
+	int			setAsynchronous(int blockFrames, int fifoBlocks);
+
 protected:
 	// AudioDevice redefinitions.
 	int			start(Callback *runCallback);
 	bool		runCallback();
 	bool		stopCallback();
 
+	void		stopQueues();
+
 protected:
+	struct Queue;
 	int			_count;
 	AudioDevice **_devices;
+	Queue		**_queues;		// NULL, or one per device (NULL for the first)
+	int			_frameFormat;
+	int			_frameChans;
 };
 
 #endif	// _AUDIOOUTPUTGROUPDEVICE_H_
@@ -0,0 +1,266 @@
+// BenchAudioDevice.cpp
+//
+// A playback (or record) device driven by a clock instead of hardware.  Its
+// thread wakes once a buffer period -- the buffer size and sampling rate
+// given to rtsetparams -- on an absolute schedule, runs the callback, and
+// times it from the moment the buffer was due.  A buffer which takes longer
+// than its deadline is counted as an xrun, and any periods it runs into are
+// skipped, as a real device would drop them.  Output is thrown away; input
+// is silence.  When the device closes, it reports the spread of callback
+// times as percentages of the deadline.
+//
+// Descriptor is "bench", or "bench:<percent>" to set the deadline to that
+// percentage of the buffer period (default 100), to leave room for what a
+// real driver would take.
+
+#include "BenchAudioDevice.h"
+#include <sndlibsupport.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEBUG 0
+
+#if DEBUG > 1
+#define PRINT0 if (1) printf
+#define PRINT1 if (1) printf
+#elif DEBUG > 0
+#define PRINT0 if (1) printf
+#define PRINT1 if (0) printf
+#else
+#define PRINT0 if (0) printf
+#define PRINT1 if (0) printf
+#endif
+
+// Callback times are counted in bins of 1% of the deadline, up to twice
+// the deadline; the last bin takes everything longer.
+#define BENCH_BINS 201
+
+struct BenchAudioDevice::Impl {
+	int			deadlinePercent;
+	int			frames;				// per buffer
+	double		srate;
+	long long	period;				// nsec
+	long long	deadline;
+	long long	buffers;
+	long long	xruns;
+	long long	skipped;			// periods lost to late buffers
+	long long	totalNsec;
+	long long	maxNsec;
+	long long	bins[BENCH_BINS];
+};
+
+static inline long long now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void sleepUntil(long long nsec)
+{
+	struct timespec ts;
+#ifdef LINUX
+	ts.tv_sec = nsec / 1000000000LL;
+	ts.tv_nsec = nsec % 1000000000LL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+#else
+	const long long wait = nsec - now();
+	if (wait > 0) {
+		ts.tv_sec = wait / 1000000000LL;
+		ts.tv_nsec = wait % 1000000000LL;
+		nanosleep(&ts, NULL);
+	}
+#endif
+}
+
+BenchAudioDevice::BenchAudioDevice(const char *desc) : _impl(new Impl)
+{
+	memset(_impl, 0, sizeof(Impl));
+	_impl->deadlinePercent = 100;
+	int percent;
+	if (desc != NULL && sscanf(desc, "bench:%d", &percent) == 1 && percent > 0)
+		_impl->deadlinePercent = percent;
+}
+
+BenchAudioDevice::~BenchAudioDevice()
+{
+	close();
+	delete _impl;
+}
+
+int BenchAudioDevice::doOpen(int mode)
+{
+	switch (mode & DirectionMask) {
+	case Playback:
+	case Record:
+	case RecordPlayback:
+		break;
+	default:
+		return error("BenchAudioDevice: Illegal open mode.");
+	}
+	closing(false);
+	resetFrameCount();
+	return 0;
+}
+
+int BenchAudioDevice::doClose()
+{
+	if (!closing()) {
+		closing(true);
+		if (_impl->buffers > 0)
+			report();
+		resetFrameCount();
+	}
+	return 0;
+}
+
+int BenchAudioDevice::doStart()
+{
+	_impl->buffers = _impl->xruns = _impl->skipped = 0;
+	_impl->totalNsec = _impl->maxNsec = 0;
+	memset(_impl->bins, 0, sizeof(_impl->bins));
+	return ThreadedAudioDevice::startThread();
+}
+
+int BenchAudioDevice::doPause(bool paused)
+{
+	this->paused(paused);
+	return 0;
+}
+
+// We take whatever RTcmix hands us, so no conversion is done.
+
+int BenchAudioDevice::doSetFormat(int sampfmt, int chans, double srate)
+{
+	_impl->srate = srate;
+	setDeviceParams(NATIVE_FLOAT_FMT | MUS_NON_INTERLEAVED, chans, srate);
+	return 0;
+}
+
+int BenchAudioDevice::doSetQueueSize(int *pWriteSize, int *pCount)
+{
+	_impl->frames = *pWriteSize;
+	return 0;
+}
+
+int BenchAudioDevice::doGetFrames(void *frameBuffer, int frameCount)
+{
+	float **chans = (float **) frameBuffer;
+	for (int ch = 0; ch < getDeviceChannels(); ++ch)
+		memset(chans[ch], 0, frameCount * sizeof(float));
+	return frameCount;
+}
+
+int BenchAudioDevice::doSendFrames(void *frameBuffer, int frameCount)
+{
+	incrementFrameCount(frameCount);
+	return frameCount;
+}
+
+void BenchAudioDevice::record(long long nsec)
+{
+	++_impl->buffers;
+	_impl->totalNsec += nsec;
+	if (nsec > _impl->maxNsec)
+		_impl->maxNsec = nsec;
+	if (nsec > _impl->deadline)
+		++_impl->xruns;
+	long long bin = nsec * 100 / _impl->deadline;
+	if (bin >= BENCH_BINS)
+		bin = BENCH_BINS - 1;
+	++_impl->bins[bin];
+}
+
+// The percentage of the deadline under which <fraction> of the callbacks
+// finished, to the nearest bin above.
+
+static int percentile(const long long *bins, long long count, double fraction)
+{
+	const long long wanted = (long long) (count * fraction + 0.999999);
+	long long sum = 0;
+	for (int bin = 0; bin < BENCH_BINS; ++bin) {
+		sum += bins[bin];
+		if (sum >= wanted)
+			return bin + 1;
+	}
+	return BENCH_BINS;
+}
+
+void BenchAudioDevice::report()
+{
+	const long long count = _impl->buffers;
+	const double deadline = (double) _impl->deadline;
+	printf("bench: %lld buffers of %d frames at %g Hz; deadline %.3f ms (%d%% of %.3f ms)\n",
+		   count, _impl->frames, _impl->srate, deadline * 1.0e-6,
+		   _impl->deadlinePercent, _impl->period * 1.0e-6);
+	printf("bench: callback time, in %% of deadline: mean %.1f, max %.1f\n",
+		   100.0 * _impl->totalNsec / count / deadline,
+		   100.0 * _impl->maxNsec / deadline);
+	const double fractions[] = { 0.5, 0.9, 0.99, 0.999 };
+	const char *names[] = { "50", "90", "99", "99.9" };
+	for (int n = 0; n < 4; ++n) {
+		const int pct = percentile(_impl->bins, count, fractions[n]);
+		if (pct < BENCH_BINS)
+			printf("bench:   %s%% of callbacks under %d%%\n", names[n], pct);
+		else
+			printf("bench:   %s%% of callbacks under more than %d%%\n",
+				   names[n], BENCH_BINS - 1);
+	}
+	printf("bench: %lld xruns, %lld buffer periods skipped\n",
+		   _impl->xruns, _impl->skipped);
+}
+
+void BenchAudioDevice::run()
+{
+	PRINT1("BenchAudioDevice::run entered\n");
+	assert(!isPassive());	// Cannot call this method when passive!
+
+	_impl->period = (long long) (1.0e9 * _impl->frames / _impl->srate + 0.5);
+	_impl->deadline = _impl->period * _impl->deadlinePercent / 100;
+	if (_impl->deadline < 1)
+		_impl->deadline = 1;
+	long long due = now();
+	while (!stopping()) {
+		if (paused()) {
+			::usleep(1000);
+			due = now();
+			continue;
+		}
+		sleepUntil(due);
+		if (runCallback() != true)
+			break;
+		const long long done = now();
+		record(done - due);
+		due += _impl->period;
+		while (due < done) {
+			due += _impl->period;
+			++_impl->skipped;
+		}
+	}
+	// As in AudioFileDevice::run().
+	if (!stopping()) {
+		setState(Configured);
+		if (!closing()) {
+			PRINT1("BenchAudioDevice::run: calling close()\n");
+			close();
+		}
+	}
+	stopCallback();
+	PRINT1("BenchAudioDevice::run: thread exiting\n");
+}
+
+bool BenchAudioDevice::recognize(const char *desc)
+{
+	return desc != NULL && strncmp(desc, "bench", 5) == 0
+		&& (desc[5] == '\0' || desc[5] == ':');
+}
+
+AudioDevice *BenchAudioDevice::create(const char *inputDesc, const char *outputDesc, int mode)
+{
+	return new BenchAudioDevice(outputDesc ? outputDesc : inputDesc);
+}
@@ -0,0 +1,40 @@
+// BenchAudioDevice.h
+//
+// A device with no hardware behind it, for measuring how close a score runs
+// to its deadlines.  See BenchAudioDevice.cpp.
+//
+
+#ifndef _BENCHAUDIODEVICE_H_
+#define _BENCHAUDIODEVICE_H_
+
+#include "ThreadedAudioDevice.h"
+
+class BenchAudioDevice : public ThreadedAudioDevice {
+public:
+	BenchAudioDevice(const char *desc);
+	virtual ~BenchAudioDevice();
+	// Recognizer
+	static bool			recognize(const char *);
+	// Creator
+	static AudioDevice*	create(const char *, const char *, int);
+
+protected:
+	// ThreadedAudioDevice redefine.
+	virtual void run();
+	// AudioDeviceImpl reimplementation
+	virtual int doOpen(int mode);
+	virtual int doClose();
+	virtual int doStart();
+	virtual int doPause(bool);
+	virtual int doSetFormat(int sampfmt, int chans, double srate);
+	virtual int doSetQueueSize(int *pWriteSize, int *pCount);
+	virtual int	doGetFrames(void *frameBuffer, int frameCount);
+	virtual int	doSendFrames(void *frameBuffer, int frameCount);
+private:
+	void	record(long long nsec);
+	void	report();
+	struct Impl;
+	Impl	*_impl;
+};
+
+#endif	// _BENCHAUDIODEVICE_H_
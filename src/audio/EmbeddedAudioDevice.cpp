@@ -34,9 +34,14 @@ int SetEmbeddedCallbackAudioFormat(int sampfmt, int chans)
 }
 
 struct EmbeddedAudioDevice::Impl {
-	Impl() : inputAudio(NULL), outputAudio(NULL), audioFormat(0), audioChannels(0), sampleSize(0), frameCount(0) {}
+	Impl() : inputAudio(NULL), outputAudio(NULL), inputSlice(NULL), outputSlice(NULL), audioFormat(0), audioChannels(0), sampleSize(0), frameCount(0) {}
+	~Impl() { delete [] inputSlice; delete [] outputSlice; }
 	void *inputAudio;
 	void *outputAudio;
+	// For non-interleaved buffers run from a frame offset, the host's
+	// channel pointers moved up to it
+	void **inputSlice;
+	void **outputSlice;
 	// Format of above audio, as passed in via run()
 	int audioFormat;
 	int audioChannels;
@@ -55,13 +60,39 @@ EmbeddedAudioDevice::~EmbeddedAudioDevice()
 	delete _impl;
 }
 
-bool EmbeddedAudioDevice::run(void *inputFrameBuffer, void *outputFrameBuffer, int frameCount)
+// Point <slice> at <frameOffset> frames into the host's <buffer>.
+
+static void *offsetBuffer(void *buffer, void **slice, int frameOffset, int audioFormat,
+						  int channels, int sampleSize)
+{
+	if (buffer == NULL || frameOffset == 0)
+		return buffer;
+	if (MUS_GET_INTERLEAVE(audioFormat) == MUS_INTERLEAVED)
+		return (char *) buffer + frameOffset * channels * sampleSize;
+	for (int ch = 0; ch < channels; ++ch)
+		slice[ch] = (char *) ((void **) buffer)[ch] + frameOffset * sampleSize;
+	return slice;
+}
+
+bool EmbeddedAudioDevice::run(void *inputFrameBuffer, void *outputFrameBuffer, int frameCount, int frameOffset)
 {
-	_impl->inputAudio = inputFrameBuffer;
-	_impl->outputAudio = outputFrameBuffer;
+	_impl->inputAudio = offsetBuffer(inputFrameBuffer, _impl->inputSlice, frameOffset,
+									 _impl->audioFormat, _impl->audioChannels, _impl->sampleSize);
+	_impl->outputAudio = offsetBuffer(outputFrameBuffer, _impl->outputSlice, frameOffset,
+									  _impl->audioFormat, _impl->audioChannels, _impl->sampleSize);
 	return runCallback();
 }
 
+bool EmbeddedAudioDevice::isDirectOutput() const
+{
+	return _impl->audioFormat == (NATIVE_FLOAT_FMT | MUS_NON_INTERLEAVED);
+}
+
+int EmbeddedAudioDevice::outputChannels() const
+{
+	return _impl->audioChannels;
+}
+
 int EmbeddedAudioDevice::doOpen(int mode)
 {
 	DPRINT("EmbeddedAudioDevice::doOpen");
@@ -132,7 +163,7 @@ int EmbeddedAudioDevice::doSetFormat(int sampfmt, int chans, double srate)
 {
 	_impl->audioFormat = sCallbackAudioFormat;
 	_impl->audioChannels = sCallbackAudioChannels;
-	switch (MUS_GET_FORMAT(sampfmt)) {
+	switch (MUS_GET_FORMAT(_impl->audioFormat)) {
 		case NATIVE_SHORT_FMT:
 			_impl->sampleSize = 2;
 			break;
@@ -148,6 +179,10 @@ int EmbeddedAudioDevice::doSetFormat(int sampfmt, int chans, double srate)
 		default:
 			return error("Unknown audio format for external buffers");
 	}
+	delete [] _impl->inputSlice;
+	delete [] _impl->outputSlice;
+	_impl->inputSlice = new void *[_impl->audioChannels];
+	_impl->outputSlice = new void *[_impl->audioChannels];
 	setDeviceParams(_impl->audioFormat, _impl->audioChannels, srate);
 	return 0;
 }
@@ -187,7 +222,14 @@ int EmbeddedAudioDevice::doGetFrames(void *frameBuffer, int frameCount)
 		memcpy(frameBuffer, _impl->inputAudio, frameCount * bytesPerFrame);
 	}
 	else {
-		return error("Non-interleaved audio not yet handled");
+		// Both are arrays of per-channel buffers.  Input buses RTcmix points
+		// at the host's buffers (see RTcmix::runAudio()) are already filled.
+		void **src = (void **) _impl->inputAudio;
+		void **dest = (void **) frameBuffer;
+		for (int ch = 0; ch < _impl->audioChannels; ++ch) {
+			if (dest[ch] != src[ch])
+				memcpy(dest[ch], src[ch], frameCount * _impl->sampleSize);
+		}
 	}
 	return frameCount;
 }
@@ -205,13 +247,45 @@ int EmbeddedAudioDevice::doSendFrames(void *frameBuffer, int frameCount)
 		// Copy audio from the pointer to the buffer pointed to by 'frameBuffer' to the cached external audio buffer
 		memcpy(_impl->outputAudio, frameBuffer, frameCount * bytesPerFrame);
 	}
-	else {
-		return error("Non-interleaved audio not yet handled");
+	else if (_impl->outputAudio != NULL) {
+		// Channels RTcmix mixed directly into the host's buffers (see
+		// RTcmix::runAudio()) are already in place.
+		void **src = (void **) frameBuffer;
+		void **dest = (void **) _impl->outputAudio;
+		const int bytes = frameCount * _impl->sampleSize;
+		for (int ch = 0; ch < _impl->audioChannels; ++ch) {
+			if (dest[ch] != src[ch])
+				memcpy(dest[ch], src[ch], bytes);
+		}
 	}
 	_impl->frameCount += frameCount;
 	return frameCount;
 }
 
+// For the non-interleaved formats, the host's arrays of channel pointers are
+// already in the layout AudioDeviceImpl converts to and from, so it can read
+// and write the host's buffers directly, with no copy of our own.
+
+void *EmbeddedAudioDevice::doBeginGetFrames(int frameCount)
+{
+	if (MUS_GET_INTERLEAVE(_impl->audioFormat) == MUS_INTERLEAVED)
+		return NULL;
+	return _impl->inputAudio;
+}
+
+void *EmbeddedAudioDevice::doBeginSendFrames(int frameCount)
+{
+	if (MUS_GET_INTERLEAVE(_impl->audioFormat) == MUS_INTERLEAVED)
+		return NULL;
+	return _impl->outputAudio;
+}
+
+int EmbeddedAudioDevice::doCommitSendFrames(int frameCount)
+{
+	_impl->frameCount += frameCount;
+	return frameCount;
+}
+
 // Return true if the passed in device descriptor matches one that this device
 // can understand.  In this case, we always return true.
 
@@ -20,8 +20,15 @@ public:
 	static bool recognize(const char *);
 	// Creator
 	static AudioDevice* create(const char *, const char *, int);
-	// Public run routine, called from public callback
-	bool run(void *inputFrameBuffer, void *outputFrameBuffer, int frameCount);
+	// Public run routine, called from public callback.  Renders <frameCount>
+	// frames from frame <frameOffset> of the host's buffers.
+	bool run(void *inputFrameBuffer, void *outputFrameBuffer, int frameCount, int frameOffset = 0);
+	// True if the host's buffers are non-interleaved, full-range float -- the
+	// same format as our frame buffers -- so that RTcmix can mix into its
+	// output buffers and read its input buffers directly.  See
+	// RTcmix::runAudio().
+	bool isDirectOutput() const;
+	int outputChannels() const;
 protected:
 	EmbeddedAudioDevice();
 	virtual ~EmbeddedAudioDevice();
@@ -41,6 +48,10 @@ protected:
 	virtual	int		doGetFrames(void *frameBuffer, int frameCount);
 	// Returns number of frames written, or -1 for error.
 	virtual	int		doSendFrames(void *frameBuffer, int frameCount);
+	// With non-interleaved formats, these hand out the host's own buffers.
+	virtual void *	doBeginGetFrames(int frameCount);
+	virtual void *	doBeginSendFrames(int frameCount);
+	virtual int		doCommitSendFrames(int frameCount);
 private:
 	struct Impl;
 	Impl *_impl;
@@ -0,0 +1,588 @@
+// FlacEncoder.cpp
+//
+// See FlacEncoder.h.  References are to the FLAC format specification,
+// https://xiph.org/flac/format.html.
+
+#include "FlacEncoder.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_CHANNELS		8
+#define MAX_FIXED_ORDER		4
+#define MAX_PARTITION_ORDER	8
+#define MAX_RICE_PARAM		14		// 15 is the escape code, which we don't use
+
+enum { SUBFRAME_CONSTANT, SUBFRAME_VERBATIM, SUBFRAME_FIXED };
+
+// Channel assignments, besides (chans - 1) for independent channels.
+enum { LEFT_SIDE = 8, SIDE_RIGHT = 9, MID_SIDE = 10 };
+
+static const int kStreamInfoOffset = 8;		// after "fLaC" and the block header
+static const int kStreamInfoBytes = 34;
+
+// CRC-8 (polynomial x^8 + x^2 + x + 1) for frame headers, and CRC-16
+// (x^16 + x^15 + x^2 + 1) for whole frames, both starting from zero.
+
+static unsigned char sCRC8[256];
+static unsigned short sCRC16[256];
+
+static struct CRCTables {
+	CRCTables() {
+		for (int n = 0; n < 256; ++n) {
+			unsigned crc8 = n, crc16 = n << 8;
+			for (int bit = 0; bit < 8; ++bit) {
+				crc8 = (crc8 & 0x80) ? (crc8 << 1) ^ 0x07 : crc8 << 1;
+				crc16 = (crc16 & 0x8000) ? (crc16 << 1) ^ 0x8005 : crc16 << 1;
+			}
+			sCRC8[n] = (unsigned char) crc8;
+			sCRC16[n] = (unsigned short) crc16;
+		}
+	}
+} sCRCTables;
+
+// Big-endian bit packing, which is how everything in a FLAC stream is laid out.
+
+class FlacEncoder::BitWriter {
+public:
+	BitWriter() : _acc(0), _bits(0) {}
+	void	clear() { _bytes.clear(); _acc = 0; _bits = 0; }
+	// <value> must fit in <bits> bits, and <bits> be at most 32.
+	void	put(uint32_t value, int bits) {
+		_acc = (_acc << bits) | value;
+		_bits += bits;
+		while (_bits >= 8) {
+			_bits -= 8;
+			_bytes.push_back((unsigned char) (_acc >> _bits));
+		}
+	}
+	void	putSigned(int32_t value, int bits) {
+		put((uint32_t) value & (0xffffffffU >> (32 - bits)), bits);
+	}
+	void	putRice(uint32_t value, int param) {
+		uint32_t quotient = value >> param;
+		while (quotient >= 32) {
+			put(0, 32);
+			quotient -= 32;
+		}
+		const uint32_t low = value & ((1U << param) - 1);
+		if (quotient + 1 + param <= 32)
+			put((1U << param) | low, quotient + 1 + param);
+		else {
+			put(1, quotient + 1);
+			put(low, param);
+		}
+	}
+	void	align() { if (_bits > 0) put(0, 8 - _bits); }
+	size_t	size() const { return _bytes.size(); }
+	const unsigned char *data() const { return &_bytes[0]; }
+	unsigned char	crc8() const {
+		unsigned crc = 0;
+		for (size_t n = 0; n < _bytes.size(); ++n)
+			crc = sCRC8[crc ^ _bytes[n]];
+		return (unsigned char) crc;
+	}
+	unsigned short	crc16() const {
+		unsigned crc = 0;
+		for (size_t n = 0; n < _bytes.size(); ++n)
+			crc = ((crc << 8) ^ sCRC16[(crc >> 8) ^ _bytes[n]]) & 0xffff;
+		return (unsigned short) crc;
+	}
+	void	reserve(size_t bytes) { _bytes.reserve(bytes); }
+private:
+	std::vector<unsigned char>	_bytes;
+	uint64_t					_acc;
+	int							_bits;
+};
+
+// What analyze() decided for one channel of a block.
+
+struct FlacEncoder::Subframe {
+	int			type;
+	int			order;
+	int			partitionOrder;
+	int			params[1 << MAX_PARTITION_ORDER];
+	uint64_t	bits;
+};
+
+// MD5 (RFC 1321) of the input, which is exactly what FLAC checksums: the
+// interleaved little-endian samples, in whole bytes.
+
+struct FlacEncoder::MD5 {
+	MD5();
+	void	update(const unsigned char *data, size_t count);
+	void	final(unsigned char digest[16]);
+private:
+	void	transform(const unsigned char block[64]);
+	uint32_t		state[4];
+	uint64_t		length;
+	unsigned char	buffer[64];
+};
+
+static inline uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+FlacEncoder::MD5::MD5() : length(0)
+{
+	state[0] = 0x67452301;
+	state[1] = 0xefcdab89;
+	state[2] = 0x98badcfe;
+	state[3] = 0x10325476;
+}
+
+void FlacEncoder::MD5::transform(const unsigned char block[64])
+{
+	static const uint32_t K[64] = {
+		0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+		0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+		0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+		0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+		0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+		0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+		0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+		0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+		0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+		0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+		0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+	};
+	static const int S[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+	uint32_t M[16];
+	for (int n = 0; n < 16; ++n)
+		M[n] = block[n*4] | (block[n*4+1] << 8) | (block[n*4+2] << 16)
+			   | ((uint32_t) block[n*4+3] << 24);
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	for (int n = 0; n < 64; ++n) {
+		uint32_t f;
+		int g;
+		switch (n >> 4) {
+		case 0:  f = (b & c) | (~b & d);	g = n;					break;
+		case 1:  f = (d & b) | (~d & c);	g = (5 * n + 1) & 15;	break;
+		case 2:  f = b ^ c ^ d;				g = (3 * n + 5) & 15;	break;
+		default: f = c ^ (b | ~d);			g = (7 * n) & 15;		break;
+		}
+		const uint32_t temp = d;
+		d = c;
+		c = b;
+		b = b + rotl(a + f + K[n] + M[g], S[((n >> 4) << 2) | (n & 3)]);
+		a = temp;
+	}
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+void FlacEncoder::MD5::update(const unsigned char *data, size_t count)
+{
+	size_t used = (size_t) (length & 63);
+	length += count;
+	if (used > 0) {
+		const size_t take = (count < 64 - used) ? count : 64 - used;
+		memcpy(&buffer[used], data, take);
+		data += take;
+		count -= take;
+		if (used + take < 64)
+			return;
+		transform(buffer);
+	}
+	for (; count >= 64; data += 64, count -= 64)
+		transform(data);
+	memcpy(buffer, data, count);
+}
+
+void FlacEncoder::MD5::final(unsigned char digest[16])
+{
+	const uint64_t bitLength = length << 3;
+	unsigned char pad[72];
+	const size_t used = (size_t) (length & 63);
+	const size_t padBytes = (used < 56) ? 56 - used : 120 - used;
+	memset(pad, 0, sizeof(pad));
+	pad[0] = 0x80;
+	for (int n = 0; n < 8; ++n)
+		pad[padBytes + n] = (unsigned char) (bitLength >> (8 * n));
+	update(pad, padBytes + 8);
+	for (int n = 0; n < 16; ++n)
+		digest[n] = (unsigned char) (state[n >> 2] >> (8 * (n & 3)));
+}
+
+// Cost, in bits, of Rice-coding <count> residuals whose zigzag-mapped values
+// add up to <sum>, and the parameter that gets it.  This estimates the sum
+// of the quotients as sum >> param, which is close enough to choose by.
+
+static uint64_t riceBits(uint64_t sum, uint32_t count, int *pParam)
+{
+	int param = 0;
+	while (param < MAX_RICE_PARAM && ((uint64_t) count << (param + 1)) <= sum)
+		++param;
+	const int first = (param > 0) ? param - 1 : 0;
+	const int last = (param < MAX_RICE_PARAM) ? param + 1 : param;
+	uint64_t best = 0;
+	for (int k = first; k <= last; ++k) {
+		const uint64_t bits = (uint64_t) count * (k + 1) + (sum >> k);
+		if (k == first || bits < best) {
+			best = bits;
+			*pParam = k;
+		}
+	}
+	return best;
+}
+
+static inline uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+// Residual of the fixed predictor of <order> (section "SUBFRAME_FIXED").
+
+static void fixedResidual(const int32_t *x, int count, int order, int32_t *residual)
+{
+	int32_t *r = residual;
+	switch (order) {
+	case 0:
+		for (int n = 0; n < count; ++n)
+			*r++ = x[n];
+		break;
+	case 1:
+		for (int n = 1; n < count; ++n)
+			*r++ = x[n] - x[n-1];
+		break;
+	case 2:
+		for (int n = 2; n < count; ++n)
+			*r++ = x[n] - 2 * x[n-1] + x[n-2];
+		break;
+	case 3:
+		for (int n = 3; n < count; ++n)
+			*r++ = x[n] - 3 * x[n-1] + 3 * x[n-2] - x[n-3];
+		break;
+	case 4:
+		for (int n = 4; n < count; ++n)
+			*r++ = x[n] - 4 * x[n-1] + 6 * x[n-2] - 4 * x[n-3] + x[n-4];
+		break;
+	}
+}
+
+bool FlacEncoder::supports(int chans, int srate, int bitsPerSample)
+{
+	return chans >= 1 && chans <= MAX_CHANNELS
+		   && srate > 0 && srate < (1 << 20)
+		   && (bitsPerSample == 16 || bitsPerSample == 24);
+}
+
+FlacEncoder::FlacEncoder(int fd, int chans, int srate, int bitsPerSample)
+	: _fd(fd), _chans(chans), _srate(srate), _bits(bitsPerSample),
+	  _bytesPerSample(bitsPerSample / 8), _bytesPerFrame(chans * (bitsPerSample / 8)),
+	  _blockFill(0), _carryBytes(0), _framesEncoded(0), _blockCount(0),
+	  _minFrameBytes(0), _maxFrameBytes(0), _md5(new MD5), _out(new BitWriter)
+{
+	for (int chan = 0; chan < MAX_CHANNELS; ++chan)
+		_block[chan] = (chan < _chans) ? new int32_t[kBlockSize] : NULL;
+	_side = new int32_t[kBlockSize];
+	_mid = new int32_t[kBlockSize];
+	_residual = new int32_t[kBlockSize];
+	_out->reserve(kBlockSize * _bytesPerFrame + 64);
+}
+
+FlacEncoder::~FlacEncoder()
+{
+	for (int chan = 0; chan < MAX_CHANNELS; ++chan)
+		delete [] _block[chan];
+	delete [] _side;
+	delete [] _mid;
+	delete [] _residual;
+	delete _md5;
+	delete _out;
+}
+
+int FlacEncoder::writeOut(const BitWriter &out)
+{
+	const unsigned char *data = out.data();
+	size_t remaining = out.size();
+	while (remaining > 0) {
+		const ssize_t written = ::write(_fd, data, remaining);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0) {
+			if (written == 0)
+				errno = ENOSPC;
+			return -1;
+		}
+		data += written;
+		remaining -= written;
+	}
+	return 0;
+}
+
+void FlacEncoder::writeStreamInfo(BitWriter &out)
+{
+	unsigned char digest[16];
+	memset(digest, 0, sizeof(digest));
+	if (_framesEncoded > 0) {
+		MD5 md5 = *_md5;	// final() consumes it
+		md5.final(digest);
+	}
+	out.put(kBlockSize, 16);			// minimum block size
+	out.put(kBlockSize, 16);			// maximum block size
+	out.put(_minFrameBytes, 24);
+	out.put(_maxFrameBytes, 24);
+	out.put(_srate, 20);
+	out.put(_chans - 1, 3);
+	out.put(_bits - 1, 5);
+	out.put((uint32_t) (_framesEncoded >> 32) & 0xf, 4);
+	out.put((uint32_t) _framesEncoded, 32);
+	for (int n = 0; n < 16; ++n)
+		out.put(digest[n], 8);
+}
+
+int FlacEncoder::start()
+{
+	BitWriter &out = *_out;
+	out.clear();
+	out.put('f', 8); out.put('L', 8); out.put('a', 8); out.put('C', 8);
+	out.put(1, 1);						// last metadata block
+	out.put(0, 7);						// STREAMINFO
+	out.put(kStreamInfoBytes, 24);
+	writeStreamInfo(out);
+	return writeOut(out);
+}
+
+void FlacEncoder::addFrame(const unsigned char *frame)
+{
+	const int n = _blockFill++;
+	if (_bytesPerSample == 2) {
+		for (int chan = 0; chan < _chans; ++chan, frame += 2)
+			_block[chan][n] = (int16_t) (frame[0] | (frame[1] << 8));
+	}
+	else {
+		for (int chan = 0; chan < _chans; ++chan, frame += 3)
+			_block[chan][n] = (int32_t) ((frame[0] << 8) | (frame[1] << 16)
+										 | ((uint32_t) frame[2] << 24)) >> 8;
+	}
+}
+
+int FlacEncoder::encode(const void *bytes, long count)
+{
+	const unsigned char *in = (const unsigned char *) bytes;
+	_md5->update(in, count);
+	while (count > 0) {
+		if (_carryBytes > 0 || count < _bytesPerFrame) {
+			const long take = (count < _bytesPerFrame - _carryBytes)
+								? count : _bytesPerFrame - _carryBytes;
+			memcpy(&_carry[_carryBytes], in, take);
+			_carryBytes += take;
+			in += take;
+			count -= take;
+			if (_carryBytes < _bytesPerFrame)
+				break;
+			addFrame(_carry);
+			_carryBytes = 0;
+		}
+		else {
+			addFrame(in);
+			in += _bytesPerFrame;
+			count -= _bytesPerFrame;
+		}
+		if (_blockFill == kBlockSize && encodeBlock() != 0)
+			return -1;
+	}
+	return 0;
+}
+
+int FlacEncoder::finish()
+{
+	if (_blockFill > 0 && encodeBlock() != 0)
+		return -1;
+	// A stream we can't seek back into (a pipe) keeps its provisional header.
+	if (::lseek(_fd, kStreamInfoOffset, SEEK_SET) != kStreamInfoOffset)
+		return 0;
+	BitWriter &out = *_out;
+	out.clear();
+	writeStreamInfo(out);
+	const int status = writeOut(out);
+	::lseek(_fd, 0, SEEK_END);
+	return status;
+}
+
+// Pick the cheapest way to code one channel of the current block.
+
+void FlacEncoder::analyze(const int32_t *x, int bits, Subframe *sub)
+{
+	const int count = _blockFill;
+	const uint64_t headerBits = 8;
+
+	int n;
+	for (n = 1; n < count && x[n] == x[0]; ++n)
+		;
+	if (n == count) {
+		sub->type = SUBFRAME_CONSTANT;
+		sub->bits = headerBits + bits;
+		return;
+	}
+	sub->type = SUBFRAME_VERBATIM;
+	sub->bits = headerBits + (uint64_t) count * bits;
+
+	const int maxOrder = (count - 1 < MAX_FIXED_ORDER) ? count - 1 : MAX_FIXED_ORDER;
+	for (int order = 0; order <= maxOrder; ++order) {
+		fixedResidual(x, count, order, _residual);
+		// Find the finest partitioning allowed, then total up each coarser
+		// one from it.  (Every partition must hold a whole number of samples,
+		// and the first must have some left over after the warm-up samples.)
+		int maxPartOrder = MAX_PARTITION_ORDER;
+		while (maxPartOrder > 0 && ((count & ((1 << maxPartOrder) - 1)) != 0
+									|| (count >> maxPartOrder) <= order))
+			--maxPartOrder;
+		uint64_t sums[1 << MAX_PARTITION_ORDER];
+		const int partitions = 1 << maxPartOrder;
+		const int partitionSize = count >> maxPartOrder;
+		const int32_t *r = _residual;
+		for (int part = 0; part < partitions; ++part) {
+			const int samples = (part == 0) ? partitionSize - order : partitionSize;
+			uint64_t sum = 0;
+			for (int s = 0; s < samples; ++s)
+				sum += zigzag(*r++);
+			sums[part] = sum;
+		}
+		int params[1 << MAX_PARTITION_ORDER];
+		for (int partOrder = maxPartOrder; partOrder >= 0; --partOrder) {
+			const int parts = 1 << partOrder;
+			const uint32_t size = count >> partOrder;
+			uint64_t residualBits = 2 + 4;
+			for (int part = 0; part < parts; ++part) {
+				const uint32_t samples = (part == 0) ? size - order : size;
+				residualBits += 4 + riceBits(sums[part], samples, &params[part]);
+			}
+			const uint64_t total = headerBits + (uint64_t) order * bits + residualBits;
+			if (total < sub->bits) {
+				sub->type = SUBFRAME_FIXED;
+				sub->order = order;
+				sub->partitionOrder = partOrder;
+				sub->bits = total;
+				memcpy(sub->params, params, parts * sizeof(int));
+			}
+			for (int part = 0; part < parts / 2; ++part)
+				sums[part] = sums[2 * part] + sums[2 * part + 1];
+		}
+	}
+}
+
+void FlacEncoder::writeSubframe(BitWriter &out, const int32_t *x, int bits,
+								const Subframe &sub)
+{
+	const int count = _blockFill;
+	out.put(0, 1);						// zero padding
+	switch (sub.type) {
+	case SUBFRAME_CONSTANT:
+		out.put(0, 6);
+		out.put(0, 1);					// no wasted bits
+		out.putSigned(x[0], bits);
+		break;
+	case SUBFRAME_VERBATIM:
+		out.put(1, 6);
+		out.put(0, 1);
+		for (int n = 0; n < count; ++n)
+			out.putSigned(x[n], bits);
+		break;
+	case SUBFRAME_FIXED: {
+		out.put(8 | sub.order, 6);
+		out.put(0, 1);
+		for (int n = 0; n < sub.order; ++n)
+			out.putSigned(x[n], bits);
+		fixedResidual(x, count, sub.order, _residual);
+		out.put(0, 2);					// Rice coding, 4-bit parameters
+		out.put(sub.partitionOrder, 4);
+		const int parts = 1 << sub.partitionOrder;
+		const int size = count >> sub.partitionOrder;
+		const int32_t *r = _residual;
+		for (int part = 0; part < parts; ++part) {
+			const int param = sub.params[part];
+			out.put(param, 4);
+			const int samples = (part == 0) ? size - sub.order : size;
+			for (int s = 0; s < samples; ++s)
+				out.putRice(zigzag(*r++), param);
+		}
+		break;
+	}
+	}
+}
+
+int FlacEncoder::encodeBlock()
+{
+	const int count = _blockFill;
+	Subframe subs[MAX_CHANNELS];
+	const int32_t *signals[MAX_CHANNELS];
+	int bits[MAX_CHANNELS];
+	int assignment = _chans - 1;
+
+	for (int chan = 0; chan < _chans; ++chan) {
+		signals[chan] = _block[chan];
+		bits[chan] = _bits;
+		analyze(signals[chan], bits[chan], &subs[chan]);
+	}
+	if (_chans == 2) {
+		const int32_t *left = _block[0], *right = _block[1];
+		for (int n = 0; n < count; ++n) {
+			_side[n] = left[n] - right[n];
+			_mid[n] = (left[n] + right[n]) >> 1;
+		}
+		Subframe side, mid;
+		analyze(_side, _bits + 1, &side);
+		analyze(_mid, _bits, &mid);
+		const uint64_t independent = subs[0].bits + subs[1].bits;
+		const uint64_t leftSide = subs[0].bits + side.bits;
+		const uint64_t sideRight = side.bits + subs[1].bits;
+		const uint64_t midSide = mid.bits + side.bits;
+		if (midSide < independent && midSide <= leftSide && midSide <= sideRight) {
+			assignment = MID_SIDE;
+			signals[0] = _mid;		subs[0] = mid;
+			signals[1] = _side;		subs[1] = side;		bits[1] = _bits + 1;
+		}
+		else if (leftSide < independent && leftSide <= sideRight) {
+			assignment = LEFT_SIDE;
+			signals[1] = _side;		subs[1] = side;		bits[1] = _bits + 1;
+		}
+		else if (sideRight < independent) {
+			assignment = SIDE_RIGHT;
+			signals[0] = _side;		subs[0] = side;		bits[0] = _bits + 1;
+		}
+	}
+
+	BitWriter &out = *_out;
+	out.clear();
+	out.put(0x3ffe, 14);				// sync code
+	out.put(0, 1);
+	out.put(0, 1);						// fixed block size
+	out.put((count == kBlockSize) ? 12 : 7, 4);
+	out.put(0, 4);						// sample rate as in STREAMINFO
+	out.put(assignment, 4);
+	out.put((_bits == 16) ? 4 : 6, 3);
+	out.put(0, 1);
+	// The block number, in UTF-8's variable-length coding.
+	const uint32_t number = _blockCount;
+	if (number < 0x80)
+		out.put(number, 8);
+	else {
+		int trailing = (number < 0x800) ? 1 : (number < 0x10000) ? 2
+					   : (number < 0x200000) ? 3 : (number < 0x4000000) ? 4 : 5;
+		out.put(((0xff00 >> (trailing + 1)) & 0xff) | (number >> (6 * trailing)), 8);
+		while (trailing-- > 0)
+			out.put(0x80 | ((number >> (6 * trailing)) & 0x3f), 8);
+	}
+	if (count != kBlockSize)
+		out.put(count - 1, 16);
+	out.put(out.crc8(), 8);
+
+	for (int chan = 0; chan < _chans; ++chan)
+		writeSubframe(out, signals[chan], bits[chan], subs[chan]);
+	out.align();
+	out.put(out.crc16(), 16);
+
+	if (writeOut(out) != 0)
+		return -1;
+	const uint32_t frameBytes = (uint32_t) out.size();
+	if (_blockCount == 0 || frameBytes < _minFrameBytes)
+		_minFrameBytes = frameBytes;
+	if (frameBytes > _maxFrameBytes)
+		_maxFrameBytes = frameBytes;
+	_framesEncoded += count;
+	++_blockCount;
+	_blockFill = 0;
+	return 0;
+}
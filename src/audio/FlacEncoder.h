@@ -0,0 +1,74 @@
+// FlacEncoder.h
+//
+// A small streaming FLAC encoder, so that AudioFileDevice can write lossless
+// compressed files directly instead of PCM that has to be encoded later.
+// sndlib does not write FLAC, and we do not want a libFLAC dependency for
+// what the file device needs, which is only this:
+//
+//	- 16- or 24-bit samples, 1 to 8 channels, fixed 4096-frame blocks
+//	- constant, verbatim or fixed-predictor (order 0-4) subframes, with
+//	  Rice-coded residuals in up to 256 partitions
+//	- left/side, side/right and mid/side decorrelation for stereo
+//	- an MD5 of the audio in STREAMINFO, so "flac -t" can verify the file
+//
+// There is no LPC, so files are somewhat larger than the flac tool's, but
+// encoding is cheap enough to keep up with any render.  The encoder takes
+// the same little-endian interleaved bytes that would go into a WAV file,
+// in chunks of any size.
+
+#ifndef _FLACENCODER_H_
+#define _FLACENCODER_H_
+
+#include <stdint.h>
+#include <vector>
+
+class FlacEncoder {
+public:
+	FlacEncoder(int fd, int chans, int srate, int bitsPerSample);
+	~FlacEncoder();
+
+	// Each returns 0, or -1 with errno set if a write failed.
+
+	int		start();				// write the stream header
+	int		encode(const void *bytes, long count);
+	int		finish();				// last block, then final STREAMINFO
+
+	static bool	supports(int chans, int srate, int bitsPerSample);
+
+	enum { kBlockSize = 4096 };
+
+private:
+	class BitWriter;
+	struct Subframe;
+	struct MD5;
+
+	void	addFrame(const unsigned char *frame);
+	int		encodeBlock();
+	void	analyze(const int32_t *samples, int bits, Subframe *sub);
+	void	writeSubframe(BitWriter &out, const int32_t *samples, int bits,
+						  const Subframe &sub);
+	void	writeStreamInfo(BitWriter &out);
+	int		writeOut(const BitWriter &out);
+
+	int				_fd;
+	int				_chans;
+	int				_srate;
+	int				_bits;
+	int				_bytesPerSample;
+	int				_bytesPerFrame;
+	int32_t *		_block[8];			// deinterleaved input, per channel
+	int32_t *		_side;				// stereo side and mid channels
+	int32_t *		_mid;
+	int32_t *		_residual;
+	int				_blockFill;			// frames in the current block
+	unsigned char	_carry[8 * 3];		// a partial input frame
+	int				_carryBytes;
+	uint64_t		_framesEncoded;
+	uint32_t		_blockCount;
+	uint32_t		_minFrameBytes;
+	uint32_t		_maxFrameBytes;
+	MD5 *			_md5;
+	BitWriter *		_out;
+};
+
+#endif	// _FLACENCODER_H_
@@ -28,8 +28,9 @@
 struct JackAudioDevice::Impl {
 	Impl(const char *serverName)
 		: serverName(serverName), client(NULL), numInPorts(0), numOutPorts(0),
-		  inPorts(NULL), outPorts(NULL), inBuf(NULL), outBuf(NULL), frameCount(0),
-		  srate(0), bufSize(0) {}
+		  inPorts(NULL), outPorts(NULL), inBuf(NULL), outBuf(NULL),
+		  hostIn(NULL), hostOut(NULL), inFifo(NULL), outFifo(NULL), fifoPos(-1),
+		  frameCount(0), srate(0), bufSize(0) {}
 	~Impl();
 	const char *serverName;
 	jack_client_t *client;
@@ -39,9 +40,16 @@ struct JackAudioDevice::Impl {
 	jack_port_t **outPorts;
 	jack_default_audio_sample_t **inBuf;
 	jack_default_audio_sample_t **outBuf;
+	jack_default_audio_sample_t **hostIn;	// JACK's port buffers
+	jack_default_audio_sample_t **hostOut;
+	jack_default_audio_sample_t *inFifo;	// see runThroughFifo()
+	jack_default_audio_sample_t *outFifo;
+	int fifoPos;			// -1 while not in use
 	int frameCount;
 	jack_nframes_t srate;
-	jack_nframes_t bufSize;
+	jack_nframes_t bufSize;	// frames rendered per callback, fixed when opened
+
+	bool runThroughFifo(JackAudioDevice *device, int nframes);
 
 	static int runProcess(jack_nframes_t nframes, void *object);
 	static int srateChanged(jack_nframes_t nframes, void *object);
@@ -56,6 +64,48 @@ JackAudioDevice::Impl::~Impl()
 	delete [] outPorts;
 	delete [] inBuf;
 	delete [] outBuf;
+	delete [] hostIn;
+	delete [] hostOut;
+	delete [] inFifo;
+	delete [] outFifo;
+}
+
+// For a JACK period that is not a multiple of bufSize: gather the input into
+// inFifo a slice at a time, and play out of outFifo what was rendered from the
+// slice before, so that the output is one slice late.  The FIFOs start out
+// silent each time we change over to them.
+
+bool JackAudioDevice::Impl::runThroughFifo(JackAudioDevice *device, int nframes)
+{
+	const int slice = bufSize;
+	if (fifoPos < 0) {
+		memset(outFifo, 0, numOutPorts * slice * sizeof(jack_default_audio_sample_t));
+		fifoPos = 0;
+	}
+	for (int i = 0; i < numInPorts; i++)
+		inBuf[i] = &inFifo[i * slice];
+	for (int i = 0; i < numOutPorts; i++)
+		outBuf[i] = &outFifo[i * slice];
+
+	bool keepGoing = true;
+	for (int done = 0; done < nframes; ) {
+		int frames = slice - fifoPos;
+		if (frames > nframes - done)
+			frames = nframes - done;
+		const size_t bytes = frames * sizeof(jack_default_audio_sample_t);
+		for (int i = 0; i < numInPorts; i++)
+			memcpy(&inBuf[i][fifoPos], &hostIn[i][done], bytes);
+		for (int i = 0; i < numOutPorts; i++)
+			memcpy(&hostOut[i][done], &outBuf[i][fifoPos], bytes);
+		fifoPos += frames;
+		done += frames;
+		if (fifoPos == slice) {
+			fifoPos = 0;
+			if (keepGoing)
+				keepGoing = device->runCallback();
+		}
+	}
+	return keepGoing;
 }
 
 int JackAudioDevice::Impl::runProcess(jack_nframes_t nframes, void *object)
@@ -67,8 +117,8 @@ int JackAudioDevice::Impl::runProcess(jack_nframes_t nframes, void *object)
 	JackAudioDevice::Impl *impl = device->_impl;
 	const int inchans = impl->numInPorts;
 	const int outchans = impl->numOutPorts;
-	jack_default_audio_sample_t **in = impl->inBuf;
-	jack_default_audio_sample_t **out = impl->outBuf;
+	jack_default_audio_sample_t **in = impl->hostIn;
+	jack_default_audio_sample_t **out = impl->hostOut;
 
 	// get non-interleaved buffer pointers from JACK
 	for (int i = 0; i < inchans; i++)
@@ -80,8 +130,24 @@ int JackAudioDevice::Impl::runProcess(jack_nframes_t nframes, void *object)
 		out[i] = (jack_default_audio_sample_t *)
 		                        jack_port_get_buffer(impl->outPorts[i], nframes);
 
-	// process sound, resulting in one call each to doGetFrames and doSendFrames
-	bool keepGoing = device->runCallback();
+	// Process sound, resulting in one call each to doGetFrames and
+	// doSendFrames per slice of bufSize frames.  The JACK period can change
+	// while we run (see bufSizeChanged); a multiple of bufSize is rendered in
+	// place, a slice after another, and anything else through the FIFOs.
+	const int slice = impl->bufSize;
+	bool keepGoing = true;
+	if (nframes % slice == 0) {
+		impl->fifoPos = -1;
+		for (int offset = 0; keepGoing && offset < (int) nframes; offset += slice) {
+			for (int i = 0; i < inchans; i++)
+				impl->inBuf[i] = in[i] + offset;
+			for (int i = 0; i < outchans; i++)
+				impl->outBuf[i] = out[i] + offset;
+			keepGoing = device->runCallback();
+		}
+	}
+	else
+		keepGoing = impl->runThroughFifo(device, nframes);
 	if (!keepGoing) {
 		PRINT0("runProcess: runCallback returned false; calling stopCallback\n");
 		device->stopCallback();
@@ -110,16 +176,15 @@ int JackAudioDevice::Impl::srateChanged(jack_nframes_t nframes, void *object)
 int JackAudioDevice::Impl::bufSizeChanged(jack_nframes_t nframes, void *object)
 {
 	PRINT0("JackAudioDevice::Impl::bufSizeChanged()\n");
+	// We keep rendering bufSize frames at a time; runProcess fits them to
+	// whatever period JACK now asks for.
 	JackAudioDevice *device = (JackAudioDevice *) object;
-	int status = 0;
-	if (device->isRunning()) {
-		if (nframes != device->_impl->bufSize) {
-			device->error("JACK buffer size changed; we can't cope with this.");
-			status = -1;
-			device->stopCallback();
-		}
+	if (device->isRunning() && nframes != device->_impl->bufSize
+			&& nframes % device->_impl->bufSize != 0) {
+		PRINT0("JACK buffer size now %d; output will be %d frames later\n",
+			   (int) nframes, (int) device->_impl->bufSize);
 	}
-	return status;
+	return 0;
 }
 
 // Called when JACK server shuts down.
@@ -214,6 +279,7 @@ int JackAudioDevice::doClose()
 	stopCallback();
 
 	_impl->frameCount = 0;
+	_impl->fifoPos = -1;
 
 	return 0;
 }
@@ -332,6 +398,8 @@ int JackAudioDevice::doSetQueueSize(int *pWriteSize, int *pCount)
 		const int numports = getFrameChannels();
 		_impl->inPorts = new jack_port_t * [numports];
 		_impl->inBuf = new jack_default_audio_sample_t * [numports];
+		_impl->hostIn = new jack_default_audio_sample_t * [numports];
+		_impl->inFifo = new jack_default_audio_sample_t [numports * _impl->bufSize];
 		char shortname[32];
 		for (int i = 0; i < numports; i++) {
 			snprintf(shortname, 31, "in_%d", i + 1);
@@ -349,6 +417,8 @@ int JackAudioDevice::doSetQueueSize(int *pWriteSize, int *pCount)
 		const int numports = getFrameChannels();
 		_impl->outPorts = new jack_port_t * [numports];
 		_impl->outBuf = new jack_default_audio_sample_t * [numports];
+		_impl->hostOut = new jack_default_audio_sample_t * [numports];
+		_impl->outFifo = new jack_default_audio_sample_t [numports * _impl->bufSize];
 		char shortname[32];
 		for (int i = 0; i < numports; i++) {
 			snprintf(shortname, 31, "out_%d", i + 1);
@@ -0,0 +1,579 @@
+// UDPAudioDevice.cpp
+
+#if defined (NETAUDIO)
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <errno.h>
+#include <unistd.h>
+#include <assert.h>
+#include <stdio.h>
+
+#include "UDPAudioDevice.h"
+#include "sndlibsupport.h"
+
+// This is a datagram alternative to NetAudioDevice, for sending RTcmix output
+// to one or more machines on a LAN.  There is no connection and no handshake:
+// every packet carries a small header describing its audio, so a listener can
+// join at any time, and the sender never waits for (or even knows about) its
+// listeners.  The sender paces itself with the system clock, because there is
+// no socket backpressure to do it, and never blocks in the network call: a
+// packet the kernel will not take right away is dropped.
+//
+// The listener keeps a jitter buffer indexed by each packet's frame position.
+// Packets arriving out of order are put in their place, packets arriving too
+// late are dropped, and lost packets leave silence.  A block is handed on once
+// packets reaching <latency> frames beyond its end have arrived.
+//
+// Descriptors are "udp:host[:port][,float][,latency=msec]".  If host is an
+// IPv4 multicast address, the sender sends to the group and the listener
+// joins it; otherwise the listener ignores host and binds to any address.
+// Audio goes over the network as big-endian 24-bit integers, or 32-bit floats
+// with ",float".  The listener accepts either.
+
+#define DEBUG 0
+
+#if DEBUG > 1
+#define PRINT0 if (1) printf
+#define PRINT1 if (1) printf
+#elif DEBUG > 0
+#define PRINT0 if (1) printf
+#define PRINT1 if (0) printf
+#else
+#define PRINT0 if (0) printf
+#define PRINT1 if (0) printf
+#endif
+
+static const int kDefaultSockNumber = 9999;
+static const int kDefaultLatencyMsec = 20;
+static const int kMulticastTTL = 1;				// stay on the LAN
+static const int kReceiveBufferBytes = 1 << 20;
+static const int kMaxPacketBytes = 1400;		// under a typical Ethernet MTU
+static const long kMaxLateBlocks = 4;			// before the sender resyncs its clock
+
+// Packet header, all fields in network byte order, packed by hand:
+//
+//	 0	magic
+//	 4	stream		chosen at random by the sender when it opens
+//	 8	sequence	one more for each packet
+//	12	frame		stream position of the first frame
+//	16	chans (16 bits), frames (16 bits)
+//	20	payload format (8 bits), 3 unused bytes
+
+static const uint32_t kPacketMagic = 0x52547564;	// 'RTud'
+static const int kHeaderBytes = 24;
+
+enum { kPayloadInt24 = 1, kPayloadFloat = 2 };
+
+// We hand our conversion routines normalized floats, which we convert to
+// and from the payload format ourselves.
+
+static const int kUDPAudioSampfmt = NATIVE_FLOAT_FMT | MUS_INTERLEAVED | MUS_NORMALIZED;
+
+struct UDPAudioDevice::Impl {
+	Impl() : hostname(NULL), sockno(kDefaultSockNumber), payload(kPayloadInt24),
+			 latencyMsec(kDefaultLatencyMsec), multicast(false), sockdesc(-1),
+			 framesPerWrite(0), framesPerPacket(0), packet(NULL),
+			 stream(0), sequence(0), framePos(0), startTime(0.0), framesPaced(0),
+			 dropped(0), ring(NULL), ringFrames(0), latencyFrames(0),
+			 synced(false), currentStream(0), readPos(0), highest(0),
+			 expectedSeq(0), lost(0), late(0), badPackets(0) {}
+	~Impl() { delete [] packet; delete [] ring; }
+	char				*hostname;
+	int					sockno;
+	int					payload;			// kPayloadInt24 or kPayloadFloat
+	int					latencyMsec;
+	bool				multicast;
+	struct sockaddr_in	sss;
+	int					sockdesc;
+	int					framesPerWrite;		// set via doSetQueueSize()
+	int					framesPerPacket;
+	unsigned char		*packet;
+	// Sender state.
+	uint32_t			stream;
+	uint32_t			sequence;
+	uint32_t			framePos;
+	double				startTime;			// clock time of frame 0, secs.
+	long				framesPaced;
+	long				dropped;			// packets the kernel would not take
+	// Listener state.  The ring holds interleaved frames; ringFrames is a
+	// power of two, so 32-bit frame positions wrap around it cleanly.
+	float				*ring;
+	uint32_t			ringFrames;
+	int					latencyFrames;
+	bool				synced;
+	uint32_t			currentStream;
+	uint32_t			readPos;			// next frame to hand on
+	uint32_t			highest;			// end of the latest frames received
+	uint32_t			expectedSeq;
+	long				lost;				// packets never seen
+	long				late;				// packets that came after their frames were played
+	long				badPackets;
+};
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 0.000001;
+}
+
+static inline void put32(unsigned char *p, uint32_t val)
+{
+	p[0] = val >> 24; p[1] = val >> 16; p[2] = val >> 8; p[3] = val;
+}
+
+static inline uint32_t get32(const unsigned char *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline int payloadSampleBytes(int payload)
+{
+	return (payload == kPayloadFloat) ? 4 : 3;
+}
+
+UDPAudioDevice::UDPAudioDevice(const char *path) : _impl(new Impl)
+{
+	// Options follow the address, separated by commas.
+	const char *options = strchr(path, ',');
+	const int addrLen = options ? options - path : strlen(path);
+	const char *colon = (const char *) memchr(path, ':', addrLen);
+	const int hostLen = colon ? colon - path : addrLen;
+	_impl->hostname = new char[hostLen + 1];
+	strncpy(_impl->hostname, path, hostLen);
+	_impl->hostname[hostLen] = '\0';
+	if (colon)
+		_impl->sockno = atoi(colon + 1);
+	while (options != NULL) {
+		++options;
+		if (strncmp(options, "float", 5) == 0)
+			_impl->payload = kPayloadFloat;
+		else if (strncmp(options, "latency=", 8) == 0)
+			_impl->latencyMsec = atoi(options + 8);
+		else
+			fprintf(stderr, "UDPAudioDevice: ignoring unknown option '%s'\n", options);
+		options = strchr(options, ',');
+	}
+	in_addr_t addr = inet_addr(_impl->hostname);
+	_impl->multicast = (addr != INADDR_NONE) && IN_MULTICAST(ntohl(addr));
+}
+
+UDPAudioDevice::~UDPAudioDevice()
+{
+	delete [] _impl->hostname;
+	delete _impl;
+}
+
+void
+UDPAudioDevice::run()
+{
+	PRINT1("UDPAudioDevice::run: top of loop\n");
+	while (!stopping()) {
+		if (isPlaying()) {
+			waitForSendTime();
+			if (stopping())
+				break;
+		}
+		if (runCallback() != true) {
+			break;
+		}
+	}
+	PRINT1("UDPAudioDevice::run: after loop\n");
+	// See NetAudioDevice::run().
+	if (!stopping()) {
+		setState(Configured);
+		if (!closing()) {
+			close();
+		}
+	}
+	PRINT1("UDPAudioDevice::run: calling stop callback\n");
+	stopCallback();
+}
+
+int
+UDPAudioDevice::doOpen(int mode)
+{
+	int len = sizeof(_impl->sss);
+
+	PRINT0("UDPAudioDevice::doOpen()\n");
+
+	bzero(&_impl->sss, len);
+
+	if ((_impl->sockdesc = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+		return error("Network socket call failed: ", strerror(errno));
+	}
+	_impl->sss.sin_family = AF_INET;
+	_impl->sss.sin_port = htons(_impl->sockno);
+
+	switch (mode & DirectionMask) {
+	case Playback:
+	{
+		struct hostent *hp;
+		if ((hp = gethostbyname(_impl->hostname)) == NULL)
+			return error("UDPAudioDevice: gethostbyname failed: ",
+						 strerror(errno));
+		bcopy(hp->h_addr, &(_impl->sss.sin_addr.s_addr), hp->h_length);
+		if (_impl->multicast) {
+			unsigned char ttl = kMulticastTTL;
+			if (setsockopt(_impl->sockdesc, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+				return error("Failed to set multicast TTL: ", strerror(errno));
+		}
+		_impl->stream = (uint32_t) (now() * 1000000.0) ^ ((uint32_t) getpid() << 16);
+		break;
+	}
+	case Record:
+	{
+		int on = 1;
+		setsockopt(_impl->sockdesc, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		int rcvbuf = kReceiveBufferBytes;
+		setsockopt(_impl->sockdesc, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		_impl->sss.sin_addr.s_addr = INADDR_ANY;
+		if (bind(_impl->sockdesc, (struct sockaddr *)&_impl->sss, len) < 0) {
+			return error("Network bind failed: ", strerror(errno));
+		}
+		if (_impl->multicast) {
+			struct ip_mreq mreq;
+			mreq.imr_multiaddr.s_addr = inet_addr(_impl->hostname);
+			mreq.imr_interface.s_addr = INADDR_ANY;
+			if (setsockopt(_impl->sockdesc, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+				return error("Failed to join multicast group: ", strerror(errno));
+		}
+		break;
+	}
+	default:
+		return error("UDPAudioDevice: Illegal open mode.");
+	}
+	fcntl(_impl->sockdesc, F_SETFL, fcntl(_impl->sockdesc, F_GETFL, 0) | O_NONBLOCK);
+	setDevice(_impl->sockdesc);
+	return 0;
+}
+
+int
+UDPAudioDevice::doClose()
+{
+	PRINT0("UDPAudioDevice::doClose()\n");
+	closing(true);	// This allows waitForPacket() to exit.
+	if (_impl->dropped > 0)
+		fprintf(stderr, "UDPAudioDevice: %ld packets dropped for lack of send buffer space\n",
+				_impl->dropped);
+	if (_impl->lost > 0 || _impl->late > 0)
+		fprintf(stderr, "UDPAudioDevice: %ld packets lost, %ld arrived too late\n",
+				_impl->lost, _impl->late);
+	int status = 0;
+	if (_impl->sockdesc > 0) {
+		if ((status = ::close(_impl->sockdesc)) == 0) {
+			_impl->sockdesc = -1;
+			setDevice(-1);
+		}
+		else
+			error("Network socket close failed: ", strerror(errno));
+	}
+	return status;
+}
+
+int
+UDPAudioDevice::doStart()
+{
+	_impl->startTime = now();
+	_impl->framesPaced = 0;
+	return ThreadedAudioDevice::startThread();
+}
+
+// This does nothing under RTcmix, so can be left as-is.
+
+int
+UDPAudioDevice::doPause(bool)
+{
+	return error("Not implemented");
+}
+
+int
+UDPAudioDevice::doSetFormat(int sampfmt, int chans, double srate)
+{
+	setDeviceParams(kUDPAudioSampfmt, chans, srate);
+	return 0;
+}
+
+int
+UDPAudioDevice::doSetQueueSize(int *pWriteSize, int *pCount)
+{
+	const int chans = getDeviceChannels();
+	_impl->framesPerWrite = *pWriteSize;
+	_impl->framesPerPacket = (kMaxPacketBytes - kHeaderBytes) / (chans * payloadSampleBytes(kPayloadFloat));
+	if (_impl->framesPerPacket < 1)
+		return error("UDPAudioDevice: too many channels for one packet");
+	if (_impl->framesPerPacket > _impl->framesPerWrite)
+		_impl->framesPerPacket = _impl->framesPerWrite;
+	delete [] _impl->packet;
+	_impl->packet = new unsigned char[kMaxPacketBytes];
+	if (isRecording()) {
+		_impl->latencyFrames = (int) (_impl->latencyMsec * getSamplingRate() / 1000.0);
+		const long wanted = 8L * (_impl->framesPerWrite + _impl->latencyFrames);
+		uint32_t frames = 1024;
+		while (frames < wanted)
+			frames <<= 1;
+		delete [] _impl->ring;
+		_impl->ring = new float[frames * chans];
+		_impl->ringFrames = frames;
+		memset(_impl->ring, 0, frames * chans * sizeof(float));
+		_impl->synced = false;
+	}
+	return 0;
+}
+
+// The sender's clock.  Wait until the next block is due, so we send no
+// faster than the audio plays.
+
+void
+UDPAudioDevice::waitForSendTime()
+{
+	const double sr = getSamplingRate();
+	double due = _impl->startTime + _impl->framesPaced / sr;
+	double wait = due - now();
+	if (wait < -kMaxLateBlocks * _impl->framesPerWrite / sr) {
+		// Fell far behind (machine stalled?); start counting from now.
+		PRINT0("UDPAudioDevice::waitForSendTime: resetting clock\n");
+		_impl->startTime = now() - _impl->framesPaced / sr;
+		return;
+	}
+	while (wait > 0.0 && !stopping()) {
+		::usleep((useconds_t) ((wait < 0.01 ? wait : 0.01) * 1000000.0));
+		wait = due - now();
+	}
+}
+
+int
+UDPAudioDevice::doSendFrames(void *frameBuffer, int frameCount)
+{
+	Impl *impl = _impl;
+	const int chans = getDeviceChannels();
+	const bool floats = (impl->payload == kPayloadFloat);
+	const float *in = (const float *) frameBuffer;
+	for (int done = 0; done < frameCount; ) {
+		int frames = frameCount - done;
+		if (frames > impl->framesPerPacket)
+			frames = impl->framesPerPacket;
+		unsigned char *p = impl->packet;
+		put32(p, kPacketMagic);
+		put32(p + 4, impl->stream);
+		put32(p + 8, impl->sequence);
+		put32(p + 12, impl->framePos);
+		put32(p + 16, ((uint32_t) chans << 16) | (uint32_t) frames);
+		put32(p + 20, (uint32_t) impl->payload << 24);
+		p += kHeaderBytes;
+		const int samps = frames * chans;
+		if (floats) {
+			for (int n = 0; n < samps; ++n, p += 4) {
+				union { float f; uint32_t l; } u;
+				u.f = in[n];
+				put32(p, u.l);
+			}
+		}
+		else {
+			for (int n = 0; n < samps; ++n, p += 3) {
+				float samp = in[n];
+				if (samp > 1.0f) samp = 1.0f;
+				else if (samp < -1.0f) samp = -1.0f;
+				const int32_t val = (int32_t) lrintf(samp * 8388607.0f);
+				p[0] = val >> 16; p[1] = val >> 8; p[2] = val;
+			}
+		}
+		const int bytes = p - impl->packet;
+		if (sendto(impl->sockdesc, impl->packet, bytes, MSG_DONTWAIT,
+				   (struct sockaddr *) &impl->sss, sizeof(impl->sss)) < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS
+					|| errno == ECONNREFUSED)
+				++impl->dropped;	// No listener, or no room: the stream goes on.
+			else
+				return error("Network socket send failed: ", strerror(errno));
+		}
+		++impl->sequence;
+		impl->framePos += frames;
+		in += samps;
+		done += frames;
+	}
+	impl->framesPaced += frameCount;
+	incrementFrameCount(frameCount);
+	return frameCount;
+}
+
+int
+UDPAudioDevice::doGetFrames(void *frameBuffer, int frameCount)
+{
+	Impl *impl = _impl;
+	const int chans = getDeviceChannels();
+	for (;;) {
+		receivePackets();
+		if (impl->synced && (int32_t) (impl->highest - impl->readPos) >= frameCount + impl->latencyFrames)
+			break;
+		int ret = waitForPacket(100);
+		if (ret > 0) {
+			PRINT0("UDPAudioDevice::doGetFrames: stopping\n");
+			return 0;
+		}
+		else if (ret < 0)
+			return ret;
+	}
+	// Hand on the block and clear its place in the ring, so that frames which
+	// never arrive the next time around are heard as silence.
+	float *out = (float *) frameBuffer;
+	const uint32_t start = impl->readPos & (impl->ringFrames - 1);
+	uint32_t first = impl->ringFrames - start;
+	if (first > (uint32_t) frameCount)
+		first = frameCount;
+	memcpy(out, &impl->ring[start * chans], first * chans * sizeof(float));
+	memset(&impl->ring[start * chans], 0, first * chans * sizeof(float));
+	if (first < (uint32_t) frameCount) {
+		const uint32_t rest = frameCount - first;
+		memcpy(out + first * chans, impl->ring, rest * chans * sizeof(float));
+		memset(impl->ring, 0, rest * chans * sizeof(float));
+	}
+	impl->readPos += frameCount;
+	incrementFrameCount(frameCount);
+	return frameCount;
+}
+
+// Returns 0 when a packet is waiting, 1 if we are stopping or closing.
+
+int UDPAudioDevice::waitForPacket(unsigned int wTime)
+{
+	fd_set rfdset;
+	struct timeval timeout;
+	const int nfds = _impl->sockdesc + 1;
+	int ret;
+	FD_ZERO(&rfdset);
+	do {
+		if (closing() || stopping())
+			return 1;
+		FD_SET(_impl->sockdesc, &rfdset);
+		timeout.tv_sec = unsigned(wTime / 1000);
+		timeout.tv_usec = 1000 * (unsigned(wTime) - (timeout.tv_sec * 1000));
+	} while ((ret = select(nfds, &rfdset, NULL, NULL, &timeout)) == 0
+			 || (ret < 0 && errno == EINTR));
+	if (ret < 0)
+		return error("Error while waiting for network audio: ", strerror(errno));
+	return 0;
+}
+
+void UDPAudioDevice::receivePackets()
+{
+	unsigned char packet[kMaxPacketBytes];
+	int bytes;
+	while ((bytes = ::recv(_impl->sockdesc, packet, sizeof(packet), 0)) > 0)
+		storePacket(packet, bytes);
+}
+
+void UDPAudioDevice::resync(unsigned stream, unsigned frame)
+{
+	PRINT0("UDPAudioDevice::resync: stream 0x%x at frame %u\n", stream, frame);
+	Impl *impl = _impl;
+	impl->currentStream = stream;
+	impl->readPos = impl->highest = frame;
+	memset(impl->ring, 0, impl->ringFrames * getDeviceChannels() * sizeof(float));
+	impl->synced = true;
+}
+
+void UDPAudioDevice::storePacket(const unsigned char *packet, int bytes)
+{
+	Impl *impl = _impl;
+	const int chans = getDeviceChannels();
+	if (bytes < kHeaderBytes || get32(packet) != kPacketMagic) {
+		++impl->badPackets;
+		return;
+	}
+	const uint32_t stream = get32(packet + 4);
+	const uint32_t sequence = get32(packet + 8);
+	const uint32_t frame = get32(packet + 12);
+	const int packetChans = get32(packet + 16) >> 16;
+	const int frames = get32(packet + 16) & 0xffff;
+	const int payload = packet[20];
+	if ((payload != kPayloadInt24 && payload != kPayloadFloat)
+		|| bytes != kHeaderBytes + frames * packetChans * payloadSampleBytes(payload))
+	{
+		++impl->badPackets;
+		return;
+	}
+	if (packetChans != chans) {
+		if (impl->badPackets++ == 0)
+			fprintf(stderr, "UDPAudioDevice: sender and receiver channel counts must match\n");
+		return;
+	}
+	// A new stream (the sender restarted), or one we have lost our place in.
+	int32_t offset = (int32_t) (frame - impl->readPos);
+	if (!impl->synced || stream != impl->currentStream
+		|| offset + frames > (int32_t) impl->ringFrames)
+	{
+		resync(stream, frame);
+		impl->expectedSeq = sequence;
+		offset = 0;
+	}
+	const int32_t gap = (int32_t) (sequence - impl->expectedSeq);
+	if (gap >= 0) {
+		impl->lost += gap;
+		impl->expectedSeq = sequence + 1;
+	}
+	else if (impl->lost > 0)
+		--impl->lost;		// it was only out of order
+	if (offset + frames <= 0) {
+		++impl->late;
+		return;
+	}
+	const unsigned char *p = packet + kHeaderBytes;
+	const int sampBytes = payloadSampleBytes(payload);
+	for (int f = 0; f < frames; ++f) {
+		if (offset + f < 0) {
+			p += chans * sampBytes;
+			continue;
+		}
+		const uint32_t index = (impl->readPos + offset + f) & (impl->ringFrames - 1);
+		float *dest = &impl->ring[index * chans];
+		for (int ch = 0; ch < chans; ++ch, p += sampBytes) {
+			if (payload == kPayloadFloat) {
+				union { float f; uint32_t l; } u;
+				u.l = get32(p);
+				dest[ch] = u.f;
+			}
+			else {
+				int32_t val = ((int32_t) p[0] << 16) | ((int32_t) p[1] << 8) | p[2];
+				if (val & 0x800000)
+					val -= 0x1000000;
+				dest[ch] = val * (1.0f / 8388607.0f);
+			}
+		}
+	}
+	const uint32_t end = frame + frames;
+	if ((int32_t) (end - impl->highest) > 0)
+		impl->highest = end;
+}
+
+bool UDPAudioDevice::recognize(const char *desc)
+{
+	return (desc != NULL) && strncmp(desc, "udp:", 4) == 0;
+}
+
+AudioDevice *UDPAudioDevice::create(const char *inputDesc, const char *outputDesc, int mode)
+{
+	AudioDevice *theDevice = NULL;
+	// We dont support full duplex for this class.
+	if ((mode & AudioDevice::DirectionMask) != RecordPlayback) {
+		const char *desc = inputDesc ? inputDesc : outputDesc;
+		// Strip off the "udp:" from the beginning of the descriptor.
+		theDevice  = new UDPAudioDevice(&desc[4]);
+	}
+	return theDevice;
+}
+
+#endif	// NETAUDIO
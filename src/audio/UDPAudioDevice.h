@@ -0,0 +1,45 @@
+// UDPAudioDevice.h
+//
+#ifndef _UDPAUDIODEVICE_H_
+#define _UDPAUDIODEVICE_H_
+
+#if defined (NETAUDIO)
+
+#include "ThreadedAudioDevice.h"
+
+class UDPAudioDevice : public ThreadedAudioDevice {
+public:
+	UDPAudioDevice(const char *path);
+	virtual ~UDPAudioDevice();
+	// Recognizer
+	static bool			recognize(const char *);
+	// Creator
+	static AudioDevice*	create(const char *, const char *, int);
+
+protected:
+	// ThreadedAudioDevice reimplementation
+	virtual void run();
+	// AudioDeviceImpl reimplementation
+	virtual int doOpen(int mode);
+	virtual int doClose();
+	virtual int doStart();
+	virtual int doPause(bool);
+	virtual int doSetFormat(int sampfmt, int chans, double srate);
+	virtual int doSetQueueSize(int *pWriteSize, int *pCount);
+	virtual int	doGetFrames(void *frameBuffer, int frameCount);
+	virtual int	doSendFrames(void *frameBuffer, int frameCount);
+
+protected:
+	int			waitForPacket(unsigned int wTime);
+	void		receivePackets();
+	void		storePacket(const unsigned char *packet, int bytes);
+	void		resync(unsigned stream, unsigned frame);
+	void		waitForSendTime();
+private:
+	struct Impl;
+	Impl			*_impl;
+};
+
+#endif	// NETAUDIO
+
+#endif	// _UDPAUDIODEVICE_H_
@@ -20,6 +20,7 @@
 #endif
 #ifdef NETAUDIO
 #include "NetAudioDevice.h"
+#include "UDPAudioDevice.h"
 #endif
 #ifdef EMBEDDEDAUDIO
 #include "EmbeddedAudioDevice.h"
@@ -35,6 +36,10 @@
 #include "JackAudioDevice.h"
 #endif
 
+#ifndef EMBEDDEDAUDIO
+#include "BenchAudioDevice.h"
+#endif
+
 #include "AudioIODevice.h"
 
 typedef AudioDevice * (*CreatorFun)(const char *, const char *, int mode);
@@ -45,8 +50,12 @@ struct AudioDevEntry {
 };
 
 static const AudioDevEntry s_AudioDevEntries[] = {
+#ifndef EMBEDDEDAUDIO	// first, since some of the others match anything
+	{ &BenchAudioDevice::recognize, &BenchAudioDevice::create },
+#endif
 #ifdef NETAUDIO
 	{ &NetAudioDevice::recognize, &NetAudioDevice::create },
+	{ &UDPAudioDevice::recognize, &UDPAudioDevice::create },
 #endif
 #ifdef JACK // before APPLEAUDIO, since AppleAudioDevice::recognize matches anything
 	{ &JackAudioDevice::recognize, &JackAudioDevice::create },
@@ -87,6 +87,27 @@ create_audio_devices(int record, int play, int chans, float *ioSrate, int *buffe
 		return NULL;
 	}
 
+	// Additional output devices (outdevice2, outdevice3) play the same
+	// channels as the first one.
+	AudioOutputGroupDevice *groupDevice = NULL;
+	const char *outDeviceName2 = get_audio_outdevice_name(1);
+	const char *outDeviceName3 = get_audio_outdevice_name(2);
+	if (outDeviceName2 != NULL && record) {
+		rtcmix_warn("rtsetparams", "Additional output devices are ignored when recording.");
+	}
+	else if (outDeviceName2 != NULL) {
+		AudioDevice *outDevice2 = createAudioDevice(NULL, outDeviceName2, false, true);
+		AudioDevice *outDevice3 = (outDeviceName3 != NULL) ?
+				createAudioDevice(NULL, outDeviceName3, false, true) : NULL;
+		if (outDevice2 == NULL || (outDeviceName3 != NULL && outDevice3 == NULL)) {
+			die("rtsetparams", "Failed to create additional output audio device.");
+			delete outDevice2;
+			delete device;
+			return NULL;
+		}
+		device = groupDevice = new AudioOutputGroupDevice(device, outDevice2, outDevice3);
+	}
+
 	// We hand the device noninterleaved, full-range floating point buffers.
 	int audioFormat = NATIVE_FLOAT_FMT | MUS_NON_INTERLEAVED;
 	device->setFrameFormat(audioFormat, chans);
@@ -129,6 +150,13 @@ create_audio_devices(int record, int play, int chans, float *ioSrate, int *buffe
 					*buffersize, newSize);
 			*buffersize = newSize;
 		}
+		const int fifoBuffers = RTOption::outputFifoBuffers();
+		if (groupDevice != NULL && fifoBuffers > 0
+				&& groupDevice->setAsynchronous(*buffersize, fifoBuffers) < 0) {
+			die("rtsetparams", "Failed to set up output device queues.");
+			delete device;
+			return NULL;
+		}
 	}
 	else
 	{
@@ -216,6 +244,13 @@ create_audio_file_device(AudioDevice *inDevice,
 		return NULL;
 	}
 
+	ret = fileDevice->setWriteBuffer(RTOption::fileWriteFrames(), RTOption::batchFileWrite());
+	if (ret == -1) {
+		rterror("rtoutput", "%s", fileDevice->getLastError());
+		delete fileDevice;
+		return NULL;
+	}
+
 	if (!playing && !recording) {	// To file only.
 		// If we are only writing to disk, we only have a single output device. 
 		assert(inDevice == NULL);	// We should not have been passed anything.
@@ -261,3 +296,79 @@ create_audio_file_device(AudioDevice *inDevice,
 	return device;
 }
 
+
+// A file device for one stem written by rtstemoutput().  It is never part of
+// the main device chain: the scheduler hands it the stem's buses after each
+// buffer, and it always queues its writes to a thread of its own, so that
+// many stems don't add their disk time to the render.
+
+#define STEM_WRITE_BUFFERS	16		// queue size, in buffers, if not set
+
+AudioDevice *
+create_stem_file_device(const char *outfilename,
+						int header_type,
+						int sample_format,
+						int chans,
+						float srate,
+						int normalize_output_floats)
+{
+	assert(rtsetparams_was_called());
+
+	AudioFileDevice *fileDevice = NULL;
+
+	try {
+		fileDevice = new AudioFileDevice(outfilename, header_type);
+	}
+	catch(...) {
+		rterror("rtstemoutput", "Failed to create audio file device");
+		return NULL;
+	}
+
+	const bool fileIsRawFloats = IS_FLOAT_FORMAT(sample_format) && !normalize_output_floats;
+
+	int openMode = AudioFileDevice::Playback | AudioDevice::Passive;
+	if (!fileIsRawFloats)
+		openMode |= AudioDevice::CheckPeaks;
+	if (RTOption::reportClipping())
+		openMode |= AudioDevice::ReportClipping;
+
+	// Buses are noninterleaved floats, and are not clipped.
+	fileDevice->setFrameFormat(NATIVE_FLOAT_FMT | MUS_NON_INTERLEAVED, chans);
+
+	sample_format |= MUS_INTERLEAVED;
+	if (normalize_output_floats)
+		sample_format |= MUS_NORMALIZED;
+	if (fileDevice->open(openMode, sample_format, chans, srate) == -1) {
+		rterror("rtstemoutput", "Can't create output for \"%s\": %s",
+				 outfilename, fileDevice->getLastError());
+		delete fileDevice;
+		return NULL;
+	}
+	int queueSize = RTcmix::bufsamps();
+	int count = 1;
+	if (fileDevice->setQueueSize(&queueSize, &count) == -1) {
+		rterror("rtstemoutput", "Failed to set queue size on file device:  %s",
+				 fileDevice->getLastError());
+		delete fileDevice;
+		return NULL;
+	}
+	int writeFrames = RTOption::fileWriteFrames();
+	if (writeFrames <= 0)
+		writeFrames = RTcmix::bufsamps() * STEM_WRITE_BUFFERS;
+	if (fileDevice->setWriteBuffer(writeFrames, RTOption::batchFileWrite()) == -1) {
+		rterror("rtstemoutput", "%s", fileDevice->getLastError());
+		delete fileDevice;
+		return NULL;
+	}
+
+	if (RTOption::print()) {
+		 printf("Stem file set for writing:\n");
+		 printf("      name:  %s\n", outfilename);
+		 printf("      type:  %s\n", mus_header_type_name(header_type));
+		 printf("    format:  %s\n", mus_data_format_name(MUS_GET_FORMAT(sample_format)));
+		 printf("     srate:  %g\n", srate);
+		 printf("     chans:  %d\n", chans);
+	}
+
+	return fileDevice;
+}
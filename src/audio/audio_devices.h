@@ -22,6 +22,14 @@ create_audio_file_device(AudioDevice *inDevice,
 						 int normalize_output_floats,
 						 int check_peaks);
 
+AudioDevice *
+create_stem_file_device(const char *outfilename,
+						int header_type,
+						int sample_format,
+						int chans,
+						float srate,
+						int normalize_output_floats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -56,6 +57,8 @@ WARNING: Not enough room in header for peak stats and comment.\n"
 
 #undef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
+#undef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
 
 static int open_rd_or_rdwr(const char *, int);
 static int format_raw_comment(SFComment *, int, char **);
@@ -1054,12 +1057,217 @@ sfcomment_peakstats_current(const SFComment *sfc, const int fd)
 
    The ability to copy input to output files is probably only useful for
    the sndpeak program.
+
+   When not copying, the window is mapped into memory rather than read, and
+   the stats for it are remembered, so that asking again about the same
+   window of an unchanged file (as a score normalizing several notes to
+   one input might) costs nothing.
 */
 
 #define BUF_FRAMES  (1024 * 16)
-#define ABS(x) ((x) < 0 ? -(x) : (x))
-#define NORMFACTOR  1.0 / 32768.0
-#define DENORMFACTOR 32768.0
+#define SCAN_FRAMES 1024        /* frames converted to float at once */
+
+/* Four-lane float vectors for scan_block(), where we have SSE2. */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define FINDPEAK_SIMD 1
+
+typedef __m128 vec4;
+typedef __m128d vec2d;
+
+static inline vec4 vzero(void) { return _mm_setzero_ps(); }
+static inline vec4 vload(const float *p) { return _mm_loadu_ps(p); }
+static inline vec4 vabs(vec4 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+static inline vec4 vmax(vec4 a, vec4 b) { return _mm_max_ps(a, b); }
+static inline float vhmax(vec4 v) {
+   float f[4];
+   _mm_storeu_ps(f, v);
+   return MAX(MAX(f[0], f[1]), MAX(f[2], f[3]));
+}
+static inline vec2d vzero2d(void) { return _mm_setzero_pd(); }
+static inline vec2d vlo2d(vec4 v) { return _mm_cvtps_pd(v); }
+static inline vec2d vhi2d(vec4 v) { return _mm_cvtps_pd(_mm_movehl_ps(v, v)); }
+static inline vec2d vadd2d(vec2d a, vec2d b) { return _mm_add_pd(a, b); }
+static inline vec2d vmul2d(vec2d a, vec2d b) { return _mm_mul_pd(a, b); }
+static inline double vhsum2d(vec2d v) {
+   double d[2];
+   _mm_storeu_pd(d, v);
+   return d[0] + d[1];
+}
+#endif
+
+typedef struct {
+   float   peak[MAXCHANS];
+   long    peakloc[MAXCHANS];
+   double  ampsum[MAXCHANS];     /* sums of |x|, x and x * x */
+   double  dcsum[MAXCHANS];
+   double  sqsum[MAXCHANS];
+} PeakSums;
+
+
+/* Returns the peak of the <n> samples in <x>, and adds their absolute
+   values, values and squares to <amp>, <dc> and <sq>.
+*/
+static float
+scan_block(const float *x, int n, double *amp, double *dc, double *sq)
+{
+   int i = 0;
+   float max = 0.0;
+#ifdef FINDPEAK_SIMD
+   vec4 vpeak = vzero();
+   vec2d a0 = vzero2d(), a1 = vzero2d(), d0 = vzero2d(), d1 = vzero2d();
+   vec2d s0 = vzero2d(), s1 = vzero2d();
+
+   for ( ; i + 4 <= n; i += 4) {
+      const vec4 v = vload(&x[i]);
+      const vec4 av = vabs(v);
+      const vec2d lo = vlo2d(v), hi = vhi2d(v);
+      vpeak = vmax(vpeak, av);
+      a0 = vadd2d(a0, vlo2d(av));
+      a1 = vadd2d(a1, vhi2d(av));
+      d0 = vadd2d(d0, lo);
+      d1 = vadd2d(d1, hi);
+      s0 = vadd2d(s0, vmul2d(lo, lo));
+      s1 = vadd2d(s1, vmul2d(hi, hi));
+   }
+   if (i > 0) {
+      max = vhmax(vpeak);
+      *amp += vhsum2d(vadd2d(a0, a1));
+      *dc += vhsum2d(vadd2d(d0, d1));
+      *sq += vhsum2d(vadd2d(s0, s1));
+   }
+#endif
+   for ( ; i < n; i++) {
+      const double samp = x[i];
+      const float absamp = fabsf(x[i]);
+      if (absamp > max)
+         max = absamp;
+      *amp += absamp;
+      *dc += samp;
+      *sq += samp * samp;
+   }
+   return max;
+}
+
+
+/* Adds the stats of <nframes> interleaved frames at <bufp> to <sums>.
+   <firstframe> is the location of the first of them in the file, and
+   <chanbuf> has room for SCAN_FRAMES floats per channel.
+*/
+static void
+scan_frames(const unsigned char *bufp, long nframes, long firstframe,
+            int informat, int nchans, float *chanbuf, PeakSums *sums)
+{
+   const int bytespersamp = mus_data_format_to_bytes_per_sample(informat);
+   const int isfloat = IS_FLOAT_FORMAT(informat);
+   long frame;
+   int i, n;
+#if MUS_LITTLE_ENDIAN
+   const int byteswap = IS_BIG_ENDIAN_FORMAT(informat);
+#else
+   const int byteswap = IS_LITTLE_ENDIAN_FORMAT(informat);
+#endif
+
+   for (frame = 0; frame < nframes; frame += SCAN_FRAMES) {
+      const int frames = MIN(SCAN_FRAMES, nframes - frame);
+
+      /* convert to float, one channel after another in <chanbuf> */
+      if (isfloat) {
+         for (i = 0; i < frames; i++) {
+            for (n = 0; n < nchans; n++) {
+               float fsamp;
+               memcpy(&fsamp, bufp, sizeof(float));
+               if (byteswap)
+                  byte_reverse4(&fsamp);
+               chanbuf[n * SCAN_FRAMES + i] = fsamp;
+               bufp += sizeof(float);
+            }
+         }
+      }
+      else if (bytespersamp == 3) {
+         const float scalefactor = 1.0 / (float) (1 << 8);
+         const int little = (informat == MUS_L24INT);
+         for (i = 0; i < frames; i++) {
+            for (n = 0; n < nchans; n++) {
+               int samp;
+               if (little)
+                  samp = (int) (((bufp[2] << 24)
+                                + (bufp[1] << 16)
+                                + (bufp[0] << 8)) >> 8);
+               else
+                  samp = (int) (((bufp[0] << 24)
+                                + (bufp[1] << 16)
+                                + (bufp[2] << 8)) >> 8);
+               chanbuf[n * SCAN_FRAMES + i] = (float) samp * scalefactor;
+               bufp += 3;
+            }
+         }
+      }
+      else {                              /* short ints */
+         for (i = 0; i < frames; i++) {
+            for (n = 0; n < nchans; n++) {
+               short samp;
+               memcpy(&samp, bufp, sizeof(short));
+               if (byteswap)
+                  byte_reverse2(&samp);
+               chanbuf[n * SCAN_FRAMES + i] = samp;
+               bufp += sizeof(short);
+            }
+         }
+      }
+
+      for (n = 0; n < nchans; n++) {
+         const float *x = &chanbuf[n * SCAN_FRAMES];
+         const float max = scan_block(x, frames, &sums->ampsum[n],
+                                      &sums->dcsum[n], &sums->sqsum[n]);
+         if (max > sums->peak[n]) {       /* find its first frame */
+            for (i = 0; fabsf(x[i]) != max; i++)
+               ;
+            sums->peak[n] = max;
+            sums->peakloc[n] = firstframe + frame + i;
+         }
+      }
+   }
+}
+
+
+/* The stats of the last few windows scanned without copying, with what
+   is needed to tell whether the file has changed since.
+*/
+#define PEAK_CACHE_SIZE 8
+
+typedef struct {
+   dev_t   dev;
+   ino_t   ino;
+   off_t   size;
+   time_t  mtime;
+   int     dataloc, format, nchans;
+   long    startframe, nframes;
+   float   peak[MAXCHANS];
+   long    peakloc[MAXCHANS];
+   double  ampavg[MAXCHANS], dcavg[MAXCHANS], rms[MAXCHANS];
+} PeakCacheEntry;
+
+static PeakCacheEntry peak_cache[PEAK_CACHE_SIZE];
+static int peak_cache_count = 0, peak_cache_next = 0;
+
+static PeakCacheEntry *
+find_cached_peak(const struct stat *st, int dataloc, int format, int nchans,
+                 long startframe, long nframes)
+{
+   int i;
+   for (i = 0; i < peak_cache_count; i++) {
+      PeakCacheEntry *e = &peak_cache[i];
+      if (e->dev == st->st_dev && e->ino == st->st_ino
+            && e->size == st->st_size && e->mtime == st->st_mtime
+            && e->dataloc == dataloc && e->format == format
+            && e->nchans == nchans && e->startframe == startframe
+            && e->nframes == nframes)
+         return e;
+   }
+   return NULL;
+}
+
 
 int
 sndlib_findpeak(int    infd,
@@ -1076,10 +1284,14 @@ sndlib_findpeak(int    infd,
                 double dcavg[],
                 double rms[])
 {
-   int   i, n, bytespersamp, isfloat, byteswap;
-   long  frames, bufframes, startbyte, bufbytes, bufcount = 0;
+   int   n, bytespersamp, isfloat, framebytes, mapped = 0;
+   long  frames, bufframes, startbyte, bufbytes;
    off_t oldloc;
-   char  *buffer;
+   char  *buffer = NULL;
+   float *chanbuf;
+   PeakSums sums;
+   struct stat statbuf;
+   PeakCacheEntry *cached;
 
    assert(infd >= 0 && indataloc >= 0);
    assert(!INVALID_DATA_FORMAT(informat));
@@ -1092,161 +1304,143 @@ sndlib_findpeak(int    infd,
 
    assert(isfloat || bytespersamp == 2 || bytespersamp == 3);
 
-#if MUS_LITTLE_ENDIAN
-   byteswap = IS_BIG_ENDIAN_FORMAT(informat);
-#else
-   byteswap = IS_LITTLE_ENDIAN_FORMAT(informat);
-#endif
+   framebytes = bytespersamp * nchans;
+   startbyte = (startframe * framebytes) + indataloc;
 
-   for (n = 0; n < nchans; n++) {
-      peak[n] = 0.0;
-      peakloc[n] = 0;
-      ampavg[n] = 0.0;
-      dcavg[n] = 0.0;
-      rms[n] = 0.0;
+   if (fstat(infd, &statbuf) == -1) {
+      perror("sndlib_findpeak: fstat");
+      return -1;
+   }
+   if (outfd == -1) {
+      cached = find_cached_peak(&statbuf, indataloc, informat, nchans,
+                                                      startframe, nframes);
+      if (cached) {
+         for (n = 0; n < nchans; n++) {
+            peak[n] = cached->peak[n];
+            peakloc[n] = cached->peakloc[n];
+            ampavg[n] = cached->ampavg[n];
+            dcavg[n] = cached->dcavg[n];
+            rms[n] = cached->rms[n];
+         }
+         return 0;
+      }
    }
 
-   bufbytes = BUF_FRAMES * bytespersamp * nchans;
-   buffer = (char *)malloc(bufbytes);
-   if (buffer == NULL) {
+   memset(&sums, 0, sizeof(sums));
+   chanbuf = (float *)malloc(SCAN_FRAMES * nchans * sizeof(float));
+   if (chanbuf == NULL) {
       perror("sndlib_findpeak: malloc");
       return -1;
    }
 
-   if (outfd > -1) {
-      assert(outdataloc >= 0);
-      if (lseek(outfd, outdataloc, SEEK_SET) == -1) {
-         perror("sndlib_findpeak: lseek");
-         return -1;
+   /* Map the window, as far as the end of the file, if we're not copying. */
+   if (outfd == -1) {
+      const long pagesize = sysconf(_SC_PAGESIZE);
+      const off_t mapstart = startbyte - (startbyte % pagesize);
+      long availframes = 0;
+      if (statbuf.st_size > startbyte)
+         availframes = (statbuf.st_size - startbyte) / framebytes;
+      frames = MIN(nframes, availframes);
+      if (frames > 0) {
+         const size_t maplen = (startbyte - mapstart) + frames * framebytes;
+         void *map = mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, infd,
+                                                                  mapstart);
+         if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise(map, maplen, MADV_SEQUENTIAL);
+#endif
+            scan_frames((unsigned char *) map + (startbyte - mapstart),
+                        frames, startframe, informat, nchans, chanbuf, &sums);
+            munmap(map, maplen);
+            mapped = 1;
+         }
       }
-   }
-   oldloc = lseek(infd, 0, SEEK_CUR);
-   startbyte = (startframe * nchans * bytespersamp) + indataloc;
-   if (lseek(infd, startbyte, SEEK_SET) == -1) {
-      perror("sndlib_findpeak: lseek");
-      return -1;
+      else
+         mapped = 1;                      /* nothing there to read */
    }
 
-   for (frames = 0; frames < nframes; frames += bufframes) {
-      long inbytes = read(infd, buffer, bufbytes);
-      if (inbytes == -1) {
-         perror("sndlib_findpeak: read");
+   oldloc = lseek(infd, 0, SEEK_CUR);
+   if (!mapped) {
+      bufbytes = BUF_FRAMES * framebytes;
+      buffer = (char *)malloc(bufbytes);
+      if (buffer == NULL) {
+         perror("sndlib_findpeak: malloc");
          goto err;
       }
-      if (inbytes == 0)
-         break;                           /* already reached EOF */
-
-      bufframes = inbytes / bytespersamp / nchans;
-
-      if (isfloat) {
-         float fsamp, fabsamp, normsamp;
-         float *fbuf = (float *)buffer;
 
-         for (i = 0; i < bufframes; i++) {
-            for (n = 0; n < nchans; n++) {
-               fsamp = *fbuf++;
-               if (byteswap)
-                  byte_reverse4(&fsamp);
-               fabsamp = (float)fabs((double)fsamp);
-               if (fabsamp > peak[n]) {
-                  peak[n] = fabsamp;
-                  peakloc[n] = startframe + frames + i;
-               }
-               ampavg[n] += fabsamp * NORMFACTOR;
-               normsamp = fsamp * NORMFACTOR;
-               dcavg[n] += normsamp;
-               rms[n] += normsamp * normsamp;
-            }
+      if (outfd > -1) {
+         assert(outdataloc >= 0);
+         if (lseek(outfd, outdataloc, SEEK_SET) == -1) {
+            perror("sndlib_findpeak: lseek");
+            goto err;
          }
       }
-      else if (bytespersamp == 3) {
-         float fsamp, fabsamp, normsamp, scalefactor = 1.0 / (float) (1 << 8);
-         unsigned char *bufp = (unsigned char *)buffer;
-         if (informat == MUS_L24INT) {
-            for (i = 0; i < bufframes; i++) {
-               for (n = 0; n < nchans; n++) {
-                  int samp = (int) (((bufp[2] << 24)
-                                   + (bufp[1] << 16)
-                                   + (bufp[0] << 8)) >> 8);
-                  fsamp = (float) samp * scalefactor;
-                  fabsamp = fabs(fsamp);
-                  if (fabsamp > peak[n]) {
-                     peak[n] = fabsamp;
-                     peakloc[n] = startframe + frames + i;
-                  }
-                  ampavg[n] += fabsamp * NORMFACTOR;
-                  normsamp = fsamp * NORMFACTOR;
-                  dcavg[n] += normsamp;
-                  rms[n] += normsamp * normsamp;
-                  bufp += 3;
-               }
-            }
-         }
-         else {   // informat == MUS_B24INT
-            for (i = 0; i < bufframes; i++) {
-               for (n = 0; n < nchans; n++) {
-                  int samp = (int) (((bufp[0] << 24)
-                                   + (bufp[1] << 16)
-                                   + (bufp[2] << 8)) >> 8);
-                  fsamp = (float) samp * scalefactor;
-                  fabsamp = fabs(fsamp);
-                  if (fabsamp > peak[n]) {
-                     peak[n] = fabsamp;
-                     peakloc[n] = startframe + frames + i;
-                  }
-                  ampavg[n] += fabsamp * NORMFACTOR;
-                  normsamp = fsamp * NORMFACTOR;
-                  dcavg[n] += normsamp;
-                  rms[n] += normsamp * normsamp;
-                  bufp += 3;
-               }
-            }
-         }
+      if (lseek(infd, startbyte, SEEK_SET) == -1) {
+         perror("sndlib_findpeak: lseek");
+         goto err;
       }
-      else if (bytespersamp == 2) {      /* short ints */
-         short samp, absamp;
-         float normsamp;
-         short *sbuf = (short *)buffer;
 
-         for (i = 0; i < bufframes; i++) {
-            for (n = 0; n < nchans; n++) {
-               samp = *sbuf++;
-               if (byteswap)
-                  byte_reverse2(&samp);
-               absamp = ABS(samp);
-               if (absamp > peak[n]) {
-                  peak[n] = absamp;
-                  peakloc[n] = startframe + frames + i;
-               }
-               ampavg[n] += absamp * NORMFACTOR;
-               normsamp = samp * NORMFACTOR;
-               dcavg[n] += normsamp;
-               rms[n] += normsamp * normsamp;
-            }
-         }
-      }
-      if (outfd > -1) {   /* copy to output file (with same byte order) */
-         long outbytes = write(outfd, buffer, inbytes);
-         if (outbytes != inbytes) {
-            perror("sndlib_findpeak: write");
+      for (frames = 0; frames < nframes; frames += bufframes) {
+         long inbytes = read(infd, buffer, bufbytes);
+         if (inbytes == -1) {
+            perror("sndlib_findpeak: read");
             goto err;
          }
+         if (inbytes == 0)
+            break;                        /* already reached EOF */
+
+         bufframes = inbytes / framebytes;
+         scan_frames((unsigned char *) buffer,
+                     MIN(bufframes, nframes - frames), startframe + frames,
+                     informat, nchans, chanbuf, &sums);
+
+         if (outfd > -1) {   /* copy to output file (with same byte order) */
+            long outbytes = write(outfd, buffer, inbytes);
+            if (outbytes != inbytes) {
+               perror("sndlib_findpeak: write");
+               goto err;
+            }
+         }
       }
    }
 
-   /* denormalize averages so that they correspond to input range;
-      we do the normalization to avoid overflow during accumulation.
-   */
    for (n = 0; n < nchans; n++) {
-      ampavg[n] = (ampavg[n] / nframes) * DENORMFACTOR;
-      dcavg[n] = (dcavg[n] / nframes) * DENORMFACTOR;
-      rms[n] = pow(rms[n] / nframes, 0.5) * DENORMFACTOR;
+      peak[n] = sums.peak[n];
+      peakloc[n] = sums.peakloc[n];
+      ampavg[n] = sums.ampsum[n] / nframes;
+      dcavg[n] = sums.dcsum[n] / nframes;
+      rms[n] = sqrt(sums.sqsum[n] / nframes);
+   }
+
+   if (outfd == -1) {
+      PeakCacheEntry *e = &peak_cache[peak_cache_next];
+      e->dev = statbuf.st_dev;
+      e->ino = statbuf.st_ino;
+      e->size = statbuf.st_size;
+      e->mtime = statbuf.st_mtime;
+      e->dataloc = indataloc;
+      e->format = informat;
+      e->nchans = nchans;
+      e->startframe = startframe;
+      e->nframes = nframes;
+      for (n = 0; n < nchans; n++) {
+         e->peak[n] = peak[n];
+         e->peakloc[n] = peakloc[n];
+         e->ampavg[n] = ampavg[n];
+         e->dcavg[n] = dcavg[n];
+         e->rms[n] = rms[n];
+      }
+      peak_cache_next = (peak_cache_next + 1) % PEAK_CACHE_SIZE;
+      if (peak_cache_count < PEAK_CACHE_SIZE)
+         peak_cache_count++;
    }
 
+   free(chanbuf);
    free(buffer);
    lseek(infd, oldloc, SEEK_SET);
    return 0;
 err:
+   free(chanbuf);
    free(buffer);
    lseek(infd, oldloc, SEEK_SET);
    return -1;
@@ -59,6 +59,11 @@ enum { MUS_CLIPPED = 0x100000 };
 #define NATIVE_FLOAT_FMT MUS_BFLOAT
 #endif
 
+/* sndlib cannot write FLAC, so AudioFileDevice encodes it itself.  This
+ * header type is ours, not sndlib's, and must never be handed to sndlib.
+ */
+#define RT_MUS_FLAC (MUS_CAFF + 1)
+
 /* used to handle encoding peak stats in sound file comment */
 
 /* all 3 constants are meant to include terminating NULL */
@@ -30,6 +30,7 @@ RTcmixWindow::_eventLoop(void *context)
 	while (obj->runThread()) {
 		if (obj->handleEvents() == false)
 			break;
+		obj->refresh();
 		usleep(obj->getSleepTime());
 	}
 	return NULL;
@@ -23,6 +23,9 @@ protected:
 	int spawnEventLoop();
 	void shutdownEventLoop();
 	virtual bool handleEvents() = 0;
+	// Called on the event thread after each handleEvents(), to redraw
+	// whatever has changed since the last call.
+	virtual void refresh() {}
 	inline unsigned long getSleepTime() { return _sleeptime; }
 
 private:
@@ -25,6 +25,9 @@ DataFileReaderPField::DataFileReaderPField(const char *fileName,
 		}
         else {
             _datafile->setSkipTime(skipTime);
+            // Reading from a mapping needs no stream, or file descriptor.
+            if (_datafile->mapFile() == 0)
+                _datafile->closeFile();
         }
 	}
 	_filter = new Oonepole(controlRate);
@@ -24,11 +24,12 @@ const char *kServerName = "localhost";
 
 
 OSXDisplay::OSXDisplay()
-	: RTcmixDisplay(), _sockdesc(0), _running(false)
+	: RTcmixDisplay(), _sockdesc(0), _valuecount(0), _running(false)
 {
 	_sockport = kSockPort;
 	_packet = new DisplaySockPacket [1];
 	_evtpacket = new DisplaySockPacket [1];
+	_valuepackets = new DisplaySockPacket [kNumLabels];
 	_servername = new char [strlen(kServerName) + 1];
 	strcpy(_servername, kServerName);
 }
@@ -37,6 +38,7 @@ OSXDisplay::~OSXDisplay()
 {
 	delete [] _packet;
 	delete [] _evtpacket;
+	delete [] _valuepackets;
 	delete [] _servername;
 }
 
@@ -142,15 +144,26 @@ int OSXDisplay::readPacket(DisplaySockPacket *packet)
 
 int OSXDisplay::writePacket(const DisplaySockPacket *packet)
 {
-	const char *ptr = (char *) packet;
-	const int packetsize = sizeof(DisplaySockPacket);
+	return writePackets(packet, 1);
+}
+
+// Labels are configured on the parser thread and updated on the window's,
+// so the lock keeps their packets from interleaving.
+int OSXDisplay::writePackets(const DisplaySockPacket *packets, const int count)
+{
+	const char *ptr = (char *) packets;
+	const int size = count * sizeof(DisplaySockPacket);
 	ssize_t amt = 0;
+	lock();
 	do {
-		ssize_t n = write(_sockdesc, ptr + amt, packetsize - amt);
-		if (n < 0)
+		ssize_t n = write(_sockdesc, ptr + amt, size - amt);
+		if (n < 0) {
+			unlock();
 			return reportError("OSXDisplay::writePacket", true);
+		}
 		amt += n;
-	} while (amt < packetsize);
+	} while (amt < size);
+	unlock();
 
 	return 0;
 }
@@ -189,13 +202,14 @@ void OSXDisplay::doConfigureLabel(const int id, const char *prefix,
 	sendLabel(id, prefix, units, precision);
 }
 
-// Send label value to DisplayWindow for given label id.
+// Queue label value for DisplayWindow for given label id.  The values that
+// have changed since the last refresh go out together, in one write.
 void OSXDisplay::sendLabelValue(const int id, const double value)
 {
-	_packet->id = id;
-	_packet->type = kPacketUpdateLabel;
-	_packet->data.dval = value;
-	writePacket(_packet);
+	DisplaySockPacket *packet = &_valuepackets[_valuecount++];
+	packet->id = id;
+	packet->type = kPacketUpdateLabel;
+	packet->data.dval = value;
 }
 
 void OSXDisplay::doUpdateLabelValue(const int id, const double value)
@@ -204,6 +218,13 @@ void OSXDisplay::doUpdateLabelValue(const int id, const double value)
 		sendLabelValue(id, value);
 }
 
+void OSXDisplay::doFlushLabels()
+{
+	if (_valuecount > 0)
+		writePackets(_valuepackets, _valuecount);
+	_valuecount = 0;
+}
+
 int OSXDisplay::pollInput(long usec)
 {
 	fd_set rfdset;
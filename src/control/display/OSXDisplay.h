@@ -5,10 +5,11 @@
 #ifndef _OSXDISPLAY_H_
 #define _OSXDISPLAY_H_
 #include <RTcmixDisplay.h>
+#include <Lockable.h>
 #include <Carbon/Carbon.h>
 #include "display_ipc.h"
 
-class OSXDisplay : public RTcmixDisplay {
+class OSXDisplay : public RTcmixDisplay, private Lockable {
 public:
 	OSXDisplay();
 	virtual ~OSXDisplay();
@@ -19,6 +20,7 @@ protected:
 	virtual void doConfigureLabel(const int id, const char *prefix,
                                  const char *units, const int precision);
 	virtual void doUpdateLabelValue(const int id, const double value);
+	virtual void doFlushLabels();
 	virtual bool handleEvents();
 
 private:
@@ -26,6 +28,7 @@ private:
 	int reportError(const char *err, const bool useErrno);
 	int readPacket(DisplaySockPacket *packet);
 	int writePacket(const DisplaySockPacket *packet);
+	int writePackets(const DisplaySockPacket *packets, const int count);
 	void sendLabel(const int id, const char *prefix,
                   const char *units, const int precision);
 	void sendLabelValue(const int id, const double value);
@@ -35,6 +38,8 @@ private:
 	int _sockdesc;
 	DisplaySockPacket *_packet;
 	DisplaySockPacket *_evtpacket;
+	DisplaySockPacket *_valuepackets;	// label values waiting to be sent
+	int _valuecount;
 	char *_servername;
 	bool _running;
 };
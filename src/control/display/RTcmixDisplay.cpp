@@ -8,8 +8,8 @@
 #include <string.h>
 #include <assert.h>
 
-const int kSleepMsec = 40;		// How long to nap between polling of events
-const int kThrottle = 50;		// How many intervening values to skip drawing
+const int kSleepMsec = 40;		// How long to nap between polling of events,
+										// and so between redraws of labels
 
 RTcmixDisplay::RTcmixDisplay() : RTcmixWindow(kSleepMsec), _labelCount(0)
 {
@@ -17,10 +17,10 @@ RTcmixDisplay::RTcmixDisplay() : RTcmixWindow(kSleepMsec), _labelCount(0)
 		_prefix[i] = NULL;
 		_units[i] = NULL;
 		_label[i] = NULL;
-		_last[i] = -1.0;
-		_throttleCount[i] = 0;
+		_value[i] = -1.0;
+		_changed[i] = false;
+		_shown[i] = -1.0;
 	}
-	_throttle = kThrottle;
 }
 
 RTcmixDisplay::~RTcmixDisplay()
@@ -52,15 +52,32 @@ void RTcmixDisplay::updateLabelValue(const int id, const double value)
 		return;
 	assert(id < _labelCount);
 
-	if (--_throttleCount[id] < 0) {
-		if (value == _last[id])
-			return;
-		doUpdateLabelValue(id, value);
-		_last[id] = value;
-		_throttleCount[id] = _throttle;
+	if (value != _value[id]) {
+		_value[id] = value;
+		_changed[id] = true;
 	}
 }
 
+// Called on the window's thread.
+
+void RTcmixDisplay::refresh()
+{
+	bool drawn = false;
+	for (int id = 0; id < _labelCount; id++) {
+		if (!_changed[id])
+			continue;
+		_changed[id] = false;
+		const double value = _value[id];
+		if (value != _shown[id]) {
+			doUpdateLabelValue(id, value);
+			_shown[id] = value;
+			drawn = true;
+		}
+	}
+	if (drawn)
+		doFlushLabels();
+}
+
 
 #ifdef MACOSX
 	#include <OSXDisplay.h>
@@ -25,7 +25,10 @@ public:
 	int configureLabel(const char *prefix, const char *units,
                                                    const int precision);
 
-	// Update the value used in the label.
+	// Update the value used in the label.  This only stores the value, so
+	// it is cheap enough to call for every value a PField returns; the
+	// window's own thread draws the labels that have changed, all at once,
+	// about 25 times a second.
 	void updateLabelValue(const int id, const double value);
 
 protected:
@@ -34,8 +37,12 @@ protected:
 	virtual int show() = 0;
 	virtual void doConfigureLabel(const int id, const char *prefix,
                                  const char *units, const int precision) = 0;
+	// Called on the window's thread for each label that has changed, and
+	// then doFlushLabels() once after them.
 	virtual void doUpdateLabelValue(const int id, const double value) = 0;
+	virtual void doFlushLabels() {}
 	virtual bool handleEvents() = 0;
+	virtual void refresh();
 
 	int _labelCount;
 	char *_label[kNumLabels];
@@ -44,9 +51,9 @@ protected:
 	int _precision[kNumLabels];
 
 private:
-	double _last[kNumLabels];
-	int _throttleCount[kNumLabels];
-	int _throttle;
+	volatile double _value[kNumLabels];		// written by updateLabelValue
+	volatile bool _changed[kNumLabels];
+	double _shown[kNumLabels];					// last drawn by refresh
 };
 
 RTcmixDisplay *createDisplayWindow();
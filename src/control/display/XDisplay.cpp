@@ -58,6 +58,11 @@ void XDisplay::doUpdateLabelValue(const int id, const double value)
 	drawLabel(id);
 }
 
+void XDisplay::doFlushLabels()
+{
+	XFlush(_display);
+}
+
 int XDisplay::show()
 {
 	const int xpos = 100;	// NB: window manager sets position
@@ -139,7 +144,6 @@ void XDisplay::drawLabel(const int id)
 	XDrawString(_display, _window, _gc,
 					_labelXpos, ypos,
 					_label[id], strlen(_label[id]));
-	XFlush(_display);
 }
 
 void XDisplay::drawLabels()
@@ -18,6 +18,7 @@ protected:
 	virtual void doConfigureLabel(const int id, const char *prefix,
                                  const char *units, const int precision);
 	virtual void doUpdateLabelValue(const int id, const double value);
+	virtual void doFlushLabels();
 	virtual bool handleEvents();
 
 private:
@@ -5,14 +5,14 @@
 
 #include "RTInletPField.h"
 #include <PField.h>
+#include <ControlTable.h>
 #include <rtdefs.h>
 #include <stdio.h>
 #include <math.h>
 #include <assert.h>
 
-// BGG -- this is set by RTcmix_setPField() in main.cpp
-//		the index is the inlet, the value is the value
-extern float gInletValues[];
+// BGG -- this is set by RTcmix_setPField() in main.cpp, which writes the
+//		value into the ControlTable slot for the inlet
 
 RTInletPField::RTInletPField(
 			const int			n_inlet,
@@ -21,7 +21,7 @@ RTInletPField::RTInletPField(
 	  _n_inlet(n_inlet)
 {
 	assert(n_inlet - 1 < MAX_INLETS);
-	gInletValues[n_inlet-1] = defaultval; // inlets are numbered from "1"
+	ControlTable::write(ControlTable::inletSlot(n_inlet), defaultval);
 }
 
 RTInletPField::~RTInletPField() {}
@@ -29,6 +29,11 @@ RTInletPField::~RTInletPField() {}
 
 double RTInletPField::doubleValue(double dummy) const
 {
-	return gInletValues[_n_inlet-1];
+	return ControlTable::read(ControlTable::inletSlot(_n_inlet));
+}
+
+unsigned RTInletPField::changes() const
+{
+	return ControlTable::sequence(ControlTable::inletSlot(_n_inlet));
 }
 
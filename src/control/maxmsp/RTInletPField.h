@@ -14,6 +14,11 @@ public:
 			const double		defaultval);
 
 	virtual double doubleValue(double dummy) const;
+	virtual Variation variation() const { return kExternal; }
+
+	// How many times the inlet has been set, for telling whether it has
+	// changed since it was last read.
+	virtual unsigned changes() const;
 
 protected:
 	virtual ~RTInletPField();
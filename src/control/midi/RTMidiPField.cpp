@@ -7,6 +7,7 @@
 #include "RTcmixMIDI.h"
 #include <PField.h>
 #include <Ougens.h>
+#include <ControlTable.h>
 #include <assert.h>
 
 extern int resetval;		// declared in src/rtcmix/minc_functions.c
@@ -23,7 +24,7 @@ RTMidiPField::RTMidiPField(
 		const MIDISubType	subtype)
 	: RTNumberPField(0),
 	  _midiport(midiport), _min(minval), _default(defaultval), _chan(chan),
-	  _type(type), _subtype(subtype)
+	  _type(type), _subtype(subtype), _current(INVALID_MIDIVAL)
 {
 	assert(_midiport != NULL);
 
@@ -50,14 +51,29 @@ double RTMidiPField::doubleValue(double dummy) const
 }
 
 double RTMidiPField::computeValue() const
+{
+	const int rawval = timedRaw();
+
+	if (rawval == INVALID_MIDIVAL)
+		return _default;
+
+	return _min + (_diff * (rawval * _factor));
+}
+
+// The latest value received.
+
+int RTMidiPField::currentRaw() const
 {
 	int rawval;
 
 	if (_type == kMIDIControlType)
 		rawval = _midiport->getControl(_chan, _subtype);
 
-	else if (_type == kMIDIPitchBendType)
-		rawval = _midiport->getBend(_chan) + 8192;
+	else if (_type == kMIDIPitchBendType) {
+		rawval = _midiport->getBend(_chan);
+		if (rawval != INVALID_MIDIVAL)
+			rawval += 8192;
+	}
 
 	else if (_type == kMIDIChanPressType)
 		rawval = _midiport->getChanPress(_chan);
@@ -85,9 +101,87 @@ double RTMidiPField::computeValue() const
 	else
 		rawval = INVALID_MIDIVAL;
 
-	if (rawval == INVALID_MIDIVAL)
-		return _default;
+	return rawval;
+}
 
-	return _min + (_diff * (rawval * _factor));
+// Of our messages in the input's ring that are due by the frame being
+// rendered, return the value of the one with the latest frame.  If there are
+// none, but there are later ones, return the value we last found due; if our
+// controller has not changed for the length of the ring, the latest value.
+
+int RTMidiPField::timedRaw() const
+{
+	const FRAMETYPE now = ControlTable::renderFrame();
+	if (now < 0)
+		return currentRaw();		// not read by an instrument
+
+	FRAMETYPE bestFrame = -1;
+	int best = INVALID_MIDIVAL;
+	bool pending = false;
+	RTcmixMIDIInput::TimedEvent event;
+	for (unsigned back = 0; _midiport->getTimedEvent(back, &event); back++) {
+		int rawval;
+		if (!eventRaw(event.status, event.data1, event.data2, &rawval))
+			continue;
+		if (event.frame > now)
+			pending = true;
+		else if (event.frame > bestFrame) {
+			bestFrame = event.frame;
+			best = rawval;
+		}
+	}
+	if (bestFrame >= 0)
+		_current = best;
+	else if (!pending)
+		_current = currentRaw();
+	return _current;
 }
 
+// If the message is one of ours, set <rawval> to the value it carries.
+
+bool RTMidiPField::eventRaw(int status, int data1, int data2,
+							int *rawval) const
+{
+	if ((status & 0x0F) != _chan)
+		return false;
+
+	int kind = status & 0xF0;
+	if (kind == kNoteOn && data2 == 0)
+		kind = kNoteOff;		// note on w/ vel=0 is logically a note off
+
+	switch (_type) {
+		case kMIDIControlType:
+			if (kind != kControl || data1 != _subtype)
+				return false;
+			*rawval = data2;
+			return true;
+		case kMIDIPitchBendType:
+			if (kind != kPitchBend)
+				return false;
+			*rawval = (data2 << 7) + data1;
+			return true;
+		case kMIDIChanPressType:
+			if (kind != kChanPress)
+				return false;
+			*rawval = data1;
+			return true;
+		case kMIDINoteOnType:
+		case kMIDINoteOffType:
+			if (kind != ((_type == kMIDINoteOnType) ? kNoteOn : kNoteOff))
+				return false;
+			*rawval = (_subtype == kMIDINotePitchSubType) ? data1 : data2;
+			return true;
+		case kMIDIPolyPressType:
+			if (kind != kPolyPress || data1 != _subtype)
+				return false;
+			*rawval = data2;
+			return true;
+		case kMIDIProgramType:
+			if (kind != kProgram)
+				return false;
+			*rawval = data1;
+			return true;
+		default:
+			return false;
+	}
+}
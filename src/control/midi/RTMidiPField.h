@@ -28,6 +28,11 @@ typedef enum {
 class RTcmixMIDIInput;
 class Oonepole;
 
+// A value changes at the output frame its MIDI message was timestamped for
+// (see RTcmixMIDIInput), rather than whenever the PField is next read.  An
+// instrument reading it gets the latest value due as of the frame it is
+// rendering; anything else reading it gets the latest value received.
+
 class RTMidiPField : public RTNumberPField {
 public:
 	RTMidiPField(
@@ -47,6 +52,9 @@ protected:
 
 private:
 	double computeValue() const;
+	int currentRaw() const;
+	int timedRaw() const;
+	bool eventRaw(int status, int data1, int data2, int *rawval) const;
 
 	RTcmixMIDIInput	*_midiport;
 	Oonepole		*_filter;
@@ -57,6 +65,7 @@ private:
 	MIDIType		_type;
 	MIDISubType	_subtype;
 	double		_factor;
+	mutable int	_current;		// last raw value found due
 };
 
 #endif // _RTMIDIPFIELD_H_
@@ -11,6 +11,7 @@
 #include <assert.h>
 #include <RTOption.h>
 #include <RTcmix.h>
+#include <ControlTable.h>
 
 #define DEBUG 0
 
@@ -29,12 +30,15 @@ typedef struct {
 	int data0;
 	int data1;
 	int data2;
+	FRAMETYPE frame;	// output frame at which a note should start or stop
 } RTMQMessage;
 
 
 RTcmixMIDIInput::RTcmixMIDIInput()
-	: _instream(NULL), _active(false)
+	: _instream(NULL), _active(false), _eventWrites(0)
 {
+	for (int i = 0; i < kEventRingSize; i++)
+		_events[i].serial = ~0U;
 	clear();
 }
 
@@ -206,18 +210,51 @@ void RTcmixMIDIInput::dump(const int chan)
 }
 
 
-// ------------------------------------------------------------ _processMIDI ---
+// ----------------------------------------------------------- timed events ---
+
+// Called from the MIDI worker thread, which is the only writer.
 
-enum StatusByte {
-	kNoteOff = 0x80,
-	kNoteOn = 0x90,
-	kPolyPress = 0xA0,
-	kControl = 0xB0,
-	kProgram = 0xC0,
-	kChanPress = 0xD0,
-	kPitchBend = 0xE0,
-	kSystem = 0xF0
-};
+FRAMETYPE RTcmixMIDIInput::addTimedEvent(PmTimestamp timestamp, int status,
+										 int data1, int data2)
+{
+	// portmidi stamps input with Pt_Time(), in msec.  Place the message
+	// one buffer after the frame that was being rendered then.
+	const double delay = (timestamp - Pt_Time()) * 0.001;
+	FRAMETYPE frame = ControlTable::frameAt(delay);
+	if (frame > 0)
+		frame += RTcmix::bufsamps();	// else no audio yet: take effect now
+
+	const unsigned serial = _eventWrites;
+	RingEntry &entry = _events[serial % kEventRingSize];
+	entry.serial = ~0U;
+	__sync_synchronize();
+	entry.event.frame = frame;
+	entry.event.status = status;
+	entry.event.data1 = data1;
+	entry.event.data2 = data2;
+	__sync_synchronize();
+	entry.serial = serial;
+	_eventWrites = serial + 1;
+	return frame;
+}
+
+bool RTcmixMIDIInput::getTimedEvent(unsigned back, TimedEvent *event) const
+{
+	const unsigned writes = _eventWrites;
+	if (back >= writes || back >= kEventRingSize)
+		return false;
+	const unsigned serial = writes - 1 - back;
+	const RingEntry &entry = _events[serial % kEventRingSize];
+	if (entry.serial != serial)
+		return false;
+	__sync_synchronize();
+	*event = entry.event;
+	__sync_synchronize();
+	return entry.serial == serial;	// else overwritten while we copied it
+}
+
+
+// ------------------------------------------------------------ _processMIDI ---
 
 // This is called from the MIDI worker thread.  The RTcmixMIDIInput object, held by
 // main thread, communicates with this worker thread by passing messages
@@ -262,23 +299,28 @@ void RTcmixMIDIInput::_processMIDI(PtTimestamp timestamp, void *context)
 
 			const int chan = status & 0x0F;
 
+			FRAMETYPE frame = 0;
+			if ((status & 0xF0) != kSystem)
+				frame = obj->addTimedEvent(buffer.timestamp, status, data1,
+																	data2);
+
 			switch (status & 0xF0) {
 				case kNoteOn:
 					if (data2 > 0) {
 						obj->setNoteOnPitch(chan, data1);
 						obj->setNoteOnVel(chan, data2);
-						obj->noteOnTrigger(chan, data1, data2);
+						obj->noteOnTrigger(chan, data1, data2, frame);
 					}
 					else {	// note on w/ vel=0 is logically a note off
 						obj->setNoteOffPitch(chan, data1);
 						obj->setNoteOffVel(chan, data2);
-						obj->noteOffTrigger(chan, data1, data2);
+						obj->noteOffTrigger(chan, data1, data2, frame);
 					}
 					break;
 				case kNoteOff:
 					obj->setNoteOffPitch(chan, data1);
 					obj->setNoteOffVel(chan, data2);
-					obj->noteOffTrigger(chan, data1, data2);
+					obj->noteOffTrigger(chan, data1, data2, frame);
 					break;
 				case kPolyPress:
 					obj->setPolyPress(chan, data1, data2);
@@ -320,23 +362,27 @@ void RTcmixMIDIInput::_processMIDI(PtTimestamp timestamp, void *context)
 // stopping notes.  Since RTcmixMIDIInput is supposed to be dynamically loaded, how
 // would scheduler know if and what to call?
 
-void RTcmixMIDIInput::noteOnTrigger(int chan, int pitch, int velocity)
+void RTcmixMIDIInput::noteOnTrigger(int chan, int pitch, int velocity,
+									  FRAMETYPE frame)
 {
 	RTMQMessage msg;
 	msg.type = kNoteOnMsg;
 	msg.data0 = chan;
 	msg.data1 = pitch;
 	msg.data2 = velocity;
+	msg.frame = frame;
 	Pm_Enqueue(_MIDIToMain, &msg);
 }
 
-void RTcmixMIDIInput::noteOffTrigger(int chan, int pitch, int velocity)
+void RTcmixMIDIInput::noteOffTrigger(int chan, int pitch, int velocity,
+									  FRAMETYPE frame)
 {
 	RTMQMessage msg;
 	msg.type = kNoteOffMsg;
 	msg.data0 = chan;
 	msg.data1 = pitch;
 	msg.data2 = velocity;
+	msg.frame = frame;
 	Pm_Enqueue(_MIDIToMain, &msg);
 }
 
@@ -11,14 +11,41 @@
 #include "pmutil.h"
 #include <RTMIDIOutput.h>
 #include <Lockable.h>
+#include <rt_types.h>
 
 #define SLEEP_MSEC			1		// How long to nap between polling of events
 #define INVALID_MIDIVAL    99999
 
 typedef unsigned char uchar;
 
+enum StatusByte {
+	kNoteOff = 0x80,
+	kNoteOn = 0x90,
+	kPolyPress = 0xA0,
+	kControl = 0xB0,
+	kProgram = 0xC0,
+	kChanPress = 0xD0,
+	kPitchBend = 0xE0,
+	kSystem = 0xF0
+};
+
+// Besides the latest value of every controller, the input keeps a ring of
+// the most recent messages, each stamped with the output frame at which it
+// takes effect: the frame being rendered when portmidi timestamped it, plus
+// one buffer, so that messages arriving while a buffer is rendered keep
+// their spacing instead of all landing on the next buffer boundary.  The
+// MIDI thread is the only writer.  Readers do not consume messages, since
+// PFields for the same controller may be read by several instruments, for
+// different frames.
+
 class RTcmixMIDIInput {
 public:
+	struct TimedEvent {
+		FRAMETYPE	frame;		// output frame at which it takes effect
+		int			status;
+		int			data1;
+		int			data2;
+	};
 	RTcmixMIDIInput();
 	virtual ~RTcmixMIDIInput();
 	int init();
@@ -48,6 +75,12 @@ public:
 	inline int getChanPress(int chan)
 						{ return _chanpress[chan]; }
 
+	// Copy the message <back> messages before the newest (0 for the newest)
+	// into <event>.  Returns false if there is no such message any more.
+	bool getTimedEvent(unsigned back, TimedEvent *event) const;
+
+	enum { kEventRingSize = 256 };	// at least a buffer's worth of messages
+
 private:
 	inline bool active() { return _active; }
 	inline bool active(bool state) { _active = state; return _active; }
@@ -55,8 +88,8 @@ private:
 	inline PmQueue *MIDIToMain() { return _MIDIToMain; }
 	inline PmStream *instream() { return _instream; }
 
-	void noteOnTrigger(int chan, int pitch, int velocity);
-	void noteOffTrigger(int chan, int pitch, int velocity);
+	void noteOnTrigger(int chan, int pitch, int velocity, FRAMETYPE frame);
+	void noteOffTrigger(int chan, int pitch, int velocity, FRAMETYPE frame);
 
 	inline void setNoteOnPitch(int chan, int val)
 						{ _noteonpitch[chan] = val; }
@@ -80,6 +113,8 @@ private:
 	const char *getValueString(const int val);
 
 	static void _processMIDI(PtTimestamp timestamp, void *context);
+	FRAMETYPE addTimedEvent(PmTimestamp timestamp, int status, int data1,
+							int data2);
 
 	PmStream *_instream;
 	PmQueue *_mainToMIDI;
@@ -95,6 +130,13 @@ private:
 	int _bend[16];
 	int _program[16];
 	int _chanpress[16];
+
+	struct RingEntry {
+		volatile unsigned	serial;		// which write this is, or ~0 while written
+		TimedEvent			event;
+	};
+	RingEntry _events[kEventRingSize];
+	volatile unsigned _eventWrites;
 };
 
 class RTcmixMIDIOutput : public RTMIDIOutput, private Lockable {
@@ -23,13 +23,14 @@ const int kNumConnectAttempts = 10;
 const int kConnectSleepMsec = 200;
 
 
-OSXMouse::OSXMouse() : RTcmixMouse(), _sockdesc(0)
+OSXMouse::OSXMouse() : RTcmixMouse(), _sockdesc(0), _valuecount(0)
 {
 	_x = -1.0;	// force RTMousePField to use default vals until these are valid
 	_y = -1.0;
 	_sockport = kSockPort;
 	_packet = new MouseSockPacket [1];
 	_evtpacket = new MouseSockPacket [1];
+	_valuepackets = new MouseSockPacket [2 * kNumLabels];
 	_servername = strdup(kServerName);
 }
 
@@ -37,6 +38,7 @@ OSXMouse::~OSXMouse()
 {
 	delete [] _packet;
 	delete [] _evtpacket;
+	delete [] _valuepackets;
 	delete [] _servername;
 }
 
@@ -140,15 +142,26 @@ int OSXMouse::readPacket(MouseSockPacket *packet)
 
 int OSXMouse::writePacket(const MouseSockPacket *packet)
 {
-	const char *ptr = (char *) packet;
-	const int packetsize = sizeof(MouseSockPacket);
+	return writePackets(packet, 1);
+}
+
+// Labels are configured on the parser thread and updated on the window's,
+// so the lock keeps their packets from interleaving.
+int OSXMouse::writePackets(const MouseSockPacket *packets, const int count)
+{
+	const char *ptr = (char *) packets;
+	const int size = count * sizeof(MouseSockPacket);
 	ssize_t amt = 0;
+	lock();
 	do {
-		ssize_t n = write(_sockdesc, ptr + amt, packetsize - amt);
-		if (n < 0)
+		ssize_t n = write(_sockdesc, ptr + amt, size - amt);
+		if (n < 0) {
+			unlock();
 			return reportError("OSXMouse::writePacket", true);
+		}
 		amt += n;
-	} while (amt < packetsize);
+	} while (amt < size);
+	unlock();
 
 	return 0;
 }
@@ -196,14 +209,15 @@ void OSXMouse::doConfigureYLabel(const int id, const char *prefix,
 	sendLabel(false, id, prefix, units, precision);
 }
 
-// Send label value to MouseWindow for given label id and axis.
+// Queue label value for MouseWindow for given label id and axis.  The values
+// that have changed since the last refresh go out together, in one write.
 void OSXMouse::sendLabelValue(const bool isXAxis, const int id,
 	const double value)
 {
-	_packet->id = id;
-	_packet->type = isXAxis ? kPacketUpdateXLabel : kPacketUpdateYLabel;
-	_packet->data.dval = value;
-	writePacket(_packet);
+	MouseSockPacket *packet = &_valuepackets[_valuecount++];
+	packet->id = id;
+	packet->type = isXAxis ? kPacketUpdateXLabel : kPacketUpdateYLabel;
+	packet->data.dval = value;
 }
 
 void OSXMouse::doUpdateXLabelValue(const int id, const double value)
@@ -216,6 +230,13 @@ void OSXMouse::doUpdateYLabelValue(const int id, const double value)
 	sendLabelValue(false, id, value);
 }
 
+void OSXMouse::doFlushLabels()
+{
+	if (_valuecount > 0)
+		writePackets(_valuepackets, _valuecount);
+	_valuecount = 0;
+}
+
 int OSXMouse::pollInput(long usec)
 {
 	fd_set rfdset;
@@ -5,10 +5,11 @@
 #ifndef _OSXMOUSE_H_
 #define _OSXMOUSE_H_
 #include <RTcmixMouse.h>
+#include <Lockable.h>
 #include <Carbon/Carbon.h>
 #include "mouse_ipc.h"
 
-class OSXMouse : public RTcmixMouse {
+class OSXMouse : public RTcmixMouse, private Lockable {
 public:
 	OSXMouse();
 
@@ -27,6 +28,7 @@ protected:
                                  const char *units, const int precision);
 	virtual void doUpdateXLabelValue(const int id, const double value);
 	virtual void doUpdateYLabelValue(const int id, const double value);
+	virtual void doFlushLabels();
 
 	virtual bool handleEvents();
 
@@ -35,6 +37,7 @@ private:
 	int reportError(const char *err, const bool useErrno);
 	int readPacket(MouseSockPacket *packet);
 	int writePacket(const MouseSockPacket *packet);
+	int writePackets(const MouseSockPacket *packets, const int count);
 	void sendLabel(const bool isXAxis, const int id, const char *prefix,
                   const char *units, const int precision);
 	void sendLabelValue(const bool isXAxis, const int id, const double value);
@@ -46,6 +49,8 @@ private:
 	double _y;
 	MouseSockPacket *_packet;
 	MouseSockPacket *_evtpacket;
+	MouseSockPacket *_valuepackets;	// label values waiting to be sent
+	int _valuecount;
 	char *_servername;
 };
 
@@ -10,10 +10,11 @@
 #include <assert.h>
 
 const int kSleepMsec = 10;		// How long to nap between polling of events
-const int kThrottle = 50;		// How many intervening values to skip drawing
+const int kRefreshMsec = 40;	// How long between redraws of labels
 
 RTcmixMouse::RTcmixMouse() 
-	: RTcmixWindow(kSleepMsec), _xlabelCount(0), _ylabelCount(0)
+	: RTcmixWindow(kSleepMsec), _xlabelCount(0), _ylabelCount(0),
+	  _refreshCount(0)
 {
 	for (int i = 0; i < kNumLabels; i++) {
 		_xprefix[i] = NULL;
@@ -22,12 +23,11 @@ RTcmixMouse::RTcmixMouse()
 		_yunits[i] = NULL;
 		_xlabel[i] = NULL;
 		_ylabel[i] = NULL;
-		_lastx[i] = -1.0;
-		_lasty[i] = -1.0;
-		_xthrottleCount[i] = 0;
-		_ythrottleCount[i] = 0;
+		_xvalue[i] = _xshown[i] = -1.0;
+		_yvalue[i] = _yshown[i] = -1.0;
+		_xchanged[i] = false;
+		_ychanged[i] = false;
 	}
-	_throttle = kThrottle;
 }
 
 RTcmixMouse::~RTcmixMouse()
@@ -76,12 +76,9 @@ void RTcmixMouse::updateXLabelValue(const int id, const double value)
 		return;
 	assert(id < _xlabelCount);
 
-	if (--_xthrottleCount[id] < 0) {
-		if (value == _lastx[id])
-			return;
-		doUpdateXLabelValue(id, value);
-		_lastx[id] = value;
-		_xthrottleCount[id] = _throttle;
+	if (value != _xvalue[id]) {
+		_xvalue[id] = value;
+		_xchanged[id] = true;
 	}
 }
 
@@ -91,15 +88,47 @@ void RTcmixMouse::updateYLabelValue(const int id, const double value)
 		return;
 	assert(id < _ylabelCount);
 
-	if (--_ythrottleCount[id] < 0) {
-		if (value == _lasty[id])
-			return;
-		doUpdateYLabelValue(id, value);
-		_lasty[id] = value;
-		_ythrottleCount[id] = _throttle;
+	if (value != _yvalue[id]) {
+		_yvalue[id] = value;
+		_ychanged[id] = true;
 	}
 }
 
+// Called on the window's thread, after every poll for events.
+
+void RTcmixMouse::refresh()
+{
+	if (++_refreshCount < kRefreshMsec / kSleepMsec)
+		return;
+	_refreshCount = 0;
+
+	bool drawn = false;
+	for (int id = 0; id < _xlabelCount; id++) {
+		if (!_xchanged[id])
+			continue;
+		_xchanged[id] = false;
+		const double value = _xvalue[id];
+		if (value != _xshown[id]) {
+			doUpdateXLabelValue(id, value);
+			_xshown[id] = value;
+			drawn = true;
+		}
+	}
+	for (int id = 0; id < _ylabelCount; id++) {
+		if (!_ychanged[id])
+			continue;
+		_ychanged[id] = false;
+		const double value = _yvalue[id];
+		if (value != _yshown[id]) {
+			doUpdateYLabelValue(id, value);
+			_yshown[id] = value;
+			drawn = true;
+		}
+	}
+	if (drawn)
+		doFlushLabels();
+}
+
 #ifdef MACOSX
 	#include <OSXMouse.h>
 #else
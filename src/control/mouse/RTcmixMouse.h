@@ -34,7 +34,9 @@ public:
                                                    const int precision);
 
 	// Update the value used in the label.  Note: only the client PField knows
-	// how the mouse coords, given to it in range [0,1], will be scaled.
+	// how the mouse coords, given to it in range [0,1], will be scaled.  This
+	// only stores the value; the window's own thread draws the labels that
+	// have changed, all at once, about 25 times a second.
 	void updateXLabelValue(const int id, const double value);
 	void updateYLabelValue(const int id, const double value);
 
@@ -50,7 +52,11 @@ protected:
                                  const char *units, const int precision) = 0;
 	virtual void doUpdateXLabelValue(const int id, const double value) = 0;
 	virtual void doUpdateYLabelValue(const int id, const double value) = 0;
+	// Called on the window's thread once after the doUpdate?LabelValue()
+	// calls for the labels that have changed.
+	virtual void doFlushLabels() {}
 	virtual bool handleEvents() = 0;
+	virtual void refresh();
 
 	int _xlabelCount;
 	int _ylabelCount;
@@ -64,11 +70,15 @@ protected:
 	int _yprecision[kNumLabels];
 
 private:
-	double _lastx[kNumLabels];
-	double _lasty[kNumLabels];
-	int _xthrottleCount[kNumLabels];
-	int _ythrottleCount[kNumLabels];
-	int _throttle;
+	// written by update?LabelValue
+	volatile double _xvalue[kNumLabels];
+	volatile double _yvalue[kNumLabels];
+	volatile bool _xchanged[kNumLabels];
+	volatile bool _ychanged[kNumLabels];
+	// last drawn by refresh
+	double _xshown[kNumLabels];
+	double _yshown[kNumLabels];
+	int _refreshCount;
 };
 
 RTcmixMouse *createMouseWindow();
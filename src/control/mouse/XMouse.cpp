@@ -67,7 +67,6 @@ void XMouse::doUpdateXLabelValue(const int id, const double value)
 	const char *units = _xunits[id] ? _xunits[id] : "";
 	snprintf(_xlabel[id], kWholeLabelLength, "%s: %.*f %s",
 				_xprefix[id], _xprecision[id], value, units);
-	drawXLabels();
 }
 
 void XMouse::doUpdateYLabelValue(const int id, const double value)
@@ -75,7 +74,11 @@ void XMouse::doUpdateYLabelValue(const int id, const double value)
 	const char *units = _yunits[id] ? _yunits[id] : "";
 	snprintf(_ylabel[id], kWholeLabelLength, "%s: %.*f %s",
 				_yprefix[id], _yprecision[id], value, units);
-	drawYLabels();
+}
+
+void XMouse::doFlushLabels()
+{
+	drawWindowContent();
 }
 
 int XMouse::show()
@@ -34,6 +34,7 @@ protected:
                                  const char *units, const int precision);
 	virtual void doUpdateXLabelValue(const int id, const double value);
 	virtual void doUpdateYLabelValue(const int id, const double value);
+	virtual void doFlushLabels();
 
 	virtual bool handleEvents();
 
@@ -5,6 +5,7 @@
 #include <RTOscPField.h>
 #include <RTcmixOSC.h>
 #include <PField.h>
+#include <ControlTable.h>
 #include <Ougens.h>
 #include <string.h>
 #include <unistd.h>
@@ -15,10 +16,11 @@
 
 extern int resetval;		// declared in src/rtcmix/minc_functions.c
 
-const double kInvalidValue = DBL_MAX;
+const double RTOscPField::kNoValue = DBL_MAX;
 
 RTOscPField::RTOscPField(
 		RTcmixOSC			*oscserver,
+		const int			slot,
 		const char 			*path,
 		const int			index,
 		const double		inputmin,
@@ -28,9 +30,9 @@ RTOscPField::RTOscPField(
 		const double		defaultval,
 		const double		lag)				// in range [0, 1]
 	: RTNumberPField(0),
-	  _oscserver(oscserver), _index(index), _badMessages(0), _lastBadArgc(0),
+	  _oscserver(oscserver), _slot(slot), _index(index), _badMessages(0), _lastBadArgc(0),
 	  _inputmin(inputmin), _inputmax(inputmax), _outputmin(outputmin),
-	  _default(defaultval), _rawvalue(kInvalidValue), _callbackReturn(0)
+	  _default(defaultval), _callbackReturn(0)
 {
 	assert(_oscserver != NULL);
 	assert(_index >= 0);
@@ -56,6 +58,7 @@ RTOscPField::~RTOscPField()
 	// this PField.
 	_oscserver->unregisterPField(this);
 
+	ControlTable::release(_slot);
 	delete [] _path;
 	delete _filter;
 
@@ -66,9 +69,9 @@ RTOscPField::~RTOscPField()
 
 double RTOscPField::doubleValue(double) const
 {
-	// map _rawvalue, clamped to input range, into output range
-	double val = _rawvalue;
-	if (val == kInvalidValue)
+	// map the raw value, clamped to input range, into output range
+	double val = ControlTable::read(_slot);
+	if (val == kNoValue)
 		val = _default;
 	else {
 		if (val < _inputmin)
@@ -80,6 +83,18 @@ double RTOscPField::doubleValue(double) const
 	return _filter->next(val);
 }
 
+// Called from the OSC server's thread.
+
+void RTOscPField::rawvalue(double value)
+{
+	ControlTable::write(_slot, value);
+}
+
+unsigned RTOscPField::changes() const
+{
+	return ControlTable::sequence(_slot) - 1;	// allocate() wrote once
+}
+
 int RTOscPField::handler(const char *path, const char *types, lo_arg **argv,
 		int argc, lo_message msg, void *context)
 {
@@ -15,6 +15,7 @@ class RTOscPField : public RTNumberPField {
 public:
 	RTOscPField(
 		RTcmixOSC			*oscserver,
+		const int			slot,				// from ControlTable::allocate
 		const char 			*path,
 		const int			index,
 		const double		inputmin,
@@ -26,6 +27,13 @@ public:
 
 	virtual double doubleValue(double) const;
 
+	// The value of a slot that has had no message yet.
+	static const double kNoValue;
+
+	// How many messages have set this PField, for telling whether it has
+	// changed since it was last read.
+	unsigned changes() const;
+
 	// These functions are called either by this object's static callback
 	// function or by the RTcmixOSC object.
 	inline void callbackReturn(int val) { _callbackReturn = val; }
@@ -35,7 +43,7 @@ public:
 	inline void incrementBadMessages() { _badMessages++; }
 	inline int lastBadArgc() const { return _lastBadArgc; }
 	inline void lastBadArgc(int argc) { _lastBadArgc = argc; }
-	inline void rawvalue(double value) { _rawvalue = value; }
+	void rawvalue(double value);
 	inline double defaultval() const { return _default; }
 	inline char *path() const { return _path; }
 
@@ -49,6 +57,7 @@ protected:
 private:
 	Oonepole *_filter;
 	RTcmixOSC *_oscserver;
+	int _slot;
 	char *_path;
 	int _index;
 	int _badMessages;
@@ -58,7 +67,6 @@ private:
 	double _outputmin;
 	double _factor;
 	double _default;
-	double _rawvalue;
 	int _callbackReturn;
 };
 
@@ -13,6 +13,7 @@
 #include <utils.h>	// in ../../rtcmix
 #include <RTcmixOSC.h>
 #include <RTOscPField.h>
+#include <ControlTable.h>
 #include <ugens.h>		// for warn, die
 
 // -----------------------------------------------------------------------------
@@ -124,8 +125,14 @@ create_pfield(const Arg args[], const int nargs)
 	if (oscserver == NULL)
 		return NULL;
 
-	return new RTOscPField(oscserver, path, index, inmin, inmax, outmin, outmax,
-	                       defaultval, lag);
+	const int slot = ControlTable::allocate(RTOscPField::kNoValue);
+	if (slot < 0) {
+		die("makeconnection (osc)", "Too many real-time control connections.");
+		return NULL;
+	}
+
+	return new RTOscPField(oscserver, slot, path, index, inmin, inmax, outmin,
+	                       outmax, defaultval, lag);
 }
 
 
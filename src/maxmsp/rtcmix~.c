@@ -163,6 +163,7 @@ typedef int (*rtsetparamsFunctionPtr)(float sr, int nchans, int vecsize, int rec
 typedef int (*rtcmixsetaudiobufferformatFunctionPtr)(RTcmix_AudioFormat format, int nchans);
 
 typedef int (*rtcmixrunAudioFunctionPtr)(void *inAudioBuffer, void *outAudioBuffer, int nframes);
+typedef int (*rtcmixrunAudioPlanarFunctionPtr)(float **inputs, float **outputs, int nframes);
 typedef int (*rtresetaudioFunctionPtr)(float sr, int nchans, int vecsize, int recording);
 typedef int (*parse_scoreFunctionPtr)();
 typedef double (*parse_dispatchFunctionPtr)(char *cmd, double *p, int n_args, void *retval);
@@ -200,6 +201,7 @@ typedef struct _rtcmix
 	rtsetparamsFunctionPtr rtsetparams;
 	rtcmixsetaudiobufferformatFunctionPtr rtsetaudiobufferformat;
 	rtcmixrunAudioFunctionPtr rtrunaudio;
+	rtcmixrunAudioPlanarFunctionPtr rtrunaudioplanar;
 	rtresetaudioFunctionPtr rtresetaudio;
 	parse_scoreFunctionPtr parse_score;
 	parse_dispatchFunctionPtr parse_dispatch;
@@ -226,9 +228,11 @@ typedef struct _rtcmix
 	 char pathname[1024]; // probably should be malloc'd
 	 */
 	
-	// space for these malloc'd in rtcmix_dsp()
+	// space for these malloc'd in rtcmix_dsp(), a vector per channel
 	float *maxmsp_outbuf;
 	float *maxmsp_inbuf;
+	float *maxmsp_outchans[MSP_OUTPUTS];
+	float *maxmsp_inchans[MSP_INPUTS];
 	
 	// script buffer pointer for large binbuf restores
 	char *restore_buf_ptr;
@@ -587,7 +591,7 @@ void rtcmix_dsp64(t_rtcmix *x, t_object *dsp64, short *count, double samplerate,
 		if (x->rtsetaudiobufferformat)
 		{
 			rtcmix_dprint(x, "rtcmix_dsp calling RTcmix_setAudioBufferFormat()");
-			x->rtsetaudiobufferformat(AudioFormat_32BitFloat_Normalized, x->num_outputs);
+			x->rtsetaudiobufferformat(AudioFormat_32BitFloat_NonInterleaved_Normalized, x->num_outputs);
 		}
 		if (x->rtsetparams)
 		{
@@ -618,13 +622,15 @@ void rtcmix_dsp64(t_rtcmix *x, t_object *dsp64, short *count, double samplerate,
 	// zero out these buffers to be safe
 	for (i = 0; i < (maxvectorsize * x->num_inputs); i++) x->maxmsp_inbuf[i] = 0.0;
 	for (i = 0; i < (maxvectorsize * x->num_outputs); i++) x->maxmsp_outbuf[i] = 0.0;
+	for (i = 0; i < x->num_inputs; i++) x->maxmsp_inchans[i] = x->maxmsp_inbuf + i * maxvectorsize;
+	for (i = 0; i < x->num_outputs; i++) x->maxmsp_outchans[i] = x->maxmsp_outbuf + i * maxvectorsize;
 
 #if defined(RELOAD_DYLIB) || defined(DESTROY_ON_DSP_MESSAGE)
 	// This is done if we are either reloading the dylib, or destroying everything each time.
 	if (x->rtsetaudiobufferformat)
 	{
 		rtcmix_dprint(x, "rtcmix_dsp calling RTcmix_setAudioBufferFormat with %d output channels", (int)x->num_outputs);
-		x->rtsetaudiobufferformat(AudioFormat_32BitFloat_Normalized, x->num_outputs);
+		x->rtsetaudiobufferformat(AudioFormat_32BitFloat_NonInterleaved_Normalized, x->num_outputs);
 	}
 	if (x->rtsetparams)
 	{
@@ -663,6 +669,7 @@ int rtcmix_load_dylib(t_rtcmix *x)
 	x->rtsetparams = NULL;
 	x->rtsetaudiobufferformat = NULL;
 	x->rtrunaudio = NULL;
+	x->rtrunaudioplanar = NULL;
 	x->rtresetaudio = NULL;
 	x->parse_score = NULL;
 	x->parse_dispatch = NULL;
@@ -747,6 +754,15 @@ int rtcmix_load_dylib(t_rtcmix *x)
 		if (!(x->rtrunaudio))
 			error("rtcmix~ could not find RTcmix_runAudio()");
 	}
+	x->symbol = NSLookupSymbolInModule(x->module, "_RTcmix_runAudioPlanar");
+	if (x->symbol == NULL) {
+		error("cannot find RTcmix_runAudioPlanar");
+		return(-1);
+	} else {
+		x->rtrunaudioplanar = NSAddressOfSymbol(x->symbol);
+		if (!(x->rtrunaudioplanar))
+			error("rtcmix~ could not find RTcmix_runAudioPlanar()");
+	}
 	x->symbol = NSLookupSymbolInModule(x->module, "_RTcmix_resetAudio");
 	if (x->symbol == NULL) {
 		error("cannot find RTcmix_resetAudio");
@@ -902,48 +918,36 @@ void rtcmix_perform64(t_rtcmix *x, t_object *dsp64, double **ins, long numins, d
 {
 	// NO debugging post here; this one gets called all the time
 	
-	double *in[MSP_INPUTS]; 		//pointers to the input vectors
-	double *out[MSP_OUTPUTS];	//pointers to the output vectors
-	
 	//random local vars
-	int i, j, k;
-
-	//check to see if we have a signal or float message connected to input
-	//then assign the pointer accordingly
-    // msp ins and outs are not interleaved -- each ins[i] and outs[i] points to a channel of samples
-	for (i = 0; i < x->num_inputs; i++) { // don't use numins, it also include pfield inputs (proxies)
-        if (x->in_connected[i])
-            in[i] = ins[i]; // each input in[] points to a channel
-        out[i] = outs[i];
-	}
-    for (i = 0; i < numouts; i++) {
-        out[i] = outs[i];
-    }
+	int i, j;
+
+	// msp ins and outs are not interleaved -- each ins[i] and outs[i] points to a channel
+	// of samples -- but they are doubles, so each channel is converted to and from
+	// RTcmix's float channels in one contiguous pass.
+	for (j = 0; j < x->num_inputs; j++) { // don't use numins, it also include pfield inputs (proxies)
+		float *dest = x->maxmsp_inchans[j];
+		if (x->in_connected[j]) {
+			const double *src = ins[j];
+			for (i = 0; i < sampleframes; i++)
+				dest[i] = src[i];
+		}
+		else {
+			const float value = x->in[j];
+			for (i = 0; i < sampleframes; i++)
+				dest[i] = value;
+		}
+	}
 
-	k = 0;
-	// copy input from MAX into transfer buffer
-    for (i = 0; i < sampleframes; i++) {
-        for (j = 0; j < x->num_inputs; j++) {
-            if (x->in_connected[j]) {
-                (x->maxmsp_inbuf)[k++] = *in[j]++;
-            }
-            else {
-                (x->maxmsp_inbuf)[k++] = x->in[j];
-            }
-        }
-    }
-    
 	// RTcmix stuff
 	// this drives the RTcmix sample-computing engine
-	x->rtrunaudio(x->maxmsp_inbuf, x->maxmsp_outbuf, sampleframes);
-    
-    k = 0;
-    // copy output from RTcmix transfer buffer
-    for (i = 0; i < sampleframes; i++) {
-        for(j = 0; j < x->num_outputs; j++) {
-            *out[j]++ = (x->maxmsp_outbuf)[k++];
-        }
-    }
+	x->rtrunaudioplanar(x->maxmsp_inchans, x->maxmsp_outchans, sampleframes);
+
+	for (j = 0; j < x->num_outputs && j < numouts; j++) {
+		const float *src = x->maxmsp_outchans[j];
+		double *dest = outs[j];
+		for (i = 0; i < sampleframes; i++)
+			dest[i] = src[i];
+	}
 }
 
 // the deferred bang output
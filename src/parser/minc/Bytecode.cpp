@@ -0,0 +1,245 @@
+/* RTcmix  - Copyright (C) 2004  The RTcmix Development Team
+ See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+ the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+//
+//  Bytecode.cpp
+//  RTcmix
+//
+//  Lowers numeric expression subtrees to a small stack program.  See
+//  Bytecode.h for the rules about when this is used.
+//
+
+#include "Bytecode.h"
+#include "Node.h"
+#include "Scope.h"
+#include "Symbol.h"
+#include <math.h>
+
+// Expressions that need a deeper stack than this are left to the tree.
+#define MAX_STACK_DEPTH 32
+
+Bytecode::Bytecode()
+{
+}
+
+Bytecode::~Bytecode()
+{
+}
+
+Bytecode *
+Bytecode::compile(Node *root)
+{
+    Bytecode *code = new Bytecode;
+    if (!code->emitTree(root, 0)) {
+        delete code;
+        return NULL;
+    }
+    code->emit(kEnd);
+    return code;
+}
+
+int
+Bytecode::emit(int opcode, int arg)
+{
+    Instruction ins;
+    ins.opcode = opcode;
+    ins.arg = arg;
+    _code.push_back(ins);
+    return (int) _code.size() - 1;
+}
+
+// Emits code for <node>, which will find <depth> values already on the
+// stack.  Returns false if any part of the subtree is not eligible.
+
+bool
+Bytecode::emitTree(Node *node, int depth)
+{
+    if (depth >= MAX_STACK_DEPTH) {
+        return false;
+    }
+    switch (node->kind) {
+        case eNodeConstf:
+            _constants.push_back(node->u.number);
+            emit(kPushConst, (int) _constants.size() - 1);
+            return true;
+        case eNodeLoadSym:
+            _names.push_back(static_cast<NodeLoadSym *>(node)->symbolName());
+            emit(kLoadSym, (int) _names.size() - 1);
+            return true;
+        case eNodeOperator:
+            if (node->op == OpNeg) {
+                // Unary minus is parsed as (exp OpNeg 0.0); the constant is ignored.
+                if (node->child(1)->kind != eNodeConstf || !emitTree(node->child(0), depth)) {
+                    return false;
+                }
+                emit(kNeg);
+                return true;
+            }
+            if (!emitTree(node->child(0), depth) || !emitTree(node->child(1), depth + 1)) {
+                return false;
+            }
+            switch (node->op) {
+                case OpPlus:    emit(kAdd); break;
+                case OpMinus:   emit(kSub); break;
+                case OpMul:     emit(kMul); break;
+                case OpDiv:     emit(kDiv); break;
+                case OpMod:     emit(kMod); break;
+                case OpPow:     emit(kPow); break;
+                default:
+                    return false;
+            }
+            return true;
+        case eNodeUnaryOperator:
+            if (node->op != OpNeg || !emitTree(node->child(0), depth)) {
+                return false;
+            }
+            emit(kNeg);
+            return true;
+        case eNodeRelation:
+            if (!emitTree(node->child(0), depth) || !emitTree(node->child(1), depth + 1)) {
+                return false;
+            }
+            switch (node->op) {
+                case OpEqual:           emit(kEqual); break;
+                case OpNotEqual:        emit(kNotEqual); break;
+                case OpLess:            emit(kLess); break;
+                case OpGreater:         emit(kGreater); break;
+                case OpLessEqual:       emit(kLessEqual); break;
+                case OpGreaterEqual:    emit(kGreaterEqual); break;
+                default:
+                    return false;
+            }
+            return true;
+        case eNodeNot:
+            if (!emitTree(node->child(0), depth)) {
+                return false;
+            }
+            emit(kNot);
+            return true;
+        case eNodeAnd:
+        case eNodeOr:
+        {
+            // Both short-circuit, exactly like NodeAnd::doExct and NodeOr::doExct.
+            const bool isAnd = (node->kind == eNodeAnd);
+            const int test = isAnd ? kJumpIfFalse : kJumpIfTrue;
+            if (!emitTree(node->child(0), depth)) {
+                return false;
+            }
+            const int jump1 = emit(test);
+            if (!emitTree(node->child(1), depth)) {
+                return false;
+            }
+            const int jump2 = emit(test);
+            _constants.push_back(isAnd ? 1.0 : 0.0);
+            emit(kPushConst, (int) _constants.size() - 1);
+            const int jumpEnd = emit(kJump);
+            _constants.push_back(isAnd ? 0.0 : 1.0);
+            const int shortCircuit = emit(kPushConst, (int) _constants.size() - 1);
+            _code[jump1].arg = _code[jump2].arg = shortCircuit;
+            _code[jumpEnd].arg = (int) _code.size();
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool
+Bytecode::run(MincFloat *result) const
+{
+    MincFloat stack[MAX_STACK_DEPTH];
+    const Instruction *code = &_code[0];
+    int sp = 0;
+    int pc = 0;
+    for (;;) {
+        const Instruction &ins = code[pc++];
+        switch (ins.opcode) {
+            case kPushConst:
+                stack[sp++] = _constants[ins.arg];
+                break;
+            case kLoadSym:
+            {
+                const Symbol *sym = lookupSymbol(_names[ins.arg], AnyLevel);
+                if (sym == NULL || sym->dataType() != MincFloatType) {
+                    return false;
+                }
+                stack[sp++] = (MincFloat) sym->value();
+            }
+                break;
+            case kAdd:
+                --sp;
+                stack[sp-1] = stack[sp-1] + stack[sp];
+                break;
+            case kSub:
+                --sp;
+                stack[sp-1] = stack[sp-1] - stack[sp];
+                break;
+            case kMul:
+                --sp;
+                stack[sp-1] = stack[sp-1] * stack[sp];
+                break;
+            case kDiv:
+                --sp;
+                stack[sp-1] = stack[sp-1] / stack[sp];
+                break;
+            case kMod:
+                --sp;
+                if (stack[sp] < 1.0 && stack[sp] > -1.0) {
+                    return false;       // let the tree report it
+                }
+                stack[sp-1] = (MincFloat) ((long) stack[sp-1] % (long) stack[sp]);
+                break;
+            case kPow:
+                --sp;
+                stack[sp-1] = pow(stack[sp-1], stack[sp]);
+                break;
+            case kNeg:
+                stack[sp-1] = -stack[sp-1];
+                break;
+            case kEqual:
+                --sp;
+                stack[sp-1] = (cmp(stack[sp-1], stack[sp]) == 0) ? 1.0 : 0.0;
+                break;
+            case kNotEqual:
+                --sp;
+                stack[sp-1] = (cmp(stack[sp-1], stack[sp]) != 0) ? 1.0 : 0.0;
+                break;
+            case kLess:
+                --sp;
+                stack[sp-1] = (cmp(stack[sp-1], stack[sp]) == -1) ? 1.0 : 0.0;
+                break;
+            case kGreater:
+                --sp;
+                stack[sp-1] = (cmp(stack[sp-1], stack[sp]) == 1) ? 1.0 : 0.0;
+                break;
+            case kLessEqual:
+                --sp;
+                stack[sp-1] = (cmp(stack[sp-1], stack[sp]) != 1) ? 1.0 : 0.0;
+                break;
+            case kGreaterEqual:
+                --sp;
+                stack[sp-1] = (cmp(stack[sp-1], stack[sp]) != -1) ? 1.0 : 0.0;
+                break;
+            case kNot:
+                stack[sp-1] = (stack[sp-1] == 0.0) ? 1.0 : 0.0;
+                break;
+            case kJumpIfFalse:
+                if (stack[--sp] == 0.0) {
+                    pc = ins.arg;
+                }
+                break;
+            case kJumpIfTrue:
+                if (stack[--sp] != 0.0) {
+                    pc = ins.arg;
+                }
+                break;
+            case kJump:
+                pc = ins.arg;
+                break;
+            case kEnd:
+                *result = stack[sp-1];
+                return true;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+//
+//  Bytecode.h
+//  RTcmix
+//
+//  Numeric fast path for the MinC tree interpreter.
+//
+
+#ifndef Bytecode_h
+#define Bytecode_h
+
+#include "minc_internal.h"
+
+class Node;
+
+// A Bytecode is a purely numeric expression subtree (constants, variable
+// loads, arithmetic, relations and the logical operators) lowered into a
+// flat stack program that works on unboxed doubles.  Node::runCompiled()
+// builds one the second time an eligible expression node executes and runs
+// it in place of the tree walk from then on.
+//
+// Variables are still looked up by name on each run, so scoping is the same
+// as for the tree.  If a variable turns out not to hold a float, or an
+// operation would need to report an error (modulo by a value less than 1,
+// undeclared variable), run() returns false without side effects, and the
+// caller falls back to the tree walk, which produces the usual result and
+// messages.
+
+class Bytecode {
+public:
+    static Bytecode *   compile(Node *root);    // returns NULL if not eligible
+    ~Bytecode();
+    bool                run(MincFloat *result) const;
+private:
+    enum Opcode {
+        kPushConst,     // arg: index into _constants
+        kLoadSym,       // arg: index into _names
+        kAdd, kSub, kMul, kDiv, kMod, kPow, kNeg,
+        kEqual, kNotEqual, kLess, kGreater, kLessEqual, kGreaterEqual,
+        kNot,
+        kJumpIfFalse,   // pops; arg: target instruction
+        kJumpIfTrue,    // pops; arg: target instruction
+        kJump,          // arg: target instruction
+        kEnd
+    };
+    struct Instruction {
+        int opcode;
+        int arg;
+    };
+    Bytecode();
+    bool                emitTree(Node *node, int depth);
+    int                 emit(int opcode, int arg=0);
+    std::vector<Instruction>    _code;
+    std::vector<MincFloat>      _constants;
+    std::vector<const char *>   _names;
+};
+
+#endif /* Bytecode_h */
@@ -14,8 +14,19 @@
 #include "Node.h"
 #include "Scope.h"
 #include "Symbol.h"
+#include <MemStats.h>
 #include <string.h>
 
+// What a list or map is charged to MemStats for each element.  A map entry
+// costs its key, its value and a tree node around them.
+
+static inline long long listBytes(int len)
+{
+    return (long long) len * sizeof(MincValue);
+}
+
+static const long long kMapEntryBytes = 2 * sizeof(MincValue) + 4 * sizeof(void *);
+
 /* ========================================================================== */
 /* MincList */
 
@@ -24,6 +35,7 @@ MincList::MincList(int inLen) : len(inLen), data(NULL)
     ENTER();
     if (inLen > 0) {
         data = new MincValue[len];
+        MemStats::add(MemStats::kMinc, listBytes(len));
     }
 #ifdef DEBUG_MINC_MEMORY
     MPRINT("MincList::MincList: %p alloc'd with len %d\n", this, inLen);
@@ -41,6 +53,7 @@ MincList::~MincList()
 #endif
         delete [] data;
         data = NULL;
+        MemStats::add(MemStats::kMinc, -listBytes(len));
     }
 #ifdef DEBUG_MINC_MEMORY
     MPRINT("\tdone\n");
@@ -60,6 +73,7 @@ MincList::resize(int newLen)
     for (; i < newLen; i++) {
         data[i] = 0.0;
     }
+    MemStats::add(MemStats::kMinc, listBytes(newLen) - (oldList ? listBytes(len) : 0));
     len = newLen;
     delete [] oldList;
 }
@@ -144,6 +158,15 @@ MincMap::~MincMap()
 #ifdef DEBUG_MINC_MEMORY
     MPRINT("deleting MincMap %p\n", this);
 #endif
+    MemStats::add(MemStats::kMinc, -kMapEntryBytes * len());
+}
+
+void MincMap::set(const MincValue &key, const MincValue &value)
+{
+    const int oldLen = len();
+    map[key] = value;
+    if (len() > oldLen)
+        MemStats::add(MemStats::kMinc, kMapEntryBytes);
 }
 
 bool MincMap::contains(const MincValue &element)
@@ -48,6 +48,8 @@ public:
     MincMap();
     int len() const { return (int) map.size(); }
     bool contains(const MincValue &element);
+    // Store <value> at <key>, charging any new entry to MemStats.
+    void set(const MincValue &key, const MincValue &value);
     std::map<MincValue, MincValue, MincValueCmp> map;
     void        print();
 protected:
@@ -43,6 +43,7 @@
 #include "debug.h"
 
 #include "Node.h"
+#include "Bytecode.h"
 #include "MincValue.h"
 #include "Scope.h"
 #include "Symbol.h"
@@ -66,10 +67,17 @@ extern "C" {
 /* builtin.cpp */
 extern int call_builtin_function(const char *funcname, const MincValue arglist[],
                           const int nargs, MincValue *retval);
+extern int find_builtin_function(const char *funcname);
+extern int call_builtin_function_at(int index, const MincValue arglist[],
+                          int nargs, MincValue *retval);
 
 /* callextfunc.cpp */
 extern int call_external_function(const char *funcname, const MincValue arglist[],
                            const int nargs, MincValue *return_value);
+extern int call_external_function(const char *funcname, const MincValue arglist[],
+                           const int nargs, MincValue *return_value,
+                           ExternalCallCache **cache);
+extern void free_external_call_cache(ExternalCallCache *cache);
 extern MincHandle minc_binop_handle_float(const MincHandle handle, const MincFloat val, OpKind op);
 extern MincHandle minc_binop_float_handle(const MincFloat val, const MincHandle handle, OpKind op);
 extern MincHandle minc_binop_handles(const MincHandle handle1, const MincHandle handle2, OpKind op);
@@ -86,6 +94,10 @@ static int sMincListLen;
 static MincValue *list_stack[MAXSTACK];
 static int list_len_stack[MAXSTACK];
 static int list_stack_ptr;
+/* The arrays themselves are kept for reuse, one per stack level, since
+   push_list runs for every function call.
+*/
+static MincValue *list_pool[MAXSTACK];
 
 static StructType *sNewStructType;  // struct currently being defined
 
@@ -114,6 +126,7 @@ void clear_tree_state()
 	for (int n = 0; n < MAXSTACK; ++n) {
 		list_stack[n] = NULL;
 		list_len_stack[n] = 0;
+		list_pool[n] = NULL;	// abandoned, like the lists above
 	}
 	list_stack_ptr = 0;
     sMethodThisSymbols.clear();
@@ -234,7 +247,8 @@ static int numNodes = 0;
 /* Tree nodes */
 
 Node::Node(OpKind op, NodeKind kind)
-	: kind(kind), op(op), lineno(yyget_lineno()), includeFilename(yy_get_current_include_filename())
+	: kind(kind), op(op), lineno(yyget_lineno()), includeFilename(yy_get_current_include_filename()),
+	  _code(NULL), _codeState(CodeUntried)
 {
 	NPRINT("Node::Node (%s) this=%p storing lineno %d, includefile '%s'\n", classname(), this, lineno, includeFilename);
 #ifdef DEBUG_NODE_MEMORY
@@ -251,6 +265,7 @@ Node::~Node()
 	--numNodes;
     NPRINT("[%d nodes remaining]\n", numNodes);
 #endif
+	delete _code;
 }
 
 const char * Node::name() const
@@ -302,6 +317,42 @@ Node *	Node::exct()
 	return outNode;
 }
 
+/* An expression node runs as a tree the first time, so that its children
+   hold the same values and types they would have in a tree-only run.  The
+   second time, we try to compile it, and use the compiled code until a
+   variable shows up with a non-float value.  After that, the expression
+   always runs as a tree.
+ */
+bool
+Node::runCompiled()
+{
+	switch (_codeState) {
+	case CodeUntried:
+		_codeState = CodeRanOnce;
+		return false;
+	case CodeRanOnce:
+		_code = Bytecode::compile(this);
+		_codeState = (_code != NULL) ? CodeCompiled : CodeRejected;
+		if (_code == NULL)
+			return false;
+		/* fall through */
+	case CodeCompiled:
+	{
+		MincFloat result;
+		if (_code->run(&result)) {
+			v = result;
+			return true;
+		}
+		delete _code;
+		_code = NULL;
+		_codeState = CodeRejected;
+		return false;
+	}
+	default:
+		return false;
+	}
+}
+
 /* This copies a node's value and handles ref counting when necessary */
 Node *
 Node::copyValue(Node *source, bool allowTypeOverwrite)
@@ -944,7 +995,7 @@ void    NodeSubscriptWrite::writeWithMapKey()
     if (theMap == NULL) {
         child(0)->symbol()->value() = theMap = new MincMap();
     }
-    theMap->map[valueIndex] = child(2)->value();
+    theMap->set(valueIndex, child(2)->value());
 }
 
 Node *	NodeSubscriptWrite::doExct()	// was exct_subscript_write()
@@ -1105,12 +1156,21 @@ void NodeCall::callBuiltinFunction(const char *functionName)
     if (!functionName) {
         minc_die("string variable called as function is NULL");
     }
+    // Look the name up once per call site.  The name only changes when it
+    // comes from a string variable.
+    if (_callName == NULL || strcmp(_callName, functionName) != 0) {
+        free(_callName);
+        _callName = strdup(functionName);
+        _builtinIndex = find_builtin_function(functionName);
+        free_external_call_cache(_externalCache);
+        _externalCache = NULL;
+    }
     MincValue retval;
-    int result = call_builtin_function(functionName, sMincList, sMincListLen,
-                                       &retval);
+    int result = call_builtin_function_at(_builtinIndex, sMincList, sMincListLen,
+                                          &retval);
     if (result == FUNCTION_NOT_FOUND) {
         result = call_external_function(functionName, sMincList, sMincListLen,
-                                        &retval);
+                                        &retval, &_externalCache);
     }
     this->setValue(retval);
     switch (result) {
@@ -1127,6 +1187,12 @@ void NodeCall::callBuiltinFunction(const char *functionName)
     }
 }
 
+NodeCall::~NodeCall()
+{
+    free(_callName);
+    free_external_call_cache(_externalCache);
+}
+
 Node *	NodeCall::doExct()
 {
     ENTER();
@@ -1233,6 +1299,8 @@ Node *	NodeOpAssign::doExct()		// was exct_opassign()
 
 Node *	NodeNot::doExct()
 {
+	if (runCompiled())
+		return this;
 	if ((bool)child(0)->exct()->value() == false)
 		this->value() = 1.0;
 	else
@@ -1242,6 +1310,8 @@ Node *	NodeNot::doExct()
 
 Node *	NodeAnd::doExct()
 {
+	if (runCompiled())
+		return this;
 	this->value() = 0.0;
 	if ((bool)child(0)->exct()->value() == true) {
 		if ((bool)child(1)->exct()->value() == true) {
@@ -1254,6 +1324,8 @@ Node *	NodeAnd::doExct()
 Node *	NodeRelation::doExct()		// was exct_relation()
 {
 	ENTER();
+	if (runCompiled())
+		return this;
 	MincValue& v0 = child(0)->exct()->value();
 	MincValue& v1 = child(1)->exct()->value();
 	
@@ -1296,6 +1368,8 @@ Node *	NodeRelation::doExct()		// was exct_relation()
 Node *	NodeOp::doExct()
 {
 	ENTER();
+	if (runCompiled())
+		return this;
 	MincValue& v0 = child(0)->exct()->value();
 	MincValue& v1 = child(1)->exct()->value();
 	switch (v0.dataType()) {
@@ -1431,6 +1505,8 @@ Node *	NodeOp::doExct()
 
 Node *	NodeUnaryOperator::doExct()
 {
+	if (runCompiled())
+		return this;
 	if (this->op == OpNeg)
 		this->value() = -1 * (MincFloat)child(0)->exct()->value();
 	return this;
@@ -1438,6 +1514,8 @@ Node *	NodeUnaryOperator::doExct()
 
 Node *	NodeOr::doExct()
 {
+	if (runCompiled())
+		return this;
 	this->value() = 0.0;
 	if (((bool)child(0)->exct()->value() == true) ||
 		((bool)child(1)->exct()->value() == true)) {
@@ -1755,8 +1833,10 @@ push_list()
       minc_die("stack overflow: too many nested list levels or function calls");
     }
    list_stack[list_stack_ptr] = sMincList;
-   list_len_stack[list_stack_ptr++] = sMincListLen;
-   sMincList = new MincValue[MAXDISPARGS];
+   list_len_stack[list_stack_ptr] = sMincListLen;
+   if (list_pool[list_stack_ptr] == NULL)
+      list_pool[list_stack_ptr] = new MincValue[MAXDISPARGS];
+   sMincList = list_pool[list_stack_ptr++];
    TPRINT("push_list: sMincList=%p at new stack level %d, len %d\n", sMincList, list_stack_ptr, sMincListLen);
    sMincListLen = 0;
 }
@@ -1767,7 +1847,10 @@ pop_list()
 {
     ENTER();
     TPRINT("pop_list: sMincList=%p\n", sMincList);
-    delete [] sMincList;
+    // Release what the list holds, but keep the array for the next push.
+    const MincValue empty;
+    for (int n = 0; n < sMincListLen; ++n)
+        sMincList[n] = empty;
     if (list_stack_ptr == 0)
         minc_die("stack underflow");
     sMincList = list_stack[--list_stack_ptr];
@@ -23,6 +23,9 @@ static char sBuf[256];
 #define NPRINT(...)
 #endif
 
+class Bytecode;
+struct ExternalCallCache;
+
 /* intermediate tree representation */
 
 typedef enum {
@@ -70,6 +73,7 @@ typedef enum {
 
 class Node : public MincObject, public RefCounted
 {
+	friend class Bytecode;
 //protected:					TODO: FINISH FULL CLASS
 public:
 	NodeKind        kind;
@@ -97,12 +101,19 @@ public:
 protected:
     virtual             ~Node();
 	virtual Node*		doExct() = 0;
+	// Numeric fast path for expression nodes (see Bytecode.h).  Returns
+	// true if the value was computed and stored into v.
+	bool				runCompiled();
 protected:
 	union {
 		Symbol *symbol;
 		double number;
 		const char *string;
 	} u;
+private:
+	enum { CodeUntried, CodeRanOnce, CodeCompiled, CodeRejected };
+	Bytecode *			_code;
+	int					_codeState;
 };
 
 class NodeNoop : public Node
@@ -220,6 +231,7 @@ protected:
  */
 class NodeLoadSym : public Node
 {
+	friend class Bytecode;
 public:
 	NodeLoadSym(const char *symbolName) : Node(OpFree, eNodeLoadSym), _symbolName(symbolName) {
 		NPRINT("NodeLoadSym('%s') => %p\n", symbolName, this);
@@ -393,15 +405,21 @@ public:
 class NodeCall : public Node2Children
 {
 public:
-	NodeCall(Node *func, Node *args) : Node2Children(OpFree, eNodeCall, func, args) {
+	NodeCall(Node *func, Node *args) : Node2Children(OpFree, eNodeCall, func, args),
+        _callName(NULL), _builtinIndex(-1), _externalCache(NULL) {
 		NPRINT("NodeCall(%p, %p) => %p\n", func, args, this);
 	}
 protected:
+    virtual             ~NodeCall();
 	virtual Node*		doExct();
 private:
     void                callMincFunctionFromNode(Node *functionNode);
     void                callListFunction(const char *functionName);
     void                callBuiltinFunction(const char *functionName);
+    // Cached lookup of the builtin or RTcmix function named _callName
+    char *              _callName;
+    int                 _builtinIndex;
+    ExternalCallCache * _externalCache;
 };
 
 class NodeAnd : public Node2Children
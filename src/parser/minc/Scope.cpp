@@ -68,7 +68,7 @@ Symbol *
 Scope::install(const char *name)
 {
     Symbol *p = Symbol::create(name);
-    int h = hash(name);        // TODO: FINISH COMBINING THIS INTO SYMBOL CREATOR
+    int h = string_hash(name);        // TODO: FINISH COMBINING THIS INTO SYMBOL CREATOR
     p->next = htab[h];
     p->_scope = depth();
     htab[h] = p;
@@ -83,7 +83,7 @@ Symbol *
 Scope::lookup(const char *name) const
 {
     Symbol *p = NULL;
-    int hashIndex = hash(name);
+    int hashIndex = string_hash(name);
     for (p = htab[hashIndex]; p != NULL; p = p->next) {
         if (name == p->name()) {
             break;
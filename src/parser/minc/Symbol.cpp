@@ -18,6 +18,7 @@ static const char *dname(int x);
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 #include <vector>
@@ -154,9 +155,15 @@ void Symbol::initAsStruct(const StructType *structType, MincList *initList)
     structType->forEachMember(functor);
 }
 
+/* Identifiers are interned here when the lexer sees them, and everything
+   downstream compares and stores these pointers.  Each entry also keeps its
+   bucket index, so Scope lookups can use string_hash() instead of hashing
+   the characters again.
+*/
 static struct str {             /* string table */
-    char *str;                   /* string */
     struct str *next;            /* next entry */
+    int hashIndex;               /* hash(str), cached */
+    char str[1];                 /* string (allocated to length) */
 } *stab[HASHSIZE] = {
     0
 };
@@ -172,15 +179,11 @@ strsave(const char *str)
     for (p = stab[h]; p != NULL; p = p->next)
         if (strcmp(str, p->str) == 0)
             return (p->str);
-    p = (struct str *) emalloc(sizeof(struct str));
+    p = (struct str *) emalloc(offsetof(struct str, str) + strlen(str) + 1);
     if (p == NULL)
         return NULL;
-    p->str = (char *) emalloc(strlen(str) + 1);
-    if (p->str == NULL) {
-        efree(p);
-        return NULL;
-    }
     strcpy(p->str, str);
+    p->hashIndex = h;
     p->next = stab[h];
     stab[h] = p;
     
@@ -190,6 +193,15 @@ strsave(const char *str)
     return p->str;
 }
 
+/* Return the hash bucket for <str>, which must be a pointer returned by
+   strsave.
+*/
+int
+string_hash(const char *str)
+{
+    return ((const struct str *) (str - offsetof(struct str, str)))->hashIndex;
+}
+
 void
 free_symbols()
 {
@@ -199,7 +211,6 @@ free_symbols()
 		struct str *str;
 		for (str = stab[s]; str != NULL; ) {
 			struct str *next = str->next;
-			free(str->str);
 			free(str);
 			str = next;
 		}
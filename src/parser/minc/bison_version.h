@@ -0,0 +1 @@
+#define BISON_VERSION 3
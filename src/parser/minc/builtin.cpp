@@ -6,12 +6,17 @@
 #include "MincValue.h"
 #include "Symbol.h"
 #include <stdlib.h>
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <RTOption.h>
 #include <ugens.h>
 #include <rtdefs.h>
+#include <RTcmix.h>
+#include <rtcmix_types.h>
+#include <vector>
+#include <algorithm>
 
 /* Minc builtin functions, for use only in Minc scripts.
    To add a builtin function, make an entry for it in the function ptr array
@@ -29,9 +34,20 @@ static MincFloat _minc_len(const MincValue args[], int nargs);
 static MincFloat _minc_interp(const MincValue args[], int nargs);
 static MincFloat _minc_index(const MincValue args[], int nargs);
 static MincFloat _minc_contains(const MincValue args[], int nargs);
+static MincFloat _minc_schedule(const MincValue args[], int nargs);
 static MincString _minc_type(const MincValue args[], int nargs);
 static MincString _minc_tostring(const MincValue args[], int nargs);
 static MincString _minc_substring(const MincValue args[], int nargs);
+static MincFloat _minc_sum(const MincValue args[], int nargs);
+static MincList *_minc_range(const MincValue args[], int nargs);
+static MincList *_minc_linspace(const MincValue args[], int nargs);
+static MincList *_minc_scale(const MincValue args[], int nargs);
+static MincList *_minc_sort(const MincValue args[], int nargs);
+static MincList *_minc_resample(const MincValue args[], int nargs);
+static MincList *_minc_vadd(const MincValue args[], int nargs);
+static MincList *_minc_vsub(const MincValue args[], int nargs);
+static MincList *_minc_vmul(const MincValue args[], int nargs);
+static MincList *_minc_vdiv(const MincValue args[], int nargs);
 
 /* other prototypes */
 static int _find_builtin(const char *funcname);
@@ -44,6 +60,7 @@ static struct _builtins {
    const char *label;
    MincFloat (*number_return)(const MincValue *, int); /* func name for those returning MincFloat */
    MincString (*string_return)(const MincValue *, int);   /* func name for those returning char * */
+   MincList *(*list_return)(const MincValue *, int);    /* func name for those returning a list */
 } builtin_funcs[] = {
    { "print",     _minc_print,   NULL },
    { "printf",    _minc_printf,  NULL },
@@ -52,10 +69,21 @@ static struct _builtins {
    { "interp",    _minc_interp,  NULL },
    { "index",     _minc_index,   NULL },
    { "contains", _minc_contains, NULL },
+   { "schedule",  _minc_schedule, NULL },
    { "type",      NULL,          _minc_type },
    { "tostring",  NULL,          _minc_tostring },
    { "substring", NULL,          _minc_substring },
-   { NULL,        NULL,          NULL }         /* marks end of list */
+   { "sum",       _minc_sum,     NULL },
+   { "range",     NULL,          NULL,          _minc_range },
+   { "linspace",  NULL,          NULL,          _minc_linspace },
+   { "scale",     NULL,          NULL,          _minc_scale },
+   { "sort",      NULL,          NULL,          _minc_sort },
+   { "resample",  NULL,          NULL,          _minc_resample },
+   { "vadd",      NULL,          NULL,          _minc_vadd },
+   { "vsub",      NULL,          NULL,          _minc_vsub },
+   { "vmul",      NULL,          NULL,          _minc_vmul },
+   { "vdiv",      NULL,          NULL,          _minc_vdiv },
+   { NULL,        NULL,          NULL,          NULL }   /* marks end of list */
 };
 
 
@@ -75,10 +103,18 @@ _find_builtin(const char *funcname)
 }
 
 int
-call_builtin_function(const char *funcname, const MincValue arglist[],
+find_builtin_function(const char *funcname)
+{
+   return _find_builtin(funcname);
+}
+
+/* Call the builtin at <index>, as returned by find_builtin_function.  This
+   lets a call site that has already looked up its function skip the search.
+*/
+int
+call_builtin_function_at(int index, const MincValue arglist[],
    int nargs, MincValue *retval)
 {
-   int index = _find_builtin(funcname);
    if (index < 0)
       return FUNCTION_NOT_FOUND;
    if (builtin_funcs[index].number_return) {
@@ -89,9 +125,20 @@ call_builtin_function(const char *funcname, const MincValue arglist[],
       *retval = (MincString) (*(builtin_funcs[index].string_return))
                                                          (arglist, nargs);
    }
+   else if (builtin_funcs[index].list_return) {
+      *retval = (*(builtin_funcs[index].list_return))(arglist, nargs);
+   }
    return 0;
 }
 
+int
+call_builtin_function(const char *funcname, const MincValue arglist[],
+   int nargs, MincValue *retval)
+{
+   return call_builtin_function_at(_find_builtin(funcname), arglist, nargs,
+                                   retval);
+}
+
 
 /* ============================================= print, printf and friends == */
 
@@ -712,6 +759,96 @@ _minc_contains(const MincValue args[], int nargs)
     }
 }
 
+/* -------------------------------------------------------------- schedule -- */
+/* Make many notes in one call:
+
+      schedule("WAVETABLE", starts, durs, amps, freqs, 0.5, wavetable)
+
+   makes one WAVETABLE note for each item of the list arguments, which must
+   all be lists of numbers of the same length.  The other arguments --
+   numbers, strings and handles -- are the same for every note.  (So a
+   table for each note must be a handle made by maketable, not a list.)
+   The instrument is looked up once, and the notes are made in a loop in
+   C++, instead of one script call apiece.  Returns the number of notes made.
+*/
+// Arg can't be copied into a std::vector, so this frees them if we die.
+struct ScheduleArgs {
+   ScheduleArgs(int n) : args(new Arg[n]) {}
+   ~ScheduleArgs() { delete [] args; }
+   Arg *args;
+};
+
+MincFloat
+_minc_schedule(const MincValue args[], int nargs)
+{
+   if (nargs < 2 || args[0].dataType() != MincStringType) {
+      minc_die("usage: schedule(\"INSTNAME\", p0_list, p1_list, ...)");
+      return 0;
+   }
+   const char *instname = (MincString) args[0];
+   const int nfields = nargs - 1;
+   if (nfields > MAXDISPARGS) {
+      minc_die("schedule: too many arguments");
+      return 0;
+   }
+   ScheduleArgs fixedArgs(nfields);
+   Arg *fixed = fixedArgs.args;
+   std::vector<std::vector<double> > values(nfields);
+   std::vector<const double *> columns(nfields, (const double *) NULL);
+   int nnotes = -1;
+
+   for (int i = 0; i < nfields; i++) {
+      const MincValue &arg = args[i + 1];
+      switch (arg.dataType()) {
+         case MincFloatType:
+            fixed[i] = (MincFloat) arg;
+            break;
+         case MincStringType:
+            fixed[i] = (MincString) arg;
+            break;
+         case MincHandleType:
+            fixed[i] = (Handle) (MincHandle) arg;
+            break;
+         case MincListType:
+            {
+               const MincList *list = (MincList *) arg;
+               const int len = list ? list->len : 0;
+               if (nnotes >= 0 && len != nnotes) {
+                  minc_die("schedule: arg %d has %d items, not %d",
+                                                      i + 1, len, nnotes);
+                  return 0;
+               }
+               nnotes = len;
+               values[i].resize(len > 0 ? len : 1);
+               for (int n = 0; n < len; n++) {
+                  if (list->data[n].dataType() != MincFloatType) {
+                     minc_die("schedule: arg %d is not a list of numbers",
+                                                                     i + 1);
+                     return 0;
+                  }
+                  values[i][n] = (MincFloat) list->data[n];
+               }
+               columns[i] = &values[i][0];
+            }
+            break;
+         default:
+            minc_die("schedule: arg %d: invalid argument type", i + 1);
+            return 0;
+      }
+   }
+   if (nnotes < 0) {
+      minc_die("schedule: no argument is a list");
+      return 0;
+   }
+
+   int done = 0;
+   const int status = RTcmix::dispatchMany(instname, fixed, &columns[0],
+                                           nfields, nnotes, &done);
+   if (status != 0)
+      minc_die("schedule: note %d of %s() failed", done, instname);
+   return (MincFloat) done;
+}
+
 /* ------------------------------------------------------------------ type -- */
 /* Print the object type of the argument: float, string, handle, list, mincfunction, struct.
 */
@@ -779,3 +916,270 @@ _minc_substring(const MincValue args[], int nargs)
     sbuffer[endIdx - startIdx] = '\0';
     return strdup(sbuffer);
 }
+
+
+/* ================================================= numeric list functions == */
+/* These work on lists of numbers in one pass in C++, for building envelopes,
+   pitch sets and the like without a Minc loop.  Each returns a new list,
+   or an empty one (with a warning) if its arguments are wrong.
+*/
+
+/* Return the <len> values of the list <arg> in <values>, or false (with a
+   warning) if it is not a list of numbers.
+*/
+static bool
+_float_values(const MincValue &arg, const char *funcname,
+   std::vector<MincFloat> &values)
+{
+   if (arg.dataType() != MincListType) {
+      minc_warn("%s: argument must be a list", funcname);
+      return false;
+   }
+   const MincList *list = (MincList *) arg;
+   const int len = list ? list->len : 0;
+   values.resize(len);
+   for (int i = 0; i < len; i++) {
+      if (list->data[i].dataType() != MincFloatType) {
+         minc_warn("%s: list must contain only numbers", funcname);
+         return false;
+      }
+      values[i] = (MincFloat) list->data[i];
+   }
+   return true;
+}
+
+static MincList *
+_make_list(const MincFloat *values, int len)
+{
+   MincList *list = new MincList(len);
+   for (int i = 0; i < len; i++)
+      list->data[i] = values[i];
+   return list;
+}
+
+/* ------------------------------------------------------------------- sum -- */
+/* Return the sum of a list of numbers.
+*/
+MincFloat
+_minc_sum(const MincValue args[], int nargs)
+{
+   std::vector<MincFloat> values;
+   if (nargs != 1) {
+      minc_warn("sum: must have one argument (list)");
+      return 0.0;
+   }
+   if (!_float_values(args[0], "sum", values))
+      return 0.0;
+   MincFloat sum = 0.0;
+   for (size_t i = 0; i < values.size(); i++)
+      sum += values[i];
+   return sum;
+}
+
+/* ----------------------------------------------------------------- range -- */
+/* range(start, end[, step]) returns start, start + step, ... up to but not
+   including end.  The default step is 1.
+*/
+MincList *
+_minc_range(const MincValue args[], int nargs)
+{
+   if (nargs < 2 || nargs > 3 || args[0].dataType() != MincFloatType
+         || args[1].dataType() != MincFloatType
+         || (nargs == 3 && args[2].dataType() != MincFloatType)) {
+      minc_warn("range: arguments are (start, end[, step])");
+      return new MincList(0);
+   }
+   const MincFloat start = (MincFloat) args[0];
+   const MincFloat end = (MincFloat) args[1];
+   const MincFloat step = (nargs == 3) ? (MincFloat) args[2] : 1.0;
+   if (step == 0.0) {
+      minc_warn("range: step can't be zero");
+      return new MincList(0);
+   }
+   const double count = ceil((end - start) / step);
+   if (count > 1e8) {
+      minc_warn("range: too many values");
+      return new MincList(0);
+   }
+   const int len = (count > 0.0) ? (int) count : 0;
+   MincList *list = new MincList(len);
+   for (int i = 0; i < len; i++)
+      list->data[i] = start + i * step;
+   return list;
+}
+
+/* -------------------------------------------------------------- linspace -- */
+/* linspace(start, end, count) returns <count> values evenly spaced from
+   start to end, including both.
+*/
+MincList *
+_minc_linspace(const MincValue args[], int nargs)
+{
+   if (nargs != 3 || args[0].dataType() != MincFloatType
+         || args[1].dataType() != MincFloatType
+         || args[2].dataType() != MincFloatType) {
+      minc_warn("linspace: arguments are (start, end, count)");
+      return new MincList(0);
+   }
+   const MincFloat start = (MincFloat) args[0];
+   const MincFloat end = (MincFloat) args[1];
+   const int len = (int) (MincFloat) args[2];
+   if (len < 0) {
+      minc_warn("linspace: count can't be negative");
+      return new MincList(0);
+   }
+   MincList *list = new MincList(len);
+   const MincFloat step = (len > 1) ? (end - start) / (len - 1) : 0.0;
+   for (int i = 0; i < len; i++)
+      list->data[i] = start + i * step;
+   if (len > 1)
+      list->data[len - 1] = end;
+   return list;
+}
+
+/* ----------------------------------------------------------------- scale -- */
+/* scale(list, mul[, add]) returns each value times <mul>, plus <add>.
+*/
+MincList *
+_minc_scale(const MincValue args[], int nargs)
+{
+   std::vector<MincFloat> values;
+   if (nargs < 2 || nargs > 3 || args[1].dataType() != MincFloatType
+         || (nargs == 3 && args[2].dataType() != MincFloatType)) {
+      minc_warn("scale: arguments are (list, mul[, add])");
+      return new MincList(0);
+   }
+   if (!_float_values(args[0], "scale", values))
+      return new MincList(0);
+   const MincFloat mul = (MincFloat) args[1];
+   const MincFloat add = (nargs == 3) ? (MincFloat) args[2] : 0.0;
+   for (size_t i = 0; i < values.size(); i++)
+      values[i] = values[i] * mul + add;
+   return _make_list(values.empty() ? NULL : &values[0], values.size());
+}
+
+/* ------------------------------------------------------------------ sort -- */
+/* Return a list of numbers sorted into ascending order.
+*/
+MincList *
+_minc_sort(const MincValue args[], int nargs)
+{
+   std::vector<MincFloat> values;
+   if (nargs != 1) {
+      minc_warn("sort: must have one argument (list)");
+      return new MincList(0);
+   }
+   if (!_float_values(args[0], "sort", values))
+      return new MincList(0);
+   std::sort(values.begin(), values.end());
+   return _make_list(values.empty() ? NULL : &values[0], values.size());
+}
+
+/* -------------------------------------------------------------- resample -- */
+/* resample(list, count) returns <count> values interpolated from those in
+   the list, from the first to the last, as interp() would give them for
+   fractions evenly spaced from 0 to 1.
+*/
+MincList *
+_minc_resample(const MincValue args[], int nargs)
+{
+   std::vector<MincFloat> values;
+   if (nargs != 2 || args[1].dataType() != MincFloatType) {
+      minc_warn("resample: arguments are (list, count)");
+      return new MincList(0);
+   }
+   if (!_float_values(args[0], "resample", values))
+      return new MincList(0);
+   const int len = (int) (MincFloat) args[1];
+   const int srclen = values.size();
+   if (len < 0 || srclen == 0) {
+      minc_warn("resample: need a list of numbers and a count of at least 0");
+      return new MincList(0);
+   }
+   MincList *list = new MincList(len);
+   for (int i = 0; i < len; i++) {
+      const MincFloat fraction = (len > 1) ? (MincFloat) i / (len - 1) : 0.0;
+      const MincFloat pos = fraction * (srclen - 1);
+      const int low = (int) pos;
+      const int high = min(srclen - 1, low + 1);
+      list->data[i] = values[low] + (pos - low) * (values[high] - values[low]);
+   }
+   return list;
+}
+
+/* -------------------------------------------------- vadd, vsub, vmul, vdiv -- */
+/* Elementwise arithmetic on two lists of numbers of the same length, or a
+   list and a number in either order.  (The + operator on two lists joins
+   them instead.)
+*/
+
+enum VectorOp { VAdd, VSub, VMul, VDiv };
+
+static MincList *
+_vector_op(const MincValue args[], int nargs, VectorOp op, const char *funcname)
+{
+   if (nargs != 2) {
+      minc_warn("%s: must have two arguments", funcname);
+      return new MincList(0);
+   }
+   std::vector<MincFloat> a, b;
+   MincFloat aval = 0.0, bval = 0.0;
+   const bool ascalar = args[0].dataType() == MincFloatType;
+   const bool bscalar = args[1].dataType() == MincFloatType;
+   if (ascalar && bscalar) {
+      minc_warn("%s: at least one argument must be a list", funcname);
+      return new MincList(0);
+   }
+   if (ascalar)
+      aval = (MincFloat) args[0];
+   else if (!_float_values(args[0], funcname, a))
+      return new MincList(0);
+   if (bscalar)
+      bval = (MincFloat) args[1];
+   else if (!_float_values(args[1], funcname, b))
+      return new MincList(0);
+   if (!ascalar && !bscalar && a.size() != b.size()) {
+      minc_warn("%s: lists must be the same length", funcname);
+      return new MincList(0);
+   }
+
+   const int len = ascalar ? b.size() : a.size();
+   MincList *list = new MincList(len);
+   for (int i = 0; i < len; i++) {
+      const MincFloat x = ascalar ? aval : a[i];
+      const MincFloat y = bscalar ? bval : b[i];
+      MincFloat result;
+      switch (op) {
+         case VAdd: result = x + y; break;
+         case VSub: result = x - y; break;
+         case VMul: result = x * y; break;
+         default:   result = x / y; break;
+      }
+      list->data[i] = result;
+   }
+   return list;
+}
+
+MincList *
+_minc_vadd(const MincValue args[], int nargs)
+{
+   return _vector_op(args, nargs, VAdd, "vadd");
+}
+
+MincList *
+_minc_vsub(const MincValue args[], int nargs)
+{
+   return _vector_op(args, nargs, VSub, "vsub");
+}
+
+MincList *
+_minc_vmul(const MincValue args[], int nargs)
+{
+   return _vector_op(args, nargs, VMul, "vmul");
+}
+
+MincList *
+_minc_vdiv(const MincValue args[], int nargs)
+{
+   return _vector_op(args, nargs, VDiv, "vdiv");
+}
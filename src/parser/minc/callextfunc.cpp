@@ -12,6 +12,7 @@
 #include <rtcmix_types.h>
 #include <prototypes.h>
 #include <PField.h>
+#include "ScoreImage.h"
 
 static Arg * minc_list_to_arglist(const char *funcname, const MincValue *inList, const int inListLen, Arg *inArgs, int *pNumArgs)
 {
@@ -73,9 +74,16 @@ static Arg * minc_list_to_arglist(const char *funcname, const MincValue *inList,
 	return newArgs;
 }
 
-int
-call_external_function(const char *funcname, const MincValue arglist[],
-	const int nargs, MincValue *return_value)
+// Remembers which RTcmix function or instrument a NodeCall resolved to, so
+// repeated calls from the same place in a script skip the name lookup.
+
+struct ExternalCallCache {
+	RTcmix::DispatchTarget target;
+};
+
+static int
+_call_external_function(const char *funcname, const MincValue arglist[],
+	const int nargs, MincValue *return_value, RTcmix::DispatchTarget *target)
 {
 	int result, numArgs = nargs;
 	Arg retval;
@@ -134,6 +142,7 @@ call_external_function(const char *funcname, const MincValue arglist[],
 				if (newarray == NULL)
 					return MEMORY_ERROR;
 				assert(sizeof(*newarray->data) == sizeof(double));	// because we cast MincFloat to double here
+				newarray->lease = NULL;
 				newarray->data = (double *) float_list_to_array(list);
 				if (newarray->data != NULL) {
 					newarray->len = list->len;
@@ -167,7 +176,10 @@ call_external_function(const char *funcname, const MincValue arglist[],
 	}
     } minc_catch(delete [] rtcmixargs;)
 
-	result = RTcmix::dispatch(funcname, rtcmixargs, numArgs, &retval);
+	if (target != NULL)
+		result = RTcmix::dispatch(funcname, target, rtcmixargs, numArgs, &retval);
+	else
+		result = RTcmix::dispatch(funcname, rtcmixargs, numArgs, &retval);
    
 	// Convert return value from RTcmix function.
 	switch (retval.type()) {
@@ -202,6 +214,33 @@ call_external_function(const char *funcname, const MincValue arglist[],
 	return result;
 }
 
+int
+call_external_function(const char *funcname, const MincValue arglist[],
+	const int nargs, MincValue *return_value)
+{
+	return _call_external_function(funcname, arglist, nargs, return_value, NULL);
+}
+
+// As above, using (and creating, the first time) the lookup cache in <cache>.
+// The caller must pass the same name each time, and release the cache with
+// free_external_call_cache().
+
+int
+call_external_function(const char *funcname, const MincValue arglist[],
+	const int nargs, MincValue *return_value, ExternalCallCache **cache)
+{
+	if (*cache == NULL)
+		*cache = new ExternalCallCache;
+	return _call_external_function(funcname, arglist, nargs, return_value,
+								   &(*cache)->target);
+}
+
+void
+free_external_call_cache(ExternalCallCache *cache)
+{
+	delete cache;
+}
+
 void printargs(const char *funcname, const Arg arglist[], const int nargs)
 {
 	RTcmix::printargs(funcname, arglist, nargs);
@@ -273,11 +312,40 @@ PField *createBinopPField(PField *pfield1, PField *pfield2, OpKind op)
 		return NULL;
 	}
 
-	// create new Binop PField, return it cast to MincHandle
+	// create new Binop PField, return it cast to MincHandle.  Sums and
+	// products get their own classes, which PFieldProgram can optimize.
 
+	if (op == OpPlus)
+		return new AddPField(pfield1, pfield2);
+	if (op == OpMul)
+		return new MultPField(pfield1, pfield2);
 	return new PFieldBinaryOperator(pfield1, pfield2, binop);
 }
 
+// A score image cannot hold a PField, only the call that made it, so save
+// the operation as the equivalent call to add(), sub(), mul() or div().
+
+static void recordBinop(const Arg &arg1, const Arg &arg2, OpKind op,
+	Handle result)
+{
+	const char *name = NULL;
+	switch (op) {
+	case OpPlus:	name = "add"; break;
+	case OpMinus:	name = "sub"; break;
+	case OpMul:		name = "mul"; break;
+	case OpDiv:		name = "div"; break;
+	default:
+		ScoreImage::invalidate("% and ^ on tables or pfields cannot be saved");
+		return;
+	}
+	Arg args[2];
+	args[0] = arg1;
+	args[1] = arg2;
+	Arg retval;
+	retval = result;
+	ScoreImage::addCall(name, args, 2, retval);
+}
+
 MincHandle minc_binop_handle_float(const MincHandle mhandle,
 	const MincFloat val, OpKind op)
 {
@@ -301,7 +369,14 @@ MincHandle minc_binop_handle_float(const MincHandle mhandle,
 	// Create PField using appropriate operator.
 	PField *outpfield = createBinopPField(pfield1, pfield2, op);
 
-	return (MincHandle) _createPFieldHandle(outpfield);
+	Handle outhandle = _createPFieldHandle(outpfield);
+	if (ScoreImage::recording()) {
+		Arg arg1, arg2;
+		arg1 = handle;
+		arg2 = (double) val;
+		recordBinop(arg1, arg2, op, outhandle);
+	}
+	return (MincHandle) outhandle;
 }
 
 MincHandle minc_binop_float_handle(const MincFloat val,
@@ -329,7 +404,14 @@ MincHandle minc_binop_float_handle(const MincFloat val,
 	// Create PField using appropriate operator.
 	PField *outpfield = createBinopPField(pfield1, pfield2, op);
 
-	return (MincHandle) _createPFieldHandle(outpfield);
+	Handle outhandle = _createPFieldHandle(outpfield);
+	if (ScoreImage::recording()) {
+		Arg arg1, arg2;
+		arg1 = (double) val;
+		arg2 = handle;
+		recordBinop(arg1, arg2, op, outhandle);
+	}
+	return (MincHandle) outhandle;
 }
 
 MincHandle minc_binop_handles(const MincHandle mhandle1,
@@ -355,6 +437,13 @@ MincHandle minc_binop_handles(const MincHandle mhandle1,
 
 	// create Handle for new PField, return it cast to MincHandle
 
-	return (MincHandle) _createPFieldHandle(opfield);
+	Handle outhandle = _createPFieldHandle(opfield);
+	if (ScoreImage::recording()) {
+		Arg arg1, arg2;
+		arg1 = handle1;
+		arg2 = handle2;
+		recordBinop(arg1, arg2, op, outhandle);
+	}
+	return (MincHandle) outhandle;
 }
 
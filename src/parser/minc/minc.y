@@ -60,6 +60,7 @@ static const char *   sCurrentStructname = NULL;   /* set to struct name if we a
 static int      xblock = 0;		/* 1 if we are entering a block preceeded by if(), else(), while(), or for() */
 static bool     preserve_symbols = false;   /* what to do with symbol table at end of parse */
 static void 	cleanup();
+static void		keepProgram(Node *prog);
 static void 	incrLevel();
 static void		decrLevel();
 static void     incrFunctionLevel();
@@ -113,7 +114,7 @@ static Node * go(Node * t1);
 
 %%
 /* program (the "start symbol") */
-prg:	| stml				{ MPRINT("prg:"); program = $1; program->ref(); cleanup(); return 0; }
+prg:	| stml				{ MPRINT("prg:"); program = $1; program->ref(); keepProgram(program); cleanup(); return 0; }
 	;
  
 /* statement list */
@@ -833,7 +834,136 @@ double minc_memflush()
 	yy_init = 1;    /* whether we need to initialize */
 	yy_start = 0;   /* start state number */
 #endif
+	flush_program_cache();
 	return 1.0;
 }
 
+/* Programs kept for re-running, keyed on the text of the score buffer they
+   were parsed from.  A hit skips the lexer and parser: the kept tree is run
+   again at global scope, just as go() ran it statement by statement the
+   first time.  Symbols are looked up as the tree runs, so it sees the
+   current values of global variables.  Scores that include other files are
+   not kept, since those files may have changed.
+*/
+
+#define PROGRAM_CACHE_SIZE 16
+
+struct CachedProgram {
+	unsigned		hash;
+	int				length;
+	char *			text;
+	Node *			program;
+	unsigned long	lastUse;
+};
+
+static CachedProgram programCache[PROGRAM_CACHE_SIZE];
+static unsigned long programCacheClock = 0;
+static const char *	nextText = NULL;		/* text of the parse about to run */
+static int			nextLength = 0;
+static Node *		cachedProgram = NULL;	/* found by find_cached_program() */
+
+static unsigned
+textHash(const char *text, int length)
+{
+	unsigned h = 2166136261u;		/* FNV-1a */
+	for (int n = 0; n < length; ++n)
+		h = (h ^ (unsigned char) text[n]) * 16777619u;
+	return h;
+}
+
+static CachedProgram *
+lookupProgram(const char *text, int length, unsigned hash)
+{
+	for (int n = 0; n < PROGRAM_CACHE_SIZE; ++n) {
+		CachedProgram *entry = &programCache[n];
+		if (entry->program && entry->hash == hash && entry->length == length
+				&& memcmp(entry->text, text, length) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+static void
+keepProgram(Node *prog)
+{
+	const char *text = nextText;
+	nextText = NULL;
+	if (text == NULL || flerror || !includedFilenames.empty())
+		return;
+	const unsigned hash = textHash(text, nextLength);
+	if (lookupProgram(text, nextLength, hash) != NULL)
+		return;
+	/* Take an empty slot, or else the one used longest ago */
+	CachedProgram *entry = &programCache[0];
+	for (int n = 0; n < PROGRAM_CACHE_SIZE && entry->program; ++n) {
+		if (!programCache[n].program || programCache[n].lastUse < entry->lastUse)
+			entry = &programCache[n];
+	}
+	char *copy = (char *) malloc(nextLength);
+	if (copy == NULL)
+		return;
+	memcpy(copy, text, nextLength);
+	if (entry->program) {
+		RefCounted::unref(entry->program);
+		free(entry->text);
+	}
+	entry->hash = hash;
+	entry->length = nextLength;
+	entry->text = copy;
+	entry->program = prog;
+	entry->lastUse = ++programCacheClock;
+	prog->ref();
+	rtcmix_debug("keepProgram", "Keeping program tree %p", prog);
+}
+
+void cache_next_program(const char *text, int length)
+{
+	nextText = text;
+	nextLength = length;
+}
+
+int find_cached_program(const char *text, int length)
+{
+	CachedProgram *entry = lookupProgram(text, length, textHash(text, length));
+	if (entry == NULL)
+		return 0;
+	entry->lastUse = ++programCacheClock;
+	cachedProgram = entry->program;
+	return 1;
+}
+
+int run_cached_program()
+{
+	Node *prog = cachedProgram;
+	cachedProgram = NULL;
+	assert(prog != NULL);
+	rtcmix_debug("run_cached_program", "Running program tree %p", prog);
+	/* Our reference keeps the tree alive if the score flushes the cache.
+	   On failure, go() drops it. */
+	prog->ref();
+	go(prog);
+	prog->unref();
+	cleanup();
+	return 0;
+}
+
+void flush_program_cache()
+{
+	for (int n = 0; n < PROGRAM_CACHE_SIZE; ++n) {
+		CachedProgram *entry = &programCache[n];
+		if (entry->program) {
+			RefCounted::unref(entry->program);
+			entry->program = NULL;
+			free(entry->text);
+			entry->text = NULL;
+		}
+	}
+	nextText = NULL;
+	cachedProgram = NULL;
+}
+
+#else
+
+static void keepProgram(Node *) {}
+
 #endif
@@ -28,6 +28,14 @@ void preserveSymbols(bool preserve);
 void reset_parser();
 void clear_tree_state();	// The only exported function from Node.cpp
 
+#ifdef EMBEDDED
+/* Kept program trees, for score buffers that are sent again */
+void cache_next_program(const char *text, int length);
+int find_cached_program(const char *text, int length);
+int run_cached_program(void);
+void flush_program_cache(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
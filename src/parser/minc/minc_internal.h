@@ -173,6 +173,7 @@ enum ScopeLookupType { AnyLevel = 0, GlobalLevel = 1, ThisLevel = 2 };
 void printargs(const char *funcname, const Arg arglist[], const int nargs);
 
 char *strsave(const char *str);
+int string_hash(const char *str);      /* only for strings from strsave */
 void clear_elem(MincValue *);
 void unref_value_list(MincValue *);
 
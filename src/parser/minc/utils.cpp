@@ -123,13 +123,14 @@ void efree(void *mem)
 int
 hash(const char *s)
 {
-    int i = 0;
+    unsigned int h = 0;
     
+    // Multiply so that anagrams ("xy", "yx") land in different buckets.
     while (*s) {
-        i = (((unsigned int) *s + i) % HASHSIZE);
+        h = h * 31 + (unsigned char) *s;
         s++;
     }
-    return i;
+    return (int) (h % HASHSIZE);
 }
 
 /* floating point comparisons:
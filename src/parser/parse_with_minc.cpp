@@ -23,19 +23,19 @@ extern YY_BUFFER_STATE yy_scan_bytes(const char * buf, size_t len);
 extern "C" {
     extern int yyparse();
     extern int check_new_arg(const char *); /* Defined in minc/args.cpp */
-    static int run_parser(const char *caller);
+    static int run_parser(const char *caller, int (*parse)());
     int embedded_parse_score(const char *caller, char *thebuf, int buflen);
 }
 
 extern int yydebug;
 
 static int
-run_parser(const char *caller)
+run_parser(const char *caller, int (*parse)())
 {
     int status;
     try {
 //        yydebug = 1;
-        status = yyparse();
+        status = (*parse)();
     }
     catch (MincError err) {
         const char *errType = NULL;
@@ -114,7 +114,7 @@ int parse_score_buffer(const char *buffer, int buflen)
     (void) yy_scan_bytes(buffer, buflen);
     reset_parser();
     preserveSymbols(true);
-    return run_parser("parse_score_buffer");
+    return run_parser("parse_score_buffer", yyparse);
 }
 
 #ifndef EMBEDDED
@@ -144,7 +144,7 @@ parse_score(int argc, char *argv[], char **env)
 	aargc = aarg;	// doesn't count args we pulled out above
 	
     preserveSymbols(false);
-	status = run_parser("parse_score");
+	status = run_parser("parse_score", yyparse);
 	
 	return status;
 }
@@ -152,14 +152,23 @@ parse_score(int argc, char *argv[], char **env)
 #else
 
 /* ---------------------------------------------------------- embedded_parse_score --- */
-/* This is called by RTcmix_parseScore() from main.cpp */
+/* This is called by RTcmix_parseScore() from main.cpp.  Hosts tend to send
+   the same snippets over and over, so with the score_cache option on, the
+   tree parsed from each buffer is kept and run again when the same text
+   comes back.
+*/
 
 int embedded_parse_score(const char *caller, char *theBuf, int buflen)
 {
+    preserveSymbols(true);
+    if (RTOption::scoreCache() && find_cached_program(theBuf, buflen)) {
+        reset_parser();
+        return run_parser(caller, run_cached_program);
+    }
+    cache_next_program(RTOption::scoreCache() ? theBuf : NULL, buflen);
     YY_BUFFER_STATE buffer = yy_scan_bytes(theBuf, buflen);
     reset_parser();
-    preserveSymbols(true);
-    return run_parser(caller);
+    return run_parser(caller, yyparse);
 }
     
 #endif
@@ -10,6 +10,72 @@
 
 extern int perl_dispatch(const char *str, const Arg args[], int n_args, Arg *retarg);
 
+// Defined in src/rtcmix/utils.cpp
+
+extern void unrefArrayLease(ArrayLease *lease);
+extern void releaseArrayLeases(void);
+
+/* A reference to a string of packed doubles -- \pack("d*", @values) -- is
+   lent to RTcmix as an array, without a copy.  The string is made read-only
+   until RTcmix is done with it, so that Perl can't move or change it.
+*/
+
+typedef struct {
+   ArrayLease lease;
+   SV *sv;
+   int wasReadOnly;
+} PackedLease;
+
+static void
+release_packed(ArrayLease *lease)
+{
+   dTHX;
+   PackedLease *packed = (PackedLease *) lease->owner;
+   if (!packed->wasReadOnly)
+      SvREADONLY_off(packed->sv);
+   SvREFCNT_dec(packed->sv);
+   free(packed);
+}
+
+static Array *
+packed_array(SV *sv)
+{
+   STRLEN bytes;
+   char *ptr = SvPV(sv, bytes);
+   Array *array = (Array *) malloc(sizeof(Array));
+   array->len = bytes / sizeof(double);
+   if (((size_t) ptr % sizeof(double)) == 0) {
+      PackedLease *packed = (PackedLease *) malloc(sizeof(PackedLease));
+      packed->sv = SvREFCNT_inc(sv);
+      packed->wasReadOnly = SvREADONLY(sv) ? 1 : 0;
+      SvREADONLY_on(sv);
+      packed->lease.release = release_packed;
+      packed->lease.owner = packed;
+      packed->lease.refcount = 1;
+      packed->lease.next = NULL;
+      array->data = (double *) ptr;
+      array->lease = &packed->lease;
+   }
+   else {
+      array->data = (double *) malloc((array->len > 0 ? array->len : 1) * sizeof(double));
+      memcpy(array->data, ptr, array->len * sizeof(double));
+      array->lease = NULL;
+   }
+   return array;
+}
+
+static void
+free_array_arg(Arg *arg)
+{
+   if (arg->_type != ArrayType)
+      return;
+   if (arg->_val.array->lease)
+      unrefArrayLease(arg->_val.array->lease);
+   else
+      free(arg->_val.array->data);
+   free(arg->_val.array);
+}
+
 MODULE = RT     PACKAGE = RT
 
 SV *
@@ -27,6 +93,8 @@ handle_minc_function(...)
          stack_item = ST(0);
          function_name = SvPV_nolen(stack_item);
 		 
+		 releaseArrayLeases();
+
 		 args = (Arg *) malloc(sizeof(Arg) * items);
 		 if (args == NULL)
 			 croak("Memory failure in handle_minc_function!");
@@ -35,7 +103,12 @@ handle_minc_function(...)
 			Arg *arg = &args[i - 1];
             stack_item = ST(i);
 
-			if (SvROK(stack_item)) {
+			if (SvROK(stack_item) && SvPOK(SvRV(stack_item))
+										&& !SvIOK(SvRV(stack_item))) {
+				arg->_type = ArrayType;
+				arg->_val.array = packed_array(SvRV(stack_item));
+			}
+			else if (SvROK(stack_item)) {
 //				printf("DEBUG: handle_minc_function: argument[%d] was a reference\n", i-1);
 				arg->_type = HandleType;
 				arg->_val.handle = (Handle) SvIV(SvRV(stack_item));
@@ -83,6 +156,8 @@ handle_minc_function(...)
 			 }
 		 }
 		 else RETVAL = newSViv(iretval);
+		 for (i = 0; i < items - 1; i++)
+			 free_array_arg(&args[i]);
 		 free(args);
       }
    OUTPUT:
@@ -54,6 +54,7 @@ print "\nstatic PyMethodDef _rtcmix_methods[] = {\n";
 foreach $func (@functions) {
    print "   {\"$func\", _$func, METH_VARARGS},\n";
 }
+print "   {\"schedule_many\", _schedule_many, METH_VARARGS},\n";
 print "   {NULL, NULL}        // sentinel\n";
 print "};\n\n";
 
@@ -176,7 +176,7 @@ char *mkdtemp(char *);
         for (int i=0; i < x->num_inputs-1; i++)
                 inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
 
-        x->pfield_in = malloc(x->num_pinlets);
+        x->pfield_in = malloc(sizeof(float) * x->num_pinlets);
         //x->pfield_inlets = malloc(x->num_pinlets);
         for (short i=0; i< x->num_pinlets; i++)
         {
@@ -277,16 +277,10 @@ void rtcmix_tilde_dsp(t_rtcmix_tilde *x, t_signal **sp)
         x->RTcmix_setValuesCallback(rtcmix_valuescallback, x);
         x->RTcmix_setPrintCallback(rtcmix_printcallback, x);
 
-// allocate the RTcmix i/o transfer buffers
-        x->pd_inbuf = malloc(sizeof(float) * x->vector_size * x->num_inputs);
-        x->pd_outbuf = malloc(sizeof(float) * x->vector_size * x->num_outputs);
-
-        // zero out these buffers for UB
-        //for (int i = 0; i < (x->vector_size * x->num_inputs); i++) x->pd_inbuf[i] = 0.0;
-        //for (int i = 0; i < (x->vector_size * x->num_outputs); i++) x->pd_outbuf[i] = 0.0;
-
+        // RTcmix reads and writes Pd's signal vectors directly, so there are
+        // no transfer buffers.
         DEBUG(post("x->srate: %f, x->num_outputs: %d, x->vector_size %d, 1, 0", x->srate, x->num_outputs, x->vector_size); );
-        x->RTcmix_setAudioBufferFormat(AudioFormat_32BitFloat_Normalized, x->num_outputs);
+        x->RTcmix_setAudioBufferFormat(AudioFormat_32BitFloat_NonInterleaved_Normalized, x->num_outputs);
         x->RTcmix_setparams(x->srate, x->num_outputs, x->vector_size, true, 0);
 }
 
@@ -294,8 +288,8 @@ t_int *rtcmix_tilde_perform(t_int *w)
 {
         t_rtcmix_tilde *x = (t_rtcmix_tilde *)(w[1]);
         t_int vecsize = w[x->num_inputs + x->num_outputs + 2]; //number of samples per vector
-        float *in[x->num_inputs * vecsize]; //pointers to the input vectors
-        float *out[x->num_outputs * vecsize]; //pointers to the output vectors
+        float *in[x->num_inputs]; //pointers to the input vectors
+        float *out[x->num_outputs]; //pointers to the output vectors
 
         //int i = x->num_outputs * vecsize;
         //while (i--) out[i] = (float *)0.;
@@ -304,10 +298,8 @@ t_int *rtcmix_tilde_perform(t_int *w)
         x->checkForVals();
         x->checkForPrint();
 
-        for (int i = 0; i < x->num_pinlets; i++)
-        {
-                x->RTcmix_setPField(i, x->pfield_in[i]);
-        }
+        // pfield inlets are numbered from 1 in scores
+        x->RTcmix_setPFields(x->pfield_in, 1, x->num_pinlets);
 
         // reset queue and heap if signalled
         if (x->flushflag == true)
@@ -330,21 +322,9 @@ t_int *rtcmix_tilde_perform(t_int *w)
                 out[i] = (float *)( w[x->num_inputs + i + 2 ]);
         }
 
-        int j = 0;
-        for (int k = 0; k < vecsize; k++)
-        {
-                for (int i = 0; i < x->num_inputs; i++)
-                        (x->pd_inbuf)[j++] = *in[i]++;
-        }
-
-        x->RTcmix_runAudio (x->pd_inbuf, x->pd_outbuf, 1);
-
-        j = 0;
-        for (int k = 0; k < vecsize; k++)
-        {
-                for(int i = 0; i < x->num_outputs; i++)
-                        *out[i]++ = (x->pd_outbuf)[j++];
-        }
+        // Pd may hand us the same vector as an input and an output; that is
+        // fine, since RTcmix reads all its input before it writes output.
+        x->RTcmix_runAudioPlanar(in, out, vecsize);
 
         return w + x->num_inputs + x->num_outputs + 3;
 }
@@ -359,8 +339,6 @@ void rtcmix_tilde_free(t_rtcmix_tilde *x)
     system(rmtmpfoldercmd);
     
         free(x->tempfolder);
-        free(x->pd_inbuf);
-        free(x->pd_outbuf);
         for (int i = 0; i < NVARS; i++)
                 free(x->var_array[i]);
         free(x->var_array);
@@ -500,7 +478,7 @@ void rtcmix_tilde_bang(t_rtcmix_tilde *x)
         post("rtcmix~: playing \"%s\"", x->script_path[x->current_script]);
         if (x->buffer_changed) rtcmix_read(x, x->script_path[x->current_script]);
         if (x->vars_present) sub_vars_and_parse(x, x->rtcmix_script[x->current_script]);
-        else x->RTcmix_parseScore(x->rtcmix_script[x->current_script], strlen(x->rtcmix_script[x->current_script]));
+        else x->RTcmix_parseScoreAsync(x->rtcmix_script[x->current_script], strlen(x->rtcmix_script[x->current_script]));
 }
 
 void rtcmix_tilde_float(t_rtcmix_tilde *x, t_float scriptnum)
@@ -698,8 +676,6 @@ void null_the_pointers(t_rtcmix_tilde *x)
         x->pfield_in = NULL;
         x->outpointer = NULL;
         x->tempfolder = NULL;
-        x->pd_inbuf = NULL;
-        x->pd_outbuf = NULL;
         x->var_array = NULL;
         x->rtcmix_script = NULL;
         x->script_path = NULL;
@@ -720,12 +696,15 @@ void null_the_pointers(t_rtcmix_tilde *x)
         x->RTcmix_resetAudio = NULL;
         x->RTcmix_setAudioBufferFormat = NULL;
         x->RTcmix_runAudio = NULL;
+        x->RTcmix_runAudioPlanar = NULL;
         x->RTcmix_parseScore = NULL;
+        x->RTcmix_parseScoreAsync = NULL;
         x->RTcmix_flushScore = NULL;
         x->RTcmix_setInputBuffer = NULL;
         x->RTcmix_getBufferFrameCount = NULL;
         x->RTcmix_getBufferChannelCount = NULL;
         x->RTcmix_setPField = NULL;
+        x->RTcmix_setPFields = NULL;
         x->checkForBang = NULL;
         x->checkForVals = NULL;
         x->checkForPrint = NULL;
@@ -760,8 +739,12 @@ void dlopen_and_errorcheck (t_rtcmix_tilde *x)
         if (!x->RTcmix_setAudioBufferFormat) error("RTcmix could not call RTcmix_setAudioBufferFormat()");
         x->RTcmix_runAudio = dlsym(x->RTcmix_dylib, "RTcmix_runAudio");
         if (!x->RTcmix_runAudio) error("RTcmix could not call RTcmix_runAudio()");
+        x->RTcmix_runAudioPlanar = dlsym(x->RTcmix_dylib, "RTcmix_runAudioPlanar");
+        if (!x->RTcmix_runAudioPlanar) error("RTcmix could not call RTcmix_runAudioPlanar()");
         x->RTcmix_parseScore = dlsym(x->RTcmix_dylib, "RTcmix_parseScore");
         if (!x->RTcmix_parseScore) error("RTcmix could not call RTcmix_parseScore()");
+        x->RTcmix_parseScoreAsync = dlsym(x->RTcmix_dylib, "RTcmix_parseScoreAsync");
+        if (!x->RTcmix_parseScoreAsync) error("RTcmix could not call RTcmix_parseScoreAsync()");
         x->RTcmix_flushScore = dlsym(x->RTcmix_dylib, "RTcmix_flushScore");
         if (!x->RTcmix_flushScore) error("RTcmix could not call RTcmix_flushScore()");
         x->RTcmix_setInputBuffer = dlsym(x->RTcmix_dylib, "RTcmix_setInputBuffer");
@@ -772,6 +755,8 @@ void dlopen_and_errorcheck (t_rtcmix_tilde *x)
         if (!x->RTcmix_getBufferChannelCount) error("RTcmix could not call RTcmix_getBufferChannelCount()");
         x->RTcmix_setPField = dlsym(x->RTcmix_dylib, "RTcmix_setPField");
         if (!x->RTcmix_setPField) error("RTcmix could not call RTcmix_setPField()");
+        x->RTcmix_setPFields = dlsym(x->RTcmix_dylib, "RTcmix_setPFields");
+        if (!x->RTcmix_setPFields) error("RTcmix could not call RTcmix_setPFields()");
         x->checkForBang = dlsym(x->RTcmix_dylib, "checkForBang");
         if (!x->checkForBang) error("RTcmix could not call checkForBang()");
         x->checkForVals = dlsym(x->RTcmix_dylib, "checkForVals");
@@ -845,7 +830,7 @@ void sub_vars_and_parse (t_rtcmix_tilde *x, const char* script)
                 }
                 //inchar++;
         }
-        x->RTcmix_parseScore(script_out, outchar);
+        x->RTcmix_parseScoreAsync(script_out, outchar);
 }
 
 void rtcmix_reference(t_rtcmix_tilde *x)
@@ -60,17 +60,23 @@ typedef enum _RTcmix_AudioFormat {
 								AudioFormat_24BitInt = 2, // 24 bit (3-byte) packed integer samples
 								AudioFormat_32BitInt = 4, // 32 bit (4-byte) integer samples
 								AudioFormat_32BitFloat_Normalized = 8, // single-precision float samples, scaled between -1.0 and 1.0
-								AudioFormat_32BitFloat = 16 // single-precision float samples, scaled between -32767.0 and 32767.0
+								AudioFormat_32BitFloat = 16, // single-precision float samples, scaled between -32767.0 and 32767.0
+								AudioFormat_32BitFloat_NonInterleaved = 32, // as above, but one buffer per channel (pass a float **)
+								AudioFormat_32BitFloat_NonInterleaved_Normalized = 64 // normalized, one buffer per channel
 } RTcmix_AudioFormat;
 typedef int (*RTcmix_setAudioBufferFormatPtr)(RTcmix_AudioFormat format, int nchans);
 // Call this to send and receive audio from RTcmix
 typedef int (*RTcmix_runAudioPtr)(void *inAudioBuffer, void *outAudioBuffer, int nframes);
+// The same, reading and writing one buffer per channel in place
+typedef int (*RTcmix_runAudioPlanarPtr)(float **inputs, float **outputs, int nframes);
 typedef int (*RTcmix_parseScorePtr)(char *theBuf, int buflen);
+typedef int (*RTcmix_parseScoreAsyncPtr)(const char *theBuf, int buflen);
 typedef void (*RTcmix_flushScorePtr)();
 typedef int (*RTcmix_setInputBufferPtr)(char *bufname, float *bufstart, int nframes, int nchans, int modtime);
 typedef int (*RTcmix_getBufferFrameCountPtr)(char *bufname);
 typedef int (*RTcmix_getBufferChannelCountPtr)(char *bufname);
 typedef void (*RTcmix_setPFieldPtr)(int inlet, float pval);
+typedef int (*RTcmix_setPFieldsPtr)(const float *vals, int first, int count);
 typedef void (*checkForBangPtr)();
 typedef void (*checkForValsPtr)();
 typedef void (*checkForPrintPtr)();
@@ -96,8 +102,6 @@ typedef struct _rtcmix_tilde
 								//t_outlet **signal_outlets;
 
 								char *tempfolder;
-								float *pd_outbuf;
-								float *pd_inbuf;
 
 								// RTcmix dylib access pointers
 								RTcmix_dylibPtr RTcmix_dylib;
@@ -110,12 +114,15 @@ typedef struct _rtcmix_tilde
 								RTcmix_resetAudioPtr RTcmix_resetAudio;
 								RTcmix_setAudioBufferFormatPtr RTcmix_setAudioBufferFormat;
 								RTcmix_runAudioPtr RTcmix_runAudio;
+								RTcmix_runAudioPlanarPtr RTcmix_runAudioPlanar;
 								RTcmix_parseScorePtr RTcmix_parseScore;
+								RTcmix_parseScoreAsyncPtr RTcmix_parseScoreAsync;
 								RTcmix_flushScorePtr RTcmix_flushScore;
 								RTcmix_setInputBufferPtr RTcmix_setInputBuffer;
 								RTcmix_getBufferFrameCountPtr RTcmix_getBufferFrameCount;
 								RTcmix_getBufferChannelCountPtr RTcmix_getBufferChannelCount;
 								RTcmix_setPFieldPtr RTcmix_setPField;
+								RTcmix_setPFieldsPtr RTcmix_setPFields;
 								checkForBangPtr checkForBang;
 								checkForValsPtr checkForVals;
 								checkForPrintPtr checkForPrint;
@@ -0,0 +1,204 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifdef ALLOC_TRACKING
+
+#include "AllocTracker.h"
+#include "DSPStats.h"
+#include <RTOption.h>
+#include <ugens.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <new>
+#include <execinfo.h>
+
+#define BACKTRACES_PER_NOTE 8
+
+// Initial-exec, so that reading these never calls the allocator itself.
+#define RT_TLS __thread __attribute__((tls_model("initial-exec")))
+
+static RT_TLS bool tRealtime = false;
+static RT_TLS bool tInHook = false;
+static RT_TLS int tNote = AllocTracker::kScheduler;
+
+// Slot 0 is the scheduler; note class n is slot n + 1.
+static volatile long long sAllocations[DSPStats::kMaxClasses + 1];
+static volatile int sBacktraces[DSPStats::kMaxClasses + 1];
+static volatile long long sTotal = 0;
+static volatile int sBufferAllocations = 0;
+
+// Written only by the audio thread
+static long long sBuffers = 0;
+static int sWorstBuffer = 0;
+
+static inline const char *noteName(int note)
+{
+	return (note == AllocTracker::kScheduler) ? "scheduler" : DSPStats::className(note);
+}
+
+static void logBacktrace(int note)
+{
+	char line[128];
+	const int len = snprintf(line, sizeof(line),
+							 "RTcmix: heap allocation on a real-time thread by %s:\n",
+							 noteName(note));
+	if (write(2, line, len) < 0)
+		return;
+	void *frames[32];
+	const int count = backtrace(frames, 32);
+	// Skip ourselves and the allocator entry point
+	if (count > 2)
+		backtrace_symbols_fd(frames + 2, count - 2, 2);
+}
+
+static inline void noteAllocation()
+{
+	if (!tRealtime || tInHook)
+		return;
+	tInHook = true;		// backtrace() may allocate
+	const int note = tNote;
+	__sync_fetch_and_add(&sAllocations[note + 1], 1LL);
+	__sync_fetch_and_add(&sTotal, 1LL);
+	__sync_fetch_and_add(&sBufferAllocations, 1);
+	if (RTOption::allocBacktraces()
+			&& __sync_fetch_and_add(&sBacktraces[note + 1], 1) < BACKTRACES_PER_NOTE)
+		logBacktrace(note);
+	tInHook = false;
+}
+
+#ifdef __GLIBC__
+
+// Everything, operator new included, comes through these.
+
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+
+	void *malloc(size_t size) throw()
+	{
+		noteAllocation();
+		return __libc_malloc(size);
+	}
+
+	void *calloc(size_t count, size_t size) throw()
+	{
+		noteAllocation();
+		return __libc_calloc(count, size);
+	}
+
+	void *realloc(void *ptr, size_t size) throw()
+	{
+		noteAllocation();
+		return __libc_realloc(ptr, size);
+	}
+}
+
+#else	// !__GLIBC__
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+	noteAllocation();
+	void *ptr = malloc(size ? size : 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+	free(ptr);
+}
+
+#endif	// !__GLIBC__
+
+void AllocTracker::realtimeThread()
+{
+	tRealtime = true;
+}
+
+AllocTracker::AudioScope::AudioScope() : mWasRealtime(tRealtime)
+{
+	tRealtime = true;
+}
+
+AllocTracker::AudioScope::~AudioScope()
+{
+	tRealtime = mWasRealtime;
+	const int count = __sync_lock_test_and_set(&sBufferAllocations, 0);
+	if (count > 0) {
+		++sBuffers;
+		if (count > sWorstBuffer)
+			sWorstBuffer = count;
+	}
+}
+
+AllocTracker::NoteScope::NoteScope(int inSlot) : mPrevious(tNote)
+{
+	tNote = inSlot;
+}
+
+AllocTracker::NoteScope::~NoteScope()
+{
+	tNote = mPrevious;
+}
+
+int AllocTracker::currentNote()
+{
+	return tNote;
+}
+
+void AllocTracker::getTotals(Totals *outTotals)
+{
+	outTotals->allocations = sTotal;
+	outTotals->buffers = sBuffers;
+	outTotals->worstBuffer = sWorstBuffer;
+}
+
+int AllocTracker::report(char *outText, int inLength)
+{
+	if (inLength <= 0)
+		return 0;
+	int len = snprintf(outText, inLength,
+					   "Real-time heap allocations: %lld, in %lld buffers (at most %d in one)\n",
+					   (long long) sTotal, sBuffers, sWorstBuffer);
+	for (int slot = 0; slot <= DSPStats::kMaxClasses && len < inLength; ++slot) {
+		if (sAllocations[slot] > 0)
+			len += snprintf(outText + len, inLength - len, "  %-16s %10lld\n",
+							noteName(slot - 1), (long long) sAllocations[slot]);
+	}
+	return (len < inLength) ? len : inLength - 1;
+}
+
+void AllocTracker::print()
+{
+	char text[4096];
+	report(text, sizeof(text));
+	RTPrintf("%s", text);
+}
+
+void AllocTracker::reset()
+{
+	for (int slot = 0; slot <= DSPStats::kMaxClasses; ++slot) {
+		sAllocations[slot] = 0;
+		sBacktraces[slot] = 0;
+	}
+	sTotal = 0;
+	sBuffers = 0;
+	sWorstBuffer = 0;
+}
+
+#endif	// ALLOC_TRACKING
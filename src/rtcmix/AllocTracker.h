@@ -0,0 +1,84 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _ALLOCTRACKER_H_
+#define _ALLOCTRACKER_H_ 1
+
+// In a build made with ALLOC_TRACKING (make ALLOC_TRACKING=TRUE), every heap
+// allocation made on a real-time thread is counted: on the audio thread while
+// it is in inTraverse, and on the TaskManager and WorkerPool threads at any
+// time.  Allocations are charged to the note being run or configured, by
+// instrument class, or to the scheduler when there is no note.  With the
+// alloc_backtraces option, the first few allocations charged to each are
+// also logged to stderr with a backtrace.
+//
+// glibc's malloc family is interposed, which catches operator new as well;
+// elsewhere only operator new is.  In other builds all of this compiles away.
+
+#ifdef ALLOC_TRACKING
+
+class AllocTracker {
+public:
+	enum { kScheduler = -1 };
+
+	struct Totals {
+		long long	allocations;
+		long long	buffers;		// buffers in which anything was allocated
+		int			worstBuffer;	// the most allocations in one buffer
+	};
+
+	static bool		active() { return true; }
+
+	// Called by each TaskManager and WorkerPool thread when it starts.
+	static void		realtimeThread();
+
+	// Marks the audio thread as real-time while in inTraverse, and closes
+	// out the buffer's count when it leaves.
+	class AudioScope {
+	public:
+		AudioScope();
+		~AudioScope();
+	private:
+		bool	mWasRealtime;
+	};
+
+	// Charges allocations on this thread to the note class in <inSlot> (a
+	// DSPStats::classSlot()), or kScheduler.
+	class NoteScope {
+	public:
+		NoteScope(int inSlot);
+		~NoteScope();
+	private:
+		int		mPrevious;
+	};
+	static int		currentNote();
+
+	static void		getTotals(Totals *outTotals);
+	static int		report(char *outText, int inLength);
+	static void		print();
+	static void		reset();
+};
+
+#else	// !ALLOC_TRACKING
+
+class AllocTracker {
+public:
+	enum { kScheduler = -1 };
+	static bool		active() { return false; }
+	static void		realtimeThread() {}
+	class AudioScope {
+	public:
+		AudioScope() {}
+	};
+	class NoteScope {
+	public:
+		NoteScope(int) {}
+	};
+	static int		currentNote() { return kScheduler; }
+	static void		print() {}
+};
+
+#endif	// !ALLOC_TRACKING
+
+#endif	// _ALLOCTRACKER_H_
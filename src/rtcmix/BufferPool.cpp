@@ -0,0 +1,250 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// BufferPool.cpp -- recycled sample buffers.  See BufferPool.h.
+
+#include "BufferPool.h"
+#include <Lockable.h>
+#include <stddef.h>
+#include <string.h>
+#include <new>
+
+// Each block is preceded by a header recording its size, so that release()
+// needs only the pointer.  The header is padded to 16 bytes so that the
+// contents keep the alignment of operator new.
+
+union BufferHeader {
+	struct {
+		BufferHeader *	next;	// while on a free list
+		size_t			bytes;
+	} info;
+	char pad[16];
+};
+
+#define POOL_CLASSES	32		// distinct sizes we will keep
+#define POOL_CLASS_MAX	256		// blocks kept per size
+
+struct PoolClass {
+	size_t			bytes;		// 0 if unused
+	int				count;
+	BufferHeader *	freeList;
+};
+
+static PoolClass sClasses[POOL_CLASSES];
+static Lockable sPoolLock;
+
+// The memory budget, if any.  Its blocks are sorted into size classes at
+// 16 * 2^(n/2) bytes, give or take (16, 24, 32, 48, 64, ...).
+
+#define BUDGET_CLASSES	64
+
+static char *sArena = NULL;
+static size_t sArenaBytes = 0;
+static size_t sArenaUsed = 0;
+static BufferHeader *sBudgetFree[BUDGET_CLASSES];
+static BufferHeader * volatile sReleased = NULL;	// pushed by releaseBytes()
+
+static inline void *contentsOf(BufferHeader *header)
+{
+	return (void *) (header + 1);
+}
+
+static inline BufferHeader *headerFor(void *contents)
+{
+	return ((BufferHeader *) contents) - 1;
+}
+
+// Return the class for this size, making one if there is room.  Called with
+// the pool locked.
+
+static PoolClass *classFor(size_t bytes)
+{
+	for (int n = 0; n < POOL_CLASSES; ++n) {
+		if (sClasses[n].bytes == bytes)
+			return &sClasses[n];
+		if (sClasses[n].bytes == 0) {
+			sClasses[n].bytes = bytes;
+			return &sClasses[n];
+		}
+	}
+	return NULL;
+}
+
+static inline bool inArena(void *block)
+{
+	return (char *) block >= sArena && (char *) block < sArena + sArenaBytes;
+}
+
+// Return the budget class for <bytes>, and that class's size in <outBytes>,
+// or -1 if too large.
+
+static int budgetClass(size_t bytes, size_t *outBytes)
+{
+	size_t size = 16;
+	for (int n = 0; n < BUDGET_CLASSES; n += 2, size <<= 1) {
+		if (bytes <= size) {
+			*outBytes = size;
+			return n;
+		}
+		if (bytes <= size + size / 2) {
+			*outBytes = size + size / 2;
+			return n + 1;
+		}
+	}
+	return -1;
+}
+
+// Move released blocks onto their free lists.  Called with the pool locked.
+
+static void sortReleased()
+{
+	BufferHeader *header = __sync_lock_test_and_set(&sReleased, (BufferHeader *) NULL);
+	while (header != NULL) {
+		BufferHeader *next = header->info.next;
+		size_t size;
+		const int n = budgetClass(header->info.bytes, &size);
+		header->info.next = sBudgetFree[n];
+		sBudgetFree[n] = header;
+		header = next;
+	}
+}
+
+static void *allocateFromBudget(size_t bytes)
+{
+	size_t size;
+	const int cls = budgetClass(bytes, &size);
+	if (cls < 0)
+		return NULL;
+	BufferHeader *header = NULL;
+	sPoolLock.lock();
+	sortReleased();
+	if (sBudgetFree[cls] != NULL) {
+		header = sBudgetFree[cls];
+		sBudgetFree[cls] = header->info.next;
+	}
+	else if (sArenaUsed + sizeof(BufferHeader) + size <= sArenaBytes) {
+		header = (BufferHeader *) (sArena + sArenaUsed);
+		header->info.bytes = size;
+		sArenaUsed += sizeof(BufferHeader) + size;
+	}
+	else {
+		// Nothing left to cut, so make do with a larger free block.
+		for (int n = cls + 1; n < BUDGET_CLASSES && header == NULL; ++n) {
+			if (sBudgetFree[n] != NULL) {
+				header = sBudgetFree[n];
+				sBudgetFree[n] = header->info.next;
+			}
+		}
+	}
+	sPoolLock.unlock();
+	return (header != NULL) ? contentsOf(header) : NULL;
+}
+
+void *BufferPool::allocateBytes(size_t bytes)
+{
+	if (bytes == 0)
+		bytes = 1;
+	if (sArena != NULL)
+		return allocateFromBudget(bytes);
+	if (sPoolLock.tryLock()) {
+		PoolClass *pc = classFor(bytes);
+		BufferHeader *header = (pc != NULL) ? pc->freeList : NULL;
+		if (header != NULL) {
+			pc->freeList = header->info.next;
+			--pc->count;
+		}
+		sPoolLock.unlock();
+		if (header != NULL)
+			return contentsOf(header);
+	}
+	char *block = new char[sizeof(BufferHeader) + bytes];
+	BufferHeader *header = (BufferHeader *) block;
+	header->info.next = NULL;
+	header->info.bytes = bytes;
+	return contentsOf(header);
+}
+
+void BufferPool::releaseBytes(void *block)
+{
+	if (block == NULL)
+		return;
+	BufferHeader *header = headerFor(block);
+	if (inArena(block)) {
+		BufferHeader *head;
+		do {
+			head = sReleased;
+			header->info.next = head;
+		} while (!__sync_bool_compare_and_swap(&sReleased, head, header));
+		return;
+	}
+	if (sPoolLock.tryLock()) {
+		PoolClass *pc = classFor(header->info.bytes);
+		const bool keep = (pc != NULL && pc->count < POOL_CLASS_MAX);
+		if (keep) {
+			header->info.next = pc->freeList;
+			pc->freeList = header;
+			++pc->count;
+		}
+		sPoolLock.unlock();
+		if (keep)
+			return;
+	}
+	delete [] (char *) header;
+}
+
+size_t BufferPool::blockBytes(const void *block)
+{
+	return (block != NULL) ? ((const BufferHeader *) block - 1)->info.bytes : 0;
+}
+
+void BufferPool::purge()
+{
+	sPoolLock.lock();
+	for (int n = 0; n < POOL_CLASSES; ++n) {
+		BufferHeader *header = sClasses[n].freeList;
+		while (header != NULL) {
+			BufferHeader *next = header->info.next;
+			delete [] (char *) header;
+			header = next;
+		}
+		sClasses[n].bytes = 0;
+		sClasses[n].count = 0;
+		sClasses[n].freeList = NULL;
+	}
+	// Anything still out would be cut from the budget, so it goes too.
+	delete [] sArena;
+	sArena = NULL;
+	sArenaBytes = sArenaUsed = 0;
+	for (int n = 0; n < BUDGET_CLASSES; ++n)
+		sBudgetFree[n] = NULL;
+	sReleased = NULL;
+	sPoolLock.unlock();
+}
+
+int BufferPool::reserve(size_t bytes)
+{
+	if (sArena != NULL)
+		return (bytes == sArenaBytes) ? 0 : -1;
+	char *arena = new (std::nothrow) char[bytes];
+	if (arena == NULL)
+		return -1;
+	// Touch every page now, so that none is faulted in on the audio thread.
+	memset(arena, 0, bytes);
+	sPoolLock.lock();
+	sArena = arena;
+	sArenaBytes = bytes;
+	sArenaUsed = 0;
+	sPoolLock.unlock();
+	return 0;
+}
+
+size_t BufferPool::budget()
+{
+	return sArenaBytes;
+}
+
+size_t BufferPool::budgetUsed()
+{
+	return sArenaUsed;
+}
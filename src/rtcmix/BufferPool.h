@@ -0,0 +1,45 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_ 1
+
+#include <stddef.h>
+#include <rt_types.h>
+
+// A pool of sample buffers, sorted into classes by exact size.  Notes
+// allocate their output buffer in configure() and free it when they are
+// unref'd, usually from the audio thread, and nearly every note asks for
+// the same bufsamps * chans.  So rather than go to the system allocator for
+// each note, freed buffers are kept on a list for their size and handed out
+// again.
+//
+// The pool is locked with tryLock(): if another thread has it, the caller
+// goes to the system allocator instead of waiting.  Buffers are not zeroed.
+//
+// The same pool recycles the memory for instruments and their PFieldSets
+// (see their operator new), which are also created and destroyed on every
+// note, using the untyped allocateBytes() and releaseBytes().
+
+class BufferPool {
+public:
+	static BUFTYPE *	allocate(int samps) {
+							return (BUFTYPE *) allocateBytes(samps * sizeof(BUFTYPE));
+						}
+	static void			release(BUFTYPE *buffer) { releaseBytes(buffer); }
+	static void *		allocateBytes(size_t bytes);
+	static void			releaseBytes(void *block);	// NULL is ignored
+	static void			purge();					// free all pooled blocks
+	// The size of a block, as asked for (or as rounded up by the budget);
+	// 0 for NULL.
+	static size_t		blockBytes(const void *block);
+
+	// Set aside <bytes> for all later blocks.  Returns -1 if there is not
+	// that much memory, or a budget of another size is already set.
+	static int			reserve(size_t bytes);
+	static size_t		budget();					// 0 if none
+	static size_t		budgetUsed();				// cut so far
+};
+
+#endif	// _BUFFERPOOL_H_
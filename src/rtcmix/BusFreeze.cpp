@@ -0,0 +1,433 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// BusFreeze.cpp -- recording and replay of aux buses.  See BusFreeze.h.
+
+#include "BusFreeze.h"
+#include "NoteCache.h"
+#include <RTcmix.h>
+#include <Instrument.h>
+#include <Lockable.h>
+#include <RTOption.h>
+#include "BusSlot.h"
+#include "rt.h"
+#include <bus.h>
+#include <ugens.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <new>
+
+#define MAX_FREEZES 64
+
+/* from bus_config.cpp */
+extern ErrCode parse_bus_name(char *busname, BusType *type, int *startchan,
+                              int *endchan, int maxBus);
+
+#define FREEZE_MAGIC "RTcmxBF"		// 7 chars + NUL
+#define FREEZE_VERSION 1
+#define FREEZE_BYTE_ORDER 0x01020304
+
+typedef std::vector<unsigned long long> NoteList;
+
+// A recording of a bus, and the notes it was made from.
+
+struct FrozenBus {
+	NoteList	notes;
+	BUFTYPE *	samples;
+	FRAMETYPE	frames;
+	FrozenBus() : samples(NULL), frames(0) {}
+	~FrozenBus() { delete [] samples; }
+};
+
+struct FreezeHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	byteOrder;
+	uint64_t	id;
+	uint64_t	frames;
+	uint32_t	noteCount;
+	uint32_t	pad;
+};
+
+// One bus_freeze() of this run.  The parser thread fills in <notes> and
+// the flags below it until the window starts playing; then the audio thread
+// decides, once, whether to replay <stored> or record <recording>.
+
+struct Freeze {
+	int				bus;
+	FRAMETYPE		start, end;		// the window, in frames
+	unsigned long long id;			// bus, window and rate
+	FrozenBus *		stored;			// owned by sStore, or NULL
+	NoteList		notes;
+	volatile bool	matching;		// <notes> so far are those of <stored>
+	volatile bool	unfreezable;
+	volatile bool	stale;			// a note came too late to be described
+	volatile bool	decided;
+	volatile bool	replaying;		// read through Instrument::_frozenBy
+	BUFTYPE *		recording;
+	FRAMETYPE		recorded;
+};
+
+static Freeze *sFreezes[MAX_FREEZES];
+static volatile int sFreezeCount = 0;
+
+// Recordings from earlier runs in this process, by id.
+typedef std::map<unsigned long long, FrozenBus *> FreezeStore;
+static FreezeStore sStore;
+static Lockable sStoreLock;
+
+static unsigned long long hashBytes(const void *data, size_t len)
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t n = 0; n < len; ++n)
+		hash = (hash ^ bytes[n]) * 1099511628211ULL;
+	return hash;
+}
+
+static std::string freezePath(unsigned long long id)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.freeze", id);
+	return std::string(RTOption::renderCacheDir()) + name;
+}
+
+static bool readAll(int fd, void *buf, size_t size)
+{
+	char *ptr = (char *) buf;
+	while (size > 0) {
+		ssize_t n = read(fd, ptr, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool writeAll(int fd, const void *buf, size_t size)
+{
+	const char *ptr = (const char *) buf;
+	while (size > 0) {
+		ssize_t n = write(fd, ptr, size);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+static FrozenBus *loadFrozenBus(unsigned long long id, FRAMETYPE frames)
+{
+	const int fd = open(freezePath(id).c_str(), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	FreezeHeader header;
+	FrozenBus *frozen = NULL;
+	if (readAll(fd, &header, sizeof(header))
+			&& memcmp(header.magic, FREEZE_MAGIC, sizeof(header.magic)) == 0
+			&& header.version == FREEZE_VERSION
+			&& header.byteOrder == FREEZE_BYTE_ORDER
+			&& header.id == id && header.frames == (uint64_t) frames) {
+		frozen = new (std::nothrow) FrozenBus;
+		if (frozen != NULL) {
+			frozen->notes.resize(header.noteCount);
+			frozen->frames = frames;
+			frozen->samples = new (std::nothrow) BUFTYPE[frames];
+			if (frozen->samples == NULL
+					|| (header.noteCount > 0 && !readAll(fd, &frozen->notes[0],
+									header.noteCount * sizeof(unsigned long long)))
+					|| !readAll(fd, frozen->samples, frames * sizeof(BUFTYPE))) {
+				delete frozen;
+				frozen = NULL;
+			}
+		}
+	}
+	close(fd);
+	return frozen;
+}
+
+// Written under a temporary name and renamed, as the table cache does.
+
+static void storeFrozenBus(unsigned long long id, const FrozenBus *frozen)
+{
+	const char *dir = RTOption::renderCacheDir();
+	if (dir[0] == 0)
+		return;
+	mkdir(dir, 0777);
+	const std::string path = freezePath(id);
+	std::string tmpPath = path + ".XXXXXX";
+	const int fd = mkstemp(&tmpPath[0]);
+	if (fd < 0) {
+		rtcmix_warn("bus_freeze", "Can't write to \"%s\" (%s).", dir, strerror(errno));
+		return;
+	}
+	fchmod(fd, 0644);		// mkstemp makes it private
+
+	FreezeHeader header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, FREEZE_MAGIC);
+	header.version = FREEZE_VERSION;
+	header.byteOrder = FREEZE_BYTE_ORDER;
+	header.id = id;
+	header.frames = frozen->frames;
+	header.noteCount = frozen->notes.size();
+
+	const bool ok = writeAll(fd, &header, sizeof(header))
+		&& (frozen->notes.empty() || writeAll(fd, &frozen->notes[0],
+								frozen->notes.size() * sizeof(unsigned long long)))
+		&& writeAll(fd, frozen->samples, frozen->frames * sizeof(BUFTYPE));
+	if (close(fd) != 0 || !ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+		rtcmix_warn("bus_freeze", "Can't write \"%s\" (%s).", path.c_str(), strerror(errno));
+		unlink(tmpPath.c_str());
+	}
+}
+
+static bool writesTo(const short *buses, int count, int bus)
+{
+	for (int n = 0; n < count; ++n)
+		if (buses[n] == bus)
+			return true;
+	return false;
+}
+
+bool BusFreeze::active()
+{
+	return sFreezeCount > 0;
+}
+
+void BusFreeze::noteStarted(Instrument *inst, rt_item *item, const Arg arglist[], int nargs)
+{
+	const int count = sFreezeCount;
+	if (count == 0)
+		return;
+	const BusSlot *slot = inst->getBusSlot();
+	if (slot->auxout_count == 0)
+		return;
+	// As in Instrument::configureEndSamp()
+	FRAMETYPE startFrame = (FRAMETYPE) (0.5 + inst->getstart() * RTcmix::sr());
+	if (RTcmix::interactive())
+		startFrame += RTcmix::getElapsedFrames();
+	const FRAMETYPE endFrame = startFrame + inst->nSamps();
+	std::string key;
+	bool described = false, tried = false;
+
+	for (int n = 0; n < count; ++n) {
+		Freeze *freeze = sFreezes[n];
+		if (endFrame <= freeze->start || startFrame >= freeze->end)
+			continue;
+		if (freeze->decided) {
+			freeze->stale = true;
+			continue;
+		}
+		if (!tried) {
+			described = NoteCache::describe(item, arglist, nargs, &key);
+			tried = true;
+		}
+		if (!described) {
+			freeze->unfreezable = true;
+			continue;
+		}
+		const long long offset = startFrame - freeze->start;
+		const unsigned long long hash = hashBytes(key.data(), key.size())
+										^ hashBytes(&offset, sizeof(offset));
+		const size_t index = freeze->notes.size();
+		freeze->notes.push_back(hash);
+		if (freeze->stored == NULL || index >= freeze->stored->notes.size()
+				|| freeze->stored->notes[index] != hash)
+			freeze->matching = false;
+		if (writesTo(slot->auxout, slot->auxout_count, freeze->bus)) {
+			if (slot->auxout_count == 1 && slot->out_count == 0
+					&& startFrame >= freeze->start && endFrame <= freeze->end)
+				inst->_frozenBy = &freeze->replaying;
+			else
+				freeze->unfreezable = true;
+		}
+	}
+}
+
+void BusFreeze::playBuffer(FRAMETYPE bufStart, FRAMETYPE bufEnd)
+{
+	const int count = sFreezeCount;
+	for (int n = 0; n < count; ++n) {
+		Freeze *freeze = sFreezes[n];
+		if (bufEnd <= freeze->start || bufStart >= freeze->end)
+			continue;
+		if (!freeze->decided) {
+			freeze->replaying = !freeze->unfreezable && freeze->matching
+								&& freeze->stored != NULL
+								&& freeze->notes.size() == freeze->stored->notes.size();
+			__sync_synchronize();
+			freeze->decided = true;
+		}
+		BUFTYPE *bus = RTcmix::aux_buffer[freeze->bus];
+		if (!freeze->replaying || bus == NULL)
+			continue;
+		const FRAMETYPE from = (bufStart > freeze->start) ? bufStart : freeze->start;
+		const FRAMETYPE to = (bufEnd < freeze->end) ? bufEnd : freeze->end;
+		const int offset = (int) (from - bufStart);
+		const int frames = (int) (to - from);
+		const BUFTYPE *src = freeze->stored->samples + (from - freeze->start);
+		if (RTcmix::begin_bus_write(true, freeze->bus, offset, offset + frames))
+			memcpy(bus + offset, src, frames * sizeof(BUFTYPE));
+		else {
+			for (int i = 0; i < frames; ++i)
+				bus[offset + i] += src[i];
+		}
+	}
+}
+
+void BusFreeze::recordBuffer(FRAMETYPE bufStart, FRAMETYPE bufEnd)
+{
+	const int count = sFreezeCount;
+	for (int n = 0; n < count; ++n) {
+		Freeze *freeze = sFreezes[n];
+		if (bufEnd <= freeze->start || bufStart >= freeze->end
+				|| !freeze->decided || freeze->replaying || freeze->unfreezable)
+			continue;
+		const FRAMETYPE from = (bufStart > freeze->start) ? bufStart : freeze->start;
+		const FRAMETYPE to = (bufEnd < freeze->end) ? bufEnd : freeze->end;
+		const BUFTYPE *bus = RTcmix::aux_buffer[freeze->bus];
+		BUFTYPE *dest = freeze->recording + (from - freeze->start);
+		if (bus == NULL || RTcmix::aux_unwritten[freeze->bus])
+			memset(dest, 0, (to - from) * sizeof(BUFTYPE));
+		else
+			memcpy(dest, bus + (from - bufStart), (to - from) * sizeof(BUFTYPE));
+		freeze->recorded += to - from;
+	}
+}
+
+void BusFreeze::finish()
+{
+	const int count = sFreezeCount;
+	sFreezeCount = 0;
+	sStoreLock.lock();
+	for (int n = 0; n < count; ++n) {
+		Freeze *freeze = sFreezes[n];
+		FreezeStore::iterator it = sStore.find(freeze->id);
+		if (freeze->stale || (!freeze->replaying && freeze->recorded == freeze->end - freeze->start
+							  && !freeze->unfreezable)) {
+			// Replace the stored recording with this one, or with none.
+			if (it != sStore.end()) {
+				delete it->second;
+				sStore.erase(it);
+			}
+			if (freeze->stale) {
+				if (RTOption::renderCacheDir()[0] != 0)
+					unlink(freezePath(freeze->id).c_str());
+			}
+			else {
+				FrozenBus *frozen = new FrozenBus;
+				frozen->notes.swap(freeze->notes);
+				frozen->samples = freeze->recording;
+				frozen->frames = freeze->recorded;
+				freeze->recording = NULL;
+				sStore[freeze->id] = frozen;
+				storeFrozenBus(freeze->id, frozen);
+			}
+		}
+		delete [] freeze->recording;
+		delete freeze;
+	}
+	sStoreLock.unlock();
+}
+
+/* ----------------------------------------------------------- bus_freeze --- */
+/* bus_freeze("aux 2", start, dur): see BusFreeze.h.  Returns the number of
+   buses frozen.
+*/
+double
+RTcmix::bus_freeze(double p[], int n_args)
+{
+	char busspec[64];
+	BusType type;
+	int startchan, endchan;
+
+	if (!rtsetparams_was_called()) {
+		die("bus_freeze", "You must call rtsetparams before bus_freeze.");
+		return rtOptionalThrow(CONFIGURATION_ERROR);
+	}
+	if (n_args != 3) {
+		rterror("bus_freeze", "usage: bus_freeze(\"aux N\", start, dur)");
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+	const char *busname = DOUBLE_TO_STRING(p[0]);
+	if (busname == NULL) {
+		rterror("bus_freeze", "NULL bus name!");
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+	/* An aux bus with no direction can only mean the one written to. */
+	if (busname[0] == 'a' && !strchr(busname, 'i') && !strchr(busname, 'o'))
+		snprintf(busspec, sizeof(busspec), "%s out", busname);
+	else
+		snprintf(busspec, sizeof(busspec), "%s", busname);
+	if (parse_bus_name(busspec, &type, &startchan, &endchan, busCount) != NO_ERR)
+		return rtOptionalThrow(PARAM_ERROR);	/* already reported */
+	if (type != BUS_AUX_OUT || endchan != startchan) {
+		rterror("bus_freeze", "\"%s\": only a single aux bus can be frozen", busname);
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+	if (p[1] < 0.0 || p[2] <= 0.0) {
+		rterror("bus_freeze", "The start must be >= 0 and the duration > 0.");
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+	if (sFreezeCount == MAX_FREEZES) {
+		rterror("bus_freeze", "Can't freeze more than %d buses.", MAX_FREEZES);
+		return rtOptionalThrow(RESOURCE_ERROR);
+	}
+
+	Freeze *freeze = new Freeze;
+	freeze->bus = startchan;
+	freeze->start = (FRAMETYPE) (0.5 + p[1] * sr());
+	freeze->end = freeze->start + (FRAMETYPE) (0.5 + p[2] * sr());
+	const double window[] = { (double) freeze->bus, p[1], p[2], sr() };
+	freeze->id = hashBytes(window, sizeof(window));
+	if (interactive()) {
+		freeze->start += getElapsedFrames();
+		freeze->end += getElapsedFrames();
+	}
+	const FRAMETYPE frames = freeze->end - freeze->start;
+	freeze->recording = new (std::nothrow) BUFTYPE[frames];
+	if (freeze->recording == NULL) {
+		delete freeze;
+		return rtOptionalThrow(MEMORY_ERROR);
+	}
+	freeze->recorded = 0;
+	freeze->matching = true;
+	freeze->unfreezable = false;
+	freeze->stale = false;
+	freeze->decided = false;
+	freeze->replaying = false;
+
+	sStoreLock.lock();
+	FreezeStore::iterator it = sStore.find(freeze->id);
+	if (it == sStore.end() && RTOption::renderCacheDir()[0] != 0) {
+		FrozenBus *loaded = loadFrozenBus(freeze->id, frames);
+		if (loaded != NULL)
+			it = sStore.insert(FreezeStore::value_type(freeze->id, loaded)).first;
+	}
+	freeze->stored = (it != sStore.end() && it->second->frames == frames) ? it->second : NULL;
+	sStoreLock.unlock();
+
+	/* The run may have started: publish the freeze only once it's complete. */
+	sFreezes[sFreezeCount] = freeze;
+	__sync_synchronize();
+	sFreezeCount = sFreezeCount + 1;
+
+	return sFreezeCount;
+}
@@ -0,0 +1,52 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _BUSFREEZE_H_
+#define _BUSFREEZE_H_ 1
+
+#include <rt_types.h>
+
+struct rt_item;
+struct Arg;
+class Instrument;
+
+// Frozen aux buses.  bus_freeze("aux 2", start, dur) says that what reaches
+// aux bus 2 from <start> for <dur> seconds -- a backing layer and its
+// reverb, say -- is the same every time the score is played.
+//
+// The first time the window plays in full, the bus is recorded as it is
+// mixed.  When the score is played again in this process (or, with the
+// render_cache_dir option set, in a later run), the notes writing to the bus
+// during the window are never run, and the recording is mixed into the bus
+// in their place.
+//
+// What the recording depends on is checked note by note: every note that
+// writes to an aux bus during the window goes into its description, in the
+// order the score makes them, with its start within the window and its
+// pfields as the note cache sees them (see NoteCache.h).  The recording is
+// played only if this run describes the same notes.  A score that makes any
+// other note for the window once it has started playing drops the recording,
+// so that the next run makes a new one.
+//
+// A bus can be frozen only if each note writing to it in the window starts
+// and ends inside the window and writes to no other bus, and only if every
+// note writing to an aux bus in the window has pfields that don't change as
+// it plays.  Otherwise the bus just plays as usual.
+
+class BusFreeze {
+public:
+	// Called by RTcmix::startInst() for each note once it is set up, before
+	// it is scheduled.
+	static void		noteStarted(Instrument *inst, rt_item *item,
+								const Arg arglist[], int nargs);
+	// Whether the score has asked for any freeze.
+	static bool		active();
+	// Called at the start and end of each buffer by inTraverse().
+	static void		playBuffer(FRAMETYPE bufStart, FRAMETYPE bufEnd);
+	static void		recordBuffer(FRAMETYPE bufStart, FRAMETYPE bufEnd);
+	// Keep the recordings made by this run, and forget the freezes.
+	static void		finish();
+};
+
+#endif	// _BUSFREEZE_H_
@@ -0,0 +1,109 @@
+/* RTcmix  - Copyright (C) 2004  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include "BusPField.h"
+#include "ControlTable.h"
+#include <RTcmix.h>
+#include <rtcmix_types.h>
+#include <ugens.h>		// for die
+#include <utils.h>
+#include <stdio.h>
+#include <math.h>
+
+BusPField::BusPField(int bus) : _bus(bus)
+{
+	RTcmix::allocate_aux_buffer(bus, RTcmix::bufsamps());
+}
+
+BusPField::~BusPField()
+{
+}
+
+double BusPField::doubleValue(int) const
+{
+	double value;
+	fillBlock(&value, 1, ControlTable::renderPercent(), 0.0);
+	return value;
+}
+
+double BusPField::doubleValue(double percent) const
+{
+	double value;
+	fillBlock(&value, 1, percent, 0.0);
+	return value;
+}
+
+// The values for <nframes> frames from the one at <startPct>.  That frame is
+// found from the frame and percentage Instrument gave ControlTable, since
+// <pctIncr> is the percentage per frame.
+
+void BusPField::fillBlock(double *out, int nframes, double startPct,
+						  double pctIncr) const
+{
+	FRAMETYPE frame = ControlTable::renderFrame();
+	const BUFTYPE *bus = (frame >= 0) ? RTcmix::auxBusFrames(_bus, 0) : NULL;
+	if (bus == NULL) {
+		for (int n = 0; n < nframes; ++n)
+			out[n] = 0.0;
+		return;
+	}
+	if (pctIncr > 0.0)
+		frame += (FRAMETYPE) floor((startPct - ControlTable::renderPercent()) / pctIncr + 0.5);
+	const int last = RTcmix::bufsamps() - 1;
+	FRAMETYPE offset = frame - RTcmix::bufStartSamp;
+	for (int n = 0; n < nframes; ++n, ++offset) {
+		const int index = (offset < 0) ? 0 : (offset > last) ? last : (int) offset;
+		out[n] = bus[index];
+	}
+}
+
+// -----------------------------------------------------------------------------
+//
+//    value = makeconnection("bus", bus)
+//
+//    <bus>    the aux bus to read, as a number or as "aux 3"
+//
+// See BusPField.h.
+
+static Handle
+_bus_usage()
+{
+	die("makeconnection (bus)", "Usage: makeconnection(\"bus\", aux bus #)");
+	rtOptionalThrow(PARAM_ERROR);
+	return NULL;
+}
+
+extern "C" {
+	Handle create_bus_handle(const Arg args[], const int nargs);
+};
+
+Handle
+create_bus_handle(const Arg args[], const int nargs)
+{
+	if (nargs != 1)
+		return _bus_usage();
+
+	int bus;
+	if (args[0].isType(DoubleType))
+		bus = (int) (double) args[0];
+	else if (args[0].isType(StringType)) {
+		const char *name = (const char *) args[0];
+		if (sscanf(name, "aux %d", &bus) != 1 && sscanf(name, "%d", &bus) != 1)
+			return _bus_usage();
+	}
+	else
+		return _bus_usage();
+
+	if (!RTcmix::rtsetparams_was_called()) {
+		die("makeconnection (bus)", "You must call rtsetparams before reading a bus.");
+		rtOptionalThrow(PARAM_ERROR);
+		return NULL;
+	}
+	if (bus < 0 || bus >= RTcmix::getBusCount()) {
+		die("makeconnection (bus)", "Aux bus %d is out of range.", bus);
+		rtOptionalThrow(PARAM_ERROR);
+		return NULL;
+	}
+	return createPFieldHandle(new BusPField(bus));
+}
@@ -0,0 +1,42 @@
+/* RTcmix  - Copyright (C) 2004  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _BUSPFIELD_H_
+#define _BUSPFIELD_H_ 1
+
+#include <PField.h>
+
+// A PField whose value is the signal on an aux bus, made by
+//
+//    value = makeconnection("bus", 3)       // or "aux 3"
+//
+// so that a note can be modulated by the output of other notes: a sidechain
+// level, an FM index.  Scale and offset it with the usual arithmetic.
+//
+// It is read at the output frame the note is rendering (see
+// ControlTable::renderFrame()), so update() gets the sample at the start of
+// the control period and updateBlock() one sample per frame.  Frames outside
+// the current buffer read the sample at its nearer edge, and a bus nothing
+// has written this buffer reads 0.
+//
+// A note reading the bus must play after the notes writing it.  Instrument
+// tells RTcmix::addBusReader() about it, which makes an instrument reading
+// aux buses wait for this one too.  See bus_config.cpp.
+
+class BusPField : public PField {
+public:
+	BusPField(int bus);
+	virtual double	doubleValue(int indx = 0) const;
+	virtual double	doubleValue(double) const;
+	virtual void	fillBlock(double *, int, double, double) const;
+	virtual int		values() const { return 1; }
+	virtual int		auxBus() const { return _bus; }
+	virtual bool	deterministic() const { return true; }
+protected:
+	virtual			~BusPField();
+private:
+	int				_bus;
+};
+
+#endif	// _BUSPFIELD_H_
@@ -0,0 +1,130 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include "ControlTable.h"
+#include "rtdefs.h"
+#include <assert.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+#define CACHE_LINE 64
+
+// <state> is twice the number of finished writes, plus one while a write is
+// in progress.
+
+struct ControlSlot {
+	volatile unsigned	state;
+	volatile int		inUse;
+	volatile double		value;
+	char				pad[CACHE_LINE - 2 * sizeof(int) - sizeof(double)];
+};
+
+static ControlSlot sSlots[ControlTable::kNumSlots] __attribute__((aligned(CACHE_LINE)));
+
+// The frame starting the current buffer, and when it started.  Written
+// only by the audio thread, and read like a slot.
+
+static struct {
+	volatile unsigned	state;
+	FRAMETYPE			frame;
+	double				time;
+	double				srate;
+} sClock;
+
+__thread FRAMETYPE ControlTable::sRenderFrame = -1;
+__thread double ControlTable::sRenderPercent = 0.0;
+
+static double now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 0.000001;
+}
+
+int ControlTable::allocate(double initial)
+{
+	for (int slot = MAX_INLETS; slot < kNumSlots; ++slot) {
+		if (sSlots[slot].inUse == 0
+				&& __sync_bool_compare_and_swap(&sSlots[slot].inUse, 0, 1)) {
+			write(slot, initial);
+			return slot;
+		}
+	}
+	return -1;
+}
+
+void ControlTable::release(int slot)
+{
+	assert(slot >= MAX_INLETS && slot < kNumSlots);
+	__sync_synchronize();
+	sSlots[slot].inUse = 0;
+}
+
+void ControlTable::write(int slot, double value)
+{
+	assert(slot >= 0 && slot < kNumSlots);
+	ControlSlot &s = sSlots[slot];
+	// Usually there is one writer per slot, but make sure of it.
+	unsigned state;
+	do {
+		state = s.state & ~1U;
+	} while (!__sync_bool_compare_and_swap(&s.state, state, state + 1));
+	s.value = value;
+	__sync_synchronize();
+	s.state = state + 2;
+}
+
+double ControlTable::read(int slot, unsigned *sequence)
+{
+	assert(slot >= 0 && slot < kNumSlots);
+	const ControlSlot &s = sSlots[slot];
+	unsigned state;
+	double value;
+	do {
+		state = s.state;
+		__sync_synchronize();
+		value = s.value;
+		__sync_synchronize();
+	} while ((state & 1) || s.state != state);
+	if (sequence)
+		*sequence = state >> 1;
+	return value;
+}
+
+unsigned ControlTable::sequence(int slot)
+{
+	assert(slot >= 0 && slot < kNumSlots);
+	return sSlots[slot].state >> 1;
+}
+
+void ControlTable::markBuffer(FRAMETYPE startFrame, double srate)
+{
+	const unsigned state = sClock.state;
+	sClock.state = state + 1;
+	__sync_synchronize();
+	sClock.frame = startFrame;
+	sClock.time = now();
+	sClock.srate = srate;
+	__sync_synchronize();
+	sClock.state = state + 2;
+}
+
+FRAMETYPE ControlTable::frameAt(double seconds)
+{
+	unsigned state;
+	FRAMETYPE frame;
+	double time, srate;
+	do {
+		state = sClock.state;
+		__sync_synchronize();
+		frame = sClock.frame;
+		time = sClock.time;
+		srate = sClock.srate;
+		__sync_synchronize();
+	} while ((state & 1) || sClock.state != state);
+	if (state == 0)
+		return 0;		// no audio yet
+	const double offset = (now() - time + seconds) * srate;
+	return (offset > -frame) ? frame + (FRAMETYPE) offset : 0;
+}
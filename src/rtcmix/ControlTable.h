@@ -0,0 +1,60 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _CONTROLTABLE_H_
+#define _CONTROLTABLE_H_ 1
+
+#include <rt_types.h>
+
+// The current values of real-time control inputs (OSC paths, Max/iOS
+// inlets), written by the threads that receive them and read by PFields on
+// the audio threads.  Each value has its own cache line, so that a busy
+// control does not slow the reading of others, and a sequence number,
+// which a reader can compare with one it saw before to tell whether the
+// value has changed since.
+//
+// Reads and writes never block.  A write marks its slot busy while it
+// stores the value; a read that overlaps one simply reads again.  The
+// first MAX_INLETS slots belong to inlets 1 through MAX_INLETS; others are
+// handed out by allocate().
+//
+// The table also keeps the audio clock, so that a control change stamped
+// with a time can be placed at the frame that will be rendered then.
+
+class ControlTable {
+public:
+	enum { kNumSlots = 1024 };
+
+	// Return a free slot, set to <initial>, or -1 if all are in use.
+	static int		allocate(double initial);
+	static void		release(int slot);
+
+	static void		write(int slot, double value);
+	// Return the value, and if <sequence> is not NULL, the slot's sequence
+	// number, which goes up by one with every write.
+	static double	read(int slot, unsigned *sequence = 0);
+	static unsigned	sequence(int slot);
+
+	static int		inletSlot(int inlet) { return inlet - 1; }
+
+	// Called by the audio thread as it starts each buffer.
+	static void		markBuffer(FRAMETYPE startFrame, double srate);
+	// The output frame being rendered <seconds> from now (or ago).
+	static FRAMETYPE	frameAt(double seconds);
+
+	// The output frame that PFields read on this thread are being read for,
+	// which Instrument sets before reading them, or -1 if unknown, and the
+	// note percentage that frame is at, so that a block read can tell which
+	// frame each of its values is for.
+	static void		renderFrame(FRAMETYPE frame, double percent = 0.0)
+					{ sRenderFrame = frame; sRenderPercent = percent; }
+	static FRAMETYPE	renderFrame() { return sRenderFrame; }
+	static double	renderPercent() { return sRenderPercent; }
+
+private:
+	static __thread FRAMETYPE	sRenderFrame;
+	static __thread double		sRenderPercent;
+};
+
+#endif	// _CONTROLTABLE_H_
@@ -0,0 +1,205 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include "DSPStats.h"
+#include <RTcmix.h>
+#include <ugens.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef MULTI_THREAD
+#include "RTThread.h"
+#endif
+
+// One per rendering thread, padded so that no two threads share a cache line.
+
+struct StatSlot {
+	long long	nsec[DSPStats::kCategoryCount];
+	long long	classNsec[DSPStats::kMaxClasses];
+	long long	classRuns[DSPStats::kMaxClasses];
+	char		pad[64];
+};
+
+static StatSlot *sSlots = NULL;
+static int sSlotCount = 0;
+
+// Class names, added to only by the parser.  sClassCount is raised after
+// the name is in place, so readers never see a slot without one.
+static pthread_mutex_t sClassLock = PTHREAD_MUTEX_INITIALIZER;
+static char sClassNames[DSPStats::kMaxClasses][32] = { "other" };
+static volatile int sClassCount = 1;
+
+// Written only by the audio thread
+static double sLoad = 0.0;
+static double sPeakLoad = 0.0;
+static long long sBuffers = 0;
+static long long sBufferNsec = 0;
+static long long sFramesSincePrint = 0;
+
+static const char *sCategoryNames[DSPStats::kCategoryCount] = {
+	"to aux", "aux to aux", "to out", "mixdown", "file reads"
+};
+
+static inline StatSlot *threadSlot()
+{
+#ifdef MULTI_THREAD
+	const int slot = RTThread::FindIndexForThread() + 1;
+	return (slot < sSlotCount) ? &sSlots[slot] : &sSlots[0];
+#else
+	return sSlots;
+#endif
+}
+
+void DSPStats::init(int inThreadCount)
+{
+	destroy();
+	sSlotCount = inThreadCount + 1;
+	sSlots = new StatSlot[sSlotCount];
+	reset();
+}
+
+void DSPStats::destroy()
+{
+	delete [] sSlots;
+	sSlots = NULL;
+	sSlotCount = 0;
+}
+
+void DSPStats::reset()
+{
+	if (sSlots != NULL)
+		memset(sSlots, 0, sizeof(StatSlot) * sSlotCount);
+	sLoad = sPeakLoad = 0.0;
+	sBuffers = sBufferNsec = sFramesSincePrint = 0;
+}
+
+int DSPStats::classSlot(const char *inName)
+{
+	pthread_mutex_lock(&sClassLock);
+	int slot;
+	for (slot = 1; slot < sClassCount; ++slot)
+		if (strcmp(sClassNames[slot], inName) == 0)
+			break;
+	if (slot == sClassCount) {
+		if (slot < kMaxClasses) {
+			strncpy(sClassNames[slot], inName, sizeof(sClassNames[slot]) - 1);
+			__sync_synchronize();
+			sClassCount = slot + 1;
+		}
+		else
+			slot = 0;
+	}
+	pthread_mutex_unlock(&sClassLock);
+	return slot;
+}
+
+const char *DSPStats::className(int inSlot)
+{
+	return (inSlot >= 0 && inSlot < sClassCount) ? sClassNames[inSlot] : "other";
+}
+
+void DSPStats::add(Category inCategory, long long inNsec)
+{
+	if (sSlots != NULL)
+		threadSlot()->nsec[inCategory] += inNsec;
+}
+
+void DSPStats::addInstrument(int inSlot, long long inNsec)
+{
+	if (sSlots != NULL) {
+		StatSlot *slot = threadSlot();
+		slot->classNsec[inSlot] += inNsec;
+		++slot->classRuns[inSlot];
+	}
+}
+
+void DSPStats::endBuffer(long long inNsec, int inFrames)
+{
+	// Follow rises quickly and falls slowly, like a meter
+	const double load = inNsec * 1.0e-9 * RTcmix::sr() / inFrames;
+	sLoad += (load - sLoad) * ((load > sLoad) ? 0.5 : 0.05);
+	if (load > sPeakLoad)
+		sPeakLoad = load;
+	++sBuffers;
+	sBufferNsec += inNsec;
+	const int interval = RTOption::dspStatsInterval();
+	if (interval > 0) {
+		sFramesSincePrint += inFrames;
+		if (sFramesSincePrint >= interval * RTcmix::sr()) {
+			sFramesSincePrint = 0;
+			print();
+		}
+	}
+}
+
+void DSPStats::getTotals(Totals *outTotals)
+{
+	memset(outTotals, 0, sizeof(Totals));
+	outTotals->dspLoad = sLoad;
+	outTotals->peakLoad = sPeakLoad;
+	outTotals->buffers = sBuffers;
+	outTotals->bufferNsec = sBufferNsec;
+	for (int n = 0; n < sSlotCount; ++n) {
+		const StatSlot &slot = sSlots[n];
+		for (int c = 0; c < kCategoryCount; ++c)
+			outTotals->nsec[c] += slot.nsec[c];
+		for (int i = 0; i < kMaxClasses; ++i)
+			outTotals->instrumentNsec += slot.classNsec[i];
+	}
+}
+
+static inline double msec(long long nsec) { return nsec * 1.0e-6; }
+
+int DSPStats::report(char *outText, int inLength)
+{
+	if (inLength <= 0)
+		return 0;
+	Totals totals;
+	getTotals(&totals);
+
+	// Per-class totals, busiest first
+	long long classNsec[kMaxClasses], classRuns[kMaxClasses];
+	int order[kMaxClasses];
+	const int classes = sClassCount;
+	for (int i = 0; i < classes; ++i) {
+		classNsec[i] = classRuns[i] = 0;
+		for (int n = 0; n < sSlotCount; ++n) {
+			classNsec[i] += sSlots[n].classNsec[i];
+			classRuns[i] += sSlots[n].classRuns[i];
+		}
+		int j;
+		for (j = i; j > 0 && classNsec[order[j - 1]] < classNsec[i]; --j)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	int len = snprintf(outText, inLength,
+					   "DSP load %.1f%% (peak %.1f%%), %lld buffers, %.1f ms computing\n",
+					   totals.dspLoad * 100.0, totals.peakLoad * 100.0,
+					   totals.buffers, msec(totals.bufferNsec));
+	for (int c = 0; c < kCategoryCount && len < inLength; ++c)
+		len += snprintf(outText + len, inLength - len, "  %-16s %10.2f ms\n",
+						sCategoryNames[c], msec(totals.nsec[c]));
+	if (len < inLength)
+		len += snprintf(outText + len, inLength - len, "  %-16s %10.2f ms\n",
+						"instruments", msec(totals.instrumentNsec));
+	for (int i = 0; i < classes && len < inLength; ++i) {
+		const int slot = order[i];
+		if (classRuns[slot] == 0)
+			continue;
+		len += snprintf(outText + len, inLength - len,
+						"  %-16s %10.2f ms %5.1f%% %9lld runs %8.2f usec/run\n",
+						sClassNames[slot], msec(classNsec[slot]),
+						totals.instrumentNsec > 0 ? classNsec[slot] * 100.0 / totals.instrumentNsec : 0.0,
+						classRuns[slot], classNsec[slot] * 1.0e-3 / classRuns[slot]);
+	}
+	return (len < inLength) ? len : inLength - 1;
+}
+
+void DSPStats::print()
+{
+	char text[4096];
+	report(text, sizeof(text));
+	RTPrintf("%s", text);
+}
@@ -0,0 +1,75 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _DSPSTATS_H_
+#define _DSPSTATS_H_ 1
+
+#include <time.h>
+#include <RTOption.h>
+
+// Where the time goes, kept only while the dsp_stats option is on.  Every
+// thread that renders adds its times to its own slot (the audio thread uses
+// slot 0, TaskManager threads the slots after it), so nothing is locked on
+// the audio path; the slots are summed when the numbers are read.  With the
+// option off, each timing point costs one test of a flag.
+//
+// The categories overlap: a bus pass includes the instruments run and mixed
+// during it, and an instrument's time includes its file reads.
+
+class DSPStats {
+public:
+	enum Category {
+		kToAuxPass,			// the three kinds of bus pass in inTraverse
+		kAuxToAuxPass,
+		kToOutPass,
+		kMixdown,			// mixing notes into buses
+		kFileRead,			// reading input files for notes
+		kCategoryCount
+	};
+	enum { kMaxClasses = 64 };		// notes of any classes past these are "other"
+
+	struct Totals {
+		double		dspLoad;		// recent compute time / buffer duration
+		double		peakLoad;
+		long long	buffers;
+		long long	nsec[kCategoryCount];
+		long long	instrumentNsec;
+		long long	bufferNsec;		// all compute time, not counting device I/O
+	};
+
+	static bool			enabled() { return RTOption::dspStats(); }
+	static long long	now();
+
+	// Make room for the audio thread and <inThreadCount> task threads.
+	static void			init(int inThreadCount);
+	static void			destroy();
+	// Clear everything counted so far.
+	static void			reset();
+
+	// The slot for notes named <inName>.  Called by the parser.
+	static int			classSlot(const char *inName);
+	static const char *	className(int inSlot);
+
+	// Called by any rendering thread.
+	static void			add(Category inCategory, long long inNsec);
+	static void			addInstrument(int inSlot, long long inNsec);
+
+	// Called by the audio thread at the end of each buffer of <inFrames>,
+	// with its compute time.  Prints the report every dsp_stats_interval secs.
+	static void			endBuffer(long long inNsec, int inFrames);
+
+	static void			getTotals(Totals *outTotals);
+	// Write a text report into <outText>, returning its length.
+	static int			report(char *outText, int inLength);
+	static void			print();
+};
+
+inline long long DSPStats::now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#endif	// _DSPSTATS_H_
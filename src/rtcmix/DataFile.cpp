@@ -7,7 +7,217 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <ugens.h>	// for message.c functions
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Asynchronous writing.  Each file written this way has a ring of bytes with
+// one writer, the note calling writeOne, and one reader, the writer thread,
+// which wakes every kPollMicros and writes whatever whole kWriteBlocks have
+// collected, and every kFlushPolls wakes, or once the DataFile is gone,
+// everything.  Neither side ever waits for the other.
+
+#define kQueueBytes		(1 << 20)		// per file; a power of two
+#define kWriteBlock		(64 * 1024)
+#define kPollMicros		20000
+#define kFlushPolls		50				// about once a second
+
+struct DataFileQueue {
+	DataFileQueue	*next;				// in sQueues
+	FILE			*stream;
+	char			*filename;
+	char			*ring;
+	volatile size_t	head;				// bytes put, ever
+	volatile size_t	tail;				// bytes written, ever
+	volatile long	dropped;			// items that found the ring full
+	volatile bool	closed;				// the DataFile is gone
+	bool			failed;				// a write failed
+};
+
+static pthread_mutex_t sQueueLock = PTHREAD_MUTEX_INITIALIZER;
+static DataFileQueue *sQueues = NULL;		// under sQueueLock
+static bool sWriterRunning = false;			// likewise
+static volatile bool sWriterStopping = false;
+static pthread_t sWriterThread;
+
+// Write out what <queue> holds: only whole blocks unless <all>.
+
+static void drainQueue(DataFileQueue *queue, const bool all)
+{
+	const size_t head = queue->head;
+	__sync_synchronize();		// see the bytes before head counted them
+	size_t avail = head - queue->tail;
+	if (!all)
+		avail -= avail % kWriteBlock;
+	while (avail > 0) {
+		const size_t at = queue->tail & (kQueueBytes - 1);
+		size_t count = kQueueBytes - at;
+		if (count > avail)
+			count = avail;
+		if (!queue->failed && fwrite(queue->ring + at, 1, count, queue->stream) != count)
+			queue->failed = true;
+		__sync_synchronize();	// done with the bytes before freeing them
+		queue->tail += count;
+		avail -= count;
+	}
+	if (all && !queue->failed)
+		fflush(queue->stream);
+}
+
+static void finishQueue(DataFileQueue *queue)
+{
+	drainQueue(queue, true);
+	if (queue->failed)
+		rterror(NULL, "Error writing data file \"%s\"\n", queue->filename);
+	if (queue->dropped > 0)
+		rtcmix_warn(NULL, "Data file \"%s\" is missing %ld items that came "
+					"faster than they could be written.\n",
+					queue->filename, (long) queue->dropped);
+	if (fclose(queue->stream) != 0)
+		rterror(NULL, "Error closing data file \"%s\": %s\n",
+				queue->filename, strerror(errno));
+	free(queue->filename);
+	delete [] queue->ring;
+	delete queue;
+}
+
+// Write out every queue, then close those whose DataFile is gone.  New
+// queues go on the front of the list, so it can be walked without the lock.
+
+static void writeQueues(const bool all)
+{
+	pthread_mutex_lock(&sQueueLock);
+	DataFileQueue *first = sQueues;
+	pthread_mutex_unlock(&sQueueLock);
+	bool closing = false;
+	for (DataFileQueue *queue = first; queue != NULL; queue = queue->next) {
+		const bool closed = queue->closed;
+		drainQueue(queue, all || closed);
+		closing = closing || closed;
+	}
+	if (!closing)
+		return;
+	DataFileQueue *finished = NULL;
+	pthread_mutex_lock(&sQueueLock);
+	for (DataFileQueue **link = &sQueues; *link != NULL; ) {
+		DataFileQueue *queue = *link;
+		if (queue->closed && queue->tail == queue->head) {
+			*link = queue->next;
+			queue->next = finished;
+			finished = queue;
+		}
+		else
+			link = &queue->next;
+	}
+	pthread_mutex_unlock(&sQueueLock);
+	while (finished != NULL) {
+		DataFileQueue *next = finished->next;
+		finishQueue(finished);
+		finished = next;
+	}
+}
+
+static void *writerMain(void *)
+{
+	int polls = 0;
+	while (!sWriterStopping) {
+		usleep(kPollMicros);
+		writeQueues(++polls % kFlushPolls == 0);
+	}
+	return NULL;
+}
+
+// Called by ~DataFile.  The writer thread finishes the queue if it is
+// running, or else we do it here.
+
+static void closeQueue(DataFileQueue *queue)
+{
+	pthread_mutex_lock(&sQueueLock);
+	if (sWriterRunning) {
+		queue->closed = true;
+		pthread_mutex_unlock(&sQueueLock);
+		return;
+	}
+	for (DataFileQueue **link = &sQueues; *link != NULL; link = &(*link)->next)
+		if (*link == queue) {
+			*link = queue->next;
+			break;
+		}
+	pthread_mutex_unlock(&sQueueLock);
+	finishQueue(queue);
+}
+
+void DataFile::stopAsyncWrites()
+{
+	pthread_mutex_lock(&sQueueLock);
+	const bool running = sWriterRunning;
+	sWriterRunning = false;		// from here on, ~DataFile closes its own file
+	pthread_mutex_unlock(&sQueueLock);
+	if (!running)
+		return;
+	sWriterStopping = true;
+	pthread_join(sWriterThread, NULL);
+	sWriterStopping = false;
+	writeQueues(true);
+}
+
+int DataFile::writeAsync()
+{
+	if (_stream == NULL || _queue != NULL)
+		return -1;
+	fflush(_stream);			// the header, before the thread writes
+	DataFileQueue *queue = new DataFileQueue;
+	queue->stream = _stream;
+	queue->filename = strdup(_filename);
+	queue->ring = new char[kQueueBytes];
+	queue->head = queue->tail = 0;
+	queue->dropped = 0;
+	queue->closed = false;
+	queue->failed = false;
+
+	pthread_mutex_lock(&sQueueLock);
+	if (!sWriterRunning) {
+		if (pthread_create(&sWriterThread, NULL, writerMain, NULL) != 0) {
+			pthread_mutex_unlock(&sQueueLock);
+			rterror(NULL, "Could not start the data file writer -- writing "
+					"\"%s\" as it goes\n", _filename);
+			free(queue->filename);
+			delete [] queue->ring;
+			delete queue;
+			return -1;
+		}
+		sWriterRunning = true;
+	}
+	queue->next = sQueues;
+	sQueues = queue;
+	pthread_mutex_unlock(&sQueueLock);
+
+	_queue = queue;
+	_stream = NULL;				// the queue owns it now
+	return 0;
+}
+
+// Put <count> bytes on the queue, or drop them if there isn't room.  Always
+// succeeds, as far as the caller need know.
+
+int DataFile::queueBytes(const void *bytes, const size_t count)
+{
+	DataFileQueue *queue = _queue;
+	const size_t head = queue->head;
+	if (kQueueBytes - (head - queue->tail) < count) {
+		queue->dropped++;
+		return 0;
+	}
+	const size_t at = head & (kQueueBytes - 1);
+	const size_t first = (count < kQueueBytes - at) ? count : kQueueBytes - at;
+	memcpy(queue->ring + at, bytes, first);
+	memcpy(queue->ring, (const char *) bytes + first, count - first);
+	__sync_synchronize();		// the bytes are there before head counts them
+	queue->head = head + count;
+	return 0;
+}
 
 
 DataFile::DataFile(const char *fileName, const int controlRate,
@@ -16,12 +226,17 @@ DataFile::DataFile(const char *fileName, const int controlRate,
 	  _headerbytes(0),
 	  _format(kDataFormatFloat), _datumsize(sizeof(float)), _fileitems(0),
 	  _controlrate(controlRate), _filerate(0), _timefactor(timeFactor),
-	  _increment(1.0), _counter(1.0), _lastval(0.0)
+	  _increment(1.0), _counter(1.0), _lastval(0.0),
+	  _map(NULL), _mapbytes(0), _readitem(0), _queue(NULL)
 {
 }
 
 DataFile::~DataFile()
 {
+	if (_map)
+		munmap((void *) _map, _mapbytes);
+	if (_queue)
+		closeQueue(_queue);
 }
 
 int DataFile::formatStringToCode(const char *str)
@@ -199,6 +414,10 @@ int DataFile::setSkipTime(const double skipTime, const bool absolute)
 	if (skipTime == 0.0)
 		return 0;
 	const long skipframes = int((_filerate * skipTime) + 0.5);
+	if (_map) {
+		_readitem = absolute ? skipframes : _readitem + skipframes;
+		return 0;
+	}
 	long skipbytes = skipframes * _datumsize;
 	int whence = absolute ? SEEK_SET : SEEK_CUR;
 	if (whence == SEEK_SET)
@@ -212,6 +431,65 @@ int DataFile::setSkipTime(const double skipTime, const bool absolute)
 	return 0;
 }
 
+int DataFile::mapFile()
+{
+	if (_stream == NULL)
+		return -1;
+	const long pos = ftell(_stream);
+	if (pos < 0 || _fileitems <= 0)
+		return -1;
+	const size_t bytes = _headerbytes + _fileitems * _datumsize;
+	void *map = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fileno(_stream), 0);
+	if (map == MAP_FAILED)
+		return -1;
+	_map = (const char *) map;
+	_mapbytes = bytes;
+	_readitem = (pos - _headerbytes) / _datumsize;	// after any skip so far
+	return 0;
+}
+
+// Return item <index> of the mapped data, converted to double.
+
+double DataFile::itemAt(const long index)
+{
+	const char *datum = _map + _headerbytes + index * _datumsize;
+	switch (_format) {
+		case kDataFormatDouble:
+			{
+				double raw;
+				memcpy(&raw, datum, sizeof(raw));
+				return _swap ? _swapit(raw) : raw;
+			}
+		case kDataFormatFloat:
+			{
+				float raw;
+				memcpy(&raw, datum, sizeof(raw));
+				return (double) (_swap ? _swapit(raw) : raw);
+			}
+		case kDataFormatInt64:
+			{
+				int64_t raw;
+				memcpy(&raw, datum, sizeof(raw));
+				return (double) (_swap ? _swapit(raw) : raw);
+			}
+		case kDataFormatInt32:
+			{
+				int32_t raw;
+				memcpy(&raw, datum, sizeof(raw));
+				return (double) (_swap ? _swapit(raw) : raw);
+			}
+		case kDataFormatInt16:
+			{
+				int16_t raw;
+				memcpy(&raw, datum, sizeof(raw));
+				return (double) (_swap ? _swapit(raw) : raw);
+			}
+		case kDataFormatByte:
+			return (double) (int8_t) *datum;
+	}
+	return 0.0;
+}
+
 // XXX need to parameterize writeOne and readOne by datafile format and swap,
 // but these two are stored as class members.
 
@@ -229,7 +507,7 @@ int DataFile::writeOne(const double val)
 					double raw = val;
 					if (_swap)
 						raw = _swapit(raw);
-					status = _write(raw);
+					status = put(raw);
 				}
 				break;
 			case kDataFormatFloat:
@@ -237,7 +515,7 @@ int DataFile::writeOne(const double val)
 					float raw = (float) val;
 					if (_swap)
 						raw = _swapit(raw);
-					status = _write(raw);
+					status = put(raw);
 				}
 				break;
 			case kDataFormatInt64:
@@ -245,7 +523,7 @@ int DataFile::writeOne(const double val)
 					int64_t raw = (int64_t) val;
 					if (_swap)
 						raw = _swapit(raw);
-					status = _write(raw);
+					status = put(raw);
 				}
 				break;
 			case kDataFormatInt32:
@@ -253,7 +531,7 @@ int DataFile::writeOne(const double val)
 					int32_t raw = (int32_t) val;
 					if (_swap)
 						raw = _swapit(raw);
-					status = _write(raw);
+					status = put(raw);
 				}
 				break;
 			case kDataFormatInt16:
@@ -261,11 +539,11 @@ int DataFile::writeOne(const double val)
 					int16_t raw = (int16_t) val;
 					if (_swap)
 						raw = _swapit(raw);
-					status = _write(raw);
+					status = put(raw);
 				}
 				break;
 			case kDataFormatByte:
-				status = _write((int8_t) val);
+				status = put((int8_t) val);
 				break;
 			default:
 				break;
@@ -279,6 +557,16 @@ int DataFile::writeOne(const double val)
 double DataFile::readOne()
 {
 	_counter -= 1.0;				// counting at client control rate
+	if (_map) {
+		while (_counter <= 0.0) {
+			_counter += _increment;
+			// As below, past the end we keep returning the last value.
+			if (_readitem >= 0 && _readitem < _fileitems)
+				_lastval = itemAt(_readitem);
+			_readitem++;
+		}
+		return _lastval;
+	}
 	while (_counter <= 0.0) {
 		_counter += _increment;
 
@@ -35,6 +35,7 @@ enum {
 
 const int kHeaderSize = sizeof(int32_t) * 3;		// header length in bytes
 
+struct DataFileQueue;	// see writeAsync()
 
 class DataFile : public RawDataFile {
 public:
@@ -57,6 +58,30 @@ public:
 
 	int setSkipTime(const double skipTime, const bool absolute = false);
 
+	// Call mapFile after readHeader to map the whole file into memory, so
+	// that readOne and setSkipTime become array lookups rather than stdio
+	// reads and seeks.  Any number of readers of the same file then share
+	// the one copy in the system's page cache.  After a successful call the
+	// stream is no longer needed and may be closed.  Returns -1 if the file
+	// can't be mapped, in which case reading goes through stdio as before.
+
+	int mapFile();
+
+	// Call writeAsync after writeHeader to have writeOne put its items on a
+	// queue rather than write them, so that it never waits on the disk.  A
+	// background thread, shared by every such file, writes each queue out in
+	// large blocks, and writes and closes the file after the DataFile is
+	// destroyed.  If a queue fills, items are dropped rather than waited for,
+	// and the loss is reported when the file is closed.  writeOne must then
+	// be called by one thread at a time.  Returns -1 if the thread can't be
+	// started, in which case writes stay synchronous.
+
+	int writeAsync();
+
+	// Write out every queue, and stop the thread.  Files whose DataFile still
+	// exists are flushed, and closed later by the DataFile.
+	static void stopAsyncWrites();
+
 	int writeOne(const double val);
 	double readOne();
 	int readFile(double *block, const long maxItems);
@@ -64,6 +89,14 @@ public:
 	static int formatStringToCode(const char *str);
 
 private:
+	double itemAt(const long index);
+	template <typename T>
+	inline int put(const T val)
+	{
+		return _queue ? queueBytes(&val, sizeof(T)) : _write(val);
+	}
+	int queueBytes(const void *bytes, const size_t count);
+
 	int _headerbytes;
 	int _format;
 	int _datumsize;
@@ -74,6 +107,10 @@ private:
 	double _increment;
 	double _counter;
 	double _lastval;		// used for reading only
+	const char *_map;		// whole file, if mapped
+	size_t _mapbytes;
+	long _readitem;			// next item to read from _map
+	DataFileQueue *_queue;	// if writing asynchronously
 };
 
 #endif // _DATAFILE_H_
@@ -0,0 +1,83 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _DENORMALS_H_
+#define _DENORMALS_H_ 1
+
+// Denormal floats -- the ones too small for a normal exponent -- take many
+// times longer than normal ones on most CPUs, and a decaying filter or
+// reverb tail makes a steady stream of them as it dies away.  With the
+// flush_denormals option (on by default), all rendering is done with the
+// CPU set to flush them to zero: the audio thread while it is in inTraverse,
+// and the TaskManager and WorkerPool threads, which only ever render.
+//
+// This is x86 (SSE) FTZ and DAZ, and AArch64 FZ.  Elsewhere (e.g. WASM)
+// there is no such mode, and instruments that feed back should rely on
+// Instrument::notifyAtNoiseFloor() instead.
+
+#include <RTOption.h>
+
+#if defined(__SSE2__) || defined(__SSE__)
+	#include <xmmintrin.h>
+	#define DENORMALS_SSE 1
+#elif defined(__aarch64__)
+	#define DENORMALS_AARCH64 1
+#endif
+
+namespace Denormals {
+
+#if defined(DENORMALS_SSE)
+	typedef unsigned int Mode;
+	inline Mode get() { return _mm_getcsr(); }
+	inline void set(Mode mode) { _mm_setcsr(mode); }
+	inline Mode flushing(Mode mode) { return mode | 0x8040; }	// FTZ | DAZ
+#elif defined(DENORMALS_AARCH64)
+	typedef unsigned long Mode;
+	inline Mode get() {
+		Mode mode;
+		__asm__ __volatile__("mrs %0, fpcr" : "=r" (mode));
+		return mode;
+	}
+	inline void set(Mode mode) { __asm__ __volatile__("msr fpcr, %0" : : "r" (mode)); }
+	inline Mode flushing(Mode mode) { return mode | (1UL << 24); }	// FZ
+#else
+	typedef int Mode;
+	inline Mode get() { return 0; }
+	inline void set(Mode) {}
+	inline Mode flushing(Mode mode) { return mode; }
+#endif
+
+	// For the threads that only render: flush from now on, if the option
+	// is on, or stop flushing if it has been turned off.
+
+	inline void apply() {
+		const Mode mode = get();
+		const Mode wanted = RTOption::flushDenormals() ? flushing(mode)
+													   : mode & ~flushing(0);
+		if (wanted != mode)
+			set(wanted);
+	}
+
+	// For the audio thread: flush while in scope, then restore the mode
+	// the audio driver (or host) had set.
+
+	class Scope {
+	public:
+		Scope() : _saved(get()), _changed(false) {
+			if (RTOption::flushDenormals()) {
+				const Mode flush = flushing(_saved);
+				if (flush != _saved) {
+					set(flush);
+					_changed = true;
+				}
+			}
+		}
+		~Scope() { if (_changed) set(_saved); }
+	private:
+		Mode _saved;
+		bool _changed;
+	};
+}
+
+#endif	/* _DENORMALS_H_ */
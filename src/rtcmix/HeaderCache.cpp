@@ -0,0 +1,164 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// HeaderCache.cpp -- sound file header info, and reading headers ahead.
+// See HeaderCache.h.
+
+#include "HeaderCache.h"
+#include <ugens.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#define PRESCAN_BYTES		65536	// more than any header we read
+#define PRESCAN_MAX_THREADS	8
+
+struct HeaderEntry {
+	dev_t				device;
+	ino_t				inode;
+	off_t				size;
+	time_t				mtime;
+	HeaderCache::Info	info;
+};
+
+typedef std::map<std::string, HeaderEntry> HeaderMap;
+
+static HeaderMap sHeaders;
+static pthread_mutex_t sHeaderLock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline bool sameFile(const HeaderEntry &entry, const struct stat &st)
+{
+	return entry.device == st.st_dev && entry.inode == st.st_ino
+		&& entry.size == st.st_size && entry.mtime == st.st_mtime;
+}
+
+bool HeaderCache::find(const char *path, const struct stat &st, Info *info)
+{
+	bool found = false;
+	pthread_mutex_lock(&sHeaderLock);
+	HeaderMap::const_iterator it = sHeaders.find(path);
+	if (it != sHeaders.end() && sameFile(it->second, st)) {
+		*info = it->second.info;
+		found = true;
+	}
+	pthread_mutex_unlock(&sHeaderLock);
+	return found;
+}
+
+void HeaderCache::store(const char *path, const struct stat &st, const Info &info)
+{
+	HeaderEntry entry;
+	entry.device = st.st_dev;
+	entry.inode = st.st_ino;
+	entry.size = st.st_size;
+	entry.mtime = st.st_mtime;
+	entry.info = info;
+	pthread_mutex_lock(&sHeaderLock);
+	sHeaders[path] = entry;
+	pthread_mutex_unlock(&sHeaderLock);
+}
+
+// The files one prescan() call queued, shared by its threads.  The last
+// thread to finish deletes it.
+
+struct PrescanJob {
+	std::vector<std::string>	paths;
+	volatile int				next;
+	volatile int				running;
+};
+
+static void readAhead(const std::string &path)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+		return;
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	char buf[PRESCAN_BYTES];
+	while (pread(fd, buf, sizeof(buf), 0) < 0 && errno == EINTR)
+		;
+	close(fd);
+}
+
+void *HeaderCache::prescanMain(void *arg)
+{
+	PrescanJob *job = (PrescanJob *) arg;
+	const int count = (int) job->paths.size();
+	int n;
+	while ((n = __sync_fetch_and_add(&job->next, 1)) < count)
+		readAhead(job->paths[n]);
+	if (__sync_sub_and_fetch(&job->running, 1) == 0)
+		delete job;
+	return NULL;
+}
+
+int HeaderCache::prescan(const char *path)
+{
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		rtcmix_warn("sfprescan", "\"%s\": %s", path, strerror(errno));
+		return -1;
+	}
+	PrescanJob *job = new PrescanJob;
+	if (S_ISDIR(st.st_mode)) {
+		DIR *dir = opendir(path);
+		if (dir == NULL) {
+			rtcmix_warn("sfprescan", "\"%s\": %s", path, strerror(errno));
+			delete job;
+			return -1;
+		}
+		const std::string prefix = std::string(path) + "/";
+		struct dirent *dp;
+		while ((dp = readdir(dir)) != NULL) {
+			if (dp->d_name[0] != '.')
+				job->paths.push_back(prefix + dp->d_name);
+		}
+		closedir(dir);
+	}
+	else
+		job->paths.push_back(path);
+
+	const int count = (int) job->paths.size();
+	if (count == 0) {
+		delete job;
+		return 0;
+	}
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+	if (threads > PRESCAN_MAX_THREADS)
+		threads = PRESCAN_MAX_THREADS;
+	if (threads > count)
+		threads = count;
+	job->next = 0;
+	job->running = threads;
+	__sync_synchronize();
+
+	int started = 0;
+	for (int n = 0; n < threads; ++n) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, prescanMain, job) != 0)
+			break;
+		pthread_detach(thread);
+		++started;
+	}
+	if (started < threads) {
+		// The threads that did start share the work; none left to start
+		// must be waited for.
+		if (__sync_sub_and_fetch(&job->running, threads - started) == 0)
+			delete job;
+		if (started == 0) {
+			rtcmix_warn("sfprescan", "Could not start a thread to read \"%s\"", path);
+			return -1;
+		}
+	}
+	return count;
+}
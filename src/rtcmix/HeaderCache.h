@@ -0,0 +1,47 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _HEADERCACHE_H_
+#define _HEADERCACHE_H_ 1
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// What open_sound_file() learned from the headers of the sound files it has
+// opened, so that a score that names the same file in rtinput, maketable,
+// filedur and the like parses its header only once.  An entry is keyed on
+// the path and holds the file's device, inode, size and modification time,
+// so a file that has been replaced or rewritten since is parsed again.
+//
+// prescan() starts reading the headers of a directory of sound files (or of
+// one file) in the background, on several threads at once, so that when
+// the score opens them, they are already in memory.  The parsing itself is
+// still done by open_sound_file(), since sndlib parses into one global
+// header buffer.
+
+class HeaderCache {
+public:
+	struct Info {
+		int		type;
+		int		format;
+		int		location;
+		double	srate;
+		int		chans;
+		long	samples;
+	};
+
+	// Fill <info> for <path>, whose stat() is <st>.  Returns false if there
+	// is no entry, or the file has changed since.
+	static bool		find(const char *path, const struct stat &st, Info *info);
+	static void		store(const char *path, const struct stat &st, const Info &info);
+
+	// Returns the number of files queued for reading, or -1 if <path>
+	// can't be read or no thread could be started.
+	static int		prescan(const char *path);
+
+private:
+	static void *	prescanMain(void *);
+};
+
+#endif	// _HEADERCACHE_H_
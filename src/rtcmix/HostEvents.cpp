@@ -0,0 +1,140 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// HostEvents.cpp -- events for an embedding host.  See HostEvents.h.
+
+#include "HostEvents.h"
+#include <string.h>
+
+#define BANG_SLOTS		64
+#define VALUE_SLOTS		16
+
+// As in PrintRing.cpp: slot (t % slots) holds ticket t once its sequence is
+// 2 * (t / slots) + 1, and is free for it while it is one less.  Posters
+// claim tickets from the head; the one taker follows at the tail.
+
+struct BangEvent {
+	volatile unsigned long long	sequence;
+	FRAMETYPE	frame;
+};
+
+struct ValueEvent {
+	volatile unsigned long long	sequence;
+	FRAMETYPE	frame;
+	int			count;
+	float		values[HostEvents::kMaxValues];
+};
+
+static BangEvent sBangs[BANG_SLOTS];
+static volatile unsigned long long sBangHead = 0;
+static unsigned long long sBangTail = 0;
+
+static ValueEvent sValues[VALUE_SLOTS];
+static volatile unsigned long long sValueHead = 0;
+static unsigned long long sValueTail = 0;
+
+// Claim the next slot of a ring of <slots> events, or return NULL if it is
+// full.  <ticket> is set to the ticket claimed.
+
+template <typename Event>
+static Event *claim(Event *ring, int slots, volatile unsigned long long *head,
+					unsigned long long *ticket)
+{
+	for (;;) {
+		const unsigned long long t = *head;
+		Event *event = &ring[t % slots];
+		const unsigned long long vacant = 2 * (t / slots);
+		const unsigned long long sequence = event->sequence;
+		if (sequence == vacant) {
+			if (__sync_bool_compare_and_swap(head, t, t + 1)) {
+				*ticket = t;
+				return event;
+			}
+		}
+		else if (sequence < vacant)		// not yet taken from the last lap
+			return NULL;
+		// Otherwise another thread has just taken this ticket.
+	}
+}
+
+template <typename Event>
+static void publish(Event *event, int slots, unsigned long long ticket)
+{
+	__sync_synchronize();
+	event->sequence = 2 * (ticket / slots) + 1;
+}
+
+// The event at <tail>, if it has been posted.
+
+template <typename Event>
+static Event *posted(Event *ring, int slots, unsigned long long tail)
+{
+	Event *event = &ring[tail % slots];
+	if (event->sequence != 2 * (tail / slots) + 1)
+		return NULL;
+	__sync_synchronize();
+	return event;
+}
+
+template <typename Event>
+static void release(Event *event, int slots, unsigned long long *tail)
+{
+	__sync_synchronize();
+	event->sequence = 2 * (*tail / slots) + 2;
+	++*tail;
+}
+
+void HostEvents::postBang(FRAMETYPE frame)
+{
+	unsigned long long ticket;
+	BangEvent *event = claim(sBangs, BANG_SLOTS, &sBangHead, &ticket);
+	if (event == NULL)
+		return;
+	event->frame = frame;
+	publish(event, BANG_SLOTS, ticket);
+}
+
+void HostEvents::postValues(FRAMETYPE frame, const float *values, int count)
+{
+	if (count > kMaxValues)
+		count = kMaxValues;
+	unsigned long long ticket;
+	ValueEvent *event = claim(sValues, VALUE_SLOTS, &sValueHead, &ticket);
+	if (event == NULL)
+		return;
+	event->frame = frame;
+	event->count = count;
+	memcpy(event->values, values, count * sizeof(float));
+	publish(event, VALUE_SLOTS, ticket);
+}
+
+bool HostEvents::takeBang()
+{
+	bool banged = false;
+	BangEvent *event;
+	while ((event = posted(sBangs, BANG_SLOTS, sBangTail)) != NULL) {
+		banged = true;
+		release(event, BANG_SLOTS, &sBangTail);
+	}
+	return banged;
+}
+
+int HostEvents::takeValues(float *values)
+{
+	int count = 0;
+	bool found = false;
+	FRAMETYPE latest = 0;
+	ValueEvent *event;
+	while ((event = posted(sValues, VALUE_SLOTS, sValueTail)) != NULL) {
+		// Threads post in any order; ties go to the one posted last.
+		if (!found || event->frame >= latest) {
+			found = true;
+			latest = event->frame;
+			count = event->count;
+			memcpy(values, event->values, count * sizeof(float));
+		}
+		release(event, VALUE_SLOTS, &sValueTail);
+	}
+	return count;
+}
@@ -0,0 +1,37 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _HOSTEVENTS_H_
+#define _HOSTEVENTS_H_ 1
+
+#include <rt_types.h>
+
+// Bangs and lists of values sent back to an embedding host (the rtcmix~
+// objects for Max and Pd, say) by MAXBANG, MAXMESSAGE and the like.
+// Instruments post them from whichever thread runs them, into fixed rings,
+// with no locking or allocation.  Each event carries the output frame it
+// belongs to.  Once a buffer, checkForBang() and checkForVals() take what
+// has been posted: a bang, if any was, goes to the host's bang callback,
+// and of the lists, the one for the latest frame goes to its values
+// callback, so a note posting meter readings every buffer costs the host
+// one call per buffer however many threads post them.
+//
+// Events that find a ring full are lost.
+
+class HostEvents {
+public:
+	enum { kMaxValues = 1024 };		// MAXDISPARGS
+
+	static void		postBang(FRAMETYPE frame);
+	// Post <count> (up to kMaxValues) <values>.
+	static void		postValues(FRAMETYPE frame, const float *values, int count);
+
+	// Called once a buffer, by one thread.  True if a bang was posted.
+	static bool		takeBang();
+	// Copy the latest list posted into <values>, and return its length,
+	// or 0 if none was.
+	static int		takeValues(float *values);
+};
+
+#endif	// _HOSTEVENTS_H_
@@ -0,0 +1,101 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _INDEXEDJOB_H_
+#define _INDEXEDJOB_H_ 1
+
+#include "AllocTracker.h"
+#include <stdint.h>
+
+// A job of calls func(context, n) for n from 0 to count - 1, which any number
+// of threads can take indices from.  Used by WorkerPool and by TaskManager's
+// sub-tasks.
+//
+// <mState> holds the job's generation in its top half and the next index to
+// hand out in its bottom half, so claiming an index is one compare-and-swap
+// that fails if the job has changed since the claimer looked at it.  start()
+// first moves to the new generation with the index set to kClosed, then
+// fills in the fields, then opens the job.  A claimer that read the old
+// state therefore cannot succeed once any field has been overwritten, and
+// one that reads the new generation cannot claim until the fields are
+// all in place.  The claimer also checks that the state has not changed
+// while it read the fields, so it never calls a function with the wrong
+// context.
+
+class IndexedJob {
+public:
+	typedef void (*Function)(void *context, int index);
+
+	IndexedJob() : mState(0), mFunc(0), mContext(0), mCount(0), mDone(0),
+		mNote(AllocTracker::kScheduler) {}
+
+	// Only one thread at a time may start a job, and only after the
+	// previous one has finished().  Returns the new generation.
+	unsigned start(Function func, void *context, int count, int note) {
+		const unsigned generation = generationOf(mState) + 1;
+		__sync_lock_test_and_set(&mState, ((uint64_t) generation << 32) | kClosed);
+		__sync_synchronize();
+		mFunc = func;
+		mContext = context;
+		mCount = count;
+		mNote = note;
+		mDone = 0;
+		__sync_bool_compare_and_swap(&mState, ((uint64_t) generation << 32) | kClosed,
+									 (uint64_t) generation << 32);
+		return generation;
+	}
+
+	// Claim one index of job <generation> (or of the current job, if 0) and
+	// make its call.  Returns false when there is nothing left to claim.
+	bool runOne(unsigned generation = 0) {
+		for (;;) {
+			const uint64_t state = mState;
+			__sync_synchronize();
+			if (generation != 0 && generationOf(state) != generation)
+				return false;
+			const unsigned index = (unsigned) (state & 0xffffffff);
+			if (index == kClosed)
+				return false;
+			Function func = mFunc;
+			void *context = mContext;
+			const int count = mCount;
+			const int note = mNote;
+			__sync_synchronize();
+			if (mState != state)
+				continue;
+			if ((int) index >= count)
+				return false;
+			if (__sync_bool_compare_and_swap(&mState, state, state + 1)) {
+				AllocTracker::NoteScope scope(note);
+				(*func)(context, (int) index);
+				__sync_fetch_and_add(&mDone, 1);
+				return true;
+			}
+		}
+	}
+
+	// True while job <generation> is still being set up by start().
+	bool opening(unsigned generation) const {
+		const uint64_t state = mState;
+		return generationOf(state) == generation
+			&& (unsigned) (state & 0xffffffff) == kClosed;
+	}
+
+	bool finished() const { return mDone >= mCount; }
+	unsigned generation() const { return generationOf(mState); }
+
+private:
+	enum { kClosed = 0xffffffff };
+
+	static unsigned generationOf(uint64_t state) { return (unsigned) (state >> 32); }
+
+	volatile uint64_t	mState;
+	volatile Function	mFunc;
+	void * volatile		mContext;
+	volatile int		mCount;
+	volatile int		mDone;		// calls finished
+	volatile int		mNote;		// for AllocTracker
+};
+
+#endif	// _INDEXEDJOB_H_
@@ -5,6 +5,7 @@
 //
 
 #include "InputFile.h"
+#include "InputStream.h"
 #include "RTcmix.h"
 #include <sndlib.h>
 #include <assert.h>
@@ -12,13 +13,26 @@
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <new>
 #include <sndlibsupport.h>
 #include <ugens.h>
 #include "byte_routines.h"
+#include <RefCounted.h>
+#include <RTOption.h>
+#include <pthread.h>
+#include <stdint.h>
 #ifdef MULTI_THREAD
 #include "RTThread.h"
 #endif
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define DECODE_SIMD 1
+#include <emmintrin.h>
+#endif
+
 #undef FILE_DEBUG
 
 /* The define below is to disable some fancy bus-mapping code for file
@@ -64,82 +78,282 @@
 static inline long lmin(long a, long b) { return a < b ? a : b; }
 static inline long lmax(long a, long b) { return a > b ? a : b; }
 
-
-/* ----------------------------------------------------- read_float_samps --- */
+/* Passed to the read functions below in place of a file descriptor when
+   read_buffer already holds the samples, because it points into a mapped
+   file.  The caller makes sure the whole request lies within the file.
+*/
+#define MAPPED_FD NO_FD
+
+/* ----------------------------------------------------- fill_read_buffer --- */
+/* Read <bytes_requested> bytes at <cur_offset> into <read_buffer>, zeroing
+   whatever lies past <endbyte>.  This uses pread, which leaves the fd's file
+   offset alone, so any number of threads can read the same file at once.
+*/
 static int
-read_float_samps(
-      int         fd,               /* file descriptor for open input file */
-      int         data_format,      /* sndlib data format of input file */
-      int         file_chans,       /* total chans in input file */
-      off_t       cur_offset,       /* current file position before read */
-      long        endbyte,          /* first byte following last file sample */
-      BufPtr      dest,             /* interleaved buffer from inst */
-      int         dest_chans,       /* number of chans interleaved */
-      int         dest_frames,      /* frames in interleaved buffer */
-      const short src_chan_list[],  /* list of in-bus chan numbers from inst */
-                 /* (or NULL to fill all chans) */
-      short       src_chans,         /* number of in-bus chans to copy */
-      void *      read_buffer        /* block to read from disk into */
-      )
-{    
-    const int bytes_per_samp = sizeof(float);
+fill_read_buffer(int fd, off_t cur_offset, long endbyte, int bytes_requested,
+                 void *read_buffer, const char *caller)
+{
     char *bufp = (char *) read_buffer;
-    
-    const int bytes_requested = dest_frames * file_chans * bytes_per_samp;
     const long bytes_remaining = endbyte - cur_offset;
-    const long extra_bytes = (bytes_requested > bytes_remaining)
-    ? bytes_requested - bytes_remaining : 0;
-    ssize_t bytes_to_read = lmin(bytes_remaining, bytes_requested);
+    ssize_t bytes_to_read = lmax(0L, lmin(bytes_remaining, bytes_requested));
     
+    off_t file_pos = cur_offset;
     while (bytes_to_read > 0) {
-        ssize_t bytes_read = read(fd, bufp, bytes_to_read);
+        ssize_t bytes_read = pread(fd, bufp, bytes_to_read, file_pos);
         if (bytes_read == -1) {
-            perror("read_float_samps (read)");
+            if (errno == EINTR)
+                continue;
+            perror(caller);
             return FILE_ERROR;
         }
         if (bytes_read == 0)          /* EOF */
             break;
         
         bufp += bytes_read;
+        file_pos += bytes_read;
         bytes_to_read -= bytes_read;
     }
     
     /* If we reached EOF, zero out remaining part of buffer that we
      expected to fill.
      */
-    bytes_to_read += extra_bytes;
-    while (bytes_to_read > 0) {
-        (* (float *) bufp) = 0.0;
-        bufp += bytes_per_samp;
-        bytes_to_read -= bytes_per_samp;
+    memset(bufp, 0, bytes_requested - (bufp - (char *) read_buffer));
+    return 0;
+}
+
+
+/* ------------------------------------------------------ sample decoders --- */
+/* Each decoder turns the file sample at <p> into a BUFTYPE with get(), and
+   <count> samples in a row with run(), four or eight at a time with SSE2.
+   Swap means the file's byte order is not ours; Big that a 24-bit file is
+   big-endian.  decode_samps() below uses run() when the instrument takes
+   every channel of the file, as nearly all do, and otherwise copies the
+   channels it takes one at a time.
+*/
+
+static inline uint16_t load16(const unsigned char *p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t load32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t swap32(uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0xff00U) | ((v << 8) & 0xff0000U) | (v << 24);
+}
+
+#ifdef DECODE_SIMD
+static inline __m128i swap16x8(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i swap32x4(__m128i v)
+{
+    v = swap16x8(v);
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+#endif
+
+template <bool Swap>
+struct ShortDecoder {
+    enum { kBytes = 2 };
+    static BUFTYPE get(const unsigned char *p) {
+        uint16_t v = load16(p);
+        if (Swap)
+            v = (uint16_t) ((v >> 8) | (v << 8));
+        return (BUFTYPE) (int16_t) v;
     }
-    
-    /* Copy interleaved file buffer to dest buffer, with bus mapping. */
-    
-    const int src_samps = dest_frames * file_chans;
-    float *fbuf = (float *) read_buffer;
-    
+    static void run(const unsigned char *p, BufPtr dest, int count) {
+        int n = 0;
+#ifdef DECODE_SIMD
+        for ( ; n + 8 <= count; n += 8, p += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) p);
+            if (Swap)
+                v = swap16x8(v);
+            // Each short into the top of a 32-bit lane, then shifted back down
+            // with its sign.
+            const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(&dest[n], _mm_cvtepi32_ps(lo));
+            _mm_storeu_ps(&dest[n + 4], _mm_cvtepi32_ps(hi));
+        }
+#endif
+        for ( ; n < count; n++, p += kBytes)
+            dest[n] = get(p);
+    }
+};
+
+template <bool Big>
+struct Int24Decoder {
+    enum { kBytes = 3 };
+    static BUFTYPE get(const unsigned char *p) {
+        const int samp = Big ? (int) ((p[0] << 24) + (p[1] << 16) + (p[2] << 8)) >> 8
+                             : (int) ((p[2] << 24) + (p[1] << 16) + (p[0] << 8)) >> 8;
+        return (BUFTYPE) samp * (1 / (BUFTYPE) (1 << 8));
+    }
+    static void run(const unsigned char *p, BufPtr dest, int count) {
+        int n = 0;
+#ifdef DECODE_SIMD
+        // Four 4-byte loads, 3 bytes apart.  The last one reads the first
+        // byte of the next sample, so the final four are left to get().
+        const __m128 scale = _mm_set1_ps(1 / (BUFTYPE) (1 << 8));
+        for ( ; n + 4 < count; n += 4, p += 12) {
+            __m128i v = _mm_setr_epi32((int) load32(p), (int) load32(p + 3),
+                                       (int) load32(p + 6), (int) load32(p + 9));
+            v = Big ? swap32x4(v) : _mm_slli_epi32(v, 8);
+            v = _mm_srai_epi32(v, 8);
+            _mm_storeu_ps(&dest[n], _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+#endif
+        for ( ; n < count; n++, p += kBytes)
+            dest[n] = get(p);
+    }
+};
+
+template <bool Swap>
+struct Int32Decoder {
+    enum { kBytes = 4 };
+    static BUFTYPE get(const unsigned char *p) {
+        uint32_t v = load32(p);
+        if (Swap)
+            v = swap32(v);
+        return (BUFTYPE) (int32_t) v * (1 / (BUFTYPE) (1 << 16));
+    }
+    static void run(const unsigned char *p, BufPtr dest, int count) {
+        int n = 0;
+#ifdef DECODE_SIMD
+        const __m128 scale = _mm_set1_ps(1 / (BUFTYPE) (1 << 16));
+        for ( ; n + 4 <= count; n += 4, p += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) p);
+            if (Swap)
+                v = swap32x4(v);
+            _mm_storeu_ps(&dest[n], _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+        }
+#endif
+        for ( ; n < count; n++, p += kBytes)
+            dest[n] = get(p);
+    }
+};
+
+template <bool Swap>
+struct FloatDecoder {
+    enum { kBytes = 4 };
+    static BUFTYPE get(const unsigned char *p) {
+        uint32_t v = load32(p);
+        if (Swap)
+            v = swap32(v);
+        float f;
+        memcpy(&f, &v, sizeof(f));
+        return (BUFTYPE) f;
+    }
+    static void run(const unsigned char *p, BufPtr dest, int count) {
+        int n = 0;
+#ifdef DECODE_SIMD
+        for ( ; n + 4 <= count; n += 4, p += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) p);
+            if (Swap)
+                v = swap32x4(v);
+            _mm_storeu_ps(&dest[n], _mm_castsi128_ps(v));
+        }
+#endif
+        for ( ; n < count; n++, p += kBytes)
+            dest[n] = get(p);
+    }
+};
+
+/* ------------------------------------------------------- decode_samps --- */
+/* Convert <dest_frames> frames of <file_chans> channels from <read_buffer>
+   into <dest>, interleaved with <dest_chans> channels, taking channel
+   <chan_list>[n] (or n, if <chan_list> is NULL) for each n.
+*/
+template <typename Decoder>
+static void
+decode_samps(const void *read_buffer, int file_chans, BufPtr dest,
+             int dest_chans, int dest_frames, const short chan_list[])
+{
+    const unsigned char *src = (const unsigned char *) read_buffer;
+    if (chan_list == NULL && dest_chans == file_chans) {
+        Decoder::run(src, dest, dest_frames * file_chans);
+        return;
+    }
+    const int stride = file_chans * Decoder::kBytes;
     for (int n = 0; n < dest_chans; n++) {
+        const int chan = chan_list ? chan_list[n] : n;
+        const unsigned char *p = src + chan * Decoder::kBytes;
+        BufPtr out = dest + n;
+        for (int f = 0; f < dest_frames; f++, p += stride, out += dest_chans)
+            *out = Decoder::get(p);
+    }
+}
+
+/* The channels an instrument reads from a file; see the comment above. */
+static inline const short *
+chan_map(const short src_chan_list[])
+{
 #ifdef IGNORE_BUS_COUNT_FOR_FILE_INPUT
-        const int chan = n;
+    return NULL;
 #else
-        const int chan = src_chan_list ? src_chan_list[n] : n;
+    return src_chan_list;
 #endif
-        int j = n;
-        for (int i = chan; i < src_samps; i += file_chans, j += dest_chans)
-            dest[j] = (BUFTYPE) fbuf[i];
-    }
-    
+}
+
+static inline bool
+swapped(int data_format)
+{
 #if MUS_LITTLE_ENDIAN
-    const bool swap = IS_BIG_ENDIAN_FORMAT(data_format);
+    return IS_BIG_ENDIAN_FORMAT(data_format);
 #else
-    const bool swap = IS_LITTLE_ENDIAN_FORMAT(data_format);
+    return IS_LITTLE_ENDIAN_FORMAT(data_format);
 #endif
-    if (swap) {
-        for (int i = 0; i < src_samps; i++)
-            byte_reverse4(&dest[i]);
+}
+
+
+/* ----------------------------------------------------- read_float_samps --- */
+static int
+read_float_samps(
+      int         fd,               /* file descriptor for open input file */
+      int         data_format,      /* sndlib data format of input file */
+      int         file_chans,       /* total chans in input file */
+      off_t       cur_offset,       /* current file position before read */
+      long        endbyte,          /* first byte following last file sample */
+      BufPtr      dest,             /* interleaved buffer from inst */
+      int         dest_chans,       /* number of chans interleaved */
+      int         dest_frames,      /* frames in interleaved buffer */
+      const short src_chan_list[],  /* list of in-bus chan numbers from inst */
+                 /* (or NULL to fill all chans) */
+      short       src_chans,         /* number of in-bus chans to copy */
+      void *      read_buffer        /* block to read from disk into */
+      )
+{    
+    const int bytes_per_samp = sizeof(float);
+    if (fd != MAPPED_FD) {
+        const int status = fill_read_buffer(fd, cur_offset, endbyte,
+                                   dest_frames * file_chans * bytes_per_samp,
+                                   read_buffer, "read_float_samps");
+        if (status != 0)
+            return status;
     }
     
+    /* Copy interleaved file buffer to dest buffer, with bus mapping. */
+    
+    const short *chans = chan_map(src_chan_list);
+    if (swapped(data_format))
+        decode_samps<FloatDecoder<true> >(read_buffer, file_chans, dest,
+                                          dest_chans, dest_frames, chans);
+    else
+        decode_samps<FloatDecoder<false> >(read_buffer, file_chans, dest,
+                                           dest_chans, dest_frames, chans);
+    
     return 0;
 }
 
@@ -163,68 +377,23 @@ read_24bit_samps(
 {
     
     const int bytes_per_samp = 3;         /* 24-bit int */
-    unsigned char *bufp = (unsigned char *) read_buffer;
-    
-    const int bytes_requested = dest_frames * file_chans * bytes_per_samp;
-    const long bytes_remaining = endbyte - cur_offset;
-    const long extra_bytes = (bytes_requested > bytes_remaining)
-    ? bytes_requested - bytes_remaining : 0;
-    ssize_t bytes_to_read = lmin(bytes_remaining, bytes_requested);
-    
-    while (bytes_to_read > 0) {
-        ssize_t bytes_read = read(fd, bufp, bytes_to_read);
-        if (bytes_read == -1) {
-            perror("read_24bit_samps (read)");
-            return FILE_ERROR;
-        }
-        if (bytes_read == 0)          /* EOF */
-            break;
-        
-        bufp += bytes_read;
-        bytes_to_read -= bytes_read;
-    }
-    
-    /* If we reached EOF, zero out remaining part of buffer that we
-     expected to fill.
-     */
-    bytes_to_read += extra_bytes;
-    while (bytes_to_read > 0) {
-        *bufp++ = 0;
-        bytes_to_read--;
+    if (fd != MAPPED_FD) {
+        const int status = fill_read_buffer(fd, cur_offset, endbyte,
+                                   dest_frames * file_chans * bytes_per_samp,
+                                   read_buffer, "read_24bit_samps");
+        if (status != 0)
+            return status;
     }
     
     /* Copy interleaved file buffer to dest buffer, with bus mapping. */
     
-    const int src_samps = dest_frames * file_chans;
-    const BUFTYPE scaleFactor = 1 / (BUFTYPE) (1 << 8);
-    unsigned char *cbuf = (unsigned char *) read_buffer;
-    
-    for (int n = 0; n < dest_chans; n++) {
-#ifdef IGNORE_BUS_COUNT_FOR_FILE_INPUT
-        const int chan = n;
-#else
-        const int chan = src_chan_list ? src_chan_list[n] : n;
-#endif
-        int i = chan * bytes_per_samp;
-        const int incr = file_chans * bytes_per_samp;
-        const int src_bytes = src_samps * bytes_per_samp;
-        if (data_format == MUS_L24INT) {
-            for (int j = n; i < src_bytes; i += incr, j += dest_chans) {
-                int samp = (int) (((cbuf[i + 2] << 24)
-                                   + (cbuf[i + 1] << 16)
-                                   + (cbuf[i] << 8)) >> 8);
-                dest[j] = (BUFTYPE) samp * scaleFactor;
-            }
-        }
-        else {   /* data_format == MUS_B24INT */
-            for (int j = n; i < src_bytes; i += incr, j += dest_chans) {
-                int samp = (int) (((cbuf[i] << 24)
-                                   + (cbuf[i + 1] << 16)
-                                   + (cbuf[i + 2] << 8)) >> 8);
-                dest[j] = (BUFTYPE) samp * scaleFactor;
-            }
-        }
-    }
+    const short *chans = chan_map(src_chan_list);
+    if (data_format == MUS_L24INT)
+        decode_samps<Int24Decoder<false> >(read_buffer, file_chans, dest,
+                                           dest_chans, dest_frames, chans);
+    else    /* data_format == MUS_B24INT */
+        decode_samps<Int24Decoder<true> >(read_buffer, file_chans, dest,
+                                          dest_chans, dest_frames, chans);
     
     return 0;
 }
@@ -247,70 +416,24 @@ read_32bit_samps(
 )
 {
     
-    const int bytes_per_samp = 4;         /* 24-bit int */
-    unsigned char *bufp = (unsigned char *) read_buffer;
-    
-    const int bytes_requested = dest_frames * file_chans * bytes_per_samp;
-    const long bytes_remaining = endbyte - cur_offset;
-    const long extra_bytes = (bytes_requested > bytes_remaining)
-    ? bytes_requested - bytes_remaining : 0;
-    ssize_t bytes_to_read = lmin(bytes_remaining, bytes_requested);
-    
-    while (bytes_to_read > 0) {
-        ssize_t bytes_read = read(fd, bufp, bytes_to_read);
-        if (bytes_read == -1) {
-            perror("read_24bit_samps (read)");
-            return FILE_ERROR;
-        }
-        if (bytes_read == 0)          /* EOF */
-            break;
-        
-        bufp += bytes_read;
-        bytes_to_read -= bytes_read;
-    }
-    
-    /* If we reached EOF, zero out remaining part of buffer that we
-     expected to fill.
-     */
-    bytes_to_read += extra_bytes;
-    while (bytes_to_read > 0) {
-        *bufp++ = 0;
-        bytes_to_read--;
+    const int bytes_per_samp = 4;         /* 32-bit int */
+    if (fd != MAPPED_FD) {
+        const int status = fill_read_buffer(fd, cur_offset, endbyte,
+                                   dest_frames * file_chans * bytes_per_samp,
+                                   read_buffer, "read_32bit_samps");
+        if (status != 0)
+            return status;
     }
     
     /* Copy interleaved file buffer to dest buffer, with bus mapping. */
     
-#if MUS_LITTLE_ENDIAN
-    const bool swap = IS_BIG_ENDIAN_FORMAT(data_format);
-#else
-    const bool swap = IS_LITTLE_ENDIAN_FORMAT(data_format);
-#endif
-
-    const int src_samps = dest_frames * file_chans;
-    const BUFTYPE scaleFactor = 1 / (BUFTYPE) (1 << 16);
-    const unsigned offset = 2U << 15;
-    int *ibuf = (int *)read_buffer;
-
-    for (int n = 0; n < dest_chans; n++) {
-#ifdef IGNORE_BUS_COUNT_FOR_FILE_INPUT
-        const int chan = n;
-#else
-        const int chan = src_chan_list ? src_chan_list[n] : n;
-#endif
-        if (swap) {
-            int j = n;
-            for (int i = chan; i < src_samps; i += file_chans, j += dest_chans) {
-                const int out = (int)(reverse_int4(&ibuf[i]));
-                dest[j] = (BUFTYPE) out;
-            }
-        }
-        else {
-            int j = n;
-            for (int i = chan; i < src_samps; i += file_chans, j += dest_chans) {
-                dest[j] = (BUFTYPE) (ibuf[i] * scaleFactor);
-            }
-        }
-    }
+    const short *chans = chan_map(src_chan_list);
+    if (swapped(data_format))
+        decode_samps<Int32Decoder<true> >(read_buffer, file_chans, dest,
+                                          dest_chans, dest_frames, chans);
+    else
+        decode_samps<Int32Decoder<false> >(read_buffer, file_chans, dest,
+                                           dest_chans, dest_frames, chans);
     
     return 0;
 }
@@ -333,96 +456,159 @@ read_short_samps(
       )
 {
     const int bytes_per_samp = 2;         /* short int */
-    char *bufp = (char *) read_buffer;
-    
-    const int bytes_requested = dest_frames * file_chans * bytes_per_samp;
-    const long bytes_remaining = endbyte - cur_offset;
-    const long extra_bytes = (bytes_requested > bytes_remaining)
-    ? bytes_requested - bytes_remaining : 0;
-    ssize_t bytes_to_read = lmin(bytes_remaining, bytes_requested);
-    
-    while (bytes_to_read > 0) {
-        ssize_t bytes_read = read(fd, bufp, bytes_to_read);
-        if (bytes_read == -1) {
-            perror("read_short_samps (read)");
-            return FILE_ERROR;
-        }
-        if (bytes_read == 0)          /* EOF */
-            break;
-        
-        bufp += bytes_read;
-        bytes_to_read -= bytes_read;
-    }
-    
-    /* If we reached EOF, zero out remaining part of buffer that we
-     expected to fill.
-     */
-    bytes_to_read += extra_bytes;
-    while (bytes_to_read > 0) {
-        (* (short *) bufp) = 0;
-        bufp += bytes_per_samp;
-        bytes_to_read -= bytes_per_samp;
+    if (fd != MAPPED_FD) {
+        const int status = fill_read_buffer(fd, cur_offset, endbyte,
+                                   dest_frames * file_chans * bytes_per_samp,
+                                   read_buffer, "read_short_samps");
+        if (status != 0)
+            return status;
     }
     
     /* Copy interleaved file buffer to dest buffer, with bus mapping. */
     
-#if MUS_LITTLE_ENDIAN
-    const bool swap = IS_BIG_ENDIAN_FORMAT(data_format);
-#else
-    const bool swap = IS_LITTLE_ENDIAN_FORMAT(data_format);
-#endif
-    
-    const int src_samps = dest_frames * file_chans;
-    short *sbuf = (short *)read_buffer;
-    
-    for (int n = 0; n < dest_chans; n++) {
-#ifdef IGNORE_BUS_COUNT_FOR_FILE_INPUT
-        const int chan = n;
-#else
-        const int chan = src_chan_list ? src_chan_list[n] : n;
-#endif
-        if (swap) {
-            int j = n;
-            for (int i = chan; i < src_samps; i += file_chans, j += dest_chans) {
-                sbuf[i] = reverse_int2(&sbuf[i]);
-                dest[j] = (BUFTYPE) sbuf[i];
-            }
-        }
-        else {
-            int j = n;
-            for (int i = chan; i < src_samps; i += file_chans, j += dest_chans)
-                dest[j] = (BUFTYPE) sbuf[i];
-        }
-    }
+    const short *chans = chan_map(src_chan_list);
+    if (swapped(data_format))
+        decode_samps<ShortDecoder<true> >(read_buffer, file_chans, dest,
+                                          dest_chans, dest_frames, chans);
+    else
+        decode_samps<ShortDecoder<false> >(read_buffer, file_chans, dest,
+                                           dest_chans, dest_frames, chans);
     
     return 0;
 }
 
 char InputFile::sScratchBuffer[sScratchBufferSize];
 
+// The pool of open input descriptors.  Inputs are opened and referenced
+// on the parser thread, but released wherever their last note is deleted.
+
+InputFile *InputFile::sPoolHead = NULL;
+InputFile *InputFile::sPoolTail = NULL;
+int InputFile::sPoolCount = 0;
+static pthread_mutex_t sPoolLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int poolLimit()
+{
+	int limit = RTOption::maxOpenInputs();
+	if (limit <= 0) {
+		const long openMax = sysconf(_SC_OPEN_MAX);
+		limit = (openMax > 0) ? (int) lmin(openMax / 2, 0x7fffffffL) : 64;
+	}
+	return limit;
+}
+
+// These are called with sPoolLock held.  A pooled input is linked while
+// its descriptor is open.
+
+void InputFile::poolLink()
+{
+	_poolPrev = NULL;
+	_poolNext = sPoolHead;
+	if (sPoolHead)
+		sPoolHead->_poolPrev = this;
+	else
+		sPoolTail = this;
+	sPoolHead = this;
+	++sPoolCount;
+}
+
+void InputFile::poolUnlink()
+{
+	if (_poolPrev)
+		_poolPrev->_poolNext = _poolNext;
+	else
+		sPoolHead = _poolNext;
+	if (_poolNext)
+		_poolNext->_poolPrev = _poolPrev;
+	else
+		sPoolTail = _poolPrev;
+	_poolPrev = _poolNext = NULL;
+	--sPoolCount;
+}
+
+// Close the least recently used descriptors that no note is reading, until
+// we are within the limit.
+
+void InputFile::trimPool()
+{
+	const int limit = poolLimit();
+	InputFile *file = sPoolTail;
+	while (sPoolCount > limit && file != NULL) {
+		InputFile *prev = file->_poolPrev;
+		if (file->_refcount <= 0) {
+#ifdef FILE_DEBUG
+			rtcmix_debug(NULL, "\tInputFile::trimPool: closing fd %d", file->_fd);
+#endif
+			file->poolUnlink();
+			sndlib_close(file->_fd, 0, 0, 0, 0);
+			file->_fd = NO_FD;
+		}
+		file = prev;
+	}
+}
+
+void InputFile::reopen()
+{
+	int fd = ::open(_filename, O_RDONLY);
+	if (fd < 0) {
+		rtcmix_warn("InputFile", "Can't reopen '%s': %s", _filename, strerror(errno));
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_dev != _device || st.st_ino != _inode) {
+		rtcmix_warn("InputFile", "'%s' has been replaced since it was opened", _filename);
+		::close(fd);
+		return;
+	}
+	mus_file_set_descriptors(fd, _filename, _data_format,
+							 ::mus_data_format_to_bytes_per_sample(_data_format),
+							 _data_location, _chans, _header_type);
+	_fd = fd;
+	poolLink();
+}
+
+int InputFile::getFD()
+{
+	if (!_pooled)
+		return _fd;
+	pthread_mutex_lock(&sPoolLock);
+	if (_fd == NO_FD) {
+		reopen();
+		trimPool();
+	}
+	else if (sPoolHead != this) {
+		poolUnlink();
+		poolLink();
+	}
+	const int fd = _fd;
+	pthread_mutex_unlock(&sPoolLock);
+	return fd;
+}
+
 #ifdef MULTI_THREAD
 
-char *		InputFile::sConversionBuffers[RT_THREAD_COUNT];
+std::vector<char *>	InputFile::sConversionBuffers;
 
-void InputFile::createConversionBuffers(int inBufSamps)
+void InputFile::createConversionBuffers(int inThreadCount, int inBufSamps)
 {
+	destroyConversionBuffers();
 	/* Allocate buffers needed to convert input audio files as they are read */
-	for (int i = 0; i < RT_THREAD_COUNT; ++i) {
-		sConversionBuffers[i] = new char[sizeof(BUFTYPE) * MAXCHANS * inBufSamps];
+	for (int i = 0; i < inThreadCount; ++i) {
+		sConversionBuffers.push_back(new char[sizeof(BUFTYPE) * MAXCHANS * inBufSamps]);
 	}
 }
 
 void InputFile::destroyConversionBuffers()
 {
-	for (int i = 0; i < RT_THREAD_COUNT; ++i) {
+	for (int i = 0; i < (int) sConversionBuffers.size(); ++i) {
         delete [] sConversionBuffers[i];
-		sConversionBuffers[i] = NULL;
 	}
+	sConversionBuffers.clear();
 }
 
 #endif
 
-InputFile::InputFile() : _filename(NULL), _fd(NO_FD), _readBuffer(NULL), _memBuffer(NULL), _refcount(0), _gainScale(1.0f)
+InputFile::InputFile() : _filename(NULL), _fd(NO_FD), _readBuffer(NULL), _memBuffer(NULL), _cacheBlock(NULL), _mapping(NULL), _mappingLength(0), _refcount(0), _pooled(false), _poolPrev(NULL), _poolNext(NULL), _gainScale(1.0f)
 {
 }
 
@@ -439,7 +625,7 @@ InputFile::~InputFile()
 
 int InputFile::init(int inFd, const char *inFileName, Type inType, int inHeaderType,
           int inDataFormat, int inDataLocation, long inFrames, float inSampleRate,
-          int inChannels, double inDuration)
+          int inChannels, double inDuration, bool inMapFile)
 {
     _filename = strdup(inFileName);
     _fd = inFd;
@@ -487,6 +673,32 @@ int InputFile::init(int inFd, const char *inFileName, Type inType, int inHeaderT
 	}
 	else
 		_endbyte = _data_location + (inFrames * bytes_per_samp * _chans);
+
+	if (inMapFile && _fileType == FileType) {
+		// Don't map past the real end of the file, in case the header
+		// claims more sound than there is.
+		struct stat st;
+		_mappingLength = (fstat(_fd, &st) == 0) ? lmin(_endbyte, st.st_size) : 0;
+		void *mapping = (_mappingLength > 0)
+				? mmap(NULL, _mappingLength, PROT_READ, MAP_SHARED, _fd, 0) : MAP_FAILED;
+		if (mapping == MAP_FAILED) {
+			rtcmix_warn("InputFile", "File '%s' cannot be mapped into memory -- reading it instead", _filename);
+			_mappingLength = 0;
+		}
+		else
+			_mapping = (char *) mapping;
+	}
+
+	struct stat st;
+	if (_fileType != AudioDeviceType && _fd > 0 && fstat(_fd, &st) == 0) {
+		_device = st.st_dev;
+		_inode = st.st_ino;
+		pthread_mutex_lock(&sPoolLock);
+		_pooled = true;
+		poolLink();
+		trimPool();
+		pthread_mutex_unlock(&sPoolLock);
+	}
     return 0;
 }
 
@@ -543,21 +755,23 @@ int InputFile::reinit(BufPtr inBuffer, long inFrames, int inChannels)
 
 void InputFile::reference()
 {
-	if (++_refcount == 1) {
+	if (RC_INCREMENT(_refcount) == 1) {
 		// In here we can do any post-initialization that only needs to be done (once) when we are
 		// sure that this InputFile is being used by an instrument.
+		// Now that a note holds us, our descriptor stays open until it's done.
+		getFD();
 	}
 #ifdef FILE_DEBUG
 	rtcmix_debug("InputFile", "InputFile::reference: refcount = %d\n", _refcount);
 #endif
 }
 
-void InputFile::unreference()
+void InputFile::unreference(bool inKeep)
 {
 #ifdef FILE_DEBUG
 	rtcmix_debug("InputFile", "InputFile::unreference: refcount = %d\n", _refcount);
 #endif
-	if (--_refcount <= 0) {
+	if (RC_DECREMENT(_refcount) <= 0 && !inKeep) {
 		close();
 	}
 }
@@ -565,13 +779,26 @@ void InputFile::unreference()
 void InputFile::close()
 {
 	if (_fd != USE_MM_BUF) {	// MM buffers are not owned by us
+		if (_mapping) {
+			munmap(_mapping, _mappingLength);
+			_mapping = NULL;
+			_mappingLength = 0;
+		}
 		if (_memBuffer) {
 #ifdef FILE_DEBUG
-			rtcmix_debug(NULL, "\tInputFile::close: freeing _memBuffer");
+			rtcmix_debug(NULL, "\tInputFile::close: releasing _memBuffer");
 #endif
-			free(_memBuffer);
+			SampleCache::release(_cacheBlock);
+			_cacheBlock = NULL;
 			_memBuffer = NULL;
 		}
+		if (_pooled) {
+			pthread_mutex_lock(&sPoolLock);
+			if (_fd > 0)
+				poolUnlink();
+			_pooled = false;
+			pthread_mutex_unlock(&sPoolLock);
+		}
 		if (_fd > 0) {
 #ifdef FILE_DEBUG
 			rtcmix_debug(NULL, "\tInputFile::close: closing fd %d", _fd);
@@ -603,7 +830,8 @@ off_t InputFile::readSamps(off_t cur_offset,
                          int dest_chans,
                          int dest_frames,
                          const short src_chan_list[],
-                         short src_chans)
+                         short src_chans,
+                         InputStream *stream)
 {
 #ifndef IGNORE_BUS_COUNT_FOR_FILE_INPUT
     assert(dest_chans >= src_chans);
@@ -613,25 +841,34 @@ off_t InputFile::readSamps(off_t cur_offset,
 		(void)copySamps(cur_offset, dest, dest_chans, dest_frames, src_chan_list, src_chans);
 	}
 	else {
+		// The read functions use pread(), so there is no shared file position
+		// to protect, and any number of instruments can read this file at once.
+		// If the file is mapped, and the request doesn't run off its end, they
+		// convert straight from the mapping instead.  Likewise if a prefetch
+		// stream has already read the bytes for us.
+		const long bytes_requested = (long) dest_frames * _chans
+						* ::mus_data_format_to_bytes_per_sample(_data_format);
+		int fd = _fd;
 #ifdef MULTI_THREAD
-		_readBuffer = sConversionBuffers[RTThread::GetIndexForThread()];
+		void *readBuffer = sConversionBuffers[RTThread::GetIndexForThread()];
+#else
+		void *readBuffer = _readBuffer;
 #endif
-		{
-			AutoLock fileLock(this);
-			if (lseek(_fd, cur_offset, SEEK_SET) == -1) {
-				perror("RTcmix::readFromInputFile (lseek)");
-                return FILE_ERROR;
-			}
-			
-			int status = (*this->_readFunction)(_fd,
-										 _data_format,
-										 _chans,
-										 cur_offset,
-										 _endbyte,
-										 dest, dest_chans, dest_frames,
-										 src_chan_list, src_chans,
-										 _readBuffer);
+		if (_mapping != NULL && cur_offset >= _data_location
+				&& cur_offset + bytes_requested <= (off_t) _mappingLength) {
+			fd = MAPPED_FD;
+			readBuffer = _mapping + cur_offset;
 		}
+		else if (stream != NULL && stream->take(cur_offset, bytes_requested, readBuffer))
+			fd = MAPPED_FD;
+		int status = (*this->_readFunction)(fd,
+									 _data_format,
+									 _chans,
+									 cur_offset,
+									 _endbyte,
+									 dest, dest_chans, dest_frames,
+									 src_chan_list, src_chans,
+									 readBuffer);
 	}
     int bytes_per_samp = ::mus_data_format_to_bytes_per_sample(_data_format);
     return dest_frames * _chans * bytes_per_samp;
@@ -642,15 +879,18 @@ int InputFile::loadSamps(long inFrames)
 #ifdef FILE_DEBUG
 	rtcmix_debug(NULL, "\tInputFile::loadSamps: allocating _memBuffer for %lu bytes", (size_t)inFrames * _chans * sizeof(BUFTYPE));
 #endif
-	_memBuffer = (BufPtr) calloc((size_t) inFrames * _chans, sizeof(BUFTYPE));
+	// Another rtinput may have loaded this file already.
+	_cacheBlock = SampleCache::find(_filename, 0, inFrames, SAMPLE_CACHE_ALL_CHANS);
+	if (_cacheBlock != NULL) {
+		_memBuffer = _cacheBlock->samples();
+		return 0;
+	}
+	const long sampleCount = inFrames * _chans;
+	_memBuffer = new (std::nothrow) BUFTYPE[sampleCount];
 	if (_memBuffer == NULL) {
 		perror("malloc");
 		return -1;
 	}
-	if (lseek(_fd, _data_location, SEEK_SET) == -1) {
-		perror("RTcmix::readFromInputFile (lseek)");
-        return FILE_ERROR;
-	}
 	const short src_chan_list[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
 	long framesRead = 0;
 	long bytesRead = 0;
@@ -667,7 +907,7 @@ int InputFile::loadSamps(long inFrames)
 										_data_format,
 										_chans,
 										_data_location + bytesRead,
-										_endbyte,
+										_data_location + _endbyte,
 										&_memBuffer[framesRead*_chans], _chans, (int)frameCount,
 										src_chan_list, _chans,
 										sScratchBuffer);
@@ -676,7 +916,14 @@ int InputFile::loadSamps(long inFrames)
 		framesRead += frameCount;
 		bytesRead += byteCount;
 	}
-	return status;
+	if (status != 0) {
+		delete [] _memBuffer;
+		_memBuffer = NULL;
+		return status;
+	}
+	_cacheBlock = SampleCache::insert(_filename, 0, inFrames, SAMPLE_CACHE_ALL_CHANS,
+									  _memBuffer, sampleCount);
+	return 0;
 }
 
 off_t InputFile::copySamps(off_t     cur_offset,       /* current file position - used to offset into cached waveform */
@@ -10,31 +10,52 @@
 #include "Lockable.h"
 #include "rt_types.h"
 #include "rtdefs.h"
+#include "SampleCache.h"
 #include <sys/types.h>
 #include <string.h>
+#ifdef MULTI_THREAD
+#include <vector>
+#endif
+
+class InputStream;
 
 typedef int (*ReadFun)(int,int,int,off_t,long,BufPtr,int,int,const short[],short,void*);
 
-/* definition of input file struct used by rtinput */
+/* definition of input file struct used by rtinput
+
+   A FileType input can be mapped into memory (rtinput's "mmap" mode, or the
+   mmap_input option), in which case readSamps converts samples straight out
+   of the mapping rather than reading them into a scratch buffer first.  The
+   pages are shared with any other process mapping or reading the same file.
+
+   The descriptors of FileType and InMemoryType inputs are pooled: when more
+   than RTOption::maxOpenInputs() are open, those of the least recently used
+   inputs that no note is reading are closed, and getFD() or reference()
+   opens them again.  So a score can name many more sound files than the
+   process can hold open at once.
+*/
 struct InputFile : public Lockable {
 public:
 	enum Type { FileType = 0, AudioDeviceType = 1, InMemoryType = 2 };
 #ifdef MULTI_THREAD
-	static void createConversionBuffers(int inBufSamps);
+	static void createConversionBuffers(int inThreadCount, int inBufSamps);
 	static void destroyConversionBuffers();
 #endif
 	InputFile();
 	~InputFile();
     int init(int inFd, const char *inFileName, Type inType, int inHeaderType,
               int inDataFormat, int inDataLocation, long nFrames, float inSampleRate,
-              int inChannels, double inDuration);
+              int inChannels, double inDuration, bool inMapFile=false);
 	int init(BufPtr inBuffer, const char *inBufferName, long nFrames, float inSampleRate, int inChannels, float inScaling);
 	int reinit(BufPtr inBuffer, long nFrames, int inChannels);
 
     void reference();
-    void unreference();
+    // If <inKeep>, the input stays in the table after its last reference
+    // (for interactive mode), though its descriptor may then be closed.
+    void unreference(bool inKeep=false);
 	
-	int	getFD() const { return _fd; }
+	// Opens the file again if its descriptor was closed.
+	int	getFD();
 	const char *fileName() const { return _filename; }
 	bool hasFile(const char *inPath) const { return strcmp(inPath, _filename) == 0; }
 	float sampleRate() const { return _srate; }
@@ -42,6 +63,7 @@ public:
 	bool isAudioDevice() const { return _fileType == AudioDeviceType; }
 	short dataFormat() const { return _data_format; }
 	int dataLocation() const { return _data_location; }
+	long endByte() const { return _endbyte; }
 	double duration() const { return _dur; }
 	
     off_t readSamps(off_t     cur_offset,       /* current file position before read */
@@ -50,9 +72,11 @@ public:
                   int         dest_frames,      /* frames in interleaved buffer */
                   const short src_chan_list[],  /* list of in-bus chan numbers from inst */
                   /* (or NULL to fill all chans) */
-                  short       src_chans         /* number of in-bus chans to copy */
+                  short       src_chans,        /* number of in-bus chans to copy */
+                  InputStream *stream=NULL      /* reader's prefetch stream, if any */
     );
-	bool isOpen() const { return _fd > 0 || _fd == USE_MM_BUF; }
+	bool isOpen() const { return _filename != NULL; }
+	bool isMapped() const { return _mapping != NULL; }
 	int modTime() const { return _modTime; }
 	void setModTime(int inModTime) { _modTime = inModTime; }
 
@@ -70,6 +94,11 @@ protected:
 	void close();
 
 private:
+	void reopen();
+	void poolLink();
+	void poolUnlink();
+	static void trimPool();
+
 	char     *_filename;         /* allocated by rtinput() */
 	int      _fd;                /* file descriptor, or NO_FD, or AUDIO_DEVICE */
 	Type     _fileType;         /* FileType, AudioDeviceType, InMemoryType */
@@ -83,14 +112,25 @@ private:
 	double   _dur;
     void *	 _readBuffer;
     BufPtr 	 _memBuffer;
+	SampleCache::Block *_cacheBlock;	/* holds _memBuffer for InMemoryType files */
+	char *	 _mapping;			/* whole file, if mapped */
+	size_t	 _mappingLength;
 	int      _refcount;
     ReadFun  _readFunction;
+	bool	 _pooled;			/* _fd is in the descriptor pool */
+	dev_t	 _device;			/* to know the file when reopening it */
+	ino_t	 _inode;
+	InputFile *_poolPrev;		/* pool list, most recently used first */
+	InputFile *_poolNext;
 	int		 _modTime;			/* used for live buffer mode */
 	float	 _gainScale;		/* same */
 	static const int	sScratchBufferSize = 4096;
 	static char			sScratchBuffer[];
+	static InputFile *	sPoolHead;
+	static InputFile *	sPoolTail;
+	static int			sPoolCount;
 #ifdef MULTI_THREAD
-	static char *		sConversionBuffers[];
+	static std::vector<char *>	sConversionBuffers;	// one per TaskManager thread
 #endif
 };
 
@@ -0,0 +1,187 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// InputStream.cpp -- background read-ahead for file input.  See InputStream.h.
+
+#include "InputStream.h"
+#include "InputFile.h"
+#include "RTcmix.h"
+#include <RTOption.h>
+#include <sndlib.h>
+#include <ugens.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PREFETCH_MAX_READ	65536	// bytes per pread
+#define PREFETCH_IDLE_USEC	1000	// sleep when no stream needs reading
+
+std::vector<InputStream *>	InputStream::sStreams;
+Lockable					InputStream::sListLock;
+pthread_t					InputStream::sThread;
+bool						InputStream::sRunning = false;
+volatile bool				InputStream::sStopping = false;
+
+static inline long lmin(long a, long b) { return a < b ? a : b; }
+
+InputStream::InputStream(int fd, off_t startOffset, off_t endOffset, long ringBytes)
+	: mFD(fd), mRing(new char[ringBytes]), mRingBytes(ringBytes), mEnd(endOffset),
+	  mStart(startOffset), mHead(0), mCount(0), mPending(0), mGeneration(0),
+	  mReleased(false)
+{
+}
+
+InputStream::~InputStream()
+{
+	::close(mFD);
+	delete [] mRing;
+}
+
+InputStream *InputStream::create(InputFile *file, off_t startOffset)
+{
+	const int frames = RTOption::prefetchFrames();
+	if (frames <= 0 || file->isAudioDevice() || file->isMapped() || file->getFD() <= 0)
+		return NULL;
+	// The stream has a descriptor of its own, so that the thread can still
+	// read from it if the InputFile closes while the stream is being reaped.
+	const int fd = dup(file->getFD());
+	if (fd < 0) {
+		rtcmix_warn("InputStream", "Cannot prefetch '%s': %s", file->fileName(), strerror(errno));
+		return NULL;
+	}
+	const long bytesPerFrame = (long) file->channels()
+					* ::mus_data_format_to_bytes_per_sample(file->dataFormat());
+	const long ringFrames = (frames > RTcmix::bufsamps() * 4) ? frames : RTcmix::bufsamps() * 4;
+	InputStream *stream = new InputStream(fd, startOffset, file->endByte(),
+										  ringFrames * bytesPerFrame);
+	sListLock.lock();
+	sStreams.push_back(stream);
+	if (!sRunning) {
+		sStopping = false;
+		if (pthread_create(&sThread, NULL, &InputStream::sRun, NULL) == 0)
+			sRunning = true;
+		else
+			rtcmix_warn("InputStream", "Failed to start the prefetch thread");
+	}
+	sListLock.unlock();
+	return stream;
+}
+
+// Called with our lock held.
+
+void InputStream::discard(long bytes)
+{
+	mStart += bytes;
+	mHead = (mHead + bytes) % mRingBytes;
+	mCount -= bytes;
+}
+
+bool InputStream::take(off_t offset, long bytes, void *dest)
+{
+	if (!tryLock())
+		return false;
+	bool found = false;
+	const off_t ready = mStart + mCount;
+	if (offset >= mStart && offset + bytes <= ready) {
+		discard(offset - mStart);
+		const long first = lmin(bytes, mRingBytes - mHead);
+		memcpy(dest, &mRing[mHead], first);
+		memcpy((char *) dest + first, mRing, bytes - first);
+		discard(bytes);
+		found = true;
+	}
+	else if (offset >= mStart && offset + bytes <= ready + mPending) {
+		// We are catching up with a read in progress; keep it.
+		discard(lmin(offset - mStart, mCount));
+	}
+	else {
+		// A jump, or too far behind: start over after this request.
+		mStart = offset + bytes;
+		mHead = 0;
+		mCount = 0;
+		++mGeneration;
+	}
+	unlock();
+	return found;
+}
+
+void InputStream::release()
+{
+	__sync_synchronize();
+	mReleased = true;
+}
+
+// Top up the ring with one read.  Returns true if there was anything to do.
+// Only the prefetch thread calls this.
+
+bool InputStream::fill()
+{
+	lock();
+	const unsigned generation = mGeneration;
+	const off_t fileOffset = mStart + mCount;
+	const long space = mRingBytes - mCount;
+	const long tail = (mHead + mCount) % mRingBytes;
+	const long bytes = lmin(lmin(space, mRingBytes - tail),
+							lmin((long) (mEnd - fileOffset), PREFETCH_MAX_READ));
+	// Wait for a worthwhile amount of space, unless we are near the end.
+	if (bytes <= 0 || (space < mRingBytes / 4 && space < mEnd - fileOffset)) {
+		unlock();
+		return false;
+	}
+	mPending = bytes;
+	unlock();
+
+	ssize_t got = pread(mFD, &mRing[tail], bytes, fileOffset);
+
+	lock();
+	mPending = 0;
+	if (generation == mGeneration) {
+		if (got > 0)
+			mCount += got;
+		else if (got == 0 || errno != EINTR)
+			mEnd = fileOffset;		// EOF or error: stop reading this file
+	}
+	unlock();
+	return true;
+}
+
+void *InputStream::sRun(void *)
+{
+	while (!sStopping) {
+		bool busy = false;
+		sListLock.lock();
+		for (size_t n = 0; n < sStreams.size(); ) {
+			InputStream *stream = sStreams[n];
+			if (stream->mReleased) {
+				delete stream;
+				sStreams[n] = sStreams.back();
+				sStreams.pop_back();
+				continue;
+			}
+			if (stream->fill())
+				busy = true;
+			++n;
+		}
+		sListLock.unlock();
+		if (!busy)
+			usleep(PREFETCH_IDLE_USEC);
+	}
+	return NULL;
+}
+
+void InputStream::stopPrefetching()
+{
+	sListLock.lock();
+	const bool running = sRunning;
+	sStopping = true;
+	sRunning = false;
+	sListLock.unlock();
+	if (running)
+		pthread_join(sThread, NULL);
+	sListLock.lock();
+	for (size_t n = 0; n < sStreams.size(); ++n)
+		delete sStreams[n];
+	sStreams.clear();
+	sListLock.unlock();
+}
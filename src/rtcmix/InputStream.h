@@ -0,0 +1,68 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _INPUTSTREAM_H_
+#define _INPUTSTREAM_H_ 1
+
+#include <Lockable.h>
+#include <sys/types.h>
+#include <vector>
+
+class InputFile;
+
+// Read-ahead for one instrument reading a sound file.  Without this, file
+// input is read from disk inside rtgetin(), on the audio thread, so a cold
+// page or a slow network mount means a dropout.
+//
+// When the prefetch_frames option is set, each instrument reading from a
+// file gets a stream, which a single background thread keeps filled with
+// the raw (unconverted) bytes following the instrument's file offset.  The
+// audio thread only copies from the stream's ring buffer, and does so with
+// tryLock(), so it never waits on the prefetch thread.  If the bytes are not
+// there -- at the start of a note, after rtinrepos(), or if the disk cannot
+// keep up -- take() returns false and the caller reads the file itself.
+
+class InputStream : public Lockable {
+public:
+	// Returns NULL if prefetching is disabled or not possible for this file.
+	static InputStream *	create(InputFile *file, off_t startOffset);
+
+	// Copy <bytes> bytes of the file, starting at <offset>, into <dest> if
+	// they have been read already.  Called by the instrument's thread.
+	bool		take(off_t offset, long bytes, void *dest);
+
+	// Called instead of delete when the instrument is done.  The prefetch
+	// thread deletes the stream, so this does not block.
+	void		release();
+
+	// Stop the prefetch thread and delete all streams.  Called at shutdown.
+	static void	stopPrefetching();
+
+private:
+	InputStream(int fd, off_t startOffset, off_t endOffset, long ringBytes);
+	~InputStream();
+	bool		fill();
+	void		discard(long bytes);
+	static void *	sRun(void *);
+
+	int				mFD;			// our own dup of the file's descriptor
+	char *			mRing;
+	long			mRingBytes;
+	off_t			mEnd;			// first byte past the sound data
+	// These are protected by our lock.
+	off_t			mStart;			// file offset of the byte at mHead
+	long			mHead;
+	long			mCount;			// bytes ready to take
+	long			mPending;		// bytes the thread is reading now
+	unsigned		mGeneration;	// bumped when the reader jumps elsewhere
+	volatile bool	mReleased;
+
+	static std::vector<InputStream *>	sStreams;
+	static Lockable						sListLock;
+	static pthread_t					sThread;
+	static bool							sRunning;
+	static volatile bool				sStopping;
+};
+
+#endif	// _INPUTSTREAM_H_
@@ -6,7 +6,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <pthread.h>
+#include <sched.h>
 #include "Instrument.h"
 #include <RTcmix.h>
 #include "rt.h"
@@ -18,35 +20,130 @@
 #include <assert.h>
 #include <ugens.h>
 #include "heap/heap.h"
+#include "BufferPool.h"
+#include "InputStream.h"
 #include <PField.h>
 #include <PFieldSet.h>
 #include <maxdispargs.h>
 #include <PFBusData.h>
+#include <RTOption.h>
+#include "ControlTable.h"
+#include "WorkerPool.h"
+#include "RTThread.h"
+#ifdef MULTI_THREAD
+#include "TaskManager.h"
+#endif
+#include "DSPStats.h"
+#include "MemStats.h"
+#include "AllocTracker.h"
+#include "NoteCache.h"
+#include "Polyphony.h"
+#include <new>
 
 #undef DEBUG_INST
 
+// Time every run(), for Instrument::runCost()
+#ifdef MULTI_THREAD
+static const bool kTimeRuns = true;
+#else
+static const bool kTimeRuns = false;
+#endif
+
 using namespace std;
 
 InputState::InputState()
-: fdIndex(NO_DEVICE_FDINDEX), fileOffset(0), inputsr(0.0), inputchans(0), inputNsamps(0)
+: fdIndex(NO_DEVICE_FDINDEX), sourceIndex(-1), fileOffset(0), inputsr(0.0), inputchans(0),
+  inputNsamps(0), stream(NULL)
 {
 }
 
-int				Instrument::RTBUFSAMPS = 0;
-int				Instrument::NCHANS = 0;
-float			Instrument::SR     = 0;
+
+/* ---------------------------------------------------------- ControlRamp --- */
+ControlRamp::ControlRamp()
+	: _value(0.0), _incr(0.0), _ramping(RTOption::smoothControls()), _started(false)
+{
+}
+
+/* ---------------------------------------------------------- pfieldValue --- */
+
+// The value of pfield <index> at <percent> through its span.  Instruments
+// often read the same pfield more than once for the same frame -- update()
+// in a loop over channels or voices, or update(int) for several uses of one
+// value -- so each pfield keeps the last value read from it and where.  A
+// pfield that is PField::deterministic() is evaluated at most once per frame
+// (and span) within a run().  Others, such as random sources, are read every
+// time, so each read still gets a new value.  A new run() starts a new
+// snapshot, since frame 0 is read first by init() and again, some time
+// later, by the first run().
+//
+// How often a pfield is read at all depends on its PField::variation(): a
+// constant is read once for the note, and one set only from outside (an
+// inlet) again only when its changes() count moves.  Each keeps the update()
+// call in which its value last changed, for pfieldChanged().
+
+struct Instrument::PFieldValue {
+	double		percent;
+	double		value;
+	unsigned	chunk;
+	int			variation;		// PField::Variation
+	bool		deterministic;	// PField::deterministic()
+	unsigned	changes;		// PField::changes() when last read
+	unsigned	changedAt;		// _updates when value last changed
+};
+
+inline double Instrument::pfieldValue(int index, double percent)
+{
+	PFieldValue &cached = _snapshot[index];
+	switch (cached.variation) {
+	case PField::kConstant:
+		if (cached.percent >= 0.0)
+			return cached.value;
+		break;
+	case PField::kExternal:
+		if (cached.percent >= 0.0) {
+			const unsigned changes = (*_pfields)[index].changes();
+			if (changes == cached.changes)
+				return cached.value;
+			cached.changes = changes;
+		}
+		break;
+	default:
+		if (cached.deterministic && cached.percent == percent
+				&& cached.chunk == _snapshotChunk)
+			return cached.value;
+		break;
+	}
+	const double value = (*_pfields)[index].doubleValue(percent);
+	if (value != cached.value || cached.percent < 0.0) {
+		cached.value = value;
+		cached.changedAt = _updates;
+		_changedAt = _updates;
+	}
+	cached.percent = percent;
+	cached.chunk = _snapshotChunk;
+	return value;
+}
 
 /* ----------------------------------------------------------- Instrument --- */
 Instrument::Instrument() : RefCounted(true),
-	  _start(0.0), _dur(0.0), cursamp(0), chunksamps(0), i_chunkstart(0),
-	  endsamp(0), output_offset(0), outputchans(0), _name(NULL),
-	  needs_to_run(true), _nsamps(0), inputChainBuf(NULL)
+	  cursamp(0), chunksamps(0), output_offset(0), needs_to_run(true),
+	  _alignedBlocks(-1), i_chunkstart(0), endsamp(0), _runCost(0.0f),
+	  _lastWorker(-1), _statsSlot(0), _nsamps(0),
+	  _start(0.0), _dur(0.0), outputchans(0), _name(NULL),
+	  _startFrame(0), _snapshot(NULL),
+	  _snapshotChunk(0), _updates(0), _changedAt(0), _sleepInputFrames(-1), _silentFrames(0),
+	  _sleepMinFrames(0), _tailFrames(-1), _asleep(false), _sleptChunk(false),
+	  _notifyNoiseFloor(false), _atNoiseFloor(false), _memBytes(0),
+	  _mixOrder(0),
+	  _planarOutput(false), _planeFrames(0), _voiceLimit(-1), _trackLevel(false),
+	  _level(0.0f), _releaseEnd(0), _releaseFrames(0), inputChainBuf(NULL),
+	  _allowNoteCache(false), _noteCapture(NULL), _frozenBy(NULL),
+	  _configState(kUnconfigured)
 {
 #if defined(DEBUG_MEMORY) || defined(DEBUG_INST)
 	rtcmix_print("Instrument::Instrument(this = %p)\n", this);
 #endif
-   // Here we initialize the Instrument class globals (over and over, I know)
-   // which replace the old system globals
+   // Each note takes the output format in effect when it is made.
    
    NCHANS = RTcmix::chans();
    SR = RTcmix::sr();
@@ -58,11 +155,14 @@ Instrument::Instrument() : RefCounted(true),
    _busSlot = NULL;
    _pfields = NULL;
 
-   for (int i = 0; i < RTcmix::getBusCount(); i++)
-	   bufferWritten[i] = false;
+   memset(_written, 0, sizeof(_written));
+   _writtenCount = 0;
 
 	my_pfbus = PFBusData::connect_val;
 	PFBusData::connect_val = -1;
+	// Like bus_link, the input this note reads is the one open when it was
+	// made, whenever and wherever its init() runs.
+	_input.sourceIndex = RTcmix::get_last_input_index();
 }
 
 
@@ -75,12 +175,20 @@ Instrument::~Instrument()
 	if (sfile_on)
 		gone();                   // decrement input soundfile reference
 
-	delete [] outbuf;
+	if (_noteCapture != NULL)
+		NoteCache::endCapture(_noteCapture);
+
+	freeBuffer(outbuf);
+
+	if (_voiceLimit >= 0 && _releaseFrames == 0)
+		Polyphony::voiceEnded(_voiceLimit);
 
 	RefCounted::unref(_busSlot);	// release our reference	
 
 	delete _pfields;
+	delete [] _snapshot;
 	delete [] _name;
+	chargeMemory(-_memBytes);
 }
 
 /* ------------------------------------------------------- setName --- */
@@ -91,6 +199,11 @@ void Instrument::setName(const char *name)
 {
 	_name = new char[strlen(name) + 1];
 	strcpy(_name, name);
+	if (kTimeRuns || DSPStats::enabled() || AllocTracker::active()
+		|| MemStats::enabled())
+		_statsSlot = DSPStats::classSlot(_name);
+	// Charged now that we know our class
+	chargeMemory(BufferPool::blockBytes(this));
 #ifdef DEBUG_MEMORY
 	rtcmix_print("Instrument::setName(this = %p [%s])\n", this, _name);
 #endif
@@ -109,15 +222,12 @@ void Instrument::set_bus_config(const char *inst_name)
 {
   setName(inst_name);
 
-  _busSlot = RTcmix::get_bus_config(inst_name);
-  _busSlot->ref();		// add our reference to this
+  _busSlot = RTcmix::get_bus_config(inst_name);	// adopts its reference
   
   _input.inputchans = _busSlot->in_count + _busSlot->auxin_count;
   outputchans = _busSlot->out_count + _busSlot->auxout_count;
 }
 
-double Instrument::s_dArray[MAXDISPARGS];
-
 /* ------------------------------------------------------------ setup () --- */
 
 // This function is now the one called by checkInsts() via loadPFieldsAndSetup().  It calls init().
@@ -125,9 +235,28 @@ double Instrument::s_dArray[MAXDISPARGS];
 int Instrument::setup(PFieldSet *pfields)
 {
 	_pfields = pfields;
-	int nargs = MAXDISPARGS;
-	update(s_dArray, nargs);
-	int samps = init(s_dArray, pfields->size());
+	_snapshot = new PFieldValue[pfields->size()];
+	for (int n = 0; n < pfields->size(); ++n) {
+		_snapshot[n].percent = -1.0;	// matches no read
+		_snapshot[n].value = 0.0;
+		_snapshot[n].variation = (*pfields)[n].variation();
+		_snapshot[n].deterministic = (*pfields)[n].deterministic();
+		_snapshot[n].changes = (*pfields)[n].changes();
+		_snapshot[n].changedAt = 0;
+	}
+	// The initial values are the caller's own, so that notes can be set up
+	// on more than one thread at once.
+	double p[MAXDISPARGS];
+	update(p, MAXDISPARGS);
+	int samps = init(p, pfields->size());
+	// Play after the notes writing any aux bus a pfield reads
+	if (_busSlot != NULL) {
+		for (int n = 0; n < pfields->size(); ++n) {
+			const int bus = (*pfields)[n].auxBus();
+			if (bus >= 0)
+				RTcmix::addBusReader(bus, _busSlot, name());
+		}
+	}
 	_skip = int(SR / (float) resetval);
 	if (_skip < 1)
 		_skip = 1;
@@ -143,23 +272,28 @@ int Instrument::setup(PFieldSet *pfields)
 // 'fields' is a bitmask of fields between [0] and [nvalues - 1] to fill.
 // If fields is zero or missing, all of the first <nvalues> pfields are updated.
 // Note that the bitmask supports only 31 pfields; if an instrument has
-// more than that, don't use the fields argument.
+// more than that, don't use the fields argument -- use updateFields().
+// Constant pfields are read only once, and those set from outside only when
+// they are set, so calling this every control period costs little for them;
+// pfieldsChanged() then tells whether anything needs recomputing.
 
 int Instrument::update(double p[], int nvalues, unsigned fields)
 {
+	++_updates;
 	int n, args = _pfields->size();
 	int frame = currentFrame();
 	double percent = (frame == 0) ? 0.0 : (double) frame / nSamps();
+	ControlTable::renderFrame(_startFrame + frame, percent);	// for timed controls
 	if (nvalues < args)
 		args = nvalues;
 	if (fields == 0) {
 		for (n = 0; n < args; ++n)
-			p[n] = (*_pfields)[n].doubleValue(percent);
+			p[n] = pfieldValue(n, percent);
 	}
 	else {
 		for (n = 0; n < args; ++n) {
 			if (fields & (1 << n))
-				p[n] = (*_pfields)[n].doubleValue(percent);
+				p[n] = pfieldValue(n, percent);
 		}
 	}
 	for (; n < nvalues; ++n)
@@ -167,13 +301,46 @@ int Instrument::update(double p[], int nvalues, unsigned fields)
 
 	// my_pfbus is set using the bus_link() thing, check this bus for de-queing
 	if (my_pfbus != -1) {
-		if (PFBusData::dq_now[my_pfbus] == 1)
+		if (PFBusData::dequeueNow(my_pfbus))
 			setendsamp(0);
 	}
 
 	return 0;
 }
 
+// As update(), but for any number of pfields: pfield <n> is filled if bit
+// (n % 32) of fields[n / 32] is set.  <fields> must have a word for every 32
+// of the first <nvalues> pfields.  Fields not asked for are left alone.
+
+int Instrument::updateFields(double p[], int nvalues, const unsigned *fields)
+{
+	++_updates;
+	int args = _pfields->size();
+	int frame = currentFrame();
+	double percent = (frame == 0) ? 0.0 : (double) frame / nSamps();
+	ControlTable::renderFrame(_startFrame + frame, percent);
+	if (nvalues < args)
+		args = nvalues;
+	for (int n = 0; n < args; ++n) {
+		if (fields[n >> 5] & (1U << (n & 31)))
+			p[n] = pfieldValue(n, percent);
+	}
+
+	if (my_pfbus != -1) {
+		if (PFBusData::dequeueNow(my_pfbus))
+			setendsamp(0);
+	}
+
+	return 0;
+}
+
+bool Instrument::pfieldChanged(int index) const
+{
+	if (index < 0 || index >= _pfields->size())
+		return false;
+	return _snapshot[index].changedAt == _updates;
+}
+
 // This alternative update method serves one main purpose: sometimes a pfield
 // needs to span a duration that's different from the total note duration (for
 // example, an envelope that controls only the input duration for an instrument
@@ -194,17 +361,45 @@ double Instrument::update(int index, int totframes, int curFrame)
 		return 0.0;		// handle updates of optional pfields
 	}
 	const int nframes = (totframes == 0) ? nSamps() : totframes;
-	double percent = (curFrame > -1 ? curFrame : currentFrame()) / (double)nframes;
+	const int frame = (curFrame > -1) ? curFrame : currentFrame();
+	double percent = frame / (double)nframes;
+	ControlTable::renderFrame(_startFrame + frame, percent);
 	if (percent > 1.0)
 		percent = 1.0;
 
 	// my_pfbus is set using the bus_link() thing, check this bus for de-queing
 	if (my_pfbus != -1) {
-		if (PFBusData::dq_now[my_pfbus] == 1)
+		if (PFBusData::dequeueNow(my_pfbus))
+			setendsamp(0);
+	}
+
+	return pfieldValue(index, percent);
+}
+
+// Block version of update(int, ...): fill <values> with pfield <index> for
+// each of the <nframes> frames starting at the current frame (or <curFrame>),
+// so that a block-based instrument gets a value per sample for about the cost
+// of one update() call.  <totframes> works as it does for update().
+
+void Instrument::updateBlock(int index, double *values, int nframes,
+							 int totframes, int curFrame)
+{
+	if (index >= _pfields->size()) {
+		for (int n = 0; n < nframes; ++n)
+			values[n] = 0.0;
+		return;
+	}
+	const double spanframes = (totframes == 0) ? nSamps() : totframes;
+	const int frame = (curFrame > -1) ? curFrame : currentFrame();
+	const double percent = frame / spanframes;
+	ControlTable::renderFrame(_startFrame + frame, percent);
+
+	if (my_pfbus != -1) {
+		if (PFBusData::dequeueNow(my_pfbus))
 			setendsamp(0);
 	}
 
-	return (*_pfields)[index].doubleValue(percent);
+	(*_pfields)[index].fillBlock(values, nframes, percent, 1.0 / spanframes);
 }
 
 
@@ -237,12 +432,91 @@ int Instrument::init(double p[], int n_args)
 
 int Instrument::configure(int bufsamps)
 {
+	AllocTracker::NoteScope note(_statsSlot);
 	assert(outbuf == NULL);	// configure called twice, or recursively??
-	outbuf = new BUFTYPE [bufsamps * outputchans];
+	outbuf = allocBuffer(bufsamps * outputchans);
+	if (outbuf == NULL)
+		return die(name(), "No memory left in the budget for the output buffer.");
+	_planeFrames = bufsamps;
 	clearOutput(bufsamps);
 	return configure();		// Class-specific configuration.
 }
 
+/* ------------------------------------------------------ configureOnce --- */
+
+int Instrument::configureOnce(int bufsamps, bool inWait)
+{
+	if (__sync_bool_compare_and_swap(&_configState, kUnconfigured, kConfiguring)) {
+		const int status = configure(bufsamps);
+		__sync_synchronize();
+		_configState = (status == 0) ? kConfigured : kConfigFailed;
+		return status;
+	}
+	if (!inWait)
+		return 1;
+	while (_configState == kConfiguring)
+		sched_yield();		// no longer than configuring it ourselves
+	__sync_synchronize();
+	return (_configState == kConfigured) ? 0 : -1;
+}
+
+/* ---------------------------------------------------------- allocBuffer --- */
+
+BUFTYPE *Instrument::allocBuffer(int samps)
+{
+	BUFTYPE *buffer = BufferPool::allocate(samps);
+	chargeMemory(BufferPool::blockBytes(buffer));
+	return buffer;
+}
+
+/* ----------------------------------------------------------- freeBuffer --- */
+
+void Instrument::freeBuffer(BUFTYPE *buffer)
+{
+	chargeMemory(-(long) BufferPool::blockBytes(buffer));
+	BufferPool::release(buffer);
+}
+
+/* --------------------------------------------------------- chargeMemory --- */
+
+void Instrument::chargeMemory(long bytes)
+{
+	_memBytes += bytes;
+	MemStats::add(MemStats::kInstruments, bytes);
+	MemStats::addInstrument(_statsSlot, bytes);
+}
+
+/* ------------------------------------------------------- operator new --- */
+
+void *Instrument::operator new(size_t size)
+{
+	void *block = BufferPool::allocateBytes(size);
+	if (block == NULL)
+		throw std::bad_alloc();		// the memory budget is used up
+	return block;
+}
+
+/* ---------------------------------------------------- operator delete --- */
+
+void Instrument::operator delete(void *ptr)
+{
+	BufferPool::releaseBytes(ptr);
+}
+
+/* ------------------------------------------------------- runInParallel --- */
+
+// On a TaskManager thread the calls go to the workers that have run out of
+// notes to play; elsewhere, to the frame_threads helpers.
+
+void Instrument::runInParallel(IndexedFunction func, void *context, int count)
+{
+#ifdef MULTI_THREAD
+	if (TaskManager::RunSubTasks(func, context, count))
+		return;
+#endif
+	WorkerPool::run(func, context, count);
+}
+
 /* ----------------------------------------------------- configure(void) --- */
 
 // This is the virtual function that derived classes override.  We supply a
@@ -264,12 +538,46 @@ int Instrument::configure()
 int Instrument::run(bool needsTo)
 {
    if (needsTo) {
+	   if (my_pfbus != -1)
+		   stopAtBusEnd();
 	   obufptr = outbuf;
+	   _startFrame = i_chunkstart - cursamp;
+	   ++_snapshotChunk;
+
+	   memset(_written, 0, ((outputchans + 31) / 32) * sizeof(unsigned int));
+	   _writtenCount = 0;
+
+	   const bool wasAsleep = _sleptChunk;
+	   _sleptChunk = _asleep && sleepThisChunk();
+	   if (_sleptChunk) {
+		   if (!wasAsleep)
+			   clearOutput(RTBUFSAMPS);	// for anyone reading our outbuf
+		   needs_to_run = false;
+		   return framesToRun();
+	   }
+
+	   int status;
+	   if (kTimeRuns || DSPStats::enabled()) {
+		   const long long start = DSPStats::now();
+		   status = run();	// Class-specific run().
+		   const long long nsec = DSPStats::now() - start;
+		   if (DSPStats::enabled())
+			   DSPStats::addInstrument(_statsSlot, nsec);
+		   if (kTimeRuns)
+			   noteRunCost(nsec);
+	   }
+	   else
+		   status = run();	// Class-specific run().
+
+	   if (_voiceLimit >= 0)
+		   voiceChunk();
+
+	   if (_noteCapture != NULL)
+		   NoteCache::capture(_noteCapture, this);
 
-	   for (int i = 0; i < outputchans; i++)
-		   bufferWritten[i] = false;
-	   
-	   int status = run();	// Class-specific run().
+	   if (_notifyNoiseFloor
+		   || (_sleepInputFrames >= 0 && RTOption::silenceSleepMsec() > 0))
+		   checkForSilence();
 
 	   needs_to_run = false;
 
@@ -278,6 +586,202 @@ int Instrument::run(bool needsTo)
    return 0;
 }
 
+/* ------------------------------------------------------- setVoiceLimit --- */
+/* Called by inTraverse for a note of a class with a voice limit, as the
+   note goes onto the rtQueues.
+*/
+void Instrument::setVoiceLimit(int limit, bool trackLevel)
+{
+	_voiceLimit = limit;
+	_trackLevel = trackLevel;
+	_level = 1.0e30f;		// not heard yet, so not the quietest
+}
+
+/* ------------------------------------------------------------- release --- */
+/* Stolen by a note over the limit: fade out and end, no longer counted.
+*/
+void Instrument::release(FRAMETYPE from, int frames)
+{
+	if (_releaseFrames > 0)
+		return;
+	_releaseEnd = from + frames;
+	_releaseFrames = frames;
+	if (getendsamp() > _releaseEnd)
+		setendsamp(_releaseEnd);
+	if (_voiceLimit >= 0)
+		Polyphony::voiceEnded(_voiceLimit);
+}
+
+/* ---------------------------------------------------------- voiceChunk --- */
+/* After each run() of a note with a voice limit: apply the release fade,
+   if any, to the chunk, and keep its peak if the quietest voice is stolen.
+*/
+void Instrument::voiceChunk()
+{
+	const int frames = framesToRun();
+	const int planes = _planarOutput ? outputchans : 1;
+	const int chans = _planarOutput ? 1 : outputchans;
+	if (_releaseFrames > 0) {
+		for (int plane = 0; plane < planes; ++plane) {
+			BUFTYPE *buf = outbuf + plane * _planeFrames;
+			for (int i = 0; i < frames; ++i, buf += chans) {
+				const FRAMETYPE left = _releaseEnd - (i_chunkstart + i);
+				if (left >= _releaseFrames)
+					continue;
+				const BUFTYPE gain = (left > 0) ? (BUFTYPE) left / _releaseFrames : 0.0f;
+				for (int ch = 0; ch < chans; ++ch)
+					buf[ch] *= gain;
+			}
+		}
+	}
+	if (_trackLevel) {
+		BUFTYPE peak = 0.0f;
+		for (int plane = 0; plane < planes; ++plane) {
+			const BUFTYPE *buf = outbuf + plane * _planeFrames;
+			for (int i = 0; i < frames * chans; ++i) {
+				const BUFTYPE mag = fabsf(buf[i]);
+				if (mag > peak)
+					peak = mag;
+			}
+		}
+		_level = peak;
+	}
+}
+
+/* -------------------------------------------------------------- runCost --- */
+/* The MULTI_THREAD scheduler orders a level's notes by what their next run()
+   is likely to cost: the recent time per frame of each note, or, before a
+   note has run, of its class.  It places them by the thread that last ran
+   the note or its class.  Updated without locks, by whichever thread ran the
+   note; these are only hints.
+*/
+
+static float sClassCost[DSPStats::kMaxClasses];		// nsec per frame
+static int sClassWorker[DSPStats::kMaxClasses];		// last thread, + 1
+
+double Instrument::runCost() const
+{
+	return (_runCost > 0.0f) ? _runCost : sClassCost[_statsSlot];
+}
+
+int Instrument::preferredWorker() const
+{
+	return (_lastWorker >= 0) ? _lastWorker : sClassWorker[_statsSlot] - 1;
+}
+
+void Instrument::noteRunCost(long long nsec)
+{
+	const int frames = framesToRun();
+	if (frames <= 0)
+		return;
+	const float frameCost = (float) nsec / frames;
+	_runCost = (_runCost > 0.0f) ? _runCost + (frameCost - _runCost) * 0.25f : frameCost;
+	float &classCost = sClassCost[_statsSlot];
+	classCost = (classCost > 0.0f) ? classCost + (frameCost - classCost) * 0.05f : frameCost;
+#ifdef MULTI_THREAD
+	_lastWorker = RTThread::FindIndexForThread();
+	sClassWorker[_statsSlot] = _lastWorker + 1;
+#endif
+}
+
+/* ------------------------------------------------------ sleepWhenSilent --- */
+
+void Instrument::sleepWhenSilent(int inputFrames, int longestDelay)
+{
+	_sleepInputFrames = (inputFrames > 0) ? inputFrames : 0;
+	_sleepMinFrames = longestDelay;
+	if (_tailFrames < 0) {
+		const int ringFrames = _nsamps - _sleepInputFrames;
+		_tailFrames = (ringFrames > longestDelay) ? ringFrames : longestDelay;
+	}
+}
+
+static BUFTYPE silenceThreshold()
+{
+	return BUFTYPE(32768.0 * pow(10.0, RTOption::silenceThresholdDb() / 20.0));
+}
+
+/* ------------------------------------------------------ checkForSilence --- */
+/* Called after each run() of a note that allows sleeping.  Once its output
+   has stayed silent for silence_sleep_msec, a note past its input ends here,
+   and one taking input from a bus sleeps until something arrives there.
+   Notes reading a file or a chained instrument never sleep, since their
+   input cannot be checked without reading it.  Also called for a note that
+   wants to know when its output reaches the noise floor.
+*/
+
+void Instrument::checkForSilence()
+{
+	const BUFTYPE threshold = silenceThreshold();
+	const int planes = _planarOutput ? outputchans : 1;
+	const int samps = _planarOutput ? framesToRun() : framesToRun() * outputchans;
+	for (int plane = 0; plane < planes; ++plane) {
+		const BUFTYPE *buf = outbuf + plane * _planeFrames;
+		for (int i = 0; i < samps; ++i) {
+			if (buf[i] > threshold || buf[i] < -threshold) {
+				_silentFrames = 0;
+				_atNoiseFloor = false;
+				return;
+			}
+		}
+	}
+	if (_notifyNoiseFloor && !_atNoiseFloor) {
+		_atNoiseFloor = true;
+		noiseFloorReached();
+	}
+	if (_sleepInputFrames < 0 || RTOption::silenceSleepMsec() <= 0)
+		return;
+	_silentFrames += framesToRun();
+	if (_silentFrames < RTOption::silenceSleepMsec() * 0.001 * SR
+		|| _silentFrames <= _sleepMinFrames)
+		return;
+	if (cursamp >= _sleepInputFrames) {
+		setendsamp(i_chunkstart + framesToRun());
+		rtcmix_debug(name(), "silent tail, ending note");
+	}
+	else if (!hasChainedInput()
+			 && (_input.fdIndex == NO_DEVICE_FDINDEX || RTcmix::isInputAudioDevice(_input.fdIndex)))
+		_asleep = true;
+}
+
+/* ------------------------------------------------------- sleepThisChunk --- */
+/* For a sleeping note: keep sleeping, and just move on in time, unless its
+   input has stopped being silent or has ended.
+*/
+
+bool Instrument::sleepThisChunk()
+{
+	const int frames = framesToRun();
+	bool silent = cursamp < _sleepInputFrames;
+	if (silent) {
+		const bool fromDevice = (_input.fdIndex != NO_DEVICE_FDINDEX);
+		const short *chans = fromDevice ? _busSlot->in : _busSlot->auxin;
+		const short count = fromDevice ? _busSlot->in_count : _busSlot->auxin_count;
+		silent = RTcmix::inputIsSilent(fromDevice, chans, count, output_offset,
+									   frames, silenceThreshold());
+	}
+	if (!silent) {
+		_asleep = false;
+		_silentFrames = 0;
+		return false;
+	}
+	increment(frames);
+	return true;
+}
+
+/* If the pfbus we are linked to with bus_link() will dequeue us during the
+   chunk we are about to run (or already should have), stop on that frame.
+*/
+void Instrument::stopAtBusEnd()
+{
+	const FRAMETYPE end = PFBusData::dequeueFrame(my_pfbus);
+	if (end < 0 || end >= getendsamp() || end >= i_chunkstart + framesToRun())
+		return;
+	if (end > i_chunkstart && !rendersAlignedBlocks())
+		setchunk(int(end - i_chunkstart));
+	setendsamp(end);
+}
+
 void Instrument::configureEndSamp(FRAMETYPE *pStartSamp)
 {
 	// Calculate variables for heap insertion
@@ -285,8 +789,12 @@ void Instrument::configureEndSamp(FRAMETYPE *pStartSamp)
 	FRAMETYPE startsamp = (FRAMETYPE) (0.5 + start * SR);	// Rounded to nearest - DS
 	
 	if (RTcmix::interactive()) {
-		// Adjust start frame based on elapsed frame count
-		startsamp += RTcmix::getElapsedFrames();
+		// Adjust start frame based on elapsed frame count, or on the
+		// host's stamp for an immediate note
+		if (RTcmix::noteStamp() >= 0)
+			startsamp += RTcmix::noteStamp();
+		else
+			startsamp += RTcmix::getElapsedFrames();
 	}
 	
 	FRAMETYPE newEndSamp = startsamp+nSamps();
@@ -297,14 +805,29 @@ void Instrument::configureEndSamp(FRAMETYPE *pStartSamp)
 }
 
 /* ------------------------------------------------------------- schedule --- */
-/* Called from checkInsts to place the instrument into the scheduler heap */
+/* Called from checkInsts to place the instrument into the scheduler heap.
+   When interactive or streaming the score, it goes through the heap's inbox,
+   so that the parser never holds up the audio thread.  Stamped interactive
+   notes skip the heap altogether (see RTcmix::postImmediate()).
+*/
 
 void Instrument::schedule(heap *rtHeap)
 {
+	static unsigned sScheduled = 0;
+	_mixOrder = sScheduled++;
 	FRAMETYPE startsamp = 0;
 	configureEndSamp(&startsamp);
 	// place instrument into heap
-	rtHeap->insert(this, startsamp);
+	if (RTcmix::parsingAhead()) {
+		rtHeap->post(this, startsamp);
+		RTcmix::advanceParseHorizon(startsamp);
+	}
+	else if (RTcmix::interactive()) {
+		if (RTcmix::noteStamp() < 0 || !RTcmix::postImmediate(this, startsamp))
+			rtHeap->post(this, startsamp);
+	}
+	else
+		rtHeap->insert(this, startsamp);
 }
 
 /* ----------------------------------------------------------------- exec --- */
@@ -325,6 +848,7 @@ void Instrument::schedule(heap *rtHeap)
 */
 int Instrument::exec(BusType bus_type, int bus)
 {
+   AllocTracker::NoteScope note(_statsSlot);
    bool done;
 
    //printf("Instrument::exec(%p [%s] bus_type %d, bus %d, needs_to_run %d\n", this, name(), (int)bus_type, bus, needs_to_run);
@@ -334,15 +858,7 @@ int Instrument::exec(BusType bus_type, int bus)
    addout(bus_type, bus);
 
    /* Decide whether we'll call run() next time. */
-   done = true;
-//   printf("Instrument::exec(%p) bufferWritten[0]: %d bufferWritten[1]: %d\n",
-//		  this, (int) bufferWritten[0], (int) bufferWritten[1]);
-   for (int i = 0; i < outputchans; i++) {
-	   if (bufferWritten[i] == false) {
-         done = false;
-         break;
-      }
-   }
+   done = (_writtenCount == outputchans);
    if (done) {
        needs_to_run = true;
    }
@@ -361,10 +877,17 @@ int Instrument::exec(BusType bus_type, int bus)
 */
 int Instrument::rtaddout(BUFTYPE samps[])
 {
-	BUFTYPE *out = obufptr;
-	for (int i = 0; i < outputchans; i++)
-		out[i] = samps[i];
-	obufptr += outputchans;
+	int stride;
+	BUFTYPE *out = outputChannel(0, &stride);
+	if (_planarOutput) {
+		for (int i = 0; i < outputchans; i++)
+			out[i * _planeFrames] = samps[i];
+	}
+	else {
+		for (int i = 0; i < outputchans; i++)
+			out[i] = samps[i];
+	}
+	advanceOutput(1);
 	return outputchans;
 }
 
@@ -376,17 +899,52 @@ int Instrument::rtaddout(BUFTYPE samps[])
 int Instrument::rtbaddout(BUFTYPE samps[], int length)
 {
 	const int sampcount = length * outputchans;
-	BUFTYPE *out = obufptr;
-	for (int i = 0; i < sampcount; i++)
-		out[i] = samps[i];
-	obufptr += sampcount;
+	if (_planarOutput) {
+		for (int ch = 0; ch < outputchans; ch++) {
+			int stride;
+			BUFTYPE *out = outputChannel(ch, &stride);
+			for (int i = 0; i < length; i++)
+				out[i] = samps[i * outputchans + ch];
+		}
+	}
+	else {
+		BUFTYPE *out = obufptr;
+		for (int i = 0; i < sampcount; i++)
+			out[i] = samps[i];
+	}
+	advanceOutput(length);
 	return sampcount;
 }
 
 
+/* ------------------------------------------------- rendersAlignedBlocks --- */
+/* With aligned_blocks, inTraverse always gives us whole buffer-length chunks,
+   counted from our own start frame, and addout lets the last one run over into
+   the next buffer.  Instruments reading a bus need their input for the same
+   span as the buffer being played, so they keep chunks aligned to it instead.
+   The answer is kept once the note is configured, since the scheduler asks
+   for every note in every pass.
+*/
+bool Instrument::rendersAlignedBlocks() const
+{
+	if (_alignedBlocks >= 0)
+		return _alignedBlocks;
+	bool aligned;
+	if (!RTOption::alignedBlocks() || hasChainedInput())
+		aligned = false;
+	else if (_input.fdIndex == NO_DEVICE_FDINDEX)
+		aligned = _busSlot->auxin_count == 0;
+	else
+		aligned = !RTcmix::isInputAudioDevice(_input.fdIndex);
+	if (_configState == kConfigured)
+		_alignedBlocks = aligned;
+	return aligned;
+}
+
 /* --------------------------------------------------------------- addout --- */
 /* Add signal from one channel of instrument's private interleaved buffer
-   into the specified output bus.
+   into the specified output bus.  Frames of an aligned block past our end
+   are dropped.
 */
 void Instrument::addout(BusType bus_type, int bus)
 {
@@ -408,19 +966,35 @@ void Instrument::addout(BusType bus_type, int bus)
 
 	   assert(src_chan != -1);
 
-	   endframe = output_offset + framesToRun();
+	   int frames = framesToRun();
+	   const FRAMETYPE remaining = getendsamp() - i_chunkstart;
+	   if (remaining < frames)
+		   frames = (remaining > 0) ? int(remaining) : 0;
+	   endframe = output_offset + frames;
 
 		// Add outbuf to appropriate bus at offset
 #ifdef DEBUG
 		RTPrintf("%s::addout(this=%p %d, %d): doing normal addToBus\n", name(), this, (int)bus_type, bus);
 #endif
-		RTcmix::addToBus(bus_type, bus,
-						 &outbuf[src_chan], output_offset,
-						 endframe, outputchans);
+		// A sleeping note has nothing to add.  A planar outbuf mixes
+		// like a mono one.
+		if (!_sleptChunk) {
+			if (_planarOutput)
+				RTcmix::addToBus(bus_type, bus,
+								 &outbuf[src_chan * _planeFrames], output_offset,
+								 endframe, 1, _mixOrder);
+			else
+				RTcmix::addToBus(bus_type, bus,
+								 &outbuf[src_chan], output_offset,
+								 endframe, outputchans, _mixOrder);
+		}
 
 		/* Show exec() that we've written this chan. */
-		bufferWritten[src_chan] = true;
-		//   printf("Instrument::addout(%p): bufferWritten[%d] now 1\n", this, src_chan);
+		const unsigned int bit = 1U << (src_chan & 31);
+		if (!(_written[src_chan >> 5] & bit)) {
+			_written[src_chan >> 5] |= bit;
+			++_writtenCount;
+		}
 	}
 #ifdef DEBUG
 	else {
@@ -435,7 +1009,12 @@ void Instrument::addout(BusType bus_type, int bus)
 
 void	Instrument::clearOutput(int length)
 {
-	bzero((void *)outbuf, sizeof(BUFTYPE) * length * outputchans);
+	if (_planarOutput) {
+		for (int ch = 0; ch < outputchans; ch++)
+			bzero((void *)&outbuf[ch * _planeFrames], sizeof(BUFTYPE) * length);
+	}
+	else
+		bzero((void *)outbuf, sizeof(BUFTYPE) * length * outputchans);
 }
 
 /* ----------------------------------------------------------------- gone --- */
@@ -449,6 +1028,10 @@ void Instrument::gone()
    RTPrintf("Instrument::gone(this=%p): index %d\n", this, _input.fdIndex);
 #endif
 
+   if (_input.stream) {
+      _input.stream->release();
+      _input.stream = NULL;
+   }
    if (_input.fdIndex >= 0) {
       RTcmix::releaseInput(_input.fdIndex);
       _input.fdIndex = NO_DEVICE_FDINDEX;
@@ -488,3 +1071,18 @@ Instrument::getPFieldTable(int index, int *tableLen) const
 		*tableLen = 0;
 	return tableArray;
 }
+
+const float *
+Instrument::getPFieldFloatTable(int index, int *tableLen) const
+{
+	const PField &pf = getPField(index);
+	const float *tableArray = pf.floatArray();
+	*tableLen = (tableArray != NULL) ? pf.values() : 0;
+	return tableArray;
+}
+
+const Omipmap *
+Instrument::getPFieldMipmap(int index) const
+{
+	return getPField(index).mipmap();
+}
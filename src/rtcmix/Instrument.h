@@ -7,9 +7,9 @@
 
 #include <RefCounted.h>
 #include <bus.h>
-#include <Locked.h>
 #include <rt_types.h>
 #include <sys/types.h>
+#include <stddef.h>
 #include "rtdefs.h"
 
 
@@ -18,32 +18,87 @@
 class heap;
 class PFieldSet;
 class PField;
+class Omipmap;
 class BusSlot;
+class InputStream;
+struct CachedNote;
 
 struct InputState {
    InputState();
    int            fdIndex;         // index into unix input file desc. table
+   int            sourceIndex;     // last rtinput() when the note was made
    off_t          fileOffset;      // current offset in file for this inst
    double         inputsr;		   // SR of input file
    int            inputchans;	   // Chans of input file
    int            inputNsamps;	   // length in samps of input file
+   InputStream    *stream;         // read-ahead for file input, or NULL
+};
+
+// A control value that an instrument updates at the control rate (every
+// getSkip() frames), but reads every sample.  With the smooth_controls
+// option on, each update starts a straight line from the current value to
+// the new one over the next <frames> frames, so there is no zipper noise
+// from the steps; otherwise the new value holds until the next update, as
+// before.  The line trails the p-field by one control period.
+
+class ControlRamp {
+public:
+	ControlRamp();
+	void	set(double target, int frames) {
+		if (_ramping && _started && frames > 1)
+			_incr = (target - _value) / frames;
+		else {
+			_value = target;
+			_incr = 0.0;
+		}
+		_started = true;
+	}
+	// Call once per frame, after set().
+	double	next() { return _value += _incr; }
+	double	value() const { return _value; }
+private:
+	double	_value;
+	double	_incr;
+	bool	_ramping;
+	bool	_started;
 };
 
 class Instrument : public RefCounted {
+	// The scheduler reads or sets these for every note it plays in every
+	// buffer, so they come first, where a pass over many notes finds them in
+	// the one or two cache lines at the start of each.  Everything set up
+	// once per note follows.
+protected:
+   int            cursamp;
+   int            chunksamps;
+   int            output_offset;
+private:
+   bool           needs_to_run;
+   mutable signed char _alignedBlocks; // rendersAlignedBlocks(), or -1 until known
 protected:
+   FRAMETYPE      i_chunkstart;   // we need this for rtperf
+   FRAMETYPE      endsamp;        // set and read atomically; see setendsamp()
+   BUFTYPE        *outbuf;         // private interleaved (or planar) buffer
+   BusSlot        *_busSlot;
+private:
+   BUFTYPE        *obufptr;
+   float          _runCost;        // recent nsec per frame of run(), or 0
+   int            _lastWorker;     // TaskManager thread of the last run(), or -1
+   int            _statsSlot;      // where DSPStats counts our run() time
+   int            _nsamps;
+   int            _skip;
 
+protected:
 	// These replace the old globals
-   static int	  RTBUFSAMPS;
-   static int     NCHANS;
-   static float   SR;
+   // The output format when this note was made.  Kept with each note,
+   // rather than shared by all of them, so that notes need no global
+   // state to render.
+   int            RTBUFSAMPS;
+   int            NCHANS;
+   float          SR;
 
    float          _start;
    float          _dur;
-   int            cursamp;
-   int            chunksamps;
-   FRAMETYPE      i_chunkstart;   // we need this for rtperf
-   Locked<FRAMETYPE>    endsamp;
-   int            output_offset;
 
    int            sfile_on;        // a soundfile is open (for closing later)
 
@@ -53,40 +108,90 @@ protected:
 
    int            mytag;           // for note tagging/rtupdate() 
 
-   BUFTYPE        *outbuf;         // private interleaved buffer
-
-   BusSlot        *_busSlot;
    PFieldSet	  *_pfields;
-   static double  s_dArray[];
 
 private:
    char 		  *_name;	// the name of this instrument
-   BUFTYPE        *obufptr;
-   bool           bufferWritten[MAXBUS];
-   bool           needs_to_run;
-   int            _skip;
-   int            _nsamps;
+   // One bit for each output channel addout() has written this chunk, and
+   // how many are set.  bus_config lets no instrument have more than MAXBUS.
+   enum { kWrittenWords = (MAXBUS + 31) / 32 };
+   unsigned int   _written[kWrittenWords];
+   int            _writtenCount;
+   FRAMETYPE      _startFrame;     // output frame of our frame 0
+   struct PFieldValue;
+   PFieldValue    *_snapshot;      // last value read from each pfield
+   unsigned       _snapshotChunk;  // run() calls so far, to key _snapshot
+   unsigned       _updates;        // update() calls so far
+   unsigned       _changedAt;      // update() call in which a pfield last changed
+   int            _sleepInputFrames;  // -1 unless sleepWhenSilent() called
+   int            _silentFrames;   // frames of silent output so far
+   int            _sleepMinFrames; // longest delay of a sleeping effect
+   int            _tailFrames;     // see tailFrames()
+   bool           _asleep;         // not running until input returns
+   bool           _sleptChunk;     // run() skipped for this chunk
+   bool           _notifyNoiseFloor;  // notifyAtNoiseFloor() called
+   bool           _atNoiseFloor;   // noiseFloorReached() called since last sound
+   long           _memBytes;       // what we have charged to MemStats
+   unsigned       _mixOrder;       // schedule() calls before ours, to order mixes
+   bool           _planarOutput;   // outbuf holds each channel in turn
+   int            _planeFrames;    // frames per channel of a planar outbuf
+   int            _voiceLimit;     // our Polyphony limit, or -1
+   bool           _trackLevel;     // keep _level, for stealing the quietest
+   float          _level;          // peak of our last chunk
+   FRAMETYPE      _releaseEnd;     // where a release() fade reaches zero
+   int            _releaseFrames;  // its length, or 0 if not released
 	// CHAINED INSTRUMENT SUPPORT
 	BUFTYPE *		inputChainBuf;			// buffer used as input by rtgetin()
 	// BGG -- for pfbus connection (dynamic PFields)
 	int				my_pfbus;
+	bool			_allowNoteCache;	// see allowNoteCache()
+	CachedNote *	_noteCapture;	// where our output is cached, or NULL
+	const volatile bool *_frozenBy;	// set by BusFreeze, else NULL
+	enum { kUnconfigured, kConfiguring, kConfigured, kConfigFailed };
+	volatile int	_configState;	// see configureOnce()
 
 public:
 	// Instruments should use these to access variables.
 	int				currentFrame() const { return cursamp; }
 	int				framesToRun() const { return chunksamps; }
 	int				nSamps() const { return _nsamps; }
+	// For how many frames an effect's output still carries its input -- a
+	// reverb's decay, a delay line's length -- or -1 if it has not said.
+	// Preroll for rtoffset (see RTcmix::prunePreroll()) leaves out the notes
+	// feeding an effect whose tail from them is over by the offset.
+	int				tailFrames() const { return _tailFrames; }
 	int				inputChannels() const { return _input.inputchans; }
 	int				inputNSamps() const { return _input.inputNsamps; }
 	int				outputChannels() const { return outputchans; }
 	int				getSkip() const { return _skip; }
+	// Used by the scheduler to lower the control rate under overload.
+	void			setSkip(int skip) { _skip = (skip < 1) ? 1 : (skip > _nsamps) ? _nsamps : skip; }
     FRAMETYPE       get_ichunkstart() const { return i_chunkstart; }
 	// Use this to increment cursamp inside single-frame run loops.
 	void			increment() { ++cursamp; }
 	// Use this to increment cursamp inside block-based run loops.
 	void	    	increment(int amount) { cursamp += amount; }
-	void			setendsamp(FRAMETYPE end) { endsamp = end; }
+	// The end can be moved by any thread (a pfbus dequeue, a voice steal)
+	// while the scheduler reads it, so it is an atomic rather than locked.
+	void			setendsamp(FRAMETYPE end) { __atomic_store_n(&endsamp, end, __ATOMIC_RELEASE); }
 	bool			needsToRun() const { return needs_to_run; }
+	// What run() is expected to take per frame, in nsec, or 0 if unknown.
+	// Kept only in MULTI_THREAD builds, for ordering the tasks.
+	double			runCost() const;
+	// The TaskManager thread to run this note on, to find its state still
+	// in that core's cache: the one that ran it last, or, for a new note,
+	// the one that last ran its class.  -1 if none.
+	int				preferredWorker() const;
+	// True if a frozen bus replays this note's output (see BusFreeze.h).
+	bool			frozen() const { return _frozenBy != NULL && *_frozenBy; }
+	// Voice limits (see Polyphony.h).  A released note fades out from output
+	// frame <from> over <frames> frames, and ends there.
+	void			setVoiceLimit(int limit, bool trackLevel);
+	int				voiceLimit() const { return _voiceLimit; }
+	float			level() const { return _level; }
+	bool			releasing() const { return _releaseFrames > 0; }
+	void			release(FRAMETYPE from, int frames);
+	bool			rendersAlignedBlocks() const;
 	// These inlines are declared at bottom of this header.
 	inline float	getstart() const;
 	inline float	getdur() const;
@@ -101,16 +206,37 @@ public:
 	void			set_bus_config(const char *);
 	virtual int		setup(PFieldSet *);				// Called by checkInsts()
 	virtual int		init(double *, int);			// Called by setup()
-	int				configure(int bufsamps);		// Called by inTraverse
+	int				configure(int bufsamps);		// Called by checkInsts()
+	// Called by inTraverse, and ahead of time by the Preparer, so that a
+	// note is configured once by whichever gets to it first; the other waits
+	// for the result.  Returns 1 without waiting if <inWait> is false and
+	// the note was already claimed.
+	int				configureOnce(int bufsamps, bool inWait=true);
+	bool			needsConfigure() const { return _configState == kUnconfigured; }
 	int				run(bool needsTo);
 	virtual int		update(double *, int , unsigned fields=0);	// Called by run()
 	double			update(int index, int totframes=0, int curFrame=-1);
+	void			updateBlock(int index, double *values, int nframes,
+								int totframes=0, int curFrame=-1);
+	// update() for more than 31 pfields: a bitmask of 32 fields per word.
+	int				updateFields(double *, int nvalues, const unsigned *fields);
+	// Whether any pfield read by the last update() differed from what was
+	// read before, or whether pfield <index> did.  Both are true after the
+	// first update(), which setup() makes for init().
+	bool			pfieldsChanged() const { return _changedAt == _updates; }
+	bool			pfieldChanged(int index) const;
 
 	int				exec(BusType bus_type, int bus);
 	void			addout(BusType bus_type, int bus);
 	bool			isDone() const { return cursamp >= _nsamps; }
 	const char *	name() const { return _name; }
 
+	// A new instrument is made and destroyed for every note, so their memory
+	// comes from a pool that keeps a free list for each object size, which in
+	// practice means one per instrument class.
+	static void *	operator new(size_t size);
+	static void		operator delete(void *ptr);
+
 	// These are called by the base class methods declared above.
 
 	virtual int		configure();	// Sometimes overridden in derived class.
@@ -118,6 +244,8 @@ public:
 
 // BGG -- added this for Ortgetin object support (see lib/Ortgetin.C)
    friend			class Ortgetin;
+   friend			class NoteCache;
+   friend			class BusFreeze;
 
 protected:
    // Methods which are called from within other methods
@@ -136,15 +264,103 @@ protected:
 	static int		rtinrepos(Instrument *, int, int);
 	static int		rtgetin(float *, Instrument *, int);
 	int				rtgetin(float *, int);
+	const BUFTYPE *	rtgetinbuf(BUFTYPE *inarr, int nsamps);	// no copy when chained
+	// One channel of input, read in place: frame n is samps[n * stride].
+	struct InputChannel {
+		const BUFTYPE *	samps;
+		int				stride;
+	};
+	int				rtgetinchans(InputChannel chans[], BUFTYPE *inarr, int nsamps);
+	// True when rtgetinchans() will not need <inarr>.  Valid from init() on.
+	bool			readsInputInPlace() const;
 	int				rtaddout(BUFTYPE samps[]);  			// replacement for old rtaddout
 	int				rtbaddout(BUFTYPE samps[], int length);	// block version of same
 	void			clearOutput(int length);
+	// Block-based instruments can write their output a channel at a time
+	// instead of a frame at a time.  <chan>'s next frame goes at the pointer
+	// returned, and the frames after it every <stride> samples; once all
+	// channels are written, advanceOutput() moves past them.  An instrument
+	// that calls setPlanarOutput() in init() gets outbuf laid out a channel
+	// after another, so that the stride is 1 and both its writes and the
+	// mix into the buses are contiguous.  (Notes in a CHAIN stay
+	// interleaved, so an instrument must always use the stride it is given.)
+	void			setPlanarOutput() { _planarOutput = true; }
+	inline BUFTYPE *	outputChannel(int chan, int *stride) const;
+	inline void		advanceOutput(int frames);
+	// For run() loops over every input or output channel: returns
+	// <inst>->runChannels<IN, OUT>(), with IN and OUT the input and output
+	// channel counts when each is 1, 2, 4 or 8, or else 0.  In the usual
+	// cases the counts are then constants, so the compiler can unroll the
+	// channel loops.  The instrument declares the template publicly, and
+	// uses IN ? IN : inputChannels() (and likewise OUT) for its counts.
+	template <class Inst>
+	static inline int	runForChannels(Inst *inst);
+	// The same for an instrument with a fixed output count: only IN varies,
+	// and OUT is always 0.
+	template <class Inst>
+	static inline int	runForInputChannels(Inst *inst);
+	// Effects whose output comes only from their input call this in init()
+	// to let the scheduler stop running them while their input and output
+	// are silent (see silence_sleep_msec).  After the first <inputFrames>
+	// frames only the tail is left, and silent output ends the note.  Output
+	// must stay silent for at least <longestDelay> frames as well, so that
+	// nothing is still on its way through the effect's delay lines.  Unless
+	// setTailFrames() has been called, the frames after <inputFrames> (or
+	// <longestDelay>, if longer) become the note's tail.
+	void			sleepWhenSilent(int inputFrames, int longestDelay = 0);
+	// Effects call this in init() to say for how many frames their output
+	// still carries their input (see tailFrames()).
+	void			setTailFrames(int frames) { _tailFrames = frames; }
+	// Instruments with feedback (filters, resonators) call this in init()
+	// to have noiseFloorReached() called after the first run() whose output
+	// is all below silence_threshold_db, and then again only after the
+	// output has risen above it.  Clearing the feedback state there keeps a
+	// dying tail from decaying into denormals where the CPU cannot flush
+	// them to zero (see Denormals.h).
+	void			notifyAtNoiseFloor() { _notifyNoiseFloor = true; }
+	virtual void	noiseFloorReached() {}
+	// Instruments whose output depends only on their pfields and input file
+	// -- nothing random, and no makegen tables -- call this in init() to let
+	// the note_cache option replay a note's output for later notes just
+	// like it (see NoteCache.h).
+	void			allowNoteCache() { _allowNoteCache = true; }
+
+	// Per-note sample buffers from a shared pool, which are recycled
+	// rather than returned to the system.  Use these instead of new [] and
+	// delete [] for buffers made in configure() and freed in the destructor.
+	// They are charged to the note's class by MemStats.
+	BUFTYPE *		allocBuffer(int samps);
+	void			freeBuffer(BUFTYPE *buffer);
+
+	// Call <func>(<context>, n) for each n from 0 to <count> - 1, sharing the
+	// calls with idle TaskManager workers when run() is on one of them, or
+	// else with the frame_threads helper threads when no other note has
+	// them.  The calls must not depend on one another, but may themselves
+	// call runInParallel.  See TaskManager.h and WorkerPool.h.
+	typedef void (*IndexedFunction)(void *context, int index);
+	static void		runInParallel(IndexedFunction func, void *context,
+								  int count);
 
 	const PField &	getPField(int index) const;
 	const double *	getPFieldTable(int index, int *tableLen) const;
+	// Like getPFieldTable, for a table stored as floats.  Returns NULL if
+	// the table is not one (call getPFieldTable for it instead).
+	const float *	getPFieldFloatTable(int index, int *tableLen) const;
+	// The band-limited levels of a table made with maketable's "bandlimit"
+	// option, or NULL for any other pfield.
+	const Omipmap *	getPFieldMipmap(int index) const;
 
 private:
    void				gone(); // decrements reference to input soundfile
+   bool				sleepThisChunk();
+   void				checkForSilence();
+   void				stopAtBusEnd();
+   void				noteRunCost(long long nsec);
+   void				chargeMemory(long bytes);
+   void				voiceChunk();
+   double			pfieldValue(int index, double percent);
+	template <int IN, class Inst>
+	static inline int	runForOutputs(Inst *inst);
 };
 
 /* ------------------------------------------------------------- getstart --- */
@@ -162,7 +378,7 @@ inline float Instrument::getdur() const
 /* ----------------------------------------------------------- getendsamp --- */
 inline FRAMETYPE Instrument::getendsamp() const
 {
-   return endsamp;
+   return __atomic_load_n(&endsamp, __ATOMIC_ACQUIRE);
 }
 
 
@@ -189,5 +405,55 @@ inline const BusSlot *	Instrument::getBusSlot() const
 	return _busSlot;
 }
 
+/* -------------------------------------------------------- outputChannel --- */
+inline BUFTYPE *Instrument::outputChannel(int chan, int *stride) const
+{
+	*stride = _planarOutput ? 1 : outputchans;
+	return _planarOutput ? obufptr + chan * _planeFrames : obufptr + chan;
+}
+
+/* -------------------------------------------------------- advanceOutput --- */
+inline void Instrument::advanceOutput(int frames)
+{
+	obufptr += _planarOutput ? frames : frames * outputchans;
+}
+
+/* ------------------------------------------------------- runForChannels --- */
+template <class Inst>
+inline int Instrument::runForChannels(Inst *inst)
+{
+	switch (inst->inputChannels()) {
+	case 1:  return runForOutputs<1>(inst);
+	case 2:  return runForOutputs<2>(inst);
+	case 4:  return runForOutputs<4>(inst);
+	case 8:  return runForOutputs<8>(inst);
+	default: return runForOutputs<0>(inst);
+	}
+}
+
+template <class Inst>
+inline int Instrument::runForInputChannels(Inst *inst)
+{
+	switch (inst->inputChannels()) {
+	case 1:  return inst->template runChannels<1, 0>();
+	case 2:  return inst->template runChannels<2, 0>();
+	case 4:  return inst->template runChannels<4, 0>();
+	case 8:  return inst->template runChannels<8, 0>();
+	default: return inst->template runChannels<0, 0>();
+	}
+}
+
+template <int IN, class Inst>
+inline int Instrument::runForOutputs(Inst *inst)
+{
+	switch (inst->outputChannels()) {
+	case 1:  return inst->template runChannels<IN, 1>();
+	case 2:  return inst->template runChannels<IN, 2>();
+	case 4:  return inst->template runChannels<IN, 4>();
+	case 8:  return inst->template runChannels<IN, 8>();
+	default: return inst->template runChannels<IN, 0>();
+	}
+}
+
 #endif /* _INSTRUMENT_H_  */
 
@@ -5,20 +5,25 @@
 #include <stdio.h>
 #include <unistd.h>		// for lseek
 #include <sys/stat.h>	// for stat for getFrame()
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <string.h>
 #include <byte_routines.h>
 #include "lpcdefs.h"
 #include "lpcheader.h"
 
 LPCDataSet::LPCDataSet()
 	: _nPoles(0), _frameCount(0), _fdesc(-1), _lpHeaderSize(0), 
-	  _array(NULL), _oldframe(0), _endframe(0), _swapped(false)
+	  _array(NULL), _oldframe(0), _endframe(0), _swapped(false),
+	  _map(NULL), _mapSize(0)
 {
 	_fprec = 22;
 }
 
 LPCDataSet::~LPCDataSet()
 {
+	if (_map)
+		::munmap((void *) _map, _mapSize);
 	if (_fdesc > 0)
 		::close(_fdesc);
 	delete [] _array;
@@ -50,6 +55,14 @@ LPCDataSet::open(const char *fileName, int npoleGuess, float sampRate)
 	/* store and return number of frames in datafile */
 	if (::stat(fileName, &st) >= 0) {
 		_frameCount = (st.st_size-_lpHeaderSize) / _bpframe;
+		void *map = (_frameCount > 0)
+			? ::mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, _fdesc, 0) : MAP_FAILED;
+		if (map != MAP_FAILED) {
+			_map = (const char *) map;
+			_mapSize = (size_t) st.st_size;
+		}
+		else if (_frameCount > 0)
+			rtcmix_warn("dataset", "Can't map %s into memory -- reading it instead", fileName);
 		return _frameCount;
 	}
 	else {
@@ -57,8 +70,52 @@ LPCDataSet::open(const char *fileName, int npoleGuess, float sampRate)
 	}
 }
 
+const float *
+LPCDataSet::getFrameData(int frame) const
+{
+	if (_map == NULL || _swapped || frame < 0 || frame >= _frameCount)
+		return NULL;
+	const char *data = _map + _lpHeaderSize + (size_t) frame * _bpframe;
+	if ((size_t) data % sizeof(float) != 0)
+		return NULL;
+	return (const float *) data;
+}
+
 int
 LPCDataSet::getFrame(double frameno, float *pCoeffs)
+{
+	if (_map == NULL) {
+		// The frames read last are shared by everyone reading them.
+		lock();
+		const int status = readFrame(frameno, pCoeffs);
+		unlock();
+		return status;
+	}
+	int frame = (int)frameno;
+	double fraction = frameno - (double)frame;
+	if (frame < 0 || frame >= _frameCount) {
+		rtcmix_warn("LPC","reached eof on analysis file");
+		return(-1);
+	}
+	// The last frame has no successor to interpolate toward.
+	const int next = (frame + 1 < _frameCount) ? frame + 1 : frame;
+	const char *first = _map + _lpHeaderSize + (size_t) frame * _bpframe;
+	const char *second = _map + _lpHeaderSize + (size_t) next * _bpframe;
+	for (int j = 0; j < _framsize; j++) {
+		float a, b;
+		memcpy(&a, first + j * FLOAT, sizeof(float));
+		memcpy(&b, second + j * FLOAT, sizeof(float));
+		if (_swapped) {
+			byte_reverse4(&a);
+			byte_reverse4(&b);
+		}
+		pCoeffs[j] = a + fraction * (b - a);
+	}
+	return(0);
+}
+
+int
+LPCDataSet::readFrame(double frameno, float *pCoeffs)
 {
 	int i,j;
 	int frame = (int)frameno;
@@ -1,7 +1,13 @@
 #include <RefCounted.h>
 #include <Lockable.h>
+#include <sys/types.h>
 
 // LPCDataSet.h
+//
+// The analysis file is mapped into memory, so that any number of notes can
+// read frames from it at once, from any thread, without locking.  If it
+// cannot be mapped, frames are read from the file a block at a time under
+// the lock.
 
 class LPCDataSet : public RefCounted, public Lockable
 {
@@ -11,9 +17,13 @@ public:
 	int getNPoles() const { return _nPoles; }
 	off_t getFrameCount() const { return _frameCount; }
 	int	getFrame(double frameno, float *pCoeffs);
+	// Frame <frame> in place, or NULL if the file is not mapped, or needs
+	// byte-swapping, or has no such frame.
+	const float *	getFrameData(int frame) const;
 protected:
 	~LPCDataSet();
 	void	allocArray(int nPoles);
+	int		readFrame(double frameno, float *pCoeffs);
 private:
 	int	_nPoles;
 	off_t _frameCount;
@@ -28,5 +38,7 @@ private:
 	int	_bpframe;
 	int	_npolem1;
 	bool _swapped;
+	const char *_map;
+	size_t	_mapSize;
 };
 
@@ -55,6 +55,7 @@ Handle getlpcframedata(const char *filename, const char *functionname, int npole
     int framesToRead = lastFrame - firstFrame + 1;
 
     Array *outValues = (Array *)malloc(sizeof(Array));
+    outValues->lease = NULL;
     outValues->len = framesToRead;
     outValues->data = (double *)malloc(framesToRead * sizeof(double));
     memset(outValues->data, 0, framesToRead * sizeof(double));
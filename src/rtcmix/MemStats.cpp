@@ -0,0 +1,109 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include "MemStats.h"
+#include <ugens.h>
+#include <stdio.h>
+
+// Memory is charged from any thread -- the parser, the audio thread, workers
+// freeing notes -- so every count is atomic.  A peak is raised with a
+// compare-and-swap after the count it follows.
+
+static volatile long long sBytes[MemStats::kCategoryCount];
+static volatile long long sPeakBytes[MemStats::kCategoryCount];
+static volatile long long sTotalBytes = 0;
+static volatile long long sPeakTotalBytes = 0;
+static volatile long long sClassBytes[DSPStats::kMaxClasses];
+static volatile long long sClassPeakBytes[DSPStats::kMaxClasses];
+
+static const char *sCategoryNames[MemStats::kCategoryCount] = {
+	"tables", "inputs", "instruments", "buses", "minc"
+};
+
+static inline void raisePeak(volatile long long *peak, long long value)
+{
+	long long old;
+	while ((old = *peak) < value)
+		if (__sync_bool_compare_and_swap(peak, old, value))
+			break;
+}
+
+void MemStats::add(Category inCategory, long long inBytes)
+{
+	if (inBytes == 0)
+		return;
+	const long long bytes = __sync_add_and_fetch(&sBytes[inCategory], inBytes);
+	const long long total = __sync_add_and_fetch(&sTotalBytes, inBytes);
+	if (inBytes > 0) {
+		raisePeak(&sPeakBytes[inCategory], bytes);
+		raisePeak(&sPeakTotalBytes, total);
+	}
+}
+
+void MemStats::addInstrument(int inSlot, long long inBytes)
+{
+	if (inSlot < 0 || inSlot >= DSPStats::kMaxClasses || inBytes == 0)
+		return;
+	const long long bytes = __sync_add_and_fetch(&sClassBytes[inSlot], inBytes);
+	if (inBytes > 0)
+		raisePeak(&sClassPeakBytes[inSlot], bytes);
+}
+
+void MemStats::getTotals(Totals *outTotals)
+{
+	for (int c = 0; c < kCategoryCount; ++c) {
+		outTotals->bytes[c] = sBytes[c];
+		outTotals->peakBytes[c] = sPeakBytes[c];
+	}
+	outTotals->totalBytes = sTotalBytes;
+	outTotals->peakTotalBytes = sPeakTotalBytes;
+}
+
+static inline double megabytes(long long bytes)
+{
+	return bytes / 1048576.0;
+}
+
+int MemStats::report(char *outText, int inLength)
+{
+	if (inLength <= 0)
+		return 0;
+	Totals totals;
+	getTotals(&totals);
+
+	// Per-class peaks, largest first
+	int order[DSPStats::kMaxClasses];
+	int classes = 0;
+	for (int i = 0; i < DSPStats::kMaxClasses; ++i) {
+		if (sClassPeakBytes[i] == 0)
+			continue;
+		int j;
+		for (j = classes; j > 0 && sClassPeakBytes[order[j - 1]] < sClassPeakBytes[i]; --j)
+			order[j] = order[j - 1];
+		order[j] = i;
+		++classes;
+	}
+
+	int len = snprintf(outText, inLength,
+					   "Memory %.2f MB (peak %.2f MB)\n",
+					   megabytes(totals.totalBytes), megabytes(totals.peakTotalBytes));
+	for (int c = 0; c < kCategoryCount && len < inLength; ++c)
+		len += snprintf(outText + len, inLength - len, "  %-16s %10.2f MB (peak %.2f MB)\n",
+						sCategoryNames[c], megabytes(totals.bytes[c]),
+						megabytes(totals.peakBytes[c]));
+	for (int i = 0; i < classes && len < inLength; ++i) {
+		const int slot = order[i];
+		len += snprintf(outText + len, inLength - len, "    %-14s %10.2f MB (peak %.2f MB)\n",
+						DSPStats::className(slot), megabytes(sClassBytes[slot]),
+						megabytes(sClassPeakBytes[slot]));
+	}
+	return (len < inLength) ? len : inLength - 1;
+}
+
+void MemStats::print()
+{
+	char text[4096];
+	report(text, sizeof(text));
+	RTPrintf("%s", text);
+}
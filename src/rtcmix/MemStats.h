@@ -0,0 +1,53 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _MEMSTATS_H_
+#define _MEMSTATS_H_ 1
+
+#include <RTOption.h>
+#include "DSPStats.h"
+
+// Where the memory goes.  The main owners of large blocks charge what they
+// hold to a category as they allocate it and give it back as they free it:
+// table PFields their arrays, the SampleCache the sound files it has read
+// into memory, instruments their objects and what they get from
+// allocBuffer(), the bus buffers, and Minc lists and maps.  Each category
+// keeps its current size and the most it has held, and so does the total.
+// These are always counted, with one atomic add each.
+//
+// With the memory_stats option, instruments also charge their class (the
+// DSPStats slots), and the report is printed at the end of the render.
+
+class MemStats {
+public:
+	enum Category {
+		kTables,
+		kInputs,
+		kInstruments,
+		kBuses,
+		kMinc,
+		kCategoryCount
+	};
+
+	struct Totals {
+		long long	bytes[kCategoryCount];
+		long long	peakBytes[kCategoryCount];
+		long long	totalBytes;
+		long long	peakTotalBytes;
+	};
+
+	static bool			enabled() { return RTOption::memoryStats(); }
+
+	// Charge <inBytes> to <inCategory>, or give them back if negative.
+	static void			add(Category inCategory, long long inBytes);
+	// The same for an instrument class (a DSPStats::classSlot()).
+	static void			addInstrument(int inSlot, long long inBytes);
+
+	static void			getTotals(Totals *outTotals);
+	// Write a text report into <outText>, returning its length.
+	static int			report(char *outText, int inLength);
+	static void			print();
+};
+
+#endif	// _MEMSTATS_H_
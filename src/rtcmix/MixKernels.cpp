@@ -0,0 +1,235 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// MixKernels.cpp -- bus mixing kernels.  See MixKernels.h.
+
+#include "MixKernels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE__)
+#define MIX_KERNEL_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MIX_KERNEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Portable versions.  The channel count is a template argument so that
+// the compiler can fold the stride.
+
+template <int CHANS>
+static void mixScalar(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int framesOverFour = frames >> 2;
+	const int framesRemaining = frames - (framesOverFour << 2);
+	for (int n = 0; n < framesOverFour; ++n) {
+		dest[0] += src[0];
+		dest[1] += src[CHANS];
+		dest[2] += src[CHANS * 2];
+		dest[3] += src[CHANS * 3];
+		dest += 4;
+		src += CHANS * 4;
+	}
+	for (int n = 0; n < framesRemaining; ++n) {
+		dest[n] += *src;
+		src += CHANS;
+	}
+}
+
+void mixKernelGeneric(BufPtr dest, const BUFTYPE *src, int frames, int srcChans)
+{
+	for (int n = 0; n < frames; ++n) {
+		dest[n] += *src;
+		src += srcChans;
+	}
+}
+
+MixKernel gMixKernels[MIX_KERNEL_MAX_CHANS + 1] = {
+	NULL, &mixScalar<1>, &mixScalar<2>, NULL, &mixScalar<4>, NULL, NULL, NULL, &mixScalar<8>
+};
+
+static const char *sKernelName = "scalar";
+
+const char *mixKernelName() { return sKernelName; }
+
+#ifdef MIX_KERNEL_X86
+
+// SSE versions.  Each handles four frames per iteration and finishes the
+// remainder with the scalar loop.
+
+static void mixSSE1(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		_mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), _mm_loadu_ps(src)));
+		dest += 4;
+		src += 4;
+	}
+	mixScalar<1>(dest, src, frames & 3);
+}
+
+static void mixSSE2(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		const __m128 a = _mm_loadu_ps(src);			// L0 R0 L1 R1
+		const __m128 b = _mm_loadu_ps(src + 4);		// L2 R2 L3 R3
+		const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		_mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), left));
+		dest += 4;
+		src += 8;
+	}
+	mixScalar<2>(dest, src, frames & 3);
+}
+
+static void mixSSE4(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		const __m128 ab = _mm_unpacklo_ps(_mm_loadu_ps(src), _mm_loadu_ps(src + 4));
+		const __m128 cd = _mm_unpacklo_ps(_mm_loadu_ps(src + 8), _mm_loadu_ps(src + 12));
+		_mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), _mm_movelh_ps(ab, cd)));
+		dest += 4;
+		src += 16;
+	}
+	mixScalar<4>(dest, src, frames & 3);
+}
+
+static void mixSSE8(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		const __m128 samps = _mm_set_ps(src[24], src[16], src[8], src[0]);
+		_mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), samps));
+		dest += 4;
+		src += 32;
+	}
+	mixScalar<8>(dest, src, frames & 3);
+}
+
+// AVX versions, for the contiguous (mono) and stereo cases where the wider
+// registers actually pay off.  These are compiled for AVX regardless of the
+// global flags and only installed if the CPU reports AVX support.
+
+__attribute__((target("avx")))
+static void mixAVX1(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 3;
+	for (int n = 0; n < blocks; ++n) {
+		_mm256_storeu_ps(dest, _mm256_add_ps(_mm256_loadu_ps(dest), _mm256_loadu_ps(src)));
+		dest += 8;
+		src += 8;
+	}
+	mixScalar<1>(dest, src, frames & 7);
+}
+
+__attribute__((target("avx")))
+static void mixAVX2(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 3;
+	for (int n = 0; n < blocks; ++n) {
+		const __m256 lo = _mm256_loadu_ps(src);			// frames 0-3
+		const __m256 hi = _mm256_loadu_ps(src + 8);		// frames 4-7
+		const __m256 x = _mm256_permute2f128_ps(lo, hi, 0x20);	// frames 0,1 | 4,5
+		const __m256 y = _mm256_permute2f128_ps(lo, hi, 0x31);	// frames 2,3 | 6,7
+		const __m256 left = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+		_mm256_storeu_ps(dest, _mm256_add_ps(_mm256_loadu_ps(dest), left));
+		dest += 8;
+		src += 16;
+	}
+	mixScalar<2>(dest, src, frames & 7);
+}
+
+static void selectKernels()
+{
+	__builtin_cpu_init();
+	if (!__builtin_cpu_supports("sse"))
+		return;
+	gMixKernels[1] = &mixSSE1;
+	gMixKernels[2] = &mixSSE2;
+	gMixKernels[4] = &mixSSE4;
+	gMixKernels[8] = &mixSSE8;
+	sKernelName = "SSE";
+	if (__builtin_cpu_supports("avx")) {
+		gMixKernels[1] = &mixAVX1;
+		gMixKernels[2] = &mixAVX2;
+		sKernelName = "AVX";
+	}
+}
+
+#elif defined(MIX_KERNEL_NEON)
+
+static void mixNEON1(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		vst1q_f32(dest, vaddq_f32(vld1q_f32(dest), vld1q_f32(src)));
+		dest += 4;
+		src += 4;
+	}
+	mixScalar<1>(dest, src, frames & 3);
+}
+
+static void mixNEON2(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		const float32x4x2_t samps = vld2q_f32(src);		// de-interleaves
+		vst1q_f32(dest, vaddq_f32(vld1q_f32(dest), samps.val[0]));
+		dest += 4;
+		src += 8;
+	}
+	mixScalar<2>(dest, src, frames & 3);
+}
+
+static void mixNEON4(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		const float32x4x4_t samps = vld4q_f32(src);
+		vst1q_f32(dest, vaddq_f32(vld1q_f32(dest), samps.val[0]));
+		dest += 4;
+		src += 16;
+	}
+	mixScalar<4>(dest, src, frames & 3);
+}
+
+static void mixNEON8(BufPtr dest, const BUFTYPE *src, int frames)
+{
+	const int blocks = frames >> 2;
+	for (int n = 0; n < blocks; ++n) {
+		float32x4_t samps = vdupq_n_f32(src[0]);
+		samps = vsetq_lane_f32(src[8], samps, 1);
+		samps = vsetq_lane_f32(src[16], samps, 2);
+		samps = vsetq_lane_f32(src[24], samps, 3);
+		vst1q_f32(dest, vaddq_f32(vld1q_f32(dest), samps));
+		dest += 4;
+		src += 32;
+	}
+	mixScalar<8>(dest, src, frames & 3);
+}
+
+// NEON is part of the baseline for every ARM target we build for.
+
+static void selectKernels()
+{
+	gMixKernels[1] = &mixNEON1;
+	gMixKernels[2] = &mixNEON2;
+	gMixKernels[4] = &mixNEON4;
+	gMixKernels[8] = &mixNEON8;
+	sKernelName = "NEON";
+}
+
+#else
+
+static void selectKernels() {}
+
+#endif	// MIX_KERNEL_X86
+
+// Select the kernels once, before main() or when a host loads the library.
+
+struct MixKernelSelector {
+	MixKernelSelector() { selectKernels(); }
+};
+
+static MixKernelSelector sSelector;
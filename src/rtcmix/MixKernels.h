@@ -0,0 +1,50 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _MIXKERNELS_H_
+#define _MIXKERNELS_H_ 1
+
+#include <stddef.h>
+#include <rt_types.h>
+
+// Kernels which sum one channel of an interleaved instrument output buffer
+// into a (mono) bus buffer:
+//
+//    for (n = 0; n < frames; ++n) dest[n] += src[n * srcChans];
+//
+// This is done for every instrument on every buffer, so we keep a table of
+// kernels specialized for the common channel counts.  The table starts out
+// holding portable scalar versions, and is upgraded once at load time to
+// SSE, AVX or NEON versions according to what the CPU supports.  Every
+// variant performs the same single add per sample, so results are identical.
+
+typedef void (*MixKernel)(BufPtr dest, const BUFTYPE *src, int frames);
+
+#define MIX_KERNEL_MAX_CHANS 8
+
+extern MixKernel gMixKernels[MIX_KERNEL_MAX_CHANS + 1];	// NULL for uncommon counts
+
+void mixKernelGeneric(BufPtr dest, const BUFTYPE *src, int frames, int srcChans);
+
+// Returns a short description of the instruction set selected ("SSE", etc.)
+const char *mixKernelName();
+
+inline void mixIntoBus(BufPtr dest, const BUFTYPE *src, int frames, int srcChans)
+{
+	MixKernel kernel = (srcChans <= MIX_KERNEL_MAX_CHANS) ? gMixKernels[srcChans] : NULL;
+	if (kernel)
+		(*kernel)(dest, src, frames);
+	else
+		mixKernelGeneric(dest, src, frames, srcChans);
+}
+
+// For the first mix into a bus since it was cleared, which can copy instead.
+
+inline void copyIntoBus(BufPtr dest, const BUFTYPE *src, int frames, int srcChans)
+{
+	for (int n = 0; n < frames; ++n, src += srcChans)
+		dest[n] = *src;
+}
+
+#endif	// _MIXKERNELS_H_
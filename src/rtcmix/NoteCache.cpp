@@ -0,0 +1,621 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// NoteCache.cpp -- replay of rendered notes.  See NoteCache.h.
+
+#include "NoteCache.h"
+#include <RTcmix.h>
+#include <Instrument.h>
+#include <PField.h>
+#include <Lockable.h>
+#include <RTOption.h>
+#include "BusSlot.h"
+#include "rt.h"
+#include "rtcmix_types.h"
+#include <ugens.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <new>
+
+#define MAX_CACHED_NOTES	4096	// entries, counting ones not kept
+
+#define NOTE_MAGIC "RTcmxNC"		// 7 chars + NUL
+#define NOTE_VERSION 1
+#define NOTE_BYTE_ORDER 0x01020304
+
+struct NoteHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	byteOrder;
+	uint32_t	keyBytes;	// padded to a multiple of 8
+	uint32_t	frames;
+	uint32_t	chans;
+	float		dur;
+};
+
+typedef std::vector<unsigned long long> NoteKey;
+
+struct CachedNote : public RefCounted {
+	enum { kCapturing, kComplete, kFailed };
+	CachedNote(BusSlot *slot);
+	BUFTYPE *		samples;		// interleaved
+	int				frames;
+	int				chans;
+	float			dur;
+	int				captured;		// frames so far
+	volatile int	state;
+	size_t			bytes;			// counted against the budget
+	unsigned long	lastUse;
+	BusSlot *		busSlot;		// keeps the slot in the key from being reused
+	std::string		diskKey;		// empty if not kept on disk
+	bool			onDisk;			// already in the render cache dir
+protected:
+	virtual ~CachedNote();
+};
+
+CachedNote::CachedNote(BusSlot *slot)
+	: RefCounted(true), samples(NULL), frames(0), chans(0), dur(0.0f),
+	  captured(0), state(kCapturing), bytes(0), lastUse(0), busSlot(slot),
+	  onDisk(false)
+{
+	busSlot->ref();
+}
+
+CachedNote::~CachedNote()
+{
+	delete [] samples;
+	busSlot->unref();
+}
+
+// Plays a cached note: its run() just copies the note's output.
+
+class NoteReplay : public Instrument {
+public:
+	NoteReplay(CachedNote *note) : _note(note) { _note->ref(); }
+	virtual int		init(double p[], int n_args);
+	virtual int		run();
+protected:
+	virtual			~NoteReplay() { _note->unref(); }
+private:
+	CachedNote *	_note;
+};
+
+int NoteReplay::init(double p[], int n_args)
+{
+	if (rtsetoutput(p[0], _note->dur, this) == -1)
+		return DONT_SCHEDULE;
+	return nSamps();
+}
+
+int NoteReplay::run()
+{
+	const int frames = framesToRun();
+	const int chans = outputChannels();
+	int held = _note->frames - currentFrame();
+	if (held > frames)
+		held = frames;
+	if (held > 0)
+		rtbaddout(_note->samples + (long) currentFrame() * chans, held);
+	if (held < frames) {	// an aligned block past the end
+		const int start = (held > 0) ? held : 0;
+		for (int ch = 0; ch < chans; ++ch) {
+			int stride;
+			BUFTYPE *out = outputChannel(ch, &stride);
+			for (int n = start; n < frames; ++n)
+				out[(n - start) * stride] = 0.0f;
+		}
+	}
+	increment(frames);
+	return frames;
+}
+
+typedef std::map<NoteKey, CachedNote *> NoteMap;
+
+static NoteMap sNotes;
+static Lockable sNotesLock;
+static size_t sNotesBytes = 0;
+static unsigned long sUseCount = 0;
+
+static size_t cacheLimit()
+{
+	const int megabytes = RTOption::noteCacheMB();
+	return (megabytes > 0) ? (size_t) megabytes << 20 : 0;
+}
+
+static unsigned long long hashBytes(const void *data, size_t len)
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	unsigned long long hash = 14695981039346656037ULL;
+	for (size_t n = 0; n < len; ++n)
+		hash = (hash ^ bytes[n]) * 1099511628211ULL;
+	return hash;
+}
+
+static inline unsigned long long bitsOf(double value)
+{
+	unsigned long long bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+// Describe the note in <arglist>, all but its start time, in <key>.  Returns
+// false if the note has pfields that can change while it plays.
+
+static bool makeKey(rt_item *item, const Arg arglist[], int nargs, NoteKey *key)
+{
+	if (nargs < 1 || !arglist[0].isType(DoubleType))
+		return false;
+	key->push_back((uintptr_t) item);
+	BusSlot *slot = RTcmix::get_bus_config(item->rt_name);
+	key->push_back((uintptr_t) slot);
+	RefCounted::unref(slot);	// a note cached under this key holds its own
+	const int inputIndex = RTcmix::get_last_input_index();
+	key->push_back((unsigned long long) (long long) inputIndex);
+	const char *inputPath = (inputIndex >= 0) ? RTcmix::getInputPath(inputIndex) : NULL;
+	key->push_back((inputPath != NULL) ? hashBytes(inputPath, strlen(inputPath)) : 0);
+	key->push_back(bitsOf(RTcmix::sr()));
+	key->push_back(nargs);
+	for (int arg = 1; arg < nargs; ++arg) {
+		const Arg &theArg = arglist[arg];
+		key->push_back(theArg.type());
+		switch (theArg.type()) {
+		case DoubleType:
+			key->push_back(bitsOf((double) theArg));
+			break;
+		case StringType:
+		{
+			const char *string = theArg.string();
+			key->push_back((string != NULL) ? hashBytes(string, strlen(string)) : 0);
+			break;
+		}
+		case ArrayType:
+		{
+			const Array *array = (Array *) theArg;
+			key->push_back(array->len);
+			key->push_back(hashBytes(array->data, array->len * sizeof(double)));
+			break;
+		}
+		case HandleType:
+		{
+			// Tables and constants are fixed; anything else may not be.
+			PField *pfield = (PField *) theArg;
+			if (pfield == NULL || (dynamic_cast<TablePField *>(pfield) == NULL
+								   && dynamic_cast<ConstPField *>(pfield) == NULL))
+				return false;
+			key->push_back((uintptr_t) pfield);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+// The on-disk cache.  Pointers mean nothing to a later run, so its key
+// describes the note by content: the instrument and the file it came from,
+// the buses, the input file, and the values in its tables.  The key is
+// stored in the note's file, which is named by a hash of it.
+
+static void addBytes(std::string *key, const void *data, size_t len)
+{
+	key->append((const char *) data, len);
+}
+
+static void addWord(std::string *key, unsigned long long word)
+{
+	addBytes(key, &word, sizeof(word));
+}
+
+static void addString(std::string *key, const char *string)
+{
+	if (string != NULL)
+		addBytes(key, string, strlen(string));
+	addBytes(key, "", 1);
+}
+
+// A file's name, size and modification time.
+
+static void addFile(std::string *key, const char *path)
+{
+	struct stat st;
+	addString(key, path);
+	if (path != NULL && stat(path, &st) == 0) {
+		addWord(key, st.st_size);
+		addWord(key, st.st_mtime);
+	}
+}
+
+static void addBuses(std::string *key, const short *buses, int count)
+{
+	addWord(key, count);
+	addBytes(key, buses, count * sizeof(short));
+}
+
+static bool makeDiskKey(rt_item *item, const Arg arglist[], int nargs, std::string *key)
+{
+	addString(key, item->rt_name);
+	Dl_info info;
+	addFile(key, dladdr((void *) item->rt_ptr, &info) ? info.dli_fname : NULL);
+	BusSlot *slot = RTcmix::get_bus_config(item->rt_name);
+	addBuses(key, slot->in, slot->in_count);
+	addBuses(key, slot->out, slot->out_count);
+	addBuses(key, slot->auxin, slot->auxin_count);
+	addBuses(key, slot->auxout, slot->auxout_count);
+	slot->unref();
+	const int inputIndex = RTcmix::get_last_input_index();
+	addFile(key, (inputIndex >= 0) ? RTcmix::getInputPath(inputIndex) : NULL);
+	addWord(key, bitsOf(RTcmix::sr()));
+	addWord(key, nargs);
+	for (int arg = 1; arg < nargs; ++arg) {
+		const Arg &theArg = arglist[arg];
+		addWord(key, theArg.type());
+		switch (theArg.type()) {
+		case DoubleType:
+			addWord(key, bitsOf((double) theArg));
+			break;
+		case StringType:
+			addString(key, theArg.string());
+			break;
+		case ArrayType:
+		{
+			const Array *array = (Array *) theArg;
+			addWord(key, array->len);
+			addWord(key, hashBytes(array->data, array->len * sizeof(double)));
+			break;
+		}
+		case HandleType:
+		{
+			PField *pfield = (PField *) theArg;
+			TablePField *table = dynamic_cast<TablePField *>(pfield);
+			if (table != NULL) {
+				const int len = table->values();
+				addWord(key, len);
+				addWord(key, table->mipmap() != NULL);
+				if (table->floatArray() != NULL)
+					addWord(key, hashBytes(table->floatArray(), len * sizeof(float)));
+				else
+					addWord(key, hashBytes((double *) *table, len * sizeof(double)));
+			}
+			else if (dynamic_cast<ConstPField *>(pfield) != NULL)
+				addWord(key, bitsOf(pfield->doubleValue(0)));
+			else
+				return false;
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	key->resize((key->size() + 7) & ~(size_t) 7, '\0');
+	return true;
+}
+
+static std::string notePath(const std::string &key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.note", hashBytes(key.data(), key.size()));
+	return std::string(RTOption::renderCacheDir()) + name;
+}
+
+static bool readAll(int fd, void *buf, size_t size)
+{
+	char *ptr = (char *) buf;
+	while (size > 0) {
+		ssize_t n = read(fd, ptr, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool writeAll(int fd, const void *buf, size_t size)
+{
+	const char *ptr = (const char *) buf;
+	while (size > 0) {
+		ssize_t n = write(fd, ptr, size);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+// Return the complete note in the file for <key>, with one reference, or
+// NULL if there is none.
+
+static CachedNote *loadNote(const std::string &key, BusSlot *slot)
+{
+	const int fd = open(notePath(key).c_str(), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	NoteHeader header;
+	std::string storedKey(key.size(), '\0');
+	CachedNote *note = NULL;
+	if (readAll(fd, &header, sizeof(header))
+			&& memcmp(header.magic, NOTE_MAGIC, sizeof(header.magic)) == 0
+			&& header.version == NOTE_VERSION
+			&& header.byteOrder == NOTE_BYTE_ORDER
+			&& header.keyBytes == key.size()
+			&& readAll(fd, &storedKey[0], key.size())
+			&& storedKey == key) {
+		const size_t samps = (size_t) header.frames * header.chans;
+		BUFTYPE *samples = new (std::nothrow) BUFTYPE[samps];
+		if (samples != NULL && readAll(fd, samples, samps * sizeof(BUFTYPE))) {
+			note = new CachedNote(slot);
+			note->ref();
+			note->samples = samples;
+			note->frames = header.frames;
+			note->chans = header.chans;
+			note->captured = header.frames;
+			note->dur = header.dur;
+			note->bytes = samps * sizeof(BUFTYPE);
+			note->diskKey = key;
+			note->onDisk = true;
+			note->state = CachedNote::kComplete;
+		}
+		else
+			delete [] samples;
+	}
+	close(fd);
+	return note;
+}
+
+// Write <note> to the render cache dir, under a temporary name that is then
+// renamed, so that runs sharing the directory never see a partial file.
+
+static void storeNote(CachedNote *note)
+{
+	static bool warned = false;
+
+	note->onDisk = true;
+	const char *dir = RTOption::renderCacheDir();
+	if (dir[0] == 0)
+		return;
+	mkdir(dir, 0777);
+	const std::string path = notePath(note->diskKey);
+	std::string tmpPath = path + ".XXXXXX";
+	const int fd = mkstemp(&tmpPath[0]);
+	if (fd < 0) {
+		if (!warned)
+			rtcmix_warn("note cache", "Can't write to \"%s\" (%s).", dir, strerror(errno));
+		warned = true;
+		return;
+	}
+	fchmod(fd, 0644);		// mkstemp makes it private
+
+	NoteHeader header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, NOTE_MAGIC);
+	header.version = NOTE_VERSION;
+	header.byteOrder = NOTE_BYTE_ORDER;
+	header.keyBytes = note->diskKey.size();
+	header.frames = note->frames;
+	header.chans = note->chans;
+	header.dur = note->dur;
+
+	const bool ok = writeAll(fd, &header, sizeof(header))
+		&& writeAll(fd, note->diskKey.data(), note->diskKey.size())
+		&& writeAll(fd, note->samples, (size_t) note->frames * note->chans * sizeof(BUFTYPE));
+	if (close(fd) != 0 || !ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+		if (!warned)
+			rtcmix_warn("note cache", "Can't write \"%s\" (%s).", path.c_str(), strerror(errno));
+		warned = true;
+		unlink(tmpPath.c_str());
+	}
+}
+
+// Let go of a note the cache is dropping, first writing it to disk if it
+// belongs there.
+
+static void retire(CachedNote *note)
+{
+	if (note->state == CachedNote::kComplete && !note->onDisk && !note->diskKey.empty())
+		storeNote(note);
+	note->unref();
+}
+
+// Drop entries, least recently used first, until <needed> more bytes fit
+// and there is a free slot.  Notes still being captured stay.  Called with
+// the cache locked.
+
+static void makeRoom(size_t needed, size_t limit)
+{
+	while (sNotesBytes + needed > limit || sNotes.size() >= MAX_CACHED_NOTES) {
+		NoteMap::iterator victim = sNotes.end();
+		for (NoteMap::iterator it = sNotes.begin(); it != sNotes.end(); ++it) {
+			if (it->second->state != CachedNote::kCapturing
+					&& (victim == sNotes.end() || it->second->lastUse < victim->second->lastUse))
+				victim = it;
+		}
+		if (victim == sNotes.end())
+			break;
+		sNotesBytes -= victim->second->bytes;
+		retire(victim->second);
+		sNotes.erase(victim);
+	}
+}
+
+bool NoteCache::enabled()
+{
+	return RTOption::noteCacheMB() > 0;
+}
+
+Instrument *NoteCache::lookup(rt_item *item, const Arg arglist[], int nargs,
+							  CachedNote **capture)
+{
+	*capture = NULL;
+	NoteKey key;
+	if (!makeKey(item, arglist, nargs, &key))
+		return NULL;
+	CachedNote *found = NULL;
+	sNotesLock.lock();
+	NoteMap::iterator it = sNotes.find(key);
+	if (it != sNotes.end()) {
+		CachedNote *note = it->second;
+		note->lastUse = ++sUseCount;
+		if (note->state == CachedNote::kComplete) {
+			found = note;
+			found->ref();
+		}
+		else if (note->state == CachedNote::kFailed && note->samples != NULL) {
+			// No one else uses the samples of a note that was not kept.
+			delete [] note->samples;
+			note->samples = NULL;
+			sNotesBytes -= note->bytes;
+			note->bytes = 0;
+		}
+	}
+	else {
+		BusSlot *slot = RTcmix::get_bus_config(item->rt_name);
+		std::string diskKey;
+		CachedNote *loaded = NULL;
+		if (RTOption::renderCacheDir()[0] != 0) {
+			// Look for the note on disk without holding up other lookups.
+			sNotesLock.unlock();
+			if (makeDiskKey(item, arglist, nargs, &diskKey))
+				loaded = loadNote(diskKey, slot);
+			else
+				diskKey.clear();
+			sNotesLock.lock();
+		}
+		const size_t limit = cacheLimit();
+		bool fits = false;
+		if (sNotes.find(key) != sNotes.end()) {
+			// Someone else added it meanwhile; just render this note.
+			if (loaded != NULL)
+				loaded->unref();
+			loaded = NULL;
+		}
+		else if (loaded != NULL && loaded->bytes <= limit) {
+			makeRoom(loaded->bytes, limit);
+			fits = (sNotesBytes + loaded->bytes <= limit);
+		}
+		if (fits) {
+			loaded->lastUse = ++sUseCount;
+			sNotes[key] = loaded;		// takes over its reference
+			sNotesBytes += loaded->bytes;
+			found = loaded;
+			found->ref();
+		}
+		else if (sNotes.find(key) == sNotes.end()) {
+			if (loaded != NULL)
+				loaded->unref();
+			makeRoom(0, limit);
+			CachedNote *note = new CachedNote(slot);
+			note->ref();				// for the cache
+			note->ref();				// for the caller
+			note->lastUse = ++sUseCount;
+			note->diskKey = diskKey;
+			sNotes[key] = note;
+			*capture = note;
+		}
+		slot->unref();				// the notes made here hold their own
+	}
+	sNotesLock.unlock();
+	if (found == NULL)
+		return NULL;
+	NoteReplay *replay = NULL;
+	try {
+		replay = new NoteReplay(found);
+	}
+	catch (std::bad_alloc &) {
+		found->unref();
+		throw;
+	}
+	found->unref();
+	replay->ref();
+	replay->set_bus_config(item->rt_name);
+	return replay;
+}
+
+void NoteCache::beginCapture(CachedNote *note, Instrument *inst, const Arg arglist[])
+{
+	bool cacheable = (inst != NULL && inst->_allowNoteCache && inst->my_pfbus == -1
+					  && inst->getstart() == (float) (double) arglist[0]
+					  && inst->_busSlot->auxin_count == 0);
+	if (cacheable && inst->_busSlot->in_count > 0)
+		cacheable = inst->_input.fdIndex >= 0
+					&& !RTcmix::isInputAudioDevice(inst->_input.fdIndex);
+	const size_t bytes = cacheable ? (size_t) inst->nSamps() * inst->outputChannels() * sizeof(BUFTYPE) : 0;
+	const size_t limit = cacheLimit();
+	sNotesLock.lock();
+	if (cacheable && bytes > 0 && bytes <= limit) {
+		makeRoom(bytes, limit);
+		if (sNotesBytes + bytes <= limit)
+			note->samples = new (std::nothrow) BUFTYPE[bytes / sizeof(BUFTYPE)];
+	}
+	if (note->samples != NULL) {
+		note->frames = inst->nSamps();
+		note->chans = inst->outputChannels();
+		note->dur = inst->getdur();
+		note->bytes = bytes;
+		sNotesBytes += bytes;
+		inst->_noteCapture = note;		// takes over our reference
+	}
+	else {
+		note->state = CachedNote::kFailed;
+		note->unref();
+	}
+	sNotesLock.unlock();
+}
+
+void NoteCache::capture(CachedNote *note, const Instrument *inst)
+{
+	int frames = inst->framesToRun();
+	if (frames > note->frames - note->captured)
+		frames = note->frames - note->captured;
+	const int chans = note->chans;
+	BUFTYPE *dest = note->samples + (long) note->captured * chans;
+	if (inst->_planarOutput) {
+		for (int ch = 0; ch < chans; ++ch) {
+			const BUFTYPE *src = inst->outbuf + ch * inst->_planeFrames;
+			for (int n = 0; n < frames; ++n)
+				dest[n * chans + ch] = src[n];
+		}
+	}
+	else
+		memcpy(dest, inst->outbuf, frames * chans * sizeof(BUFTYPE));
+	note->captured += frames;
+}
+
+void NoteCache::endCapture(CachedNote *note)
+{
+	__sync_synchronize();		// the samples before the state
+	note->state = (note->captured == note->frames) ? CachedNote::kComplete
+												   : CachedNote::kFailed;
+	note->unref();
+}
+
+bool NoteCache::describe(rt_item *item, const Arg arglist[], int nargs, std::string *key)
+{
+	return nargs >= 1 && makeDiskKey(item, arglist, nargs, key);
+}
+
+void NoteCache::purge()
+{
+	sNotesLock.lock();
+	for (NoteMap::iterator it = sNotes.begin(); it != sNotes.end(); ++it)
+		retire(it->second);
+	sNotes.clear();
+	sNotesBytes = 0;
+	sNotesLock.unlock();
+}
@@ -0,0 +1,76 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _NOTECACHE_H_
+#define _NOTECACHE_H_ 1
+
+#include <string>
+
+struct rt_item;
+struct Arg;
+struct CachedNote;
+class Instrument;
+
+// Rendered notes, kept so that a later note just like one of them replays
+// its output instead of computing it again.  Algorithmic scores often play
+// the same drum hit, pluck or grain hundreds of times.
+//
+// With the note_cache_mb option above 0, RTcmix::startInst() asks lookup()
+// about each note.  Two notes are alike when they are for the same
+// instrument and bus config, with the same rtinput file current, and have
+// the same pfields after the start time: equal numbers and strings, lists
+// with the same contents, and the very same tables.  A note with any other
+// kind of PField -- one that changes while it plays -- or an instrument
+// handle is never cached.
+//
+// The first note of its kind is made as usual, and, if its instrument
+// called Instrument::allowNoteCache() in init(), its output is copied into
+// the cache as it plays.  Once it has played to its end, the notes like it
+// are made as a small instrument that just copies that output into its
+// outbuf, to be mixed into the buses the same way.  Notes that end early (a
+// silent tail, bus_link) are not kept.  Only instruments whose output
+// depends on nothing but their pfields and input file should allow caching:
+// nothing random, and no makegen tables, which the cache cannot see change.
+//
+// The memory held is bounded by note_cache_mb; the least recently replayed
+// notes are dropped to make room.  A dropped note lives on until the last
+// note replaying it is done.
+//
+// With the render_cache_dir option also set, notes are kept in that
+// directory when they are dropped and at the end of the run, and a note not
+// in memory is looked for there.  Re-rendering an edited score then renders
+// only the notes that changed (and the ones that can't be cached, such as
+// reverbs reading aux buses), mixing the rest from disk.  That key can't use
+// addresses, so it holds the instrument's file, the input file, and the
+// values in tables, with the size and time of each file.
+
+class NoteCache {
+public:
+	static bool			enabled();
+
+	// For the note in <arglist>: if one like it is in the cache, return an
+	// instrument (with one reference, and its bus config set) that replays
+	// it.  Otherwise return NULL, having set <*capture> to the entry the
+	// note should be rendered into, or to NULL if it should not be.
+	static Instrument *	lookup(rt_item *item, const Arg arglist[], int nargs,
+							   CachedNote **capture);
+	// After setup() of the note given <capture> by lookup(), have <inst>
+	// render into it -- or give up on it if <inst> is NULL (setup failed)
+	// or cannot be cached.
+	static void			beginCapture(CachedNote *capture, Instrument *inst,
+									 const Arg arglist[]);
+	// Called by the Instrument after each run(), and when it is destroyed.
+	static void			capture(CachedNote *note, const Instrument *inst);
+	static void			endCapture(CachedNote *note);
+
+	static void			purge();		// drop every note
+
+	// Describe the note in <arglist>, all but its start time, by content, in
+	// <key>, as the render cache does.  Returns false if it has pfields that
+	// can change while it plays.
+	static bool			describe(rt_item *item, const Arg arglist[], int nargs,
+								 std::string *key);
+};
+
+#endif	// _NOTECACHE_H_
@@ -0,0 +1,81 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// NoteSetup.cpp -- setting up a score's notes in parallel.  See NoteSetup.h.
+
+#include "NoteSetup.h"
+#include <RTcmix.h>
+#include <RTOption.h>
+#include <Instrument.h>
+#include "NoteCache.h"
+#include "BusFreeze.h"
+#include <vector>
+#ifdef MULTI_THREAD
+#include "TaskManager.h"
+#endif
+
+#define SETUP_BATCH 1024	// notes held before they are set up anyway
+
+struct PendingNote {
+	Instrument *	inst;
+	PFieldSet *		pfields;
+	int				status;
+	int				setup() { status = inst->setup(pfields); return status; }
+};
+
+int NoteSetup::sCount = 0;
+
+static std::vector<PendingNote> sNotes;
+static std::vector<PendingNote *> sTasks;
+
+bool NoteSetup::enabled()
+{
+#ifdef MULTI_THREAD
+	return RTOption::parallelSetup() && !RTcmix::interactive()
+		&& !RTcmix::parsingAhead() && !NoteCache::enabled()
+		&& !BusFreeze::active();
+#else
+	return false;
+#endif
+}
+
+void NoteSetup::defer(Instrument *inInst, PFieldSet *inPFields)
+{
+	PendingNote note;
+	note.inst = inInst;
+	note.pfields = inPFields;
+	note.status = 0;
+	sNotes.push_back(note);
+	sCount = (int) sNotes.size();
+	if (sCount >= SETUP_BATCH)
+		flush();
+}
+
+void NoteSetup::flush()
+{
+	if (sNotes.empty())
+		return;
+#ifdef MULTI_THREAD
+	if (sNotes.size() > 1) {
+		for (size_t n = 0; n < sNotes.size(); ++n) {
+			sTasks.push_back(&sNotes[n]);
+			RTcmix::taskManager->addTask<PendingNote, int, &PendingNote::setup>(&sNotes[n]);
+		}
+		RTcmix::taskManager->waitForTasks(sTasks);
+		sTasks.clear();
+	}
+	else
+#endif
+		sNotes[0].setup();
+
+	for (size_t n = 0; n < sNotes.size(); ++n) {
+		Instrument *inst = sNotes[n].inst;
+		if (sNotes[n].status >= 0)
+			inst->schedule(RTcmix::rtHeap);
+		else
+			inst->unref();
+	}
+	sNotes.clear();
+	sCount = 0;
+}
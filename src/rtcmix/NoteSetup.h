@@ -0,0 +1,47 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _NOTESETUP_H_
+#define _NOTESETUP_H_ 1
+
+class Instrument;
+class PFieldSet;
+
+// With the parallel_setup option, the notes of a non-interactive score are
+// set up in batches, on the TaskManager threads, instead of one at a time as
+// the parser makes them.  Scores that make thousands of notes with costly
+// init()s -- filter designs, wavetables, analysis files -- spend most of
+// their load time there, and the audio loop is not running yet to use the
+// threads.
+//
+// RTcmix::startInst() still makes the instrument and loads its pfields, and
+// returns its handle as usual, but hands it here instead of calling setup().
+// flush() sets up the notes held, schedules those that succeed in the order
+// they were made, and drops the rest.  It is called before any script
+// function that does not return a handle -- rtinput, makegen, bus_config,
+// srand and the like change what a later init() sees -- and before the
+// audio loop starts, so each note is set up with the state it was made in.
+// What init() reads or changes of its own (statics of the instrument, the
+// random number generators) it may see in another order, which is why this
+// is an option.
+//
+// Notes are held only when the score is not interactive or parsed while it
+// plays, and neither the note cache nor bus_freeze, which look at each note
+// as it is set up, is in use.
+
+class NoteSetup {
+public:
+	// Whether startInst() should hand its notes to defer().
+	static bool		enabled();
+	// Hold <inInst>, with the reference startInst() made, and <inPFields>
+	// until the next flush().
+	static void		defer(Instrument *inInst, PFieldSet *inPFields);
+	// Set up and schedule every note held.
+	static void		flush();
+	static bool		pending() { return sCount > 0; }
+private:
+	static int		sCount;
+};
+
+#endif	// _NOTESETUP_H_
@@ -1,12 +1,207 @@
+/* RTcmix - Copyright (C) 2004  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
 #include <PFBusData.h>
+#include "ControlTable.h"
+#include <assert.h>
+
+#define CACHE_LINE 64
+
+// <state> is twice the number of draws published, plus one while one is
+// being written.  <value> has a state of its own, as readers write it.
+
+struct PFBus {
+	volatile unsigned	state;
+	volatile unsigned	step;		// reads with no frame since the draw began
+	PField * volatile	pfield;
+	volatile double		incr;
+	volatile FRAMETYPE	startFrame;
+	volatile int		frames;
+	volatile unsigned	valueState;
+	volatile double		value;
+	volatile int		drawing;
+	volatile int		dequeue;
+	volatile int		connected;
+	volatile int		dqNow;
+} __attribute__((aligned(CACHE_LINE)));
+
+static PFBus sBus[NPFBUSSES];
 
-int PFBusData::drawflag[NPFBUSSES];
-PField *PFBusData::thepfield[NPFBUSSES];
-double PFBusData::val[NPFBUSSES];
-double PFBusData::percent[NPFBUSSES];
-double PFBusData::theincr[NPFBUSSES];
-int PFBusData::dqflag[NPFBUSSES];
-int PFBusData::pfbus_is_connected[NPFBUSSES];
-int PFBusData::dq_now[NPFBUSSES];
 int PFBusData::connect_val = -1;
 
+static inline PFBus &
+getBus(int bus)
+{
+	assert(bus >= 0 && bus < NPFBUSSES);
+	return sBus[bus];
+}
+
+// Mark <state> busy, and return its value before.
+
+static unsigned
+lockState(volatile unsigned &state)
+{
+	unsigned was;
+	do {
+		was = state & ~1U;
+	} while (!__sync_bool_compare_and_swap(&state, was, was + 1));
+	return was;
+}
+
+// The same, but only if <state> is still <was>.
+
+static inline bool
+lockStateIf(volatile unsigned &state, unsigned was)
+{
+	return __sync_bool_compare_and_swap(&state, was, was + 1);
+}
+
+static inline void
+unlockState(volatile unsigned &state, unsigned was)
+{
+	__sync_synchronize();
+	state = was + 2;
+}
+
+static void
+writeValue(PFBus &b, double value)
+{
+	const unsigned was = lockState(b.valueState);
+	b.value = value;
+	unlockState(b.valueState, was);
+}
+
+static double
+readValue(const PFBus &b)
+{
+	unsigned state;
+	double value;
+	do {
+		state = b.valueState;
+		__sync_synchronize();
+		value = b.value;
+		__sync_synchronize();
+	} while ((state & 1) || b.valueState != state);
+	return value;
+}
+
+void PFBusData::connect(int bus, double defaultval)
+{
+	PFBus &b = getBus(bus);
+	writeValue(b, defaultval);
+	const unsigned was = lockState(b.state);
+	b.dequeue = 0;
+	unlockState(b.state, was);
+	b.dqNow = 0;
+	__sync_synchronize();
+	b.connected = 1;
+}
+
+bool PFBusData::isConnected(int bus)
+{
+	return getBus(bus).connected == 1;
+}
+
+void PFBusData::startDraw(int bus, PField *pfield, FRAMETYPE startFrame,
+						   int frames, double incr, bool dequeue)
+{
+	PFBus &b = getBus(bus);
+	const unsigned was = lockState(b.state);
+	b.pfield = pfield;
+	b.incr = incr;
+	b.startFrame = startFrame;
+	b.frames = (frames > 0) ? frames : 1;
+	b.dequeue = dequeue;
+	b.step = 0;
+	b.drawing = 1;
+	b.dqNow = 0;
+	unlockState(b.state, was);
+}
+
+double PFBusData::read(int bus)
+{
+	PFBus &b = getBus(bus);
+	const FRAMETYPE frame = ControlTable::renderFrame();
+	unsigned state, step = 0;
+	int drawing, dequeue, frames;
+	const PField *pfield;
+	double incr;
+	FRAMETYPE startFrame;
+	do {
+		state = b.state;
+		__sync_synchronize();
+		drawing = b.drawing;
+		dequeue = b.dequeue;
+		pfield = b.pfield;
+		incr = b.incr;
+		startFrame = b.startFrame;
+		frames = b.frames;
+		if (drawing && frame < 0)
+			step = __sync_fetch_and_add(&b.step, 1);
+		__sync_synchronize();
+	} while ((state & 1) || b.state != state);
+
+	if (!drawing)
+		return readValue(b);	// continue to read last value
+
+	double pct;
+	bool last;
+	if (frame >= 0) {
+		if (frame < startFrame)
+			return readValue(b);	// not yet
+		pct = (frame - startFrame) / (double) frames;
+		last = (frame + 1 - startFrame >= frames);
+	}
+	else {
+		// the increment is set up in the PFSCHED instrument to cover the
+		// appropriate duration of the PField
+		pct = step * incr;
+		if (pct >= 1.0)
+			return readValue(b);
+		last = ((step + 1) * incr >= 1.0);
+	}
+
+	double value;
+	if (!last)
+		value = pfield->doubleValue(pct);
+	else {
+		value = pfield->doubleValue(1.0);
+		// PField end, and dequeue is set, signal Instrument.cpp to de-queue
+		if (dequeue) {
+			// Unless another PFSCHED has started on the bus since.
+			if (lockStateIf(b.state, state)) {
+				b.drawing = 0;
+				unlockState(b.state, state);
+				b.dqNow = 1;
+				b.connected = 0;
+			}
+		}
+	}
+	writeValue(b, value);
+	return value;
+}
+
+double PFBusData::value(int bus)
+{
+	return readValue(getBus(bus));
+}
+
+bool PFBusData::dequeueNow(int bus)
+{
+	return getBus(bus).dqNow == 1;
+}
+
+FRAMETYPE PFBusData::dequeueFrame(int bus)
+{
+	const PFBus &b = getBus(bus);
+	unsigned state;
+	FRAMETYPE frame;
+	do {
+		state = b.state;
+		__sync_synchronize();
+		frame = (b.dequeue && b.startFrame >= 0) ? b.startFrame + b.frames : -1;
+		__sync_synchronize();
+	} while ((state & 1) || b.state != state);
+	return frame;
+}
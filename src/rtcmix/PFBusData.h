@@ -8,23 +8,54 @@
 
 	Brad Garton, 12/2012
 */
+#ifndef _PFBUSDATA_H_
+#define _PFBUSDATA_H_ 1
 
 #define NPFBUSSES 1024
 
 #include <PField.h>
+#include <rt_types.h>
+
+// Each bus has a cache line of its own, so that PFSCHED notes and the
+// PFBusPFields reading them on different threads do not slow one another.
+// Nothing blocks.  A PFSCHED publishes the PField to draw (and how fast to
+// draw it) all at once, and a reader that catches it half-written reads it
+// again, as ControlTable does.
+//
+// A draw is stamped with the output frames it covers.  A reader that knows
+// the frame it is reading for (see ControlTable::renderFrame()) reads the
+// PField at that frame, so the change lands on the frame it was scheduled
+// for, whatever the control rate and whichever thread is reading.  Other
+// reads take the next step through the PField, so any number of readers can
+// share one bus.
 
 class PFBusData {
 public:
-	PFBusData() {};
-	~PFBusData() {};
-
-	static int drawflag[];
-	static PField *thepfield[];
-	static double val[];
-	static double percent[];
-	static double theincr[];
-	static int dqflag[];
-	static int pfbus_is_connected[];
-	static int dq_now[];
+	// For the PFBusPField reading <bus>: connect it, holding <defaultval>.
+	static void		connect(int bus, double defaultval);
+	static bool		isConnected(int bus);
+
+	// For PFSCHED: draw <pfield> on <bus> over the <frames> output frames
+	// from <startFrame>, or for reads with no frame, moving <incr> of the way
+	// through it with every read.  If <dequeue>, the bus disconnects at the
+	// end, and the Instruments linked to it with bus_link() stop there.
+	// <pfield> must already be referenced, as it will be read after the note
+	// is gone.
+	static void		startDraw(int bus, PField *pfield, FRAMETYPE startFrame,
+							  int frames, double incr, bool dequeue);
+
+	// For PFBusPField: the value of the PField being drawn, at the frame
+	// being read for or the next step, or the last value, if there is none.
+	static double	read(int bus);
+	// The last value read, without stepping.
+	static double	value(int bus);
+
+	// For the Instruments linked to <bus>: whether to stop, and the output
+	// frame at which to stop, or -1 if the bus is not set to dequeue.
+	static bool		dequeueNow(int bus);
+	static FRAMETYPE	dequeueFrame(int bus);
+
 	static int connect_val; // for the bus_link() thing
 };
+
+#endif	// _PFBUSDATA_H_
@@ -10,16 +10,24 @@
 #include <float.h>
 #include <Ougens.h>
 #include "Functor.h"
+#include "WorkerPool.h"
+#include "MemStats.h"
+#include "utils.h"
 #include <ugens.h>
+#include <pthread.h>
 
 #undef DEBUG_PFIELD	/* local debugging */
 
 inline int max(int x, int y) { return (x >= y) ? x : y; }
 inline int min(int x, int y) { return (x < y) ? x : y; }
 
+// fillBlock() works through long blocks in pieces of this many values, so
+// that PFields built on others can keep their operands on the stack.
+#define FILL_CHUNK 256
+
 // PField
 
-PField::PField()
+PField::PField(bool dispatchOnDelete) : RefCounted(dispatchOnDelete)
 {
 #if defined(DEBUG_PFIELD) || defined(DEBUG_MEMORY)
 	rtcmix_print("PField:PField(this = %p)\n", this);
@@ -66,6 +74,13 @@ int PField::copyValues(double *array) const
 	return len;
 }
 
+void PField::fillBlock(double *out, int nframes, double startPct,
+					   double pctIncr) const
+{
+	for (int n = 0; n < nframes; ++n)
+		out[n] = doubleValue(startPct + n * pctIncr);
+}
+
 // SingleValuePField
 
 double SingleValuePField::doubleValue(double) const
@@ -79,6 +94,13 @@ ConstPField::ConstPField(double value) : SingleValuePField(value) {}
 
 ConstPField::~ConstPField() {}
 
+void ConstPField::fillBlock(double *out, int nframes, double, double) const
+{
+	const double value = SingleValuePField::doubleValue(0.0);
+	for (int n = 0; n < nframes; ++n)
+		out[n] = value;
+}
+
 
 // StringPField
 
@@ -110,6 +132,16 @@ RTNumberPField::RTNumberPField(double value) : SingleValuePField(value) {}
 
 double RTNumberPField::set(double value) { return setValue(value); }
 
+// The value is read once, so the block is consistent even if another
+// thread sets it meanwhile.
+
+void RTNumberPField::fillBlock(double *out, int nframes, double, double) const
+{
+	const double value = SingleValuePField::doubleValue(0.0);
+	for (int n = 0; n < nframes; ++n)
+		out[n] = value;
+}
+
 // PFieldBinaryOperator
 
 PFieldBinaryOperator::PFieldBinaryOperator(PField *pf1, PField *pf2,
@@ -126,6 +158,21 @@ PFieldBinaryOperator::~PFieldBinaryOperator()
 	_pfield1->unref();
 }
 
+PField::Variation PFieldBinaryOperator::variation() const
+{
+	const Variation v1 = _pfield1->variation();
+	const Variation v2 = _pfield2->variation();
+	return (v1 > v2) ? v1 : v2;
+}
+
+// A note can wait on only one bus, so a PField reading two gives the first.
+
+int PFieldBinaryOperator::auxBus() const
+{
+	const int bus = _pfield1->auxBus();
+	return (bus >= 0) ? bus : _pfield2->auxBus();
+}
+
 double PFieldBinaryOperator::doubleValue(int indx) const
 {
 	const int rindx = min(indx, values() - 1);
@@ -137,6 +184,38 @@ double PFieldBinaryOperator::doubleValue(double frac) const
 	return (*_operator)(_pfield1->doubleValue(frac), _pfield2->doubleValue(frac));
 }
 
+// Fill <out> from the two operands, combining them with <combine>, which
+// may be a function pointer or (for Add and Mult) an inlined functor.
+
+template <class Combine>
+static void fillBinary(const PField *pf1, const PField *pf2, Combine combine,
+					   double *out, int nframes, double startPct, double pctIncr)
+{
+	double operand[FILL_CHUNK];
+	for (int done = 0; done < nframes; done += FILL_CHUNK) {
+		const int count = min(nframes - done, FILL_CHUNK);
+		const double pct = startPct + done * pctIncr;
+		pf1->fillBlock(&out[done], count, pct, pctIncr);
+		pf2->fillBlock(operand, count, pct, pctIncr);
+		for (int n = 0; n < count; ++n)
+			out[done + n] = combine(out[done + n], operand[n]);
+	}
+}
+
+struct AddValues {
+	double operator () (double x, double y) const { return x + y; }
+};
+
+struct MultValues {
+	double operator () (double x, double y) const { return x * y; }
+};
+
+void PFieldBinaryOperator::fillBlock(double *out, int nframes, double startPct,
+									 double pctIncr) const
+{
+	fillBinary(_pfield1, _pfield2, _operator, out, nframes, startPct, pctIncr);
+}
+
 int PFieldBinaryOperator::values() const
 {
 	const int len1 = _pfield1->values();
@@ -188,6 +267,20 @@ int PFieldBinaryOperator::copyValues(double *array) const
 	}
 }
 
+// AddPField, MultPField
+
+void AddPField::fillBlock(double *out, int nframes, double startPct,
+						  double pctIncr) const
+{
+	fillBinary(leftField(), rightField(), AddValues(), out, nframes, startPct, pctIncr);
+}
+
+void MultPField::fillBlock(double *out, int nframes, double startPct,
+						   double pctIncr) const
+{
+	fillBinary(leftField(), rightField(), MultValues(), out, nframes, startPct, pctIncr);
+}
+
 // LFOPField
 
 LFOPField::LFOPField(double krate, TablePField *tablePField,
@@ -226,6 +319,33 @@ double LFOPField::doubleValue(double percent) const
 	return (*_interpolator)(_oscil);
 }
 
+// The frequencies come from one block fill, rather than a call per value.
+
+void LFOPField::fillBlock(double *out, int nframes, double startPct,
+						  double pctIncr) const
+{
+	double freq[FILL_CHUNK];
+	for (int done = 0; done < nframes; done += FILL_CHUNK) {
+		const int count = min(nframes - done, FILL_CHUNK);
+		const double pct = startPct + done * pctIncr;
+		// Percentages past the end are clamped, as in doubleValue().
+		int unclamped = count;
+		if (pct + (count - 1) * pctIncr > 1.0)
+			for (unclamped = 0; unclamped < count && pct + unclamped * pctIncr <= 1.0; )
+				++unclamped;
+		_freqPF->fillBlock(freq, unclamped, pct, pctIncr);
+		if (unclamped < count) {
+			const double lastFreq = _freqPF->doubleValue(1.0);
+			for (int n = unclamped; n < count; ++n)
+				freq[n] = lastFreq;
+		}
+		for (int n = 0; n < count; ++n) {
+			_oscil->setfreq(freq[n]);
+			out[done + n] = (*_interpolator)(_oscil);
+		}
+	}
+}
+
 // RandomPField
 
 #include <Random.h>
@@ -271,46 +391,224 @@ double RandomPField::doubleValue(double percent) const
 TablePField::TablePField(double *tableArray,
 						 int length,
 						 TablePField::InterpFunction ifun)
-	: _table(tableArray), _len(length), _interpolator(ifun)
+	: PField(true), _table(tableArray), _len(length), _interpolator(ifun),
+	  _generator(NULL), _floatTable(NULL), _mipmap(NULL),
+	  _lease(NULL), _tableLent(false), _drawn(NULL), _nextDrawn(NULL)
 {
+	if (_table != NULL)
+		MemStats::add(MemStats::kTables, _len * sizeof(double));
+}
+
+TablePField::TablePField(TableGenerator *generator,
+						 int length,
+						 TablePField::InterpFunction ifun)
+	: PField(true), _table(NULL), _len(length), _interpolator(ifun),
+	  _generator(generator), _floatTable(NULL), _mipmap(NULL),
+	  _lease(NULL), _tableLent(false), _drawn(NULL), _nextDrawn(NULL)
+{
+}
+
+TablePField::TablePField(float *tableArray,
+						 int length,
+						 TablePField::InterpFunction ifun)
+	: PField(true), _table(NULL), _len(length), _interpolator(ifun),
+	  _generator(NULL), _floatTable(tableArray), _mipmap(NULL),
+	  _lease(NULL), _tableLent(false), _drawn(NULL), _nextDrawn(NULL)
+{
+	if (_floatTable != NULL)
+		MemStats::add(MemStats::kTables, _len * sizeof(float));
+}
+
+TablePField::TablePField(const double *tableArray,
+						 int length,
+						 struct _arraylease *lease,
+						 TablePField::InterpFunction ifun)
+	: PField(true), _table((double *) tableArray), _len(length),
+	  _interpolator(ifun), _generator(NULL), _floatTable(NULL), _mipmap(NULL),
+	  _lease(lease), _tableLent(true), _drawn(NULL), _nextDrawn(NULL)
+{
+	refArrayLease(_lease);
 }
 
 TablePField::~TablePField()
 {
-	delete [] _table;
+	if (!_tableLent && _table != NULL) {
+		MemStats::add(MemStats::kTables, -(long long) (_len * sizeof(double)));
+		delete [] _table;
+	}
+	if (_lease)
+		unrefArrayLease(_lease);
+	if (_floatTable != NULL)
+		MemStats::add(MemStats::kTables, -(long long) (_len * sizeof(float)));
+	delete [] _floatTable;
+	delete _generator;
+	delete _mipmap;
 }
 
-double TablePField::Truncate(double *tab, int len, double didx)
+// The interpolators, for tables of doubles or of floats.  Values are
+// converted to double before any arithmetic.
+
+template <typename T>
+static inline double truncate(const T *tab, int len, double didx)
 {
 	const int idx = int(didx);
 	return tab[idx];
 }
 
-double TablePField::Interpolate1stOrder(double *tab, int len, double didx)
+template <typename T>
+static inline double interpolate1st(const T *tab, int len, double didx)
 {
 	const int idx = int(didx);
 	const int idx2 = min(idx + 1, len - 1);
 	double frac = didx - idx;
-	return tab[idx] + frac * (tab[idx2] - tab[idx]);
+	const double y0 = tab[idx], y1 = tab[idx2];
+	return y0 + frac * (y1 - y0);
 }
 
-double TablePField::Interpolate2ndOrder(double *tab, int len, double didx)
+template <typename T>
+static inline double interpolate2nd(const T *tab, int len, double didx)
 {
 	const int idx = int(didx);
 	const int idx2 = min(idx + 1, len - 1);
 	const int idx3 = min(idx + 2, len - 1);
 	double frac = didx - idx;
 	double a = tab[idx];
+	const double y1 = tab[idx2], y2 = tab[idx3];
 	double hy0 = a / 2.0;
-	double hy2 = tab[idx3] / 2.0;
-	double b = (-3.0 * hy0) + (2.0 * tab[idx2]) - hy2;
-	double c = hy0 - tab[idx2] + hy2;
+	double hy2 = y2 / 2.0;
+	double b = (-3.0 * hy0) + (2.0 * y1) - hy2;
+	double c = hy0 - y1 + hy2;
 	return a + (b * frac) + (c * frac * frac);
 }
 
+template <typename T>
+static void fillBlock1st(const T *tab, int len, double *out, int nframes,
+						 double startPct, double pctIncr)
+{
+	const double scale = len - 1;
+	for (int n = 0; n < nframes; ++n) {
+		double percent = startPct + n * pctIncr;
+		if (percent > 1.0)
+			percent = 1.0;
+		const double didx = scale * percent;
+		const int idx = int(didx);
+		const int idx2 = min(idx + 1, len - 1);
+		const double y0 = tab[idx], y1 = tab[idx2];
+		out[n] = y0 + (didx - idx) * (y1 - y0);
+	}
+}
+
+double TablePField::Truncate(double *tab, int len, double didx)
+{
+	return truncate(tab, len, didx);
+}
+
+double TablePField::Interpolate1stOrder(double *tab, int len, double didx)
+{
+	return interpolate1st(tab, len, didx);
+}
+
+double TablePField::Interpolate2ndOrder(double *tab, int len, double didx)
+{
+	return interpolate2nd(tab, len, didx);
+}
+
+// The table's array of doubles, or NULL if this is a lazy or float table
+// that has not been asked for one yet.
+
+inline double *TablePField::array() const
+{
+	double *table = _table;
+	if (table != NULL && lazy())
+		__sync_synchronize();		// read the values only after the pointer
+	return table;
+}
+
+// Lazy and float tables that are filled in all share this lock, which is
+// only taken by the first reader of each one's array.
+
+static pthread_mutex_t sMaterializeLock = PTHREAD_MUTEX_INITIALIZER;
+
+double *TablePField::materialize() const
+{
+	double *table = array();
+	if (table != NULL)
+		return table;
+	pthread_mutex_lock(&sMaterializeLock);
+	if ((table = _table) == NULL) {
+		table = new double[_len];
+		MemStats::add(MemStats::kTables, _len * sizeof(double));
+		generate(table);
+		__sync_synchronize();		// publish the values before the pointer
+		_table = table;
+	}
+	pthread_mutex_unlock(&sMaterializeLock);
+	return table;
+}
+
+#define GENERATE_CHUNK 16384
+
+struct GenerateJob {
+	const TableGenerator *generator;
+	double *array;
+	int len;
+};
+
+static void generateChunk(void *context, int index)
+{
+	const GenerateJob *job = (const GenerateJob *) context;
+	const int start = index * GENERATE_CHUNK;
+	const int end = min(start + GENERATE_CHUNK, job->len);
+	for (int n = start; n < end; ++n)
+		job->array[n] = job->generator->valueAt(n);
+}
+
+void TablePField::generate(double *array) const
+{
+	if (_floatTable != NULL) {
+		for (int n = 0; n < _len; ++n)
+			array[n] = _floatTable[n];
+		return;
+	}
+	GenerateJob job;
+	job.generator = _generator;
+	job.array = array;
+	job.len = _len;
+	WorkerPool::run(generateChunk, &job, (_len + GENERATE_CHUNK - 1) / GENERATE_CHUNK);
+}
+
+// Interpolate in a lazy or float table that has no double array.  A lazy
+// table hands the interpolator only the values it reads: those at int(didx)
+// and the one or two after it.
+
+double TablePField::lazyValue(double didx) const
+{
+	if (_floatTable != NULL) {
+		if (_interpolator == Interpolate1stOrder)
+			return interpolate1st(_floatTable, _len, didx);
+		if (_interpolator == Truncate)
+			return truncate(_floatTable, _len, didx);
+		if (_interpolator == Interpolate2ndOrder)
+			return interpolate2nd(_floatTable, _len, didx);
+		return (*_interpolator)(materialize(), _len, didx);
+	}
+	const int idx = int(didx);
+	int count = (_interpolator == Truncate) ? 1
+			  : (_interpolator == Interpolate1stOrder) ? 2 : 3;
+	count = min(count, _len - idx);
+	double vals[3];
+	for (int n = 0; n < count; ++n)
+		vals[n] = _generator->valueAt(idx + n);
+	return (*_interpolator)(vals, count, didx - idx);
+}
+
 double TablePField::doubleValue(int indx) const
 {
-	return _table[min(indx, values() - 1)];
+	const int idx = min(indx, values() - 1);
+	const double *table = array();
+	if (table != NULL)
+		return table[idx];
+	return _floatTable ? _floatTable[idx] : _generator->valueAt(idx);
 }
 
 double TablePField::doubleValue(double percent) const
@@ -319,14 +617,48 @@ double TablePField::doubleValue(double percent) const
 		percent = 1.0;
 	const int len = values();
 	double didx = (len - 1) * percent;
-	return (*_interpolator)(_table, len, didx);
+	double *table = array();
+	return table ? (*_interpolator)(table, len, didx) : lazyValue(didx);
+}
+
+// Linear interpolation is done inline; other interpolators are called
+// directly, without the virtual call per value.
+
+void TablePField::fillBlock(double *out, int nframes, double startPct,
+							double pctIncr) const
+{
+	const int len = values();
+	const double scale = len - 1;
+	const double *table = array();
+	if (_interpolator == Interpolate1stOrder && (table || _floatTable)) {
+		if (table != NULL)
+			fillBlock1st(table, len, out, nframes, startPct, pctIncr);
+		else
+			fillBlock1st(_floatTable, len, out, nframes, startPct, pctIncr);
+	}
+	else if (table == NULL) {
+		for (int n = 0; n < nframes; ++n) {
+			double percent = startPct + n * pctIncr;
+			if (percent > 1.0)
+				percent = 1.0;
+			out[n] = lazyValue(scale * percent);
+		}
+	}
+	else {
+		for (int n = 0; n < nframes; ++n) {
+			double percent = startPct + n * pctIncr;
+			if (percent > 1.0)
+				percent = 1.0;
+			out[n] = (*_interpolator)((double *) table, len, scale * percent);
+		}
+	}
 }
 
 int TablePField::print(FILE *file) const
 {
 	int chars = 0;
 	for (int i = 0; i < values(); i++) {
-		chars += fprintf(file, "%.6f\n", _table[i]);
+		chars += fprintf(file, "%.6f\n", doubleValue(i));
 	}
 	return chars;
 }
@@ -336,11 +668,111 @@ int TablePField::print(FILE *file) const
 int TablePField::copyValues(double *array) const
 {
 	const int len = values();
+	const double *table = this->array();
+	if (table == NULL) {
+		generate(array);
+		return len;
+	}
 	for (int n = 0; n < len; ++n)
-		array[n] = _table[n];
+		array[n] = table[n];
 	return len;
 }
 
+// Drawing.  Each copy published links to the one it replaced, so that
+// foldDrawn() can retire a slice's copies together.  Copies are RefCounted
+// only so that the Reaper frees them: the newest holds the one reference.
+
+struct TableDraft : public RefCounted {
+	TableDraft(int len, const double *from, TableDraft *replaced)
+		: RefCounted(true), values(new double[len]), previous(replaced),
+		  nextRetired(NULL)
+	{
+		memcpy(values, from, len * sizeof(double));
+	}
+	virtual ~TableDraft()
+	{
+		delete [] values;
+		while (previous != NULL) {
+			TableDraft *draft = previous;
+			previous = draft->previous;
+			draft->previous = NULL;
+			delete draft;
+		}
+	}
+	double		*values;
+	TableDraft	*previous;
+	TableDraft	*nextRetired;
+};
+
+// Tables drawn on since the last fold, each with a reference, and the copies
+// folded last time, freed at the next fold.
+static TablePField * volatile sDrawnTables = NULL;
+static TableDraft *sRetiredDrafts = NULL;
+
+const double *TablePField::drawnValues() const
+{
+	TableDraft *newest = _drawn;
+	return newest ? newest->values : (double *) *this;
+}
+
+bool TablePField::draw(EditFunction edit, void *context)
+{
+	const double *base = (double *) *this;	// fills in a lazy table
+	for (;;) {
+		TableDraft *newest = _drawn;
+		TableDraft *draft = new TableDraft(_len, newest ? newest->values : base,
+										   newest);
+		if (!edit(draft->values, _len, context)) {
+			draft->previous = NULL;
+			delete draft;
+			return false;
+		}
+		if (__sync_bool_compare_and_swap(&_drawn, newest, draft)) {
+			if (newest == NULL) {
+				// The first drawing since the last fold lists the table.
+				ref();
+				TablePField *head;
+				do {
+					head = sDrawnTables;
+					_nextDrawn = head;
+				} while (!__sync_bool_compare_and_swap(&sDrawnTables, head, this));
+			}
+			return true;
+		}
+		// Someone else published first; draw on theirs.
+		draft->previous = NULL;
+		delete draft;
+	}
+}
+
+void TablePField::foldDrawn()
+{
+	while (sRetiredDrafts != NULL) {
+		TableDraft *draft = sRetiredDrafts;
+		sRetiredDrafts = draft->nextRetired;
+		draft->unref();
+	}
+	TablePField *table = __sync_lock_test_and_set(&sDrawnTables, (TablePField *) NULL);
+	while (table != NULL) {
+		TablePField *next = table->_nextDrawn;
+		TableDraft *newest = __sync_lock_test_and_set(&table->_drawn, (TableDraft *) NULL);
+		if (table->_tableLent) {
+			// Lent memory is never written: the table takes the copy.
+			table->_table = newest->values;
+			newest->values = NULL;
+			table->_tableLent = false;
+			MemStats::add(MemStats::kTables, table->_len * sizeof(double));
+		}
+		else
+			memcpy(table->_table, newest->values, table->_len * sizeof(double));
+		newest->ref();
+		newest->nextRetired = sRetiredDrafts;
+		sRetiredDrafts = newest;
+		table->unref();
+		table = next;
+	}
+}
+
 // PFieldWrapper
 
 PFieldWrapper::PFieldWrapper(PField *innerPField)
@@ -517,30 +949,41 @@ DrawTablePField::~DrawTablePField()
 	_indexPField->unref();
 }
 
-double DrawTablePField::doubleValue(double didx) const
-{
-	// get table and length; if it doesn't look like a table, do nothing
-	double *table = (double *) *field();
-	if (table == NULL)
-		return 0.0;
-	const int len = values();
-	if (len < 0)
-		return 0.0;
-	const int lastindex = len - 1;
+// One change made by a DrawTablePField.  The width is read only if the
+// value changes, and only once.
+
+struct DrawStroke {
+	bool	literalIndex;
+	double	index;
+	double	value;
+	PField	*widthPField;
+	double	didx;
+	bool	haveWidth;
+	double	width;
+};
 
-	// get target index
-	double dindex = _indexPField->doubleValue(didx);
-	int targetindex = _literalIndex ? int(dindex) : int(dindex * len);
+static int strokeTarget(const DrawStroke &stroke, int len)
+{
+	int targetindex = stroke.literalIndex ? int(stroke.index)
+										  : int(stroke.index * len);
 	if (targetindex < 0)
 		targetindex = 0;
-	else if (targetindex > lastindex)
-		targetindex = lastindex;
+	else if (targetindex > len - 1)
+		targetindex = len - 1;
+	return targetindex;
+}
+
+static bool drawStroke(double *table, int len, void *context)
+{
+	DrawStroke *stroke = (DrawStroke *) context;
+	const int lastindex = len - 1;
+	const int targetindex = strokeTarget(*stroke, len);
 
 	// new value to place at targeted index
-	const double newval = _valuePField->doubleValue(didx);
+	const double newval = stroke->value;
 	const double curval = table[targetindex];
 	if (curval == newval)
-		return 0.0;		// no change to table
+		return false;		// no change to table
 
 	// printf("[%d]\tcur=%f, new=%f\n", targetindex, curval, newval);
 
@@ -550,8 +993,12 @@ double DrawTablePField::doubleValue(double didx) const
 	// between start's val and <newval> across the intervening indices.  Same
 	// thing between target and stop indices.
 
-	double dwidth = _widthPField->doubleValue(didx);
-	int span = _literalIndex ? int(dwidth) : int(dwidth * len);
+	if (!stroke->haveWidth) {
+		stroke->width = stroke->widthPField->doubleValue(stroke->didx);
+		stroke->haveWidth = true;
+	}
+	const double dwidth = stroke->width;
+	int span = stroke->literalIndex ? int(dwidth) : int(dwidth * len);
 	if (span < 0)
 		span = 0;
 	if (span > 0) {
@@ -590,7 +1037,35 @@ double DrawTablePField::doubleValue(double didx) const
 	else
 		table[targetindex] = newval;
 
-	return 1.0;		// table was changed
+	return true;
+}
+
+double DrawTablePField::doubleValue(double didx) const
+{
+	// get table and length; if it doesn't look like a table, do nothing
+	double *table = (double *) *field();
+	if (table == NULL)
+		return 0.0;
+	const int len = values();
+	if (len < 0)
+		return 0.0;
+
+	DrawStroke stroke;
+	stroke.literalIndex = _literalIndex;
+	stroke.index = _indexPField->doubleValue(didx);
+	stroke.value = _valuePField->doubleValue(didx);
+	stroke.widthPField = _widthPField;
+	stroke.didx = didx;
+	stroke.haveWidth = false;
+
+	// A TablePField is drawn on a copy, published whole (see
+	// TablePField::draw()).  Anything else is changed in place.
+	TablePField *tablePField = dynamic_cast<TablePField *>(field());
+	if (tablePField == NULL)
+		return drawStroke(table, len, &stroke) ? 1.0 : 0.0;
+	if (tablePField->drawnValues()[strokeTarget(stroke, len)] == stroke.value)
+		return 0.0;		// no change, and no copy
+	return tablePField->draw(drawStroke, &stroke) ? 1.0 : 0.0;
 }
 
 double DrawTablePField::doubleValue(int idx) const
@@ -619,6 +1094,11 @@ ConcatTablePField::~ConcatTablePField()
 	_table2->unref();
 }
 
+bool ConcatTablePField::deterministic() const
+{
+	return field()->deterministic() && _table2->deterministic();
+}
+
 double ConcatTablePField::doubleValue(double didx) const
 {
 	if (didx > 1.0)
@@ -671,6 +1151,11 @@ InvertPField::~InvertPField()
 	_centerPField->unref();
 }
 
+bool InvertPField::deterministic() const
+{
+	return field()->deterministic() && _centerPField->deterministic();
+}
+
 double InvertPField::doubleValue(double didx) const
 {
 	const double center = _centerPField->doubleValue(didx);
@@ -705,6 +1190,12 @@ RangePField::~RangePField()
 	_minPField->unref();
 }
 
+bool RangePField::deterministic() const
+{
+	return field()->deterministic() && _minPField->deterministic()
+			&& _maxPField->deterministic();
+}
+
 // Assumes val is in range [0, 1]
 double RangePField::UnipolarSource(const double val, const double min, const double max)
 {
@@ -827,6 +1318,11 @@ QuantizePField::~QuantizePField()
 	_quantumPField->unref();
 }
 
+bool QuantizePField::deterministic() const
+{
+	return field()->deterministic() && _quantumPField->deterministic();
+}
+
 double QuantizePField::quantizeValue(const double val, const double quantum) const
 {
 	const double quotient = fabs(val / quantum);
@@ -869,6 +1365,12 @@ ClipPField::~ClipPField()
 	_minPField->unref();
 }
 
+bool ClipPField::deterministic() const
+{
+	return field()->deterministic() && _minPField->deterministic()
+			&& (_maxPField == NULL || _maxPField->deterministic());
+}
+
 double ClipPField::doubleValue(double didx) const
 {
 	double val = field()->doubleValue(didx);
@@ -1009,6 +1511,7 @@ double MapPField::doubleValue(int idx) const
 // DataFileWriterPField
 
 #include "DataFile.h"
+#include <RTOption.h>
 
 DataFileWriterPField::DataFileWriterPField(PField *innerPField,
 		const char *fileName, const bool clobber, const int controlRate,
@@ -1017,8 +1520,12 @@ DataFileWriterPField::DataFileWriterPField(PField *innerPField,
 {
 	_datafile = new DataFile(fileName, controlRate);
 	if (_datafile) {
-		if (_datafile->openFileWrite(clobber) == 0)
-			_datafile->writeHeader(fileRate, format, swap);
+		if (_datafile->openFileWrite(clobber) == 0) {
+			// With async_datafiles, reading this never waits on the disk
+			if (_datafile->writeHeader(fileRate, format, swap) == 0
+					&& RTOption::asyncDataFiles())
+				_datafile->writeAsync();
+		}
 		else {
 			delete _datafile;
 			_datafile = NULL;
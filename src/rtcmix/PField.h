@@ -11,6 +11,10 @@
 #include <RefCounted.h>
 #include <stdio.h>
 
+class Omipmap;
+struct _arraylease;
+struct TableDraft;
+
 // Base class for all PFields.  Value can be retrieved at any time in any
 // of the 3 supported formats.
 
@@ -26,10 +30,42 @@ public:
 	const char * 	stringValue(double dindex) const;
 	virtual int		print(FILE *) const;
 	virtual operator double *() const { /* default is to */ return 0; }
+	// Tables stored as floats return their array here, without making the
+	// double array that operator double * would have to.
+	virtual const float *floatArray() const { return 0; }
+	// Tables made with maketable's "bandlimit" option return their
+	// band-limited levels here, for oscillators (see Omipmap.h).
+	virtual const Omipmap *mipmap() const { return 0; }
 	virtual int		copyValues(double *) const;
 	virtual int		values() const = 0;
+	// Fill <out> with the values doubleValue() gives at <nframes> positions,
+	// starting at <startPct> and <pctIncr> apart, in order.  PFields with
+	// state (LFOs, random generators) advance once per value, just as they
+	// do per call.  Subclasses redefine this to skip the virtual call
+	// per value, both their own and those of the PFields they are built on.
+	virtual void	fillBlock(double *out, int nframes, double startPct,
+							  double pctIncr) const;
+	// How the value can change over a note, so that a reader knows how
+	// often it must read it.  kConstant never changes; kExternal changes
+	// only when it is set from outside the note (an inlet, say), which moves
+	// changes(); kVarying may differ from one read to the next.  These are
+	// in order, so the variation of a value made from several PFields is
+	// the largest of theirs.
+	enum Variation { kConstant, kExternal, kVarying };
+	virtual Variation	variation() const { return kVarying; }
+	// For kExternal PFields, a count that moves whenever the value is set.
+	virtual unsigned	changes() const { return 0; }
+	// True if reading the value changes nothing and gives the same value
+	// for the same index, so that a note may keep one read for the frame
+	// (see Instrument::pfieldValue()).  Anything that advances with each
+	// read -- an LFO, a random source, a smoother -- must leave this false.
+	virtual bool		deterministic() const { return false; }
+	// The aux bus this PField reads (see BusPField.h), or -1, so that the
+	// note reading it can be played after the notes writing the bus.
+	virtual int		auxBus() const { return -1; }
 protected:
-	PField();
+	// See RefCounted for <dispatchOnDelete>.
+	PField(bool dispatchOnDelete=false);
 	virtual 		~PField();
 };
 
@@ -52,6 +88,9 @@ private:
 class ConstPField : public SingleValuePField {
 public:
 	ConstPField(double value);
+	virtual void	fillBlock(double *, int, double, double) const;
+	virtual Variation	variation() const { return kConstant; }
+	virtual bool		deterministic() const { return true; }
 protected:
 	virtual 		~ConstPField();
 };
@@ -65,6 +104,8 @@ public:
 	virtual double	doubleValue(double) const;
 	virtual int		print(FILE *) const;
 	virtual int		values() const { return 1; }
+	virtual Variation	variation() const { return kConstant; }
+	virtual bool		deterministic() const { return true; }
 protected:
 	virtual 		~StringPField();
 private:
@@ -82,6 +123,8 @@ public:
 	virtual double	doubleValue(double) const { return 0.0; };
 	virtual int		print(FILE *f) const { return fprintf(f, "Instrument %p", _instrument); }
 	virtual int		values() const { return 1; }
+	virtual Variation	variation() const { return kConstant; }
+	virtual bool		deterministic() const { return true; }
 	Instrument *	instrument() const { return _instrument; }
 protected:
 	virtual 		~InstPField() {}
@@ -101,6 +144,15 @@ public:
 	virtual int		print(FILE *) const;
 	virtual int		copyValues(double *) const;
 	virtual int		values() const;
+	virtual void	fillBlock(double *, int, double, double) const;
+	virtual Variation	variation() const;
+	virtual unsigned	changes() const { return _pfield1->changes() + _pfield2->changes(); }
+	virtual bool		deterministic() const { return _pfield1->deterministic() && _pfield2->deterministic(); }
+	virtual int		auxBus() const;
+	// The operands and the operator, for PFieldProgram.
+	PField *		leftField() const { return _pfield1; }
+	PField *		rightField() const { return _pfield2; }
+	Operator		operation() const { return _operator; }
 protected:
 	virtual 		~PFieldBinaryOperator();
 private:
@@ -115,6 +167,7 @@ protected:
 	static double Add(double x, double y) { return x + y; }
 public:
 	AddPField(PField *pf1, PField *pf2) : PFieldBinaryOperator(pf1, pf2, Add) {}
+	virtual void	fillBlock(double *, int, double, double) const;
 protected:
 	virtual 		~AddPField() {}
 };
@@ -126,6 +179,7 @@ protected:
 	static double Mult(double x, double y) { return x * y; }
 public:
 	MultPField(PField *pf1, PField *pf2) : PFieldBinaryOperator(pf1, pf2, Mult) {}
+	virtual void	fillBlock(double *, int, double, double) const;
 protected:
 	virtual 		~MultPField() {}
 };
@@ -156,6 +210,7 @@ public:
 	float operator += (float value) { return (float) offset(value); }
 	double operator -= (double value) { return offset(-value); }
 	float operator -= (float value) { return (float) offset(-value); }
+	virtual void	fillBlock(double *, int, double, double) const;
 protected:
 	virtual 		~RTNumberPField() {}
 };
@@ -174,6 +229,7 @@ public:
 	LFOPField(double krate, TablePField *tablePField, PField *freq,
 								InterpFunction fun=Interpolate1stOrder);
 	virtual double	doubleValue(double) const;
+	virtual void	fillBlock(double *, int, double, double) const;
 protected:
 	virtual ~LFOPField();
 private:
@@ -205,7 +261,19 @@ private:
 	RandomOscil *_randOscil;
 };
 
-// Class for interpolated reading of table.
+// Computes the values of a lazy TablePField (see below) one at a time.
+
+class TableGenerator {
+public:
+	virtual ~TableGenerator() {}
+	// Return the value at <index>, which is less than the table length.  This
+	// must be exactly the value that filling the whole table would give, and
+	// safe to call from several threads at once.
+	virtual double	valueAt(int index) const = 0;
+};
+
+// Class for interpolated reading of table.  A table can be large, so it is
+// freed by the Reaper thread rather than by whoever lets go of it last.
 
 class TablePField : public PField, public RTFieldObject {
 public:
@@ -215,25 +283,75 @@ public:
 	static double Interpolate2ndOrder(double *, int, double);
 public:
 	TablePField(double *tableArray, int length, InterpFunction fun=Interpolate1stOrder);
+	// A lazy table, which owns <generator>.  Values are computed as they are
+	// read, and the array is only filled in -- in parallel, if frame_threads
+	// is set -- when someone asks for it through operator double *.
+	TablePField(TableGenerator *generator, int length, InterpFunction fun=Interpolate1stOrder);
+	// A table stored as floats, which are read without conversion to an
+	// array of doubles.  As with a lazy table, the double array is made
+	// only if asked for.
+	TablePField(float *tableArray, int length, InterpFunction fun=Interpolate1stOrder);
+	// A table reading memory lent by a front end (see ArrayLease in
+	// rtcmix_types.h), which is never copied, written or freed.  The table
+	// holds a reference to <lease> until it is destroyed.
+	TablePField(const double *tableArray, int length, struct _arraylease *lease,
+				InterpFunction fun=Interpolate1stOrder);
 	virtual double 	doubleValue(int indx = 0) const;
 	virtual double	doubleValue(double) const;
-	virtual operator double *() const { return _table; }
+	virtual operator double *() const { return lazy() ? materialize() : _table; }
+	virtual const float *floatArray() const { return _floatTable; }
+	virtual const Omipmap *mipmap() const { return _mipmap; }
+	// Give the table band-limited levels of its values, which it owns.
+	void setMipmap(Omipmap *mipmap) { _mipmap = mipmap; }
 	virtual int		print(FILE *) const;	// redefined
 	virtual int		copyValues(double *) const;
 	virtual int		values() const { return _len; }
+	virtual void	fillBlock(double *, int, double, double) const;
+	// Drawing (below) takes effect only between slices.
+	virtual bool		deterministic() const { return true; }
 	void setInterpFunction(InterpFunction fun) { _interpolator = fun; }
+
+	// Drawing on the table while notes read it (modtable "draw").  A drawing
+	// is made on a copy of the newest values, which is then published in
+	// place of them; readers go on seeing the table's array as it was until
+	// the end of the slice, when foldDrawn() copies the last copy published
+	// into it, so no reader sees a drawing half done.  <edit> changes the
+	// <len> values it is given and returns true, or returns false if it
+	// leaves them be.  Returns what <edit> did.
+	typedef bool (*EditFunction)(double *values, int len, void *context);
+	bool			draw(EditFunction edit, void *context);
+	// The values the next drawing will start from.
+	const double *	drawnValues() const;
+	// Called by the audio thread at the end of each slice, when no note is
+	// running.  A copy is freed (by the Reaper) a slice after it is folded.
+	static void		foldDrawn();
 protected:
 	virtual ~TablePField();
 private:
-	double				*_table;
+	bool				lazy() const { return _generator || _floatTable; }
+	double *			array() const;
+	double *			materialize() const;
+	double				lazyValue(double didx) const;
+	void				generate(double *array) const;
+	mutable double * volatile _table;	// NULL until a lazy table is filled in
 	int 				_len;
 	InterpFunction		_interpolator;
+	TableGenerator		*_generator;
+	float				*_floatTable;
+	Omipmap				*_mipmap;
+	struct _arraylease	*_lease;
+	bool				_tableLent;		// _table is the lease's memory
+	TableDraft * volatile _drawn;		// newest copy drawn this slice, or NULL
+	TablePField			*_nextDrawn;	// in the list of tables drawn on
 };
 
 class PFieldWrapper : public PField {
 public:
 	virtual int		values() const { return _len; }
 	virtual operator double *() const { return (double *) *_pField; }
+	virtual const float *floatArray() const { return _pField->floatArray(); }
+	virtual const Omipmap *mipmap() const { return _pField->mipmap(); }
+	virtual int		auxBus() const { return _pField->auxBus(); }
 protected:
 	PFieldWrapper(PField *innerPField);
 	virtual ~PFieldWrapper();
@@ -254,6 +372,9 @@ protected:
 	ModifiedIndexPFieldWrapper(PField *innerPField, IIFunctor *iif, DIFunctor *dif);
 	virtual double	doubleValue(double didx) const;
 	virtual double	doubleValue(int idx) const;
+	virtual Variation	variation() const { return field()->variation(); }
+	virtual unsigned	changes() const { return field()->changes(); }
+	virtual bool		deterministic() const { return field()->deterministic(); }
 protected:
 	virtual ~ModifiedIndexPFieldWrapper();
 private:
@@ -322,6 +443,7 @@ public:
 	virtual double	doubleValue(double didx) const;
 	virtual double	doubleValue(int idx) const;
 	virtual int	values() const { return _values; }
+	virtual bool	deterministic() const;
 protected:
 	virtual ~ConcatTablePField();
 private:
@@ -339,6 +461,9 @@ public:
 	ReversePField(PField *innerPField);
 	virtual double	doubleValue(double didx) const;
 	virtual double	doubleValue(int idx) const;
+	virtual Variation	variation() const { return field()->variation(); }
+	virtual unsigned	changes() const { return field()->changes(); }
+	virtual bool		deterministic() const { return field()->deterministic(); }
 };
 
 // Class for inverting PField output around a variable center of symmetry.
@@ -348,6 +473,7 @@ public:
 	InvertPField(PField *innerPField, PField *centerPField);
 	virtual double	doubleValue(double didx) const;
 	virtual double	doubleValue(int idx) const;
+	virtual bool	deterministic() const;
 protected:
 	virtual ~InvertPField();
 private:
@@ -366,6 +492,7 @@ public:
 												RangeFitFunction fun=UnipolarSource);
 	virtual double	doubleValue(double didx) const;
 	virtual double	doubleValue(int idx) const;
+	virtual bool	deterministic() const;
 protected:
 	virtual ~RangePField();
 private:
@@ -418,6 +545,7 @@ public:
 	QuantizePField(PField *innerPField, PField *quantumPField);
 	virtual double	doubleValue(double didx) const;
 	virtual double	doubleValue(int idx) const;
+	virtual bool	deterministic() const;
 protected:
 	virtual ~QuantizePField();
 private:
@@ -433,6 +561,7 @@ public:
 	ClipPField(PField *innerPField, PField *minPField, PField *maxPField);
 	virtual double	doubleValue(double didx) const;
 	virtual double	doubleValue(int idx) const;
+	virtual bool	deterministic() const;
 protected:
 	virtual ~ClipPField();
 private:
@@ -543,6 +672,7 @@ public:
 	ConverterPField(PField *innerPField, ConverterFunction cfun);
 	virtual double doubleValue(double percent) const;
 	virtual double doubleValue(int indx = 0) const;
+	virtual bool deterministic() const { return field()->deterministic(); }
 private:
 	ConverterFunction _converter;
 };
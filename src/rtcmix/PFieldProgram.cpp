@@ -0,0 +1,290 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#include "PFieldProgram.h"
+#include <vector>
+
+// fillBlock() runs the program over this many values at a time, with one
+// buffer of them for every level of the operand stack below the top.
+#define PROGRAM_CHUNK 128
+
+struct PFieldProgram::Step {
+	enum Opcode {
+		PushField,		// push field's value * scale + offset
+		Affine,			// top = top * scale + offset
+		Add,			// pop two, push their sum
+		Mult,			// pop two, push their product
+		Apply,			// pop two, push op(lower, top)
+		ApplyLeft,		// top = op(constant, top)
+		ApplyRight		// top = op(top, constant)
+	};
+	Opcode							opcode;
+	const PField *					field;
+	double							scale;
+	double							offset;		// also the constant operand
+	PFieldBinaryOperator::Operator	op;
+};
+
+struct PFieldProgram::Compilation {
+	Compilation() : depth(0), maxDepth(0) {}
+	void	add(const Step &step);
+	void	push(const PField *field);
+	void	scale(double factor);
+	void	offset(double amount);
+	std::vector<Step>	steps;
+	int					depth;
+	int					maxDepth;
+};
+
+void PFieldProgram::Compilation::add(const Step &step)
+{
+	steps.push_back(step);
+	if (step.opcode == Step::PushField) {
+		if (++depth > maxDepth)
+			maxDepth = depth;
+	}
+	else if (step.opcode == Step::Add || step.opcode == Step::Mult
+			 || step.opcode == Step::Apply)
+		--depth;
+}
+
+void PFieldProgram::Compilation::push(const PField *field)
+{
+	Step step = { Step::PushField, field, 1.0, 0.0, NULL };
+	add(step);
+}
+
+// The last step always produces the top of the stack, so a scale or offset
+// of the top merges into it if it already has one.
+
+void PFieldProgram::Compilation::scale(double factor)
+{
+	Step &last = steps.back();
+	if (last.opcode == Step::PushField || last.opcode == Step::Affine) {
+		last.scale *= factor;
+		last.offset *= factor;
+	}
+	else {
+		Step step = { Step::Affine, NULL, factor, 0.0, NULL };
+		add(step);
+	}
+}
+
+void PFieldProgram::Compilation::offset(double amount)
+{
+	Step &last = steps.back();
+	if (last.opcode == Step::PushField || last.opcode == Step::Affine)
+		last.offset += amount;
+	else {
+		Step step = { Step::Affine, NULL, 1.0, amount, NULL };
+		add(step);
+	}
+}
+
+// Add the steps computing <node> to <comp>, or if <node> is constant, add
+// nothing, store its value in <constant> and return true.  Only true
+// ConstPFields count: RTNumberPFields and the like can change during a note.
+
+bool PFieldProgram::emit(Compilation &comp, PField *node, double *constant)
+{
+	if (dynamic_cast<ConstPField *>(node) != NULL) {
+		*constant = node->doubleValue(0.0);
+		return true;
+	}
+	PFieldBinaryOperator *binop = dynamic_cast<PFieldBinaryOperator *>(node);
+	if (binop == NULL) {
+		comp.push(node);
+		return false;
+	}
+	const bool isAdd = dynamic_cast<AddPField *>(binop) != NULL;
+	const bool isMult = dynamic_cast<MultPField *>(binop) != NULL;
+	const PFieldBinaryOperator::Operator op = binop->operation();
+
+	double left, right;
+	const bool leftConst = emit(comp, binop->leftField(), &left);
+	const bool rightConst = emit(comp, binop->rightField(), &right);
+
+	if (leftConst && rightConst) {
+		*constant = (*op)(left, right);
+		return true;
+	}
+	if (leftConst || rightConst) {
+		const double value = leftConst ? left : right;
+		if (isAdd)
+			comp.offset(value);
+		else if (isMult)
+			comp.scale(value);
+		else {
+			Step step = { leftConst ? Step::ApplyLeft : Step::ApplyRight,
+						  NULL, 1.0, value, op };
+			comp.add(step);
+		}
+		return false;
+	}
+	Step step = { isAdd ? Step::Add : isMult ? Step::Mult : Step::Apply,
+				  NULL, 1.0, 0.0, op };
+	comp.add(step);
+	return false;
+}
+
+PField *PFieldProgram::compile(PField *tree)
+{
+	if (dynamic_cast<PFieldBinaryOperator *>(tree) == NULL)
+		return tree;
+	Compilation comp;
+	double value;
+	if (emit(comp, tree, &value))
+		return new ConstPField(value);
+	if (comp.maxDepth > kMaxDepth)
+		return tree;
+	return new PFieldProgram(tree, &comp.steps[0], (int) comp.steps.size());
+}
+
+PFieldProgram::PFieldProgram(PField *tree, const Step *steps, int count)
+	: _tree(tree), _steps(new Step[count]), _count(count)
+{
+	_tree->ref();
+	for (int n = 0; n < count; ++n)
+		_steps[n] = steps[n];
+}
+
+PFieldProgram::~PFieldProgram()
+{
+	delete [] _steps;
+	_tree->unref();
+}
+
+// Indexed access clamps the index differently at every level of the tree,
+// and is not used per sample, so it goes to the tree itself.
+
+double PFieldProgram::doubleValue(int indx) const
+{
+	return _tree->doubleValue(indx);
+}
+
+double PFieldProgram::doubleValue(double percent) const
+{
+	double stack[kMaxDepth];
+	int top = -1;
+	for (const Step *step = _steps; step < _steps + _count; ++step) {
+		switch (step->opcode) {
+		case Step::PushField:
+			stack[++top] = step->field->doubleValue(percent) * step->scale
+						   + step->offset;
+			break;
+		case Step::Affine:
+			stack[top] = stack[top] * step->scale + step->offset;
+			break;
+		case Step::Add:
+			--top;
+			stack[top] = stack[top] + stack[top + 1];
+			break;
+		case Step::Mult:
+			--top;
+			stack[top] = stack[top] * stack[top + 1];
+			break;
+		case Step::Apply:
+			--top;
+			stack[top] = (*step->op)(stack[top], stack[top + 1]);
+			break;
+		case Step::ApplyLeft:
+			stack[top] = (*step->op)(step->offset, stack[top]);
+			break;
+		case Step::ApplyRight:
+			stack[top] = (*step->op)(stack[top], step->offset);
+			break;
+		}
+	}
+	return stack[0];
+}
+
+// The same, a chunk of values at a time.  The bottom of the stack is the
+// caller's buffer, so the result needs no copying.
+
+void PFieldProgram::fillBlock(double *out, int nframes, double startPct,
+							  double pctIncr) const
+{
+	double buffers[kMaxDepth - 1][PROGRAM_CHUNK];
+	double *stack[kMaxDepth];
+	for (int n = 1; n < kMaxDepth; ++n)
+		stack[n] = buffers[n - 1];
+
+	for (int done = 0; done < nframes; done += PROGRAM_CHUNK) {
+		const int count = (nframes - done < PROGRAM_CHUNK) ? nframes - done
+														   : PROGRAM_CHUNK;
+		const double pct = startPct + done * pctIncr;
+		stack[0] = &out[done];
+		int top = -1;
+		for (const Step *step = _steps; step < _steps + _count; ++step) {
+			switch (step->opcode) {
+			case Step::PushField: {
+				double *dest = stack[++top];
+				step->field->fillBlock(dest, count, pct, pctIncr);
+				if (step->scale != 1.0 || step->offset != 0.0) {
+					const double scale = step->scale, offset = step->offset;
+					for (int n = 0; n < count; ++n)
+						dest[n] = dest[n] * scale + offset;
+				}
+				break;
+			}
+			case Step::Affine: {
+				double *dest = stack[top];
+				const double scale = step->scale, offset = step->offset;
+				for (int n = 0; n < count; ++n)
+					dest[n] = dest[n] * scale + offset;
+				break;
+			}
+			case Step::Add: {
+				double *dest = stack[--top];
+				const double *operand = stack[top + 1];
+				for (int n = 0; n < count; ++n)
+					dest[n] += operand[n];
+				break;
+			}
+			case Step::Mult: {
+				double *dest = stack[--top];
+				const double *operand = stack[top + 1];
+				for (int n = 0; n < count; ++n)
+					dest[n] *= operand[n];
+				break;
+			}
+			case Step::Apply: {
+				double *dest = stack[--top];
+				const double *operand = stack[top + 1];
+				for (int n = 0; n < count; ++n)
+					dest[n] = (*step->op)(dest[n], operand[n]);
+				break;
+			}
+			case Step::ApplyLeft: {
+				double *dest = stack[top];
+				for (int n = 0; n < count; ++n)
+					dest[n] = (*step->op)(step->offset, dest[n]);
+				break;
+			}
+			case Step::ApplyRight: {
+				double *dest = stack[top];
+				for (int n = 0; n < count; ++n)
+					dest[n] = (*step->op)(dest[n], step->offset);
+				break;
+			}
+			}
+		}
+	}
+}
+
+int PFieldProgram::values() const
+{
+	return _tree->values();
+}
+
+int PFieldProgram::print(FILE *file) const
+{
+	return _tree->print(file);
+}
+
+int PFieldProgram::copyValues(double *array) const
+{
+	return _tree->copyValues(array);
+}
@@ -0,0 +1,59 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+ */
+
+#ifndef _PFIELDPROGRAM_H_
+#define _PFIELDPROGRAM_H_
+
+#include <PField.h>
+
+// A tree of PFieldBinaryOperators, as a score builds with expressions like
+// "amp * env + 0.5", but flattened into a list of steps that is run in one
+// loop.  Evaluating the tree itself costs two virtual calls and a call
+// through a function pointer for every operator, every time, even where
+// both operands are constants.  Compiling it at note setup folds constant
+// subtrees into single values, turns adding or multiplying by a constant
+// into a scale and offset applied to the operand, and leaves only the
+// tree's leaves (tables, LFOs, real-time controls...) to be called.
+//
+// The leaves are still the tree's own PFields, so tables that drawtable()
+// changes, or real-time values, are read live exactly as before.  Results
+// can differ from the tree's in the last bit where two constants are merged
+// into one scale or offset.
+
+class PFieldProgram : public PField {
+public:
+	// Return the PField a note should use in place of <tree>: <tree> itself
+	// if it is not an operator tree, a ConstPField if it folds away entirely,
+	// otherwise a new program.  The new PField is not yet referenced.
+	static PField *	compile(PField *tree);
+
+	virtual double 	doubleValue(int indx = 0) const;
+	virtual double	doubleValue(double) const;
+	virtual int		print(FILE *) const;
+	virtual int		copyValues(double *) const;
+	virtual int		values() const;
+	virtual void	fillBlock(double *, int, double, double) const;
+	virtual Variation	variation() const { return _tree->variation(); }
+	virtual unsigned	changes() const { return _tree->changes(); }
+	virtual bool		deterministic() const { return _tree->deterministic(); }
+	virtual int		auxBus() const { return _tree->auxBus(); }
+
+	// Programs needing a deeper operand stack than this are not made.
+	enum { kMaxDepth = 16 };
+protected:
+	virtual 		~PFieldProgram();
+private:
+	struct Step;
+	struct Compilation;
+
+	PFieldProgram(PField *tree, const Step *steps, int count);
+	static bool		emit(Compilation &, PField *node, double *constant);
+
+	PField *		_tree;		// for indexed access, and to hold the leaves
+	Step *			_steps;
+	int				_count;
+};
+
+#endif	// _PFIELDPROGRAM_H_
@@ -5,22 +5,98 @@
 
 #include "PField.h"
 #include "PFieldSet.h"
+#include "BufferPool.h"
+#include <new>
 #ifndef NULL
 #define NULL 0
 #endif
 
-PFieldSet::PFieldSet(int numfields)
-	: _array(new PField *[numfields]), _size(numfields)
+// The PField pointer array and room for one constant per field are taken in
+// a single block from the BufferPool, so that a note whose args are all
+// numbers costs one allocation rather than one per arg.
+//
+// The constants are ordinary ref-counted PFields, and may be ref'd by
+// someone else (e.g., PFSCHED) and so outlive the set.  The block therefore
+// counts its holders -- the set plus each live constant -- and is released
+// by whichever of them goes last.  Constants are unref'd on the parser, audio
+// and reaper threads, so the count is kept the same way RefCounted's is.
+
+struct PFieldBlock {
+	int		holders;
+};
+
+class InlineConstPField : public ConstPField {
+public:
+	InlineConstPField(double value) : ConstPField(value) {}
+	static void *operator new(size_t, void *where) { return where; }
+	static void operator delete(void *ptr);		// called by unref()
+protected:
+	virtual ~InlineConstPField() {}
+};
+
+struct ConstantSlot {
+	PFieldBlock *block;		// NULL while the slot is empty
+	union {
+		char	storage[sizeof(InlineConstPField)];
+		double	align;
+		void *	align2;
+	};
+};
+
+#define ROUND_UP(n)	(((n) + 15) & ~(size_t) 15)
+
+static inline PField **arrayOf(PFieldBlock *block)
+{
+	return (PField **) ((char *) block + ROUND_UP(sizeof(PFieldBlock)));
+}
+
+static inline ConstantSlot *slotsOf(PFieldBlock *block, int numfields)
+{
+	return (ConstantSlot *) ((char *) arrayOf(block)
+							 + ROUND_UP(numfields * sizeof(PField *)));
+}
+
+static inline PField *constantIn(ConstantSlot *slot)
+{
+	return (InlineConstPField *) slot->storage;
+}
+
+static void releaseHolder(PFieldBlock *block)
+{
+	if (RC_DECREMENT(block->holders) == 0)
+		BufferPool::releaseBytes(block);
+}
+
+void InlineConstPField::operator delete(void *ptr)
+{
+	ConstantSlot *slot = (ConstantSlot *) ((char *) ptr - offsetof(ConstantSlot, storage));
+	PFieldBlock *block = slot->block;
+	slot->block = NULL;
+	releaseHolder(block);
+}
+
+PFieldSet::PFieldSet(int numfields) : _size(numfields)
 {
-	for (int n = 0; n < numfields; ++n)
+	const size_t bytes = ROUND_UP(sizeof(PFieldBlock))
+						 + ROUND_UP(numfields * sizeof(PField *))
+						 + numfields * sizeof(ConstantSlot);
+	_block = (PFieldBlock *) BufferPool::allocateBytes(bytes);
+	if (_block == NULL)
+		throw std::bad_alloc();
+	_block->holders = 1;
+	_array = arrayOf(_block);
+	ConstantSlot *slots = slotsOf(_block, numfields);
+	for (int n = 0; n < numfields; ++n) {
 		_array[n] = NULL;
+		slots[n].block = NULL;
+	}
 }
 
 PFieldSet::~PFieldSet()
 {
 	for (int n = 0; n < _size; ++n)
 		RefCounted::unref(_array[n]);
-	delete [] _array;
+	releaseHolder(_block);
 }
 
 void
@@ -33,3 +109,33 @@ PFieldSet::load(PField *pf, int index)
 	}
 }
 
+void
+PFieldSet::loadConstant(double value, int index)
+{
+	ConstantSlot *slot = &slotsOf(_block, _size)[index];
+	if (slot->block != NULL && _array[index] == constantIn(slot)) {
+		RefCounted::unref(_array[index]);	// frees the slot unless shared
+		_array[index] = NULL;
+	}
+	if (slot->block != NULL) {
+		// Still held elsewhere, so fall back to the usual way.
+		load(new ConstPField(value), index);
+		return;
+	}
+	slot->block = _block;
+	RC_INCREMENT(_block->holders);
+	load(new (slot->storage) InlineConstPField(value), index);
+}
+
+void *PFieldSet::operator new(size_t size)
+{
+	void *block = BufferPool::allocateBytes(size);
+	if (block == NULL)
+		throw std::bad_alloc();		// the memory budget is used up
+	return block;
+}
+
+void PFieldSet::operator delete(void *ptr)
+{
+	BufferPool::releaseBytes(ptr);
+}
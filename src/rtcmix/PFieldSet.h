@@ -6,18 +6,29 @@
 #ifndef _PFIELDSET_H_
 #define _PFIELDSET_H_
 
+#include <stddef.h>
+
 // Class to contain a set of PFields used by one instrument
 
 class PField;
+struct PFieldBlock;
 
 class PFieldSet {
 public:
 	PFieldSet(int numfields);
 	~PFieldSet();
 	void		load(PField *, int index);
+	// Load a constant.  This is the same as load(new ConstPField(value)),
+	// except that the PField is made inside the set's own memory.
+	void		loadConstant(double value, int index);
 	PField & 	operator[](int index) const { return *_array[index]; }
 	int			size() const { return _size; }
+
+	// One of these is made for every note, so they come from a pool.
+	static void *	operator new(size_t size);
+	static void		operator delete(void *ptr);
 private:
+	PFieldBlock	*_block;
 	PField	**_array;
 	int		_size;
 };
@@ -0,0 +1,122 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// Polyphony.cpp -- voice limits for instrument classes.  See Polyphony.h.
+
+#include "Polyphony.h"
+#include <RTcmix.h>
+#include <ugens.h>
+#include <string.h>
+#include <stdio.h>
+
+#define MAX_LIMITS		32
+#define DEFAULT_FADE_MSEC	5.0
+
+// Set by the parser thread and read by the audio thread.  An entry is filled
+// in before sLimits counts it, and is never removed, only given 0 voices.
+
+struct VoiceLimit {
+	char				name[64];
+	volatile int		voices;		// 0 for no limit
+	volatile int		sounding;	// counted by addVoice()
+	Polyphony::Policy	policy;
+	double				fadeMsec;
+};
+
+static VoiceLimit sLimitTable[MAX_LIMITS];
+volatile int Polyphony::sLimits = 0;
+
+int Polyphony::find(const char *name)
+{
+	const int count = sLimits;
+	for (int n = 0; n < count; ++n)
+		if (strcmp(sLimitTable[n].name, name) == 0)
+			return sLimitTable[n].voices > 0 ? n : -1;
+	return -1;
+}
+
+bool Polyphony::addVoice(int limit)
+{
+	return __sync_add_and_fetch(&sLimitTable[limit].sounding, 1) > sLimitTable[limit].voices;
+}
+
+void Polyphony::voiceEnded(int limit)
+{
+	__sync_sub_and_fetch(&sLimitTable[limit].sounding, 1);
+}
+
+Polyphony::Policy Polyphony::policy(int limit)
+{
+	return sLimitTable[limit].policy;
+}
+
+int Polyphony::fadeFrames(int limit, double srate)
+{
+	const int frames = (int) (sLimitTable[limit].fadeMsec * 0.001 * srate + 0.5);
+	return (frames > 0) ? frames : 1;
+}
+
+/* -------------------------------------------------------- set_polyphony --- */
+/* set_polyphony("GRANSYNTH", voices[, "oldest" | "quietest"[, fade msec]]):
+   see Polyphony.h.  Returns the number of voices.
+*/
+double
+RTcmix::set_polyphony(double p[], int n_args)
+{
+	if (n_args < 2 || n_args > 4) {
+		rterror("set_polyphony",
+				"usage: set_polyphony(\"INSTRUMENT\", voices[, \"oldest\"|\"quietest\"[, fade msec]])");
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+	const char *instname = DOUBLE_TO_STRING(p[0]);
+	if (instname == NULL || instname[0] == '\0') {
+		rterror("set_polyphony", "NULL instrument name!");
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+	const int voices = (int) p[1];
+	if (voices < 0) {
+		rterror("set_polyphony", "The number of voices must be >= 0.");
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+	Polyphony::Policy policy = Polyphony::kOldest;
+	if (n_args > 2) {
+		const char *name = DOUBLE_TO_STRING(p[2]);
+		if (name != NULL && strcmp(name, "quietest") == 0)
+			policy = Polyphony::kQuietest;
+		else if (name == NULL || strcmp(name, "oldest") != 0) {
+			rterror("set_polyphony", "The policy must be \"oldest\" or \"quietest\".");
+			return rtOptionalThrow(PARAM_ERROR);
+		}
+	}
+	const double fadeMsec = (n_args > 3) ? p[3] : DEFAULT_FADE_MSEC;
+	if (fadeMsec < 0.0) {
+		rterror("set_polyphony", "The fade must be >= 0.");
+		return rtOptionalThrow(PARAM_ERROR);
+	}
+
+	int limit;
+	for (limit = 0; limit < Polyphony::sLimits; ++limit)
+		if (strcmp(sLimitTable[limit].name, instname) == 0)
+			break;
+	VoiceLimit *entry = &sLimitTable[limit];
+	if (limit == Polyphony::sLimits) {
+		if (limit == MAX_LIMITS) {
+			rterror("set_polyphony", "Can't limit more than %d instruments.", MAX_LIMITS);
+			return rtOptionalThrow(RESOURCE_ERROR);
+		}
+		snprintf(entry->name, sizeof(entry->name), "%s", instname);
+		entry->sounding = 0;
+	}
+	entry->policy = policy;
+	entry->fadeMsec = fadeMsec;
+	entry->voices = voices;
+	if (limit == Polyphony::sLimits) {
+		__sync_synchronize();		// publish the entry before counting it
+		Polyphony::sLimits = limit + 1;
+	}
+	if (voices > 0)
+		rtcmix_advise("set_polyphony", "%s: at most %d voices, stealing the %s.",
+					  instname, voices, policy == Polyphony::kQuietest ? "quietest" : "oldest");
+	return voices;
+}
@@ -0,0 +1,41 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _POLYPHONY_H_
+#define _POLYPHONY_H_ 1
+
+// Voice limits for instrument classes.  set_polyphony("GRANSYNTH", 256)
+// lets no more than 256 notes of GRANSYNTH sound at once, however dense the
+// score, so that its cost has a ceiling.
+//
+// The limit is kept by inTraverse as it moves notes from the heap to the
+// rtQueues.  A note that would go over it takes the place of one already
+// sounding: by default the one that started first, or with "quietest" as
+// the third argument, the one whose last buffer peaked lowest.  The voice
+// taken is faded out over a few msec (the fourth argument, default 5) and
+// ends there; it no longer counts against the limit.  A limit of 0 removes
+// the limit.
+
+class Polyphony {
+public:
+	enum Policy { kOldest, kQuietest };
+
+	// Whether the score has set any limit.
+	static bool		active() { return sLimits > 0; }
+	// The limit for the instrument named <name>, or -1 if it has none.
+	static int		find(const char *name);
+	// Count a new voice against <limit>.  Returns true if it goes over, so
+	// that a voice should be released to make room.
+	static bool		addVoice(int limit);
+	// A voice counted by addVoice() has been released or destroyed.
+	static void		voiceEnded(int limit);
+	static Policy	policy(int limit);
+	static int		fadeFrames(int limit, double srate);
+
+private:
+	friend class RTcmix;	// set_polyphony() fills in the limits
+	static volatile int	sLimits;
+};
+
+#endif	// _POLYPHONY_H_
@@ -0,0 +1,100 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// Preparer.cpp -- configuring notes ahead of time.  See Preparer.h.
+
+#include "Preparer.h"
+#include "RTSemaphore.h"
+#include "heap/heap.h"
+#include <Instrument.h>
+#include <ugens.h>
+#include <pthread.h>
+#include <stddef.h>
+
+#define PREPARE_BATCH 32	// notes taken from the heap at a time
+
+volatile bool Preparer::sRunning = false;
+
+static heap *sHeap = NULL;
+static int sBufsamps = 0;
+static RTSemaphore *sWake = NULL;
+static pthread_t sThread;
+static volatile bool sStopping = false;
+static volatile FRAMETYPE sHorizon = 0;
+
+// Written only by the thread
+static Instrument *sBatch[PREPARE_BATCH];
+static int sBatchCount = 0;
+
+void Preparer::start(heap *inHeap, int inBufsamps)
+{
+	if (sRunning)
+		return;
+	sHeap = inHeap;
+	sBufsamps = inBufsamps;
+	sHorizon = 0;
+	sStopping = false;
+	sWake = new RTSemaphore(0);
+	if (pthread_create(&sThread, NULL, threadMain, NULL) != 0) {
+		rterror("Preparer", "Could not create the thread -- notes will be configured as they start");
+		delete sWake;
+		sWake = NULL;
+		return;
+	}
+	__sync_synchronize();
+	sRunning = true;
+}
+
+void Preparer::stop()
+{
+	if (!sRunning)
+		return;
+	sRunning = false;
+	sStopping = true;
+	__sync_synchronize();
+	sWake->post();
+	pthread_join(sThread, NULL);
+	delete sWake;
+	sWake = NULL;
+	sHeap = NULL;
+}
+
+void Preparer::ahead(FRAMETYPE inHorizon)
+{
+	if (!sRunning)
+		return;
+	sHorizon = inHorizon;
+	__sync_synchronize();
+	sWake->post();
+}
+
+// Called with the heap locked, which keeps <inInst> alive until we ref it.
+
+bool Preparer::collect(Instrument *inInst, void *)
+{
+	if (!inInst->needsConfigure())
+		return false;
+	inInst->ref();
+	sBatch[sBatchCount++] = inInst;
+	return true;
+}
+
+void *Preparer::threadMain(void *)
+{
+	while (!sStopping) {
+		sWake->wait();
+		__sync_synchronize();
+		const FRAMETYPE horizon = sHorizon;
+		do {
+			sBatchCount = 0;
+			sHeap->visitBefore(horizon, collect, NULL, PREPARE_BATCH);
+			for (int n = 0; n < sBatchCount; ++n) {
+				// Does nothing if the audio thread has gotten to it first.
+				sBatch[n]->configureOnce(sBufsamps, false);
+				sBatch[n]->unref();
+			}
+		} while (sBatchCount == PREPARE_BATCH && !sStopping);
+	}
+	return NULL;
+}
@@ -0,0 +1,39 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _PREPARER_H_
+#define _PREPARER_H_ 1
+
+#include <rt_types.h>
+
+class heap;
+class Instrument;
+
+// With the preconfigure_msec option, a helper thread that configures
+// non-interactive notes shortly before they start, so that the allocations
+// and table building in their configure() -- impulse FFTs, delay lines and
+// the like -- are done by the time inTraverse pops them from the heap.  The
+// audio thread tells it how far ahead to look at the start of each buffer.
+// A note that comes due before the thread gets to it is configured by the
+// audio thread as before (see Instrument::configureOnce()), and one that the
+// thread is working on when it comes due is waited for.
+//
+// (Interactive notes are configured by the parser when they are made, so
+// this is used only for scores.)
+
+class Preparer {
+public:
+	// Start looking ahead in <inHeap> for notes with <inBufsamps> frames.
+	static void		start(heap *inHeap, int inBufsamps);
+	static void		stop();
+	static bool		running() { return sRunning; }
+	// Called by the audio thread: configure notes starting before <inHorizon>.
+	static void		ahead(FRAMETYPE inHorizon);
+private:
+	static bool		collect(Instrument *inInst, void *);
+	static void *	threadMain(void *);
+	static volatile bool sRunning;
+};
+
+#endif	// _PREPARER_H_
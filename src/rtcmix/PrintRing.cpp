@@ -0,0 +1,241 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// PrintRing.cpp -- printing for real-time threads.  See PrintRing.h.
+
+#include "PrintRing.h"
+#include <ugens.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RING_SLOTS			256
+#define NAME_BYTES			24
+#define TEXT_BYTES			232
+#define MAX_PER_SECOND		40
+#define DRAIN_MICROSECONDS	50000
+
+// Slot (t % RING_SLOTS) holds ticket t once its sequence is
+// 2 * (t / RING_SLOTS) + 1, and is free for it while it is one less.
+// Posters claim tickets from sHead; the one drainer follows at sTail.
+
+struct Message {
+	volatile unsigned long long	sequence;
+	int		level;
+	char	instName[NAME_BYTES];
+	char	text[TEXT_BYTES];
+};
+
+static Message sRing[RING_SLOTS];
+static volatile unsigned long long sHead = 0;
+static unsigned long long sTail = 0;
+static volatile int sLost = 0;				// posts that found the ring full
+
+static __thread bool tRealtime = false;
+
+static pthread_t sThread;
+static volatile bool sRunning = false;
+static volatile bool sStopping = false;
+
+void PrintRing::realtimeThread()
+{
+	tRealtime = true;
+}
+
+PrintRing::AudioScope::AudioScope() : mWasRealtime(tRealtime)
+{
+	tRealtime = true;
+}
+
+PrintRing::AudioScope::~AudioScope()
+{
+	tRealtime = mWasRealtime;
+}
+
+bool PrintRing::deferring()
+{
+	return tRealtime;
+}
+
+static void postOne(int level, const char *instName, const char *text, size_t length)
+{
+	Message *message;
+	unsigned long long ticket;
+	for (;;) {
+		ticket = sHead;
+		message = &sRing[ticket % RING_SLOTS];
+		const unsigned long long vacant = 2 * (ticket / RING_SLOTS);
+		const unsigned long long sequence = message->sequence;
+		if (sequence == vacant) {
+			if (__sync_bool_compare_and_swap(&sHead, ticket, ticket + 1))
+				break;
+		}
+		else if (sequence < vacant) {		// not yet drained from the last lap
+			__sync_fetch_and_add(&sLost, 1);
+			return;
+		}
+		// Otherwise another thread has just taken this ticket.
+	}
+	message->level = level;
+	strncpy(message->instName, instName ? instName : "", NAME_BYTES - 1);
+	message->instName[NAME_BYTES - 1] = '\0';
+	memcpy(message->text, text, length);
+	message->text[length] = '\0';
+	__sync_synchronize();
+	message->sequence = 2 * (ticket / RING_SLOTS) + 1;
+}
+
+void PrintRing::post(int level, const char *instName, const char *text)
+{
+	size_t length = strlen(text);
+	if (level >= 0) {
+		if (length >= TEXT_BYTES)
+			length = TEXT_BYTES - 1;
+		postOne(level, instName, text, length);
+		return;
+	}
+	// Plain text too long for a slot goes in pieces.
+	do {
+		const size_t piece = (length < TEXT_BYTES) ? length : TEXT_BYTES - 1;
+		postOne(level, NULL, text, piece);
+		text += piece;
+		length -= piece;
+	} while (length > 0);
+}
+
+// Repeats and rate limiting, as seen by the drainer.
+
+static int sLastLevel = -1;
+static char sLastName[NAME_BYTES];
+static char sLastText[TEXT_BYTES];
+static bool sLastShown = false;
+static int sRepeats = 0;
+static time_t sSecond = 0;
+static int sShown = 0;				// messages shown in sSecond
+static int sSuppressed = 0;
+
+static void reportRepeats()
+{
+	if (sRepeats > 0) {
+		char text[64];
+		snprintf(text, sizeof(text), "(last message repeated %d time%s)",
+				 sRepeats, (sRepeats == 1) ? "" : "s");
+		rtcmix_show_message(sLastLevel, sLastName[0] ? sLastName : NULL, text);
+		sRepeats = 0;
+	}
+}
+
+// Once a second, or when stopping: report repeats and what went unprinted,
+// and start counting again.
+static void catchUp(bool force)
+{
+	const time_t now = time(NULL);
+	if (!force && now == sSecond)
+		return;
+	reportRepeats();
+	char text[128];
+	const int lost = __sync_lock_test_and_set(&sLost, 0);
+	if (sSuppressed > 0 || lost > 0) {
+		snprintf(text, sizeof(text),
+				 "%d message%s from real-time threads not printed",
+				 sSuppressed + lost, (sSuppressed + lost == 1) ? "" : "s");
+		rtcmix_show_message(MMP_WARN, NULL, text);
+		sSuppressed = 0;
+	}
+	sSecond = now;
+	sShown = 0;
+}
+
+static void show(const Message &message)
+{
+	if (message.level < 0) {
+		RTFPrintf((message.level == PrintRing::kStderr) ? stderr : stdout,
+				  "%s", message.text);
+		return;
+	}
+	if (message.level == sLastLevel && strcmp(message.instName, sLastName) == 0
+			&& strcmp(message.text, sLastText) == 0) {
+		if (sLastShown)
+			++sRepeats;
+		else
+			++sSuppressed;
+		return;
+	}
+	catchUp(false);
+	reportRepeats();
+	sLastLevel = message.level;
+	strcpy(sLastName, message.instName);
+	strcpy(sLastText, message.text);
+	sLastShown = (sShown < MAX_PER_SECOND);
+	if (!sLastShown) {
+		++sSuppressed;
+		return;
+	}
+	++sShown;
+	rtcmix_show_message(message.level,
+						message.instName[0] ? message.instName : NULL,
+						message.text);
+}
+
+void PrintRing::drain()
+{
+	Message message;
+	for (;;) {
+		Message *slot = &sRing[sTail % RING_SLOTS];
+		const unsigned long long lap = sTail / RING_SLOTS;
+		if (slot->sequence != 2 * lap + 1)
+			break;
+		__sync_synchronize();
+		message.level = slot->level;
+		strcpy(message.instName, slot->instName);
+		strcpy(message.text, slot->text);
+		__sync_synchronize();
+		slot->sequence = 2 * lap + 2;
+		++sTail;
+		show(message);
+	}
+	catchUp(false);
+}
+
+void PrintRing::start()
+{
+	if (sRunning)
+		return;
+	sStopping = false;
+	if (pthread_create(&sThread, NULL, threadMain, NULL) != 0) {
+		rterror("PrintRing", "Could not create the thread -- messages from the audio thread will be printed at the end");
+		return;
+	}
+	sRunning = true;
+}
+
+void PrintRing::stop()
+{
+	if (sRunning) {
+		sStopping = true;
+		pthread_join(sThread, NULL);
+		sRunning = false;
+	}
+	drain();
+	catchUp(true);
+}
+
+void PrintRing::restartAfterFork()
+{
+	if (!sRunning)
+		return;
+	sRunning = false;
+	start();
+}
+
+void *PrintRing::threadMain(void *)
+{
+	while (!sStopping) {
+		drain();
+		usleep(DRAIN_MICROSECONDS);
+	}
+	return NULL;
+}
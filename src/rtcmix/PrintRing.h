@@ -0,0 +1,64 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _PRINTRING_H_
+#define _PRINTRING_H_ 1
+
+// Printing from real-time threads.  Messages printed on the audio thread
+// while it is in inTraverse, or on a TaskManager or WorkerPool thread, are
+// not written there, where stdio, syslog or a host's print callback could
+// block, and turn one late buffer into a run of them.  rtcmix_warn(),
+// RTPrintf() and the rest copy them into a fixed ring instead, with no
+// locking or allocation, and they are printed later: by a low-priority
+// thread in standalone RTcmix, or in embedded builds by checkForPrint(),
+// which hands them to the host's print callback along with the rest.
+//
+// A warning or other message posted over and over (one every buffer, say)
+// is printed once, followed later by a count of its repeats, and no more
+// than a few dozen messages are printed in any second.  Messages that find
+// the ring full are lost.  Each of these is noted when printing catches up.
+// Plain RTPrintf() text is printed as is.
+
+class PrintRing {
+public:
+	enum { kStdout = -1, kStderr = -2 };	// levels for plain text
+
+	// Called by each TaskManager and WorkerPool thread when it starts.
+	static void		realtimeThread();
+
+	// Marks the audio thread as real-time while in inTraverse.
+	class AudioScope {
+	public:
+		AudioScope();
+		~AudioScope();
+	private:
+		bool	mWasRealtime;
+	};
+
+	// True if messages printed on this thread should be posted.
+	static bool		deferring();
+
+	// Copy a message, at <level> (MMP_WARN, say, or kStdout for plain
+	// text), for printing later.  Never blocks.
+	static void		post(int level, const char *instName, const char *text);
+
+	// Print whatever has been posted.  Only one thread may drain at a time:
+	// the thread started by start(), or else the caller of checkForPrint().
+	static void		drain();
+
+	static void		start();
+	// Print whatever is still waiting, and stop the thread.
+	static void		stop();
+	// Called in the child of a fork(), which has none of the parent's
+	// threads: start a thread of its own if the parent had one.
+	static void		restartAfterFork();
+private:
+	static void *	threadMain(void *);
+};
+
+// Defined in message.cpp: print a message just as rtcmix_warn() and the rest
+// would, at <level>.
+void rtcmix_show_message(int level, const char *inst_name, const char *text);
+
+#endif	// _PRINTRING_H_
@@ -12,7 +12,10 @@
 #include "utils.h"
 #include <sys/file.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
+#include <string.h>
 #include <limits>
 
 extern "C" {
@@ -31,16 +34,45 @@ static int gPvocDataOffset = 0;
 static int gPvocFrameCount = 0;
 static double gPvocFrameRate = 0;
 static int gPvocBinsPerFrame = 0;       // how many amp/freq pairs
+static const char *gPvocMap = NULL;     // the whole file, mapped
+static size_t gPvocMapSize = 0;
 
 static const int kBinSizeInBytes = 8;   // 2 floats per bin
 
-double
-pvinput(const Arg arglist[], const int nargs)
+// The data file is mapped rather than read, so frames cost no system calls
+// and its pages are shared with anything else reading the same file.
+
+static void pvclose()
 {
+    if (gPvocMap != NULL) {
+        munmap((void *) gPvocMap, gPvocMapSize);
+        gPvocMap = NULL;
+        gPvocMapSize = 0;
+    }
     if (gPvocFD > 0) {
         close(gPvocFD);
         gPvocFD = -1;   // mark as closed
     }
+}
+
+// Value <index> of frame <frame>: the amplitude of bin n is value 2n, and
+// its frequency value 2n + 1.
+
+static inline float pvvalue(int frame, int index)
+{
+    float value;
+    memcpy(&value, gPvocMap + gPvocDataOffset
+                   + (size_t) frame * gPvocBinsPerFrame * kBinSizeInBytes
+                   + index * sizeof(float), sizeof(float));
+    if (gPvocNeedsSwap)
+        byte_reverse4(&value);
+    return value;
+}
+
+double
+pvinput(const Arg arglist[], const int nargs)
+{
+    pvclose();
     const char *dataFileName = (const char *) arglist[0];
     if (!dataFileName) {
         die("pvinput", "Usage: pvinput(\"pvoc_data_filename\")");
@@ -78,7 +110,26 @@ pvinput(const Arg arglist[], const int nargs)
     gPvocNeedsSwap = IS_LITTLE_ENDIAN_FORMAT(data_format);
 #endif
 
+    // Don't believe a header that claims more frames than the file holds.
+    struct stat st;
+    const int frameBytes = file_chans * (int) sizeof(float);
+    if (fstat(fd, &st) == 0 && st.st_size > data_location) {
+        const int storedFrames = int((st.st_size - data_location) / frameBytes);
+        if (storedFrames < file_frames)
+            file_frames = storedFrames;
+    }
+    else
+        file_frames = 0;
+    void *map = (file_frames > 0) ? mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (map == MAP_FAILED) {
+        close(fd);
+        ::rterror("pvinput", "Can't map data file \"%s\" into memory", dataFileName);
+        return rtOptionalThrow(FILE_ERROR);
+    }
+
     gPvocFD = fd;
+    gPvocMap = (const char *) map;
+    gPvocMapSize = (size_t) st.st_size;
     gPvocDataOffset = data_location;
     gPvocFrameCount = file_frames;
     gPvocFrameRate = srate;
@@ -109,111 +160,58 @@ static Handle mkusage()
     return NULL;
 }
 
-Handle
-pvgetframeamps(const Arg arglist[], const int nargs)
+// Return a list of the amplitudes (<which> 0) or frequencies (<which> 1) of
+// frame <frameToRead>, interpolating between frames for a fractional frame.
+
+static Handle
+getframevalues(const char *funcname, double frameToRead, int which)
 {
     if (gPvocFD == -1) {
-        ::rterror("pvgetframeamps", "You haven't opened a PVOC data file yet");
+        ::rterror(funcname, "You haven't opened a PVOC data file yet");
         rtOptionalThrow(CONFIGURATION_ERROR);
         return NULL;
     }
-    double frameToRead = (double)arglist[0];
     if (frameToRead > gPvocFrameCount-1.0) {
-        rtcmix_warn("pvgetframeamps", "Limiting frame number to %f", gPvocFrameCount-1.0);
+        rtcmix_warn(funcname, "Limiting frame number to %f", gPvocFrameCount-1.0);
         frameToRead = gPvocFrameCount-1.0;
     }
     else if (frameToRead < 0.0) {
         return mkusage();
     }
-    const int read_offset = gPvocDataOffset + ((int)frameToRead * (gPvocBinsPerFrame * kBinSizeInBytes));
-    const int ampBins = gPvocBinsPerFrame;    // only want amplitudes
-    
-    // In PVOC datafiles, each frame consists of a float gain followed by a float
-    // frequency.  We read entire frame, but only extract the gain bins here.
-    
-    if (lseek(gPvocFD, read_offset, SEEK_SET) == -1) {
-        ::rterror("pvgetframeamps", "Failed to seek in data file");
-        rtOptionalThrow(FILE_ERROR);
-        return NULL;
-    }
-    float *totalframe = new float[gPvocBinsPerFrame*2];
-    float *nextframe = new float[gPvocBinsPerFrame*2];
+    const int frame = (int)frameToRead;
+    const int nextFrame = (frame < gPvocFrameCount-1) ? frame + 1 : frame;
+    const double frac = frameToRead - frame;
 
     // Create Array
     
-    Array *outGains = (Array *)malloc(sizeof(Array));
-    outGains->len = ampBins;
-    outGains->data = (double *)malloc(ampBins * sizeof(double));
+    Array *outValues = (Array *)malloc(sizeof(Array));
+    outValues->lease = NULL;
+    outValues->len = gPvocBinsPerFrame;
+    outValues->data = (double *)malloc(gPvocBinsPerFrame * sizeof(double));
 
-    read(gPvocFD, totalframe, gPvocBinsPerFrame*kBinSizeInBytes);
-    read(gPvocFD, nextframe, gPvocBinsPerFrame*kBinSizeInBytes);
+    // In PVOC datafiles, each frame consists of a float gain followed by a float
+    // frequency.  We extract only the one we want here.
 
-    double frac = frameToRead - (int)frameToRead;
     for (int bin = 0; bin < gPvocBinsPerFrame; ++bin) {
-        float binVal = totalframe[bin*2];
-        float nextBinVal = nextframe[bin*2];
-        if (gPvocNeedsSwap) { byte_reverse4(&binVal); byte_reverse4(&nextBinVal); }
-        outGains->data[bin] = binVal + frac * (nextBinVal - binVal);
+        const float binVal = pvvalue(frame, bin*2 + which);
+        const float nextBinVal = pvvalue(nextFrame, bin*2 + which);
+        outValues->data[bin] = binVal + frac * (nextBinVal - binVal);
     }
-    delete [] totalframe;
-    delete [] nextframe;
     
     // Wrap Array in Handle, and return.  This will return a 'list' to MinC.
-    return createArrayHandle(outGains);
+    return createArrayHandle(outValues);
 }
 
 Handle
-pvgetframefreqs(const Arg arglist[], const int nargs)
+pvgetframeamps(const Arg arglist[], const int nargs)
 {
-    if (gPvocFD == -1) {
-        ::rterror("pvgetframefreqs", "You haven't opened a PVOC data file yet");
-        rtOptionalThrow(CONFIGURATION_ERROR);
-        return NULL;
-    }
-    double frameToRead = (double)arglist[0];
-    if (frameToRead > gPvocFrameCount-1.0) {
-        rtcmix_warn("pvgetframefreqs", "Limiting frame number to %f", gPvocFrameCount-1.0);
-        frameToRead = gPvocFrameCount-1.0;
-    }
-    else if (frameToRead < 0.0) {
-        return mkusage();
-    }
-    // Offset to just past first float amp value in bin
-    const int read_offset = gPvocDataOffset + (int)sizeof(float) + ((int)frameToRead * (gPvocBinsPerFrame * kBinSizeInBytes));
-    const int pitchBins = gPvocBinsPerFrame;    // only want pitches
-    
-    // In PVOC datafiles, each frame consists of a float gain followed by a float
-    // frequency.  We read entire frame, but only extract the frequency bins here.
-    
-    if (lseek(gPvocFD, read_offset, SEEK_SET) == -1) {
-        ::rterror("pvgetframefreqs", "Failed to seek in data file");
-        rtOptionalThrow(FILE_ERROR);
-        return NULL;
-    }
-    float *totalframe = new float[gPvocBinsPerFrame*2];
-    float *nextframe = new float[gPvocBinsPerFrame*2];
-
-    // Create Array
-    
-    Array *outPitches = (Array *)malloc(sizeof(Array));
-    outPitches->len = pitchBins;
-    outPitches->data = (double *)malloc(pitchBins * sizeof(double));
-
-    read(gPvocFD, totalframe, gPvocBinsPerFrame*kBinSizeInBytes);
-    read(gPvocFD, nextframe, gPvocBinsPerFrame*kBinSizeInBytes);
+    return getframevalues("pvgetframeamps", (double)arglist[0], 0);
+}
 
-    double frac = frameToRead - (int)frameToRead;
-    for (int bin = 0; bin < gPvocBinsPerFrame; ++bin) {
-        float binVal = totalframe[bin*2];
-        float nextBinVal = nextframe[bin*2];
-        if (gPvocNeedsSwap) { byte_reverse4(&binVal); byte_reverse4(&nextBinVal); }
-        outPitches->data[bin] = binVal + frac * (nextBinVal - binVal);
-    }
-    delete [] totalframe;
-    delete [] nextframe;
-    
-    // Wrap Array in Handle, and return.  This will return a 'list' to MinC.
-    return createArrayHandle(outPitches);
+Handle
+pvgetframefreqs(const Arg arglist[], const int nargs)
+{
+    return getframevalues("pvgetframefreqs", (double)arglist[0], 1);
 }
 
 Handle
@@ -242,39 +240,18 @@ pvgetbin(const Arg arglist[], const int nargs)
         return NULL;
     }
     
-    // Offset to beginning of amplitude values for bin[binToRead] in the first PVOC frame
-    int read_offset = gPvocDataOffset + int(binToRead * kBinSizeInBytes);
-    if (lseek(gPvocFD, read_offset, SEEK_SET) == -1) {
-        ::rterror("pvgetbin", "Failed to seek in data file");
-        rtOptionalThrow(FILE_ERROR);
-        return NULL;
-    }
-    
+    const int bin = int(binToRead);
+
     // Create Array with length to hold an amp/freq pair for each frame in the datafile
     
     Array *outValues = (Array *)malloc(sizeof(Array));
+    outValues->lease = NULL;
     outValues->len = gPvocFrameCount*2;
     outValues->data = (double *)malloc(outValues->len * sizeof(double));
 
-    // How much we skip to get to the binToRead'th amplitude in each new frame.
-    // This is the size of each frame minus the size of the floats we read for the previous frame.
-    int skipBytes = (gPvocBinsPerFrame * kBinSizeInBytes) - kBinSizeInBytes;
-    // read amp and freq bin, skip to next frame, read next amp bin and freq bin, repeat
     for (int frame = 0; frame < gPvocFrameCount; ++frame) {
-        float binamp = 0.0f, binfreq = 0.0f;
-        read(gPvocFD, &binamp, sizeof(float));
-        read(gPvocFD, &binfreq, sizeof(float));
-        if (gPvocNeedsSwap) { byte_reverse4(&binamp); byte_reverse4(&binfreq); }
-        printf("gain[%d] freq[%d] for frame %d: %.6f\t%.4f\n", (int)binToRead, (int)binToRead, frame, binamp, binfreq);
-        outValues->data[frame*2] = binamp;
-        outValues->data[(frame*2)+1] = binfreq;
-        if (lseek(gPvocFD, skipBytes, SEEK_CUR) == -1) {
-            free(outValues->data);
-            free(outValues);
-            ::rterror("pvgetbin", "Failed to seek in data file");
-            rtOptionalThrow(FILE_ERROR);
-            return NULL;
-        }
+        outValues->data[frame*2] = pvvalue(frame, bin*2);
+        outValues->data[(frame*2)+1] = pvvalue(frame, bin*2 + 1);
     }
     
     // Wrap Array in Handle, and return.  This will return a 'list' to MinC.
@@ -32,11 +32,48 @@ bool RTOption::_bailOnParserWarning = false;
 bool RTOption::_autoLoad = false;
 bool RTOption::_fastUpdate = false;
 bool RTOption::_requireSampleRate = true;
+bool RTOption::_mmapInput = false;
+bool RTOption::_batchFileWrite = false;
+bool RTOption::_smoothControls = false;
+bool RTOption::_blockNoise = false;
+bool RTOption::_floatTables = false;
+bool RTOption::_preloadDSOs = false;
+bool RTOption::_threadRealtime = true;
+bool RTOption::_threadAffinity = false;
+bool RTOption::_alignedBlocks = false;
+bool RTOption::_deterministicMix = false;
+bool RTOption::_dspStats = false;
+bool RTOption::_memoryStats = false;
+bool RTOption::_asyncDataFiles = false;
+bool RTOption::_allocBacktraces = false;
+bool RTOption::_scoreCache = true;
+bool RTOption::_masterLimiter = false;
+bool RTOption::_voicePool = false;
+bool RTOption::_flushDenormals = true;
+bool RTOption::_parallelSetup = false;
 
 double RTOption::_bufferFrames = DEFAULT_BUFFER_FRAMES;
 int RTOption::_bufferCount = DEFAULT_BUFFER_COUNT;
 int RTOption::_oscInPort = DEFAULT_OSC_INPORT;
 double RTOption::_muteThreshold = DEFAULT_MUTE_THRESHOLD;
+int RTOption::_threadCount = DEFAULT_THREAD_COUNT;
+int RTOption::_prefetchFrames = DEFAULT_PREFETCH_FRAMES;
+int RTOption::_maxOpenInputs = DEFAULT_MAX_OPEN_INPUTS;
+int RTOption::_sampleCacheMB = DEFAULT_SAMPLE_CACHE_MB;
+int RTOption::_noteCacheMB = DEFAULT_NOTE_CACHE_MB;
+int RTOption::_fileWriteFrames = DEFAULT_FILE_WRITE_FRAMES;
+int RTOption::_offlineBufferFrames = DEFAULT_OFFLINE_BUFFER_FRAMES;
+int RTOption::_frameThreads = DEFAULT_FRAME_THREADS;
+int RTOption::_parseAheadMsec = DEFAULT_PARSE_AHEAD_MSEC;
+int RTOption::_threadSpinUsec = DEFAULT_THREAD_SPIN_USEC;
+int RTOption::_outputFifoBuffers = DEFAULT_OUTPUT_FIFO_BUFFERS;
+int RTOption::_overloadPercent = DEFAULT_OVERLOAD_PERCENT;
+int RTOption::_overloadShedNotes = DEFAULT_OVERLOAD_SHED_NOTES;
+int RTOption::_silenceSleepMsec = DEFAULT_SILENCE_SLEEP_MSEC;
+int RTOption::_silenceThresholdDb = DEFAULT_SILENCE_THRESHOLD_DB;
+int RTOption::_dspStatsInterval = DEFAULT_DSP_STATS_INTERVAL;
+int RTOption::_memoryBudget = 0;
+int RTOption::_preconfigureMsec = 0;
 
 // BGG see ugens.h for levels
 #ifdef EMBEDDED
@@ -57,6 +94,9 @@ char RTOption::_oscHost[OSCHOST_MAX];
 char RTOption::_dsoPath[DSOPATH_MAX];
 char RTOption::_homeDir[PATH_MAX];
 char RTOption::_rcName[PATH_MAX];
+char RTOption::_traceFile[PATH_MAX];
+char RTOption::_tableCacheDir[PATH_MAX];
+char RTOption::_renderCacheDir[PATH_MAX];
 
 
 void RTOption::init()
@@ -72,6 +112,25 @@ void RTOption::init()
 	_autoLoad = false;
 	_fastUpdate = false;
 	_requireSampleRate = true;
+	_mmapInput = false;
+	_batchFileWrite = false;
+	_smoothControls = false;
+	_blockNoise = false;
+	_floatTables = false;
+	_preloadDSOs = false;
+	_threadRealtime = true;
+	_threadAffinity = false;
+	_alignedBlocks = false;
+	_deterministicMix = false;
+	_dspStats = false;
+	_memoryStats = false;
+	_asyncDataFiles = false;
+	_allocBacktraces = false;
+	_scoreCache = true;
+	_masterLimiter = false;
+	_voicePool = false;
+	_flushDenormals = true;
+	_parallelSetup = false;
 #ifdef EMBEDDED
 	_print = MMP_RTERRORS; // basic level for max/msp
 #else
@@ -83,6 +142,24 @@ void RTOption::init()
 	_bufferCount = DEFAULT_BUFFER_COUNT;
 	_oscInPort = DEFAULT_OSC_INPORT;
 	_muteThreshold = DEFAULT_MUTE_THRESHOLD;
+	_threadCount = DEFAULT_THREAD_COUNT;
+	_prefetchFrames = DEFAULT_PREFETCH_FRAMES;
+	_maxOpenInputs = DEFAULT_MAX_OPEN_INPUTS;
+	_sampleCacheMB = DEFAULT_SAMPLE_CACHE_MB;
+	_noteCacheMB = DEFAULT_NOTE_CACHE_MB;
+	_fileWriteFrames = DEFAULT_FILE_WRITE_FRAMES;
+	_offlineBufferFrames = DEFAULT_OFFLINE_BUFFER_FRAMES;
+	_frameThreads = DEFAULT_FRAME_THREADS;
+	_parseAheadMsec = DEFAULT_PARSE_AHEAD_MSEC;
+	_threadSpinUsec = DEFAULT_THREAD_SPIN_USEC;
+	_outputFifoBuffers = DEFAULT_OUTPUT_FIFO_BUFFERS;
+	_overloadPercent = DEFAULT_OVERLOAD_PERCENT;
+	_overloadShedNotes = DEFAULT_OVERLOAD_SHED_NOTES;
+	_silenceSleepMsec = DEFAULT_SILENCE_SLEEP_MSEC;
+	_silenceThresholdDb = DEFAULT_SILENCE_THRESHOLD_DB;
+	_dspStatsInterval = DEFAULT_DSP_STATS_INTERVAL;
+	_memoryBudget = 0;
+	_preconfigureMsec = 0;
 
 	_device[0] = 0;
 	_inDevice[0] = 0;
@@ -95,6 +172,9 @@ void RTOption::init()
 	_dsoPath[0] = 0;
 	_homeDir[0] = 0;
 	_rcName[0] = 0;
+	_traceFile[0] = 0;
+	_tableCacheDir[0] = 0;
+	_renderCacheDir[0] = 0;
 
 	// initialize home directory and full path of user's configuration file
 
@@ -209,6 +289,139 @@ int RTOption::readConfigFile(const char *fileName)
 	else if (result != kConfigNoValueForKey)
 		reportError("%s: %s.", conf.getLastErrorText(), key);
 
+	key = kOptionMmapInput;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		mmapInput(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionBatchFileWrite;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		batchFileWrite(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionSmoothControls;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		smoothControls(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionBlockNoise;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		blockNoise(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionFloatTables;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		floatTables(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionPreloadDSOs;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		preloadDSOs(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionThreadRealtime;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		threadRealtime(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionThreadAffinity;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		threadAffinity(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionAlignedBlocks;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		alignedBlocks(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionDeterministicMix;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		deterministicMix(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionDspStats;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		dspStats(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionMemoryStats;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		memoryStats(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionAsyncDataFiles;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		asyncDataFiles(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionAllocBacktraces;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		allocBacktraces(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionScoreCache;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		scoreCache(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionMasterLimiter;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		masterLimiter(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionVoicePool;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		voicePool(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionFlushDenormals;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		flushDenormals(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionParallelSetup;
+	result = conf.getValue(key, bval);
+	if (result == kConfigNoErr)
+		parallelSetup(bval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
 	// number options .........................................................
 
 	double dval;
@@ -255,6 +468,132 @@ int RTOption::readConfigFile(const char *fileName)
 	else if (result != kConfigNoValueForKey)
 		reportError("%s: %s.", conf.getLastErrorText(), key);
 
+	key = kOptionThreadCount;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		threadCount((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionPrefetchFrames;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		prefetchFrames((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionMaxOpenInputs;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		maxOpenInputs((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionSampleCacheMB;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		sampleCacheMB((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionNoteCacheMB;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		noteCacheMB((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionFileWriteFrames;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		fileWriteFrames((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionOfflineBufferFrames;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		offlineBufferFrames((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionFrameThreads;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		frameThreads((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionParseAheadMsec;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		parseAheadMsec((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionThreadSpinUsec;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		threadSpinUsec((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionOutputFifoBuffers;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		outputFifoBuffers((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionOverloadPercent;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		overloadPercent((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionOverloadShedNotes;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		overloadShedNotes((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionSilenceSleepMsec;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		silenceSleepMsec((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionSilenceThresholdDb;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		silenceThresholdDb((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionDspStatsInterval;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		dspStatsInterval((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionMemoryBudget;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		memoryBudget((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionPreconfigureMsec;
+	result = conf.getValue(key, dval);
+	if (result == kConfigNoErr)
+		preconfigureMsec((int)dval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
 	// string options .........................................................
 
 	char *sval;
@@ -322,6 +661,27 @@ int RTOption::readConfigFile(const char *fileName)
 	else if (result != kConfigNoValueForKey)
 		reportError("%s: %s.", conf.getLastErrorText(), key);
 
+	key = kOptionTraceFile;
+	result = conf.getValue(key, sval);
+	if (result == kConfigNoErr)
+		traceFile(sval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionTableCacheDir;
+	result = conf.getValue(key, sval);
+	if (result == kConfigNoErr)
+		tableCacheDir(sval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
+	key = kOptionRenderCacheDir;
+	result = conf.getValue(key, sval);
+	if (result == kConfigNoErr)
+		renderCacheDir(sval);
+	else if (result != kConfigNoValueForKey)
+		reportError("%s: %s.", conf.getLastErrorText(), key);
+
 	return 0;
 }
 
@@ -370,6 +730,44 @@ int RTOption::writeConfigFile(const char *fileName)
 										fastUpdate() ? "true" : "false");
 	fprintf(stream, "%s = %s\n", kOptionRequireSampleRate,
 										requireSampleRate() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionMmapInput,
+										mmapInput() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionBatchFileWrite,
+										batchFileWrite() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionSmoothControls,
+										smoothControls() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionBlockNoise,
+										blockNoise() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionFloatTables,
+										floatTables() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionPreloadDSOs,
+										preloadDSOs() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionThreadRealtime,
+										threadRealtime() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionThreadAffinity,
+										threadAffinity() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionAlignedBlocks,
+										alignedBlocks() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionDeterministicMix,
+										deterministicMix() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionDspStats,
+										dspStats() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionMemoryStats,
+										memoryStats() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionAsyncDataFiles,
+										asyncDataFiles() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionAllocBacktraces,
+										allocBacktraces() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionScoreCache,
+										scoreCache() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionMasterLimiter,
+										masterLimiter() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionVoicePool,
+										voicePool() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionFlushDenormals,
+										flushDenormals() ? "true" : "false");
+	fprintf(stream, "%s = %s\n", kOptionParallelSetup,
+										parallelSetup() ? "true" : "false");
 
 	// write number options
 	fprintf(stream, "\n# Number options: key = value\n");
@@ -379,6 +777,24 @@ int RTOption::writeConfigFile(const char *fileName)
 	fprintf(stream, "%s = %d\n", kOptionPrint, print());
     fprintf(stream, "%s = %d\n", kOptionPrintListLimit, printListLimit());
 	fprintf(stream, "%s = %g\n", kOptionMuteThreshold, muteThreshold());
+	fprintf(stream, "%s = %d\n", kOptionThreadCount, threadCount());
+	fprintf(stream, "%s = %d\n", kOptionPrefetchFrames, prefetchFrames());
+	fprintf(stream, "%s = %d\n", kOptionMaxOpenInputs, maxOpenInputs());
+	fprintf(stream, "%s = %d\n", kOptionSampleCacheMB, sampleCacheMB());
+	fprintf(stream, "%s = %d\n", kOptionNoteCacheMB, noteCacheMB());
+	fprintf(stream, "%s = %d\n", kOptionFileWriteFrames, fileWriteFrames());
+	fprintf(stream, "%s = %d\n", kOptionOfflineBufferFrames, offlineBufferFrames());
+	fprintf(stream, "%s = %d\n", kOptionFrameThreads, frameThreads());
+	fprintf(stream, "%s = %d\n", kOptionParseAheadMsec, parseAheadMsec());
+	fprintf(stream, "%s = %d\n", kOptionThreadSpinUsec, threadSpinUsec());
+	fprintf(stream, "%s = %d\n", kOptionOutputFifoBuffers, outputFifoBuffers());
+	fprintf(stream, "%s = %d\n", kOptionOverloadPercent, overloadPercent());
+	fprintf(stream, "%s = %d\n", kOptionOverloadShedNotes, overloadShedNotes());
+	fprintf(stream, "%s = %d\n", kOptionSilenceSleepMsec, silenceSleepMsec());
+	fprintf(stream, "%s = %d\n", kOptionSilenceThresholdDb, silenceThresholdDb());
+	fprintf(stream, "%s = %d\n", kOptionDspStatsInterval, dspStatsInterval());
+	fprintf(stream, "%s = %d\n", kOptionMemoryBudget, memoryBudget());
+	fprintf(stream, "%s = %d\n", kOptionPreconfigureMsec, preconfigureMsec());
 
 	// write string options
 	fprintf(stream, "\n# String options: key = \"quoted string\"\n");
@@ -508,6 +924,27 @@ char *RTOption::rcName(const char *rcName)
 	return _rcName;
 }
 
+char *RTOption::traceFile(const char *fileName)
+{
+	strncpy(_traceFile, fileName, PATH_MAX);
+	_traceFile[PATH_MAX - 1] = 0;
+	return _traceFile;
+}
+
+char *RTOption::tableCacheDir(const char *dirName)
+{
+	strncpy(_tableCacheDir, dirName, PATH_MAX);
+	_tableCacheDir[PATH_MAX - 1] = 0;
+	return _tableCacheDir;
+}
+
+char *RTOption::renderCacheDir(const char *dirName)
+{
+	strncpy(_renderCacheDir, dirName, PATH_MAX);
+	_renderCacheDir[PATH_MAX - 1] = 0;
+	return _renderCacheDir;
+}
+
 void RTOption::dump()
 {
 #ifndef EMBEDDED
@@ -522,9 +959,46 @@ void RTOption::dump()
 	cout << kOptionAutoLoad << ": " << _autoLoad << endl;
 	cout << kOptionFastUpdate << ": " << _fastUpdate << endl;
 	cout << kOptionRequireSampleRate << ": " << _requireSampleRate << endl;
+	cout << kOptionMmapInput << ": " << _mmapInput << endl;
+	cout << kOptionBatchFileWrite << ": " << _batchFileWrite << endl;
+	cout << kOptionSmoothControls << ": " << _smoothControls << endl;
+	cout << kOptionBlockNoise << ": " << _blockNoise << endl;
+	cout << kOptionFloatTables << ": " << _floatTables << endl;
+	cout << kOptionPreloadDSOs << ": " << _preloadDSOs << endl;
+	cout << kOptionThreadRealtime << ": " << _threadRealtime << endl;
+	cout << kOptionThreadAffinity << ": " << _threadAffinity << endl;
+	cout << kOptionAlignedBlocks << ": " << _alignedBlocks << endl;
+	cout << kOptionDeterministicMix << ": " << _deterministicMix << endl;
+	cout << kOptionDspStats << ": " << _dspStats << endl;
+	cout << kOptionMemoryStats << ": " << _memoryStats << endl;
+	cout << kOptionAsyncDataFiles << ": " << _asyncDataFiles << endl;
+	cout << kOptionAllocBacktraces << ": " << _allocBacktraces << endl;
+	cout << kOptionScoreCache << ": " << _scoreCache << endl;
+	cout << kOptionMasterLimiter << ": " << _masterLimiter << endl;
+	cout << kOptionVoicePool << ": " << _voicePool << endl;
+	cout << kOptionFlushDenormals << ": " << _flushDenormals << endl;
+	cout << kOptionParallelSetup << ": " << _parallelSetup << endl;
 	cout << kOptionBufferFrames << ": " << _bufferFrames << endl;
 	cout << kOptionBufferCount << ": " << _bufferCount << endl;
 	cout << kOptionMuteThreshold << ": " << _muteThreshold << endl;
+	cout << kOptionThreadCount << ": " << _threadCount << endl;
+	cout << kOptionPrefetchFrames << ": " << _prefetchFrames << endl;
+	cout << kOptionMaxOpenInputs << ": " << _maxOpenInputs << endl;
+	cout << kOptionSampleCacheMB << ": " << _sampleCacheMB << endl;
+	cout << kOptionNoteCacheMB << ": " << _noteCacheMB << endl;
+	cout << kOptionFileWriteFrames << ": " << _fileWriteFrames << endl;
+	cout << kOptionOfflineBufferFrames << ": " << _offlineBufferFrames << endl;
+	cout << kOptionFrameThreads << ": " << _frameThreads << endl;
+	cout << kOptionParseAheadMsec << ": " << _parseAheadMsec << endl;
+	cout << kOptionThreadSpinUsec << ": " << _threadSpinUsec << endl;
+	cout << kOptionOutputFifoBuffers << ": " << _outputFifoBuffers << endl;
+	cout << kOptionOverloadPercent << ": " << _overloadPercent << endl;
+	cout << kOptionOverloadShedNotes << ": " << _overloadShedNotes << endl;
+	cout << kOptionSilenceSleepMsec << ": " << _silenceSleepMsec << endl;
+	cout << kOptionSilenceThresholdDb << ": " << _silenceThresholdDb << endl;
+	cout << kOptionDspStatsInterval << ": " << _dspStatsInterval << endl;
+	cout << kOptionMemoryBudget << ": " << _memoryBudget << endl;
+	cout << kOptionPreconfigureMsec << ": " << _preconfigureMsec << endl;
 	cout << kOptionOSCInPort << ": " << _oscInPort << endl;
 	cout << kOptionDevice << ": " << _device << endl;
 	cout << kOptionInDevice << ": " << _inDevice << endl;
@@ -537,6 +1011,9 @@ void RTOption::dump()
 	cout << kOptionDSOPath << ": " << _dsoPath << endl;
 	cout << kOptionRCName << ": " << _rcName << endl;
 	cout << kOptionHomeDir << ": " << _homeDir << endl;
+	cout << kOptionTraceFile << ": " << _traceFile << endl;
+	cout << kOptionTableCacheDir << ": " << _tableCacheDir << endl;
+	cout << kOptionRenderCacheDir << ": " << _renderCacheDir << endl;
 #endif // EMBEDDED
 }
 
@@ -587,6 +1064,44 @@ int get_bool_option(const char *option_name)
 		return (int) RTOption::fastUpdate();
 	else if (!strcmp(option_name, kOptionRequireSampleRate))
 		return (int) RTOption::requireSampleRate();
+	else if (!strcmp(option_name, kOptionMmapInput))
+		return (int) RTOption::mmapInput();
+	else if (!strcmp(option_name, kOptionBatchFileWrite))
+		return (int) RTOption::batchFileWrite();
+	else if (!strcmp(option_name, kOptionSmoothControls))
+		return (int) RTOption::smoothControls();
+	else if (!strcmp(option_name, kOptionBlockNoise))
+		return (int) RTOption::blockNoise();
+	else if (!strcmp(option_name, kOptionFloatTables))
+		return (int) RTOption::floatTables();
+	else if (!strcmp(option_name, kOptionPreloadDSOs))
+		return (int) RTOption::preloadDSOs();
+	else if (!strcmp(option_name, kOptionThreadRealtime))
+		return (int) RTOption::threadRealtime();
+	else if (!strcmp(option_name, kOptionThreadAffinity))
+		return (int) RTOption::threadAffinity();
+	else if (!strcmp(option_name, kOptionAlignedBlocks))
+		return (int) RTOption::alignedBlocks();
+	else if (!strcmp(option_name, kOptionDeterministicMix))
+		return (int) RTOption::deterministicMix();
+	else if (!strcmp(option_name, kOptionDspStats))
+		return (int) RTOption::dspStats();
+	else if (!strcmp(option_name, kOptionMemoryStats))
+		return (int) RTOption::memoryStats();
+	else if (!strcmp(option_name, kOptionAsyncDataFiles))
+		return (int) RTOption::asyncDataFiles();
+	else if (!strcmp(option_name, kOptionAllocBacktraces))
+		return (int) RTOption::allocBacktraces();
+	else if (!strcmp(option_name, kOptionScoreCache))
+		return (int) RTOption::scoreCache();
+	else if (!strcmp(option_name, kOptionMasterLimiter))
+		return (int) RTOption::masterLimiter();
+	else if (!strcmp(option_name, kOptionVoicePool))
+		return (int) RTOption::voicePool();
+	else if (!strcmp(option_name, kOptionFlushDenormals))
+		return (int) RTOption::flushDenormals();
+	else if (!strcmp(option_name, kOptionParallelSetup))
+		return (int) RTOption::parallelSetup();
 
 	assert(0 && "unsupported option name");		// program error
 	return 0;
@@ -618,6 +1133,44 @@ void set_bool_option(const char *option_name, int value)
 		RTOption::fastUpdate((bool) value);
 	else if (!strcmp(option_name, kOptionRequireSampleRate))
 		RTOption::requireSampleRate((bool) value);
+	else if (!strcmp(option_name, kOptionMmapInput))
+		RTOption::mmapInput((bool) value);
+	else if (!strcmp(option_name, kOptionBatchFileWrite))
+		RTOption::batchFileWrite((bool) value);
+	else if (!strcmp(option_name, kOptionSmoothControls))
+		RTOption::smoothControls((bool) value);
+	else if (!strcmp(option_name, kOptionBlockNoise))
+		RTOption::blockNoise((bool) value);
+	else if (!strcmp(option_name, kOptionFloatTables))
+		RTOption::floatTables((bool) value);
+	else if (!strcmp(option_name, kOptionPreloadDSOs))
+		RTOption::preloadDSOs((bool) value);
+	else if (!strcmp(option_name, kOptionThreadRealtime))
+		RTOption::threadRealtime((bool) value);
+	else if (!strcmp(option_name, kOptionThreadAffinity))
+		RTOption::threadAffinity((bool) value);
+	else if (!strcmp(option_name, kOptionAlignedBlocks))
+		RTOption::alignedBlocks((bool) value);
+	else if (!strcmp(option_name, kOptionDeterministicMix))
+		RTOption::deterministicMix((bool) value);
+	else if (!strcmp(option_name, kOptionDspStats))
+		RTOption::dspStats((bool) value);
+	else if (!strcmp(option_name, kOptionMemoryStats))
+		RTOption::memoryStats((bool) value);
+	else if (!strcmp(option_name, kOptionAsyncDataFiles))
+		RTOption::asyncDataFiles((bool) value);
+	else if (!strcmp(option_name, kOptionAllocBacktraces))
+		RTOption::allocBacktraces((bool) value);
+	else if (!strcmp(option_name, kOptionScoreCache))
+		RTOption::scoreCache((bool) value);
+	else if (!strcmp(option_name, kOptionMasterLimiter))
+		RTOption::masterLimiter((bool) value);
+	else if (!strcmp(option_name, kOptionVoicePool))
+		RTOption::voicePool((bool) value);
+	else if (!strcmp(option_name, kOptionFlushDenormals))
+		RTOption::flushDenormals((bool) value);
+	else if (!strcmp(option_name, kOptionParallelSetup))
+		RTOption::parallelSetup((bool) value);
 	else
 		assert(0 && "unsupported option name");
 }
@@ -634,6 +1187,42 @@ double get_double_option(const char *option_name)
         return RTOption::parserWarnings();
 	else if (!strcmp(option_name, kOptionMuteThreshold))
 		return RTOption::muteThreshold();
+	else if (!strcmp(option_name, kOptionThreadCount))
+		return RTOption::threadCount();
+	else if (!strcmp(option_name, kOptionPrefetchFrames))
+		return RTOption::prefetchFrames();
+	else if (!strcmp(option_name, kOptionMaxOpenInputs))
+		return RTOption::maxOpenInputs();
+	else if (!strcmp(option_name, kOptionSampleCacheMB))
+		return RTOption::sampleCacheMB();
+	else if (!strcmp(option_name, kOptionNoteCacheMB))
+		return RTOption::noteCacheMB();
+	else if (!strcmp(option_name, kOptionFileWriteFrames))
+		return RTOption::fileWriteFrames();
+	else if (!strcmp(option_name, kOptionOfflineBufferFrames))
+		return RTOption::offlineBufferFrames();
+	else if (!strcmp(option_name, kOptionFrameThreads))
+		return RTOption::frameThreads();
+	else if (!strcmp(option_name, kOptionParseAheadMsec))
+		return RTOption::parseAheadMsec();
+	else if (!strcmp(option_name, kOptionThreadSpinUsec))
+		return RTOption::threadSpinUsec();
+	else if (!strcmp(option_name, kOptionOutputFifoBuffers))
+		return RTOption::outputFifoBuffers();
+	else if (!strcmp(option_name, kOptionOverloadPercent))
+		return RTOption::overloadPercent();
+	else if (!strcmp(option_name, kOptionOverloadShedNotes))
+		return RTOption::overloadShedNotes();
+	else if (!strcmp(option_name, kOptionSilenceSleepMsec))
+		return RTOption::silenceSleepMsec();
+	else if (!strcmp(option_name, kOptionSilenceThresholdDb))
+		return RTOption::silenceThresholdDb();
+	else if (!strcmp(option_name, kOptionDspStatsInterval))
+		return RTOption::dspStatsInterval();
+	else if (!strcmp(option_name, kOptionMemoryBudget))
+		return RTOption::memoryBudget();
+	else if (!strcmp(option_name, kOptionPreconfigureMsec))
+		return RTOption::preconfigureMsec();
 
 	assert(0 && "unsupported option name");
 	return 0;
@@ -651,6 +1240,42 @@ void set_double_option(const char *option_name, double value)
         RTOption::parserWarnings((int)value);
 	else if (!strcmp(option_name, kOptionMuteThreshold))
 		RTOption::muteThreshold(value);
+	else if (!strcmp(option_name, kOptionThreadCount))
+		RTOption::threadCount((int)value);
+	else if (!strcmp(option_name, kOptionPrefetchFrames))
+		RTOption::prefetchFrames((int)value);
+	else if (!strcmp(option_name, kOptionMaxOpenInputs))
+		RTOption::maxOpenInputs((int)value);
+	else if (!strcmp(option_name, kOptionSampleCacheMB))
+		RTOption::sampleCacheMB((int)value);
+	else if (!strcmp(option_name, kOptionNoteCacheMB))
+		RTOption::noteCacheMB((int)value);
+	else if (!strcmp(option_name, kOptionFileWriteFrames))
+		RTOption::fileWriteFrames((int)value);
+	else if (!strcmp(option_name, kOptionOfflineBufferFrames))
+		RTOption::offlineBufferFrames((int)value);
+	else if (!strcmp(option_name, kOptionFrameThreads))
+		RTOption::frameThreads((int)value);
+	else if (!strcmp(option_name, kOptionParseAheadMsec))
+		RTOption::parseAheadMsec((int)value);
+	else if (!strcmp(option_name, kOptionThreadSpinUsec))
+		RTOption::threadSpinUsec((int)value);
+	else if (!strcmp(option_name, kOptionOutputFifoBuffers))
+		RTOption::outputFifoBuffers((int)value);
+	else if (!strcmp(option_name, kOptionOverloadPercent))
+		RTOption::overloadPercent((int)value);
+	else if (!strcmp(option_name, kOptionOverloadShedNotes))
+		RTOption::overloadShedNotes((int)value);
+	else if (!strcmp(option_name, kOptionSilenceSleepMsec))
+		RTOption::silenceSleepMsec((int)value);
+	else if (!strcmp(option_name, kOptionSilenceThresholdDb))
+		RTOption::silenceThresholdDb((int)value);
+	else if (!strcmp(option_name, kOptionDspStatsInterval))
+		RTOption::dspStatsInterval((int)value);
+	else if (!strcmp(option_name, kOptionMemoryBudget))
+		RTOption::memoryBudget((int)value);
+	else if (!strcmp(option_name, kOptionPreconfigureMsec))
+		RTOption::preconfigureMsec((int)value);
 	else
 		assert(0 && "unsupported option name");
 }
@@ -669,6 +1294,12 @@ char *get_string_option(const char *option_name)
 		return RTOption::outDevice(2);
 	else if (!strcmp(option_name, kOptionDSOPath))
 		return RTOption::dsoPath();
+	else if (!strcmp(option_name, kOptionTraceFile))
+		return RTOption::traceFile();
+	else if (!strcmp(option_name, kOptionTableCacheDir))
+		return RTOption::tableCacheDir();
+	else if (!strcmp(option_name, kOptionRenderCacheDir))
+		return RTOption::renderCacheDir();
 
 	assert(0 && "unsupported option name");
 	return 0;
@@ -688,6 +1319,12 @@ void set_string_option(const char *option_name, const char *value)
 		RTOption::outDevice(value, 2);
 	else if (!strcmp(option_name, kOptionDSOPath))
 		RTOption::dsoPath(value);
+	else if (!strcmp(option_name, kOptionTraceFile))
+		RTOption::traceFile(value);
+	else if (!strcmp(option_name, kOptionTableCacheDir))
+		RTOption::tableCacheDir(value);
+	else if (!strcmp(option_name, kOptionRenderCacheDir))
+		RTOption::renderCacheDir(value);
 	else
 		assert(0 && "unsupported option name");
 }
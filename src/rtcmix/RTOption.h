@@ -77,6 +77,22 @@
 #endif
 #define DEFAULT_OSC_INPORT 7770
 #define DEFAULT_MUTE_THRESHOLD 0.0	/* means no muting */
+#define DEFAULT_THREAD_COUNT 0		/* means one per processor */
+#define DEFAULT_PREFETCH_FRAMES 0	/* means no read-ahead thread */
+#define DEFAULT_MAX_OPEN_INPUTS 0	/* means half the process limit */
+#define DEFAULT_SAMPLE_CACHE_MB 256
+#define DEFAULT_NOTE_CACHE_MB 0	/* means no note cache */
+#define DEFAULT_FILE_WRITE_FRAMES 32768
+#define DEFAULT_OFFLINE_BUFFER_FRAMES 0	/* means render at buffer_frames */
+#define DEFAULT_FRAME_THREADS 0
+#define DEFAULT_PARSE_AHEAD_MSEC 0	/* means parse whole score before playing */
+#define DEFAULT_THREAD_SPIN_USEC 50	/* how long idle task threads spin */
+#define DEFAULT_OUTPUT_FIFO_BUFFERS 4	/* per extra output device; 0 means none */
+#define DEFAULT_OVERLOAD_PERCENT 0	/* means no overload handling */
+#define DEFAULT_OVERLOAD_SHED_NOTES 1
+#define DEFAULT_SILENCE_SLEEP_MSEC 0	/* means never sleep silent notes */
+#define DEFAULT_SILENCE_THRESHOLD_DB -100
+#define DEFAULT_DSP_STATS_INTERVAL 0
 
 #define DEVICE_MAX   64
 #define MAX_OUTPUT_DEVICES 3
@@ -100,6 +116,25 @@
 #define kOptionAutoLoad         "auto_load"
 #define kOptionFastUpdate       "fast_update"
 #define kOptionRequireSampleRate	"require_sample_rate"
+#define kOptionMmapInput        "mmap_input"
+#define kOptionBatchFileWrite	"batch_file_write"
+#define kOptionSmoothControls	"smooth_controls"
+#define kOptionBlockNoise	"block_noise"
+#define kOptionFloatTables	"float_tables"
+#define kOptionPreloadDSOs	"preload_dsos"
+#define kOptionThreadRealtime	"thread_realtime"
+#define kOptionThreadAffinity	"thread_affinity"
+#define kOptionAlignedBlocks	"aligned_blocks"
+#define kOptionDeterministicMix	"deterministic_mix"
+#define kOptionDspStats	"dsp_stats"
+#define kOptionMemoryStats	"memory_stats"
+#define kOptionAsyncDataFiles	"async_datafiles"
+#define kOptionAllocBacktraces	"alloc_backtraces"
+#define kOptionScoreCache	"score_cache"
+#define kOptionMasterLimiter	"master_limiter"
+#define kOptionVoicePool	"voice_pool"
+#define kOptionFlushDenormals	"flush_denormals"
+#define kOptionParallelSetup	"parallel_setup"
 
 // number options
 #define kOptionBufferFrames     "buffer_frames"
@@ -109,6 +144,24 @@
 #define kOptionPrintListLimit    "print_list_limit"
 #define kOptionParserWarnings   "parser_warnings"
 #define kOptionMuteThreshold	"mute_threshold"
+#define kOptionThreadCount		"thread_count"
+#define kOptionPrefetchFrames	"prefetch_frames"
+#define kOptionMaxOpenInputs	"max_open_inputs"
+#define kOptionSampleCacheMB	"sample_cache_mb"
+#define kOptionNoteCacheMB	"note_cache_mb"
+#define kOptionFileWriteFrames	"file_write_frames"
+#define kOptionOfflineBufferFrames	"offline_buffer_frames"
+#define kOptionFrameThreads	"frame_threads"
+#define kOptionParseAheadMsec	"parse_ahead_msec"
+#define kOptionThreadSpinUsec	"thread_spin_usec"
+#define kOptionOutputFifoBuffers	"output_fifo_buffers"
+#define kOptionOverloadPercent	"overload_percent"
+#define kOptionOverloadShedNotes	"overload_shed_notes"
+#define kOptionSilenceSleepMsec	"silence_sleep_msec"
+#define kOptionSilenceThresholdDb	"silence_threshold_db"
+#define kOptionDspStatsInterval	"dsp_stats_interval"
+#define kOptionMemoryBudget	"memory_budget"
+#define kOptionPreconfigureMsec	"preconfigure_msec"
 
 // string options
 #define kOptionDevice           "device"
@@ -122,6 +175,9 @@
 #define kOptionDSOPath          "dso_path"
 #define kOptionRCName           "rcname"
 #define kOptionHomeDir          "homedir"
+#define kOptionTraceFile        "trace_file"
+#define kOptionTableCacheDir    "table_cache_dir"
+#define kOptionRenderCacheDir   "render_cache_dir"
 
 
 #ifdef __cplusplus
@@ -183,6 +239,116 @@ public:
 	static bool requireSampleRate(const bool setIt) { _requireSampleRate = setIt;
 		return _requireSampleRate; }
 
+	// Map rtinput sound files into memory instead of reading them (see
+	// InputFile.h).  Can also be requested per file with rtinput(..., "mmap").
+	static bool mmapInput() { return _mmapInput; }
+	static bool mmapInput(const bool setIt) { _mmapInput = setIt;
+		return _mmapInput; }
+
+	// Have the sound file writer thread save up large blocks before writing
+	// (see AudioFileDevice.h).  Best for offline rendering.
+	static bool batchFileWrite() { return _batchFileWrite; }
+	static bool batchFileWrite(const bool setIt) { _batchFileWrite = setIt;
+		return _batchFileWrite; }
+
+	// If true, instruments that support it ramp their controls linearly
+	// between control-rate updates, instead of stepping.
+	static bool smoothControls() { return _smoothControls; }
+	static bool smoothControls(const bool setIt) { _smoothControls = setIt;
+		return _smoothControls; }
+
+	// If true, noise instruments and the Random classes (makerandom,
+	// maketable "random") draw from Orandblock instead of the old generators.
+	// Renders stay reproducible, but differ from those made without it.
+	static bool blockNoise() { return _blockNoise; }
+	static bool blockNoise(const bool setIt) { _blockNoise = setIt;
+		return _blockNoise; }
+
+	// store maketable tables as floats, halving their memory
+	static bool floatTables() { return _floatTables; }
+	static bool floatTables(const bool setIt) { _floatTables = setIt;
+		return _floatTables; }
+
+	// with auto_load, open all instrument DSOs in the background at startup
+	static bool preloadDSOs() { return _preloadDSOs; }
+	static bool preloadDSOs(const bool setIt) { _preloadDSOs = setIt;
+		return _preloadDSOs; }
+
+	// Run task threads with the SCHED_RR policy, where permitted.
+	static bool threadRealtime() { return _threadRealtime; }
+	static bool threadRealtime(const bool setIt) { _threadRealtime = setIt;
+		return _threadRealtime; }
+
+	// Pin each task thread to a core of its own (Linux).
+	static bool threadAffinity() { return _threadAffinity; }
+	static bool threadAffinity(const bool setIt) { _threadAffinity = setIt;
+		return _threadAffinity; }
+
+	// Render instruments without bus input in whole, block-aligned chunks
+	// from their own start, leaving the offset into the buffer to the mixer.
+	static bool alignedBlocks() { return _alignedBlocks; }
+	static bool alignedBlocks(const bool setIt) { _alignedBlocks = setIt;
+		return _alignedBlocks; }
+
+	// Mix notes into each bus in the order they were scheduled, rather than
+	// the order the render threads finished them, so that MULTI_THREAD
+	// renders come out the same, bit for bit, every time.
+	static bool deterministicMix() { return _deterministicMix; }
+	static bool deterministicMix(const bool setIt) { _deterministicMix = setIt;
+		return _deterministicMix; }
+
+	// Time instruments, bus passes, mixdown and file reads (see DSPStats.h).
+	static bool dspStats() { return _dspStats; }
+	static bool dspStats(const bool setIt) { _dspStats = setIt;
+		return _dspStats; }
+
+	// Count memory by instrument class, and report it at the end of the
+	// render (see MemStats.h).
+	static bool memoryStats() { return _memoryStats; }
+	static bool memoryStats(const bool setIt) { _memoryStats = setIt;
+		return _memoryStats; }
+
+	// Data files written by makemonitor go through a queue to a background
+	// thread, so that writing them never blocks a note (see DataFile.h).
+	static bool asyncDataFiles() { return _asyncDataFiles; }
+	static bool asyncDataFiles(const bool setIt) { _asyncDataFiles = setIt;
+		return _asyncDataFiles; }
+
+	// In an ALLOC_TRACKING build, log heap allocations on real-time threads
+	// to stderr with a backtrace (see AllocTracker.h).
+	static bool allocBacktraces() { return _allocBacktraces; }
+	static bool allocBacktraces(const bool setIt) { _allocBacktraces = setIt;
+		return _allocBacktraces; }
+
+	// Keep the MinC trees of score buffers sent by embedded hosts, and
+	// re-run them when the same text comes again
+	static bool scoreCache() { return _scoreCache; }
+	static bool scoreCache(const bool setIt) { _scoreCache = setIt;
+		return _scoreCache; }
+
+	// Run the output through a look-ahead peak limiter, so that nothing
+	// reaches the device clipper.  Delays the output by 2 msec.
+	static bool masterLimiter() { return _masterLimiter; }
+	static bool masterLimiter(const bool setIt) { _masterLimiter = setIt;
+		return _masterLimiter; }
+
+	// Play notes of instruments that allow it (WAVETABLE, FMINST) as voices
+	// of one long-lived instance apiece, instead of as instruments of their own
+	static bool voicePool() { return _voicePool; }
+	static bool voicePool(const bool setIt) { _voicePool = setIt;
+		return _voicePool; }
+
+	// Render with denormal floats flushed to zero (see Denormals.h).
+	static bool flushDenormals() { return _flushDenormals; }
+	static bool flushDenormals(const bool setIt) { _flushDenormals = setIt;
+		return _flushDenormals; }
+
+	// Set up a non-interactive score's notes several at a time, on the
+	// TaskManager threads, rather than one by one as they are parsed
+	static bool parallelSetup() { return _parallelSetup; }
+	static bool parallelSetup(const bool setIt) { _parallelSetup = setIt;
+		return _parallelSetup; }
+
 	// number options
 
 	static double bufferFrames() { return _bufferFrames; }
@@ -209,6 +375,96 @@ public:
 	static double muteThreshold() { return _muteThreshold; }
 	static double muteThreshold(double thresh) { _muteThreshold = thresh; return _muteThreshold; }
 
+	// Number of TaskManager worker threads for MULTI_THREAD builds.  Only
+	// read at startup; 0 means use one per online processor.
+	static int threadCount() { return _threadCount; }
+	static int threadCount(int count) { _threadCount = count; return _threadCount; }
+
+	// Frames of each sound file input to read ahead of the instruments on
+	// a background thread (see InputStream.h); 0 means read synchronously.
+	static int prefetchFrames() { return _prefetchFrames; }
+	static int prefetchFrames(int frames) { _prefetchFrames = frames; return _prefetchFrames; }
+
+	// Most sound file inputs to hold descriptors for at once; those not in
+	// use by a note are closed, oldest first, and opened again when needed.
+	// 0 means half the process's open file limit.
+	static int maxOpenInputs() { return _maxOpenInputs; }
+	static int maxOpenInputs(int count) { _maxOpenInputs = count; return _maxOpenInputs; }
+
+	// Megabytes of decoded sound file samples to keep for reuse (see
+	// SampleCache.h); 0 turns the cache off.
+	static int sampleCacheMB() { return _sampleCacheMB; }
+	static int sampleCacheMB(int mb) { _sampleCacheMB = mb; return _sampleCacheMB; }
+
+	// Megabytes of rendered notes to keep for replay (see NoteCache.h); 0,
+	// the default, turns the cache off.
+	static int noteCacheMB() { return _noteCacheMB; }
+	static int noteCacheMB(int mb) { _noteCacheMB = mb; return _noteCacheMB; }
+
+	// Frames of output to queue for the sound file writer thread (see
+	// AudioFileDevice.h); 0 means write on the calling thread.
+	static int fileWriteFrames() { return _fileWriteFrames; }
+	static int fileWriteFrames(int value) { _fileWriteFrames = value; return _fileWriteFrames; }
+
+	// Frames per render pass when writing to a file with play off (0 = use buffer_frames)
+	static int offlineBufferFrames() { return _offlineBufferFrames; }
+	static int offlineBufferFrames(int value) { _offlineBufferFrames = value; return _offlineBufferFrames; }
+
+	// Helper threads that spectral instruments may share a note's FFT
+	// frames with (0: compute every frame on the note's own thread).
+	static int frameThreads() { return _frameThreads; }
+	static int frameThreads(int value) { _frameThreads = value; return _frameThreads; }
+
+	// If > 0, play while the score is still being parsed, starting once
+	// this many msec of it are scheduled.  Standalone CMIX only.
+	static int parseAheadMsec() { return _parseAheadMsec; }
+	static int parseAheadMsec(int value) { _parseAheadMsec = value; return _parseAheadMsec; }
+
+	// Longest time, in microseconds, an idle task thread polls for work
+	// before it sleeps (MULTI_THREAD builds).  0 means always sleep.
+	static int threadSpinUsec() { return _threadSpinUsec; }
+	static int threadSpinUsec(int value) { _threadSpinUsec = value; return _threadSpinUsec; }
+
+	// Buffers queued for each extra output device (outdevice2,
+	// outdevice3), which then runs on its own clock with drift
+	// correction.  0 drives them in step with the first device.
+	static int outputFifoBuffers() { return _outputFifoBuffers; }
+	static int outputFifoBuffers(int value) { _outputFifoBuffers = value; return _outputFifoBuffers; }
+
+	// Percent of each buffer's duration that computing it may take before
+	// notes are shed (see overload_shed_notes).  0 means no overload handling.
+	static int overloadPercent() { return _overloadPercent; }
+	static int overloadPercent(int value) { _overloadPercent = value; return _overloadPercent; }
+
+	// Number of the oldest notes ended on overload.  0 means halve the
+	// control rate of every playing note instead.
+	static int overloadShedNotes() { return _overloadShedNotes; }
+	static int overloadShedNotes(int value) { _overloadShedNotes = value; return _overloadShedNotes; }
+
+	// How long the output of a note that allows it must stay below
+	// silence_threshold_db before the note sleeps.  0 means never sleep.
+	static int silenceSleepMsec() { return _silenceSleepMsec; }
+	static int silenceSleepMsec(int value) { _silenceSleepMsec = value; return _silenceSleepMsec; }
+
+	// Level, in dB below full scale, under which a note's output counts
+	// as silent.
+	static int silenceThresholdDb() { return _silenceThresholdDb; }
+	static int silenceThresholdDb(int value) { _silenceThresholdDb = value; return _silenceThresholdDb; }
+
+	// With dsp_stats, print the stats every this many seconds; 0 means never.
+	static int dspStatsInterval() { return _dspStatsInterval; }
+	static int dspStatsInterval(int value) { _dspStatsInterval = value; return _dspStatsInterval; }
+
+	// Megabytes to set aside at rtsetparams time for notes, their pfields
+	// and output buffers, which may use no more (0 for no limit)
+	static int memoryBudget() { return _memoryBudget; }
+	static int memoryBudget(int value) { _memoryBudget = value; return _memoryBudget; }
+
+	// Milliseconds ahead of their start at which a helper thread
+	// configures non-interactive notes (0 = none, on the audio thread)
+	static int preconfigureMsec() { return _preconfigureMsec; }
+	static int preconfigureMsec(int value) { _preconfigureMsec = value; return _preconfigureMsec; }
+
 	// string options
 
 	// WARNING: If no string as been assigned, do not expect the get method
@@ -242,6 +498,22 @@ public:
 	static char *rcName() { return _rcName; }
 	static char *rcName(const char *rcName);
 
+	// Record a timeline of scheduler activity, and write it to this file
+	// for chrome://tracing or Perfetto (see SchedTrace.h).
+	static char *traceFile() { return _traceFile; }
+	static char *traceFile(const char *fileName);
+
+	// Keep the costlier maketable and makegen tables in this directory, to
+	// be reused by later runs (see TableCache.h).  Empty for no cache.
+	static char *tableCacheDir() { return _tableCacheDir; }
+	static char *tableCacheDir(const char *dirName);
+
+	// Keep the notes in the note cache in this directory, to be replayed by
+	// later runs of the score (see NoteCache.h).  Empty to keep them only
+	// for this run.
+	static char *renderCacheDir() { return _renderCacheDir; }
+	static char *renderCacheDir(const char *dirName);
+
 	static void dump();
 
 private:
@@ -260,6 +532,25 @@ private:
 	static bool _autoLoad;
 	static bool _fastUpdate;
 	static bool _requireSampleRate;
+	static bool _mmapInput;
+	static bool _batchFileWrite;
+	static bool _smoothControls;
+	static bool _blockNoise;
+	static bool _floatTables;
+	static bool _preloadDSOs;
+	static bool _threadRealtime;
+	static bool _threadAffinity;
+	static bool _alignedBlocks;
+	static bool _deterministicMix;
+	static bool _dspStats;
+	static bool _memoryStats;
+	static bool _asyncDataFiles;
+	static bool _allocBacktraces;
+	static bool _scoreCache;
+	static bool _masterLimiter;
+	static bool _voicePool;
+	static bool _flushDenormals;
+	static bool _parallelSetup;
 
 	// number options
 	static double _bufferFrames;
@@ -269,6 +560,24 @@ private:
     static int _printListLimit;
     static unsigned _parserWarnings;
 	static double _muteThreshold;
+	static int _threadCount;
+	static int _prefetchFrames;
+	static int _maxOpenInputs;
+	static int _sampleCacheMB;
+	static int _noteCacheMB;
+	static int _fileWriteFrames;
+	static int _offlineBufferFrames;
+	static int _frameThreads;
+	static int _parseAheadMsec;
+	static int _threadSpinUsec;
+	static int _outputFifoBuffers;
+	static int _overloadPercent;
+	static int _overloadShedNotes;
+	static int _silenceSleepMsec;
+	static int _silenceThresholdDb;
+	static int _dspStatsInterval;
+	static int _memoryBudget;
+	static int _preconfigureMsec;
 
 	// string options
 	static char _device[];
@@ -280,6 +589,9 @@ private:
 	static char _dsoPath[];
 	static char _homeDir[];
 	static char _rcName[];
+	static char _traceFile[];
+	static char _tableCacheDir[];
+	static char _renderCacheDir[];
 };
 
 extern "C" {
@@ -17,6 +17,7 @@ public:
 	RTSemaphore(unsigned inStartingValue=0) : mSema(dispatch_semaphore_create((long)inStartingValue)) { if (!mSema) { throw -1; }; }
 	~RTSemaphore() { dispatch_release(mSema); mSema = NULL; }
 	void wait() { dispatch_semaphore_wait(mSema, DISPATCH_TIME_FOREVER); }	// each thread will wait on this
+	bool tryWait() { return dispatch_semaphore_wait(mSema, DISPATCH_TIME_NOW) == 0; }	// never blocks
 	void post() { dispatch_semaphore_signal(mSema); }	// when done, each thread calls this
 private:
 	dispatch_semaphore_t	mSema;
@@ -32,6 +33,7 @@ public:
 	RTSemaphore(unsigned inStartingValue=0) { sem_init(&mSema, 0, inStartingValue); }
 	~RTSemaphore() { sem_destroy(&mSema); }
 	void wait() { sem_wait(&mSema); }	// each thread will wait on this
+	bool tryWait() { return sem_trywait(&mSema) == 0; }	// never blocks
 	void post() { sem_post(&mSema); }	// when done, each thread calls this
 private:
 	sem_t	mSema;
@@ -8,6 +8,9 @@
 
 #include "RTThread.h"
 #include <sys/resource.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 
@@ -53,6 +56,12 @@ int RTThread::GetIndexForThread() {
 	return *((int *) mem);
 }
 
+int RTThread::FindIndexForThread() {
+	pthread_once(&sOnceControl, InitOnce);
+	void *mem = pthread_getspecific(sIndexKey);
+	return (mem != NULL) ? *((int *) mem) : -1;
+}
+
 void RTThread::SetIndexForThread(int inIndex) {
 	int *pIndex = new int;
 	*pIndex = inIndex;
@@ -60,6 +69,33 @@ void RTThread::SetIndexForThread(int inIndex) {
 	assert(status == 0);
 }
 
+void RTThread::SetSchedulingForThread(bool inRealtime, int inCore)
+{
+	if (inRealtime) {
+		struct sched_param param;
+		param.sched_priority = sched_get_priority_min(SCHED_RR);
+		// Fails without the privilege to do it; the thread just stays as it was.
+		if (pthread_setschedparam(pthread_self(), SCHED_RR, &param) != 0) {
+#ifdef THREAD_DEBUG
+			perror("RTThread::SetSchedulingForThread: pthread_setschedparam() failed.");
+#endif
+		}
+	}
+#ifdef LINUX
+	if (inCore >= 0) {
+		const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cores > 0 ? inCore % cores : 0, &cpus);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+#ifdef THREAD_DEBUG
+			perror("RTThread::SetSchedulingForThread: pthread_setaffinity_np() failed.");
+#endif
+		}
+	}
+#endif
+}
+
 void RTThread::DestroyMemory(void *value)
 {
 	int *threadMem = (int *) value;
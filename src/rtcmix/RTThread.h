@@ -17,8 +17,13 @@ public:
 	RTThread(int inThreadIndex);
 	virtual ~RTThread();
 	static int	GetIndexForThread();
+	// As above, but -1 if the calling thread is not an RTThread.
+	static int	FindIndexForThread();
 protected:
 	void start();
+	// Give the calling thread the SCHED_RR policy (if <inRealtime>) and
+	// bind it to core <inCore> (if >= 0), where the system allows it.
+	static void	SetSchedulingForThread(bool inRealtime, int inCore);
 	virtual void run()=0;
 	static void *sProcess(void *inContext);
 private:
@@ -35,6 +35,17 @@
 #endif
 #include "rt.h"
 #include "heap.h"
+#include "BufferPool.h"
+#include "InputStream.h"
+#include "SampleCache.h"
+#include "NoteCache.h"
+#include "BusFreeze.h"
+#include "DSPStats.h"
+#include "SchedTrace.h"
+#include "Reaper.h"
+#include "DataFile.h"
+#include "PrintRing.h"
+#include "Preparer.h"
 #include "maxdispargs.h"
 #include "dbug.h"
 #include "globals.h"
@@ -60,6 +71,7 @@ extern "C" {
 
 int				RTcmix::NCHANS 			= 2;
 int				RTcmix::sBufferFrameCount = 0;
+int				RTcmix::sSliceFrameCount = 0;
 int				RTcmix::audioNCHANS 	= 0;
 float			RTcmix::sSamplingRate	= 0.0;
 bool			RTcmix::runToOffset		= false;
@@ -74,10 +86,14 @@ int				RTcmix::audioLoopStarted = 0;
 int				RTcmix::audio_config 	= 1;
 FRAMETYPE		RTcmix::elapsed 		= 0;
 RTstatus		RTcmix::run_status      = RT_GOOD;
+volatile bool	RTcmix::sParsingAhead   = false;
+FRAMETYPE		RTcmix::sNoteStamp      = -1;
 AudioDevice *	RTcmix::audioDevice     = NULL;
 
 heap *			RTcmix::rtHeap			= NULL;
 RTQueue *		RTcmix::rtQueue			= NULL;
+heap *			RTcmix::flushedHeap		= NULL;
+RTQueue *		RTcmix::flushedQueue	= NULL;
 rt_item *		RTcmix::rt_list 		= NULL;
 
 int				RTcmix::output_data_format 		= -1;
@@ -85,10 +101,18 @@ int				RTcmix::output_header_type 		= -1;
 int				RTcmix::normalize_output_floats	= 0;
 int				RTcmix::is_float_format 		= 0;
 char *			RTcmix::rtoutsfname 			= NULL;
+char *			RTcmix::outputPathOverride		= NULL;
+RTcmix::Stem	RTcmix::stems[RTcmix::kMaxStems];
+volatile int	RTcmix::stemCount				= 0;
+BufPtr			RTcmix::stemSilence				= NULL;
 
 BufPtr *		RTcmix::audioin_buffer = NULL;    /* input from ADC, not file */
 BufPtr *		RTcmix::aux_buffer = NULL;
 BufPtr *		RTcmix::out_buffer = NULL;
+BufPtr *		RTcmix::saved_out_buffer = NULL;
+BufPtr *		RTcmix::saved_audioin_buffer = NULL;
+bool *			RTcmix::aux_unwritten = NULL;
+bool *			RTcmix::out_unwritten = NULL;
 
 bool		RTcmix::rtrecord 	= false;		// indicates reading from audio device
 int			RTcmix::rtfileit 	= 0;		// signal writing to soundfile
@@ -120,7 +144,9 @@ short *			RTcmix::ToAuxPlayList = NULL;
 //pthread_mutex_t RTcmix::aux_buffer_lock = PTHREAD_MUTEX_INITIALIZER;
 //pthread_mutex_t RTcmix::out_buffer_lock = PTHREAD_MUTEX_INITIALIZER;
 TaskManager *	RTcmix::taskManager = NULL;
-std::vector<RTcmix::MixData> RTcmix::mixVectors[RT_THREAD_COUNT];
+std::vector<std::vector<RTcmix::MixData> > RTcmix::mixVectors;
+RTcmix::BusMixer *	RTcmix::busMixers = NULL;
+std::vector<RTcmix::BusMixer *> RTcmix::activeMixers;
 #endif
 
 std::vector<RTcmix::CallbackInfo> RTcmix::audioStartCallbacks;
@@ -138,6 +164,7 @@ FunctionEntry *	RTcmix::_functionRegistry = NULL;
 
 // Function table state
 struct _func *	RTcmix::_func_list = NULL;
+unsigned		RTcmix::_dispatchGeneration = 1;
 
 
 /* --------------------------------------------------------- init_options --- */
@@ -173,6 +200,8 @@ RTcmix::init_options(bool fromMain, const char *defaultDSOPath)
 			registerDSOs(SHAREDLIBDIR);
 		else
 			registerDSOs(dsoPath);
+		if (RTOption::preloadDSOs())
+			startPreloadingDSOs();
 	}
 }
 
@@ -181,13 +210,22 @@ void
 RTcmix::init_globals()
 {
    rtcmix_debug(NULL, "RTcmix::init_globals entered");
-   rtHeap = new heap;
+   rtHeap = new heap(!interactive());	// bulk-load until runMainLoop()
    rtQueue = new RTQueue[busCount*3];
+   flushedHeap = new heap;
+   flushedQueue = new RTQueue[busCount*3];
 #ifdef MULTI_THREAD
-   taskManager = new TaskManager;
-    for (int i = 0; i < RT_THREAD_COUNT; ++i) {
+   taskManager = new TaskManager(RTOption::threadCount(), busCount);
+    mixVectors.resize(taskManager->threadCount());
+    for (int i = 0; i < taskManager->threadCount(); ++i) {
         mixVectors[i].reserve(busCount);
     }
+    busMixers = new BusMixer[busCount * 2];
+    activeMixers.reserve(busCount * 2);
+   DSPStats::init(taskManager->threadCount());
+   SchedTrace::init(taskManager->threadCount());
+#else
+   DSPStats::init(0);
 #endif
 	BusConfigs = new BusConfig[busCount];
 	AuxToAuxPlayList = new short[busCount];
@@ -199,11 +237,15 @@ RTcmix::init_globals()
       ToAuxPlayList[i] =-1;     /* The playback order for AUX buses */
    }
 #ifndef EMBEDDED
+	// Input descriptors are pooled (see InputFile.h), so the table can hold
+	// more inputs than we can have files open.
 	max_input_fds = sysconf(_SC_OPEN_MAX);
 	if (max_input_fds == -1)	// call failed
 		max_input_fds = 128;		// what we used to hardcode
 	else
 		max_input_fds -= RESERVE_INPUT_FDS;
+	if (max_input_fds < MAX_INPUT_FILES)
+		max_input_fds = MAX_INPUT_FILES;
 #else
 	// BGGx -- the above doesn't work for rtcmix~ on Big Sur and
 	// following OSes.  I'm reverting to our older hard-coded number,
@@ -214,12 +256,17 @@ RTcmix::init_globals()
 	last_input_index = -1;
 	
    init_buf_ptrs();
+	Reaper::start();
+#ifndef EMBEDDED
+	PrintRing::start();		// embedded hosts are printed to by checkForPrint()
+#endif
 }
 
 void
 RTcmix::free_globals()
 {
 	rtcmix_debug(NULL, "RTcmix::free_globals entered");
+	Preparer::stop();
 	free_buffers();
 	free_bus_config();
 	freefuncs();
@@ -228,6 +275,14 @@ RTcmix::free_globals()
 	rtQueue = NULL;
 	delete rtHeap;
 	rtHeap = NULL;
+	reclaimFlushed(-1);
+	Reaper::stop();		// after the last notes are unref'd above
+	DataFile::stopAsyncWrites();	// after their monitor pfields are gone
+	delete [] flushedQueue;
+	flushedQueue = NULL;
+	delete flushedHeap;
+	flushedHeap = NULL;
+	InputStream::stopPrefetching();
 	delete [] inputFileTable;
 	inputFileTable = NULL;
 	
@@ -239,6 +294,10 @@ RTcmix::free_globals()
 	ToAuxPlayList = NULL;
 	delete [] BusConfigs;
 	BusConfigs = NULL;
+	BufferPool::purge();
+	SampleCache::purge();
+	SchedTrace::finish();
+	DSPStats::destroy();
 	
 	// Reset state of all global vars
 	runToOffset				= false;
@@ -257,9 +316,12 @@ RTcmix::free_globals()
 #ifdef MULTI_THREAD
 	delete taskManager;
 	taskManager = NULL;
+	delete [] busMixers;
+	busMixers = NULL;
+	activeMixers.clear();
 	InputFile::destroyConversionBuffers();
 #endif
-
+	PrintRing::stop();
 }
 
 /* ----------------------------------------------------- detect_denormals --- */
@@ -682,10 +744,67 @@ int RTcmix::startAudio(AudioDeviceCallback renderCallback, AudioDeviceCallback d
 
 #include "EmbeddedAudioDevice.h"
 
+// The host's block is rendered as one or more buffers of up to bufsamps()
+// frames, each taken from and written to its own part of the host's buffers,
+// so that a block of any size costs no latency beyond its own.  Notes see the
+// same frame clock however the host cuts it up; only the times at which
+// their control-rate updates fall may shift, as they do for a note starting
+// partway into a buffer.  With aligned_blocks, which renders whole blocks,
+// the host's block must be a multiple of bufsamps().
+//
+// If the host's output buffers are in our own format, point the output buses
+// at them for the length of each buffer, so that the final bus mix sums
+// straight into host memory and the device has nothing left to copy.
+// Likewise the audio input buses read the host's input buffers where they
+// are, so that instruments reading live input with rtgetinchans() see the
+// host's samples with no copy at all -- except for any input buffer the host
+// also passes as an output (Pd and Max may process in place), which the bus
+// mix would overwrite while notes still read it.  Not with aligned_blocks,
+// which needs the second half of our own bus buffers.
+
 int RTcmix::runAudio(void *inAudioBuffer, void *outAudioBuffer, int frameCount)
 {
 	EmbeddedAudioDevice *device = (EmbeddedAudioDevice *) audioDevice;
-	return (device && device->run(inAudioBuffer, outAudioBuffer, frameCount) == true) ? 0 : -1;
+	if (device == NULL)
+		return -1;
+	const int maxSlice = bufsamps();
+	if (RTOption::alignedBlocks() && frameCount % maxSlice != 0)
+		return die("runAudio", "With aligned_blocks, the frame count (%d) must be "
+				   "a multiple of the vector size (%d)", frameCount, maxSlice);
+	const bool direct = device->isDirectOutput() && !RTOption::alignedBlocks();
+	const int deviceChans = (NCHANS < device->outputChannels()) ? NCHANS : device->outputChannels();
+	BufPtr *savedOut = saved_out_buffer;
+	BufPtr *savedIn = saved_audioin_buffer;
+	BufPtr *hostOut = (BufPtr *) outAudioBuffer;
+	BufPtr *hostIn = (BufPtr *) inAudioBuffer;
+	const int directChans = (outAudioBuffer != NULL && direct) ? deviceChans : 0;
+	const int directInChans = (inAudioBuffer != NULL && direct && RTOption::record()) ? deviceChans : 0;
+	for (int ch = 0; ch < directChans; ++ch)
+		savedOut[ch] = out_buffer[ch];
+	for (int ch = 0; ch < directInChans; ++ch)
+		savedIn[ch] = audioin_buffer[ch];
+
+	bool ran = true;
+	for (int offset = 0; ran && offset < frameCount; offset += maxSlice) {
+		sSliceFrameCount = (frameCount - offset < maxSlice) ? frameCount - offset : maxSlice;
+		for (int ch = 0; ch < directChans; ++ch)
+			out_buffer[ch] = hostOut[ch] + offset;
+		for (int ch = 0; ch < directInChans; ++ch) {
+			bool lend = (savedIn[ch] != NULL);
+			for (int out = 0; out < directChans && lend; ++out)
+				lend = (hostIn[ch] != hostOut[out]);
+			if (lend)
+				audioin_buffer[ch] = hostIn[ch] + offset;
+		}
+		ran = device->run(inAudioBuffer, outAudioBuffer, sSliceFrameCount, offset);
+	}
+	sSliceFrameCount = maxSlice;
+
+	for (int ch = 0; ch < directChans; ++ch)
+		out_buffer[ch] = savedOut[ch];
+	for (int ch = 0; ch < directInChans; ++ch)
+		audioin_buffer[ch] = savedIn[ch];
+	return ran ? 0 : -1;
 }
 
 #endif
@@ -703,6 +822,9 @@ void RTcmix::close()
 	AudioDevice *dev = audioDevice;
 	audioDevice = NULL;
 	delete dev;
+	closeStems();
+	NoteCache::purge();
+	BusFreeze::finish();
 	audio_config = NO;
 	free_buffers();
 #ifdef MULTI_THREAD
@@ -16,6 +16,7 @@ extern "C" void set_SR(float);
 
 class Instrument;
 class PFieldSet;
+class InputStream;
 class RTQueue;
 class heap;
 class AudioDevice;
@@ -81,17 +82,67 @@ public:
     static bool usingOSC() { return rtUsingOSC; }
     static void setUseOSC(bool useOSC) { rtUsingOSC = useOSC; }
     static int bufsamps() { return sBufferFrameCount; }         // Replaces "RTBUFSAMPS"
+	// Frames in the buffer being rendered: bufsamps(), or fewer for the last
+	// part of a host block that is not a multiple of it (see runAudio()).
+	static int sliceFrames() { return sSliceFrameCount; }
     static float sr() { return sSamplingRate; }                 // Replaces "SR"
 	static int chans() { return NCHANS; }
 	static void setBufTimeOffset(float inOffset, bool inRunToOffset);
-	static FRAMETYPE getElapsedFrames() { return elapsed + bufsamps(); }
+	static FRAMETYPE getElapsedFrames() { return elapsed + sliceFrames(); }
 	static bool outputOpen() { return rtfileit != -1; }
 	static bool rtsetparams_was_called() { return rtsetparams_called; }
+
+	// Score streaming ("parse-ahead").  The parser runs on its own thread
+	// while the audio loop plays whatever it has scheduled so far.  Scores
+	// are assumed to be in (roughly) time order: the audio loop does not
+	// render a buffer until a note starting at or after its end has been
+	// scheduled, or the parse is done.
+	static void beginParseAhead();
+	static void endParseAhead(int parseStatus);
+	static bool parsingAhead() { return sParsingAhead; }
+	static void advanceParseHorizon(FRAMETYPE startFrame);
+
+	// Immediate notes.  While a note stamp is set (by RTcmix_parseScoreAt()),
+	// interactive notes start their start times after the frame <frameOffset>
+	// into the next buffer, rather than after the end of it, and skip the
+	// heap: they go into a ring which inTraverse empties straight into the
+	// rtQueues.  A negative offset clears the stamp.  postImmediate()
+	// returns false if the ring is full.
+	static void setNoteStamp(int frameOffset)
+		{ sNoteStamp = (frameOffset < 0) ? -1 : elapsed + frameOffset; }
+	static FRAMETYPE noteStamp() { return sNoteStamp; }
+	static bool postImmediate(Instrument *inst, FRAMETYPE startFrame);
 	
 	static int registerFunction(const char *funcName, const char *dsoPath);
+	// With the preload_dsos option, wait for the DSOs being opened in the
+	// background to be ready, and load every one not loaded yet.  Call this
+	// from the thread that will parse, before parsing.
+	static void finishPreloadingDSOs();
 	static void printargs(const char *funcname, const Arg arglist[], const int nargs);
 	static int dispatch(const char *func_label, const Arg arglist[],
 						const int nargs, Arg *retval);
+	// The function or instrument a name resolved to.  A caller that makes
+	// the same call over and over (the MinC parser, for one) can keep one
+	// of these and hand it to dispatch() to skip the name lookup.  It is
+	// looked up again after any function or instrument is added or the
+	// tables are cleared.
+	struct DispatchTarget {
+		DispatchTarget() : func(NULL), inst(NULL), generation(0) {}
+		struct _func *	func;
+		rt_item *		inst;
+		unsigned		generation;
+	};
+	static int dispatch(const char *func_label, DispatchTarget *target,
+						const Arg arglist[], const int nargs, Arg *retval);
+	// Make <nnotes> calls to <func_label>, for front ends that have a whole
+	// batch of notes at once.  Argument n of each call is <fixed>[n], or if
+	// <columns>[n] is not NULL, that call's entry in it.  Stops at the first
+	// call that fails, and returns its status, or else 0.  The number of
+	// calls that succeeded is returned in <pDone>.  Instrument Handles are
+	// not returned.
+	static int dispatchMany(const char *func_label, const Arg fixed[],
+							const double *const columns[], const int nargs,
+							const int nnotes, int *pDone);
 	static void addfunc(const char *func_label,
 					   double (*func_ptr_legacy)(double*, int),
                        double (*func_ptr_number)(const Arg[], int),
@@ -100,6 +151,16 @@ public:
                        int    return_type,
                        int    legacy);
 	static int addrtInst(rt_item *);
+	static rt_item *findInst(const char *instname);
+
+	// Bucket index into the function, instrument and DSO-registry hash tables
+	enum { NameHashSize = 256 };
+	static unsigned nameHash(const char *name) {
+		unsigned h = 5381;
+		while (*name)
+			h = h * 33 + (unsigned char) *name++;
+		return h & (NameHashSize - 1);
+	}
 	
 	// These are called by Instrument class -- can it be done using friends?
 	// Config
@@ -111,16 +172,29 @@ public:
 	static int attachInput(float inputSkip, InputState *instInput);
 	static void readFromAuxBus(BufPtr dest, int dest_chans, int dest_frms, const short src_chan_list[], short src_chans, int output_offset);
 	static void readFromAudioDevice(BufPtr dest, int dest_chans, int dest_frms, const short src_chan_list[], short src_chans, int output_offset);
+	static bool auxBusIsSilent(int bus) { return aux_unwritten[bus]; }
+	// A note in <slot> has a pfield reading aux <bus>; see bus_config.cpp.
+	static void addBusReader(int bus, const BusSlot *slot, const char *instname);
+	// The aux bus itself from <output_offset> on, or NULL if it is silent.
+	static const BUFTYPE *auxBusFrames(int bus, int output_offset) {
+		return aux_unwritten[bus] ? NULL : aux_buffer[bus] + output_offset;
+	}
+	// The audio input bus from <output_offset> on.
+	static const BUFTYPE *audioInFrames(int chan, int output_offset) {
+		return audioin_buffer[chan] + output_offset;
+	}
+	static bool inputIsSilent(bool fromAudioDevice, const short src_chan_list[], short src_chans, int output_offset, int frames, BUFTYPE threshold);
 
 	/* ------------------------------------------------- get_last_input_index --- */
 	/* Called by rtsetinput to find out which file to set for the inst.
 	 */
 	static int get_last_input_index() { return last_input_index; }
 	static off_t seekInputFile(int fdIndex, int frames, int chans, int whence);
-	static void readFromInputFile(BufPtr dest, int dest_chans, int dest_frms, const short src_chan_list[], short src_chans, int fdIndex, off_t *outFileOffset);
+	static void readFromInputFile(BufPtr dest, int dest_chans, int dest_frms, const short src_chan_list[], short src_chans, int fdIndex, off_t *outFileOffset, InputStream *stream=NULL);
 	static void rtgetsamps(AudioDevice *inputDevice);
 	// Output	   
-	static void addToBus(BusType type, int bus, BufPtr buf, int offset, int endfr, int chans);
+	static void addToBus(BusType type, int bus, BufPtr buf, int offset, int endfr, int chans,
+						 unsigned order);
 #ifdef MULTI_THREAD
     static void mixToBus();
 #endif
@@ -155,6 +229,9 @@ public:
 	static double rtsetparams(double*, int);
 	static double rtinput(double*, int);
 	static double rtoutput(double*, int);
+	static double rtstemoutput(double*, int);
+	static double bus_freeze(double*, int);
+	static double set_polyphony(double*, int);
 	static double set_option(double *, int);
 	static double bus_config(double*, int);
 	static double offset(double *, int);
@@ -175,7 +252,7 @@ protected:
 	static void init_globals();
 
 	static void setSR(float sr) { sSamplingRate = sr; }
-    static void setRTBUFSAMPS(int samps) { sBufferFrameCount = samps; }
+    static void setRTBUFSAMPS(int samps) { sBufferFrameCount = sSliceFrameCount = samps; }
 
 	// Cleanup methods
 	static void free_globals();
@@ -186,17 +263,32 @@ protected:
 	int waitForMainLoop();
 
 	static void resetHeapAndQueue();
+	// Unref up to <maxNotes> of the notes flushed by resetHeapAndQueue(), or
+	// all of them if < 0.  Returns true if any are left.
+	static bool reclaimFlushed(int maxNotes);
+	static void relieveOverload();
+	static void limitVoices(Instrument *inst, FRAMETYPE start);
 
 	// These were standalone but are now static methods
 	static int checkInsts(const char *instname, const Arg arglist[], const int nargs, Arg *retval);
 	static int checkfunc(const char *funcname, const Arg arglist[], const int nargs, Arg *retval);
 	static int findAndLoadFunction(const char *funcname);
+	static struct _func *findfunc(const char *funcname);
+	static int callfunc(struct _func *func, const char *funcname, const Arg arglist[], const int nargs, Arg *retval);
+	static int startInst(rt_item *item, const Arg arglist[], const int nargs, Arg *retval);
+	// The bodies of the two dispatch() methods, which wrap them to save
+	// top-level calls in a score image.
+	static int dispatchByName(const char *func_label, const Arg arglist[],
+							  const int nargs, Arg *retval);
+	static int dispatchTarget(const char *func_label, DispatchTarget *target,
+							  const Arg arglist[], const int nargs, Arg *retval);
 	static void freefuncs();
 	static FRAMETYPE getElapsed() { return elapsed; }
 
 protected:
 	static int 		NCHANS;
 	static int 		sBufferFrameCount;
+	static int		sSliceFrameCount;
 	static float 	sSamplingRate;
 	
 	static int		rtInteractive;
@@ -207,14 +299,31 @@ protected:
 
 	static AudioDevice *audioDevice;
 
+	// Set by the score server (CMIX --serve): rtoutput() writes here, and
+	// takes only the header type from the name the score gives.
+	static char *	outputPathOverride;
+
 	static RTstatus	run_status;
 
+	static bool		waitForParseHorizon(FRAMETYPE frame);
+	static volatile bool sParsingAhead;
+	static FRAMETYPE	sNoteStamp;		// -1 unless parsing with a stamp
+
+	// Preroll for rtoffset: unref the notes that cannot be heard at
+	// <offsetFrame>, returning how many, and move the clock past buffers
+	// with nothing to render.
+	static int		prunePreroll(FRAMETYPE offsetFrame, bool withTails);
+	static void		skipIdleBuffers(FRAMETYPE limit);
+
 	static pthread_mutex_t audio_config_lock;
 
 	// BGG -- used for the [flush] message (flush_sched()/resetQueueHeap())
 	// DT:  main heap structure used to queue instruments
 	static heap *rtHeap;
 	static RTQueue *rtQueue;
+	// What the last flush took out of them, until reclaimFlushed() is done.
+	static heap *flushedHeap;
+	static RTQueue *flushedQueue;
 
 private:
     struct CallbackInfo {
@@ -238,11 +347,14 @@ private:
     static void clearRtInstList();
 
 	static int registerDSOs(const char *dsoPaths);
+	static void startPreloadingDSOs();
 
 	// Internal audio loop methods (called by runMainLoop())
 	
 	static int rtsendsamps(AudioDevice *);
 	static int rtwritesamps(AudioDevice *);
+	static int rtsendstems();
+	static void closeStems();
 	static void limiter(BUFTYPE peaks[], long peaklocs[]);
 	static int rtsendzeros(AudioDevice *device, int);
 	static void rtreportstats(AudioDevice *);
@@ -254,8 +366,13 @@ private:
 	static void init_buf_ptrs();
 	static void clear_aux_buffers();
 	static void clear_output_buffers();
+	static void zero_unwritten_out_buffers();
+	static bool begin_bus_write(bool aux, int bus, int offset, int endfr);
 	
 	friend void set_SR(float);	// hack to allow C code to initialize SR
+	friend class BusFreeze;		// mixes into and records the aux buses
+	friend class NoteSetup;		// schedules the notes it sets up
+	friend class BusPField;		// reads the aux buses as a pfield
 
 	static int		audioNCHANS;
 
@@ -267,6 +384,19 @@ private:
 	static int		is_float_format;
 	static char *	rtoutsfname;
 
+	// Files opened by rtstemoutput(), each written from a range of buses.
+	enum { kMaxStems = 64 };
+	struct Stem {
+		AudioDevice	*device;
+		bool		aux;		// aux buses, else out buses
+		int			startBus;
+		int			chans;
+		BufPtr		*bufs;		// [chans], filled by rtsendstems
+	};
+	static Stem			stems[kMaxStems];
+	static volatile int	stemCount;
+	static BufPtr		stemSilence;	// stands in for a bus not written to
+
 
 	/* used in intraverse.C, rtsendsamps.c */
 	static bool			runToOffset;
@@ -289,7 +419,7 @@ private:
 	static pthread_mutex_t aux_out_in_use_lock;
 	static pthread_mutex_t out_in_use_lock;
 	static pthread_mutex_t revplay_lock;
-	static pthread_mutex_t bus_slot_lock;
+	static pthread_mutex_t bus_slot_lock;		// serializes changes to the bus config
 	
 	static bool		rtrecord;
 	static int		rtfileit;		// 1 if rtoutput() succeeded
@@ -302,6 +432,12 @@ private:
 	static BufPtr	*audioin_buffer;    /* input from ADC, not file */
 	static BufPtr	*aux_buffer;
 	static BufPtr	*out_buffer;
+	static BufPtr	*saved_out_buffer;	// out_buffer while runAudio() lends it out
+	static BufPtr	*saved_audioin_buffer;	// and audioin_buffer
+	// True for a bus nothing has been mixed into since the last buffer.
+	// Its contents are stale, and stand for silence.
+	static bool		*aux_unwritten;
+	static bool		*out_unwritten;
 #ifdef MULTI_THREAD
 	static TaskManager *taskManager;
 //	static pthread_mutex_t aux_buffer_lock;
@@ -311,11 +447,24 @@ private:
         BufPtr  dest;
         int     frames;
         int     channels;
-        MixData(BufPtr inSrc, BufPtr inDest, int inFrames, int inChans)
-            : src(inSrc), dest(inDest), frames(inFrames), channels(inChans) {}
+        int     mixer;      // index into busMixers[] for the destination bus
+        unsigned order;     // the note's place in the schedule
+        MixData(BufPtr inSrc, BufPtr inDest, int inFrames, int inChans, int inMixer,
+                unsigned inOrder)
+            : src(inSrc), dest(inDest), frames(inFrames), channels(inChans), mixer(inMixer),
+              order(inOrder) {}
+        static bool before(const MixData *a, const MixData *b) { return a->order < b->order; }
+    };
+    // Collects every mix into a single destination bus, so that mixes into
+    // disjoint buses can be run in parallel by the TaskManager.
+    struct BusMixer {
+        std::vector<MixData *> mixes;
+        int mix();
     };
     static void mixOperation(MixData &m);
-    static std::vector<MixData> mixVectors[];
+    static std::vector<std::vector<MixData> > mixVectors;	// one per TaskManager thread
+    static BusMixer *busMixers;				// [busCount * 2]: aux buses, then out buses
+    static std::vector<BusMixer *> activeMixers;
 #endif
 	
 	static short *AuxToAuxPlayList; /* The playback order for AUX buses */
@@ -331,6 +480,8 @@ private:
 	static ErrCode check_bus_inst_config(BusSlot*, Bool);  /* Graph parsing, insertion */
 	static ErrCode print_inst_bus_config();
 	static ErrCode insert_bus_slot(char*, BusSlot*);
+	static void insert_bus_graph(const BusSlot*);
+	static void publish_bus_slots();
 	static void bf_traverse(int bus, Bool visit);
 	static void create_play_order();
 
@@ -357,6 +508,10 @@ private:
 	static struct _func *	_func_list;
 	// End of function table
 
+	// Bumped whenever the function or instrument tables change, so that
+	// DispatchTargets know to look their names up again.
+	static unsigned			_dispatchGeneration;
+
 };
 
 // handy utility function...
@@ -6,12 +6,20 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <arpa/inet.h>
 
 #include "RTcmixMain.h"
+#include "ScoreImage.h"
+#include "Reaper.h"
+#include "PrintRing.h"
 #include <AudioDevice.h>
 #include <RTOption.h>
 #include "version.h"
@@ -74,6 +82,19 @@ usage()
 #endif
       "           -f NAME  read score from NAME instead of stdin\n"
       "                      (Minc and Python only)\n"
+      "           -l MSEC  stream the score: start playing once MSEC worth\n"
+      "                      of it has been parsed\n"
+      "           --write-image NAME  save the parsed score to NAME\n"
+      "           --read-image NAME   play the score saved in NAME instead\n"
+      "                      of parsing one\n"
+      "           --image-part K/N  play only part K (1 to N) of the score\n"
+      "                      image, for mixing with the other N-1 parts\n"
+      "           --output NAME  write to NAME instead of the file given\n"
+      "                      to rtoutput\n"
+      "           --serve PORT  render scores sent to PORT, replying with\n"
+      "                      the sound file each one writes\n"
+      "           --serve-address ADDR  accept scores on ADDR rather than\n"
+      "                      on 127.0.0.1 only\n"
       "           --debug  enter parser debugger (Perl only)\n"
       "           -q       quiet -- suppress print to screen\n"
       "           -Q       really quiet -- not even clipping or peak stats\n"
@@ -124,6 +145,11 @@ int				RTcmixMain::signal_handler_called = 0;
 
 int				RTcmixMain::noParse         = 0;
 int				RTcmixMain::parseOnly       = 0;
+int				RTcmixMain::parseAheadStatus = 0;
+const char *	RTcmixMain::writeImagePath = NULL;
+const char *	RTcmixMain::readImagePath = NULL;
+int				RTcmixMain::servePort		= 0;
+const char *	RTcmixMain::serveAddress	= "127.0.0.1";
 int				RTcmixMain::socknew			= 0;
 
 #ifdef OSC
@@ -371,9 +397,55 @@ RTcmixMain::parseArguments(int argc, char **argv, char **env)
                infile = argv[i];
                use_script_file(infile);
                break;
+            case 'l':     /* parse-ahead latency */
+               if (++i >= argc) {
+                  fprintf(stderr, "You didn't give a parse-ahead latency.\n");
+                  exit(1);
+               }
+               RTOption::parseAheadMsec(atoi(argv[i]));
+               break;
             case '-':           /* accept "--debug" and pass to Perl as "-d" */
                if (strncmp(&arg[2], "debug", 10) == 0)
                   xargv[xargc++] = strdup("-d");
+               else if (strcmp(&arg[2], "write-image") == 0
+                        || strcmp(&arg[2], "read-image") == 0) {
+                  if (++i >= argc) {
+                     fprintf(stderr, "You didn't give a score image file name.\n");
+                     exit(1);
+                  }
+                  if (arg[2] == 'w')
+                     writeImagePath = argv[i];
+                  else
+                     readImagePath = argv[i];
+               }
+               else if (strcmp(&arg[2], "image-part") == 0) {
+                  int part = 0, parts = 0;
+                  if (++i >= argc || sscanf(argv[i], "%d/%d", &part, &parts) != 2
+                        || ScoreImage::setPart(part - 1, parts) != 0) {
+                     fprintf(stderr, "You didn't give a part like 2/4.\n");
+                     exit(1);
+                  }
+               }
+               else if (strcmp(&arg[2], "output") == 0) {
+                  if (++i >= argc) {
+                     fprintf(stderr, "You didn't give an output file name.\n");
+                     exit(1);
+                  }
+                  outputPathOverride = argv[i];
+               }
+               else if (strcmp(&arg[2], "serve") == 0) {
+                  if (++i >= argc || (servePort = atoi(argv[i])) <= 0) {
+                     fprintf(stderr, "You didn't give a port number to serve on.\n");
+                     exit(1);
+                  }
+               }
+               else if (strcmp(&arg[2], "serve-address") == 0) {
+                  if (++i >= argc) {
+                     fprintf(stderr, "You didn't give an address to serve on.\n");
+                     exit(1);
+                  }
+                  serveAddress = argv[i];
+               }
 			   else
 				   xargv[xargc++] = arg;    /* copy all other --arguments to parser */
                break;
@@ -513,6 +585,222 @@ Failed:
 
 #ifndef EMBEDDED
 
+// Parse the score -- or play the score image given with --read-image in
+// its place -- saving it if --write-image was given.
+
+int     RTcmixMain::parseScore()
+{
+    if (readImagePath != NULL)
+        return ScoreImage::play(readImagePath);
+    if (ScoreImage::parts() > 1)
+        rtcmix_warn("RTcmixMain", "--image-part is only used with --read-image");
+    if (writeImagePath != NULL)
+        ScoreImage::record(writeImagePath);
+    int status = ::parse_score(xargc, xargv, xenv);
+    if (writeImagePath != NULL) {
+        if (status != 0)
+            ScoreImage::invalidate("the score did not parse");
+        ScoreImage::finish();
+    }
+    return status;
+}
+
+void *
+RTcmixMain::parseAheadThread(void *)
+{
+    parseAheadStatus = parseScore();
+    rtcmix_debug("RTcmixMain", "parseAheadThread: parse returned status %d", parseAheadStatus);
+    RTcmix::endParseAhead(parseAheadStatus);
+    return NULL;
+}
+
+// Parse the score on a thread of its own, and play what it schedules as it
+// goes, rather than waiting for all of it.  Returns the parse status.
+
+int     RTcmixMain::runParsingAhead()
+{
+    pthread_t   parseThread;
+    beginParseAhead();
+    rtcmix_debug("RTcmixMain", "creating parseAheadThread() thread");
+    int retcode = pthread_create(&parseThread, NULL, &RTcmixMain::parseAheadThread, (void *) this);
+    if (retcode != 0) {
+        rterror("RTcmixMain", "parseAheadThread() thread create failed\n");
+        return -1;
+    }
+    rtcmix_debug("RTcmixMain", "runParsingAhead: calling runMainLoop()");
+    if (runMainLoop() == 0) {
+        rtcmix_debug("RTcmixMain", "runParsingAhead: calling waitForMainLoop()");
+        waitForMainLoop();
+    }
+    rtcmix_debug("RTcmixMain", "joining parseAheadThread() thread");
+    if (pthread_join(parseThread, NULL) != 0) {
+        rterror(NULL, "parseAheadThread() thread join failed\n");
+    }
+    return parseAheadStatus;
+}
+
+// Score server (--serve PORT).  The server sets itself up once -- options,
+// .rtcmixrc, DSO registration and preloading -- and then forks a copy of
+// itself for each connection.  A client sends a score and closes its end
+// for writing (e.g., "nc -N host PORT < x.sco > x.wav"); the copy renders
+// it as CMIX would, and replies with the sound file the score wrote, or
+// with nothing if it failed (the server's output says why).  Each render
+// starts from the server's state as it was before any score ran, so
+// nothing one score does can affect the next.
+//
+// A score can run any command (Minc's system(), for one), so the server
+// listens only on the loopback address unless --serve-address says
+// otherwise.
+
+#define SERVE_DIR_TEMPLATE "/tmp/rtcmix-serve-XXXXXX"
+
+// A score that fails to parse exits the copy from deep in the parser, so
+// its directory is also removed at exit.
+
+static char sServeDir[] = SERVE_DIR_TEMPLATE;
+
+static void
+removeServeDir()
+{
+    char path[sizeof(sServeDir) + 16];
+    snprintf(path, sizeof(path), "%s/output", sServeDir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/score", sServeDir);
+    unlink(path);
+    rmdir(sServeDir);
+}
+
+int     RTcmixMain::runServing()
+{
+#ifdef MULTI_THREAD
+    // The TaskManager's threads would not survive the fork.
+    rterror("RTcmixMain", "--serve is not available in multi-threaded builds");
+    return 1;
+#else
+    if (writeImagePath != NULL || readImagePath != NULL) {
+        rtcmix_warn("RTcmixMain", "Score images are not used in server mode");
+        writeImagePath = readImagePath = NULL;
+    }
+    // A server renders to files; scores can still turn playing back on.
+    RTOption::play(false);
+
+    int s = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) {
+        perror("socket");
+        return 1;
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in sss;
+    memset(&sss, 0, sizeof(sss));
+    sss.sin_family = AF_INET;
+    if (inet_pton(AF_INET, serveAddress, &sss.sin_addr) != 1) {
+        rterror("RTcmixMain", "'%s' is not an IPv4 address to serve on", serveAddress);
+        return 1;
+    }
+    sss.sin_port = htons(servePort);
+    if (::bind(s, (struct sockaddr *)&sss, sizeof(sss)) < 0) {
+        perror("bind");
+        return 1;
+    }
+    listen(s, 16);
+    if (ntohl(sss.sin_addr.s_addr) >> 24 != 127)
+        rtcmix_warn("RTcmixMain", "Anyone who can reach %s can run commands as this user", serveAddress);
+    rtcmix_advise("RTcmixMain", "Serving scores on %s port %d", serveAddress, servePort);
+
+    for (;;) {
+        int ns = ::accept(s, NULL, NULL);
+        // Collect any renders that have finished.
+        while (waitpid(-1, NULL, WNOHANG) > 0)
+            ;
+        if (ns < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("RTcmixMain::runServing: accept");
+            return 1;
+        }
+        fflush(NULL);       // or the copy would write it out again
+        pid_t pid = fork();
+        if (pid == 0) {
+            ::close(s);
+            Reaper::restartAfterFork();
+            PrintRing::restartAfterFork();
+            const int status = serveRender(ns);
+            PrintRing::stop();
+            fflush(NULL);
+            _exit(status);
+        }
+        if (pid < 0)
+            perror("RTcmixMain::runServing: fork");
+        ::close(ns);
+    }
+#endif
+}
+
+// Runs in the forked copy: read a score from <sock>, render it, send back
+// what it wrote.  Returns the exit status for the copy.
+
+int     RTcmixMain::serveRender(int sock)
+{
+    char *dir = sServeDir;
+    if (mkdtemp(dir) == NULL) {
+        perror("RTcmixMain::serveRender: mkdtemp");
+        return 1;
+    }
+    atexit(removeServeDir);
+    char scorePath[sizeof(sServeDir) + 16], outputPath[sizeof(sServeDir) + 16];
+    snprintf(scorePath, sizeof(scorePath), "%s/score", dir);
+    snprintf(outputPath, sizeof(outputPath), "%s/output", dir);
+
+    int status = 0;
+    FILE *score = fopen(scorePath, "w");
+    if (score == NULL)
+        status = 1;
+    else {
+        char buf[8192];
+        ssize_t amt;
+        while ((amt = read(sock, buf, sizeof(buf))) > 0)
+            if (fwrite(buf, 1, amt, score) != (size_t) amt)
+                status = 1;
+        if (amt < 0 || fclose(score) != 0)
+            status = 1;
+    }
+    if (status == 0) {
+        outputPathOverride = outputPath;
+        ::use_script_file(scorePath);
+        if (RTOption::parseAheadMsec() > 0)
+            status = runParsingAhead();
+        else if ((status = parseScore()) == 0) {
+            if (runMainLoop() == 0)
+                waitForMainLoop();
+        }
+        ::closesf_noexit();
+    }
+    // Send the sound file, if the score wrote one.
+    int fd = (status == 0) ? open(outputPath, O_RDONLY) : -1;
+    if (fd >= 0) {
+        char buf[65536];
+        ssize_t amt;
+        while ((amt = read(fd, buf, sizeof(buf))) > 0) {
+            ssize_t sent = 0;
+            while (sent < amt) {
+                ssize_t n = write(sock, buf + sent, amt - sent);
+                if (n <= 0)
+                    break;
+                sent += n;
+            }
+            if (sent < amt) {
+                status = 1;
+                break;
+            }
+        }
+        ::close(fd);
+    }
+    ::close(sock);
+    removeServeDir();
+    return status;
+}
+
 void
 RTcmixMain::run()
 {
@@ -522,11 +810,18 @@ RTcmixMain::run()
         thread, and the scheduler and instrument code go in another.
 
         When not in interactive mode, RTcmix parses the score, schedules
-        all instruments, and then plays them -- in that order.
+        all instruments, and then plays them -- in that order.  Unless the
+        parse_ahead_msec option is set: then the score is parsed in its own
+        thread, and playing starts once that much of it has been scheduled.
     */
+#ifndef EMBEDDED
+    RTcmix::finishPreloadingDSOs();
+#endif
     if (interactive()) {
         int retcode;
          rtcmix_advise("RTcmixMain", "interactive mode set\n");
+        if (writeImagePath != NULL || readImagePath != NULL)
+            rtcmix_warn("RTcmixMain", "Score images are not used in interactive mode");
 #ifdef OSC
         if (usingOSC()) {
             retcode = runUsingOSC();
@@ -537,9 +832,25 @@ RTcmixMain::run()
             retcode = runUsingSockit();
         }
     }
+    else if (servePort > 0)
+    {
+        exit(runServing());
+    }
+    else if (RTOption::parseAheadMsec() > 0 && !parseOnly)
+    {
+        int status = runParsingAhead();
+#ifdef PYTHON
+        set_sig_handlers();
+#endif
+        if (readImagePath == NULL)
+            destroy_parser();
+        ::closesf_noexit();
+        if (status != 0)
+            exit(status);
+    }
     else      // not interactive
     {
-        int status = ::parse_score(xargc, xargv, xenv);
+        int status = parseScore();
         if (parseOnly) {
             rtcmix_debug("RTcmixMain", "run: parse-only returned status %d", status);
             return;
@@ -563,7 +874,8 @@ RTcmixMain::run()
        else {
            exit(status);
        }
-        destroy_parser();        // DAS TODO: make this work?
+        if (readImagePath == NULL)
+            destroy_parser();        // DAS TODO: make this work?
         ::closesf_noexit();
     }
 }
@@ -762,6 +1074,7 @@ RTcmixMain::sockit(void *arg)
           else {
               if ( (strcmp(sinfo->name, "rtinput") == 0) ||
                    (strcmp(sinfo->name, "rtoutput") == 0) ||
+                   (strcmp(sinfo->name, "rtstemoutput") == 0) ||
                    (strcmp(sinfo->name,"set_option") == 0) ||
                    (strcmp(sinfo->name,"bus_config") == 0) ||
                    (strcmp(sinfo->name, "load")==0) ) {
@@ -829,6 +1142,7 @@ RTcmixMain::sockit(void *arg)
 		else {
             if (strcmp(sinfo->name, "rtinput") == 0 ||
                 strcmp(sinfo->name, "rtoutput") == 0 ||
+                strcmp(sinfo->name, "rtstemoutput") == 0 ||
                 strcmp(sinfo->name,"set_option") == 0 ||
                 strcmp(sinfo->name,"bus_config") == 0 ||
                 strcmp(sinfo->name, "load")==0 ) {
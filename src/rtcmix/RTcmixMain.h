@@ -37,6 +37,11 @@ protected:
 	static void *   OSC_Server(void *);
 #endif
     int             runUsingSockit();
+    int             runParsingAhead();
+	static void *	parseAheadThread(void *);
+	static int		parseScore();
+	int				runServing();
+	int				serveRender(int sock);
 private:
 	char *			makeDSOPath(const char *progPath);
 	static int 		xargc;	// local copy of arg count
@@ -46,6 +51,11 @@ private:
 	static int 		signal_handler_called;
 	static int		noParse;
 	static int		parseOnly;
+	static int		parseAheadStatus;
+	static const char *	writeImagePath;	// --write-image: save the parsed score
+	static const char *	readImagePath;	// --read-image: play a saved score
+	static int		servePort;		// --serve: run as a score server
+	static const char *	serveAddress;	// --serve-address: where to listen
 #ifdef NETAUDIO
 	static int		netplay;     // for remote sound network playing
 #endif
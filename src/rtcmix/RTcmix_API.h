@@ -12,6 +12,7 @@ extern "C" {
 	typedef void (*RTcmixValuesCallback)(float *values, int numValues, void *inContext);
 	typedef void (*RTcmixPrintCallback)(const char *printBuffer, void *inContext);
 	typedef void (*RTcmixFinishedCallback)(long long frameCount, void *inContext);
+	typedef void (*RTcmixParseCallback)(int parseID, int status, void *inContext);
 	void RTcmix_setPrintLevel(int level);
 	int RTcmix_init();
 	int RTcmix_destroy();
@@ -20,6 +21,7 @@ extern "C" {
 	void RTcmix_setValuesCallback(RTcmixValuesCallback inValuesCallback, void *inContext);
 	void RTcmix_setPrintCallback(RTcmixPrintCallback inPrintCallback, void *inContext);
 	void RTcmix_setFinishedCallback(RTcmixFinishedCallback inFinishedCallback, void *inContext);
+	void RTcmix_setParseCallback(RTcmixParseCallback inParseCallback, void *inContext);
 #ifdef IOS
 	int RTcmix_startAudio();
 	int RTcmix_stopAudio();
@@ -32,20 +34,90 @@ extern "C" {
 		AudioFormat_24BitInt = 2,				// 24 bit (3-byte) packed integer samples
 		AudioFormat_32BitInt = 4,				// 32 bit (4-byte) integer samples
 		AudioFormat_32BitFloat_Normalized = 8,	// single-precision float samples, scaled between -1.0 and 1.0
-		AudioFormat_32BitFloat = 16				// single-precision float samples, scaled between -32767.0 and 32767.0
+		AudioFormat_32BitFloat = 16,			// single-precision float samples, scaled between -32767.0 and 32767.0
+		AudioFormat_32BitFloat_NonInterleaved = 32,	// as above, but one buffer per channel (pass a float **)
+		AudioFormat_32BitFloat_NonInterleaved_Normalized = 64	// normalized, one buffer per channel
 	} RTcmix_AudioFormat;
 	int RTcmix_setAudioBufferFormat(RTcmix_AudioFormat format, int nchans);
     // Set this to 0 to run non-interactively (i.e., parse the score completely first, then start running audio).
     void RTcmix_setInteractive(int interactive);
-	// Call this to send and receive audio from RTcmix
+	// Call this to send and receive audio from RTcmix.  <nframes> may be any
+	// number, and may change from call to call: RTcmix renders the block as
+	// buffers of up to the vector size, with no added latency (though with
+	// the aligned_blocks option, it must be a multiple of the vector size).
+	// With AudioFormat_32BitFloat_NonInterleaved, RTcmix mixes its output
+	// directly into the buffers given (which may also change from call to
+	// call), with no copy or conversion.
 	int RTcmix_runAudio(void *inAudioBuffer, void *outAudioBuffer, int nframes);
+	// The same, for the two non-interleaved formats: <inputs> and <outputs>
+	// each hold one pointer per channel to <nframes> samples.  RTcmix reads
+	// and writes these buffers in place.
+	int RTcmix_runAudioPlanar(float **inputs, float **outputs, int nframes);
 #endif
 	int RTcmix_parseScore(char *theBuf, int buflen);
+	// Parse as above, but start the notes at their start times after frame
+	// <frameOffset> of the next block passed to RTcmix_runAudio(), rather
+	// than after the next vector, for triggering notes from the host's
+	// scheduler at the sample.  Call it between RTcmix_runAudio() calls, in
+	// interactive mode; notes whose time has already passed start at once.
+	int RTcmix_parseScoreAt(char *theBuf, int buflen, int frameOffset);
+	// Copy <theBuf> and parse it on a thread of RTcmix's own, after any
+	// buffers sent before it.  Returns an ID > 0, which the parse callback
+	// is given along with the parse's status, or -1 on failure.
+	int RTcmix_parseScoreAsync(const char *theBuf, int buflen);
 	void RTcmix_flushScore();
 	int RTcmix_setInputBuffer(char *bufname, float *bufstart, int nframes, int nchans, int modtime);
 	int RTcmix_getBufferFrameCount(char *bufname);
 	int RTcmix_getBufferChannelCount(char *bufname);
+	// What the dsp_stats option has counted so far.  Times are in msec,
+	// and the loads are compute time as a fraction of the buffer duration.
+	typedef struct _RTcmix_Stats {
+		double		dspLoad;			// recent load, smoothed like a meter
+		double		peakLoad;
+		long long	buffers;
+		double		bufferMsec;			// all compute time
+		double		instrumentMsec;		// time in the notes' run()
+		double		toAuxMsec;			// bus passes, including their notes
+		double		auxToAuxMsec;
+		double		toOutMsec;
+		double		mixdownMsec;
+		double		fileReadMsec;
+	} RTcmix_Stats;
+	// Fill in <outStats> and, if <outReport> is not NULL, write a text report
+	// with the time for each instrument into it.  Returns -1 unless the
+	// dsp_stats option is set.
+	int RTcmix_getStats(RTcmix_Stats *outStats, char *outReport, int reportLength);
+	// Heap allocations made on the real-time threads, counted only by builds
+	// made with ALLOC_TRACKING.
+	typedef struct _RTcmix_AllocStats {
+		long long	allocations;
+		long long	buffers;			// buffers in which anything was allocated
+		int			worstBuffer;		// the most allocations in one buffer
+	} RTcmix_AllocStats;
+	// Fill in <outStats> and, if <outReport> is not NULL, write the counts for
+	// each instrument into it.  If <reset>, start counting again from zero.
+	// Returns -1 unless built with ALLOC_TRACKING.
+	int RTcmix_getAllocStats(RTcmix_AllocStats *outStats, char *outReport, int reportLength, int reset);
+	// Memory held by tables, sound file input read into memory, instruments,
+	// buses and Minc lists and maps, in bytes, with the most each has held.
+	typedef struct _RTcmix_MemStats {
+		long long	tableBytes;
+		long long	inputBytes;
+		long long	instrumentBytes;
+		long long	busBytes;
+		long long	mincBytes;
+		long long	totalBytes;
+		long long	peakTotalBytes;
+		long long	peakBytes[5];		// in the order above
+	} RTcmix_MemStats;
+	// Fill in <outStats> and, if <outReport> is not NULL, write a text report
+	// into it, with the memory of each instrument class if the memory_stats
+	// option is set.
+	int RTcmix_getMemStats(RTcmix_MemStats *outStats, char *outReport, int reportLength);
 	void RTcmix_setPField(int inlet, float pval);
+	// Set inlets <first> through <first> + <count> - 1 from <vals>, skipping
+	// any whose value has not changed.  Returns -1 if any are out of range.
+	int RTcmix_setPFields(const float *vals, int first, int count);
 	void pfield_set(int inlet, float pval);
 #ifdef MAXMSP
 	void loadinst(char *dsoname);
@@ -54,6 +126,7 @@ extern "C" {
 	void checkForBang();
 	void checkForVals();
 	void checkForPrint();
+	void checkForParsed();
 	void notifyIsFinished(long long);
 #ifdef __cplusplus
 }
@@ -173,6 +173,7 @@ void RTsendsock(const char *cmd, int theSock, int nargs, ...)
 	va_start(ap, nargs);
     if ( (strcmp(ssend.name, "rtinput") == 0) ||
 			(strcmp(ssend.name, "rtoutput") == 0) ||
+			(strcmp(ssend.name, "rtstemoutput") == 0) ||
 			(strcmp(ssend.name,"set_option") == 0) ||
 			(strcmp(ssend.name,"bus_config") == 0) ||
 			(strcmp(ssend.name, "load")==0) ||
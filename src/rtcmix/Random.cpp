@@ -4,6 +4,8 @@
 */
 
 #include "Random.h"
+#include <Ougens.h>
+#include <RTOption.h>
 #include <math.h>
 #include <assert.h>
 
@@ -17,11 +19,39 @@ inline double dmin(double x, double y) { return (x < y) ? x : y; }
 
 // Base class -----------------------------------------------------------------
 
-Random::~Random() {}
+Random::Random(double min, double max, int seed)
+	: _noise(NULL), _min(min), _max(max), _mid(0), _tight(0)
+{
+	if (RTOption::blockNoise())
+		_noise = new Orandblock;
+	setseed(seed);
+}
+
+Random::Random(double min, double max, double mid, double tight, int seed)
+	: _noise(NULL), _min(min), _max(max), _mid(mid), _tight(tight)
+{
+	if (RTOption::blockNoise())
+		_noise = new Orandblock;
+	setseed(seed);
+}
+
+Random::~Random()
+{
+	delete _noise;
+}
+
+void Random::setseed(const int aseed)
+{
+	_randx = (long) aseed;
+	if (_noise)
+		_noise->seed(aseed);
+}
 
 // Return a random number in range [0, 1]
 inline double Random::rawvalue()
 {
+	if (_noise)
+		return _noise->random();
 	_randx = (_randx * 1103515245) + 12345;
 	long k = (_randx >> 16L) & 077777;
 	return (double) k / 32768.0;
@@ -12,6 +12,8 @@
 
 #include <RefCounted.h>
 
+class Orandblock;
+
 enum {
 	kLinearRandom = 0,
 	kLowLinearRandom,
@@ -26,13 +28,11 @@ enum {
 
 class Random : public RefCounted {
 public:
-	Random(double min, double max, int seed)
-		: _min(min), _max(max), _mid(0), _tight(0) { setseed(seed); }
-	Random(double min, double max, double mid, double tight, int seed)
-		: _min(min), _max(max), _mid(mid), _tight(tight) { setseed(seed); }
+	Random(double min, double max, int seed);
+	Random(double min, double max, double mid, double tight, int seed);
 	virtual ~Random();
 	virtual double value() = 0;	// NB: not const, because it changes _randx
-	void setseed(const int aseed) { _randx = (long) aseed; }
+	void setseed(const int aseed);
 	void setmin(const double min) { _min = min; }
 	void setmax(const double max) { _max = max; }
 	void setmid(const double mid) { _mid = mid; }
@@ -46,6 +46,7 @@ protected:
 	double gettight() const { return _tight; }
 private:
 	long _randx;
+	Orandblock *_noise;		// non-NULL with the block_noise option
 	double _min;
 	double _max;
 	double _mid;
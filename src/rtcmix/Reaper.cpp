@@ -0,0 +1,102 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// Reaper.cpp -- deleting instruments, and the like, off the audio thread.
+// See Reaper.h.
+
+#include "Reaper.h"
+#include "RTSemaphore.h"
+#include <RefCounted.h>
+#include <ugens.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+
+static RefCounted * volatile sDead = NULL;	// pushed by add()
+static RTSemaphore *sWake = NULL;
+static pthread_t sThread;
+static volatile bool sRunning = false;
+static volatile bool sStopping = false;
+static volatile int sAdding = 0;			// callers inside add()
+
+void Reaper::start()
+{
+#ifndef USE_OSX_DISPATCH
+	if (sRunning)
+		return;
+	sStopping = false;
+	sWake = new RTSemaphore(0);
+	if (pthread_create(&sThread, NULL, threadMain, NULL) != 0) {
+		rterror("Reaper", "Could not create the thread -- instruments will be deleted as they finish");
+		delete sWake;
+		sWake = NULL;
+		return;
+	}
+	__sync_synchronize();
+	sRunning = true;
+#endif
+}
+
+void Reaper::stop()
+{
+	if (!sRunning)
+		return;
+	sRunning = false;		// from here on, callers delete for themselves
+	__sync_synchronize();
+	while (sAdding > 0)
+		usleep(100);
+	sStopping = true;
+	sWake->post();
+	pthread_join(sThread, NULL);
+	reap();					// anything added while we were stopping
+	delete sWake;
+	sWake = NULL;
+}
+
+void Reaper::restartAfterFork()
+{
+	if (!sRunning)
+		return;
+	sRunning = false;
+	sAdding = 0;
+	delete sWake;
+	sWake = NULL;
+	start();
+}
+
+bool Reaper::add(RefCounted *inObject)
+{
+	__sync_fetch_and_add(&sAdding, 1);
+	if (!sRunning) {
+		__sync_fetch_and_sub(&sAdding, 1);
+		return false;
+	}
+	RefCounted *head;
+	do {
+		head = sDead;
+		inObject->_nextDead = head;
+	} while (!__sync_bool_compare_and_swap(&sDead, head, inObject));
+	sWake->post();
+	__sync_fetch_and_sub(&sAdding, 1);
+	return true;
+}
+
+void Reaper::reap()
+{
+	RefCounted *dead = __sync_lock_test_and_set(&sDead, (RefCounted *) NULL);
+	while (dead != NULL) {
+		RefCounted *next = dead->_nextDead;
+		delete dead;
+		dead = next;
+	}
+}
+
+void *Reaper::threadMain(void *)
+{
+	while (!sStopping) {
+		sWake->wait();
+		reap();			// wakes left over from a batch find nothing
+	}
+	return NULL;
+}
@@ -0,0 +1,36 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _REAPER_H_
+#define _REAPER_H_ 1
+
+class RefCounted;
+
+// An ordinary, non-real-time thread that deletes finished instruments, so that their
+// destructors -- and the freeing of their delay lines, FFT buffers and
+// such -- do not run on the audio thread when a burst of notes ends there.
+// The last unref() of an instrument, or of any RefCounted made with
+// dispatchOnDelete, pushes it onto a lock-free list and wakes the thread;
+// nothing is locked or freed by the caller.
+//
+// Builds made with USE_OSX_DISPATCH hand instruments to a dispatch queue
+// instead (see RefCounted), and never start this thread.
+
+class Reaper {
+public:
+	static void		start();
+	// Delete whatever is still waiting, and stop the thread.
+	static void		stop();
+	// Called in the child of a fork(), which has none of the parent's
+	// threads: start a thread of its own if the parent had one.
+	static void		restartAfterFork();
+	// Returns false if the thread is not running, in which case the caller
+	// must delete <inObject> itself.
+	static bool		add(RefCounted *inObject);
+private:
+	static void		reap();
+	static void *	threadMain(void *);
+};
+
+#endif	// _REAPER_H_
@@ -7,6 +7,7 @@
 #include <dispatch/dispatch.h>
 #endif
 #include <ugens.h>
+#include "Reaper.h"
 
 RefCounted::~RefCounted()
 {
@@ -15,26 +16,40 @@ RefCounted::~RefCounted()
 #endif
 }
 
+#ifdef DEBUG_MEMORY
 int RefCounted::unref()
 {
-	int r;
-#if defined(DEBUG_MEMORY) || defined(DEBUG)
 	if (_refcount <= 0) { rtcmix_print("Refcounted::~RefCounted(this = %p): object already deleted!\n"); assert(0); }
+	const int r = RC_DECREMENT(_refcount);
+	if (r <= 0)
+		release();
+	return r;
+}
 #endif
-	if ((r=--_refcount) <= 0) {
+
+// The last reference is gone.
+
+void RefCounted::release()
+{
+#ifdef DEBUG
+	if (_refcount < 0) { rtcmix_print("Refcounted::release(this = %p): object already deleted!\n", this); assert(0); }
+#endif
+	if (_dispatch)
+		dispatchDelete();
+	else
+		delete this;
+}
+
+void RefCounted::dispatchDelete()
+{
 #ifdef USE_OSX_DISPATCH
-        if (_dispatch) {
-            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
-                           ^{ delete this; }
-            );
-        }
-        else
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                   ^{ delete this; }
+    );
+#else
+	if (!Reaper::add(this))
+		delete this;
 #endif
-        {
-            delete this;
-        }
-	}
-	return r;
 }
 
 void RefCounted::ref(RefCounted *r)
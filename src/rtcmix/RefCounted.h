@@ -2,27 +2,54 @@
 //
 // Base class for objects which are held by reference in multiple locations.
 //
+// The count is atomic, so that PFields, tables and bus slots shared by
+// instruments running on different TaskThreads can be ref'd and unref'd
+// there without a lock.  A ref() needs no ordering; the unref() that may
+// delete orders all earlier uses of the object before the deletion.
+// Objects made with dispatchOnDelete are deleted by the Reaper thread
+// rather than by whichever thread lets go of them last.
 
 #ifndef _RT_REFCOUNTED_H_
 #define _RT_REFCOUNTED_H_
 
+#ifdef __ATOMIC_RELAXED
+#define RC_INCREMENT(count)	__atomic_add_fetch(&(count), 1, __ATOMIC_RELAXED)
+#define RC_DECREMENT(count)	__atomic_sub_fetch(&(count), 1, __ATOMIC_ACQ_REL)
+#else
+#define RC_INCREMENT(count)	__sync_add_and_fetch(&(count), 1)
+#define RC_DECREMENT(count)	__sync_sub_and_fetch(&(count), 1)
+#endif
+
 class RefCounted {
 public:
 #ifdef DEBUG_MEMORY
-	virtual int ref() { return ++_refcount; }
+	virtual int ref() { return RC_INCREMENT(_refcount); }
 	virtual int unref();
 #else
-	int ref() { return ++_refcount; }
-	int unref();
+	int ref() { return RC_INCREMENT(_refcount); }
+	int unref() {
+		const int r = RC_DECREMENT(_refcount);
+		if (r <= 0)
+			release();
+		return r;
+	}
 #endif
 	static void ref(RefCounted *r);
 	static int unref(RefCounted *r);
 protected:
-	RefCounted(bool dispatchOnDelete=false) : _refcount(0), _dispatch(dispatchOnDelete) {}
+	RefCounted(bool dispatchOnDelete=false)
+		: _refcount(0), _dispatch(dispatchOnDelete), _nextDead(0) {}
 	virtual ~RefCounted();
+	// Called by the last unref() of an object made with dispatchOnDelete,
+	// to delete it somewhere other than on the calling thread.  By default,
+	// hands it to the Reaper.
+	virtual void dispatchDelete();
 private:
+	void release();
 	int _refcount;
     bool  _dispatch;
+	RefCounted *_nextDead;		// while waiting for the Reaper
+	friend class Reaper;
 };
 
 #endif	//	 _RT_REFCOUNTED_H_
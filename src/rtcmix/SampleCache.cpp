@@ -0,0 +1,166 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// SampleCache.cpp -- shared decoded sound file regions.  See SampleCache.h.
+
+#include "SampleCache.h"
+#include "MemStats.h"
+#include <Lockable.h>
+#include <RTOption.h>
+#include <sys/stat.h>
+#include <map>
+
+struct CacheKey {
+	dev_t	device;
+	ino_t	inode;
+	off_t	size;
+	time_t	modTime;
+	long	startFrame;
+	long	frames;
+	int		chan;
+	bool operator < (const CacheKey &rhs) const;
+};
+
+bool CacheKey::operator < (const CacheKey &rhs) const
+{
+	if (device != rhs.device) return device < rhs.device;
+	if (inode != rhs.inode) return inode < rhs.inode;
+	if (size != rhs.size) return size < rhs.size;
+	if (modTime != rhs.modTime) return modTime < rhs.modTime;
+	if (startFrame != rhs.startFrame) return startFrame < rhs.startFrame;
+	if (frames != rhs.frames) return frames < rhs.frames;
+	return chan < rhs.chan;
+}
+
+typedef std::map<CacheKey, SampleCache::Block *> CacheMap;
+
+static CacheMap sCache;
+static Lockable sCacheLock;
+static size_t sCacheBytes = 0;
+static unsigned long sUseCount = 0;
+
+static bool makeKey(const char *path, long startFrame, long frames, int chan, CacheKey *key)
+{
+	struct stat st;
+	if (path == NULL || stat(path, &st) != 0)
+		return false;
+	key->device = st.st_dev;
+	key->inode = st.st_ino;
+	key->size = st.st_size;
+	key->modTime = st.st_mtime;
+	key->startFrame = startFrame;
+	key->frames = frames;
+	key->chan = chan;
+	return true;
+}
+
+static inline size_t bytesFor(const SampleCache::Block *block)
+{
+	return block->sampleCount() * sizeof(float);
+}
+
+static size_t cacheLimit()
+{
+	const int megabytes = RTOption::sampleCacheMB();
+	return (megabytes > 0) ? (size_t) megabytes << 20 : 0;
+}
+
+SampleCache::Block::Block(float *samples, long count)
+	: mSamples(samples), mSampleCount(count), mUsers(1), mCached(false), mLastUse(0)
+{
+	MemStats::add(MemStats::kInputs, count * sizeof(float));
+}
+
+SampleCache::Block::~Block()
+{
+	MemStats::add(MemStats::kInputs, -(long long) (mSampleCount * sizeof(float)));
+	delete [] mSamples;
+}
+
+// Drop least recently used regions that no one holds until <needed> more
+// bytes fit.  Called with the cache locked.
+
+void SampleCache::makeRoom(size_t needed, size_t limit)
+{
+	while (sCacheBytes + needed > limit) {
+		CacheMap::iterator victim = sCache.end();
+		for (CacheMap::iterator it = sCache.begin(); it != sCache.end(); ++it) {
+			if (it->second->mUsers == 0
+					&& (victim == sCache.end() || it->second->mLastUse < victim->second->mLastUse))
+				victim = it;
+		}
+		if (victim == sCache.end())
+			break;
+		sCacheBytes -= bytesFor(victim->second);
+		delete victim->second;
+		sCache.erase(victim);
+	}
+}
+
+SampleCache::Block *
+SampleCache::find(const char *path, long startFrame, long frames, int chan)
+{
+	CacheKey key;
+	if (cacheLimit() == 0 || !makeKey(path, startFrame, frames, chan, &key))
+		return NULL;
+	sCacheLock.lock();
+	Block *block = NULL;
+	CacheMap::iterator it = sCache.find(key);
+	if (it != sCache.end()) {
+		block = it->second;
+		++block->mUsers;
+		block->mLastUse = ++sUseCount;
+	}
+	sCacheLock.unlock();
+	return block;
+}
+
+SampleCache::Block *
+SampleCache::insert(const char *path, long startFrame, long frames, int chan,
+					float *samples, long sampleCount)
+{
+	Block *block = new Block(samples, sampleCount);
+	const size_t limit = cacheLimit();
+	CacheKey key;
+	if (bytesFor(block) > limit || !makeKey(path, startFrame, frames, chan, &key))
+		return block;
+	sCacheLock.lock();
+	if (sCache.find(key) == sCache.end()) {
+		makeRoom(bytesFor(block), limit);
+		if (sCacheBytes + bytesFor(block) <= limit) {
+			sCache[key] = block;
+			sCacheBytes += bytesFor(block);
+			block->mCached = true;
+			block->mLastUse = ++sUseCount;
+		}
+	}
+	sCacheLock.unlock();
+	return block;
+}
+
+void SampleCache::release(Block *block)
+{
+	if (block == NULL)
+		return;
+	sCacheLock.lock();
+	const bool orphan = (--block->mUsers == 0 && !block->mCached);
+	sCacheLock.unlock();
+	if (orphan)
+		delete block;
+}
+
+void SampleCache::purge()
+{
+	sCacheLock.lock();
+	for (CacheMap::iterator it = sCache.begin(); it != sCache.end(); ) {
+		Block *block = it->second;
+		sCacheBytes -= bytesFor(block);
+		sCache.erase(it++);
+		if (block->mUsers == 0)
+			delete block;
+		else
+			block->mCached = false;		// freed on its last release()
+	}
+	sCacheLock.unlock();
+}
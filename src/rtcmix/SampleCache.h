@@ -0,0 +1,60 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _SAMPLECACHE_H_
+#define _SAMPLECACHE_H_ 1
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// A process-wide cache of sound file samples, decoded to float, so that
+// rtinput(file, "MEMORY"), maketable("soundfile") and sound_sample_buf_read()
+// decode a given region of a file only once, however many times a score (or
+// a series of scores in one embedded session) asks for it.
+//
+// Each region is keyed by the file (device, inode, size and modification
+// time, so an edited file is never served stale), its first frame, its
+// length, and the channel read (or SAMPLE_CACHE_ALL_CHANS for interleaved
+// frames).  The total size is bounded by the sample_cache_mb option; the
+// least recently used regions not currently held by anyone are dropped to
+// stay under it.  Setting the option to 0 turns the cache off, in which case
+// insert() still hands back a Block, but it is simply freed on release().
+
+#define SAMPLE_CACHE_ALL_CHANS -1
+
+class SampleCache {
+public:
+	class Block {
+	public:
+		float *	samples() const { return mSamples; }
+		long	sampleCount() const { return mSampleCount; }
+	private:
+		friend class SampleCache;
+		Block(float *samples, long count);
+		~Block();
+		float *			mSamples;
+		long			mSampleCount;
+		int				mUsers;
+		bool			mCached;		// false once evicted (or never added)
+		unsigned long	mLastUse;
+	};
+
+	// Return the region if it is cached, else NULL.  A non-NULL result must
+	// be given back with release().
+	static Block *	find(const char *path, long startFrame, long frames, int chan);
+
+	// Add a region.  <samples> must have been allocated with new [], and
+	// belongs to the cache from now on.  Returns the (held) Block.
+	static Block *	insert(const char *path, long startFrame, long frames, int chan,
+						   float *samples, long sampleCount);
+
+	static void		release(Block *block);	// NULL is ignored
+
+	static void		purge();		// drop all regions not in use
+
+private:
+	static void		makeRoom(size_t needed, size_t limit);
+};
+
+#endif	// _SAMPLECACHE_H_
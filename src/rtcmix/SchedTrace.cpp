@@ -0,0 +1,129 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include "SchedTrace.h"
+#include <ugens.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#ifdef MULTI_THREAD
+#include "RTThread.h"
+#endif
+
+#define TRACE_EVENTS_PER_THREAD 65536
+
+struct TraceEvent {
+	long long	start;
+	long long	duration;
+	int			arg;
+	char		name[28];
+};
+
+struct TraceBuffer {
+	TraceEvent *	events;
+	int				count;
+	bool			full;
+	char			pad[64];
+};
+
+bool SchedTrace::sActive = false;
+int SchedTrace::sThreadCount = 0;
+
+static TraceBuffer *sBuffers = NULL;
+static int sBufferCount = 0;
+static long long sStartTime = 0;
+static char sFileName[PATH_MAX];
+
+static inline TraceBuffer *threadBuffer()
+{
+#ifdef MULTI_THREAD
+	const int index = RTThread::FindIndexForThread() + 1;
+	return (index < sBufferCount) ? &sBuffers[index] : NULL;
+#else
+	return sBuffers;
+#endif
+}
+
+void SchedTrace::start()
+{
+	sBufferCount = sThreadCount + 1;
+	sBuffers = new TraceBuffer[sBufferCount];
+	for (int n = 0; n < sBufferCount; ++n) {
+		sBuffers[n].events = new TraceEvent[TRACE_EVENTS_PER_THREAD];
+		sBuffers[n].count = 0;
+		sBuffers[n].full = false;
+	}
+	strncpy(sFileName, RTOption::traceFile(), PATH_MAX);
+	sFileName[PATH_MAX - 1] = 0;
+	sStartTime = DSPStats::now();
+	sActive = true;
+}
+
+void SchedTrace::record(const char *inName, long long inStart, long long inEnd, int inArg)
+{
+	TraceBuffer *buffer = threadBuffer();
+	if (buffer == NULL || buffer->full)
+		return;
+	TraceEvent &event = buffer->events[buffer->count];
+	event.start = inStart;
+	event.duration = inEnd - inStart;
+	event.arg = inArg;
+	strncpy(event.name, inName, sizeof(event.name) - 1);
+	event.name[sizeof(event.name) - 1] = 0;
+	if (++buffer->count == TRACE_EVENTS_PER_THREAD)
+		buffer->full = true;
+}
+
+// Names are instrument names and our own labels, so they need no escaping.
+
+static void writeEvent(FILE *file, const TraceEvent &event, int thread)
+{
+	fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+			"\"ts\":%.3f,\"dur\":%.3f", event.name, thread, (event.start - sStartTime) * 0.001,
+			event.duration * 0.001);
+	if (event.arg >= 0)
+		fprintf(file, ",\"args\":{\"n\":%d}", event.arg);
+	fprintf(file, "}");
+}
+
+void SchedTrace::finish()
+{
+	if (!sActive)
+		return;
+	sActive = false;
+	RTOption::traceFile("");	// set it again to record another
+
+	FILE *file = fopen(sFileName, "w");
+	if (file == NULL)
+		rtcmix_warn("trace", "Can't open trace file \"%s\"", sFileName);
+	else {
+		int total = 0;
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+		for (int n = 0; n < sBufferCount; ++n) {
+			char threadName[32];
+			if (n == 0)
+				strcpy(threadName, "audio");
+			else
+				snprintf(threadName, sizeof(threadName), "TaskThread %d", n - 1);
+			fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+					"\"tid\":%d,\"args\":{\"name\":\"%s\"}}", n == 0 ? "" : ",",
+					n, threadName);
+			const TraceBuffer &buffer = sBuffers[n];
+			for (int e = 0; e < buffer.count; ++e)
+				writeEvent(file, buffer.events[e], n);
+			total += buffer.count;
+			if (buffer.full)
+				rtcmix_warn("trace", "Trace buffer for thread %d filled; later events were dropped", n);
+		}
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		rtcmix_advise("trace", "Wrote %d events to \"%s\"", total, sFileName);
+	}
+
+	for (int n = 0; n < sBufferCount; ++n)
+		delete [] sBuffers[n].events;
+	delete [] sBuffers;
+	sBuffers = NULL;
+	sBufferCount = 0;
+}
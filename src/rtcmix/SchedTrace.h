@@ -0,0 +1,61 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _SCHEDTRACE_H_
+#define _SCHEDTRACE_H_ 1
+
+#include "DSPStats.h"
+
+// A timeline of what the scheduler does, recorded while the trace_file
+// option names a file.  Each rendering thread appends fixed-size spans
+// (name, start, duration and one integer argument) to its own buffer,
+// which is allocated once, at the first traced audio buffer.  When any
+// buffer fills, that thread stops recording.  At the end of the run the
+// spans are written to the file in the Chrome trace event format, which
+// chrome://tracing and ui.perfetto.dev both load.
+//
+// Thread 0 is the audio thread; the TaskManager threads follow it, so the
+// gaps in their rows are the time they spent waiting for work.
+
+class SchedTrace {
+public:
+	static bool		active() { return sActive; }
+
+	// Note how many TaskManager threads there are.  Called by init_globals.
+	static void		init(int inThreadCount) { sThreadCount = inThreadCount; }
+	// Called by the audio thread at the top of each buffer.  Starts
+	// recording if trace_file has been set since the last finish().
+	static void		startBuffer() {
+		if (!sActive && RTOption::traceFile()[0] != '\0')
+			start();
+	}
+	// Write the file and stop recording.  Called once no task is running.
+	static void		finish();
+
+	// <inName> is copied, so it need not outlive the call.
+	static void		record(const char *inName, long long inStart, long long inEnd,
+						   int inArg=-1);
+private:
+	static void		start();
+	static bool		sActive;
+	static int		sThreadCount;
+};
+
+// Records the span of its own lifetime.
+
+class TraceSpan {
+public:
+	TraceSpan(const char *inName, int inArg=-1)
+		: mName(inName), mArg(inArg), mStart(SchedTrace::active() ? DSPStats::now() : 0) {}
+	~TraceSpan() {
+		if (mStart != 0)
+			SchedTrace::record(mName, mStart, DSPStats::now(), mArg);
+	}
+private:
+	const char *	mName;
+	int				mArg;
+	long long		mStart;
+};
+
+#endif	// _SCHEDTRACE_H_
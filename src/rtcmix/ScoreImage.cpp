@@ -0,0 +1,514 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// ScoreImage.cpp -- saving and replaying evaluated scores.  See ScoreImage.h.
+
+#include "ScoreImage.h"
+#include <RTcmix.h>
+#include <ugens.h>
+#include "utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#define IMAGE_MAGIC "RTcmxSI"		// 7 chars + NUL
+#define IMAGE_VERSION 2
+#define IMAGE_BYTE_ORDER 0x01020304
+#define NULL_HANDLE_ID 0xffffffffUL
+
+struct ImageHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	byteOrder;
+	uint32_t	callCount;
+	uint32_t	argCount;
+	uint32_t	numberCount;
+	uint32_t	stringBytes;
+};
+
+struct ImageCall {
+	uint32_t	name;		// offset into string pool
+	uint32_t	firstArg;	// index of first argument record
+	uint32_t	nargs;
+	int32_t		handleId;	// id of the handle this call returned, or -1
+	uint32_t	flags;
+};
+
+enum { kInstrumentCall = 0x1 };
+
+struct ImageArg {
+	uint32_t	type;		// RTcmixType
+	uint32_t	count;		// ArrayType: number of values
+	union {
+		double		number;	// DoubleType
+		uint64_t	index;	// StringType: string offset, HandleType: handle id,
+							// ArrayType: first value in number pool
+	} u;
+};
+
+bool ScoreImage::sRecording = false;
+int ScoreImage::sPart = 0;
+int ScoreImage::sParts = 1;
+
+static std::string sPath;
+static std::string sInvalidReason;		// empty while the image is good
+static std::vector<ImageCall> sCalls;
+static std::vector<ImageArg> sArgs;
+static std::vector<double> sNumbers;
+static std::string sStrings;
+static std::map<std::string, uint32_t> sStringOffsets;
+static std::map<Handle, int32_t> sHandleIds;
+static int32_t sNextHandleId = 0;
+
+static void clearRecording()
+{
+	sPath.clear();
+	sInvalidReason.clear();
+	sCalls.clear();
+	sArgs.clear();
+	sNumbers.clear();
+	sStrings.clear();
+	sStringOffsets.clear();
+	sHandleIds.clear();
+	sNextHandleId = 0;
+}
+
+static uint32_t addString(const char *str)
+{
+	const std::string key(str ? str : "");
+	std::map<std::string, uint32_t>::const_iterator it = sStringOffsets.find(key);
+	if (it != sStringOffsets.end())
+		return it->second;
+	const uint32_t offset = (uint32_t) sStrings.size();
+	sStrings.append(key.c_str(), key.size() + 1);
+	sStringOffsets[key] = offset;
+	return offset;
+}
+
+void ScoreImage::record(const char *path)
+{
+	clearRecording();
+	sPath = path;
+	sRecording = true;
+}
+
+void ScoreImage::invalidate(const char *reason)
+{
+	if (sRecording && sInvalidReason.empty() && *reason)
+		sInvalidReason = reason;
+}
+
+void ScoreImage::addCall(const char *name, const Arg args[], int nargs,
+						 const Arg &retval)
+{
+	if (!sRecording || !sInvalidReason.empty())
+		return;
+	ImageCall call;
+	call.name = addString(name);
+	call.firstArg = (uint32_t) sArgs.size();
+	call.nargs = (uint32_t) nargs;
+	call.handleId = -1;
+	call.flags = 0;
+	for (int n = 0; n < nargs; ++n) {
+		ImageArg arg;
+		arg.type = args[n].type();
+		arg.count = 0;
+		arg.u.index = 0;
+		switch (args[n].type()) {
+		case DoubleType:
+			arg.u.number = (double) args[n];
+			break;
+		case StringType:
+			arg.u.index = addString(args[n].string());
+			break;
+		case HandleType:
+			{
+				Handle h = (Handle) args[n];
+				if (h == NULL) {
+					arg.u.index = NULL_HANDLE_ID;
+					break;
+				}
+				std::map<Handle, int32_t>::const_iterator it = sHandleIds.find(h);
+				if (it == sHandleIds.end()) {
+					invalidate("a score object not made by an RTcmix function was passed to one");
+					return;
+				}
+				arg.u.index = (uint64_t) it->second;
+			}
+			break;
+		case ArrayType:
+			{
+				const Array *array = (Array *) args[n];
+				arg.count = array->len;
+				arg.u.index = sNumbers.size();
+				sNumbers.insert(sNumbers.end(), array->data, array->data + array->len);
+			}
+			break;
+		default:	// VoidType
+			break;
+		}
+		sArgs.push_back(arg);
+	}
+	if (retval.isType(HandleType) && (Handle) retval != NULL) {
+		call.handleId = sNextHandleId++;
+		sHandleIds[(Handle) retval] = call.handleId;
+		if (((Handle) retval)->type == InstrumentPtrType)
+			call.flags |= kInstrumentCall;
+	}
+	sCalls.push_back(call);
+}
+
+int ScoreImage::finish()
+{
+	if (!sRecording)
+		return -1;
+	sRecording = false;
+	if (!sInvalidReason.empty()) {
+		rtcmix_warn("ScoreImage", "Not saving score to \"%s\": %s.",
+					sPath.c_str(), sInvalidReason.c_str());
+		clearRecording();
+		return -1;
+	}
+	ImageHeader header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, IMAGE_MAGIC);
+	header.version = IMAGE_VERSION;
+	header.byteOrder = IMAGE_BYTE_ORDER;
+	header.callCount = (uint32_t) sCalls.size();
+	header.argCount = (uint32_t) sArgs.size();
+	header.numberCount = (uint32_t) sNumbers.size();
+	header.stringBytes = (uint32_t) sStrings.size();
+
+	int status = 0;
+	FILE *stream = fopen(sPath.c_str(), "wb");
+	if (stream == NULL) {
+		rtcmix_warn("ScoreImage", "Can't create \"%s\".", sPath.c_str());
+		status = -1;
+	}
+	else {
+		bool ok = fwrite(&header, sizeof(header), 1, stream) == 1;
+		if (ok && !sCalls.empty())
+			ok = fwrite(&sCalls[0], sizeof(ImageCall), sCalls.size(), stream) == sCalls.size();
+		if (ok && !sArgs.empty())
+			ok = fwrite(&sArgs[0], sizeof(ImageArg), sArgs.size(), stream) == sArgs.size();
+		if (ok && !sNumbers.empty())
+			ok = fwrite(&sNumbers[0], sizeof(double), sNumbers.size(), stream) == sNumbers.size();
+		if (ok && !sStrings.empty())
+			ok = fwrite(sStrings.data(), 1, sStrings.size(), stream) == sStrings.size();
+		if (fclose(stream) != 0)
+			ok = false;
+		if (!ok) {
+			rtcmix_warn("ScoreImage", "Error writing \"%s\".", sPath.c_str());
+			unlink(sPath.c_str());
+			status = -1;
+		}
+		else
+			rtcmix_advise("ScoreImage", "Saved %u calls to \"%s\".",
+						  header.callCount, sPath.c_str());
+	}
+	clearRecording();
+	return status;
+}
+
+// Check everything that play() will index, so that a damaged or foreign
+// file is refused up front rather than replayed halfway.
+
+static bool validImage(const char *base, size_t length)
+{
+	if (length < sizeof(ImageHeader))
+		return false;
+	const ImageHeader *header = (const ImageHeader *) base;
+	if (memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) != 0
+			|| header->version != IMAGE_VERSION
+			|| header->byteOrder != IMAGE_BYTE_ORDER)
+		return false;
+	const size_t expected = sizeof(ImageHeader)
+			+ (size_t) header->callCount * sizeof(ImageCall)
+			+ (size_t) header->argCount * sizeof(ImageArg)
+			+ (size_t) header->numberCount * sizeof(double)
+			+ header->stringBytes;
+	if (length != expected)
+		return false;
+	if (header->stringBytes == 0 || base[length - 1] != '\0')
+		return false;
+	const ImageCall *calls = (const ImageCall *) (header + 1);
+	const ImageArg *args = (const ImageArg *) (calls + header->callCount);
+	for (uint32_t n = 0; n < header->callCount; ++n) {
+		if (calls[n].name >= header->stringBytes
+				|| calls[n].firstArg > header->argCount
+				|| calls[n].nargs > header->argCount - calls[n].firstArg)
+			return false;
+	}
+	for (uint32_t n = 0; n < header->argCount; ++n) {
+		switch (args[n].type) {
+		case StringType:
+			if (args[n].u.index >= header->stringBytes)
+				return false;
+			break;
+		case ArrayType:
+			if (args[n].u.index > header->numberCount
+					|| args[n].count > header->numberCount - args[n].u.index)
+				return false;
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+int ScoreImage::setPart(int part, int parts)
+{
+	if (parts < 1 || part < 0 || part >= parts)
+		return -1;
+	sPart = part;
+	sParts = parts;
+	return 0;
+}
+
+// Splitting.  Instruments that share an aux bus -- everything writing it
+// and everything reading it -- must be played in the same part, and so
+// must calls that take an instrument's handle (e.g., CHAIN).  We join these
+// into groups with union-find, the nodes being calls and then aux buses,
+// and deal the groups out to the parts, biggest first, to whichever part
+// has the fewest instrument calls so far.  Everything else (rtsetparams,
+// rtinput, maketable, bus_config, ...) is played in every part.
+
+struct AuxBuses {
+	std::vector<int> buses;		// every aux bus an instrument reads or writes
+};
+
+static int findGroup(std::vector<int> &parent, int node)
+{
+	while (parent[node] != node) {
+		parent[node] = parent[parent[node]];
+		node = parent[node];
+	}
+	return node;
+}
+
+static void joinGroups(std::vector<int> &parent, int a, int b)
+{
+	a = findGroup(parent, a);
+	b = findGroup(parent, b);
+	if (a != b)
+		parent[std::max(a, b)] = std::min(a, b);
+}
+
+// Adds the buses in an "aux N[-M] in|out" bus_config argument.
+
+static void addAuxBuses(const char *spec, AuxBuses &aux)
+{
+	if (strncmp(spec, "aux", 3) != 0)
+		return;
+	char *end;
+	const long first = strtol(spec + 3, &end, 10);
+	long last = first;
+	if (*end == '-')
+		last = strtol(end + 1, &end, 10);
+	for (long bus = first; bus <= last && bus >= 0; ++bus)
+		aux.buses.push_back((int) bus);
+}
+
+static bool lessLoaded(const std::pair<long, int> &a, const std::pair<long, int> &b)
+{
+	return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+// Sets skip[n] for each call not played in part <part> of <parts>.
+
+static void planPart(const ImageHeader *header, const ImageCall *calls,
+					 const ImageArg *args, const char *strings,
+					 int part, int parts, std::vector<char> &skip)
+{
+	const int callCount = (int) header->callCount;
+	std::vector<int> parent(callCount);
+	for (int n = 0; n < callCount; ++n)
+		parent[n] = n;
+	std::map<int, int> busNodes;			// aux bus -> its node
+	std::vector<char> grouped(callCount, 0);
+	std::map<int32_t, int> handleCalls;		// handle id -> call that made it
+	std::map<std::string, AuxBuses> busConfigs;
+
+	for (int n = 0; n < callCount; ++n) {
+		const ImageCall &call = calls[n];
+		const ImageArg *callArgs = &args[call.firstArg];
+		if (call.handleId >= 0)
+			handleCalls[call.handleId] = n;
+		if (strcmp(strings + call.name, "bus_config") == 0) {
+			if (call.nargs > 0 && callArgs[0].type == StringType) {
+				AuxBuses &aux = busConfigs[strings + callArgs[0].u.index];
+				aux.buses.clear();
+				for (uint32_t a = 1; a < call.nargs; ++a)
+					if (callArgs[a].type == StringType)
+						addAuxBuses(strings + callArgs[a].u.index, aux);
+			}
+			continue;
+		}
+		if (call.flags & kInstrumentCall) {
+			grouped[n] = 1;
+			std::map<std::string, AuxBuses>::const_iterator it = busConfigs.find(strings + call.name);
+			if (it != busConfigs.end())
+				for (size_t b = 0; b < it->second.buses.size(); ++b) {
+					const int bus = it->second.buses[b];
+					if (busNodes.find(bus) == busNodes.end()) {
+						busNodes[bus] = (int) parent.size();
+						parent.push_back((int) parent.size());
+					}
+					joinGroups(parent, n, busNodes[bus]);
+				}
+		}
+		for (uint32_t a = 0; a < call.nargs; ++a) {
+			if (callArgs[a].type != HandleType || callArgs[a].u.index == NULL_HANDLE_ID)
+				continue;
+			std::map<int32_t, int>::const_iterator it = handleCalls.find((int32_t) callArgs[a].u.index);
+			if (it != handleCalls.end() && grouped[it->second]) {
+				grouped[n] = 1;
+				joinGroups(parent, n, it->second);
+			}
+		}
+	}
+
+	std::map<int, long> groupSizes;
+	for (int n = 0; n < callCount; ++n)
+		if (grouped[n] && (calls[n].flags & kInstrumentCall))
+			++groupSizes[findGroup(parent, n)];
+	std::vector<std::pair<long, int> > bySize;
+	for (std::map<int, long>::const_iterator it = groupSizes.begin(); it != groupSizes.end(); ++it)
+		bySize.push_back(std::make_pair(it->second, it->first));
+	std::sort(bySize.begin(), bySize.end(), lessLoaded);
+	std::vector<long> load(parts, 0);
+	std::map<int, int> groupParts;
+	for (size_t g = 0; g < bySize.size(); ++g) {
+		const int lightest = (int) (std::min_element(load.begin(), load.end()) - load.begin());
+		load[lightest] += bySize[g].first;
+		groupParts[bySize[g].second] = lightest;
+	}
+	skip.assign(callCount, 0);
+	for (int n = 0; n < callCount; ++n) {
+		if (!grouped[n])
+			continue;
+		std::map<int, int>::const_iterator it = groupParts.find(findGroup(parent, n));
+		// A call grouped with no instrument call cannot happen, but play it.
+		skip[n] = (it != groupParts.end() && it->second != part);
+	}
+	rtcmix_advise("ScoreImage", "Playing part %d of %d: %ld of %u calls.",
+				  part + 1, parts, (long) std::count(skip.begin(), skip.end(), 0),
+				  header->callCount);
+}
+
+int ScoreImage::play(const char *path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		rterror("ScoreImage", "Can't open \"%s\".", path);
+		return -1;
+	}
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		rterror("ScoreImage", "Can't map \"%s\".", path);
+		return -1;
+	}
+	const char *base = (const char *) map;
+	if (!validImage(base, (size_t) st.st_size)) {
+		rterror("ScoreImage", "\"%s\" is not a score image made by this build of RTcmix.", path);
+		munmap(map, (size_t) st.st_size);
+		return -1;
+	}
+	// The mapping is never removed: functions may hold on to the string
+	// arguments we hand them, as they do with the parsers' strings.
+	const ImageHeader *header = (const ImageHeader *) base;
+	const ImageCall *calls = (const ImageCall *) (header + 1);
+	const ImageArg *args = (const ImageArg *) (calls + header->callCount);
+	const double *numbers = (const double *) (args + header->argCount);
+	const char *strings = (const char *) (numbers + header->numberCount);
+
+	std::vector<char> skip;
+	if (sParts > 1)
+		planPart(header, calls, args, strings, sPart, sParts, skip);
+
+	std::vector<Handle> handles;
+	int status = 0;
+	for (uint32_t n = 0; n < header->callCount && status == 0; ++n) {
+		const ImageCall &call = calls[n];
+		if (!skip.empty() && skip[n]) {
+			// Keep the handle ids lined up.  Only calls skipped with this
+			// one can refer to its handle.
+			if (call.handleId >= 0)
+				handles.push_back(NULL);
+			continue;
+		}
+		Arg *arglist = new Arg[call.nargs > 0 ? call.nargs : 1];
+		for (uint32_t a = 0; a < call.nargs; ++a) {
+			const ImageArg &arg = args[call.firstArg + a];
+			switch (arg.type) {
+			case DoubleType:
+				arglist[a] = arg.u.number;
+				break;
+			case StringType:
+				arglist[a] = strings + arg.u.index;
+				break;
+			case HandleType:
+				if (arg.u.index == NULL_HANDLE_ID)
+					arglist[a] = (Handle) NULL;
+				else if (arg.u.index < handles.size())
+					arglist[a] = handles[arg.u.index];
+				else
+					status = -1;
+				break;
+			case ArrayType:
+				{
+					Array *array = (Array *) malloc(sizeof(Array));
+					array->len = arg.count;
+					array->lease = NULL;
+					array->data = (double *) malloc((arg.count > 0 ? arg.count : 1) * sizeof(double));
+					memcpy(array->data, numbers + arg.u.index, arg.count * sizeof(double));
+					arglist[a] = array;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+		if (status != 0) {
+			rterror("ScoreImage", "\"%s\": bad handle reference in call %u.", path, n);
+			delete [] arglist;
+			break;
+		}
+		Arg retval;
+		status = RTcmix::dispatch(strings + call.name, arglist, call.nargs, &retval);
+		delete [] arglist;
+		// Undefined names are only a warning for the parser, too.
+		if (status == FUNCTION_NOT_FOUND)
+			status = 0;
+		if (call.handleId >= 0) {
+			Handle h = retval.isType(HandleType) ? (Handle) retval : NULL;
+			if ((size_t) call.handleId != handles.size() || h == NULL) {
+				rterror("ScoreImage", "\"%s\": call %u (%s) did not return the handle it did when saved.",
+						path, n, strings + call.name);
+				status = -1;
+				break;
+			}
+			refHandle(h);
+			handles.push_back(h);
+		}
+	}
+	for (std::vector<Handle>::iterator it = handles.begin(); it != handles.end(); ++it)
+		if (*it != NULL)
+			unrefHandle(*it);
+	return status;
+}
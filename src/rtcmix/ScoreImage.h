@@ -0,0 +1,59 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _SCOREIMAGE_H_
+#define _SCOREIMAGE_H_ 1
+
+#include <rtcmix_types.h>
+
+// A score image is a saved copy of everything a parsed score asked RTcmix
+// to do: each call to a function or instrument (rtsetparams, bus_config,
+// maketable, WAVETABLE, ...) with its arguments already evaluated.  Playing
+// it back repeats those calls in order without running a parser, so a batch
+// job can render the same long score many times for the cost of one parse.
+//
+// Handles (tables, pfields, instruments) are saved as references to the
+// call that returned them.  A handle made any other way cannot be saved;
+// the parser reports those with invalidate(), and no image is written.
+//
+// The file is a header followed by fixed-size call and argument records,
+// a pool of list values and a pool of strings, in native byte order.  It is
+// mapped, not read, when played.  Images are meant to be made and used on
+// the same machine and build; play() refuses any other.
+
+class ScoreImage {
+public:
+	// Start saving top-level calls, to be written to <path> by finish().
+	static void		record(const char *path);
+	static bool		recording() { return sRecording; }
+
+	// Called by RTcmix::dispatch after each top-level call, and by parsers
+	// for handles they make by calling the same code a function would
+	// (e.g., MinC's table * 2, recorded as mul(table, 2)).
+	static void		addCall(const char *name, const Arg args[], int nargs,
+							const Arg &retval);
+
+	// Give up on the image: something the score did cannot be replayed.
+	static void		invalidate(const char *reason);
+
+	// Write the image.  Returns 0, or -1 if the image was invalidated or
+	// could not be written.
+	static int		finish();
+
+	// Make the calls saved in <path>.  Returns 0 on success.
+	static int		play(const char *path);
+
+	// Make play() do only part <part> (0 to parts-1) of the score: the
+	// instruments in some of its independent bus groups, with everything
+	// they need.  Mixing the output of all the parts gives the whole score.
+	static int		setPart(int part, int parts);
+	static int		parts() { return sParts; }
+
+private:
+	static bool		sRecording;
+	static int		sPart;
+	static int		sParts;
+};
+
+#endif	// _SCOREIMAGE_H_
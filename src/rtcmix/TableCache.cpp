@@ -0,0 +1,175 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// TableCache.cpp -- the on-disk table cache.  See TableCache.h.
+
+#include "TableCache.h"
+#include <RTOption.h>
+#include <ugens.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+
+#define TABLE_MAGIC "RTcmxTC"		// 7 chars + NUL
+#define TABLE_VERSION 1
+#define TABLE_BYTE_ORDER 0x01020304
+
+struct TableHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	byteOrder;
+	uint32_t	keyBytes;	// padded to a multiple of 8, so values are aligned
+	uint32_t	length;
+};
+
+// The key is the tag (with its NUL), then the length and the arguments.
+
+static std::string
+makeKey(const char *tag, const double args[], int nargs, int len)
+{
+	std::string key(tag, strlen(tag) + 1);
+	const uint32_t length = len;
+	key.append((const char *) &length, sizeof(length));
+	key.append((const char *) args, nargs * sizeof(double));
+	key.resize((key.size() + 7) & ~(size_t) 7, '\0');
+	return key;
+}
+
+// FNV-1a
+
+static uint64_t
+hashKey(const std::string &key)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t n = 0; n < key.size(); n++) {
+		hash ^= (unsigned char) key[n];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Return the file for <key>, or an empty string if the cache is off.
+
+static std::string
+tablePath(const std::string &key)
+{
+	const char *dir = RTOption::tableCacheDir();
+	if (dir == NULL || dir[0] == 0)
+		return std::string();
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.table",
+								(unsigned long long) hashKey(key));
+	return std::string(dir) + name;
+}
+
+int
+table_cache_find(const char *tag, const double args[], int nargs,
+	double *array, int len)
+{
+	if (len < TABLE_CACHE_MIN_LEN)
+		return 0;
+	const std::string key = makeKey(tag, args, nargs, len);
+	const std::string path = tablePath(key);
+	if (path.empty())
+		return 0;
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return 0;
+	const size_t size = sizeof(TableHeader) + key.size() + len * sizeof(double);
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size != (off_t) size) {
+		close(fd);
+		return 0;
+	}
+	void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+
+	const TableHeader *header = (const TableHeader *) map;
+	const char *storedKey = (const char *) map + sizeof(TableHeader);
+	const bool found = memcmp(header->magic, TABLE_MAGIC, sizeof(header->magic)) == 0
+		&& header->version == TABLE_VERSION
+		&& header->byteOrder == TABLE_BYTE_ORDER
+		&& header->keyBytes == key.size()
+		&& header->length == (uint32_t) len
+		&& memcmp(storedKey, key.data(), key.size()) == 0;
+	if (found)
+		memcpy(array, storedKey + key.size(), len * sizeof(double));
+	munmap(map, size);
+
+	return found;
+}
+
+static bool
+writeAll(int fd, const void *buf, size_t size)
+{
+	const char *ptr = (const char *) buf;
+	while (size > 0) {
+		ssize_t n = write(fd, ptr, size);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+void
+table_cache_store(const char *tag, const double args[], int nargs,
+	const double *array, int len)
+{
+	static bool warned = false;
+
+	if (len < TABLE_CACHE_MIN_LEN)
+		return;
+	const std::string key = makeKey(tag, args, nargs, len);
+	const std::string path = tablePath(key);
+	if (path.empty())
+		return;
+
+	// The first table stored makes the directory, if need be.
+	mkdir(RTOption::tableCacheDir(), 0777);
+
+	std::string tmpPath = path + ".XXXXXX";
+	int fd = mkstemp(&tmpPath[0]);
+	if (fd < 0) {
+		if (!warned)
+			rtcmix_warn("table cache", "Can't write to \"%s\" (%s).",
+								RTOption::tableCacheDir(), strerror(errno));
+		warned = true;
+		return;
+	}
+	fchmod(fd, 0644);		// mkstemp makes it private
+
+	TableHeader header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, TABLE_MAGIC);
+	header.version = TABLE_VERSION;
+	header.byteOrder = TABLE_BYTE_ORDER;
+	header.keyBytes = key.size();
+	header.length = len;
+
+	const bool ok = writeAll(fd, &header, sizeof(header))
+		&& writeAll(fd, key.data(), key.size())
+		&& writeAll(fd, array, len * sizeof(double));
+	if (close(fd) != 0 || !ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+		if (!warned)
+			rtcmix_warn("table cache", "Can't write \"%s\" (%s).",
+								path.c_str(), strerror(errno));
+		warned = true;
+		unlink(tmpPath.c_str());
+	}
+}
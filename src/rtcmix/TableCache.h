@@ -0,0 +1,46 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _TABLECACHE_H_
+#define _TABLECACHE_H_ 1
+
+/* An on-disk cache of the tables that take the longest to make -- the sums
+   of sines, Chebyshev polynomials and windows of maketable and makegen -- so
+   that the scores run after the first one reuse them instead of making them
+   again.  These depend only on their arguments and length, so a table is
+   stored under a key made of a tag naming the routine (e.g. "gen10" or
+   "maketable wave"), its arguments and its length, and found by a hash of
+   that key.
+
+   The cache is in the directory given by the table_cache_dir option, and
+   is off when that is empty.  Each table is one file, named by the key's
+   hash, holding the whole key (so that a hash collision is only a miss)
+   and the values in native byte order.  A file is written under a private
+   name and then renamed, so that other processes sharing the directory
+   never see a partial one.  Tables shorter than TABLE_CACHE_MIN_LEN are
+   quicker to make than to look up, and are never cached.
+*/
+
+#define TABLE_CACHE_MIN_LEN 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fill <array> with the <len> values stored for <tag> and <args>.  Returns
+   1 if they were found, 0 otherwise.
+*/
+int table_cache_find(const char *tag, const double args[], int nargs,
+							double *array, int len);
+
+/* Store the <len> values in <array> for <tag> and <args>, if the cache is on.
+*/
+void table_cache_store(const char *tag, const double args[], int nargs,
+							const double *array, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _TABLECACHE_H_ */
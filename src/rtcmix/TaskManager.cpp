@@ -12,9 +12,19 @@
 #include "TaskManager.h"
 #include "RTSemaphore.h"
 #include "RTThread.h"
+#include "SchedTrace.h"
+#include "IndexedJob.h"
+#include "AllocTracker.h"
+#include "PrintRing.h"
+#include "Denormals.h"
 #include "rt_types.h"
+#include <RTOption.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
 #include <assert.h>
 
 #ifdef LINUX
@@ -46,21 +56,70 @@ private:
 	int 		mIndex;
 };
 
+// SpinWait waits on a semaphore by polling it for a while before sleeping
+// on it.  At small buffer sizes the next batch of work usually arrives
+// sooner than the kernel could wake a sleeping thread.  The polling time
+// adapts: it doubles, up to the thread_spin_usec option, each time polling
+// pays off, and halves each time the thread has to sleep anyway.
+
+#define SPIN_CHECKS_PER_CLOCK_READ 64
+
+class SpinWait
+{
+public:
+	SpinWait() : mBudget(-1) {}
+	void wait(RTSemaphore &inSema);
+private:
+	static long	nowUsec() {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+	long		mBudget;	// microseconds to poll next time
+};
+
+void SpinWait::wait(RTSemaphore &inSema)
+{
+	const long limit = RTOption::threadSpinUsec();
+	if (mBudget < 0 || mBudget > limit)
+		mBudget = limit;
+	if (mBudget > 0) {
+		const long start = nowUsec();
+		do {
+			for (int n = 0; n < SPIN_CHECKS_PER_CLOCK_READ; ++n) {
+				if (inSema.tryWait()) {
+					mBudget = std::min(mBudget * 2, limit);
+					return;
+				}
+			}
+		} while (nowUsec() - start < mBudget);
+		// Keep polling a little, so that the budget can grow back.
+		mBudget = std::max(mBudget / 2, std::max(limit / 16, 1L));
+	}
+	inSema.wait();
+}
+
 class TaskThread : public RTThread, Notifier
 {
 public:
-	TaskThread(Notifiable *inTarget, TaskProvider *inProvider, int inIndex)
+	TaskThread(Notifiable *inTarget, TaskProvider * volatile *inProvider, int inIndex)
 		: RTThread(inIndex), Notifier(inTarget, inIndex),
-		  mStopping(false), mTaskProvider(inProvider) { start(); }
+		  mStopping(false), mIdle(1), mTaskProvider(inProvider) { start(); }
 	~TaskThread() { mStopping = true; wake(); }
 	inline void wake();
+	// Called by the pool before waking the thread for a batch.  recruit()
+	// returns false if the thread is already taking part in this one.
+	void		setBusy() { mIdle = 0; }
+	bool		recruit() { return __sync_bool_compare_and_swap(&mIdle, 1, 0); }
 protected:
 	virtual void	run();
-	Task *			getATask() { return mTaskProvider->getSingleTask(); }
+	Task *			getATask() { return (*mTaskProvider)->getSingleTask(); }
 private:
 	bool			mStopping;
-	TaskProvider *	mTaskProvider;
+	volatile int	mIdle;			// done with the current batch
+	TaskProvider * volatile *	mTaskProvider;	// the pool's, for this batch
 	RTSemaphore		mSema;
+	SpinWait		mSpin;
 };
 
 inline void TaskThread::wake()
@@ -84,12 +143,27 @@ void TaskThread::run()
 #endif
     char threadName[16];
     snprintf(threadName, 16, "TaskThread %d", getIndex());
+#if defined(MACOSX)
     (void) pthread_setname_np(threadName);
+#elif defined(LINUX)
+    (void) pthread_setname_np(pthread_self(), threadName);
+#endif
+	AllocTracker::realtimeThread();
+	PrintRing::realtimeThread();
+	bool scheduled = false;
 	do {
 #ifdef THREAD_DEBUG
 		printf("TaskThread %d sleeping...\n", tIndex);
 #endif
-		mSema.wait();
+		mSpin.wait(mSema);
+		// The threads start before the options are read, so this waits
+		// for the first batch of work.
+		if (!scheduled) {
+			SetSchedulingForThread(RTOption::threadRealtime(),
+								   RTOption::threadAffinity() ? getIndex() + 1 : -1);
+			scheduled = true;
+		}
+		Denormals::apply();
 #ifdef THREAD_DEBUG
 		printf("TaskThread %d woke up -- running task loop\n", tIndex);
 #endif
@@ -97,6 +171,7 @@ void TaskThread::run()
         const uint64_t startTime = mach_absolute_time();
         bool taskWasRun = false;
 #endif
+        TraceSpan span("work");
         Task *task;
         while ((task = getATask()) != NULL) {
 #ifdef TASK_TIME_DEBUG
@@ -124,6 +199,7 @@ void TaskThread::run()
             printf("TaskThread %d loop done in %.5f ms\n", getIndex(), elapsedNS*1.0e-06);
         }
 #endif
+		mIdle = 1;
 		notify();
 	}
 	while (!mStopping);
@@ -132,37 +208,132 @@ void TaskThread::run()
 #endif
 }
 
+// There is one ThreadPool per process, shared by every TaskManager in it,
+// so that several engines in one host (a patch full of rtcmix~ objects, say)
+// do not each bring a full set of threads to compete for the same cores.
+// The first TaskManager sizes it and the last one deletes it.  Batches from
+// different managers take turns:  a manager holds the pool, and points its
+// threads at its own deques, from startAndWait() until the batch is done.
+
 class ThreadPool : private Notifiable
 {
 public:
-	ThreadPool(TaskProvider *inProvider) : mRequestCount(0), mThreadSema(RT_THREAD_COUNT), mWaitSema(0) {
-		for(int i=0; i<RT_THREAD_COUNT; ++i) {
-			mThreads[i] = new TaskThread(this, inProvider, i);
+	// Returns the shared pool, creating it with <inThreadCount> threads if
+	// there is none.  Each Acquire() must be matched by a Release().
+	static ThreadPool *	Acquire(int inThreadCount);
+	static void			Release(ThreadPool *inPool);
+	int			threadCount() const { return mThreadCount; }
+	// Run a batch from <inProvider>, waiting for any other provider's first.
+	inline void	startAndWait(TaskProvider *inProvider, int taskCount);
+	inline void	startAndWait(TaskProvider *inProvider, const char *inWake);
+	void		recruit(int inCount);
+private:
+	ThreadPool(int inThreadCount)
+		: mThreadCount(inThreadCount), mThreads(new TaskThread *[inThreadCount]),
+		  mRequestCount(0), mThreadSema(inThreadCount), mWaitSema(0),
+		  mProvider(NULL), mUsers(0) {
+		pthread_mutex_init(&mBatchLock, NULL);
+		for(int i=0; i<mThreadCount; ++i) {
+			mThreads[i] = new TaskThread(this, &mProvider, i);
 		}
 	}
 	virtual ~ThreadPool() {
-		for(int i=0; i<RT_THREAD_COUNT; ++i)
+		for(int i=0; i<mThreadCount; ++i)
 			delete mThreads[i];
+		delete [] mThreads;
+		pthread_mutex_destroy(&mBatchLock);
 	}
 	virtual void notify(int inIndex);
-	inline void startAndWait(int taskCount);
-private:
-	TaskThread		*mThreads[RT_THREAD_COUNT];
+	inline void	begin(TaskProvider *inProvider);
+	inline void	end();
+
+	static ThreadPool *		sShared;
+	static pthread_mutex_t	sSharedLock;
+
+	int				mThreadCount;
+	TaskThread		**mThreads;
 	AtomicInt		mRequestCount;
 	RTSemaphore		mThreadSema;
 	RTSemaphore		mWaitSema;
+	SpinWait		mWaitSpin;
+	TaskProvider * volatile	mProvider;		// whose batch is running
+	pthread_mutex_t	mBatchLock;				// held for the length of a batch
+	int				mUsers;					// guarded by sSharedLock
 };
 
-inline void ThreadPool::startAndWait(int taskCount) {
+ThreadPool *	ThreadPool::sShared = NULL;
+pthread_mutex_t	ThreadPool::sSharedLock = PTHREAD_MUTEX_INITIALIZER;
+
+ThreadPool * ThreadPool::Acquire(int inThreadCount)
+{
+	pthread_mutex_lock(&sSharedLock);
+	if (sShared == NULL)
+		sShared = new ThreadPool(inThreadCount);
+	++sShared->mUsers;
+	ThreadPool *pool = sShared;
+	pthread_mutex_unlock(&sSharedLock);
+	return pool;
+}
+
+void ThreadPool::Release(ThreadPool *inPool)
+{
+	pthread_mutex_lock(&sSharedLock);
+	if (--inPool->mUsers == 0) {
+		delete inPool;
+		sShared = NULL;
+	}
+	pthread_mutex_unlock(&sSharedLock);
+}
+
+// A batch is short -- one buffer's worth of one engine's notes -- so another
+// manager wanting the pool just waits its turn.
+
+inline void ThreadPool::begin(TaskProvider *inProvider) {
+	if (pthread_mutex_trylock(&mBatchLock) != 0) {
+		TraceSpan span("waitForPool");
+		pthread_mutex_lock(&mBatchLock);
+	}
+	mProvider = inProvider;
+	__sync_synchronize();
+}
+
+inline void ThreadPool::end() {
+	mProvider = NULL;
+	pthread_mutex_unlock(&mBatchLock);
+}
+
+inline void ThreadPool::startAndWait(TaskProvider *inProvider, int taskCount) {
+	begin(inProvider);
 	// Dont wake any more threads than we have tasks.
-	mRequestCount = (int) std::min(taskCount, RT_THREAD_COUNT);
+	mRequestCount = (int) std::min(taskCount, mThreadCount);
 	const int count = (int) mRequestCount;
-	for(int i=0; i<count; ++i)
+	for(int i=0; i<count; ++i) {
+		mThreads[i]->setBusy();
 		mThreads[i]->wake();
+	}
 #ifdef POOL_DEBUG
 	printf("ThreadPool::startAndWait: waiting on %d threads\n", count);
 #endif
-	mWaitSema.wait();
+	mWaitSpin.wait(mWaitSema);
+	end();
+}
+
+// Wake just the threads with <inWake> set, which have tasks of their own.
+
+inline void ThreadPool::startAndWait(TaskProvider *inProvider, const char *inWake) {
+	begin(inProvider);
+	int count = 0;
+	for (int i = 0; i < mThreadCount; ++i)
+		count += inWake[i];
+	mRequestCount = count;
+	for (int i = 0; i < mThreadCount; ++i) {
+		if (inWake[i]) {
+			mThreads[i]->setBusy();
+			mThreads[i]->wake();
+		}
+	}
+	mWaitSpin.wait(mWaitSema);
+	end();
 }
 
 // Let thread pool know that the thread at index inIndex is available
@@ -181,26 +352,232 @@ void ThreadPool::notify(int inIndex)
 	}
 }
 
-TaskManagerImpl::TaskManagerImpl()
-	: mThreadPool(new ThreadPool(this)), mTaskHead(NULL), mTaskTail(NULL) {}
+// Wake up to <inCount> threads that have finished with the current batch,
+// or were not needed for it, to help with sub-tasks.  Only called by a
+// running task, so the batch cannot end while their count is being added.
 
-TaskManagerImpl::~TaskManagerImpl() { delete mThreadPool; }
+void ThreadPool::recruit(int inCount)
+{
+	for (int i = 0; i < mThreadCount && inCount > 0; ++i) {
+		if (mThreads[i]->recruit()) {
+			mRequestCount.increment();
+			mThreads[i]->wake();
+			--inCount;
+		}
+	}
+}
+
+// TaskDeque holds the tasks assigned to one worker for the current batch.
+// The owning thread pops from the front, and idle threads steal from the
+// back.  Because a batch is complete before the workers are woken, both
+// ends can be claimed with a single CAS on the packed (head, tail) word.
+
+#define TASK_CACHE_LINE 64
+
+class TaskDeque
+{
+public:
+	TaskDeque() : mState(0) {}
+	void	push(Task *inTask) { mTasks.push_back(inTask); }
+	// Called (non-atomically) after the batch has been filled
+	void	publish() { mState = (uint64_t) mTasks.size(); }
+	void	clear() { mTasks.clear(); mState = 0; }
+	bool	empty() const { return mTasks.empty(); }
+	inline Task *	popFront();
+	inline Task *	popBack();
+private:
+	static uint32_t	head(uint64_t state) { return (uint32_t) (state >> 32); }
+	static uint32_t	tail(uint64_t state) { return (uint32_t) state; }
+	static uint64_t	pack(uint32_t h, uint32_t t) { return ((uint64_t) h << 32) | t; }
+
+	volatile uint64_t		mState;
+	std::vector<Task *>		mTasks;
+	char					mPad[TASK_CACHE_LINE];	// keep each deque on its own line
+};
+
+inline Task * TaskDeque::popFront()
+{
+	uint64_t state;
+	uint32_t h;
+	do {
+		state = mState;
+		h = head(state);
+		if (h >= tail(state))
+			return NULL;
+	} while (!__sync_bool_compare_and_swap(&mState, state, pack(h + 1, tail(state))));
+	return mTasks[h];
+}
+
+inline Task * TaskDeque::popBack()
+{
+	uint64_t state;
+	uint32_t t;
+	do {
+		state = mState;
+		t = tail(state);
+		if (head(state) >= t)
+			return NULL;
+	} while (!__sync_bool_compare_and_swap(&mState, state, pack(head(state), t - 1)));
+	return mTasks[t - 1];
+}
+
+// The sub-task jobs posted by running tasks, shared out the same way as
+// WorkerPool's (see IndexedJob.h).  A task finding every slot in use just
+// makes its calls itself.
+
+#define MAX_SUBTASK_JOBS 16
+
+struct SubTaskJob {
+	IndexedJob		job;
+	volatile int	busy;		// slot belongs to a job
+	char			pad[TASK_CACHE_LINE];
+};
+
+static SubTaskJob		sSubTaskJobs[MAX_SUBTASK_JOBS];
+static volatile int		sOpenSubTaskJobs = 0;
+
+TaskManagerImpl *	TaskManagerImpl::sInstance = NULL;
+
+bool TaskManagerImpl::runOneSubTask()
+{
+	if (sOpenSubTaskJobs == 0)
+		return false;
+	for (int n = 0; n < MAX_SUBTASK_JOBS; ++n) {
+		if (sSubTaskJobs[n].job.runOne())
+			return true;
+	}
+	return false;
+}
+
+void TaskManagerImpl::runSubTasks(void (*inFunc)(void *, int), void *inContext, int inCount)
+{
+	SubTaskJob *slot = NULL;
+	if (inCount > 1) {
+		for (int n = 0; n < MAX_SUBTASK_JOBS; ++n) {
+			if (__sync_bool_compare_and_swap(&sSubTaskJobs[n].busy, 0, 1)) {
+				slot = &sSubTaskJobs[n];
+				break;
+			}
+		}
+	}
+	if (slot == NULL) {
+		for (int n = 0; n < inCount; ++n)
+			(*inFunc)(inContext, n);
+		return;
+	}
+	TraceSpan span("subTasks", inCount);
+	IndexedJob &job = slot->job;
+	job.start(inFunc, inContext, inCount, AllocTracker::currentNote());
+	__sync_fetch_and_add(&sOpenSubTaskJobs, 1);
+	mThreadPool->recruit(inCount - 1);
+
+	while (job.runOne())
+		;
+	// The rest are under way on other threads.  Help with other tasks'
+	// sub-tasks until they finish, since those may be what they wait on.
+	while (!job.finished()) {
+		if (!runOneSubTask())
+			sched_yield();
+	}
+	__sync_fetch_and_sub(&sOpenSubTaskJobs, 1);
+	__sync_synchronize();
+	slot->busy = 0;
+}
+
+int TaskManager::ResolveThreadCount(int inThreadCount)
+{
+	if (inThreadCount > 0)
+		return inThreadCount;
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return (cpus > 0) ? (int) cpus : RT_THREAD_COUNT;
+}
+
+// A manager made while the shared pool exists gets as many workers as the
+// pool has, whatever <inThreadCount> asks for.
+
+TaskManagerImpl::TaskManagerImpl(int inThreadCount, int inInitialSlots)
+	: mThreadCount(0), mDeques(NULL), mNextDeque(0), mPlaced(false),
+	  mSlotsPerSlab(inInitialSlots > 0 ? inInitialSlots : 64), mSlotsUsed(0),
+	  mTaskCount(0), mThreadPool(NULL)
+{
+	addSlab();
+	mThreadPool = ThreadPool::Acquire(TaskManager::ResolveThreadCount(inThreadCount));
+	mThreadCount = mThreadPool->threadCount();
+	mDeques = new TaskDeque[mThreadCount];
+	mWake.resize(mThreadCount);
+	sInstance = this;
+}
+
+TaskManagerImpl::~TaskManagerImpl()
+{
+	if (sInstance == this)
+		sInstance = NULL;
+	ThreadPool::Release(mThreadPool);
+	delete [] mDeques;
+	releaseTasks();
+	for (std::vector<char *>::iterator it = mSlabs.begin(); it != mSlabs.end(); ++it)
+		delete [] *it;
+}
+
+// Called only when the current batch has outgrown the existing slabs.
+
+void TaskManagerImpl::addSlab()
+{
+#ifdef POOL_DEBUG
+	printf("TaskManagerImpl::addSlab: growing to %d slots\n", (int)(mSlabs.size() + 1) * mSlotsPerSlab);
+#endif
+	mSlabs.push_back(new char[mSlotsPerSlab * RT_TASK_SLOT_SIZE]);
+}
+
+// Destroy all tasks in the slab.  Only legal once every task has been run.
+
+void TaskManagerImpl::releaseTasks()
+{
+	for (int n = 0; n < mSlotsUsed; ++n) {
+		Task *task = (Task *) (mSlabs[n / mSlotsPerSlab] + (n % mSlotsPerSlab) * RT_TASK_SLOT_SIZE);
+		task->~Task();
+	}
+	mSlotsUsed = 0;
+}
 
 void TaskManagerImpl::addTask(Task *inTask)
 {
 #ifdef DEBUG
-	printf("TaskManagerImpl::addTask: adding task %p to linked list\n", inTask);
+	printf("TaskManagerImpl::addTask: adding task %p to deque %d\n", inTask, mNextDeque);
 #endif
-	// Each new task is put behind the previous one
-	inTask->next() = mTaskHead;
-	mTaskHead = inTask;
+	// Deal the tasks out round-robin, so that the workers which are woken
+	// (the first min(taskCount, threadCount)) each start with their own.
+	mDeques[mNextDeque].push(inTask);
+	if (++mNextDeque == mThreadCount)
+		mNextDeque = 0;
+	++mTaskCount;
+}
+
+void TaskManagerImpl::addTask(Task *inTask, int inWorker)
+{
+	mDeques[inWorker].push(inTask);
+	mPlaced = true;
+	++mTaskCount;
 }
 
 Task * TaskManagerImpl::getSingleTask()
 {
-	Task *task = mTaskStack.pop_atomic();
+	const int self = RTThread::GetIndexForThread();
+	Task *task = mDeques[self].popFront();
+	for (int n = 1; task == NULL && n < mThreadCount; ++n) {
+		int victim = self + n;
+		if (victim >= mThreadCount)
+			victim -= mThreadCount;
+		task = mDeques[victim].popBack();
+	}
+	// With no tasks left to start, help the running ones with their
+	// sub-tasks before going back to sleep.
+	if (task == NULL) {
+		while (runOneSubTask())
+			;
+	}
 #ifdef DEBUG
-	printf("TaskManagerImpl::getSingleTask: returning task %p from stack\n", task);
+	printf("TaskManagerImpl::getSingleTask: thread %d returning task %p\n", self, task);
 #endif
 	return task;
 }
@@ -208,26 +585,33 @@ Task * TaskManagerImpl::getSingleTask()
 void TaskManagerImpl::startAndWait()
 {
 #ifdef DEBUG
-	printf("TaskManagerImpl::startAndWait pushing tasks onto stack\n");
+	printf("TaskManagerImpl::startAndWait publishing %d tasks\n", mTaskCount);
 #endif
-	int taskCount = 0;
-	// Push entire reversed linked list into stack
-	for (Task *t = mTaskHead; t != NULL; ++taskCount) {
-		Task *next = t->next();
-		mTaskStack.push_atomic(t);
-		t = next;
+	TraceSpan span("waitForTasks", mTaskCount);
+	for (int i = 0; i < mThreadCount; ++i)
+		mDeques[i].publish();
+	// Any manager will do for RunSubTasks(), as they share the pool.
+	sInstance = this;
+	if (mPlaced) {
+		for (int i = 0; i < mThreadCount; ++i)
+			mWake[i] = !mDeques[i].empty();
+		mThreadPool->startAndWait(this, &mWake[0]);
 	}
-	mTaskHead = mTaskTail = NULL;
-#ifdef DEBUG
-    printf("TaskManagerImpl::startAndWait waiting on ThreadPool for %d tasks...\n", taskCount);
-#endif
-	mThreadPool->startAndWait(taskCount);
+	else
+		mThreadPool->startAndWait(this, mTaskCount);
+	for (int i = 0; i < mThreadCount; ++i)
+		mDeques[i].clear();
+	mNextDeque = 0;
+	mPlaced = false;
+	mTaskCount = 0;
+	releaseTasks();
 #ifdef DEBUG
 	printf("TaskManagerImpl::startAndWait done\n");
 #endif
 }
 
-TaskManager::TaskManager() : mImpl(new TaskManagerImpl)
+TaskManager::TaskManager(int inThreadCount, int inInitialSlots)
+	: mImpl(new TaskManagerImpl(inThreadCount, inInitialSlots))
 {
 }
 
@@ -236,3 +620,11 @@ TaskManager::~TaskManager()
 	delete mImpl;
 }
 
+bool TaskManager::RunSubTasks(SubTaskFunction inFunc, void *inContext, int inCount)
+{
+	TaskManagerImpl *impl = TaskManagerImpl::sInstance;
+	if (impl == NULL || RTThread::FindIndexForThread() < 0)
+		return false;
+	impl->runSubTasks(inFunc, inContext, inCount);
+	return true;
+}
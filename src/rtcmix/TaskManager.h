@@ -12,12 +12,17 @@
 #define _TASKMANAGER_H_
 
 #include <vector>
-#include "atomic_stack.h"
+#include <new>
+#include <stddef.h>
 
 #ifndef RT_THREAD_COUNT
 #define RT_THREAD_COUNT 2
 #endif
 
+// Every task is constructed in place inside a fixed-size slot taken from the
+// TaskManagerImpl slab.  This must be large enough for the biggest Task subclass.
+#define RT_TASK_SLOT_SIZE 64
+
 using namespace std;
 
 class Task
@@ -82,40 +87,97 @@ private:
 	Ret		mReturned;
 };
 
+// Compile-time check that a Task subclass fits in a slab slot.  Only the
+// 'true' specialization is defined.
+
+template <bool> struct TaskSlotCheck;
+template <> struct TaskSlotCheck<true> { enum { ok = 1 }; };
+
 class ThreadPool;
+class TaskDeque;
 
 class TaskManagerImpl : public TaskProvider
 {
 public:
-	TaskManagerImpl();
+	TaskManagerImpl(int inThreadCount, int inInitialSlots);
 	virtual ~TaskManagerImpl();
+	// Called by each worker:  pops from the calling thread's own deque, then
+	// steals from the other workers' deques once its own is empty.
 	virtual Task *	getSingleTask();
+	inline void *	allocTaskSlot();
 	void	addTask(Task *inTask);
+	void	addTask(Task *inTask, int inWorker);
 	void	startAndWait();
+	int		threadCount() const { return mThreadCount; }
+	void	runSubTasks(void (*inFunc)(void *, int), void *inContext, int inCount);
+	// Runs one unclaimed sub-task, if there is one.
+	static bool	runOneSubTask();
+	static TaskManagerImpl *	sInstance;
 private:
+	void	addSlab();
+	void	releaseTasks();
+
+	int						mThreadCount;
+	TaskDeque *				mDeques;		// one per worker thread
+	int						mNextDeque;		// round-robin target for addTask()
+	bool					mPlaced;		// addTask(task, worker) used this batch
+	std::vector<char>		mWake;			// which workers startAndWait() wakes
+
+	// Slots are handed out in order and all released at once after each
+	// startAndWait(), so slabs hold the high-water mark of tasks per batch
+	// and nothing is allocated once that has been reached.
+	std::vector<char *>		mSlabs;
+	int						mSlotsPerSlab;
+	int						mSlotsUsed;
+	int						mTaskCount;
 	ThreadPool *			mThreadPool;
-	Task *					mTaskHead;
-	Task *					mTaskTail;
-#ifdef MACOSX
-	TAtomicStack2<Task>		mTaskStack;
-#else
-	TAtomicStack<Task>		mTaskStack;
-#endif
 };
 
+inline void * TaskManagerImpl::allocTaskSlot()
+{
+	int slab = mSlotsUsed / mSlotsPerSlab;
+	if (slab == (int) mSlabs.size())
+		addSlab();
+	char *slot = mSlabs[slab] + (mSlotsUsed % mSlotsPerSlab) * RT_TASK_SLOT_SIZE;
+	++mSlotsUsed;
+	return slot;
+}
+
 class TaskManager
 {
 public:
-	TaskManager();
+	// inThreadCount <= 0 means use one worker per online processor.
+	// All TaskManagers in a process share one set of workers, sized by the
+	// first; later ones get that many whatever they ask for.
+	// inInitialSlots is the number of tasks we expect per batch (re-sized as needed)
+	TaskManager(int inThreadCount=0, int inInitialSlots=64);
 	~TaskManager();
+	int		threadCount() const { return mImpl->threadCount(); }
+	// Returns the number of workers that TaskManager(inThreadCount) will create.
+	static int	ResolveThreadCount(int inThreadCount);
 	template <typename Object, typename Ret, Ret (Object::*Method)()>
 	inline void addTask(Object * inObject);
 	template <typename Object, typename Ret, typename Arg, Ret (Object::*Method)(Arg)>
 	inline void addTask(Object * inObject, Arg inArg);
 	template <typename Object, typename Ret, typename Arg1, typename Arg2, Ret (Object::*Method)(Arg1, Arg2)>
 	inline void addTask(Object * inObject, Arg1 inArg1, Arg2 inArg2);
+	// As above, but queued for worker <inWorker> (0 to threadCount() - 1),
+	// which runs it unless another worker runs out of tasks first and takes
+	// it.  Only the workers given tasks are woken for the batch.
+	template <typename Object, typename Ret, Ret (Object::*Method)()>
+	inline void addTaskFor(Object * inObject, int inWorker);
 	template <typename Object>
 	inline void waitForTasks(vector<Object *> &ioVector);
+
+	// Called from within a running task: call <inFunc>(<inContext>, n) for
+	// each n from 0 to <inCount> - 1, and return when all have returned.
+	// Workers with no tasks left take calls too, and so does the caller
+	// while it waits, so a task never blocks a worker the others need.
+	// The calls may happen at the same time, in any order, and may make
+	// calls of their own.  Returns false, having made no calls, if the
+	// caller is not a TaskManager thread.
+	typedef void (*SubTaskFunction)(void *inContext, int inIndex);
+	static bool	RunSubTasks(SubTaskFunction inFunc, void *inContext, int inCount);
 private:
 	TaskManagerImpl	*mImpl;
 };
@@ -123,19 +185,33 @@ private:
 template <typename Object, typename Ret, Ret (Object::*Method)()>
 inline void TaskManager::addTask(Object * inObject)
 {
-	mImpl->addTask(new NoArgumentTask<Object, Ret, Method>(inObject));
+	typedef NoArgumentTask<Object, Ret, Method> TaskType;
+	(void) TaskSlotCheck<sizeof(TaskType) <= RT_TASK_SLOT_SIZE>::ok;
+	mImpl->addTask(new (mImpl->allocTaskSlot()) TaskType(inObject));
+}
+
+template <typename Object, typename Ret, Ret (Object::*Method)()>
+inline void TaskManager::addTaskFor(Object * inObject, int inWorker)
+{
+	typedef NoArgumentTask<Object, Ret, Method> TaskType;
+	(void) TaskSlotCheck<sizeof(TaskType) <= RT_TASK_SLOT_SIZE>::ok;
+	mImpl->addTask(new (mImpl->allocTaskSlot()) TaskType(inObject), inWorker);
 }
 
 template <typename Object, typename Ret, typename Arg, Ret (Object::*Method)(Arg)>
 inline void TaskManager::addTask(Object * inObject, Arg inArg)
 {
-	mImpl->addTask(new OneArgumentTask<Object, Ret, Arg, Method>(inObject, inArg));
+	typedef OneArgumentTask<Object, Ret, Arg, Method> TaskType;
+	(void) TaskSlotCheck<sizeof(TaskType) <= RT_TASK_SLOT_SIZE>::ok;
+	mImpl->addTask(new (mImpl->allocTaskSlot()) TaskType(inObject, inArg));
 }
 
 template <typename Object, typename Ret, typename Arg1, typename Arg2, Ret (Object::*Method)(Arg1, Arg2)>
 inline void TaskManager::addTask(Object * inObject, Arg1 inArg1, Arg2 inArg2)
 {
-	mImpl->addTask(new TwoArgumentTask<Object, Ret, Arg1, Arg2, Method>(inObject, inArg1, inArg2));
+	typedef TwoArgumentTask<Object, Ret, Arg1, Arg2, Method> TaskType;
+	(void) TaskSlotCheck<sizeof(TaskType) <= RT_TASK_SLOT_SIZE>::ok;
+	mImpl->addTask(new (mImpl->allocTaskSlot()) TaskType(inObject, inArg1, inArg2));
 }
 
 template <typename Object>
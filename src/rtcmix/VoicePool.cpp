@@ -0,0 +1,431 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+// VoicePool.cpp -- many notes as the voices of one instrument.  See
+// VoicePool.h.
+
+#include "VoicePool.h"
+#include <RTcmix.h>
+#include <RTOption.h>
+#include <PField.h>
+#include "PFieldProgram.h"
+#include "ControlTable.h"
+#include "BusSlot.h"
+#include "rt.h"
+#include "rtcmix_types.h"
+#include "heap/heap.h"
+#include "lock.h"
+#include <ugens.h>
+#include <pthread.h>
+#include <string.h>
+#include <vector>
+#include <new>
+
+extern int resetval;		// declared in src/rtcmix/minc_functions.c
+
+// The pool taking notes for each instrument name and bus config.  Only
+// parsers use this, under sPoolLock, which the audio thread never takes.
+// Each entry holds a reference to its pool and to its bus slot, so that the
+// slot's address is never reused for another config while it is here.
+
+struct OpenPool {
+	const rt_item *	item;
+	const BusSlot *	slot;
+	VoicePool *		pool;
+};
+
+static std::vector<OpenPool> sOpenPools;
+static pthread_mutex_t sPoolLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Counts flushes of the scheduler, so that parsers stop posting to the
+// pools that went with them.
+static volatile unsigned sGeneration = 0;
+
+void VoicePool::SlotRing::put(int slot)
+{
+	const unsigned t = tail;
+	slots[t & (kMaxNotes - 1)] = slot;
+	__sync_synchronize();		// publish the slot before the new tail
+	tail = t + 1;
+}
+
+bool VoicePool::SlotRing::take(int *slot)
+{
+	const unsigned h = head;
+	if (h == tail)
+		return false;
+	__sync_synchronize();		// read the slot only after seeing the tail
+	*slot = slots[h & (kMaxNotes - 1)];
+	__sync_synchronize();		// finish reading before releasing the slot
+	head = h + 1;
+	return true;
+}
+
+VoicePool::VoicePool()
+	: _notes(new Note[kMaxNotes]), _firstFrame(0), _generation(sGeneration),
+	  _state(kOpen), _freeCount(kMaxNotes), _pendingCount(0),
+	  _soundingCount(0), _mix(NULL)
+{
+	for (int n = 0; n < kMaxNotes; ++n) {
+		_free[n] = kMaxNotes - 1 - n;
+		for (int f = 0; f < kMaxFields; ++f)
+			_notes[n].fields[f] = NULL;
+	}
+}
+
+VoicePool::~VoicePool()
+{
+	for (int n = 0; n < kMaxNotes; ++n) {
+		for (int f = 0; f < kMaxFields; ++f)
+			RefCounted::unref(_notes[n].fields[f]);
+	}
+	delete [] _notes;
+	freeBuffer(_mix);
+}
+
+int VoicePool::configure()
+{
+	_mix = allocBuffer(kBlockFrames * outputChannels());
+	if (_mix == NULL)
+		return die(name(), "No memory left in the budget for the voice pool.");
+	return 0;
+}
+
+// Set up to play on from <startFrame>, the frame of our first note, which
+// starts at <start> seconds and lasts <dur>.
+
+int VoicePool::open(float start, float dur, FRAMETYPE startFrame)
+{
+	if (rtsetoutput(start, dur, this) == -1)
+		return -1;
+	setPlanarOutput();
+	setSkip(int(SR / (float) resetval));		// as setup() does for a note
+	_firstFrame = startFrame;
+	return 0;
+}
+
+// Return the slots of finished notes to the free list.
+
+void VoicePool::reclaim()
+{
+	int slot;
+	while (_outbox.take(&slot)) {
+		Note &note = _notes[slot];
+		for (int f = 0; f < note.nfields; ++f) {
+			RefCounted::unref(note.fields[f]);
+			note.fields[f] = NULL;
+		}
+		_free[_freeCount++] = slot;
+	}
+}
+
+// Hand a note to the audio thread.  Returns 1 if we took it, 0 if we have
+// closed or have no room, and -1 if the subclass won't play it.
+
+int VoicePool::post(const double values[], PField * const fields[],
+					int nargs, FRAMETYPE start, int frames)
+{
+	if (!__sync_bool_compare_and_swap(&_state, kOpen, kPosting))
+		return 0;
+	reclaim();
+	int status = 0;
+	if (_freeCount > 0) {
+		const int slot = _free[--_freeCount];
+		Note &note = _notes[slot];
+		note.start = start;
+		note.frames = frames;
+		note.nfields = nargs;
+		note.played = 0;
+		note.toUpdate = 0;
+		for (int f = 0; f < nargs; ++f) {
+			note.values[f] = values[f];
+			note.fields[f] = fields[f];
+			if (fields[f] != NULL)
+				fields[f]->ref();
+		}
+		if (acceptNote(slot, values, fields, nargs)) {
+			_inbox.put(slot);
+			status = 1;
+		}
+		else {
+			for (int f = 0; f < nargs; ++f) {
+				RefCounted::unref(note.fields[f]);
+				note.fields[f] = NULL;
+			}
+			_free[_freeCount++] = slot;
+			status = -1;
+		}
+	}
+	__sync_synchronize();		// the note is in before we reopen
+	_state = kOpen;
+	return status;
+}
+
+// Stop taking notes for good, unless one is on its way in.  Called when we
+// have nothing left to play.
+
+bool VoicePool::tryClose()
+{
+	if (!__sync_bool_compare_and_swap(&_state, kOpen, kClosed))
+		return false;		// being posted to
+	if (_inbox.empty())
+		return true;
+	_state = kOpen;			// one came in since takeNotes()
+	return false;
+}
+
+// Move posted notes into the heap of those waiting to start.
+
+void VoicePool::takeNotes()
+{
+	int slot;
+	while (_inbox.take(&slot)) {
+		int n = _pendingCount++;
+		// Sift up, soonest start on top
+		while (n > 0) {
+			const int parent = (n - 1) / 2;
+			if (_notes[_pending[parent]].start <= _notes[slot].start)
+				break;
+			_pending[n] = _pending[parent];
+			n = parent;
+		}
+		_pending[n] = slot;
+	}
+}
+
+// Start sounding the notes that begin before <blockEnd>.
+
+void VoicePool::startNotes(FRAMETYPE blockEnd)
+{
+	while (_pendingCount > 0 && _notes[_pending[0]].start < blockEnd) {
+		_sounding[_soundingCount++] = _pending[0];
+		const int last = _pending[--_pendingCount];
+		const FRAMETYPE lastStart = _notes[last].start;
+		int n = 0;
+		// Sift down
+		for (;;) {
+			int child = 2 * n + 1;
+			if (child >= _pendingCount)
+				break;
+			if (child + 1 < _pendingCount
+					&& _notes[_pending[child + 1]].start < _notes[_pending[child]].start)
+				++child;
+			if (lastStart <= _notes[_pending[child]].start)
+				break;
+			_pending[n] = _pending[child];
+			n = child;
+		}
+		if (_pendingCount > 0)
+			_pending[n] = last;
+	}
+}
+
+void VoicePool::updateNote(int slot)
+{
+	const Note &note = _notes[slot];
+	double p[kMaxFields];
+	const double percent = (double) note.played / note.frames;
+	ControlTable::renderFrame(note.start + note.played, percent);	// for timed controls
+	int f;
+	for (f = 0; f < note.nfields; ++f)
+		p[f] = (note.fields[f] != NULL) ? note.fields[f]->doubleValue(percent)
+										: note.values[f];
+	for (; f < kMaxFields; ++f)
+		p[f] = 0.0;
+	updateVoice(slot, p, note.nfields);
+}
+
+// Add the note's part of the <frames> frames from <blockStart> into _mix.
+
+void VoicePool::renderNote(int slot, FRAMETYPE blockStart, int frames)
+{
+	Note &note = _notes[slot];
+	const int nchans = outputChannels();
+	int pos = 0;
+	if (note.played == 0 && note.start > blockStart)
+		pos = int(note.start - blockStart);
+	while (pos < frames && note.played < note.frames) {
+		if (note.toUpdate == 0) {
+			updateNote(slot);
+			note.toUpdate = getSkip();
+		}
+		int count = frames - pos;
+		if (count > note.toUpdate)
+			count = note.toUpdate;
+		if (count > note.frames - note.played)
+			count = note.frames - note.played;
+		float *outs[MAXBUS];
+		for (int chan = 0; chan < nchans; ++chan)
+			outs[chan] = _mix + chan * kBlockFrames + pos;
+		renderVoice(slot, outs, count);
+		pos += count;
+		note.played += count;
+		note.toUpdate -= count;
+	}
+}
+
+int VoicePool::run()
+{
+	takeNotes();
+
+	const int nframes = framesToRun();
+	const int nchans = outputChannels();
+	const FRAMETYPE chunkStart = get_ichunkstart();
+	for (int done = 0; done < nframes; ) {
+		int frames = nframes - done;
+		if (frames > kBlockFrames)
+			frames = kBlockFrames;
+		const FRAMETYPE blockStart = chunkStart + done;
+		startNotes(blockStart + frames);
+		for (int chan = 0; chan < nchans; ++chan)
+			memset(_mix + chan * kBlockFrames, 0, sizeof(float) * frames);
+		for (int n = 0; n < _soundingCount; ) {
+			const int slot = _sounding[n];
+			renderNote(slot, blockStart, frames);
+			if (_notes[slot].played == _notes[slot].frames) {
+				_sounding[n] = _sounding[--_soundingCount];
+				_outbox.put(slot);
+			}
+			else
+				++n;
+		}
+		for (int chan = 0; chan < nchans; ++chan) {
+			int stride;
+			BUFTYPE *out = outputChannel(chan, &stride);
+			const float *mix = _mix + chan * kBlockFrames;
+			if (stride == 1)
+				memcpy(out, mix, sizeof(float) * frames);
+			else {
+				for (int i = 0; i < frames; ++i)
+					out[i * stride] = mix[i];
+			}
+		}
+		advanceOutput(frames);
+		done += frames;
+	}
+	increment(nframes);
+
+	// Stay on the rtQueues for another buffer at a time until done.
+	const FRAMETYPE chunkEnd = chunkStart + nframes;
+	if (_soundingCount == 0 && _pendingCount == 0 && tryClose())
+		setendsamp(chunkEnd);
+	else
+		setendsamp(chunkEnd + RTBUFSAMPS);
+	return nframes;
+}
+
+// ------------------------------------------------------------ playNote ---
+
+static void releaseFields(PField *fields[], int count)
+{
+	for (int f = 0; f < count; ++f)
+		RefCounted::unref(fields[f]);
+}
+
+bool VoicePool::playNote(rt_item *item, const Arg arglist[], int nargs,
+						 heap *rtHeap)
+{
+	if (!RTOption::voicePool() || item->rt_pool == NULL
+			|| nargs < 2 || nargs > kMaxFields || !RTcmix::outputOpen())
+		return false;
+
+	double values[kMaxFields];
+	PField *fields[kMaxFields];
+	for (int f = nargs; f < kMaxFields; ++f)
+		values[f] = 0.0;
+	for (int arg = 0; arg < nargs; ++arg) {
+		const Arg &theArg = arglist[arg];
+		fields[arg] = NULL;
+		if (theArg.isType(DoubleType))
+			values[arg] = (double) theArg;
+		else if ((PField *) theArg != NULL) {
+			// Operator trees are flattened, as for any note.
+			fields[arg] = PFieldProgram::compile((PField *) theArg);
+			fields[arg]->ref();
+			values[arg] = fields[arg]->doubleValue(0.0);
+		}
+		else {
+			releaseFields(fields, arg);
+			return false;
+		}
+	}
+
+	// These are rounded as for any note (see Instrument::configureEndSamp()
+	// and rtsetoutput()).
+	const float start = values[0], dur = values[1];
+	const int frames = (int) (0.5 + dur * RTcmix::sr());
+	if (start < 0.0f || frames <= 0) {
+		releaseFields(fields, nargs);
+		return false;
+	}
+	FRAMETYPE startFrame = (FRAMETYPE) (0.5 + start * RTcmix::sr());
+	if (RTcmix::interactive())
+		startFrame += RTcmix::getElapsedFrames();
+	BusSlot *busSlot = RTcmix::get_bus_config(item->rt_name);
+
+	int status = 0;
+	pthread_mutex_lock(&sPoolLock);
+	OpenPool *entry = NULL;
+	for (std::vector<OpenPool>::iterator it = sOpenPools.begin();
+			it != sOpenPools.end(); ++it) {
+		if (it->item == item && it->slot == busSlot) {
+			entry = &*it;
+			break;
+		}
+	}
+	VoicePool *pool = entry ? entry->pool : NULL;
+	if (pool != NULL && pool->_generation == sGeneration
+			&& startFrame >= pool->_firstFrame)
+		status = pool->post(values, fields, nargs, startFrame, frames);
+
+	if (status == 0) {
+		// That pool is closed, full or gone, or started after this note.
+		pool = NULL;
+		try {
+			pool = (*item->rt_pool)();
+		}
+		catch (std::bad_alloc &) {
+		}
+		if (pool != NULL) {
+			pool->ref();		// the scheduler's
+			if (pool->open(start, dur, startFrame) == 0)
+				status = pool->post(values, fields, nargs, startFrame, frames);
+			Instrument *inst = pool;
+			if (status == 1 && RTcmix::interactive()
+					&& inst->configure(RTcmix::bufsamps()) != 0)
+				status = -1;
+			if (status == 1) {
+				pool->setendsamp(startFrame + frames);
+				if (RTcmix::interactive() || RTcmix::parsingAhead())
+					rtHeap->post(pool, startFrame);
+				else
+					rtHeap->insert(pool, startFrame);
+				pool->ref();	// ours
+				if (entry != NULL) {
+					entry->pool->unref();
+					entry->pool = pool;
+				}
+				else {
+					OpenPool newEntry = { item, busSlot, pool };
+					sOpenPools.push_back(newEntry);
+					busSlot = NULL;	// the entry keeps our reference
+				}
+			}
+			else
+				pool->unref();
+		}
+	}
+	pthread_mutex_unlock(&sPoolLock);
+	RefCounted::unref(busSlot);
+
+	releaseFields(fields, nargs);
+	if (status == 1 && RTcmix::parsingAhead())
+		RTcmix::advanceParseHorizon(startFrame);
+	return status == 1;
+}
+
+void VoicePool::flushed()
+{
+	__sync_add_and_fetch(&sGeneration, 1);
+}
@@ -0,0 +1,125 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _VOICEPOOL_H_
+#define _VOICEPOOL_H_ 1
+
+#include <Instrument.h>
+
+struct rt_item;
+struct Arg;
+class heap;
+
+// One long-lived instrument that plays many notes as voices of its own.
+// Most of the cost of a short note made the usual way goes to the Instrument,
+// its PFieldSet and outbuf, the trip through the heap and rtQueues, and the
+// mixing of its outbuf into the buses.  With the voice_pool option on,
+// RTcmix::startInst() instead hands each note of an instrument introduced
+// with RT_INTRO_POOL to the open pool for its name and bus config, making
+// one when there is none.  The pool starts each voice at its exact frame,
+// updates its pfields once per control period from there, and renders all
+// of its voices, a block at a time, into one planar outbuf.  A pool ends
+// once it has nothing left to play, and the next note makes another.
+//
+// A subclass decides which notes it can play as voices -- the rest are made
+// as instruments of their own, as usual -- and does the DSP for a voice.
+// The voice numbers it is given are from 0 to kMaxNotes - 1.
+//
+// A pooled note returns no instrument handle.  It can take constants and
+// PFields (including dynamic ones), but not strings or literal arrays.
+
+class VoicePool : public Instrument {
+public:
+	enum {
+		kMaxNotes = 512,	// waiting and sounding at once, per pool
+		kMaxFields = 12,	// pfields per note
+		kBlockFrames = 256	// most frames asked of renderVoice() at once
+	};
+
+	// Play the note described by <arglist> as a voice, scheduling a new
+	// pool into <rtHeap> if need be.  Returns false if the note is to be
+	// made the usual way: the option is off, <item> has no pool, or the
+	// pool will not take the note.
+	static bool		playNote(rt_item *item, const Arg arglist[], int nargs,
+							 heap *rtHeap);
+	// Called when the scheduler is flushed, after which the pools in it
+	// will not run again.
+	static void		flushed();
+
+	virtual int		configure();
+	virtual int		run();
+
+protected:
+	VoicePool();
+	virtual			~VoicePool();
+
+	// On the parser thread: whether the note with pfields <p> can be played
+	// as voice <voice>, and if so, set the voice up for it.  <fields> holds
+	// the PField given for each of <p>, or NULL for a constant.  Look up
+	// tables here rather than on the audio thread.  In these and in
+	// updateVoice(), <p> has kMaxFields values, zero past the note's own.
+	virtual bool	acceptNote(int voice, const double p[],
+							   PField * const fields[], int nargs) = 0;
+	// On the audio thread: take the pfields' current values, once at the
+	// start of the note and once per control period after.
+	virtual void	updateVoice(int voice, const double p[], int nargs) = 0;
+	// Add the voice's next <frames> frames into each of <outs>, one per
+	// output channel.
+	virtual void	renderVoice(int voice, float *outs[], int frames) = 0;
+
+private:
+	struct Note {
+		FRAMETYPE	start;		// output frame
+		int			frames;
+		int			nfields;
+		double		values[kMaxFields];	// constants, and starting values
+		PField *	fields[kMaxFields];	// NULL for a constant
+		int			played;		// frames so far
+		int			toUpdate;	// frames until the next updateVoice()
+	};
+
+	// Single-producer, single-consumer ring of note slots.  A slot is in
+	// one place at a time, so a ring never holds more than kMaxNotes.
+	struct SlotRing {
+		SlotRing() : head(0), tail(0) {}
+		void	put(int slot);
+		bool	take(int *slot);
+		bool	empty() const { return head == tail; }
+		int		slots[kMaxNotes];
+		volatile unsigned head;		// written by the consumer
+		volatile unsigned tail;		// written by the producer
+	};
+
+	enum { kOpen, kPosting, kClosed };
+
+	int				open(float start, float dur, FRAMETYPE startFrame);
+	int				post(const double values[], PField * const fields[],
+						 int nargs, FRAMETYPE start, int frames);
+	void			reclaim();
+	void			takeNotes();
+	void			startNotes(FRAMETYPE blockEnd);
+	void			updateNote(int slot);
+	void			renderNote(int slot, FRAMETYPE blockStart, int frames);
+	bool			tryClose();
+
+	Note *			_notes;
+	FRAMETYPE		_firstFrame;	// no note may start before this
+	unsigned		_generation;	// sGeneration when opened
+	volatile int	_state;
+
+	// Parser side
+	int				_free[kMaxNotes];
+	int				_freeCount;
+	SlotRing		_inbox;			// parser to audio thread
+	SlotRing		_outbox;		// finished notes, back again
+
+	// Audio side
+	int				_pending[kMaxNotes];	// heap, soonest start first
+	int				_pendingCount;
+	int				_sounding[kMaxNotes];
+	int				_soundingCount;
+	float *			_mix;			// one block of each channel
+};
+
+#endif	// _VOICEPOOL_H_
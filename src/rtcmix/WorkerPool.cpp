@@ -0,0 +1,90 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#include "WorkerPool.h"
+#include "IndexedJob.h"
+#include "AllocTracker.h"
+#include "PrintRing.h"
+#include "Denormals.h"
+#include <RTOption.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+// The job being worked on.
+
+static IndexedJob			sJob;
+static volatile int			sBusy = 0;		// a caller has the helpers
+static int					sThreads = 0;
+
+static pthread_mutex_t	sLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	sWake = PTHREAD_COND_INITIALIZER;
+
+void WorkerPool::run(Function func, void *context, int count)
+{
+	if (count <= 1 || RTOption::frameThreads() == 0
+			|| !__sync_bool_compare_and_swap(&sBusy, 0, 1)) {
+		for (int n = 0; n < count; ++n)
+			(*func)(context, n);
+		return;
+	}
+	startThreads(RTOption::frameThreads());
+
+	const unsigned generation = sJob.start(func, context, count,
+										   AllocTracker::currentNote());
+
+	pthread_mutex_lock(&sLock);
+	pthread_cond_broadcast(&sWake);
+	pthread_mutex_unlock(&sLock);
+
+	work(generation);
+	// What is left is at most one call per helper, already under way.
+	while (!sJob.finished())
+		sched_yield();
+
+	__sync_synchronize();
+	sBusy = 0;
+}
+
+// Only the caller holding the helpers gets here, so <sThreads> needs no lock.
+
+void WorkerPool::startThreads(int count)
+{
+	if (count > kMaxThreads)
+		count = kMaxThreads;
+	while (sThreads < count) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, threadMain, NULL) != 0) {
+			fprintf(stderr, "WorkerPool: could not start helper thread\n");
+			break;
+		}
+		pthread_detach(thread);
+		++sThreads;
+	}
+}
+
+void WorkerPool::work(unsigned generation)
+{
+	while (sJob.opening(generation))
+		sched_yield();
+	while (sJob.runOne(generation))
+		;
+}
+
+void *WorkerPool::threadMain(void *)
+{
+	AllocTracker::realtimeThread();
+	PrintRing::realtimeThread();
+	unsigned seen = 0;
+	for (;;) {
+		pthread_mutex_lock(&sLock);
+		while (sJob.generation() == seen)
+			pthread_cond_wait(&sWake, &sLock);
+		seen = sJob.generation();
+		pthread_mutex_unlock(&sLock);
+		Denormals::apply();
+		work(seen);
+	}
+	return NULL;
+}
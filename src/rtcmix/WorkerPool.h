@@ -0,0 +1,32 @@
+/* RTcmix  - Copyright (C) 2000  The RTcmix Development Team
+   See ``AUTHORS'' for a list of contributors. See ``LICENSE'' for
+   the license to this software and for a DISCLAIMER OF ALL WARRANTIES.
+*/
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_ 1
+
+// A few helper threads that a note can hand independent pieces of one run()
+// to, such as the FFTs of the overlapping frames of a spectral instrument.
+// The thread calling run() works through the pieces along with the helpers,
+// and only one caller at a time gets the helpers: if another note already
+// has them, or the frame_threads option is 0, the caller simply does all of
+// the work itself.  So a run() never waits for helpers to become free, and
+// calls made from TaskManager threads cannot deadlock.
+
+class WorkerPool {
+public:
+	typedef void (*Function)(void *context, int index);
+
+	// Call <func>(<context>, n) for each n from 0 to <count> - 1, and return
+	// when all have returned.  The calls may happen at the same time, in any
+	// order, on any thread.
+	static void		run(Function func, void *context, int count);
+
+	enum { kMaxThreads = 16 };
+private:
+	static void		startThreads(int count);
+	static void		work(unsigned generation);
+	static void *	threadMain(void *);
+};
+
+#endif	// _WORKERPOOL_H_
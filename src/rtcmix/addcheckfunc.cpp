@@ -12,11 +12,13 @@
 #include <ug_intro.h>
 #include <string.h>
 #include <RTOption.h>
+#include "NoteSetup.h"
 
 #define WARN_DUPLICATES
 
 typedef struct _func {
    struct _func *next;
+   struct _func *hash_next;   /* next entry in the same sFuncHash bucket */
    union {
       double (*legacy_return) (double *, int);
       double (*number_return) (const Arg[], int);
@@ -34,8 +36,17 @@ struct FunctionEntry {
 	char *funcName;
 	char *dsoPath;
 	struct FunctionEntry *next;
+	struct FunctionEntry *hashNext;
 };
 
+/* Every script call looks its name up here, so _func_list and
+   _functionRegistry are indexed by name hash.  The lists still hold the
+   entries (in order of introduction) and own them.
+*/
+static RTcmixFunction *sFuncHash[RTcmix::NameHashSize];
+static RTcmixFunction *sFuncTail = NULL;
+static FunctionEntry *sRegistryHash[RTcmix::NameHashSize];
+
 /* --------------------------------------------------------------- addfunc -- */
 /* Place a function into the table we search when handed a function name
    from the parser.  addfunc is called only from the UG_INTRO* macros.
@@ -69,6 +80,7 @@ RTcmix::addfunc(
    }
 
    this_node->next = NULL;
+   this_node->hash_next = NULL;
    switch (return_type) {
       case DoubleType:
 	  	if (legacy)
@@ -95,23 +107,25 @@ RTcmix::addfunc(
    /* Place new node at tail of list.  Warn if this function name is already
       in list.
    */
-   if (_func_list == NULL) {
-      _func_list = this_node;
-      return;
-   }
-   for (cur_node = _func_list; cur_node->next != NULL; cur_node = cur_node->next) {
+   if ((cur_node = findfunc(func_label)) != NULL) {
 #ifdef WARN_DUPLICATES
-      if (strcmp(cur_node->func_label, this_node->func_label) == 0) {
-         if (!autoload)
-             rtcmix_advise("addfunc", "Function '%s' already introduced",
-                  this_node->func_label);
-          delete this_node;
-         return;
-      }
+      if (!autoload)
+          rtcmix_advise("addfunc", "Function '%s' already introduced",
+               this_node->func_label);
 #endif
+      delete this_node;
+      return;
    }
 //   RTPrintf("addfunc: Function '%s' introduced at %p\n", this_node->func_label, this_node->func_ptr.legacy_return);
-   cur_node->next = this_node;
+   if (_func_list == NULL)
+      _func_list = this_node;
+   else
+      sFuncTail->next = this_node;
+   sFuncTail = this_node;
+   const unsigned h = nameHash(func_label);
+   this_node->hash_next = sFuncHash[h];
+   sFuncHash[h] = this_node;
+   ++_dispatchGeneration;
 } 
 
 
@@ -125,6 +139,8 @@ RTcmix::freefuncs()
 		cur_node = next;
 	}
 	_func_list = NULL;
+	sFuncTail = NULL;
+	memset(sFuncHash, 0, sizeof(sFuncHash));
 	
 	// DAS added 01/2014
 	
@@ -134,15 +150,17 @@ RTcmix::freefuncs()
 		entry = next;
 	}
 	_functionRegistry = NULL;
+	memset(sRegistryHash, 0, sizeof(sRegistryHash));
+	++_dispatchGeneration;
 }
 
 /* ------------------------------------------------------------- findfunc -- */
-static RTcmixFunction *
-findfunc(RTcmixFunction *func_list, const char *func_label)
+RTcmixFunction *
+RTcmix::findfunc(const char *func_label)
 {
    RTcmixFunction *cur_node;
 
-   for (cur_node = func_list; cur_node; cur_node = cur_node->next) {
+   for (cur_node = sFuncHash[nameHash(func_label)]; cur_node; cur_node = cur_node->hash_next) {
       if (strcmp(cur_node->func_label, func_label) == 0) {
          return cur_node;
       }
@@ -175,12 +193,12 @@ RTcmix::checkfunc(const char *funcname, const Arg arglist[], const int nargs,
 {
    RTcmixFunction *func;
 
-   func = ::findfunc(_func_list, funcname);
+   func = findfunc(funcname);
 
    // If we did not find it, try loading it from our list of registered DSOs.
    if (func == NULL) {
       if (findAndLoadFunction(funcname) == 0) {
-         func = ::findfunc(_func_list, funcname);
+         func = findfunc(funcname);
 		  if (func == NULL) {
                return FUNCTION_NOT_FOUND;
 		  }
@@ -190,6 +208,14 @@ RTcmix::checkfunc(const char *funcname, const Arg arglist[], const int nargs,
 	  }
    }
 
+   return callfunc(func, funcname, arglist, nargs, retval);
+}
+
+/* -------------------------------------------------------------- callfunc -- */
+int
+RTcmix::callfunc(RTcmixFunction *func, const char *funcname,
+                 const Arg arglist[], const int nargs, Arg *retval)
+{
    /* function found, so call it */
    /* DAS: in order to properly report errors within function that return doubles,
       we have to use try/catch because there are no return values guaranteed not
@@ -199,6 +225,11 @@ RTcmix::checkfunc(const char *funcname, const Arg arglist[], const int nargs,
 
    printargs(funcname, arglist, nargs);
 
+   // Notes held for parallel setup must see the state this call may change.
+   // Functions returning handles just make new tables, streams and such.
+   if (func->return_type != HandleType && NoteSetup::pending())
+      NoteSetup::flush();
+
    int status = 0;
 
     switch (func->return_type) {
@@ -302,7 +333,7 @@ RTcmix::checkfunc(const char *funcname, const Arg arglist[], const int nargs,
 // for a given function.
 
 FunctionEntry::FunctionEntry(const char *fname, const char *dso_path)
-	: funcName(strdup(fname)), dsoPath(strdup(dso_path)), next(NULL)
+	: funcName(strdup(fname)), dsoPath(strdup(dso_path)), next(NULL), hashNext(NULL)
 {
 }
 
@@ -313,20 +344,21 @@ FunctionEntry::~FunctionEntry()
 }
 
 static FunctionEntry *
-findFunctionEntry(FunctionEntry *entry, const char *funcname)
+findFunctionEntry(const char *funcname)
 {
+	FunctionEntry *entry = sRegistryHash[RTcmix::nameHash(funcname)];
 	while (entry != NULL) {
 		if (!strcmp(entry->funcName, funcname))
 			return entry;
-		entry = entry->next;
+		entry = entry->hashNext;
 	}
 	return NULL;
 }
 
 static const char *
-getDSOPath(FunctionEntry *entry, const char *funcname)
+getDSOPath(const char *funcname)
 {
-	FunctionEntry * fentry = findFunctionEntry(entry, funcname);
+	FunctionEntry * fentry = findFunctionEntry(funcname);
 	if (fentry != NULL)
         return fentry->dsoPath;
 	return NULL;
@@ -343,7 +375,7 @@ RTcmix::findAndLoadFunction(const char *funcname)
 {
 	const char *path;
 	int status = -1;
-	if ((path = ::getDSOPath(_functionRegistry, funcname)) != NULL) {
+	if ((path = ::getDSOPath(funcname)) != NULL) {
 		char fullDSOPath[128];
 		double pp[1];
 		snprintf(fullDSOPath, 128, "%s.so", path);
@@ -368,10 +400,13 @@ int
 RTcmix::registerFunction(const char *funcName, const char *dsoPath)
 {
 	const char *path;
-	if ((path = ::getDSOPath(_functionRegistry, funcName)) == NULL) {
+	if ((path = ::getDSOPath(funcName)) == NULL) {
 		FunctionEntry *newEntry = new FunctionEntry(funcName, dsoPath);
 		newEntry->next = _functionRegistry;
 		_functionRegistry = newEntry;
+		const unsigned h = nameHash(funcName);
+		newEntry->hashNext = sRegistryHash[h];
+		sRegistryHash[h] = newEntry;
 		RTPrintf("RTcmix::registerFunction: registered function '%s' for dso '%s'\n",
 				funcName, dsoPath);
 		return 0;
@@ -438,6 +473,137 @@ RTcmix::registerDSOs(const char *pathList)
 	return 0;
 }
 
+/* ------------------------------------------------- startPreloadingDSOs -- */
+// With the preload_dsos option, every DSO named in the registry is opened
+// on a background thread as soon as registerDSOs() has run, with its
+// symbols bound and its pages read in.  finishPreloadingDSOs() later calls
+// each one's profile routines on the parser's thread, so that all the
+// instruments and functions are registered before the score starts, and
+// the first note of an instrument never waits for the disk or the linker.
+
+#include <pthread.h>
+#include <set>
+#include <string>
+#include <vector>
+#ifdef LINUX
+#include <dlfcn.h>
+#include <link.h>
+#include <unistd.h>
+#endif
+
+struct PreloadEntry {
+	std::string funcName;	// one function the DSO registered
+	std::string dsoPath;	// as passed to dlopen()
+	void *handle;
+};
+
+static std::vector<PreloadEntry> sPreloads;
+static pthread_t sPreloadThread;
+static bool sPreloadThreadRunning = false;
+
+#ifdef LINUX
+// Read one byte from every page of each readable segment of the object
+// whose base address matches <data>.
+
+static int
+touchPages(struct dl_phdr_info *info, size_t, void *data)
+{
+	if (info->dlpi_addr != *(ElfW(Addr) *) data)
+		return 0;
+	const long pageSize = sysconf(_SC_PAGESIZE);
+	for (int n = 0; n < info->dlpi_phnum; ++n) {
+		const ElfW(Phdr) &phdr = info->dlpi_phdr[n];
+		if (phdr.p_type != PT_LOAD || !(phdr.p_flags & PF_R))
+			continue;
+		const char *start = (const char *) (info->dlpi_addr + phdr.p_vaddr);
+		for (ElfW(Word) offset = 0; offset < phdr.p_memsz; offset += pageSize)
+			(void) *(volatile const char *) (start + offset);
+	}
+	return 1;
+}
+#endif
+
+static void *
+preloadDSOs(void *)
+{
+	for (size_t n = 0; n < sPreloads.size(); ++n) {
+		PreloadEntry &entry = sPreloads[n];
+#ifdef LINUX
+		entry.handle = dlopen(entry.dsoPath.c_str(), RTLD_NOW);
+		struct link_map *map = NULL;
+		if (entry.handle != NULL && dlinfo(entry.handle, RTLD_DI_LINKMAP, &map) == 0) {
+			ElfW(Addr) base = map->l_addr;
+			dl_iterate_phdr(touchPages, &base);
+		}
+#else
+		DynamicLib dso;
+		entry.handle = (dso.load(entry.dsoPath.c_str()) == 0) ? &entry : NULL;
+#endif
+	}
+	return NULL;
+}
+
+void
+RTcmix::startPreloadingDSOs()
+{
+#ifndef EMBEDDED
+	if (sPreloadThreadRunning)
+		return;
+	std::set<std::string> seen;
+	for (FunctionEntry *entry = _functionRegistry; entry; entry = entry->next) {
+		if (!seen.insert(entry->dsoPath).second)
+			continue;
+		PreloadEntry preload;
+		preload.funcName = entry->funcName;
+		preload.handle = NULL;
+		// Resolve the path just as m_load() will for findAndLoadFunction().
+		if (strchr(entry->dsoPath, '/'))
+			preload.dsoPath = std::string(entry->dsoPath) + ".so";
+		else
+			preload.dsoPath = std::string(SHAREDLIBDIR) + "/" + entry->dsoPath + ".so";
+		sPreloads.push_back(preload);
+	}
+	if (sPreloads.empty())
+		return;
+	if (pthread_create(&sPreloadThread, NULL, preloadDSOs, NULL) != 0) {
+		rtcmix_warn("preload_dsos", "Could not start the preloading thread");
+		sPreloads.clear();
+		return;
+	}
+	sPreloadThreadRunning = true;
+#endif
+}
+
+/* ------------------------------------------------ finishPreloadingDSOs -- */
+// Called before the first score text is parsed.  Does nothing unless
+// startPreloadingDSOs() was called.
+
+void
+RTcmix::finishPreloadingDSOs()
+{
+	if (!sPreloadThreadRunning)
+		return;
+	pthread_join(sPreloadThread, NULL);
+	sPreloadThreadRunning = false;
+	int loaded = 0;
+	for (size_t n = 0; n < sPreloads.size(); ++n) {
+		const char *name = sPreloads[n].funcName.c_str();
+		if (sPreloads[n].handle == NULL) {
+			rtcmix_warn("preload_dsos", "Could not preload '%s'",
+						sPreloads[n].dsoPath.c_str());
+			continue;
+		}
+		// The DSO is already in memory, so this only runs its profiles.
+		if (findfunc(name) == NULL && findInst(name) == NULL
+				&& findAndLoadFunction(name) == 0)
+			++loaded;
+	}
+	rtcmix_advise("preload_dsos", "Preloaded %d of %d instrument libraries.",
+				  loaded, (int) sPreloads.size());
+	// Our own references keep the libraries mapped for the whole run.
+	sPreloads.clear();
+}
+
 // Wrappers for UG_INTRO() use.
 
 extern "C" {
@@ -20,35 +20,57 @@
 #include "mixerr.h"
 #include <string.h>
 
+// rt_list keeps the instruments in order of introduction; this table finds
+// them by name.  The rt_items themselves are statics owned by the DSOs, so
+// the hash entries are kept apart from them.
+
+struct InstHashEntry {
+	rt_item *item;
+	InstHashEntry *next;
+};
+
+static InstHashEntry *sInstHash[RTcmix::NameHashSize];
+static rt_item *sInstTail = NULL;
+
 int
 addrtInst(rt_item *rt_p)
 {
 	return RTcmix::addrtInst(rt_p);
 }
 
+rt_item *
+RTcmix::findInst(const char *instname)
+{
+	for (InstHashEntry *entry = sInstHash[nameHash(instname)]; entry; entry = entry->next) {
+		if (!strcmp(entry->item->rt_name, instname))
+			return entry->item;
+	}
+	return NULL;
+}
+
 int
 RTcmix::addrtInst(rt_item *rt_p)
 {
 	// RTPrintf("ENTERING addrtInst() FUNCTION -----\n");
-	/*  Seek end of rt_list	*/
-    rt_item *rt_tail = rt_list;
-	
-	if (!rt_tail) { // first one on the list
-	  rt_list = rt_p;
-	  rt_p->rt_next = NULL;
-	  // RTPrintf("EXITING addrtInst() FUNCTION (0)-----\n");
-	  return 0;
-	}
-	for (rt_tail=rt_list; rt_tail->rt_next != NULL; rt_tail=rt_tail->rt_next)
-	{
-		if (!strcmp(rt_tail->rt_name, rt_p->rt_name))	{
-			mixerr = MX_FEXIST;
-			// RTPrintf("EXITING addrtInst() FUNCTION (MX_FEXIST)-----\n");
-			return (-1);
-		}
+	if (findInst(rt_p->rt_name) != NULL) {
+		mixerr = MX_FEXIST;
+		// RTPrintf("EXITING addrtInst() FUNCTION (MX_FEXIST)-----\n");
+		return (-1);
 	}
-	rt_tail->rt_next = rt_p;
+	InstHashEntry *entry = new InstHashEntry;
+	const unsigned h = nameHash(rt_p->rt_name);
+	entry->item = rt_p;
+	entry->next = sInstHash[h];
+	sInstHash[h] = entry;
+
+	/*  Append to end of rt_list	*/
 	rt_p->rt_next = NULL;
+	if (!rt_list)	// first one on the list
+		rt_list = rt_p;
+	else
+		sInstTail->rt_next = rt_p;
+	sInstTail = rt_p;
+	++_dispatchGeneration;
 	// RTPrintf("EXITING addrtInst() FUNCTION (0)-----\n");
 	return (0);
 }
@@ -57,9 +79,14 @@ void
 RTcmix::clearRtInstList()
 {
     rt_list = NULL;     // Ths does not leak memory because all the rt_items were statics
+	sInstTail = NULL;
+	for (int n = 0; n < NameHashSize; ++n) {
+		for (InstHashEntry *entry = sInstHash[n]; entry; ) {
+			InstHashEntry *next = entry->next;
+			delete entry;
+			entry = next;
+		}
+		sInstHash[n] = NULL;
+	}
+	++_dispatchGeneration;
 }
-
-
-
-
-
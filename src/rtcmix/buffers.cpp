@@ -8,9 +8,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
 
 #include <RTcmix.h>
 #include "buffers.h"
+#include <RTOption.h>
+#include "MemStats.h"
 #include <bus.h>
 #include <assert.h>
 
@@ -67,10 +71,16 @@ RTcmix::init_buf_ptrs()
    audioin_buffer = new BufPtr[busCount];
    aux_buffer = new BufPtr[busCount];
    out_buffer = new BufPtr[busCount];
+   saved_out_buffer = new BufPtr[busCount];
+   saved_audioin_buffer = new BufPtr[busCount];
+   aux_unwritten = new bool[busCount];
+   out_unwritten = new bool[busCount];
    for (i = 0; i < busCount; i++) {
       audioin_buffer[i] = NULL;
       aux_buffer[i] = NULL;
       out_buffer[i] = NULL;
+      aux_unwritten[i] = false;     /* allocated zeroed */
+      out_unwritten[i] = false;
    }
 }
 
@@ -93,19 +103,45 @@ RTcmix::clear_audioin_buffers()
 }
 #endif
 
+/* ---------------------------------------------------------- next_buffer --- */
+/* Bus buffers are allocated at twice the buffer length.  With aligned_blocks,
+   an instrument's block mixed in at an offset runs over into the second half,
+   which is moved into place for the next buffer instead of clearing.
+*/
+static void
+next_buffer(BufPtr buf, int count)
+{
+   if (RTOption::alignedBlocks()) {
+      memcpy(buf, buf + count, count * sizeof(BUFTYPE));
+      memset(buf + count, 0, count * sizeof(BUFTYPE));
+   }
+   else {
+      for (int j = 0; j < count; j++)
+         buf[j] = 0.0;
+   }
+}
+
 /* ---------------------------------------------------- clear_aux_buffers --- */
-/* Called from inTraverse. */
+/* Called from inTraverse.  Rather than zeroing them, mark the buses
+   unwritten; the first mix into one copies instead of adding (see
+   prepare_bus_write), and readers treat an unwritten bus as silent.
+   With aligned_blocks, the spill has to be moved into place, so the buses
+   are always written.
+*/
 void
 RTcmix::clear_aux_buffers()
 {
-   int   i, j;
+   int   i;
     const int count = bufsamps();
 
    for (i = 0; i < busCount; i++) {
       BufPtr buf = aux_buffer[i];
-      if (buf != NULL)
-         for (j = 0; j < count; j++)
-            buf[j] = 0.0;
+      if (buf == NULL)
+         continue;
+      if (RTOption::alignedBlocks())
+         ::next_buffer(buf, count);
+      else
+         aux_unwritten[i] = true;
    }
 }
 
@@ -114,16 +150,52 @@ RTcmix::clear_aux_buffers()
 void
 RTcmix::clear_output_buffers()
 {
-   int   i, j;
+   int   i;
     const int count = bufsamps();
 
    for (i = 0; i < NCHANS; i++) {          /* zero just the ones in use */
-      BufPtr buf = out_buffer[i];
-      for (j = 0; j < count; j++)
-         buf[j] = 0.0;
+      if (RTOption::alignedBlocks())
+         ::next_buffer(out_buffer[i], count);
+      else
+         out_unwritten[i] = true;
    }
 }
 
+/* ------------------------------------------- zero_unwritten_out_buffers --- */
+/* Called before the out buses are handed to a device, which reads them all. */
+void
+RTcmix::zero_unwritten_out_buffers()
+{
+   const int count = sliceFrames();
+
+   for (int i = 0; i < NCHANS; i++) {
+      if (out_unwritten[i]) {
+         memset(out_buffer[i], 0, count * sizeof(BUFTYPE));
+         out_unwritten[i] = false;
+      }
+   }
+}
+
+/* ------------------------------------------------------ begin_bus_write --- */
+/* Called before mixing frames <offset> to <endfr> into an aux or out bus,
+   and marks it written.  Returns true if the bus was unwritten and the mix
+   covers all of it, so that the caller can copy rather than add.  If it
+   covers only part, the bus is zeroed first.
+*/
+bool
+RTcmix::begin_bus_write(bool aux, int bus, int offset, int endfr)
+{
+   bool *unwritten = aux ? &aux_unwritten[bus] : &out_unwritten[bus];
+   if (!*unwritten)
+      return false;
+   *unwritten = false;
+   const int count = sliceFrames();
+   if (offset == 0 && endfr >= count)
+      return true;
+   memset(aux ? aux_buffer[bus] : out_buffer[bus], 0, count * sizeof(BUFTYPE));
+   return false;
+}
+
 
 /* ----------------------------------------------------- allocate_buf_ptr --- */
 static BufPtr
@@ -137,6 +209,80 @@ allocate_buf_ptr(int nsamps)       /* samples, not frames */
 }
 
 
+/* ------------------------------------------------------------- bus slab --- */
+/* The aux and out bus buffers are carved from one mapping rather than
+   allocated one by one: out buses first, then aux, each padded to a whole
+   number of cache lines, so that workers mixing into neighbouring buses
+   never share a line, and so that a scan over the buses walks memory in
+   order.  The mapping has room for every bus, but its pages are committed
+   only as buses are first written; large ones are backed by huge pages
+   where the kernel allows, to save TLB misses with many buses.
+*/
+#define BUS_ALIGN       64
+#define HUGEPAGE_BYTES  (2 * 1024 * 1024)
+
+static char    *sBusSlab = NULL;
+static size_t  sBusSlabBytes = 0;
+static size_t  sBusStride = 0;      /* bytes per bus */
+
+static BufPtr
+allocate_bus_buf(int slot, int slots, int nsamps)
+{
+   const size_t bytes = nsamps * sizeof(BUFTYPE);
+
+   if (sBusSlab == NULL) {
+      sBusStride = (bytes + BUS_ALIGN - 1) & ~(size_t) (BUS_ALIGN - 1);
+      sBusSlabBytes = sBusStride * slots;
+      int flags = MAP_PRIVATE | MAP_ANON;
+#ifdef MAP_NORESERVE
+      flags |= MAP_NORESERVE;
+#endif
+      void *map = mmap(NULL, sBusSlabBytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+      if (map == MAP_FAILED) {
+         sBusSlabBytes = 0;
+         return ::allocate_buf_ptr(nsamps);
+      }
+#ifdef MADV_HUGEPAGE
+      if (sBusSlabBytes >= HUGEPAGE_BYTES)
+         madvise(map, sBusSlabBytes, MADV_HUGEPAGE);
+#endif
+      sBusSlab = (char *) map;
+   }
+   if (bytes > sBusStride)          /* buffer size changed under us */
+      return ::allocate_buf_ptr(nsamps);
+   return (BufPtr) (sBusSlab + slot * sBusStride);    /* mapped zeroed */
+}
+
+static void
+free_bus_buf(BufPtr buf)
+{
+   if ((char *) buf < sBusSlab || (char *) buf >= sBusSlab + sBusSlabBytes)
+      free(buf);
+}
+
+static void
+free_bus_slab()
+{
+   if (sBusSlab != NULL)
+      munmap(sBusSlab, sBusSlabBytes);
+   sBusSlab = NULL;
+   sBusSlabBytes = 0;
+   sBusStride = 0;
+}
+
+
+/* Bytes of bus buffers charged to MemStats, given back by free_buffers. */
+static long long sBusBytes = 0;
+
+static void
+charge_bus_bytes(int nsamps)
+{
+   const long long bytes = nsamps * sizeof(BUFTYPE);
+   sBusBytes += bytes;
+   MemStats::add(MemStats::kBuses, bytes);
+}
+
+
 /* ---------------------------------------------- allocate_audioin_buffer --- */
 /* Allocate one of the global audio input bus buffers.
    Called from rtinput and rtsetparams.
@@ -152,6 +298,7 @@ RTcmix::allocate_audioin_buffer(short chan, int nsamps)
       buf_ptr = ::allocate_buf_ptr(nsamps);
       assert(buf_ptr != NULL);
       audioin_buffer[chan] = buf_ptr;
+      charge_bus_bytes(nsamps);
    }
 
    return 0;
@@ -170,9 +317,11 @@ RTcmix::allocate_aux_buffer(short chan, int nsamps)
    assert(chan >= 0 && chan < busCount);
 
    if (aux_buffer[chan] == NULL) {
-      buf_ptr = ::allocate_buf_ptr(nsamps);
+      /* room for an aligned block running over into the next buffer */
+      buf_ptr = ::allocate_bus_buf(busCount + chan, busCount * 2, nsamps * 2);
       assert(buf_ptr != NULL);
       aux_buffer[chan] = buf_ptr;
+      charge_bus_bytes(nsamps * 2);
    }
 
    return 0;
@@ -191,9 +340,11 @@ RTcmix::allocate_out_buffer(short chan, int nsamps)
    assert(chan >= 0 && chan < busCount);
 
    if (out_buffer[chan] == NULL) {
-      buf_ptr = ::allocate_buf_ptr(nsamps);
+      /* room for an aligned block running over into the next buffer */
+      buf_ptr = ::allocate_bus_buf(chan, busCount * 2, nsamps * 2);
       assert(buf_ptr != NULL);
       out_buffer[chan] = buf_ptr;
+      charge_bus_bytes(nsamps * 2);
    }
 
    return 0;
@@ -214,18 +365,29 @@ RTcmix::free_buffers()
 			audioin_buffer[chan] = NULL;
 		}
 		if (aux_buffer[chan]) {
-			free(aux_buffer[chan]);
+			free_bus_buf(aux_buffer[chan]);
 			aux_buffer[chan] = NULL;
 		}
 		if (out_buffer[chan]) {
-			free(out_buffer[chan]);
+			free_bus_buf(out_buffer[chan]);
 			out_buffer[chan] = NULL;
 		}
 	}
+	free_bus_slab();
+	MemStats::add(MemStats::kBuses, -sBusBytes);
+	sBusBytes = 0;
 	delete [] audioin_buffer;
 	audioin_buffer = NULL;
 	delete [] aux_buffer;
 	aux_buffer = NULL;
 	delete [] out_buffer;
 	out_buffer = NULL;
+	delete [] saved_out_buffer;
+	saved_out_buffer = NULL;
+	delete [] saved_audioin_buffer;
+	saved_audioin_buffer = NULL;
+	delete [] aux_unwritten;
+	aux_unwritten = NULL;
+	delete [] out_unwritten;
+	out_unwritten = NULL;
 }
@@ -10,6 +10,7 @@
 #include <ugens.h>
 #include <bus.h>
 #include <algorithm>
+#include <vector>
 #include "BusSlot.h"
 #include <RTcmix.h>
 #include <RTThread.h>
@@ -17,6 +18,12 @@
 #include "InputFile.h"
 #include <lock.h>
 #include <RTOption.h>
+#include "MixKernels.h"
+#include "DSPStats.h"
+#include "SchedTrace.h"
+#ifdef MULTI_THREAD
+#include "TaskManager.h"
+#endif
   
 //#define PRINTPLAY
 //#define DEBUG
@@ -76,6 +83,104 @@ BusQueue::~BusQueue()
 	slot->unref();
 }
 
+//
+// BusSlotTable: a read-only copy of Inst_Bus_Config, hashed by instrument
+// name.  Each change to the configuration builds a new one, and publishes it
+// only after its slots are complete, so that get_bus_config() can look names
+// up without any lock.  A slot is never changed once it is in a table.  A
+// table that has been replaced stays around (holding its slots) while a
+// lookup may still be reading it.  Lookups count themselves in
+// <sTableReaders>, and take their own reference to the slot they found
+// before they leave, so freeing a table never frees a slot a caller holds.
+// The next publish_bus_slots() that finds no lookup running frees all the
+// tables replaced so far; free_bus_config() frees any that are left.
+//
+
+struct BusSlotTable {
+	BusSlotTable(BusQueue *inQueue, unsigned inVersion, BusSlotTable *inRetired);
+	~BusSlotTable();
+	BusSlot *find(const char *name) const;
+	static unsigned long hash(const char *name);
+	struct Entry {
+		char *name;
+		unsigned long hash;
+		BusSlot *slot;
+	};
+	Entry *entries;
+	unsigned long mask;			// entry count - 1
+	unsigned version;
+	BusSlotTable *retired;		// the table this one replaced
+};
+
+BusSlotTable::BusSlotTable(BusQueue *inQueue, unsigned inVersion, BusSlotTable *inRetired)
+	: version(inVersion), retired(inRetired)
+{
+	int count = 0;
+	for (BusQueue *q = inQueue; q; q = q->next)
+		++count;
+	unsigned long size = 8;
+	while (size < (unsigned long) count * 2)
+		size <<= 1;
+	mask = size - 1;
+	entries = new Entry[size];
+	memset(entries, 0, size * sizeof(Entry));
+	for (BusQueue *q = inQueue; q; q = q->next) {
+		const unsigned long h = hash(q->instName());
+		unsigned long n = h & mask;
+		while (entries[n].name != NULL)
+			n = (n + 1) & mask;
+		entries[n].name = strdup(q->instName());
+		entries[n].hash = h;
+		entries[n].slot = q->slot;
+		q->slot->ref();
+	}
+}
+
+BusSlotTable::~BusSlotTable()
+{
+	for (unsigned long n = 0; n <= mask; ++n) {
+		if (entries[n].name != NULL) {
+			free(entries[n].name);
+			entries[n].slot->unref();
+		}
+	}
+	delete [] entries;
+}
+
+// FNV-1a
+
+unsigned long
+BusSlotTable::hash(const char *name)
+{
+	unsigned long h = 2166136261UL;
+	for (const char *c = name; *c; ++c)
+		h = (h ^ (unsigned char) *c) * 16777619UL;
+	return h;
+}
+
+BusSlot *
+BusSlotTable::find(const char *name) const
+{
+	const unsigned long h = hash(name);
+	for (unsigned long n = h & mask; entries[n].name != NULL; n = (n + 1) & mask) {
+		if (entries[n].hash == h && strcmp(entries[n].name, name) == 0)
+			return entries[n].slot;
+	}
+	return NULL;
+}
+
+static BusSlotTable * volatile sBusSlotTable = NULL;
+static volatile int sTableReaders = 0;	// get_bus_config() lookups under way
+
+static void freeBusSlotTables(BusSlotTable *table)
+{
+	while (table != NULL) {
+		BusSlotTable *retired = table->retired;
+		delete table;
+		table = retired;
+	}
+}
+
 // Local classes for configuration checking
 
 struct CheckNode : public RefCounted {
@@ -224,7 +329,7 @@ RTcmix::print_play_order() {
   RTPrintf("\n");
 }
 
-static Bool Visited[MAXBUS];
+static std::vector<Bool> Visited;	/* [busCount] */
 
 /* ------------------------------------------------ check_bust_inst_config -- */
 /* Parses bus graph nodes */
@@ -235,7 +340,7 @@ RTcmix::check_bus_inst_config(BusSlot *slot, Bool visit) {
 	short *in_check_list;
 	short in_check_count;
 	CheckQueue *in_check_queue,*last;
-	Bool Checked[MAXBUS];
+	std::vector<Bool> Checked(busCount, NO);
 	short r_p_count=0;
 
 	/* If we haven't gotten a config yet ... allocate the graph array */
@@ -256,11 +361,11 @@ RTcmix::check_bus_inst_config(BusSlot *slot, Bool visit) {
 
 	aux_ctr = out_ctr = 0;
 	j=0;
+	Visited.resize(busCount, NO);
 	for(i=0;i<busCount;i++) {
 		BusConfig *bus = &BusConfigs[i];
 		if (visit)
 			Visited[i] = NO;
-		Checked[i] = NO;
 		pthread_mutex_lock(&revplay_lock);
 		bus->RevPlay = -1;
 		pthread_mutex_unlock(&revplay_lock);
@@ -355,17 +460,15 @@ RTcmix::check_bus_inst_config(BusSlot *slot, Bool visit) {
 	return NO_ERR;
 }
 
-/* ------------------------------------------------------ insert_bus_slot --- */
-/* Inserts bus configuration into structure used by insts */
-/* Also inserts into bus graph */
-/* Special case when called by bf_traverse->check_bus_inst_config-> */
-/*     s_in set to 333 and filtered out below */
-ErrCode
-RTcmix::insert_bus_slot(char *name, BusSlot *slot) {
-  
+/* ----------------------------------------------------- insert_bus_graph --- */
+/* Inserts the edges from the slot's aux inputs to its aux outputs into the
+   bus graph.  s_in of 333 is filtered out as for insert_bus_slot.
+*/
+void
+RTcmix::insert_bus_graph(const BusSlot *slot) {
+
 	short i,j,t_in_count,s_in,s_out;
 
-	/* Insert into bus graph */
 	for(i=0;i<slot->auxout_count;i++) {
 		s_out = slot->auxout[i];
 		pthread_mutex_lock(&aux_in_use_lock);
@@ -409,6 +512,17 @@ RTcmix::insert_bus_slot(char *name, BusSlot *slot) {
 			}
 		}
 	}
+}
+
+/* ------------------------------------------------------ insert_bus_slot --- */
+/* Inserts bus configuration into structure used by insts */
+/* Also inserts into bus graph */
+/* Special case when called by bf_traverse->check_bus_inst_config-> */
+/*     s_in set to 333 and filtered out below */
+ErrCode
+RTcmix::insert_bus_slot(char *name, BusSlot *slot) {
+
+	insert_bus_graph(slot);
 
 	/* Create initial node for Inst_Bus_Config */
 	pthread_mutex_lock(&inst_bus_config_lock);
@@ -449,6 +563,33 @@ RTcmix::insert_bus_slot(char *name, BusSlot *slot) {
 }
 
 
+/* ---------------------------------------------------- publish_bus_slots --- */
+/* Makes Inst_Bus_Config as it is now visible to get_bus_config()'s lookup.
+   Called with bus_slot_lock held, after the new slot is complete.
+*/
+void
+RTcmix::publish_bus_slots()
+{
+	BusSlotTable *current = sBusSlotTable;
+	pthread_mutex_lock(&inst_bus_config_lock);
+	BusSlotTable *table = new BusSlotTable(Inst_Bus_Config,
+										   current ? current->version + 1 : 1,
+										   current);
+	pthread_mutex_unlock(&inst_bus_config_lock);
+	__sync_synchronize();	// the table is complete before anyone can see it
+	sBusSlotTable = table;
+	__sync_synchronize();
+	// A lookup that starts from here on finds the new table, so if none is
+	// running now, nothing can still be reading the ones it replaced.
+	if (sTableReaders == 0) {
+		freeBusSlotTables(table->retired);
+		table->retired = NULL;
+	}
+#ifdef PRINTALL
+	RTPrintf("publish_bus_slots: version %u\n", table->version);
+#endif
+}
+
 /* ----------------------------------------------------- bf_traverse -------- */
 /* sets fictitious parent node to 333 */
 /* filtered out in insert() */
@@ -522,12 +663,109 @@ RTcmix::create_play_order() {
 	}
 	pthread_mutex_unlock(&aux_in_use_lock);
   }
+
+  /* Assign each aux bus a level one higher than that of any aux bus feeding
+	 it (and at least 1).  Buses on the same level never read each other, so
+	 in MULTI_THREAD mode inTraverse() plays all of them in one batch.  The
+	 graph has no loops, so this settles within busCount passes. */
+  std::vector<short> levels(busCount, 0);
+  pthread_mutex_lock(&bus_in_config_lock);
+  Bool changed = YES;
+  for (int pass=0; pass<busCount && changed; pass++) {
+	changed = NO;
+	for (i=0;i<busCount;i++) {
+	  CheckNode *node = BusConfigs[i].In_Config;
+	  if (node == NULL)
+		continue;
+	  for (j=0;j<node->bus_count;j++) {
+		const short level = levels[node->bus_list[j]] + 1;
+		if (level > levels[i]) {
+		  levels[i] = level;
+		  changed = YES;
+		}
+	  }
+	}
+  }
+  pthread_mutex_unlock(&bus_in_config_lock);
+  pthread_mutex_lock(&aux_to_aux_lock);
+  for (i=0;i<busCount;i++)
+	BusConfigs[i].PlayLevel = (levels[i] > 0) ? levels[i] : 1;
+  pthread_mutex_unlock(&aux_to_aux_lock);
+}
+
+/* -------------------------------------------------------- addBusReader --- */
+/* Called by Instrument::setup() for a note with a pfield that reads aux bus
+   <bus> (see BusPField.h), so that the note plays after the notes writing
+   the bus.  For a note writing aux buses, <bus> is added to the inputs of
+   each of them in the bus graph, as if its bus_config had named it.  A note
+   writing only to out plays after every aux bus anyway.  A note writing aux
+   buses without reading any plays in the first pass, before any aux bus is
+   certain to be written, so it is warned about instead.
+*/
+void
+RTcmix::addBusReader(int bus, const BusSlot *slot, const char *instname)
+{
+	switch (slot->Class()) {
+	case TO_OUT:
+	case UNKNOWN:
+		return;
+	case AUX_TO_AUX:
+		break;
+	default:
+		{
+			static bool warned = false;
+			if (!warned) {
+				rtcmix_warn(instname, "Reading aux bus %d from a pfield, but this "
+							"instrument plays before the aux buses are written.  "
+							"Add \"aux %d in\" to its bus_config.", bus, bus);
+				warned = true;
+			}
+		}
+		return;
+	}
+
+	Lock lock(&bus_slot_lock);	// unlocks when out of scope
+
+	BusSlot *edges = new BusSlot(busCount);
+	edges->ref();
+	edges->auxin[0] = bus;
+	edges->auxin_count = 1;
+	for (int i = 0; i < slot->auxout_count; i++) {
+		const short out = slot->auxout[i];
+		if (out == bus) {
+			rtcmix_warn(instname, "A pfield reads aux bus %d, which this "
+						"instrument also writes.", bus);
+			edges->unref();
+			return;
+		}
+		bool found = false;
+		pthread_mutex_lock(&bus_in_config_lock);
+		const CheckNode *node = BusConfigs[out].In_Config;
+		for (int j = 0; j < node->bus_count && !found; j++)
+			found = (node->bus_list[j] == bus);
+		pthread_mutex_unlock(&bus_in_config_lock);
+		if (!found)
+			edges->auxout[edges->auxout_count++] = out;
+	}
+	if (edges->auxout_count > 0) {
+		if (check_bus_inst_config(edges, YES) == NO_ERR) {
+			insert_bus_graph(edges);
+			create_play_order();
+#ifdef PRINTPLAY
+			print_play_order();
+#endif
+		}
+		else
+			rtcmix_warn(instname, "Can't play after the notes writing aux bus %d.", bus);
+	}
+	edges->unref();
 }
 
 /* ------------------------------------------------------- get_bus_config --- */
 /* Given an instrument name, return a pointer to the most recently
    created BusSlot node for that instrument name. If no instrument name
-   match, return a pointer to the default node.
+   match, return a pointer to the default node.  The slot comes with a
+   reference, which the caller must adopt or unref.
 */
 BusSlot *
 RTcmix::get_bus_config(const char *inst_name)
@@ -539,19 +777,29 @@ RTcmix::get_bus_config(const char *inst_name)
 
    assert(inst_name != NULL);
 
+   /* Published slots never change, so this needs no lock */
+   __sync_fetch_and_add(&sTableReaders, 1);
+   BusSlotTable *table = sBusSlotTable;
+   slot = (table != NULL) ? table->find(inst_name) : NULL;
+   if (slot != NULL)
+      slot->ref();		// while the table still holds it
+   __sync_fetch_and_sub(&sTableReaders, 1);
+   if (slot != NULL)
+      return slot;
+
    slot = NULL;
 
    Lock lock(&bus_slot_lock);	// unlocks when out of scope
 
-   /* Maybe also need to lock q since it's accessing a BusSlot */
-   /* that intraverse might also be checking? */
-   /* But the values don't change, so I don't see why */
+   /* Another thread may have configured this name while we waited */
 
    pthread_mutex_lock(&inst_bus_config_lock);
    for (q = Inst_Bus_Config; q; q = q->next) {
 	 if (strcmp(inst_name, q->instName()) == 0) {
+	   slot = q->slot;
+	   slot->ref();
 	   pthread_mutex_unlock(&inst_bus_config_lock);   
-	   return q->slot;
+	   return slot;
 	 }
    }
    pthread_mutex_unlock(&inst_bus_config_lock);
@@ -653,25 +901,32 @@ RTcmix::get_bus_config(const char *inst_name)
 	
 	rtcmix_advise(NULL, "default: %s\n", buslist);
 
+   publish_bus_slots();
+   default_bus_slot->ref();		// the caller's
    return default_bus_slot;
 }
 
 /* ------------------------------------------------------- addToBus --------- */
 /* This is called by each instrument during addout() to insert a request for a mix.
-   All requests are mixed at the same time via mixToBus().
+   All requests are mixed at the same time via mixToBus().  <order> is the
+   note's place in the schedule, used to order the mixes into each bus when
+   deterministic_mix is set.
  */
 
 #ifdef MULTI_THREAD
 
 void
-RTcmix::addToBus(BusType type, int bus, BufPtr src, int offset, int endfr, int chans)
+RTcmix::addToBus(BusType type, int bus, BufPtr src, int offset, int endfr, int chans,
+				 unsigned order)
 {
     mixVectors[RTThread::GetIndexForThread()].push_back(
 						MixData(
 								src,
 								(type == BUS_AUX_OUT) ? aux_buffer[bus] + offset : out_buffer[bus] + offset,
 								endfr - offset,
-								chans)
+								chans,
+								(type == BUS_AUX_OUT) ? bus : busCount + bus,
+								order)
                         );
 	
 }
@@ -679,37 +934,59 @@ RTcmix::addToBus(BusType type, int bus, BufPtr src, int offset, int endfr, int c
 void
 RTcmix::mixOperation(MixData &m)
 {
-    BufPtr src = m.src;
-    BufPtr dest = m.dest;
-    const int framesOverFour = m.frames >> 2;
-    const int framesRemaining = m.frames - (framesOverFour << 2);
-    const int chans = m.channels;
-    const int chansx2 = chans << 1;
-    const int chansx3 = chansx2 + chans;
-    const int chansx4 = chansx2 + chansx2;
-    for (int n = 0; n < framesOverFour; ++n) {
-        dest[0] += src[0];
-        dest[1] += src[chans];
-        dest[2] += src[chansx2];
-        dest[3] += src[chansx3];
-        dest += 4;
-        src += chansx4;
-    }
-    for (int n = 0; n < framesRemaining; ++n) {
-        dest[n] += *src;
-        src += chans;
-    }
+    const bool aux = m.mixer < busCount;
+    const int bus = aux ? m.mixer : m.mixer - busCount;
+    const int offset = int(m.dest - (aux ? aux_buffer[bus] : out_buffer[bus]));
+    if (begin_bus_write(aux, bus, offset, offset + m.frames))
+        copyIntoBus(m.dest, m.src, m.frames, m.channels);
+    else
+        mixIntoBus(m.dest, m.src, m.frames, m.channels);
+}
+
+int
+RTcmix::BusMixer::mix()
+{
+    TraceSpan span("mix", (int) mixes.size());
+    // The mixes arrive grouped by the thread that ran each note, which
+    // varies from run to run, and float sums depend on their order.
+    if (RTOption::deterministicMix() && mixes.size() > 1)
+        std::stable_sort(mixes.begin(), mixes.end(), MixData::before);
+    for (std::vector<MixData *>::iterator it = mixes.begin(); it != mixes.end(); ++it)
+        mixOperation(**it);
+    mixes.clear();
+    return 0;
 }
 
 void
 RTcmix::mixToBus()
 {
-    // Mix all vectors from each thread down to the final mix buses
-    for (int i = 0; i < RT_THREAD_COUNT; ++i) {
+    const long long start = DSPStats::enabled() ? DSPStats::now() : 0;
+    TraceSpan span("mixToBus");
+    // Sort the requests from every thread by destination bus.  Each bus is
+    // then summed by a single task, so no two tasks ever write the same buffer.
+    for (int i = 0; i < (int) mixVectors.size(); ++i) {
         std::vector<MixData> &vector = mixVectors[i];
-        std::for_each(vector.begin(), vector.end(), mixOperation);
-        vector.clear();
+        for (std::vector<MixData>::iterator it = vector.begin(); it != vector.end(); ++it) {
+            BusMixer *mixer = &busMixers[it->mixer];
+            if (mixer->mixes.empty())
+                activeMixers.push_back(mixer);
+            mixer->mixes.push_back(&*it);
+        }
+    }
+    if (activeMixers.size() > 1) {
+        for (std::vector<BusMixer *>::iterator it = activeMixers.begin(); it != activeMixers.end(); ++it)
+            taskManager->addTask<BusMixer, int, &BusMixer::mix>(*it);
+        taskManager->waitForTasks(activeMixers);
     }
+    else if (activeMixers.size() == 1) {
+        // Not worth waking the pool for a single bus
+        activeMixers[0]->mix();
+    }
+    activeMixers.clear();
+    for (int i = 0; i < (int) mixVectors.size(); ++i)
+        mixVectors[i].clear();
+    if (start != 0)
+        DSPStats::add(DSPStats::kMixdown, DSPStats::now() - start);
 }
 
 #else
@@ -718,7 +995,8 @@ RTcmix::mixToBus()
 /* This is called by each instrument during addout() to mix itself into bus. */
 
 void
-RTcmix::addToBus(BusType type, int bus, BufPtr src, int offset, int endfr, int chans)
+RTcmix::addToBus(BusType type, int bus, BufPtr src, int offset, int endfr, int chans,
+				 unsigned)
 {
 	register BufPtr dest;
 	
@@ -729,10 +1007,13 @@ RTcmix::addToBus(BusType type, int bus, BufPtr src, int offset, int endfr, int c
 		dest = out_buffer[bus];
 	}
 	assert(dest != NULL);
-	for (int frame = offset; frame < endfr; frame++) {
-		dest[frame] += *src;
-		src += chans;
-	}
+	const long long start = DSPStats::enabled() ? DSPStats::now() : 0;
+	if (begin_bus_write(type == BUS_AUX_OUT, bus, offset, endfr))
+		copyIntoBus(dest + offset, src, endfr - offset, chans);
+	else
+		mixIntoBus(dest + offset, src, endfr - offset, chans);
+	if (start != 0)
+		DSPStats::add(DSPStats::kMixdown, DSPStats::now() - start);
 }
 
 #endif	// MULTI_THREAD
@@ -986,6 +1267,13 @@ RTcmix::bus_config(double p[], int n_args)
       }
    }
 
+   if (bus_slot->in_count + bus_slot->auxin_count + chain_incount > MAXBUS
+       || bus_slot->out_count + bus_slot->auxout_count + chain_outcount > MAXBUS) {
+      die("bus_config", "An instrument can't read or write more than %d buses.",
+                                                                       MAXBUS);
+      RTExit(PARAM_ERROR);
+   }
+
    err = check_bus_inst_config(bus_slot, YES);
    if (!err) {
       err = insert_bus_slot(instname, bus_slot);
@@ -1019,6 +1307,7 @@ RTcmix::bus_config(double p[], int n_args)
 #ifdef DEBUG
    err = print_inst_bus_config();
 #endif
+   publish_bus_slots();
 
    rtcmix_advise("bus_config", "(%s) => %s => (%s)", inbusses, instname, outbusses);
    return 0;
@@ -1033,6 +1322,8 @@ RTcmix::free_bus_config()
       q = next;
    }
 	Inst_Bus_Config = NULL;
+   freeBusSlotTables(sBusSlotTable);
+   sBusSlotTable = NULL;
     BusConfig zeroConfig;
 	if (BusConfigs) {
 		for (int i=0 ; i<busCount; i++) {
@@ -1040,6 +1331,6 @@ RTcmix::free_bus_config()
 		   BusConfigs[i] = zeroConfig;
 		}
 	}
-	memset(&Visited, 0, sizeof(Visited));
+	Visited.clear();
 	Bus_Config_Status = NO;
 }
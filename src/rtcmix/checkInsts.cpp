@@ -9,6 +9,7 @@
 #include <Instrument.h>
 #include <PField.h>
 #include <PFieldSet.h>
+#include "PFieldProgram.h"
 #include "utils.h"
 #include "rt.h"
 #include "rtdefs.h"
@@ -20,39 +21,115 @@
 #include <string.h>
 #include <assert.h>
 #include <RTOption.h>
+#include "BufferPool.h"
+#include "VoicePool.h"
+#include "NoteCache.h"
+#include "BusFreeze.h"
+#include "NoteSetup.h"
+#include <new>
 
 //#define DEBUG
 
-static InstCreatorFunction
-findInstCreator(rt_item *inList, const char *inInstName)
+// Scores often pass the same list -- a long envelope, say -- to thousands of
+// notes, and each call hands us a new copy of it.  A table made from a list
+// is never changed (modtable and drawtable only see tables made by
+// maketable), so notes whose lists are identical can share one TablePField.
+// We remember the most recent few, and compare contents to find a match.
+
+#define TABLE_CACHE_SLOTS 32
+
+struct CachedTable {
+	unsigned long	hash;
+	unsigned		len;
+	TablePField *	table;
+};
+
+static CachedTable sTableCache[TABLE_CACHE_SLOTS];
+static int sNextTableSlot = 0;
+static pthread_mutex_t sTableCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned long hashArray(const Array *array)
+{
+	unsigned long hash = 2166136261UL;
+	for (unsigned n = 0; n < array->len; ++n) {
+		unsigned long long bits;
+		memcpy(&bits, &array->data[n], sizeof(bits));
+		hash = (hash ^ (unsigned long) (bits ^ (bits >> 32))) * 16777619UL;
+	}
+	return hash;
+}
+
+// Return a table holding the values in <array>, or NULL if out of memory.
+
+static TablePField *sharedTable(const Array *array)
 {
-	rt_item *item = inList;       // rt_item defined in rt.h
-	while (item) {
-		if (strcmp(item->rt_name, inInstName) == 0) {
-			return item->rt_ptr;
+	// Lent memory is read in place, with no copy to share.
+	if (array->lease != NULL)
+		return new TablePField(array->data, array->len, array->lease,
+							   TablePField::Interpolate2ndOrder);
+	const unsigned long hash = hashArray(array);
+	TablePField *table = NULL;
+	pthread_mutex_lock(&sTableCacheLock);
+	for (int slot = 0; slot < TABLE_CACHE_SLOTS; ++slot) {
+		const CachedTable &cached = sTableCache[slot];
+		if (cached.table != NULL && cached.hash == hash && cached.len == array->len
+				&& memcmp((double *) *cached.table, array->data,
+						  array->len * sizeof(double)) == 0) {
+			table = cached.table;
+			break;
 		}
-		item = item->rt_next;
 	}
-	return NULL;
+	if (table == NULL) {
+		double *dataCopy = new double[array->len];
+		if (dataCopy != NULL) {
+			memcpy(dataCopy, array->data, array->len * sizeof(double));
+			table = new TablePField(dataCopy, array->len, TablePField::Interpolate2ndOrder);
+			CachedTable &cached = sTableCache[sNextTableSlot];
+			RefCounted::unref(cached.table);	// notes using it keep their own refs
+			cached.hash = hash;
+			cached.len = array->len;
+			cached.table = table;
+			table->ref();
+			sNextTableSlot = (sNextTableSlot + 1) % TABLE_CACHE_SLOTS;
+		}
+	}
+	pthread_mutex_unlock(&sTableCacheLock);
+	return table;
 }
 
-// Load the argument list into a PFieldSet, hand to instrument, and call setup().  Does not destroy
-// the instrument on failure.
+// Report that a note could not be made for want of memory: most likely the
+// memory budget is used up, since otherwise pooled blocks come from the
+// system allocator.
 
-static int loadPFieldsAndSetup(const char *inName, Instrument *inInst, const Arg arglist[], const int nargs)
+static int noMemory(const char *inName)
+{
+	if (BufferPool::budget() > 0)
+		die(inName, "The memory budget of %d MB is used up; note not made.",
+			(int) (BufferPool::budget() >> 20));
+	else
+		die(inName, "Out of memory; note not made.");
+	return MEMORY_ERROR;
+}
+
+// Load the argument list into a new PFieldSet, returned in <outSet>.
+
+static int loadPFields(const char *inName, const Arg arglist[], const int nargs, PFieldSet **outSet)
 {
     int status = NO_ERROR;
 	// Load PFieldSet with ConstPField instances for each
 	// valid p field.
-	PFieldSet *pfieldset = new PFieldSet(nargs);
-	if (!pfieldset) {
-		return MEMORY_ERROR;
+	PFieldSet *pfieldset = NULL;
+	try {
+		pfieldset = new PFieldSet(nargs);
+	}
+	catch (std::bad_alloc &) {
+		return noMemory(inName);
 	}
 	for (int arg = 0; arg < nargs; ++arg) {
 		const Arg &theArg = arglist[arg];
 		switch (theArg.type()) {
 			case DoubleType:
-				pfieldset->load(new ConstPField((double) theArg), arg);
+				pfieldset->loadConstant((double) theArg, arg);
 				break;
 			case StringType:
 				pfieldset->load(new StringPField(theArg.string()), arg);
@@ -63,7 +140,8 @@ static int loadPFieldsAndSetup(const char *inName, Instrument *inInst, const Arg
 				if (handle != NULL) {
 					if (handle->type == PFieldType) {
 						assert(handle->ptr != NULL);
-						pfieldset->load((PField *) handle->ptr, arg);
+						// Operator trees are flattened for the note.
+						pfieldset->load(PFieldProgram::compile((PField *) handle->ptr), arg);
 					}
 					else if (handle->type == InstrumentPtrType) {
 						assert(handle->ptr != NULL);
@@ -84,15 +162,13 @@ static int loadPFieldsAndSetup(const char *inName, Instrument *inInst, const Arg
 			{
 				Array *array = (Array *)theArg;
 				assert(array->data != NULL);
-				double *dataCopy = new double[array->len];
-				if (dataCopy == NULL) {
+				TablePField *table = sharedTable(array);
+				if (table == NULL) {
 					die(inName, "arg %d: ran out of memory copying array!", arg);
 					status = MEMORY_ERROR;
 				}
                 else {
-                    for (unsigned n = 0; n < array->len; ++n)
-                        dataCopy[n] = array->data[n];
-                    pfieldset->load(new TablePField(dataCopy, array->len, TablePField::Interpolate2ndOrder), arg);
+                    pfieldset->load(table, arg);
                 }
 			}
 				break;
@@ -106,14 +182,47 @@ static int loadPFieldsAndSetup(const char *inName, Instrument *inInst, const Arg
 		delete pfieldset;
 		return status;
 	}
+	*outSet = pfieldset;
+	return NO_ERROR;
+}
+
+// Load the argument list into a PFieldSet, hand to instrument, and call setup().  Does not destroy
+// the instrument on failure.
+
+static int loadPFieldsAndSetup(const char *inName, Instrument *inInst, const Arg arglist[], const int nargs)
+{
+	PFieldSet *pfieldset = NULL;
+	int status = loadPFields(inName, arglist, nargs, &pfieldset);
+	if (status != NO_ERROR)
+		return status;
     return inInst->setup(pfieldset) >= 0 ? NO_ERROR : PARAM_ERROR;
 }
 
 int
 RTcmix::checkInsts(const char *instname, const Arg arglist[],
 				   const int nargs, Arg *retval)
+{
+	*retval = 0.0;	// Default to float 0
+
+	rt_item *item = findInst(instname);
+
+	if (item) {
+		return startInst(item, arglist, nargs, retval);
+	}
+
+   return FUNCTION_NOT_FOUND;
+}
+
+// Create, set up and schedule the instrument described by <item>.  This is
+// the part of checkInsts() that follows the name lookup, so that callers
+// who have already found the rt_item can skip it.
+
+int
+RTcmix::startInst(rt_item *item, const Arg arglist[],
+				  const int nargs, Arg *retval)
 {
 	Instrument *Iptr = NULL;;
+	const char *instname = item->rt_name;
 
 #ifdef DEBUG
    RTPrintf("ENTERING checkInsts() FUNCTION -----\n");
@@ -121,61 +230,96 @@ RTcmix::checkInsts(const char *instname, const Arg arglist[],
 
 	*retval = 0.0;	// Default to float 0
 
-	InstCreatorFunction instCreator = findInstCreator(rt_list, instname);
+	printargs(instname, arglist, nargs);
 
-	if (instCreator) {
-		
-		printargs(instname, arglist, nargs);
-
-		if (!rtsetparams_was_called()) {
+	if (!rtsetparams_was_called()) {
 #ifdef EMBEDDED
-			die(instname, "You need to start the audio device before doing this.");
+		die(instname, "You need to start the audio device before doing this.");
 #else
-			die(instname, "You did not call rtsetparams!");
+		die(instname, "You did not call rtsetparams!");
 #endif
-            return CONFIGURATION_ERROR;
-		}
-		
-		/* Create the Instrument */
+		return CONFIGURATION_ERROR;
+	}
 
-		Iptr = (*instCreator)();
+	// With the voice_pool option, a note may be played by a running
+	// instance instead of making one of its own.
+	if (item->rt_pool != NULL && VoicePool::playNote(item, arglist, nargs, rtHeap))
+		return NO_ERROR;
+	
+	/* Create the Instrument */
 
-		if (!Iptr) {
-			return SYSTEM_ERROR;
+	// With the note_cache_mb option, a note just like one already rendered
+	// replays its output, and the first of its kind is rendered into the cache.
+	CachedNote *capture = NULL;
+	try {
+		if (NoteCache::enabled())
+			Iptr = NoteCache::lookup(item, arglist, nargs, &capture);
+		if (Iptr == NULL) {
+			Iptr = (*item->rt_ptr)();
+			if (Iptr)
+				Iptr->ref();   // We do this to assure one reference
 		}
+	}
+	catch (std::bad_alloc &) {
+		if (capture != NULL)
+			NoteCache::beginCapture(capture, NULL, arglist);
+		return noMemory(instname);
+	}
 
-		Iptr->ref();   // We do this to assure one reference
+	if (!Iptr) {
+		if (capture != NULL)
+			NoteCache::beginCapture(capture, NULL, arglist);
+		return SYSTEM_ERROR;
+	}
 
-		int rv = loadPFieldsAndSetup(instname, Iptr, arglist, nargs);
-		
-        if (rv == 0) { // only schedule if no setup() error
-			// For non-interactive case, configure() is delayed until just
-			// before instrument run time.
-			if (interactive()) {
-			   if ((rv = Iptr->configure(bufsamps())) != 0) {
-                   return rv;
-			   }
-			}
-		}
-		// Clean up if there was an error.
-		else {
+	// With the parallel_setup option, setup() waits for NoteSetup::flush(),
+	// which also schedules the note.
+	if (capture == NULL && NoteSetup::enabled()) {
+		PFieldSet *pfieldset = NULL;
+		int rv = loadPFields(instname, arglist, nargs, &pfieldset);
+		if (rv != NO_ERROR) {
 			Iptr->unref();
 			*retval = (Handle) NULL;
 			return rv;
 		}
+		NoteSetup::defer(Iptr, pfieldset);
+		*retval = createInstHandle(Iptr);
+		return NO_ERROR;
+	}
 
-		/* schedule instrument */
-		Iptr->schedule(rtHeap);
+	int rv = loadPFieldsAndSetup(instname, Iptr, arglist, nargs);
+	if (capture != NULL)
+		NoteCache::beginCapture(capture, (rv == 0) ? Iptr : NULL, arglist);
+	
+	if (rv == 0) { // only schedule if no setup() error
+		// For non-interactive case, configure() is delayed until just
+		// before instrument run time.
+		if (interactive()) {
+		   if ((rv = Iptr->configure(bufsamps())) != 0) {
+			   Iptr->unref();
+			   *retval = (Handle) NULL;
+			   return rv;
+		   }
+		}
+	}
+	// Clean up if there was an error.
+	else {
+		Iptr->unref();
+		*retval = (Handle) NULL;
+		return rv;
+	}
 
-		// Create Handle for Iptr on return
-		*retval = createInstHandle(Iptr);
+	BusFreeze::noteStarted(Iptr, item, arglist, nargs);
+
+	/* schedule instrument */
+	Iptr->schedule(rtHeap);
+
+	// Create Handle for Iptr on return
+	*retval = createInstHandle(Iptr);
 #ifdef DEBUG
-		 RTPrintf("EXITING checkInsts() FUNCTION -----\n");
+	 RTPrintf("EXITING checkInsts() FUNCTION -----\n");
 #endif
-		 return rv;
-	}
-
-   return FUNCTION_NOT_FOUND;
+	 return rv;
 }
 
 static Handle mkusage()
@@ -205,7 +349,8 @@ makeinstrument(const Arg arglist[], int nargs)
 	if (!instName)
 		return mkusage();
 	
-	InstCreatorFunction instCreator = findInstCreator(RTcmix::rt_list, instName);
+	rt_item *item = RTcmix::findInst(instName);
+	InstCreatorFunction instCreator = item ? item->rt_ptr : NULL;
 	
 	if (instCreator) {
         if (!rtsetparams_was_called()) {
@@ -220,7 +365,14 @@ makeinstrument(const Arg arglist[], int nargs)
 
         /* Create the Instrument */
 		
-		Iptr = (*instCreator)();
+		try {
+			Iptr = (*instCreator)();
+		}
+		catch (std::bad_alloc &) {
+			noMemory(instName);
+			rtOptionalThrow(MEMORY_ERROR);
+			return NULL;
+		}
 		
 		if (!Iptr) {
 			mixerr = MX_FAIL;
@@ -27,6 +27,7 @@
 
 extern "C" {
 	Handle makeconnection(const Arg args[], const int nargs);
+	Handle create_bus_handle(const Arg args[], const int nargs);	// BusPField.cpp
 #ifdef EMBEDDED
 // BGG -- see note below
 	Handle create_handle(const Arg args[], const int nargs);
@@ -54,6 +55,10 @@ makeconnection(const Arg args[], const int nargs)
 		return NULL;
 	}
 
+	// Aux buses are read by the core, not by a DSO.
+	if (args[0] == "bus")
+		return create_bus_handle(&args[1], nargs - 1);
+
 	Handle handle = NULL;
 #ifndef EMBEDDED
 	const char *selector = (const char *) args[0];
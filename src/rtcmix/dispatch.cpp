@@ -4,13 +4,30 @@
 */
 #include <RTcmix.h>
 #include "prototypes.h"
+#include "ScoreImage.h"
+#include "utils.h"
 #include <ugens.h>
 #include <maxdispargs.h>
 #include <stdio.h>
 
+// Calls made from inside other calls are not saved in a score image;
+// replaying the outer call makes them again.
+static int sDispatchDepth = 0;
+
 int
 RTcmix::dispatch(const char *func_label, const Arg arglist[], 
 				 const int nargs, Arg *retval)
+{
+   ++sDispatchDepth;
+   int status = dispatchByName(func_label, arglist, nargs, retval);
+   if (--sDispatchDepth == 0 && ScoreImage::recording())
+      ScoreImage::addCall(func_label, arglist, nargs, *retval);
+   return status;
+}
+
+int
+RTcmix::dispatchByName(const char *func_label, const Arg arglist[],
+					   const int nargs, Arg *retval)
 {
    /* Search non-rt and rt function lists for a match with <func_label>.
       If there is a match of either, checkfunc or checkInsts will call
@@ -36,6 +53,87 @@ RTcmix::dispatch(const char *func_label, const Arg arglist[],
    return status;
 }
 
+// Same as above, but the lookup is remembered in <target>, which the caller
+// keeps with the call site.  It is reused until a function or instrument is
+// added or the lists are cleared.  Names that are not known yet go through
+// the plain dispatch() above, which can autoload them.
+
+int
+RTcmix::dispatch(const char *func_label, DispatchTarget *target,
+				 const Arg arglist[], const int nargs, Arg *retval)
+{
+   ++sDispatchDepth;
+   int status = dispatchTarget(func_label, target, arglist, nargs, retval);
+   if (--sDispatchDepth == 0 && ScoreImage::recording())
+      ScoreImage::addCall(func_label, arglist, nargs, *retval);
+   return status;
+}
+
+int
+RTcmix::dispatchTarget(const char *func_label, DispatchTarget *target,
+					   const Arg arglist[], const int nargs, Arg *retval)
+{
+   if (target->generation != _dispatchGeneration) {
+      target->func = findfunc(func_label);
+      target->inst = (target->func == NULL) ? findInst(func_label) : NULL;
+      target->generation = _dispatchGeneration;
+   }
+   if (target->func != NULL) {
+      int status = callfunc(target->func, func_label, arglist, nargs, retval);
+      if (status != FUNCTION_NOT_FOUND)
+         return status;
+      *retval = 0.0;
+      status = checkInsts(func_label, arglist, nargs, retval);
+      if (status == FUNCTION_NOT_FOUND)
+         rtcmix_advise(NULL,
+            "Note: \"%s\" is an undefined function or instrument.",
+            func_label);
+      return status;
+   }
+   if (target->inst != NULL)
+      return startInst(target->inst, arglist, nargs, retval);
+   return dispatchByName(func_label, arglist, nargs, retval);
+}
+
+// The notes share one lookup, and an argument list that has only its
+// columns refilled for each one.
+
+int
+RTcmix::dispatchMany(const char *func_label, const Arg fixed[],
+					 const double *const columns[], const int nargs,
+					 const int nnotes, int *pDone)
+{
+   DispatchTarget target;
+   Arg *arglist = new Arg[nargs];
+   for (int i = 0; i < nargs; i++)
+      arglist[i] = fixed[i];
+
+   int status = NO_ERROR;
+   int done = 0;
+   for (; done < nnotes; done++) {
+      for (int i = 0; i < nargs; i++) {
+         if (columns[i] != NULL)
+            arglist[i] = columns[i][done];
+      }
+      Arg retval;
+      status = dispatch(func_label, &target, arglist, nargs, &retval);
+      if (status != NO_ERROR)
+         break;
+      // Nobody will see the Handle, so free it (which leaves the note
+      // scheduled), unless a score image is keeping track of it.
+      if (retval.isType(HandleType) && !ScoreImage::recording()) {
+         Handle handle = (Handle) retval;
+         if (handle != NULL && handle->type == InstrumentPtrType) {
+            refHandle(handle);
+            unrefHandle(handle);
+         }
+      }
+   }
+   delete [] arglist;
+   *pDone = done;
+   return status;
+}
+
 #include <stdlib.h>
 
 class Instrument;
@@ -0,0 +1,42 @@
+#include <math.h>
+#include <ugens.h>
+
+/* Add amp * sin(phase + i * incr) to each array[i], for the sums of sines
+   of gen 9, gen 10 and maketable wave and wave3.  Calling sin() for every
+   point of every partial is what makes large tables slow, so the sines are
+   made by rotating phasors instead, from an exact sin() and cos() at the
+   start of every SINE_SPAN points, which keeps the error near that of the
+   sin() calls themselves.  Four phasors a point apart each step four points
+   at a time, so that they do not wait on one another (and can be done as
+   vectors).
+*/
+#define SINE_SPAN 64
+#define SINE_LANES 4
+
+void
+addsine(double array[], int len, double incr, double phase, double amp)
+{
+   const double sinc = sin(SINE_LANES * incr);
+   const double cinc = cos(SINE_LANES * incr);
+   int i, k, start;
+
+   for (start = 0; start < len; start += SINE_SPAN) {
+      const int end = (start + SINE_SPAN < len) ? start + SINE_SPAN : len;
+      double s[SINE_LANES], c[SINE_LANES];
+      for (k = 0; k < SINE_LANES; k++) {
+         s[k] = sin(phase + (start + k) * incr);
+         c[k] = cos(phase + (start + k) * incr);
+      }
+      for (i = start; i + SINE_LANES <= end; i += SINE_LANES) {
+         for (k = 0; k < SINE_LANES; k++) {
+            const double next = s[k] * cinc + c[k] * sinc;
+            array[i + k] += s[k] * amp;
+            c[k] = c[k] * cinc - s[k] * sinc;
+            s[k] = next;
+         }
+      }
+      for (k = 0; i < end; i++, k++)
+         array[i] += s[k] * amp;
+   }
+}
+
@@ -10,12 +10,9 @@ gen10(struct gen *gen)
       gen->array[i] = 0.0;
    j = gen->nargs;
    while (j--) {
-      if (gen->pvals[j] != 0) {
-         for (i = 0; i < gen->size; i++) {
-				double val = (double) (PI2 * (double) i / (gen->size / (j + 1)));
-            gen->array[i] += sin(val) * gen->pvals[j];
-         }
-      }
+      if (gen->pvals[j] != 0)
+         addsine(gen->array, gen->size, PI2 / (gen->size / (j + 1)), 0.0,
+                                                            gen->pvals[j]);
    }
    fnscl(gen);
 
@@ -10,13 +10,10 @@ gen9(struct gen *gen)
       gen->array[i] = 0.0;
 
    for (j = gen->nargs - 1; j > 0; j -= 3) {
-      if (gen->pvals[j - 1] != 0) {
-         for (i = 0; i < gen->size; i++) {
-            double val = sin(PI2 * ((double) i / ((double) (gen->size)
-                                 / gen->pvals[j - 2]) + gen->pvals[j] / 360.));
-            gen->array[i] += val * gen->pvals[j - 1];
-         }
-      }
+      if (gen->pvals[j - 1] != 0)
+         addsine(gen->array, gen->size,
+                 PI2 / ((double) (gen->size) / gen->pvals[j - 2]),
+                 PI2 * (gen->pvals[j] / 360.), gen->pvals[j - 1]);
    }
    fnscl(gen);
 
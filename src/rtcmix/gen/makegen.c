@@ -9,6 +9,7 @@
 #include <math.h>    /* for fabs */
 #include <assert.h>
 #include <maxdispargs.h>
+#include "../TableCache.h"
 
 extern double gen1(struct gen *gen, char *sfname);
 extern double gen2(struct gen *gen);
@@ -108,6 +109,22 @@ makegen(double p[], int n_args)
    gen.array = table;
    gen.slot = (int) p[0];   /* get from pfield, to preserve negative "flag" */
 
+   /* Sums of sines, Chebyshev polynomials and windows are worth keeping
+      from one run to the next.  The key has the args as the gen sees them,
+      and whether it normalizes.
+   */
+   int cached = (genno == 9 || genno == 10 || genno == 17 || genno == 25);
+   double keyargs[MAXDISPARGS + 1];
+   char tag[16];
+   if (cached) {
+      for (int n = 0; n < gen.nargs; ++n)
+         keyargs[n] = gen.pvals[n];
+      keyargs[gen.nargs] = (gen.slot < 0);
+      snprintf(tag, sizeof(tag), "gen%d", genno);
+      if (table_cache_find(tag, keyargs, gen.nargs + 1, table, gen.size))
+         return 0.0;
+   }
+
    switch (genno) {
       case 25:
          retval = gen25(&gen);
@@ -165,6 +182,9 @@ makegen(double p[], int n_args)
          retval = (double) die("makegen", "There is no gen%d.", genno);
    }
 
+   if (cached && retval == 0.0)
+      table_cache_store(tag, keyargs, gen.nargs + 1, table, gen.size);
+
    return retval;
 }
 
@@ -5,226 +5,331 @@
 #include "heap.h"
 #include <lock.h>
 #include <stdio.h>
+#include <algorithm>
 #include <Instrument.h>
 
 using namespace std;
 
-heapslot::heapslot() : chunkStart(0), inst(NULL), 
-					   left(NULL), right(NULL), parent(NULL)   
+#define HEAP_ARITY 4
+
+// If at least this fraction (1/n) of the elements are out of heap order,
+// rebuild the whole heap rather than sift each one up.
+#define HEAP_REBUILD_FRACTION 8
+
+bool HeapInbox::post(Instrument *inst, FRAMETYPE chunkStart)
 {
+  Lock lock(&postLock);
+  const unsigned int t = tail;
+  if (t - head >= (unsigned int) kSize)
+	return false;
+  Entry &entry = entries[t & (kSize - 1)];
+  entry.chunkStart = chunkStart;
+  entry.inst = inst;
+  __sync_synchronize();		// publish the entry before the new tail
+  tail = t + 1;
+  return true;
 }
 
-heapslot::~heapslot()
+bool HeapInbox::take(Instrument **pInst, FRAMETYPE *pChunkStart)
 {
-//	printf("heapslot::~heapslot()\n");
-	delete left;
-	delete right;
+  const unsigned int h = head;
+  if (h == tail)
+	return false;
+  __sync_synchronize();		// read the entry only after seeing the tail
+  const Entry &entry = entries[h & (kSize - 1)];
+  *pInst = entry.inst;
+  *pChunkStart = entry.chunkStart;
+  __sync_synchronize();		// finish reading before releasing the slot
+  head = h + 1;
+  return true;
 }
 
 heap::~heap()
 {
-    delete top;
 //	printf("heap::~heap()\n");
 }
 
-FRAMETYPE heap::getTop()
+void heap::siftUp(size_t index)
 {
-  Lock topLock(getLockHandle());	// This will unlock when it goes out of scope
-  return top ? top->chunkStart : 0;
+  Element elt = elements[index];
+  while (index > 0) {
+	const size_t parent = (index - 1) / HEAP_ARITY;
+	if (!(elt < elements[parent]))
+	  break;
+	elements[index] = elements[parent];
+	index = parent;
+  }
+  elements[index] = elt;
 }
 
-void heap::insert(Instrument *newInst, FRAMETYPE cStart)
+void heap::siftDown(size_t index)
 {
-  heapslot *newHeapElt;
-  heapslot *tempHeapElt;
-  Instrument *tempInst;
-  unsigned long tempChunkStart;
-
-  Lock insertLock(getLockHandle());	// This will unlock when it goes out of scope
+  const size_t count = elements.size();
+  Element elt = elements[index];
+  for (;;) {
+	const size_t first = index * HEAP_ARITY + 1;
+	if (first >= count)
+	  break;
+	const size_t last = (first + HEAP_ARITY < count) ? first + HEAP_ARITY : count;
+	size_t least = first;
+	for (size_t child = first + 1; child < last; ++child)
+	  if (elements[child] < elements[least])
+		least = child;
+	if (!(elements[least] < elt))
+	  break;
+	elements[index] = elements[least];
+	index = least;
+  }
+  elements[index] = elt;
+}
 
-//  printf("insert(in):  %lld\n", cStart);
+// Put any elements appended in bulk-load mode into heap order.
 
-  if (size == 0) {          // SC:  heap is empty ... need to allocate new memory
-//  printf("Heap empty ... initializing\n");
-    top = new heapslot;
-    leaves.head=NULL;
-    leaves.tail=NULL;
-    leaves.pushTail(top);
-    bot = top;
+void heap::settle()
+{
+  const size_t count = elements.size();
+  if (settled == count)
+	return;
+  if ((count - settled) * HEAP_REBUILD_FRACTION >= count) {
+	for (size_t n = (count - 1) / HEAP_ARITY + 1; n-- > 0; )
+	  siftDown(n);
+  }
+  else {
+	for (size_t n = settled; n < count; ++n)
+	  siftUp(n);
   }
+  settled = count;
+}
+
+FRAMETYPE heap::getTop()
+{
+  Lock topLock(getLockHandle());	// This will unlock when it goes out of scope
+  settle();
+  return elements.empty() ? 0 : elements[0].chunkStart;
+}
+
+// Called with the heap locked
 
-  newHeapElt = leaves.pop();  // pop bottom most leaf to locate new insertion point
-
-  newHeapElt->left = new heapslot;    // create new slots and put into leaves queue
-  newHeapElt->left->parent = newHeapElt;
-  newHeapElt->right = new heapslot;
-  newHeapElt->right->parent = newHeapElt;
-  
-  leaves.pushTail(newHeapElt->right);
-  leaves.pushTail(newHeapElt->left);
-
-  newHeapElt->inst = newInst;
-  newHeapElt->chunkStart = cStart;
-
-  bot = newHeapElt;
-
-  tempHeapElt = newHeapElt;
-
-  // swap instruments based on chunkStart value until heap order is restored
-  while (tempHeapElt->parent && 
-	 (tempHeapElt->parent->chunkStart > tempHeapElt->chunkStart)) {
-    tempInst = tempHeapElt->parent->inst;
-    tempChunkStart = tempHeapElt->parent->chunkStart;
-    tempHeapElt->parent->inst = tempHeapElt->inst;
-    tempHeapElt->parent->chunkStart = tempHeapElt->chunkStart;
-    tempHeapElt->inst = tempInst;
-    tempHeapElt->chunkStart = tempChunkStart;
-    tempHeapElt = tempHeapElt->parent;
+void heap::insertElement(Instrument *newInst, FRAMETYPE cStart)
+{
+//  printf("insert(in):  %lld\n", cStart);
+
+  Element elt;
+  elt.chunkStart = cStart;
+  elt.order = insertCount++;
+  elt.inst = newInst;
+  elements.push_back(elt);
+  if (!bulkLoad) {
+	siftUp(elements.size() - 1);
+	settled = elements.size();
   }
   size++;
-//  printf("insert(out): %lld\n", tempHeapElt->chunkStart);
 //  printf("heap::insert ... size = %d\n", size)";
 }
 
+void heap::insert(Instrument *newInst, FRAMETYPE cStart)
+{
+  Lock insertLock(getLockHandle());	// This will unlock when it goes out of scope
+  insertElement(newInst, cStart);
+}
+
+// Schedule an instrument without taking the heap lock.  If the inbox is full,
+// take the lock and empty it ourselves, which keeps everything in order.
+// (Only one thread at a time takes from the inbox, since both do so with
+// the heap locked.)
+
+void heap::post(Instrument *newInst, FRAMETYPE cStart)
+{
+  if (inbox.post(newInst, cStart))
+	return;
+  Lock postLock(getLockHandle());
+  takeInbox();
+  insertElement(newInst, cStart);
+}
+
+// Move everything posted so far into the heap.  Called by the audio thread
+// at the start of each buffer.
+
+void heap::drainInbox()
+{
+  if (inbox.empty())
+	return;
+  Lock drainLock(getLockHandle());
+  takeInbox();
+}
+
+// Called with the heap locked
+
+void heap::takeInbox()
+{
+  Instrument *inst;
+  FRAMETYPE cStart;
+  while (inbox.take(&inst, &cStart))
+	insertElement(inst, cStart);
+}
+
 // Pull the top instrument if its start sample is < maxChunkStart
 // Returns start sample for the instrument as argument
 
-Instrument * 
+Instrument *
 heap::deleteMin(FRAMETYPE maxChunkStart, FRAMETYPE *pChunkStart)
 {
-  int sift;               // flag to tell loop when to stop sifting
-  Instrument* retInst;
-  Instrument* tempInst;
-  heapslot *dead;
-  heapslot *oldBot;
-  heapslot *tempHeapElt;
-  unsigned long tempChunkStart;
-  unsigned long retChunkStart;
-
   Lock deleteLock(getLockHandle());	// This will unlock when it goes out of scope
 
-  sift = 1;
-
-  if (size == 0) {  // trap to catch attempt to pop empty heap
-//    cerr << "heap is empty -- returning NULL\n";
+  if (elements.empty()) {  // trap to catch attempt to pop empty heap
 	*pChunkStart = 0;
     return NULL;
   }
 
+  settle();
+
   // If instrument start time is > max, return NULL.
-  if (top->chunkStart >= maxChunkStart) {
-      *pChunkStart = top->chunkStart;
+  if (elements[0].chunkStart >= maxChunkStart) {
+      *pChunkStart = elements[0].chunkStart;
 	  return NULL;
   }
-  
-  retInst = top->inst;    // return instrument is the top instrument
-  retChunkStart = top->chunkStart;
 
-  top->inst = bot->inst;  // replace top instrument with bottom instrument
-  top->chunkStart = bot->chunkStart;
+  Instrument *retInst = elements[0].inst;
+  *pChunkStart = elements[0].chunkStart;
 
-                          // for filtering down (later)
-  oldBot = bot;           // store old "bottom"
+  // replace top element with bottom element and filter it down
+  elements[0] = elements.back();
+  elements.pop_back();
+  settled = elements.size();
+  if (!elements.empty())
+	siftDown(0);
 
-  bot->left = NULL;
-  bot->right = NULL;
-  bot->inst = NULL;
-  bot->chunkStart = 0;
+//  printf("deleteMin(): %lld\n", *pChunkStart);
+  size--;
+  return retInst;
+}
 
-  if (size > 1) {             // SC: only want to pop one item if size == 1
-    dead = leaves.popTail();  // trim last (two) element(s) appended to leaves
-    delete dead;              // and free up memory
-  }
-  dead = leaves.popTail();    
-  delete dead;
-
-  bot = leaves.tail->heap->parent;  // reset bottom
-  
-  leaves.push(oldBot);        // push old bottom onto top of leaves
-
-  tempHeapElt = top;          // place new element onto top of heap
-
-  // filter top item down through heap until heap order is restored
-
-  while ((tempHeapElt->inst && 
-	(tempHeapElt->left->inst || tempHeapElt->right->inst) && sift)) {
-    if (!tempHeapElt->left->inst) {
-      if (tempHeapElt->right->chunkStart < tempHeapElt->chunkStart) {
-	tempInst = tempHeapElt->right->inst;
-	tempChunkStart = tempHeapElt->right->chunkStart;
-	tempHeapElt->right->inst = tempHeapElt->inst;
-	tempHeapElt->right->chunkStart = tempHeapElt->chunkStart;
-	tempHeapElt->inst = tempInst;
-	tempHeapElt->chunkStart = tempChunkStart;
-	tempHeapElt = tempHeapElt->right;
-      }
-      else
-	sift = 0;
-    }
-    else if (!tempHeapElt->right->inst) {
-      if (tempHeapElt->left->chunkStart < tempHeapElt->chunkStart) {
-	tempInst = tempHeapElt->left->inst;
-	tempChunkStart = tempHeapElt->left->chunkStart;
-	tempHeapElt->left->inst = tempHeapElt->inst;
-	tempHeapElt->left->chunkStart = tempHeapElt->chunkStart;
-	tempHeapElt->inst = tempInst;
-	tempHeapElt->chunkStart = tempChunkStart;
-	tempHeapElt = tempHeapElt->left;
-      }
-      else
-	sift = 0;
-    }
-    if (tempHeapElt->left->inst && tempHeapElt->right->inst) {
-      if(tempHeapElt->left->chunkStart < tempHeapElt->right->chunkStart) {
-	if (tempHeapElt->left->chunkStart < tempHeapElt->chunkStart) {
-	tempInst = tempHeapElt->left->inst;
-	tempChunkStart = tempHeapElt->left->chunkStart;
-	tempHeapElt->left->inst = tempHeapElt->inst;
-	tempHeapElt->left->chunkStart = tempHeapElt->chunkStart;
-	tempHeapElt->inst = tempInst;
-	tempHeapElt->chunkStart = tempChunkStart;
-	tempHeapElt = tempHeapElt->left;
-	}
-	else
-	  sift = 0;
-      }
-      else if(tempHeapElt->left->chunkStart >= tempHeapElt->right->chunkStart)
-	if (tempHeapElt->right->chunkStart < tempHeapElt->chunkStart) {
-	tempInst = tempHeapElt->right->inst;
-	tempChunkStart = tempHeapElt->right->chunkStart;
-	tempHeapElt->right->inst = tempHeapElt->inst;
-	tempHeapElt->right->chunkStart = tempHeapElt->chunkStart;
-	tempHeapElt->inst = tempInst;
-	tempHeapElt->chunkStart = tempChunkStart;
-	tempHeapElt = tempHeapElt->right;
-	}
-	else
-	  sift = 0;
-    }
+int
+heap::extractDue(FRAMETYPE maxChunkStart, std::vector<DueNote> &outList)
+{
+  Lock extractLock(getLockHandle());
+
+  if (elements.empty())
+	return 0;
+
+  settle();
+
+  int count = 0;
+  while (!elements.empty() && elements[0].chunkStart < maxChunkStart) {
+	outList.push_back(DueNote(elements[0].chunkStart, elements[0].inst));
+	elements[0] = elements.back();
+	elements.pop_back();
+	if (!elements.empty())
+	  siftDown(0);
+	++count;
   }
-//  printf("deleteMin(): %lld\n", retChunkStart);
+  settled = elements.size();
+  size -= count;
+  return count;
+}
+
+// Turning bulk-load mode off puts the heap in order right away, so that the
+// next deleteMin() does not have to.
+
+void heap::setBulkLoad(bool inBulkLoad)
+{
+  Lock bulkLock(getLockHandle());
+  bulkLoad = inBulkLoad;
+  if (!bulkLoad)
+	settle();
+}
+
+// Called by the audio thread, so anything waiting in our inbox is moved to
+// the other heap's inbox (which is the same size, so there is room) rather
+// than into its array.
+
+void heap::exchange(heap &inEmpty)
+{
+  Lock exchangeLock(getLockHandle());
+  elements.swap(inEmpty.elements);
+  std::swap(size, inEmpty.size);
+  std::swap(settled, inEmpty.settled);
+  std::swap(insertCount, inEmpty.insertCount);	// later ties go after these
+  Instrument *inst;
+  FRAMETYPE cStart;
+  while (inbox.take(&inst, &cStart))
+	inEmpty.inbox.post(inst, cStart);
+}
+
+Instrument *heap::takeAny()
+{
+  Lock takeLock(getLockHandle());
+  Instrument *inst;
+  FRAMETYPE cStart;
+  if (inbox.take(&inst, &cStart))
+	return inst;
+  if (elements.empty())
+	return NULL;
+  inst = elements.back().inst;
+  elements.pop_back();
+  if (settled > elements.size())
+	settled = elements.size();
   size--;
-  *pChunkStart = retChunkStart;
-  return retInst;
+  return inst;
 }
 
-void heapslot::dump(int indent)
+// The children of an element start no sooner than it does, so the search
+// stops going down a branch at the first element that is too late.
+
+int heap::visitFrom(size_t index, FRAMETYPE maxChunkStart,
+					bool (*inFunc)(Instrument *, void *), void *inContext, int maxCount)
 {
-  int i;
+  if (index >= settled || elements[index].chunkStart >= maxChunkStart)
+	return 0;
+  int visited = inFunc(elements[index].inst, inContext) ? 1 : 0;
+  const size_t first = index * HEAP_ARITY + 1;
+  for (size_t child = first; child < first + HEAP_ARITY && visited < maxCount; ++child)
+	visited += visitFrom(child, maxChunkStart, inFunc, inContext, maxCount - visited);
+  return visited;
+}
 
-  if (this->inst == NULL)
-    return;
-  
-  if (left->inst)
-    left->dump(indent+1);
+int heap::visitBefore(FRAMETYPE maxChunkStart, bool (*inFunc)(Instrument *, void *),
+					  void *inContext, int maxCount)
+{
+  Lock visitLock(getLockHandle());
+  if (maxCount <= 0)
+	return 0;
+  return visitFrom(0, maxChunkStart, inFunc, inContext, maxCount);
+}
+
+// Those left keep their insertion counts, so equal start times still come
+// out in order once the heap is rebuilt.
 
-  for (i=0; i<indent; i++)
-    printf("    ");
-  printf("%lld\n", chunkStart);
-  
-  if (right->inst)
-    right->dump(indent+1);
-  return;
+int heap::removeIf(bool (*inFunc)(Instrument *, void *), void *inContext)
+{
+  Lock removeLock(getLockHandle());
+  takeInbox();
+  size_t kept = 0;
+  for (size_t n = 0; n < elements.size(); ++n) {
+	if (inFunc(elements[n].inst, inContext))
+	  elements[n].inst->unref();
+	else
+	  elements[kept++] = elements[n];
+  }
+  const int removed = int(elements.size() - kept);
+  if (removed > 0) {
+	elements.resize(kept);
+	size -= removed;
+	settled = 0;
+	if (!bulkLoad)
+	  settle();
+  }
+  return removed;
 }
 
+void heap::dump()
+{
+  Lock dumpLock(getLockHandle());
+  settle();
+  for (size_t n = 0; n < elements.size(); ++n) {
+	for (size_t parent = n; parent > 0; parent = (parent - 1) / HEAP_ARITY)
+	  printf("    ");
+	printf("%lld\n", elements[n].chunkStart);
+  }
+}
 
@@ -7,85 +7,144 @@
 
 class Instrument;
 
-// class for heap element structure
+// Single-producer, single-consumer ring of instruments waiting to go into
+// the heap.  Interactive parsers post here rather than taking the heap lock,
+// and the audio thread drains the ring at the start of each buffer, so it
+// never waits on a parser.  Posting threads serialize among themselves with
+// a lock of their own, which the audio thread never takes, and anyone taking
+// from the ring must hold the heap lock.
 
-class heapslot {
+class HeapInbox {
 public:
-  FRAMETYPE chunkStart; // start samp for chunk
-  Instrument *inst;
-  heapslot *left, *right, *parent;
-
-  heapslot();
-  ~heapslot();
-  void dump(int);
-};
-
-// class for queue used to hold heap end
-
-class qElt {
-public:
-  qElt(heapslot *hs) : next(NULL), prev(NULL), heap(hs) {}
-  friend class rtqueue;
-  friend class heap;
-  qElt *next;
-  qElt *prev;
-  heapslot *heap;
-};
-
-// class for main queue structure
-
-class rtqueue {
+  HeapInbox() : head(0), tail(0) { pthread_mutex_init(&postLock, NULL); }
+  ~HeapInbox() { pthread_mutex_destroy(&postLock); }
+  bool post(Instrument *inst, FRAMETYPE chunkStart);		// false if full
+  bool take(Instrument **pInst, FRAMETYPE *pChunkStart);	// false if empty
+  bool empty() const { return head == tail; }
+  long pending() const { return (long) (tail - head); }
 private:
-  friend class heap;
-  qElt *head;
-  qElt *tail;
-public:
-  rtqueue() : head(NULL), tail(NULL) {}
-  ~rtqueue();
-  void pushTail(heapslot*);
-  void push(heapslot*);
-  heapslot *pop();
-  heapslot *popTail();
-  void print();
+  enum { kSize = 4096 };	// power of two
+  struct Entry {
+	FRAMETYPE chunkStart;
+	Instrument *inst;
+  };
+  Entry entries[kSize];
+  volatile unsigned int head;	// next entry to take, written by the consumer
+  char pad[64];					// keep head and tail on separate cache lines
+  volatile unsigned int tail;	// next entry to post, written by producers
+  pthread_mutex_t postLock;
 };
 
 // class for main heap structure
+//
+// A 4-ary min-heap of (chunkStart, Instrument) kept in one contiguous array.
+// Instruments with equal start times come out in the order they went in.
+// In bulk-load mode, insert() just appends, and the array is put in heap
+// order all at once by the next getTop() or deleteMin().  This is meant for
+// a whole score being parsed before playback starts.  Instruments scheduled
+// with post() wait in the inbox until drainInbox() inserts them.
 
 class heap : public Lockable {
 private:
-  rtqueue leaves;  // queue used to hold next insertion point
+  struct Element {
+	FRAMETYPE chunkStart;
+	unsigned long long order;	// insertion count, to break ties
+	Instrument *inst;
+	bool operator < (const Element &rhs) const {
+	  return chunkStart < rhs.chunkStart || (chunkStart == rhs.chunkStart && order < rhs.order);
+	}
+  };
+  std::vector<Element> elements;
+  HeapInbox inbox;
+  unsigned long long insertCount;
+  size_t settled;		// elements[0, settled) are in heap order
+  bool bulkLoad;
+  void siftUp(size_t index);
+  void siftDown(size_t index);
+  void settle();
+  void insertElement(Instrument*, FRAMETYPE chunkStart);
+  void takeInbox();
+  int visitFrom(size_t index, FRAMETYPE maxChunkStart,
+				bool (*inFunc)(Instrument *, void *), void *inContext, int maxCount);
 public:
-  heapslot* bot;
-  heapslot* top;
-  heap() : bot(NULL), top(NULL), size(0) {}
+  heap(bool inBulkLoad=false) : insertCount(0), settled(0), bulkLoad(inBulkLoad), size(0) {}
   ~heap();
   FRAMETYPE getTop();
-  long getSize() const { return size; }
+  long getSize() const { return size + inbox.pending(); }
   void insert(Instrument*, FRAMETYPE chunkStart);
+  void post(Instrument*, FRAMETYPE chunkStart);
+  void drainInbox();
   Instrument *deleteMin(FRAMETYPE maxChunkStart, FRAMETYPE *pChunkStart);
-  void dump(heapslot*,int);
+  // Remove every instrument starting before <maxChunkStart>, appending each
+  // with its chunk start to <outList> in the order deleteMin() would give
+  // them, all under one lock.  The caller takes over the heap's references.
+  // Returns how many were removed.
+  typedef std::pair<FRAMETYPE, Instrument *> DueNote;
+  int extractDue(FRAMETYPE maxChunkStart, std::vector<DueNote> &outList);
+  void setBulkLoad(bool inBulkLoad);
+  // Trade contents with <inEmpty>, which must be empty.  Nothing is
+  // allocated or freed, so the audio thread can flush the heap this way.
+  void exchange(heap &inEmpty);
+  // Remove any one instrument (NULL if none), for disposing of contents
+  // a few at a time.  The caller takes over the heap's reference.
+  Instrument *takeAny();
+  // Call <inFunc> on the instruments starting before <maxChunkStart>, soonest
+  // first along each branch, until it has returned true <maxCount> times.
+  // Only the part of the heap already in order is searched, and the heap is
+  // locked throughout.  Returns how many times <inFunc> returned true.
+  int visitBefore(FRAMETYPE maxChunkStart, bool (*inFunc)(Instrument *, void *),
+				  void *inContext, int maxCount);
+  // Remove and unref every instrument for which <inFunc> returns true,
+  // including any waiting in the inbox.  Returns how many were removed.
+  int removeIf(bool (*inFunc)(Instrument *, void *), void *inContext);
+  void dump();
   long size;
 };
 
 // class for queue used to hold Instruments
+//
+// This is a calendar queue keyed on chunk start.  Almost every element is
+// pushed back with a chunk start at the end of the current buffer, so the
+// elements are kept in a small ring of buckets, each one buffer wide, plus a
+// sorted overflow list for anything further out.  A push lands at (or very
+// near) the end of its bucket, so push and pop are O(1) in the steady state.
+// Elements with equal chunk starts pop in the order they were pushed.
 
 class RTQueue {
 	typedef std::pair<FRAMETYPE, Instrument *> Element;
+	enum { kBucketCount = 4 };		// power of two
+	struct Bucket {
+		Bucket() : head(0) {}
+		std::vector<Element>	elements;	// ascending chunk start from head
+		size_t					head;		// index of the next element to pop
+		bool empty() const { return head == elements.size(); }
+	};
 private:
-	std::vector<Element>	mInstrumentVector;
-	typedef std::vector<Element>::iterator InstrumentVecIterator;
+	Bucket					mBuckets[kBucketCount];
+	std::vector<Element>	mOverflow;		// descending, so the next is at back
+	FRAMETYPE				mBucketFrames;	// width of one bucket
+	FRAMETYPE				mFirstBucket;	// bucket number of the earliest bucket
+	int						mSize;
 	static bool sortElems(const Element& x,const Element& y);
+	static bool lessElems(const Element& x,const Element& y);
     static void unrefElems(Element &e);
+	Bucket &bucketFor(FRAMETYPE bucketNumber) { return mBuckets[bucketNumber & (kBucketCount - 1)]; }
+	void insert(const Element &element);
+	Bucket *firstBucket();
 public:
-	RTQueue() {}
+	RTQueue() : mBucketFrames(0), mFirstBucket(0), mSize(0) {}
 	~RTQueue();
 	void push(Instrument*, FRAMETYPE);
-    void pushUnsorted(Instrument*, FRAMETYPE);
-    void sort();
 	Instrument *pop(FRAMETYPE *pChunkStart);
 	FRAMETYPE nextChunk();
 	// Return the number of elements on the RTQueue
-	int getSize() const { return (int) mInstrumentVector.size(); }
+	int getSize() const { return mSize; }
+	// Append every queued Instrument to <outList> (without ref'ing them)
+	void collect(std::vector<Instrument *> &outList) const;
+	// As for the heap: trade contents with an empty RTQueue, and remove any
+	// one Instrument, handing over the queue's reference.
+	void exchange(RTQueue &inEmpty);
+	Instrument *takeAny();
 	void print();  // For debugging
 };
 
@@ -18,7 +18,11 @@ void RTQueue::unrefElems(Element &e)
 
 RTQueue::~RTQueue()
 {
-    std::for_each(mInstrumentVector.begin(), mInstrumentVector.end(), unrefElems);
+	for (int n = 0; n < kBucketCount; ++n) {
+		Bucket &bucket = mBuckets[n];
+		std::for_each(bucket.elements.begin() + bucket.head, bucket.elements.end(), unrefElems);
+	}
+    std::for_each(mOverflow.begin(), mOverflow.end(), unrefElems);
 }
 
 bool RTQueue::sortElems (const RTQueue::Element& x,const RTQueue::Element& y)
@@ -26,41 +30,87 @@ bool RTQueue::sortElems (const RTQueue::Element& x,const RTQueue::Element& y)
 	return (x.first > y.first);
 }
 
-// Push an element to end of the RTQueue
+bool RTQueue::lessElems (const RTQueue::Element& x,const RTQueue::Element& y)
+{
+	return (x.first < y.first);
+}
 
-void RTQueue::push(Instrument *inInst, FRAMETYPE chunkstart)
+// Place an element in its bucket, or in the overflow list if it is beyond
+// the last bucket.  An element earlier than the first bucket (the scheduler
+// is behind) goes into the first bucket, which keeps it ahead of the rest.
+
+void RTQueue::insert(const Element &element)
 {
-	Element element(chunkstart, inInst);
-	mInstrumentVector.insert(std::lower_bound(mInstrumentVector.begin(), mInstrumentVector.end(), element, sortElems), element);
-	inInst->ref();
+	FRAMETYPE bucketNumber = element.first / mBucketFrames;
+	if (bucketNumber < mFirstBucket)
+		bucketNumber = mFirstBucket;
+	if (bucketNumber >= mFirstBucket + kBucketCount) {
+		mOverflow.insert(std::lower_bound(mOverflow.begin(), mOverflow.end(), element, sortElems), element);
+		return;
+	}
+	std::vector<Element> &elements = bucketFor(bucketNumber).elements;
+	if (elements.empty() || !lessElems(element, elements.back()))
+		elements.push_back(element);
+	else {
+		std::vector<Element>::iterator begin = elements.begin() + bucketFor(bucketNumber).head;
+		elements.insert(std::upper_bound(begin, elements.end(), element, lessElems), element);
+	}
 }
 
-// Push an element onto RTQueue, unsorted
+// Return the earliest non-empty bucket, advancing the ring past empty buckets
+// and refilling it from the overflow list as it goes.
 
-void RTQueue::pushUnsorted(Instrument *inInst, FRAMETYPE chunkstart)
+RTQueue::Bucket *RTQueue::firstBucket()
 {
-    Element element(chunkstart, inInst);
-    mInstrumentVector.push_back(element);
-    inInst->ref();
+	if (mSize == 0)
+		return NULL;
+	for (;;) {
+		Bucket &bucket = bucketFor(mFirstBucket);
+		if (!bucket.empty())
+			return &bucket;
+		if (mSize == (int) mOverflow.size())
+			mFirstBucket = mOverflow.back().first / mBucketFrames;	// skip the gap
+		else
+			++mFirstBucket;
+		while (!mOverflow.empty() && mOverflow.back().first / mBucketFrames < mFirstBucket + kBucketCount) {
+			insert(mOverflow.back());
+			mOverflow.pop_back();
+		}
+	}
 }
 
-void RTQueue::sort()
+// Push an element onto the RTQueue
+
+void RTQueue::push(Instrument *inInst, FRAMETYPE chunkstart)
 {
-    std::sort(mInstrumentVector.begin(), mInstrumentVector.end(), sortElems);
+	Element element(chunkstart, inInst);
+	if (mBucketFrames == 0)
+		mBucketFrames = (RTcmix::bufsamps() > 0) ? RTcmix::bufsamps() : 1;
+	if (mSize == 0)
+		mFirstBucket = chunkstart / mBucketFrames;
+	insert(element);
+	++mSize;
+	inInst->ref();
 }
 
 // Pop an element of the top of the RTQueue
 
 Instrument *	RTQueue::pop(FRAMETYPE *pChunkStart)
 {
-	if (mInstrumentVector.empty()) {
+	Bucket *bucket = firstBucket();
+	if (bucket == NULL) {
 		rtcmix_warn("rtQueue", "attempt to pop empty RTQueue\n");
 		return NULL;
 	}
-	*pChunkStart = mInstrumentVector.back().first;	// frame loc
-	Instrument *outInst = mInstrumentVector.back().second;	// inst
+	const Element &element = bucket->elements[bucket->head++];
+	*pChunkStart = element.first;	// frame loc
+	Instrument *outInst = element.second;	// inst
+	if (bucket->empty()) {
+		bucket->elements.clear();
+		bucket->head = 0;
+	}
+	--mSize;
 	outInst->unref();
-	mInstrumentVector.pop_back();
 	return outInst;
 }
 
@@ -68,12 +118,59 @@ Instrument *	RTQueue::pop(FRAMETYPE *pChunkStart)
 
 FRAMETYPE RTQueue::nextChunk()
 {
-	return mInstrumentVector.back().first;
+	Bucket *bucket = firstBucket();
+	return (bucket != NULL) ? bucket->elements[bucket->head].first : 0;
 }
 
-void RTQueue::print() {
-	
+// Append every queued Instrument to outList, in no particular order
+
+void RTQueue::collect(std::vector<Instrument *> &outList) const
+{
+	for (int n = 0; n < kBucketCount; ++n) {
+		const Bucket &bucket = mBuckets[n];
+		for (size_t e = bucket.head; e < bucket.elements.size(); ++e)
+			outList.push_back(bucket.elements[e].second);
+	}
+	for (size_t e = 0; e < mOverflow.size(); ++e)
+		outList.push_back(mOverflow[e].second);
+}
+
+void RTQueue::exchange(RTQueue &inEmpty)
+{
+	assert(inEmpty.mSize == 0);
+	for (int n = 0; n < kBucketCount; ++n) {
+		mBuckets[n].elements.swap(inEmpty.mBuckets[n].elements);
+		std::swap(mBuckets[n].head, inEmpty.mBuckets[n].head);
+	}
+	mOverflow.swap(inEmpty.mOverflow);
+	std::swap(mSize, inEmpty.mSize);
+	inEmpty.mBucketFrames = mBucketFrames;
+	inEmpty.mFirstBucket = mFirstBucket;
 }
 
+// Elements come off the back of the overflow list and buckets, which
+// neither allocates nor disturbs the order of what is left.
 
+Instrument *RTQueue::takeAny()
+{
+	if (mSize == 0)
+		return NULL;
+	std::vector<Element> *from = &mOverflow;
+	for (int n = 0; from->empty() && n < kBucketCount; ++n) {
+		Bucket &bucket = mBuckets[n];
+		if (bucket.empty()) {
+			bucket.elements.clear();
+			bucket.head = 0;
+		}
+		else
+			from = &bucket.elements;
+	}
+	Instrument *inst = from->back().second;
+	from->pop_back();
+	--mSize;
+	return inst;
+}
 
+void RTQueue::print() {
+	
+}
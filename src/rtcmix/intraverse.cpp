@@ -10,20 +10,35 @@
 #endif
 #include <stdio.h>
 #include <unistd.h>
+#include <limits.h>
 #include <assert.h>
+#include <algorithm>
+#include <vector>
 #include "heap/heap.h"
 #include "rtdefs.h"
 #include <AudioDevice.h>
 #include <Instrument.h>
+#include <PField.h>
 #include <RTOption.h>
 #include <bus.h>
 #include "BusSlot.h"
+#include "ControlTable.h"
 #include "dbug.h"
+#include "DSPStats.h"
+#include "SchedTrace.h"
+#include "AllocTracker.h"
+#include "MemStats.h"
+#include "PrintRing.h"
+#include "Denormals.h"
+#include "Preparer.h"
+#include "NoteSetup.h"
+#include "VoicePool.h"
+#include "BusFreeze.h"
+#include "Polyphony.h"
 #include <ugens.h>
 
 #ifdef MULTI_THREAD
 #include "TaskManager.h"
-#include <vector>
 #endif
 
 #ifdef EMBEDDED
@@ -31,6 +46,7 @@ extern "C" {
 	void checkForBang();		// DAS TODO: currently in main.cpp -- create header and move to new file
 	void checkForVals();
 	void checkForPrint();
+	void checkForParsed();
 	void notifyIsFinished(long long);
 }
 #endif
@@ -43,11 +59,359 @@ using namespace std;
 #undef WBUG	/* this new one turns on prints of where we are */
 #undef IBUG	/* debug what Instruments are doing */
 
+// After a flush, notes let go of per buffer (see resetHeapAndQueue())
+#define FLUSH_RECLAIM_NOTES 32
+
+// Stamped interactive notes, waiting for inTraverse, which alone takes
+// from it (see RTcmix::postImmediate()).
+
+static HeapInbox sImmediateNotes;
+
+bool RTcmix::postImmediate(Instrument *inst, FRAMETYPE startFrame)
+{
+	return sImmediateNotes.post(inst, startFrame);
+}
+
+#ifdef MULTI_THREAD
+
+// In MULTI_THREAD mode the rtQueues are played a level at a time, rather
+// than a bus at a time.  The first level holds every TO_AUX bus, then come
+// the AUX_TO_AUX buses grouped by BusConfig::PlayLevel (see
+// create_play_order()), and the last level holds every TO_OUT bus.  No bus
+// reads from another bus on the same level, so all of a level's instruments
+// are run as a single batch of tasks with one wait at the end.
+//
+// An instrument writing several buses on the same level gets one job which
+// covers all of them, so that it is never exec'd concurrently with itself.
+//
+// The level's jobs are handed out costliest first, going by each note's
+// recent run() times (see Instrument::runCost()), so that a convolver is not
+// left to start after everything else and hold up the wait at the end.
+// Jobs too small to be worth a task of their own are run several to a task.
+// Each task goes to the thread that last ran its note (or the note's class),
+// whose cache likely still holds the note's delay lines and buffers, unless
+// that would give the thread well over its share of the level; then it goes
+// to the thread with the least so far.  Idle threads still steal.
+
+// A task costing less than this is batched with others, in nsec
+#define MIN_TASK_COST 20000.0
+// What a note of a class not yet timed is taken to cost: enough to go first
+#define UNKNOWN_TASK_COST 1.0e9
+
+struct InstrumentJob {
+	Instrument *		inst;
+	BusType				busType;
+	std::vector<short>	buses;
+	double				cost;		// expected nsec
+	int exec();
+};
+
+int InstrumentJob::exec()
+{
+	TraceSpan span(inst->name(), (int) buses.size());
+	for (vector<short>::const_iterator it = buses.begin(); it != buses.end(); ++it)
+		inst->exec(busType, *it);
+	return 0;
+}
+
+static bool costlier(const InstrumentJob *a, const InstrumentJob *b)
+{
+	return a->cost > b->cost;
+}
+
+// Jobs [first, last) of <order>, run as one task.
+
+struct InstrumentBatch {
+	InstrumentJob * const *	first;
+	InstrumentJob * const *	last;
+	double					cost;
+	int exec();
+};
+
+int InstrumentBatch::exec()
+{
+	for (InstrumentJob * const *job = first; job != last; ++job)
+		(*job)->exec();
+	return 0;
+}
+
+// Maps each instrument popped for the current level to the index of its job.
+// Open addressing on the instrument pointer; clear() empties just the slots
+// used since the last clear().
+
+class InstrumentJobTable {
+public:
+	InstrumentJobTable() : mMask(0) {}
+	void	reserve(int inEntries);
+	int &	lookup(Instrument *inInst);		// -1 if not yet present
+	void	clear();
+private:
+	vector<Instrument *>	mKeys;
+	vector<int>				mJobs;
+	vector<int>				mUsed;
+	size_t					mMask;
+};
+
+void InstrumentJobTable::reserve(int inEntries)
+{
+	size_t size = 16;
+	while (size < (size_t) inEntries * 2)
+		size <<= 1;
+	if (size > mKeys.size()) {
+		mKeys.assign(size, (Instrument *) NULL);
+		mJobs.assign(size, -1);
+		mMask = size - 1;
+	}
+}
+
+int & InstrumentJobTable::lookup(Instrument *inInst)
+{
+	size_t slot = ((size_t) inInst >> 4) & mMask;
+	while (mKeys[slot] != NULL && mKeys[slot] != inInst)
+		slot = (slot + 1) & mMask;
+	if (mKeys[slot] == NULL) {
+		mKeys[slot] = inInst;
+		mUsed.push_back((int) slot);
+	}
+	return mJobs[slot];
+}
+
+void InstrumentJobTable::clear()
+{
+	for (vector<int>::const_iterator it = mUsed.begin(); it != mUsed.end(); ++it) {
+		mKeys[*it] = NULL;
+		mJobs[*it] = -1;
+	}
+	mUsed.clear();
+}
+
+#endif	// MULTI_THREAD
+
 // Temporary globals
 
 static FRAMETYPE bufEndSamp;
 static int startupBufCount = 0;
 static bool audioDone = true;   // set to false in runMainLoop
+static FRAMETYPE alignedSpillEnd = 0;	// end of aligned blocks mixed so far
+
+// Notes of classes with voice limits, gathered by limitVoices()
+static vector<Instrument *> sLimitedVoices;
+static bool sLimitedVoicesGathered = false;		// in this buffer
+
+// Parse-ahead state, shared between the parsing thread and the audio loop
+static pthread_mutex_t parseAheadLock = PTHREAD_MUTEX_INITIALIZER;
+static FRAMETYPE parseHorizon = 0;	// latest start frame scheduled so far
+static bool parseDone = true;
+
+// Overload monitoring, done only when playing with overload_percent set.
+// Each buffer's compute time (everything but the device write) is measured
+// against its duration.  The load follows rises quickly and falls slowly, so
+// that a run of heavy buffers is caught before the device underruns.
+
+static const int kOverloadHoldBuffers = 8;	// let the last action show first
+static double sliceLoad = 0.0;			// smoothed, 1.0 == the whole buffer
+static double peakLoad = 0.0;
+static int overloadCount = 0;
+static int overloadHold = 0;
+
+static const char *passNames[DSPStats::kCategoryCount] = {
+	"to aux pass", "aux to aux pass", "to out pass"
+};
+
+static inline DSPStats::Category passCategory(IBusClass busClass)
+{
+	switch (busClass) {
+	case TO_AUX:
+		return DSPStats::kToAuxPass;
+	case AUX_TO_AUX:
+		return DSPStats::kAuxToAuxPass;
+	default:
+		return DSPStats::kToOutPass;
+	}
+}
+
+// Keep track of how far aligned blocks have been mixed past the buffer, so
+// that the score does not end before they have been played.
+
+static inline void noteAlignedBlock(FRAMETYPE blockEnd, FRAMETYPE endsamp)
+{
+	if (endsamp < blockEnd)
+		blockEnd = endsamp;
+	if (blockEnd > alignedSpillEnd)
+		alignedSpillEnd = blockEnd;
+}
+
+static bool startedEarlier(const Instrument *x, const Instrument *y)
+{
+	return x->getstart() < y->getstart();
+}
+
+// Called just before starting the parsing thread.  Audio may not start
+// until the score has called rtsetparams, so clear audio_config as the
+// interactive modes do.
+
+void RTcmix::beginParseAhead()
+{
+	::pthread_mutex_lock(&parseAheadLock);
+	parseHorizon = 0;
+	parseDone = false;
+	::pthread_mutex_unlock(&parseAheadLock);
+	::pthread_mutex_lock(&audio_config_lock);
+	audio_config = 0;
+	::pthread_mutex_unlock(&audio_config_lock);
+	sParsingAhead = true;
+}
+
+// Called by the parsing thread when the score is finished.  A failed parse
+// stops playback, just as it would have kept it from starting.
+
+void RTcmix::endParseAhead(int status)
+{
+	::pthread_mutex_lock(&parseAheadLock);
+	parseDone = true;
+	::pthread_mutex_unlock(&parseAheadLock);
+	if (status != 0)
+		run_status = RT_ERROR;
+}
+
+// Called by Instrument::schedule after the instrument has been posted.
+
+void RTcmix::advanceParseHorizon(FRAMETYPE startFrame)
+{
+	::pthread_mutex_lock(&parseAheadLock);
+	if (startFrame > parseHorizon)
+		parseHorizon = startFrame;
+	::pthread_mutex_unlock(&parseAheadLock);
+}
+
+// Wait until the parser has scheduled something that starts at or after
+// <frame>, or has finished.  Returns true if the parser is still running.
+
+bool RTcmix::waitForParseHorizon(FRAMETYPE frame)
+{
+	for (;;) {
+		::pthread_mutex_lock(&parseAheadLock);
+		const bool done = parseDone;
+		const bool reached = parseHorizon >= frame;
+		::pthread_mutex_unlock(&parseAheadLock);
+		if (done)
+			return false;
+		if (reached || run_status == RT_SHUTDOWN || run_status == RT_ERROR)
+			return true;
+		usleep(1000);
+	}
+}
+
+// Preroll for rtoffset.  A note writing to the output buses can be heard
+// at the offset if it ends after it.  One writing to an aux bus can be heard
+// if it ends after the first frame from which that bus can be: for each note
+// reading the bus that can itself be heard, the frame from which it can be
+// heard less its tail (see Instrument::tailFrames()), or its start, if it
+// has not given one.  These frames are worked back from the output through
+// the bus graph, a level of aux buses per pass.  Without tails (rtoffset's
+// skip_preroll), only notes still playing at the offset are kept.  Notes
+// writing to no bus at all, such as PFSCHED, are always kept.
+
+static const FRAMETYPE kNeverHeard = 0x7fffffffffffffffLL;
+
+struct PrerollContext {
+	FRAMETYPE					offsetFrame;
+	const vector<FRAMETYPE> *	auxHeard;	// per aux bus
+};
+
+static bool collectNote(Instrument *inst, void *context)
+{
+	((vector<Instrument *> *) context)->push_back(inst);
+	return true;
+}
+
+// The first frame from which what <inst> writes can be heard.
+
+static FRAMETYPE heardFrom(const Instrument *inst, const PrerollContext &context)
+{
+	const BusSlot *slot = inst->getBusSlot();
+	FRAMETYPE from = (slot->out_count > 0) ? context.offsetFrame : kNeverHeard;
+	for (int n = 0; n < slot->auxout_count; ++n) {
+		const FRAMETYPE busFrom = (*context.auxHeard)[slot->auxout[n]];
+		if (busFrom < from)
+			from = busFrom;
+	}
+	return from;
+}
+
+static bool unheard(Instrument *inst, void *context)
+{
+	const BusSlot *slot = inst->getBusSlot();
+	if (slot == NULL || (slot->out_count == 0 && slot->auxout_count == 0))
+		return false;
+	return inst->getendsamp() <= heardFrom(inst, *(const PrerollContext *) context);
+}
+
+int RTcmix::prunePreroll(FRAMETYPE offsetFrame, bool withTails)
+{
+	if (parsingAhead())
+		waitForParseHorizon(offsetFrame);
+	rtHeap->drainInbox();
+	rtHeap->getTop();		// puts it in order for visitBefore()
+
+	vector<FRAMETYPE> auxHeard(busCount, withTails ? kNeverHeard : offsetFrame);
+	PrerollContext context = { offsetFrame, &auxHeard };
+	if (withTails) {
+		vector<Instrument *> notes;
+		rtHeap->visitBefore(offsetFrame, collectNote, &notes, INT_MAX);
+		bool changed = true;
+		for (int pass = 0; changed && pass <= busCount; ++pass) {
+			changed = false;
+			for (vector<Instrument *>::const_iterator it = notes.begin(); it != notes.end(); ++it) {
+				const Instrument *inst = *it;
+				const BusSlot *slot = inst->getBusSlot();
+				if (slot == NULL || slot->auxin_count == 0)
+					continue;
+				const FRAMETYPE heard = heardFrom(inst, context);
+				const FRAMETYPE end = inst->getendsamp();
+				if (end <= heard)
+					continue;	// its own output is unheard
+				const FRAMETYPE start = end - inst->nSamps();
+				FRAMETYPE from = start;
+				if (inst->tailFrames() >= 0 && heard - inst->tailFrames() > start)
+					from = heard - inst->tailFrames();
+				for (int n = 0; n < slot->auxin_count; ++n) {
+					if (from < auxHeard[slot->auxin[n]]) {
+						auxHeard[slot->auxin[n]] = from;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+	return rtHeap->removeIf(unheard, &context);
+}
+
+// Called between buffers of the preroll.  Whole buffers are skipped, so the
+// clock stays on the buffer grid.
+
+void RTcmix::skipIdleBuffers(FRAMETYPE limit)
+{
+	if (parsingAhead() || alignedSpillEnd > bufStartSamp)
+		return;
+	for (int q = 0; q < busCount * 3; ++q) {
+		if (rtQueue[q].getSize() > 0)
+			return;
+	}
+	rtHeap->drainInbox();
+	if (rtHeap->getSize() == 0)
+		return;		// let inTraverse() find the score is over
+	FRAMETYPE next = rtHeap->getTop();
+	if (next > limit)
+		next = limit;
+	const int frameCount = bufsamps();
+	const FRAMETYPE frames = (next - bufStartSamp) / frameCount * frameCount;
+	if (frames > 0) {
+		elapsed += frames;
+		bufStartSamp += frames;
+		bufEndSamp += frames;
+	}
+}
 
 int RTcmix::runMainLoop()
 {
@@ -60,6 +424,10 @@ int RTcmix::runMainLoop()
 	bufEndSamp = bufsamps();
 	startupBufCount = 0;
 	audioDone = false;
+	sliceLoad = peakLoad = 0.0;
+	alignedSpillEnd = 0;
+	overloadCount = overloadHold = 0;
+	DSPStats::reset();
 	
 	// This lets signal handler know that we have gotten to this point.
 	audioLoopStarted = 1;
@@ -74,11 +442,18 @@ int RTcmix::runMainLoop()
 
 	while (!audio_configured) {
 //        rtcmix_debug(NULL, "runMainLoop():  top of !audio_configured loop");
+		// Checked before audio_config, so that a score which calls
+		// rtsetparams and then ends right away is not missed.
+		const bool parseEnded = parsingAhead() && !waitForParseHorizon(0);
 		::pthread_mutex_lock(&audio_config_lock);
 		if (audio_config) {
 			audio_configured = YES;
 		}
 		::pthread_mutex_unlock(&audio_config_lock);
+		if (!audio_configured && parseEnded) {
+			audioDone = true;
+			return -1;	// The score never called rtsetparams.
+		}
 #ifndef EMBEDDED
         // This interactive mode is specifically the standalone one - not the embedded one.
 		if (interactive()) {
@@ -112,15 +487,34 @@ int RTcmix::runMainLoop()
 	if (rtsetparams_was_called()) {
 		startupBufCount = 0;
 
+		// A non-interactive score has been parsed in full by now, so set up
+		// any notes still held for it, and put the bulk-loaded heap in order
+		// before the first buffer.
+		NoteSetup::flush();
+		rtHeap->setBulkLoad(false);
+		if (!interactive() && RTOption::preconfigureMsec() > 0)
+			Preparer::start(rtHeap, bufsamps());
+
+		// When streaming, give the parser a head start.
+		if (parsingAhead()) {
+			const FRAMETYPE latency = (FRAMETYPE) (RTOption::parseAheadMsec() * 0.001 * sr());
+			rtcmix_debug(NULL, "runMainLoop():  waiting for %lld frames of score", (long long) latency);
+			waitForParseHorizon(latency);
+		}
+
 		rtcmix_debug(NULL, "runMainLoop():  calling startAudio()");
 		
 #ifndef EMBEDDED
 		if (RTcmix::bufTimeOffset > 0) {
             const FRAMETYPE bufOffset = (FRAMETYPE)(RTcmix::bufTimeOffset * sr());
-			RTPrintf("Skipping %f seconds (%llu frames)", RTcmix::bufTimeOffset, (unsigned long long)bufOffset);
+			const int pruned = prunePreroll(bufOffset, runToOffset);
+			RTPrintf("Skipping %f seconds (%llu frames, %d notes unheard)", RTcmix::bufTimeOffset, (unsigned long long)bufOffset, pruned);
 			run_status = RT_SKIP;
 			int dot = 0, dotskip = (int)(sr()/bufsamps());	// dots in a second of audio
 			while (bufStartSamp < bufOffset) {
+				skipIdleBuffers(bufOffset);
+				if (bufStartSamp >= bufOffset)
+					break;
                 if (inTraverse(audioDevice, this) == false) {
                     audioDone = true;
                     rtcmix_debug(NULL, "runMainLoop():  exiting with -1");
@@ -167,7 +561,12 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 	int bus = -1, bus_count = 0, busq = 0;
 	int i;
 	int bus_q_offset = 0;
-    const int frameCount = bufsamps();
+    const int frameCount = sliceFrames();
+	AllocTracker::AudioScope realtime;
+	PrintRing::AudioScope deferPrinting;
+	Denormals::Scope flushing;
+
+	ControlTable::markBuffer(bufStartSamp, sr());
 
 #ifdef WBUG
 	RTPrintf("ENTERING inTraverse()\n");
@@ -203,18 +602,60 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
             notifyIsFinished(bufEndSamp);
             return true;
         }
+        else if (interactive())
+            reclaimFlushed(FLUSH_RECLAIM_NOTES);
 #endif
 
+	const bool monitorLoad = RTOption::play() && RTOption::overloadPercent() > 0
+							 && !panic && run_status != RT_SKIP;
+	SchedTrace::startBuffer();
+	const bool timeBuffer = monitorLoad || DSPStats::enabled() || SchedTrace::active();
+	const long long bufferStart = timeBuffer ? DSPStats::now() : 0;
+
+	// When streaming, make sure the parser has gotten past this buffer.
+	// Whether it is still running must be read before draining the inbox,
+	// or its last notes could be missed when deciding whether we are done.
+	const bool stillParsing = parsingAhead() && waitForParseHorizon(bufEndSamp);
+
+	// Pick up anything scheduled by the parser since the last buffer
+	rtHeap->drainInbox();
+
+	// Mix in the frozen buses (see BusFreeze.h) before anyone reads them
+	BusFreeze::playBuffer(bufStartSamp, bufEndSamp);
+
+	// Have the Preparer configure the notes starting soon
+	if (Preparer::running())
+		Preparer::ahead(bufEndSamp + (FRAMETYPE) (RTOption::preconfigureMsec() * 0.001 * sr()));
+
 	// Pop elements off rtHeap and insert into rtQueue +++++++++++++++++++++
 
-	// deleteMin() returns top instrument if inst's start time is < bufEndSamp,
-	// else NULL.  heapChunkStart is set in all cases
-	
+	// extractDue() takes every instrument whose start time is < bufEndSamp
+	// with one lock of the heap, so that a big chord costs no more locking
+	// than a single note.  The list is static so that its capacity persists.
+
+	static vector<heap::DueNote> dueNotes;
+	dueNotes.clear();
+	rtHeap->extractDue(bufEndSamp, dueNotes);
+
+	// Immediate notes due in this buffer join them at their exact frame (or
+	// at its start, if their stamp has passed); later ones wait in the heap.
+	Instrument *immediate;
+	FRAMETYPE immediateStart;
+	while (sImmediateNotes.take(&immediate, &immediateStart)) {
+		if (immediateStart >= bufEndSamp)
+			rtHeap->insert(immediate, immediateStart);
+		else
+			dueNotes.push_back(heap::DueNote(max(immediateStart, bufStartSamp), immediate));
+	}
+
 	FRAMETYPE heapChunkStart = 0;
 	Instrument *Iptr;
     const BusSlot *iBus;
+	sLimitedVoicesGathered = false;
 
-	while ((Iptr = rtHeap->deleteMin(bufEndSamp, &heapChunkStart)) != NULL) {
+	for (size_t due = 0; due < dueNotes.size(); ++due) {
+		heapChunkStart = dueNotes[due].first;
+		Iptr = dueNotes[due].second;
 #ifdef IBUG
 		RTPrintf("Iptr %p pulled from rtHeap (size %d) with heapChunkStart = %lld\n", Iptr, rtHeap->getSize(), (long long)heapChunkStart);
 #endif
@@ -229,6 +670,12 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 			continue;
 		}
 
+		// A frozen bus plays a recording in place of this note
+		if (Iptr->frozen()) {
+			Iptr->unref();
+			continue;
+		}
+
 		// Because we know this instrument will be run during this slot,
 		// perform final configuration on it if we are not interactive.
 		// (If interactive, this is handled at init() time).
@@ -237,7 +684,7 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 #ifdef ALLBUG
 			RTPrintf("Calling configure()\n");
 #endif
-			if (Iptr->configure(frameCount) != 0) {
+			if (Iptr->configureOnce(frameCount) != 0) {
 #ifdef DBUG
 				rtcmix_warn(NULL, "Inst configure error: Iptr %p unref'd", Iptr);
 #endif
@@ -246,10 +693,14 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 			}
 		}
 
+		// Make room for it under its class's voice limit, if any
+		if (Polyphony::active())
+			limitVoices(Iptr, heapChunkStart);
+
         iBus = Iptr->getBusSlot();
 
 		// DJT Now we push things onto different queues
-		::pthread_mutex_lock(&bus_slot_lock);
+		// (a note's BusSlot never changes once published, so no lock)
 		IBusClass bus_class = iBus->Class();
 		switch (bus_class) {
 		case TO_AUX:
@@ -314,7 +765,6 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 			rterror("intraverse", "unknown bus_class");
 			break;
 		}
-		::pthread_mutex_unlock(&bus_slot_lock);
 	}
 	// End rtHeap popping and rtQueue insertion ----------------------------
 
@@ -324,13 +774,297 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 	Bool aux_pb_done = NO;
 	int rtQSize = 0, allQSize = 0;
     FRAMETYPE rtQchunkStart = 0;
+	bool instrumentFound = false;
 #ifdef MULTI_THREAD
-	vector<Instrument *>instruments;
-	instruments.reserve(busCount);
+	// rtQueue[] playback, one level at a time ++++++++++++++++++++++++++++++
+	// These are static so that their capacity persists across calls and we
+	// do not allocate on every buffer once the high-water mark is reached.
+	static vector<short> levelBuses;
+	static vector<Instrument *> levelInstruments;
+	static vector<short> levelInstrumentBuses;
+	static vector<InstrumentJob> jobPool;
+	static vector<InstrumentJob *> jobs;
+	static vector<InstrumentJob *> jobOrder;
+	static vector<InstrumentBatch> batches;
+	static vector<double> workerLoads;
+	static InstrumentJobTable jobTable;
+	short auxLevel = 0;
+
+	while (!aux_pb_done) {
+		const long long passStart = (DSPStats::enabled() || SchedTrace::active()) ? DSPStats::now() : 0;
+		// Collect the buses for the next level
+		levelBuses.clear();
+		switch (qStatus) {
+		case TO_AUX:
+			bus_q_offset = 0;
+			bus_type = BUS_AUX_OUT;
+			::pthread_mutex_lock(&to_aux_lock);
+			for (i = 0; i < busCount && ToAuxPlayList[i] != -1; ++i)
+				levelBuses.push_back(ToAuxPlayList[i]);
+			::pthread_mutex_unlock(&to_aux_lock);
+			break;
+		case AUX_TO_AUX:
+			{
+				bus_q_offset = busCount;
+				bus_type = BUS_AUX_OUT;
+				short nextLevel = auxLevel;
+				::pthread_mutex_lock(&aux_to_aux_lock);
+				for (i = 0; i < busCount && AuxToAuxPlayList[i] != -1; ++i) {
+					const short level = BusConfigs[AuxToAuxPlayList[i]].PlayLevel;
+					if (level > auxLevel && (nextLevel == auxLevel || level < nextLevel))
+						nextLevel = level;
+				}
+				if (nextLevel > auxLevel) {
+					for (i = 0; i < busCount && AuxToAuxPlayList[i] != -1; ++i) {
+						if (BusConfigs[AuxToAuxPlayList[i]].PlayLevel == nextLevel)
+							levelBuses.push_back(AuxToAuxPlayList[i]);
+					}
+				}
+				::pthread_mutex_unlock(&aux_to_aux_lock);
+				auxLevel = nextLevel;
+			}
+			break;
+		case TO_OUT:
+			bus_q_offset = busCount*2;
+			bus_type = BUS_OUT;
+			::pthread_mutex_lock(&to_out_lock);
+			for (i = 0; i < busCount && ToOutPlayList[i] != -1; ++i)
+				levelBuses.push_back(ToOutPlayList[i]);
+			::pthread_mutex_unlock(&to_out_lock);
+			break;
+		default:
+			rterror("intraverse", "unknown bus_class");
+			break;
+		}
+#ifdef BBUG
+		printf("qStatus %d aux level %d: %d buses\n", qStatus, auxLevel, (int) levelBuses.size());
 #endif
-	bool instrumentFound = false;
+
+		// Pop every instrument due in this slice off the level's rtQueues
+		levelInstruments.clear();
+		levelInstrumentBuses.clear();
+		for (vector<short>::const_iterator bit = levelBuses.begin(); bit != levelBuses.end(); ++bit) {
+			bus = *bit;
+			busq = bus+bus_q_offset;
+			while (rtQueue[busq].getSize() > 0 && rtQueue[busq].nextChunk() < bufEndSamp) {
+				int chunksamps = 0;
+				instrumentFound = true;
+
+				Iptr = rtQueue[busq].pop(&rtQchunkStart);  // get next instrument off queue
+#ifdef IBUG
+				printf("Iptr %p popped from rtQueue[%d] at rtQchunkStart %lld\n", Iptr, busq, rtQchunkStart);
+#endif
+				// DS ADDED
+				assert(rtQchunkStart > 0 || bufStartSamp == 0);
+				Iptr->set_ichunkstart(rtQchunkStart);
+
+				FRAMETYPE endsamp = Iptr->getendsamp();
+
+				// difference in sample start (countdown)
+				int offset = int(rtQchunkStart - bufStartSamp);
+
+				if (offset < 0) { // BGG: added this trap for robustness
+#ifndef EMBEDDED
+					rtcmix_warn(NULL, "the scheduler is behind the queue!");
+					rtcmix_debug(NULL, "bufStartSamp:  %ld, endsamp:  %ld",
+					             (long)bufStartSamp, (long)endsamp);
+#endif
+					endsamp += offset;  // DJT:  added this (with hope)
+					offset = 0;
+				}
+
+				Iptr->set_output_offset(offset);
+
+				const bool aligned = Iptr->rendersAlignedBlocks();
+				if (aligned) {
+					// A whole block from the instrument's own start; addout
+					// mixes whatever runs past bufEndSamp into the next buffer.
+					chunksamps = frameCount;
+				}
+				else if (endsamp < bufEndSamp) {  // compute # of samples to write
+					chunksamps = int(endsamp-rtQchunkStart);
+				}
+				else {
+					chunksamps = int(bufEndSamp-rtQchunkStart);
+				}
+				if (chunksamps > frameCount) {
+#ifndef EMBEDDED
+					printf("ERROR: chunksamps is %ld - limiting to %ld\n", (long)chunksamps, (long)frameCount);
+#endif
+					chunksamps = frameCount;
+				}
+				Iptr->setchunk(chunksamps);  // set "chunksamps"
+				if (aligned)
+					noteAlignedBlock(rtQchunkStart + chunksamps, endsamp);
+
+				// DT_PANIC_MOD: in panic mode the instrument is just dropped
+				if (!panic) {
+					levelInstruments.push_back(Iptr);
+					levelInstrumentBuses.push_back(bus);
+				}
+			}
+		}
+
+		// Group them into one job per instrument, and run the jobs
+		jobs.clear();
+		if (!levelInstruments.empty()) {
+			const int count = (int) levelInstruments.size();
+			int jobCount = 0;
+			jobTable.reserve(count);
+			for (int n = 0; n < count; ++n) {
+				Iptr = levelInstruments[n];
+				int &jobIndex = jobTable.lookup(Iptr);
+				if (jobIndex < 0) {
+					jobIndex = jobCount++;
+					if ((int) jobPool.size() < jobCount)
+						jobPool.resize(jobCount);
+					InstrumentJob &job = jobPool[jobIndex];
+					job.inst = Iptr;
+					job.busType = bus_type;
+					job.buses.clear();
+				}
+				jobPool[jobIndex].buses.push_back(levelInstrumentBuses[n]);
+			}
+			jobTable.clear();
+			// jobPool is done growing, so these pointers stay valid
+			const int workers = taskManager->threadCount();
+			double knownCost = 0.0;
+			for (int n = 0; n < jobCount; ++n) {
+				InstrumentJob &job = jobPool[n];
+				const double frameCost = job.inst->runCost();
+				job.cost = (frameCost > 0.0) ? frameCost * job.inst->framesToRun()
+											 : UNKNOWN_TASK_COST;
+				if (frameCost > 0.0)
+					knownCost += job.cost;
+				jobs.push_back(&job);
+			}
+			jobOrder.assign(jobs.begin(), jobs.end());
+			std::sort(jobOrder.begin(), jobOrder.end(), costlier);
+			// Batch the small jobs only when there are more than enough
+			// tasks to go around.
+			const double share = knownCost / workers;
+			double minCost = 0.0;
+			if (jobCount > workers)
+				minCost = std::min(MIN_TASK_COST, share / 4);
+			batches.clear();
+			InstrumentJob * const *order = &jobOrder[0];
+			for (int n = 0; n < jobCount; ) {
+				const int first = n;
+				double cost = 0.0;
+				do {
+					cost += order[n]->cost;
+					++n;
+				} while (n < jobCount && cost < minCost && order[first]->cost < minCost);
+				InstrumentBatch batch = { order + first, order + n, cost };
+				batches.push_back(batch);
+			}
+			workerLoads.assign(workers, 0.0);
+			const double limit = share * 1.25;
+			for (vector<InstrumentBatch>::iterator it = batches.begin(); it != batches.end(); ++it) {
+				// An untimed note is taken as a full share (at least 1 nsec,
+				// so that several of them are still spread out).
+				const double cost = (it->cost >= UNKNOWN_TASK_COST) ? std::max(share, 1.0) : it->cost;
+				int worker = (*it->first)->inst->preferredWorker();
+				if (worker < 0 || worker >= workers
+						|| (workerLoads[worker] > 0.0 && workerLoads[worker] + cost > limit)) {
+					worker = 0;
+					for (int w = 1; w < workers; ++w)
+						if (workerLoads[w] < workerLoads[worker])
+							worker = w;
+				}
+				workerLoads[worker] += cost;
+#ifdef IBUG
+				printf("putting %d inst(s) into taskmgr for thread %d (bus_type %d) [%s]\n",
+					   (int) (it->last - it->first), worker, bus_type, (*it->first)->inst->name());
+#endif
+				if (it->last - it->first == 1)
+					taskManager->addTaskFor<InstrumentJob, int, &InstrumentJob::exec>(*it->first, worker);
+				else
+					taskManager->addTaskFor<InstrumentBatch, int, &InstrumentBatch::exec>(&*it, worker);
+			}
+#if defined(DBUG) || defined(IBUG)
+			printf("waiting for %d instrument tasks...", (int) jobs.size());
+#endif
+			taskManager->waitForTasks(jobs);
+			RTcmix::mixToBus();
+#if defined(DBUG) || defined(IBUG)
+			printf("done waiting\n");
+#endif
+		}
+
+		// Push each instrument back onto the rtQueues it played from, or
+		// destroy it.
+		for (vector<InstrumentJob *>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+			InstrumentJob *job = *it;
+			Iptr = job->inst;
+			int chunksamps = Iptr->framesToRun();
+			FRAMETYPE endsamp = Iptr->getendsamp();
+			int inst_chunk_finished = Iptr->needsToRun();
+
+			rtQchunkStart = Iptr->get_ichunkstart();    // We stored this value before placing into the job
+			const FRAMETYPE renderEnd = Iptr->rendersAlignedBlocks() ? rtQchunkStart+chunksamps : bufEndSamp;
+
+			// ReQueue or unref ++++++++++++++++++++++++++++++++++++++++++++++
+			if (endsamp > renderEnd) {
+				for (vector<short>::const_iterator bit = job->buses.begin(); bit != job->buses.end(); ++bit) {
+#ifdef IBUG
+					printf("re-queueing inst %p on rtQueue[%d] because its endsamp %lld > bufEndSamp %lld\n", Iptr, *bit+bus_q_offset, endsamp, bufEndSamp);
+#endif
+					rtQueue[*bit+bus_q_offset].push(Iptr,rtQchunkStart+chunksamps);   // put back onto queue
+				}
+			}
+			else {
+				iBus = Iptr->getBusSlot();
+				// unref only after all buses have played -- i.e., if inst_chunk_finished.
+				// if not unref'd here, it means the inst still needs to run on another bus.
+				if (qStatus == iBus->Class() && inst_chunk_finished) {
+#ifdef IBUG
+					printf("unref'ing inst %p\n", Iptr);
+#endif
+					Iptr->unref();
+					Iptr = NULL;
+				}
+			}  // end rtQueue or unref ----------------------------------------
+		}
+		for (vector<short>::const_iterator bit = levelBuses.begin(); bit != levelBuses.end(); ++bit)
+			allQSize += rtQueue[*bit+bus_q_offset].getSize();
+		if (passStart != 0) {
+			const long long passEnd = DSPStats::now();
+			if (DSPStats::enabled())
+				DSPStats::add(passCategory(qStatus), passEnd - passStart);
+			if (SchedTrace::active() && !levelBuses.empty())
+				SchedTrace::record(passNames[passCategory(qStatus)], passStart, passEnd,
+								   (int) levelBuses.size());
+		}
+
+		// Move on to the next level.  AUX_TO_AUX repeats until it finds no
+		// more buses.
+		switch (qStatus) {
+		case TO_AUX:
+			qStatus = AUX_TO_AUX;
+			break;
+		case AUX_TO_AUX:
+			if (levelBuses.empty())
+				qStatus = TO_OUT;
+			break;
+		case TO_OUT:
+#ifdef BBUG
+			printf("aux_pb_done\n");
+#endif
+			aux_pb_done = YES;
+			break;
+		default:
+			rterror("intraverse", "unknown bus_class");
+			aux_pb_done = YES;
+			break;
+		}
+	}  // end while (!aux_pb_done) --------------------------------------------------
+
+#else   // MULTI_THREAD
 	// rtQueue[] playback shuffling ++++++++++++++++++++++++++++++++++++++++
 	while (!aux_pb_done) {
+		const IBusClass passClass = qStatus;
+		const long long passStart = (DSPStats::enabled() || SchedTrace::active()) ? DSPStats::now() : 0;
 		switch (qStatus) {
 		case TO_AUX:
 			bus_q_offset = 0;
@@ -407,146 +1141,6 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 		printf("bus: %d  busq: %d\n", bus, busq);
 #endif
         
-#ifdef MULTI_THREAD
-		if (bus != -1) {
-#if defined(BBUG)
-			printf("\nAdding instruments for current slice [end = %.3f ms] and bus [%d]\n",
-				   1000 * bufEndSamp/sr(), busq);
-#endif
-		}
-		else {
-#if defined(BBUG) || defined(DEBUG)
-			printf("\nDone with bus type %d -- continuing\n", bus_type);
-#endif
-			continue;
-		}
-		// Play elements on queue (insert back in if needed) ++++++++++++++++++
-		while (rtQSize > 0 && rtQchunkStart < bufEndSamp) {
-			int chunksamps = 0;
-			instrumentFound = true;
-			
-			Iptr = rtQueue[busq].pop(&rtQchunkStart);  // get next instrument off queue
-#ifdef IBUG
-            printf("Iptr %p popped from rtQueue[%d] at rtQchunkStart %lld\n", Iptr, busq, rtQchunkStart);
-#endif			
-			Iptr->set_ichunkstart(rtQchunkStart);
-
-			FRAMETYPE endsamp = Iptr->getendsamp();
-
-			// difference in sample start (countdown)
-			int offset = int(rtQchunkStart - bufStartSamp);
-
-			// DJT:  may have to expand here.  IE., conditional above
-			// (rtQchunkStart >= bufStartSamp)
-			// unlcear what that will do just now
-			if (offset < 0) { // BGG: added this trap for robustness
-#ifndef EMBEDDED
-                printf("WARNING: the scheduler is behind the queue!\n");
-                printf("bufStartSamp:  %ld\n", (long)bufStartSamp);
-                printf("endsamp:  %ld\n", (long)endsamp);
-#endif
-				endsamp += offset;  // DJT:  added this (with hope)
-				offset = 0;
-			}
-
-			Iptr->set_output_offset(offset);
-
-			if (endsamp < bufEndSamp) {  // compute # of samples to write
-				chunksamps = int(endsamp-rtQchunkStart);
-			}
-			else {
-				chunksamps = int(bufEndSamp-rtQchunkStart);
-			}
-			if (chunksamps > frameCount) {
-#ifndef EMBEDDED
-                printf("ERROR: chunksamps is %ld - limiting to %ld\n", (long)chunksamps, (long)frameCount);
-#endif
-				chunksamps = frameCount;
-			}
-#ifdef DBUG
-            printf("Begin playback iteration==========\n");
-            printf("bufEndSamp:  %ld\n", (long)bufEndSamp);
-            printf("frameCount:  %ld\n", (long)frameCount);
-            printf("endsamp:  %ld\n", (long)endsamp);
-            printf("offset:  %ld\n", (long)offset);
-            printf("chunksamps:  %ld\n", (long)chunksamps);
-#endif
-			Iptr->setchunk(chunksamps);  // set "chunksamps"		 
-						
-			// DT_PANIC_MOD
-			if (!panic) {
-#ifdef IBUG
-                printf("putting inst %p into taskmgr (bus_type %d) [%s]\n", Iptr, bus_type, Iptr->name());
-#endif
-				instruments.push_back(Iptr);
-				taskManager->addTask<Instrument, int, BusType, int, &Instrument::exec>(Iptr, bus_type, bus);
-			}
-            else { // DT_PANIC_MOD ... just keep on incrementing endsamp
-				endsamp += chunksamps;
-            }
-			rtQSize = rtQueue[busq].getSize();
-		}	// while (rtQSize > 0 && rtQchunkStart < bufEndSamp)
-
-		if (!instruments.empty()) {
-#if defined(DBUG) || defined(IBUG)
-			printf("Done adding instruments for current slice\n");
-			printf("waiting for %d instrument tasks...", (int) instruments.size());
-#endif
-			taskManager->waitForTasks(instruments);
-        	RTcmix::mixToBus();
-#if defined(DBUG) || defined(IBUG)
-            printf("done waiting\n");
-#endif
-#if defined(IBUG)
-			printf("Re-queuing instruments\n");
-#endif
-		}
-        // Iterate instrument list, either pushing elements back onto rtQueues
-        // or destroying them.  rtQueue is unsorted until all pushes are complete.
-		for (vector<Instrument *>::iterator it = instruments.begin(); it != instruments.end(); ++it) {
-			Iptr = *it;
-			int chunksamps = Iptr->framesToRun();
-			FRAMETYPE endsamp = Iptr->getendsamp();
-			int inst_chunk_finished = Iptr->needsToRun();
-
-			rtQchunkStart = Iptr->get_ichunkstart();    // We stored this value before placing into the vector
-            
-			// ReQueue or unref ++++++++++++++++++++++++++++++++++++++++++++++
-			if (endsamp > bufEndSamp && !panic) {
-#ifdef IBUG
-                printf("re-queueing inst %p on rtQueue[%d] because its endsamp %lld > bufEndSamp %lld\n", Iptr, busq, endsamp, bufEndSamp);
-#endif
-				rtQueue[busq].pushUnsorted(Iptr,rtQchunkStart+chunksamps);   // put back onto queue
-			}
-			else {
-				iBus = Iptr->getBusSlot();
-				// unref only after all buses have played -- i.e., if inst_chunk_finished.
-				// if not unref'd here, it means the inst still needs to run on another bus.
-				if (qStatus == iBus->Class() && inst_chunk_finished) {
-#ifdef IBUG
-                    printf("unref'ing inst %p\n", Iptr);
-#endif
-					Iptr->unref();
-					Iptr = NULL;
-				}
-			}  // end rtQueue or unref ----------------------------------------
-			
-			rtQSize = rtQueue[busq].getSize();
-			if (rtQSize) {
-				allQSize += rtQSize;
-			}
-#ifdef DBUG
-            printf("rtQSize: %ld\n", (long)rtQSize);
-            printf("rtQchunkStart:  %ld\n", (long)rtQchunkStart);
-            printf("chunksamps:  %ld\n", (long)chunksamps);
-            printf("Iteration done==========\n\n");
-#endif
-		} // end while() [Play elements on queue (insert back in if needed)] -----------
-        rtQueue[busq].sort();
-		instruments.clear();
-	}  // end while (!aux_pb_done) --------------------------------------------------
-
-#else   // MULTI_THREAD
     // Play elements on queue (insert back in if needed) ++++++++++++++++++
     while (rtQSize > 0 && rtQchunkStart < bufEndSamp && bus != -1) {
         int chunksamps = 0;
@@ -567,9 +1161,9 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
         // unlcear what that will do just now
         if (offset < 0) { // BGG: added this trap for robustness
 #ifndef EMBEDDED
-            printf("WARNING: the scheduler is behind the queue!\n");
-            printf("bufStartSamp:  %ld\n", (long)bufStartSamp);
-            printf("endsamp:  %ld\n", (long)endsamp);
+            rtcmix_warn(NULL, "the scheduler is behind the queue!");
+            rtcmix_debug(NULL, "bufStartSamp:  %ld, endsamp:  %ld",
+                         (long)bufStartSamp, (long)endsamp);
 #endif
             endsamp += offset;  // DJT:  added this (with hope)
             offset = 0;
@@ -577,7 +1171,13 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
         
         Iptr->set_output_offset(offset);
         
-        if (endsamp < bufEndSamp) {  // compute # of samples to write
+        const bool aligned = Iptr->rendersAlignedBlocks();
+        if (aligned) {
+            // A whole block from the instrument's own start; addout
+            // mixes whatever runs past bufEndSamp into the next buffer.
+            chunksamps = frameCount;
+        }
+        else if (endsamp < bufEndSamp) {  // compute # of samples to write
             chunksamps = int(endsamp-rtQchunkStart);
         }
         else {
@@ -598,6 +1198,8 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
         printf("chunksamps:  %ld\n", (long)chunksamps);
 #endif      
         Iptr->setchunk(chunksamps);  // set "chunksamps"		 
+        if (aligned)
+            noteAlignedBlock(rtQchunkStart + chunksamps, endsamp);
         
         int inst_chunk_finished = 0;
         
@@ -606,14 +1208,18 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 #ifdef IBUG
             printf("Iptr->exec(%d, %d) [%s]\n", bus_type, bus, Iptr->name());
 #endif
-            inst_chunk_finished = Iptr->exec(bus_type, bus);    // write the samples * * * * * * * * * 
+            {
+                TraceSpan span(Iptr->name(), bus);
+                inst_chunk_finished = Iptr->exec(bus_type, bus);    // write the samples * * * * * * * * * 
+            }
             endsamp = Iptr->getendsamp();
         }
         else // DT_PANIC_MOD ... just keep on incrementing endsamp
             endsamp += chunksamps;
         
         // ReQueue or unref ++++++++++++++++++++++++++++++++++++++++++++++
-        if (endsamp > bufEndSamp && !panic) {
+        const FRAMETYPE renderEnd = aligned ? rtQchunkStart+chunksamps : bufEndSamp;
+        if (endsamp > renderEnd && !panic) {
 #ifdef IBUG
             printf("re queueing inst %p on rtQueue[%d]\n", Iptr, busq);
 #endif
@@ -646,27 +1252,56 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
         printf("Iteration done==========\n\n");
 #endif
     } // end while() [Play elements on queue (insert back in if needed)] -----------
+	if (passStart != 0) {
+		const long long passEnd = DSPStats::now();
+		if (DSPStats::enabled())
+			DSPStats::add(passCategory(passClass), passEnd - passStart);
+		if (SchedTrace::active() && bus != -1)
+			SchedTrace::record(passNames[passCategory(passClass)], passStart, passEnd, bus);
+	}
 }  // end while (!aux_pb_done) --------------------------------------------------
 
 #endif  // MULTI_THREAD
 
+	// No note is running now, so tables drawn on can take their new values.
+	TablePField::foldDrawn();
+
 #ifdef EMBEDDED
 	// Here is where we now call the "checkers" for Bang, Values, and Print	-- DAS
 	checkForBang();
 	checkForVals();
+	PrintRing::drain();
 	checkForPrint();
+	checkForParsed();
 #endif
 
 	if (panic) {
 		rtsendzeros(device, false);
 	}
 	else if (run_status != RT_SKIP) {
+		if (timeBuffer) {
+			const long long bufferNsec = DSPStats::now() - bufferStart;
+			if (monitorLoad) {
+				const double load = bufferNsec * 1.0e-9 * sr() / frameCount;
+				sliceLoad += (load - sliceLoad) * ((load > sliceLoad) ? 0.5 : 0.05);
+				if (load > peakLoad)
+					peakLoad = load;
+			}
+			if (DSPStats::enabled())
+				DSPStats::endBuffer(bufferNsec, frameCount);
+			if (SchedTrace::active())
+				SchedTrace::record("buffer", bufferStart, bufferStart + bufferNsec,
+								   int(bufStartSamp / frameCount));
+		}
+		BusFreeze::recordBuffer(bufStartSamp, bufEndSamp);
+
         // Write buf to audio device - - - - - - - - - - - - - - - - - - - - -
 #ifdef DBUG
         printf("Writing samples----------\n");
         printf("bufEndSamp:  %ld\n", (long)bufEndSamp);
 #endif
 
+		TraceSpan span("device write");
 		if (rtsendsamps(device) != 0) {
 #ifdef WBUG
 			RTPrintf("EXITING inTraverse() with error\n");
@@ -679,6 +1314,17 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 	bufStartSamp += frameCount;
 	bufEndSamp += frameCount;
 
+	// Lighten the next buffers if this one came too close to the deadline
+	if (monitorLoad) {
+		if (overloadHold > 0)
+			--overloadHold;
+		else if (sliceLoad * 100.0 > RTOption::overloadPercent()) {
+			relieveOverload();
+			++overloadCount;
+			overloadHold = kOverloadHoldBuffers;
+		}
+	}
+
 	// zero the buffers
 	clear_aux_buffers();
 	clear_output_buffers();
@@ -686,7 +1332,10 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 	// read in an input buffer (if audio input is active)
 	if (rtrecord) {
 		if (!panic && run_status != RT_SKIP)
+		{
+			TraceSpan span("device read");
 			rtgetsamps(device);
+		}
 	}
 
 	bool playEm = true;
@@ -708,7 +1357,8 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
     const bool instrumentQueueIsEmpty = rtHeap->getSize() == 0 && allQSize == 0;
 
 	if (!interactive()) {  // Ending condition
-		if (instrumentQueueIsEmpty) {
+		// Also wait until what the last aligned blocks spilled has played
+		if (instrumentQueueIsEmpty && !stillParsing && alignedSpillEnd <= bufStartSamp) {
 #ifdef ALLBUG
 			printf("heapSize:  %ld\n", (long)rtHeap->getSize());
 			printf("rtQSize:  %ld\n", (long)rtQSize);
@@ -745,15 +1395,128 @@ bool RTcmix::inTraverse(AudioDevice *device, void *arg)
 	return playEm;
 }
 
+// Flushing clears out the heap and rtQueues from the audio thread.  Rather
+// than unref every waiting note there at once, which could take longer
+// than a buffer, their contents are traded for those of the flushed set,
+// which only swaps pointers, and the flushed notes are let go of a few per
+// buffer.  The flushed set's arrays then keep their size for the next time.
+
+static long sFlushedNotes = 0;		// references still held by the flushed set
+
 void  RTcmix::resetHeapAndQueue()
 {
-	delete rtHeap;
-	delete [] rtQueue;
-	rtHeap = NULL;
-	rtQueue = NULL;
-	
-	rtHeap = new heap;
-	rtQueue = new RTQueue[busCount*3];
+	reclaimFlushed(-1);		// anything left from the flush before
+	VoicePool::flushed();
+	rtHeap->exchange(*flushedHeap);
+	Instrument *inst;
+	FRAMETYPE startFrame;
+	while (sImmediateNotes.take(&inst, &startFrame))
+		flushedHeap->post(inst, startFrame);
+	sFlushedNotes = flushedHeap->getSize();
+	for (int q = 0; q < busCount*3; ++q) {
+		rtQueue[q].exchange(flushedQueue[q]);
+		sFlushedNotes += flushedQueue[q].getSize();
+	}
+}
+
+bool RTcmix::reclaimFlushed(int maxNotes)
+{
+	Instrument *inst;
+	for (int q = -1; q < busCount*3 && sFlushedNotes > 0; ++q) {
+		while (maxNotes != 0) {
+			inst = (q < 0) ? flushedHeap->takeAny() : flushedQueue[q].takeAny();
+			if (inst == NULL)
+				break;
+			inst->unref();
+			--sFlushedNotes;
+			--maxNotes;
+		}
+	}
+	return sFlushedNotes > 0;
+}
+
+// Called for each note as it goes from rtHeap to the rtQueues, when the
+// score has set a voice limit (see Polyphony.h).  If <inst> puts its class
+// over the limit, release one of the class's voices from <start>.  The notes
+// on the rtQueues are gathered once per buffer, at the first steal, and the
+// notes let in after that are added to them.
+
+static bool quieter(const Instrument *x, const Instrument *y)
+{
+	return x->level() < y->level();
+}
+
+void RTcmix::limitVoices(Instrument *inst, FRAMETYPE start)
+{
+	const int limit = Polyphony::find(inst->name());
+	if (limit < 0)
+		return;
+	const Polyphony::Policy policy = Polyphony::policy(limit);
+	inst->setVoiceLimit(limit, policy == Polyphony::kQuietest);
+	if (Polyphony::addVoice(limit)) {
+		if (!sLimitedVoicesGathered) {
+			sLimitedVoices.clear();
+			for (int q = 0; q < busCount*3; ++q)
+				rtQueue[q].collect(sLimitedVoices);
+			sort(sLimitedVoices.begin(), sLimitedVoices.end());
+			sLimitedVoices.erase(unique(sLimitedVoices.begin(), sLimitedVoices.end()),
+								 sLimitedVoices.end());
+			sLimitedVoicesGathered = true;
+		}
+		Instrument *victim = NULL;
+		for (vector<Instrument *>::const_iterator it = sLimitedVoices.begin();
+			 it != sLimitedVoices.end(); ++it) {
+			Instrument *voice = *it;
+			if (voice->voiceLimit() != limit || voice->releasing())
+				continue;
+			if (victim == NULL
+				|| (policy == Polyphony::kQuietest ? quieter(voice, victim)
+												   : startedEarlier(voice, victim)))
+				victim = voice;
+		}
+		// None found means the count holds notes that have ended but are
+		// not yet destroyed, so there is room after all.
+		if (victim != NULL)
+			victim->release(start, Polyphony::fadeFrames(limit, sr()));
+	}
+	if (sLimitedVoicesGathered)
+		sLimitedVoices.push_back(inst);
+}
+
+// Called under overload between buffers, when every playing instrument is
+// waiting on the rtQueues.  Either end the overload_shed_notes oldest notes
+// at the end of the next buffer, or halve the control rate of all of them.
+
+void RTcmix::relieveOverload()
+{
+	static vector<Instrument *> playing;
+	playing.clear();
+	for (int q = 0; q < busCount*3; ++q)
+		rtQueue[q].collect(playing);
+	// An instrument playing on several buses is queued once for each
+	sort(playing.begin(), playing.end());
+	playing.erase(unique(playing.begin(), playing.end()), playing.end());
+
+	const int shedCount = RTOption::overloadShedNotes();
+	if (shedCount > 0) {
+		stable_sort(playing.begin(), playing.end(), startedEarlier);
+		int shed = 0;
+		for (vector<Instrument *>::iterator it = playing.begin();
+			 it != playing.end() && shed < shedCount; ++it) {
+			if ((*it)->getendsamp() > bufEndSamp) {
+				(*it)->setendsamp(bufEndSamp);
+				++shed;
+			}
+		}
+		rtcmix_debug("intraverse", "overload (%.0f%%): ended %d notes",
+					 sliceLoad * 100.0, shed);
+	}
+	else {
+		for (vector<Instrument *>::iterator it = playing.begin(); it != playing.end(); ++it)
+			(*it)->setSkip((*it)->getSkip() * 2);
+		rtcmix_debug("intraverse", "overload (%.0f%%): lowered control rate of %d notes",
+					 sliceLoad * 100.0, (int) playing.size());
+	}
 }
 
 bool RTcmix::doneTraverse(AudioDevice *device, void *arg)
@@ -767,6 +1530,16 @@ bool RTcmix::doneTraverse(AudioDevice *device, void *arg)
 		RTPrintf("\nclosing...\n");
 	RTPrintf("Output duration: %.2f seconds\n", bufEndSamp / sr());
 	rtreportstats(device);
+	if (RTOption::play() && RTOption::overloadPercent() > 0)
+		RTPrintf("Peak DSP load: %.0f%%, overloads handled: %d\n",
+				 peakLoad * 100.0, overloadCount);
+	if (DSPStats::enabled())
+		DSPStats::print();
+	SchedTrace::finish();
+	if (AllocTracker::active())
+		AllocTracker::print();
+	if (MemStats::enabled())
+		MemStats::print();
 	if (RTOption::print())
 		RTPrintf("\n");
 #endif
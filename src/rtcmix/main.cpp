@@ -27,6 +27,11 @@
 #include "sockdefs.h"
 #include "dbug.h"
 #include "InputFile.h"
+#include "ControlTable.h"
+#include "DSPStats.h"
+#include "AllocTracker.h"
+#include "MemStats.h"
+#include "HostEvents.h"
 #include <MMPrint.h>
 #include "RTcmix_API.h"
 
@@ -99,6 +104,8 @@ main(int argc, char *argv[], char **env)
 
 static RTcmixMain *globalApp;
 
+static void stopParseThread();
+
 void RTcmix_setPrintLevel(int level)
 {
 	RTOption::print(level);
@@ -123,6 +130,7 @@ int
 RTcmix_destroy()
 {
     rtcmix_debug("RTcmix_destroy", "deleting main object");
+	stopParseThread();
 	delete globalApp;
 	globalApp = NULL;
 	return 0;
@@ -138,22 +146,17 @@ RTcmix_setBangCallback(RTcmixBangCallback inBangCallback, void *inContext)
 	sBangCallbackContext = inContext;
 }
 
-int bang_ready = 0;
-
-// This is called from inTraverse
+// This is called from inTraverse.  Instruments post bangs and values with
+// HostEvents, from any thread; at most one of each reaches the host per call.
 
 void checkForBang()
-{  
-	if (bang_ready == 1) {
-		bang_ready = 0;
-		if (sBangCallback != NULL) {
-			sBangCallback(sBangCallbackContext);
-		}
-	}
+{
+	if (HostEvents::takeBang() && sBangCallback != NULL)
+		sBangCallback(sBangCallbackContext);
 }
 
 static RTcmixValuesCallback sValuesCallback = NULL;
-static float sValuesArray[1024];
+static float sValuesArray[HostEvents::kMaxValues];
 static void *sValuesCallbackContext;
 
 void
@@ -163,22 +166,13 @@ RTcmix_setValuesCallback(RTcmixValuesCallback inValuesCallback, void *inContext)
 	sValuesCallbackContext = inContext;
 }
 
-int vals_ready = 0;
-float maxmsp_vals[MAXDISPARGS];
-
 // This is called from inTraverse
 
 void checkForVals()
-{  
-	if (vals_ready > 0) { // vals_ready will contain how many vals to return
-		int nVals = vals_ready;
-		vals_ready = 0;
-		// Copy into local static array.  This is what gets handed to callback.
-		for (int i = 0; i < nVals; i++) sValuesArray[i] = maxmsp_vals[i];
-		if (sValuesCallback) {
-			sValuesCallback(sValuesArray, nVals, sValuesCallbackContext);
-		}
-	}
+{
+	const int nVals = HostEvents::takeValues(sValuesArray);
+	if (nVals > 0 && sValuesCallback)
+		sValuesCallback(sValuesArray, nVals, sValuesCallbackContext);
 }
 
 static RTcmixPrintCallback sPrintCallback = NULL;
@@ -245,9 +239,16 @@ extern "C" int embedded_parse_score(const char *caller, char *thebuf, int buflen
 
 // BGG mm -- set this to accept a buffer from max/msp or other embedded systems
 
+// Held while parsing, since the parser may be run from the host's thread
+// and from the parse thread below.
+
+static pthread_mutex_t sParseLock = PTHREAD_MUTEX_INITIALIZER;
+
 int RTcmix_parseScore(char *theBuf, int buflen)
 {
+    pthread_mutex_lock(&sParseLock);
     int status = embedded_parse_score("RTcmix_parseScore", theBuf, buflen);
+    pthread_mutex_unlock(&sParseLock);
 #if defined(EMBEDDEDAUDIO)
     if (!globalApp->interactive() && status != 0) {
         // If there was an error, flush messages.
@@ -257,6 +258,187 @@ int RTcmix_parseScore(char *theBuf, int buflen)
     return status;
 }
 
+// Notes parsed here are stamped with the frame <frameOffset> into the next
+// buffer to be rendered, which is the first frame of the host's next block
+// when called between RTcmix_runAudio() calls, and go to the audio thread
+// without passing through the heap.
+
+int RTcmix_parseScoreAt(char *theBuf, int buflen, int frameOffset)
+{
+    if (frameOffset < 0)
+        frameOffset = 0;
+    pthread_mutex_lock(&sParseLock);
+    RTcmix::setNoteStamp(frameOffset);
+    int status = embedded_parse_score("RTcmix_parseScoreAt", theBuf, buflen);
+    RTcmix::setNoteStamp(-1);
+    pthread_mutex_unlock(&sParseLock);
+#if defined(EMBEDDEDAUDIO)
+    if (!globalApp->interactive() && status != 0)
+        checkForPrint();
+#endif
+    return status;
+}
+
+// RTcmix_parseScoreAsync() copies each buffer onto a queue, and a thread
+// of our own parses them in order, so that a long score does not hold up
+// the host's scheduler.  What they schedule goes through the heap's inbox
+// as usual.  Each parse's status is passed back through a ring that
+// inTraverse empties, and handed to the parse callback from there, like
+// bangs and prints.
+
+struct ParseRequest {
+	char *			text;
+	int				length;
+	int				id;
+	ParseRequest *	next;
+};
+
+struct ParseResult {
+	int				id;
+	int				status;
+};
+
+#define PARSE_RESULTS 64		// power of 2
+
+static RTcmixParseCallback sParseCallback = NULL;
+static void *sParseCallbackContext = NULL;
+
+static pthread_mutex_t sParseQueueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sParseQueueCond = PTHREAD_COND_INITIALIZER;
+static ParseRequest *sParseQueueHead = NULL;
+static ParseRequest *sParseQueueTail = NULL;
+static pthread_t sParseThread;
+static bool sParseThreadRunning = false;
+static bool sParseThreadQuit = false;
+static int sLastParseID = 0;
+
+// Written by the parse thread, read by inTraverse
+static ParseResult sParseResults[PARSE_RESULTS];
+static volatile unsigned sParseResultsWritten = 0;
+static volatile unsigned sParseResultsRead = 0;
+
+void RTcmix_setParseCallback(RTcmixParseCallback inParseCallback, void *inContext)
+{
+	sParseCallback = inParseCallback;
+	sParseCallbackContext = inContext;
+}
+
+// This is called from inTraverse
+
+void checkForParsed()
+{
+	unsigned readPos = sParseResultsRead;
+	while (readPos != sParseResultsWritten) {
+		__sync_synchronize();
+		const ParseResult &result = sParseResults[readPos & (PARSE_RESULTS - 1)];
+		if (sParseCallback)
+			sParseCallback(result.id, result.status, sParseCallbackContext);
+		++readPos;
+		__sync_synchronize();
+		sParseResultsRead = readPos;
+	}
+}
+
+static void postParseResult(int id, int status)
+{
+	// If inTraverse is not keeping up (or not running), wait for room
+	// rather than lose a result.
+	while (sParseResultsWritten - sParseResultsRead == PARSE_RESULTS && !sParseThreadQuit)
+		usleep(1000);
+	ParseResult &result = sParseResults[sParseResultsWritten & (PARSE_RESULTS - 1)];
+	result.id = id;
+	result.status = status;
+	__sync_synchronize();
+	++sParseResultsWritten;
+}
+
+static void *parseThreadProcess(void *)
+{
+	pthread_mutex_lock(&sParseQueueLock);
+	while (!sParseThreadQuit) {
+		ParseRequest *request = sParseQueueHead;
+		if (request == NULL) {
+			pthread_cond_wait(&sParseQueueCond, &sParseQueueLock);
+			continue;
+		}
+		sParseQueueHead = request->next;
+		if (sParseQueueHead == NULL)
+			sParseQueueTail = NULL;
+		pthread_mutex_unlock(&sParseQueueLock);
+
+		pthread_mutex_lock(&sParseLock);
+		const int status = embedded_parse_score("RTcmix_parseScoreAsync", request->text, request->length);
+		pthread_mutex_unlock(&sParseLock);
+		rtcmix_debug("parseThreadProcess", "parse %d returned status %d", request->id, status);
+		postParseResult(request->id, status);
+		free(request->text);
+		delete request;
+
+		pthread_mutex_lock(&sParseQueueLock);
+	}
+	pthread_mutex_unlock(&sParseQueueLock);
+	return NULL;
+}
+
+int RTcmix_parseScoreAsync(const char *theBuf, int buflen)
+{
+	ParseRequest *request = new ParseRequest;
+	request->text = (char *) malloc(buflen > 0 ? buflen : 1);
+	if (request->text == NULL) {
+		delete request;
+		return die("RTcmix_parseScoreAsync", "Memory error");
+	}
+	memcpy(request->text, theBuf, buflen);
+	request->length = buflen;
+	request->next = NULL;
+
+	pthread_mutex_lock(&sParseQueueLock);
+	if (!sParseThreadRunning) {
+		sParseThreadQuit = false;
+		if (pthread_create(&sParseThread, NULL, parseThreadProcess, NULL) != 0) {
+			pthread_mutex_unlock(&sParseQueueLock);
+			free(request->text);
+			delete request;
+			return die("RTcmix_parseScoreAsync", "Parse thread create failed");
+		}
+		sParseThreadRunning = true;
+	}
+	request->id = ++sLastParseID;
+	if (sParseQueueTail)
+		sParseQueueTail->next = request;
+	else
+		sParseQueueHead = request;
+	sParseQueueTail = request;
+	pthread_cond_signal(&sParseQueueCond);
+	pthread_mutex_unlock(&sParseQueueLock);
+	return request->id;
+}
+
+// Drop any parses not yet started, and wait for the one under way.
+
+static void stopParseThread()
+{
+	pthread_mutex_lock(&sParseQueueLock);
+	if (!sParseThreadRunning) {
+		pthread_mutex_unlock(&sParseQueueLock);
+		return;
+	}
+	sParseThreadQuit = true;
+	while (sParseQueueHead) {
+		ParseRequest *request = sParseQueueHead;
+		sParseQueueHead = request->next;
+		free(request->text);
+		delete request;
+	}
+	sParseQueueTail = NULL;
+	pthread_cond_signal(&sParseQueueCond);
+	pthread_mutex_unlock(&sParseQueueLock);
+	if (pthread_join(sParseThread, NULL) != 0)
+		rterror("RTcmix_destroy", "Parse thread join failed");
+	sParseThreadRunning = false;
+	sParseResultsWritten = sParseResultsRead = 0;
+}
+
 #ifdef IOS
 
 int RTcmix_startAudio()
@@ -311,6 +493,8 @@ int RTcmix_setparams(float sr, int nchans, int vecsize, int recording, int bus_c
 
 #ifdef EMBEDDEDAUDIO
 
+static bool sPlanarAudioFormat = false;		// for RTcmix_runAudioPlanar()
+
 int RTcmix_setAudioBufferFormat(RTcmix_AudioFormat format, int nchans)
 {
 	int rtcmix_fmt = 0;
@@ -331,10 +515,19 @@ int RTcmix_setAudioBufferFormat(RTcmix_AudioFormat format, int nchans)
 			rtcmix_fmt = NATIVE_FLOAT_FMT;
 			rtcmix_fmt |= MUS_NORMALIZED;
 			break;
+		case AudioFormat_32BitFloat_NonInterleaved:
+			sPlanarAudioFormat = true;
+			rtcmix_fmt = NATIVE_FLOAT_FMT | MUS_NON_INTERLEAVED;
+			return SetEmbeddedCallbackAudioFormat(rtcmix_fmt, nchans);
+		case AudioFormat_32BitFloat_NonInterleaved_Normalized:
+			sPlanarAudioFormat = true;
+			rtcmix_fmt = NATIVE_FLOAT_FMT | MUS_NORMALIZED | MUS_NON_INTERLEAVED;
+			return SetEmbeddedCallbackAudioFormat(rtcmix_fmt, nchans);
 		default:
 			return die("RTcmix_setAudioBufferFormat", "Unknown format");
 	}
-	// For now, only interleaved audio is allowed.
+	// Other than the above, only interleaved audio is allowed.
+	sPlanarAudioFormat = false;
 	rtcmix_fmt |= MUS_INTERLEAVED;
 	return SetEmbeddedCallbackAudioFormat(rtcmix_fmt, nchans);
 }
@@ -349,6 +542,13 @@ int RTcmix_runAudio(void *inAudioBuffer, void *outAudioBuffer, int nframes)
 	return globalApp->runAudio(inAudioBuffer, outAudioBuffer, nframes);
 }
 
+int RTcmix_runAudioPlanar(float **inputs, float **outputs, int nframes)
+{
+	if (!sPlanarAudioFormat)
+		return die("RTcmix_runAudioPlanar", "Audio buffer format is not non-interleaved");
+	return globalApp->runAudio(inputs, outputs, nframes);
+}
+
 #endif
 
 // these are set from inlets on the rtcmix~ object, using PFields to
@@ -356,19 +556,34 @@ int RTcmix_runAudio(void *inAudioBuffer, void *outAudioBuffer, int nframes)
 // rtcmix~ is set to constrain up to a max of 19 inlets for PFields
 // iRTCmix can handle up to MAX_INLETS - DAS
 
-float gInletValues[MAX_INLETS];		// used by RTInlinePField.cpp
-
 // New name
 void RTcmix_setPField(int inlet, float pval)
 {
 	if (inlet <= MAX_INLETS) {
-		gInletValues[inlet-1] = pval;
+		ControlTable::write(ControlTable::inletSlot(inlet), pval);	// read by RTInletPField
 	}
 	else {
 		die("RTcmix_setPField", "exceeded max inlet count [%d]", MAX_INLETS);
 	}
 }
 
+// For hosts that send all their inlets every tick.  Most values are the same
+// as the last time, and reading a slot is much cheaper than writing one (which
+// also tells every PField reading it that it has changed).
+
+int RTcmix_setPFields(const float *vals, int first, int count)
+{
+	if (first < 1 || first + count - 1 > MAX_INLETS)
+		return die("RTcmix_setPFields", "inlets %d to %d out of range [1, %d]",
+				   first, first + count - 1, MAX_INLETS);
+	for (int n = 0; n < count; ++n) {
+		const int slot = ControlTable::inletSlot(first + n);
+		if (ControlTable::read(slot) != vals[n])
+			ControlTable::write(slot, vals[n]);
+	}
+	return 0;
+}
+
 void pfield_set(int inlet, float pval) { RTcmix_setPField(inlet, pval); }	// UNTIL WE REMOVE THIS FROM IOS VERSION
 
 // This allows a float audio buffer to be directly loaded as input
@@ -408,6 +623,76 @@ int RTcmix_getBufferChannelCount(char *bufname)
 }
 
 
+// returns the counts kept by the dsp_stats option, for a DSP load display
+int RTcmix_getStats(RTcmix_Stats *outStats, char *outReport, int reportLength)
+{
+	if (!DSPStats::enabled())
+		return -1;
+	DSPStats::Totals totals;
+	DSPStats::getTotals(&totals);
+	if (outStats != NULL) {
+		outStats->dspLoad = totals.dspLoad;
+		outStats->peakLoad = totals.peakLoad;
+		outStats->buffers = totals.buffers;
+		outStats->bufferMsec = totals.bufferNsec * 1.0e-6;
+		outStats->instrumentMsec = totals.instrumentNsec * 1.0e-6;
+		outStats->toAuxMsec = totals.nsec[DSPStats::kToAuxPass] * 1.0e-6;
+		outStats->auxToAuxMsec = totals.nsec[DSPStats::kAuxToAuxPass] * 1.0e-6;
+		outStats->toOutMsec = totals.nsec[DSPStats::kToOutPass] * 1.0e-6;
+		outStats->mixdownMsec = totals.nsec[DSPStats::kMixdown] * 1.0e-6;
+		outStats->fileReadMsec = totals.nsec[DSPStats::kFileRead] * 1.0e-6;
+	}
+	if (outReport != NULL)
+		DSPStats::report(outReport, reportLength);
+	return 0;
+}
+
+
+// returns the counts kept by ALLOC_TRACKING builds of allocations on the
+// real-time threads
+int RTcmix_getAllocStats(RTcmix_AllocStats *outStats, char *outReport, int reportLength, int reset)
+{
+#ifdef ALLOC_TRACKING
+	AllocTracker::Totals totals;
+	AllocTracker::getTotals(&totals);
+	if (outStats != NULL) {
+		outStats->allocations = totals.allocations;
+		outStats->buffers = totals.buffers;
+		outStats->worstBuffer = totals.worstBuffer;
+	}
+	if (outReport != NULL)
+		AllocTracker::report(outReport, reportLength);
+	if (reset)
+		AllocTracker::reset();
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+
+// returns the memory held by each part of the system
+int RTcmix_getMemStats(RTcmix_MemStats *outStats, char *outReport, int reportLength)
+{
+	MemStats::Totals totals;
+	MemStats::getTotals(&totals);
+	if (outStats != NULL) {
+		outStats->tableBytes = totals.bytes[MemStats::kTables];
+		outStats->inputBytes = totals.bytes[MemStats::kInputs];
+		outStats->instrumentBytes = totals.bytes[MemStats::kInstruments];
+		outStats->busBytes = totals.bytes[MemStats::kBuses];
+		outStats->mincBytes = totals.bytes[MemStats::kMinc];
+		outStats->totalBytes = totals.totalBytes;
+		outStats->peakTotalBytes = totals.peakTotalBytes;
+		for (int c = 0; c < MemStats::kCategoryCount; ++c)
+			outStats->peakBytes[c] = totals.peakBytes[c];
+	}
+	if (outReport != NULL)
+		MemStats::report(outReport, reportLength);
+	return 0;
+}
+
+
 // called for the [flush] message; deletes and reinstantiates the rtQueue
 // and rtHeap, thus flushing all scheduled events in the future
 void RTcmix_flushScore()
@@ -20,6 +20,7 @@
 #include <prototypes.h>
 #include <ugens.h>
 #include <RTOption.h>
+#include "PrintRing.h"
 #ifdef MAXMSP
 // BGG -- this is how you print to the console.app now in max/msp
 extern void cpost(const char *fmt, ...);
@@ -53,6 +54,108 @@ extern void post(const char *fmt, ...);
    prints no matter what, and then exits after some cleanup.
 */
 
+/* Messages printed on a real-time thread are posted to the PrintRing
+   (see PrintRing.h), which prints them later with rtcmix_show_message().
+*/
+
+static void
+show_debug(const char *inst_name, const char *buf)
+{
+	if (inst_name) {
+		RTPrintf("DEBUG: %s:  %s\n", inst_name, buf);
+#ifdef USE_SYSLOG
+		syslog(LOG_DEBUG, "DEBUG: %s:  %s", inst_name, buf);
+#elif defined(USE_POST)
+		cpost("DEBUG: [%s]:  %s", inst_name, buf);
+#endif
+	}
+	else {
+		RTPrintf("DEBUG: %s\n", buf);
+#ifdef USE_SYSLOG
+		syslog(LOG_DEBUG, "DEBUG: %s", buf);
+#elif defined(USE_POST)
+		cpost("DEBUG: %s", buf);
+#endif
+	}
+}
+
+static void
+show_advise(const char *inst_name, const char *buf)
+{
+   if (inst_name)
+      RTPrintf("%s:  %s\n", inst_name, buf);
+   else
+      RTPrintf("%s\n", buf);
+}
+
+static void
+show_warn(const char *inst_name, const char *buf)
+{
+   if (inst_name) {
+		RTFPrintf(stderr, "\n" PREFIX "WARNING [%s]:  %s\n\n", inst_name, buf);
+#ifdef USE_SYSLOG
+		syslog(LOG_WARNING, PREFIX "WARNING: [%s]:  %s", inst_name, buf);
+#elif defined(USE_POST)
+	   cpost(PREFIX "WARNING: [%s]:  %s", inst_name, buf);
+#endif
+   }
+   else {
+		RTFPrintf(stderr, "\n" PREFIX "WARNING:  %s\n\n", buf);
+#ifdef USE_SYSLOG
+		syslog(LOG_ERR, PREFIX "WARNING: %s", buf);
+#elif defined(USE_POST)
+		cpost(PREFIX "WARNING: %s", buf);
+#endif
+   }
+}
+
+static void
+show_rterror(const char *inst_name, const char *buf)
+{
+	if (inst_name) {
+		RTFPrintf(stderr, PREFIX "ERROR [%s]: %s\n", inst_name, buf);
+#ifdef USE_SYSLOG
+#ifndef IOSDEV
+		fprintf(stderr, PREFIX "ERROR: [%s]:  %s\n", inst_name, buf);
+#endif
+		syslog(LOG_ERR, PREFIX "ERROR: [%s]:  %s", inst_name, buf);
+#elif defined(USE_POST)
+		cpost(PREFIX "ERROR: [%s]:  %s", inst_name, buf);
+#endif
+	}
+	else {
+		RTFPrintf(stderr, PREFIX "ERROR: %s\n", buf);
+#ifdef USE_SYSLOG
+#ifndef IOSDEV
+		fprintf(stderr, PREFIX "ERROR: %s\n", buf);
+#endif
+		syslog(LOG_ERR, PREFIX "ERROR: %s", buf);
+#elif defined(USE_POST)
+		cpost(PREFIX "ERROR: %s", buf);
+#endif
+	}
+}
+
+/* ------------------------------------------------- rtcmix_show_message --- */
+void
+rtcmix_show_message(int level, const char *inst_name, const char *text)
+{
+   switch (level) {
+   case MMP_DEBUG:
+      show_debug(inst_name, text);
+      break;
+   case MMP_ADVISE:
+      show_advise(inst_name, text);
+      break;
+   case MMP_WARN:
+      show_warn(inst_name, text);
+      break;
+   default:
+      show_rterror(inst_name, text);
+      break;
+   }
+}
+
 /* -------------------------------------------------------- rtcmix_debug --- */
 void rtcmix_debug(const char *inst_name, const char *format, ...)
 {
@@ -64,22 +167,10 @@ void rtcmix_debug(const char *inst_name, const char *format, ...)
 		vsnprintf(buf, BUFSIZE, format, args);
 		va_end(args);
 		
-		if (inst_name) {
-			RTPrintf("DEBUG: %s:  %s\n", inst_name, buf);
-#ifdef USE_SYSLOG
-			syslog(LOG_DEBUG, "DEBUG: %s:  %s", inst_name, buf);
-#elif defined(USE_POST)
-			cpost("DEBUG: [%s]:  %s", inst_name, buf);
-#endif
-		}
-		else {
-			RTPrintf("DEBUG: %s\n", buf);
-#ifdef USE_SYSLOG
-			syslog(LOG_DEBUG, "DEBUG: %s", buf);
-#elif defined(USE_POST)
-			cpost("DEBUG: %s", buf);
-#endif
-		}
+		if (PrintRing::deferring())
+			PrintRing::post(MMP_DEBUG, inst_name, buf);
+		else
+			show_debug(inst_name, buf);
 	}
 }
 
@@ -95,10 +186,10 @@ rtcmix_advise(const char *inst_name, const char *format, ...)
       vsnprintf(buf, BUFSIZE, format, args);
       va_end(args);
 
-      if (inst_name)
-         RTPrintf("%s:  %s\n", inst_name, buf);
+      if (PrintRing::deferring())
+         PrintRing::post(MMP_ADVISE, inst_name, buf);
       else
-         RTPrintf("%s\n", buf);
+         show_advise(inst_name, buf);
    }
 }
 
@@ -115,22 +206,10 @@ rtcmix_warn(const char *inst_name, const char *format, ...)
       vsnprintf(buf, BUFSIZE, format, args);
       va_end(args);
 
-	   if (inst_name) {
-			RTFPrintf(stderr, "\n" PREFIX "WARNING [%s]:  %s\n\n", inst_name, buf);
-#ifdef USE_SYSLOG
-			syslog(LOG_WARNING, PREFIX "WARNING: [%s]:  %s", inst_name, buf);
-#elif defined(USE_POST)
-		   cpost(PREFIX "WARNING: [%s]:  %s", inst_name, buf);
-#endif
-	   }
-	   else {
-			RTFPrintf(stderr, "\n" PREFIX "WARNING:  %s\n\n", buf);
-#ifdef USE_SYSLOG
-			syslog(LOG_ERR, PREFIX "WARNING: %s", buf);
-#elif defined(USE_POST)
-			cpost(PREFIX "WARNING: %s", buf);
-#endif
-	   }
+      if (PrintRing::deferring())
+         PrintRing::post(MMP_WARN, inst_name, buf);
+      else
+         show_warn(inst_name, buf);
    }
 }
 
@@ -165,28 +244,10 @@ rterror(const char *inst_name, const char *format, ...)
    vsnprintf(buf, BUFSIZE, format, args);
    va_end(args);
 
-	if (inst_name) {
-		RTFPrintf(stderr, PREFIX "ERROR [%s]: %s\n", inst_name, buf);
-#ifdef USE_SYSLOG
-#ifndef IOSDEV
-		fprintf(stderr, PREFIX "ERROR: [%s]:  %s\n", inst_name, buf);
-#endif
-		syslog(LOG_ERR, PREFIX "ERROR: [%s]:  %s", inst_name, buf);
-#elif defined(USE_POST)
-		cpost(PREFIX "ERROR: [%s]:  %s", inst_name, buf);
-#endif
-	}
-	else {
-		RTFPrintf(stderr, PREFIX "ERROR: %s\n", buf);
-#ifdef USE_SYSLOG
-#ifndef IOSDEV
-		fprintf(stderr, PREFIX "ERROR: %s\n", buf);
-#endif
-		syslog(LOG_ERR, PREFIX "ERROR: %s", buf);
-#elif defined(USE_POST)
-		cpost(PREFIX "ERROR: %s", buf);
-#endif
-	}
+	if (PrintRing::deferring())
+		PrintRing::post(MMP_RTERRORS, inst_name, buf);
+	else
+		show_rterror(inst_name, buf);
 }
 
 /* ------------------------------------------------------------------ die --- */
@@ -226,6 +287,30 @@ die(const char *inst_name, const char *format, ...)
     return DONT_SCHEDULE;
 }
 
+#if !defined(EMBEDDED) || FORCE_EMBEDDED_PRINTF
+/* ------------------------------------------------------- rtcmix_fprintf --- */
+/* What RTPrintf() and RTFPrintf() call outside of embedded builds. */
+int
+rtcmix_fprintf(FILE *stream, const char *format, ...)
+{
+   va_list  args;
+   int      count;
+
+   va_start(args, format);
+   if (PrintRing::deferring()) {
+      char  buf[BUFSIZE * 8];
+      count = vsnprintf(buf, sizeof(buf), format, args);
+      PrintRing::post((stream == stderr) ? PrintRing::kStderr
+                                         : PrintRing::kStdout, NULL, buf);
+   }
+   else
+      count = vfprintf(stream, format, args);
+   va_end(args);
+
+   return count;
+}
+#endif
+
 RTCmixStatus rtOptionalThrow(RTCmixStatus status)
 {
     if (get_bool_option(kOptionBailOnError)) {
@@ -12,6 +12,8 @@
 #include <maxdispargs.h>
 #include <RTOption.h>
 #include "prototypes.h"
+#include "DSPStats.h"
+#include "MemStats.h"
 
 #define ARRAY_SIZE 256
 #define NUM_ARRAYS  32
@@ -417,6 +419,34 @@ double m_print_is_off(double p[], int n_args)
 	return 0.0;
 }
 
+/* Print what the dsp_stats option has counted so far, and return the
+   current DSP load, as a percentage.
+*/
+double m_print_stats(double p[], int n_args)
+{
+	if (!DSPStats::enabled()) {
+		rtcmix_warn("print_stats", "Set the \"%s\" option to collect stats",
+					kOptionDspStats);
+		return 0.0;
+	}
+	DSPStats::print();
+	DSPStats::Totals totals;
+	DSPStats::getTotals(&totals);
+	return totals.dspLoad * 100.0;
+}
+
+/* Print the memory held by tables, inputs, instruments, buses and Minc, and
+   return the total, in megabytes.  Set the memory_stats option to see each
+   instrument class as well.
+*/
+double m_print_mem_stats(double p[], int n_args)
+{
+	MemStats::print();
+	MemStats::Totals totals;
+	MemStats::getTotals(&totals);
+	return totals.totalBytes / 1048576.0;
+}
+
 static struct slist slist[NUM_SPRAY_ARRAYS];
 
 double m_get_spray(double p[], int n_args)
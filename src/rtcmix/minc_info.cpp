@@ -5,6 +5,7 @@
 #include <sfheader.h>
 #include "rtdefs.h"
 #include "InputFile.h"
+#include "HeaderCache.h"
 #include <stdio.h>
 #include <sys/file.h>
 #include <sys/types.h>
@@ -81,6 +82,7 @@ extern "C" {
 	double filepeak(const Arg args[], const int nargs);
 	double filerms(const Arg args[], const int nargs);
 	double filedc(const Arg args[], const int nargs);
+	double sfprescan(const Arg args[], const int nargs);
 };
 
 double filedur(const Arg args[], const int nargs)
@@ -258,6 +260,29 @@ double filedc(const Arg args[], const int nargs)
 	return dc;
 }
 
+// Start reading the headers of the sound files in each directory (or of each
+// file) named, in the background, so that opening them later is quick.
+// Returns the number of files queued.
+
+double sfprescan(const Arg args[], const int nargs)
+{
+	if (nargs < 1) {
+		die("sfprescan", "Usage:  count = sfprescan(\"dir_or_file\"[, ...])");
+		RTExit(PARAM_ERROR);
+	}
+	int count = 0;
+	for (int i = 0; i < nargs; i++) {
+		if (!args[i].isType(StringType)) {
+			die("sfprescan", "Arguments must be directory or file names.");
+			RTExit(PARAM_ERROR);
+		}
+		const int queued = HeaderCache::prescan((const char *) args[i]);
+		if (queued > 0)
+			count += queued;
+	}
+	return double(count);
+}
+
 
 double
 RTcmix::input_chans(double *p, int n_args)   /* returns chans for rtinput() files */
@@ -528,10 +553,7 @@ double bus_exists(const Arg args[], const int nargs)
         RTExit(PARAM_ERROR);
     }
 	int connection = (int)args[0];
-	int is_connected = PFBusData::pfbus_is_connected[connection];
-
-	if (is_connected == 1) return 1.0;
-	else return 0.0;
+	return PFBusData::isConnected(connection) ? 1.0 : 0.0;
 }
 
 
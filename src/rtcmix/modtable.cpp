@@ -97,6 +97,9 @@ _concat_table(PField *intable, const Arg args[], const int nargs)
 //    of slots affected.
 // Both <index> and <value> can be dynamic control sources.
 //
+// Notes reading <table> see each change from the start of the next slice,
+// all at once (see TablePField::draw()).
+//
 // -JGG, 6/18/05
 
 static PField *
@@ -8,6 +8,15 @@
 #include <sys/time.h>
 #include <time.h>
 
+#ifndef EMBEDDED
+/* The standalone utilities link this file without message.cpp, so print
+   directly rather than through rtcmix_fprintf.  Only called from the
+   parsing thread, which never defers its printing anyway.
+*/
+#undef RTPrintf
+#define RTPrintf printf
+#endif
+
 #define MAX_TIME_CHARS  64
 
 /* NOTE: not able to retrieve comment in sndlib version with just sfh */
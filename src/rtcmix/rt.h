@@ -2,13 +2,16 @@
 #define __RT_H__
 
 class Instrument;
+class VoicePool;
 
 typedef Instrument * (*InstCreatorFunction)();
+typedef VoicePool * (*PoolCreatorFunction)();
 
 struct rt_item {
 	struct rt_item *rt_next;
 	InstCreatorFunction rt_ptr;
 	const char *rt_name;
+	PoolCreatorFunction rt_pool;	// NULL unless introduced with RT_INTRO_POOL
 };
 
 extern rt_item *rt_list;
@@ -27,7 +30,18 @@ extern "C" {
 
 #define RT_INTRO(flabel, func) \
 	{ extern Instrument* func(); \
-		static rt_item this_rt = { NULL, func, flabel }; \
+		static rt_item this_rt = { NULL, func, flabel, NULL }; \
+		if (addrtInst(&this_rt) == -1) \
+		  merror(flabel); \
+	}
+
+// For an instrument whose notes can also be played as the voices of a
+// VoicePool made by <poolfunc> (see VoicePool.h).
+
+#define RT_INTRO_POOL(flabel, func, poolfunc) \
+	{ extern Instrument* func(); \
+		extern VoicePool* poolfunc(); \
+		static rt_item this_rt = { NULL, func, flabel, poolfunc }; \
 		if (addrtInst(&this_rt) == -1) \
 		  merror(flabel); \
 	}
@@ -14,6 +14,9 @@ rt_ug_intro()
 	UG_INTRO("bus_config", RTcmix::bus_config);
 	UG_INTRO("rtinput",RTcmix::rtinput);
 	UG_INTRO("rtoutput",RTcmix::rtoutput);
+	UG_INTRO("rtstemoutput",RTcmix::rtstemoutput);
+	UG_INTRO("bus_freeze",RTcmix::bus_freeze);
+	UG_INTRO("set_polyphony",RTcmix::set_polyphony);
 	UG_INTRO("rtoffset",RTcmix::offset);
 	UG_INTRO("CHANS",RTcmix::input_chans);  /* returns channels for rtinput files */
 	UG_INTRO("DUR",RTcmix::input_dur);  /* returns duration for rtinput files */
@@ -11,7 +11,9 @@
 
 Arg::~Arg() {
 	if (_type == ArrayType) {
-		if (_val.array->data)
+		if (_val.array->lease)
+			unrefArrayLease(_val.array->lease);
+		else if (_val.array->data)
 			free(_val.array->data);
 		free(_val.array);
 	}
@@ -43,6 +45,14 @@ Arg & Arg::operator = (const Arg &rhs) {
 			break;
 		case ArrayType:
 			_val.array = (Array *) malloc(sizeof(Array));
+			_val.array->lease = rhs._val.array->lease;
+			if (_val.array->lease) {
+				// Lent memory is shared, not copied.
+				refArrayLease(_val.array->lease);
+				_val.array->data = rhs._val.array->data;
+				_val.array->len = rhs._val.array->len;
+				break;
+			}
 			_val.array->data = (double *) malloc(rhs._val.array->len * sizeof(double));
 			if (_val.array->data != NULL) {
 				memcpy(_val.array->data, rhs._val.array->data, rhs._val.array->len * sizeof(double));
@@ -23,9 +23,23 @@ typedef struct _handle {
    int refcount;
 } *Handle;
 
+// Memory that a front end lends to RTcmix without copying it -- a NumPy
+// array, say -- for as long as anything refers to it.  When the last
+// reference goes, the lease is queued, and <release> is called for it by the
+// next releaseArrayLeases() on the front end's own thread, since the last
+// holder may be a note ending on the audio thread.
+
+typedef struct _arraylease {
+   void (*release)(struct _arraylease *);
+   void *owner;         // the front end's object
+   int refcount;
+   struct _arraylease *next;  // while queued for release
+} ArrayLease;
+
 typedef struct {
    unsigned int len;    // number of elements in <data> array
    double *data;
+   ArrayLease *lease;   // if not NULL, <data> is lent, and is not freed
 } Array;
 
 typedef union {
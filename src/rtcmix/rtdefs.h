@@ -8,6 +8,7 @@
 #endif
 
 #define RESERVE_INPUT_FDS    20  // subtract this from max number of input files
+#define MAX_INPUT_FILES      8192  // least number of input files (see InputFile.h)
 
 #define NO_DEVICE_FDINDEX    -1    /* value for inst fdIndex if unused */
 #define NO_FD                -1    /* this InputFile not in use */
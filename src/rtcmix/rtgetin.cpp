@@ -8,6 +8,7 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <RTcmix.h>
 #include "prototypes.h"
@@ -16,6 +17,7 @@
 #include <Instrument.h>
 #include "BusSlot.h"
 #include "InputFile.h"
+#include "DSPStats.h"
 #include <ugens.h>
 #include <rtdefs.h>
 #include <assert.h>
@@ -118,6 +120,12 @@ RTcmix::readFromAuxBus(
       BufPtr src = aux_buffer[chan];
       assert(src != NULL);
 
+      if (aux_unwritten[chan]) {    /* nothing on this bus */
+         for (int i = n; i < dest_frames * dest_chans; i += dest_chans)
+            dest[i] = 0.0;
+         continue;
+      }
+
       /* The inst might be playing only the last part of a buffer. If so,
          we want it to read the corresponding segment of the aux buffer.
       */
@@ -159,6 +167,33 @@ RTcmix::readFromAudioDevice(
 }
 
 
+/* ---------------------------------------------- RTcmix::inputIsSilent --- */
+/* True if the segment of the listed aux (or audio input) buses an inst would
+   read stays below <threshold>.  Used to let silent notes sleep.
+*/
+bool
+RTcmix::inputIsSilent(
+      bool        fromAudioDevice,
+      const short src_chan_list[],
+      short       src_chans,
+      int         output_offset,
+      int         frames,
+      BUFTYPE     threshold)
+{
+   BufPtr *buffers = fromAudioDevice ? audioin_buffer : aux_buffer;
+   for (int n = 0; n < src_chans; n++) {
+      if (!fromAudioDevice && auxBusIsSilent(src_chan_list[n]))
+         continue;
+      const BufPtr src = buffers[src_chan_list[n]] + output_offset;
+      for (int i = 0; i < frames; i++) {
+         if (src[i] > threshold || src[i] < -threshold)
+            return false;
+      }
+   }
+   return true;
+}
+
+
 /* ---------------------------RTcmix::readFromInputFile [was get_file_in ]--- */
 void
 RTcmix::readFromInputFile(
@@ -168,17 +203,20 @@ RTcmix::readFromInputFile(
       const short src_chan_list[],  /* list of in-bus chan numbers from inst */
       short       src_chans,        /* number of in-bus chans to copy */
       int		  fdIndex,			/* index into input file desc. array */
-	  off_t		  *pFileOffset)		/* ptr to inst's file offset (updated) */
+	  off_t		  *pFileOffset,		/* ptr to inst's file offset (updated) */
+	  InputStream *stream)			/* inst's prefetch stream, or NULL */
 {
     /* File opened by earlier call to rtinput. */
     InputFile &inputFile = inputFileTable[fdIndex];
+    const long long start = DSPStats::enabled() ? DSPStats::now() : 0;
     
     off_t amountRead = inputFile.readSamps(*pFileOffset,
                                            dest,
                                            dest_chans,
                                            dest_frames,
                                            src_chan_list,
-                                           src_chans);
+                                           src_chans,
+                                           stream);
 
    /* Advance saved offset by the number of bytes read.
       Note that this includes samples in channels that were read but
@@ -186,6 +224,8 @@ RTcmix::readFromInputFile(
    */
     if (amountRead > 0)
         *pFileOffset += amountRead;
+    if (start != 0)
+        DSPStats::add(DSPStats::kFileRead, DSPStats::now() - start);
 }
 
 /* -------------------------------------------------------------- rtgetin --- */
@@ -197,29 +237,91 @@ Instrument::rtgetin(float		*inarr,  /* interleaved array of <inputchans> */
         			int			nsamps)         /* samps, not frames */
 {
 	if (inst->hasChainedInput()) {
-		const int chans = inst->inputChannels();
-		const int frames = nsamps / chans;
 #ifdef DEBUG
 		printf("%s::rtgetin(%p): copying from inputChainBuf %p to inarr %p\n", inst->name(), inst, inst->inputChainBuf, inarr);
 #endif
-		// Copy all channels of audio from inputChainBuf, which is a pointer to the output buffer of
-		// the previous instrument in the chain.
-		for (int ch = 0; ch < chans; ++ch) {
-			copy_interleaved_buf_to_buf(
-										inarr,            		/* interleaved dest buffer */
-										inst->inputChainBuf,    /* interleaved source buffer */
-										chans,                /* number of dest chans interleaved */
-										ch,                      /* output chan to copy into */
-										frames,                 /* frames in dest buffer */
-										chans,                /* number of input chans interleaved */
-										ch);                     /* input chan to copy from */
-		}
+		// inputChainBuf is the output buffer of the previous instrument in the chain,
+		// whose channel count setChainedInputBuffer() made sure matches ours.
+		memcpy(inarr, inst->inputChainBuf, nsamps * sizeof(BUFTYPE));
 		return nsamps;
 	}
 	else
 		return inst->rtgetin(inarr, nsamps);
 }
 
+/* ----------------------------------------------------------- rtgetinbuf --- */
+/* Like rtgetin, but returns the input rather than copying it into <inarr>
+   when it is already somewhere else: a chained instrument gets the output
+   buffer of the one before it in the chain, so reading it costs nothing.
+   Otherwise <inarr> is filled as by rtgetin and returned.  Either way the
+   instrument must not write into what it gets back.
+*/
+
+const BUFTYPE *
+Instrument::rtgetinbuf(BUFTYPE *inarr, int nsamps)
+{
+	if (hasChainedInput())
+		return inputChainBuf;
+	rtgetin(inarr, nsamps);
+	return inarr;
+}
+
+/* --------------------------------------------------------- rtgetinchans --- */
+/* For block-based instruments that work on one channel at a time.  Fills in
+   an InputChannel for each of our input channels, pointing at its next
+   <nsamps> / inputChannels() frames.  Aux buses and the audio input buses
+   are read where they are, so live input is neither copied nor interleaved;
+   a silent aux bus, or a channel past those in the bus_config, gives a
+   single zero with a stride of 0.  Chained input is interleaved already,
+   and the channels point into it; input from a file is read into <inarr>
+   as by rtgetin, and they point into that.  Nothing pointed to may be
+   written, and it is good only until this run() returns.
+*/
+
+static const BUFTYPE sSilence = 0.0;
+
+bool Instrument::readsInputInPlace() const
+{
+	return hasChainedInput() || _input.fdIndex == NO_DEVICE_FDINDEX
+			|| RTcmix::isInputAudioDevice(_input.fdIndex);
+}
+
+int Instrument::rtgetinchans(InputChannel chans[], BUFTYPE *inarr, int nsamps)
+{
+	const int inchans = inputChannels();
+
+	if (hasChainedInput() || !readsInputInPlace()) {
+		const BUFTYPE *frames = rtgetinbuf(inarr, nsamps);
+		for (int n = 0; n < inchans; ++n) {
+			chans[n].samps = frames + n;
+			chans[n].stride = inchans;
+		}
+		return nsamps;
+	}
+
+	if (_input.fdIndex != NO_DEVICE_FDINDEX) {		// the audio device
+		const short *in = _busSlot->in;
+		const short in_count = _busSlot->in_count;
+		assert(in_count > 0);
+		for (int n = 0; n < inchans; ++n) {
+			const bool live = n < in_count;
+			chans[n].samps = live ? RTcmix::audioInFrames(in[n], output_offset) : &sSilence;
+			chans[n].stride = live ? 1 : 0;
+		}
+		return nsamps;
+	}
+
+	const short *auxin = _busSlot->auxin;
+	const short auxin_count = _busSlot->auxin_count;
+	assert(auxin_count > 0);
+	for (int n = 0; n < inchans; ++n) {
+		const BUFTYPE *bus = (n < auxin_count) ? RTcmix::auxBusFrames(auxin[n], output_offset) : NULL;
+		chans[n].samps = bus ? bus : &sSilence;
+		chans[n].stride = bus ? 1 : 0;
+	}
+	return nsamps;
+}
+
 /* -------------------------------------------------------------- rtgetin --- */
 /* For use by instruments that take input either from an in buffer or from
  an aux buffer, but not from both at once. Also, input from files or from
@@ -270,7 +372,7 @@ int	Instrument::rtgetin(float *inarr, int nsamps)
 		assert(in_count > 0);
 		
 		RTcmix::readFromInputFile(inarr, inchans, frames, in, in_count,
-								  fdindex, &_input.fileOffset);
+								  fdindex, &_input.fileOffset, _input.stream);
 	}
 	
 	return nsamps;   // this seems pointless, but no insts pay attention anyway
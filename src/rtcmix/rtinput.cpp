@@ -21,9 +21,9 @@
 #include <RTOption.h>
 #include "audio_devices.h"
 #include "InputFile.h"
-#ifdef LINUX
-   #include <fcntl.h>
-#endif /* LINUX */
+#include "HeaderCache.h"
+#include <fcntl.h>
+#include <unistd.h>
 
 /* code that lets user specify buses for input sources */
 //#define INPUT_BUS_SUPPORT
@@ -34,6 +34,26 @@ typedef enum {
    DIGITAL
 } AudioPortType;
 
+/* ----------------------------------------------------- copy_header_info --- */
+static void
+copy_header_info(const HeaderCache::Info &info, int *header_type,
+                 int *data_format, int *data_location, double *srate,
+                 int *nchans, long *nsamps)
+{
+   if (header_type)
+      *header_type = info.type;
+   if (data_format)
+      *data_format = info.format;
+   if (data_location)
+      *data_location = info.location;
+   if (srate)
+      *srate = info.srate;
+   if (nchans)
+      *nchans = info.chans;
+   if (nsamps)
+      *nsamps = info.samples;
+}
+
 /* ------------------------------------------------------ open_sound_file --- */
 int
 open_sound_file(
@@ -57,6 +77,28 @@ open_sound_file(
       return -1;
    }
 
+   // A file we've opened before (and that hasn't changed since) needs no
+   // parsing; just set up its descriptor as sndlib_open_read would.
+   HeaderCache::Info info;
+   if (HeaderCache::find(sfname, sfst, &info)) {
+      int fd = open(sfname, O_RDONLY);
+      if (fd == -1) {
+         rterror(funcname, "Can't open \"%s\" (%s)\n", sfname, strerror(errno));
+         return -1;
+      }
+      mus_file_set_descriptors(fd, sfname, info.format,
+                               mus_data_format_to_bytes_per_sample(info.format),
+                               info.location, info.chans, info.type);
+      if (lseek(fd, info.location, SEEK_SET) == -1) {
+         rterror(funcname, "Can't seek in \"%s\" (%s)\n", sfname, strerror(errno));
+         sndlib_close(fd, 0, 0, 0, 0);
+         return -1;
+      }
+      copy_header_info(info, header_type, data_format, data_location, srate,
+                       nchans, nsamps);
+      return fd;
+   }
+
    // Open the file and read its header.
    int fd = sndlib_open_read(sfname);
    if (fd == -1) {
@@ -90,19 +132,16 @@ open_sound_file(
 	  return -1;
    }
 
-   if (header_type)
-      *header_type = type;
-   if (data_format)
-      *data_format = format;
-   if (data_location)
-      *data_location = mus_header_data_location();
-   if (srate)
-      *srate = (double) mus_header_srate();
-   if (nchans)
-      *nchans = mus_header_chans();
-   if (nsamps)
-      *nsamps = mus_header_samples();
+   info.type = type;
+   info.format = format;
+   info.location = mus_header_data_location();
+   info.srate = (double) mus_header_srate();
+   info.chans = mus_header_chans();
+   info.samples = mus_header_samples();
+   HeaderCache::store(sfname, sfst, info);
 
+   copy_header_info(info, header_type, data_format, data_location, srate,
+                    nchans, nsamps);
    return fd;
 }
 
@@ -117,6 +156,11 @@ open_sound_file(
    "DIGITAL". (This option not available yet under Linux.)
    This sets up the input device to do real-time reading of sound.
 
+   For a sound file, p[1] (optional) can be "MEMORY", to read the whole
+   file into memory now, or "MMAP", to map it into memory and read from
+   the mapping.  Setting the mmap_input option maps every file not loaded
+   into memory.
+
 FIXME: this stuff not implemented yet  -JGG
    pfields after these are bus specification strings in the format
    accepted by the bus_config Minc function. They *must* be "in"
@@ -197,7 +241,7 @@ RTcmix::findInput(const char *inName, int *pOutIndex)
 double
 RTcmix::rtinput(double p[], int n_args)
 {
-	int            audio_in = 0, in_memory = 0, p1_is_used = 0, fd;
+	int            audio_in = 0, in_memory = 0, map_file = 0, p1_is_used = 0, fd;
 	int            is_open = 0, header_type, data_format, data_location = 0, nchans;
 	bool		   set_record = false, in_buffer = false;
     int            status = 0;
@@ -272,7 +316,12 @@ RTcmix::rtinput(double p[], int n_args)
 			if (strcasestr(str, "mem") != NULL) {
 				in_memory = 1;
 			}
+			else if (strcasestr(str, "mmap") != NULL) {
+				map_file = 1;
+			}
 		}
+		if (!in_memory && RTOption::mmapInput())
+			map_file = 1;
 	}
 
 #ifdef INPUT_BUS_SUPPORT
@@ -430,6 +479,8 @@ RTcmix::rtinput(double p[], int n_args)
 			rtcmix_advise(NULL, "  duration:  %g", dur);
 			if (in_memory)
 				rtcmix_advise(NULL, "Loading file into memory");
+			else if (map_file)
+				rtcmix_advise(NULL, "Mapping file into memory");
 
 #ifdef INPUT_BUS_SUPPORT
 #endif /* INPUT_BUS_SUPPORT */
@@ -459,7 +510,8 @@ RTcmix::rtinput(double p[], int n_args)
 									   nsamps/nchans,	// passing this in as frames now, not samps
 									   srate,
 									   nchans,
-                                           dur)) == 0) {
+                                           dur,
+									   map_file != 0)) == 0) {
                     last_input_index = i;
                     break;
                 }
@@ -502,12 +554,12 @@ RTcmix::releaseInput(int fdIndex)
 {
    // BGG -- added this to prevent file closings in interactive mode
    // we don't know if a file will be referenced again in the future
-   if (!interactive()) {
+   // (The input is kept, but its descriptor may be closed, to be opened
+   // again by the next note that reads it.)
 #ifdef DEBUG
-      printf("RTcmix::releaseInput: fdIndex %d\n", fdIndex);
+   printf("RTcmix::releaseInput: fdIndex %d\n", fdIndex);
 #endif
-	   inputFileTable[fdIndex].unreference();
-   }
+   inputFileTable[fdIndex].unreference(interactive());
 }
 
 
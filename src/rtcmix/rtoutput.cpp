@@ -15,6 +15,11 @@
 #include "audio_devices.h"
 #include "rtdefs.h"
 #include <RTOption.h>
+#include <bus.h>
+
+/* from bus_config.cpp */
+extern ErrCode parse_bus_name(char *busname, BusType *type, int *startchan,
+                              int *endchan, int maxBus);
 
 
 /* The syntax of rtoutput is expanded when using sndlib:
@@ -22,7 +27,7 @@
    rtoutput("filename" [, "header_type"] [, "data_format"])
 
    - "header_type" is one of:
-        "aiff", "aifc", "wav", "next", "sun", or "ircam"
+        "aiff", "aifc", "wav", "next", "sun", "ircam", or "flac"
 
       The default is "aiff", since this is what most other unix
       programs can use (Notam software, Cecilia, etc.).
@@ -33,6 +38,10 @@
 
       All formats are bigendian, except for "wav".
 
+      "flac" files are compressed (losslessly) as they are written, so
+      they take roughly half the disk space of the others, or less.
+      They may be "short" or "24", but not "float".
+
    - "data_format" is one of:
         "short"      16-bit linear
         "float"      32-bit floating point
@@ -64,6 +73,27 @@
    to those listed above makes for an easier Minc interface to rtoutput.
 */
 
+/* rtstemoutput writes some of the buses to a file of their own, during the
+   same run that writes the rtoutput file:
+
+   rtstemoutput("filename", "bus" [, "header_type"] [, "data_format"])
+
+   - "bus" is a range of output or aux buses, as in bus_config:
+        "out 0-1", "aux 4-5" (or "aux 4-5 out"), "aux 7"
+
+      The file has one channel per bus.  Out buses are written before the
+      master limiter; aux buses are written as they stand once every
+      instrument has run, so an aux bus that nothing wrote to in a buffer
+      is written as silence.
+
+   - "header_type" and "data_format" are as for rtoutput.
+
+   Call it after rtsetparams, once for each stem.  A stem opened while the
+   run is under way starts at the next buffer.  Every stem file has its own
+   writer thread (see the "file_write_frames" option), so rendering a score
+   once gives the main mix and all of its stems.
+*/
+
 
 /* CAUTION: Don't change these without thinking about constraints
             imposed by the various formats, and by sndlib and any
@@ -105,6 +135,7 @@ static Param param_list[] = {
    { HEADER_TYPE,  MUS_RIFF,     "wav"       },
    { HEADER_TYPE,  MUS_IRCAM,    "ircam"     },
    { HEADER_TYPE,  MUS_RAW,      "raw"       },
+   { HEADER_TYPE,  RT_MUS_FLAC,  "flac"      },
    { DATA_FORMAT,  MUS_BSHORT,   "short"     },
    { DATA_FORMAT,  MUS_BFLOAT,   "float"     },
    { DATA_FORMAT,  MUS_BFLOAT,   "normfloat" },
@@ -129,7 +160,8 @@ static Extension format_extension_list[] = {
    { MUS_AIFC,    "aifc"   },
    { MUS_RIFF,    "wav"    },
    { MUS_IRCAM,   "sf"     },
-   { MUS_RAW,     "raw"    }
+   { MUS_RAW,     "raw"    },
+   { RT_MUS_FLAC, "flac"   }
 };
 static int num_format_extensions = sizeof(format_extension_list)
                                                       / sizeof(Extension);
@@ -159,36 +191,41 @@ header_type_from_filename(char *fname)
 }
 
 
-/* -------------------------------------------------- parse_rtoutput_args --- */
-int
-RTcmix::parse_rtoutput_args(int nargs, double pp[])
+/* ---------------------------------------------------- parse_output_args --- */
+/* Parse the file name in pp[0] and the format strings in pp[first] on,
+   for rtoutput or rtstemoutput (named by <func>).
+*/
+static int
+parse_output_args(const char *func, int nargs, double pp[], int first,
+                  char **fname, int *header_type, int *data_format,
+                  int *normalize_floats)
 {
    int   i, j, matched;
    int   normfloat_requested;
    char  *arg;
 
    if (nargs == 0) {
-      rterror("rtoutput", "you didn't specify a file name!");
+      rterror(func, "you didn't specify a file name!");
       return -1;
    }
 
-   rtoutsfname = DOUBLE_TO_STRING(pp[0]);
-   if (rtoutsfname == NULL || strlen(rtoutsfname) == 0)
+   *fname = DOUBLE_TO_STRING(pp[0]);
+   if (*fname == NULL || strlen(*fname) == 0)
    {
-      rterror("rtoutput", "NULL or empty file name!");
+      rterror(func, "NULL or empty file name!");
       return -1;
    }
 
-   output_header_type = header_type_from_filename(rtoutsfname);
+   int output_header_type = header_type_from_filename(*fname);
    if (output_header_type == -1)
       return -1;
    if (output_header_type == -2)
       output_header_type = DEFAULT_HEADER_TYPE;
-   output_data_format = DEFAULT_DATA_FORMAT;
+   int output_data_format = DEFAULT_DATA_FORMAT;
 
    normfloat_requested = 0;
 
-   for (i = 1; i < nargs; i++) {
+   for (i = first; i < nargs; i++) {
       arg = DOUBLE_TO_STRING(pp[i]);
 
       matched = 0;
@@ -199,7 +236,7 @@ RTcmix::parse_rtoutput_args(int nargs, double pp[])
          }
       }
       if (!matched) {
-         rterror("rtoutput", "unrecognized argument \"%s\"", arg);
+         rterror(func, "unrecognized argument \"%s\"", arg);
          return -1;
       }
 
@@ -237,6 +274,21 @@ RTcmix::parse_rtoutput_args(int nargs, double pp[])
       }
    }
 
+   /* FLAC is always little-endian, and integer only. */
+   if (output_header_type == RT_MUS_FLAC) {
+      switch (output_data_format) {
+         case MUS_BSHORT:
+            output_data_format = MUS_LSHORT;
+            break;
+         case MUS_B24INT:
+            output_data_format = MUS_L24INT;
+            break;
+         default:
+            rterror(func, "FLAC files must be \"short\" or \"24\"");
+            return -1;
+      }
+   }
+
    /* If AIFF, use AIFC only if explicitly requested, or if
       the data format is float.
    */
@@ -248,20 +300,62 @@ RTcmix::parse_rtoutput_args(int nargs, double pp[])
       normal range fall between -1.0 and +1.0. This is what Snd
       and sndlib like to see, but it's not the old cmix way.
    */
-   normalize_output_floats = normfloat_requested;
-
-   is_float_format = IS_FLOAT_FORMAT(output_data_format);
+   *normalize_floats = normfloat_requested;
+   *header_type = output_header_type;
+   *data_format = output_data_format;
 
 #ifdef ALLBUG
    fprintf(stderr, "name: %s, head: %d, data: %d, norm: %d\n",
-                   rtoutsfname, output_header_type, output_data_format,
-                   normalize_output_floats);
+                   *fname, output_header_type, output_data_format,
+                   normfloat_requested);
 #endif
 
    return 0;
 }
 
 
+/* -------------------------------------------------- parse_rtoutput_args --- */
+int
+RTcmix::parse_rtoutput_args(int nargs, double pp[])
+{
+   if (parse_output_args("rtoutput", nargs, pp, 1, &rtoutsfname,
+                         &output_header_type, &output_data_format,
+                         &normalize_output_floats) != 0)
+      return -1;
+   is_float_format = IS_FLOAT_FORMAT(output_data_format);
+   return 0;
+}
+
+
+/* ------------------------------------------------------ check_clobber --- */
+/* Return 0 if we may create <path>: it doesn't exist, or it's a regular
+   file and clobber mode is on.
+*/
+static int
+check_clobber(const char *func, const char *path)
+{
+   struct stat statbuf;
+
+   if (stat(path, &statbuf) != 0) {
+      if (errno == ENOENT)
+         return 0;      /* File doesn't exist -- no problem */
+      rterror(func, "Error accessing file \"%s\": %s", path, strerror(errno));
+      return -1;
+   }
+   /* File exists; find out whether we can clobber it */
+   if (!get_bool_option(kOptionClobber)) {
+      rterror(func, "\n%s", CLOBBER_WARNING);
+      return -1;
+   }
+   /* make sure it's a regular file */
+   if (!S_ISREG(statbuf.st_mode)) {
+      rterror(func, "\"%s\" isn't a regular file; won't clobber it", path);
+      return -1;
+   }
+   return 0;
+}
+
+
 /* ------------------------------------------------------------- rtoutput --- */
 /* This routine is used in the Minc score to open up a file for
    writing by RT instruments.  p[0] is a pointer to the soundfile
@@ -280,7 +374,6 @@ double
 RTcmix::rtoutput(double p[], int n_args)
 {
    int         error;
-   struct stat statbuf;
 
    if (rtfileit == 1) {
       rterror("rtoutput", "A soundfile is already open for writing...");
@@ -300,33 +393,11 @@ RTcmix::rtoutput(double p[], int n_args)
    error = parse_rtoutput_args(n_args, p);
    if (error)
       return rtOptionalThrow(PARAM_ERROR);          /* already reported in parse_rtoutput_args */
+   if (outputPathOverride != NULL)
+      rtoutsfname = outputPathOverride;
 
-   error = stat(rtoutsfname, &statbuf);
-
-   if (error) {
-      if (errno == ENOENT) { 
-         ;              /* File doesn't exist -- no problem */
-      }
-      else {
-         rterror("rtoutput", "Error accessing file \"%s\": %s",
-                                                rtoutsfname, strerror(errno));
-         return rtOptionalThrow(FILE_ERROR);  /* was exit() */
-      }
-   }
-   else {               /* File exists; find out whether we can clobber it */
-      if (!get_bool_option(kOptionClobber)) {
-         rterror("rtoutput", "\n%s", CLOBBER_WARNING);
-         return rtOptionalThrow(FILE_ERROR);
-      }
-      else {
-         /* make sure it's a regular file */
-         if (!S_ISREG(statbuf.st_mode)) {
-            rterror("rtoutput", "\"%s\" isn't a regular file; won't clobber it",
-                                                                 rtoutsfname);
-            return rtOptionalThrow(FILE_ERROR);
-         }
-      }
-   }
+   if (check_clobber("rtoutput", rtoutsfname) != 0)
+      return rtOptionalThrow(FILE_ERROR);
 
    // If user has chosen to turn off audio playback, we delete
    // the device that might have been created during rtsetparams().
@@ -352,3 +423,83 @@ RTcmix::rtoutput(double p[], int n_args)
 }
 
 
+
+
+/* --------------------------------------------------------- rtstemoutput --- */
+/* Open a file for writing one or more buses; see the comment at the top of
+   this file.  Returns the number of stems open.  Dies on error.
+*/
+double
+RTcmix::rtstemoutput(double p[], int n_args)
+{
+   char  *fname, *busname;
+   char  busspec[64];
+   int   header_type, data_format, normfloat, startchan, endchan;
+   BusType  type;
+
+   if (!rtsetparams_was_called()) {
+      die("rtstemoutput", "You must call rtsetparams before rtstemoutput.");
+      return rtOptionalThrow(CONFIGURATION_ERROR);
+   }
+   if (stemCount == kMaxStems) {
+      rterror("rtstemoutput", "Can't write more than %d stems.", kMaxStems);
+      return rtOptionalThrow(RESOURCE_ERROR);
+   }
+   if (n_args < 2) {
+      rterror("rtstemoutput", "usage: rtstemoutput(\"filename\", \"bus\" "
+                              "[, \"header_type\"] [, \"data_format\"])");
+      return rtOptionalThrow(PARAM_ERROR);
+   }
+   busname = DOUBLE_TO_STRING(p[1]);
+   if (busname == NULL) {
+      rterror("rtstemoutput", "NULL bus name!");
+      return rtOptionalThrow(PARAM_ERROR);
+   }
+   /* An aux bus with no direction can only mean the one written to. */
+   if (busname[0] == 'a' && !strchr(busname, 'i') && !strchr(busname, 'o'))
+      snprintf(busspec, sizeof(busspec), "%s out", busname);
+   else
+      snprintf(busspec, sizeof(busspec), "%s", busname);
+   if (parse_bus_name(busspec, &type, &startchan, &endchan, busCount) != NO_ERR)
+      return rtOptionalThrow(PARAM_ERROR);     /* already reported */
+   if (type != BUS_OUT && type != BUS_AUX_OUT) {
+      rterror("rtstemoutput", "\"%s\": stems are written from out or aux buses",
+                                                                     busname);
+      return rtOptionalThrow(PARAM_ERROR);
+   }
+   if (endchan < startchan) {
+      rterror("rtstemoutput", "\"%s\": bus range is backwards", busname);
+      return rtOptionalThrow(PARAM_ERROR);
+   }
+   if (type == BUS_OUT && endchan >= NCHANS) {
+      rterror("rtstemoutput", "You specified %d channels in rtsetparams,\n"
+              "but \"%s\" requires %d channels.", NCHANS, busname, endchan + 1);
+      return rtOptionalThrow(PARAM_ERROR);
+   }
+
+   if (parse_output_args("rtstemoutput", n_args, p, 2, &fname, &header_type,
+                         &data_format, &normfloat) != 0)
+      return rtOptionalThrow(PARAM_ERROR);
+   if (check_clobber("rtstemoutput", fname) != 0)
+      return rtOptionalThrow(FILE_ERROR);
+
+   Stem *stem = &stems[stemCount];
+   stem->aux = (type == BUS_AUX_OUT);
+   stem->startBus = startchan;
+   stem->chans = endchan - startchan + 1;
+   stem->bufs = new BufPtr[stem->chans];
+   stem->device = create_stem_file_device(fname, header_type, data_format,
+                                          stem->chans, sr(), normfloat);
+   if (stem->device == NULL) {
+      delete [] stem->bufs;
+      stem->bufs = NULL;
+      return rtOptionalThrow(AUDIO_ERROR);
+   }
+   if (stemSilence == NULL)
+      stemSilence = new BUFTYPE[bufsamps()]();
+   /* The run may have started: publish the stem only once it's complete. */
+   __sync_synchronize();
+   stemCount = stemCount + 1;
+
+   return stemCount;
+}
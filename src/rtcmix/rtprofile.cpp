@@ -12,7 +12,7 @@ rtprofile()
 {
 // base
 	RT_INTRO("MIX",makeMIX);
-	RT_INTRO("WAVETABLE",makeWAVETABLE);
+	RT_INTRO_POOL("WAVETABLE",makeWAVETABLE,makeWAVETABLEPool);
 	RT_INTRO("CHAIN",makeCHAIN);
 // std
 	RT_INTRO("AM",makeAM);
@@ -22,7 +22,7 @@ rtprofile()
 	RT_INTRO("DEL1",makeDEL1);
 	RT_INTRO("DELAY",makeDELAY);
 	RT_INTRO("FIR",makeFIR);
-	RT_INTRO("FMINST",makeFMINST);
+	RT_INTRO_POOL("FMINST",makeFMINST,makeFMINSTPool);
 	RT_INTRO("HOLO",makeHOLO);
 	RT_INTRO("INPUTSIG",makeINPUTSIG);
 	RT_INTRO("IINOISE",makeIINOISE);
@@ -64,7 +64,7 @@ rtprofile()
 	RT_INTRO("START1",makeSTART1);
 	RT_INTRO("VFRET1",makeVFRET1);
 	RT_INTRO("VSTART1",makeVSTART1);
-	RT_INTRO("STRUM2",makeSTRUM2);
+	RT_INTRO_POOL("STRUM2",makeSTRUM2,makeSTRUM2Pool);
 	RT_INTRO("STRUMFB",makeSTRUMFB);
 	RT_INTRO("TRANS", makeTRANS);
 	RT_INTRO("TRANS3", makeTRANS3);
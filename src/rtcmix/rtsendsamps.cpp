@@ -21,12 +21,24 @@
 #include <AudioFileDevice.h>
 #include "RTOption.h"
 #include <bus.h>
+#include <Ougens.h>
 
 /* #define DUMP_AUDIO_TO_RAW_FILE */
-/* #define USE_REAL2INT */
 
 static int printing_dots = 0;
 
+/* The master limiter, made when the master_limiter option is first seen to
+   be on.  It brings peaks down to just under full scale, looking 2 msec
+   ahead, so that the clipping in the audio device never happens.
+*/
+#define LIMITER_CEILING    -0.1     /* dBFS */
+#define LIMITER_LOOKAHEAD  0.002    /* seconds */
+#define LIMITER_RELEASE    0.1      /* seconds */
+
+static Olimiter *master_limiter = NULL;
+static int limiter_chans = 0;
+static float limiter_srate = 0.0;
+
 
 /* local prototypes */
 static int write_to_audio_device(BufPtr out_buffer[], int samps, AudioDevice *);
@@ -54,30 +66,6 @@ dump_audio_to_raw_file(OBufPtr dest, int nbytes)
 }
 #endif /* DUMP_AUDIO_TO_RAW_FILE */
 
-#ifdef USE_REAL2INT
-/* ------------------------------------------------------------- real2int --- */
-/* This is supposed to be more efficient than casting from float to int,
-   but I didn't notice much difference.  This came from info off of the
-   music-dsp list.  -JGG
-*/
-typedef long int32;
-static double _double2fixmagic = 68719476736.0 * 1.5;
-static int32 _shiftamt = 16;
-#if MUS_LITTLE_ENDIAN    /* processor is little-endian */
-   #define iman_   0
-#else
-   #define iman_   1
-#endif
-
-static INLINE int
-real2int(float val)
-{
-   double x = (double) val;
-   x = x + _double2fixmagic;
-   return ((int32 *) &x)[iman_] >> _shiftamt;
-}
-#endif /* USE_REAL2INT */
-
 /* ------------------------------------------------ write_to_audio_device --- */
 static int
 write_to_audio_device(BufPtr out_buffer[], int samps, AudioDevice *device)
@@ -85,6 +73,27 @@ write_to_audio_device(BufPtr out_buffer[], int samps, AudioDevice *device)
 	return device->sendFrames(out_buffer, samps) == samps ? 0 : AUDIO_ERROR;
 }
 
+/* --------------------------------------------------------- limit_output --- */
+static void
+limit_output(BufPtr out_buffer[], int chans, int frames, float srate)
+{
+   if (!RTOption::masterLimiter()) {
+      delete master_limiter;
+      master_limiter = NULL;
+      return;
+   }
+   if (master_limiter == NULL || chans != limiter_chans
+                                          || srate != limiter_srate) {
+      delete master_limiter;
+      master_limiter = new Olimiter(srate, chans, LIMITER_LOOKAHEAD);
+      master_limiter->setthreshold(32768.0 * pow(10.0, LIMITER_CEILING / 20.0));
+      master_limiter->setrelease(LIMITER_RELEASE);
+      limiter_chans = chans;
+      limiter_srate = srate;
+   }
+   master_limiter->process(out_buffer, frames);
+}
+
 /* ---------------------------------------------------------- rtsendzeros --- */
 /* Send a buffer of zeros to the audio output device, and to the output sound
    file if <also_write_to_file> is true.
@@ -97,9 +106,12 @@ RTcmix::rtsendzeros(AudioDevice *device, int also_write_to_file)
    int   err = 0;
 
    clear_output_buffers();
+   zero_unwritten_out_buffers();
+   if (master_limiter)
+      master_limiter->clear();     /* don't let its delayed samples out later */
 
    if (RTOption::play()) {
-      err = ::write_to_audio_device(out_buffer, bufsamps(), device);
+      err = ::write_to_audio_device(out_buffer, sliceFrames(), device);
       if (err) {
          rtcmix_warn("rtsendzeros error", "%s\n", device->getLastError());
 		 return err;
@@ -111,8 +123,8 @@ RTcmix::rtsendzeros(AudioDevice *device, int also_write_to_file)
 
 /* ---------------------------------------------------------- rtsendsamps --- */
 /* Called by the scheduler to write the output buffer to the audio device
-   and/or a sound file.   All format conversion and limting happens inside
-   the AudioDevice.
+   and/or a sound file.   All format conversion and clipping happens inside
+   the AudioDevice; the master limiter, if it's on, runs just before.
 */
 
 int
@@ -128,7 +140,11 @@ RTcmix::rtsendsamps(AudioDevice *device)
       printing_dots = 1;
       printf(".");    /* no '\n' */
    }
-   err = ::write_to_audio_device(out_buffer, bufsamps(), device);
+   zero_unwritten_out_buffers();
+   if (stemCount > 0 && (err = rtsendstems()) != 0)
+      return err;
+   ::limit_output(out_buffer, NCHANS, sliceFrames(), sr());
+   err = ::write_to_audio_device(out_buffer, sliceFrames(), device);
    if (err != 0) {
       rtcmix_warn("rtsendsamps error", "%s\n", device->getLastError());
    }
@@ -136,6 +152,60 @@ RTcmix::rtsendsamps(AudioDevice *device)
 }
 
 
+/* ---------------------------------------------------------- rtsendstems --- */
+/* Hand each rtstemoutput file the buses it takes from this buffer.  Called
+   from rtsendsamps once every instrument has run, before the master limiter,
+   so aux buses still hold what was mixed into them.  The writes only queue
+   the frames; each stem's own thread takes them to disk.
+*/
+int
+RTcmix::rtsendstems()
+{
+   const int frames = sliceFrames();
+   const int count = stemCount;
+
+   for (int n = 0; n < count; n++) {
+      const Stem &stem = stems[n];
+      BufPtr *bufs = stem.bufs;
+      for (int ch = 0; ch < stem.chans; ch++) {
+         const int bus = stem.startBus + ch;
+         if (!stem.aux)
+            bufs[ch] = out_buffer[bus];
+         else if (aux_buffer[bus] == NULL || aux_unwritten[bus])
+            bufs[ch] = stemSilence;
+         else
+            bufs[ch] = aux_buffer[bus];
+      }
+      if (stem.device->sendFrames(bufs, frames) != frames) {
+         rtcmix_warn("rtsendstems error", "%s\n", stem.device->getLastError());
+         return AUDIO_ERROR;
+      }
+   }
+   return 0;
+}
+
+
+/* ----------------------------------------------------------- closeStems --- */
+/* Finish writing the stem files, once the run is over. */
+void
+RTcmix::closeStems()
+{
+   const int count = stemCount;
+
+   stemCount = 0;
+   for (int n = 0; n < count; n++) {
+      if (stems[n].device->close() != 0)
+         rtcmix_warn("rtstemoutput", "%s", stems[n].device->getLastError());
+      delete stems[n].device;
+      stems[n].device = NULL;
+      delete [] stems[n].bufs;
+      stems[n].bufs = NULL;
+   }
+   delete [] stemSilence;
+   stemSilence = NULL;
+}
+
+
 /* -------------------------------------------------------- rtreportstats --- */
 // BGG -- this isn't used in maxmsp
 void
@@ -144,14 +214,13 @@ RTcmix::rtreportstats(AudioDevice *device)
    static const double dbref = ::dbamp(32768.0);
 	
    if (RTOption::checkPeaks()) {
-      BUFTYPE peaks[MAXBUS];
-      long peaklocs[MAXBUS];
       printf("\nPeak amplitudes of output:\n");
       for (int n = 0; n < NCHANS; n++) {
-         peaks[n] = device->getPeak(n, &peaklocs[n]);
-         double peak_dbfs = ::dbamp(peaks[n]) - dbref;
+         long peakloc;
+         const BUFTYPE peak = device->getPeak(n, &peakloc);
+         double peak_dbfs = ::dbamp(peak) - dbref;
          printf("  channel %d: %12.6f (%6.2f dBFS) at frame %ld (%g seconds)\n",
-                n, peaks[n], peak_dbfs, peaklocs[n], (float) peaklocs[n] / sr());
+                n, peak, peak_dbfs, peakloc, (float) peakloc / sr());
       }
    }
 }
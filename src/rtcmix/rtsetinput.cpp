@@ -15,6 +15,8 @@
 #include "Instrument.h"
 #include "rtdefs.h"
 #include "InputFile.h"
+#include "InputStream.h"
+#include <Lockable.h>
 
 
 #define INCHANS_DISCREPANCY_WARNING "\
@@ -76,10 +78,15 @@ Instrument::rtsetinput(float start_time, Instrument *inst)
    return 0;
 }
 
+// Notes may be set up on more than one thread at once (see NoteSetup.h),
+// and the first to read a file opens it.
+static Lockable sAttachLock;
+
 int
 RTcmix::attachInput(float start_time, InputState *input)
 {
-      int index = get_last_input_index();
+      AutoLock lock(sAttachLock);
+      int index = input->sourceIndex;
 #ifdef SGI
       if (index < 0) {
          return RT_NO_INPUT_SRC;
@@ -130,6 +137,10 @@ RTcmix::attachInput(float start_time, InputState *input)
                             + (inskip_frames * input->inputchans * datum_size);
          assert(input->fileOffset >= 0);
 		 input->inputNsamps = (int) (0.5 + inputFileTable[index].duration() * input->inputsr) - inskip_frames;
+		 // Start reading ahead from the inskip.  (An instrument calls
+		 // rtsetinput only once, but be safe.)
+		 if (input->stream == NULL)
+		    input->stream = InputStream::create(&inputFileTable[index], input->fileOffset);
          if (start_time >= inputFileTable[index].duration())
 		    status = RT_INPUT_EOF;	// not fatal -- just produces warning
       }
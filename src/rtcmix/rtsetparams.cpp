@@ -16,6 +16,7 @@
 #include <assert.h>
 #include "audio_devices.h"
 #include <ugens.h>
+#include "BufferPool.h"
 #include <RTOption.h>
 #include "rtdefs.h"
 #include "InputFile.h"
@@ -39,11 +40,11 @@ RTcmix::setparams(float sr, int nchans, int bufsamps, bool recording, int bus_co
         RTExit(PARAM_ERROR);
     }
 
-	if (bus_count < MAXBUS && bus_count >= MINBUS) {
+	if (bus_count <= MAXBUSCOUNT && bus_count >= MINBUS) {
 		busCount = bus_count;
 	}
 	else {
-		die("rtsetparams", "Bus count must be between %d and %d", MINBUS, MAXBUS);
+		die("rtsetparams", "Bus count must be between %d and %d", MINBUS, MAXBUSCOUNT);
         RTExit(PARAM_ERROR);
 	}
 
@@ -57,7 +58,25 @@ RTcmix::setparams(float sr, int nchans, int bufsamps, bool recording, int bus_co
     setSR(sr);
     NCHANS = nchans;
     setRTBUFSAMPS(bufsamps);
-    
+
+	const int budget = RTOption::memoryBudget();
+	if (budget > 0 && BufferPool::reserve((size_t) budget << 20) != 0) {
+		die("rtsetparams", "Cannot set the memory budget to %d MB.", budget);
+		RTExit(MEMORY_ERROR);
+	}
+
+	/* When rendering to a file only, nothing gains from small buffers: they
+	 just mean more passes through inTraverse, more waits for the worker
+	 threads, and more, smaller file writes.  So if offline_buffer_frames is
+	 set, render in blocks of that size instead.  Instruments still update
+	 their parameters at the control rate, which does not depend on this.
+	 */
+	const int offline_frames = RTOption::offlineBufferFrames();
+	if (!play_audio && !record_audio && !interactive() && offline_frames > bufsamps) {
+		rtcmix_advise("rtsetparams", "Rendering offline in blocks of %d frames.", offline_frames);
+		setRTBUFSAMPS(offline_frames);
+	}
+
     int numBuffers = RTOption::bufferCount();
     
     // Now that much of our global state is dynamically sized, the initialization
@@ -107,21 +126,27 @@ RTcmix::setparams(float sr, int nchans, int bufsamps, bool recording, int bus_co
 	}
 	
 #ifdef MULTI_THREAD
-	InputFile::createConversionBuffers(RTcmix::bufsamps());
+	InputFile::createConversionBuffers((int) mixVectors.size(), RTcmix::bufsamps());
 #endif
 
 #ifdef EMBEDDED
-    if (verbose >= MMP_PRINTALL)
+	if (verbose >= MMP_PRINTALL) {
+#endif
+		rtcmix_advise("rtsetparams", "Audio set:  %g sampling rate, %d channels\n", RTcmix::sr(), NCHANS);
+#ifdef EMBEDDED
+	}
 #endif
-        rtcmix_advise("rtsetparams", "Audio set:  %g sampling rate, %d channels\n", RTcmix::sr(), NCHANS);
     
-	/* inTraverse waits for this. Set it even if play_audio is false! */
+	rtsetparams_called = 1;	/* Put this at end to allow re-call due to error */
+
+	/* inTraverse waits for this. Set it even if play_audio is false!
+	   Set after rtsetparams_called, which runMainLoop checks as soon as it
+	   sees this, possibly from another thread.
+	 */
 	pthread_mutex_lock(&audio_config_lock);
 	audio_config = 1;
 	pthread_mutex_unlock(&audio_config_lock);
 	
-	rtsetparams_called = 1;	/* Put this at end to allow re-call due to error */
-	
 	return 0;
 }
 
@@ -176,7 +201,7 @@ int RTcmix::resetparams(float sr, int chans, int bufsamps, bool recording)
 		}
 	}
 #ifdef MULTI_THREAD
-	InputFile::createConversionBuffers(RTcmix::bufsamps());
+	InputFile::createConversionBuffers((int) mixVectors.size(), RTcmix::bufsamps());
 #endif
 
 	/* inTraverse waits for this. Set it even if play_audio is false! */
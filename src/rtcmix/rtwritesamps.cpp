@@ -28,7 +28,7 @@
 int
 RTcmix::rtwritesamps(AudioDevice *fileDevice)
 {
-	const int nframes = bufsamps();
+	const int nframes = sliceFrames();
 
 	/* This catches our new case where rtoutput() failed but was ignored */
 	if (rtfileit < 0) {
@@ -37,6 +37,7 @@ RTcmix::rtwritesamps(AudioDevice *fileDevice)
 		return -1;	/*NOTREACHED*/	/* sometimes, that is */
 	}
    
+	zero_unwritten_out_buffers();
 	int framesWritten = fileDevice->sendFrames(out_buffer, nframes);
    
 	if (framesWritten != nframes) {
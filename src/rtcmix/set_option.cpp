@@ -20,6 +20,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <RTOption.h>
+#include "BufferPool.h"
 
 enum ParamType {
 	AUDIO,
@@ -35,6 +36,25 @@ enum ParamType {
 	AUTO_LOAD,
 	FAST_UPDATE,
 	REQUIRE_SAMPLE_RATE,
+	MMAP_INPUT,
+	BATCH_FILE_WRITE,
+	SMOOTH_CONTROLS,
+	BLOCK_NOISE,
+	FLOAT_TABLES,
+	PRELOAD_DSOS,
+	THREAD_REALTIME,
+	THREAD_AFFINITY,
+	ALIGNED_BLOCKS,
+	DETERMINISTIC_MIX,
+	DSP_STATS,
+	MEMORY_STATS,
+	ASYNC_DATAFILES,
+	ALLOC_BACKTRACES,
+	SCORE_CACHE,
+	MASTER_LIMITER,
+	VOICE_POOL,
+	FLUSH_DENORMALS,
+	PARALLEL_SETUP,
 	BUFFER_FRAMES,
 	BUFFER_COUNT,
 	OSC_INPORT,
@@ -42,6 +62,24 @@ enum ParamType {
     PRINT_LIST_LIMIT,
     PARSER_WARNINGS,
     MUTE_THRESHOLD,
+	THREAD_COUNT,
+	PREFETCH_FRAMES,
+	MAX_OPEN_INPUTS,
+	SAMPLE_CACHE_MB,
+	NOTE_CACHE_MB,
+	FILE_WRITE_FRAMES,
+	OFFLINE_BUFFER_FRAMES,
+	FRAME_THREADS,
+	PARSE_AHEAD_MSEC,
+	THREAD_SPIN_USEC,
+	OUTPUT_FIFO_BUFFERS,
+	OVERLOAD_PERCENT,
+	OVERLOAD_SHED_NOTES,
+	SILENCE_SLEEP_MSEC,
+	SILENCE_THRESHOLD_DB,
+	DSP_STATS_INTERVAL,
+	MEMORY_BUDGET,
+	PRECONFIGURE_MSEC,
 	DEVICE,
 	INDEVICE,
 	OUTDEVICE,
@@ -49,6 +87,9 @@ enum ParamType {
 	MIDI_OUTDEVICE,
 	OSC_HOST,
 	DSOPATH,
+	TRACE_FILE,
+	TABLE_CACHE_DIR,
+	RENDER_CACHE_DIR,
 	RCNAME
 };
 
@@ -77,6 +118,25 @@ static Param _param_list[] = {
 	{ kOptionAutoLoad, AUTO_LOAD, false},
 	{ kOptionFastUpdate, FAST_UPDATE, false},
 	{ kOptionRequireSampleRate, REQUIRE_SAMPLE_RATE, true},
+	{ kOptionMmapInput, MMAP_INPUT, false},
+	{ kOptionBatchFileWrite, BATCH_FILE_WRITE, false},
+	{ kOptionSmoothControls, SMOOTH_CONTROLS, false},
+	{ kOptionBlockNoise, BLOCK_NOISE, false},
+	{ kOptionFloatTables, FLOAT_TABLES, false},
+	{ kOptionPreloadDSOs, PRELOAD_DSOS, false},
+	{ kOptionThreadRealtime, THREAD_REALTIME, false},
+	{ kOptionThreadAffinity, THREAD_AFFINITY, false},
+	{ kOptionAlignedBlocks, ALIGNED_BLOCKS, false},
+	{ kOptionDeterministicMix, DETERMINISTIC_MIX, false},
+	{ kOptionDspStats, DSP_STATS, false},
+	{ kOptionMemoryStats, MEMORY_STATS, false},
+	{ kOptionAsyncDataFiles, ASYNC_DATAFILES, false},
+	{ kOptionAllocBacktraces, ALLOC_BACKTRACES, false},
+	{ kOptionScoreCache, SCORE_CACHE, false},
+	{ kOptionMasterLimiter, MASTER_LIMITER, false},
+	{ kOptionVoicePool, VOICE_POOL, false},
+	{ kOptionFlushDenormals, FLUSH_DENORMALS, false},
+	{ kOptionParallelSetup, PARALLEL_SETUP, false},
 
 	// number options
 	{ kOptionBufferFrames, BUFFER_FRAMES, false},
@@ -86,6 +146,24 @@ static Param _param_list[] = {
     { kOptionPrintListLimit, PRINT_LIST_LIMIT, false},
     { kOptionParserWarnings, PARSER_WARNINGS, false},
 	{ kOptionMuteThreshold, MUTE_THRESHOLD, false},
+	{ kOptionThreadCount, THREAD_COUNT, false},
+	{ kOptionPrefetchFrames, PREFETCH_FRAMES, false},
+	{ kOptionMaxOpenInputs, MAX_OPEN_INPUTS, false},
+	{ kOptionSampleCacheMB, SAMPLE_CACHE_MB, false},
+	{ kOptionNoteCacheMB, NOTE_CACHE_MB, false},
+	{ kOptionFileWriteFrames, FILE_WRITE_FRAMES, false},
+	{ kOptionOfflineBufferFrames, OFFLINE_BUFFER_FRAMES, false},
+	{ kOptionFrameThreads, FRAME_THREADS, false},
+	{ kOptionParseAheadMsec, PARSE_AHEAD_MSEC, false},
+	{ kOptionThreadSpinUsec, THREAD_SPIN_USEC, false},
+	{ kOptionOutputFifoBuffers, OUTPUT_FIFO_BUFFERS, false},
+	{ kOptionOverloadPercent, OVERLOAD_PERCENT, false},
+	{ kOptionOverloadShedNotes, OVERLOAD_SHED_NOTES, false},
+	{ kOptionSilenceSleepMsec, SILENCE_SLEEP_MSEC, false},
+	{ kOptionSilenceThresholdDb, SILENCE_THRESHOLD_DB, false},
+	{ kOptionDspStatsInterval, DSP_STATS_INTERVAL, false},
+	{ kOptionMemoryBudget, MEMORY_BUDGET, false},
+	{ kOptionPreconfigureMsec, PRECONFIGURE_MSEC, false},
 
 	// string options
 	{ kOptionDevice, DEVICE, false},
@@ -95,6 +173,9 @@ static Param _param_list[] = {
 	{ kOptionMidiOutDevice, MIDI_OUTDEVICE, false},
 	{ kOptionOSCHost, OSC_HOST, false},
 	{ kOptionDSOPath, DSOPATH, false},
+	{ kOptionTraceFile, TRACE_FILE, false},
+	{ kOptionTableCacheDir, TABLE_CACHE_DIR, false},
+	{ kOptionRenderCacheDir, RENDER_CACHE_DIR, false},
 	{ kOptionRCName, RCNAME, false},
 
 	// These are the deprecated single-value option strings.
@@ -262,6 +343,88 @@ static int _set_key_value_option(const char *key, const char *sval,
 			status = _str_to_bool(sval, bval);
 			RTOption::requireSampleRate(bval);
 			break;
+		case MMAP_INPUT:
+			status = _str_to_bool(sval, bval);
+			RTOption::mmapInput(bval);
+			break;
+		case BATCH_FILE_WRITE:
+			status = _str_to_bool(sval, bval);
+			RTOption::batchFileWrite(bval);
+			break;
+		case SMOOTH_CONTROLS:
+			status = _str_to_bool(sval, bval);
+			RTOption::smoothControls(bval);
+			break;
+		case BLOCK_NOISE:
+			status = _str_to_bool(sval, bval);
+			RTOption::blockNoise(bval);
+			break;
+		case FLOAT_TABLES:
+			status = _str_to_bool(sval, bval);
+			RTOption::floatTables(bval);
+			break;
+		case PRELOAD_DSOS:
+			status = _str_to_bool(sval, bval);
+			RTOption::preloadDSOs(bval);
+			break;
+		case THREAD_REALTIME:
+			status = _str_to_bool(sval, bval);
+			RTOption::threadRealtime(bval);
+			break;
+		case THREAD_AFFINITY:
+			status = _str_to_bool(sval, bval);
+			RTOption::threadAffinity(bval);
+			break;
+		case ALIGNED_BLOCKS:
+			status = _str_to_bool(sval, bval);
+			RTOption::alignedBlocks(bval);
+#ifndef EMBEDDED
+			// The bus buffers have been sized by now.
+			if (rtsetparams_called)
+				return die("set_option",
+							"Set \"%s\" BEFORE calling rtsetparams.", key);
+#endif
+			break;
+		case DETERMINISTIC_MIX:
+			status = _str_to_bool(sval, bval);
+			RTOption::deterministicMix(bval);
+			break;
+		case DSP_STATS:
+			status = _str_to_bool(sval, bval);
+			RTOption::dspStats(bval);
+			break;
+		case MEMORY_STATS:
+			status = _str_to_bool(sval, bval);
+			RTOption::memoryStats(bval);
+			break;
+		case ASYNC_DATAFILES:
+			status = _str_to_bool(sval, bval);
+			RTOption::asyncDataFiles(bval);
+			break;
+		case ALLOC_BACKTRACES:
+			status = _str_to_bool(sval, bval);
+			RTOption::allocBacktraces(bval);
+			break;
+		case SCORE_CACHE:
+			status = _str_to_bool(sval, bval);
+			RTOption::scoreCache(bval);
+			break;
+		case MASTER_LIMITER:
+			status = _str_to_bool(sval, bval);
+			RTOption::masterLimiter(bval);
+			break;
+		case VOICE_POOL:
+			status = _str_to_bool(sval, bval);
+			RTOption::voicePool(bval);
+			break;
+		case FLUSH_DENORMALS:
+			status = _str_to_bool(sval, bval);
+			RTOption::flushDenormals(bval);
+			break;
+		case PARALLEL_SETUP:
+			status = _str_to_bool(sval, bval);
+			RTOption::parallelSetup(bval);
+			break;
 
 		// number options
 
@@ -305,6 +468,154 @@ static int _set_key_value_option(const char *key, const char *sval,
 			status = _str_to_double(sval, dval);
 			RTOption::muteThreshold(dval);
 			break;
+		case THREAD_COUNT:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::threadCount(ival);
+			}
+			break;
+		case PREFETCH_FRAMES:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::prefetchFrames(ival);
+			}
+			break;
+		case MAX_OPEN_INPUTS:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::maxOpenInputs(ival);
+			}
+			break;
+		case SAMPLE_CACHE_MB:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::sampleCacheMB(ival);
+			}
+			break;
+		case NOTE_CACHE_MB:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::noteCacheMB(ival);
+			}
+			break;
+		case FILE_WRITE_FRAMES:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::fileWriteFrames(ival);
+			}
+			break;
+		case OFFLINE_BUFFER_FRAMES:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::offlineBufferFrames(ival);
+			}
+			break;
+		case FRAME_THREADS:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::frameThreads(ival);
+			}
+			break;
+		case PARSE_AHEAD_MSEC:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::parseAheadMsec(ival);
+			}
+			break;
+		case THREAD_SPIN_USEC:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::threadSpinUsec(ival);
+			}
+			break;
+		case OUTPUT_FIFO_BUFFERS:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::outputFifoBuffers(ival);
+			}
+			break;
+		case OVERLOAD_PERCENT:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::overloadPercent(ival);
+			}
+			break;
+		case OVERLOAD_SHED_NOTES:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::overloadShedNotes(ival);
+			}
+			break;
+		case SILENCE_SLEEP_MSEC:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::silenceSleepMsec(ival);
+			}
+			break;
+		case SILENCE_THRESHOLD_DB:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival > 0)
+					return die("set_option", "\"%s\" value must be <= 0", key);
+				RTOption::silenceThresholdDb(ival);
+			}
+			break;
+		case DSP_STATS_INTERVAL:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::dspStatsInterval(ival);
+			}
+			break;
+		case MEMORY_BUDGET:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::memoryBudget(ival);
+				// Otherwise rtsetparams sets the memory aside.
+				if (rtsetparams_called && ival > 0
+						&& BufferPool::reserve((size_t) ival << 20) != 0)
+					return die("set_option", "Cannot set the memory budget to %d MB.", ival);
+			}
+			break;
+		case PRECONFIGURE_MSEC:
+			status = _str_to_int(sval, ival);
+			if (status == 0) {
+				if (ival < 0)
+					return die("set_option", "\"%s\" value must be >= 0", key);
+				RTOption::preconfigureMsec(ival);
+			}
+			break;
 
 		// string options
 
@@ -332,6 +643,15 @@ static int _set_key_value_option(const char *key, const char *sval,
 		case RCNAME:
 			RTOption::rcName(sval);
 			break;
+		case TRACE_FILE:
+			RTOption::traceFile(sval);
+			break;
+		case TABLE_CACHE_DIR:
+			RTOption::tableCacheDir(sval);
+			break;
+		case RENDER_CACHE_DIR:
+			RTOption::renderCacheDir(sval);
+			break;
 		default:
 			break;
 	}
@@ -5,6 +5,9 @@
 #include "sfheader.h"
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 /* these are all defined in sound.c */
 extern int  sfd[NFILES];            /* soundfile descriptors */
@@ -13,6 +16,54 @@ extern off_t  filepointer[NFILES];   /* to save current pointer in file */
 extern int   nbytes;
 extern SFHEADER      sfdesc[NFILES];
 
+/* Writes <bytes> of the input file, from its current position, straight out
+   of a mapping of it, rather than reading them into sndbuf first.  Returns
+   the number of bytes copied, which is short of <bytes> at EOF, or -1 if
+   the input can't be mapped.
+*/
+static long
+mapcopy(int input, int output, long bytes)
+{
+	struct stat st;
+	off_t inpos, mapstart;
+	long pagesize, n;
+	size_t maplen;
+	char *map;
+
+	inpos = lseek(sfd[input], 0, SEEK_CUR);
+	if (inpos < 0 || fstat(sfd[input], &st) < 0)
+		return -1;
+	if (inpos + bytes > st.st_size)
+		bytes = (st.st_size > inpos) ? st.st_size - inpos : 0;
+	if (bytes == 0)
+		return 0;
+	pagesize = sysconf(_SC_PAGESIZE);
+	mapstart = inpos - (inpos % pagesize);
+	maplen = (inpos - mapstart) + bytes;
+	map = (char *) mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, sfd[input],
+																mapstart);
+	if (map == (char *) MAP_FAILED)
+		return -1;
+#ifdef MADV_SEQUENTIAL
+	madvise(map, maplen, MADV_SEQUENTIAL);
+#endif
+	for (n = 0; n < bytes; ) {
+		long jj = write(sfd[output], map + (inpos - mapstart) + n, bytes - n);
+		if (jj <= 0) {
+			fprintf(stderr,"Trouble writing output file\n");
+			munmap(map, maplen);
+			closesf();
+			return n;
+		}
+		n += jj;
+	}
+	munmap(map, maplen);
+	lseek(sfd[input], inpos + bytes, SEEK_SET);
+	filepointer[input] = inpos + bytes;
+	filepointer[output] += bytes;
+	return bytes;
+}
+
 
 double
 sfcopy(double p[], int n_args)
@@ -37,6 +88,13 @@ sfcopy(double p[], int n_args)
 
 	fprintf(stderr,"Copy %d bytes\n",bytes);
 
+	if((n = mapcopy(input,output,bytes)) >= 0) {
+		if(n < bytes) {
+			fprintf(stderr,"Apparent eof on input\n");
+			return -1.0;
+		}
+		bytes = 0;
+	}
 	while(bytes) {
 		maxread = (bytes > nbytes) ? nbytes : bytes;
 		if((n = read(sfd[input],sndbuf[input],maxread)) <= 0) {
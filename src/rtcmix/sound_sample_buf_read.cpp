@@ -16,6 +16,8 @@
 #include "utils.h"
 #include <ugens.h>		// for warn, die
 #include <maxdispargs.h>
+#include <RTOption.h>
+#include "SampleCache.h"
 
 
 // Used to read in samples from disk to a buffer which can then be used
@@ -55,7 +57,6 @@ sound_sample_buf_read(char *fname, double insk, double dur, int *nframes, int *n
 	long file_frames = file_samps / file_chans;
 	long insk_frames = (long)(insk * srate);
 	long read_frames = (long)(dur * srate);
-	long read_samps = read_frames * file_chans;
 	if (read_frames + insk_frames > file_frames) {
 		read_frames = file_frames - insk_frames;
 		// some of the rterror()s should probably be rtcmix_warn()s, but for
@@ -71,6 +72,20 @@ sound_sample_buf_read(char *fname, double insk, double dur, int *nframes, int *n
 
 	*nframes = read_frames;
 	*nchans = file_chans;
+	const long read_samps = read_frames * file_chans;
+
+	// This region of the file may have been decoded already.  (We don't
+	// share 32-bit int files, which rtinput decodes differently.)
+	const bool cacheable = !IS_32BIT_FORMAT(data_format);
+	SampleCache::Block *cached = cacheable
+			? SampleCache::find(fname, insk_frames, read_frames, SAMPLE_CACHE_ALL_CHANS) : NULL;
+	if (cached != NULL) {
+		float *block = new float[read_samps];
+		memcpy(block, cached->samples(), read_samps * sizeof(float));
+		SampleCache::release(cached);
+		sndlib_close(fd, 0, 0, 0, 0);
+		return block;
+	}
 
 	float *block = new float[read_samps];
 	if (block == NULL) {
@@ -150,6 +165,12 @@ sound_sample_buf_read(char *fname, double insk, double dur, int *nframes, int *n
 	delete [] buf;
 	sndlib_close(fd, 0, 0, 0, 0);
 
+	if (cacheable && RTOption::sampleCacheMB() > 0) {
+		float *samps = new float[read_samps];
+		memcpy(samps, block, read_samps * sizeof(float));
+		SampleCache::release(SampleCache::insert(fname, insk_frames, read_frames,
+												 SAMPLE_CACHE_ALL_CHANS, samps, read_samps));
+	}
 	return block;
 }
 
@@ -24,6 +24,11 @@
 #include <ugens.h>		// for warn, die
 #include <maxdispargs.h>
 #include <limits.h>
+#include <RTOption.h>
+#include "SampleCache.h"
+#include "TableCache.h"
+#include <Ougens.h>		// for Omipmap
+#include <vector>
 
 // Functions for creating and modifying double arrays.  These can be passed
 // from a script to RTcmix functions that can accept them.  Much of this code
@@ -271,82 +276,14 @@ _textfile_table(const Arg args[], const int nargs, double *array, const int len)
 #define ALL_CHANS -1
 #define BUFSAMPS	1024 * 16
 
+// Read <table_frames> frames starting at <start_frame> from an open sound
+// file, converting them to doubles in <block>.  Reads just one channel unless
+// <inchan> is ALL_CHANS.
+
 static int
-_soundfile_table(const Arg args[], const int nargs, double **array, int *len)
+_decode_soundfile(int fd, int data_format, int data_location, int file_chans,
+				  long start_frame, long table_frames, int inchan, double *block)
 {
-	delete [] *array;		// need to allocate our own
-
-	if (nargs <= 0)
-		return die("maketable (soundfile)",
-					  "\nUsage: table = maketable(\"soundfile\", size=0, "
-										"filename[, duration[, inskip[, inchan]]])");
-
-	if (!args[0].isType(StringType))
-		return die("maketable (soundfile)", "File name must be a string.");
-	const char *fname = (const char *) args[0];
-
-	double request_dur = 0.0;
-	double inskip = 0.0;
-	int inchan = ALL_CHANS;
-	if (nargs > 1) {
-		if (!args[1].isType(DoubleType))
-			return die("maketable (soundfile)", "<duration> must be a number.");
-		request_dur = args[1];
-		if (nargs > 2) {
-			if (!args[2].isType(DoubleType))
-				return die("maketable (soundfile)", "<inskip> must be a number.");
-			inskip = args[2];
-			if (nargs > 3) {
-				if (!args[3].isType(DoubleType))
-					return die("maketable (soundfile)", "<inchan> must be a number.");
-				inchan = args[3];
-			}
-		}
-	}
-
-	int data_format, data_location, file_chans;
-	long file_samps;
-	double srate;
-
-	int fd = open_sound_file("maketable (soundfile)", (char *) fname, NULL,
-                &data_format, &data_location, &srate, &file_chans, &file_samps);
-	if (fd == -1)
-		return FILE_ERROR;
-
-	if (srate != RTcmix::sr())
-		rtcmix_warn("maketable (soundfile)", "The input file sampling rate is %g, but "
-			  "the output rate is currently %g.", srate, RTcmix::sr());
-
-	long file_frames = file_samps / file_chans;
-
-	int table_chans = file_chans;
-	if (inchan != ALL_CHANS) {
-		if (inchan >= file_chans)
-			return die("maketable (soundfile)",
-						  "You asked for channel %d of a %d-channel file. (\"%s\")",
-						  inchan, file_chans, fname);
-		table_chans = 1;
-	}
-
-	long table_frames = file_frames;			// if request_dur == 0
-	if (request_dur < 0.0)
-		table_frames = (long) -request_dur;
-	else if (request_dur > 0.0)
-		table_frames = (long) (request_dur * srate + 0.5);
-
-	long start_frame = (long) (inskip * srate + 0.5); 
-	if (inskip < 0.0)
-		start_frame = (long) -inskip;
-
-	if (start_frame + table_frames > file_frames)
-		table_frames = file_frames - start_frame;
-
-	long table_samps = table_frames * table_chans;
- 
-	double *block = new double[table_samps];
-	if (block == NULL)
-		return die("maketable (soundfile)", "Not enough memory for table.");
-
 	int bytes_per_samp = mus_data_format_to_bytes_per_sample(data_format);
 
 	char *buf = new char[BUFSAMPS * bytes_per_samp];
@@ -462,6 +399,109 @@ _soundfile_table(const Arg args[], const int nargs, double **array, int *len)
 	}
 
 	delete [] buf;
+	return 0;
+}
+
+static int
+_soundfile_table(const Arg args[], const int nargs, double **array, int *len)
+{
+	delete [] *array;		// need to allocate our own
+
+	if (nargs <= 0)
+		return die("maketable (soundfile)",
+					  "\nUsage: table = maketable(\"soundfile\", size=0, "
+										"filename[, duration[, inskip[, inchan]]])");
+
+	if (!args[0].isType(StringType))
+		return die("maketable (soundfile)", "File name must be a string.");
+	const char *fname = (const char *) args[0];
+
+	double request_dur = 0.0;
+	double inskip = 0.0;
+	int inchan = ALL_CHANS;
+	if (nargs > 1) {
+		if (!args[1].isType(DoubleType))
+			return die("maketable (soundfile)", "<duration> must be a number.");
+		request_dur = args[1];
+		if (nargs > 2) {
+			if (!args[2].isType(DoubleType))
+				return die("maketable (soundfile)", "<inskip> must be a number.");
+			inskip = args[2];
+			if (nargs > 3) {
+				if (!args[3].isType(DoubleType))
+					return die("maketable (soundfile)", "<inchan> must be a number.");
+				inchan = args[3];
+			}
+		}
+	}
+
+	int data_format, data_location, file_chans;
+	long file_samps;
+	double srate;
+
+	int fd = open_sound_file("maketable (soundfile)", (char *) fname, NULL,
+                &data_format, &data_location, &srate, &file_chans, &file_samps);
+	if (fd == -1)
+		return FILE_ERROR;
+
+	if (srate != RTcmix::sr())
+		rtcmix_warn("maketable (soundfile)", "The input file sampling rate is %g, but "
+			  "the output rate is currently %g.", srate, RTcmix::sr());
+
+	long file_frames = file_samps / file_chans;
+
+	int table_chans = file_chans;
+	if (inchan != ALL_CHANS) {
+		if (inchan >= file_chans)
+			return die("maketable (soundfile)",
+						  "You asked for channel %d of a %d-channel file. (\"%s\")",
+						  inchan, file_chans, fname);
+		table_chans = 1;
+	}
+
+	long table_frames = file_frames;			// if request_dur == 0
+	if (request_dur < 0.0)
+		table_frames = (long) -request_dur;
+	else if (request_dur > 0.0)
+		table_frames = (long) (request_dur * srate + 0.5);
+
+	long start_frame = (long) (inskip * srate + 0.5); 
+	if (inskip < 0.0)
+		start_frame = (long) -inskip;
+
+	if (start_frame + table_frames > file_frames)
+		table_frames = file_frames - start_frame;
+
+	long table_samps = table_frames * table_chans;
+ 
+	double *block = new double[table_samps];
+	if (block == NULL)
+		return die("maketable (soundfile)", "Not enough memory for table.");
+
+	// This region of the file may have been decoded already.  (We don't
+	// share 32-bit int files, which rtinput decodes differently.)
+	const bool cacheable = !IS_32BIT_FORMAT(data_format);
+	SampleCache::Block *cached = cacheable
+			? SampleCache::find(fname, start_frame, table_frames, inchan) : NULL;
+	if (cached != NULL) {
+		const float *samps = cached->samples();
+		for (long i = 0; i < table_samps; i++)
+			block[i] = (double) samps[i];
+		SampleCache::release(cached);
+	}
+	else {
+		int status = _decode_soundfile(fd, data_format, data_location, file_chans,
+									   start_frame, table_frames, inchan, block);
+		if (status != 0)
+			return status;
+		if (cacheable && RTOption::sampleCacheMB() > 0) {
+			float *samps = new float[table_samps];
+			for (long i = 0; i < table_samps; i++)
+				samps[i] = (float) block[i];
+			SampleCache::release(SampleCache::insert(fname, start_frame, table_frames,
+													 inchan, samps, table_samps));
+		}
+	}
 	sndlib_close(fd, 0, 0, 0, 0);
 
     if (table_samps > INT_MAX) {
@@ -656,50 +696,65 @@ readerr:
 //                                                -JGG, 12/2/01, rev 1/25/04
 
 
-// _transition(a, alpha, b, n, output) makes a transition from <a> to <b> in
-// <n> steps, according to transition parameter <alpha>.  It stores the
-// resulting <n> values starting at location <output>.
+// _transition(seg, output) makes a transition from <a> to <b> in <n> steps,
+// according to transition parameter <alpha>, all set up in <seg> by
+// _transition_setup.  It stores the resulting <n> values starting at
+// location <output>.
 //    alpha = 0 yields a straight line,
 //    alpha < 0 yields a logarithmic transition, and 
 //    alpha > 0 yields an exponential transition.
 // All of this in accord with the formula:
 //    output[i] = a + (b - a) * (1 - exp(i * alpha / (n-1))) / (1 - exp(alpha))
 //    for 0 <= i < n
+// Both _transition and the lazy curve table compute each value with
+// _transition_value.
+
+struct CurveSegment {
+	int start, n;
+	double a, delta, alpha, interval, denom;
+};
 
 static void
-_transition(double a, double alpha, double b, int n, double *output)
+_transition_setup(double a, double alpha, double b, int n, CurveSegment *seg)
 {
-	int	 i;
-	double delta, interval = 0.0;
-
-	delta = b - a;
+	seg->n = n;
+	seg->a = a;
+	seg->delta = b - a;
+	seg->alpha = alpha;
+	seg->interval = (n > 1) ? 1.0 / (n - 1.0) : 0.0;
+	seg->denom = (alpha != 0.0) ? 1.0 / (1.0 - exp(alpha)) : 0.0;
+}
 
-	if (n <= 1) {
-		rtcmix_warn("maketable (curve)", "Trying to transition over 1 array slot; "
-										  "time between points is too short");
-		*output = a;
-		return;
-	}
-	interval = 1.0 / (n - 1.0);
+static inline double
+_transition_value(const CurveSegment *seg, int i)
+{
+	if (seg->n <= 1)
+		return seg->a;
+	if (seg->alpha != 0.0)
+		return (seg->a + seg->delta
+							* (1.0 - exp((double) i * seg->alpha * seg->interval)) * seg->denom);
+	return seg->a + seg->delta * i * seg->interval;
+}
 
-	if (alpha != 0.0) {
-		double denom = 1.0 / (1.0 - exp(alpha));
-		for (i = 0; i < n; i++)
-			*output++ = (a + delta
-								* (1.0 - exp((double) i * alpha * interval)) * denom);
-	}
-	else
-		for (i = 0; i < n; i++)
-			*output++ = a + delta * i * interval;
+static void
+_transition(const CurveSegment *seg, double *output)
+{
+	for (int i = 0; i < seg->n; i++)
+		*output++ = _transition_value(seg, i);
 }
 
 #define MAX_CURVE_PTS 256
 
+// Check the arguments for a curve table of length <len>, and divide it into
+// the segments that _curve_table fills with _transition.  Each segment's
+// last value is overwritten by the first value of the next one.
+
 static int
-_curve_table(const Arg args[], const int nargs, double *array, const int len)
+_curve_segments(const Arg args[], const int nargs, const int len,
+	std::vector<CurveSegment> &segments)
 {
-	int	 i, points, seglen = 0;
-	double factor, *ptr;
+	int	 i, points, start = 0;
+	double factor;
 	double time[MAX_CURVE_PTS], value[MAX_CURVE_PTS], alpha[MAX_CURVE_PTS];
 
 	if (len < 2)
@@ -729,11 +784,16 @@ _curve_table(const Arg args[], const int nargs, double *array, const int len)
 	for (i = 0; i < points; i++)
 		time[i] *= factor;
 
-	ptr = array;
 	for (i = 0; i < points - 1; i++) {
-		seglen = (int) (floor(time[i + 1] + 0.5) - floor(time[i] + 0.5)) + 1;
-		_transition(value[i], alpha[i], value[i + 1], seglen, ptr);
-		ptr += seglen - 1;
+		CurveSegment seg;
+		seg.start = start;
+		const int seglen = (int) (floor(time[i + 1] + 0.5) - floor(time[i] + 0.5)) + 1;
+		if (seglen <= 1)
+			rtcmix_warn("maketable (curve)", "Trying to transition over 1 array slot; "
+											  "time between points is too short");
+		_transition_setup(value[i], alpha[i], value[i + 1], seglen, &seg);
+		segments.push_back(seg);
+		start += seglen - 1;
 	}
 
 	return 0;
@@ -741,6 +801,18 @@ time_err:
 	return die("maketable (curve)", "Times must be in ascending order.");
 }
 
+static int
+_curve_table(const Arg args[], const int nargs, double *array, const int len)
+{
+	std::vector<CurveSegment> segments;
+	const int status = _curve_segments(args, nargs, len, segments);
+	if (status != 0)
+		return status;
+	for (size_t i = 0; i < segments.size(); i++)
+		_transition(&segments[i], array + segments[i].start);
+	return 0;
+}
+
 
 // ----------------------------------------------------------- _expbrk_table ---
 // Similar to gen 5, but no normalization.
@@ -808,8 +880,30 @@ _expbrk_table(const Arg args[], const int nargs, double *array, const int len)
 // -JGG, 1/25/04
 
 #define NEWWAY
+
+// The values array[l - 1], for l from <j> to <i>, that _line_table fills
+// with one straight segment.  Both _line_table and the lazy line table
+// compute each value with _line_value.
+
+struct LineSegment {
+	int j, i;
+	double thisval, nextval;
+};
+
+static inline double
+_line_value(const LineSegment *seg, int l)
+{
+	return seg->thisval + (seg->nextval - seg->thisval)
+										* (double) (l - seg->j) / ((seg->i - seg->j) + 1);
+}
+
+// Check the arguments for a line table of length <len>, and divide it into
+// segments.  Under NEWWAY, the last value is set apart from the segments to
+// equal the last argument.
+
 static int
-_line_table(const Arg args[], const int nargs, double *array, const int len)
+_line_segments(const Arg args[], const int nargs, const int len,
+	std::vector<LineSegment> &segments)
 {
 	if (len < 2)
 		return die("maketable (line)", "Table length must be at least 2.");
@@ -848,13 +942,34 @@ _line_table(const Arg args[], const int nargs, double *array, const int len)
 		i = (int) ((nexttime * scaler) + 1.0);
 #endif
 		//printf("j=%d, i=%d\n", j, i);
-		for (int l = j; l <= i; l++) {
-			if (l <= len)
-				array[l - 1] = thisval + (nextval - thisval)
-														* (double) (l - j) / ((i - j) + 1);
+		if (j <= i) {
+			LineSegment seg;
+			seg.j = j;
+			seg.i = i;
+			seg.thisval = thisval;
+			seg.nextval = nextval;
+			segments.push_back(seg);
 		}
 		thistime = nexttime;
 	}
+
+	return 0;
+}
+
+static int
+_line_table(const Arg args[], const int nargs, double *array, const int len)
+{
+	std::vector<LineSegment> segments;
+	const int status = _line_segments(args, nargs, len, segments);
+	if (status != 0)
+		return status;
+	for (size_t n = 0; n < segments.size(); n++) {
+		const LineSegment *seg = &segments[n];
+		for (int l = seg->j; l <= seg->i; l++) {
+			if (l <= len)
+				array[l - 1] = _line_value(seg, l);
+		}
+	}
 #ifdef NEWWAY
 	array[len - 1] = (double) args[nargs - 1];
 #endif
@@ -1132,16 +1247,14 @@ _wave3_table(const Arg args[], const int nargs, double *array, const int len)
 		assert(j < nargs);
 
 		if ((double) args[j - 1] != 0.0) {
-			for (int i = 0; i < len; i++) {
-				double val;
-				if ((double)args[j - 2] == 0.0) val = 1.0; // BGG: harmonic 0 (DC)
-				else {
-					val = sin(TWOPI * ((double) i
-										/ ((double) len / (double) args[j - 2])
-										+ (double) args[j] / 360.0));
-				}
-				array[i] += (val * (double) args[j - 1]);
+			if ((double) args[j - 2] == 0.0) {	// BGG: harmonic 0 (DC)
+				for (int i = 0; i < len; i++)
+					array[i] += (double) args[j - 1];
 			}
+			else
+				addsine(array, len,
+						TWOPI / ((double) len / (double) args[j - 2]),
+						TWOPI * ((double) args[j] / 360.0), (double) args[j - 1]);
 		}
 	}
 
@@ -1488,14 +1601,15 @@ _string_to_tablekind(const char *str)
 	return InvalidTable;
 }
 
-int
-_dispatch_table(const Arg args[], const int nargs, const int startarg,
-	double **array, int *len)
+// Find the table kind named by args[0], and flatten any one-dimensional
+// parser arrays in args[startarg] on into a new argument list, <xargs>.
+
+static int
+_table_args(const Arg args[], const int nargs, const int startarg,
+	TableKind *kind, Arg xargs[], int *count)
 {
-	int status;
 	TableKind tablekind;
 
-	// Call the appropriate factory function, skipping over first two args.
 	if (args[0].isType(DoubleType))
 		tablekind = (TableKind) (int) args[0];
 	else if (args[0].isType(StringType)) {
@@ -1507,10 +1621,6 @@ _dispatch_table(const Arg args[], const int nargs, const int startarg,
 	else
 		return die("maketable", "First argument must be a number or string.");
 
-	// Flatten any one-dimensional parser arrays into a new argument list,
-	// beginning from <startarg>.
-
-	Arg xargs[MAXDISPARGS];
 	int nxargs = 0;
 	for (int i = startarg; i < nargs; i++) {
 		if (args[i].isType(ArrayType)) {
@@ -1534,6 +1644,66 @@ _dispatch_table(const Arg args[], const int nargs, const int startarg,
 		}
 	}
 
+	*kind = tablekind;
+	*count = nxargs;
+	return 0;
+}
+
+// Whether a table of this kind should go in the table cache (TableCache.h),
+// and if so, its key: a tag naming the kind and any string argument (as in
+// "wave", "square10"), and the numeric arguments.
+
+static bool
+_table_cache_key(const TableKind kind, const Arg args[], const int nargs,
+	const int len, char tag[], const int tagsize, double keyargs[],
+	int *nkeyargs)
+{
+	if (len < TABLE_CACHE_MIN_LEN || RTOption::tableCacheDir()[0] == 0)
+		return false;
+	if (kind != WaveTable && kind != Wave3Table && kind != ChebyTable
+													&& kind != WindowTable)
+		return false;
+
+	int first = 0;
+	int n = snprintf(tag, tagsize, "maketable %s", _table_name[kind]);
+	if (nargs > 0 && args[0].isType(StringType)) {
+		n += snprintf(tag + n, tagsize - n, " %s", (const char *) args[0]);
+		first = 1;
+	}
+	if (n >= tagsize)
+		return false;
+	int count = 0;
+	for (int i = first; i < nargs; i++) {
+		if (!args[i].isType(DoubleType))
+			return false;
+		keyargs[count++] = args[i];
+	}
+	*nkeyargs = count;
+	return true;
+}
+
+int
+_dispatch_table(const Arg args[], const int nargs, const int startarg,
+	double **array, int *len)
+{
+	int status;
+	TableKind tablekind;
+	Arg xargs[MAXDISPARGS];
+	int nxargs;
+
+	// Call the appropriate factory function, skipping over first two args.
+	status = _table_args(args, nargs, startarg, &tablekind, xargs, &nxargs);
+	if (status != 0)
+		return status;
+
+	char tag[128];
+	double keyargs[MAXDISPARGS];
+	int nkeyargs = 0;
+	const bool cached = _table_cache_key(tablekind, xargs, nxargs, *len,
+										tag, sizeof(tag), keyargs, &nkeyargs);
+	if (cached && table_cache_find(tag, keyargs, nkeyargs, *array, *len))
+		return 0;
+
 	// NOTE: passing addresses of array and len is correct for some of these
    //       tables, because they might need to recreate their array.
 
@@ -1588,6 +1758,159 @@ _dispatch_table(const Arg args[], const int nargs, const int startarg,
 			break;
 	}
 
+	if (cached && status == 0)
+		table_cache_store(tag, keyargs, nkeyargs, *array, *len);
+
+	return status;
+}
+
+
+// ------------------------------------------------------------- lazy tables ---
+// Line and curve tables at least LAZY_TABLE_LEN long are not filled in when
+// they are made.  Instead, their TablePField computes each value from the
+// segments when it is read, with the same arithmetic as _line_table and
+// _curve_table, so a lazy table holds exactly the values the array would.
+// The array is made only if something asks for it.
+
+#define LAZY_TABLE_LEN 16384
+
+class SegmentTableGenerator : public TableGenerator {
+public:
+	virtual double valueAt(int index) const {
+		const double value = rawValueAt(index);
+		return (_divisor != 0.0) ? value / _divisor : value;
+	}
+	// Do what _normalize_table would do to the array.  Within a segment the
+	// values move steadily from one end to the other, so the largest one is
+	// at the end of a segment, or next to where a later one overwrites it.
+	void normalize(const std::vector<int> &ends) {
+		double max = 0.0;
+		for (size_t n = 0; n < ends.size(); n++) {
+			if (ends[n] < 0 || ends[n] >= _len)
+				continue;
+			const double absval = fabs(rawValueAt(ends[n]));
+			if (absval > max)
+				max = absval;
+		}
+		_divisor = max;			// i.e., max / peak, with peak 1
+	}
+protected:
+	SegmentTableGenerator(int len) : _len(len), _divisor(0.0) {}
+	virtual double rawValueAt(int index) const = 0;
+	const int _len;
+private:
+	double _divisor;			// zero if not normalized
+};
+
+class LineTableGenerator : public SegmentTableGenerator {
+public:
+	LineTableGenerator(const std::vector<LineSegment> &segments,
+							double lastval, int len, bool normalize)
+		: SegmentTableGenerator(len), _segments(segments), _lastval(lastval)
+	{
+		if (normalize) {
+			std::vector<int> ends;
+			for (size_t n = 0; n < _segments.size(); n++) {
+				ends.push_back(_segments[n].j - 1);
+				ends.push_back(_segments[n].i - 1);
+			}
+			ends.push_back(len - 2);
+			ends.push_back(len - 1);
+			this->normalize(ends);
+		}
+	}
+protected:
+	virtual double rawValueAt(int index) const {
+#ifdef NEWWAY
+		if (index == _len - 1)
+			return _lastval;
+#endif
+		const int l = index + 1;
+		int lo = 0, hi = (int) _segments.size() - 1;
+		while (lo <= hi) {
+			const int mid = (lo + hi) / 2;
+			const LineSegment *seg = &_segments[mid];
+			if (l < seg->j)
+				hi = mid - 1;
+			else if (l > seg->i)
+				lo = mid + 1;
+			else
+				return _line_value(seg, l);
+		}
+		return 0.0;				// not filled in by _line_table either
+	}
+private:
+	const std::vector<LineSegment> _segments;
+	const double _lastval;
+};
+
+class CurveTableGenerator : public SegmentTableGenerator {
+public:
+	CurveTableGenerator(const std::vector<CurveSegment> &segments, int len,
+							bool normalize)
+		: SegmentTableGenerator(len), _segments(segments)
+	{
+		if (normalize) {
+			std::vector<int> ends;
+			for (size_t n = 0; n < _segments.size(); n++) {
+				ends.push_back(_segments[n].start - 1);
+				ends.push_back(_segments[n].start);
+				ends.push_back(_segments[n].start + _segments[n].n - 1);
+			}
+			this->normalize(ends);
+		}
+	}
+protected:
+	// Later segments overwrite earlier ones, so use the last one starting
+	// at or before <index>.
+	virtual double rawValueAt(int index) const {
+		int lo = 0, hi = (int) _segments.size() - 1, found = -1;
+		while (lo <= hi) {
+			const int mid = (lo + hi) / 2;
+			if (_segments[mid].start <= index) {
+				found = mid;
+				lo = mid + 1;
+			}
+			else
+				hi = mid - 1;
+		}
+		if (found < 0 || index - _segments[found].start >= _segments[found].n)
+			return 0.0;			// not filled in by _curve_table either
+		return _transition_value(&_segments[found], index - _segments[found].start);
+	}
+private:
+	const std::vector<CurveSegment> _segments;
+};
+
+// Return a generator for a lazy table, or NULL if this one should be filled
+// in now (in which case, for a lazy kind, the arguments have been checked).
+
+static int
+_lazy_table(const Arg args[], const int nargs, const int startarg,
+	const int len, const bool normalize, TableGenerator **generator)
+{
+	*generator = NULL;
+	if (len < LAZY_TABLE_LEN)
+		return 0;
+	TableKind tablekind;
+	Arg xargs[MAXDISPARGS];
+	int nxargs;
+	int status = _table_args(args, nargs, startarg, &tablekind, xargs, &nxargs);
+	if (status != 0)
+		return status;
+	if (tablekind == LineTable) {
+		std::vector<LineSegment> segments;
+		status = _line_segments(xargs, nxargs, len, segments);
+		if (status == 0)
+			*generator = new LineTableGenerator(segments,
+									(double) xargs[nxargs - 1], len, normalize);
+	}
+	else if (tablekind == CurveTable) {
+		std::vector<CurveSegment> segments;
+		status = _curve_segments(xargs, nxargs, len, segments);
+		if (status == 0)
+			*generator = new CurveTableGenerator(segments, len, normalize);
+	}
 	return status;
 }
 
@@ -1626,6 +1949,23 @@ typedef enum {
 	kInterp2ndOrder
 } InterpType;
 
+// For maketable("literal", ..., size, array): the array, which is filled in
+// directly rather than flattened into an argument list, so that it is not
+// limited to MAXDISPARGS values.  NULL for any other table.
+
+static const Array *
+_literal_array(const Arg args[], const int nargs, const int lenindex)
+{
+	if (nargs != lenindex + 2 || !args[lenindex + 1].isType(ArrayType))
+		return NULL;
+	TableKind kind = InvalidTable;
+	if (args[0].isType(StringType))
+		kind = _string_to_tablekind((const char *) args[0]);
+	else if (args[0].isType(DoubleType))
+		kind = (TableKind) (int) args[0];
+	return (kind == LiteralTable) ? (const Array *) args[lenindex + 1] : NULL;
+}
+
 Handle
 maketable(const Arg args[], const int nargs)
 {
@@ -1637,6 +1977,8 @@ maketable(const Arg args[], const int nargs)
 	bool normalize = true;
 	InterpType interp = kInterp1stOrder;
 	bool dynamic = false;
+	bool bandlimit = false;
+	bool storeFloats = RTOption::floatTables();
 
 	int lenindex = 1;					// following table type string w/ no options
 	for (int i = lenindex; i < nargs; i++) {
@@ -1656,6 +1998,14 @@ maketable(const Arg args[], const int nargs)
 			dynamic = true;
 			normalize = false;
 		}
+		else if (args[i] == "float")
+			storeFloats = true;
+		else if (args[i] == "double")
+			storeFloats = false;
+		// One cycle of a waveform, with band-limited copies an octave apart
+		// for oscillators such as WAVETABLE to read at high pitches.
+		else if (args[i] == "bandlimit")
+			bandlimit = true;
 		else {
 			die("maketable", "Invalid string option \"%s\".",
 													(const char *) args[i]);
@@ -1679,6 +2029,35 @@ maketable(const Arg args[], const int nargs)
 		len = MAX_ARRAY_LEN;
 	}
 
+	TablePField::InterpFunction interpFunction = TablePField::Interpolate1stOrder;
+	if (interp == kTruncate)
+		interpFunction = TablePField::Truncate;
+	else if (interp == kInterp2ndOrder)
+		interpFunction = TablePField::Interpolate2ndOrder;
+
+	if (bandlimit && dynamic) {
+		die("maketable", "A \"dynamic\" table can't be band-limited.");
+		return NULL;
+	}
+
+	// Memory lent by the front end (e.g., a NumPy array) is read in place,
+	// if nothing would change the values.
+	const Array *literal = _literal_array(args, nargs, lenindex);
+	if (literal != NULL && literal->lease != NULL && (len == 0 || len == (int) literal->len)
+			&& !normalize && !dynamic && !bandlimit && !storeFloats)
+		return createPFieldHandle(new TablePField(literal->data, literal->len,
+												  literal->lease, interpFunction));
+
+	if (!dynamic && !bandlimit) {
+		TableGenerator *generator;
+		if (_lazy_table(args, nargs, lenindex + 1, len, normalize, &generator) != 0) {
+			rtOptionalThrow(PARAM_ERROR);
+			return NULL;				// error message already given
+		}
+		if (generator != NULL)
+			return createPFieldHandle(new TablePField(generator, len, interpFunction));
+	}
+
 	// Allocate table array.  TablePField will own and delete this.
 	
 	double *data = NULL;
@@ -1690,7 +2069,24 @@ maketable(const Arg args[], const int nargs)
 		}
 	}
 
-	if (!dynamic) {
+	if (literal != NULL && !dynamic) {
+		if (len == 0) {
+			len = literal->len;
+			data = new double[len > 0 ? len : 1];
+		}
+		const int fill = _min((int) literal->len, len);
+		memcpy(data, literal->data, fill * sizeof(double));
+		for (int i = fill; i < len; i++)
+			data[i] = 0.0;
+		if (fill < len)
+			rtcmix_advise("maketable (literal)",
+							"Table is larger than the number of elements given "
+							"to fill it.  Adding zeros to pad.");
+		else if (len < (int) literal->len)
+			rtcmix_warn("maketable (literal)",
+							"Table is large enough for only %d numbers.", len);
+	}
+	else if (!dynamic) {
 		if (_dispatch_table(args, nargs, lenindex + 1, &data, &len) != 0) {
 			delete [] data;
             rtOptionalThrow(PARAM_ERROR);
@@ -1730,13 +2126,32 @@ maketable(const Arg args[], const int nargs)
 	if (normalize)
 		_normalize_table(data, len, 1.0);
 
+	Omipmap *mipmap = NULL;
+	if (bandlimit && len > 0) {
+		if (len >= 32768) {
+			delete [] data;
+			die("maketable", "A band-limited table must have fewer than "
+								"32768 values.");
+			return NULL;
+		}
+		mipmap = new Omipmap(data, len);
+	}
+
 	TablePField *table;
-	if (interp == kInterp1stOrder)
+	if (storeFloats && !dynamic) {
+		float *floatData = new float[len];
+		for (int i = 0; i < len; i++)
+			floatData[i] = (float) data[i];
+		delete [] data;
+		table = new TablePField(floatData, len, interpFunction);
+	}
+	else if (interp == kInterp1stOrder)
 		table = new TablePField(data, len);
 	else if (interp == kTruncate)
 		table = new TablePField(data, len, TablePField::Truncate);
 	else // interp == kInterp2ndOrder
 		table = new TablePField(data, len, TablePField::Interpolate2ndOrder);
+	table->setMipmap(mipmap);
 
 	return createPFieldHandle(table);
 }
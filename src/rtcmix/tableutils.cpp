@@ -109,12 +109,8 @@ void fill_wave_table(const Arg args[], const int nargs, double *array,
 		array[i] = 0.0;
 	int j = nargs;
 	while (j--) {
-		if ((double) args[j] != 0.0) {
-			for (int i = 0; i < len; i++) {
-				double val = TWOPI * (double) i / (len / (j + 1));
-				array[i] += (sin(val) * (double) args[j]);
-			}
-		}
+		if ((double) args[j] != 0.0)
+			addsine(array, len, TWOPI / (len / (j + 1)), 0.0, (double) args[j]);
 	}
 }
 
@@ -8,6 +8,7 @@
 
 static float xtime[TLENP],temp[TLENP],rxtime[TLENP],accel[TLENP],BASIS = 60.;
 static short tset = 0,npts;
+static short tsorted = 0;	/* xtime[] and rxtime[] never decrease */
 
 float time_beat(float timein);
 float beat_time(float beatin);
@@ -62,6 +63,14 @@ tempo(double p[], int n_args)
 		}
 		prvbt = rxtime[m+1];
 	}
+	/* Scores give the times in order, so conversions can search by halves.
+	   If not (or with a negative tempo), they walk the segments instead.
+	*/
+	tsorted = 1;
+	for(m=0; m<npts; m++) {
+		if (!(xtime[m+1] >= xtime[m] && rxtime[m+1] >= rxtime[m]))
+			tsorted = 0;
+	}
 /*
 for(m=0; m<=npts; m++) printf("%d %f %f %f %f\n",m,temp[m],accel[m],rxtime[m],xtime[m]);
 */
@@ -69,6 +78,37 @@ for(m=0; m<=npts; m++) printf("%d %f %f %f %f\n",m,temp[m],accel[m],rxtime[m],xt
 }
 
 
+/* Return the segment m for which bound[m] < value <= bound[m+1], or npts+1
+   if there is none.
+*/
+static int
+find_segment(const float bound[], float value)
+{
+	int m, lo, hi;
+
+	if (!tsorted) {
+		for(m=0; m<=npts; m++) {
+			if (value > bound[m] && value <= bound[m+1])
+				break;
+		}
+		return m;
+	}
+	/* Find the first k in [1, npts] with value <= bound[k]. */
+	if (!(value > bound[0]) || value > bound[npts])
+		return npts + 1;
+	lo = 1;
+	hi = npts;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (value <= bound[mid])
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo - 1;
+}
+
+
 float
 time_beat(float timein)
 {
@@ -81,12 +121,9 @@ time_beat(float timein)
 	if(!tset) return(timein);
 
     if (timein > 0.0f) {
-        for(m=0; m<=npts; m++) {
-            if(timein > xtime[m] && timein <= xtime[m+1]) {
-                durp = timein-xtime[m];
-                break;
-            }
-        }
+        m = find_segment(xtime, timein);
+        if (m <= npts)
+            durp = timein-xtime[m];
     }
     if (accel[m] == 0.0f) {
         return(durp/temp[m] + rxtime[m]);
@@ -103,13 +140,8 @@ beat_time(float beatin)    /* returns beats from times */
 	int m=0;
 	if(!tset) return(beatin);
 
-    if (beatin != 0.0f) {
-        for(m=0; m<=npts; m++) {
-            if (beatin > rxtime[m] && beatin <= rxtime[m+1]) {
-                break;
-            }
-        }
-    }
+    if (beatin != 0.0f)
+        m = find_segment(rxtime, beatin);
     if (accel[m] == 0.0f) {
         return((beatin-rxtime[m])*temp[m] + xtime[m]);
     }
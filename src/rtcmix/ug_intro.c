@@ -52,6 +52,7 @@ ug_intro()
 	UG_INTRO_DOUBLE_RETURN("filepeak", filepeak);
 	UG_INTRO_DOUBLE_RETURN("filerms", filerms);
 	UG_INTRO_DOUBLE_RETURN("filedc", filedc);
+	UG_INTRO_DOUBLE_RETURN("sfprescan", sfprescan);
 	UG_INTRO_DOUBLE_RETURN("bus_exists", bus_exists);
 	UG_INTRO_DOUBLE_RETURN("bus_link", bus_link);
 	UG_INTRO_DOUBLE_RETURN("getPFval", getPFval);
@@ -129,6 +130,8 @@ ug_intro()
 	UG_INTRO("n_arg",n_arg); /* to return num args from command line */
 	UG_INTRO("print_on",m_print_is_on); /* to turn on printing*/
 	UG_INTRO("print_off",m_print_is_off); /* to turn off printing*/
+	UG_INTRO("print_stats",m_print_stats); /* to print dsp_stats */
+	UG_INTRO("print_mem_stats",m_print_mem_stats); /* to print memory use */
 	UG_INTRO("get_spray",m_get_spray);
 	UG_INTRO("spray_init",m_spray_init);
 	UG_INTRO("pchmidi", m_pchmidi);
@@ -100,3 +100,35 @@ unrefHandle(Handle h)
 }	
 
 
+
+// Leases whose last reference has gone, waiting for releaseArrayLeases().
+// They are pushed from any thread, so this is a lock-free stack.
+
+static ArrayLease * volatile sReleasedLeases = NULL;
+
+void refArrayLease(ArrayLease *lease)
+{
+	__sync_add_and_fetch(&lease->refcount, 1);
+}
+
+void unrefArrayLease(ArrayLease *lease)
+{
+	assert(lease->refcount > 0);
+	if (__sync_sub_and_fetch(&lease->refcount, 1) == 0) {
+		ArrayLease *head;
+		do {
+			head = sReleasedLeases;
+			lease->next = head;
+		} while (!__sync_bool_compare_and_swap(&sReleasedLeases, head, lease));
+	}
+}
+
+void releaseArrayLeases()
+{
+	ArrayLease *lease = __sync_lock_test_and_set(&sReleasedLeases, (ArrayLease *) NULL);
+	while (lease != NULL) {
+		ArrayLease *next = lease->next;
+		(*lease->release)(lease);
+		lease = next;
+	}
+}
@@ -18,6 +18,11 @@ extern "C" {
 #endif	// __cplusplus
 	void refHandle(Handle h);
 	void unrefHandle(Handle h);
+	void refArrayLease(ArrayLease *lease);
+	void unrefArrayLease(ArrayLease *lease);
+	// Call <release> for each lease no longer referred to.  Front ends that
+	// lend arrays call this before each call into RTcmix.
+	void releaseArrayLeases(void);
 #ifdef __cplusplus
 }
 #endif	// __cplusplus
@@ -0,0 +1,293 @@
+//
+//  benchmark.cpp
+//  RTcmix engine benchmark
+//
+//  Renders each of the workload scores in bench/ as fast as possible through
+//  the embedded API, with no audio device, and prints the results as JSON
+//  for comparing one build against another:
+//
+//     frames_per_sec    frames rendered per second of wall-clock time
+//     realtime_factor   how many times faster than real time that is
+//     slice_usec        percentiles of the time taken by each RTcmix_runAudio()
+//     allocs_per_slice  calls to the global operator new during each one
+//     parse_msec        time taken by RTcmix_parseScore()
+//
+//  Against an ALLOC_TRACKING build of RTcmix, allocs_per_slice is replaced by
+//  rt_allocs, the library's own count of allocations on its real-time
+//  threads; with -v, the count for each instrument goes to stderr.
+//
+//  Each score is prefixed with "N = <scale>", which it uses to size itself.
+//
+//  usage: benchmark [-b bufsize] [-r srate] [-c chans] [-n scale]
+//                   [-d scoredir] [-l label] [-v] [workload ...]
+//
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <RTcmix_API.h>
+
+#ifndef EMBEDDED
+#error This code cannot be compiled unless the system is configured for an EMBEDDED system
+#endif
+
+struct Workload {
+	const char *name;
+	const char *score;
+	int			scale;		// default value of N
+};
+
+static const Workload sWorkloads[] = {
+	{ "wavetable",	"wavetable.sco",	200 },	// N simultaneous notes
+	{ "auxbus",		"auxbus.sco",		32 },	// N three-stage aux chains
+	{ "granular",	"granular.sco",		8 },	// N dense grain streams
+	{ "fft",		"fft.sco",			4 },	// N SPECTACLE2 notes
+	{ "streaming",	"streaming.sco",	32 },	// N notes reading a file
+	{ "parse",		"parse.sco",		50 },	// N thousand loop passes
+	{ NULL, NULL, 0 }
+};
+
+// Count global allocations.  Instruments come from their own pool, so
+// these are what the engine allocates around them.  An ALLOC_TRACKING
+// library does its own counting, and this would hide it.
+
+static volatile long sAllocCount = 0;
+
+#ifndef ALLOC_TRACKING
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+	__sync_fetch_and_add(&sAllocCount, 1);
+	void *ptr = malloc(size ? size : 1);
+	if (ptr == NULL)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void *operator new[](size_t size) throw(std::bad_alloc)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+	free(ptr);
+}
+
+#endif	// ALLOC_TRACKING
+
+static bool sVerbose = false;
+static bool sDone = false;
+
+static void PrintCallback(const char *printBuffer, void *inContext)
+{
+	if (sVerbose && printBuffer != NULL)
+		fprintf(stderr, "%s", printBuffer);
+}
+
+static void DoneCallback(long long frames, void *inContext)
+{
+	sDone = true;
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+}
+
+static bool readScore(const std::string &path, std::string &outText)
+{
+	FILE *file = fopen(path.c_str(), "r");
+	if (file == NULL) {
+		perror(path.c_str());
+		return false;
+	}
+	char buf[8192];
+	size_t count;
+	while ((count = fread(buf, 1, sizeof(buf), file)) > 0)
+		outText.append(buf, count);
+	fclose(file);
+	return true;
+}
+
+static double percentile(const std::vector<double> &sorted, double pct)
+{
+	if (sorted.empty())
+		return 0.0;
+	size_t index = (size_t) (pct * 0.01 * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+static bool runWorkload(const Workload &workload, int scale, const char *scoreDir,
+						float srate, int chans, int bufsize, bool first)
+{
+	std::string text;
+	char header[64];
+	snprintf(header, sizeof(header), "N = %d\n", scale);
+	text = header;
+	if (!readScore(std::string(scoreDir) + "/" + workload.score, text))
+		return false;
+
+	// Never run longer than this, in case the score never finishes
+	const long long maxFrames = (long long) (600 * srate);
+	std::vector<float> audio(bufsize * chans);
+	std::vector<double> sliceUsec;
+	double allocTotal = 0.0;
+	long allocMax = 0;
+	long long frames = 0;
+
+	RTcmix_getAllocStats(NULL, NULL, 0, 1);
+	sDone = false;
+	double start = now();
+	const int status = RTcmix_parseScore(&text[0], (int) text.size());
+	const double parseSec = now() - start;
+
+	start = now();
+	while (status == 0 && !sDone && frames < maxFrames) {
+		const long allocs = sAllocCount;
+		const double sliceStart = now();
+		if (RTcmix_runAudio(NULL, &audio[0], bufsize) != 0)
+			break;
+		sliceUsec.push_back((now() - sliceStart) * 1.0e6);
+		const long sliceAllocs = sAllocCount - allocs;
+		allocTotal += sliceAllocs;
+		if (sliceAllocs > allocMax)
+			allocMax = sliceAllocs;
+		frames += bufsize;
+	}
+	const double renderSec = now() - start;
+	RTcmix_AllocStats rtAllocs;
+	char allocReport[4096];
+	const bool haveRTAllocs = RTcmix_getAllocStats(&rtAllocs, allocReport, sizeof(allocReport), 0) == 0;
+	if (haveRTAllocs && sVerbose)
+		fprintf(stderr, "%s: %s", workload.name, allocReport);
+
+	// Leave nothing behind for the next workload
+	RTcmix_flushScore();
+	for (int n = 0; n < 4; ++n)
+		RTcmix_runAudio(NULL, &audio[0], bufsize);
+
+	const int slices = (int) sliceUsec.size();
+	std::sort(sliceUsec.begin(), sliceUsec.end());
+	printf("%s    {\n", first ? "" : ",\n");
+	printf("      \"name\": \"%s\",\n", workload.name);
+	printf("      \"scale\": %d,\n", scale);
+	if (status != 0)
+		printf("      \"error\": \"score failed to parse\",\n");
+	else if (!sDone)
+		printf("      \"error\": \"score did not finish\",\n");
+	printf("      \"parse_msec\": %.3f,\n", parseSec * 1000.0);
+	printf("      \"frames\": %lld,\n", frames);
+	printf("      \"slices\": %d,\n", slices);
+	printf("      \"seconds\": %.6f,\n", renderSec);
+	printf("      \"frames_per_sec\": %.1f,\n", renderSec > 0.0 ? frames / renderSec : 0.0);
+	printf("      \"realtime_factor\": %.3f,\n", renderSec > 0.0 ? frames / srate / renderSec : 0.0);
+	printf("      \"slice_usec\": { \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f },\n",
+		   percentile(sliceUsec, 50), percentile(sliceUsec, 90),
+		   percentile(sliceUsec, 99), slices > 0 ? sliceUsec.back() : 0.0);
+	if (haveRTAllocs)
+		printf("      \"rt_allocs\": { \"total\": %lld, \"buffers\": %lld, \"worst_buffer\": %d }\n",
+			   rtAllocs.allocations, rtAllocs.buffers, rtAllocs.worstBuffer);
+	else
+		printf("      \"allocs_per_slice\": { \"mean\": %.3f, \"max\": %ld }\n",
+			   slices > 0 ? allocTotal / slices : 0.0, allocMax);
+	printf("    }");
+	return status == 0 && sDone;
+}
+
+static void usage(const char *program)
+{
+	fprintf(stderr, "usage: %s [-b bufsize] [-r srate] [-c chans] [-n scale] "
+			"[-d scoredir] [-l label] [-v] [workload ...]\nworkloads:", program);
+	for (const Workload *w = sWorkloads; w->name != NULL; ++w)
+		fprintf(stderr, " %s", w->name);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int bufsize = 256;
+	float srate = 44100;
+	int chans = 2;
+	int scale = 0;			// 0 means each workload's own default
+	const char *scoreDir = "bench";
+	const char *label = "";
+	std::vector<const Workload *> selected;
+
+	for (int arg = 1; arg < argc; ++arg) {
+		const char *a = argv[arg];
+		if (a[0] == '-') {
+			if (a[1] == 'v') {
+				sVerbose = true;
+				continue;
+			}
+			if (arg + 1 >= argc)
+				usage(argv[0]);
+			const char *value = argv[++arg];
+			switch (a[1]) {
+			case 'b': bufsize = atoi(value); break;
+			case 'r': srate = atof(value); break;
+			case 'c': chans = atoi(value); break;
+			case 'n': scale = atoi(value); break;
+			case 'd': scoreDir = value; break;
+			case 'l': label = value; break;
+			default: usage(argv[0]);
+			}
+		}
+		else {
+			const Workload *w;
+			for (w = sWorkloads; w->name != NULL; ++w)
+				if (strcmp(w->name, a) == 0)
+					break;
+			if (w->name == NULL)
+				usage(argv[0]);
+			selected.push_back(w);
+		}
+	}
+	if (selected.empty())
+		for (const Workload *w = sWorkloads; w->name != NULL; ++w)
+			selected.push_back(w);
+
+	RTcmix_setPrintCallback(PrintCallback, NULL);
+	RTcmix_setFinishedCallback(DoneCallback, NULL);
+	RTcmix_setPrintLevel(sVerbose ? 5 : 0);
+	if (RTcmix_init() != 0) {
+		fprintf(stderr, "RTcmix_init failed\n");
+		return 1;
+	}
+	RTcmix_setAudioBufferFormat(AudioFormat_32BitFloat_Normalized, chans);
+	if (RTcmix_setparams(srate, chans, bufsize, 0, 512) != 0) {
+		fprintf(stderr, "RTcmix_setparams failed\n");
+		return 1;
+	}
+
+	printf("{\n");
+	printf("  \"label\": \"%s\",\n", label);
+	printf("  \"srate\": %g,\n", srate);
+	printf("  \"chans\": %d,\n", chans);
+	printf("  \"buffer_frames\": %d,\n", bufsize);
+	printf("  \"workloads\": [\n");
+	bool ok = true;
+	for (size_t n = 0; n < selected.size(); ++n) {
+		const Workload &w = *selected[n];
+		if (!runWorkload(w, scale > 0 ? scale : w.scale, scoreDir, srate, chans, bufsize, n == 0))
+			ok = false;
+	}
+	printf("\n  ]\n}\n");
+
+	RTcmix_destroy();
+	return ok ? 0 : 1;
+}
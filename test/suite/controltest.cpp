@@ -0,0 +1,174 @@
+// Exercises ControlTable, the table of real-time control values: slots
+// are handed out once each, every write bumps the sequence number by one,
+// a read never pairs a value with another write's sequence number while a
+// writer is busy, and the audio clock maps seconds to frames.  Exits with
+// status 1 on any failure.
+//
+// usage: controltest [-v]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <vector>
+#include <rtdefs.h>
+#include "../../src/rtcmix/ControlTable.h"
+
+static bool verbose = false;
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+	if (verbose || !ok)
+		printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+	if (!ok)
+		failures++;
+}
+
+static void testAllocate()
+{
+	std::vector<int> slots;
+	int slot;
+	while ((slot = ControlTable::allocate(0.5)) >= 0)
+		slots.push_back(slot);
+	bool ok = (slots.size() == ControlTable::kNumSlots - MAX_INLETS);
+	std::vector<int> seen(ControlTable::kNumSlots, 0);
+	for (size_t n = 0; n < slots.size(); n++) {
+		ok = ok && slots[n] >= MAX_INLETS && seen[slots[n]]++ == 0;
+		ok = ok && ControlTable::read(slots[n]) == 0.5;
+	}
+	check(ok, "allocate hands out every free slot once, set to its initial value");
+
+	ControlTable::release(slots[10]);
+	ControlTable::release(slots[20]);
+	const int a = ControlTable::allocate(1.0);
+	const int b = ControlTable::allocate(2.0);
+	check(((a == slots[10] && b == slots[20]) || (a == slots[20] && b == slots[10]))
+		  && ControlTable::allocate(0.0) == -1, "released slots are handed out again");
+	for (size_t n = 0; n < slots.size(); n++)
+		ControlTable::release(slots[n]);
+}
+
+static void testSequence()
+{
+	const int slot = ControlTable::inletSlot(3);
+	unsigned before, after;
+	ControlTable::read(slot, &before);
+	for (int n = 1; n <= 100; n++)
+		ControlTable::write(slot, n);
+	const double value = ControlTable::read(slot, &after);
+	check(value == 100 && after == before + 100 && ControlTable::sequence(slot) == after,
+		  "each write bumps the sequence number by one");
+}
+
+// One thread writes a slot's own sequence number into it, so any read that
+// pairs a value with another write's sequence number shows up.
+
+enum { kWrites = 2000000 };
+
+struct Shared {
+	int slot;
+	unsigned start;
+	volatile bool done;
+};
+
+static void *writeAll(void *arg)
+{
+	Shared *shared = (Shared *) arg;
+	for (unsigned n = 1; n <= kWrites; n++)
+		ControlTable::write(shared->slot, shared->start + n);
+	shared->done = true;
+	return NULL;
+}
+
+static void *writeSome(void *arg)
+{
+	Shared *shared = (Shared *) arg;
+	for (unsigned n = 1; n <= kWrites / 4; n++)
+		ControlTable::write(shared->slot, n);
+	return NULL;
+}
+
+static void testConcurrentReads()
+{
+	Shared shared;
+	shared.slot = ControlTable::allocate(0.0);
+	shared.start = ControlTable::sequence(shared.slot);
+	shared.done = false;
+	pthread_t writer;
+	pthread_create(&writer, NULL, writeAll, &shared);
+	bool matched = true, ascending = true;
+	unsigned last = shared.start;
+	long reads = 0;
+	while (!shared.done) {
+		unsigned sequence;
+		const double value = ControlTable::read(shared.slot, &sequence);
+		if (sequence != shared.start)
+			matched = matched && value == (double) sequence;
+		ascending = ascending && sequence >= last;
+		last = sequence;
+		reads++;
+	}
+	pthread_join(writer, NULL);
+	if (verbose)
+		printf("%ld reads during %d writes\n", reads, kWrites);
+	check(matched && ascending, "reads during writes see whole writes");
+	check(ControlTable::sequence(shared.slot) == shared.start + kWrites,
+		  "sequence number counts every write");
+
+	// Writers sharing a slot must not lose writes.
+	const unsigned start = ControlTable::sequence(shared.slot);
+	pthread_t writers[4];
+	for (int n = 0; n < 4; n++)
+		pthread_create(&writers[n], NULL, writeSome, &shared);
+	for (int n = 0; n < 4; n++)
+		pthread_join(writers[n], NULL);
+	check(ControlTable::sequence(shared.slot) == start + kWrites,
+		  "writers sharing a slot all count");
+	ControlTable::release(shared.slot);
+}
+
+static void *readRenderFrame(void *arg)
+{
+	*(FRAMETYPE *) arg = ControlTable::renderFrame();
+	return NULL;
+}
+
+static void testClock()
+{
+	check(ControlTable::frameAt(1.0) == 0, "no frame before the first buffer");
+	ControlTable::markBuffer(441000, 44100.0);
+	const FRAMETYPE now = ControlTable::frameAt(0.0);
+	const FRAMETYPE later = ControlTable::frameAt(1.0);
+	const FRAMETYPE earlier = ControlTable::frameAt(-1.0);
+	check(now >= 441000 && now < 441000 + 4410, "frameAt(0) is the frame being rendered");
+	check(later - now >= 44100 && later - now < 44100 + 4410, "frameAt counts seconds in frames");
+	check(now - earlier > 44100 - 4410 && now - earlier <= 44101, "frameAt looks back too");
+	check(ControlTable::frameAt(-100.0) == 0, "frameAt stops at frame 0");
+
+	ControlTable::renderFrame(1234, 0.5);
+	FRAMETYPE other = 0;
+	pthread_t thread;
+	pthread_create(&thread, NULL, readRenderFrame, &other);
+	pthread_join(thread, NULL);
+	check(ControlTable::renderFrame() == 1234 && ControlTable::renderPercent() == 0.5
+		  && other == -1, "each thread has its own render frame");
+}
+
+int
+main(int argc, char *argv[])
+{
+	verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+
+	testAllocate();
+	testSequence();
+	testConcurrentReads();
+	testClock();
+
+	if (failures > 0) {
+		printf("ControlTable: %d of the checks failed\n", failures);
+		return 1;
+	}
+	printf("ControlTable reads and writes are consistent\n");
+	return 0;
+}
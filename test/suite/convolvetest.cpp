@@ -0,0 +1,88 @@
+// Compares genlib's Oconvolve with direct convolution, for impulse responses
+// from shorter than one partition to many partitions long, and block sizes
+// like those CONVOLVE1 uses.  Exits with status 1 if any output differs by
+// more than float rounding.
+//
+// usage: convolvetest [-v]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <Ougens.h>
+
+static const double kTolerance = 1.0e-5;	// relative to the output's peak
+
+static float frand()
+{
+	return (float) (2.0 * random() / (double) RAND_MAX - 1.0);
+}
+
+// Returns the largest difference from direct convolution, relative to the
+// peak of the direct result.
+
+static double compare(int blocklen, int implen, int blocks)
+{
+	const int inlen = blocklen * blocks;
+	float *impulse = new float [implen];
+	float *in = new float [inlen];
+	float *out = new float [inlen];
+	for (int i = 0; i < implen; i++)
+		impulse[i] = frand() * expf(-4.0f * i / implen);
+	for (int i = 0; i < inlen; i++)
+		in[i] = frand();
+
+	Oconvolve conv(impulse, implen, blocklen);
+	for (int b = 0; b < blocks; b++)
+		conv.process(&in[b * blocklen], &out[b * blocklen]);
+
+	double peak = 0.0, maxerr = 0.0;
+	for (int n = 0; n < inlen; n++) {
+		double sum = 0.0;
+		const int last = (n < implen - 1) ? n : implen - 1;
+		for (int k = 0; k <= last; k++)
+			sum += (double) impulse[k] * in[n - k];
+		if (fabs(sum) > peak)
+			peak = fabs(sum);
+		const double err = fabs(sum - out[n]);
+		if (err > maxerr)
+			maxerr = err;
+	}
+	delete [] impulse;
+	delete [] in;
+	delete [] out;
+	return (peak > 0.0) ? maxerr / peak : maxerr;
+}
+
+int
+main(int argc, char *argv[])
+{
+	const bool verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+	static const int blocklens[] = { 64, 256, 1024 };
+	// In partitions: less than one, exactly one, a little over, and many.
+	static const double lengths[] = { 0.25, 1.0, 1.5, 2.0, 7.3, 79.0 };
+	int failures = 0;
+
+	srandom(1);
+	for (int b = 0; b < (int) (sizeof(blocklens) / sizeof(int)); b++) {
+		for (int l = 0; l < (int) (sizeof(lengths) / sizeof(double)); l++) {
+			const int blocklen = blocklens[b];
+			const int implen = (int) (lengths[l] * blocklen);
+			const int blocks = (int) lengths[l] + 4;
+			const double err = compare(blocklen, implen, blocks);
+			const bool ok = err <= kTolerance;
+			if (verbose || !ok)
+				printf("block %4d, impulse %6d: error %g%s\n", blocklen, implen,
+								err, ok ? "" : " -- FAILED");
+			if (!ok)
+				failures++;
+		}
+	}
+	if (failures > 0) {
+		printf("Oconvolve: %d of the comparisons with direct convolution failed\n",
+								failures);
+		return 1;
+	}
+	printf("Oconvolve matches direct convolution\n");
+	return 0;
+}
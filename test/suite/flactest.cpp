@@ -0,0 +1,571 @@
+// Encodes known signals with the FlacEncoder that AudioFileDevice uses for
+// "flac" output, then decodes each file with the small decoder below and
+// checks that every sample comes back.  The decoder checks each frame's
+// CRC-8 and CRC-16 and the STREAMINFO MD5, and counts the subframe types,
+// Rice partition orders and stereo modes it sees, so that the test can
+// insist that the signals exercised all of them.  Exits with status 1 if
+// any check fails.
+//
+// usage: flactest [-v]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <vector>
+#include "../../src/audio/FlacEncoder.h"
+
+static bool sVerbose = false;
+
+// What the decoder saw, over all the files.
+
+enum { kIndependent, kLeftSide, kSideRight, kMidSide, kModes };
+static const char *kModeNames[kModes] = { "independent", "left/side", "side/right", "mid/side" };
+
+static int sConstant, sVerbatim, sFixed, sPartitioned, sModes[kModes];
+
+// MD5 (RFC 1321), written apart from the encoder's so that the two check
+// each other.
+
+struct MD5 {
+	uint32_t h[4];
+	uint64_t len;
+	unsigned char buf[64];
+
+	MD5() : len(0) { h[0] = 0x67452301; h[1] = 0xefcdab89; h[2] = 0x98badcfe; h[3] = 0x10325476; }
+
+	void block(const unsigned char *p)
+	{
+		static const int s[64] = {
+			7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+			5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+			4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+			6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+		};
+		uint32_t w[16];
+		for (int i = 0; i < 16; i++)
+			w[i] = (uint32_t) p[4*i] | ((uint32_t) p[4*i+1] << 8)
+					| ((uint32_t) p[4*i+2] << 16) | ((uint32_t) p[4*i+3] << 24);
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+		for (int i = 0; i < 64; i++) {
+			uint32_t f;
+			int g;
+			if (i < 16)			{ f = d ^ (b & (c ^ d));	g = i; }
+			else if (i < 32)	{ f = c ^ (d & (b ^ c));	g = (5*i + 1) % 16; }
+			else if (i < 48)	{ f = b ^ c ^ d;			g = (3*i + 5) % 16; }
+			else				{ f = c ^ (b | ~d);			g = (7*i) % 16; }
+			// K[i] is the integer part of 2^32 * |sin(i + 1)|.
+			const uint32_t k = (uint32_t) (fabs(sin((double) (i + 1))) * 4294967296.0);
+			const uint32_t x = a + f + k + w[g];
+			a = d; d = c; c = b;
+			b += (x << s[i]) | (x >> (32 - s[i]));
+		}
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+	}
+
+	void add(const unsigned char *p, size_t n)
+	{
+		while (n-- > 0) {
+			buf[len++ & 63] = *p++;
+			if ((len & 63) == 0)
+				block(buf);
+		}
+	}
+
+	void finish(unsigned char out[16])
+	{
+		const uint64_t bits = len * 8;
+		const unsigned char one = 0x80, zero = 0;
+		add(&one, 1);
+		while ((len & 63) != 56)
+			add(&zero, 1);
+		for (int i = 0; i < 8; i++) {
+			const unsigned char b = (unsigned char) (bits >> (8 * i));
+			add(&b, 1);
+		}
+		for (int i = 0; i < 16; i++)
+			out[i] = (unsigned char) (h[i / 4] >> (8 * (i % 4)));
+	}
+};
+
+// Reads bits from a FLAC stream, high bit first.
+
+class BitReader {
+public:
+	BitReader(const std::vector<unsigned char> &data) : _data(data), _pos(0), _failed(false) {}
+	uint32_t get(int bits)
+	{
+		uint32_t value = 0;
+		while (bits-- > 0) {
+			if ((_pos >> 3) >= _data.size()) {
+				_failed = true;
+				return 0;
+			}
+			value = (value << 1) | ((_data[_pos >> 3] >> (7 - (_pos & 7))) & 1);
+			_pos++;
+		}
+		return value;
+	}
+	int32_t getSigned(int bits)
+	{
+		const uint32_t value = get(bits);
+		if (bits < 32 && (value & (1U << (bits - 1))))
+			return (int32_t) (value | ~((1U << bits) - 1));
+		return (int32_t) value;
+	}
+	uint32_t getUnary()
+	{
+		uint32_t zeros = 0;
+		while (!_failed && get(1) == 0)
+			zeros++;
+		return zeros;
+	}
+	void align() { _pos = (_pos + 7) & ~(size_t) 7; }
+	size_t bytePos() const { return _pos >> 3; }
+	bool atEnd() const { return (_pos >> 3) >= _data.size(); }
+	bool failed() const { return _failed; }
+private:
+	const std::vector<unsigned char> &_data;
+	size_t _pos;
+	bool _failed;
+};
+
+static unsigned crc8(const unsigned char *p, size_t n)
+{
+	unsigned crc = 0;
+	while (n-- > 0) {
+		crc ^= *p++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) & 0xff : (crc << 1) & 0xff;
+	}
+	return crc;
+}
+
+static unsigned crc16(const unsigned char *p, size_t n)
+{
+	unsigned crc = 0;
+	while (n-- > 0) {
+		crc ^= (unsigned) *p++ << 8;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) & 0xffff : (crc << 1) & 0xffff;
+	}
+	return crc;
+}
+
+static bool fail(const char *name, const char *what)
+{
+	printf("%s: %s -- FAILED\n", name, what);
+	return false;
+}
+
+// Decode one subframe of <count> samples into <out>.
+
+static bool decodeSubframe(BitReader &in, int bits, int count, int32_t *out,
+						   const char *name)
+{
+	if (in.get(1) != 0)
+		return fail(name, "subframe padding bit set");
+	const int type = in.get(6);
+	int wasted = 0;
+	if (in.get(1))
+		wasted = in.getUnary() + 1;
+	bits -= wasted;
+	if (type == 0) {
+		const int32_t value = in.getSigned(bits);
+		for (int i = 0; i < count; i++)
+			out[i] = value;
+		sConstant++;
+	}
+	else if (type == 1) {
+		for (int i = 0; i < count; i++)
+			out[i] = in.getSigned(bits);
+		sVerbatim++;
+	}
+	else if (type >= 8 && type <= 12) {
+		const int order = type - 8;
+		if (order > count)
+			return fail(name, "predictor order longer than block");
+		for (int i = 0; i < order; i++)
+			out[i] = in.getSigned(bits);
+		const int method = in.get(2);
+		if (method > 1)
+			return fail(name, "reserved residual coding method");
+		const int paramBits = (method == 0) ? 4 : 5;
+		const uint32_t escape = (method == 0) ? 15 : 31;
+		const int partOrder = in.get(4);
+		const int parts = 1 << partOrder;
+		if ((count % parts) != 0 || (count >> partOrder) < order)
+			return fail(name, "bad partition order");
+		int n = order;
+		for (int part = 0; part < parts; part++) {
+			const int samples = (count >> partOrder) - ((part == 0) ? order : 0);
+			const uint32_t param = in.get(paramBits);
+			if (param == escape) {
+				const int raw = in.get(5);
+				for (int i = 0; i < samples; i++, n++)
+					out[n] = (raw == 0) ? 0 : in.getSigned(raw);
+			}
+			else {
+				for (int i = 0; i < samples; i++, n++) {
+					const uint32_t v = (in.getUnary() << param) | in.get(param);
+					out[n] = (int32_t) (v >> 1) ^ -(int32_t) (v & 1);
+				}
+			}
+		}
+		// Undo the fixed predictor in place; out[] holds residuals past <order>.
+		for (int i = order; i < count; i++) {
+			int64_t p = 0;
+			switch (order) {
+			case 1: p = out[i-1]; break;
+			case 2: p = 2 * (int64_t) out[i-1] - out[i-2]; break;
+			case 3: p = 3 * (int64_t) out[i-1] - 3 * (int64_t) out[i-2] + out[i-3]; break;
+			case 4: p = 4 * (int64_t) out[i-1] - 6 * (int64_t) out[i-2]
+						+ 4 * (int64_t) out[i-3] - out[i-4]; break;
+			}
+			out[i] = (int32_t) (p + out[i]);
+		}
+		sFixed++;
+		if (partOrder > 0)
+			sPartitioned++;
+	}
+	else
+		return fail(name, "unexpected subframe type");
+	if (wasted > 0)
+		for (int i = 0; i < count; i++)
+			out[i] <<= wasted;
+	return !in.failed() || fail(name, "subframe runs past end of file");
+}
+
+// Decode the FLAC file <data> and compare it with the interleaved samples
+// <expect>.
+
+static bool decode(const std::vector<unsigned char> &data, int chans, int srate,
+				   int bits, const std::vector<int32_t> &expect, const char *name)
+{
+	const long frames = (long) expect.size() / chans;
+	if (data.size() < 42 || memcmp(&data[0], "fLaC", 4) != 0)
+		return fail(name, "no fLaC marker");
+	BitReader in(data);
+	in.get(32);
+	if (in.get(1) != 1 || in.get(7) != 0 || in.get(24) != 34)
+		return fail(name, "STREAMINFO is not the only metadata block");
+	const uint32_t minBlock = in.get(16), maxBlock = in.get(16);
+	const uint32_t minFrame = in.get(24), maxFrame = in.get(24);
+	if ((int) in.get(20) != srate || (int) in.get(3) + 1 != chans
+			|| (int) in.get(5) + 1 != bits)
+		return fail(name, "STREAMINFO format does not match");
+	const uint64_t total = ((uint64_t) in.get(4) << 32) | in.get(32);
+	if (total != (uint64_t) frames)
+		return fail(name, "STREAMINFO frame count is wrong");
+	unsigned char md5[16];
+	for (int i = 0; i < 16; i++)
+		md5[i] = (unsigned char) in.get(8);
+
+	std::vector<int32_t> chan[8], side;
+	for (int c = 0; c < chans; c++)
+		chan[c].resize(maxBlock);
+	MD5 sum;
+	long decoded = 0;
+	uint32_t frameNumber = 0;
+	while (!in.atEnd()) {
+		const size_t start = in.bytePos();
+		if (in.get(14) != 0x3ffe || in.get(1) != 0 || in.get(1) != 0)
+			return fail(name, "bad frame sync");
+		const int sizeCode = in.get(4);
+		if (in.get(4) != 0)
+			return fail(name, "frame gives its own sample rate");
+		const int assignment = in.get(4);
+		const int sizeBits = in.get(3);
+		in.get(1);
+		// The frame number, in UTF-8's coding
+		uint32_t number = in.get(8);
+		int trailing = 0;
+		while (trailing < 6 && (number & (0x80 >> trailing)))
+			trailing++;
+		if (trailing == 1)
+			return fail(name, "bad frame number");
+		if (trailing > 1) {
+			number &= 0x7f >> trailing;
+			for (int i = 1; i < trailing; i++)
+				number = (number << 6) | (in.get(8) & 0x3f);
+		}
+		if (number != frameNumber++)
+			return fail(name, "frames out of order");
+		int count;
+		if (sizeCode == 6)
+			count = in.get(8) + 1;
+		else if (sizeCode == 7)
+			count = in.get(16) + 1;
+		else if (sizeCode >= 8)
+			count = 256 << (sizeCode - 8);
+		else
+			return fail(name, "unexpected block size code");
+		if ((uint32_t) count > maxBlock || (count < (int) minBlock && decoded + count != frames))
+			return fail(name, "block size outside STREAMINFO's range");
+		if ((sizeBits == 4 && bits != 16) || (sizeBits == 6 && bits != 24)
+				|| (sizeBits != 4 && sizeBits != 6 && sizeBits != 0))
+			return fail(name, "frame sample size does not match");
+		const size_t headerEnd = in.bytePos();
+		if (in.get(8) != crc8(&data[start], headerEnd - start))
+			return fail(name, "frame header CRC-8 mismatch");
+
+		int mode = kIndependent;
+		if (assignment == 8) mode = kLeftSide;
+		else if (assignment == 9) mode = kSideRight;
+		else if (assignment == 10) mode = kMidSide;
+		else if (assignment != chans - 1)
+			return fail(name, "channel assignment does not match");
+		if (mode != kIndependent && chans != 2)
+			return fail(name, "stereo decorrelation in a non-stereo file");
+		sModes[mode]++;
+		for (int c = 0; c < chans; c++) {
+			const bool isSide = (mode == kLeftSide && c == 1)
+						|| (mode == kSideRight && c == 0) || (mode == kMidSide && c == 1);
+			if (!decodeSubframe(in, bits + (isSide ? 1 : 0), count, &chan[c][0], name))
+				return false;
+		}
+		in.align();
+		const size_t footer = in.bytePos();
+		if (in.get(16) != crc16(&data[start], footer - start))
+			return fail(name, "frame CRC-16 mismatch");
+		const uint32_t frameBytes = (uint32_t) (in.bytePos() - start);
+		if (frameBytes < minFrame || frameBytes > maxFrame)
+			return fail(name, "frame size outside STREAMINFO's range");
+
+		for (int i = 0; i < count; i++) {
+			int32_t l = chan[0][i], r = (chans > 1) ? chan[1][i] : 0;
+			if (mode == kLeftSide)
+				r = l - r;
+			else if (mode == kSideRight)
+				l = r + l;
+			else if (mode == kMidSide) {
+				const int32_t s = r;
+				const int32_t m = (int32_t) (((uint32_t) l << 1) | (s & 1));
+				l = (m + s) >> 1;
+				r = (m - s) >> 1;
+			}
+			for (int c = 0; c < chans; c++) {
+				const int32_t v = (c == 0) ? l : (c == 1) ? r : chan[c][i];
+				if (decoded + i >= frames || v != expect[(decoded + i) * chans + c]) {
+					char msg[80];
+					snprintf(msg, sizeof(msg), "sample %ld of channel %d differs",
+							 decoded + i, c);
+					return fail(name, msg);
+				}
+				unsigned char bytes[3] = { (unsigned char) v, (unsigned char) (v >> 8),
+										   (unsigned char) (v >> 16) };
+				sum.add(bytes, bits / 8);
+			}
+		}
+		decoded += count;
+	}
+	if (decoded != frames)
+		return fail(name, "file is short");
+	unsigned char digest[16];
+	sum.finish(digest);
+	if (memcmp(digest, md5, 16) != 0)
+		return fail(name, "MD5 of the decoded audio differs from STREAMINFO's");
+	return true;
+}
+
+// Encode <samples> (interleaved) to a temporary file, feeding the encoder
+// in uneven chunks as the file writer thread does, and read it back.
+
+static bool encode(const std::vector<int32_t> &samples, int chans, int srate,
+				   int bits, std::vector<unsigned char> &data, const char *name)
+{
+	char path[] = "/tmp/flactestXXXXXX";
+	const int fd = mkstemp(path);
+	if (fd < 0)
+		return fail(name, "cannot make temporary file");
+	unlink(path);
+	const int bytes = bits / 8;
+	std::vector<unsigned char> pcm(samples.size() * bytes);
+	for (size_t i = 0; i < samples.size(); i++)
+		for (int b = 0; b < bytes; b++)
+			pcm[i * bytes + b] = (unsigned char) (samples[i] >> (8 * b));
+
+	FlacEncoder encoder(fd, chans, srate, bits);
+	bool ok = encoder.start() == 0;
+	static const long chunks[] = { 4096, 1, 7, 3000, 11111, 5 };
+	size_t pos = 0;
+	for (int n = 0; ok && pos < pcm.size(); n++) {
+		long count = chunks[n % (sizeof(chunks) / sizeof(long))];
+		if ((size_t) count > pcm.size() - pos)
+			count = pcm.size() - pos;
+		ok = encoder.encode(&pcm[pos], count) == 0;
+		pos += count;
+	}
+	ok = ok && encoder.finish() == 0;
+	if (ok) {
+		const off_t size = lseek(fd, 0, SEEK_END);
+		data.resize(size);
+		ok = size > 0 && pread(fd, &data[0], size, 0) == size;
+	}
+	close(fd);
+	return ok || fail(name, "encoding failed");
+}
+
+// The test signals.  <frames> per channel, full scale for <bits>.
+
+enum Signal {
+	kSilent, kConstant, kFullScaleConstant, kFullScaleSquare, kSine, kNoise,
+	kQuietThenLoud, kSameBoth, kSmoothLeft, kSmoothRight, kUnrelated
+};
+
+struct Case {
+	const char *name;
+	Signal signal;
+	int chans;
+};
+
+static const Case kCases[] = {
+	{ "silence", kSilent, 1 },
+	{ "silence", kSilent, 2 },
+	{ "constant", kConstant, 1 },
+	{ "constant", kConstant, 2 },
+	{ "full-scale constant", kFullScaleConstant, 2 },
+	{ "full-scale square", kFullScaleSquare, 1 },
+	{ "full-scale square", kFullScaleSquare, 2 },
+	{ "sine", kSine, 1 },
+	{ "noise", kNoise, 1 },
+	{ "quiet, then loud", kQuietThenLoud, 1 },
+	{ "same in both channels", kSameBoth, 2 },
+	{ "smooth left, noisy right", kSmoothLeft, 2 },
+	{ "noisy left, smooth right", kSmoothRight, 2 },
+	{ "unrelated channels", kUnrelated, 2 },
+};
+
+static int32_t noise(int32_t amp)
+{
+	return (int32_t) (random() % (2 * amp + 1)) - amp;
+}
+
+static void makeSignal(Signal signal, int chans, int bits, long frames,
+					   std::vector<int32_t> &out)
+{
+	const int32_t max = (1 << (bits - 1)) - 1, min = -max - 1;
+	const int32_t small = (bits == 16) ? 40 : 40 << 8;
+	out.resize(frames * chans);
+	for (long i = 0; i < frames; i++) {
+		const int32_t sine = (int32_t) (0.5 * max * sin(i * 0.01));
+		int32_t l = 0, r = 0;
+		switch (signal) {
+		case kSilent:
+			break;
+		case kConstant:
+			l = r = max / 3;
+			break;
+		case kFullScaleConstant:
+			l = max;
+			r = min;
+			break;
+		case kFullScaleSquare:
+			l = (i & 1) ? max : min;
+			r = (i & 1) ? min : max;
+			break;
+		case kSine:
+			l = r = (int32_t) (max * sin(i * 0.03));
+			break;
+		case kNoise:
+			l = r = noise(max);
+			break;
+		case kQuietThenLoud:
+			// Residuals that change size within a block, for partitioning
+			l = r = ((i % 4096) < 2048) ? noise(3) : noise(max / 4);
+			break;
+		case kSameBoth:
+			l = r = sine + noise(small);
+			break;
+		case kSmoothLeft:
+			l = sine;
+			r = sine + noise(small);
+			break;
+		case kSmoothRight:
+			r = sine;
+			l = sine + noise(small);
+			break;
+		case kUnrelated:
+			l = sine;
+			r = noise(max / 2);
+			break;
+		}
+		out[i * chans] = l;
+		if (chans > 1)
+			out[i * chans + 1] = r;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	sVerbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+	int failures = 0;
+
+	// The decoder's MD5 against RFC 1321's test suite
+	MD5 check;
+	check.add((const unsigned char *) "abc", 3);
+	unsigned char digest[16];
+	check.finish(digest);
+	static const unsigned char abc[16] = {
+		0x90, 0x01, 0x50, 0x98, 0x3c, 0xd2, 0x4f, 0xb0,
+		0xd6, 0x96, 0x3f, 0x7d, 0x28, 0xe1, 0x7f, 0x72
+	};
+	if (memcmp(digest, abc, 16) != 0) {
+		printf("flactest: the test's own MD5 is wrong\n");
+		return 1;
+	}
+
+	srandom(1);
+	static const int bitSizes[] = { 16, 24 };
+	// Whole blocks plus a short last one, just one short block, and a block
+	// too short for every predictor order.
+	static const long lengths[] = { 3 * FlacEncoder::kBlockSize + 1000, 100, 3 };
+	for (int b = 0; b < 2; b++) {
+		for (int c = 0; c < (int) (sizeof(kCases) / sizeof(Case)); c++) {
+			for (int l = 0; l < 3; l++) {
+				const Case &test = kCases[c];
+				const int bits = bitSizes[b];
+				char name[100];
+				snprintf(name, sizeof(name), "%d-bit %s %s, %ld frames", bits,
+						 test.chans == 1 ? "mono" : "stereo", test.name, lengths[l]);
+				std::vector<int32_t> samples;
+				std::vector<unsigned char> data;
+				makeSignal(test.signal, test.chans, bits, lengths[l], samples);
+				const bool ok = encode(samples, test.chans, 44100, bits, data, name)
+								&& decode(data, test.chans, 44100, bits, samples, name);
+				if (ok && sVerbose)
+					printf("%s: %lu bytes\n", name, (unsigned long) data.size());
+				if (!ok)
+					failures++;
+			}
+		}
+	}
+
+	if (sVerbose) {
+		printf("subframes: %d constant, %d verbatim, %d fixed (%d partitioned)\n",
+				sConstant, sVerbatim, sFixed, sPartitioned);
+		for (int m = 0; m < kModes; m++)
+			printf("%s frames: %d\n", kModeNames[m], sModes[m]);
+	}
+	// The signals are chosen so that the encoder uses every kind of
+	// subframe and stereo coding it has.
+	if (sConstant == 0 || sVerbatim == 0 || sFixed == 0 || sPartitioned == 0) {
+		printf("flactest: some subframe type or Rice partitioning never occurred\n");
+		failures++;
+	}
+	for (int m = 0; m < kModes; m++) {
+		if (sModes[m] == 0) {
+			printf("flactest: no frame used %s stereo coding\n", kModeNames[m]);
+			failures++;
+		}
+	}
+	if (failures > 0) {
+		printf("FlacEncoder: %d of the checks failed\n", failures);
+		return 1;
+	}
+	printf("FlacEncoder output decodes to its input\n");
+	return 0;
+}
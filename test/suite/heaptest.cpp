@@ -0,0 +1,399 @@
+// Exercises the scheduler's note heap, its inbox, and the RTQueue: equal
+// start times must come out in the order they went in, exchange() and
+// takeAny() must hand over every note exactly once, and nothing posted to
+// the inbox from several threads at once may be lost or reordered.  Exits
+// with status 1 on any failure.
+//
+// usage: heaptest [-v]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <vector>
+#include <Instrument.h>
+#include "../../src/rtcmix/heap/heap.h"
+
+static bool verbose = false;
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+	if (verbose || !ok)
+		printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+	if (!ok)
+		failures++;
+}
+
+class TestInst : public Instrument {
+public:
+	TestInst(int inTag) : tag(inTag) {}
+	virtual int run() { return 0; }
+	const int tag;
+};
+
+// Every note made here keeps one reference for the test, so nothing the
+// heap or queue gives up is ever deleted.
+
+static std::vector<TestInst *> notes;
+
+static TestInst *makeNote()
+{
+	TestInst *inst = new TestInst((int) notes.size());
+	inst->ref();	// the test's
+	inst->ref();	// the one handed to the heap
+	notes.push_back(inst);
+	return inst;
+}
+
+static int tagOf(Instrument *inst)
+{
+	return ((TestInst *) inst)->tag;
+}
+
+// Start times are drawn from a few values so that most notes tie.
+
+static FRAMETYPE startFor(int n)
+{
+	return (FRAMETYPE) ((n * 7919) % 5) * 64;
+}
+
+// <out> must hold the notes in <in>, which are in the order they entered the
+// heap, sorted by start time and then by that order.
+
+struct Expected {
+	FRAMETYPE start;
+	int tag;
+};
+
+static bool inOrder(const std::vector<Expected> &in, const std::vector<Expected> &out)
+{
+	if (in.size() != out.size())
+		return false;
+	std::vector<Expected> sorted;
+	for (FRAMETYPE s = 0; s < 5 * 64; s += 64)
+		for (size_t n = 0; n < in.size(); n++)
+			if (in[n].start == s)
+				sorted.push_back(in[n]);
+	for (size_t n = 0; n < out.size(); n++)
+		if (sorted[n].start != out[n].start || sorted[n].tag != out[n].tag)
+			return false;
+	return true;
+}
+
+static std::vector<Expected> drain(heap &h)
+{
+	std::vector<Expected> out;
+	Instrument *inst;
+	FRAMETYPE start;
+	while ((inst = h.deleteMin(1 << 30, &start)) != NULL) {
+		Expected e = { start, tagOf(inst) };
+		out.push_back(e);
+	}
+	return out;
+}
+
+static void fill(heap &h, int count, std::vector<Expected> &in, bool usePost)
+{
+	for (int n = 0; n < count; n++) {
+		TestInst *inst = makeNote();
+		Expected e = { startFor(inst->tag), inst->tag };
+		if (usePost)
+			h.post(inst, e.start);
+		else
+			h.insert(inst, e.start);
+		in.push_back(e);
+	}
+}
+
+static void testHeapOrder(bool bulkLoad)
+{
+	heap h(bulkLoad);
+	std::vector<Expected> in;
+	fill(h, 1000, in, false);
+	check(h.getSize() == 1000, "heap size after insert");
+	check(inOrder(in, drain(h)), bulkLoad ? "bulk-loaded heap keeps equal starts in order"
+										  : "heap keeps equal starts in order");
+
+	// Interleave inserting and removing, so that ties span many sift-downs.
+	in.clear();
+	std::vector<Expected> out;
+	fill(h, 300, in, false);
+	Instrument *inst;
+	FRAMETYPE start;
+	for (int n = 0; n < 100; n++) {
+		inst = h.deleteMin(1 << 30, &start);
+		Expected e = { start, tagOf(inst) };
+		out.push_back(e);
+	}
+	std::vector<Expected> later;
+	fill(h, 300, later, false);
+	std::vector<Expected> rest = drain(h);
+	std::vector<Expected> all(in.begin(), in.end());
+	all.insert(all.end(), later.begin(), later.end());
+	std::vector<Expected> allOut(out.begin(), out.end());
+	allOut.insert(allOut.end(), rest.begin(), rest.end());
+	// Notes inserted after some were removed may start earlier than those,
+	// so check each start time's notes separately.
+	bool ok = true;
+	for (FRAMETYPE s = 0; s < 5 * 64 && ok; s += 64) {
+		std::vector<int> a, b;
+		for (size_t n = 0; n < all.size(); n++)
+			if (all[n].start == s)
+				a.push_back(all[n].tag);
+		for (size_t n = 0; n < allOut.size(); n++)
+			if (allOut[n].start == s)
+				b.push_back(allOut[n].tag);
+		ok = (a == b);
+	}
+	check(ok && allOut.size() == all.size(), "equal starts stay in order across inserts and removals");
+}
+
+static bool isOdd(Instrument *inst, void *)
+{
+	return (tagOf(inst) & 1) != 0;
+}
+
+static void testRemoveIf()
+{
+	heap h;
+	std::vector<Expected> in, kept;
+	fill(h, 200, in, false);
+	fill(h, 50, in, true);
+	const int removed = h.removeIf(isOdd, NULL);
+	for (size_t n = 0; n < in.size(); n++)
+		if ((in[n].tag & 1) == 0)
+			kept.push_back(in[n]);
+	check(removed == 125 && h.getSize() == (long) kept.size(), "removeIf removes from the heap and inbox");
+	check(inOrder(kept, drain(h)), "removeIf leaves equal starts in order");
+}
+
+static void testHeapExchange()
+{
+	heap full, empty;
+	std::vector<Expected> in;
+	fill(full, 500, in, false);
+	fill(full, 100, in, true);		// still in the inbox
+	full.exchange(empty);
+	check(full.getSize() == 0 && empty.getSize() == 600, "exchange moves the heap and the inbox");
+	FRAMETYPE start;
+	check(full.deleteMin(1 << 30, &start) == NULL, "exchange leaves the source empty");
+
+	// Notes added after the exchange follow the ones it moved.
+	fill(empty, 100, in, false);
+	empty.drainInbox();
+	std::vector<Expected> expected(in.begin(), in.begin() + 500);
+	expected.insert(expected.end(), in.begin() + 600, in.end());
+	expected.insert(expected.end(), in.begin() + 500, in.begin() + 600);
+	check(inOrder(expected, drain(empty)), "exchange keeps equal starts in order");
+
+	std::vector<Expected> again;
+	fill(full, 10, again, false);
+	check(inOrder(again, drain(full)), "the emptied heap is usable again");
+}
+
+static void testHeapTakeAny()
+{
+	heap h;
+	std::vector<Expected> in;
+	fill(h, 300, in, false);
+	fill(h, 40, in, true);
+	std::vector<int> seen(notes.size(), 0);
+	// Take some, then make sure the rest still come out in order.
+	for (int n = 0; n < 100; n++) {
+		Instrument *inst = h.takeAny();
+		if (inst != NULL)
+			seen[tagOf(inst)]++;
+	}
+	check(h.getSize() == 240, "heap size after takeAny");
+	std::vector<Expected> left;
+	for (size_t n = 0; n < in.size(); n++)
+		if (seen[in[n].tag] == 0)
+			left.push_back(in[n]);
+	h.drainInbox();
+	std::vector<Expected> rest = drain(h);
+	// Notes taken from the inbox never entered the heap, so the rest
+	// entered in their original order.
+	check(inOrder(left, rest), "takeAny leaves the rest in order");
+
+	fill(h, 300, in, false);
+	fill(h, 40, in, true);
+	seen.resize(notes.size(), 0);
+	int taken = 0;
+	Instrument *inst;
+	while ((inst = h.takeAny()) != NULL) {
+		seen[tagOf(inst)]++;
+		taken++;
+	}
+	bool once = true;
+	for (size_t n = in.size() - 340; n < in.size(); n++)
+		once = once && seen[in[n].tag] == 1;
+	check(taken == 340 && once && h.getSize() == 0, "takeAny hands over every note once");
+}
+
+static void testInbox()
+{
+	HeapInbox box;
+	int posted = 0;
+	while (box.post(makeNote(), posted))
+		posted++;
+	check(posted == 4096 && box.pending() == 4096, "inbox holds its full size");
+	Instrument *inst;
+	FRAMETYPE start;
+	bool ok = true;
+	for (int n = 0; n < posted; n++)
+		ok = ok && box.take(&inst, &start) && start == n;
+	check(ok && box.empty() && !box.take(&inst, &start), "inbox takes in the order posted");
+}
+
+// Several threads post at once, more than the inbox holds, while this
+// thread drains it as the audio thread would.
+
+enum { kPosters = 4, kPerPoster = 5000 };
+
+struct Poster {
+	heap *h;
+	std::vector<TestInst *> notes;
+};
+
+static volatile int postersDone = 0;
+
+static void *postAll(void *arg)
+{
+	Poster *p = (Poster *) arg;
+	for (size_t n = 0; n < p->notes.size(); n++)
+		p->h->post(p->notes[n], 0);
+	__sync_fetch_and_add(&postersDone, 1);
+	return NULL;
+}
+
+static void testConcurrentPosts()
+{
+	heap h;
+	Poster posters[kPosters];
+	for (int p = 0; p < kPosters; p++) {
+		posters[p].h = &h;
+		for (int n = 0; n < kPerPoster; n++)
+			posters[p].notes.push_back(makeNote());
+	}
+	pthread_t threads[kPosters];
+	for (int p = 0; p < kPosters; p++)
+		pthread_create(&threads[p], NULL, postAll, &posters[p]);
+	std::vector<int> order;
+	while (postersDone < kPosters) {
+		h.drainInbox();
+		Instrument *inst;
+		FRAMETYPE start;
+		while ((inst = h.deleteMin(1, &start)) != NULL)
+			order.push_back(tagOf(inst));
+	}
+	for (int p = 0; p < kPosters; p++)
+		pthread_join(threads[p], NULL);
+	h.drainInbox();
+	Instrument *inst;
+	FRAMETYPE start;
+	while ((inst = h.deleteMin(1, &start)) != NULL)
+		order.push_back(tagOf(inst));
+
+	std::vector<int> seen(notes.size(), 0);
+	for (size_t n = 0; n < order.size(); n++)
+		seen[order[n]]++;
+	bool once = (order.size() == kPosters * kPerPoster);
+	for (int p = 0; p < kPosters; p++)
+		for (int n = 0; n < kPerPoster; n++)
+			once = once && seen[posters[p].notes[n]->tag] == 1;
+	check(once && h.getSize() == 0, "concurrent posts all arrive once");
+
+	// Each poster's notes tie, so they must come out in the order posted.
+	bool ordered = true;
+	for (int p = 0; p < kPosters; p++) {
+		const int first = posters[p].notes[0]->tag;
+		int last = first - 1;
+		for (size_t n = 0; n < order.size(); n++) {
+			if (order[n] >= first && order[n] < first + kPerPoster) {
+				ordered = ordered && order[n] == last + 1;
+				last = order[n];
+			}
+		}
+	}
+	check(ordered, "concurrent posts keep each poster's order");
+}
+
+static void testQueue()
+{
+	RTQueue q;
+	std::vector<Expected> in, out;
+	// Mostly the next buffer, as the scheduler pushes, plus some far out.
+	for (int n = 0; n < 600; n++) {
+		TestInst *inst = makeNote();
+		Expected e = { startFor(n) + ((n % 50 == 0) ? 64 * 1000 : 0), inst->tag };
+		q.push(inst, e.start);
+		in.push_back(e);
+	}
+	check(q.getSize() == 600, "queue size after push");
+	Instrument *inst;
+	FRAMETYPE start;
+	FRAMETYPE last = 0;
+	bool sorted = true;
+	while (q.getSize() > 0) {
+		inst = q.pop(&start);
+		sorted = sorted && start >= last;
+		last = start;
+		Expected e = { start, tagOf(inst) };
+		out.push_back(e);
+	}
+	// Ties in the far-out notes too.
+	bool ok = sorted && out.size() == in.size();
+	for (size_t s = 0; ok && s < out.size(); ) {
+		size_t e = s;
+		std::vector<int> a, b;
+		while (e < out.size() && out[e].start == out[s].start)
+			b.push_back(out[e++].tag);
+		for (size_t n = 0; n < in.size(); n++)
+			if (in[n].start == out[s].start)
+				a.push_back(in[n].tag);
+		ok = (a == b);
+		s = e;
+	}
+	check(ok, "queue pops equal starts in the order pushed");
+
+	RTQueue full, empty;
+	for (int n = 0; n < 200; n++)
+		full.push(makeNote(), startFor(n) + (n % 20 == 0 ? 64 * 1000 : 0));
+	full.exchange(empty);
+	check(full.getSize() == 0 && empty.getSize() == 200, "queue exchange moves everything");
+	std::vector<int> seen(notes.size(), 0);
+	int taken = 0;
+	while ((inst = empty.takeAny()) != NULL) {
+		seen[tagOf(inst)]++;
+		taken++;
+	}
+	bool once = true;
+	for (size_t n = notes.size() - 200; n < notes.size(); n++)
+		once = once && seen[n] == 1;
+	check(taken == 200 && once && empty.getSize() == 0, "queue takeAny hands over every note once");
+	full.push(makeNote(), 0);
+	check(full.pop(&start) != NULL && full.getSize() == 0, "the emptied queue is usable again");
+}
+
+int
+main(int argc, char *argv[])
+{
+	verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+
+	testHeapOrder(false);
+	testHeapOrder(true);
+	testRemoveIf();
+	testHeapExchange();
+	testHeapTakeAny();
+	testInbox();
+	testConcurrentPosts();
+	testQueue();
+
+	if (failures > 0) {
+		printf("heap: %d of the checks failed\n", failures);
+		return 1;
+	}
+	printf("heap, inbox and queue keep their order\n");
+	return 0;
+}
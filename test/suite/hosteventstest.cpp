@@ -0,0 +1,177 @@
+// Exercises HostEvents, the rings that carry bangs and lists of values
+// from instruments back to an embedding host: a bang is taken once, the
+// list for the latest frame wins, a full ring drops events without harm,
+// and lists posted from several threads at once arrive whole.  Exits with
+// status 1 on any failure.
+//
+// usage: hosteventstest [-v]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <HostEvents.h>
+
+static bool verbose = false;
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+	if (verbose || !ok)
+		printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+	if (!ok)
+		failures++;
+}
+
+static float sValues[HostEvents::kMaxValues];
+
+// A list of <count> values starting at <first>, counting up by one.
+
+static void makeList(float *values, float first, int count)
+{
+	for (int n = 0; n < count; n++)
+		values[n] = first + n;
+}
+
+static bool isList(const float *values, float first, int count)
+{
+	for (int n = 0; n < count; n++)
+		if (values[n] != first + n)
+			return false;
+	return true;
+}
+
+static void testBangs()
+{
+	check(!HostEvents::takeBang(), "no bang before one is posted");
+	HostEvents::postBang(0);
+	HostEvents::postBang(64);
+	HostEvents::postBang(128);
+	check(HostEvents::takeBang() && !HostEvents::takeBang(), "bangs in one buffer are taken as one");
+	for (int n = 0; n < 1000; n++)
+		HostEvents::postBang(n);
+	check(HostEvents::takeBang() && !HostEvents::takeBang(), "a full bang ring is harmless");
+	HostEvents::postBang(0);
+	check(HostEvents::takeBang(), "bangs are taken after the ring was full");
+}
+
+static void testValues()
+{
+	float list[HostEvents::kMaxValues + 10];
+	check(HostEvents::takeValues(sValues) == 0, "no list before one is posted");
+
+	makeList(list, 100, 3);
+	HostEvents::postValues(640, list, 3);
+	makeList(list, 200, 5);
+	HostEvents::postValues(1280, list, 5);
+	makeList(list, 300, 4);
+	HostEvents::postValues(960, list, 4);
+	int count = HostEvents::takeValues(sValues);
+	check(count == 5 && isList(sValues, 200, 5), "the list for the latest frame is taken");
+	check(HostEvents::takeValues(sValues) == 0, "a list is taken only once");
+
+	makeList(list, 400, 2);
+	HostEvents::postValues(64, list, 2);
+	makeList(list, 500, 2);
+	HostEvents::postValues(64, list, 2);
+	count = HostEvents::takeValues(sValues);
+	check(count == 2 && isList(sValues, 500, 2), "of lists for the same frame, the last posted is taken");
+
+	makeList(list, 0, HostEvents::kMaxValues + 10);
+	HostEvents::postValues(0, list, HostEvents::kMaxValues + 10);
+	count = HostEvents::takeValues(sValues);
+	check(count == HostEvents::kMaxValues && isList(sValues, 0, count), "long lists are cut to kMaxValues");
+
+	// The ring holds 16 lists, so later ones are dropped until it is taken.
+	for (int n = 0; n < 40; n++) {
+		makeList(list, n * 10, 3);
+		HostEvents::postValues(n, list, 3);
+	}
+	count = HostEvents::takeValues(sValues);
+	check(count == 3 && isList(sValues, 150, 3), "a full value ring keeps what it has");
+	makeList(list, 7, 1);
+	HostEvents::postValues(0, list, 1);
+	count = HostEvents::takeValues(sValues);
+	check(count == 1 && sValues[0] == 7, "lists are taken after the ring was full");
+}
+
+// Several threads post lists and bangs at once while this one takes them,
+// as the host would once a buffer.  Each list's length and values come
+// from its frame, so a list mixing two posts shows up.  The posters pause
+// now and then, so that the rings are sometimes full and sometimes not.
+
+enum { kPosters = 4, kPerPoster = 5000 };
+
+static volatile int postersDone = 0;
+
+static int lengthFor(FRAMETYPE frame)
+{
+	return 1 + (int) (frame % 97);
+}
+
+static void *postAll(void *arg)
+{
+	const int poster = *(int *) arg;
+	float list[128];
+	for (int n = 0; n < kPerPoster; n++) {
+		const FRAMETYPE frame = (FRAMETYPE) n * kPosters + poster;
+		makeList(list, (float) frame, lengthFor(frame));
+		HostEvents::postValues(frame, list, lengthFor(frame));
+		if (n % 100 == 0)
+			HostEvents::postBang(frame);
+		if (n % 8 == 7)
+			usleep(100);
+	}
+	__sync_fetch_and_add(&postersDone, 1);
+	return NULL;
+}
+
+static void testConcurrentPosts()
+{
+	int ids[kPosters];
+	pthread_t threads[kPosters];
+	for (int p = 0; p < kPosters; p++) {
+		ids[p] = p;
+		pthread_create(&threads[p], NULL, postAll, &ids[p]);
+	}
+	long lists = 0, bangs = 0;
+	bool whole = true;
+	for (;;) {
+		const bool done = (postersDone == kPosters);
+		if (HostEvents::takeBang())
+			bangs++;
+		const int count = HostEvents::takeValues(sValues);
+		if (count > 0) {
+			const FRAMETYPE frame = (FRAMETYPE) sValues[0];
+			whole = whole && count == lengthFor(frame) && isList(sValues, sValues[0], count);
+			lists++;
+		}
+		if (done)
+			break;
+	}
+	for (int p = 0; p < kPosters; p++)
+		pthread_join(threads[p], NULL);
+	if (verbose)
+		printf("%ld lists and %ld bangs taken\n", lists, bangs);
+	check(whole && lists > 0 && bangs > 0, "lists posted from several threads arrive whole");
+	check(HostEvents::takeValues(sValues) == 0 && !HostEvents::takeBang(),
+		  "nothing is left once the posters are done");
+}
+
+int
+main(int argc, char *argv[])
+{
+	verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+
+	testBangs();
+	testValues();
+	testConcurrentPosts();
+
+	if (failures > 0) {
+		printf("HostEvents: %d of the checks failed\n", failures);
+		return 1;
+	}
+	printf("HostEvents delivers bangs and whole lists\n");
+	return 0;
+}
@@ -0,0 +1,306 @@
+// Exercises PrintRing, which holds messages printed on real-time threads
+// until they can be printed safely: messages wait until drained and come
+// out whole and in order, repeats are counted rather than printed, no more
+// than a few dozen warnings a second are printed, and whatever is dropped
+// (rate-limited, or posted to a full ring, even by several threads at once)
+// is counted.  Exits with status 1 on any failure.
+//
+// usage: printringtest [-v]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <ugens.h>
+#include "../../src/rtcmix/PrintRing.h"
+
+static bool verbose = false;
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+	if (verbose || !ok)
+		printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+	if (!ok)
+		failures++;
+}
+
+// What PrintRing prints goes to stdout and stderr, so those are sent to a
+// file while it drains.  main() makes stdout line-buffered, so that the two
+// do not split each other's lines.
+
+static int sCaptureFD = -1, sStdout = -1, sStderr = -1;
+
+static void beginCapture()
+{
+	char path[] = "/tmp/printringtestXXXXXX";
+	sCaptureFD = mkstemp(path);
+	unlink(path);
+	fflush(stdout);
+	fflush(stderr);
+	sStdout = dup(1);
+	sStderr = dup(2);
+	dup2(sCaptureFD, 1);
+	dup2(sCaptureFD, 2);
+}
+
+static std::string captured()
+{
+	fflush(stdout);
+	fflush(stderr);
+	std::string text;
+	char buf[4096];
+	ssize_t count;
+	lseek(sCaptureFD, 0, SEEK_SET);
+	while ((count = read(sCaptureFD, buf, sizeof(buf))) > 0)
+		text.append(buf, count);
+	return text;
+}
+
+static std::string endCapture()
+{
+	std::string text = captured();
+	dup2(sStdout, 1);
+	dup2(sStderr, 2);
+	close(sStdout);
+	close(sStderr);
+	close(sCaptureFD);
+	return text;
+}
+
+static int occurrences(const std::string &text, const char *what)
+{
+	int count = 0;
+	for (size_t at = text.find(what); at != std::string::npos; at = text.find(what, at + 1))
+		count++;
+	return count;
+}
+
+// The total of the "<n> message(s) from real-time threads not printed"
+// reports in <text>.
+
+static int notPrinted(const std::string &text)
+{
+	int total = 0;
+	const char *report = " from real-time threads not printed";
+	for (size_t at = text.find(report); at != std::string::npos; at = text.find(report, at + 1)) {
+		size_t start = text.rfind(" message", at);
+		while (start > 0 && isdigit(text[start - 1]))
+			start--;
+		total += atoi(text.c_str() + start);
+	}
+	return total;
+}
+
+// Rate limiting counts messages a second, so tests of it start a second
+// afresh.
+
+static void awaitNewSecond()
+{
+	const time_t then = time(NULL);
+	while (time(NULL) == then)
+		usleep(1000);
+}
+
+static void *checkDeferring(void *arg)
+{
+	const bool before = PrintRing::deferring();
+	PrintRing::realtimeThread();
+	*(bool *) arg = !before && PrintRing::deferring();
+	return NULL;
+}
+
+static void testDeferring()
+{
+	bool ok = !PrintRing::deferring();
+	{
+		PrintRing::AudioScope outer;
+		ok = ok && PrintRing::deferring();
+		{
+			PrintRing::AudioScope inner;
+			ok = ok && PrintRing::deferring();
+		}
+		ok = ok && PrintRing::deferring();
+	}
+	ok = ok && !PrintRing::deferring();
+	check(ok, "only the audio scope defers printing");
+	bool threadOK = false;
+	pthread_t thread;
+	pthread_create(&thread, NULL, checkDeferring, &threadOK);
+	pthread_join(thread, NULL);
+	check(threadOK && !PrintRing::deferring(), "a real-time thread defers its own printing");
+
+	beginCapture();
+	{
+		PrintRing::AudioScope scope;
+		rtcmix_warn("TESTINST", "deferred warning %d", 1);
+		rtcmix_advise("TESTINST", "deferred advice");
+		RTPrintf("deferred text\n");
+	}
+	const std::string before = captured();
+	PrintRing::drain();
+	const std::string after = endCapture();
+	check(before.empty(), "nothing is printed before draining");
+	const size_t warning = after.find("WARNING [TESTINST]:  deferred warning 1");
+	const size_t advice = after.find("TESTINST:  deferred advice");
+	const size_t text = after.find("deferred text\n");
+	check(warning != std::string::npos && advice != std::string::npos
+		  && text != std::string::npos && warning < advice && advice < text,
+		  "draining prints messages as posted, in order");
+}
+
+static void testRepeats()
+{
+	awaitNewSecond();
+	beginCapture();
+	for (int n = 0; n < 10; n++)
+		PrintRing::post(MMP_WARN, "TESTINST", "the same warning");
+	PrintRing::post(MMP_WARN, "TESTINST", "another warning");
+	PrintRing::drain();
+	const std::string text = endCapture();
+	check(occurrences(text, "the same warning") == 1
+		  && occurrences(text, "(last message repeated 9 times)") == 1
+		  && text.find("repeated 9") < text.find("another warning"),
+		  "repeats are counted, not printed");
+}
+
+static void testRateLimit()
+{
+	awaitNewSecond();
+	beginCapture();
+	char buf[64];
+	for (int n = 0; n < 100; n++) {
+		snprintf(buf, sizeof(buf), "rate-limited warning %d", n);
+		PrintRing::post(MMP_WARN, NULL, buf);
+	}
+	PrintRing::drain();
+	PrintRing::stop();		// reports what was suppressed
+	const std::string text = endCapture();
+	const int shown = occurrences(text, "rate-limited warning");
+	if (verbose)
+		printf("%d of 100 warnings printed\n", shown);
+	check(shown > 0 && shown <= 40 && notPrinted(text) == 100 - shown,
+		  "warnings are limited to a few dozen a second, and the rest counted");
+}
+
+static void testLongText()
+{
+	std::string line;
+	for (int n = 0; n < 100; n++)
+		line += "0123456789";
+	line += "\n";
+	beginCapture();
+	PrintRing::post(PrintRing::kStdout, NULL, line.c_str());
+	PrintRing::drain();
+	const std::string text = endCapture();
+	check(text == line, "text too long for one slot is printed whole");
+}
+
+static void testFullRing()
+{
+	awaitNewSecond();
+	beginCapture();
+	char buf[64];
+	for (int n = 0; n < 300; n++) {
+		snprintf(buf, sizeof(buf), "queued line %d\n", n);
+		PrintRing::post(PrintRing::kStdout, NULL, buf);
+	}
+	PrintRing::drain();
+	PrintRing::stop();
+	const std::string text = endCapture();
+	const int printed = occurrences(text, "queued line");
+	check(printed == 256 && text.find("queued line 255\n") != std::string::npos
+		  && notPrinted(text) == 44, "posts to a full ring are counted as lost");
+}
+
+// Several threads post at once while this one drains.  They pause now and
+// then, so that some lines are printed and some find the ring full.
+
+enum { kPosters = 4, kPerPoster = 5000 };
+
+static volatile int postersDone = 0;
+
+static void *postLines(void *arg)
+{
+	const int poster = *(int *) arg;
+	PrintRing::realtimeThread();
+	for (int n = 0; n < kPerPoster; n++) {
+		RTPrintf("poster %d line %d\n", poster, n);
+		if (n % 32 == 31)
+			usleep(100);
+	}
+	__sync_fetch_and_add(&postersDone, 1);
+	return NULL;
+}
+
+static void testConcurrentPosts()
+{
+	awaitNewSecond();
+	beginCapture();
+	int ids[kPosters];
+	pthread_t threads[kPosters];
+	for (int p = 0; p < kPosters; p++) {
+		ids[p] = p;
+		pthread_create(&threads[p], NULL, postLines, &ids[p]);
+	}
+	while (postersDone < kPosters)
+		PrintRing::drain();
+	for (int p = 0; p < kPosters; p++)
+		pthread_join(threads[p], NULL);
+	PrintRing::stop();
+	const std::string text = endCapture();
+
+	// Every line must be whole, and each poster's in order.
+	int last[kPosters], printed = 0;
+	bool whole = true, ordered = true;
+	for (int p = 0; p < kPosters; p++)
+		last[p] = -1;
+	size_t at = 0, end;
+	while ((end = text.find('\n', at)) != std::string::npos) {
+		const std::string line = text.substr(at, end - at);
+		at = end + 1;
+		if (line.empty() || line.find("not printed") != std::string::npos)
+			continue;
+		int poster, n;
+		char extra[8];
+		if (sscanf(line.c_str(), "poster %d line %d%1s", &poster, &n, extra) != 2
+				|| poster < 0 || poster >= kPosters || n < 0 || n >= kPerPoster) {
+			whole = false;
+			continue;
+		}
+		ordered = ordered && n > last[poster];
+		last[poster] = n;
+		printed++;
+	}
+	const int lost = notPrinted(text);
+	if (verbose)
+		printf("%d lines printed, %d lost\n", printed, lost);
+	check(whole && ordered, "concurrent posts are printed whole and in each poster's order");
+	check(printed + lost == kPosters * kPerPoster, "concurrent posts are printed or counted");
+}
+
+int
+main(int argc, char *argv[])
+{
+	verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+	setvbuf(stdout, NULL, _IOLBF, BUFSIZ);
+
+	testDeferring();
+	testRepeats();
+	testRateLimit();
+	testLongText();
+	testFullRing();
+	testConcurrentPosts();
+
+	if (failures > 0) {
+		printf("PrintRing: %d of the checks failed\n", failures);
+		return 1;
+	}
+	printf("PrintRing prints or counts every message\n");
+	return 0;
+}
@@ -15,6 +15,7 @@ resample version 1.2 (jos at ccrma dot stanford dot edu)\n\
 #include <math.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <unistd.h>
 #include <sndlibsupport.h>
 
 #define OUT_TYPE    MUS_AIFF
@@ -52,6 +53,7 @@ resample version 1.2 (jos at ccrma dot stanford dot edu)\n\
                                                                      \n\
      -n       No interpolation of filter coefficients (faster)       \n\
      -i       resample by linear Interpolation, not with filter      \n\
+     -j NUM   convert with NUM threads (0 = one per processor)       \n\
      -t       Terse (don't print out so much)                        \n\
      -v       print Version of program and quit                      \n\
   If no output file specified, writes to \"inputfile.resamp\".       \n\
@@ -87,6 +89,7 @@ main(int argc, char *argv[])
    BOOL   largeFilter = FALSE;    /* TRUE means use 65-tap FIR filter */
    BOOL   linearInterp = FALSE;   /* TRUE => no filter, linearly interpolate */
    int    trace = TRUE, designFilter = FALSE;
+   int    nThreads = 1;
    int    infd, outfd, insrate, nChans, inFormat, result;
    int    inCount, outCount, outCountReal;
    char   *insfname, *outsfname;
@@ -148,6 +151,18 @@ main(int argc, char *argv[])
             if (trace)
                printf("Using linear instead of bandlimited interpolation\n");
             break;
+         case 'j':                        /* -j threads */
+            if (--argc)
+               sscanf(*++argv, "%d", &nThreads);
+            if (nThreads < 0)
+               fail("number of threads must be 0 or more.");
+            if (nThreads == 0)
+               nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+            if (nThreads < 1)
+               nThreads = 1;
+            if (trace)
+               printf("Converting with %d threads.\n", nThreads);
+            break;
          case 't':                        /* -terse */
             trace = 0;
             break;
@@ -244,7 +259,7 @@ main(int argc, char *argv[])
    outCountReal = resample(factor, infd, outfd, inFormat, OUT_FORMAT,
                            inCount, outCount, nChans,
                            interpFilt, linearInterp, largeFilter,
-                           designFilter ? &filtspec : NULL);
+                           designFilter ? &filtspec : NULL, nThreads);
    if (outCountReal <= 0)
       fail("Conversion factor out of range");
 
@@ -87,6 +87,7 @@ int resample(           /* number of output sample returned */
     BOOL interpFilt,    /* TRUE means interpolate filter coeffs */
     int fastMode,       /* 0 = highest quality, slowest speed */
     BOOL largeFilter,   /* TRUE means use 65-tap FIR filter */
-    FiltSpec *filtspec  /* NULL for internal filter, else makeFilter */
+    FiltSpec *filtspec, /* NULL for internal filter, else makeFilter */
+    int nThreads        /* more than 1 to convert with threads */
 );
 
@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <math.h>
 #include <string.h>
+#include <pthread.h>
 #include "resample.h"
 #include "smallfilter.h"
 #include "largefilter.h"
@@ -236,14 +237,73 @@ WordToHword(WORD v, int scl)
 }
 
 
+/* The output sample at <Time> (fixed-point position in X) for each kind
+ * of conversion.  These are shared by the serial converters below and the
+ * threaded one, so both give exactly the same output.
+ */
+static INLINE HWORD
+LinearSample(HWORD X[], UWORD Time)
+{
+   HWORD iconst;
+   HWORD *Xp;
+   WORD v, x1, x2;
+
+   iconst = Time & Pmask;
+   Xp = &X[Time >> Np];              /* Ptr to current input sample */
+   x1 = *Xp++;
+   x2 = *Xp;
+   x1 *= ((1 << Np) - iconst);
+   x2 *= iconst;
+   v = x1 + x2;
+   return WordToHword(v, Np);
+}
+
+
+static INLINE HWORD
+UpSample(HWORD X[], UWORD Time, UHWORD Nwing, UHWORD LpScl,
+         HWORD Imp[], HWORD ImpD[], BOOL Interp)
+{
+   HWORD *Xp;
+   WORD v;
+
+   Xp = &X[Time >> Np];              /* Ptr to current input sample */
+                                     /* Perform left-wing inner product: */
+   v = FilterUp(Imp, ImpD, Nwing, Interp, Xp, (HWORD)(Time & Pmask), -1);
+                                     /* Perform right-wing inner product: */
+   v += FilterUp(Imp, ImpD, Nwing, Interp, Xp + 1,
+                                              (HWORD)((-Time) & Pmask), 1);
+   v >>= Nhg;                        /* Make guard bits */
+   v *= LpScl;                       /* Normalize for unity filter gain */
+   return WordToHword(v, NLpScl);    /* strip guard bits */
+}
+
+
+static INLINE HWORD
+UDSample(HWORD X[], UWORD Time, UHWORD Nwing, UHWORD LpScl,
+         HWORD Imp[], HWORD ImpD[], BOOL Interp, UHWORD dhb)
+{
+   HWORD *Xp;
+   WORD v;
+
+   Xp = &X[Time >> Np];              /* Ptr to current input sample */
+                                     /* Perform left-wing inner product: */
+   v = FilterUD(Imp, ImpD, Nwing, Interp, Xp,
+                                         (HWORD)(Time & Pmask), -1, dhb);
+                                     /* Perform right-wing inner product: */
+   v += FilterUD(Imp, ImpD, Nwing, Interp, Xp + 1,
+                                         (HWORD)((-Time) & Pmask), 1, dhb);
+   v >>= Nhg;                        /* Make guard bits */
+   v *= LpScl;                       /* Normalize for unity filter gain */
+   return WordToHword(v, NLpScl);    /* strip guard bits */
+}
+
+
 /* Sampling rate conversion using linear interpolation for maximum speed.
  */
 static int
 SrcLinear(HWORD X[], HWORD Y[], double factor, UWORD *Time, UHWORD Nx)
 {
-   HWORD iconst;
-   HWORD *Xp, *Ystart;
-   WORD v, x1, x2;
+   HWORD *Ystart;
 
    double dt;                        /* Step through input signal */
    UWORD dtb;                        /* Fixed-point version of Dt */
@@ -255,14 +315,7 @@ SrcLinear(HWORD X[], HWORD Y[], double factor, UWORD *Time, UHWORD Nx)
    Ystart = Y;
    endTime = *Time + (1 << Np) * (WORD) Nx;
    while (*Time < endTime) {
-      iconst = (*Time) & Pmask;
-      Xp = &X[(*Time) >> Np];        /* Ptr to current input sample */
-      x1 = *Xp++;
-      x2 = *Xp;
-      x1 *= ((1 << Np) - iconst);
-      x2 *= iconst;
-      v = x1 + x2;
-      *Y++ = WordToHword(v, Np);     /* Deposit output */
+      *Y++ = LinearSample(X, *Time); /* Deposit output */
       *Time += dtb;                  /* Move to next sample by time increment */
    }
    return (Y - Ystart);              /* Return number of output samples */
@@ -276,8 +329,7 @@ static int
 SrcUp(HWORD X[], HWORD Y[], double factor, UWORD *Time, UHWORD Nx,
       UHWORD Nwing, UHWORD LpScl, HWORD Imp[], HWORD ImpD[], BOOL Interp)
 {
-   HWORD *Xp, *Ystart;
-   WORD v;
+   HWORD *Ystart;
 
    double dt;                        /* Step through input signal */
    UWORD dtb;                        /* Fixed-point version of Dt */
@@ -289,15 +341,8 @@ SrcUp(HWORD X[], HWORD Y[], double factor, UWORD *Time, UHWORD Nx,
    Ystart = Y;
    endTime = *Time + (1 << Np) * (WORD) Nx;
    while (*Time < endTime) {
-      Xp = &X[*Time >> Np];          /* Ptr to current input sample */
-                                     /* Perform left-wing inner product: */
-      v = FilterUp(Imp, ImpD, Nwing, Interp, Xp, (HWORD)(*Time & Pmask), -1);
-                                     /* Perform right-wing inner product: */
-      v += FilterUp(Imp, ImpD, Nwing, Interp, Xp + 1,
-                                                 (HWORD)((-*Time) & Pmask), 1);
-      v >>= Nhg;                     /* Make guard bits */
-      v *= LpScl;                    /* Normalize for unity filter gain */
-      *Y++ = WordToHword(v, NLpScl); /* strip guard bits, deposit output */
+                                     /* Deposit output */
+      *Y++ = UpSample(X, *Time, Nwing, LpScl, Imp, ImpD, Interp);
       *Time += dtb;                  /* Move to next sample by time increment */
    }
    return (Y - Ystart);              /* Return the number of output samples */
@@ -310,8 +355,7 @@ static int
 SrcUD(HWORD X[], HWORD Y[], double factor, UWORD *Time, UHWORD Nx,
       UHWORD Nwing, UHWORD LpScl, HWORD Imp[], HWORD ImpD[], BOOL Interp)
 {
-   HWORD *Xp, *Ystart;
-   WORD v;
+   HWORD *Ystart;
 
    double dh;                        /* Step through filter impulse response */
    double dt;                        /* Step through input signal */
@@ -327,16 +371,8 @@ SrcUD(HWORD X[], HWORD Y[], double factor, UWORD *Time, UHWORD Nx,
    Ystart = Y;
    endTime = *Time + (1 << Np) * (WORD) Nx;
    while (*Time < endTime) {
-      Xp = &X[*Time >> Np];          /* Ptr to current input sample */
-                                     /* Perform left-wing inner product: */
-      v = FilterUD(Imp, ImpD, Nwing, Interp, Xp,
-                                            (HWORD)(*Time & Pmask), -1, dhb);
-                                     /* Perform right-wing inner product: */
-      v += FilterUD(Imp, ImpD, Nwing, Interp, Xp + 1,
-                                            (HWORD)((-*Time) & Pmask), 1, dhb);
-      v >>= Nhg;                     /* Make guard bits */
-      v *= LpScl;                    /* Normalize for unity filter gain */
-      *Y++ = WordToHword(v, NLpScl); /* strip guard bits, deposit output */
+                                     /* Deposit output */
+      *Y++ = UDSample(X, *Time, Nwing, LpScl, Imp, ImpD, Interp, dhb);
       *Time += dtb;                  /* Move to next sample by time increment */
    }
    return (Y - Ystart);              /* Return the number of output samples */
@@ -558,6 +594,173 @@ resampleWithFilter(double factor,      /* factor = Sndout/Sndin */
 }
 
 
+/* The threaded converter reads the whole input into memory, in large
+ * blocks, and then splits the output into one run of frames per thread.
+ * The position of output frame k in the input is exactly
+ * (Xoff << Np) + k * dtb, which is what the serial converters reach by
+ * adding dtb k times, so any run of output can be made without the ones
+ * before it, and the output is the same as theirs.  2 bytes per sample of
+ * input and output are held at once.
+ */
+
+#define BLOCKFRAMES 65536    /* frames per read() and write() */
+
+typedef struct {
+   HWORD  *X[2], *Y[2];     /* whole input (after Xoff zeros) and output */
+   int    nChans;
+   int    from, to;         /* output frames to compute */
+   UWORD  dtb;              /* fixed-point output period */
+   UHWORD dhb;              /* fixed-point filter period, for SrcUD */
+   int    Xoff;
+   int    fastMode;
+   BOOL   interpFilt;
+   HWORD  *Imp, *ImpD;
+   UHWORD LpScl, Nwing;
+   double factor;
+} SrcJob;
+
+
+static void *
+SrcRun(void *arg)
+{
+   SrcJob *job = (SrcJob *) arg;
+   int c, k;
+
+   for (c = 0; c < job->nChans; c++) {
+      HWORD *X = job->X[c], *Y = job->Y[c];
+      for (k = job->from; k < job->to; k++) {
+         /* Xb is the input sample at or just before frame k, and Time
+            is the fraction of a sample past it. */
+         unsigned long long pos = ((unsigned long long) job->Xoff << Np)
+                                  + (unsigned long long) k * job->dtb;
+         HWORD *Xb = &X[pos >> Np];
+         UWORD Time = (UWORD) (pos & Pmask);
+
+         if (job->fastMode)
+            Y[k] = LinearSample(Xb, Time);
+         else if (job->factor >= 1)
+            Y[k] = UpSample(Xb, Time, job->Nwing, job->LpScl,
+                            job->Imp, job->ImpD, job->interpFilt);
+         else
+            Y[k] = UDSample(Xb, Time, job->Nwing, job->LpScl,
+                            job->Imp, job->ImpD, job->interpFilt, job->dhb);
+      }
+   }
+   return NULL;
+}
+
+
+/* returns number of output samples */
+static int
+resampleThreaded(double factor,      /* factor = Sndout/Sndin */
+                 int    infd,        /* input and output file descriptors */
+                 int    outfd,
+                 int    inDataFormat, /* sndlib data format code */
+                 int    outDataFormat,
+                 int    inCount,     /* number of input samples to convert */
+                 int    outCount,    /* number of output samples to compute */
+                 int    nChans,      /* number of sound channels (1 or 2) */
+                 int    nThreads,    /* number of threads to convert with */
+                 int    fastMode,    /* linear interpolation, no filter */
+                 BOOL   interpFilt,  /* should interpolate filter coeffs? */
+                 HWORD  Imp[],
+                 HWORD  ImpD[],
+                 UHWORD LpScl,
+                 UHWORD Nmult,
+                 UHWORD Nwing)
+{
+   SrcJob job, *jobs;
+   pthread_t *threads;
+   HWORD *X[2], *Y[2];
+   UWORD dtb;
+   int c, i, t, Xoff, Xlen, last;
+
+   if (fastMode)
+      Xoff = 10;
+   else {
+      /* Account for increased filter gain when using factors less than 1 */
+      if (factor < 1)
+         LpScl = LpScl * factor + 0.5;
+      /* Calc reach of LP filter wing & give some creeping room */
+      Xoff = ((Nmult + 1) / 2.0) * MAX(1.0, 1.0 / factor) + 10;
+   }
+
+   dtb = (1.0 / factor) * (1 << Np) + 0.5;
+
+   /* Xoff zeros on either side of the input and of the last frame of
+      output, and room for the last block read. */
+   Xlen = (int) (((unsigned long long) outCount * dtb) >> Np) + 2;
+   Xlen = MAX(Xlen, inCount) + Xoff + BLOCKFRAMES + Xoff;
+   X[0] = X[1] = Y[0] = Y[1] = NULL;
+   for (c = 0; c < nChans; c++) {
+      X[c] = (HWORD *) calloc(Xlen, sizeof(HWORD));
+      Y[c] = (HWORD *) malloc(MAX(outCount, 1) * sizeof(HWORD));
+      if (X[c] == NULL || Y[c] == NULL) {
+         fprintf(stderr, "Can't allocate %d frames of input and output.\n"
+                         "Try again without -j.\n", inCount + outCount);
+         exit(1);
+      }
+   }
+
+   for (i = Xoff, last = 0; !last; i += BLOCKFRAMES)
+      last = readData(infd, inDataFormat, inCount, X[0] + i,
+                      X[nChans - 1] + i, BLOCKFRAMES, nChans, 0);
+
+   job.nChans = nChans;
+   job.dtb = dtb;
+   job.dhb = MIN(Npc, factor * Npc) * (1 << Na) + 0.5;
+   job.Xoff = Xoff;
+   job.fastMode = fastMode;
+   job.interpFilt = interpFilt;
+   job.Imp = Imp;
+   job.ImpD = ImpD;
+   job.LpScl = LpScl;
+   job.Nwing = Nwing;
+   job.factor = factor;
+   for (c = 0; c < 2; c++) {
+      job.X[c] = X[c];
+      job.Y[c] = Y[c];
+   }
+
+   if (nThreads > outCount)
+      nThreads = MAX(outCount, 1);
+   jobs = (SrcJob *) malloc(nThreads * sizeof(SrcJob));
+   threads = (pthread_t *) malloc(nThreads * sizeof(pthread_t));
+   if (jobs == NULL || threads == NULL) {
+      fprintf(stderr, "Can't allocate threads.\n");
+      exit(1);
+   }
+   for (t = 0; t < nThreads; t++) {
+      jobs[t] = job;
+      jobs[t].from = (int) ((long long) outCount * t / nThreads);
+      jobs[t].to = (int) ((long long) outCount * (t + 1) / nThreads);
+      if (pthread_create(&threads[t], NULL, SrcRun, &jobs[t]) != 0) {
+         perror("resample (pthread_create)");
+         exit(1);
+      }
+   }
+   for (t = 0; t < nThreads; t++) {
+      pthread_join(threads[t], NULL);
+      printf("."); fflush(stdout);
+   }
+
+   for (i = 0; i < outCount; i += BLOCKFRAMES) {
+      int n = MIN(BLOCKFRAMES, outCount - i);
+      (void) writeData(outfd, outDataFormat, Y[0] + i, Y[nChans - 1] + i,
+                                                              n, nChans);
+   }
+
+   for (c = 0; c < nChans; c++) {
+      free(X[c]);
+      free(Y[c]);
+   }
+   free(jobs);
+   free(threads);
+
+   return (outCount);              /* Return # of samples in output file */
+}
+
+
 /* returns number of output samples */
 int
 resample(double factor,         /* factor = Sndout/Sndin */
@@ -571,7 +774,8 @@ resample(double factor,         /* factor = Sndout/Sndin */
          BOOL   interpFilt,     /* TRUE means interpolate filter coeffs */
          int    fastMode,       /* 0 = highest quality, slowest speed */
          BOOL   largeFilter,    /* TRUE means use 65-tap FIR filter */
-         FiltSpec *filtspec)    /* NULL for internal filter, else makeFilter */
+         FiltSpec *filtspec,    /* NULL for internal filter, else makeFilter */
+         int    nThreads)       /* more than 1 to convert with threads */
 {
    UHWORD LpScl;                /* Unity-gain scale factor */
    UHWORD Nwing;                /* Filter table size */
@@ -579,6 +783,10 @@ resample(double factor,         /* factor = Sndout/Sndin */
    HWORD *Imp = 0;              /* Filter coefficients */
    HWORD *ImpD = 0;             /* ImpD[n] = Imp[n+1]-Imp[n] */
 
+   if (fastMode && nThreads > 1)
+      return resampleThreaded(factor, infd, outfd, inDataFormat,
+                              outDataFormat, inCount, outCount, nChans,
+                              nThreads, fastMode, FALSE, NULL, NULL, 0, 0, 0);
    if (fastMode)
       return resampleFast(factor, infd, outfd, inDataFormat, outDataFormat,
                                                 inCount, outCount, nChans);
@@ -640,6 +848,11 @@ resample(double factor,         /* factor = Sndout/Sndin */
  #endif
    LpScl *= 0.95;
 #endif
+   if (nThreads > 1)
+      return resampleThreaded(factor, infd, outfd, inDataFormat,
+                              outDataFormat, inCount, outCount, nChans,
+                              nThreads, fastMode, interpFilt, Imp, ImpD,
+                              LpScl, Nmult, Nwing);
    return resampleWithFilter(factor, infd, outfd, inDataFormat,
                              outDataFormat, inCount, outCount, nChans,
                              interpFilt, Imp, ImpD, LpScl, Nmult, Nwing);
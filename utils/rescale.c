@@ -4,6 +4,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <math.h>
@@ -27,11 +28,21 @@
 
 #define ABS(x)    ((x) < 0 ? (-x) : (x))
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
 
 char *progname = NULL;
 
+typedef struct {
+   int count;           /* samples clipped */
+   int max;             /* largest magnitude among them, before clipping */
+} ClipStats;
+
 static void usage(void);
 static float drandom(long *);
+static float convert_float(const float *, short *, int, double, long *,
+                                                               ClipStats *);
+static float convert_short(const short *, short *, int, double, long *,
+                                                               ClipStats *);
 
 
 /* ------------------------------------ usage, error and warning messages --- */
@@ -43,6 +54,7 @@ usage:  %s [options] input_filename [output_filename]   \n\
   --------------------------------------------------------------------- \n\
   -P NUM   desired peak amplitude           [32767]                     \n\
   -p NUM   peak amplitude of input file     [taken from file header]    \n\
+  -a       scan input file for its peak     [no]                        \n\
   -f NUM   rescale factor                   [desired peak / input peak] \n\
   -r       overwrite INPUT file             [no]                        \n\
   -t       use dithering algorithm          [no]                        \n\
@@ -56,6 +68,7 @@ usage:  %s [options] input_filename [output_filename]   \n\
   (1) If no output file name, and no overwrite option (-r), output      \n\
       file will have same name as input file, but with \".rescale\".    \n\
   (2) Desired peak (-P) ignored if you also specify rescale factor (-f).\n\
+  (3) With -a, the peak is that of just the part of the file rescaled. \n\
 "
 
 #define NO_PEAK_AMP_MSG                                         " \n\
@@ -63,7 +76,8 @@ Can't calculate rescale factor without an input peak amplitude.   \n\
 Do one of these things:                                           \n\
   - specify the factor yourself (e.g., -f 1.2)                    \n\
   - put a peak amplitude in the file header (e.g., with sndpeak)  \n\
-  - tell %s what the file's peak amp is (use -p option). \
+  - tell %s what the file's peak amp is (use -p option)  \n\
+  - have it scan the file for its peak amp (use -a option). \
 \n"
 
 #define DANGEROUS_OVERWRITE_MSG                                 " \n\
@@ -73,7 +87,8 @@ overtake the input samples. Run without the -r option.            \n\
 
 #define STALE_PEAK_STATS_WARNING "\
 WARNING: Calculating rescale factor from peak in file header, \n\
-         but this peak info might not be up-to-date. \
+         but this peak info might not be up-to-date. (Use -a to \n\
+         scan the file for its peak instead.) \
 \n"
 
 #define BAD_PEAK_LOC_WARNING "\
@@ -109,6 +124,203 @@ drandom(long *seeds)
 }
 
 
+/* ------------------------------------------------------------- kernels --- */
+/* convert_float and convert_short convert <n> input samples to shorts in
+   <out>, multiplied by <factor>, adding dither from <seeds> unless it's
+   NULL, and return the largest absolute value in the input.  If <clip>
+   is not NULL, limit the output to +-32767, adding the number of samples
+   clipped and the largest of them to <clip>.
+
+   Without dither, they do eight samples at a time with SSE2.  Like the
+   scalar code, this scales in double precision and truncates toward zero.
+*/
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RESCALE_SIMD 1
+
+/* four ints, scaled from <lo> and <hi> doubles */
+static inline __m128i
+scale4(__m128d lo, __m128d hi, __m128d vfactor)
+{
+   return _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_mul_pd(lo, vfactor)),
+                             _mm_cvttpd_epi32(_mm_mul_pd(hi, vfactor)));
+}
+
+static inline __m128i
+max4i(__m128i a, __m128i b)
+{
+   const __m128i gt = _mm_cmpgt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+static inline __m128i
+min4i(__m128i a, __m128i b)
+{
+   const __m128i lt = _mm_cmplt_epi32(a, b);
+   return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+}
+
+/* Packs eight ints to <out>, limiting them to +-32767 if <clip>, and
+   tracking in <vmax> and <vmin> the extremes of those out of range.
+*/
+static inline int
+store8(short *out, __m128i s0, __m128i s1, ClipStats *clip,
+       __m128i *vmax, __m128i *vmin)
+{
+   __m128i packed = _mm_packs_epi32(s0, s1);
+   int clipped = 0;
+
+   if (clip) {
+      const __m128i hi = _mm_set1_epi32(32767), lo = _mm_set1_epi32(-32767);
+      const int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(
+                          _mm_cmpgt_epi32(s0, hi), _mm_cmplt_epi32(s0, lo))))
+                     | (_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(
+                          _mm_cmpgt_epi32(s1, hi), _mm_cmplt_epi32(s1, lo))))
+                                                                        << 4);
+      if (mask) {
+         clipped = __builtin_popcount(mask);
+         *vmax = max4i(*vmax, max4i(s0, s1));
+         *vmin = min4i(*vmin, min4i(s0, s1));
+      }
+      packed = _mm_max_epi16(packed, _mm_set1_epi16(-32767));
+   }
+   _mm_storeu_si128((__m128i *) out, packed);
+   return clipped;
+}
+
+static void
+finish_clip(ClipStats *clip, int clipped, __m128i vmax, __m128i vmin)
+{
+   int i, m[4];
+
+   if (clip == NULL || clipped == 0)
+      return;
+   clip->count += clipped;
+   _mm_storeu_si128((__m128i *) m, vmax);
+   for (i = 0; i < 4; i++)
+      if (m[i] > clip->max)
+         clip->max = m[i];
+   _mm_storeu_si128((__m128i *) m, vmin);
+   for (i = 0; i < 4; i++)
+      if (m[i] < -clip->max)
+         clip->max = -m[i];
+}
+#endif /* __SSE2__ */
+
+
+static inline short
+limit(int samp, ClipStats *clip)
+{
+   if (samp < -32767) {             /* not -32768 */
+      if (samp < -clip->max)
+         clip->max = -samp;
+      samp = -32767;
+      clip->count++;
+   }
+   else if (samp > 32767) {
+      if (samp > clip->max)
+         clip->max = samp;
+      samp = 32767;
+      clip->count++;
+   }
+   return (short)samp;
+}
+
+
+static float
+convert_float(const float *in, short *out, int n, double factor, long *seeds,
+              ClipStats *clip)
+{
+   int i = 0;
+   float peak = 0.0;
+
+#ifdef RESCALE_SIMD
+   if (seeds == NULL && n >= 8) {
+      const __m128d vfactor = _mm_set1_pd(factor);
+      const __m128 signbit = _mm_set1_ps(-0.0f);
+      __m128 vpeak = _mm_setzero_ps();
+      __m128i vmax = _mm_setzero_si128(), vmin = _mm_setzero_si128();
+      float f[4];
+      int clipped = 0;
+
+      for ( ; i + 8 <= n; i += 8) {
+         const __m128 v0 = _mm_loadu_ps(&in[i]);
+         const __m128 v1 = _mm_loadu_ps(&in[i + 4]);
+         vpeak = _mm_max_ps(vpeak, _mm_andnot_ps(signbit, v0));
+         vpeak = _mm_max_ps(vpeak, _mm_andnot_ps(signbit, v1));
+         clipped += store8(&out[i],
+                     scale4(_mm_cvtps_pd(v0),
+                            _mm_cvtps_pd(_mm_movehl_ps(v0, v0)), vfactor),
+                     scale4(_mm_cvtps_pd(v1),
+                            _mm_cvtps_pd(_mm_movehl_ps(v1, v1)), vfactor),
+                     clip, &vmax, &vmin);
+      }
+      _mm_storeu_ps(f, vpeak);
+      peak = MAX(MAX(f[0], f[1]), MAX(f[2], f[3]));
+      finish_clip(clip, clipped, vmax, vmin);
+   }
+#endif
+   for ( ; i < n; i++) {
+      /* NB: Assigning to dblsamp seems to be necessary for accuracy.
+         "samp = (int)((double)in[i] * factor)" was NOT always.
+      */
+      double dblsamp = (double)in[i] * factor;
+      const float fabsamp = fabs(in[i]);
+      if (fabsamp > peak)
+         peak = fabsamp;
+      if (seeds)
+         dblsamp += (double)drandom(seeds);
+      out[i] = clip ? limit((int)dblsamp, clip) : (short)dblsamp;
+   }
+   return peak;
+}
+
+
+static float
+convert_short(const short *in, short *out, int n, double factor, long *seeds,
+              ClipStats *clip)
+{
+   int i = 0, peak = 0;
+
+#ifdef RESCALE_SIMD
+   if (seeds == NULL && n >= 8) {
+      const __m128d vfactor = _mm_set1_pd(factor);
+      __m128i vpeak = _mm_setzero_si128();
+      __m128i vmax = _mm_setzero_si128(), vmin = _mm_setzero_si128();
+      int m[4], clipped = 0;
+
+      for ( ; i + 8 <= n; i += 8) {
+         const __m128i v = _mm_loadu_si128((const __m128i *) &in[i]);
+         const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+         const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+         const __m128i slo = _mm_srai_epi32(lo, 31), shi = _mm_srai_epi32(hi, 31);
+         vpeak = max4i(vpeak, _mm_sub_epi32(_mm_xor_si128(lo, slo), slo));
+         vpeak = max4i(vpeak, _mm_sub_epi32(_mm_xor_si128(hi, shi), shi));
+         clipped += store8(&out[i],
+                     scale4(_mm_cvtepi32_pd(lo),
+                            _mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), vfactor),
+                     scale4(_mm_cvtepi32_pd(hi),
+                            _mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), vfactor),
+                     clip, &vmax, &vmin);
+      }
+      _mm_storeu_si128((__m128i *) m, vpeak);
+      peak = MAX(MAX(m[0], m[1]), MAX(m[2], m[3]));
+      finish_clip(clip, clipped, vmax, vmin);
+   }
+#endif
+   for ( ; i < n; i++) {
+      double dblsamp = (double)in[i] * factor;
+      const int absamp = ABS(in[i]);
+      if (absamp > peak)
+         peak = absamp;
+      if (seeds)
+         dblsamp += (double)drandom(seeds);
+      out[i] = clip ? limit((int)dblsamp, clip) : (short)dblsamp;
+   }
+   return (float)peak;
+}
+
+
 /* ----------------------------------------------------------------- main --- */
 int
 main(int argc, char *argv[])
@@ -116,15 +328,15 @@ main(int argc, char *argv[])
    int         i, replace, result, inswap, outswap;
    int         infd, outfd, intype, outtype, inheadersize, outheadersize;
    int         inclass, outclass, nchans, informat, outformat, srate, nsamps;
-   int         limiter, dither, inpeak_uptodate;
+   int         limiter, dither, inpeak_uptodate, scan;
    int         nbytes, inbytes, outbytes, durbytes, readbytes, bufcount;
-   float       inpeak, specified_peak, desired_peak, actual_peak;
+   float       inpeak, specified_peak, desired_peak, actual_peak, blockpeak;
    double      factor, inskip, outskip, dur, empty;
-   long        inskipbytes, outskipbytes, len, seeds[2];
+   long        inskipbytes, outskipbytes, len, seeds[2], mappos;
    short       outbuf[BUFSIZE];
    float       inbuf[BUFSIZE];
-   short       *bufp;
-   char        *insfname, *outsfname;
+   size_t      maplen;
+   char        *insfname, *outsfname, *map, *block;
    SFComment   insfc, outsfc;
    struct stat statbuf;
 
@@ -139,7 +351,7 @@ main(int argc, char *argv[])
       usage();
 
    insfname = outsfname = NULL;
-   replace = dither = inpeak_uptodate = bufcount = 0;
+   replace = dither = inpeak_uptodate = scan = bufcount = 0;
    inskip = outskip = dur = empty = 0.0;
    factor = inpeak = specified_peak = desired_peak = 0.0;
 
@@ -158,6 +370,9 @@ main(int argc, char *argv[])
                   usage();
                specified_peak = (float)atof(argv[i]);
                break;
+            case 'a':
+               scan = 1;
+               break;
             case 'f':
                if (++i >= argc)
                   usage();
@@ -240,6 +455,8 @@ main(int argc, char *argv[])
       printf("Specified rescale factor = %f\n", factor);
    if (specified_peak > 0.0)
       printf("Specified peak of input file = %f\n", specified_peak);
+   if (scan)
+      printf("Scanning input file for its peak.\n");
    if (desired_peak > 0.0) {
       if (factor > 0.0) {
          printf("You specified both a factor and a desired peak ...");
@@ -321,6 +538,37 @@ main(int argc, char *argv[])
       */
       inpeak_uptodate = sfcomment_peakstats_current(&insfc, infd);
    }
+
+   /* Find the peak of the part of the file to rescale.  sndlib_findpeak
+      maps the file to scan it, so the rescale loop below finds the pages
+      still in memory.
+   */
+   if (scan) {
+      long   startframe, nframes, framebytes = inclass * nchans;
+      long   peakloc[MAXCHANS];
+      float  peak[MAXCHANS];
+      double ampavg[MAXCHANS], dcavg[MAXCHANS], rms[MAXCHANS];
+
+      inskipbytes = (long)(inskip * srate * nchans * inclass);
+      startframe = inskipbytes / framebytes;
+      if (dur)
+         nframes = (long)(dur * inclass * nchans * srate) / framebytes;
+      else
+         nframes = (statbuf.st_size - inheadersize) / framebytes - startframe;
+      if (nframes <= 0
+            || sndlib_findpeak(infd, -1, inheadersize, -1, informat, nchans,
+                  startframe, nframes, peak, peakloc, ampavg, dcavg, rms)) {
+         fprintf(stderr, "Can't scan \"%s\" for its peak\n", insfname);
+         exit(1);
+      }
+      for (i = 0, inpeak = 0.0; i < nchans; i++) {
+         insfc.peak[i] = peak[i];
+         insfc.peakloc[i] = peakloc[i];
+         if (peak[i] > inpeak)
+            inpeak = peak[i];
+      }
+      inpeak_uptodate = 1;
+   }
    if (!inpeak_uptodate)
       printf(BAD_PEAK_LOC_WARNING);   /* output header peak locs unreliable */
 
@@ -348,15 +596,17 @@ main(int argc, char *argv[])
             insfc.peak[i] = specified_peak;
       }
       else {                                 /* use peak from header */
+         if (inpeak == 0.0) {
+            if (scan)
+               fprintf(stderr, "\"%s\" is silent.\n", insfname);
+            else
+               fprintf(stderr, NO_PEAK_AMP_MSG, progname);
+            exit(1);
+         }
          if (inpeak_uptodate)
             limiter = 0;
-         else {
-            if (inpeak == 0.0) {
-               fprintf(stderr, NO_PEAK_AMP_MSG, progname);
-               exit(1);
-            }
+         else
             printf(STALE_PEAK_STATS_WARNING);
-         }
          printf("Peak amplitude of input file is %f.\n", inpeak);
       }
       factor = ((double)desired_peak / (double)inpeak) + DBL_EPSILON;
@@ -527,13 +777,37 @@ main(int argc, char *argv[])
    readbytes = inbytes = BUFSIZE * inclass;
    durbytes = dur * inclass * nchans * srate;
 
-   bufp = (short *)inbuf;
-
    seeds[0] = 17;      /* seeds for dither */
    seeds[1] = 31;
 
+   /* Map the input from the skip to the end of the file, and take each
+      buffer from there rather than reading it.  If we can't, read.  (When
+      overwriting the input, the output still can't overtake the input,
+      because each buffer is converted before it's written.)
+   */
+   map = NULL;
+   maplen = mappos = 0;
+   if (fstat(infd, &statbuf) == 0
+                  && statbuf.st_size > inskipbytes + inheadersize) {
+      const long   pagesize = sysconf(_SC_PAGESIZE);
+      const off_t  start = inskipbytes + inheadersize;
+      const off_t  mapstart = start - (start % pagesize);
+
+      maplen = statbuf.st_size - mapstart;
+      map = (char *) mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, infd,
+                                                                  mapstart);
+      if (map == (char *) MAP_FAILED)
+         map = NULL;
+      else {
+#ifdef MADV_SEQUENTIAL
+         madvise(map, maplen, MADV_SEQUENTIAL);
+#endif
+         mappos = start - mapstart;
+      }
+   }
+
    while (1) {
-      double dblsamp;
+      ClipStats clip;
 
       if (dur) {
          if (durbytes <= readbytes)
@@ -541,12 +815,26 @@ main(int argc, char *argv[])
          durbytes -= inbytes;
       }
 
-      nbytes = read(infd, (char *)inbuf, inbytes);
-      if (nbytes == -1) {
-         fprintf(stderr, "Read on input file failed (%s)\n", strerror(errno));
-         close(infd);
-         close(outfd);
-         exit(1);
+      if (map) {
+         nbytes = MIN((long) inbytes, (long) maplen - mappos);
+         block = map + mappos;
+         mappos += nbytes;
+         /* need a copy to swap, or to align */
+         if (inswap || ((unsigned long) block % inclass) != 0) {
+            memcpy(inbuf, block, nbytes);
+            block = (char *)inbuf;
+         }
+      }
+      else {
+         nbytes = read(infd, (char *)inbuf, inbytes);
+         if (nbytes == -1) {
+            fprintf(stderr, "Read on input file failed (%s)\n",
+                                                            strerror(errno));
+            close(infd);
+            close(outfd);
+            exit(1);
+         }
+         block = (char *)inbuf;
       }
       if (nbytes == 0)                  /* reached EOF -- time to stop */
          break;
@@ -560,75 +848,27 @@ main(int argc, char *argv[])
                byte_reverse4(&inbuf[i]);
          }
          else {
+            short *bufp = (short *)inbuf;
             for (i = 0; i < nsamps; i++)
                byte_reverse2(&bufp[i]);
          }
       }
 
-      if (limiter) {
-         int  samp, clipmax, numclipped;
-
-         clipmax = numclipped = 0;
-
-         if (inclass == SF_FLOAT) {
-            for (i = 0; i < nsamps; i++) {
-#ifdef INPUT_PEAK_CHECK
-               float fabsamp = fabs(inbuf[i]);
-               if (fabsamp > actual_peak)
-                  actual_peak = fabsamp;
-#endif
-               /* NB: Assigning to dblsamp seems to be necessary for accuracy.
-                  "samp = (int)((double)inbuf[i] * factor)" was NOT always.
-               */
-               dblsamp = (double)inbuf[i] * factor;
-               if (dither)
-                  dblsamp += (double)drandom(seeds);
-               samp = (int)dblsamp;
-
-               if (samp < -32767) {             /* not -32768 */
-                  if (samp < -clipmax)
-                     clipmax = -samp;
-                  samp = -32767;
-                  numclipped++;
-               }
-               else if (samp > 32767) {
-                  if (samp > clipmax)
-                     clipmax = samp;
-                  samp = 32767;
-                  numclipped++;
-               }
-               outbuf[i] = (short)samp;
-            }
-         }
-         else {                                 /* SF_SHORT */
-            for (i = 0; i < nsamps; i++) {
+      clip.count = clip.max = 0;
+      if (inclass == SF_FLOAT)
+         blockpeak = convert_float((float *)block, outbuf, nsamps, factor,
+                           dither ? seeds : NULL, limiter ? &clip : NULL);
+      else
+         blockpeak = convert_short((short *)block, outbuf, nsamps, factor,
+                           dither ? seeds : NULL, limiter ? &clip : NULL);
 #ifdef INPUT_PEAK_CHECK
-               int absamp = ABS(bufp[i]);
-               if (absamp > (int)actual_peak)
-                  actual_peak = (float)absamp;
+      if (blockpeak > actual_peak)
+         actual_peak = blockpeak;
 #endif
-               dblsamp = (double)bufp[i] * factor;
-               if (dither)
-                  dblsamp += (double)drandom(seeds);
-               samp = (int)dblsamp;
-
-               if (samp < -32767) {             /* not -32768 */
-                  if (samp < -clipmax)
-                     clipmax = -samp;
-                  samp = -32767;
-                  numclipped++;
-               }
-               else if (samp > 32767) {
-                  if (samp > clipmax)
-                     clipmax = samp;
-                  samp = 32767;
-                  numclipped++;
-               }
-               outbuf[i] = (short)samp;
-            }
-         }
+
+      if (limiter) {
          bufcount++;
-         if (numclipped) {
+         if (clip.count) {
             float loc1 = (float)(((bufcount - 1) * BUFSIZE) / nchans)
                                                                 / (float)srate;
             float loc2 = (float)((bufcount * BUFSIZE) / nchans) / (float)srate;
@@ -637,36 +877,7 @@ main(int argc, char *argv[])
                loc2 += outskip;
             }
             printf("  CLIPPING: %4d samps, max: %d, output time: %f - %f\n",
-                   numclipped, clipmax, loc1, loc2);
-         }
-      }
-
-      else {                                   /* !limiter */
-         if (inclass == SF_FLOAT) {
-            for (i = 0; i < nsamps; i++) {
-#ifdef INPUT_PEAK_CHECK
-               float fabsamp = fabs(inbuf[i]);
-               if (fabsamp > actual_peak)
-                  actual_peak = fabsamp;
-#endif
-               dblsamp = (double)inbuf[i] * factor;
-               if (dither)
-                  dblsamp += (double)drandom(seeds);
-               outbuf[i] = (short)dblsamp;
-            }
-         }
-         else {                                /* SF_SHORT */
-            for (i = 0; i < nsamps; i++) {
-#ifdef INPUT_PEAK_CHECK
-               int absamp = ABS(bufp[i]);
-               if (absamp > (int)actual_peak)
-                  actual_peak = (float)absamp;
-#endif
-               dblsamp = (double)bufp[i] * factor;
-               if (dither)
-                  dblsamp += (double)drandom(seeds);
-               outbuf[i] = (short)dblsamp;
-            }
+                   clip.count, clip.max, loc1, loc2);
          }
       }
 
@@ -685,6 +896,10 @@ main(int argc, char *argv[])
       }
    }
 
+   /* before the file might be truncated below */
+   if (map)
+      munmap(map, maplen);
+
 
    /************************************************************************/
    /* CLEANUP                                                              */
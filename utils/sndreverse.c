@@ -8,6 +8,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sfheader.h>
 #include <byte_routines.h>
 #include <sndlibsupport.h>
@@ -16,14 +17,61 @@
    The channels of the soundfile are kept in the original order
    contrary to what an analog tape would do. */
 
-extern int swap;
+
+/* Copies <nframes> frames of <framebytes> bytes from <src> to <dst> in
+   reverse order.  Frames of 2, 4 or 8 bytes (mono or stereo shorts and
+   floats) are reversed 16 bytes at a time with SSE2.
+*/
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+static long
+reverse_block(const char *src, char *dst, long nframes, int framebytes)
+{
+   const long perblock = 16 / framebytes;
+   long i;
+
+   if (framebytes != 2 && framebytes != 4 && framebytes != 8)
+      return 0;
+   for (i = 0; i + perblock <= nframes; i += perblock) {
+      __m128i v = _mm_loadu_si128((const __m128i *)
+                                  (src + (nframes - i - perblock) * framebytes));
+      if (framebytes == 8)
+         v = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+      else {
+         v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+         if (framebytes == 2) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+         }
+      }
+      _mm_storeu_si128((__m128i *) (dst + i * framebytes), v);
+   }
+   return i;
+}
+#else
+#define reverse_block(src, dst, nframes, framebytes) (0L)
+#endif
+
+static void
+reverse_frames(const char *src, char *dst, long nframes, int framebytes)
+{
+   long i = reverse_block(src, dst, nframes, framebytes);
+
+   for ( ; i < nframes; i++)
+      memcpy(dst + i * framebytes, src + (nframes - 1 - i) * framebytes,
+                                                               framebytes);
+}
+
 
 int
 main(int argc, char *argv[])
 {
-   int      i, sfd1, sfd2, backsu, units, nsu, nextsu, result, readbyte;
-   off_t    bytes;
-   char     *forward, *back;
+   int      sfd1, sfd2, result, framebytes, dataloc;
+   long     nframes, bufframes, frames, done;
+   off_t    bytes, mapstart = 0;
+   size_t   maplen = 0;
+   char     *forward, *back, *map;
    char     outfilename[1024], infilename[1024];
    SFHEADER hd1, hd2;
    struct stat st;
@@ -64,78 +112,68 @@ main(int argc, char *argv[])
    if (result < 0)
       exit(1);
 
-   /* Get memory for buffers */
-   forward = (char *) malloc(SF_BUFSIZE);
-   back = (char *) malloc(SF_BUFSIZE);
+   /* Map the sound data, if we can, and fill each output buffer with the
+      frames at the end of what is left of it, in reverse order.  The output
+      has the same header and data format as the input, so the bytes of each
+      frame are copied as they are.
+   */
+   if (fstat(sfd1, &st) == -1) {
+      fprintf(stderr, "Can't get status on \"%s\".\n", infilename);
+      exit(1);
+   }
+   framebytes = sfclass(&hd1) * sfchans(&hd1);
+   dataloc = getheadersize(&hd1);
+   nframes = sfdatasize(&hd1);
+   if (dataloc + nframes > st.st_size)
+      nframes = st.st_size - dataloc;
+   nframes /= framebytes;
+   bufframes = SF_BUFSIZE / framebytes;
+
+   forward = (char *) malloc(bufframes * framebytes);
+   back = (char *) malloc(bufframes * framebytes);
    if (!forward || !back) {
       fprintf(stderr, "Bad allocation for buffers.\n");
       exit(1);
    }
 
-   bytes = sfdatasize(&hd1);
-   readbyte = bytes % SF_BUFSIZE;
-   if (lseek(sfd1, (long) -readbyte, SEEK_END) == -1) {
-      fprintf(stderr, "Bad seek.\n");
-      exit(1);
+   map = NULL;
+   if (nframes > 0) {
+      const long pagesize = sysconf(_SC_PAGESIZE);
+      mapstart = dataloc - (dataloc % pagesize);
+      maplen = (dataloc - mapstart) + nframes * framebytes;
+      map = (char *) mmap(NULL, maplen, PROT_READ, MAP_PRIVATE, sfd1, mapstart);
+      if (map == (char *) MAP_FAILED)
+         map = NULL;
    }
 
-   while (bytes > 0) {          /* For all of the samples */
-      if ((readbyte = read(sfd1, forward, SF_BUFSIZE)) < 0) {
-         fprintf(stderr, "Bad read on soundfile \"%s\".\n", infilename);
-         exit(1);
-      }
-      /* units = samples per read.
-         nsu = number of sample units per read. 
-         (sample unit = all channels
-         for this sample slot).
-         nextsu = next sample unit.
-         backsu = current backward sample unit 
-         starting channel. */
-
-      units = readbyte / sfclass(&hd1);
-      nextsu = 0;
-      nsu = units - sfchans(&hd1);
-      if (sfclass(&hd1) == SF_FLOAT) {  /* Do floating point file */
-         register float *fbuf = (float *) back;
-         float *fforward = (float *) forward;
-
-         while ((char *) fbuf < back + readbyte) {
-            backsu = nsu - nextsu;
-            for (i = 0; i < sfchans(&hd1); i++) {
-               *fbuf++ = *(fforward + backsu + i);
-               if (swap) {
-                  byte_reverse4(fbuf);
-               }
-            }
-            nextsu += i;
-         }
-      }
-      else {                    /* Integer (short) file */
-         register short *sbuf = (short *) back;
-         short *sforward = (short *) forward;
-
-         while ((char *) sbuf < back + readbyte) {
-            backsu = nsu - nextsu;
-            for (i = 0; i < sfchans(&hd1); i++) {
-               *sbuf++ = *(sforward + backsu + i);
-               if (swap) {
-                  byte_reverse2(sbuf);
-               }
-            }
-            nextsu += i;
+   for (done = 0; done < nframes; done += frames) {
+      char  *src;
+      off_t offset;
+
+      frames = nframes - done;
+      if (frames > bufframes)
+         frames = bufframes;
+      offset = (off_t) (nframes - done - frames) * framebytes;
+      bytes = frames * framebytes;
+      if (map)
+         src = map + (dataloc - mapstart) + offset;
+      else {
+         if (pread(sfd1, forward, bytes, dataloc + offset) != bytes) {
+            fprintf(stderr, "Bad read on soundfile \"%s\".\n", infilename);
+            exit(1);
          }
+         src = forward;
       }
 
-      if (write(sfd2, back, readbyte) != readbyte) {
+      reverse_frames(src, back, frames, framebytes);
+
+      if (write(sfd2, back, bytes) != bytes) {
          fprintf(stderr, "Bad write on soundfile.\n");
          exit(1);
       }
-      if ((bytes -= readbyte) > 0)
-         if (lseek(sfd1, (long) -(SF_BUFSIZE + readbyte), SEEK_CUR) == -1) {
-            fprintf(stderr, "Bad seek.\n");
-            exit(1);
-         }
    }
+   if (map)
+      munmap(map, maplen);
 
    /* Update header for bytes of sound data written. */
    putlength(outfilename, sfd2, &hd2);